@@ -406,10 +406,21 @@ JsonObjects::add_action(const cstring& name, Util::JsonArray*& params, Util::Jso
     action->emplace("id", id);
     action->emplace("runtime_data", params);
     action->emplace("primitives", body);
-    actions->append(action);
+    // the action is complete, and there may be many; keep its text rather than its tree
+    actions->append(new Util::JsonText(action));
     return id;
 }
 
+void
+JsonObjects::add_action_alias(const cstring& name, unsigned id) {
+    if (action_aliases == nullptr)
+        action_aliases = insert_array_field(toplevel, "action_aliases");
+    auto alias = new Util::JsonObject();
+    alias->emplace("name", name);
+    alias->emplace("action_id", id);
+    action_aliases->append(alias);
+}
+
 void
 JsonObjects::add_extern_attribute(const cstring& name, const cstring& type,
                                   const cstring& value, Util::JsonArray* attributes) {
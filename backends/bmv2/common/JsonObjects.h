@@ -52,6 +52,8 @@ class JsonObjects {
     void add_parse_vset(const cstring& name, const unsigned bitwidth,
                         const big_int& size);
     unsigned add_action(const cstring& name, Util::JsonArray*& params, Util::JsonArray*& body);
+    /// List @name as another name of the action with @id.
+    void add_action_alias(const cstring& name, unsigned id);
     void add_extern_attribute(const cstring& name, const cstring& type,
                               const cstring& value, Util::JsonArray* attributes);
     void add_extern(const cstring& name, const cstring& type, Util::JsonArray* attributes);
@@ -69,6 +71,7 @@ class JsonObjects {
     Util::JsonObject* toplevel;
     Util::JsonObject* meta;
     Util::JsonArray* actions;
+    Util::JsonArray* action_aliases = nullptr;  // only emitted if not empty
     Util::JsonArray* calculations;
     Util::JsonArray* checksums;
     Util::JsonArray* counters;
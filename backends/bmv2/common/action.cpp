@@ -195,12 +195,59 @@ ActionConverter::convertActionParams(const IR::ParameterList *parameters,
     }
 }
 
+bool ActionConverter::sharedTable(const IR::P4Action* left, const IR::P4Action* right) {
+    if (!tablesComputed) {
+        tablesComputed = true;
+        forAllMatching<IR::P4Table>(ctxt->toplevel->getProgram(),
+                                    [this](const IR::P4Table* table) {
+            auto actions = table->getActionList();
+            if (actions == nullptr)
+                return;
+            for (auto element : actions->actionList) {
+                auto decl = ctxt->refMap->getDeclaration(element->getPath(), true);
+                if (auto action = decl->to<IR::P4Action>())
+                    tables[action].emplace(table);
+            }
+        });
+    }
+    auto l = tables.find(left), r = tables.find(right);
+    if (l == tables.end() || r == tables.end())
+        return false;
+    for (auto table : l->second)
+        if (r->second.count(table))
+            return true;
+    return false;
+}
+
+const IR::P4Action* ActionConverter::findDuplicate(const IR::P4Action* action,
+                                                   Util::JsonArray* params,
+                                                   Util::JsonArray* body) {
+    Util::JsonObject converted;
+    converted.emplace("runtime_data", params);
+    converted.emplace("primitives", body);
+    auto& candidates = emitted[converted.toString().c_str()];
+    for (auto candidate : candidates)
+        if (!sharedTable(action, candidate))
+            return candidate;
+    candidates.push_back(action);
+    return nullptr;
+}
+
 void ActionConverter::postorder(const IR::P4Action* action) {
     cstring name = action->controlPlaneName();
     auto params = new Util::JsonArray();
     convertActionParams(action->parameters, params);
     auto body = new Util::JsonArray();
     convertActionBody(&action->body->components, body);
+    if (deduplicate) {
+        if (auto duplicate = findDuplicate(action, params, body)) {
+            auto id = ctxt->structure->ids.at(duplicate);
+            ctxt->json->add_action_alias(name, id);
+            LOG3("action " << name << " shares the body of " << duplicate << " with id " << id);
+            ctxt->structure->ids.emplace(action, id);
+            return;
+        }
+    }
     auto id = ctxt->json->add_action(name, params, body);
     LOG3("add action with id " << id << " name " << name << " " << action);
     ctxt->structure->ids.emplace(action, id);
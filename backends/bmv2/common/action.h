@@ -17,25 +17,49 @@ limitations under the License.
 #ifndef BACKENDS_BMV2_COMMON_ACTION_H_
 #define BACKENDS_BMV2_COMMON_ACTION_H_
 
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "ir/ir.h"
 #include "helpers.h"
 
 namespace BMV2 {
 
+/**
+ * Converts actions to JSON.  With @deduplicate, an action whose parameters and primitives
+ * convert to the same JSON as an action converted before it (which happens often after
+ * LocalizeAllActions) is not emitted again: it gets the id of that action, and its name is
+ * listed in the top-level "action_aliases" array.  The tables keep listing the action
+ * under its own name, so the control plane can still use it.  Two actions listed by the
+ * same table are never merged, since BMv2 selects the next table by action id.
+ */
 class ActionConverter : public Inspector {
     ConversionContext* ctxt;
+    // the actions emitted so far, by the text of their parameters and primitives
+    std::map<std::string, std::vector<const IR::P4Action*>> emitted;
+    // the tables listing each action; computed on first use
+    std::map<const IR::P4Action*, std::set<const IR::P4Table*>> tables;
+    bool tablesComputed = false;
 
     void convertActionBody(const IR::Vector<IR::StatOrDecl>* body,
                            Util::JsonArray* result);
     void convertActionParams(const IR::ParameterList *parameters,
                              Util::JsonArray* params);
     cstring jsonAssignment(const IR::Type* type, bool inParser);
+    /// An emitted action that @action can share, given its converted @params and @body.
+    const IR::P4Action* findDuplicate(const IR::P4Action* action, Util::JsonArray* params,
+                                      Util::JsonArray* body);
+    bool sharedTable(const IR::P4Action* left, const IR::P4Action* right);
     void postorder(const IR::P4Action* action) override;
 
  public:
     const bool emitExterns;
-    explicit ActionConverter(ConversionContext* ctxt, const bool& emitExterns_)
-        : ctxt(ctxt), emitExterns(emitExterns_) {
+    const bool deduplicate;
+    explicit ActionConverter(ConversionContext* ctxt, const bool& emitExterns_,
+                             bool deduplicate = false)
+        : ctxt(ctxt), emitExterns(emitExterns_), deduplicate(deduplicate) {
         setName("ConvertActions"); }
 };
 
@@ -27,6 +27,7 @@ limitations under the License.
 #include "lib/exceptions.h"
 #include "lib/gc.h"
 #include "lib/json.h"
+#include "lib/json_binary.h"
 #include "lib/log.h"
 #include "lib/nullstream.h"
 #include "JsonObjects.h"
@@ -61,10 +62,12 @@ class Backend {
             P4::ConvertEnums::EnumMapping* enumMap) :
         options(options),
         refMap(refMap), typeMap(typeMap), enumMap(enumMap),
-        corelib(P4::P4CoreLibrary::instance), json(new BMV2::JsonObjects()) {
+        corelib(P4::P4CoreLibrary::instance()), json(new BMV2::JsonObjects()) {
         refMap->setIsV1(options.isv1());
         }
     void serialize(std::ostream& out) const { json->toplevel->serialize(out); }
+    void serializeBinary(std::ostream& out) const
+    { Util::JsonBinary::write(out, json->toplevel); }
     virtual void convert(const IR::ToplevelBlock* block) = 0;
 };
 
@@ -86,6 +89,8 @@ class SkipControls : public P4::ActionSynthesisPolicy {
             return false;
         return true;
     }
+    // each synthesized action is a table applied to every packet
+    bool coalesce() override { return true; }
 };
 
 /**
@@ -17,8 +17,13 @@ limitations under the License.
 #ifndef BACKENDS_BMV2_COMMON_CONTROL_H_
 #define BACKENDS_BMV2_COMMON_CONTROL_H_
 
+#include <algorithm>
+#include <exception>
+#include <vector>
+
 #include "ir/ir.h"
 #include "lib/json.h"
+#include "lib/thread_pool.h"
 #include "controlFlowGraph.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/typeMap.h"
@@ -428,159 +433,192 @@ class ControlConverter : public Inspector {
     convertTableEntries(table, result);
     return result;
     }
+    /// The number of const entries converted by each task when they are converted in parallel.
+    static constexpr size_t ENTRIES_PER_TASK = 256;
+
     void convertTableEntries(const IR::P4Table *table, Util::JsonObject *jsonTable) {
         auto entriesList = table->getEntries();
         if (entriesList == nullptr) return;
 
         auto entries = mkArrayField(jsonTable, "entries");
-        int entryPriority = 1;  // default priority is defined by index position
-        for (auto e : entriesList->entries) {
-            auto entry = new Util::JsonObject();
-            entry->emplace_non_null("source_info", e->sourceInfoJsonObj());
-
-            auto keyset = e->getKeys();
-            auto matchKeys = mkArrayField(entry, "match_key");
-            int keyIndex = 0;
-            for (auto k : keyset->components) {
-                auto key = new Util::JsonObject();
-                auto tableKey = table->getKey()->keyElements.at(keyIndex);
-                auto keyWidth = tableKey->expression->type->width_bits();
-                auto k8 = ROUNDUP(keyWidth, 8);
-                auto matchType = getKeyMatchType(tableKey);
-                // Table key fields with match_kind optional will be
-                // represented in the BMv2 JSON file the same as a ternary
-                // field would be.
-                if (matchType == "optional") {
-                    key->emplace("match_type", "ternary");
+        auto& list = entriesList->entries;
+        // The entries are converted independently from each other, so long lists are
+        // split between the threads; the results and diagnostics are then collected in
+        // the order of the entries, as if they had been converted one after the other.
+        std::vector<Util::IJson*> converted(list.size());
+        size_t tasks = (list.size() + ENTRIES_PER_TASK - 1) / ENTRIES_PER_TASK;
+        if (tasks < 2 || Util::ThreadPool::global().concurrency() < 2) {
+            for (size_t i = 0; i < list.size(); i++)
+                converted[i] = convertTableEntry(table, list.at(i), i + 1);
+        } else {
+            std::vector<ErrorReporter::Deferred> deferred(tasks);
+            std::vector<std::exception_ptr> failed(tasks);
+            Util::ThreadPool::global().parallel_for(tasks, [&](size_t t) {
+                ErrorReporter::Deferred::Scope keep(deferred[t]);
+                try {
+                    auto last = std::min(list.size(), (t + 1) * ENTRIES_PER_TASK);
+                    for (size_t i = t * ENTRIES_PER_TASK; i < last; i++)
+                        converted[i] = convertTableEntry(table, list.at(i), i + 1);
+                } catch (...) {
+                    failed[t] = std::current_exception(); } });
+            auto& reporter = BaseCompileContext::get().errorReporter();
+            for (size_t t = 0; t < tasks; t++) {
+                reporter.emit(deferred[t]);
+                if (failed[t])
+                    std::rethrow_exception(failed[t]);
+            }
+        }
+        for (auto entry : converted)
+            entries->append(entry);
+    }
+    /// Converts @e, the entry at @entryPriority (counting from 1) in the const entries
+    /// of @table.
+    Util::IJson* convertTableEntry(const IR::P4Table *table, const IR::Entry *e,
+                                   int entryPriority) {
+        auto entry = new Util::JsonObject();
+        entry->emplace_non_null("source_info", e->sourceInfoJsonObj());
+
+        auto keyset = e->getKeys();
+        auto matchKeys = mkArrayField(entry, "match_key");
+        int keyIndex = 0;
+        for (auto k : keyset->components) {
+            auto key = new Util::JsonObject();
+            auto tableKey = table->getKey()->keyElements.at(keyIndex);
+            auto keyWidth = tableKey->expression->type->width_bits();
+            auto k8 = ROUNDUP(keyWidth, 8);
+            auto matchType = getKeyMatchType(tableKey);
+            // Table key fields with match_kind optional will be
+            // represented in the BMv2 JSON file the same as a ternary
+            // field would be.
+            if (matchType == "optional") {
+                key->emplace("match_type", "ternary");
+            } else {
+                key->emplace("match_type", matchType);
+            }
+            if (matchType == corelib.exactMatch.name) {
+                if (k->is<IR::Constant>())
+                    key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                else if (k->is<IR::BoolLiteral>())
+                    // booleans are converted to ints
+                    key->emplace("key",
+                            stringRepr(k->to<IR::BoolLiteral>()->value ? 1 : 0, k8));
+                else
+                    ::error(ErrorType::ERR_UNSUPPORTED,
+                            "%1%: unsupported exact key expression", k);
+            } else if (matchType == corelib.ternaryMatch.name) {
+                if (k->is<IR::Mask>()) {
+                    auto km = k->to<IR::Mask>();
+                    key->emplace("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
+                    key->emplace("mask", stringRepr(km->right->to<IR::Constant>()->value, k8));
+                } else if (k->is<IR::Constant>()) {
+                    key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                    key->emplace("mask", stringRepr(Util::mask(keyWidth), k8));
+                } else if (k->is<IR::DefaultExpression>()) {
+                    key->emplace("key", stringRepr(0, k8));
+                    key->emplace("mask", stringRepr(0, k8));
                 } else {
-                    key->emplace("match_type", matchType);
+                    ::error(ErrorType::ERR_UNSUPPORTED,
+                            "%1%: unsupported ternary key expression", k);
                 }
-                if (matchType == corelib.exactMatch.name) {
-                    if (k->is<IR::Constant>())
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
-                    else if (k->is<IR::BoolLiteral>())
-                        // booleans are converted to ints
-                        key->emplace("key",
-                                stringRepr(k->to<IR::BoolLiteral>()->value ? 1 : 0, k8));
+            } else if (matchType == corelib.lpmMatch.name) {
+                if (k->is<IR::Mask>()) {
+                    auto km = k->to<IR::Mask>();
+                    key->emplace("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
+                    auto trailing_zeros = [](unsigned long n, unsigned long keyWidth)
+                        { return n ? __builtin_ctzl(n) : static_cast<int>(keyWidth); };
+                    auto count_ones = [](unsigned long n)
+                        { return n ? __builtin_popcountl(n) : 0;};
+                    auto mask =
+                        static_cast<unsigned long>(km->right->to<IR::Constant>()->value);
+                    auto len = trailing_zeros(mask, keyWidth);
+                    if (len + count_ones(mask) != keyWidth)  // any remaining 0s in the prefix?
+                        ::error(ErrorType::ERR_INVALID, "%1%: invalid mask for LPM key", k);
                     else
-                        ::error(ErrorType::ERR_UNSUPPORTED,
-                                "%1%: unsupported exact key expression", k);
-                } else if (matchType == corelib.ternaryMatch.name) {
-                    if (k->is<IR::Mask>()) {
-                        auto km = k->to<IR::Mask>();
-                        key->emplace("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
-                        key->emplace("mask", stringRepr(km->right->to<IR::Constant>()->value, k8));
-                    } else if (k->is<IR::Constant>()) {
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("mask", stringRepr(Util::mask(keyWidth), k8));
-                    } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("key", stringRepr(0, k8));
-                        key->emplace("mask", stringRepr(0, k8));
-                    } else {
-                        ::error(ErrorType::ERR_UNSUPPORTED,
-                                "%1%: unsupported ternary key expression", k);
-                    }
-                } else if (matchType == corelib.lpmMatch.name) {
-                    if (k->is<IR::Mask>()) {
-                        auto km = k->to<IR::Mask>();
-                        key->emplace("key", stringRepr(km->left->to<IR::Constant>()->value, k8));
-                        auto trailing_zeros = [](unsigned long n, unsigned long keyWidth)
-                            { return n ? __builtin_ctzl(n) : static_cast<int>(keyWidth); };
-                        auto count_ones = [](unsigned long n)
-                            { return n ? __builtin_popcountl(n) : 0;};
-                        auto mask =
-                            static_cast<unsigned long>(km->right->to<IR::Constant>()->value);
-                        auto len = trailing_zeros(mask, keyWidth);
-                        if (len + count_ones(mask) != keyWidth)  // any remaining 0s in the prefix?
-                            ::error(ErrorType::ERR_INVALID, "%1%: invalid mask for LPM key", k);
-                        else
-                            key->emplace("prefix_length", keyWidth - len);
-                    } else if (k->is<IR::Constant>()) {
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("prefix_length", keyWidth);
-                    } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("key", stringRepr(0, k8));
-                        key->emplace("prefix_length", 0);
-                    } else {
-                        ::error(ErrorType::ERR_UNSUPPORTED,
-                                "%1%: unsupported LPM key expression", k);
-                    }
-                } else if (matchType == "range") {
-                    if (k->is<IR::Range>()) {
-                        auto kr = k->to<IR::Range>();
-                        key->emplace("start", stringRepr(kr->left->to<IR::Constant>()->value, k8));
-                        key->emplace("end", stringRepr(kr->right->to<IR::Constant>()->value, k8));
-                    } else if (k->is<IR::Constant>()) {
-                        key->emplace("start", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("end", stringRepr(k->to<IR::Constant>()->value, k8));
-                    } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("start", stringRepr(0, k8));
-                        key->emplace("end", stringRepr((1 << keyWidth)-1, k8));  // 2^N -1
-                    } else {
-                        ::error(ErrorType::ERR_UNSUPPORTED,
-                                "%1% unsupported range key expression", k);
-                    }
-                } else if (matchType == "optional") {
-                    // Table key fields with match_kind optional with
-                    // "const entries" in the P4 source code will be
-                    // represented using the same "key" and "mask" keys in
-                    // the BMv2 JSON file as table key fields with
-                    // match_kind ternary.  In the P4 source code we only
-                    // allow exact values or a DefaultExpression (_ or
-                    // default), no &&& expression.
-                    if (k->is<IR::Constant>()) {
-                        key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
-                        key->emplace("mask", stringRepr(Util::mask(keyWidth), k8));
-                    } else if (k->is<IR::DefaultExpression>()) {
-                        key->emplace("key", stringRepr(0, k8));
-                        key->emplace("mask", stringRepr(0, k8));
-                    } else {
-                        ::error(ErrorType::ERR_UNSUPPORTED,
-                                "%1%: unsupported optional key expression", k);
-                    }
+                        key->emplace("prefix_length", keyWidth - len);
+                } else if (k->is<IR::Constant>()) {
+                    key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                    key->emplace("prefix_length", keyWidth);
+                } else if (k->is<IR::DefaultExpression>()) {
+                    key->emplace("key", stringRepr(0, k8));
+                    key->emplace("prefix_length", 0);
                 } else {
-                    ::error(ErrorType::ERR_UNKNOWN,
-                            "unknown key match type '%2%' for key %1%", k, matchType);
+                    ::error(ErrorType::ERR_UNSUPPORTED,
+                            "%1%: unsupported LPM key expression", k);
+                }
+            } else if (matchType == "range") {
+                if (k->is<IR::Range>()) {
+                    auto kr = k->to<IR::Range>();
+                    key->emplace("start", stringRepr(kr->left->to<IR::Constant>()->value, k8));
+                    key->emplace("end", stringRepr(kr->right->to<IR::Constant>()->value, k8));
+                } else if (k->is<IR::Constant>()) {
+                    key->emplace("start", stringRepr(k->to<IR::Constant>()->value, k8));
+                    key->emplace("end", stringRepr(k->to<IR::Constant>()->value, k8));
+                } else if (k->is<IR::DefaultExpression>()) {
+                    key->emplace("start", stringRepr(0, k8));
+                    key->emplace("end", stringRepr((1 << keyWidth)-1, k8));  // 2^N -1
+                } else {
+                    ::error(ErrorType::ERR_UNSUPPORTED,
+                            "%1% unsupported range key expression", k);
+                }
+            } else if (matchType == "optional") {
+                // Table key fields with match_kind optional with
+                // "const entries" in the P4 source code will be
+                // represented using the same "key" and "mask" keys in
+                // the BMv2 JSON file as table key fields with
+                // match_kind ternary.  In the P4 source code we only
+                // allow exact values or a DefaultExpression (_ or
+                // default), no &&& expression.
+                if (k->is<IR::Constant>()) {
+                    key->emplace("key", stringRepr(k->to<IR::Constant>()->value, k8));
+                    key->emplace("mask", stringRepr(Util::mask(keyWidth), k8));
+                } else if (k->is<IR::DefaultExpression>()) {
+                    key->emplace("key", stringRepr(0, k8));
+                    key->emplace("mask", stringRepr(0, k8));
+                } else {
+                    ::error(ErrorType::ERR_UNSUPPORTED,
+                            "%1%: unsupported optional key expression", k);
                 }
-                matchKeys->append(key);
-                keyIndex++;
-            }
-
-            auto action = new Util::JsonObject();
-            auto actionRef = e->getAction();
-            if (!actionRef->is<IR::MethodCallExpression>())
-                ::error(ErrorType::ERR_INVALID, "Invalid action '%1%' in entries list.", actionRef);
-            auto actionCall = actionRef->to<IR::MethodCallExpression>();
-            auto method = actionCall->method->to<IR::PathExpression>()->path;
-            auto decl = ctxt->refMap->getDeclaration(method, true);
-            auto actionDecl = decl->to<IR::P4Action>();
-            unsigned id = get(ctxt->structure->ids, actionDecl, INVALID_ACTION_ID);
-            BUG_CHECK(id != INVALID_ACTION_ID,
-                      "Could not find id for %1%", actionDecl);
-            action->emplace("action_id", id);
-            auto actionData = mkArrayField(action, "action_data");
-            for (auto arg : *actionCall->arguments) {
-                actionData->append(stringRepr(arg->expression->to<IR::Constant>()->value, 0));
-            }
-            entry->emplace("action_entry", action);
-
-            auto priorityAnnotation = e->getAnnotation("priority");
-            if (priorityAnnotation != nullptr) {
-                if (priorityAnnotation->expr.size() > 1)
-                    ::error(ErrorType::ERR_INVALID, "Invalid priority value %1%",
-                            priorityAnnotation->expr);
-                auto priValue = priorityAnnotation->expr.front();
-                if (!priValue->is<IR::Constant>())
-                    ::error(ErrorType::ERR_INVALID, "Invalid priority value %1%; must be constant.",
-                            priorityAnnotation->expr);
-                entry->emplace("priority", priValue->to<IR::Constant>()->value);
             } else {
-                entry->emplace("priority", entryPriority);
+                ::error(ErrorType::ERR_UNKNOWN,
+                        "unknown key match type '%2%' for key %1%", k, matchType);
             }
-            entryPriority += 1;
+            matchKeys->append(key);
+            keyIndex++;
+        }
 
-            entries->append(entry);
+        auto action = new Util::JsonObject();
+        auto actionRef = e->getAction();
+        if (!actionRef->is<IR::MethodCallExpression>())
+            ::error(ErrorType::ERR_INVALID, "Invalid action '%1%' in entries list.", actionRef);
+        auto actionCall = actionRef->to<IR::MethodCallExpression>();
+        auto method = actionCall->method->to<IR::PathExpression>()->path;
+        auto decl = ctxt->refMap->getDeclaration(method, true);
+        auto actionDecl = decl->to<IR::P4Action>();
+        unsigned id = get(ctxt->structure->ids, actionDecl, INVALID_ACTION_ID);
+        BUG_CHECK(id != INVALID_ACTION_ID,
+                  "Could not find id for %1%", actionDecl);
+        action->emplace("action_id", id);
+        auto actionData = mkArrayField(action, "action_data");
+        for (auto arg : *actionCall->arguments) {
+            actionData->append(stringRepr(arg->expression->to<IR::Constant>()->value, 0));
+        }
+        entry->emplace("action_entry", action);
+
+        auto priorityAnnotation = e->getAnnotation("priority");
+        if (priorityAnnotation != nullptr) {
+            if (priorityAnnotation->expr.size() > 1)
+                ::error(ErrorType::ERR_INVALID, "Invalid priority value %1%",
+                        priorityAnnotation->expr);
+            auto priValue = priorityAnnotation->expr.front();
+            if (!priValue->is<IR::Constant>())
+                ::error(ErrorType::ERR_INVALID, "Invalid priority value %1%; must be constant.",
+                        priorityAnnotation->expr);
+            entry->emplace("priority", priValue->to<IR::Constant>()->value);
+        } else {
+            entry->emplace("priority", entryPriority);
         }
+        // kept as text: there may be many entries, and they do not change
+        return new Util::JsonText(entry);
     }
     cstring getKeyMatchType(const IR::KeyElement *ke) {
         auto path = ke->matchType->path;
@@ -734,8 +772,8 @@ class ControlConverter : public Inspector {
         auto result = new Util::JsonObject();
         result->emplace("name", node->name);
         result->emplace("id", nextId("conditionals"));
-        result->emplace_non_null("source_info", node->statement->condition->sourceInfoJsonObj());
-        auto j = ctxt->conv->convert(node->statement->condition, true, false);
+        result->emplace_non_null("source_info", node->condition->sourceInfoJsonObj());
+        auto j = ctxt->conv->convert(node->condition, true, false);
         CHECK_NULL(j);
         result->emplace("expression", j);
         for (auto e : node->successors.edges) {
@@ -761,6 +799,7 @@ class ControlConverter : public Inspector {
         bool success = cfg->checkImplementable();
         if (!success)
             return false;
+        cfg->simplify(ctxt->typeMap);
 
         if (cfg->entryPoint->successors.size() == 0) {
             result->emplace("init_table", Util::JsonValue::null);
@@ -825,12 +864,13 @@ class ControlConverter : public Inspector {
             P4C_UNIMPLEMENTED("%1%: not yet handled", c);
         }
 
-        ctxt->json->pipelines->append(result);
+        // finished, so kept as text rather than as a tree
+        ctxt->json->pipelines->append(new Util::JsonText(result));
         return false;
     }
 
     explicit ControlConverter(ConversionContext* ctxt, cstring name, const bool& emitExterns_) :
-        ctxt(ctxt), name(name), corelib(P4::P4CoreLibrary::instance), emitExterns(emitExterns_)
+        ctxt(ctxt), name(name), corelib(P4::P4CoreLibrary::instance()), emitExterns(emitExterns_)
     { setName("ControlConverter"); }
 };
 
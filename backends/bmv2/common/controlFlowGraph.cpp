@@ -181,6 +181,119 @@ bool CFG::checkImplementable() const {
     return true;
 }
 
+namespace {
+
+/// The edge taken from @node when its condition is @value.
+CFG::Edge* branch(CFG::Node* node, bool value) {
+    for (auto e : node->successors.edges)
+        if (e->isBool() && e->getBool() == value)
+            return e;
+    return nullptr;
+}
+
+/// True if @condition calls no method other than isValid.
+bool simpleCondition(const IR::Expression* condition) {
+    bool simple = true;
+    forAllMatching<IR::MethodCallExpression>(condition,
+                                             [&simple](const IR::MethodCallExpression* mce) {
+        auto member = mce->method->to<IR::Member>();
+        if (member == nullptr || member->member != IR::Type_Header::isValid)
+            simple = false;
+    });
+    return simple;
+}
+
+}  // namespace
+
+void CFG::removePredecessor(Node* node, Node* source, const Edge* edge) {
+    for (auto p : node->predecessors.edges) {
+        if (p->endpoint == source && p->sameKind(edge)) {
+            node->predecessors.erase(p);
+            return;
+        }
+    }
+}
+
+bool CFG::removePassThrough(IfNode* node) {
+    auto ifTrue = branch(node, true), ifFalse = branch(node, false);
+    if (ifTrue == nullptr || ifFalse == nullptr || ifTrue->endpoint != ifFalse->endpoint)
+        return false;
+    auto next = ifTrue->endpoint;
+    if (next == node)
+        return false;
+    // the condition is still evaluated if it may have side effects
+    if (!simpleCondition(node->condition))
+        return false;
+    LOG2("Removing " << node->name << " which always leads to " << next->name);
+    removePredecessor(next, node, ifTrue);
+    removePredecessor(next, node, ifFalse);
+    for (auto p : node->predecessors.edges) {
+        auto source = p->endpoint;
+        for (auto s : source->successors.edges) {
+            if (s->endpoint == node && s->sameKind(p)) {
+                source->successors.erase(s);
+                source->successors.emplace(s->clone(next));
+                break;
+            }
+        }
+        next->predecessors.emplace(p);
+    }
+    allNodes.erase(node);
+    return true;
+}
+
+bool CFG::foldIf(IfNode* node, P4::TypeMap* typeMap) {
+    for (bool value : { true, false }) {
+        auto inner = branch(node, value);
+        if (inner == nullptr)
+            continue;
+        auto next = inner->endpoint->to<IfNode>();
+        if (next == nullptr || next == node || next->predecessors.size() != 1)
+            continue;
+        // Both must lead to the same node in the other case
+        auto other = branch(node, !value), nextOther = branch(next, !value);
+        auto nextSame = branch(next, value);
+        if (other == nullptr || nextOther == nullptr || nextSame == nullptr ||
+            other->endpoint != nextOther->endpoint)
+            continue;
+        if (!simpleCondition(node->condition) || !simpleCondition(next->condition))
+            continue;
+        LOG2("Folding " << next->name << " into " << node->name);
+        const IR::Expression* condition;
+        if (value)
+            condition = new IR::LAnd(node->condition->srcInfo, node->condition, next->condition);
+        else
+            condition = new IR::LOr(node->condition->srcInfo, node->condition, next->condition);
+        typeMap->setType(condition, IR::Type_Boolean::get());
+        node->condition = condition;
+
+        auto destination = nextSame->endpoint;
+        node->successors.erase(inner);
+        node->successors.emplace(new Edge(destination, value));
+        removePredecessor(destination, next, nextSame);
+        destination->predecessors.emplace(new Edge(node, value));
+        removePredecessor(other->endpoint, next, nextOther);
+        allNodes.erase(next);
+        return true;
+    }
+    return false;
+}
+
+void CFG::simplify(P4::TypeMap* typeMap) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto n : allNodes) {
+            auto node = n->to<IfNode>();
+            if (node != nullptr && (removePassThrough(node) || foldIf(node, typeMap))) {
+                changed = true;
+                break;
+            }
+        }
+    }
+    LOG2("Simplified " << this);
+}
+
 namespace {
 class CFGBuilder : public Inspector {
     CFG*                    cfg;
@@ -43,6 +43,7 @@ class CFG final : public IHasDbPrint {
         { edges.insert(other->edges.begin(), other->edges.end()); }
         void dbprint(std::ostream& out) const;
         void emplace(CFG::Edge* edge) { edges.emplace(edge); }
+        void erase(CFG::Edge* edge) { edges.erase(edge); }
         size_t size() const { return edges.size(); }
         /// Checks whether the two edge sets represent the same set of
         /// nodes.  Importantly, two TableNodes are equivalent if they
@@ -92,7 +93,11 @@ class CFG final : public IHasDbPrint {
     class IfNode final : public Node {
      public:
         const IR::IfStatement* statement;
-        explicit IfNode(const IR::IfStatement* statement) : statement(statement)
+        /// The condition tested; initially that of the statement, but simplify() can fold
+        /// the conditions of several statements into one.
+        const IR::Expression* condition;
+        explicit IfNode(const IR::IfStatement* statement) :
+                statement(statement), condition(statement->condition)
         { CHECK_NULL(statement); }
     };
 
@@ -143,6 +148,9 @@ class CFG final : public IHasDbPrint {
         }
         bool isBool() const { return type == EdgeType::True || type == EdgeType::False; }
         bool isUnconditional() const { return type == EdgeType::Unconditional; }
+        /// True if both edges are taken in the same case.
+        bool sameKind(const Edge* other) const
+        { return type == other->type && label == other->label; }
     };
 
  public:
@@ -180,6 +188,16 @@ class CFG final : public IHasDbPrint {
     /// BMv2 is very restricted in the kinds of graphs it supports.
     /// Thie method checks whether a CFG is implementable.
     bool checkImplementable() const;
+    /// Reduces the number of conditionals that BMv2 evaluates: removes the If nodes that
+    /// lead to the same node either way, and folds an If node that is only reached from
+    /// another one, and that shares a destination with it, into its predecessor:
+    ///
+    ///     if (h.a.isValid()) { if (h.b.isValid()) { t.apply(); } }
+    ///
+    /// becomes a single conditional on h.a.isValid() && h.b.isValid().  Only conditions
+    /// that call no method other than isValid are folded or removed.  The new conditions are
+    /// given their type in @typeMap.
+    void simplify(P4::TypeMap* typeMap);
 
  private:
     bool dfs(Node* node, std::set<Node*> &visited,
@@ -190,6 +208,13 @@ class CFG final : public IHasDbPrint {
     /// This requires their successor edgesets to be "compatible" with
     /// each other.  This is a constraint specific to BMv2.
     bool checkMergeable(std::set<TableNode*> nodes) const;
+    /// Removes from the predecessors of @node the edge from @source of the same kind as @edge.
+    static void removePredecessor(Node* node, Node* source, const Edge* edge);
+    /// Removes @node if both its branches lead to the same node, and its condition calls
+    /// no method other than isValid.
+    bool removePassThrough(IfNode* node);
+    /// Folds the If node reached from a branch of @node into @node.
+    bool foldIf(IfNode* node, P4::TypeMap* typeMap);
 };
 
 }  // namespace BMV2
@@ -14,6 +14,9 @@ limitations under the License.
 */
 
 #include "expression.h"
+
+#include <sstream>
+
 #include "helpers.h"
 
 namespace BMV2 {
@@ -81,7 +84,34 @@ const IR::Node* ArithmeticFixup::postorder(IR::Cast* expression) {
     return updateType(expression);
 }
 
+Util::IJson* ExpressionConverter::shareLeaf(const IR::Expression* expression,
+                                           Util::IJson* json) {
+    if (!expression->is<IR::Constant>() && !expression->is<IR::BoolLiteral>() &&
+        !expression->is<IR::Member>() && !expression->is<IR::PathExpression>())
+        return json;
+    // only objects made of values and arrays of values, which are not changed later
+    auto object = json->to<Util::JsonObject>();
+    if (object == nullptr)
+        return json;
+    for (auto& member : *object) {
+        if (member.second == nullptr)
+            return json;
+        if (member.second->is<Util::JsonValue>())
+            continue;
+        auto array = member.second->to<Util::JsonArray>();
+        if (array == nullptr)
+            return json;
+        for (auto element : *array)
+            if (element == nullptr || !element->is<Util::JsonValue>())
+                return json;
+    }
+    std::stringstream text;
+    json->serialize(text);
+    return leaves.emplace(text.str(), json).first->second;
+}
+
 void ExpressionConverter::mapExpression(const IR::Expression* expression, Util::IJson* json) {
+    json = shareLeaf(expression, json);
     map.emplace(expression, json);
     LOG3("Mapping " << dbp(expression) << " to " << json->toString());
 }
@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef BACKENDS_BMV2_COMMON_EXPRESSION_H_
 #define BACKENDS_BMV2_COMMON_EXPRESSION_H_
 
+#include <string>
+#include <unordered_map>
+
 #include "ir/ir.h"
 #include "lower.h"
 #include "lib/gmputil.h"
@@ -63,6 +66,9 @@ class ExpressionConverter : public Inspector {
     /// For this pass to work correctly, the IR tree must be converted
     /// from a DAG to a TREE.
     std::map<const IR::Expression*, Util::IJson*> map;
+    /// The JSON of the leaves (constants, field and header references), by their text,
+    /// so that the many references to the same field share one JSON object.
+    std::unordered_map<std::string, Util::IJson*> leaves;
     bool leftValue;  // true if converting a left value
     // in some cases the bmv2 JSON requires a 'bitwidth' attribute for hex
     // strings (e.g. for constants in calculation inputs). When this flag is set
@@ -73,7 +79,7 @@ class ExpressionConverter : public Inspector {
     ExpressionConverter(P4::ReferenceMap* refMap, P4::TypeMap* typeMap,
                         ProgramStructure* structure, cstring scalarsName) :
             refMap(refMap), typeMap(typeMap), structure(structure),
-            corelib(P4::P4CoreLibrary::instance),
+            corelib(P4::P4CoreLibrary::instance()),
             scalarsName(scalarsName), leftValue(false), simpleExpressionsOnly(false) {}
     /// If this is 'true' we fail to convert complex expressions.
     /// This is used for table key expressions, for example.
@@ -131,6 +137,8 @@ class ExpressionConverter : public Inspector {
 
  private:
     void binary(const IR::Operation_Binary* expression);
+    /// The JSON shared by all the leaves converted to the same text as @json.
+    Util::IJson* shareLeaf(const IR::Expression* expression, Util::IJson* json);
     void saturated_binary(const IR::Operation_Binary* expression);
 };
 
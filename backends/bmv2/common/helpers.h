@@ -75,10 +75,10 @@ template <Arch arch> struct ActionProfileTraits;
 template<> struct ActionProfileTraits<Arch::V1MODEL> {
     static const cstring name() { return "action profile"; }
     static const cstring propertyName() {
-        return P4V1::V1Model::instance.tableAttributes.tableImplementation.name;
+        return P4V1::V1Model::instance().tableAttributes.tableImplementation.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.action_profile.name;
+        return P4V1::V1Model::instance().action_profile.name;
     }
     static const cstring sizeParamName() { return "size"; }
 };
@@ -104,7 +104,7 @@ template <Arch arch> struct ActionSelectorTraits;
 template<> struct ActionSelectorTraits<Arch::V1MODEL> : public ActionProfileTraits<Arch::V1MODEL> {
     static const cstring name() { return "action selector"; }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.action_selector.name;
+        return P4V1::V1Model::instance().action_selector.name;
     }
 };
 
@@ -124,7 +124,7 @@ template <Arch arch> struct RegisterTraits;
 template<> struct RegisterTraits<Arch::V1MODEL> {
     static const cstring name() { return "register"; }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.registers.name;
+        return P4V1::V1Model::instance().registers.name;
     }
     static const cstring sizeParamName() { return "size"; }
     // the index of the type parameter for the data stored in the register, in
@@ -176,13 +176,13 @@ template <typename Kind> struct CounterlikeTraits;
 template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::V1MODEL> > {
     static const cstring name() { return "counter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.counters.name;
+        return P4V1::V1Model::instance().tableAttributes.counters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.counter.name;
+        return P4V1::V1Model::instance().counter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directCounter.name;
+        return P4V1::V1Model::instance().directCounter.name;
     }
     static const cstring sizeParamName() {
         return "size";
@@ -193,13 +193,13 @@ template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::V1MO
 template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::V1MODEL2020> > {
     static const cstring name() { return "counter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.counters.name;
+        return P4V1::V1Model::instance().tableAttributes.counters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.counter.name;
+        return P4V1::V1Model::instance().counter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directCounter.name;
+        return P4V1::V1Model::instance().directCounter.name;
     }
     static const cstring sizeParamName() {
         return "size";
@@ -231,13 +231,13 @@ template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::PSA>
 template<> struct CounterlikeTraits<Standard::MeterExtern<Standard::Arch::V1MODEL> > {
     static const cstring name() { return "meter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.meters.name;
+        return P4V1::V1Model::instance().tableAttributes.meters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.meter.name;
+        return P4V1::V1Model::instance().meter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directMeter.name;
+        return P4V1::V1Model::instance().directMeter.name;
     }
     static const cstring sizeParamName() {
         return "size";
@@ -248,13 +248,13 @@ template<> struct CounterlikeTraits<Standard::MeterExtern<Standard::Arch::V1MODE
 template<> struct CounterlikeTraits<Standard::MeterExtern<Standard::Arch::V1MODEL2020> > {
     static const cstring name() { return "meter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.meters.name;
+        return P4V1::V1Model::instance().tableAttributes.meters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.meter.name;
+        return P4V1::V1Model::instance().meter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directMeter.name;
+        return P4V1::V1Model::instance().directMeter.name;
     }
     static const cstring sizeParamName() {
         return "size";
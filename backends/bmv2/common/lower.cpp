@@ -292,7 +292,7 @@ RemoveComplexExpressions::postorder(IR::MethodCallExpression* expression) {
         return expression;
 
     if (auto ef = mi->to<P4::ExternFunction>()) {
-        if (ef->method->name == P4V1::V1Model::instance.digest_receiver.name) {
+        if (ef->method->name == P4V1::V1Model::instance().digest_receiver.name) {
             // Special handling for digest; the semantics on bmv2 is to
             // execute the digest at the very end of the pipeline, and to
             // pass a reference to the fields, so fields can be modified
@@ -356,8 +356,8 @@ const IR::Node*
 RemoveComplexExpressions::postorder(IR::MethodCallStatement* statement) {
     auto mi = P4::MethodInstance::resolve(statement, refMap, typeMap);
     if (auto em = mi->to<P4::ExternMethod>()) {
-        if (em->originalExternType->name != P4::P4CoreLibrary::instance.packetIn.name ||
-            em->method->name != P4::P4CoreLibrary::instance.packetIn.lookahead.name)
+        if (em->originalExternType->name != P4::P4CoreLibrary::instance().packetIn.name ||
+            em->method->name != P4::P4CoreLibrary::instance().packetIn.lookahead.name)
             return simpleStatement(statement);
         auto type = em->actualMethodType->returnType;
         auto name = refMap->newName("tmp");
@@ -30,6 +30,14 @@ class BMV2Options : public CompilerOptions {
     cstring outputFile = nullptr;
     // read from json
     bool loadIRFromJson = false;
+    // read from binary IR (also sets loadIRFromJson, which selects the reduced midEnd)
+    bool loadIRFromBinary = false;
+    // emit actions with the same body only once
+    bool deduplicateActions = false;
+    // file to output the binary encoding of the configuration to
+    cstring binaryConfigFile = nullptr;
+    // remove the struct fields that are never referenced
+    bool pruneUnusedFields = false;
 
     BMV2Options() {
         registerOption("--emit-externs", nullptr,
@@ -43,6 +51,25 @@ class BMV2Options : public CompilerOptions {
                 [this](const char* arg) { loadIRFromJson = true; file = arg; return true; },
                 "Use IR representation from JsonFile dumped previously,"\
                 "the compilation starts with reduced midEnd.");
+        registerOption("--fromBinaryIR", "file",
+                [this](const char* arg) {
+                    loadIRFromJson = loadIRFromBinary = true;
+                    file = arg;
+                    return true; },
+                "Use IR representation from a file dumped previously with --toBinaryIR,"\
+                "the compilation starts with reduced midEnd.");
+        registerOption("--dedup-actions", nullptr,
+                [this](const char*) { deduplicateActions = true; return true; },
+                "[BMv2 back-end] Emit actions with identical primitives only once,\n"
+                "listing the other names in the \"action_aliases\" array.");
+        registerOption("--binary-config", "file",
+                [this](const char* arg) { binaryConfigFile = arg; return true; },
+                "[BMv2 back-end] Also write the configuration to file in the compact\n"
+                "binary encoding of lib/json_binary.h.");
+        registerOption("--prune-unused-fields", nullptr,
+                [this](const char*) { pruneUnusedFields = true; return true; },
+                "[BMv2 back-end] Leave the fields of program structs (such as user\n"
+                "metadata) that are never referenced out of the header types.");
     }
 };
 
@@ -15,6 +15,9 @@ limitations under the License.
 */
 
 #include "parser.h"
+
+#include <cstring>
+
 #include "JsonObjects.h"
 #include "backend.h"
 #include "extern.h"
@@ -23,6 +26,105 @@ limitations under the License.
 
 namespace BMV2 {
 
+namespace {
+
+cstring stringValue(const Util::IJson* json) {
+    auto value = json ? json->to<Util::JsonValue>() : nullptr;
+    return value && value->isString() ? value->getString() : cstring();
+}
+
+/// The field [header, name] written by a parser "set" operation, or nullptr.
+const Util::JsonArray* setTarget(const Util::IJson* op) {
+    auto obj = op->to<Util::JsonObject>();
+    auto kind = obj ? obj->get("op") : nullptr;
+    if (stringValue(kind) != "set")
+        return nullptr;
+    auto left = obj->get("parameters")->to<Util::JsonArray>()->at(0)->to<Util::JsonObject>();
+    if (left == nullptr || stringValue(left->get("type")) != "field")
+        return nullptr;
+    auto field = left->get("value")->to<Util::JsonArray>();
+    if (field == nullptr || field->size() != 2)
+        return nullptr;
+    return field;
+}
+
+/// The name of the stack or union that header instance @name is part of, e.g. hs for
+/// hs[0], or u for u.h; @name itself for a header that is not part of one.
+cstring headerRoot(cstring name) {
+    auto end = strcspn(name.c_str(), "[.");
+    return end < name.size() ? name.substr(0, end) : name;
+}
+
+/// True if @json may read @field: a reference to the field itself, or to any other
+/// object of the header containing it.  The field of a stack element or union member
+/// may also be read through any reference to its stack or union, such as hs.last.f
+/// ({"type": "stack_field", "value": ["hs", "f"]}) or an element of a union stack.
+bool mayRead(const Util::IJson* json, const Util::JsonArray* field) {
+    if (auto array = json->to<Util::JsonArray>()) {
+        for (auto element : *array)
+            if (mayRead(element, field))
+                return true;
+        return false;
+    }
+    auto obj = json->to<Util::JsonObject>();
+    if (obj == nullptr)
+        return false;
+    auto header = stringValue(field->at(0));
+    auto root = headerRoot(header);
+    auto sameRoot = [&](cstring name) {
+        return root != header && !name.isNullOrEmpty() && headerRoot(name) == root; };
+    if (auto value = obj->get("value")) {
+        auto name = stringValue(value);
+        if (name == header || sameRoot(name))
+            return true;
+        auto path = value->to<Util::JsonArray>();
+        if (path && !path->empty()) {
+            auto first = stringValue(path->at(0));
+            if (first == header &&
+                (stringValue(obj->get("type")) != "field" || path->size() != 2 ||
+                 stringValue(path->at(1)) == stringValue(field->at(1))))
+                return true;
+            if (first != header && sameRoot(first))
+                return true;
+        }
+    }
+    for (auto& member : *obj)
+        if (mayRead(member.second, field))
+            return true;
+    return false;
+}
+
+}  // namespace
+
+void ParserConverter::removeDeadSets(std::vector<Util::IJson*>& ops) {
+    std::vector<Util::IJson*> live;
+    for (size_t i = 0; i < ops.size(); ++i) {
+        auto field = setTarget(ops[i]);
+        bool dead = false;
+        // Only look at the run of "set" operations starting here: the other operations
+        // may read anything.
+        for (size_t j = i + 1; field != nullptr && j < ops.size(); ++j) {
+            auto target = setTarget(ops[j]);
+            if (target == nullptr)
+                break;
+            auto right = ops[j]->to<Util::JsonObject>()->get("parameters")
+                    ->to<Util::JsonArray>()->at(1);
+            if (mayRead(right, field))
+                break;
+            if (stringValue(target->at(0)) == stringValue(field->at(0)) &&
+                stringValue(target->at(1)) == stringValue(field->at(1))) {
+                dead = true;
+                break;
+            }
+        }
+        if (dead)
+            LOG3("Removing overwritten parser operation " << ops[i]->toString());
+        else
+            live.push_back(ops[i]);
+    }
+    ops.swap(live);
+}
+
 cstring ParserConverter::jsonAssignment(const IR::Type* type, bool inParser) {
     if (!inParser && type->is<IR::Type_Varbits>())
         return "assign_VL";
@@ -279,7 +381,7 @@ Util::IJson* ParserConverter::convertParserStatement(const IR::StatOrDecl* stat)
                 paramsArray->append(expr);
                 paramValue->emplace("op", extFuncName);
                 paramValue->emplace_non_null("source_info", mce->sourceInfoJsonObj());
-            } else if (extFuncName == P4V1::V1Model::instance.log_msg.name) {
+            } else if (extFuncName == P4V1::V1Model::instance().log_msg.name) {
                 BUG_CHECK(mce->arguments->size() == 2 || mce->arguments->size() == 1,
                             "%1%: Expected 1 or 2 arguments", mce);
                 result->emplace("op", "primitive");
@@ -533,7 +635,7 @@ void ParserConverter::addValueSets(const IR::P4Parser* parser) {
         auto matchTypeDecl = ctxt->refMap->getDeclaration(matchPathExpr->path, true)
             ->to<IR::Declaration_ID>();
         BUG_CHECK(matchTypeDecl != nullptr, "No declaration for match type '%1%'", matchPathExpr);
-        return (matchTypeDecl->name.name == P4::P4CoreLibrary::instance.exactMatch.name);
+        return (matchTypeDecl->name.name == P4::P4CoreLibrary::instance().exactMatch.name);
     };
 
     for (auto s : parser->parserLocals) {
@@ -571,11 +673,15 @@ bool ParserConverter::preorder(const IR::P4Parser* parser) {
         // For the state we use the internal name, not the control-plane name
         auto state_id = ctxt->json->add_parser_state(parser_id, state->name);
         // convert statements
+        std::vector<Util::IJson*> ops;
         for (auto s : state->components) {
             auto op = convertParserStatement(s);
             if (op)
-                ctxt->json->add_parser_op(state_id, op);
+                ops.push_back(op);
         }
+        removeDeadSets(ops);
+        for (auto op : ops)
+            ctxt->json->add_parser_op(state_id, op);
         // convert transitions
         if (state->selectExpression != nullptr) {
             if (state->selectExpression->is<IR::SelectExpression>()) {
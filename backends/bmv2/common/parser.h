@@ -45,11 +45,14 @@ class ParserConverter : public Inspector {
     cstring jsonAssignment(const IR::Type* type, bool inParser);
     std::vector<Util::IJson*> convertSelectExpression(const IR::SelectExpression* expr);
     void addValueSets(const IR::P4Parser* parser);
+    /// Removes the "set" operations of a parser state whose field is set again, by the
+    /// run of "set" operations that follows them, before being read.
+    void removeDeadSets(std::vector<Util::IJson*>& ops);
 
  public:
     bool preorder(const IR::P4Parser* p) override;
     explicit ParserConverter(ConversionContext* ctxt, cstring name = "parser")
-        : ctxt(ctxt), name(name), corelib(P4::P4CoreLibrary::instance) {
+        : ctxt(ctxt), name(name), corelib(P4::P4CoreLibrary::instance()) {
         setName("ParserConverter");
     }
 };
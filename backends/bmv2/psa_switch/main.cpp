@@ -23,6 +23,8 @@ limitations under the License.
 #include "frontends/common/applyOptionsPragmas.h"
 #include "frontends/common/parseInput.h"
 #include "frontends/p4/frontend.h"
+#include "lib/batch_compile.h"
+#include "lib/compile_server.h"
 #include "lib/error.h"
 #include "lib/exceptions.h"
 #include "lib/gc.h"
@@ -33,12 +35,11 @@ limitations under the License.
 #include "backends/bmv2/psa_switch/psaSwitch.h"
 #include "backends/bmv2/psa_switch/version.h"
 #include "backends/bmv2/psa_switch/options.h"
+#include "ir/binary_loader.h"
 #include "ir/json_loader.h"
 #include "fstream"
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-
+static int compileProgram(int argc, char *const argv[]) {
     AutoCompileContext autoPsaSwitchContext(new BMV2::PsaSwitchContext);
     auto& options = BMV2::PsaSwitchContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
@@ -78,6 +79,17 @@ int main(int argc, char *const argv[]) {
         }
         if (program == nullptr || ::errorCount() > 0)
             return 1;
+    } else if (options.loadIRFromBinary) {
+        BinaryLoader loader(options.file);
+        if (!loader.valid()) {
+            ::error(ErrorType::ERR_IO, "%s: %s", options.file, loader.error());
+            return 1;
+        }
+        program = loader.root()->to<IR::P4Program>();
+        if (program == nullptr) {
+            ::error(ErrorType::ERR_INVALID, "%s: not a P4Program", options.file);
+            return 1;
+        }
     } else {
         std::filebuf fb;
         if (fb.open(options.file, std::ios::in) == nullptr) {
@@ -85,7 +97,7 @@ int main(int argc, char *const argv[]) {
             return 1;
         }
         std::istream inJson(&fb);
-        JSONLoader jsonFileLoader(inJson);
+        JSONStreamLoader jsonFileLoader(inJson);
         if (jsonFileLoader.json == nullptr) {
             ::error(ErrorType::ERR_IO, "%s: Not valid input file", options.file);
             return 1;
@@ -100,13 +112,18 @@ int main(int argc, char *const argv[]) {
 
     BMV2::PsaSwitchMidEnd midEnd(options);
     midEnd.addDebugHook(hook);
+    if (options.profileMidendPasses)
+        midEnd.setProfile(&std::cerr);
     try {
         toplevel = midEnd.process(program);
         if (::errorCount() > 1 || toplevel == nullptr ||
             toplevel->getMain() == nullptr)
             return 1;
         if (options.dumpJsonFile)
-            JSONGenerator(*openFile(options.dumpJsonFile, true), true) << program << std::endl;
+            JSONGenerator(*openFile(options.dumpJsonFile, true), true, options.compactJson)
+                << program << std::endl;
+        if (options.dumpBinaryFile)
+            BinaryGenerator(true).write(program, *openFile(options.dumpBinaryFile, true));
     } catch (const std::exception &bug) {
         std::cerr << bug.what() << std::endl;
         return 1;
@@ -135,6 +152,23 @@ int main(int argc, char *const argv[]) {
             out->flush();
         }
     }
+    if (!options.binaryConfigFile.isNullOrEmpty()) {
+        std::ostream* out = openFile(options.binaryConfigFile, false);
+        if (out != nullptr) {
+            backend->serializeBinary(*out);
+            out->flush();
+        }
+    }
 
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+
+    if (auto socket = Util::CompileServer::socketPath(argc, argv))
+        return Util::CompileServer::serve(socket, compileProgram);
+    if (Util::BatchCompile::requested(argc, argv))
+        return Util::BatchCompile::run(argc, argv, compileProgram);
+    return compileProgram(argc, argv);
+}
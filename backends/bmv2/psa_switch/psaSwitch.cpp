@@ -211,7 +211,8 @@ void PsaProgramStructure::createExterns() {
 }
 
 void PsaProgramStructure::createActions(ConversionContext* ctxt) {
-    auto cvt = new ActionConverter(ctxt, true);
+    auto cvt = new ActionConverter(ctxt, true,
+                                   BMV2Context::get().options().deduplicateActions);
     for (auto it : actions) {
         auto action = it.first;
         action->apply(*cvt);
@@ -1028,7 +1028,7 @@ SimpleSwitchBackend::convertChecksum(const IR::BlockStatement *block, Util::Json
 }
 
 void SimpleSwitchBackend::createActions(ConversionContext* ctxt, V1ProgramStructure* structure) {
-    auto cvt = new ActionConverter(ctxt, options.emitExterns);
+    auto cvt = new ActionConverter(ctxt, options.emitExterns, options.deduplicateActions);
     for (auto it : structure->actions) {
         auto action = it.first;
         ctxt->blockConverted = structure->blockKind(it.second);
@@ -136,7 +136,7 @@ class ParseV1Architecture : public Inspector {
 
  public:
     explicit ParseV1Architecture(V1ProgramStructure* structure) :
-        structure(structure), v1model(P4V1::V1Model::instance) { }
+        structure(structure), v1model(P4V1::V1Model::instance()) { }
     void modelError(const char* format, const IR::Node* node);
     bool preorder(const IR::PackageBlock* block) override;
 };
@@ -161,7 +161,7 @@ class SimpleSwitchBackend : public Backend {
     SimpleSwitchBackend(BMV2Options& options, P4::ReferenceMap* refMap, P4::TypeMap* typeMap,
                         P4::ConvertEnums::EnumMapping* enumMap) :
         Backend(options, refMap, typeMap, enumMap), options(options),
-        v1model(P4V1::V1Model::instance) { }
+        v1model(P4V1::V1Model::instance()) { }
 };
 
 EXTERN_CONVERTER_W_FUNCTION(clone)
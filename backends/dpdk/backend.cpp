@@ -17,6 +17,7 @@ limitations under the License.
 #include "backend.h"
 #include "dpdkArch.h"
 #include "dpdkAsmOpt.h"
+#include "dpdkCostReport.h"
 #include "dpdkHelpers.h"
 #include "dpdkProgram.h"
 #include "midend/eliminateTypedefs.h"
@@ -38,8 +39,15 @@ void DpdkBackend::convert(const IR::ToplevelBlock *tlb) {
     auto hook = options.getDebugHook();
     auto program = tlb->getProgram();
 
+    bool splitEgress = !options.egressSpec.isNullOrEmpty();
+    if (splitEgress && options.arch != "psa") {
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "--egress-spec requires the psa architecture, not %1%", options.arch);
+        return;
+    }
+
     std::set<const IR::P4Table*> invokedInKey;
-    auto convertToDpdk = new ConvertToDpdkProgram(refMap, typeMap, &structure);
+    auto convertToDpdk = new ConvertToDpdkProgram(refMap, typeMap, &structure, splitEgress);
     PassManager simplify = {
         new DpdkArchFirst(),
         new P4::EliminateTypedef(refMap, typeMap),
@@ -57,7 +65,9 @@ void DpdkBackend::convert(const IR::ToplevelBlock *tlb) {
         new InjectJumboStruct(&structure),
         new P4::ClearTypeMap(typeMap),
         new P4::TypeChecking(refMap, typeMap, true),
+        new SelectTableMatchKinds(),
         new CopyMatchKeysToSingleStruct(refMap, typeMap, &invokedInKey),
+        new CopyLearnerActionArgs(refMap),
         new P4::ResolveReferences(refMap),
         new StatementUnroll(refMap, &structure),
         new IfStatementUnroll(refMap, &structure),
@@ -67,6 +77,8 @@ void DpdkBackend::convert(const IR::ToplevelBlock *tlb) {
         new CollectProgramStructure(refMap, typeMap, &structure),
         new CollectLocalVariableToMetadata(refMap, &structure),
         new CollectErrors(&structure),
+        options.incrementalChecksum ?
+            new IncrementalChecksumUpdate(refMap, typeMap, &structure) : nullptr,
         new ConvertInternetChecksum(typeMap, &structure),
         new PrependPDotToActionArgs(typeMap, refMap, &structure),
         new ConvertLogicalExpression(),
@@ -85,16 +97,44 @@ void DpdkBackend::convert(const IR::ToplevelBlock *tlb) {
     dpdk_program = convertToDpdk->getDpdkProgram();
     if (!dpdk_program)
         return;
-    PassManager post_code_gen = {
-        new EliminateUnusedAction(),
-        new DpdkAsmOptimization,
+    // Each pipeline of a split program only declares the metadata fields it uses
+    auto optimize = [&](const IR::DpdkAsmProgram *pipeline) {
+        PassManager post_code_gen = {
+            new EliminateUnusedAction(),
+            new DpdkAsmOptimization,
+        };
+        if (options.optimizeInstructions)
+            post_code_gen.addPasses({ new InlineConstantDefaultActions,
+                                      new ReuseHashComputations,
+                                      new DpdkDataflowOptimization(
+                                          structure.local_variable_fields),
+                                      new DpdkAsmOptimization });
+        if (options.shareLocalMetadata)
+            post_code_gen.addPasses({ new ShareLocalMetadataFields(
+                                          structure.local_variable_fields) });
+        if (options.layoutMetadata || splitEgress)
+            post_code_gen.addPasses({ new LayoutMetadataStruct });
+        return pipeline->apply(post_code_gen)->to<IR::DpdkAsmProgram>();
     };
-
-    dpdk_program = dpdk_program->apply(post_code_gen)->to<IR::DpdkAsmProgram>();
+    dpdk_program = optimize(dpdk_program);
+    if (auto egress = convertToDpdk->getEgressProgram())
+        egress_program = optimize(egress);
 }
 
 void DpdkBackend::codegen(std::ostream &out) const {
     dpdk_program->toSpec(out) << std::endl;
 }
 
+void DpdkBackend::egressCodegen(std::ostream &out) const {
+    if (egress_program)
+        egress_program->toSpec(out) << std::endl;
+}
+
+void DpdkBackend::costReport(std::ostream &out) const {
+    DpdkCostReport report;
+    dpdk_program->apply(report);
+    report.report->serialize(out);
+    out << std::endl;
+}
+
 }  // namespace DPDK
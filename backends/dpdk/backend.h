@@ -39,6 +39,8 @@ class DpdkBackend {
     P4::ConvertEnums::EnumMapping *enumMap;
 
     const IR::DpdkAsmProgram *dpdk_program = nullptr;
+    // The egress pipeline emitted with --egress-spec
+    const IR::DpdkAsmProgram *egress_program = nullptr;
     const IR::ToplevelBlock* toplevel = nullptr;
 
   public:
@@ -48,6 +50,8 @@ class DpdkBackend {
                      P4::ConvertEnums::EnumMapping *enumMap)
         : options(options), refMap(refMap), typeMap(typeMap), enumMap(enumMap) {}
     void codegen(std::ostream &) const;
+    void egressCodegen(std::ostream &) const;
+    void costReport(std::ostream &) const;
 };
 
 } // namespace DPDK
@@ -105,7 +105,7 @@ BFRuntimeSchemaGenerator::addActionSelectorGetMemberCommon(Util::JsonArray* tabl
     tableJson->emplace("attributes", new Util::JsonArray());
     addToDependsOn(tableJson, actionSelector.id);
 
-    tablesJson->append(tableJson);
+    tablesJson->append(new Util::JsonText(tableJson));
 }
 
 void
@@ -148,15 +148,22 @@ BFRuntimeSchemaGenerator::addActionSelectorCommon(Util::JsonArray* tablesJson,
     tableJson->emplace("attributes", new Util::JsonArray());
     addToDependsOn(tableJson, actionSelector.action_profile_id);
 
-    auto oneTableId = actionSelector.tableIds.at(0);
-    auto* oneTable = Standard::findTable(p4info, oneTableId);
-    CHECK_NULL(oneTable);
+    tablesJson->append(new Util::JsonText(tableJson));
+}
 
+void
+BFRuntimeSchemaGenerator::collectTableDependencies(TableDependencies* dependencies) const {
+    BFRuntimeGenerator::collectTableDependencies(dependencies);
     // Add action selector id to match table depends on
-    auto oneTableJson = findJsonTable(tablesJson, oneTable->preamble().name());
-    addToDependsOn(oneTableJson, actionSelector.id);
-
-    tablesJson->append(tableJson);
+    for (const auto& externType : p4info.externs()) {
+        auto externTypeId = static_cast<::dpdk::P4Ids::Prefix>(externType.extern_type_id());
+        if (externTypeId != ::dpdk::P4Ids::ACTION_SELECTOR) continue;
+        for (const auto& externInstance : externType.instances()) {
+            auto actionSelector = ActionSelector::fromDPDK(p4info, externInstance);
+            if (actionSelector == boost::none) continue;
+            (*dependencies)[actionSelector->tableIds.at(0)].push_back(actionSelector->id);
+        }
+    }
 }
 
 bool
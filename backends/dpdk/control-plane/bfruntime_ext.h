@@ -62,6 +62,7 @@ class BFRuntimeSchemaGenerator : public BFRuntimeGenerator {
                                  const ActionSelector& actionProf) const;
     void addActionSelectorGetMemberCommon(Util::JsonArray* tablesJson,
                                           const ActionSelector& actionProf) const;
+    void collectTableDependencies(TableDependencies* dependencies) const override;
     void addActionProfs(Util::JsonArray* tablesJson) const override;
     bool addActionProfIds(const p4configv1::Table& table,
                           Util::JsonObject* tableJson) const override;
@@ -44,6 +44,16 @@ bool isNonConstantSimpleExpression(const IR::Expression *e) {
     return false;
 }
 
+bool isLearnerTable(const IR::P4Table *t) {
+    auto property = t->properties->getProperty("add_on_miss");
+    if (property == nullptr)
+        return false;
+    auto value = property->value->to<IR::ExpressionValue>();
+    if (value == nullptr || !value->expression->is<IR::BoolLiteral>())
+        return false;
+    return value->expression->to<IR::BoolLiteral>()->value;
+}
+
 bool isStandardMetadata(cstring name) {
     bool isStdMeta = name == "psa_ingress_parser_input_metadata_t" ||
                      name == "psa_ingress_input_metadata_t" ||
@@ -341,6 +351,141 @@ const IR::Node *InjectJumboStruct::preorder(IR::Type_Struct *s) {
     return s;
 }
 
+const IR::Node *CopyLearnerActionArgs::postorder(IR::MethodCallStatement *s) {
+    auto orig = getOriginal<IR::MethodCallStatement>();
+    auto path = orig->methodCall->method->to<IR::PathExpression>();
+    if (path == nullptr)
+        return s;
+    auto decl = refMap->getDeclaration(path->path);
+    if (decl == nullptr || !decl->is<IR::Method>())
+        return s;
+    auto name = decl->getName().name;
+    if (name != "add_entry" && name != "set_entry_expire_time" &&
+        name != "restart_expire_timer" && name != "remove_entry")
+        return s;
+    if (findContext<IR::P4Action>() == nullptr) {
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "%1%: must be called from an action of a table with add_on_miss", s);
+        return s;
+    }
+    if (name == "add_entry")
+        return copyAddEntryArgs(s);
+    if (name == "set_entry_expire_time")
+        return copyExpireTimeProfile(s);
+    return s;
+}
+
+const IR::Node *CopyLearnerActionArgs::copyAddEntryArgs(const IR::MethodCallStatement *s) {
+    auto control = findOrigCtxt<IR::P4Control>();
+    auto mce = s->methodCall;
+    auto actionName = mce->arguments->at(0)->expression->to<IR::StringLiteral>();
+    if (actionName == nullptr) {
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "%1%: the name of the learned action must be a string literal", s);
+        return s;
+    }
+    const IR::P4Action *learned = nullptr;
+    for (auto d : control->controlLocals) {
+        auto action = d->to<IR::P4Action>();
+        if (action == nullptr)
+            continue;
+        cstring externalName = action->externalName();
+        if (action->name.name == actionName->value || externalName == actionName->value ||
+            externalName.endsWith("." + actionName->value)) {
+            learned = action;
+            break;
+        }
+    }
+    if (learned == nullptr) {
+        ::error(ErrorType::ERR_NOT_FOUND, "%1%: no action %2% in %3%", s, actionName,
+                control->name);
+        return s;
+    }
+
+    auto params = mce->arguments->at(1)->expression;
+    IR::Vector<IR::Expression> components;
+    if (auto list = params->to<IR::ListExpression>()) {
+        components = list->components;
+    } else if (auto se = params->to<IR::StructExpression>()) {
+        for (auto c : se->components)
+            components.push_back(c->expression);
+    } else if (auto st = params->type->to<IR::Type_StructLike>()) {
+        for (auto f : st->fields)
+            components.push_back(new IR::Member(params, f->name));
+    } else {
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "%1%: the action parameters must be a list or a struct", params);
+        return s;
+    }
+    auto parameters = learned->parameters->parameters;
+    if (components.size() != parameters.size()) {
+        ::error(ErrorType::ERR_EXPECTED, "%1%: expected %2% parameters for action %3%",
+                params, parameters.size(), learned);
+        return s;
+    }
+
+    IR::IndexedVector<IR::StatOrDecl> code_block;
+    IR::Vector<IR::Expression> copies;
+    for (size_t i = 0; i < parameters.size(); i++) {
+        auto param = parameters.at(i);
+        if (param->direction != IR::Direction::None) {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "%1%: learned actions can only have directionless parameters", param);
+            return s;
+        }
+        auto tmp = new IR::Declaration_Variable(
+            IR::ID(refMap->newName(learned->name.name + "_" + param->name.name)), param->type);
+        injector.collect(control, nullptr, tmp);
+        code_block.push_back(new IR::AssignmentStatement(new IR::PathExpression(tmp->name),
+                                                         components.at(i)));
+        copies.push_back(new IR::PathExpression(tmp->name));
+    }
+    // The type argument is inferred again from the list
+    auto args = new IR::Vector<IR::Argument>();
+    args->push_back(new IR::Argument(new IR::StringLiteral(learned->name.name)));
+    args->push_back(new IR::Argument(new IR::ListExpression(copies)));
+    code_block.push_back(new IR::MethodCallStatement(s->srcInfo,
+        new IR::MethodCallExpression(mce->srcInfo, mce->method, new IR::Vector<IR::Type>(),
+                                     args)));
+    return new IR::BlockStatement(code_block);
+}
+
+const IR::Node *CopyLearnerActionArgs::copyExpireTimeProfile(const IR::MethodCallStatement *s) {
+    auto mce = s->methodCall;
+    auto profile = mce->arguments->at(0)->expression;
+    if (auto member = profile->to<IR::Member>()) {
+        auto path = member->expr->to<IR::PathExpression>();
+        if (path != nullptr && path->path->name == "m")
+            return s;
+    }
+    auto control = findOrigCtxt<IR::P4Control>();
+    auto tmp = new IR::Declaration_Variable(IR::ID(refMap->newName("expire_time_profile")),
+                                            profile->type);
+    injector.collect(control, nullptr, tmp);
+    IR::IndexedVector<IR::StatOrDecl> code_block;
+    code_block.push_back(new IR::AssignmentStatement(new IR::PathExpression(tmp->name),
+                                                     profile));
+    auto args = new IR::Vector<IR::Argument>();
+    args->push_back(new IR::Argument(new IR::PathExpression(tmp->name)));
+    code_block.push_back(new IR::MethodCallStatement(s->srcInfo,
+        new IR::MethodCallExpression(mce->srcInfo, mce->method, mce->typeArguments, args)));
+    return new IR::BlockStatement(code_block);
+}
+
+const IR::Node *CopyLearnerActionArgs::postorder(IR::P4Table *t) {
+    auto property = t->properties->getProperty("add_on_miss");
+    if (property == nullptr)
+        return t;
+    auto value = property->value->to<IR::ExpressionValue>();
+    if (value == nullptr || !value->expression->is<IR::BoolLiteral>())
+        ::error(ErrorType::ERR_EXPECTED, "%1%: expected true or false", property);
+    return t;
+}
+
+const IR::Node *CopyLearnerActionArgs::postorder(IR::P4Control *c) {
+    return injector.inject_control(getOriginal(), c);
+}
+
 const IR::Node *StatementUnroll::preorder(IR::AssignmentStatement *a) {
     auto code_block = new IR::IndexedVector<IR::StatOrDecl>;
     auto right = a->right;
@@ -538,20 +683,14 @@ const IR::Node *IfStatementUnroll::postorder(IR::P4Control *a) {
 bool LogicalExpressionUnroll::preorder(const IR::Operation_Unary *u) {
     expressionUnrollSanityCheck(u->expr);
 
-    // If the expression is a methodcall expression, do not insert a temporary
-    // variable to represent the value of the methodcall. Instead the
-    // methodcall is converted to a dpdk branch instruction in a later pass.
-    if (u->expr->is<IR::MethodCallExpression>())
+    // Do not insert a temporary variable to represent the value of a negated
+    // condition. The negation is pushed down to the comparisons, methodcalls
+    // and apply().hit or apply().miss, which are converted to the opposite
+    // dpdk branch instruction in a later pass.
+    if (u->is<IR::LNot>()) {
+        visit(u->expr);
+        root = negate(root ? root : u->expr);
         return false;
-
-    // if the expression is apply().hit or apply().miss, do not insert a temporary
-    // variable.
-    if (auto member = u->expr->to<IR::Member>()) {
-        if (member->expr->is<IR::MethodCallExpression>() &&
-            (member->member == IR::Type_Table::hit ||
-             member->member == IR::Type_Table::miss)) {
-            return false;
-        }
     }
 
     root = u->clone();
@@ -562,13 +701,11 @@ bool LogicalExpressionUnroll::preorder(const IR::Operation_Unary *u) {
             un_expr = new IR::Neg(root);
         } else if (u->to<IR::Cmpl>()) {
             un_expr = new IR::Cmpl(root);
-        } else if (u->to<IR::LNot>()) {
-            un_expr = new IR::LNot(root);
         } else {
             BUG("%1% Not Implemented", u);
         }
     } else {
-        un_expr = u->expr;
+        un_expr = u;
     }
 
     auto tmp = new IR::PathExpression(IR::ID(refMap->newName("tmp")));
@@ -578,6 +715,28 @@ bool LogicalExpressionUnroll::preorder(const IR::Operation_Unary *u) {
     return false;
 }
 
+const IR::Expression *LogicalExpressionUnroll::negate(const IR::Expression *e) {
+    if (auto land = e->to<IR::LAnd>())
+        return new IR::LOr(land->srcInfo, negate(land->left), negate(land->right));
+    else if (auto lor = e->to<IR::LOr>())
+        return new IR::LAnd(lor->srcInfo, negate(lor->left), negate(lor->right));
+    else if (auto equ = e->to<IR::Equ>())
+        return new IR::Neq(equ->srcInfo, equ->left, equ->right);
+    else if (auto neq = e->to<IR::Neq>())
+        return new IR::Equ(neq->srcInfo, neq->left, neq->right);
+    else if (auto lss = e->to<IR::Lss>())
+        return new IR::Geq(lss->srcInfo, lss->left, lss->right);
+    else if (auto geq = e->to<IR::Geq>())
+        return new IR::Lss(geq->srcInfo, geq->left, geq->right);
+    else if (auto grt = e->to<IR::Grt>())
+        return new IR::Leq(grt->srcInfo, grt->left, grt->right);
+    else if (auto leq = e->to<IR::Leq>())
+        return new IR::Grt(leq->srcInfo, leq->left, leq->right);
+    else if (auto lnot = e->to<IR::LNot>())
+        return lnot->expr;
+    return new IR::LNot(e->srcInfo, e);
+}
+
 bool LogicalExpressionUnroll::preorder(const IR::Operation_Binary *bin) {
     expressionUnrollSanityCheck(bin->left);
     expressionUnrollSanityCheck(bin->right);
@@ -729,6 +888,7 @@ const IR::Node *CollectLocalVariableToMetadata::postorder(IR::Type_Struct *s) {
                 if (auto dv = d->to<IR::Declaration_Variable>()) {
                     s->fields.push_back(new IR::StructField(
                         IR::ID(kv.first + "_" + dv->name.name), dv->type));
+                    structure->local_variable_fields.insert(kv.first + "_" + dv->name.name);
                 } else if (!d->is<IR::P4Action>() && !d->is<IR::P4Table>() &&
                            !d->is<IR::Declaration_Instance>()) {
                     BUG("%1%: Unhandled declaration type", s);
@@ -784,6 +944,224 @@ const IR::Node *CollectLocalVariableToMetadata::postorder(IR::P4Parser *p) {
     return p;
 }
 
+const IR::IDeclaration *
+CollectIncrementalChecksums::checksumCall(const IR::Expression *e, cstring method) {
+    auto mce = e->to<IR::MethodCallExpression>();
+    if (!mce)
+        return nullptr;
+    auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
+    if (auto a = mi->to<P4::ExternMethod>()) {
+        if (a->originalExternType->getName().name == "InternetChecksum" &&
+            a->method->getName().name == method)
+            return a->object;
+    }
+    return nullptr;
+}
+
+// A field is written when the program writes it or any struct or header that
+// contains it.
+bool CollectIncrementalChecksums::isWritten(const IR::Expression *e) const {
+    while (auto m = e->to<IR::Member>()) {
+        if (written.count(m->toString()))
+            return true;
+        e = m->expr;
+    }
+    return written.count(e->toString());
+}
+
+bool CollectIncrementalChecksums::preorder(const IR::BlockStatement *b) {
+    auto &c = b->components;
+    for (size_t i = 0; i + 2 < c.size(); i++) {
+        auto clear = c.at(i)->to<IR::MethodCallStatement>();
+        auto add = c.at(i + 1)->to<IR::MethodCallStatement>();
+        auto get = c.at(i + 2)->to<IR::AssignmentStatement>();
+        if (!clear || !add || !get)
+            continue;
+        auto object = checksumCall(clear->methodCall, "clear");
+        if (object && checksumCall(add->methodCall, "add") == object &&
+            checksumCall(get->right, "get") == object)
+            candidates.push_back({add, get});
+    }
+    return true;
+}
+
+bool CollectIncrementalChecksums::preorder(const IR::AssignmentStatement *a) {
+    if (checksumCall(a->right, "get"))
+        checksumWrites[a->left->toString()]++;
+    else
+        written.insert(a->left->toString());
+    return true;
+}
+
+bool CollectIncrementalChecksums::preorder(const IR::MethodCallExpression *m) {
+    auto mi = P4::MethodInstance::resolve(m, refMap, typeMap);
+    if (auto a = mi->to<P4::BuiltInMethod>()) {
+        if (a->name == "setValid" || a->name == "setInvalid")
+            rebuilt.insert(a->appliedTo->toString());
+        return true;
+    } else if (auto a = mi->to<P4::ExternMethod>()) {
+        if (a->originalExternType->getName().name == "packet_in" &&
+            a->method->getName().name == "extract") {
+            extracted.insert(m->arguments->at(0)->expression->toString());
+            return true;
+        }
+    }
+    for (auto p : mi->getActualParameters()->parameters) {
+        auto arg = mi->substitution.lookup(p);
+        if (arg && (p->direction == IR::Direction::Out || p->direction == IR::Direction::InOut))
+            written.insert(arg->expression->toString());
+    }
+    return true;
+}
+
+void CollectIncrementalChecksums::collectUpdate(const IR::MethodCallStatement *add,
+                                                const IR::AssignmentStatement *get) {
+    auto dst = get->left->to<IR::Member>();
+    if (!dst || checksumWrites[dst->toString()] != 1 || isWritten(dst))
+        return;
+    auto header = dst->expr->to<IR::Member>();
+    if (!header || !extracted.count(header->toString()) ||
+        rebuilt.count(header->toString()))
+        return;
+    auto args = add->methodCall->arguments;
+    if (args->size() != 1)
+        return;
+    // EliminateTuples turns the list of the add into a struct expression
+    IR::Vector<IR::Expression> components;
+    auto arg = args->at(0)->expression;
+    if (auto list = arg->to<IR::ListExpression>()) {
+        components = list->components;
+    } else if (auto s = arg->to<IR::StructExpression>()) {
+        for (auto c : s->components)
+            components.push_back(c->expression);
+    } else {
+        return;
+    }
+
+    // The checksum sums the fields as a sequence of 16-bit words, so the
+    // modified fields are added at their offset in their word. Fields that span
+    // several words are only supported when they are made of whole words.
+    IncrementalChecksum update = { dst, {} };
+    unsigned offset = 0;
+    for (auto c : components) {
+        auto field = c->to<IR::Member>();
+        auto type = typeMap->getType(c);
+        if (!field || !type || !type->is<IR::Type_Bits>() ||
+            field->expr->toString() != header->toString() || field->member == dst->member)
+            return;
+        unsigned width = type->to<IR::Type_Bits>()->width_bits();
+        unsigned pos = offset % 16;
+        offset += width;
+        if (!isWritten(field))
+            continue;
+        unsigned shift = 0;
+        if (pos + width <= 16)
+            shift = 16 - pos - width;
+        else if (pos != 0 || width % 16 != 0)
+            return;
+        cstring name = shift
+                ? cstring::concat(header->member.name, '_', field->member.name, "_shl", shift)
+                : cstring::concat(header->member.name, '_', field->member.name);
+        update.fields.push_back({ field, shift ? IR::Type_Bits::get(16) : type, shift,
+                                  cstring("csum_old_" + name),
+                                  shift ? cstring("csum_new_" + name) : cstring() });
+    }
+    updates->emplace(add, update);
+}
+
+void CollectIncrementalChecksums::end_apply() {
+    for (auto c : candidates)
+        collectUpdate(c.first, c.second);
+}
+
+const IR::Node *ApplyIncrementalChecksums::postorder(IR::ParserState *s) {
+    IR::IndexedVector<IR::StatOrDecl> components;
+    for (auto c : s->components) {
+        components.push_back(c);
+        auto mcs = c->to<IR::MethodCallStatement>();
+        if (!mcs || mcs->methodCall->arguments->size() == 0)
+            continue;
+        auto method = mcs->methodCall->method->to<IR::Member>();
+        if (!method || method->member != "extract")
+            continue;
+        cstring header = mcs->methodCall->arguments->at(0)->expression->toString();
+        std::set<cstring> saved;
+        for (auto &kv : updates) {
+            for (auto &f : kv.second.fields) {
+                if (f.field->expr->toString() != header || !saved.insert(f.oldValue).second)
+                    continue;
+                auto oldValue = metadataField(f.oldValue);
+                if (f.shift) {
+                    components.push_back(new IR::AssignmentStatement(
+                        oldValue, new IR::Cast(f.type, f.field)));
+                    components.push_back(new IR::AssignmentStatement(
+                        oldValue, new IR::Shl(oldValue, new IR::Constant(f.shift))));
+                } else {
+                    components.push_back(new IR::AssignmentStatement(oldValue, f.field));
+                }
+            }
+        }
+    }
+    s->components = components;
+    return s;
+}
+
+const IR::Node *ApplyIncrementalChecksums::postorder(IR::BlockStatement *b) {
+    IR::IndexedVector<IR::StatOrDecl> components;
+    for (auto c : b->components) {
+        auto it = updates.find(c->to<IR::MethodCallStatement>());
+        if (it == updates.end()) {
+            components.push_back(c);
+            continue;
+        }
+        auto &update = it->second;
+        auto object = it->first->methodCall->method->to<IR::Member>()->expr;
+        auto call = [object](cstring method, IR::Vector<IR::Expression> fields) {
+            return new IR::MethodCallStatement(new IR::MethodCallExpression(
+                new IR::Member(object, IR::ID(method)),
+                new IR::Vector<IR::Argument>(
+                    new IR::Argument(new IR::ListExpression(fields)))));
+        };
+        components.push_back(call("subtract", { update.dst }));
+        if (update.fields.empty())
+            continue;
+        IR::Vector<IR::Expression> oldValues, newValues;
+        for (auto &f : update.fields) {
+            oldValues.push_back(metadataField(f.oldValue));
+            if (f.shift) {
+                auto newValue = metadataField(f.newValue);
+                components.push_back(new IR::AssignmentStatement(
+                    newValue, new IR::Cast(f.type, f.field)));
+                components.push_back(new IR::AssignmentStatement(
+                    newValue, new IR::Shl(newValue, new IR::Constant(f.shift))));
+                newValues.push_back(newValue);
+            } else {
+                newValues.push_back(f.field);
+            }
+        }
+        components.push_back(call("subtract", oldValues));
+        components.push_back(call("add", newValues));
+    }
+    b->components = components;
+    return b;
+}
+
+const IR::Node *ApplyIncrementalChecksums::postorder(IR::Type_Struct *s) {
+    if (s->name.name != structure->local_metadata_type)
+        return s;
+    for (auto &kv : updates) {
+        for (auto &f : kv.second.fields) {
+            for (auto name : { f.oldValue, f.newValue }) {
+                if (name.isNullOrEmpty() || s->fields.getDeclaration(name))
+                    continue;
+                s->fields.push_back(new IR::StructField(IR::ID(name), f.type));
+                structure->local_variable_fields.insert(name);
+            }
+        }
+    }
+    return s;
+}
+
 const IR::Node *PrependPDotToActionArgs::postorder(IR::P4Action *a) {
     if (a->parameters->size() > 0) {
         auto l = new IR::IndexedVector<IR::Parameter>;
@@ -868,6 +1246,137 @@ const IR::Node* PrependPDotToActionArgs::preorder(IR::MethodCallExpression* mce)
             arguments);
 }
 
+namespace {
+
+/// The value and mask of the entry key @e of a key of @width bits, or false if it is
+/// not a constant, a constant with a mask or a don't care.
+bool entryMask(const IR::Expression* e, unsigned width, big_int& value, big_int& mask) {
+    if (auto c = e->to<IR::Constant>()) {
+        mask = Util::mask(width);
+        value = c->value & mask;
+        return true;
+    } else if (auto b = e->to<IR::BoolLiteral>()) {
+        mask = 1;
+        value = b->value ? 1 : 0;
+        return true;
+    } else if (e->is<IR::DefaultExpression>()) {
+        mask = value = 0;
+        return true;
+    } else if (auto m = e->to<IR::Mask>()) {
+        auto v = m->left->to<IR::Constant>();
+        auto k = m->right->to<IR::Constant>();
+        if (!v || !k)
+            return false;
+        mask = k->value & Util::mask(width);
+        value = v->value & mask;
+        return true;
+    }
+    return false;
+}
+
+/// The length of the prefix @mask of a key of @width bits, or -1 if it is not a prefix.
+int prefixLength(const big_int& mask, unsigned width) {
+    if (mask == 0)
+        return 0;
+    unsigned low = Util::scan1(mask, 0);
+    if (low >= width || mask != (Util::mask(width) ^ Util::mask(low)))
+        return -1;
+    return width - low;
+}
+
+}  // namespace
+
+const IR::Node* SelectTableMatchKinds::preorder(IR::P4Table* table) {
+    auto key = table->getKey();
+    if (!key || key->keyElements.empty() || table->getAnnotation("keep_match_kinds") ||
+        isLearnerTable(table) || table->properties->getProperty("selector"))
+        return table;
+    auto& corelib = P4::P4CoreLibrary::instance();
+    auto n = key->keyElements.size();
+    // full: every entry has a full mask; prefix: the masks are prefixes, longest first
+    std::vector<cstring> kinds(n);
+    std::vector<bool> full(n), prefix(n);
+    for (size_t i = 0; i < n; i++) {
+        auto element = key->keyElements.at(i);
+        kinds[i] = element->matchType->path->name.name;
+        if (kinds[i] != corelib.exactMatch.name && kinds[i] != corelib.ternaryMatch.name &&
+            kinds[i] != corelib.lpmMatch.name && kinds[i] != "optional")
+            return table;
+        full[i] = kinds[i] == corelib.exactMatch.name ||
+                  element->getAnnotation("exact_like") != nullptr;
+        prefix[i] = full[i];
+    }
+
+    // The entries of a table with const entries are all those it can have
+    auto property = table->properties->getProperty(IR::TableProperties::entriesPropertyName);
+    const IR::EntriesList* entries = nullptr;
+    if (property && property->isConstant)
+        entries = property->value->to<IR::EntriesList>();
+    std::set<std::string> matches;
+    bool unique = true;
+    if (entries) {
+        std::vector<int> lengths(n, -1);
+        for (size_t i = 0; i < n; i++)
+            full[i] = prefix[i] = true;
+        for (auto entry : entries->entries) {
+            auto& components = entry->keys->components;
+            if (components.size() != n)
+                return table;
+            std::string match;
+            for (size_t i = 0; i < n; i++) {
+                auto width = key->keyElements.at(i)->expression->type->width_bits();
+                big_int value, mask;
+                if (width <= 0 || !entryMask(components.at(i), width, value, mask))
+                    return table;
+                match += value.str() + "&&&" + mask.str() + ",";
+                int length = prefixLength(mask, width);
+                full[i] = full[i] && length == width;
+                // Without priorities, the first entry of the overlapping ones matches,
+                // which is the longest prefix only if they are in that order
+                prefix[i] = prefix[i] && length >= 0 && !entry->getAnnotation("priority") &&
+                            (lengths[i] < 0 || length <= lengths[i]);
+                lengths[i] = length;
+            }
+            unique = matches.insert(match).second && unique;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (!full[i] && key->keyElements.at(i)->getAnnotation("exact_like"))
+                ::warning(ErrorType::WARN_MISMATCH, "%1%: @exact_like key with entries that "
+                          "have a mask", key->keyElements.at(i));
+        }
+    }
+
+    // All the keys but one at most must be exact, and that one lpm
+    size_t lpm = n;
+    for (size_t i = 0; i < n; i++) {
+        if (full[i])
+            continue;
+        if (lpm != n || (kinds[i] != corelib.lpmMatch.name && !prefix[i]))
+            return table;
+        lpm = i;
+    }
+    // The entries of an exact or LPM table must have different keys
+    if (!unique)
+        return table;
+    for (size_t i = 0; i < n; i++) {
+        auto kind = i == lpm ? corelib.lpmMatch.name : corelib.exactMatch.name;
+        if (kind == kinds[i])
+            continue;
+        LOG2("Matching key " << key->keyElements.at(i) << " of " << table->name << " as "
+             << kind);
+        selected.emplace(key->keyElements.at(i), kind);
+    }
+    return table;
+}
+
+const IR::Node* SelectTableMatchKinds::postorder(IR::KeyElement* element) {
+    auto it = selected.find(getOriginal<IR::KeyElement>());
+    if (it == selected.end())
+        return element;
+    element->matchType = new IR::PathExpression(IR::ID(it->second));
+    return element;
+}
+
 /* This function transforms the table so that all match keys come from the same struct.
    Mirror copies of match fields are created in metadata struct and table is updated to
    use the metadata fields.
@@ -905,6 +1414,9 @@ const IR::Node* PrependPDotToActionArgs::preorder(IR::MethodCallExpression* mce)
            tbl_0.apply();
        }
   }
+
+   Key fields that all come from the same header, like the parts of a 5-tuple, are matched
+   in place without any copy.
 */
 
 const IR::Node* CopyMatchKeysToSingleStruct::preorder(IR::Key* keys) {
@@ -973,12 +1485,20 @@ const IR::Node* CopyMatchKeysToSingleStruct::postorder(IR::KeyElement* element)
 
     /* All header fields are prefixed with "h.", prefix the match field with table name */
     if (keyName.startsWith("h.")) {
-        keyName = keyName.replace('.','_');
-        keyName = keyName.replace("h_",table->name.toString()+"_");
-        auto keyPathExpr = new IR::PathExpression(IR::ID(refMap->newName(keyName)));
-        auto decl = new IR::Declaration_Variable(keyPathExpr->path->name,
-                                                 element->expression->type, nullptr);
-        insertions->declarations.push_back(decl);
+        /* The first table of the control keyed on this field declares the copy, so the
+           declaration precedes all the tables using it */
+        auto control = findOrigCtxt<IR::P4Control>();
+        auto &copy = keyCopies[std::make_pair(control, keyName)];
+        if (copy.isNull()) {
+            keyName = keyName.replace('.','_');
+            keyName = keyName.replace("h_",table->name.toString()+"_");
+            copy = refMap->newName(keyName);
+            auto decl = new IR::Declaration_Variable(copy, element->expression->type, nullptr);
+            insertions->declarations.push_back(decl);
+        } else {
+            LOG3("Sharing the copy " << copy << " of " << keyName);
+        }
+        auto keyPathExpr = new IR::PathExpression(IR::ID(copy));
         auto right = element->expression;
         auto assign = new IR::AssignmentStatement(element->expression->srcInfo,
                                                   keyPathExpr, right);
@@ -1085,7 +1605,7 @@ SplitP4TableCommon::create_member_table(const IR::P4Table* tbl,
         cstring member_id) {
     IR::Vector<IR::KeyElement> member_keys;
     auto tableKeyEl = new IR::KeyElement(new IR::PathExpression(member_id),
-            new IR::PathExpression(P4::P4CoreLibrary::instance.exactMatch.Id()));
+            new IR::PathExpression(P4::P4CoreLibrary::instance().exactMatch.Id()));
     member_keys.push_back(tableKeyEl);
     IR::IndexedVector<IR::Property> member_properties;
     member_properties.push_back(new IR::Property("key", new IR::Key(member_keys), false));
@@ -31,6 +31,9 @@ cstring TypeStruct2Name(const cstring *s);
 bool isSimpleExpression(const IR::Expression *e);
 bool isNonConstantSimpleExpression(const IR::Expression *e);
 void expressionUnrollSanityCheck(const IR::Expression *e);
+// True if the table has the add_on_miss property, so that its default action can
+// add the missed key to the table
+bool isLearnerTable(const IR::P4Table *t);
 
 using UserMeta = std::set<cstring>;
 
@@ -146,6 +149,35 @@ class DeclarationInjector {
     }
 };
 
+/* The DPDK learn instruction reads the arguments of the learned action from the
+ * metadata fields that follow its first argument. This pass copies the action
+ * parameters given to add_entry into consecutive local variables, which
+ * CollectLocalVariableToMetadata moves in order to the metadata struct, and passes
+ * the list of these variables to add_entry instead. For example,
+ * add_entry("next_hop", {h.ipv4.dstAddr, 1})
+ *
+ * becomes:
+ * next_hop_addr = h.ipv4.dstAddr;
+ * next_hop_port = 1;
+ * add_entry("next_hop", {next_hop_addr, next_hop_port});
+ *
+ * The expire time profile given to set_entry_expire_time is copied to a local
+ * variable as well, since the rearm instruction reads it from the metadata.
+ */
+class CopyLearnerActionArgs : public Transform {
+    P4::ReferenceMap *refMap;
+    DeclarationInjector injector;
+
+    const IR::Node *copyAddEntryArgs(const IR::MethodCallStatement *s);
+    const IR::Node *copyExpireTimeProfile(const IR::MethodCallStatement *s);
+
+  public:
+    explicit CopyLearnerActionArgs(P4::ReferenceMap *refMap) : refMap(refMap) {}
+    const IR::Node *postorder(IR::MethodCallStatement *s) override;
+    const IR::Node *postorder(IR::P4Table *t) override;
+    const IR::Node *postorder(IR::P4Control *c) override;
+};
+
 /* This pass breaks complex expressions down, since dpdk asm cannot describe
  * complex expression. This pass is not complete. MethodCallStatement should be
  * unrolled as well. Note that IfStatement should not be unrolled here, as we
@@ -216,6 +248,9 @@ class IfStatementUnroll : public Transform {
 /* Assume one logical expression looks like this: a && (b + c > d), this pass
  * will unroll the expression to {tmp = b + c; if(a && (tmp > d))}. Logical
  * calculation will be unroll in a dedicated pass.
+ * The negations are pushed down to the comparisons instead of being computed
+ * in temporaries, so !(a == b && c < d) becomes a != b || c >= d, and each
+ * comparison is converted to a single dpdk branch instruction.
  */
 class LogicalExpressionUnroll : public Inspector {
     P4::ReferenceMap* refMap;
@@ -224,17 +259,18 @@ class LogicalExpressionUnroll : public Inspector {
   public:
     IR::IndexedVector<IR::StatOrDecl> stmt;
     IR::IndexedVector<IR::Declaration> decl;
-    IR::Expression *root;
+    const IR::Expression *root = nullptr;
     static bool is_logical(const IR::Operation_Binary *bin) {
         if (bin->is<IR::LAnd>() || bin->is<IR::LOr>() || bin->is<IR::Leq>() ||
             bin->is<IR::Equ>() || bin->is<IR::Neq>() || bin->is<IR::Grt>() ||
-            bin->is<IR::Lss>())
+            bin->is<IR::Lss>() || bin->is<IR::Geq>())
             return true;
-        else if (bin->is<IR::Geq>() or bin->is<IR::Leq>()) {
-            BUG("%1%: not implemented", bin);
-        } else
+        else
             return false;
     }
+    // Returns the negation of the unrolled condition @e, with the negation
+    // pushed down to the comparisons by De Morgan's laws.
+    static const IR::Expression *negate(const IR::Expression *e);
 
     LogicalExpressionUnroll(P4::ReferenceMap* refMap, DpdkProgramStructure *structure)
         : refMap(refMap), structure(structure) {}
@@ -381,6 +417,106 @@ class ConvertInternetChecksum : public PassManager {
     }
 };
 
+// A header field that a checksum update adds back incrementally. The value of the
+// field at extraction is kept in the metadata field @oldValue. Fields that do not
+// end at a 16-bit word boundary of the checksum are shifted to their position in
+// the word, both in @oldValue and in the metadata field @newValue.
+struct ModifiedChecksumField {
+    const IR::Member *field;
+    const IR::Type *type;
+    unsigned shift;
+    cstring oldValue;
+    cstring newValue;
+};
+
+// The incremental update of the checksum field @dst of a header.
+struct IncrementalChecksum {
+    const IR::Member *dst;
+    std::vector<ModifiedChecksumField> fields;
+};
+
+/* This pass finds the InternetChecksum computations that recompute the checksum
+ * of a header from all its fields, like:
+ * ck.clear();
+ * ck.add({h.ipv4.version, ..., h.ipv4.dstAddr});
+ * h.ipv4.hdrChecksum = ck.get();
+ *
+ * which can be updated incrementally instead, because the header is extracted by
+ * the parser, is never rebuilt with setValid() or an assignment, and its checksum
+ * field is only written by this computation. The update subtracts the checksum
+ * and the values at extraction of the fields that the program writes, and adds
+ * their new values.
+ */
+class CollectIncrementalChecksums : public Inspector {
+    P4::ReferenceMap *refMap;
+    P4::TypeMap *typeMap;
+    std::map<const IR::MethodCallStatement *, IncrementalChecksum> *updates;
+    std::set<cstring> written;
+    std::set<cstring> extracted;
+    std::set<cstring> rebuilt;
+    std::map<cstring, unsigned> checksumWrites;
+    std::vector<std::pair<const IR::MethodCallStatement *,
+                          const IR::AssignmentStatement *>> candidates;
+
+    const IR::IDeclaration *checksumCall(const IR::Expression *e, cstring method);
+    bool isWritten(const IR::Expression *e) const;
+    void collectUpdate(const IR::MethodCallStatement *add, const IR::AssignmentStatement *get);
+
+  public:
+    CollectIncrementalChecksums(P4::ReferenceMap *refMap, P4::TypeMap *typeMap,
+        std::map<const IR::MethodCallStatement *, IncrementalChecksum> *updates)
+        : refMap(refMap), typeMap(typeMap), updates(updates) {}
+    bool preorder(const IR::BlockStatement *b) override;
+    bool preorder(const IR::AssignmentStatement *a) override;
+    bool preorder(const IR::MethodCallExpression *m) override;
+    void end_apply() override;
+};
+
+/* This pass replaces the checksum computations found by
+ * CollectIncrementalChecksums by their incremental update, and saves the values
+ * of the modified fields after the header is extracted. For example, when the
+ * program only writes h.ipv4.ttl and h.ipv4.dstAddr, the computation above becomes:
+ * ck.clear();
+ * ck.subtract({h.ipv4.hdrChecksum});
+ * m.csum_new_ipv4_ttl = (bit<16>)h.ipv4.ttl;
+ * m.csum_new_ipv4_ttl = m.csum_new_ipv4_ttl << 8;
+ * ck.subtract({m.csum_old_ipv4_ttl, m.csum_old_ipv4_dstAddr});
+ * ck.add({m.csum_new_ipv4_ttl, h.ipv4.dstAddr});
+ * h.ipv4.hdrChecksum = ck.get();
+ *
+ * The metadata fields are added to the local metadata struct.
+ */
+class ApplyIncrementalChecksums : public Transform {
+    DpdkProgramStructure *structure;
+    const std::map<const IR::MethodCallStatement *, IncrementalChecksum> &updates;
+
+    const IR::Expression *metadataField(cstring name) {
+        return new IR::Member(new IR::PathExpression(IR::ID("m")), IR::ID(name));
+    }
+
+  public:
+    ApplyIncrementalChecksums(DpdkProgramStructure *structure,
+        const std::map<const IR::MethodCallStatement *, IncrementalChecksum> &updates)
+        : structure(structure), updates(updates) {}
+    const IR::Node *postorder(IR::ParserState *s) override;
+    const IR::Node *postorder(IR::BlockStatement *b) override;
+    const IR::Node *postorder(IR::Type_Struct *s) override;
+};
+
+class IncrementalChecksumUpdate : public PassManager {
+    std::map<const IR::MethodCallStatement *, IncrementalChecksum> updates;
+
+  public:
+    IncrementalChecksumUpdate(P4::ReferenceMap *refMap, P4::TypeMap *typeMap,
+                              DpdkProgramStructure *structure) {
+        passes.push_back(new CollectIncrementalChecksums(refMap, typeMap, &updates));
+        passes.push_back(new ApplyIncrementalChecksums(structure, updates));
+        passes.push_back(new P4::ClearTypeMap(typeMap));
+        passes.push_back(new P4::TypeChecking(refMap, typeMap, true));
+        setName("IncrementalChecksumUpdate");
+    }
+};
+
 /* This pass collects PSA extern meter, counter and register declaration instances and
    push them to a vector for emitting to the .spec file later */
 class CollectExternDeclaration : public Inspector {
@@ -410,6 +546,11 @@ class CollectExternDeclaration : public Inspector {
                 if (d->arguments->size() != 1 and d->arguments->size() != 2 ) {
                     ::error("%1%: expected size and optionally init_val as arguments", d);
                 }
+            } else if (externTypeName == "Hash") {
+                // no declaration in the spec, the algorithm is needed to reuse hashes
+                if (d->arguments->size() != 1) {
+                    ::error("%1%: expected the hash algorithm as argument", d);
+                }
             } else {
                 // unsupported extern type
                 return false;
@@ -435,6 +576,9 @@ class BreakLogicalExpressionParenthesis : public Transform {
                    not land->left->is<IR::Neq>() and
                    not land->left->is<IR::Lss>() and
                    not land->left->is<IR::Grt>() and
+                   not land->left->is<IR::Leq>() and
+                   not land->left->is<IR::Geq>() and
+                   not land->left->is<IR::LNot>() and
                    not land->left->is<IR::MethodCallExpression>() and
                    not land->left->is<IR::PathExpression>() and
                    not land->left->is<IR::Member>()) {
@@ -451,6 +595,9 @@ class BreakLogicalExpressionParenthesis : public Transform {
                    not lor->left->is<IR::Neq>() and
                    not lor->left->is<IR::Lss>() and
                    not lor->left->is<IR::Grt>() and
+                   not lor->left->is<IR::Leq>() and
+                   not lor->left->is<IR::Geq>() and
+                   not lor->left->is<IR::LNot>() and
                    not lor->left->is<IR::MethodCallExpression>() and
                    not lor->left->is<IR::PathExpression>() and
                    not lor->left->is<IR::Member>()) {
@@ -467,7 +614,8 @@ class BreakLogicalExpressionParenthesis : public Transform {
 class SwapSimpleExpressionToFrontOfLogicalExpression : public Transform {
     bool is_simple(const IR::Node *n) {
         if (n->is<IR::Equ>() or n->is<IR::Neq>() or n->is<IR::Lss>() or
-            n->is<IR::Grt>() or n->is<IR::MethodCallExpression>() or
+            n->is<IR::Grt>() or n->is<IR::Leq>() or n->is<IR::Geq>() or
+            n->is<IR::LNot>() or n->is<IR::MethodCallExpression>() or
             n->is<IR::PathExpression>() or n->is<IR::Member>()) {
             return true;
         } else if (not n->is<IR::LAnd>() and not n->is<IR::LOr>()) {
@@ -522,11 +670,34 @@ class ConvertLogicalExpression : public PassManager {
     }
 };
 
+// This pass selects the match kinds of the table keys that give the cheapest DPDK table
+// type consistent with the entries that can be installed: an exact match (hash) table
+// when all the keys are exact, an LPM table when one key is lpm and the others are exact,
+// and a wildcard table otherwise, which is left as declared. A ternary or optional key
+// is exact when all its entries have a full mask, and lpm when their masks are prefixes
+// listed longest first; an lpm key is exact when all its prefixes have the full length.
+// The entries are only known for the tables with const entries; for the others, an
+// @exact_like key is one for which the control plane only installs full masks. The
+// tables annotated with @keep_match_kinds keep the declared match kinds.
+class SelectTableMatchKinds : public Transform {
+    // The match kind selected for each key element that changes
+    std::map<const IR::KeyElement*, cstring> selected;
+
+ public:
+    SelectTableMatchKinds() { setName("SelectTableMatchKinds"); }
+    const IR::Node* preorder(IR::P4Table* table) override;
+    const IR::Node* postorder(IR::KeyElement* element) override;
+};
+
 // This pass transforms the tables such that all the Match keys are part of the same
 // header/metadata struct. If the match keys are from different headers, this pass creates
 // mirror copies of the struct field into the metadata struct and updates the table to use
-// the metadata copy.
+// the metadata copy. The tables of a control that key on the same header field share
+// its copy, which keeps the key fields of the metadata struct few and compact.
 class CopyMatchKeysToSingleStruct : public P4::KeySideEffect {
+    // The copies of the header fields, indexed by control and field
+    std::map<std::pair<const IR::P4Control*, cstring>, cstring> keyCopies;
+
  public:
     CopyMatchKeysToSingleStruct(P4::ReferenceMap* refMap, P4::TypeMap* typeMap,
              std::set<const IR::P4Table*>* invokedInKey)
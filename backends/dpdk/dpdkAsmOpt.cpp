@@ -16,6 +16,10 @@ limitations under the License.
 
 #include "dpdkAsmOpt.h"
 
+#include <algorithm>
+
+#include "lib/bitvec.h"
+
 namespace DPDK {
 // The assumption is compiler can only produce forward jumps.
 const IR::IndexedVector<IR::DpdkAsmStatement> *RemoveRedundantLabel::removeRedundantLabel(
@@ -163,4 +167,813 @@ const IR::IndexedVector<IR::DpdkAsmStatement> *RemoveLabelAfterLabel::removeLabe
     }
     return new_l;
 }
+
+namespace {
+
+int operandWidth(const IR::Expression *e) {
+    auto type = e->type->to<IR::Type_Bits>();
+    return type ? type->width_bits() : -1;
+}
+
+// True if the instructions that read @dst after mov @dst @src can read @src instead
+bool canForward(const IR::Expression *dst, const IR::Expression *src) {
+    auto width = operandWidth(dst);
+    if (width <= 0 || dst->equiv(*src))
+        return false;
+    if (auto c = src->to<IR::Constant>())
+        return c->value >= 0 && c->value < Util::shift_left(1, width);
+    if (!src->is<IR::Member>() && !src->is<IR::PathExpression>())
+        return false;
+    return operandWidth(src) == width;
+}
+
+// Instructions that only read their sources and write their destination
+bool isArithmetic(const IR::DpdkAsmStatement *s) {
+    return s->is<IR::DpdkUnaryStatement>() || s->is<IR::DpdkBinaryStatement>();
+}
+
+bool readsOperand(const IR::DpdkAsmStatement *s, const IR::Expression *operand) {
+    if (auto unary = s->to<IR::DpdkUnaryStatement>())
+        return unary->src->equiv(*operand);
+    auto binary = s->to<IR::DpdkBinaryStatement>();
+    return binary->src1->equiv(*operand) || binary->src2->equiv(*operand);
+}
+
+}  // namespace
+
+Visitor::profile_t CollectOperandReads::init_apply(const IR::Node *node) {
+    reads->clear();
+    writes.clear();
+    return Inspector::init_apply(node);
+}
+
+void CollectOperandReads::end_apply() {
+    for (auto w : writes)
+        (*reads)[w.first] -= w.second;
+}
+
+bool CollectOperandReads::preorder(const IR::DpdkAssignmentStatement *s) {
+    auto dst = s->dst->toString();
+    writes[dst]++;
+    // A binary instruction reading its destination only updates it
+    if (auto binary = s->to<IR::DpdkBinaryStatement>())
+        if (binary->src1->equiv(*s->dst))
+            writes[dst]++;
+    return true;
+}
+
+bool CollectOperandReads::preorder(const IR::Member *m) {
+    (*reads)[m->toString()]++;
+    return false;
+}
+
+bool CollectOperandReads::preorder(const IR::PathExpression *p) {
+    (*reads)[p->toString()]++;
+    return false;
+}
+
+const IR::IndexedVector<IR::DpdkAsmStatement> *CopyPropagation::copyPropagation(
+                             const IR::IndexedVector<IR::DpdkAsmStatement> &s) {
+    // The operands copied by the mov instructions of the current sequence of
+    // arithmetic instructions, indexed by their destination
+    std::map<cstring, const IR::Expression *> copies;
+    auto forward = [&copies](const IR::Expression *operand) {
+        auto copy = copies.find(operand->toString());
+        return copy == copies.end() ? operand : copy->second;
+    };
+    auto kill = [&copies](const IR::Expression *dst) {
+        auto name = dst->toString();
+        copies.erase(name);
+        for (auto it = copies.begin(); it != copies.end();) {
+            if (it->second->toString() == name)
+                it = copies.erase(it);
+            else
+                ++it;
+        }
+    };
+
+    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
+    for (auto stmt : s) {
+        if (auto unary = stmt->to<IR::DpdkUnaryStatement>()) {
+            auto src = forward(unary->src);
+            if (src != unary->src) {
+                auto clone = unary->clone();
+                clone->src = src;
+                unary = clone;
+                stmt = clone;
+            }
+            kill(unary->dst);
+            if (unary->is<IR::DpdkMovStatement>() && canForward(unary->dst, unary->src))
+                copies.emplace(unary->dst->toString(), unary->src);
+        } else if (auto binary = stmt->to<IR::DpdkBinaryStatement>()) {
+            // The first source is the destination
+            auto src2 = forward(binary->src2);
+            if (src2 != binary->src2) {
+                auto clone = binary->clone();
+                clone->src2 = src2;
+                stmt = clone;
+            }
+            kill(binary->dst);
+        } else {
+            copies.clear();
+        }
+        new_l->push_back(stmt);
+    }
+    return new_l;
+}
+
+const IR::IndexedVector<IR::DpdkAsmStatement> *RemoveDeadStores::removeDeadStores(
+                             const IR::IndexedVector<IR::DpdkAsmStatement> &s) {
+    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
+    for (size_t i = 0; i < s.size(); i++) {
+        auto stmt = s.at(i);
+        if (!isArithmetic(stmt)) {
+            new_l->push_back(stmt);
+            continue;
+        }
+        auto dst = stmt->to<IR::DpdkAssignmentStatement>()->dst;
+        if (auto mov = stmt->to<IR::DpdkMovStatement>()) {
+            if (mov->src->equiv(*dst))
+                continue;
+        }
+        auto name = dst->toString();
+        auto member = dst->to<IR::Member>();
+        if (member != nullptr && member->expr->toString() == "m" &&
+            locals.count(member->member.name) && reads[name] == 0)
+            continue;
+        // Look for a write of the destination before it is read
+        bool dead = false;
+        for (size_t j = i + 1; j < s.size() && isArithmetic(s.at(j)); j++) {
+            if (readsOperand(s.at(j), dst))
+                break;
+            if (s.at(j)->to<IR::DpdkAssignmentStatement>()->dst->equiv(*dst)) {
+                dead = true;
+                break;
+            }
+        }
+        if (!dead)
+            new_l->push_back(stmt);
+    }
+    return new_l;
+}
+
+const IR::IndexedVector<IR::DpdkAsmStatement> *FoldMovAndOperation::foldMovAndOperation(
+                             const IR::IndexedVector<IR::DpdkAsmStatement> &s) {
+    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
+    for (size_t i = 0; i < s.size(); i++) {
+        auto stmt = s.at(i);
+        new_l->push_back(stmt);
+        auto mov = stmt->to<IR::DpdkMovStatement>();
+        if (mov == nullptr)
+            continue;
+        auto tmp = mov->dst->to<IR::Member>();
+        if (tmp == nullptr || tmp->expr->toString() != "m" ||
+            !locals.count(tmp->member.name) || reads[tmp->toString()] != 1 ||
+            operandWidth(tmp) <= 0)
+            continue;
+        // The operations computing the value of tmp, then the copy of the result
+        size_t j = i + 1;
+        while (j < s.size()) {
+            auto binary = s.at(j)->to<IR::DpdkBinaryStatement>();
+            if (binary == nullptr || !binary->dst->equiv(*tmp) || !binary->src1->equiv(*tmp) ||
+                binary->src2->equiv(*tmp))
+                break;
+            j++;
+        }
+        if (j == s.size())
+            continue;
+        auto copy = s.at(j)->to<IR::DpdkMovStatement>();
+        if (copy == nullptr || !copy->src->equiv(*tmp) || copy->dst->equiv(*tmp) ||
+            operandWidth(copy->dst) != operandWidth(tmp))
+            continue;
+        auto dst = copy->dst;
+        bool readsDst = false;
+        for (size_t k = i + 1; k < j; k++)
+            readsDst = readsDst || s.at(k)->to<IR::DpdkBinaryStatement>()->src2->equiv(*dst);
+        if (readsDst)
+            continue;
+
+        LOG3("Computing " << tmp << " directly into " << dst);
+        new_l->pop_back();
+        new_l->push_back(new IR::DpdkMovStatement(dst, mov->src));
+        for (size_t k = i + 1; k < j; k++) {
+            auto binary = s.at(k)->to<IR::DpdkBinaryStatement>()->clone();
+            binary->dst = dst;
+            binary->src1 = dst;
+            new_l->push_back(binary);
+        }
+        i = j;
+    }
+    return new_l;
+}
+
+const IR::Node *InlineConstantDefaultActions::preorder(IR::DpdkAsmProgram *p) {
+    inlined.clear();
+    std::map<cstring, unsigned> applies;
+    for (auto s : p->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>()) {
+            for (auto i : l->statements) {
+                if (auto a = i->to<IR::DpdkApplyStatement>())
+                    applies[a->table]++;
+            }
+        }
+    }
+    // The frontend may leave several copies of an action, the first one is kept
+    std::map<cstring, const IR::DpdkAction *> actions;
+    for (auto a : p->actions)
+        actions.emplace(a->name.name, a);
+
+    for (auto t : p->tables) {
+        if ((t->match_keys && !t->match_keys->keyElements.empty()) || applies[t->name] != 1)
+            continue;
+        auto prop = t->properties->getProperty(IR::TableProperties::defaultActionPropertyName);
+        auto call = t->default_action->to<IR::MethodCallExpression>();
+        if (!prop || !prop->isConstant || !call || !call->arguments->empty() ||
+            !call->method->is<IR::PathExpression>())
+            continue;
+        auto action = actions.find(call->method->to<IR::PathExpression>()->path->name);
+        if (action == actions.end())
+            continue;
+        auto body = new IR::IndexedVector<IR::DpdkAsmStatement>;
+        bool straight = true;
+        for (auto s : action->second->statements) {
+            if (s->is<IR::DpdkReturnStatement>())
+                break;
+            if (s->is<IR::DpdkJmpStatement>() || s->is<IR::DpdkLabelStatement>())
+                straight = false;
+            body->push_back(s);
+        }
+        if (straight)
+            inlined.emplace(t->name, body);
+    }
+    return p;
+}
+
+const IR::IndexedVector<IR::DpdkAsmStatement> *
+InlineConstantDefaultActions::inlineDefaultActions(
+                      const IR::IndexedVector<IR::DpdkAsmStatement> &s) {
+    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
+    for (size_t i = 0; i < s.size(); i++) {
+        auto apply = s.at(i)->to<IR::DpdkApplyStatement>();
+        auto body = apply ? inlined.find(apply->table) : inlined.end();
+        if (body == inlined.end()) {
+            new_l->push_back(s.at(i));
+            continue;
+        }
+        new_l->append(*body->second);
+        if (i + 1 < s.size()) {
+            auto next = s.at(i + 1);
+            if (auto miss = next->to<IR::DpdkJmpMissStatement>()) {
+                new_l->push_back(new IR::DpdkJmpLabelStatement(miss->label));
+                i++;
+            } else if (next->is<IR::DpdkJmpHitStatement>()) {
+                i++;
+            }
+        }
+    }
+    return new_l;
+}
+
+namespace {
+
+// Inserts in @writes the operands that @s writes, a header stands for all its
+// fields and "*" for any operand. Applies are handled by the caller.
+void collectWrites(const IR::DpdkAsmStatement *s, std::set<cstring> &writes) {
+    if (auto a = s->to<IR::DpdkAssignmentStatement>())
+        writes.insert(a->dst->toString());
+    else if (auto h = s->to<IR::DpdkGetHashStatement>())
+        writes.insert(h->dst->toString());
+    else if (auto c = s->to<IR::DpdkGetChecksumStatement>())
+        writes.insert(c->dst->toString());
+    else if (auto c = s->to<IR::DpdkCastStatement>())
+        writes.insert(c->dst->toString());
+    else if (auto m = s->to<IR::DpdkMeterExecuteStatement>())
+        writes.insert(m->color_out->toString());
+    else if (auto e = s->to<IR::DpdkExtractStatement>())
+        writes.insert(e->header->toString());
+    else if (auto v = s->to<IR::DpdkValidateStatement>())
+        writes.insert(v->header->toString());
+    else if (auto v = s->to<IR::DpdkInvalidateStatement>())
+        writes.insert(v->header->toString());
+    else if (s->is<IR::DpdkChecksumAddStatement>() || s->is<IR::DpdkChecksumSubStatement>() ||
+             s->is<IR::DpdkChecksumClearStatement>())
+        writes.insert("h.cksum_state");
+    else if (!s->is<IR::DpdkJmpStatement>() && !s->is<IR::DpdkLabelStatement>() &&
+             !s->is<IR::DpdkEmitStatement>() && !s->is<IR::DpdkTxStatement>() &&
+             !s->is<IR::DpdkReturnStatement>() && !s->is<IR::DpdkDropStatement>() &&
+             !s->is<IR::DpdkCounterCountStatement>() &&
+             !s->is<IR::DpdkRegisterWriteStatement>() && !s->is<IR::DpdkLearnStatement>() &&
+             !s->is<IR::DpdkRearmStatement>() && !s->is<IR::DpdkForgetStatement>())
+        writes.insert("*");
+}
+
+bool isWritten(cstring operand, const std::set<cstring> &writes) {
+    for (auto w : writes) {
+        if (w == "*" || operand == w || operand.startsWith(w + "."))
+            return true;
+    }
+    return false;
+}
+
+// A hash held by an operand
+struct AvailableHash {
+    const IR::Expression *holder;
+    std::vector<cstring> fields;
+};
+
+}  // namespace
+
+const IR::Node *ReuseHashComputations::preorder(IR::DpdkAsmProgram *p) {
+    algorithms.clear();
+    tableWrites.clear();
+    for (auto d : p->externDeclarations) {
+        auto type = d->type->to<IR::Type_Specialized>();
+        if (type && type->baseType->path->name == "Hash" && !d->arguments->empty())
+            algorithms.emplace(d->name.name, d->arguments->at(0)->expression->toString());
+    }
+    std::map<cstring, std::set<cstring>> actionWrites;
+    for (auto a : p->actions) {
+        auto &writes = actionWrites[a->name.name];
+        for (auto s : a->statements)
+            collectWrites(s, writes);
+    }
+    auto collectTableWrites = [&](cstring name, const IR::ActionList *actions) {
+        auto &writes = tableWrites[name];
+        for (auto a : actions->actionList) {
+            auto it = actionWrites.find(a->getName());
+            if (it == actionWrites.end())
+                writes.insert("*");
+            else
+                writes.insert(it->second.begin(), it->second.end());
+        }
+    };
+    for (auto t : p->tables)
+        collectTableWrites(t->name, t->actions);
+    for (auto l : p->learners)
+        collectTableWrites(l->name, l->actions);
+    for (auto s : p->selectors)
+        tableWrites[s->name].insert(s->member_id);
+    return p;
+}
+
+const IR::IndexedVector<IR::DpdkAsmStatement> *
+ReuseHashComputations::reuseHashComputations(
+                      const IR::IndexedVector<IR::DpdkAsmStatement> &s) {
+    using Available = std::map<cstring, AvailableHash>;
+    // The hashes available at a label are those available on all the jumps to
+    // the label and at the end of the preceding instruction. The jumps to a
+    // preceding label close a loop, nothing is available at such labels.
+    std::map<cstring, size_t> labels;
+    std::set<cstring> loops;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (auto l = s.at(i)->to<IR::DpdkLabelStatement>())
+            labels.emplace(l->label, i);
+    }
+    for (size_t i = 0; i < s.size(); i++) {
+        if (auto j = s.at(i)->to<IR::DpdkJmpStatement>()) {
+            auto label = labels.find(j->label);
+            if (label == labels.end() || label->second < i)
+                loops.insert(j->label);
+        }
+    }
+    auto intersect = [](Available &a, const Available &b) {
+        for (auto it = a.begin(); it != a.end();) {
+            auto other = b.find(it->first);
+            if (other == b.end() || !other->second.holder->equiv(*it->second.holder))
+                it = a.erase(it);
+            else
+                ++it;
+        }
+    };
+    auto kill = [](Available &a, const std::set<cstring> &writes) {
+        for (auto it = a.begin(); it != a.end();) {
+            bool killed = isWritten(it->second.holder->toString(), writes);
+            for (auto f : it->second.fields)
+                killed = killed || isWritten(f, writes);
+            if (killed)
+                it = a.erase(it);
+            else
+                ++it;
+        }
+    };
+
+    std::map<cstring, Available> atLabel;
+    Available available;
+    bool reachable = true;
+    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
+    for (auto stmt : s) {
+        if (auto l = stmt->to<IR::DpdkLabelStatement>()) {
+            auto incoming = atLabel.find(l->label);
+            if (!reachable)
+                available.clear();
+            if (incoming != atLabel.end()) {
+                if (reachable)
+                    intersect(available, incoming->second);
+                else
+                    available = incoming->second;
+            }
+            if (loops.count(l->label))
+                available.clear();
+            reachable = true;
+        } else if (auto j = stmt->to<IR::DpdkJmpStatement>()) {
+            if (!loops.count(j->label)) {
+                auto incoming = atLabel.find(j->label);
+                if (incoming == atLabel.end())
+                    atLabel.emplace(j->label, available);
+                else
+                    intersect(incoming->second, available);
+            }
+            if (stmt->is<IR::DpdkJmpLabelStatement>())
+                reachable = false;
+        } else if (auto a = stmt->to<IR::DpdkApplyStatement>()) {
+            auto writes = tableWrites.find(a->table);
+            kill(available, writes == tableWrites.end() ? std::set<cstring>{"*"}
+                                                        : writes->second);
+        } else if (auto h = stmt->to<IR::DpdkGetHashStatement>()) {
+            auto list = h->fields->to<IR::ListExpression>();
+            auto width = h->dst->type->to<IR::Type_Bits>();
+            std::set<cstring> writes = {h->dst->toString()};
+            if (list == nullptr || width == nullptr) {
+                kill(available, writes);
+                new_l->push_back(stmt);
+                continue;
+            }
+            auto algorithm = algorithms.find(h->hash);
+            std::string name = algorithm == algorithms.end() ? h->hash : algorithm->second;
+            name += "/" + std::to_string(width->width_bits()) + "/";
+            std::vector<cstring> fields;
+            for (auto c : list->components) {
+                fields.push_back(c->toString());
+                name += " " + fields.back();
+            }
+            cstring key = name;
+            auto hash = available.find(key);
+            bool reused = hash != available.end();
+            if (reused) {
+                auto holder = hash->second.holder;
+                if (holder->equiv(*h->dst))
+                    continue;
+                LOG3("Reusing the hash of " << h->dst << " held by " << holder);
+                stmt = new IR::DpdkMovStatement(h->dst, holder);
+            }
+            kill(available, writes);
+            // A hash of its own destination does not hold after the instruction
+            if (!reused && std::none_of(fields.begin(), fields.end(),
+                                        [&](cstring f) { return isWritten(f, writes); }))
+                available.emplace(key, AvailableHash{h->dst, fields});
+        } else {
+            std::set<cstring> writes;
+            collectWrites(stmt, writes);
+            kill(available, writes);
+        }
+        new_l->push_back(stmt);
+    }
+    return new_l;
+}
+
+Visitor::profile_t CollectMetadataUses::init_apply(const IR::Node *node) {
+    uses->clear();
+    keyFields->clear();
+    return Inspector::init_apply(node);
+}
+
+bool CollectMetadataUses::preorder(const IR::Member *m) {
+    auto path = m->expr->to<IR::PathExpression>();
+    if (path == nullptr)
+        return true;
+    if (path->path->name == "m")
+        use(m->member.name);
+    return false;
+}
+
+// Some temporaries are referenced by name, e.g. m.tmpMask
+bool CollectMetadataUses::preorder(const IR::PathExpression *p) {
+    cstring name = p->path->name;
+    if (name.startsWith("m."))
+        use(name.substr(2));
+    return false;
+}
+
+void CollectMetadataUses::collectKey(const IR::Key *key) {
+    if (key == nullptr)
+        return;
+    for (auto k : key->keyElements) {
+        auto m = k->expression->to<IR::Member>();
+        if (m == nullptr || !m->expr->is<IR::PathExpression>() ||
+            m->expr->to<IR::PathExpression>()->path->name != "m")
+            continue;
+        if (std::find(keyFields->begin(), keyFields->end(), m->member.name) ==
+            keyFields->end())
+            keyFields->push_back(m->member.name);
+    }
+    visit(key);
+}
+
+bool CollectMetadataUses::preorder(const IR::DpdkTable *t) {
+    collectKey(t->match_keys);
+    // The other properties of the table repeat its key and its actions
+    visit(t->default_action);
+    return false;
+}
+
+bool CollectMetadataUses::preorder(const IR::DpdkLearner *l) {
+    collectKey(l->match_keys);
+    visit(l->default_action);
+    return false;
+}
+
+bool CollectMetadataUses::preorder(const IR::DpdkLearnStatement *l) {
+    for (auto arg : l->args->components) {
+        auto m = arg->to<IR::Member>();
+        BUG_CHECK(m != nullptr, "%1%: learn argument is not a metadata field", arg);
+        if (std::find(keyFields->begin(), keyFields->end(), m->member.name) ==
+            keyFields->end())
+            keyFields->push_back(m->member.name);
+    }
+    return true;
+}
+
+// The apply block also uses the fields of its rx, tx and drop instructions
+bool CollectMetadataUses::preorder(const IR::DpdkListStatement *l) {
+    for (auto field : { l->inputPort(), l->outputPort(), l->dropFlag() })
+        use(field);
+    return true;
+}
+
+bool CollectMetadataUses::preorder(const IR::DpdkSelector *s) {
+    for (auto id : { s->group_id, s->member_id }) {
+        if (id.startsWith("m."))
+            use(id.substr(2));
+    }
+    if (s->selectors)
+        visit(s->selectors);
+    return false;
+}
+
+namespace {
+
+// The name of the metadata field @e refers to, or nullptr
+cstring metadataField(const IR::Expression *e) {
+    if (auto m = e->to<IR::Member>()) {
+        auto path = m->expr->to<IR::PathExpression>();
+        if (path != nullptr && path->path->name == "m")
+            return m->member.name;
+    } else if (auto p = e->to<IR::PathExpression>()) {
+        if (p->path->name.name.startsWith("m."))
+            return p->path->name.name.substr(2);
+    }
+    return nullptr;
+}
+
+// The operand that @s always writes entirely, or nullptr
+const IR::Expression *writtenOperand(const IR::DpdkAsmStatement *s) {
+    if (auto a = s->to<IR::DpdkAssignmentStatement>())
+        return a->dst;
+    if (auto h = s->to<IR::DpdkGetHashStatement>())
+        return h->dst;
+    if (auto c = s->to<IR::DpdkGetChecksumStatement>())
+        return c->dst;
+    if (auto c = s->to<IR::DpdkCastStatement>())
+        return c->dst;
+    if (auto m = s->to<IR::DpdkMeterExecuteStatement>())
+        return m->color_out;
+    return nullptr;
+}
+
+}  // namespace
+
+const IR::Node *ShareLocalMetadataFields::preorder(IR::DpdkAsmProgram *p) {
+    replacements.clear();
+    std::map<cstring, const IR::Type *> types;
+    for (auto s : p->structType) {
+        if (s->getAnnotations()->getSingle("__metadata__")) {
+            for (auto f : s->fields)
+                types.emplace(f->name.name, f->type);
+        }
+    }
+    std::map<cstring, unsigned> uses;
+    std::vector<cstring> keyFields;
+    getOriginal()->apply(CollectMetadataUses(&uses, &keyFields));
+    // The fields of the table keys and the learn arguments keep their place
+    for (auto k : keyFields)
+        uses[k] = 0;
+    for (auto s : p->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>())
+            shareFields(l, types, uses);
+    }
+    return p;
+}
+
+void ShareLocalMetadataFields::shareFields(const IR::DpdkListStatement *l,
+                                           const std::map<cstring, const IR::Type *> &types,
+                                           const std::map<cstring, unsigned> &uses) {
+    auto &s = l->statements;
+    size_t n = s.size();
+    // The operand occurrences of each instruction
+    std::vector<std::map<cstring, unsigned>> occurrences(n);
+    std::map<cstring, unsigned> listUses;
+    for (size_t i = 0; i < n; i++) {
+        std::vector<cstring> keyFields;
+        s.at(i)->apply(CollectMetadataUses(&occurrences[i], &keyFields));
+        for (auto o : occurrences[i])
+            listUses[o.first] += o.second;
+    }
+    // The candidates are the local variables only used by these instructions
+    std::vector<cstring> candidates;
+    std::map<cstring, size_t> index;
+    for (auto u : listUses) {
+        auto total = uses.find(u.first);
+        if (locals.count(u.first) && types.count(u.first) && total != uses.end() &&
+            total->second == u.second) {
+            index.emplace(u.first, candidates.size());
+            candidates.push_back(u.first);
+        }
+    }
+    if (candidates.size() < 2)
+        return;
+
+    std::map<cstring, size_t> labels;
+    for (size_t i = 0; i < n; i++) {
+        if (auto label = s.at(i)->to<IR::DpdkLabelStatement>())
+            labels.emplace(label->label, i);
+    }
+    std::vector<bitvec> use(n), def(n), touched(n), in(n), out(n);
+    for (size_t i = 0; i < n; i++) {
+        cstring written;
+        if (auto dst = writtenOperand(s.at(i)))
+            written = metadataField(dst);
+        for (auto o : occurrences[i]) {
+            auto k = index.find(o.first);
+            if (k == index.end())
+                continue;
+            touched[i].setbit(k->second);
+            if (o.first == written) {
+                def[i].setbit(k->second);
+                if (o.second > 1)
+                    use[i].setbit(k->second);
+            } else {
+                use[i].setbit(k->second);
+            }
+        }
+    }
+    // Backward liveness; only the unconditional jumps do not fall through
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = n; i-- > 0;) {
+            bitvec live;
+            auto jmp = s.at(i)->to<IR::DpdkJmpStatement>();
+            if (i + 1 < n && !(jmp && jmp->is<IR::DpdkJmpLabelStatement>()))
+                live |= in[i + 1];
+            if (jmp) {
+                auto target = labels.find(jmp->label);
+                if (target != labels.end())
+                    live |= in[target->second];
+            }
+            out[i] = live;
+            live -= def[i];
+            live |= use[i];
+            if (live != in[i]) {
+                in[i] = live;
+                changed = true;
+            }
+        }
+    }
+    // The variables live after an instruction, or used by it, interfere
+    std::vector<bitvec> interferes(candidates.size());
+    std::vector<size_t> first(candidates.size(), n);
+    for (size_t i = 0; i < n; i++) {
+        bitvec live = out[i] | touched[i];
+        for (auto k : live)
+            interferes[k] |= live;
+        for (auto k : touched[i])
+            first[k] = std::min(first[k], i);
+    }
+
+    std::vector<size_t> order;
+    for (size_t k = 0; k < candidates.size(); k++) {
+        if (!in.empty() && in[0].getbit(k))
+            LOG3("Not sharing " << candidates[k] << ", which may be read before written");
+        else
+            order.push_back(k);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&first](size_t a, size_t b) { return first[a] < first[b]; });
+    struct Field {
+        size_t      owner;
+        cstring     type;
+        bitvec      variables;
+    };
+    std::vector<Field> fields;
+    for (auto k : order) {
+        cstring type = types.at(candidates[k])->toString();
+        auto field = std::find_if(fields.begin(), fields.end(), [&](const Field &f) {
+            return f.type == type && !f.variables.intersects(interferes[k]);
+        });
+        if (field == fields.end()) {
+            fields.push_back({k, type, bitvec()});
+            field = fields.end() - 1;
+        } else {
+            LOG3("Sharing the metadata field " << candidates[field->owner] << " with " <<
+                 candidates[k]);
+            replacements.emplace(candidates[k], candidates[field->owner]);
+        }
+        field->variables.setbit(k);
+    }
+}
+
+const IR::Node *ShareLocalMetadataFields::preorder(IR::DpdkStructType *s) {
+    prune();
+    if (replacements.empty() || !s->getAnnotations()->getSingle("__metadata__"))
+        return s;
+    IR::IndexedVector<IR::StructField> fields;
+    for (auto f : s->fields) {
+        if (!replacements.count(f->name.name))
+            fields.push_back(f);
+    }
+    s->fields = fields;
+    return s;
+}
+
+const IR::Node *ShareLocalMetadataFields::postorder(IR::Member *m) {
+    auto field = metadataField(m);
+    if (field == nullptr)
+        return m;
+    auto replacement = replacements.find(field);
+    if (replacement != replacements.end())
+        m->member = IR::ID(m->member.srcInfo, replacement->second);
+    return m;
+}
+
+const IR::Node *ShareLocalMetadataFields::postorder(IR::PathExpression *p) {
+    auto field = metadataField(p);
+    if (field == nullptr)
+        return p;
+    auto replacement = replacements.find(field);
+    if (replacement != replacements.end())
+        p->path = new IR::Path(IR::ID(p->path->name.srcInfo, "m." + replacement->second));
+    return p;
+}
+
+unsigned LayoutMetadataStruct::fieldSize(const IR::StructField *f) {
+    if (auto t = f->type->to<IR::Type_Bits>())
+        return (t->width_bits() + 7) / 8;
+    // DPDK implements bool and error as bit<8>
+    if (f->type->is<IR::Type_Boolean>() || f->type->is<IR::Type_Error>())
+        return 1;
+    if (auto t = f->type->to<IR::Type_Name>())
+        if (t->path->name == "error")
+            return 1;
+    return 8;
+}
+
+const IR::Node *LayoutMetadataStruct::preorder(IR::DpdkStructType *s) {
+    prune();
+    if (!s->getAnnotations()->getSingle("__metadata__"))
+        return s;
+
+    std::vector<const IR::StructField *> keys;
+    std::vector<const IR::StructField *> others;
+    for (auto name : keyFields) {
+        if (auto f = s->fields.getDeclaration<IR::StructField>(name))
+            keys.push_back(f);
+    }
+    for (auto f : s->fields) {
+        if (std::find(keys.begin(), keys.end(), f) != keys.end())
+            continue;
+        if (uses[f->name.name] == 0) {
+            LOG3("Removing unused metadata field " << f->name);
+            continue;
+        }
+        others.push_back(f);
+    }
+    std::stable_sort(others.begin(), others.end(),
+                     [this](const IR::StructField *a, const IR::StructField *b) {
+                         return uses[a->name.name] > uses[b->name.name];
+                     });
+
+    IR::IndexedVector<IR::StructField> fields;
+    unsigned offset = 0;
+    for (auto f : keys) {
+        fields.push_back(f);
+        offset += fieldSize(f);
+    }
+    // Fill the cache lines one at a time with the most used fields left
+    auto line = others.begin();
+    while (line != others.end()) {
+        unsigned lineEnd = (offset / cacheLineSize + 1) * cacheLineSize;
+        auto end = line;
+        do {
+            offset += fieldSize(*end);
+            ++end;
+        } while (end != others.end() && offset + fieldSize(*end) <= lineEnd);
+        std::stable_sort(line, end, [](const IR::StructField *a, const IR::StructField *b) {
+            return fieldSize(a) > fieldSize(b);
+        });
+        for (auto it = line; it != end; ++it)
+            fields.push_back(*it);
+        line = end;
+    }
+    s->fields = fields;
+    return s;
+}
 }  // namespace DPDK
@@ -135,6 +135,190 @@ class RemoveLabelAfterLabel : public Transform {
     }
 };
 
+// This pass counts how many times each operand is read in the program: by the
+// instructions, the table keys and the extern calls. The destination of an
+// assignment instruction is not counted as read, nor is the first source of a
+// binary instruction, which is its destination. Operands are often shared by
+// several instructions, so every occurrence of a node is visited.
+class CollectOperandReads : public Inspector {
+    std::map<cstring, unsigned> *reads;
+    std::map<cstring, unsigned> writes;
+
+  public:
+    explicit CollectOperandReads(std::map<cstring, unsigned> *reads) : reads(reads)
+    { visitDagOnce = false; }
+    Visitor::profile_t init_apply(const IR::Node *node) override;
+    void end_apply() override;
+    bool preorder(const IR::DpdkAssignmentStatement *s) override;
+    bool preorder(const IR::Member *m) override;
+    bool preorder(const IR::PathExpression *p) override;
+};
+
+// This pass forwards the sources of mov instructions to the instructions that
+// read their destination, until the destination or the source is written again.
+// The copies are only tracked in sequences of assignment instructions, because
+// the other instructions may read or write any operand. For example,
+// mov m.tmp h.ipv4.ttl
+// add m.x m.tmp
+//
+// will become:
+// mov m.tmp h.ipv4.ttl
+// add m.x h.ipv4.ttl
+//
+// Only sources of the same width as the destination and constants that fit in
+// the destination are forwarded, since a mov truncates its source.
+class CopyPropagation : public Transform {
+  public:
+    const IR::IndexedVector<IR::DpdkAsmStatement> *copyPropagation(
+                 const IR::IndexedVector<IR::DpdkAsmStatement> &s);
+
+    const IR::Node *postorder(IR::DpdkListStatement *l) override {
+        l->statements = *copyPropagation(l->statements);
+        return l;
+    }
+
+    const IR::Node *postorder(IR::DpdkAction *l) override {
+        l->statements = *copyPropagation(l->statements);
+        return l;
+    }
+};
+
+// This pass removes the assignment instructions whose destination is written
+// again by a following assignment instruction before being read, and the
+// assignment instructions to local variables that are never read.
+class RemoveDeadStores : public Transform {
+    const std::set<cstring> &locals;
+    std::map<cstring, unsigned> reads;
+
+  public:
+    explicit RemoveDeadStores(const std::set<cstring> &locals) : locals(locals) {}
+    const IR::IndexedVector<IR::DpdkAsmStatement> *removeDeadStores(
+                  const IR::IndexedVector<IR::DpdkAsmStatement> &s);
+
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override {
+        getOriginal()->apply(CollectOperandReads(&reads));
+        return p;
+    }
+
+    const IR::Node *postorder(IR::DpdkListStatement *l) override {
+        l->statements = *removeDeadStores(l->statements);
+        return l;
+    }
+
+    const IR::Node *postorder(IR::DpdkAction *l) override {
+        l->statements = *removeDeadStores(l->statements);
+        return l;
+    }
+};
+
+// This pass computes directly into the destination the values that a sequence
+// of instructions computes in a local variable only read to copy the result.
+// For example,
+// mov m.tmp h.ipv4.ttl
+// add m.tmp 0x1
+// mov h.ipv4.ttl2 m.tmp
+//
+// will become:
+// mov h.ipv4.ttl2 h.ipv4.ttl
+// add h.ipv4.ttl2 0x1
+class FoldMovAndOperation : public Transform {
+    const std::set<cstring> &locals;
+    std::map<cstring, unsigned> reads;
+
+  public:
+    explicit FoldMovAndOperation(const std::set<cstring> &locals) : locals(locals) {}
+    const IR::IndexedVector<IR::DpdkAsmStatement> *foldMovAndOperation(
+                     const IR::IndexedVector<IR::DpdkAsmStatement> &s);
+
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override {
+        getOriginal()->apply(CollectOperandReads(&reads));
+        return p;
+    }
+
+    const IR::Node *postorder(IR::DpdkListStatement *l) override {
+        l->statements = *foldMovAndOperation(l->statements);
+        return l;
+    }
+
+    const IR::Node *postorder(IR::DpdkAction *l) override {
+        l->statements = *foldMovAndOperation(l->statements);
+        return l;
+    }
+};
+
+// This pass replaces the apply of a table without key, which always misses, by the
+// instructions of its default action, when the control plane cannot change it and
+// the table is applied once. The default action must be const, take no arguments
+// and have no jumps. The jmph and jmpnh instructions following the apply are
+// resolved as a miss. For example, with
+// table t { actions = { a; } const default_action = a(); }
+// table t
+// jmpnh LABEL_1
+//
+// becomes:
+// <instructions of a>
+// jmp LABEL_1
+class InlineConstantDefaultActions : public Transform {
+    // The instructions of the default actions, by table
+    std::map<cstring, const IR::IndexedVector<IR::DpdkAsmStatement> *> inlined;
+
+  public:
+    const IR::IndexedVector<IR::DpdkAsmStatement> *inlineDefaultActions(
+                      const IR::IndexedVector<IR::DpdkAsmStatement> &s);
+
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+
+    const IR::Node *postorder(IR::DpdkListStatement *l) override {
+        l->statements = *inlineDefaultActions(l->statements);
+        return l;
+    }
+};
+
+// This pass computes once per packet the hashes of the same fields with the same
+// algorithm in the apply block. A hash_get instruction whose hash is held by an
+// operand on every path reaching it, because neither the operand nor the hashed
+// fields were written since the hash was computed, is replaced by a mov from this
+// operand, or removed when this operand is its destination. For example,
+// hash_get m.Ingress_h1 h_0 ( h.ipv4.src_addr h.ipv4.dst_addr )
+// table ecmp_0
+// hash_get m.Ingress_h2 h_1 ( h.ipv4.src_addr h.ipv4.dst_addr )
+//
+// becomes, when h_0 and h_1 use the same algorithm and the actions of ecmp_0
+// write neither m.Ingress_h1 nor the addresses:
+// hash_get m.Ingress_h1 h_0 ( h.ipv4.src_addr h.ipv4.dst_addr )
+// table ecmp_0
+// mov m.Ingress_h2 m.Ingress_h1
+class ReuseHashComputations : public Transform {
+    // The algorithm of the hash instances
+    std::map<cstring, cstring> algorithms;
+    // The operands written by the actions of the tables, "*" is any operand
+    std::map<cstring, std::set<cstring>> tableWrites;
+
+  public:
+    const IR::IndexedVector<IR::DpdkAsmStatement> *reuseHashComputations(
+                      const IR::IndexedVector<IR::DpdkAsmStatement> &s);
+
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+
+    const IR::Node *postorder(IR::DpdkListStatement *l) override {
+        l->statements = *reuseHashComputations(l->statements);
+        return l;
+    }
+};
+
+// Removes the redundant moves and the dead temporaries that the unrolling of
+// statements and expressions leaves in the instructions. @locals are the fields
+// of the local metadata holding local variables, which are only read by the
+// instructions of the program.
+class DpdkDataflowOptimization : public PassRepeated {
+  public:
+    explicit DpdkDataflowOptimization(const std::set<cstring> &locals) {
+        passes.push_back(new CopyPropagation);
+        passes.push_back(new FoldMovAndOperation(locals));
+        passes.push_back(new RemoveDeadStores(locals));
+    }
+};
+
 // Instructions can only appear in actions and apply block of .spec file.
 // All these individual passes work on the actions and apply block of .spec file.
 class DpdkAsmOptimization : public PassRepeated {
@@ -151,5 +335,87 @@ class DpdkAsmOptimization : public PassRepeated {
     }
 };
 
+// This pass shares the metadata fields of the local variables, most of which are
+// temporaries introduced by the unrolling of statements and expressions, between
+// the variables of the same type that are never live at the same time. The
+// liveness of the variables only used by the instructions of the apply block is
+// computed on its control flow graph; a variable that an instruction may read
+// before any write is never shared. The variables are then assigned to fields in
+// the order of their first use, each to the first field none of whose variables
+// it interferes with, and the fields left unused are removed. For example,
+// mov m.Ingress_tmp h.ipv4.ttl
+// add m.Ingress_tmp 0x1
+// mov h.ipv4.ttl m.Ingress_tmp
+// mov m.Ingress_tmp_0 h.ipv4.totalLen
+//
+// will become:
+// mov m.Ingress_tmp h.ipv4.ttl
+// add m.Ingress_tmp 0x1
+// mov h.ipv4.ttl m.Ingress_tmp
+// mov m.Ingress_tmp h.ipv4.totalLen
+class ShareLocalMetadataFields : public Transform {
+    const std::set<cstring> &locals;
+    // The field holding each local variable that shares the field of another one
+    std::map<cstring, cstring> replacements;
+
+    void shareFields(const IR::DpdkListStatement *l,
+                     const std::map<cstring, const IR::Type *> &types,
+                     const std::map<cstring, unsigned> &uses);
+
+  public:
+    explicit ShareLocalMetadataFields(const std::set<cstring> &locals) : locals(locals) {}
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+    const IR::Node *preorder(IR::DpdkStructType *s) override;
+    const IR::Node *postorder(IR::Member *m) override;
+    const IR::Node *postorder(IR::PathExpression *p) override;
+};
+
+// This pass counts how many times the program uses each field of the metadata
+// struct, and collects in order the fields of the table keys and the arguments
+// of the learn instructions, which must stay consecutive.
+class CollectMetadataUses : public Inspector {
+    std::map<cstring, unsigned> *uses;
+    std::vector<cstring> *keyFields;
+
+    void use(cstring field) { (*uses)[field]++; }
+    void collectKey(const IR::Key *key);
+
+  public:
+    CollectMetadataUses(std::map<cstring, unsigned> *uses, std::vector<cstring> *keyFields)
+        : uses(uses), keyFields(keyFields) { visitDagOnce = false; }
+    Visitor::profile_t init_apply(const IR::Node *node) override;
+    bool preorder(const IR::Member *m) override;
+    bool preorder(const IR::PathExpression *p) override;
+    bool preorder(const IR::DpdkTable *t) override;
+    bool preorder(const IR::DpdkSelector *s) override;
+    bool preorder(const IR::DpdkLearner *l) override;
+    bool preorder(const IR::DpdkLearnStatement *l) override;
+    bool preorder(const IR::DpdkListStatement *l) override;
+};
+
+// This pass lays out the metadata struct so that the fields used together by each
+// packet share as few cache lines as possible. The fields of the table keys come
+// first, in key order, so that the lookup keys are compact, with the arguments of
+// the learn instructions, which are read from consecutive fields. The other fields
+// follow by decreasing number of uses, and by decreasing size within each cache
+// line, so that fields whose size is a power of two stay naturally aligned. The
+// fields that the program never uses are removed.
+class LayoutMetadataStruct : public Transform {
+    std::map<cstring, unsigned> uses;
+    std::vector<cstring> keyFields;
+
+  public:
+    static const unsigned cacheLineSize = 64;
+    // The size in bytes of a metadata field in the DPDK pipeline
+    static unsigned fieldSize(const IR::StructField *f);
+
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override {
+        getOriginal()->apply(CollectMetadataUses(&uses, &keyFields));
+        return p;
+    }
+
+    const IR::Node *preorder(IR::DpdkStructType *s) override;
+};
+
 } // namespace DPDK
 #endif
@@ -0,0 +1,234 @@
+/*
+Copyright 2020 Intel Corp.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "dpdkCostReport.h"
+#include "dpdkAsmOpt.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace DPDK {
+
+// The rx and mov instructions that the apply block starts with, and the tx or drop
+// instruction that it ends with.
+static const unsigned applyPrologue = 2;
+static const unsigned applyEpilogue = 1;
+
+unsigned DpdkCostReport::metadataBytes(const IR::IndexedVector<IR::DpdkAsmStatement> &s) {
+    std::map<cstring, unsigned> uses;
+    std::vector<cstring> keyFields;
+    s.apply(CollectMetadataUses(&uses, &keyFields));
+    unsigned bytes = 0;
+    for (auto &u : uses) {
+        auto it = fieldSizes.find("m." + u.first);
+        if (it != fieldSizes.end())
+            bytes += it->second;
+    }
+    return bytes;
+}
+
+unsigned DpdkCostReport::keyBytes(const IR::Key *key, bool copied) {
+    if (key == nullptr)
+        return 0;
+    unsigned bytes = 0;
+    for (auto k : key->keyElements) {
+        cstring name = k->expression->toString();
+        if (copied && !copiedFields.count(name))
+            continue;
+        auto it = fieldSizes.find(name);
+        if (it != fieldSizes.end())
+            bytes += it->second;
+    }
+    return bytes;
+}
+
+unsigned DpdkCostReport::worstPath(const IR::IndexedVector<IR::DpdkAsmStatement> &s,
+                                   bool *loops) {
+    std::map<cstring, size_t> labels;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (auto l = s.at(i)->to<IR::DpdkLabelStatement>())
+            labels.emplace(l->label, i);
+    }
+
+    // The worst number of instructions from each statement to the end of the
+    // apply block, which is computed once all its successors are
+    enum { New, InProgress, Done };
+    std::vector<unsigned> worst(s.size(), 0);
+    std::vector<int> state(s.size(), New);
+    std::function<unsigned(size_t)> cost;
+    auto jump = [&](cstring label) -> unsigned {
+        auto it = labels.find(label);
+        if (it == labels.end())
+            return applyEpilogue;  // LABEL_DROP
+        return cost(it->second);
+    };
+    cost = [&](size_t i) -> unsigned {
+        if (i == s.size())
+            return applyEpilogue;
+        if (state[i] == Done)
+            return worst[i];
+        if (state[i] == InProgress) {
+            *loops = true;
+            return 0;
+        }
+        state[i] = InProgress;
+        auto stmt = s.at(i);
+        unsigned self = 1;
+        unsigned next = 0;
+        if (stmt->is<IR::DpdkLabelStatement>()) {
+            self = 0;
+        } else if (auto a = stmt->to<IR::DpdkApplyStatement>()) {
+            auto it = tableCost.find(a->table);
+            if (it != tableCost.end())
+                self = it->second;
+        }
+        if (auto j = stmt->to<IR::DpdkJmpLabelStatement>())
+            next = jump(j->label);
+        else if (auto j = stmt->to<IR::DpdkJmpStatement>())
+            next = std::max(cost(i + 1), jump(j->label));
+        else if (!stmt->is<IR::DpdkDropStatement>() && !stmt->is<IR::DpdkReturnStatement>())
+            next = cost(i + 1);
+        state[i] = Done;
+        worst[i] = self + next;
+        return worst[i];
+    };
+    return applyPrologue + cost(0);
+}
+
+Util::JsonObject *DpdkCostReport::tableReport(cstring name, const IR::Key *key,
+                                              const IR::ActionList *actions) {
+    unsigned worst = 0;
+    for (auto a : actions->actionList) {
+        auto it = actionCost.find(a->getName());
+        if (it != actionCost.end())
+            worst = std::max(worst, it->second);
+    }
+    // The table lookup is one instruction, followed by the action
+    tableCost[name] = 1 + worst;
+    auto table = new Util::JsonObject();
+    table->emplace("name", name);
+    table->emplace("key_bytes", keyBytes(key, false));
+    table->emplace("key_bytes_copied", keyBytes(key, true));
+    table->emplace("worst_case_instructions", 1 + worst);
+    return table;
+}
+
+Util::JsonObject *DpdkCostReport::applyReport(const IR::DpdkListStatement *l) {
+    auto blocks = new Util::JsonArray();
+    IR::IndexedVector<IR::DpdkAsmStatement> block;
+    cstring label = l->name;
+    unsigned instructions = 0;
+    auto endBlock = [&]() {
+        if (block.empty())
+            return;
+        auto b = new Util::JsonObject();
+        b->emplace("label", label);
+        b->emplace("instructions", block.size());
+        b->emplace("metadata_bytes", metadataBytes(block));
+        blocks->append(b);
+        instructions += block.size();
+        block.clear();
+    };
+    for (auto s : l->statements) {
+        if (auto lbl = s->to<IR::DpdkLabelStatement>()) {
+            endBlock();
+            label = lbl->label;
+        } else {
+            block.push_back(s);
+        }
+    }
+    endBlock();
+
+    bool loops = false;
+    auto apply = new Util::JsonObject();
+    apply->emplace("name", l->name);
+    apply->emplace("instructions", applyPrologue + instructions + applyEpilogue);
+    apply->emplace("metadata_bytes", metadataBytes(l->statements));
+    apply->emplace("worst_case_instructions_per_packet", worstPath(l->statements, &loops));
+    apply->emplace("loops", loops);
+    apply->emplace("blocks", blocks);
+    return apply;
+}
+
+bool DpdkCostReport::preorder(const IR::DpdkAsmProgram *p) {
+    std::map<cstring, const IR::DpdkHeaderType *> headers;
+    for (auto h : p->headerType)
+        headers.emplace(h->name.name, h);
+    for (auto s : p->structType) {
+        bool metadata = s->getAnnotations()->getSingle("__metadata__") != nullptr;
+        for (auto f : s->fields) {
+            if (metadata) {
+                fieldSizes.emplace("m." + f->name.name, LayoutMetadataStruct::fieldSize(f));
+            } else if (auto t = f->type->to<IR::Type_Name>()) {
+                auto h = headers.find(t->path->name.name);
+                if (h == headers.end())
+                    continue;
+                for (auto hf : h->second->fields)
+                    fieldSizes.emplace("h." + f->name.name + "." + hf->name.name,
+                                       LayoutMetadataStruct::fieldSize(hf));
+            }
+        }
+    }
+
+    auto collectCopies = [this](const IR::IndexedVector<IR::DpdkAsmStatement> &s) {
+        for (auto i : s) {
+            auto mov = i->to<IR::DpdkMovStatement>();
+            if (mov && mov->src->toString().startsWith("h."))
+                copiedFields.insert(mov->dst->toString());
+        }
+    };
+    for (auto a : p->actions)
+        collectCopies(a->statements);
+    for (auto s : p->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>())
+            collectCopies(l->statements);
+    }
+
+    auto actions = new Util::JsonArray();
+    for (auto a : p->actions) {
+        unsigned instructions = 0;
+        for (auto s : a->statements) {
+            if (!s->is<IR::DpdkLabelStatement>())
+                instructions++;
+        }
+        actionCost.emplace(a->name.name, instructions);
+        auto action = new Util::JsonObject();
+        action->emplace("name", a->name.name);
+        action->emplace("instructions", instructions);
+        action->emplace("metadata_bytes", metadataBytes(a->statements));
+        actions->append(action);
+    }
+
+    auto tables = new Util::JsonArray();
+    for (auto t : p->tables)
+        tables->append(tableReport(t->name, t->match_keys, t->actions));
+    for (auto l : p->learners)
+        tables->append(tableReport(l->name, l->match_keys, l->actions));
+
+    auto applies = new Util::JsonArray();
+    for (auto s : p->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>())
+            applies->append(applyReport(l));
+    }
+
+    report = new Util::JsonObject();
+    report->emplace("actions", actions);
+    report->emplace("tables", tables);
+    report->emplace("apply", applies);
+    return false;
+}
+
+}  // namespace DPDK
@@ -0,0 +1,60 @@
+/*
+Copyright 2020 Intel Corp.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef BACKENDS_DPDK_DPDKCOSTREPORT_H_
+#define BACKENDS_DPDK_DPDKCOSTREPORT_H_
+
+#include "ir/ir.h"
+#include "lib/json.h"
+
+namespace DPDK {
+
+/* This pass reports in JSON the per packet cost of the instructions of a dpdk
+ * program:
+ * - for each action, its number of instructions and the bytes of metadata that
+ *   it touches;
+ * - for each table, the bytes of its key, the bytes of its metadata key fields
+ *   that the program copies from the headers, and the worst number of
+ *   instructions of an apply, i.e. the lookup and its longest action;
+ * - for the apply block, the number of instructions and the bytes of metadata
+ *   touched by each block of instructions starting at a label, which include the
+ *   parser states, and the worst number of instructions executed for a packet
+ *   along a path through the apply block, counting table applies as above.
+ * The back edges of the loops of the apply block, e.g. those parsing header
+ * stacks, are not followed, so the loops count once in the worst case.
+ */
+class DpdkCostReport : public Inspector {
+    // The size in bytes of the metadata and header fields, by operand name
+    std::map<cstring, unsigned> fieldSizes;
+    std::map<cstring, unsigned> actionCost;
+    std::map<cstring, unsigned> tableCost;
+    // The metadata fields that mov instructions copy from header fields
+    std::set<cstring> copiedFields;
+
+    unsigned metadataBytes(const IR::IndexedVector<IR::DpdkAsmStatement> &s);
+    unsigned keyBytes(const IR::Key *key, bool copied);
+    unsigned worstPath(const IR::IndexedVector<IR::DpdkAsmStatement> &s, bool *loops);
+    Util::JsonObject *tableReport(cstring name, const IR::Key *key,
+                                  const IR::ActionList *actions);
+    Util::JsonObject *applyReport(const IR::DpdkListStatement *l);
+
+  public:
+    Util::JsonObject *report = nullptr;
+    bool preorder(const IR::DpdkAsmProgram *p) override;
+};
+
+}  // namespace DPDK
+#endif  /* BACKENDS_DPDK_DPDKCOSTREPORT_H_ */
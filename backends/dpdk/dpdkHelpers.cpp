@@ -131,9 +131,15 @@ bool ConvertStatementToDpdk::preorder(const IR::AssignmentStatement *a) {
         if (auto e = mi->to<P4::ExternMethod>()) {
             if (e->originalExternType->getName().name == "Hash") {
                 if (e->expr->arguments->size() == 1) {
-                    auto field = (*e->expr->arguments)[0];
-                    i = new IR::DpdkGetHashStatement(e->object->getName(),
-                                                     field->expression, left);
+                    auto field = (*e->expr->arguments)[0]->expression;
+                    // EliminateTuples turns the field list into a struct expression
+                    if (auto s = field->to<IR::StructExpression>()) {
+                        IR::Vector<IR::Expression> components;
+                        for (auto c : s->components)
+                            components.push_back(c->expression);
+                        field = new IR::ListExpression(components);
+                    }
+                    i = new IR::DpdkGetHashStatement(e->object->getName(), field, left);
                 }
             } else if (e->originalExternType->getName().name ==
                        "InternetChecksum") {
@@ -357,6 +363,15 @@ bool BranchingInstructionGeneration::generate(const IR::Expression *expr,
                         true_label, leq->left, leq->right));
         }
         return is_and;
+    } else if (auto geq = expr->to<IR::Geq>()) {
+        if (is_and) {
+            instructions.push_back(new IR::DpdkJmpLessStatement(
+                        false_label, geq->left, geq->right));
+        } else {
+            instructions.push_back(new IR::DpdkJmpGreaterEqualStatement(
+                        true_label, geq->left, geq->right));
+        }
+        return is_and;
     } else if (auto mce = expr->to<IR::MethodCallExpression>()) {
         auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
         if (auto a = mi->to<P4::BuiltInMethod>()) {
@@ -386,10 +401,10 @@ bool BranchingInstructionGeneration::generate(const IR::Expression *expr,
             auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
             if (auto a = mi->to<P4::ApplyMethod>()) {
                 if (a->isTableApply()) {
+                    auto tbl = a->object->to<IR::P4Table>();
+                    instructions.push_back(
+                            new IR::DpdkApplyStatement(tbl->name.toString()));
                     if (mem->member == IR::Type_Table::hit) {
-                        auto tbl = a->object->to<IR::P4Table>();
-                        instructions.push_back(
-                                new IR::DpdkApplyStatement(tbl->name.toString()));
                         if (is_and) {
                             instructions.push_back(
                                     new IR::DpdkJmpMissStatement(false_label));
@@ -397,6 +412,16 @@ bool BranchingInstructionGeneration::generate(const IR::Expression *expr,
                             instructions.push_back(
                                     new IR::DpdkJmpHitStatement(true_label));
                         }
+                    } else if (mem->member == IR::Type_Table::miss) {
+                        if (is_and) {
+                            instructions.push_back(
+                                    new IR::DpdkJmpHitStatement(false_label));
+                        } else {
+                            instructions.push_back(
+                                    new IR::DpdkJmpMissStatement(true_label));
+                        }
+                    } else {
+                        BUG("%1%: not implemented.", expr);
                     }
                 } else {
                     BUG("%1%: not implemented.", expr);
@@ -414,8 +439,11 @@ bool BranchingInstructionGeneration::generate(const IR::Expression *expr,
         }
         return is_and;
     } else if (auto lnot = expr->to<IR::LNot>()) {
-        generate(lnot->expr, false_label, true_label, false);
-        return is_and;
+    /* The negation of a simple expression swaps the labels, and the
+     * condition that falls through for the expression is the opposite one
+     * for its negation.
+     */
+        return !generate(lnot->expr, false_label, true_label, !is_and);
     } else {
         BUG("%1%: not implemented", expr);
     }
@@ -617,6 +645,20 @@ bool ConvertStatementToDpdk::preorder(const IR::MethodCallStatement *s) {
             add_instr(new IR::DpdkJmpLabelStatement(
                         append_parser_name(parser, IR::ParserState::reject)));
             add_instr(new IR::DpdkLabelStatement(end_label));
+        } else if (a->method->name == "add_entry") {
+            // CopyLearnerActionArgs copied the action parameters to consecutive metadata fields
+            auto args = a->expr->arguments;
+            auto action = args->at(0)->expression->to<IR::StringLiteral>();
+            auto params = args->at(1)->expression->to<IR::ListExpression>();
+            BUG_CHECK(action != nullptr && params != nullptr,
+                      "%1%: action parameters not copied to metadata", s);
+            add_instr(new IR::DpdkLearnStatement(action->value, params));
+        } else if (a->method->name == "set_entry_expire_time") {
+            add_instr(new IR::DpdkRearmStatement(a->expr->arguments->at(0)->expression));
+        } else if (a->method->name == "restart_expire_timer") {
+            add_instr(new IR::DpdkRearmStatement());
+        } else if (a->method->name == "remove_entry") {
+            add_instr(new IR::DpdkForgetStatement());
         }
     } else if (auto a = mi->to<P4::BuiltInMethod>()) {
         if (a->name == "setValid") {
@@ -34,6 +34,10 @@ limitations under the License.
 #define TOSTR_DECLA(NAME) std::ostream &toStr(std::ostream &, IR::NAME *)
 
 namespace DPDK {
+/* The timeouts in seconds of the expire time profiles of the learner tables. The
+ * expire time profile id k selects the timeout at index k. */
+const unsigned learner_timeouts[] = { 60, 120, 180 };
+
 /* This class will generate a optimized jmp and label control flow.
  * Couple of examples here
  *
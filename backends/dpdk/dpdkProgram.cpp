@@ -125,7 +125,8 @@ const IR::DpdkAsmProgram *ConvertToDpdkProgram::create(IR::P4Program *prog) {
     auto ingress_deparser_converter =
         new ConvertToDpdkControl(refmap, typemap, structure, true);
     auto egress_deparser_converter =
-        new ConvertToDpdkControl(refmap, typemap, structure);
+        new ConvertToDpdkControl(refmap, typemap, structure, splitEgress,
+                                 "psa_egress_output_metadata_drop");
     for (auto kv : structure->deparsers) {
         if (kv.first == "IngressDeparser")
             kv.second->apply(*ingress_deparser_converter);
@@ -137,15 +138,22 @@ const IR::DpdkAsmProgram *ConvertToDpdkProgram::create(IR::P4Program *prog) {
             BUG("Unknown deparser block %s", kv.second->name);
     }
 
-    auto s = createListStatement(
-        "ingress", {ingress_parser_converter->getInstructions(),
-                    ingress_converter->getInstructions(),
-                    ingress_deparser_converter->getInstructions(),
-                    egress_parser_converter->getInstructions(),
-                    egress_converter->getInstructions(),
-                    egress_deparser_converter->getInstructions(),
-                    });
-    statements.push_back(s);
+    if (splitEgress) {
+        statements.push_back(createListStatement(
+            "ingress", {ingress_parser_converter->getInstructions(),
+                        ingress_converter->getInstructions(),
+                        ingress_deparser_converter->getInstructions(),
+                        }));
+    } else {
+        statements.push_back(createListStatement(
+            "ingress", {ingress_parser_converter->getInstructions(),
+                        ingress_converter->getInstructions(),
+                        ingress_deparser_converter->getInstructions(),
+                        egress_parser_converter->getInstructions(),
+                        egress_converter->getInstructions(),
+                        egress_deparser_converter->getInstructions(),
+                        }));
+    }
 
     IR::IndexedVector<IR::DpdkHeaderType> headerType;
     for (auto kv : structure->header_types) {
@@ -170,10 +178,26 @@ const IR::DpdkAsmProgram *ConvertToDpdkProgram::create(IR::P4Program *prog) {
         dpdkExternDecls.push_back(st);
     }
 
+    if (splitEgress) {
+        /* The egress pipeline receives the packets sent by the ingress deparser to an
+           egress port on the same port, and transmits them on it. It declares the same
+           types, and unused metadata fields are removed from each pipeline later */
+        IR::IndexedVector<IR::DpdkAsmStatement> egressStatements;
+        egressStatements.push_back(createListStatement(
+            "egress", {egress_parser_converter->getInstructions(),
+                       egress_converter->getInstructions(),
+                       egress_deparser_converter->getInstructions(),
+                       }));
+        egress_program = new IR::DpdkAsmProgram(
+            headerType, structType, dpdkExternDecls, egress_converter->getActions(),
+            egress_converter->getTables(), egress_converter->getSelectors(),
+            egress_converter->getLearners(), egressStatements, structure->get_globals());
+    }
+
     return new IR::DpdkAsmProgram(
         headerType, structType, dpdkExternDecls, ingress_converter->getActions(),
         ingress_converter->getTables(), ingress_converter->getSelectors(),
-        statements, structure->get_globals());
+        ingress_converter->getLearners(), statements, structure->get_globals());
 }
 
 const IR::Node *ConvertToDpdkProgram::preorder(IR::P4Program *prog) {
@@ -469,6 +493,11 @@ bool ConvertToDpdkControl::checkTableValid(const IR::P4Table *a) {
         }
 
         auto matchKind = key->matchType->toString();
+        if (matchKind != "exact" && isLearnerTable(a)) {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET, "Learner table %1% only supports "
+                    "'exact' match kind, found %2%", a->name.toString(), matchKind);
+            return false;
+        }
         if (matchKind == "lpm") {
             ++lpmCount;
         } else if (matchKind != "exact") {
@@ -549,6 +578,10 @@ bool ConvertToDpdkControl::preorder(const IR::P4Table *t) {
                 *n_groups_max, *n_members_per_group_max);
 
             selectors.push_back(selector);
+        } else if (isLearnerTable(t)) {
+            auto learner = new IR::DpdkLearner(t->name.toString(), t->getKey(),
+                    t->getActionList(), t->getDefaultAction(), t->properties);
+            learners.push_back(learner);
         } else {
             auto table = new IR::DpdkTable(t->name.toString(), t->getKey(), t->getActionList(),
                     t->getDefaultAction(), t->properties);
@@ -568,7 +601,7 @@ bool ConvertToDpdkControl::preorder(const IR::P4Control *c) {
     c->body->apply(*helper);
     if (deparser) {
         add_inst(new IR::DpdkJmpNotEqualStatement("LABEL_DROP",
-            new IR::Member(new IR::PathExpression("m"), "psa_ingress_output_metadata_drop"),
+            new IR::Member(new IR::PathExpression("m"), dropFlag),
             new IR::Constant(0))); }
 
     for (auto i : helper->get_instr()) {
@@ -40,12 +40,15 @@ class ConvertToDpdkProgram : public Transform {
     P4::TypeMap *typemap;
     P4::ReferenceMap *refmap;
     DpdkProgramStructure *structure;
+    // Emit the egress of a PSA program as a separate pipeline
+    bool splitEgress;
     const IR::DpdkAsmProgram *dpdk_program;
+    const IR::DpdkAsmProgram *egress_program = nullptr;
 
   public:
     ConvertToDpdkProgram(P4::ReferenceMap *refmap, P4::TypeMap *typemap,
-                         DpdkProgramStructure *structure)
-        : typemap(typemap), refmap(refmap), structure(structure) { }
+                         DpdkProgramStructure *structure, bool splitEgress = false)
+        : typemap(typemap), refmap(refmap), structure(structure), splitEgress(splitEgress) { }
 
     const IR::DpdkAsmProgram *create(IR::P4Program *prog);
     const IR::DpdkAsmStatement *createListStatement(
@@ -54,6 +57,8 @@ class ConvertToDpdkProgram : public Transform {
             statements);
     const IR::Node *preorder(IR::P4Program *p) override;
     const IR::DpdkAsmProgram *getDpdkProgram() { return dpdk_program; }
+    // The egress pipeline, or nullptr if the egress is part of the ingress pipeline
+    const IR::DpdkAsmProgram *getEgressProgram() { return egress_program; }
     IR::IndexedVector<IR::DpdkStructType> UpdateHeaderMetadata(
                       IR::P4Program *prog, IR::Type_Struct *metadata);
 };
@@ -95,19 +100,24 @@ class ConvertToDpdkControl : public Inspector {
     IR::IndexedVector<IR::DpdkAsmStatement> instructions;
     IR::IndexedVector<IR::DpdkTable> tables;
     IR::IndexedVector<IR::DpdkSelector> selectors;
+    IR::IndexedVector<IR::DpdkLearner> learners;
     IR::IndexedVector<IR::DpdkAction> actions;
     std::set<cstring> unique_actions;
     bool deparser;
+    // The metadata field checked by a deparser before it emits the packet
+    cstring dropFlag;
 
   public:
     ConvertToDpdkControl(
         P4::ReferenceMap *refmap, P4::TypeMap *typemap,
         DpdkProgramStructure *structure,
-        bool deparser = false)
-        : typemap(typemap), refmap(refmap), structure(structure), deparser(deparser) {}
+        bool deparser = false, cstring dropFlag = "psa_ingress_output_metadata_drop")
+        : typemap(typemap), refmap(refmap), structure(structure), deparser(deparser),
+          dropFlag(dropFlag) {}
 
     IR::IndexedVector<IR::DpdkTable> &getTables() { return tables; }
     IR::IndexedVector<IR::DpdkSelector> &getSelectors() { return selectors; }
+    IR::IndexedVector<IR::DpdkLearner> &getLearners() { return learners; }
     IR::IndexedVector<IR::DpdkAction> &getActions() { return actions; }
     IR::IndexedVector<IR::DpdkAsmStatement> &getInstructions() {
         return instructions;
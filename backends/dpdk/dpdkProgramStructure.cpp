@@ -193,7 +193,7 @@ void InspectDpdkProgram::addTypesAndInstances(const IR::Type_StructLike* type, b
             auto stack_type = stack->elementType->to<IR::Type_Header>();
             std::vector<unsigned> ids;
             for (unsigned i = 0; i < stack_size; i++) {
-                cstring hdrName = f->controlPlaneName() + "[" + Util::toString(i) + "]";
+                cstring hdrName = cstring::concat(f->controlPlaneName(), '[', i, ']');
                 addHeaderInstance(stack_type, hdrName);
             }
         } else {
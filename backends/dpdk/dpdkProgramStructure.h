@@ -1,6 +1,8 @@
 #ifndef BACKENDS_DPDK_PROGRAM_STRUCTURE_H_
 #define BACKENDS_DPDK_PROGRAM_STRUCTURE_H_
 
+#include <set>
+
 #include "ir/ir.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/typeMap.h"
@@ -35,6 +37,8 @@ struct DpdkProgramStructure {
 
     IR::Type_Struct * metadataStruct;
     cstring local_metadata_type;
+    // the fields of the local metadata that hold the local variables of the blocks
+    std::set<cstring> local_variable_fields;
     cstring header_type;
     IR::IndexedVector<IR::StructField> fields;
     IR::Vector<IR::Type> used_metadata;
@@ -83,7 +83,7 @@ int main(int argc, char *const argv[]) {
             return 1;
         }
         std::istream inJson(&fb);
-        JSONLoader jsonFileLoader(inJson);
+        JSONStreamLoader jsonFileLoader(inJson);
         if (jsonFileLoader.json == nullptr) {
             ::error("Not valid input file");
             return 1;
@@ -113,13 +113,15 @@ int main(int argc, char *const argv[]) {
 
     DPDK::DpdkMidEnd midEnd(options);
     midEnd.addDebugHook(hook);
+    if (options.profileMidendPasses)
+        midEnd.setProfile(&std::cerr);
     try {
         toplevel = midEnd.process(program);
         if (::errorCount() > 1 || toplevel == nullptr ||
             toplevel->getMain() == nullptr)
             return 1;
         if (options.dumpJsonFile)
-            JSONGenerator(*openFile(options.dumpJsonFile, true), true)
+            JSONGenerator(*openFile(options.dumpJsonFile, true), true, options.compactJson)
                 << program << std::endl;
     } catch (const std::exception &bug) {
         std::cerr << bug.what() << std::endl;
@@ -143,5 +145,21 @@ int main(int argc, char *const argv[]) {
         }
     }
 
+    if (!options.egressSpec.isNullOrEmpty()) {
+        std::ostream *out = openFile(options.egressSpec, false);
+        if (out != nullptr) {
+            backend->egressCodegen(*out);
+            out->flush();
+        }
+    }
+
+    if (!options.costReport.isNullOrEmpty()) {
+        std::ostream *out = openFile(options.costReport, false);
+        if (out != nullptr) {
+            backend->costReport(*out);
+            out->flush();
+        }
+    }
+
     return ::errorCount() > 0;
 }
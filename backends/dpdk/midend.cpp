@@ -38,8 +38,7 @@ limitations under the License.
 #include "midend/expandEmit.h"
 #include "midend/expandLookahead.h"
 #include "midend/fillEnumMap.h"
-#include "midend/flattenHeaders.h"
-#include "midend/flattenInterfaceStructs.h"
+#include "midend/flattenNestedTypes.h"
 #include "midend/local_copyprop.h"
 #include "midend/midEndLast.h"
 #include "midend/nestedStructs.h"
@@ -134,7 +133,8 @@ DpdkMidEnd::DpdkMidEnd(CompilerOptions &options,
         [=](cstring arch) -> Inspector* {
         if (arch == "pna") {
             return new P4::ValidateTableProperties({"pna_implementation",
-                    "pna_direct_counter", "pna_direct_meter", "pna_idle_timeout", "size"});
+                    "pna_direct_counter", "pna_direct_meter", "pna_idle_timeout", "size",
+                    "add_on_miss", "idle_timeout_with_auto_delete"});
         } else if (arch == "psa") {
             return new P4::ValidateTableProperties({"psa_implementation",
                     "psa_direct_counter", "psa_direct_meter", "psa_idle_timeout", "size"});
@@ -175,8 +175,7 @@ DpdkMidEnd::DpdkMidEnd(CompilerOptions &options,
             new P4::NestedStructs(&refMap, &typeMap),
             new P4::SimplifySelectList(&refMap, &typeMap),
             new P4::RemoveSelectBooleans(&refMap, &typeMap),
-            new P4::FlattenHeaders(&refMap, &typeMap),
-            new P4::FlattenInterfaceStructs(&refMap, &typeMap),
+            new P4::FlattenNestedTypes(&refMap, &typeMap),
             new P4::ParsersUnroll(true, &refMap, &typeMap),
             new P4::ReplaceSelectRange(&refMap, &typeMap),
             // DPDK architecture does not currently support predicated instructions
@@ -186,8 +185,8 @@ DpdkMidEnd::DpdkMidEnd(CompilerOptions &options,
             new P4::LocalCopyPropagation(&refMap, &typeMap, nullptr, policy),
             new P4::ConstantFolding(&refMap, &typeMap),
             new P4::MoveDeclarations(),
-            validateTableProperties(options.arch),
             new P4::SimplifyControlFlow(&refMap, &typeMap),
+            validateTableProperties(options.arch),
             new P4::CompileTimeOperations(),
             new P4::TableHit(&refMap, &typeMap),
             new P4::RemoveLeftSlices(&refMap, &typeMap),
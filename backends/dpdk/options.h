@@ -26,8 +26,21 @@ class DpdkOptions : public CompilerOptions {
     cstring bfRtSchema = "";
     // file to output to
     cstring outputFile = nullptr;
+    // file to write the per packet cost report to
+    cstring costReport = nullptr;
     // read from json
     bool loadIRFromJson = false;
+    // remove the redundant moves and dead temporaries from the instructions
+    bool optimizeInstructions = false;
+    // group the hot metadata fields in as few cache lines as possible
+    bool layoutMetadata = false;
+    // share the metadata fields of the local variables that are never live together
+    bool shareLocalMetadata = false;
+    // update the checksums of the extracted headers incrementally
+    bool incrementalChecksum = false;
+    // file to write the egress pipeline of a PSA program to, which is then not part of
+    // the ingress pipeline
+    cstring egressSpec = nullptr;
 
     DpdkOptions() {
         registerOption(
@@ -45,10 +58,38 @@ class DpdkOptions : public CompilerOptions {
         registerOption("-o", "outfile",
                 [this](const char* arg) { outputFile = arg; return true; },
                 "Write output to outfile");
+        registerOption("--cost-report", "file",
+                [this](const char* arg) { costReport = arg; return true; },
+                "Write a JSON report of the instructions and metadata bytes of each action,\n"
+                "table and block of the apply block, and of the worst case per packet");
         registerOption("--fromJSON", "file",
                 [this](const char* arg) { loadIRFromJson = true; file = arg; return true; },
                 "Use IR representation from JsonFile dumped previously,"\
                 "the compilation starts with reduced midEnd.");
+        registerOption("--optimize-instructions", nullptr,
+                [this](const char*) { optimizeInstructions = true; return true; },
+                "Inline the const default actions of the tables without key, reuse\n"
+                "the hashes already computed, forward copies, fold moves into the\n"
+                "operations that follow them and remove dead stores in the generated\n"
+                "instructions");
+        registerOption("--layout-metadata", nullptr,
+                [this](const char*) { layoutMetadata = true; return true; },
+                "Order the metadata fields by table key and number of uses and\n"
+                "remove the unused ones, to fit the hot fields in few cache lines");
+        registerOption("--share-local-metadata", nullptr,
+                [this](const char*) { shareLocalMetadata = true; return true; },
+                "Hold the local variables and temporaries that are never live at the\n"
+                "same time in the same metadata field");
+        registerOption("--incremental-checksum", nullptr,
+                [this](const char*) { incrementalChecksum = true; return true; },
+                "Update the checksums recomputed from the fields of an extracted header\n"
+                "by subtracting the old values of the modified fields and adding the new ones");
+        registerOption("--egress-spec", "file",
+                [this](const char* arg) { egressSpec = arg; return true; },
+                "Write the egress of a PSA program to file as a separate pipeline, which\n"
+                "receives on each port the packets that the ingress pipeline sends to it,\n"
+                "so that ingress and egress can run on different cores connected by a\n"
+                "ring per port");
     }
 
     /// Process the command line arguments and set options accordingly.
@@ -46,6 +46,7 @@ class Options(object):
         self.runDebugger_skip = 0
         self.generateP4Runtime = False
         self.generateBfRt = False
+        self.generateEgressSpec = False
 
 def usage(options):
     name = options.binary
@@ -60,6 +61,7 @@ def usage(options):
     print("          -a \"args\": pass args to the compiler")
     print("          --p4runtime: generate P4Info message in text format")
     print("          --bfrt: generate BfRt message in text format")
+    print("          --egress-spec: emit the PSA egress as a separate pipeline")
 
 def isError(p4filename):
     # True if the filename represents a p4 program that should fail
@@ -192,6 +194,7 @@ def process_file(options, argv):
     p4runtimeFile = os.path.join(tmpdir, basename + ".p4info.txt")
     p4runtimeEntriesFile = os.path.join(tmpdir, basename + ".entries.txt")
     bfRtSchemaFile = os.path.join(tmpdir, basename + ".bfrt.json")
+    egressSpec = os.path.join(tmpdir, basename + ".egress.spec")
     def getArch(path):
         v1Pattern = re.compile('include.*v1model\.p4')
         psaPattern = re.compile('include.*psa\.p4')
@@ -209,6 +212,8 @@ def process_file(options, argv):
     if not os.path.isfile(options.p4filename):
         raise Exception("No such file " + options.p4filename)
     args = ["./p4c-dpdk", "--dump", tmpdir, "-o", spec] + options.compilerOptions
+    if options.generateEgressSpec:
+        args.extend(["--egress-spec", egressSpec])
     arch = getArch(options.p4filename)
     if arch is not None:
         args.extend(["--arch", arch])
@@ -300,6 +305,8 @@ def main(argv):
             options.generateP4Runtime = True
         elif argv[0] == "--bfrt":
             options.generateBfRt = True
+        elif argv[0] == "--egress-spec":
+            options.generateEgressSpec = True
         else:
             print("Unknown option ", argv[0], file=sys.stderr)
             usage(options)
@@ -137,6 +137,9 @@ std::ostream &IR::DpdkAsmProgram::toSpec(std::ostream &out) const {
     for (auto s : selectors) {
         s->toSpec(out) << std::endl;
     }
+    for (auto l : learners) {
+        l->toSpec(out) << std::endl;
+    }
     for (auto s : statements) {
         s->toSpec(out) << std::endl;
     }
@@ -282,15 +285,15 @@ std::ostream &IR::DpdkStructType::toSpec(std::ostream &out) const {
 
 std::ostream &IR::DpdkListStatement::toSpec(std::ostream &out) const {
     out << "apply {" << std::endl;
-    out << "\trx m.psa_ingress_input_metadata_ingress_port" << std::endl;
-    out << "\tmov m.psa_ingress_output_metadata_drop 0x0" << std::endl;
+    out << "\trx m." << inputPort() << std::endl;
+    out << "\tmov m." << dropFlag() << " 0x0" << std::endl;
     for (auto s : statements) {
         out << "\t";
         s->toSpec(out);
         if (!s->to<IR::DpdkLabelStatement>())
             out << std::endl;
     }
-    out << "\ttx m.psa_ingress_output_metadata_egress_port" << std::endl;
+    out << "\ttx m." << outputPort() << std::endl;
     out << "\tLABEL_DROP : drop" << std::endl;
     out << "}" << std::endl;
     return out;
@@ -413,6 +416,44 @@ std::ostream &IR::DpdkTable::toSpec(std::ostream &out) const {
     return out;
 }
 
+std::ostream &IR::DpdkLearner::toSpec(std::ostream &out) const {
+    out << "learner " << name << " {" << std::endl;
+    if (match_keys) {
+        // The keys of learner tables are all exact
+        out << "\tkey {" << std::endl;
+        for (auto key : match_keys->keyElements) {
+            out << "\t\t" << DPDK::toStr(key->expression) << std::endl;
+        }
+        out << "\t}" << std::endl;
+    }
+    out << "\tactions {" << std::endl;
+    for (auto action : actions->actionList) {
+        out << "\t\t" << DPDK::toStr(action->expression) << std::endl;
+    }
+    out << "\t}" << std::endl;
+
+    out << "\tdefault_action " << DPDK::toStr(default_action);
+    if (default_action->to<IR::MethodCallExpression>()->arguments->size() ==
+        0) {
+        out << " args none ";
+    } else {
+        BUG("non-zero default action arguments not supported yet");
+    }
+    out << std::endl;
+    if (auto size = properties->getProperty("size")) {
+        out << "\tsize " << DPDK::toStr(size->value) << "" << std::endl;
+    } else {
+        out << "\tsize 0x10000" << std::endl;
+    }
+    // The expire time profiles, in seconds, selected by the learn and rearm instructions
+    out << "\ttimeout {" << std::endl;
+    for (auto timeout : DPDK::learner_timeouts)
+        out << "\t\t" << timeout << std::endl;
+    out << "\t}" << std::endl;
+    out << "}" << std::endl;
+    return out;
+}
+
 std::ostream &IR::DpdkSelector::toSpec(std::ostream &out) const {
     out << "selector " << name << " {" << std::endl;
     out << "\tgroup_id " << group_id << std::endl;
@@ -562,3 +603,23 @@ std::ostream& IR::DpdkDropStatement::toSpec(std::ostream& out) const {
     return out;
 }
 
+std::ostream& IR::DpdkLearnStatement::toSpec(std::ostream& out) const {
+    out << "learn " << action;
+    // The other arguments follow the first one in the metadata
+    if (!args->components.empty())
+        out << " " << DPDK::toStr(args->components.at(0));
+    return out;
+}
+
+std::ostream& IR::DpdkRearmStatement::toSpec(std::ostream& out) const {
+    out << "rearm";
+    if (timeout)
+        out << " " << DPDK::toStr(timeout);
+    return out;
+}
+
+std::ostream& IR::DpdkForgetStatement::toSpec(std::ostream& out) const {
+    out << "forget";
+    return out;
+}
+
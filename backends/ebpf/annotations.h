@@ -0,0 +1,20 @@
+#ifndef _BACKENDS_EBPF_ANNOTATIONS_H_
+#define _BACKENDS_EBPF_ANNOTATIONS_H_
+
+#include "ir/ir.h"
+#include "frontends/p4/parseAnnotations.h"
+
+namespace EBPF {
+
+/// Parses the standard annotations and the eBPF-specific ones.
+class ParseAnnotations : public P4::ParseAnnotations {
+ public:
+    ParseAnnotations() : P4::ParseAnnotations("EBPF", true, {
+                PARSE("flow_cache", Constant),
+                PARSE_CONSTANT_LIST("dir_24_8")
+            }) { }
+};
+
+}  // namespace EBPF
+
+#endif /* _BACKENDS_EBPF_ANNOTATIONS_H_ */
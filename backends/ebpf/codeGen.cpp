@@ -215,7 +215,7 @@ bool CodeGenInspector::preorder(const IR::PathExpression* expression) {
 bool CodeGenInspector::preorder(const IR::Path* p) {
     if (p->absolute)
         ::error(ErrorType::ERR_EXPECTED, "%1%: Unexpected absolute path", p);
-    builder->append(p->name);
+    builder->appendName(p->name);
     return false;
 }
 
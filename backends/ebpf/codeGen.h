@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef _BACKENDS_EBPF_CODEGEN_H_
 #define _BACKENDS_EBPF_CODEGEN_H_
 
+#include <set>
+
 #include "ir/ir.h"
 #include "lib/sourceCodeBuilder.h"
 #include "target.h"
@@ -33,7 +35,17 @@ namespace EBPF {
 class CodeBuilder : public Util::SourceCodeBuilder {
  public:
     const Target* target;
+    // The variables that are pointers to the values the P4 program refers to by their
+    // names, such as the headers in a per-CPU map.
+    std::set<cstring> pointers;
     explicit CodeBuilder(const Target* target) : target(target) {}
+    /// Appends the name of a P4 variable, dereferenced if it is a pointer.
+    void appendName(cstring name) {
+        if (pointers.count(name))
+            appendFormat("(*%s)", name.c_str());
+        else
+            append(name);
+    }
 };
 
 // Visitor for generating C for EBPF
@@ -0,0 +1,143 @@
+#include "codeReport.h"
+
+#include <algorithm>
+
+#include "frontends/p4/coreLibrary.h"
+#include "frontends/p4/methodInstance.h"
+
+namespace EBPF {
+
+unsigned CodeReport::statements(const IR::Node* node) const {
+    unsigned count = 0;
+    forAllMatching<IR::Statement>(node, [&](const IR::Statement* statement) {
+        if (!statement->is<IR::BlockStatement>() && !statement->is<IR::EmptyStatement>())
+            count++;
+    });
+    return count;
+}
+
+unsigned CodeReport::lookups(const IR::Node* node) const {
+    if (node == nullptr)
+        return 0;
+    if (auto block = node->to<IR::BlockStatement>()) {
+        unsigned count = 0;
+        for (auto component : block->components)
+            count += lookups(component);
+        return count;
+    }
+    if (auto statement = node->to<IR::IfStatement>())
+        return lookups(statement->condition) +
+               std::max(lookups(statement->ifTrue), lookups(statement->ifFalse));
+    if (auto statement = node->to<IR::SwitchStatement>()) {
+        unsigned worst = 0;
+        for (auto c : statement->cases)
+            worst = std::max(worst, lookups(c->statement));
+        return lookups(statement->expression) + worst;
+    }
+
+    unsigned count = 0;
+    forAllMatching<IR::MethodCallExpression>(node, [&](const IR::MethodCallExpression* call) {
+        auto mi = P4::MethodInstance::resolve(call, refMap, typeMap);
+        if (auto apply = mi->to<P4::ApplyMethod>()) {
+            if (apply->isTableApply())
+                count += lookups(apply->object->to<IR::P4Table>());
+        } else if (mi->is<P4::ExternMethod>()) {
+            // The objects of the eBPF and uBPF models are maps
+            count++;
+        } else if (auto action = mi->to<P4::ActionCall>()) {
+            count += lookups(action->action);
+        }
+    });
+    return count;
+}
+
+unsigned CodeReport::lookups(const IR::P4Table* table) const {
+    unsigned worst = 0;
+    if (auto actions = table->getActionList()) {
+        for (auto element : actions->actionList) {
+            auto decl = refMap->getDeclaration(element->getPath(), true);
+            if (auto action = decl->to<IR::P4Action>())
+                worst = std::max(worst, lookups(action));
+        }
+    }
+    return 1 + worst;
+}
+
+unsigned CodeReport::lookups(const IR::P4Action* action) const {
+    return lookups(action->body);
+}
+
+unsigned CodeReport::extractedBytes(const IR::ParserState* state,
+                                    std::set<const IR::ParserState*>& path) const {
+    unsigned bits = 0;
+    forAllMatching<IR::MethodCallExpression>(&state->components,
+                                             [&](const IR::MethodCallExpression* call) {
+        auto mi = P4::MethodInstance::resolve(call, refMap, typeMap);
+        auto em = mi->to<P4::ExternMethod>();
+        auto& extract = P4::P4CoreLibrary::instance().packetIn.extract;
+        if (em == nullptr || em->method->name != extract.name)
+            return;
+        auto type = typeMap->getType(call->arguments->at(0)->expression, true);
+        bits += type->width_bits();
+    });
+
+    std::vector<const IR::PathExpression*> next;
+    if (auto select = state->selectExpression) {
+        if (auto target = select->to<IR::PathExpression>())
+            next.push_back(target);
+        else if (auto cases = select->to<IR::SelectExpression>())
+            for (auto c : cases->selectCases)
+                next.push_back(c->state);
+    }
+    unsigned worst = 0;
+    path.insert(state);
+    for (auto target : next) {
+        auto decl = refMap->getDeclaration(target->path, true);
+        auto successor = decl->to<IR::ParserState>();
+        if (successor != nullptr && !path.count(successor))
+            worst = std::max(worst, extractedBytes(successor, path));
+    }
+    path.erase(state);
+    return (bits + 7) / 8 + worst;
+}
+
+bool CodeReport::preorder(const IR::P4Parser* parser) {
+    out << "parser " << parser->name << " " << parser->srcInfo.toPositionString() << std::endl;
+    out << "  states: " << parser->states.size() << std::endl;
+    out << "  statements: " << statements(&parser->states) << std::endl;
+    unsigned bytes = 0;
+    if (auto start = parser->states.getDeclaration<IR::ParserState>(IR::ParserState::start)) {
+        std::set<const IR::ParserState*> path;
+        bytes = extractedBytes(start, path);
+    }
+    out << "  worst-case bytes extracted: " << bytes << std::endl;
+    return false;
+}
+
+void CodeReport::reportAction(const IR::P4Action* action) {
+    out << "  action " << action->name << " "
+        << action->srcInfo.toPositionString() << ": " << statements(action->body)
+        << " statements, " << lookups(action) << " map accesses" << std::endl;
+}
+
+bool CodeReport::preorder(const IR::P4Control* control) {
+    out << "control " << control->name << " " << control->srcInfo.toPositionString()
+        << std::endl;
+    out << "  statements: " << statements(control->body) << std::endl;
+    out << "  worst-case map accesses: " << lookups(control->body) << std::endl;
+    for (auto decl : control->controlLocals) {
+        if (auto table = decl->to<IR::P4Table>()) {
+            auto key = table->getKey();
+            auto actions = table->getActionList();
+            out << "  table " << table->name << " " << table->srcInfo.toPositionString() << ": "
+                << (key ? key->keyElements.size() : 0) << " key fields, "
+                << (actions ? actions->size() : 0) << " actions, "
+                << lookups(table) << " worst-case map accesses" << std::endl;
+        } else if (auto action = decl->to<IR::P4Action>()) {
+            reportAction(action);
+        }
+    }
+    return false;
+}
+
+}  // namespace EBPF
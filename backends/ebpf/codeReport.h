@@ -0,0 +1,53 @@
+#ifndef _BACKENDS_EBPF_CODEREPORT_H_
+#define _BACKENDS_EBPF_CODEREPORT_H_
+
+#include <set>
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeMap.h"
+
+namespace EBPF {
+
+/**
+ * Writes a report of the size and of the worst-case costs of the parsers, controls,
+ * tables and actions of a program, to find the P4 constructs that make the generated
+ * programs hit the limits of the verifier.  For each construct the report gives its
+ * source position, the number of statements, and the maximum number of map accesses
+ * along a path of a packet: each table application is one lookup, followed by the
+ * accesses of its most expensive action, and each extern method call accesses a map.
+ * For parsers, it gives the maximum number of bytes extracted along a path that does
+ * not loop.
+ *
+ * The statements are counted on the IR that the code generator translates, so that
+ * they are proportional to the C statements emitted for the construct.
+ */
+class CodeReport : public Inspector {
+    P4::ReferenceMap*   refMap;
+    P4::TypeMap*        typeMap;
+    std::ostream&       out;
+
+    unsigned statements(const IR::Node* node) const;
+    /// The maximum number of map accesses along a path through @node.
+    unsigned lookups(const IR::Node* node) const;
+    unsigned lookups(const IR::P4Table* table) const;
+    unsigned lookups(const IR::P4Action* action) const;
+    /// The maximum number of bytes extracted from @state to the end of the parser,
+    /// ignoring the transitions to the states in @path.
+    unsigned extractedBytes(const IR::ParserState* state,
+                            std::set<const IR::ParserState*>& path) const;
+    void reportAction(const IR::P4Action* action);
+
+ public:
+    CodeReport(P4::ReferenceMap* refMap, P4::TypeMap* typeMap, std::ostream& out) :
+            refMap(refMap), typeMap(typeMap), out(out) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap);
+        setName("CodeReport");
+    }
+    bool preorder(const IR::P4Parser* parser) override;
+    bool preorder(const IR::P4Control* control) override;
+};
+
+}  // namespace EBPF
+
+#endif /* _BACKENDS_EBPF_CODEREPORT_H_ */
@@ -22,6 +22,7 @@ limitations under the License.
 #include "target.h"
 #include "ebpfType.h"
 #include "ebpfProgram.h"
+#include "codeReport.h"
 
 namespace EBPF {
 
@@ -45,9 +46,12 @@ void run_ebpf_backend(const EbpfOptions& options, const IR::ToplevelBlock* tople
         target = new BccTarget();
     } else if (options.target == "test") {
         target = new TestTarget();
+    } else if (options.target == "xdp") {
+        target = new XdpTarget();
     } else {
         ::error(ErrorType::ERR_UNKNOWN,
-                "Unknown target %s; legal choices are 'bcc', 'kernel', and test", options.target);
+                "Unknown target %s; legal choices are 'bcc', 'kernel', 'xdp', and test",
+                options.target);
         return;
     }
 
@@ -59,6 +63,14 @@ void run_ebpf_backend(const EbpfOptions& options, const IR::ToplevelBlock* tople
     if (!ebpfprog->build())
         return;
 
+    if (!options.reportFile.isNullOrEmpty()) {
+        auto rstream = openFile(options.reportFile, false);
+        if (rstream == nullptr)
+            return;
+        toplevel->getProgram()->apply(CodeReport(refMap, typeMap, *rstream));
+        rstream->flush();
+    }
+
     if (options.outputFile.isNullOrEmpty())
         return;
 
@@ -77,10 +89,12 @@ void run_ebpf_backend(const EbpfOptions& options, const IR::ToplevelBlock* tople
     if (hstream == nullptr)
         return;
 
+    c.setOutput(cstream);
+    h.setOutput(hstream);
     ebpfprog->emitH(&h, hfile);
     ebpfprog->emitC(&c, hfile);
-    *cstream << c.toString();
-    *hstream << h.toString();
+    c.flush();
+    h.flush();
     cstream->flush();
     hstream->flush();
 }
@@ -27,7 +27,7 @@ namespace EBPF {
 
 ControlBodyTranslator::ControlBodyTranslator(const EBPFControl* control) :
         CodeGenInspector(control->program->refMap, control->program->typeMap), control(control),
-        p4lib(P4::P4CoreLibrary::instance)
+        p4lib(P4::P4CoreLibrary::instance())
 { setName("ControlBodyTranslator"); }
 
 bool ControlBodyTranslator::preorder(const IR::PathExpression* expression) {
@@ -38,11 +38,11 @@ bool ControlBodyTranslator::preorder(const IR::PathExpression* expression) {
             builder->append("*");
         auto subst = ::get(substitution, param);
         if (subst != nullptr) {
-            builder->append(subst->name);
+            builder->appendName(subst->name);
             return false;
         }
     }
-    builder->append(expression->path->name);  // each identifier should be unique
+    builder->appendName(expression->path->name);  // each identifier should be unique
     return false;
 }
 
@@ -271,13 +271,19 @@ void ControlBodyTranslator::processMethod(const P4::ExternMethod* method) {
     auto decl = method->object;
     auto declType = method->originalExternType;
 
-    if (declType->name.name == EBPFModel::instance.counterArray.name) {
+    if (declType->name.name == EBPFModel::instance().counterArray.name) {
         builder->blockStart();
         cstring name = EBPFObject::externalName(decl);
         auto counterMap = control->getCounter(name);
         counterMap->emitMethodInvocation(builder, method);
         builder->blockEnd(true);
         return;
+    } else if (declType->name.name == EBPFModel::instance().digest.name) {
+        builder->blockStart();
+        auto digest = control->getDigest(EBPFObject::externalName(decl));
+        digest->emitMethodInvocation(builder, method);
+        builder->blockEnd(true);
+        return;
     } else if (declType->name.name == p4lib.packetOut.name) {
         if (method->method->name.name == p4lib.packetOut.emit.name) {
             compileEmit(method->expr->arguments);
@@ -325,9 +331,7 @@ void ControlBodyTranslator::processApply(const P4::ApplyMethod* method) {
     if (table->keyGenerator != nullptr) {
         builder->emitIndent();
         builder->appendLine("/* perform lookup */");
-        builder->emitIndent();
-        builder->target->emitTableLookup(builder, table->dataMapName, keyname, valueName);
-        builder->endOfStatement(true);
+        table->emitLookup(builder, keyname, valueName);
     }
 
     builder->emitIndent();
@@ -421,6 +425,38 @@ bool ControlBodyTranslator::preorder(const IR::IfStatement* statement) {
 }
 
 bool ControlBodyTranslator::preorder(const IR::SwitchStatement* statement) {
+    auto type = control->program->typeMap->getType(statement->expression, true);
+    if (!type->is<IR::Type_ActionEnum>()) {
+        // A switch on a scalar value; the C compiler
+        // generates a jump table when the labels are dense.
+        widthCheck(statement->expression);
+        builder->append("switch (");
+        visit(statement->expression);
+        builder->append(") ");
+        builder->blockStart();
+        for (auto c : statement->cases) {
+            builder->emitIndent();
+            if (c->label->is<IR::DefaultExpression>()) {
+                builder->append("default");
+            } else {
+                builder->append("case ");
+                visit(c->label);
+            }
+            builder->append(":");
+            builder->newline();
+            if (c->statement == nullptr)
+                // fall through to the next case
+                continue;
+            builder->emitIndent();
+            visit(c->statement);
+            builder->newline();
+            builder->emitIndent();
+            builder->appendLine("break;");
+        }
+        builder->blockEnd(false);
+        return false;
+    }
+
     cstring newName = control->program->refMap->newName("action_run");
     saveAction.push_back(newName);
     // This must be a table.apply().action_run
@@ -483,8 +519,12 @@ void EBPFControl::scanConstants() {
             if (node->is<IR::Declaration_Instance>()) {
                 auto di = node->to<IR::Declaration_Instance>();
                 cstring name = EBPFObject::externalName(di);
-                auto ctr = new EBPFCounterTable(program, ctrblk, name, codeGen);
-                counters.emplace(name, ctr);
+                if (ctrblk->type->name.name == program->model.digest.name) {
+                    digests.emplace(name, new EBPFDigest(program, ctrblk, name, codeGen));
+                } else {
+                    auto ctr = new EBPFCounterTable(program, ctrblk, name, codeGen);
+                    counters.emplace(name, ctr);
+                }
             }
         } else {
             ::error(ErrorType::ERR_UNEXPECTED,
@@ -550,6 +590,8 @@ void EBPFControl::emitTableTypes(CodeBuilder* builder) {
         it.second->emitTypes(builder);
     for (auto it : counters)
         it.second->emitTypes(builder);
+    for (auto it : digests)
+        it.second->emitTypes(builder);
 }
 
 void EBPFControl::emitTableInstances(CodeBuilder* builder) {
@@ -557,11 +599,44 @@ void EBPFControl::emitTableInstances(CodeBuilder* builder) {
         it.second->emitInstance(builder);
     for (auto it : counters)
         it.second->emitInstance(builder);
+    for (auto it : digests)
+        it.second->emitInstance(builder);
 }
 
 void EBPFControl::emitTableInitializers(CodeBuilder* builder) {
-    for (auto it : tables)
+    for (auto it : tables) {
         it.second->emitInitializer(builder);
+        if (it.second->cacheSize > 0) {
+            builder->emitIndent();
+            builder->appendFormat("if (%s_invalidate_cache() != 0) { "
+                                  "perror(\"Could not invalidate the cache of %s\"); exit(1); }",
+                                  it.second->instanceName.c_str(),
+                                  it.second->instanceName.c_str());
+            builder->newline();
+        }
+    }
+}
+
+void EBPFControl::emitCacheInvalidations(CodeBuilder* builder) {
+    for (auto it : tables)
+        it.second->emitCacheInvalidation(builder);
+}
+
+void EBPFControl::emitTableWriters(CodeBuilder* builder) {
+    for (auto it : tables) {
+        it.second->emitWriter(builder);
+        it.second->emitDeleter(builder);
+    }
+}
+
+void EBPFControl::emitCounterReaders(CodeBuilder* builder) {
+    for (auto it : counters)
+        it.second->emitReader(builder);
+}
+
+void EBPFControl::emitDigestReaders(CodeBuilder* builder) {
+    for (auto it : digests)
+        it.second->emitReader(builder);
 }
 
 }  // namespace EBPF
@@ -66,6 +66,7 @@ class EBPFControl : public EBPFObject {
     std::set<const IR::Parameter*> toDereference;
     std::map<cstring, EBPFTable*>  tables;
     std::map<cstring, EBPFCounterTable*>  counters;
+    std::map<cstring, EBPFDigest*>  digests;
 
     EBPFControl(const EBPFProgram* program, const IR::ControlBlock* block,
                 const IR::Parameter* parserHeaders);
@@ -73,6 +74,10 @@ class EBPFControl : public EBPFObject {
     void emitDeclaration(CodeBuilder* builder, const IR::Declaration* decl);
     void emitTableTypes(CodeBuilder* builder);
     void emitTableInitializers(CodeBuilder* builder);
+    void emitCounterReaders(CodeBuilder* builder);
+    void emitDigestReaders(CodeBuilder* builder);
+    void emitCacheInvalidations(CodeBuilder* builder);
+    void emitTableWriters(CodeBuilder* builder);
     void emitTableInstances(CodeBuilder* builder);
     virtual bool build();
     EBPFTable* getTable(cstring name) const {
@@ -83,6 +88,10 @@ class EBPFControl : public EBPFObject {
         auto result = ::get(counters, name);
         BUG_CHECK(result != nullptr, "No counter named %1%", name);
         return result; }
+    EBPFDigest* getDigest(cstring name) const {
+        auto result = ::get(digests, name);
+        BUG_CHECK(result != nullptr, "No digest named %1%", name);
+        return result; }
 
  protected:
     void scanConstants();
@@ -16,9 +16,16 @@ limitations under the License.
 
 #include "ebpfModel.h"
 
+#include "lib/startup_profile.h"
+
 namespace EBPF {
 
 cstring EBPFModel::reservedPrefix = "ebpf_";
-EBPFModel EBPFModel::instance;
+
+EBPFModel &EBPFModel::instance() {
+    static EBPFModel *rv = Util::StartupProfile::time("EBPFModel", [] {
+        return new EBPFModel; });
+    return *rv;
+}
 
 }  // namespace EBPF
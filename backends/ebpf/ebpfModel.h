@@ -41,6 +41,12 @@ struct CounterArray_Model : public ::Model::Extern_Model {
     ::Model::Elem sparse;
 };
 
+struct Digest_Model : public ::Model::Extern_Model {
+    Digest_Model() : Extern_Model("Digest"), pack("pack"), size("size") {}
+    ::Model::Elem pack;
+    ::Model::Elem size;
+};
+
 struct Filter_Model : public ::Model::Elem {
     Filter_Model() : Elem("ebpf_filter"),
                      parser("prs"), filter("filt") {}
@@ -51,20 +57,22 @@ struct Filter_Model : public ::Model::Elem {
 // Keep this in sync with ebpf_model.p4
 class EBPFModel : public ::Model::Model {
  protected:
-    EBPFModel() : counterArray(),
+    EBPFModel() : counterArray(), digest(),
                   array_table("array_table"),
                   hash_table("hash_table"),
                   tableImplProperty("implementation"),
                   CPacketName("skb"),
-                  packet("packet", P4::P4CoreLibrary::instance.packetIn, 0),
+                  packet("packet", P4::P4CoreLibrary::instance().packetIn, 0),
                   filter(), counterIndexType("u32"), counterValueType("u32")
     {}
 
  public:
-    static EBPFModel instance;
+    /// created on first use, to keep it out of the startup of the compiler
+    static EBPFModel &instance();
     static cstring reservedPrefix;
 
     CounterArray_Model     counterArray;
+    Digest_Model           digest;
     TableImpl_Model        array_table;
     TableImpl_Model        hash_table;
     ::Model::Elem          tableImplProperty;
@@ -23,4 +23,38 @@ EbpfOptions::EbpfOptions() {
         registerOption("--emit-externs", nullptr,
                 [this](const char*) { emitExterns = true; return true; },
                 "[ebpf back-end] Allow for user-provided implementation of extern functions.");
+        registerOption("--max-dense-key-bits", "bits",
+                [this](const char* arg) {
+                    auto bits = strtoul(arg, nullptr, 10);
+                    if (bits > 24) {
+                        ::error(ErrorType::ERR_INVALID, "%1%: at most 24 bits", arg);
+                        return false;
+                    }
+                    maxDenseKeyBits = bits;
+                    return true; },
+                "[ebpf back-end] Implement the exact-match tables whose key has at most\n"
+                "this many bits (default 16, 0 to disable) as arrays indexed by the key.");
+        registerOption("--tail-calls", nullptr,
+                [this](const char*) { tailCalls = true; return true; },
+                "[ebpf back-end] Run the parser and the control in separate programs, the\n"
+                "parser passing the headers in a per-CPU map and ending with a tail call,\n"
+                "so that each program stays within the limits of the verifier.");
+        registerOption("--scratch-headers", nullptr,
+                [this](const char*) { scratchHeaders = true; return true; },
+                "[ebpf back-end] Keep the headers in a per-CPU map instead of on the stack,\n"
+                "resetting for each packet only the validity bits and the other fields\n"
+                "that the program may read.");
+        registerOption("--direct-access", nullptr,
+                [this](const char*) { directAccess = true; return true; },
+                "[ubpf back-end] Write the register elements that the control read before\n"
+                "through the pointer returned by the lookup, instead of calling the helper\n"
+                "that updates the map. The host must return pointers to the map values.");
+        registerOption("--emit-report", "file",
+                [this](const char* arg) { reportFile = arg; return true; },
+                "[ebpf back-end] Write to file the size and the worst-case map accesses\n"
+                "of the parsers, controls, tables and actions, with their source positions.");
+        registerOption("--emit-batch", nullptr,
+                [this](const char*) { emitBatch = true; return true; },
+                "[ubpf back-end] Also emit a process_batch function that runs the program\n"
+                "on a vector of packets.");
 }
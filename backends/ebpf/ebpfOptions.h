@@ -29,6 +29,18 @@ class EbpfOptions : public CompilerOptions {
     bool loadIRFromJson = false;
     // Externs generation
     bool emitExterns = false;
+    // exact-match tables with keys of at most this many bits are arrays
+    unsigned maxDenseKeyBits = 16;
+    // run the control in a separate program reached by a tail call
+    bool tailCalls = false;
+    // keep the headers in a per-CPU map instead of on the stack
+    bool scratchHeaders = false;
+    // uBPF: write the register elements read before through the pointer to their value
+    bool directAccess = false;
+    // uBPF: emit an entry point that processes a batch of packets
+    bool emitBatch = false;
+    // file to write the code size report to
+    cstring reportFile = nullptr;
     EbpfOptions();
 };
 
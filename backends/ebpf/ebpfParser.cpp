@@ -29,16 +29,25 @@ class StateTranslationVisitor : public CodeGenInspector {
 
     P4::P4CoreLibrary& p4lib;
     const EBPFParserState* state;
+    // the extracts covered by the length check at the start of the state
+    std::set<const IR::MethodCallExpression*> checkedExtracts;
 
     void compileExtractField(const IR::Expression* expr, cstring name,
                              unsigned alignment, EBPFType* type);
-    void compileExtract(const IR::Expression* destination);
+    void compileExtractFields(const IR::Expression* expr,
+                              const std::vector<std::pair<cstring, EBPFType*>>& fields,
+                              unsigned alignment);
+    /// @checked is true if the caller has already checked the length of the packet.
+    void compileExtract(const IR::Expression* destination, bool checked);
     void compileLookahead(const IR::Expression* destination);
+    /// The header extracted by @component, or nullptr.
+    const IR::Expression* extracted(const IR::StatOrDecl* component) const;
+    void emitLengthCheck(unsigned width);
 
  public:
     explicit StateTranslationVisitor(const EBPFParserState* state) :
             CodeGenInspector(state->parser->program->refMap, state->parser->program->typeMap),
-            p4lib(P4::P4CoreLibrary::instance), state(state) {}
+            p4lib(P4::P4CoreLibrary::instance()), state(state) {}
     bool preorder(const IR::ParserState* state) override;
     bool preorder(const IR::SelectCase* selectCase) override;
     bool preorder(const IR::SelectExpression* expression) override;
@@ -59,7 +68,7 @@ StateTranslationVisitor::compileLookahead(const IR::Expression* destination) {
                           state->parser->program->offsetVar.c_str(),
                           state->parser->program->offsetVar.c_str());
     builder->endOfStatement(true);
-    compileExtract(destination);
+    compileExtract(destination, false);
     builder->emitIndent();
     builder->appendFormat("%s = %s_save",
                           state->parser->program->offsetVar.c_str(),
@@ -91,6 +100,45 @@ bool StateTranslationVisitor::preorder(const IR::AssignmentStatement* statement)
     return CodeGenInspector::preorder(statement);
 }
 
+const IR::Expression*
+StateTranslationVisitor::extracted(const IR::StatOrDecl* component) const {
+    auto statement = component->to<IR::MethodCallStatement>();
+    if (statement == nullptr || statement->methodCall->arguments->size() != 1)
+        return nullptr;
+    auto mi = P4::MethodInstance::resolve(statement->methodCall,
+                                          state->parser->program->refMap,
+                                          state->parser->program->typeMap);
+    auto extMethod = mi->to<P4::ExternMethod>();
+    if (extMethod == nullptr || extMethod->object != state->parser->packet ||
+        extMethod->method->name.name != p4lib.packetIn.extract.name)
+        return nullptr;
+    auto destination = statement->methodCall->arguments->at(0)->expression;
+    auto type = state->parser->typeMap->getType(destination);
+    if (type == nullptr || !type->is<IR::Type_StructLike>())
+        return nullptr;
+    return destination;
+}
+
+void StateTranslationVisitor::emitLengthCheck(unsigned width) {
+    auto program = state->parser->program;
+    builder->emitIndent();
+    builder->appendFormat("if (%s < %s + BYTES(%s + %d)) ",
+                          program->packetEndVar.c_str(),
+                          program->packetStartVar.c_str(),
+                          program->offsetVar.c_str(), width);
+    builder->blockStart();
+
+    builder->emitIndent();
+    builder->appendFormat("%s = %s;", program->errorVar.c_str(),
+                          p4lib.packetTooShort.str());
+    builder->newline();
+
+    builder->emitIndent();
+    builder->appendFormat("goto %s;", IR::ParserState::reject.c_str());
+    builder->newline();
+    builder->blockEnd(true);
+}
+
 bool StateTranslationVisitor::preorder(const IR::ParserState* parserState) {
     if (parserState->isBuiltin()) return false;
 
@@ -100,6 +148,19 @@ bool StateTranslationVisitor::preorder(const IR::ParserState* parserState) {
     builder->spc();
     builder->blockStart();
 
+    // Check the length of the packet once for all the headers extracted by the state:
+    // a packet too short for any of them is rejected with the same error.
+    unsigned width = 0;
+    checkedExtracts.clear();
+    for (auto c : parserState->components)
+        if (auto destination = extracted(c)) {
+            width += state->parser->typeMap->getType(destination)
+                    ->to<IR::Type_StructLike>()->width_bits();
+            checkedExtracts.emplace(c->to<IR::MethodCallStatement>()->methodCall);
+        }
+    if (width > 0)
+        emitLengthCheck(width);
+
     visit(parserState->components, "components");
     if (parserState->selectExpression == nullptr) {
         builder->emitIndent();
@@ -265,47 +326,114 @@ StateTranslationVisitor::compileExtractField(
 }
 
 void
-StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
-    auto type = state->parser->typeMap->getType(destination);
-    auto ht = type->to<IR::Type_StructLike>();
-    if (ht == nullptr) {
-        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
-                "Cannot extract to a non-struct type %1%", destination);
-        return;
+StateTranslationVisitor::compileExtractFields(
+    const IR::Expression* expr, const std::vector<std::pair<cstring, EBPFType*>>& fields,
+    unsigned alignment) {
+    auto program = state->parser->program;
+    unsigned span = alignment;
+    for (auto& f : fields)
+        span += dynamic_cast<IHasWidth*>(f.second)->widthInBits();
+    unsigned loadSize = 8;
+    const char* helper = "load_byte";
+    if (span > 32) {
+        loadSize = 64;
+        helper = "load_dword";
+    } else if (span > 16) {
+        loadSize = 32;
+        helper = "load_word";
+    } else if (span > 8) {
+        loadSize = 16;
+        helper = "load_half";
     }
+    auto wordType = EBPFTypeFactory::instance->create(IR::Type_Bits::get(loadSize));
+    cstring word = program->refMap->newName("word");
 
-    unsigned width = ht->width_bits();
-    auto program = state->parser->program;
     builder->emitIndent();
-    builder->appendFormat("if (%s < %s + BYTES(%s + %d)) ",
-                          program->packetEndVar.c_str(),
-                          program->packetStartVar.c_str(),
-                          program->offsetVar.c_str(), width);
     builder->blockStart();
-
     builder->emitIndent();
-    builder->appendFormat("%s = %s;", program->errorVar.c_str(),
-                          p4lib.packetTooShort.str());
-    builder->newline();
+    wordType->declare(builder, word, false);
+    builder->appendFormat(" = %s(%s, BYTES(%s))", helper,
+                          program->packetStartVar.c_str(), program->offsetVar.c_str());
+    builder->endOfStatement(true);
+
+    unsigned used = alignment;
+    for (auto& f : fields) {
+        unsigned widthToExtract = dynamic_cast<IHasWidth*>(f.second)->widthInBits();
+        used += widthToExtract;
+        unsigned shift = loadSize - used;
+        builder->emitIndent();
+        visit(expr);
+        builder->appendFormat(".%s = (", f.first.c_str());
+        f.second->emit(builder);
+        builder->append(")(");
+        if (shift != 0)
+            builder->appendFormat("(%s >> %d)", word.c_str(), shift);
+        else
+            builder->append(word);
+        if (widthToExtract != loadSize) {
+            builder->append(" & EBPF_MASK(");
+            wordType->emit(builder);
+            builder->appendFormat(", %d)", widthToExtract);
+        }
+        builder->append(")");
+        builder->endOfStatement(true);
+    }
+    builder->blockEnd(true);
 
     builder->emitIndent();
-    builder->appendFormat("goto %s;", IR::ParserState::reject.c_str());
+    builder->appendFormat("%s += %d", program->offsetVar.c_str(), used - alignment);
+    builder->endOfStatement(true);
     builder->newline();
-    builder->blockEnd(true);
+}
+
+void
+StateTranslationVisitor::compileExtract(const IR::Expression* destination, bool checked) {
+    auto type = state->parser->typeMap->getType(destination);
+    auto ht = type->to<IR::Type_StructLike>();
+    if (ht == nullptr) {
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "Cannot extract to a non-struct type %1%", destination);
+        return;
+    }
 
-    unsigned alignment = 0;
-    for (auto f : ht->fields) {
-        auto ftype = state->parser->typeMap->getType(f);
-        auto etype = EBPFTypeFactory::instance->create(ftype);
-        auto et = dynamic_cast<IHasWidth*>(etype);
-        if (et == nullptr) {
-            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
-                    "Only headers with fixed widths supported %1%", f);
-            return;
+    unsigned width = ht->width_bits();
+    if (!checked)
+        emitLengthCheck(width);
+
+    // Adjacent fields are read with a single load, when it does not go past the header.
+    unsigned bitOffset = 0;
+    auto& fields = ht->fields;
+    for (size_t i = 0; i < fields.size(); ) {
+        std::vector<std::pair<cstring, EBPFType*>> group;
+        unsigned alignment = bitOffset % 8;
+        unsigned span = alignment;
+        for (size_t j = i; j < fields.size(); ++j) {
+            auto ftype = state->parser->typeMap->getType(fields.at(j));
+            auto etype = EBPFTypeFactory::instance->create(ftype);
+            auto et = dynamic_cast<IHasWidth*>(etype);
+            if (et == nullptr) {
+                ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                        "Only headers with fixed widths supported %1%", fields.at(j));
+                return;
+            }
+            unsigned w = et->widthInBits();
+            unsigned loadBytes = 1;
+            while (loadBytes < 8 && loadBytes * 8 < span + w)
+                loadBytes *= 2;
+            if (!group.empty() &&
+                (span + w > 64 || loadBytes > width / 8 - bitOffset / 8))
+                break;
+            group.emplace_back(fields.at(j)->name, etype);
+            span += w;
+            if (w > 64)
+                break;
         }
-        compileExtractField(destination, f->name, alignment, etype);
-        alignment += et->widthInBits();
-        alignment %= 8;
+        if (group.size() == 1)
+            compileExtractField(destination, group.at(0).first, alignment, group.at(0).second);
+        else
+            compileExtractFields(destination, group, alignment);
+        bitOffset += span - alignment;
+        i += group.size();
     }
 
     if (ht->is<IR::Type_Header>()) {
@@ -342,7 +470,10 @@ bool StateTranslationVisitor::preorder(const IR::MethodCallExpression* expressio
                             "Variable-sized header fields not yet supported %1%", expression);
                     return false;
                 }
-                compileExtract(expression->arguments->at(0)->expression);
+                auto destination = expression->arguments->at(0)->expression;
+                // preorder(IR::ParserState) has checked the length for the extracts
+                // that are statements of the state
+                compileExtract(destination, checkedExtracts.count(expression) != 0);
                 return false;
             }
             BUG("Unhandled packet method %1%", expression->method);
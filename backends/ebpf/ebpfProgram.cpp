@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <chrono>
 #include <ctime>
+#include <set>
 
 #include "ebpfProgram.h"
 #include "ebpfType.h"
@@ -73,8 +74,26 @@ void EBPFProgram::emitC(CodeBuilder* builder, cstring header) {
 
     builder->target->emitIncludes(builder);
     emitPreamble(builder);
+    if (options.tailCalls || options.scratchHeaders) {
+        builder->emitIndent();
+        builder->appendFormat("struct %s ", stateType.c_str());
+        builder->blockStart();
+        builder->emitIndent();
+        parser->headerType->declare(builder, "headers", false);
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendLine("unsigned offset;");
+        builder->blockEnd(false);
+        builder->endOfStatement(true);
+        builder->newline();
+    }
     builder->append("REGISTER_START()\n");
     control->emitTableInstances(builder);
+    if (options.tailCalls || options.scratchHeaders)
+        builder->target->emitTableDecl(builder, stateMapName, TablePerCPUArray, arrayIndexType,
+                                       cstring("struct ") + stateType, 1);
+    if (options.tailCalls)
+        builder->target->emitProgArrayDecl(builder, programsMapName, 1, 1);
     builder->append("REGISTER_END()\n");
     builder->newline();
     builder->emitIndent();
@@ -84,11 +103,15 @@ void EBPFProgram::emitC(CodeBuilder* builder, cstring header) {
     builder->blockStart();
 
     emitHeaderInstances(builder);
-    builder->append(" = ");
-    parser->headerType->emitInitializer(builder);
+    if (!options.scratchHeaders) {
+        builder->append(" = ");
+        parser->headerType->emitInitializer(builder);
+    }
     builder->endOfStatement(true);
 
     emitLocalVariables(builder);
+    if (options.scratchHeaders)
+        emitScratchHeaders(builder);
     builder->newline();
     builder->emitIndent();
     builder->appendFormat("goto %s;", IR::ParserState::start.c_str());
@@ -96,7 +119,18 @@ void EBPFProgram::emitC(CodeBuilder* builder, cstring header) {
 
     parser->emit(builder);
     emitPipeline(builder);
+    if (options.tailCalls) {
+        builder->blockEnd(true);  // end of function
+        emitControlProgram(builder);
+    } else {
+        emitEnd(builder);
+        builder->blockEnd(true);  // end of function
+    }
+
+    builder->target->emitLicense(builder, license);
+}
 
+void EBPFProgram::emitEnd(CodeBuilder* builder) {
     builder->emitIndent();
     builder->appendFormat("%s:\n", endLabel.c_str());
     builder->emitIndent();
@@ -111,9 +145,40 @@ void EBPFProgram::emitC(CodeBuilder* builder, cstring header) {
     builder->emitIndent();
     builder->appendFormat("return %s;\n", builder->target->dropReturnCode().c_str());
     builder->decreaseIndent();
-    builder->blockEnd(true);  // end of function
+}
 
-    builder->target->emitLicense(builder, license);
+void EBPFProgram::emitControlProgram(CodeBuilder* builder) {
+    cstring state = EBPFModel::reserved("stateValue");
+    builder->newline();
+    builder->emitIndent();
+    builder->target->emitTailCallSection(builder, 1, 0);
+    builder->emitIndent();
+    builder->target->emitMain(builder, controlFunctionName, model.CPacketName.str());
+    builder->blockStart();
+
+    emitHeaderInstances(builder);
+    builder->endOfStatement(true);
+    emitLocalVariables(builder);
+    emitStateLookup(builder, state);
+    builder->emitIndent();
+    if (options.scratchHeaders)
+        builder->appendFormat("%s = &%s->headers", parser->headers->name.name.c_str(),
+                              state.c_str());
+    else
+        builder->appendFormat("%s = %s->headers", parser->headers->name.name.c_str(),
+                              state.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s = %s->offset", offsetVar.c_str(), state.c_str());
+    builder->endOfStatement(true);
+    builder->newline();
+
+    builder->emitIndent();
+    builder->blockStart();
+    control->emit(builder);
+    builder->blockEnd(true);
+    emitEnd(builder);
+    builder->blockEnd(true);  // end of function
 }
 
 void EBPFProgram::emitGeneratedComment(CodeBuilder* builder) {
@@ -139,6 +204,8 @@ void EBPFProgram::emitH(CodeBuilder* builder, cstring) {
     emitTypes(builder);
     control->emitTableTypes(builder);
     builder->appendLine("#if CONTROL_PLANE");
+    control->emitTableWriters(builder);
+    control->emitCacheInvalidations(builder);
     builder->appendLine("static void init_tables() ");
     builder->blockStart();
     builder->emitIndent();
@@ -146,6 +213,8 @@ void EBPFProgram::emitH(CodeBuilder* builder, cstring) {
     builder->newline();
     control->emitTableInitializers(builder);
     builder->blockEnd(true);
+    control->emitCounterReaders(builder);
+    control->emitDigestReaders(builder);
     builder->appendLine("#endif");
     builder->appendLine("#endif");
 }
@@ -214,7 +283,7 @@ void EBPFProgram::emitLocalVariables(CodeBuilder* builder) {
 
     builder->emitIndent();
     builder->appendFormat("enum %s %s = %s;", errorEnum.c_str(), errorVar.c_str(),
-                          P4::P4CoreLibrary::instance.noError.str());
+                          P4::P4CoreLibrary::instance().noError.str());
     builder->newline();
 
     builder->emitIndent();
@@ -243,7 +312,145 @@ void EBPFProgram::emitLocalVariables(CodeBuilder* builder) {
 
 void EBPFProgram::emitHeaderInstances(CodeBuilder* builder) {
     builder->emitIndent();
-    parser->headerType->declare(builder, parser->headers->name.name, false);
+    parser->headerType->declare(builder, parser->headers->name.name, options.scratchHeaders);
+}
+
+void EBPFProgram::emitStateLookup(CodeBuilder* builder, cstring state) {
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s", stateType.c_str(), state.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, stateMapName, zeroKey, state);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s == NULL)", state.c_str());
+    builder->newline();
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendFormat("return %s", builder->target->abortReturnCode().c_str());
+    builder->endOfStatement(true);
+    builder->decreaseIndent();
+}
+
+namespace {
+/// Finds the fields of the headers that the parser or the control may read, as paths
+/// from the headers such as .meta.x; a field written before it is read is found too
+/// if it is read anywhere, and the headers themselves may appear as the path "".
+class FindHeaderReads : public Inspector, P4WriteContext {
+    const P4::ReferenceMap* refMap;
+    std::set<const IR::IDeclaration*> headers;
+
+    bool record(const IR::Expression* expression) {
+        cstring path = "";
+        auto e = expression;
+        while (auto member = e->to<IR::Member>()) {
+            path = cstring::concat('.', member->member, path);
+            e = member->expr;
+        }
+        auto pe = e->to<IR::PathExpression>();
+        if (pe == nullptr)
+            // the members of a header stack element; the stack itself is found below
+            return false;
+        if (headers.count(refMap->getDeclaration(pe->path, true)) && isRead())
+            reads.emplace(path);
+        return true;
+    }
+
+ public:
+    std::set<cstring> reads;
+
+    FindHeaderReads(const P4::ReferenceMap* refMap, std::set<const IR::IDeclaration*> headers) :
+            refMap(refMap), headers(headers) { visitDagOnce = false; }
+    bool preorder(const IR::Member* member) override { return !record(member); }
+    bool preorder(const IR::PathExpression* expression) override {
+        record(expression);
+        return false;
+    }
+
+    /// True if the program may read a field at @path or a part of it.
+    bool mayRead(cstring path) const {
+        for (auto r : reads) {
+            auto shorter = r.size() < path.size() ? r : path;
+            auto longer = r.size() < path.size() ? path : r;
+            if (longer.startsWith(shorter) &&
+                (longer.size() == shorter.size() || longer[shorter.size()] == '.'))
+                return true;
+        }
+        return false;
+    }
+};
+
+/// Emits the reset of the headers in the per-CPU map: every header is invalid,
+/// and the other fields the program may read are zero.
+class ResetScratchHeaders {
+    CodeBuilder* builder;
+    const P4::TypeMap* typeMap;
+    const FindHeaderReads& reads;
+
+    const IR::Type* canonical(const IR::Type* type) const {
+        if (type->is<IR::Type_Name>())
+            return typeMap->getTypeType(type, true);
+        return type;
+    }
+
+    void zero(const IR::Type* type, cstring lvalue) {
+        builder->emitIndent();
+        auto tb = type->to<IR::Type_Bits>();
+        if (type->is<IR::Type_Boolean>() ||
+            (tb != nullptr && EBPFScalarType::generatesScalar(tb->size)))
+            builder->appendFormat("%s = 0", lvalue.c_str());
+        else
+            builder->appendFormat("__builtin_memset(&%s, 0, sizeof(%s))",
+                                  lvalue.c_str(), lvalue.c_str());
+        builder->endOfStatement(true);
+    }
+
+ public:
+    ResetScratchHeaders(CodeBuilder* builder, const P4::TypeMap* typeMap,
+                        const FindHeaderReads& reads) :
+            builder(builder), typeMap(typeMap), reads(reads) {}
+
+    void emit(const IR::Type* type, cstring lvalue, cstring path) {
+        type = canonical(type);
+        if (type->is<IR::Type_Header>()) {
+            // the fields of an invalid header are unspecified
+            builder->emitIndent();
+            builder->appendFormat("%s.ebpf_valid = 0", lvalue.c_str());
+            builder->endOfStatement(true);
+        } else if (auto stack = type->to<IR::Type_Stack>()) {
+            for (unsigned i = 0; i < stack->getSize(); i++)
+                emit(stack->elementType, cstring::concat(lvalue, "[", i, "]"), path);
+        } else if (auto st = type->to<IR::Type_StructLike>()) {
+            for (auto f : st->fields) {
+                // the fields of canonical types may have no type of their own
+                auto ft = typeMap->getType(f);
+                if (ft == nullptr)
+                    ft = f->type;
+                emit(ft, cstring::concat(lvalue, ".", f->name),
+                     cstring::concat(path, ".", f->name));
+            }
+        } else if (reads.mayRead(path)) {
+            zero(type, lvalue);
+        }
+    }
+};
+}  // namespace
+
+void EBPFProgram::emitScratchHeaders(CodeBuilder* builder) {
+    cstring state = EBPFModel::reserved("stateValue");
+    cstring headers = parser->headers->name.name;
+    emitStateLookup(builder, state);
+    builder->emitIndent();
+    builder->appendFormat("%s = &%s->headers", headers.c_str(), state.c_str());
+    builder->endOfStatement(true);
+    builder->pointers.emplace(headers);
+
+    // The entry keeps the headers of the previous packet
+    FindHeaderReads reads(refMap, { parser->headers, control->headers });
+    parser->parserBlock->container->apply(reads);
+    control->controlBlock->container->apply(reads);
+    ResetScratchHeaders reset(builder, typeMap, reads);
+    reset.emit(typeMap->getType(parser->headers, true), cstring::concat("(*", headers, ")"), "");
 }
 
 void EBPFProgram::emitPipeline(CodeBuilder* builder) {
@@ -253,7 +460,51 @@ void EBPFProgram::emitPipeline(CodeBuilder* builder) {
     builder->newline();
     builder->emitIndent();
     builder->blockStart();
-    control->emit(builder);
+    if (!options.tailCalls) {
+        control->emit(builder);
+        builder->blockEnd(true);
+        return;
+    }
+
+    // Pass the parsed headers to the program of the control
+    cstring state = EBPFModel::reserved("stateValue");
+    if (options.scratchHeaders) {
+        // The headers are already in the map
+        builder->emitIndent();
+        builder->appendFormat("%s->offset = %s", state.c_str(), offsetVar.c_str());
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->target->emitTailCall(builder, model.CPacketName.str(), programsMapName, 0);
+        builder->newline();
+        builder->emitIndent();
+        builder->appendFormat("return %s", builder->target->abortReturnCode().c_str());
+        builder->endOfStatement(true);
+        builder->blockEnd(true);
+        return;
+    }
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s", stateType.c_str(), state.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, stateMapName, zeroKey, state);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL) ", state.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s->headers = %s", state.c_str(), parser->headers->name.name.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s->offset = %s", state.c_str(), offsetVar.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTailCall(builder, model.CPacketName.str(), programsMapName, 0);
+    builder->newline();
+    builder->blockEnd(true);
+    // The tail call only returns if it fails
+    builder->emitIndent();
+    builder->appendFormat("return %s", builder->target->abortReturnCode().c_str());
+    builder->endOfStatement(true);
     builder->blockEnd(true);
 }
 
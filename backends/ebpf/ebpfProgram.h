@@ -50,6 +50,9 @@ class EBPFProgram : public EBPFObject {
     cstring zeroKey, functionName, errorVar;
     cstring packetStartVar, packetEndVar, byteVar;
     cstring errorEnum;
+    // With --tail-calls: the state passed by the parser to the control and its map,
+    // the program array, and the function of the control
+    cstring stateType, stateMapName, programsMapName, controlFunctionName;
     cstring license = "GPL";  // TODO: this should be a compiler option probably
     cstring arrayIndexType = "u32";
 
@@ -59,7 +62,7 @@ class EBPFProgram : public EBPFObject {
                 P4::ReferenceMap* refMap, P4::TypeMap* typeMap, const IR::ToplevelBlock* toplevel) :
             options(options), program(program), toplevel(toplevel),
             refMap(refMap), typeMap(typeMap),
-            parser(nullptr), control(nullptr), model(EBPFModel::instance) {
+            parser(nullptr), control(nullptr), model(EBPFModel::instance()) {
         offsetVar = EBPFModel::reserved("packetOffsetInBits");
         zeroKey = EBPFModel::reserved("zero");
         functionName = EBPFModel::reserved("filter");
@@ -69,6 +72,10 @@ class EBPFProgram : public EBPFObject {
         byteVar = EBPFModel::reserved("byte");
         endLabel = EBPFModel::reserved("end");
         errorEnum = EBPFModel::reserved("errorCodes");
+        stateType = EBPFModel::reserved("state");
+        stateMapName = EBPFModel::reserved("scratch");
+        programsMapName = EBPFModel::reserved("programs");
+        controlFunctionName = EBPFModel::reserved("control");
     }
 
  protected:
@@ -78,6 +85,16 @@ class EBPFProgram : public EBPFObject {
     virtual void emitHeaderInstances(CodeBuilder* builder);
     virtual void emitLocalVariables(CodeBuilder* builder);
     virtual void emitPipeline(CodeBuilder* builder);
+    /// Emits the end label, where the program returns the verdict of the control.
+    virtual void emitEnd(CodeBuilder* builder);
+    /// With --tail-calls, emits the program running the control.
+    virtual void emitControlProgram(CodeBuilder* builder);
+    /// Declares @state, a pointer to the entry of the per-CPU map, and returns if the
+    /// lookup fails.
+    virtual void emitStateLookup(CodeBuilder* builder, cstring state);
+    /// With --scratch-headers, points the headers to the per-CPU map and resets the
+    /// validity bits and the fields that the program may read.
+    virtual void emitScratchHeaders(CodeBuilder* builder);
 
  public:
     virtual void emitH(CodeBuilder* builder, cstring headerFile);  // emits C headers
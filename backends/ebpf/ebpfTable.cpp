@@ -15,6 +15,9 @@ limitations under the License.
 */
 
 #include "ebpfTable.h"
+
+#include <algorithm>
+
 #include "ebpfType.h"
 #include "ir/ir.h"
 #include "frontends/p4/coreLibrary.h"
@@ -60,6 +63,56 @@ class ActionTranslationVisitor : public CodeGenInspector {
         return false;
     }
 };  // ActionTranslationVisitor
+
+cstring matchTypeName(const EBPFProgram* program, const IR::KeyElement* element) {
+    auto mtdecl = program->refMap->getDeclaration(element->matchType->path, true);
+    return mtdecl->getNode()->to<IR::Declaration_ID>()->name.name;
+}
+
+/// The value and mask of the key set @keySet for a field of @width bits.
+bool ternaryKeySet(const IR::Expression* keySet, unsigned width,
+                   big_int& value, big_int& mask) {
+    big_int all = (big_int(1) << width) - 1;
+    if (keySet->is<IR::DefaultExpression>()) {
+        value = mask = 0;
+        return true;
+    }
+    auto v = keySet, m = keySet;
+    if (auto ternary = keySet->to<IR::Mask>()) {
+        v = ternary->left;
+        m = ternary->right;
+    }
+    auto constant = [all](const IR::Expression* e, big_int& result, bool isMask) {
+        if (auto c = e->to<IR::Constant>())
+            result = c->value & all;
+        else if (auto b = e->to<IR::BoolLiteral>())
+            result = b->value ? 1 : 0;
+        else
+            return false;
+        if (isMask && e->is<IR::BoolLiteral>())
+            result = all;
+        return true; };
+    if (!constant(v, value, false))
+        return false;
+    if (m == v)
+        mask = all;
+    else if (!constant(m, mask, true))
+        return false;
+    value &= mask;
+    return true;
+}
+
+/// The value and prefix length of the key set @keySet for a 32-bit LPM field.
+bool prefixKeySet(const IR::Expression* keySet, big_int& value, unsigned& length) {
+    big_int mask;
+    if (!ternaryKeySet(keySet, 32, value, mask))
+        return false;
+    big_int all = (big_int(1) << 32) - 1;
+    for (length = 0; length <= 32; length++)
+        if (mask == (all ^ ((big_int(1) << (32 - length)) - 1)))
+            return true;
+    return false;
+}
 }  // namespace
 
 ////////////////////////////////////////////////////////////////
@@ -75,6 +128,89 @@ EBPFTable::EBPFTable(const EBPFProgram* program, const IR::TableBlock* table,
 
     keyGenerator = table->container->getKey();
     actionList = table->container->getActionList();
+
+    maskTypeName = program->refMap->newName(instanceName + "_mask");
+    masksMapName = program->refMap->newName(instanceName + "_masks");
+
+    if (keyGenerator != nullptr) {
+        unsigned bits = 0;
+        for (auto c : keyGenerator->keyElements) {
+            auto type = program->typeMap->getType(c->expression, true);
+            if (matchTypeName(program, c) != P4::P4CoreLibrary::instance().exactMatch.name ||
+                !(type->is<IR::Type_Bits>() || type->is<IR::Type_Boolean>())) {
+                bits = 0;
+                break;
+            }
+            bits += type->width_bits();
+        }
+        if (bits <= program->options.maxDenseKeyBits)
+            denseKeyBits = bits;
+    }
+
+    if (auto cache = table->container->getAnnotation(flowCacheAnnotation)) {
+        auto size = cache->expr.size() == 1 ? cache->expr.at(0)->to<IR::Constant>() : nullptr;
+        if (size == nullptr || !size->fitsInt() || size->asInt() <= 0) {
+            ::error(ErrorType::ERR_INVALID, "%1%: expected a positive number of entries", cache);
+        } else if (keyGenerator == nullptr) {
+            ::warning(ErrorType::WARN_IGNORE, "%1%: table has no key", cache);
+        } else if (isDense()) {
+            ::warning(ErrorType::WARN_IGNORE, "%1%: table is an array", cache);
+        } else {
+            cacheSize = size->asInt();
+            cacheMapName = program->refMap->newName(instanceName + "_cache");
+            cacheValueTypeName = program->refMap->newName(instanceName + "_cache_value");
+            epochMapName = program->refMap->newName(instanceName + "_epoch");
+        }
+    }
+
+    if (auto dir = table->container->getAnnotation(dir24_8Annotation)) {
+        unsigned groups = 256;
+        auto key = keyGenerator != nullptr && keyGenerator->keyElements.size() == 1 ?
+                keyGenerator->keyElements.at(0) : nullptr;
+        auto type = key ? program->typeMap->getType(key->expression, true) : nullptr;
+        if (dir->expr.size() == 1) {
+            auto count = dir->expr.at(0)->to<IR::Constant>();
+            if (count == nullptr || !count->fitsInt() || count->asInt() <= 0 ||
+                count->asInt() > (1 << 16)) {
+                ::error(ErrorType::ERR_INVALID, "%1%: expected between 1 and 65536 groups", dir);
+                return;
+            }
+            groups = count->asInt();
+        } else if (dir->expr.size() > 1) {
+            ::error(ErrorType::ERR_INVALID, "%1%: expected at most one number of groups", dir);
+            return;
+        }
+        if (key == nullptr ||
+            matchTypeName(program, key) != P4::P4CoreLibrary::instance().lpmMatch.name ||
+            !type->is<IR::Type_Bits>() || type->width_bits() != 32) {
+            ::error(ErrorType::ERR_UNSUPPORTED,
+                    "%1%: only tables with a single 32-bit LPM key field can be "
+                    "DIR-24-8 tables", dir);
+        } else {
+            dirGroups = groups;
+            tbl24MapName = program->refMap->newName(instanceName + "_tbl24");
+            tbl8MapName = program->refMap->newName(instanceName + "_tbl8");
+            groupsMapName = program->refMap->newName(instanceName + "_groups");
+        }
+    }
+}
+
+const unsigned EBPFTable::maxMasks = 32;
+const cstring EBPFTable::flowCacheAnnotation = "flow_cache";
+const cstring EBPFTable::dir24_8Annotation = "dir_24_8";
+
+bool EBPFTable::isTupleSpace() const {
+    if (keyGenerator == nullptr)
+        return false;
+    unsigned lpm = 0;
+    for (auto c : keyGenerator->keyElements) {
+        auto matchType = matchTypeName(program, c);
+        if (matchType == P4::P4CoreLibrary::instance().ternaryMatch.name)
+            return true;
+        if (matchType == P4::P4CoreLibrary::instance().lpmMatch.name)
+            lpm++;
+    }
+    return lpm > 1;
 }
 
 void EBPFTable::emitKeyType(CodeBuilder* builder) {
@@ -82,6 +218,11 @@ void EBPFTable::emitKeyType(CodeBuilder* builder) {
     builder->appendFormat("struct %s ", keyTypeName.c_str());
     builder->blockStart();
 
+    if (isDir24_8()) {
+        builder->emitIndent();
+        builder->appendLine("u32 prefixlen;  /* the routes are keyed by their prefix */");
+    }
+
     CodeGenInspector commentGen(program->refMap, program->typeMap);
     commentGen.setBuilder(builder);
 
@@ -106,10 +247,20 @@ void EBPFTable::emitKeyType(CodeBuilder* builder) {
         }
 
         // Emit key in decreasing order size - this way there will be no gaps
+        bool maskId = !isTupleSpace();
         for (auto it = ordered.rbegin(); it != ordered.rend(); ++it) {
             auto c = it->second;
+            if (!maskId && it->first <= 32) {
+                builder->emitIndent();
+                builder->appendLine("u32 mask_id;");
+                maskId = true;
+            }
 
             auto ebpfType = ::get(keyTypes, c);
+            if (isTupleSpace() && !EBPFScalarType::generatesScalar(it->first))
+                ::error(ErrorType::ERR_UNSUPPORTED,
+                        "%1%: fields wider than 64 bits are not supported in tables with "
+                        "ternary or several LPM fields", c);
             builder->emitIndent();
             cstring fieldName = ::get(keyFieldNames, c);
             ebpfType->declare(builder, fieldName, false);
@@ -118,17 +269,36 @@ void EBPFTable::emitKeyType(CodeBuilder* builder) {
             builder->append(" */");
             builder->newline();
 
-            auto mtdecl = program->refMap->getDeclaration(c->matchType->path, true);
-            auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
-            if (matchType->name.name != P4::P4CoreLibrary::instance.exactMatch.name &&
-                matchType->name.name != P4::P4CoreLibrary::instance.lpmMatch.name)
+            auto matchType = matchTypeName(program, c);
+            if (matchType != P4::P4CoreLibrary::instance().exactMatch.name &&
+                matchType != P4::P4CoreLibrary::instance().ternaryMatch.name &&
+                matchType != P4::P4CoreLibrary::instance().lpmMatch.name)
                 ::error(ErrorType::ERR_UNSUPPORTED,
                         "Match of type %1% not supported", c->matchType);
         }
+        if (!maskId) {
+            builder->emitIndent();
+            builder->appendLine("u32 mask_id;");
+        }
     }
 
     builder->blockEnd(false);
     builder->endOfStatement(true);
+
+    if (isTupleSpace()) {
+        builder->emitIndent();
+        builder->appendFormat("struct %s ", maskTypeName.c_str());
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("u32 id;  /* the mask_id of the entries with this mask */");
+        builder->emitIndent();
+        builder->appendLine("u32 priority;  /* of the best entry with this mask; 0 if unused */");
+        builder->emitIndent();
+        builder->appendFormat("struct %s mask;", keyTypeName.c_str());
+        builder->newline();
+        builder->blockEnd(false);
+        builder->endOfStatement(true);
+    }
 }
 
 void EBPFTable::emitActionArguments(CodeBuilder* builder,
@@ -179,6 +349,14 @@ void EBPFTable::emitValueType(CodeBuilder* builder) {
     builder->emitIndent();
     builder->appendFormat("enum %s action;", actionEnumName.c_str());
     builder->newline();
+    if (isDense()) {
+        builder->emitIndent();
+        builder->appendLine("u32 valid;  /* 0 for the unused entries of the array */");
+    }
+    if (isTupleSpace()) {
+        builder->emitIndent();
+        builder->appendLine("u32 priority;  /* the highest priority entry matches */");
+    }
 
     builder->emitIndent();
     builder->append("union ");
@@ -201,6 +379,18 @@ void EBPFTable::emitValueType(CodeBuilder* builder) {
 void EBPFTable::emitTypes(CodeBuilder* builder) {
     emitKeyType(builder);
     emitValueType(builder);
+    if (cacheSize > 0) {
+        builder->emitIndent();
+        builder->appendFormat("struct %s ", cacheValueTypeName.c_str());
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("u32 epoch;  /* the entry is stale if the epoch has changed */");
+        builder->emitIndent();
+        builder->appendFormat("struct %s entry;", valueTypeName.c_str());
+        builder->newline();
+        builder->blockEnd(false);
+        builder->endOfStatement(true);
+    }
 }
 
 void EBPFTable::emitInstance(CodeBuilder* builder) {
@@ -247,18 +437,19 @@ void EBPFTable::emitInstance(CodeBuilder* builder) {
             return;
         }
 
-        // If any key field is LPM we will generate an LPM table
-        for (auto it : keyGenerator->keyElements) {
-            auto mtdecl = program->refMap->getDeclaration(it->matchType->path, true);
-            auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
-            if (matchType->name.name == P4::P4CoreLibrary::instance.lpmMatch.name) {
-                if (tableKind == TableLPMTrie) {
-                    ::error(ErrorType::ERR_UNSUPPORTED,
-                            "%1%: only one LPM field allowed", it->matchType);
-                    return;
-                }
-                tableKind = TableLPMTrie;
-            }
+        if (isTupleSpace()) {
+            // The masked keys are looked up in a hash map
+            tableKind = TableHash;
+        } else if (isDense()) {
+            tableKind = TableArray;
+        } else {
+            // If any key field is LPM we will generate an LPM table
+            for (auto it : keyGenerator->keyElements)
+                if (matchTypeName(program, it) == P4::P4CoreLibrary::instance().lpmMatch.name)
+                    tableKind = TableLPMTrie;
+            // The routes of DIR-24-8 tables are found by their exact prefix
+            if (isDir24_8())
+                tableKind = TableHash;
         }
 
         auto sz = extBlock->getParameterValue(program->model.array_table.size.name);
@@ -279,9 +470,33 @@ void EBPFTable::emitInstance(CodeBuilder* builder) {
         }
 
         cstring name = EBPFObject::externalName(table->container);
-        builder->target->emitTableDecl(builder, name, tableKind,
-                                       cstring("struct ") + keyTypeName,
-                                       cstring("struct ") + valueTypeName, size);
+        if (isDense())
+            builder->target->emitTableDecl(builder, name, tableKind, program->arrayIndexType,
+                                           cstring("struct ") + valueTypeName,
+                                           1u << denseKeyBits);
+        else
+            builder->target->emitTableDecl(builder, name, tableKind,
+                                           cstring("struct ") + keyTypeName,
+                                           cstring("struct ") + valueTypeName, size);
+        if (isDir24_8()) {
+            builder->target->emitTableDecl(builder, tbl24MapName, TableArray,
+                                           program->arrayIndexType, "u32", 1u << 24);
+            builder->target->emitTableDecl(builder, tbl8MapName, TableArray,
+                                           program->arrayIndexType, "u32", dirGroups << 8);
+            builder->target->emitTableDecl(builder, groupsMapName, TableArray,
+                                           program->arrayIndexType, "u32", dirGroups);
+        }
+        if (isTupleSpace())
+            builder->target->emitTableDecl(builder, masksMapName, TableArray,
+                                           program->arrayIndexType,
+                                           cstring("struct ") + maskTypeName, maxMasks);
+        if (cacheSize > 0) {
+            builder->target->emitTableDecl(builder, cacheMapName, TableLRUHash,
+                                           cstring("struct ") + keyTypeName,
+                                           cstring("struct ") + cacheValueTypeName, cacheSize);
+            builder->target->emitTableDecl(builder, epochMapName, TableArray,
+                                           program->arrayIndexType, "u32", 1);
+        }
     }
     builder->target->emitTableDecl(builder, defaultActionMapName, TableArray,
                                    program->arrayIndexType,
@@ -317,6 +532,440 @@ void EBPFTable::emitKey(CodeBuilder* builder, cstring keyName) {
     }
 }
 
+void EBPFTable::emitLookup(CodeBuilder* builder, cstring keyName, cstring valueName) {
+    if (cacheSize == 0) {
+        emitMapLookup(builder, keyName, valueName);
+        return;
+    }
+
+    cstring epoch = program->refMap->newName("epoch");
+    cstring cached = program->refMap->newName("cached");
+    builder->emitIndent();
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("u32 *%s", epoch.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s", cacheValueTypeName.c_str(), cached.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, epochMapName, program->zeroKey, epoch);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, cacheMapName, keyName, cached);
+    builder->endOfStatement(true);
+
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL && %s != NULL && %s->epoch == *%s) ",
+                          epoch.c_str(), cached.c_str(), cached.c_str(), epoch.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s = &%s->entry", valueName.c_str(), cached.c_str());
+    builder->endOfStatement(true);
+    builder->blockEnd(false);
+    builder->append(" else ");
+    builder->blockStart();
+    emitMapLookup(builder, keyName, valueName);
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL && %s != NULL) ", epoch.c_str(), valueName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    cstring entry = program->refMap->newName("entry");
+    builder->appendFormat("struct %s %s = { .epoch = *%s, .entry = *%s }",
+                          cacheValueTypeName.c_str(), entry.c_str(), epoch.c_str(),
+                          valueName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableUpdate(builder, cacheMapName, keyName, entry);
+    builder->newline();
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+}
+
+void EBPFTable::emitMapLookup(CodeBuilder* builder, cstring keyName, cstring valueName) {
+    if (isTupleSpace()) {
+        emitTupleSpaceLookup(builder, keyName, valueName);
+        return;
+    }
+    if (isDense()) {
+        cstring index = program->refMap->newName("index");
+        builder->emitIndent();
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendFormat("u32 %s = ", index.c_str());
+        emitDenseIndex(builder, keyName);
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->target->emitTableLookup(builder, dataMapName, index, valueName);
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendFormat("if (%s != NULL && !%s->valid)",
+                              valueName.c_str(), valueName.c_str());
+        builder->newline();
+        builder->increaseIndent();
+        builder->emitIndent();
+        builder->appendFormat("%s = NULL", valueName.c_str());
+        builder->endOfStatement(true);
+        builder->decreaseIndent();
+        builder->blockEnd(true);
+        return;
+    }
+    if (isDir24_8()) {
+        emitDirLookup(builder, keyName, valueName);
+        return;
+    }
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, dataMapName, keyName, valueName);
+    builder->endOfStatement(true);
+}
+
+void EBPFTable::emitDirLookup(CodeBuilder* builder, cstring keyName, cstring valueName) {
+    cstring field = keyName + "." + ::get(keyFieldNames, keyGenerator->keyElements.at(0));
+    cstring index = program->refMap->newName("index");
+    cstring entry = program->refMap->newName("entry");
+    cstring prefix = program->refMap->newName("prefix");
+    builder->emitIndent();
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("u32 %s = %s >> 8", index.c_str(), field.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("u32 *%s", entry.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, tbl24MapName, index, entry);
+    builder->endOfStatement(true);
+    // DIR24_8_GROUP: the entry is the index of a group of entries for the last 8 bits
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL && (*%s & 0x80000000)) ", entry.c_str(), entry.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s = ((*%s & 0xffffff) << 8) | (%s & 0xff)",
+                          index.c_str(), entry.c_str(), field.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, tbl8MapName, index, entry);
+    builder->endOfStatement(true);
+    builder->blockEnd(true);
+    builder->emitIndent();
+    builder->appendFormat("%s = NULL", valueName.c_str());
+    builder->endOfStatement(true);
+    // The entry is the length of the longest matching prefix plus one, 0 for none
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL && *%s != 0) ", entry.c_str(), entry.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("struct %s %s = {}", keyTypeName.c_str(), prefix.c_str());
+    builder->endOfStatement(true);
+    cstring prefixField = prefix + "." + ::get(keyFieldNames, keyGenerator->keyElements.at(0));
+    builder->emitIndent();
+    builder->appendFormat("%s.prefixlen = *%s - 1", prefix.c_str(), entry.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s = %s & (%s.prefixlen ? 0xffffffff << (32 - %s.prefixlen) : 0)",
+                          prefixField.c_str(), field.c_str(), prefix.c_str(), prefix.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, dataMapName, prefix, valueName);
+    builder->endOfStatement(true);
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+}
+
+void EBPFTable::emitDenseIndex(CodeBuilder* builder, cstring keyName) {
+    // The first key field has the most significant bits
+    unsigned shift = denseKeyBits;
+    bool first = true;
+    for (auto c : keyGenerator->keyElements) {
+        unsigned width = program->typeMap->getType(c->expression, true)->width_bits();
+        shift -= width;
+        if (!first)
+            builder->append(" | ");
+        first = false;
+        builder->appendFormat("(((u32)%s.%s & 0x%x) << %u)", keyName.c_str(),
+                              ::get(keyFieldNames, c).c_str(), (1u << width) - 1, shift);
+    }
+}
+
+void EBPFTable::emitDirMaps(CodeBuilder* builder) {
+    builder->emitIndent();
+    builder->appendFormat("static int %s_dir24_8_maps(int fd, struct dir24_8_maps *maps) ",
+                          instanceName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("static int tbl24 = -1, tbl8 = -1, groups = -1;");
+    std::vector<std::pair<cstring, cstring>> maps = {
+        { "tbl24", tbl24MapName }, { "tbl8", tbl8MapName }, { "groups", groupsMapName } };
+    for (auto& map : maps) {
+        builder->emitIndent();
+        builder->appendFormat("if (%s < 0)", map.first.c_str());
+        builder->newline();
+        builder->increaseIndent();
+        builder->emitIndent();
+        builder->appendFormat("%s = BPF_OBJ_GET(MAP_PATH \"/%s\")",
+                              map.first.c_str(), map.second.c_str());
+        builder->endOfStatement(true);
+        builder->decreaseIndent();
+    }
+    builder->emitIndent();
+    builder->appendFormat("struct dir24_8_maps result = { fd, tbl24, tbl8, groups, %u, "
+                          "sizeof(struct %s) }", dirGroups, valueTypeName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("*maps = result;");
+    builder->emitIndent();
+    builder->appendLine("return tbl24 < 0 || tbl8 < 0 || groups < 0 ? -1 : 0;");
+    builder->blockEnd(true);
+}
+
+void EBPFTable::emitWriter(CodeBuilder* builder) {
+    if (keyGenerator == nullptr)
+        return;
+    if (isDir24_8()) {
+        cstring field = ::get(keyFieldNames, keyGenerator->keyElements.at(0));
+        emitDirMaps(builder);
+        builder->emitIndent();
+        builder->appendFormat("static int %s_write(int fd, struct %s key, struct %s value) ",
+                              instanceName.c_str(), keyTypeName.c_str(), valueTypeName.c_str());
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("struct dir24_8_maps maps;");
+        builder->emitIndent();
+        builder->appendFormat("if (%s_dir24_8_maps(fd, &maps) != 0)", instanceName.c_str());
+        builder->newline();
+        builder->increaseIndent();
+        builder->emitIndent();
+        builder->appendLine("return -1;");
+        builder->decreaseIndent();
+        builder->emitIndent();
+        builder->appendFormat("return dir24_8_insert(&maps, key.prefixlen, key.%s, &value)",
+                              field.c_str());
+        builder->endOfStatement(true);
+        builder->blockEnd(true);
+        return;
+    }
+    builder->emitIndent();
+    builder->appendFormat("static int %s_write(int fd, struct %s key, struct %s value) ",
+                          instanceName.c_str(), keyTypeName.c_str(), valueTypeName.c_str());
+    builder->blockStart();
+    cstring index = "key";
+    if (isDense()) {
+        index = "index";
+        builder->emitIndent();
+        builder->append("u32 index = ");
+        emitDenseIndex(builder, "key");
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendLine("value.valid = 1;");
+    }
+    builder->emitIndent();
+    builder->append("return ");
+    builder->target->emitUserTableUpdate(builder, "fd", index, "value");
+    builder->newline();
+    builder->blockEnd(true);
+}
+
+void EBPFTable::emitDeleter(CodeBuilder* builder) {
+    if (!isDir24_8())
+        return;
+    builder->emitIndent();
+    builder->appendFormat("static int %s_delete(int fd, struct %s key) ",
+                          instanceName.c_str(), keyTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("struct dir24_8_maps maps;");
+    builder->emitIndent();
+    builder->appendFormat("if (%s_dir24_8_maps(fd, &maps) != 0)", instanceName.c_str());
+    builder->newline();
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("return -1;");
+    builder->decreaseIndent();
+    builder->emitIndent();
+    builder->appendFormat("return dir24_8_delete(&maps, key.prefixlen, key.%s)",
+                          ::get(keyFieldNames, keyGenerator->keyElements.at(0)).c_str());
+    builder->endOfStatement(true);
+    builder->blockEnd(true);
+}
+
+void EBPFTable::emitCacheInvalidation(CodeBuilder* builder) {
+    if (cacheSize == 0)
+        return;
+    builder->emitIndent();
+    builder->appendFormat("static int %s_invalidate_cache() ", instanceName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("u32 index = 0, epoch;");
+    builder->emitIndent();
+    builder->appendFormat("int fd = BPF_OBJ_GET(MAP_PATH \"/%s\")", epochMapName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("if (fd < 0 || BPF_USER_MAP_LOOKUP_ELEM(fd, &index, &epoch) != 0)");
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("return -1;");
+    builder->decreaseIndent();
+    builder->emitIndent();
+    builder->appendLine("epoch++;");
+    builder->emitIndent();
+    builder->append("return ");
+    builder->target->emitUserTableUpdate(builder, "fd", "index", "epoch");
+    builder->newline();
+    builder->blockEnd(true);
+}
+
+void EBPFTable::emitTupleSpaceLookup(CodeBuilder* builder, cstring keyName, cstring valueName) {
+    cstring index = program->refMap->newName("index");
+    cstring best = program->refMap->newName("best");
+    cstring mask = program->refMap->newName("mask");
+    cstring entry = program->refMap->newName("entry");
+    cstring tuple = program->refMap->newName("tuple");
+
+    builder->emitIndent();
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("u32 %s, %s = 0", index.c_str(), best.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("#pragma clang loop unroll(full)");
+    builder->emitIndent();
+    builder->appendFormat("for (%s = 0; %s < %u; %s++) ",
+                          index.c_str(), index.c_str(), maxMasks, index.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s", maskTypeName.c_str(), mask.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s", valueTypeName.c_str(), entry.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("struct %s %s = {}", keyTypeName.c_str(), tuple.c_str());
+    builder->endOfStatement(true);
+
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, masksMapName, index, mask);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("/* the masks are ordered by the priority of their best entry */");
+    builder->emitIndent();
+    builder->appendFormat("if (%s == NULL || %s->priority <= %s)",
+                          mask.c_str(), mask.c_str(), best.c_str());
+    builder->newline();
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->append("break");
+    builder->endOfStatement(true);
+    builder->decreaseIndent();
+
+    for (auto c : keyGenerator->keyElements) {
+        cstring fieldName = ::get(keyFieldNames, c);
+        builder->emitIndent();
+        builder->appendFormat("%s.%s = %s.%s & %s->mask.%s",
+                              tuple.c_str(), fieldName.c_str(), keyName.c_str(),
+                              fieldName.c_str(), mask.c_str(), fieldName.c_str());
+        builder->endOfStatement(true);
+    }
+    builder->emitIndent();
+    builder->appendFormat("%s.mask_id = %s->id", tuple.c_str(), mask.c_str());
+    builder->endOfStatement(true);
+
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, dataMapName, tuple, entry);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL && %s->priority > %s) ",
+                          entry.c_str(), entry.c_str(), best.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s = %s", valueName.c_str(), entry.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s = %s->priority", best.c_str(), entry.c_str());
+    builder->endOfStatement(true);
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+}
+
+std::vector<std::pair<std::vector<cstring>, size_t>>
+EBPFTable::emitTupleSpaceMasks(CodeBuilder* builder, const IR::EntriesList* entries) {
+    std::vector<std::pair<std::vector<cstring>, size_t>> result;
+    // The distinct masks, in the order of their best entry
+    std::vector<std::vector<big_int>> masks;
+    std::vector<size_t> maskPriority;
+    size_t priority = entries->entries.size();
+    for (auto e : entries->entries) {
+        auto keySets = e->getKeys()->components;
+        std::vector<big_int> mask;
+        std::vector<cstring> fields;
+        for (size_t i = 0; i < keyGenerator->keyElements.size(); ++i) {
+            auto c = keyGenerator->keyElements.at(i);
+            auto width = ::get(keyTypes, c)->to<IHasWidth>()->widthInBits();
+            big_int value, m;
+            if (!ternaryKeySet(keySets.at(i), width, value, m)) {
+                ::error(ErrorType::ERR_UNSUPPORTED,
+                        "%1%: only constant key sets are supported", keySets.at(i));
+                return {};
+            }
+            mask.push_back(m);
+            fields.push_back(cstring(".") + ::get(keyFieldNames, c) + " = " +
+                             Util::toString(value, 0, false, 16) + "ULL, ");
+        }
+        auto it = std::find(masks.begin(), masks.end(), mask);
+        if (it == masks.end()) {
+            masks.push_back(mask);
+            maskPriority.push_back(priority);
+            it = masks.end() - 1;
+        }
+        result.emplace_back(fields, it - masks.begin());
+        priority--;
+    }
+    if (masks.size() > maxMasks) {
+        ::error(ErrorType::ERR_OVERLIMIT, "%1%: the entries use more than %2% masks",
+                entries, maxMasks);
+        return {};
+    }
+
+    cstring fd = "masksFileDescriptor";
+    builder->emitIndent();
+    builder->appendFormat("int %s = BPF_OBJ_GET(MAP_PATH \"/%s\")",
+                          fd.c_str(), masksMapName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s < 0) { fprintf(stderr, \"map %s not loaded\\n\"); exit(1); }",
+                          fd.c_str(), masksMapName.c_str());
+    builder->newline();
+    for (size_t m = 0; m < masks.size(); ++m) {
+        builder->emitIndent();
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendFormat("u32 index = %u", static_cast<unsigned>(m));
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendFormat("struct %s mask = { .id = %u, .priority = %u, .mask = { ",
+                              maskTypeName.c_str(), static_cast<unsigned>(m),
+                              static_cast<unsigned>(maskPriority.at(m)));
+        for (size_t i = 0; i < keyGenerator->keyElements.size(); ++i)
+            builder->appendFormat(".%s = %sULL, ",
+                                  ::get(keyFieldNames, keyGenerator->keyElements.at(i)).c_str(),
+                                  Util::toString(masks.at(m).at(i), 0, false, 16).c_str());
+        builder->append("} }");
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->append("int ok = ");
+        builder->target->emitUserTableUpdate(builder, fd, "index", "mask");
+        builder->newline();
+        builder->emitIndent();
+        builder->appendFormat("if (ok != 0) { "
+                              "perror(\"Could not write in %s\"); exit(1); }",
+                              masksMapName.c_str());
+        builder->newline();
+        builder->blockEnd(true);
+    }
+    return result;
+}
+
 void EBPFTable::emitAction(CodeBuilder* builder, cstring valueName) {
     builder->emitIndent();
     builder->appendFormat("switch (%s->action) ", valueName.c_str());
@@ -364,7 +1013,6 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
     cstring fd = "tableFileDescriptor";
     cstring defaultTable = defaultActionMapName;
     cstring value = "value";
-    cstring key = "key";
 
     builder->emitIndent();
     builder->blockStart();
@@ -427,19 +1075,58 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
                           fd.c_str(), dataMapName.c_str());
     builder->newline();
 
-    for (auto e : entries->entries) {
-        builder->emitIndent();
-        builder->blockStart();
+    // For tuple-space tables, the fields of each key, masked, and the index of the mask
+    std::vector<std::pair<std::vector<cstring>, size_t>> tupleKeys;
+    if (isTupleSpace()) {
+        tupleKeys = emitTupleSpaceMasks(builder, entries);
+        if (tupleKeys.size() != entries->entries.size()) {
+            builder->blockEnd(true);
+            return;
+        }
+    }
 
-        auto entryAction = e->getAction();
+    // The entries are in static arrays, written with one batch update when the kernel
+    // supports it; the keys of dense tables are not the keys of the map.
+    cstring keys = "keys", values = "values";
+    size_t count = entries->entries.size();
+    builder->emitIndent();
+    builder->appendFormat("static struct %s %s[] = ", keyTypeName.c_str(), keys.c_str());
+    builder->blockStart();
+    for (size_t i = 0; i < count; i++) {
+        auto e = entries->entries.at(i);
         builder->emitIndent();
-        builder->appendFormat("struct %s %s = {", keyTypeName.c_str(), key.c_str());
-        e->getKeys()->apply(cg);
-        builder->append("}");
-        builder->endOfStatement(true);
+        builder->append("{");
+        if (isTupleSpace()) {
+            auto& tuple = tupleKeys.at(i);
+            for (auto field : tuple.first)
+                builder->append(field);
+            builder->appendFormat(".mask_id = %u", static_cast<unsigned>(tuple.second));
+        } else if (isDir24_8()) {
+            auto keySet = e->getKeys()->components.at(0);
+            big_int value;
+            unsigned length = 0;
+            if (!prefixKeySet(keySet, value, length))
+                ::error(ErrorType::ERR_UNSUPPORTED,
+                        "%1%: only constant prefixes are supported", keySet);
+            builder->appendFormat(".prefixlen = %u, .%s = ", length,
+                                  ::get(keyFieldNames, keyGenerator->keyElements.at(0)).c_str());
+            builder->append(Util::toString(value, 0, false, 16));
+        } else {
+            e->getKeys()->apply(cg);
+        }
+        builder->append("},");
+        builder->newline();
+    }
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
 
+    builder->emitIndent();
+    builder->appendFormat("static struct %s %s[] = ", valueTypeName.c_str(), values.c_str());
+    builder->blockStart();
+    for (size_t i = 0; i < count; i++) {
+        auto entryAction = entries->entries.at(i)->getAction();
         BUG_CHECK(entryAction->is<IR::MethodCallExpression>(),
-                  "%1%: expected an action call", defaultAction);
+                  "%1%: expected an action call", entryAction);
         auto mce = entryAction->to<IR::MethodCallExpression>();
         auto mi = P4::MethodInstance::resolve(mce, program->refMap, program->typeMap);
 
@@ -449,40 +1136,49 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
         cstring name = EBPFObject::externalName(action);
 
         builder->emitIndent();
-        builder->appendFormat("struct %s %s = ",
-                              valueTypeName.c_str(), value.c_str());
-        builder->blockStart();
-        builder->emitIndent();
-        builder->appendFormat(".action = %s,", name.c_str());
-        builder->newline();
-
-        CodeGenInspector cg(program->refMap, program->typeMap);
-        cg.setBuilder(builder);
-
-        builder->emitIndent();
+        builder->appendFormat("{ .action = %s, ", name.c_str());
+        if (isTupleSpace())
+            // The first entries have the highest priority
+            builder->appendFormat(".priority = %u, ", static_cast<unsigned>(count - i));
         builder->appendFormat(".u = {.%s = {", name.c_str());
         for (auto p : *mi->substitution.getParametersInArgumentOrder()) {
             auto arg = mi->substitution.lookup(p);
             arg->apply(cg);
             builder->append(",");
         }
-        builder->append("}},\n");
-
-        builder->blockEnd(false);
-        builder->endOfStatement(true);
-
-        builder->emitIndent();
-        builder->append("int ok = ");
-        builder->target->emitUserTableUpdate(builder, fd, key, value);
+        builder->append("}} },");
         builder->newline();
+    }
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
 
+    // Only the generated writer of DIR-24-8 tables fills their arrays
+    bool batch = !isDense() && !isDir24_8();
+    if (batch) {
         builder->emitIndent();
-        builder->appendFormat("if (ok != 0) { "
-                              "perror(\"Could not write in %s\"); exit(1); }",
-                              t->name.name.c_str());
-        builder->newline();
-        builder->blockEnd(true);
+        builder->appendFormat("u32 count = %u", static_cast<unsigned>(count));
+        builder->endOfStatement(true);
     }
+    builder->emitIndent();
+    if (batch)
+        builder->appendFormat("if (BPF_USER_MAP_UPDATE_BATCH(%s, %s, %s, &count) != 0) ",
+                              fd.c_str(), keys.c_str(), values.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    // A failed batch update may have written some of the entries
+    builder->appendFormat("for (u32 i = 0; i < %u; i++) ", static_cast<unsigned>(count));
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("int ok = %s_write(%s, %s[i], %s[i])", instanceName.c_str(),
+                          fd.c_str(), keys.c_str(), values.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (ok != 0) { "
+                          "perror(\"Could not write in %s\"); exit(1); }",
+                          t->name.name.c_str());
+    builder->newline();
+    builder->blockEnd(true);
+    builder->blockEnd(true);
     builder->blockEnd(true);
 }
 
@@ -521,7 +1217,9 @@ EBPFCounterTable::EBPFCounterTable(const EBPFProgram* program, const IR::ExternB
 }
 
 void EBPFCounterTable::emitInstance(CodeBuilder* builder) {
-    TableKind kind = isHash ? TableHash : TableArray;
+    // Each CPU updates its own copy of the counters, so the updates need no atomic
+    // operations; the control plane adds the copies up (see emitReader).
+    TableKind kind = isHash ? TablePerCPUHash : TablePerCPUArray;
     builder->target->emitTableDecl(
         builder, dataMapName, kind, keyTypeName, valueTypeName, size);
 }
@@ -564,7 +1262,7 @@ void EBPFCounterTable::emitCounterIncrement(CodeBuilder* builder,
     builder->newline();
     builder->increaseIndent();
     builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, 1);", valueName.c_str());
+    builder->appendFormat("*%s += 1;", valueName.c_str());
     builder->newline();
     builder->decreaseIndent();
 
@@ -590,11 +1288,6 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     builder->append(valueName);
     builder->endOfStatement(true);
 
-    builder->emitIndent();
-    builder->append(valueTypeName);
-    builder->spc();
-    builder->appendLine("init_val = 1;");
-
     builder->emitIndent();
     builder->append(keyTypeName);
     builder->spc();
@@ -618,6 +1311,12 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     codeGen->visit(inc);
     builder->endOfStatement(true);
 
+    builder->emitIndent();
+    builder->append(valueTypeName);
+    builder->spc();
+    builder->appendFormat("init_val = %s;", incName.c_str());
+    builder->newline();
+
     builder->emitIndent();
     builder->target->emitTableLookup(builder, dataMapName, keyName, valueName);
     builder->endOfStatement(true);
@@ -627,7 +1326,7 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     builder->newline();
     builder->increaseIndent();
     builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, %s);", valueName.c_str(), incName.c_str());
+    builder->appendFormat("*%s += %s;", valueName.c_str(), incName.c_str());
     builder->newline();
     builder->decreaseIndent();
 
@@ -640,6 +1339,37 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     builder->decreaseIndent();
 }
 
+void EBPFCounterTable::emitReader(CodeBuilder* builder) {
+    // The kernel returns the values of all the CPUs, each in 8 bytes.
+    BUG_CHECK(EBPFModel::instance().counterValueType == "u32", "Unexpected counter type");
+    builder->emitIndent();
+    builder->appendFormat("static int %s_read(int fd, %s *key, %s *total) ",
+                          dataMapName.c_str(), keyTypeName.c_str(), valueTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("int i, cpus = BPF_USER_NUM_CPUS();");
+    builder->emitIndent();
+    builder->appendLine("u64 values[cpus > 0 ? cpus : 1];");
+    builder->emitIndent();
+    builder->appendLine("if (cpus <= 0 || BPF_USER_MAP_LOOKUP_ELEM(fd, key, values) != 0)");
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("return -1;");
+    builder->decreaseIndent();
+    builder->emitIndent();
+    builder->appendLine("*total = 0;");
+    builder->emitIndent();
+    builder->appendLine("for (i = 0; i < cpus; i++)");
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendFormat("*total += *(%s *)&values[i];", valueTypeName.c_str());
+    builder->newline();
+    builder->decreaseIndent();
+    builder->emitIndent();
+    builder->appendLine("return 0;");
+    builder->blockEnd(true);
+}
+
 void
 EBPFCounterTable::emitMethodInvocation(CodeBuilder* builder, const P4::ExternMethod* method) {
     if (method->method->name.name == program->model.counterArray.increment.name) {
@@ -657,12 +1387,126 @@ EBPFCounterTable::emitMethodInvocation(CodeBuilder* builder, const P4::ExternMet
 void EBPFCounterTable::emitTypes(CodeBuilder* builder) {
     builder->emitIndent();
     builder->appendFormat("typedef %s %s",
-                          EBPFModel::instance.counterIndexType.c_str(), keyTypeName.c_str());
+                          EBPFModel::instance().counterIndexType.c_str(), keyTypeName.c_str());
     builder->endOfStatement(true);
     builder->emitIndent();
     builder->appendFormat("typedef %s %s",
-                          EBPFModel::instance.counterValueType.c_str(), valueTypeName.c_str());
+                          EBPFModel::instance().counterValueType.c_str(), valueTypeName.c_str());
     builder->endOfStatement(true);
 }
 
+////////////////////////////////////////////////////////////////
+
+EBPFDigest::EBPFDigest(const EBPFProgram* program, const IR::ExternBlock* block,
+                       cstring name, CodeGenInspector* codeGen) :
+        EBPFTableBase(program, name, codeGen) {
+    auto sz = block->getParameterValue(program->model.digest.size.name);
+    if (sz == nullptr || !sz->is<IR::Constant>()) {
+        ::error(ErrorType::ERR_INVALID,
+                "%1% (%2%): expected an integer argument; is the model corrupted?",
+                program->model.digest.size, name);
+        return;
+    }
+    auto cst = sz->to<IR::Constant>();
+    // The kernel maps the ring buffer in pages, and indexes it with a mask
+    if (!cst->fitsInt() || cst->asInt() < 4096 || (cst->asInt() & (cst->asInt() - 1)) != 0) {
+        ::error(ErrorType::ERR_INVALID,
+                "%1%: the size of a ring buffer must be a power of 2 of at least 4096 bytes",
+                cst);
+        return;
+    }
+    size = cst->asInt();
+
+    auto di = block->node->to<IR::Declaration_Instance>();
+    auto spec = di ? di->type->to<IR::Type_Specialized>() : nullptr;
+    BUG_CHECK(spec != nullptr && spec->arguments->size() == 1,
+              "%1%: expected a type argument", block->node);
+    type = program->typeMap->getTypeType(spec->arguments->at(0), true);
+    if (!EBPFTypeFactory::instance->create(type)->is<IHasWidth>())
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "%1%: digests of type %2% are not supported", di, type);
+}
+
+void EBPFDigest::emitTypes(CodeBuilder* builder) {
+    builder->emitIndent();
+    builder->append("typedef ");
+    EBPFTypeFactory::instance->create(type)->declare(builder, valueTypeName, false);
+    builder->endOfStatement(true);
+}
+
+void EBPFDigest::emitInstance(CodeBuilder* builder) {
+    builder->target->emitTableDecl(builder, dataMapName, TableRingBuf, "", valueTypeName, size);
+}
+
+void EBPFDigest::emitPack(CodeBuilder* builder, const IR::MethodCallExpression* expression) {
+    BUG_CHECK(expression->arguments->size() == 1, "Expected just 1 argument for %1%", expression);
+    auto data = expression->arguments->at(0)->expression;
+    cstring record = program->refMap->newName("record");
+
+    builder->emitIndent();
+    builder->appendFormat("%s *%s", valueTypeName.c_str(), record.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitRingBufReserve(builder, dataMapName,
+                                        cstring("sizeof(") + valueTypeName + ")", record);
+    builder->endOfStatement(true);
+
+    // The record is dropped if the ring buffer is full
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL) ", record.c_str());
+    builder->blockStart();
+    auto st = type->to<IR::Type_StructLike>();
+    auto fieldValue = [&](cstring field, const IR::Expression* value) {
+        builder->emitIndent();
+        builder->appendFormat("%s->%s = ", record.c_str(), field.c_str());
+        codeGen->visit(value);
+        builder->endOfStatement(true); };
+    if (st != nullptr && data->is<IR::ListExpression>()) {
+        auto list = data->to<IR::ListExpression>();
+        for (size_t i = 0; i < list->size() && i < st->fields.size(); i++)
+            fieldValue(st->fields.at(i)->name.name, list->components.at(i));
+    } else if (st != nullptr && data->is<IR::StructExpression>()) {
+        for (auto c : data->to<IR::StructExpression>()->components)
+            fieldValue(c->name.name, c->expression);
+    } else {
+        builder->emitIndent();
+        builder->appendFormat("*%s = ", record.c_str());
+        codeGen->visit(data);
+        builder->endOfStatement(true);
+    }
+    builder->emitIndent();
+    builder->target->emitRingBufSubmit(builder, dataMapName, record);
+    builder->newline();
+    builder->blockEnd(true);
+}
+
+void EBPFDigest::emitReader(CodeBuilder* builder) {
+    builder->emitIndent();
+    builder->appendFormat("static struct ring_buffer *%s_reader("
+                          "int (*callback)(void *ctx, void *data, size_t size), void *ctx) ",
+                          dataMapName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("int fd = BPF_OBJ_GET(MAP_PATH \"/%s\")", dataMapName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("if (fd < 0)");
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("return NULL;");
+    builder->decreaseIndent();
+    builder->emitIndent();
+    builder->appendLine("return BPF_USER_RINGBUF_NEW(fd, callback, ctx);");
+    builder->blockEnd(true);
+}
+
+void EBPFDigest::emitMethodInvocation(CodeBuilder* builder, const P4::ExternMethod* method) {
+    if (method->method->name.name == program->model.digest.pack.name) {
+        emitPack(builder, method->expr);
+        return;
+    }
+    ::error(ErrorType::ERR_UNSUPPORTED,
+            "Unexpected method %1% for %2%", method->expr, program->model.digest.name);
+}
+
 }  // namespace EBPF
@@ -44,25 +44,97 @@ class EBPFTableBase : public EBPFObject {
     }
 };
 
+/**
+ * A table.  Tables with only exact fields, or exact fields and one LPM field, are a
+ * single map.  Tables with ternary fields or several LPM fields use tuple-space search:
+ * the entries are kept in a hash map whose key is the masked key together with the id
+ * of its mask, and a masks map lists the distinct masks ordered by decreasing priority
+ * of their best entry.  A lookup probes the masks in this order, and stops at the first
+ * unused one, after maxMasks masks, or when no entry of the remaining masks can have a
+ * higher priority than the best match found.  The control plane inserting entries at
+ * run time must keep the masks map ordered the same way.
+ *
+ * A table with a @flow_cache(size) annotation is looked up first in an LRU hash map of
+ * that size, which holds the entries recently found for complete keys.  The cached
+ * entries are valid for the value of an epoch counter when they were found; the
+ * control plane must call the generated <table>_invalidate_cache() after writing in
+ * the table.
+ *
+ * A table whose key only has exact fields, of at most EbpfOptions::maxDenseKeyBits
+ * bits in total, is an array map indexed by the concatenation of the key fields; the
+ * entries of the array that the control plane did not write have a zero `valid` field.
+ * The control plane adds entries with the generated <table>_write(), which computes
+ * the index of the key in dense tables.
+ *
+ * A table with a @dir_24_8 or @dir_24_8(groups) annotation and a single 32-bit LPM key
+ * field is looked up DIR-24-8 style: an array indexed by the 24 most significant bits
+ * of the key, and groups of 256 entries for the other 8 bits of the prefixes with
+ * longer routes, give the length of the longest matching prefix, and the route is then
+ * read from a hash map keyed by the prefix length and the masked key.  The control
+ * plane must add and delete the routes with the generated <table>_write() and
+ * <table>_delete(), which maintain the arrays (see runtime/ebpf_dir24_8.h).
+ */
 class EBPFTable final : public EBPFTableBase {
+    void emitTupleSpaceLookup(CodeBuilder* builder, cstring keyName, cstring valueName);
+    void emitMapLookup(CodeBuilder* builder, cstring keyName, cstring valueName);
+    void emitDirLookup(CodeBuilder* builder, cstring keyName, cstring valueName);
+    /// Appends the index of the key @keyName in a dense table.
+    void emitDenseIndex(CodeBuilder* builder, cstring keyName);
+    /// Emits the control-plane function filling the dir24_8_maps of a DIR-24-8 table.
+    void emitDirMaps(CodeBuilder* builder);
+    /// Writes the masks of the constant @entries, and returns the initializers of the
+    /// key fields of each entry and the index of its mask.
+    std::vector<std::pair<std::vector<cstring>, size_t>>
+    emitTupleSpaceMasks(CodeBuilder* builder, const IR::EntriesList* entries);
+
  public:
+    /// The number of masks of a tuple-space table.
+    static const unsigned maxMasks;
+    static const cstring flowCacheAnnotation;
+    static const cstring dir24_8Annotation;
+
     const IR::Key*            keyGenerator;
     const IR::ActionList*     actionList;
     const IR::TableBlock*    table;
     cstring               defaultActionMapName;
     cstring               actionEnumName;
+    cstring               maskTypeName;
+    cstring               masksMapName;
+    /// The number of entries of the flow cache, 0 if the table has none.
+    unsigned              cacheSize = 0;
+    cstring               cacheMapName;
+    cstring               cacheValueTypeName;
+    cstring               epochMapName;
+    /// The number of bits of the key of a dense table, 0 for the other tables.
+    unsigned              denseKeyBits = 0;
+    /// The number of groups of 256 entries of a DIR-24-8 table, 0 for the other tables.
+    unsigned              dirGroups = 0;
+    cstring               tbl24MapName;
+    cstring               tbl8MapName;
+    cstring               groupsMapName;
     std::map<const IR::KeyElement*, cstring> keyFieldNames;
     std::map<const IR::KeyElement*, EBPFType*> keyTypes;
 
     EBPFTable(const EBPFProgram* program, const IR::TableBlock* table, CodeGenInspector* codeGen);
+    bool isTupleSpace() const;
+    bool isDense() const { return denseKeyBits > 0; }
+    bool isDir24_8() const { return dirGroups > 0; }
     void emitTypes(CodeBuilder* builder);
     void emitInstance(CodeBuilder* builder);
     void emitActionArguments(CodeBuilder* builder, const IR::P4Action* action, cstring name);
     void emitKeyType(CodeBuilder* builder);
     void emitValueType(CodeBuilder* builder);
     void emitKey(CodeBuilder* builder, cstring keyName);
+    /// Sets @valueName to the entry matching @keyName, or to NULL.
+    void emitLookup(CodeBuilder* builder, cstring keyName, cstring valueName);
     void emitAction(CodeBuilder* builder, cstring valueName);
     void emitInitializer(CodeBuilder* builder);
+    /// Emits the control-plane function <table>_write(fd, key, value) adding an entry.
+    void emitWriter(CodeBuilder* builder);
+    /// Emits the control-plane function <table>_delete(fd, key) of DIR-24-8 tables.
+    void emitDeleter(CodeBuilder* builder);
+    /// Emits the control-plane function invalidating the flow cache.
+    void emitCacheInvalidation(CodeBuilder* builder);
 };
 
 class EBPFCounterTable final : public EBPFTableBase {
@@ -75,6 +147,28 @@ class EBPFCounterTable final : public EBPFTableBase {
     void emitInstance(CodeBuilder* builder);
     void emitCounterIncrement(CodeBuilder* builder, const IR::MethodCallExpression* expression);
     void emitCounterAdd(CodeBuilder* builder, const IR::MethodCallExpression* expression);
+    /// Emits the control-plane function adding up the per-CPU values of a counter.
+    void emitReader(CodeBuilder* builder);
+    void emitMethodInvocation(CodeBuilder* builder, const P4::ExternMethod* method);
+};
+
+/**
+ * A Digest<T>: a ring buffer map holding the values of T packed by the program.  The
+ * control plane gets a batched reader of the records from the generated
+ * <digest>_reader(callback, ctx); each BPF_USER_RINGBUF_CONSUME() of the reader calls
+ * the callback for all the records available, with no system call per record.
+ */
+class EBPFDigest final : public EBPFTableBase {
+    unsigned          size = 0;
+    const IR::Type*   type = nullptr;
+ public:
+    EBPFDigest(const EBPFProgram* program, const IR::ExternBlock* block,
+               cstring name, CodeGenInspector* codeGen);
+    void emitTypes(CodeBuilder* builder);
+    void emitInstance(CodeBuilder* builder);
+    void emitPack(CodeBuilder* builder, const IR::MethodCallExpression* expression);
+    /// Emits the control-plane function creating a reader of the records.
+    void emitReader(CodeBuilder* builder);
     void emitMethodInvocation(CodeBuilder* builder, const P4::ExternMethod* method);
 };
 
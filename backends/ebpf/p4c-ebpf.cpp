@@ -20,12 +20,15 @@ limitations under the License.
 
 #include "backends/ebpf/version.h"
 #include "ir/ir.h"
+#include "lib/batch_compile.h"
+#include "lib/compile_server.h"
 #include "lib/log.h"
 #include "lib/crash.h"
 #include "lib/exceptions.h"
 #include "lib/gc.h"
 #include "lib/nullstream.h"
 
+#include "annotations.h"
 #include "midend.h"
 #include "ebpfOptions.h"
 #include "ebpfBackend.h"
@@ -53,7 +56,7 @@ void compile(EbpfOptions& options) {
         }
 
         std::istream inJson(&fb);
-        JSONLoader jsonFileLoader(inJson);
+        JSONStreamLoader jsonFileLoader(inJson);
         if (jsonFileLoader.json == nullptr) {
             ::error(ErrorType::ERR_IO, "%s: Not valid input file", options.file);
             return;
@@ -68,7 +71,7 @@ void compile(EbpfOptions& options) {
         P4::P4COptionPragmaParser optionsPragmaParser;
         program->apply(P4::ApplyOptionsPragmas(optionsPragmaParser));
 
-        P4::FrontEnd frontend;
+        P4::FrontEnd frontend{EBPF::ParseAnnotations()};
         frontend.addDebugHook(hook);
         program = frontend.run(options, program);
         if (::errorCount() > 0)
@@ -78,17 +81,15 @@ void compile(EbpfOptions& options) {
     midend.addDebugHook(hook);
     auto toplevel = midend.run(options, program);
     if (options.dumpJsonFile)
-        JSONGenerator(*openFile(options.dumpJsonFile, true)) << program << std::endl;
+        JSONGenerator(*openFile(options.dumpJsonFile, true), false, options.compactJson)
+            << program << std::endl;
     if (::errorCount() > 0)
         return;
 
     EBPF::run_ebpf_backend(options, toplevel, &midend.refMap, &midend.typeMap);
 }
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-    setup_signals();
-
+static int compileProgram(int argc, char *const argv[]) {
     AutoCompileContext autoEbpfContext(new EbpfContext);
     auto& options = EbpfContext::get().options();
     options.compilerVersion = P4C_EBPF_VERSION_STRING;
@@ -98,7 +99,7 @@ int main(int argc, char *const argv[]) {
                     options.setInputFile();
     }
     if (::errorCount() > 0)
-        exit(1);
+        return 1;
 
     try {
         compile(options);
@@ -111,3 +112,14 @@ int main(int argc, char *const argv[]) {
         std::cerr << "Done." << std::endl;
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+    setup_signals();
+
+    if (auto socket = Util::CompileServer::socketPath(argc, argv))
+        return Util::CompileServer::serve(socket, compileProgram);
+    if (Util::BatchCompile::requested(argc, argv))
+        return Util::BatchCompile::run(argc, argv, compileProgram);
+    return compileProgram(argc, argv);
+}
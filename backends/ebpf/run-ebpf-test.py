@@ -51,6 +51,11 @@ PARSER.add_argument("-t", "--target", dest="target", default="test",
                     "default is test")
 PARSER.add_argument("-e", "--extern-file", dest="extern", default="",
                     help="Specify path additional file with C extern function definition")
+PARSER.add_argument("--benchmark", dest="benchmark", type=int, default=0,
+                    help="Also run the packets through the program this many "
+                    "times and report the speed (test target only)")
+PARSER.add_argument("--benchmark-output", dest="benchmark_output", default="",
+                    help="Append the benchmark results as a JSON line to this file")
 
 
 def import_from(module, name):
@@ -89,6 +94,8 @@ class Options(object):
         # Actual location of the test framework
         self.testdir = os.path.dirname(os.path.realpath(__file__))
         self.extern = ""                # Path to C file with extern definition
+        self.benchmark = 0              # Iterations of the benchmark, 0 for none
+        self.benchmark_output = ""      # File collecting the benchmark results
 
 
 def run_model(ebpf, stffile):
@@ -180,9 +187,13 @@ if __name__ == '__main__':
     options.cleanupTmp = args.nocleanup
     options.target = args.target
     options.extern = args.extern
+    options.benchmark = args.benchmark
+    options.benchmark_output = args.benchmark_output
 
-    # All args after '--' are intended for the p4 compiler
-    argv = argv[1:]
+    # All the other args are intended for the p4 compiler; argparse keeps
+    # the '--' separating them in some versions
+    if argv and argv[0] == "--":
+        argv = argv[1:]
     # Run the test with the extracted options and modified argv
     result = run_test(options, argv)
     sys.exit(result)
@@ -42,3 +42,60 @@ static inline void print_n_bytes(void *receiveBuffer, int num) {
         printf("%02x", ((unsigned char *)receiveBuffer)[i]);
     printf("\n");
 }
+
+
+/*
+ * Checksum helpers for extern functions (RFC 1071 and RFC 1624).
+ * The data is added in 64-bit words: a 64-bit one's complement sum folds to
+ * the same 16-bit sum as the 16-bit words it contains. The sums are in the
+ * byte order of the data.
+ */
+static inline u64 ebpf_csum_add(u64 csum, u64 addend) {
+    csum += addend;
+    return csum + (csum < addend);
+}
+
+/* Folds a 64-bit sum into its 16-bit one's complement sum. */
+static inline u16 ebpf_csum_fold(u64 csum) {
+    csum = (csum & 0xffffffff) + (csum >> 32);
+    csum = (csum & 0xffffffff) + (csum >> 32);
+    csum = (csum & 0xffff) + (csum >> 16);
+    csum = (csum & 0xffff) + (csum >> 16);
+    return (u16) csum;
+}
+
+/* Adds len bytes of data, which must be a constant in eBPF programs. */
+static inline u64 ebpf_csum_partial(const void *data, u32 len, u64 csum) {
+    const u8 *bytes = (const u8 *) data;
+    u32 i = 0;
+    for (; i + 8 <= len; i += 8) {
+        u64 word;
+        __builtin_memcpy(&word, bytes + i, 8);
+        csum = ebpf_csum_add(csum, word);
+    }
+    if (i < len) {
+        u64 word = 0;
+        for (u32 j = 0; i + j < len; j++)
+            ((u8 *) &word)[j] = bytes[i + j];
+        csum = ebpf_csum_add(csum, word);
+    }
+    return csum;
+}
+
+/* The checksum of len bytes of data (e.g. an IPv4 header). */
+static inline u16 ebpf_csum(const void *data, u32 len) {
+    return (u16) ~ebpf_csum_fold(ebpf_csum_partial(data, len, 0));
+}
+
+/* Updates a checksum after a field changed from "from" to "to" (RFC 1624, eqn. 3). */
+static inline u16 ebpf_csum_replace2(u16 csum, u16 from, u16 to) {
+    return (u16) ~ebpf_csum_fold(ebpf_csum_add(ebpf_csum_add((u16) ~csum, (u16) ~from), to));
+}
+
+static inline u16 ebpf_csum_replace4(u16 csum, u32 from, u32 to) {
+    return (u16) ~ebpf_csum_fold(ebpf_csum_add(ebpf_csum_add((u16) ~csum, (u32) ~from), to));
+}
+
+static inline u16 ebpf_csum_replace8(u16 csum, u64 from, u64 to) {
+    return (u16) ~ebpf_csum_fold(ebpf_csum_add(ebpf_csum_add((u16) ~csum, ~from), to));
+}
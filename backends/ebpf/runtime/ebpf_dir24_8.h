@@ -0,0 +1,197 @@
+/*
+ * Control-plane operations of the tables with a @dir_24_8 annotation, which
+ * look up a 32-bit LPM key with one or two array accesses.
+ *
+ * The routes are in a hash map (the table itself) whose keys are the prefix
+ * length and the masked address. The entries of two arrays describe the
+ * longest prefix matching each address: tbl24 has an entry for each value of
+ * the 24 most significant bits, and tbl8 has groups of 256 entries, one for
+ * each value of the 8 remaining bits, for the /24 prefixes that have routes
+ * longer than 24 bits. An entry is 0 if no route matches, the length of the
+ * matching prefix plus one, or, in tbl24, DIR24_8_GROUP and the index of a
+ * group. The groups array counts the routes longer than 24 bits of each
+ * group; the groups whose count is 0 are free.
+ *
+ * The datapath finds the length of the longest matching prefix in the
+ * arrays, and then the route in the hash map from the masked address.
+ *
+ * This file is included by ebpf_kernel.h and ebpf_test.h after the
+ * definitions of the BPF_USER_MAP_* macros.
+ */
+
+#ifndef BACKENDS_EBPF_RUNTIME_EBPF_DIR24_8_H_
+#define BACKENDS_EBPF_RUNTIME_EBPF_DIR24_8_H_
+
+#define DIR24_8_GROUP 0x80000000u
+#define DIR24_8_INDEX 0x00ffffffu
+
+/* The layout of the key of the route hash map */
+struct dir24_8_prefix {
+    u32 prefixlen;
+    u32 addr;
+};
+
+/* The maps of a table */
+struct dir24_8_maps {
+    int rules;          // the route hash map
+    int tbl24;
+    int tbl8;
+    int groups;
+    u32 max_groups;     // the number of groups of tbl8
+    u32 value_size;     // the size of the values of the route map
+};
+
+static inline u32 dir24_8_mask(u32 prefixlen) {
+    return prefixlen ? 0xffffffffu << (32 - prefixlen) : 0;
+}
+
+static inline int dir24_8_set(int fd, u32 index, u32 entry) {
+    return BPF_USER_MAP_UPDATE_ELEM(fd, &index, &entry, BPF_ANY);
+}
+
+static inline int dir24_8_get(int fd, u32 index, u32 *entry) {
+    return BPF_USER_MAP_LOOKUP_ELEM(fd, &index, entry);
+}
+
+/* True if the map has a route for the prefix of addr of this length */
+static inline int dir24_8_has_route(const struct dir24_8_maps *maps, u32 prefixlen, u32 addr) {
+    struct dir24_8_prefix key = { prefixlen, addr & dir24_8_mask(prefixlen) };
+    unsigned char value[maps->value_size];
+    return BPF_USER_MAP_LOOKUP_ELEM(maps->rules, &key, value) == 0;
+}
+
+/* The entry of the longest route shorter than prefixlen that matches addr */
+static inline u32 dir24_8_covering(const struct dir24_8_maps *maps, u32 prefixlen, u32 addr) {
+    for (u32 length = prefixlen; length-- > 0; ) {
+        if (dir24_8_has_route(maps, length, addr))
+            return length + 1;
+    }
+    return 0;
+}
+
+/* Sets to entry the count entries of the array fd from first whose value is
+   between low and high, including those of the groups they point to */
+static inline int dir24_8_fill(const struct dir24_8_maps *maps, int fd, u32 first, u32 count,
+                               u32 low, u32 high, u32 entry) {
+    for (u32 i = first; i - first < count; i++) {
+        u32 current;
+        if (dir24_8_get(fd, i, &current) != 0)
+            return -1;
+        if (fd == maps->tbl24 && (current & DIR24_8_GROUP)) {
+            if (dir24_8_fill(maps, maps->tbl8, (current & DIR24_8_INDEX) << 8, 256,
+                             low, high, entry) != 0)
+                return -1;
+        } else if (current >= low && current <= high && dir24_8_set(fd, i, entry) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Adds 1 (or -1) to the number of routes of a group, and returns the new number */
+static inline int dir24_8_count(const struct dir24_8_maps *maps, u32 group, int change) {
+    u32 count;
+    if (dir24_8_get(maps->groups, group, &count) != 0)
+        return -1;
+    count += change;
+    if (dir24_8_set(maps->groups, group, count) != 0)
+        return -1;
+    return count;
+}
+
+/* The group of the /24 prefix of addr, which is allocated if there is none */
+static inline int dir24_8_group(const struct dir24_8_maps *maps, u32 addr, u32 *group) {
+    u32 current;
+    if (dir24_8_get(maps->tbl24, addr >> 8, &current) != 0)
+        return -1;
+    if (current & DIR24_8_GROUP) {
+        *group = current & DIR24_8_INDEX;
+        return 0;
+    }
+    for (u32 g = 0; g < maps->max_groups; g++) {
+        u32 count;
+        if (dir24_8_get(maps->groups, g, &count) != 0)
+            return -1;
+        if (count != 0)
+            continue;
+        /* The addresses of the group match the route of the /24 prefix */
+        for (u32 i = 0; i < 256; i++) {
+            if (dir24_8_set(maps->tbl8, (g << 8) | i, current) != 0)
+                return -1;
+        }
+        *group = g;
+        return dir24_8_set(maps->tbl24, addr >> 8, DIR24_8_GROUP | g);
+    }
+    fprintf(stderr, "No free group for a route longer than 24 bits\n");
+    return -1;
+}
+
+/**
+ * @brief Add or update a route.
+ * @details Writes the value of the route addr/prefixlen in the route map, and,
+ * if the route is new, makes the entries of the addresses for which it is the
+ * longest matching prefix point to it.
+ *
+ * @return 0 on success
+ */
+static inline int dir24_8_insert(const struct dir24_8_maps *maps, u32 prefixlen, u32 addr,
+                                 void *value) {
+    if (prefixlen > 32)
+        return -1;
+    addr &= dir24_8_mask(prefixlen);
+    struct dir24_8_prefix key = { prefixlen, addr };
+    int exists = dir24_8_has_route(maps, prefixlen, addr);
+    if (BPF_USER_MAP_UPDATE_ELEM(maps->rules, &key, value, BPF_ANY) != 0)
+        return -1;
+    if (exists)
+        return 0;
+    u32 entry = prefixlen + 1;
+    if (prefixlen <= 24)
+        return dir24_8_fill(maps, maps->tbl24, addr >> 8, 1u << (24 - prefixlen),
+                            0, entry, entry);
+    u32 group;
+    if (dir24_8_group(maps, addr, &group) != 0 || dir24_8_count(maps, group, 1) < 0) {
+        BPF_USER_MAP_DELETE_ELEM(maps->rules, &key);
+        return -1;
+    }
+    return dir24_8_fill(maps, maps->tbl8, (group << 8) | (addr & 0xff),
+                        1u << (32 - prefixlen), 0, entry, entry);
+}
+
+/**
+ * @brief Delete a route.
+ * @details Removes the route addr/prefixlen from the route map, and makes the
+ * entries that pointed to it point to the longest shorter route that matches,
+ * if any. A group is freed when its last route is deleted.
+ *
+ * @return 0 on success, or if the route does not exist
+ */
+static inline int dir24_8_delete(const struct dir24_8_maps *maps, u32 prefixlen, u32 addr) {
+    if (prefixlen > 32)
+        return -1;
+    addr &= dir24_8_mask(prefixlen);
+    struct dir24_8_prefix key = { prefixlen, addr };
+    if (!dir24_8_has_route(maps, prefixlen, addr))
+        return 0;
+    if (BPF_USER_MAP_DELETE_ELEM(maps->rules, &key) != 0)
+        return -1;
+    u32 entry = prefixlen + 1;
+    u32 replacement = dir24_8_covering(maps, prefixlen, addr);
+    if (prefixlen <= 24)
+        return dir24_8_fill(maps, maps->tbl24, addr >> 8, 1u << (24 - prefixlen),
+                            entry, entry, replacement);
+    u32 group, first;
+    if (dir24_8_group(maps, addr, &group) != 0 ||
+        dir24_8_fill(maps, maps->tbl8, (group << 8) | (addr & 0xff), 1u << (32 - prefixlen),
+                     entry, entry, replacement) != 0)
+        return -1;
+    int count = dir24_8_count(maps, group, -1);
+    if (count != 0)
+        return count < 0 ? -1 : 0;
+    /* Without longer routes, all the addresses of the group match the same route */
+    if (dir24_8_get(maps->tbl8, group << 8, &first) != 0)
+        return -1;
+    return dir24_8_set(maps->tbl24, addr >> 8, first);
+}
+
+#endif  // BACKENDS_EBPF_RUNTIME_EBPF_DIR24_8_H_
@@ -48,11 +48,30 @@ limitations under the License.
 #ifdef CONTROL_PLANE // BEGIN EBPF USER SPACE DEFINITIONS
 
 #include "bpf.h" // bpf_obj_get/pin, bpf_map_update_elem
+#include "libbpf.h" // libbpf_num_possible_cpus
 
 #define BPF_USER_MAP_UPDATE_ELEM(index, key, value, flags)\
     bpf_map_update_elem(index, key, value, flags)
+/* For per-CPU maps, value receives the value of each possible CPU */
+#define BPF_USER_MAP_LOOKUP_ELEM(index, key, value)\
+    bpf_map_lookup_elem(index, key, value)
+#define BPF_USER_MAP_DELETE_ELEM(index, key)\
+    bpf_map_delete_elem(index, key)
+#define BPF_USER_NUM_CPUS() libbpf_num_possible_cpus()
+/* Fails on kernels and maps without batch operations; *count receives the number of
+ * elements written */
+#define BPF_USER_MAP_UPDATE_BATCH(index, keys, values, count)\
+    bpf_map_update_batch(index, keys, values, count, NULL)
 #define BPF_OBJ_PIN(table, name) bpf_obj_pin(table, name)
 #define BPF_OBJ_GET(name) bpf_obj_get(name)
+/* The ring buffer is mapped in user space: each consume call passes all the available
+ * records to the callback without system calls */
+#define BPF_USER_RINGBUF_NEW(index, callback, ctx) \
+    ring_buffer__new(index, callback, ctx, NULL)
+#define BPF_USER_RINGBUF_CONSUME(reader) ring_buffer__consume(reader)
+#define BPF_USER_RINGBUF_FREE(reader) ring_buffer__free(reader)
+
+#include "ebpf_dir24_8.h"  // control plane of the @dir_24_8 tables
 
 #else // BEGIN EBPF KERNEL DEFINITIONS
 
@@ -91,6 +110,18 @@ struct bpf_elf_map SEC("maps") NAME = {          \
     .flags       = 0,                \
 };
 #define REGISTER_END()
+/* The loader stores the programs of the sections "ID/INDEX" in the array with this id */
+#define REGISTER_PROG_ARRAY(NAME, ID, MAX_ENTRIES) \
+struct bpf_elf_map SEC("maps") NAME = {          \
+    .type        = BPF_MAP_TYPE_PROG_ARRAY, \
+    .size_key    = sizeof(u32),      \
+    .size_value  = sizeof(u32),      \
+    .max_elem    = MAX_ENTRIES,      \
+    .pinning     = 2,                \
+    .id          = ID,               \
+};
+#define BPF_TAIL_CALL(ctx, table, index) \
+    bpf_tail_call(ctx, &table, index)
 
 #define BPF_MAP_LOOKUP_ELEM(table, key) \
     bpf_map_lookup_elem(&table, key)
@@ -98,6 +129,10 @@ struct bpf_elf_map SEC("maps") NAME = {          \
     bpf_map_update_elem(&table, key, value, flags)
 #define BPF_MAP_DELETE_ELEM(table, key) \
     bpf_map_delete_elem(&table, key)
+#define BPF_RINGBUF_RESERVE(table, size) \
+    bpf_ringbuf_reserve(&table, size, 0)
+#define BPF_RINGBUF_SUBMIT(data) \
+    bpf_ringbuf_submit(data, 0)
 #define BPF_USER_MAP_UPDATE_ELEM(index, key, value, flags)\
     bpf_update_elem(index, key, value, flags)
 #define BPF_OBJ_PIN(table, name) bpf_obj_pin(table, name)
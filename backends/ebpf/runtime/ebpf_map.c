@@ -14,11 +14,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+
 /*
 Implementation of userlevel eBPF map structure. Emulates the linux kernel bpf maps.
 */
 
-#include <assert.h>
 #include <stdio.h>
 #include "ebpf_map.h"
 
@@ -41,51 +41,355 @@ static int check_flags(void *elem, unsigned long long map_flags) {
     return EXIT_SUCCESS;
 }
 
-void *bpf_map_lookup_elem(struct bpf_map *map, void *key, unsigned int key_size) {
-    struct bpf_map *tmp_map;
-    HASH_FIND(hh, map, key, key_size, tmp_map);
-    if (tmp_map == NULL)
+static int is_array(const struct bpf_map *map) {
+    return map->type == BPF_MAP_TYPE_ARRAY || map->type == BPF_MAP_TYPE_PERCPU_ARRAY;
+}
+
+/* FNV-1a */
+static uint32_t hash_key(const unsigned char *key, unsigned int key_size) {
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < key_size; i++)
+        hash = (hash ^ key[i]) * 16777619u;
+    return hash;
+}
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address)
+#endif
+
+/* Size of the header of the records of ring buffers */
+#define RINGBUF_HEADER_SIZE 8ull
+
+/* Number of keys of a batch whose slots are prefetched together */
+#define LOOKUP_BATCH 16
+
+static unsigned char *pool_key(const struct bpf_map *map, uint32_t index) {
+    return map->keys + (size_t) index * map->key_size;
+}
+
+static unsigned char *pool_value(const struct bpf_map *map, uint32_t index) {
+    return map->values + (size_t) index * map->value_size;
+}
+
+/* The slot of the key, or of the empty slot where it would be inserted */
+static uint32_t find_slot(const struct bpf_map *map, const unsigned char *key, uint32_t hash) {
+    uint32_t slot = hash & map->mask;
+    while (map->slots[slot] != 0) {
+        if (map->hashes[slot] == hash &&
+            memcmp(pool_key(map, map->slots[slot] - 1), key, map->key_size) == 0)
+            break;
+        slot = (slot + 1) & map->mask;
+    }
+    return slot;
+}
+
+/* Removes the element of a slot, moving back the following elements of its probe
+   sequence, so that there are no tombstones */
+static void remove_slot(struct bpf_map *map, uint32_t slot) {
+    uint32_t index = map->slots[slot] - 1;
+    map->free_list[index] = map->first_free;
+    map->first_free = index;
+    map->count--;
+    uint32_t next = slot;
+    for (;;) {
+        map->slots[slot] = 0;
+        for (;;) {
+            next = (next + 1) & map->mask;
+            if (map->slots[next] == 0)
+                return;
+            uint32_t home = map->hashes[next] & map->mask;
+            /* The element can move to the hole if its home is not between them */
+            if (((next - home) & map->mask) >= ((next - slot) & map->mask))
+                break;
+        }
+        map->slots[slot] = map->slots[next];
+        map->hashes[slot] = map->hashes[next];
+        slot = next;
+    }
+}
+
+/* LPM keys: the prefix length, then the data */
+static uint32_t prefix_length(const unsigned char *key) {
+    uint32_t length;
+    memcpy(&length, key, sizeof(length));
+    return length;
+}
+
+static uint32_t max_prefix_length(const struct bpf_map *map) {
+    return (map->key_size - sizeof(uint32_t)) * 8;
+}
+
+/* Copies the key, masked to the given prefix length */
+static void mask_key(const struct bpf_map *map, const unsigned char *key, uint32_t length,
+                     unsigned char *masked) {
+    memcpy(masked, &length, sizeof(length));
+    const unsigned char *data = key + sizeof(length);
+    unsigned char *masked_data = masked + sizeof(length);
+    for (unsigned int i = 0; i < map->key_size - sizeof(length); i++) {
+        if (length >= 8 * (i + 1))
+            masked_data[i] = data[i];
+        else if (length > 8 * i)
+            masked_data[i] = data[i] & (unsigned char) (0xff << (8 - (length - 8 * i)));
+        else
+            masked_data[i] = 0;
+    }
+}
+
+struct bpf_map *bpf_map_create(unsigned int type, unsigned int key_size,
+                               unsigned int value_size, unsigned int max_entries) {
+    struct bpf_map *map = calloc(1, sizeof(struct bpf_map));
+    if (!map)
+        return NULL;
+    map->type = type;
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->max_entries = max_entries;
+    map->values = calloc(max_entries ? max_entries : 1, value_size ? value_size : 1);
+    if (!map->values) {
+        bpf_map_delete_map(map);
+        return NULL;
+    }
+    if (is_array(map))
+        return map;
+    if (type == BPF_MAP_TYPE_RINGBUF) {
+        if (key_size != 0 || value_size != 0 || max_entries < RINGBUF_HEADER_SIZE ||
+            (max_entries & (max_entries - 1)) != 0) {
+            fprintf(stderr, "Error: the size of a ring buffer must be a power of 2\n");
+            bpf_map_delete_map(map);
+            return NULL;
+        }
+        return map;
+    }
+    if (type == BPF_MAP_TYPE_LPM_TRIE && key_size < sizeof(uint32_t)) {
+        fprintf(stderr, "Error: LPM keys must start with a 32-bit prefix length\n");
+        bpf_map_delete_map(map);
+        return NULL;
+    }
+
+    /* At most half of the slots are used */
+    unsigned int slots = 8;
+    while (slots < 2 * max_entries)
+        slots *= 2;
+    map->mask = slots - 1;
+    map->slots = calloc(slots, sizeof(uint32_t));
+    map->hashes = calloc(slots, sizeof(uint32_t));
+    map->keys = calloc(max_entries ? max_entries : 1, key_size ? key_size : 1);
+    map->free_list = calloc(max_entries ? max_entries : 1, sizeof(uint32_t));
+    if (type == BPF_MAP_TYPE_LPM_TRIE)
+        map->prefixes = calloc(max_prefix_length(map) + 1, sizeof(unsigned int));
+    if (!map->slots || !map->hashes || !map->keys || !map->free_list ||
+        (type == BPF_MAP_TYPE_LPM_TRIE && !map->prefixes)) {
+        bpf_map_delete_map(map);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < max_entries; i++)
+        map->free_list[i] = i + 1;
+    map->first_free = 0;
+    return map;
+}
+
+void *bpf_map_lookup_elem(struct bpf_map *map, const void *key) {
+    if (is_array(map)) {
+        uint32_t index;
+        memcpy(&index, key, sizeof(index));
+        return index < map->max_entries ? pool_value(map, index) : NULL;
+    }
+    if (map->count == 0)
+        return NULL;
+    if (map->type == BPF_MAP_TYPE_LPM_TRIE) {
+        unsigned char masked[map->key_size];
+        uint32_t length = prefix_length(key);
+        uint32_t max = max_prefix_length(map);
+        for (uint32_t l = length < max ? length : max; ; l--) {
+            if (map->prefixes[l] != 0) {
+                mask_key(map, key, l, masked);
+                uint32_t slot = find_slot(map, masked, hash_key(masked, map->key_size));
+                if (map->slots[slot] != 0)
+                    return pool_value(map, map->slots[slot] - 1);
+            }
+            if (l == 0)
+                return NULL;
+        }
+    }
+    uint32_t slot = find_slot(map, key, hash_key(key, map->key_size));
+    if (map->slots[slot] == 0)
         return NULL;
-    return tmp_map->value;
+    return pool_value(map, map->slots[slot] - 1);
+}
+
+void bpf_map_lookup_elems(struct bpf_map *map, const void *keys, unsigned int count,
+                          void **values) {
+    const unsigned char *key = keys;
+    if (is_array(map) || map->type == BPF_MAP_TYPE_LPM_TRIE || map->count == 0) {
+        for (unsigned int i = 0; i < count; i++)
+            values[i] = bpf_map_lookup_elem(map, key + (size_t) i * map->key_size);
+        return;
+    }
+    uint32_t hashes[LOOKUP_BATCH];
+    for (unsigned int first = 0; first < count; first += LOOKUP_BATCH) {
+        unsigned int n = count - first < LOOKUP_BATCH ? count - first : LOOKUP_BATCH;
+        const unsigned char *batch = key + (size_t) first * map->key_size;
+        /* Fetch the home slots of all the keys, then the keys they point to,
+           so that the cache misses of the batch overlap */
+        for (unsigned int i = 0; i < n; i++) {
+            hashes[i] = hash_key(batch + (size_t) i * map->key_size, map->key_size);
+            PREFETCH(&map->slots[hashes[i] & map->mask]);
+            PREFETCH(&map->hashes[hashes[i] & map->mask]);
+        }
+        for (unsigned int i = 0; i < n; i++) {
+            uint32_t slot = hashes[i] & map->mask;
+            if (map->slots[slot] != 0 && map->hashes[slot] == hashes[i])
+                PREFETCH(pool_key(map, map->slots[slot] - 1));
+        }
+        for (unsigned int i = 0; i < n; i++) {
+            uint32_t slot = find_slot(map, batch + (size_t) i * map->key_size, hashes[i]);
+            values[first + i] =
+                map->slots[slot] == 0 ? NULL : pool_value(map, map->slots[slot] - 1);
+        }
+    }
 }
 
-int bpf_map_update_elem(struct bpf_map **map, void *key, unsigned int key_size, void *value, unsigned int value_size, unsigned long long flags) {
-    struct bpf_map *tmp_map;
-    HASH_FIND(hh, *map, key, key_size, tmp_map);
-    int ret = check_flags(tmp_map, flags);
+int bpf_map_update_elem(struct bpf_map *map, const void *key, const void *value,
+                        unsigned long long flags) {
+    if (map->type == BPF_MAP_TYPE_RINGBUF)
+        return EXIT_FAILURE;
+    if (is_array(map)) {
+        void *elem = bpf_map_lookup_elem(map, key);
+        /* The elements of arrays always exist */
+        if (!elem || check_flags(elem, flags))
+            return EXIT_FAILURE;
+        memcpy(elem, value, map->value_size);
+        return EXIT_SUCCESS;
+    }
+
+    unsigned char masked[map->key_size];
+    if (map->type == BPF_MAP_TYPE_LPM_TRIE) {
+        /* Only the bits of the prefix are part of the key */
+        uint32_t length = prefix_length(key);
+        if (length > max_prefix_length(map))
+            return EXIT_FAILURE;
+        mask_key(map, key, length, masked);
+        key = masked;
+    }
+    uint32_t hash = hash_key(key, map->key_size);
+    uint32_t slot = find_slot(map, key, hash);
+    void *elem = map->slots[slot] ? pool_value(map, map->slots[slot] - 1) : NULL;
+    int ret = check_flags(elem, flags);
     if (ret)
         return ret;
-    if (tmp_map == NULL) {
-        tmp_map = (struct bpf_map *) malloc(sizeof(struct bpf_map));
-        tmp_map->key = malloc(key_size);
-        memcpy(tmp_map->key, key, key_size);
-        HASH_ADD_KEYPTR(hh, *map, tmp_map->key, key_size, tmp_map);
-    }
-    tmp_map->value = malloc(value_size);
-    memcpy(tmp_map->value, value, value_size);
+    if (elem == NULL) {
+        if (map->count == map->max_entries) {
+            if (map->type != BPF_MAP_TYPE_LRU_HASH || map->count == 0)
+                return EXIT_FAILURE;
+            /* Evict the element that follows in the table; the emulation does not
+               track the recently used elements */
+            uint32_t victim = slot;
+            while (map->slots[victim] == 0)
+                victim = (victim + 1) & map->mask;
+            if (map->prefixes)
+                map->prefixes[prefix_length(pool_key(map, map->slots[victim] - 1))]--;
+            remove_slot(map, victim);
+            slot = find_slot(map, key, hash);
+        }
+        uint32_t index = map->first_free;
+        map->first_free = map->free_list[index];
+        memcpy(pool_key(map, index), key, map->key_size);
+        map->slots[slot] = index + 1;
+        map->hashes[slot] = hash;
+        map->count++;
+        if (map->prefixes)
+            map->prefixes[prefix_length(key)]++;
+        elem = pool_value(map, index);
+    }
+    memcpy(elem, value, map->value_size);
     return EXIT_SUCCESS;
 }
 
-int bpf_map_delete_elem(struct bpf_map *map, void *key, unsigned int key_size) {
-    struct bpf_map *tmp_map;
-    HASH_FIND(hh, map, key, key_size, tmp_map);
-    if (tmp_map != NULL) {
-        HASH_DEL(map, tmp_map);
-        free(tmp_map->value);
-        free(tmp_map->key);
-        free(tmp_map);
+int bpf_map_delete_elem(struct bpf_map *map, const void *key) {
+    if (is_array(map) || map->type == BPF_MAP_TYPE_RINGBUF)
+        return EXIT_FAILURE;
+    unsigned char masked[map->key_size];
+    if (map->type == BPF_MAP_TYPE_LPM_TRIE) {
+        uint32_t length = prefix_length(key);
+        if (length > max_prefix_length(map))
+            return EXIT_FAILURE;
+        mask_key(map, key, length, masked);
+        key = masked;
+    }
+    uint32_t slot = find_slot(map, key, hash_key(key, map->key_size));
+    if (map->slots[slot] != 0) {
+        if (map->prefixes)
+            map->prefixes[prefix_length(key)]--;
+        remove_slot(map, slot);
     }
     return EXIT_SUCCESS;
 }
 
-int bpf_map_delete_map(struct bpf_map *map) {
-    struct bpf_map *curr_map, *tmp_map;
-    HASH_ITER(hh, map, curr_map, tmp_map) {
-        HASH_DEL(map, curr_map);
-        free(curr_map->value);
-        free(curr_map->key);
-        free(curr_map);
+/* Ring buffer records: a header with the length of the data and these flags,
+   then the data, padded to a multiple of the header size */
+#define RINGBUF_BUSY (1u << 31)     // reserved, not yet submitted
+#define RINGBUF_DISCARD (1u << 30)  // skipped by the consumer
+
+static uint32_t *ringbuf_header(struct bpf_map *map, unsigned long long position) {
+    return (uint32_t *) (map->values + (position & (map->max_entries - 1)));
+}
+
+void *bpf_ringbuf_reserve(struct bpf_map *map, unsigned long long size) {
+    if (map->type != BPF_MAP_TYPE_RINGBUF || size >= RINGBUF_DISCARD)
+        return NULL;
+    unsigned long long total = (size + 2 * RINGBUF_HEADER_SIZE - 1) & ~(RINGBUF_HEADER_SIZE - 1);
+    unsigned long long tail = map->max_entries - (map->producer & (map->max_entries - 1));
+    /* A record does not wrap around: the end of the buffer is skipped instead */
+    unsigned long long skip = tail < total ? tail : 0;
+    if (map->producer + skip + total - map->consumer > map->max_entries)
+        return NULL;
+    if (skip) {
+        *ringbuf_header(map, map->producer) = (uint32_t) (skip - RINGBUF_HEADER_SIZE) |
+                                              RINGBUF_DISCARD;
+        map->producer += skip;
     }
+    uint32_t *header = ringbuf_header(map, map->producer);
+    *header = (uint32_t) size | RINGBUF_BUSY;
+    map->producer += total;
+    return (unsigned char *) header + RINGBUF_HEADER_SIZE;
+}
+
+void bpf_ringbuf_submit(void *data, unsigned long long flags) {
+    (void) flags;
+    *(uint32_t *) ((unsigned char *) data - RINGBUF_HEADER_SIZE) &= ~RINGBUF_BUSY;
+}
+
+int bpf_ringbuf_consume(struct bpf_map *map,
+                        int (*callback)(void *ctx, void *data, size_t size), void *ctx) {
+    int count = 0;
+    while (map->consumer < map->producer) {
+        uint32_t *header = ringbuf_header(map, map->consumer);
+        if (*header & RINGBUF_BUSY)
+            break;
+        uint32_t size = *header & ~RINGBUF_DISCARD;
+        int discard = (*header & RINGBUF_DISCARD) != 0;
+        map->consumer += (size + 2 * RINGBUF_HEADER_SIZE - 1) & ~(RINGBUF_HEADER_SIZE - 1);
+        if (discard)
+            continue;
+        int ret = callback(ctx, (unsigned char *) header + RINGBUF_HEADER_SIZE, size);
+        if (ret < 0)
+            return ret;
+        count++;
+    }
+    return count;
+}
+
+int bpf_map_delete_map(struct bpf_map *map) {
+    if (!map)
+        return EXIT_SUCCESS;
+    free(map->slots);
+    free(map->hashes);
+    free(map->keys);
+    free(map->values);
+    free(map->free_list);
+    free(map->prefixes);
     free(map);
     return EXIT_SUCCESS;
 }
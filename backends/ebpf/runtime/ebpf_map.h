@@ -14,49 +14,137 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+
 /*
- * This file defines a library of simple hashmap operations which emulate the behavior
+ * This file defines a library of simple map operations which emulate the behavior
  * of the kernel ebpf map API. This library is currently not thread-safe.
  */
 
 #ifndef BACKENDS_EBPF_RUNTIME_EBPF_MAP_H_
 #define BACKENDS_EBPF_RUNTIME_EBPF_MAP_H_
 
-#include "contrib/uthash.h"  // exports string.h, stddef.h, and stdlib.h
+#include <stdint.h>
+#include <stdlib.h>     // EXIT_SUCCESS, EXIT_FAILURE
+#include <string.h>
+
+/* Supported bpf map types. Per-CPU maps have a single value, since the
+ * user-space runtime runs on one thread. */
+enum bpf_map_type {
+    BPF_MAP_TYPE_HASH,
+    BPF_MAP_TYPE_ARRAY,
+    BPF_MAP_TYPE_LPM_TRIE,
+    BPF_MAP_TYPE_PERCPU_HASH,
+    BPF_MAP_TYPE_PERCPU_ARRAY,
+    BPF_MAP_TYPE_LRU_HASH,
+    BPF_MAP_TYPE_RINGBUF,
+};
 
+/**
+ * A map with a fixed capacity of max_entries elements, like the kernel maps.
+ * The keys of hash and LPM maps are in an open-addressing table with linear
+ * probing. The values are in a separate pool, so the pointers returned by
+ * bpf_map_lookup_elem stay valid until the element is deleted.
+ * The keys of LPM maps start with a 32-bit prefix length, followed by the
+ * data, most significant byte first. An LPM map keeps the number of entries
+ * of each prefix length, and a lookup probes the masked key for each used
+ * prefix length, the longest first.
+ * Ring buffers have no elements: values holds max_entries bytes of records,
+ * each after an 8-byte header with its length, written at the producer
+ * position and read at the consumer position.
+ */
 struct bpf_map {
-    void *key;
-    void *value;
-    UT_hash_handle hh;  // makes this structure hashable
+    unsigned int type;
+    unsigned int key_size;
+    unsigned int value_size;
+    unsigned int max_entries;
+    unsigned int count;         // number of elements
+    unsigned int mask;          // number of slots - 1
+    uint32_t *slots;            // 1 + index of the element in the pool, 0 if empty
+    uint32_t *hashes;           // hash of the key in each slot
+    unsigned char *keys;        // pool of keys
+    unsigned char *values;      // pool of values
+    uint32_t *free_list;        // next free element of the pool
+    uint32_t first_free;
+    unsigned int *prefixes;     // LPM maps: number of elements per prefix length
+    unsigned long long producer;    // ring buffers: bytes reserved so far
+    unsigned long long consumer;    // ring buffers: bytes consumed so far
 };
 
+/**
+ * @brief Create a map.
+ * @details Allocates a map of one of the supported types. Arrays are indexed
+ * by a 32-bit key and their max_entries values are initialized to zero.
+ *
+ * @return NULL if the map cannot be allocated.
+ */
+struct bpf_map *bpf_map_create(unsigned int type, unsigned int key_size,
+                               unsigned int value_size, unsigned int max_entries);
+
 /**
  * @brief Add/Update a value in the map
  * @details Updates a value in the map based on the provided key.
  * If the key does not exist, it depends the provided flags if the
- * element is added or the operation is rejected.
+ * element is added or the operation is rejected. Adding an element to a
+ * full map fails, except for LRU maps, which evict an element.
  *
  * @return EXIT_FAILURE if update operation fails
  */
-int bpf_map_update_elem(struct bpf_map **map, void *key, unsigned int key_size, void *value,unsigned int value_size, unsigned long long flags);
+int bpf_map_update_elem(struct bpf_map *map, const void *key, const void *value,
+                        unsigned long long flags);
 
 /**
  * @brief Find a value based on a key.
  * @details Provides a pointer to a value in the map based on the provided key.
- * If the key does not exist, NULL is returned.
+ * If the key does not exist, NULL is returned. LPM maps return the value of the
+ * longest prefix that matches the key.
  *
  * @return NULL if key does not exist
  */
-void *bpf_map_lookup_elem(struct bpf_map *map, void *key, unsigned int key_size);
+void *bpf_map_lookup_elem(struct bpf_map *map, const void *key);
+
+/**
+ * @brief Find the values of several keys.
+ * @details Looks up the count keys stored one after the other in keys, and
+ * stores the pointers to their values, or NULL, in values. The keys of hash
+ * maps are processed in batches whose slots are prefetched together, so that
+ * a datapath that processes a vector of packets does not wait for each lookup.
+ */
+void bpf_map_lookup_elems(struct bpf_map *map, const void *keys, unsigned int count,
+                          void **values);
+
+/**
+ * @brief Reserve a record in a ring buffer.
+ * @details Reserves size bytes at the producer position of the ring buffer.
+ * The record is invisible to the consumer until it is submitted.
+ *
+ * @return NULL if the ring buffer is full.
+ */
+void *bpf_ringbuf_reserve(struct bpf_map *map, unsigned long long size);
+
+/**
+ * @brief Submit a record reserved in a ring buffer.
+ */
+void bpf_ringbuf_submit(void *data, unsigned long long flags);
+
+/**
+ * @brief Consume the records of a ring buffer.
+ * @details Calls callback for each submitted record, in order, until the
+ * first record that is still reserved or a callback returns a negative value.
+ *
+ * @return the number of records consumed, or the error of the callback.
+ */
+int bpf_ringbuf_consume(struct bpf_map *map,
+                        int (*callback)(void *ctx, void *data, size_t size), void *ctx);
 
 /**
  * @brief Delete key and value from the map.
  * @details Deletes the key and the corresponding value from the map.
- * If the key does not exist, no operation is performed.
+ * If the key does not exist, no operation is performed. The elements of
+ * arrays cannot be deleted.
  *
  * @return EXIT_FAILURE if operation fails.
  */
-int bpf_map_delete_elem(struct bpf_map *map, void *key, unsigned int key_size);
+int bpf_map_delete_elem(struct bpf_map *map, const void *key);
 
 /**
  * @brief Delete the entire map at once.
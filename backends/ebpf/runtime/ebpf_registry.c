@@ -19,26 +19,28 @@ Implementation of ebpf registry. Intended to provide a common access interface b
 */
 
 #include <stdio.h>
+#include <string.h>
 #include "ebpf_registry.h"
+#include "contrib/uthash.h"
 
 /**
  * @brief Defines the structure of the central registry.
- * @details Defines a registry type, which maps names to tables
- * as well as integer identifiers.
+ * @details Defines a registry type, which maps names to tables.
+ * The ids index an array of the entries.
  */
 typedef struct {
     char name[MAX_TABLE_NAME_LENGTH];   // name of the map
     struct bpf_table *tbl;            // ptr to the map
     int handle;                         // id of the map
     UT_hash_handle h_name;              // the hash handle for names
-    UT_hash_handle h_id;                // the hash handle for ids
 } registry_entry;
 
 static int table_indexer = 0;
 
-/* Instantiation of the central registry by id and name */
+/* Instantiation of the central registry by name and id */
 static registry_entry *reg_tables_name = NULL;
-static registry_entry *reg_tables_id = NULL;
+static registry_entry **reg_tables_id = NULL;
+static int reg_tables_capacity = 0;
 
 static registry_entry *find_register(const char *name) {
     if (strlen(name) > MAX_TABLE_NAME_LENGTH){
@@ -62,19 +64,35 @@ int registry_add(struct bpf_table *tbl) {
         fprintf(stderr, "Error: Key name %s exceeds maximum size %d", tbl->name, MAX_TABLE_NAME_LENGTH);
         return EXIT_FAILURE;
     }
+    /* Create the map */
+    tbl->bpf_map = bpf_map_create(tbl->type, tbl->key_size, tbl->value_size, tbl->max_entries);
+    if (!tbl->bpf_map) {
+        fprintf(stderr, "Error: Could not create the map of table %s\n", tbl->name);
+        return EXIT_FAILURE;
+    }
     /* Add the table */
-    tmp_reg = malloc(sizeof(registry_entry));
+    tmp_reg = calloc(1, sizeof(registry_entry));
     if (!tmp_reg) {
         perror("Fatal: Could not allocate memory\n");
         exit(EXIT_FAILURE);
     }
+    if (table_indexer == reg_tables_capacity) {
+        int capacity = reg_tables_capacity ? 2 * reg_tables_capacity : 16;
+        registry_entry **ids = realloc(reg_tables_id, capacity * sizeof(registry_entry *));
+        if (!ids) {
+            perror("Fatal: Could not allocate memory\n");
+            exit(EXIT_FAILURE);
+        }
+        reg_tables_id = ids;
+        reg_tables_capacity = capacity;
+    }
     /* Do not forget to actually copy the values to the entry... */
     memcpy(tmp_reg->name, tbl->name, strlen(tbl->name));
     tmp_reg->handle = table_indexer;
     tmp_reg->tbl = tbl;
     /* Add the id and name to the registry. */
     HASH_ADD(h_name, reg_tables_name, name, strlen(tbl->name), tmp_reg);
-    HASH_ADD(h_id, reg_tables_id, handle, sizeof(int), tmp_reg);
+    reg_tables_id[table_indexer] = tmp_reg;
     table_indexer++;
     return EXIT_SUCCESS;
 }
@@ -84,21 +102,23 @@ void registry_delete() {
     HASH_ITER(h_name, reg_tables_name, curr_tbl, tmp_tbl) {
         HASH_DELETE(h_name, reg_tables_name, curr_tbl);
         bpf_map_delete_map(curr_tbl->tbl->bpf_map);
+        curr_tbl->tbl->bpf_map = NULL;
         free(curr_tbl);
     }
-    curr_tbl = NULL;
-    tmp_tbl = NULL;
-    HASH_ITER(h_id, reg_tables_id, curr_tbl, tmp_tbl) {
-        HASH_DELETE(h_id, reg_tables_id, curr_tbl);
-    }
+    free(reg_tables_id);
+    reg_tables_id = NULL;
+    reg_tables_capacity = 0;
+    table_indexer = 0;
 }
 
 int registry_delete_tbl(const char *name) {
     registry_entry *tmp_reg = find_register(name);
     if (tmp_reg != NULL) {
         bpf_map_delete_map(tmp_reg->tbl->bpf_map);
+        tmp_reg->tbl->bpf_map = NULL;
         HASH_DELETE(h_name, reg_tables_name, tmp_reg);
-        HASH_DELETE(h_id, reg_tables_id, tmp_reg);
+        /* The ids are not reused */
+        reg_tables_id[tmp_reg->handle] = NULL;
         free(tmp_reg);
         return  EXIT_SUCCESS;
     }
@@ -113,11 +133,9 @@ struct bpf_table *registry_lookup_table(const char *name) {
 }
 
 struct bpf_table *registry_lookup_table_id(int tbl_id) {
-    registry_entry *tmp_reg;
-    HASH_FIND(h_id, reg_tables_id, &tbl_id, sizeof(int), tmp_reg);
-    if (tmp_reg == NULL)
+    if (tbl_id < 0 || tbl_id >= table_indexer || reg_tables_id[tbl_id] == NULL)
         return NULL;
-    return tmp_reg->tbl;
+    return reg_tables_id[tbl_id]->tbl;
 }
 
 int registry_update_table(const char *name, void *key, void *value, unsigned long long flags) {
@@ -125,7 +143,7 @@ int registry_update_table(const char *name, void *key, void *value, unsigned lon
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_update_elem(&tmp_tbl->bpf_map, key, tmp_tbl->key_size, value, tmp_tbl->value_size, flags);
+    return bpf_map_update_elem(tmp_tbl->bpf_map, key, value, flags);
 }
 
 int registry_update_table_id(int tbl_id, void *key, void *value, unsigned long long flags) {
@@ -133,7 +151,7 @@ int registry_update_table_id(int tbl_id, void *key, void *value, unsigned long l
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_update_elem(&tmp_tbl->bpf_map, key, tmp_tbl->key_size, value, tmp_tbl->value_size, flags);
+    return bpf_map_update_elem(tmp_tbl->bpf_map, key, value, flags);
 }
 
 int registry_delete_table_elem(const char *name, void *key) {
@@ -141,7 +159,7 @@ int registry_delete_table_elem(const char *name, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_delete_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);;
+    return bpf_map_delete_elem(tmp_tbl->bpf_map, key);
 }
 
 int registry_delete_table_elem_id(int tbl_id, void *key) {
@@ -149,7 +167,7 @@ int registry_delete_table_elem_id(int tbl_id, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_delete_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);;
+    return bpf_map_delete_elem(tmp_tbl->bpf_map, key);
 }
 
 void *registry_lookup_table_elem(const char *name, void *key) {
@@ -157,7 +175,19 @@ void *registry_lookup_table_elem(const char *name, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return NULL;
-    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);
+    tmp_tbl->lookups++;
+    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key);
+}
+
+int registry_lookup_table_elems(const char *name, void *keys, unsigned int count,
+                                void **values) {
+    struct bpf_table *tmp_tbl = registry_lookup_table(name);
+    if (tmp_tbl == NULL)
+        /* not found, return */
+        return EXIT_FAILURE;
+    tmp_tbl->lookups += count;
+    bpf_map_lookup_elems(tmp_tbl->bpf_map, keys, count, values);
+    return EXIT_SUCCESS;
 }
 
 void *registry_lookup_table_elem_id(int tbl_id, void *key) {
@@ -165,7 +195,50 @@ void *registry_lookup_table_elem_id(int tbl_id, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return NULL;
-    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);
+    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key);
+}
+
+int registry_read_table_elem_id(int tbl_id, void *key, void *value) {
+    struct bpf_table *tmp_tbl = registry_lookup_table_id(tbl_id);
+    if (tmp_tbl == NULL)
+        /* not found, return */
+        return EXIT_FAILURE;
+    void *elem = bpf_map_lookup_elem(tmp_tbl->bpf_map, key);
+    if (elem == NULL)
+        return EXIT_FAILURE;
+    memcpy(value, elem, tmp_tbl->value_size);
+    return EXIT_SUCCESS;
+}
+
+void *registry_ringbuf_reserve(const char *name, unsigned long long size) {
+    struct bpf_table *tmp_tbl = registry_lookup_table(name);
+    if (tmp_tbl == NULL)
+        /* not found, return */
+        return NULL;
+    return bpf_ringbuf_reserve(tmp_tbl->bpf_map, size);
+}
+
+struct ring_buffer *registry_ringbuf_new(int tbl_id, ring_buffer_sample_fn callback,
+                                         void *ctx) {
+    struct ring_buffer *reader = malloc(sizeof(struct ring_buffer));
+    if (reader == NULL)
+        return NULL;
+    reader->tbl_id = tbl_id;
+    reader->callback = callback;
+    reader->ctx = ctx;
+    return reader;
+}
+
+int registry_ringbuf_consume(struct ring_buffer *reader) {
+    struct bpf_table *tmp_tbl = registry_lookup_table_id(reader->tbl_id);
+    if (tmp_tbl == NULL)
+        /* not found, return */
+        return -1;
+    return bpf_ringbuf_consume(tmp_tbl->bpf_map, reader->callback, reader->ctx);
+}
+
+void registry_ringbuf_free(struct ring_buffer *reader) {
+    free(reader);
 }
 
 int registry_get_id(const char *name) {
@@ -32,25 +32,25 @@ limitations under the License.
  * @brief A helper structure used to describe attributes.
  * @details This structure describes various properties of the ebpf table
  * such as key and value size and the maximum amount of entries possible.
- * In userspace, this space is theoretically unlimited.
- * This table definition points to an actual hashmap managed by uthash,
- * the relation is many-to-one.
+ * The map is created when the table is added to the registry, and holds
+ * at most max_entries elements, like the kernel maps.
  * "name" should not exceed VAR_SIZE. Functions using bpf_table also assume
  * that "name" is a conventional null-terminated string.
  */
 struct bpf_table {
     char *name;                 // table name longer than VAR_SIZE is not accessed
-    unsigned int type;          // currently only hashmap is supported
+    unsigned int type;          // one of the bpf_map_type values
     unsigned int key_size;      // size of the key structure
     unsigned int value_size;    // size of the value structure
     unsigned int max_entries;   // Maximum of possible entries
-    struct bpf_map *bpf_map;    // Pointer to the actual hash map
+    struct bpf_map *bpf_map;    // Pointer to the actual map
+    unsigned long long lookups; // Number of lookups by the data plane, for benchmarks
 };
 
 /**
  * @brief Adds a new table to the registry.
- * @details Adds a new table to the shared registry and assigns
- * an id to it. This operation uses a char name stored in "table" as a key.
+ * @details Adds a new table to the shared registry, creates its map and
+ * assigns an id to it. This operation uses a char name stored in "table" as a key.
   * @return EXIT_FAILURE if map already exists or cannot be added.
  */
 int registry_add(struct bpf_table *tbl);
@@ -82,7 +82,7 @@ struct bpf_table *registry_lookup_table(const char *name);
 /**
  * @brief Retrieve a table from the registry.
  * @details Retrieves a table from the shared registry.
- * This operation uses an integer as the key.
+ * This operation uses an integer as the key, which indexes an array.
  * @return NULL if map cannot be found.
  */
 struct bpf_table *registry_lookup_table_id(int tbl_id);
@@ -143,11 +143,22 @@ int registry_delete_table_elem_id(int tbl_id, void *key);
  * where only the name is known. The function looks up the identifier
  * in the registry and calls bpf_map_lookup_elem on the retrieved list.
  * If there is no table, this function also returns NULL.
- * This operation uses a char name as the key.
+ * This operation uses a char name as the key, and is counted in the
+ * lookups of the table.
  * @return NULL if the value cannot be found.
  */
 void *registry_lookup_table_elem(const char *name, void *key);
 
+/**
+ * @brief Retrieve the values of several keys through the registry.
+ * @details Like registry_lookup_table_elem for the count keys stored one
+ * after the other in keys, through bpf_map_lookup_elems. The pointers to
+ * the values, or NULL, are stored in values.
+ * @return EXIT_FAILURE if the table cannot be found.
+ */
+int registry_lookup_table_elems(const char *name, void *keys, unsigned int count,
+                                void **values);
+
 /**
  * @brief Retrieve a value from a bpf map through the registry.
  * @details A wrapper function to retrieve a value from a hash map
@@ -159,4 +170,46 @@ void *registry_lookup_table_elem(const char *name, void *key);
  */
 void *registry_lookup_table_elem_id(int tbl_id, void *key);
 
+/**
+ * @brief Copy a value from a bpf map through the registry.
+ * @details Like registry_lookup_table_elem_id, but copies the value
+ * into the buffer pointed to by value, as the kernel bpf_map_lookup_elem
+ * call does.
+ * @return EXIT_FAILURE if the value cannot be found.
+ */
+int registry_read_table_elem_id(int tbl_id, void *key, void *value);
+
+/**
+ * @brief Reserve a record in a ring buffer through the registry.
+ * @details Calls bpf_ringbuf_reserve on the map of the table with this name.
+ * @return NULL if there is no such table or the ring buffer is full.
+ */
+void *registry_ringbuf_reserve(const char *name, unsigned long long size);
+
+/* The reader of a ring buffer, with the interface of the libbpf ring_buffer */
+typedef int (*ring_buffer_sample_fn)(void *ctx, void *data, size_t size);
+struct ring_buffer {
+    int tbl_id;
+    ring_buffer_sample_fn callback;
+    void *ctx;
+};
+
+/**
+ * @brief Create a reader of the ring buffer with this id.
+ * @return NULL if the reader cannot be allocated.
+ */
+struct ring_buffer *registry_ringbuf_new(int tbl_id, ring_buffer_sample_fn callback,
+                                         void *ctx);
+
+/**
+ * @brief Pass all the available records of a ring buffer to the callback of its reader.
+ * @return the number of records, or a negative value on errors.
+ */
+int registry_ringbuf_consume(struct ring_buffer *reader);
+
+/**
+ * @brief Free a reader of a ring buffer.
+ */
+void registry_ringbuf_free(struct ring_buffer *reader);
+
 #endif  // BACKENDS_EBPF_RUNTIME_EBPF_REGISTRY_H_
@@ -34,6 +34,7 @@ limitations under the License.
 #define DELIM   '_'
 
 static int debug = 0;
+static unsigned long benchmark = 0;
 
 void usage(char *name) {
     fprintf(stderr, "This program expects a pcap file pattern, "
@@ -41,9 +42,11 @@ void usage(char *name) {
             "in the order given by the packet time,"
             "then feeds the individual packets into a filter function, "
             "and returns the output.\n");
-    fprintf(stderr, "Usage: %s [-d] -f file.pcap -n num_pcaps\n", name);
+    fprintf(stderr, "Usage: %s [-d] [-b iterations] -f file.pcap -n num_pcaps\n", name);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "\t-d: Turn on debug messages\n");
+    fprintf(stderr, "\t-b: Run the packets through the program this many times "
+            "and report the speed\n");
     fprintf(stderr, "\t-f: The input pcap file\n");
     fprintf(stderr, "\t-n: Specifies the number of input pcap files\n");
     exit(EXIT_FAILURE);
@@ -87,6 +90,8 @@ void launch_runtime(const char *pcap_name, uint16_t num_pcaps) {
     sort_pcap_list(input_list);
     /* Run the "program" and retrieve output lists */
     RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug);
+    if (benchmark > 0)
+        BENCHMARK(ebpf_filter, pcap_base, input_list, benchmark);
     /* Delete the list of input packets */
     delete_list(input_list);
 }
@@ -97,11 +102,18 @@ int main(int argc, char **argv) {
     int c;
     opterr = 0;
 
-    while ((c = getopt (argc, argv, "dn:f:")) != -1) {
+    while ((c = getopt (argc, argv, "db:n:f:")) != -1) {
         switch (c) {
             case 'd':
             debug = 1;
             break;
+            case 'b':
+                benchmark = strtoul(optarg, (char **)NULL, 10);
+                if (benchmark == 0) {
+                    fprintf(stderr, "Expected a positive number of iterations\n");
+                    return EXIT_FAILURE;
+                }
+            break;
             case 'n':
                 num_pcaps = (int)strtol(optarg, (char **)NULL, 10);
                 if (num_pcaps < 0 || num_pcaps > UINT16_MAX) {
@@ -31,6 +31,8 @@ void run_and_record_output(pcap_list_t *pkt_list, char *pcap_base, uint16_t num_
 
 #define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug) \
     run_and_record_output(input_list, pcap_base, num_pcaps, debug)
+#define BENCHMARK(ebpf_filter, pcap_base, input_list, iterations) \
+    fprintf(stderr, "Benchmarks are only supported by the test target\n")
 #define INIT_EBPF_TABLES(debug)
 #define DELETE_EBPF_TABLES(debug)
 
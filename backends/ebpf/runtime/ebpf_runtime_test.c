@@ -18,10 +18,12 @@ limitations under the License.
 #include <ctype.h>      // isprint()
 #include <string.h>     // memcpy()
 #include <stdlib.h>     // malloc()
+#include <time.h>       // clock_gettime()
 #include "ebpf_test.h"
 #include "ebpf_runtime_test.h"
 
 #define PCAPOUT "_out.pcap"
+#define BENCHOUT "_benchmark.json"
 
 /**
  * @brief Feed a list packets into an eBPF program.
@@ -80,6 +82,89 @@ void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pc
     delete_array(output_array);
 }
 
+/**
+ * @brief Measure the speed of an eBPF program.
+ * @details Runs the list of input packets through the filter function the
+ * given number of times. Before each run, the packets are restored from the
+ * input list, so that changes by the program do not accumulate; only the
+ * calls of the filter function are timed. Prints a summary and writes the
+ * results, with the number of lookups in each table, as a JSON object to
+ * pcap_base_benchmark.json.
+ */
+void run_benchmark(packet_filter ebpf_filter, const char *pcap_base, pcap_list_t *pkt_list,
+                   unsigned long iterations) {
+    uint32_t list_len = get_pkt_list_length(pkt_list);
+    if (list_len == 0 || iterations == 0)
+        return;
+    char **buffers = malloc(list_len * sizeof(char *));
+    if (!buffers) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < list_len; i++) {
+        buffers[i] = malloc(get_packet(pkt_list, i)->pcap_hdr.len);
+        if (!buffers[i]) {
+            perror("Fatal: Could not allocate memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (struct bpf_table *current = tables; current->name != NULL; current++)
+        current->lookups = 0;
+
+    unsigned long long ns = 0, accepted = 0;
+    for (unsigned long n = 0; n < iterations; n++) {
+        for (uint32_t i = 0; i < list_len; i++) {
+            pcap_pkt *input_pkt = get_packet(pkt_list, i);
+            memcpy(buffers[i], input_pkt->data, input_pkt->pcap_hdr.len);
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t i = 0; i < list_len; i++) {
+            struct sk_buff skb;
+            skb.data = (void *) buffers[i];
+            skb.len = get_packet(pkt_list, i)->pcap_hdr.len;
+            if (ebpf_filter(&skb) != 0)
+                accepted++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns += (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+    }
+    for (uint32_t i = 0; i < list_len; i++)
+        free(buffers[i]);
+    free(buffers);
+
+    unsigned long long packets = (unsigned long long) list_len * iterations;
+    double ns_per_packet = (double) ns / packets;
+    double pps = ns > 0 ? packets * 1e9 / ns : 0;
+    printf("Benchmark: %llu packets in %.3f ms, %.0f packets/s, %.1f ns/packet\n",
+           packets, ns / 1e6, pps, ns_per_packet);
+    for (struct bpf_table *current = tables; current->name != NULL; current++)
+        printf("Benchmark: %s: %.2f lookups/packet\n", current->name,
+               (double) current->lookups / packets);
+
+    char *bench_name = malloc(strlen(pcap_base) + strlen(BENCHOUT) + 1);
+    if (!bench_name) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    sprintf(bench_name, "%s%s", pcap_base, BENCHOUT);
+    FILE *out = fopen(bench_name, "w");
+    if (!out) {
+        perror("Could not write the benchmark results");
+        free(bench_name);
+        return;
+    }
+    fprintf(out, "{\"iterations\": %lu, \"packets\": %llu, \"accepted\": %llu, "
+            "\"ns\": %llu, \"packets_per_second\": %.1f, \"ns_per_packet\": %.2f, "
+            "\"lookups\": {", iterations, packets, accepted, ns, pps, ns_per_packet);
+    for (struct bpf_table *current = tables; current->name != NULL; current++)
+        fprintf(out, "%s\"%s\": %llu", current == tables ? "" : ", ",
+                current->name, current->lookups);
+    fprintf(out, "}}\n");
+    fclose(out);
+    free(bench_name);
+}
+
 void init_ebpf_tables(int debug) {
     /* Initialize the registry of shared tables */
     struct bpf_table* current = tables;
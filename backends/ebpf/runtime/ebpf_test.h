@@ -75,21 +75,15 @@ struct sk_buff {
 #define BPF_EXIST   2 /* update existing element */
 #define BPF_F_LOCK  4 /* spin_lock-ed map_lookup/map_update */
 
-/* Supported bpf map types */
-enum bpf_map_type {
-    BPF_MAP_TYPE_HASH,
-    BPF_MAP_TYPE_ARRAY,
-};
-
 
 
 #define SK_BUFF struct sk_buff
 #define REGISTER_START() \
 struct bpf_table tables[] = {
 #define REGISTER_TABLE(NAME, TYPE, KEY_SIZE, VALUE_SIZE, MAX_ENTRIES) \
-    { MAP_PATH"/"#NAME, TYPE, KEY_SIZE, VALUE_SIZE, MAX_ENTRIES, NULL },
+    { MAP_PATH"/"#NAME, TYPE, KEY_SIZE, VALUE_SIZE, MAX_ENTRIES, NULL, 0 },
 #define REGISTER_END() \
-    { 0, 0, 0, 0, 0 } \
+    { 0, 0, 0, 0, 0, NULL, 0 } \
 };
 
 #define BPF_MAP_LOOKUP_ELEM(table, key) \
@@ -98,10 +92,29 @@ struct bpf_table tables[] = {
     registry_update_table(MAP_PATH"/"#table, key, value, flags)
 #define BPF_MAP_DELETE_ELEM(table, key) \
     registry_delete_table_elem(MAP_PATH"/"#table, key)
+#define BPF_RINGBUF_RESERVE(table, size) \
+    registry_ringbuf_reserve(MAP_PATH"/"#table, size)
+#define BPF_RINGBUF_SUBMIT(data) \
+    bpf_ringbuf_submit(data, 0)
 #define BPF_USER_MAP_UPDATE_ELEM(index, key, value, flags)\
     registry_update_table_id(index, key, value, flags)
+/* The userspace runtime is single-threaded: per-CPU maps have one value */
+#define BPF_USER_MAP_LOOKUP_ELEM(index, key, value)\
+    registry_read_table_elem_id(index, key, value)
+#define BPF_USER_MAP_DELETE_ELEM(index, key)\
+    registry_delete_table_elem_id(index, key)
+#define BPF_USER_NUM_CPUS() 1
+/* The registry has no batch updates: the callers fall back to element updates */
+#define BPF_USER_MAP_UPDATE_BATCH(index, keys, values, count) (-1)
 #define BPF_OBJ_PIN(table, name) registry_add(table)
 #define BPF_OBJ_GET(name) registry_get_id(name)
+/* Each consume call passes all the available records to the callback */
+#define BPF_USER_RINGBUF_NEW(index, callback, ctx) \
+    registry_ringbuf_new(index, callback, ctx)
+#define BPF_USER_RINGBUF_CONSUME(reader) registry_ringbuf_consume(reader)
+#define BPF_USER_RINGBUF_FREE(reader) registry_ringbuf_free(reader)
+
+#include "ebpf_dir24_8.h"  // control plane of the @dir_24_8 tables
 
 
 /* These should be automatically generated and included in the generated x.h header file */
@@ -16,16 +16,45 @@ limitations under the License.
 
 #include <stdlib.h>     // EXIT_SUCCESS, EXIT_FAILURE
 #include <string.h>     // memcpy()
+#include <fcntl.h>      // open()
+#include <unistd.h>     // close()
+#include <sys/mman.h>   // mmap()
+#include <sys/stat.h>   // fstat()
 #include "pcap_util.h"
 
 #define DLT_EN10MB 1        // Ethernet Link Type, see also 'man pcap-linktype'
 
+/* Magic numbers of the classic pcap format, with micro- or nanosecond timestamps */
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_FILE_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
 
-/* Dynamically-allocated list of packets.
+/* A contiguous array of packets read from one capture file, whose data stays
+   in the private mapping of the file. It is deleted with the last list that
+   references it.
+ */
+struct pcap_block {
+    pcap_pkt *pkts;
+    uint32_t len;
+    void *map;
+    size_t map_len;
+    unsigned refs;
+};
+
+struct pcap_block_ref {
+    struct pcap_block *block;
+    struct pcap_block_ref *next;
+};
+
+/* Dynamically-allocated list of packets. The list references the blocks of
+   its packets, and owns the other packets appended to it.
  */
 struct pcap_list {
     pcap_pkt **pkts;
     uint32_t len;
+    uint32_t capacity;
+    struct pcap_block_ref *blocks;
 };
 
 /* An array of lists of packets */
@@ -39,7 +68,11 @@ pcap_list_t *append_packet(pcap_list_t *pkt_list, pcap_pkt *pkt) {
         /* If the list is not allocated yet, create it */
         pkt_list = allocate_pkt_list();
     pkt_list->len++;
-    pkt_list->pkts = realloc(pkt_list->pkts, pkt_list->len * sizeof(pcap_pkt *));
+    if (pkt_list->len > pkt_list->capacity) {
+        /* Double the capacity, so that appending is amortized constant time */
+        pkt_list->capacity = pkt_list->capacity ? 2 * pkt_list->capacity : 64;
+        pkt_list->pkts = realloc(pkt_list->pkts, pkt_list->capacity * sizeof(pcap_pkt *));
+    }
     if (pkt_list->pkts == NULL) {
         fprintf(stderr, "Fatal: Failed to expand the"
             "packet list with size %u !\n", pkt_list->len);
@@ -105,13 +138,55 @@ pcap_list_array_t *allocate_pkt_list_array() {
     return pkt_list_arr;
 }
 
+/* Returns true if the packet is part of a block of the list */
+static int in_block(const pcap_list_t *pkt_list, const pcap_pkt *pkt) {
+    for (struct pcap_block_ref *ref = pkt_list->blocks; ref; ref = ref->next)
+        if (pkt >= ref->block->pkts && pkt < ref->block->pkts + ref->block->len)
+            return 1;
+    return 0;
+}
+
+static void add_block(pcap_list_t *pkt_list, struct pcap_block *block) {
+    struct pcap_block_ref *ref = malloc(sizeof(struct pcap_block_ref));
+    if (!ref) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    block->refs++;
+    ref->block = block;
+    ref->next = pkt_list->blocks;
+    pkt_list->blocks = ref;
+}
+
+static void release_blocks(pcap_list_t *pkt_list) {
+    while (pkt_list->blocks) {
+        struct pcap_block_ref *ref = pkt_list->blocks;
+        pkt_list->blocks = ref->next;
+        if (--ref->block->refs == 0) {
+            munmap(ref->block->map, ref->block->map_len);
+            free(ref->block->pkts);
+            free(ref->block);
+        }
+        free(ref);
+    }
+}
+
+/* Adds references to the blocks of a list to another list */
+static void share_blocks(const pcap_list_t *from, pcap_list_t *to) {
+    for (struct pcap_block_ref *ref = from->blocks; ref; ref = ref->next)
+        add_block(to, ref->block);
+}
+
 void delete_list(pcap_list_t *pkt_list) {
     for(uint32_t i = 0; i < pkt_list->len; i++) {
+        if (in_block(pkt_list, pkt_list->pkts[i]))
+            continue;
         free(pkt_list->pkts[i]->data);
         /* Set the data pointer to NULL, to mitigate duplicate frees */
         pkt_list->pkts[i]->data = NULL;
         free(pkt_list->pkts[i]);
     }
+    release_blocks(pkt_list);
     free(pkt_list->pkts);
     free(pkt_list);
 }
@@ -124,7 +199,98 @@ void delete_array(pcap_list_array_t *pkt_list_array) {
     free(pkt_list_array);
 }
 
+static uint32_t read_u32(const unsigned char *data, int swapped) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return swapped ? __builtin_bswap32(value) : value;
+}
+
+/* Indexes the packets of a file in the classic pcap format in place, in a
+   private writable mapping of the file. Returns NULL if the file cannot be
+   mapped or has another format.
+ */
+static pcap_list_t *map_pkts_from_pcap(const char *pcap_file_name, iface_index index) {
+    int fd = open(pcap_file_name, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < PCAP_FILE_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    size_t map_len = st.st_size;
+    /* Programs may write in the packets: the pages are copied on write */
+    unsigned char *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    uint32_t magic = read_u32(map, 0);
+    int swapped = magic == __builtin_bswap32(PCAP_MAGIC_USEC) ||
+                  magic == __builtin_bswap32(PCAP_MAGIC_NSEC);
+    magic = read_u32(map, swapped);
+    if (magic != PCAP_MAGIC_USEC && magic != PCAP_MAGIC_NSEC) {
+        munmap(map, map_len);
+        return NULL;
+    }
+    int nanoseconds = magic == PCAP_MAGIC_NSEC;
+
+    /* Count the packets, to allocate the block at once */
+    uint32_t count = 0;
+    size_t offset = PCAP_FILE_HEADER_SIZE;
+    while (offset + PCAP_RECORD_HEADER_SIZE <= map_len) {
+        uint32_t caplen = read_u32(map + offset + 8, swapped);
+        if (caplen > map_len - offset - PCAP_RECORD_HEADER_SIZE)
+            break;
+        offset += PCAP_RECORD_HEADER_SIZE + caplen;
+        count++;
+    }
+    if (offset != map_len)
+        fprintf(stderr, "Warning: Truncated pcap file %s\n", pcap_file_name);
+
+    struct pcap_block *block = calloc(1, sizeof(struct pcap_block));
+    pcap_list_t *pkt_list = allocate_pkt_list();
+    if (!block || !pkt_list || (count && !(block->pkts = calloc(count, sizeof(pcap_pkt))))) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    block->len = count;
+    block->map = map;
+    block->map_len = map_len;
+    add_block(pkt_list, block);
+    pkt_list->pkts = malloc((count ? count : 1) * sizeof(pcap_pkt *));
+    pkt_list->capacity = count ? count : 1;
+    if (!pkt_list->pkts) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    offset = PCAP_FILE_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        const unsigned char *record = map + offset;
+        pcap_pkt *pkt = &block->pkts[i];
+        pkt->pcap_hdr.ts.tv_sec = read_u32(record, swapped);
+        pkt->pcap_hdr.ts.tv_usec = read_u32(record + 4, swapped);
+        if (nanoseconds)
+            pkt->pcap_hdr.ts.tv_usec /= 1000;
+        pkt->pcap_hdr.caplen = read_u32(record + 8, swapped);
+        /* The users of the packets expect len bytes of data */
+        pkt->pcap_hdr.len = pkt->pcap_hdr.caplen;
+        pkt->data = (char *) record + PCAP_RECORD_HEADER_SIZE;
+        pkt->ifindex = index;
+        pkt_list->pkts[i] = pkt;
+        offset += PCAP_RECORD_HEADER_SIZE + pkt->pcap_hdr.caplen;
+    }
+    pkt_list->len = count;
+    return pkt_list;
+}
+
 pcap_list_t *read_pkts_from_pcap(const char *pcap_file_name, iface_index index) {
+    pcap_list_t *mapped = map_pkts_from_pcap(pcap_file_name, index);
+    if (mapped != NULL)
+        return mapped;
+
+    /* Other formats, such as pcapng, are copied with libpcap */
     struct pcap_pkthdr *pcap_hdr;
     const unsigned char *tmp_pkt;
     char errbuf[PCAP_ERRBUF_SIZE];
@@ -177,12 +343,45 @@ int write_pkts_to_pcap(const char *pcap_file_name, const pcap_list_t *list) {
     return EXIT_SUCCESS;
 }
 
+/* Compare the timestamps of two packets */
+static int compare_time(const pcap_pkt *p1, const pcap_pkt *p2) {
+    if (p1->pcap_hdr.ts.tv_sec != p2->pcap_hdr.ts.tv_sec)
+        return p1->pcap_hdr.ts.tv_sec < p2->pcap_hdr.ts.tv_sec ? -1 : 1;
+    if (p1->pcap_hdr.ts.tv_usec != p2->pcap_hdr.ts.tv_usec)
+        return p1->pcap_hdr.ts.tv_usec < p2->pcap_hdr.ts.tv_usec ? -1 : 1;
+    return 0;
+}
+
 pcap_list_t *merge_and_delete_lists(pcap_list_array_t *array, pcap_list_t *merged_list) {
-    /* Fill the master list by copying over the individual packet descriptors */
+    if (!merged_list)
+        merged_list = allocate_pkt_list();
+    /* Merge the lists, which are in capture order, by timestamp; packets with
+       the same timestamp are taken from the lowest interface first */
+    uint32_t *next = calloc(array->len ? array->len : 1, sizeof(uint32_t));
+    if (!next) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (;;) {
+        int best = -1;
+        for (uint32_t i = 0; i < array->len; i++) {
+            pcap_list_t *list = array->lists[i];
+            if (!list || next[i] >= list->len)
+                continue;
+            if (best < 0 || compare_time(list->pkts[next[i]],
+                                         array->lists[best]->pkts[next[best]]) < 0)
+                best = i;
+        }
+        if (best < 0)
+            break;
+        merged_list = append_packet(merged_list, array->lists[best]->pkts[next[best]++]);
+    }
+    free(next);
     for (uint32_t i = 0; i < array->len; i++) {
-            for (uint32_t j = 0; j < array->lists[i]->len; j++)
-                merged_list = append_packet(
-                    merged_list, array->lists[i]->pkts[j]);
+        if (!array->lists[i])
+            continue;
+        share_blocks(array->lists[i], merged_list);
+        release_blocks(array->lists[i]);
         /* We do not need the previous list anymore */
         free(array->lists[i]->pkts);
         free(array->lists[i]);
@@ -212,6 +411,9 @@ pcap_list_array_t *split_and_delete_list(pcap_list_t *input_list, pcap_list_arra
     /* Fill each list with its respective packets */
     for (uint32_t i = 0; i < input_list->len; i++)
         append_packet(result_arr->lists[input_list->pkts[i]->ifindex], input_list->pkts[i]);
+    for (int i = 0; i <= max_index; i++)
+        share_blocks(input_list, result_arr->lists[i]);
+    release_blocks(input_list);
 
     /* Destroy the input list (but keep its data) */
     free(input_list->pkts);
@@ -229,16 +431,16 @@ pcap_pkt *copy_pkt(pcap_pkt *src_pkt) {
     return new_pkt;
 }
 
-/* Rank packets based on the timestamp of the pcap header */
-static int compare_pkt_time(const void *s1, const void *s2) {
-  pcap_pkt *p1 = *(pcap_pkt **)s1;
-  pcap_pkt *p2 = *(pcap_pkt **)s2;
-  return p1->pcap_hdr.ts.tv_usec - p2->pcap_hdr.ts.tv_usec;
-}
-
 void sort_pcap_list(pcap_list_t *pkt_list) {
-    /* Sort the master list and return the meta information*/
-    qsort(pkt_list->pkts, pkt_list->len, sizeof(pcap_pkt *), compare_pkt_time);
+    /* Sort the master list by insertion: merged lists are already sorted, so
+       this is linear for them, and the order of equal timestamps is kept */
+    for (uint32_t i = 1; i < pkt_list->len; i++) {
+        pcap_pkt *pkt = pkt_list->pkts[i];
+        uint32_t j = i;
+        for (; j > 0 && compare_time(pkt_list->pkts[j - 1], pkt) > 0; j--)
+            pkt_list->pkts[j] = pkt_list->pkts[j - 1];
+        pkt_list->pkts[j] = pkt;
+    }
 }
 
 char *generate_pcap_name(const char *pcap_base, int index, const char *suffix) {
@@ -48,7 +48,10 @@ typedef struct pcap_list_array pcap_list_array_t;
  * @brief Retrieve packets from a pcap file.
  * @details Retrieves a list of packets from a given pcap file.
  * Allocates a packet list and fills it with the packets from the
- * supplied pcap file. All data in the capture file is copied to the new list.
+ * supplied pcap file. Files in the classic pcap format are mapped in memory,
+ * privately, and their packets are indexed in place in one contiguous array;
+ * truncated packets have the length of their captured data. The data of
+ * files in other formats is copied to the new list.
  * Each packet is assigned the given interface index as meta-information.
  * A list allocated by this function should subsequently be freed by
  * delete_list().
@@ -75,7 +78,8 @@ int write_pkts_to_pcap(const char *pcap_file_name, const pcap_list_t *pkt_list);
 /**
  * @brief Merges a given list array into a single list.
  * @details Expects a handle to an array list and allocates a single list from
- * it. The array and its data structures are subsequently destroyed.
+ * it, merging the lists by the timestamps of their packets. The array and its
+ * data structures are subsequently destroyed.
  *
  * @param array The array containing the lists to split
  * @param merged_list The output lists to fill with packets.
@@ -209,6 +213,7 @@ void delete_array(pcap_list_array_t *pkt_list_array);
  * @brief Sort a list in place.
  * @details Sorts a given list by the timestamp of the packets contained in it.
  * This alters the order in place, the input list is permanently modified.
+ * The sort is stable.
  *
  * @param pkt_list A list.
  */
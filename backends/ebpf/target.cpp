@@ -20,6 +20,22 @@ limitations under the License.
 namespace EBPF {
 
 
+void Target::emitProgArrayDecl(Util::SourceCodeBuilder*, cstring, unsigned, unsigned) const {
+    ::error(ErrorType::ERR_UNSUPPORTED, "%1% target: tail calls are not supported", name);
+}
+
+void Target::emitTailCallSection(Util::SourceCodeBuilder*, unsigned, unsigned) const {}
+
+void Target::emitTailCall(Util::SourceCodeBuilder*, cstring, cstring, unsigned) const {}
+
+void Target::emitRingBufReserve(Util::SourceCodeBuilder*, cstring, cstring, cstring) const {
+    ::error(ErrorType::ERR_UNSUPPORTED, "%1% target: ring buffers are not supported", name);
+}
+
+void Target::emitRingBufSubmit(Util::SourceCodeBuilder*, cstring, cstring) const {}
+
+//////////////////////////////////////////////////////////////
+
 void KernelSamplesTarget::emitIncludes(Util::SourceCodeBuilder* builder) const {
     builder->append("#include \"ebpf_kernel.h\"\n");
     builder->newline();
@@ -54,14 +70,37 @@ void KernelSamplesTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
         kind = "BPF_MAP_TYPE_ARRAY";
     else if (tableKind == TableLPMTrie)
         kind = "BPF_MAP_TYPE_LPM_TRIE";
+    else if (tableKind == TablePerCPUHash)
+        kind = "BPF_MAP_TYPE_PERCPU_HASH";
+    else if (tableKind == TablePerCPUArray)
+        kind = "BPF_MAP_TYPE_PERCPU_ARRAY";
+    else if (tableKind == TableLRUHash)
+        kind = "BPF_MAP_TYPE_LRU_HASH";
+    else if (tableKind == TableRingBuf)
+        kind = "BPF_MAP_TYPE_RINGBUF";
     else
         BUG("%1%: unsupported table kind", tableKind);
     builder->appendFormat("REGISTER_TABLE(%s, %s, ", tblName.c_str(), kind.c_str());
-    builder->appendFormat("sizeof(%s), sizeof(%s), %d)",
-                          keyType.c_str(), valueType.c_str(), size);
+    if (tableKind == TableRingBuf)
+        // ring buffers have neither keys nor values
+        builder->appendFormat("0, 0, %d)", size);
+    else
+        builder->appendFormat("sizeof(%s), sizeof(%s), %d)",
+                              keyType.c_str(), valueType.c_str(), size);
     builder->newline();
 }
 
+void KernelSamplesTarget::emitRingBufReserve(Util::SourceCodeBuilder* builder, cstring tblName,
+                                             cstring size, cstring record) const {
+    builder->appendFormat("%s = BPF_RINGBUF_RESERVE(%s, %s)",
+                          record.c_str(), tblName.c_str(), size.c_str());
+}
+
+void KernelSamplesTarget::emitRingBufSubmit(Util::SourceCodeBuilder* builder, cstring,
+                                            cstring record) const {
+    builder->appendFormat("BPF_RINGBUF_SUBMIT(%s);", record.c_str());
+}
+
 void KernelSamplesTarget::emitLicense(Util::SourceCodeBuilder* builder, cstring license) const {
     builder->emitIndent();
     builder->appendFormat("char _license[] SEC(\"license\") = \"%s\";", license.c_str());
@@ -73,6 +112,23 @@ void KernelSamplesTarget::emitCodeSection(
     builder->appendFormat("SEC(\"prog\")\n", sectionName.c_str());
 }
 
+void KernelSamplesTarget::emitProgArrayDecl(Util::SourceCodeBuilder* builder, cstring tblName,
+                                            unsigned id, unsigned size) const {
+    builder->appendFormat("REGISTER_PROG_ARRAY(%s, %u, %u)", tblName.c_str(), id, size);
+    builder->newline();
+}
+
+void KernelSamplesTarget::emitTailCallSection(Util::SourceCodeBuilder* builder,
+                                              unsigned id, unsigned index) const {
+    // iproute2 stores the programs of the sections "ID/INDEX" in the program arrays
+    builder->appendFormat("SEC(\"%u/%u\")\n", id, index);
+}
+
+void KernelSamplesTarget::emitTailCall(Util::SourceCodeBuilder* builder, cstring argName,
+                                       cstring tblName, unsigned index) const {
+    builder->appendFormat("BPF_TAIL_CALL(%s, %s, %u);", argName.c_str(), tblName.c_str(), index);
+}
+
 void KernelSamplesTarget::emitMain(Util::SourceCodeBuilder* builder,
                                    cstring functionName,
                                    cstring argName) const {
@@ -82,18 +138,21 @@ void KernelSamplesTarget::emitMain(Util::SourceCodeBuilder* builder,
 
 //////////////////////////////////////////////////////////////
 
-void TestTarget::emitIncludes(Util::SourceCodeBuilder* builder) const {
-    builder->append("#include \"ebpf_test.h\"\n");
-    builder->newline();
+void XdpTarget::emitCodeSection(Util::SourceCodeBuilder* builder, cstring) const {
+    builder->append("SEC(\"xdp\")\n");
+}
+
+void XdpTarget::emitMain(Util::SourceCodeBuilder* builder,
+                         cstring functionName,
+                         cstring argName) const {
+    builder->appendFormat("int %s(struct xdp_md *%s)",
+                          functionName.c_str(), argName.c_str());
 }
 
-void TestTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
-                               cstring tblName, TableKind,
-                               cstring keyType, cstring valueType,
-                               unsigned size) const {
-    builder->appendFormat("REGISTER_TABLE(%s, 0 /* unused */,", tblName.c_str());
-    builder->appendFormat("sizeof(%s), sizeof(%s), %d)",
-                          keyType.c_str(), valueType.c_str(), size);
+//////////////////////////////////////////////////////////////
+
+void TestTarget::emitIncludes(Util::SourceCodeBuilder* builder) const {
+    builder->append("#include \"ebpf_test.h\"\n");
     builder->newline();
 }
 
@@ -129,6 +188,12 @@ void BccTarget::emitIncludes(Util::SourceCodeBuilder* builder) const {
 void BccTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
                               cstring tblName, TableKind tableKind,
                               cstring keyType, cstring valueType, unsigned size) const {
+    if (tableKind == TableRingBuf) {
+        // BCC sizes ring buffers in pages
+        builder->appendFormat("BPF_RINGBUF_OUTPUT(%s, %u);", tblName.c_str(), size / 4096);
+        builder->newline();
+        return;
+    }
     cstring kind;
     if (tableKind == TableHash)
         kind = "hash";
@@ -136,6 +201,12 @@ void BccTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
         kind = "array";
     else if (tableKind == TableLPMTrie)
         kind = "lpm_trie";
+    else if (tableKind == TablePerCPUHash)
+        kind = "percpu_hash";
+    else if (tableKind == TablePerCPUArray)
+        kind = "percpu_array";
+    else if (tableKind == TableLRUHash)
+        kind = "lru_hash";
     else
         BUG("%1%: unsupported table kind", tableKind);
 
@@ -144,6 +215,17 @@ void BccTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
     builder->newline();
 }
 
+void BccTarget::emitRingBufReserve(Util::SourceCodeBuilder* builder, cstring tblName,
+                                   cstring size, cstring record) const {
+    builder->appendFormat("%s = %s.ringbuf_reserve(%s)",
+                          record.c_str(), tblName.c_str(), size.c_str());
+}
+
+void BccTarget::emitRingBufSubmit(Util::SourceCodeBuilder* builder, cstring tblName,
+                                  cstring record) const {
+    builder->appendFormat("%s.ringbuf_submit(%s, 0);", tblName.c_str(), record.c_str());
+}
+
 void BccTarget::emitMain(Util::SourceCodeBuilder* builder,
                                    cstring functionName,
                                    cstring argName) const {
@@ -29,7 +29,11 @@ namespace EBPF {
 enum TableKind {
     TableHash,
     TableArray,
-    TableLPMTrie  // longest prefix match trie
+    TableLPMTrie,  // longest prefix match trie
+    TablePerCPUHash,  // one value per CPU, see EBPFCounterTable
+    TablePerCPUArray,
+    TableLRUHash,  // evicts the least recently used entries when full
+    TableRingBuf  // records sent to user space; the size is in bytes
 };
 
 class Target {
@@ -63,6 +67,23 @@ class Target {
     virtual cstring abortReturnCode() const = 0;
     // Path on /sys filesystem where maps are stored
     virtual cstring sysMapPath() const = 0;
+    // Tail calls; the default implementations report that they are not supported.
+    // Declares the program array @tblName, identified by @id for the loader
+    virtual void emitProgArrayDecl(Util::SourceCodeBuilder* builder, cstring tblName,
+                                   unsigned id, unsigned size) const;
+    // Emits the section of the program that the loader stores at @index in array @id
+    virtual void emitTailCallSection(Util::SourceCodeBuilder* builder,
+                                     unsigned id, unsigned index) const;
+    virtual void emitTailCall(Util::SourceCodeBuilder* builder, cstring argName,
+                              cstring tblName, unsigned index) const;
+    // Ring buffers (TableRingBuf); the default implementations report that they are not
+    // supported.
+    // Sets @record to the space of @size bytes reserved in ring buffer @tblName, or NULL
+    virtual void emitRingBufReserve(Util::SourceCodeBuilder* builder, cstring tblName,
+                                    cstring size, cstring record) const;
+    // Makes the reserved @record of ring buffer @tblName visible to user space
+    virtual void emitRingBufSubmit(Util::SourceCodeBuilder* builder, cstring tblName,
+                                   cstring record) const;
 };
 
 // Represents a target that is compiled within the kernel
@@ -82,6 +103,10 @@ class KernelSamplesTarget : public Target {
     void emitTableDecl(Util::SourceCodeBuilder* builder,
                        cstring tblName, TableKind tableKind,
                        cstring keyType, cstring valueType, unsigned size) const override;
+    void emitRingBufReserve(Util::SourceCodeBuilder* builder, cstring tblName,
+                            cstring size, cstring record) const override;
+    void emitRingBufSubmit(Util::SourceCodeBuilder* builder, cstring tblName,
+                           cstring record) const override;
     void emitMain(Util::SourceCodeBuilder* builder,
                   cstring functionName,
                   cstring argName) const override;
@@ -93,6 +118,27 @@ class KernelSamplesTarget : public Target {
     cstring dropReturnCode() const override { return "TC_ACT_SHOT"; }
     cstring abortReturnCode() const override { return "TC_ACT_SHOT"; }
     cstring sysMapPath() const override { return "/sys/fs/bpf/tc/globals"; }
+    void emitProgArrayDecl(Util::SourceCodeBuilder* builder, cstring tblName,
+                           unsigned id, unsigned size) const override;
+    void emitTailCallSection(Util::SourceCodeBuilder* builder,
+                             unsigned id, unsigned index) const override;
+    void emitTailCall(Util::SourceCodeBuilder* builder, cstring argName,
+                      cstring tblName, unsigned index) const override;
+};
+
+// A kernel target whose program is attached to the XDP hook of a device,
+// so that it runs on the packet buffer before any skb is allocated.
+class XdpTarget : public KernelSamplesTarget {
+ public:
+    XdpTarget() : KernelSamplesTarget("XDP") {}
+    void emitCodeSection(Util::SourceCodeBuilder* builder, cstring sectionName) const override;
+    void emitMain(Util::SourceCodeBuilder* builder,
+                  cstring functionName,
+                  cstring argName) const override;
+    cstring forwardReturnCode() const override { return "XDP_PASS"; }
+    cstring dropReturnCode() const override { return "XDP_DROP"; }
+    cstring abortReturnCode() const override { return "XDP_ABORTED"; }
+    cstring sysMapPath() const override { return "/sys/fs/bpf/xdp/globals"; }
 };
 
 // Represents a target compiled by bcc that uses the TC
@@ -111,6 +157,10 @@ class BccTarget : public Target {
     void emitTableDecl(Util::SourceCodeBuilder* builder,
                        cstring tblName, TableKind tableKind,
                        cstring keyType, cstring valueType, unsigned size) const override;
+    void emitRingBufReserve(Util::SourceCodeBuilder* builder, cstring tblName,
+                            cstring size, cstring record) const override;
+    void emitRingBufSubmit(Util::SourceCodeBuilder* builder, cstring tblName,
+                           cstring record) const override;
     void emitMain(Util::SourceCodeBuilder* builder,
                   cstring functionName,
                   cstring argName) const override;
@@ -128,10 +178,16 @@ class BccTarget : public Target {
 class TestTarget : public EBPF::KernelSamplesTarget {
  public:
     TestTarget() : KernelSamplesTarget("Userspace Test") {}
+    void emitProgArrayDecl(Util::SourceCodeBuilder* builder, cstring tblName,
+                           unsigned id, unsigned size) const override
+    { Target::emitProgArrayDecl(builder, tblName, id, size); }
+    void emitTailCallSection(Util::SourceCodeBuilder* builder,
+                             unsigned id, unsigned index) const override
+    { Target::emitTailCallSection(builder, id, index); }
+    void emitTailCall(Util::SourceCodeBuilder* builder, cstring argName,
+                      cstring tblName, unsigned index) const override
+    { Target::emitTailCall(builder, argName, tblName, index); }
     void emitIncludes(Util::SourceCodeBuilder* builder) const override;
-    void emitTableDecl(Util::SourceCodeBuilder* builder,
-                       cstring tblName, TableKind tableKind,
-                       cstring keyType, cstring valueType, unsigned size) const override;
     cstring dataOffset(cstring base) const override
     { return cstring("((void*)(long)")+ base + "->data)"; }
     cstring dataEnd(cstring base) const override
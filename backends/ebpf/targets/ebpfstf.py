@@ -68,9 +68,14 @@ def _generate_control_actions(cmds):
             generated += "%s," % val_field[1]
         generated += "}},\n\t"
         generated += "};\n\t"
-        generated += ("ok = BPF_USER_MAP_UPDATE_ELEM"
-                      "(tableFileDescriptor, &%s, &%s, BPF_ANY);\n\t"
-                      % (key_name, value_name))
+        if cmd.a_type == "setdefault":
+            generated += ("ok = BPF_USER_MAP_UPDATE_ELEM"
+                          "(tableFileDescriptor, &%s, &%s, BPF_ANY);\n\t"
+                          % (key_name, value_name))
+        else:
+            # The generated function computes the index of the key in array tables
+            generated += ("ok = %s_write(tableFileDescriptor, %s, %s);\n\t"
+                          % (cmd.table, key_name, value_name))
         generated += ("if (ok != 0) { perror(\"Could not write in %s\");"
                       "exit(1); }\n" % tbl_name)
     return generated
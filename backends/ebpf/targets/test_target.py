@@ -16,6 +16,7 @@
 
 import os
 import sys
+import json
 from glob import glob
 from .target import EBPFTarget
 # path to the tools folder of the compiler
@@ -63,9 +64,30 @@ class Target(EBPFTarget):
         args += "-f " + pcap_pattern + " "
         # Number of input interfaces
         args += "-n " + str(num_files) + " "
+        if self.options.benchmark > 0:
+            args += "-b " + str(self.options.benchmark) + " "
         # Debug flag (verbose output)
         args += "-d"
         errmsg = "Failed to execute the filter:"
         result = run_timeout(self.options.verbose, args,
                              TIMEOUT, self.outputs, errmsg)
+        if result == SUCCESS and self.options.benchmark > 0:
+            self._record_benchmark()
         return result
+
+    def _record_benchmark(self):
+        """ Adds the program and the compiler to the results written by the
+        runtime, and appends them to the benchmark output file. """
+        results_file = self.tmpdir + "/pcap_benchmark.json"
+        if not os.path.isfile(results_file):
+            return
+        with open(results_file) as f:
+            results = json.load(f)
+        results["program"] = os.path.basename(self.options.p4filename)
+        results["compiler"] = self.options.compiler
+        line = json.dumps(results, sort_keys=True)
+        report_output(self.outputs["stdout"], self.options.verbose,
+                      "Benchmark: " + line)
+        if self.options.benchmark_output:
+            with open(self.options.benchmark_output, "a") as f:
+                f.write(line + "\n")
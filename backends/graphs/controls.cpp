@@ -14,7 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <exception>
 #include <iostream>
+#include <vector>
 
 #include <boost/graph/graphviz.hpp>
 
@@ -22,9 +24,12 @@ limitations under the License.
 
 #include "frontends/p4/methodInstance.h"
 #include "frontends/p4/tableApply.h"
+#include "lib/compile_context.h"
+#include "lib/error.h"
 #include "lib/log.h"
 #include "lib/nullstream.h"
 #include "lib/path.h"
+#include "lib/thread_pool.h"
 #include "controls.h"
 
 namespace graphs {
@@ -70,9 +75,10 @@ bool ControlGraphs::ControlStack::isEmpty() const {
 using vertex_t = ControlGraphs::vertex_t;
 
 ControlGraphs::ControlGraphs(P4::ReferenceMap *refMap, P4::TypeMap *typeMap,
-                             const cstring &graphsDir)
+                             const cstring &graphsDir, const SummaryOptions &summary)
     : refMap(refMap), typeMap(typeMap), graphsDir(graphsDir) {
     visitDagOnce = false;
+    this->summary = summary;
 }
 
 void ControlGraphs::writeGraphToFile(const Graph &g, const cstring &name) {
@@ -87,37 +93,65 @@ void ControlGraphs::writeGraphToFile(const Graph &g, const cstring &name) {
     boost::write_graphviz(*out, g);
 }
 
-bool ControlGraphs::preorder(const IR::PackageBlock *block) {
+static void collectControls(const IR::PackageBlock *block,
+                            std::vector<const IR::ControlBlock *> *controls) {
     for (auto it : block->constantValue) {
         if (!it.second) continue;
-        if (it.second->is<IR::ControlBlock>()) {
-            auto name = it.second->to<IR::ControlBlock>()->container->name;
-            LOG1("Generating graph for top-level control " << name);
-            Graph g_;
-            g = &g_;
-            BUG_CHECK(controlStack.isEmpty(), "Invalid control stack state");
-            g = controlStack.pushBack(g_, "");
-            instanceName = boost::none;
-            boost::get_property(g_, boost::graph_name) = name;
-            start_v = add_vertex("__START__", VertexType::OTHER);
-            exit_v = add_vertex("__EXIT__", VertexType::OTHER);
-            parents = {{start_v, new EdgeUnconditional()}};
-            visit(it.second->getNode());
-            for (auto parent : parents)
-                add_edge(parent.first, exit_v, parent.second->label());
-            BUG_CHECK(g_.is_root(), "Invalid graph");
-            controlStack.popBack();
-            GraphAttributeSetter()(g_);
-            writeGraphToFile(g_, name);
-        } else if (it.second->is<IR::PackageBlock>()) {
-            visit(it.second->getNode());
-        }
+        if (auto control = it.second->to<IR::ControlBlock>())
+            controls->push_back(control);
+        else if (auto package = it.second->to<IR::PackageBlock>())
+            collectControls(package, controls);
+    }
+}
+
+bool ControlGraphs::preorder(const IR::PackageBlock *block) {
+    std::vector<const IR::ControlBlock *> controls;
+    collectControls(block, &controls);
+    if (controls.size() < 2 || Util::ThreadPool::global().concurrency() == 1) {
+        for (auto control : controls) visit(control);
+        return false;
     }
+    // The graph of each top-level control only depends on that control, so
+    // they are built by separate visitors; diagnostics are reported in order.
+    std::vector<ErrorReporter::Deferred> deferred(controls.size());
+    std::vector<std::exception_ptr> failed(controls.size());
+    Util::ThreadPool::global().parallel_for(controls.size(), [&](size_t i) {
+        ErrorReporter::Deferred::Scope keep(deferred[i]);
+        try {
+            ControlGraphs cgen(refMap, typeMap, graphsDir, summary);
+            controls[i]->apply(cgen);
+        } catch (...) {
+            failed[i] = std::current_exception(); } });
+    auto& reporter = BaseCompileContext::get().errorReporter();
+    for (size_t i = 0; i < controls.size(); i++) {
+        reporter.emit(deferred[i]);
+        if (failed[i])
+            std::rethrow_exception(failed[i]); }
     return false;
 }
 
 bool ControlGraphs::preorder(const IR::ControlBlock *block) {
+    auto name = block->container->name;
+    LOG1("Generating graph for top-level control " << name);
+    Graph g_;
+    g = &g_;
+    BUG_CHECK(controlStack.isEmpty(), "Invalid control stack state");
+    g = controlStack.pushBack(g_, "");
+    instanceName = boost::none;
+    reset_summary();
+    tableVertices.clear();
+    boost::get_property(g_, boost::graph_name) = name;
+    start_v = add_vertex("__START__", VertexType::OTHER);
+    exit_v = add_vertex("__EXIT__", VertexType::OTHER);
+    parents = {{start_v, new EdgeUnconditional()}};
     visit(block->container);
+    for (auto parent : parents)
+        add_edge(parent.first, exit_v, parent.second->label());
+    BUG_CHECK(g_.is_root(), "Invalid graph");
+    finish_summary();
+    controlStack.popBack();
+    GraphAttributeSetter()(g_);
+    writeGraphToFile(g_, name);
     return false;
 }
 
@@ -259,7 +293,16 @@ bool ControlGraphs::preorder(const IR::ExitStatement *) {
 
 bool ControlGraphs::preorder(const IR::P4Table *table) {
     auto name = controlStack.getName(table->controlPlaneName());
+    auto it = tableVertices.find(name);
+    if (it != tableVertices.end()) {
+        merge_other_statements_into_vertex();
+        for (auto parent : parents)
+            add_edge(parent.first, it->second, parent.second->label());
+        parents = {{it->second, new EdgeUnconditional()}};
+        return false;
+    }
     auto v = add_and_connect_vertex(name, VertexType::TABLE);
+    if (summary.summarize) tableVertices.emplace(name, v);
     parents = {{v, new EdgeUnconditional()}};
     return false;
 }
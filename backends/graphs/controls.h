@@ -35,7 +35,8 @@ class ControlGraphs : public Graphs {
         std::vector<Graph *> subgraphs{};
     };
 
-    ControlGraphs(P4::ReferenceMap *refMap, P4::TypeMap *typeMap, const cstring &graphsDir);
+    ControlGraphs(P4::ReferenceMap *refMap, P4::TypeMap *typeMap, const cstring &graphsDir,
+                  const SummaryOptions &summary = {});
 
     bool preorder(const IR::PackageBlock *block) override;
     bool preorder(const IR::ControlBlock *block) override;
@@ -60,6 +61,8 @@ class ControlGraphs : public Graphs {
     // "current graph" to which we add vertices (e.g. tables).
     ControlStack controlStack{};
     boost::optional<cstring> instanceName{};
+    // in summarized mode, the vertex of each table applied so far
+    std::map<cstring, vertex_t> tableVertices{};
 };
 
 }  // namespace graphs
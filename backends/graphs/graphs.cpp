@@ -26,13 +26,43 @@ limitations under the License.
 namespace graphs {
 
 Graphs::vertex_t Graphs::add_vertex(const cstring &name, VertexType type) {
+    if (summary.maxVertices != 0 && boost::num_vertices(g->root()) >= summary.maxVertices) {
+        truncated++;
+        if (truncated_v == boost::none) {
+            // kept out of the control clusters, in the root graph
+            truncated_v = boost::add_vertex(g->root());
+            boost::put(&Vertex::type, g->root(), *truncated_v, VertexType::OTHER);
+        }
+        return *truncated_v;
+    }
     auto v = boost::add_vertex(*g);
     boost::put(&Vertex::name, *g, v, name);
     boost::put(&Vertex::type, *g, v, type);
-    return g->local_to_global(v);
+    auto global_v = g->local_to_global(v);
+    if (type == VertexType::TABLE || type == VertexType::STATEMENTS) {
+        region_v = global_v;
+        region_g = g;
+        region_first = name;
+        region_size = 1;
+    } else {
+        region_v = boost::none;
+    }
+    return global_v;
 }
 
 void Graphs::add_edge(const vertex_t &from, const vertex_t &to, const cstring &name) {
+    if (truncated_v != boost::none && (from == *truncated_v || to == *truncated_v) &&
+        (from == to || boost::edge(from, to, g->root()).second))
+        return;
+    if (summary.summarize) {
+        // repeated table applications lead to the same edges again
+        auto out = boost::out_edges(from, g->root());
+        for (auto &eit = out.first; eit != out.second; ++eit) {
+            if (boost::target(*eit, g->root()) == to &&
+                boost::get(boost::edge_name, g->root(), *eit) == name)
+                return;
+        }
+    }
     auto ep = boost::add_edge(from, to, g->root());
     boost::put(boost::edge_name, g->root(), ep.first, name);
 }
@@ -51,6 +81,10 @@ boost::optional<Graphs::vertex_t> Graphs::merge_other_statements_into_vertex() {
         sstream << "\n...\n";
         statementsStack.back()->dbprint(sstream);
     }
+    if (auto region = extend_region(cstring(sstream), VertexType::STATEMENTS)) {
+        statementsStack.clear();
+        return region;
+    }
     auto v = add_vertex(cstring(sstream), VertexType::STATEMENTS);
     for (auto parent : parents)
         add_edge(parent.first, v, parent.second->label());
@@ -61,10 +95,41 @@ boost::optional<Graphs::vertex_t> Graphs::merge_other_statements_into_vertex() {
 
 Graphs::vertex_t Graphs::add_and_connect_vertex(const cstring &name, VertexType type) {
     merge_other_statements_into_vertex();
+    if (auto region = extend_region(name, type))
+        return *region;
     auto v = add_vertex(name, type);
     for (auto parent : parents)
         add_edge(parent.first, v, parent.second->label());
     return v;
 }
 
+boost::optional<Graphs::vertex_t> Graphs::extend_region(const cstring &name, VertexType type) {
+    if (!summary.summarize || region_v == boost::none || region_g != g) return boost::none;
+    if (type != VertexType::TABLE && type != VertexType::STATEMENTS) return boost::none;
+    // the region must be the only predecessor, and must not branch yet
+    if (parents.size() != 1 || parents.front().first != *region_v ||
+        dynamic_cast<EdgeUnconditional *>(parents.front().second) == nullptr ||
+        boost::out_degree(*region_v, g->root()) != 0)
+        return boost::none;
+    auto &vertex = g->root()[*region_v];
+    region_size++;
+    vertex.name = cstring(region_first + (region_size == 2 ? "\n" : "\n...\n") + name);
+    if (vertex.type != type) vertex.type = VertexType::STATEMENTS;
+    return region_v;
+}
+
+void Graphs::reset_summary() {
+    truncated_v = boost::none;
+    truncated = 0;
+    region_v = boost::none;
+    region_g = nullptr;
+}
+
+void Graphs::finish_summary() {
+    if (truncated_v == boost::none) return;
+    std::stringstream sstream;
+    sstream << "... " << truncated << " more vertices";
+    g->root()[*truncated_v].name = cstring(sstream);
+}
+
 }  // namespace graphs
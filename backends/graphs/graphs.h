@@ -92,6 +92,17 @@ class EdgeSwitch : public EdgeTypeIface {
     const IR::Expression *labelExpr;
 };
 
+/// Options for keeping the generated graphs small enough to be built and
+/// rendered for large programs.
+struct SummaryOptions {
+    /// Collapse straight-line regions of tables and statements, and repeated
+    /// applications of a table, into single vertices.
+    bool summarize = false;
+    /// Maximum number of vertices of each graph, 0 for no limit. The vertices
+    /// past the limit are collapsed into a single vertex.
+    unsigned maxVertices = 0;
+};
+
 class Graphs : public Inspector {
  public:
     enum class VertexType {
@@ -141,6 +152,14 @@ class Graphs : public Inspector {
     vertex_t add_and_connect_vertex(const cstring &name, VertexType type);
     void add_edge(const vertex_t &from, const vertex_t &to, const cstring &name);
 
+    // in summarized mode, appends a table or statements vertex to the
+    // straight-line region ending with its only parent instead of adding it
+    boost::optional<vertex_t> extend_region(const cstring &name, VertexType type);
+    // clears the summary state before building a new graph; the label of the
+    // vertex standing for the truncated vertices is set by finish_summary()
+    void reset_summary();
+    void finish_summary();
+
     class GraphAttributeSetter {
      public:
         void operator()(Graph &g) const {
@@ -197,6 +216,17 @@ class Graphs : public Inspector {
     vertex_t exit_v{};
     Parents parents{};
     std::vector<const IR::Statement *> statementsStack{};
+
+    SummaryOptions summary{};
+    // vertex standing for the vertices past summary.maxVertices
+    boost::optional<vertex_t> truncated_v{};
+    unsigned truncated{0};
+    // last table or statements vertex added, which can be extended into a
+    // straight-line region, with the subgraph it belongs to
+    boost::optional<vertex_t> region_v{};
+    Graph *region_g{nullptr};
+    cstring region_first{};
+    unsigned region_size{0};
 };
 
 }  // namespace graphs
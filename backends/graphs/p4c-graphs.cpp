@@ -63,6 +63,7 @@ MidEnd::MidEnd(CompilerOptions& options) {
 class Options : public CompilerOptions {
  public:
     cstring graphsDir{"."};
+    SummaryOptions summary;
     // read from json
     bool loadIRFromJson = false;
     Options() {
@@ -70,6 +71,22 @@ class Options : public CompilerOptions {
                        [this](const char* arg) { graphsDir = arg; return true; },
                        "Use this directory to dump graphs in dot format "
                        "(default is current working directory)\n");
+        registerOption("--graphs-summarize", nullptr,
+                       [this](const char*) { summary.summarize = true; return true; },
+                       "Collapse straight-line regions of tables, statements and parser\n"
+                       "states, and repeated applications of a table, into single vertices\n");
+        registerOption("--graphs-max-vertices", "n",
+                       [this](const char* arg) {
+                           summary.maxVertices = strtoul(arg, nullptr, 10);
+                           if (summary.maxVertices == 0) {
+                               ::error(ErrorType::ERR_INVALID,
+                                       "Invalid number of vertices %1%", arg);
+                               return false;
+                           }
+                           return true;
+                       },
+                       "Collapse the vertices of each graph past the first n into a single\n"
+                       "vertex (default is no limit)\n");
         registerOption("--fromJSON", "file",
                 [this](const char* arg) { loadIRFromJson = true; file = arg; return true; },
                 "Use IR representation from JsonFile dumped previously,"\
@@ -109,7 +126,7 @@ int main(int argc, char *const argv[]) {
         }
 
         std::istream inJson(&fb);
-        JSONLoader jsonFileLoader(inJson);
+        JSONStreamLoader jsonFileLoader(inJson);
         if (jsonFileLoader.json == nullptr) {
             ::error(ErrorType::ERR_IO, "Not valid input file");
             return 1;
@@ -142,7 +159,8 @@ int main(int argc, char *const argv[]) {
     try {
         top = midEnd.process(program);
         if (options.dumpJsonFile)
-            JSONGenerator(*openFile(options.dumpJsonFile, true)) << program << std::endl;
+            JSONGenerator(*openFile(options.dumpJsonFile, true), false, options.compactJson)
+                << program << std::endl;
     } catch (const std::exception &bug) {
         std::cerr << bug.what() << std::endl;
         return 1;
@@ -152,10 +170,12 @@ int main(int argc, char *const argv[]) {
 
     LOG2("Generating graphs under " << options.graphsDir);
     LOG2("Generating control graphs");
-    graphs::ControlGraphs cgen(&midEnd.refMap, &midEnd.typeMap, options.graphsDir);
+    graphs::ControlGraphs cgen(&midEnd.refMap, &midEnd.typeMap, options.graphsDir,
+                               options.summary);
     top->getMain()->apply(cgen);
     LOG2("Generating parser graphs");
-    graphs::ParserGraphs pgg(&midEnd.refMap, &midEnd.typeMap, options.graphsDir);
+    graphs::ParserGraphs pgg(&midEnd.refMap, &midEnd.typeMap, options.graphsDir,
+                             options.summary);
     program->apply(pgg);
 
     return ::errorCount() > 0;
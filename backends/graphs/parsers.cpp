@@ -15,6 +15,9 @@
  * limitations under the License.
  */
 
+#include <set>
+#include <utility>
+
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/toP4/toP4.h"
 #include "lib/nullstream.h"
@@ -30,6 +33,51 @@ static cstring toString(const IR::Expression* expression) {
     return cstring(ss.str());
 }
 
+ParserGraphs::Vertices ParserGraphs::summarize(const IR::P4Parser* parser) const {
+    Vertices vertices;
+    const auto& parserStates = states.at(parser);
+    // the state following each state whose only transition is unconditional,
+    // if it has no other predecessor
+    std::map<const IR::ParserState*, const IR::ParserState*> next;
+    std::set<const IR::ParserState*> continued;
+    auto parserTransitions = transitions.find(parser);
+    if (summary.summarize && parserTransitions != transitions.end()) {
+        std::map<const IR::ParserState*, unsigned> in, out;
+        std::map<const IR::ParserState*, const TransitionEdge*> last;
+        for (auto edge : parserTransitions->second) {
+            out[edge->sourceState]++;
+            in[edge->destState]++;
+            last[edge->sourceState] = edge;
+        }
+        for (auto it : last) {
+            auto dest = it.second->destState;
+            if (out[it.first] == 1 && it.second->label == "always" && in[dest] == 1 &&
+                dest != it.first && dest->name != IR::ParserState::accept &&
+                dest->name != IR::ParserState::reject) {
+                next.emplace(it.first, dest);
+                continued.insert(dest);
+            }
+        }
+    }
+    auto addRegion = [&](const IR::ParserState* head) {
+        vertices.heads.push_back(head);
+        vertices.vertexOf.emplace(head, head);
+        Region region{head, 1};
+        for (auto it = next.find(head); it != next.end(); it = next.find(it->second)) {
+            if (!vertices.vertexOf.emplace(it->second, head).second) break;
+            region.last = it->second;
+            region.size++;
+        }
+        vertices.regions.emplace(head, region);
+    };
+    for (auto state : parserStates)
+        if (!continued.count(state)) addRegion(state);
+    // states on cycles of unconditional transitions
+    for (auto state : parserStates)
+        if (!vertices.vertexOf.count(state)) addRegion(state);
+    return vertices;
+}
+
 void ParserGraphs::postorder(const IR::P4Parser *parser) {
     auto path = Util::PathName(graphsDir).join(parser->name + ".dot");
     LOG2("Writing parser graph " << parser->name);
@@ -39,20 +87,59 @@ void ParserGraphs::postorder(const IR::P4Parser *parser) {
         return;
     }
 
+    auto vertices = summarize(parser);
+    // the vertices past summary.maxVertices are written as a single one
+    size_t kept = vertices.heads.size();
+    if (summary.maxVertices != 0 && kept > summary.maxVertices)
+        kept = summary.maxVertices - 1;
+    std::map<const IR::ParserState*, cstring> names;
+    unsigned truncated = 0;
+    for (size_t i = 0; i < vertices.heads.size(); i++) {
+        auto head = vertices.heads[i];
+        names.emplace(head, i < kept ? head->name.name : cstring("__TRUNCATED__"));
+        if (i >= kept) truncated += vertices.regions.at(head).size;
+    }
+
     (*out) << "digraph " << parser->name << "{" << std::endl;
-    for (auto state : states[parser]) {
-        cstring label = state->name;
+    for (size_t i = 0; i < kept; i++) {
+        auto head = vertices.heads[i];
+        const auto& region = vertices.regions.at(head);
+        cstring label = head->name;
+        if (region.size > 1)
+            label += (region.size == 2 ? "\n" : "\n...\n") + region.last->name.name;
+        auto state = region.last;
         if (state->selectExpression != nullptr &&
             state->selectExpression->is<IR::SelectExpression>()) {
             label += "\n" + toString(
                 state->selectExpression->to<IR::SelectExpression>()->select);
         }
-        (*out) << state->name.name << " [shape=rectangle,label=\"" <<
+        (*out) << head->name.name << " [shape=rectangle,label=\"" <<
                 label << "\"]" << std::endl;
     }
+    if (truncated != 0) {
+        (*out) << "__TRUNCATED__ [shape=rectangle,label=\"... " << truncated <<
+                " more states\"]" << std::endl;
+    }
 
+    auto vertexOf = [&](const IR::ParserState* state) {
+        auto it = vertices.vertexOf.find(state);
+        return it != vertices.vertexOf.end() ? it->second : state;
+    };
+    auto nameOf = [&](const IR::ParserState* head) {
+        auto it = names.find(head);
+        return it != names.end() ? it->second : head->name.name;
+    };
+    std::set<std::pair<cstring, cstring>> truncatedEdges;
     for (auto edge : transitions[parser]) {
-        *out << edge->sourceState->name.name << " -> " << edge->destState->name.name <<
+        auto source = vertexOf(edge->sourceState);
+        auto dest = vertexOf(edge->destState);
+        // transitions inside a region
+        if (source == dest && dest != edge->destState) continue;
+        auto sourceName = nameOf(source), destName = nameOf(dest);
+        if ((sourceName == "__TRUNCATED__" || destName == "__TRUNCATED__") &&
+            (sourceName == destName || !truncatedEdges.emplace(sourceName, destName).second))
+            continue;
+        *out << sourceName << " -> " << destName <<
                 " [label=\"" << edge->label << "\"]" << std::endl;
     }
     *out << "}" << std::endl;
@@ -24,6 +24,7 @@
 #include "lib/nullstream.h"
 #include "lib/path.h"
 #include "lib/safe_vector.h"
+#include "graphs.h"
 
 namespace P4 {
 // Forward declaration to avoid includes
@@ -36,6 +37,7 @@ namespace graphs {
 class ParserGraphs : public Inspector {
     const P4::ReferenceMap* refMap;
     const cstring graphsDir;
+    const SummaryOptions summary;
 
  protected:
     struct TransitionEdge {
@@ -52,9 +54,26 @@ class ParserGraphs : public Inspector {
     std::map<const IR::P4Parser*, safe_vector<const TransitionEdge*>> transitions;
     std::map<const IR::P4Parser*, safe_vector<const IR::ParserState*>> states;
 
+    /// A straight-line region of parser states written as a single vertex.
+    struct Region {
+        const IR::ParserState* last;
+        unsigned size;
+    };
+    /// The vertices written for the states of a parser, identified by their
+    /// first state, and the vertex of each state.
+    struct Vertices {
+        safe_vector<const IR::ParserState*> heads;
+        std::map<const IR::ParserState*, Region> regions;
+        std::map<const IR::ParserState*, const IR::ParserState*> vertexOf;
+    };
+    /// In summarized mode, collapses the chains of states connected by their
+    /// only transitions into regions; otherwise each state is its own vertex.
+    Vertices summarize(const IR::P4Parser* parser) const;
+
  public:
-    ParserGraphs(P4::ReferenceMap *refMap, P4::TypeMap *, const cstring &graphsDir) :
-            refMap(refMap), graphsDir(graphsDir) {
+    ParserGraphs(P4::ReferenceMap *refMap, P4::TypeMap *, const cstring &graphsDir,
+                 const SummaryOptions &summary = {}) :
+            refMap(refMap), graphsDir(graphsDir), summary(summary) {
         CHECK_NULL(refMap); setName("ParserGraphs");
     }
 
@@ -34,8 +34,7 @@ limitations under the License.
 #include "midend/eliminateNewtype.h"
 #include "midend/eliminateSerEnums.h"
 #include "midend/eliminateSwitch.h"
-#include "midend/flattenHeaders.h"
-#include "midend/flattenInterfaceStructs.h"
+#include "midend/flattenNestedTypes.h"
 #include "midend/replaceSelectRange.h"
 #include "midend/expandEmit.h"
 #include "midend/expandLookahead.h"
@@ -44,6 +43,7 @@ limitations under the License.
 #include "midend/nestedStructs.h"
 #include "midend/parserUnroll.h"
 #include "midend/noMatch.h"
+#include "midend/parallelBlocks.h"
 #include "midend/predication.h"
 #include "midend/removeExits.h"
 #include "midend/removeMiss.h"
@@ -99,16 +99,20 @@ MidEnd::MidEnd(CompilerOptions& options, std::ostream* outStream) {
         new P4::NestedStructs(&refMap, &typeMap),
         new P4::SimplifySelectList(&refMap, &typeMap),
         new P4::RemoveSelectBooleans(&refMap, &typeMap),
-        new P4::FlattenHeaders(&refMap, &typeMap),
-        new P4::FlattenInterfaceStructs(&refMap, &typeMap),
+        new P4::FlattenNestedTypes(&refMap, &typeMap),
         new P4::ReplaceSelectRange(&refMap, &typeMap),
-        new P4::Predication(&refMap),
-        new P4::MoveDeclarations(),  // more may have been introduced
-        new P4::ConstantFolding(&refMap, &typeMap),
-        new P4::LocalCopyPropagation(&refMap, &typeMap),
-        new P4::ConstantFolding(&refMap, &typeMap),
-        new P4::StrengthReduction(&refMap, &typeMap),
-        new P4::MoveDeclarations(),  // more may have been introduced
+        // these passes only change the insides of controls, so can run on each separately
+        new P4::ParallelBlocks(&refMap, &typeMap,
+            [](P4::ReferenceMap *refMap, P4::TypeMap *typeMap) {
+                return new PassManager({
+                    new P4::Predication(refMap),
+                    new P4::MoveDeclarations(),  // more may have been introduced
+                    new P4::ConstantFolding(refMap, typeMap),
+                    new P4::LocalCopyPropagation(refMap, typeMap),
+                    new P4::ConstantFolding(refMap, typeMap),
+                    new P4::StrengthReduction(refMap, typeMap),
+                    new P4::MoveDeclarations(),  // more may have been introduced
+                }); }),
         new P4::SimplifyControlFlow(&refMap, &typeMap),
         new P4::CompileTimeOperations(),
         new P4::TableHit(&refMap, &typeMap),
@@ -121,13 +125,13 @@ MidEnd::MidEnd(CompilerOptions& options, std::ostream* outStream) {
                 // nothing further to do
                 return nullptr;
             // Special handling when compiling for v1model.p4
-            if (main->type->name == P4V1::V1Model::instance.sw.name) {
+            if (main->type->name == P4V1::V1Model::instance().sw.name) {
                 if (main->getConstructorParameters()->size() != 6)
                     return root;
-                auto verify = main->getParameterValue(P4V1::V1Model::instance.sw.verify.name);
+                auto verify = main->getParameterValue(P4V1::V1Model::instance().sw.verify.name);
                 auto update = main->getParameterValue(
-                    P4V1::V1Model::instance.sw.compute.name);
-                auto deparser = main->getParameterValue(P4V1::V1Model::instance.sw.deparser.name);
+                    P4V1::V1Model::instance().sw.compute.name);
+                auto deparser = main->getParameterValue(P4V1::V1Model::instance().sw.deparser.name);
                 if (verify == nullptr || update == nullptr || deparser == nullptr ||
                     !verify->is<IR::ControlBlock>() || !update->is<IR::ControlBlock>() ||
                     !deparser->is<IR::ControlBlock>()) {
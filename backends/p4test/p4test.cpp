@@ -20,7 +20,10 @@ limitations under the License.
 #include "backends/p4test/version.h"
 #include "control-plane/p4RuntimeSerializer.h"
 #include "ir/ir.h"
+#include "ir/binary_loader.h"
 #include "ir/json_loader.h"
+#include "lib/batch_compile.h"
+#include "lib/compile_server.h"
 #include "lib/log.h"
 #include "lib/error.h"
 #include "lib/exceptions.h"
@@ -39,6 +42,7 @@ class P4TestOptions : public CompilerOptions {
     bool parseOnly = false;
     bool validateOnly = false;
     bool loadIRFromJson = false;
+    bool loadIRFromBinary = false;
     P4TestOptions() {
         registerOption("--listMidendPasses", nullptr,
                 [this](const char*) {
@@ -66,6 +70,13 @@ class P4TestOptions : public CompilerOptions {
                            return true;
                        },
                        "read previously dumped json instead of P4 source code");
+        registerOption("--fromBinaryIR", "file",
+                       [this](const char* arg) {
+                           loadIRFromBinary = true;
+                           file = arg;
+                           return true;
+                       },
+                       "read IR previously dumped with --toBinaryIR instead of P4 source code");
      }
 };
 
@@ -83,17 +94,14 @@ static void log_dump(const IR::Node *node, const char *head) {
             std::cout << *node << std::endl; }
 }
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-    setup_signals();
-
+static int compileProgram(int argc, char *const argv[]) {
     AutoCompileContext autoP4TestContext(new P4TestContext);
     auto& options = P4TestContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
     options.compilerVersion = P4TEST_VERSION_STRING;
 
     if (options.process(argc, argv) != nullptr) {
-            if (options.loadIRFromJson == false)
+            if (options.loadIRFromJson == false && options.loadIRFromBinary == false)
                     options.setInputFile();
     }
     if (::errorCount() > 0)
@@ -103,13 +111,20 @@ int main(int argc, char *const argv[]) {
     if (options.loadIRFromJson) {
         std::ifstream json(options.file);
         if (json) {
-            JSONLoader loader(json);
+            JSONStreamLoader loader(json);
             const IR::Node* node = nullptr;
             loader >> node;
             if (!(program = node->to<IR::P4Program>()))
                 error(ErrorType::ERR_INVALID, "%s is not a P4Program in json format", options.file);
         } else {
             error(ErrorType::ERR_IO, "Can't open %s", options.file); }
+    } else if (options.loadIRFromBinary) {
+        BinaryLoader loader(options.file);
+        if (!loader.valid())
+            error(ErrorType::ERR_IO, "%s: %s", options.file, loader.error());
+        else if (!(program = loader.root()->to<IR::P4Program>()))
+            error(ErrorType::ERR_INVALID, "%s is not a P4Program in binary IR format",
+                  options.file);
     } else {
         program = P4::parseP4File(options);
 
@@ -137,6 +152,8 @@ int main(int argc, char *const argv[]) {
         if (!options.parseOnly && !options.validateOnly) {
             P4Test::MidEnd midEnd(options);
             midEnd.addDebugHook(hook);
+            if (options.profileMidendPasses)
+                midEnd.setProfile(&std::cerr);
 #if 0
             /* doing this breaks the output until we get dump/undump of srcInfo */
             if (options.debugJson) {
@@ -160,7 +177,10 @@ int main(int argc, char *const argv[]) {
         }
         if (program) {
             if (options.dumpJsonFile)
-                JSONGenerator(*openFile(options.dumpJsonFile, true), true) << program << std::endl;
+                JSONGenerator(*openFile(options.dumpJsonFile, true), true, options.compactJson)
+                    << program << std::endl;
+            if (options.dumpBinaryFile)
+                BinaryGenerator(true).write(program, *openFile(options.dumpBinaryFile, true));
             if (options.debugJson) {
                 std::stringstream ss1, ss2;
                 JSONGenerator gen1(ss1), gen2(ss2);
@@ -188,3 +208,14 @@ int main(int argc, char *const argv[]) {
         std::cerr << "Done." << std::endl;
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+    setup_signals();
+
+    if (auto socket = Util::CompileServer::socketPath(argc, argv))
+        return Util::CompileServer::serve(socket, compileProgram);
+    if (Util::BatchCompile::requested(argc, argv))
+        return Util::BatchCompile::run(argc, argv, compileProgram);
+    return compileProgram(argc, argv);
+}
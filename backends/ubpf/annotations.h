@@ -0,0 +1,19 @@
+#ifndef P4C_UBPF_ANNOTATIONS_H
+#define P4C_UBPF_ANNOTATIONS_H
+
+#include "ir/ir.h"
+#include "frontends/p4/parseAnnotations.h"
+
+namespace UBPF {
+
+    /// Parses the standard annotations and the uBPF-specific ones.
+    class ParseAnnotations : public P4::ParseAnnotations {
+    public:
+        ParseAnnotations() : P4::ParseAnnotations("UBPF", true, {
+                    PARSE_EXPRESSION_LIST("per_core")
+                }) { }
+    };
+
+}
+
+#endif //P4C_UBPF_ANNOTATIONS_H
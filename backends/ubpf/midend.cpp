@@ -63,6 +63,12 @@ class EnumOn32Bits : public P4::ChooseEnumRepresentation {
     { return 32; }
 };
 
+/// The generated C code copies a whole structure with a single assignment.
+class CopyStructsAsBlocks : public P4::CopyStructuresPolicy {
+    bool copyAsBlock(const IR::Type_Struct*) const override
+    { return true; }
+};
+
 const IR::ToplevelBlock*
 MidEnd::run(EbpfOptions& options, const IR::P4Program* program, std::ostream* outStream) {
     if (program == nullptr && options.listMidendPasses == 0)
@@ -91,7 +97,8 @@ MidEnd::run(EbpfOptions& options, const IR::P4Program* program, std::ostream* ou
                 new P4::SimplifyParsers(&refMap),
                 new P4::StrengthReduction(&refMap, &typeMap),
                 new P4::SimplifyComparisons(&refMap, &typeMap),
-                new P4::CopyStructures(&refMap, &typeMap),
+                new P4::CopyStructures(&refMap, &typeMap, true, nullptr,
+                                       new CopyStructsAsBlocks()),
                 new P4::LocalCopyPropagation(&refMap, &typeMap),
                 new P4::SimplifySelectList(&refMap, &typeMap),
                 new P4::MoveDeclarations(),  // more may have been introduced
@@ -122,6 +129,8 @@ MidEnd::run(EbpfOptions& options, const IR::P4Program* program, std::ostream* ou
     }
     midEnd.setName("MidEnd");
     midEnd.addDebugHooks(hooks);
+    if (options.profileMidendPasses)
+        midEnd.setProfile(&std::cerr);
     program = program->apply(midEnd);
     if (::errorCount() > 0)
         return nullptr;
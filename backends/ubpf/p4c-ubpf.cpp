@@ -36,6 +36,7 @@ limitations under the License.
 #include "ir/json_loader.h"
 #include "fstream"
 #include "ubpfModel.h"
+#include "annotations.h"
 
 void compile(EbpfOptions& options) {
     auto hook = options.getDebugHook();
@@ -48,8 +49,8 @@ void compile(EbpfOptions& options) {
     if (::errorCount() > 0)
         return;
 
-    P4::FrontEnd frontend;
-    program = UBPF::UBPFModel::instance.run(program);
+    P4::FrontEnd frontend{UBPF::ParseAnnotations()};
+    program = UBPF::UBPFModel::instance().run(program);
     frontend.addDebugHook(hook);
     program = frontend.run(options, program);
     if (::errorCount() > 0)
@@ -26,21 +26,31 @@ struct standard_metadata;
 
 extern uint64_t entry(void *, struct standard_metadata *);
 typedef uint64_t (*packet_filter)(void *dp, struct standard_metadata *std_meta);
+/* Defined by the programs compiled with --emit-batch */
+extern void process_batch(void *pkts[], struct standard_metadata *std_meta[],
+                          uint64_t results[], uint32_t n) __attribute__((weak));
 
 void *run_and_record_output(packet_filter entry, const char *pcap_base, pcap_list_t *pkt_list, int debug);
 
+/* The ubpf tables do not declare a size; the emulated maps have a fixed capacity */
+#define UBPF_TEST_TABLE_SIZE 8192
+
 static void inline init_ubpf_table_test(char *name, unsigned int key_size, unsigned int value_size) {
-    struct bpf_table tbl = {
-        .name = name,
-        .type = 0,
-        .key_size = key_size,
-        .value_size = value_size,
-        .bpf_map = NULL
-    };
-    registry_add(&tbl);
+    /* The registry keeps a pointer to the table */
+    struct bpf_table *tbl = calloc(1, sizeof(struct bpf_table));
+    if (!tbl) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    tbl->name = name;
+    tbl->type = BPF_MAP_TYPE_HASH;
+    tbl->key_size = key_size;
+    tbl->value_size = value_size;
+    tbl->max_entries = UBPF_TEST_TABLE_SIZE;
+    tbl->bpf_map = NULL;
+    registry_add(tbl);
 }
 
-
 #define ubpf_printf(fmt, args) \
     ubpf_printf_test(fmt, args)
 #define ubpf_packet_data(ctx) \
@@ -53,6 +63,13 @@ static void inline init_ubpf_table_test(char *name, unsigned int key_size, unsig
     registry_lookup_table_elem(#table, key)
 #define ubpf_map_update(table, key, value) \
     registry_update_table(#table, key, value, 0)
+/* Looks up a vector of keys, for datapaths that process packets in batches */
+#define ubpf_map_lookup_batch(table, keys, count, values) \
+    registry_lookup_table_elems(#table, keys, count, values)
+#define ubpf_hash_crc32c(data, len) \
+    ubpf_hash_crc32c_test(data, len)
+/* The test runtime runs on a single core */
+#define ubpf_get_core_id() 0
 
 #define INIT_UBPF_TABLE(name, key_size, value_size) init_ubpf_table_test("&"name, key_size, value_size)
 
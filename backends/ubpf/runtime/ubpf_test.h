@@ -20,6 +20,12 @@ limitations under the License.
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
 
 #define MAX_PRINTF_LENGTH 80
 
@@ -81,5 +87,38 @@ static inline uint32_t ubpf_truncate_packet_test(void *ctx, int maxlen)
     return cutlen;
 }
 
+/* The CRC-32C of len bytes, with the CRC32 instructions of SSE4.2 or ARMv8 when
+ * the runtime is compiled for them (-msse4.2, -march=armv8-a+crc), 8 bytes at a time. */
+static inline uint32_t ubpf_hash_crc32c_test(const void *data, uint64_t len)
+{
+    const uint8_t *p = (const uint8_t *) data;
+    uint32_t crc = 0xFFFFFFFF;
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+    for (; len >= 8; len -= 8, p += 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+#if defined(__SSE4_2__)
+        crc = (uint32_t) _mm_crc32_u64(crc, word);
+#else
+        crc = __crc32cd(crc, word);
+#endif
+    }
+    for (; len > 0; len--, p++) {
+#if defined(__SSE4_2__)
+        crc = _mm_crc32_u8(crc, *p);
+#else
+        crc = __crc32cb(crc, *p);
+#endif
+    }
+#else
+    for (; len > 0; len--, p++) {
+        crc ^= *p;
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1));
+    }
+#endif
+    return crc ^ 0xFFFFFFFF;
+}
+
 
 #endif //P4C_UBPF_TEST_H
\ No newline at end of file
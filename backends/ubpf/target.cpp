@@ -119,6 +119,8 @@ namespace UBPF {
                 "static void *(*ubpf_packet_data)(const void *) = (void *)9;\n"
                 "static void *(*ubpf_adjust_head)(const void *, uint64_t) = (void *)8;\n"
                 "static uint32_t (*ubpf_truncate_packet)(const void *, uint64_t) = (void *)11;\n"
+                "static uint32_t (*ubpf_get_core_id)() = (void *)12;\n"
+                "static uint32_t (*ubpf_hash_crc32c)(const void *, uint64_t) = (void *)13;\n"
                 "\n");
         builder->newline();
         builder->appendLine(
@@ -178,6 +180,20 @@ namespace UBPF {
                     "    uint32_t tmp = csum32_sub(~csum_unfold(csum), from);\n"
                     "    return csum_fold(csum32_add(tmp, to));\n"
                     "}");
+        // A 64-bit one's complement sum folds to the same 16-bit sum as the 16-bit words
+        // it contains, so wide fields are updated with a few 64-bit additions.
+        builder->appendLine("inline uint64_t csum64_add(uint64_t csum, uint64_t addend) {\n"
+                    "    uint64_t res = csum;\n"
+                    "    res += addend;\n"
+                    "    return (res + (res < addend));\n"
+                    "}\n"
+                    "inline uint16_t csum64_fold(uint64_t csum) {\n"
+                    "    return csum_fold(csum32_add((uint32_t)csum, (uint32_t)(csum >> 32)));\n"
+                    "}\n"
+                    "inline uint16_t csum_replace8(uint16_t csum, uint64_t from, uint64_t to) {\n"
+                    "    uint64_t tmp = csum64_add((uint16_t)~csum, ~from);\n"
+                    "    return csum64_fold(csum64_add(tmp, to));\n"
+                    "}");
     }
 
 }  // namespace UBPF
@@ -23,6 +23,7 @@ limitations under the License.
 #include "codeGen.h"
 #include "target.h"
 #include "ubpfType.h"
+#include "backends/ebpf/codeReport.h"
 
 namespace UBPF {
 
@@ -54,6 +55,14 @@ namespace UBPF {
         if (!prog->build())
             return;
 
+        if (!options.reportFile.isNullOrEmpty()) {
+            auto rstream = openFile(options.reportFile, false);
+            if (rstream == nullptr)
+                return;
+            toplevel->getProgram()->apply(EBPF::CodeReport(refMap, typeMap, *rstream));
+            rstream->flush();
+        }
+
         if (options.outputFile.isNullOrEmpty())
             return;
 
@@ -75,11 +84,13 @@ namespace UBPF {
         UbpfCodeBuilder c(target);
         UbpfCodeBuilder h(target);
 
+        c.setOutput(cstream);
+        h.setOutput(hstream);
         prog->emitH(&h, hfile);
         prog->emitC(&c, UBPF::extract_file_name(hfile.c_str()));
 
-        *cstream << c.toString();
-        *hstream << h.toString();
+        c.flush();
+        h.flush();
         cstream->flush();
         hstream->flush();
     }
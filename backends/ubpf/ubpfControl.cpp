@@ -28,12 +28,13 @@ namespace UBPF {
     UBPFControlBodyTranslator::UBPFControlBodyTranslator(
             const UBPFControl *control) :
             EBPF::ControlBodyTranslator(control), control(control),
-            p4lib(P4::P4CoreLibrary::instance) {
+            p4lib(P4::P4CoreLibrary::instance()) {
         setName("UBPFControlBodyTranslator");
     }
 
     void UBPFControlBodyTranslator::processFunction(
             const P4::ExternFunction *function) {
+        invalidateRegisterValues(nullptr);
         if (function->method->name.name == control->program->model.drop.name) {
             builder->appendFormat("%s = false", control->passVariable);
             return;
@@ -45,12 +46,13 @@ namespace UBPF {
             builder->append(control->program->model.ubpf_time_get_ns.name + "()");
             return;
         } else if (function->method->name.name ==
-                   control->program->model.csum_replace2.name) {
-            processChecksumReplace2(function);
-            return;
-        } else if (function->method->name.name ==
-                   control->program->model.csum_replace4.name) {
-            processChecksumReplace4(function);
+                   control->program->model.csum_replace2.name ||
+                   function->method->name.name ==
+                   control->program->model.csum_replace4.name ||
+                   function->method->name.name ==
+                   control->program->model.csum_replace8.name) {
+            // The extern functions are implemented by the checksum helpers of the same name
+            processChecksumReplace(function, function->method->name.name);
             return;
         } else if (function->method->name.name == control->program->model.hash.name) {
             cstring hashKeyInstanceName = createHashKeyInstance(function);
@@ -62,6 +64,9 @@ namespace UBPF {
             if (algorithmType == control->program->model.hashAlgorithm.lookup3.name) {
                 builder->appendFormat(" = ubpf_hash(&%s, sizeof(%s))",
                         hashKeyInstanceName, hashKeyInstanceName);
+            } else if (algorithmType == control->program->model.hashAlgorithm.crc32c.name) {
+                builder->appendFormat(" = ubpf_hash_crc32c(&%s, sizeof(%s))",
+                        hashKeyInstanceName, hashKeyInstanceName);
             } else {
                 ::error(ErrorType::ERR_UNSUPPORTED,
                         "%1%: Not supported hash algorithm type", algorithmType);
@@ -82,21 +87,9 @@ namespace UBPF {
         processCustomExternFunction(function, UBPFTypeFactory::instance);
     }
 
-    void UBPFControlBodyTranslator::processChecksumReplace2(const P4::ExternFunction *function) {
-        builder->append(control->program->model.csum_replace2.name + "(");
-        auto v = function->expr->arguments;
-        bool first = true;
-        for (auto arg : *v) {
-            if (!first)
-                builder->append(", ");
-            first = false;
-            visit(arg);
-        }
-        builder->append(")");
-    }
-
-    void UBPFControlBodyTranslator::processChecksumReplace4(const P4::ExternFunction *function) {
-        builder->append(control->program->model.csum_replace4.name + "(");
+    void UBPFControlBodyTranslator::processChecksumReplace(const P4::ExternFunction *function,
+                                                           cstring helper) {
+        builder->append(helper + "(");
         auto v = function->expr->arguments;
         bool first = true;
         for (auto arg : *v) {
@@ -161,12 +154,25 @@ namespace UBPF {
                 return;
             }
         } else if (declType->name.name ==
-                   UBPFModel::instance.registerModel.name) {
+                   UBPFModel::instance().registerModel.name) {
             cstring name = decl->getName().name;
             auto pRegister = control->getRegister(name);
 
             if (method->method->name.name ==
-                UBPFModel::instance.registerModel.write.name) {
+                UBPFModel::instance().registerModel.write.name) {
+                auto key = registerKey(method->expr);
+                auto it = registerValues.find(std::make_pair(pRegister, key));
+                if (!key.isNullOrEmpty() && it != registerValues.end()) {
+                    pRegister->emitRegisterWriteInPlace(builder, method->expr, it->second);
+                    return;
+                }
+                // Updates may move the values of the map
+                for (auto v = registerValues.begin(); v != registerValues.end();) {
+                    if (v->first.first == pRegister)
+                        v = registerValues.erase(v);
+                    else
+                        ++v;
+                }
                 pRegister->emitKeyInstance(builder, method->expr);
             }
 
@@ -176,10 +182,29 @@ namespace UBPF {
         ::error(ErrorType::ERR_UNEXPECTED, "%1%: Unexpected method call", method->expr);
     }
 
+    cstring UBPFControlBodyTranslator::registerKey(const IR::MethodCallExpression *method) const {
+        auto key = method->arguments->at(0)->expression;
+        if (!control->program->options.directAccess ||
+            (!key->is<IR::Constant>() && !key->is<IR::PathExpression>()))
+            return nullptr;
+        return key->toString();
+    }
+
+    void UBPFControlBodyTranslator::invalidateRegisterValues(cstring variable) {
+        for (auto v = registerValues.begin(); v != registerValues.end();) {
+            if (variable.isNullOrEmpty() || v->first.second == variable)
+                v = registerValues.erase(v);
+            else
+                ++v;
+        }
+    }
+
     void
     UBPFControlBodyTranslator::processApply(const P4::ApplyMethod *method) {
         auto table = control->getTable(method->object->getName().name);
         BUG_CHECK(table != nullptr, "No table for %1%", method->expr);
+        // The actions may modify the keys
+        invalidateRegisterValues(nullptr);
 
         cstring actionVariableName;
         if (!saveAction.empty()) {
@@ -347,11 +372,19 @@ namespace UBPF {
     }
 
     bool UBPFControlBodyTranslator::preorder(const IR::AssignmentStatement *a) {
+        auto root = a->left;
+        while (auto member = root->to<IR::Member>())
+            root = member->expr;
+        if (auto path = root->to<IR::PathExpression>())
+            invalidateRegisterValues(path->toString());
+        else
+            invalidateRegisterValues(nullptr);
+
         if (a->right->is<IR::MethodCallExpression>()) {
             auto method = a->right->to<IR::MethodCallExpression>();
             if (method->method->is<IR::Member>()) {
                 auto methodName = method->method->to<IR::Member>()->member.name;
-                if (methodName == UBPFModel::instance.registerModel.read.name) {
+                if (methodName == UBPFModel::instance().registerModel.read.name) {
                     return emitRegisterRead(a, method);
                 }
             }
@@ -370,7 +403,7 @@ namespace UBPF {
         auto pRegister = control->getRegister(registerName);
         pRegister->emitKeyInstance(builder, method);
 
-        auto etype = UBPFTypeFactory::instance->create(pRegister->keyType);
+        auto etype = UBPFTypeFactory::instance->create(pRegister->valueType);
         auto tmp = control->program->refMap->newName("tmp");
         etype->declare(builder, tmp, true);
         builder->endOfStatement(true);
@@ -393,6 +426,11 @@ namespace UBPF {
         builder->endOfStatement();
 
         registersLookups.push_back(pRegister);
+        // The value stays valid until the end of the control, which closes the block
+        auto key = registerKey(method);
+        if (!key.isNullOrEmpty() &&
+            getContext()->node == control->controlBlock->container->body)
+            registerValues[std::make_pair(pRegister, key)] = tmp;
 
         return false;
     }
@@ -455,6 +493,11 @@ namespace UBPF {
 
     bool
     UBPFControlBodyTranslator::preorder(const IR::SwitchStatement *statement) {
+        auto type = control->program->typeMap->getType(statement->expression, true);
+        if (!type->is<IR::Type_ActionEnum>())
+            // A switch on a scalar value is translated to a C switch
+            return EBPF::ControlBodyTranslator::preorder(statement);
+
         cstring newName = control->program->refMap->newName("action_run");
         saveAction.push_back(newName);
         // This must be a table.apply().action_run
@@ -587,7 +630,7 @@ namespace UBPF {
                     auto di = node->to<IR::Declaration_Instance>();
                     auto type = di->type->to<IR::Type_Specialized>();
                     auto externTypeName = type->baseType->path->name.name;
-                    if (externTypeName == UBPFModel::instance.registerModel.name) {
+                    if (externTypeName == UBPFModel::instance().registerModel.name) {
                         cstring name = di->name.name;
                         auto ctr = new UBPFRegister(program, ctrblk, name, codeGen);
                         registers.emplace(name, ctr);
@@ -658,7 +701,7 @@ namespace UBPF {
         hitVariable = program->refMap->newName("hit");
         passVariable = program->refMap->newName("pass");
         auto pl = controlBlock->container->type->applyParams;
-        size_t numberOfArgs = UBPFModel::instance.numberOfControlBlockArguments();
+        size_t numberOfArgs = UBPFModel::instance().numberOfControlBlockArguments();
         if (pl->size() != numberOfArgs) {
             ::error(ErrorType::ERR_EXPECTED,
                     "Expected control block to have exactly %d parameter", numberOfArgs);
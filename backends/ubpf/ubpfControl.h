@@ -32,13 +32,16 @@ namespace UBPF {
         P4::P4CoreLibrary &p4lib;
 
         std::vector<UBPFRegister *> registersLookups;
+        /// With --direct-access, the pointers to the register elements read by the top-level
+        /// statements of the control, indexed by the register and the key, while they are
+        /// valid.
+        std::map<std::pair<const UBPFRegister *, cstring>, cstring> registerValues;
 
         explicit UBPFControlBodyTranslator(const UBPFControl *control);
         virtual void processMethod(const P4::ExternMethod *method) override;
         virtual void processApply(const P4::ApplyMethod *method) override;
         virtual void processFunction(const P4::ExternFunction *function) override;
-        void processChecksumReplace2(const P4::ExternFunction *function);
-        void processChecksumReplace4(const P4::ExternFunction *function);
+        void processChecksumReplace(const P4::ExternFunction *function, cstring helper);
         bool preorder(const IR::PathExpression *expression) override;
         bool preorder(const IR::MethodCallStatement *s) override;
         bool preorder(const IR::MethodCallExpression *expression) override;
@@ -54,6 +57,9 @@ namespace UBPF {
         cstring createHashKeyInstance(const P4::ExternFunction *function);
         void emitAssignmentStatement(const IR::AssignmentStatement *a);
         bool emitRegisterRead(const IR::AssignmentStatement *a, const IR::MethodCallExpression *method);
+        /// The key of the register elements that can be cached, or nullptr.
+        cstring registerKey(const IR::MethodCallExpression *method) const;
+        void invalidateRegisterValues(cstring variable);
     };
 
     class UBPFControl : public EBPF::EBPFControl {
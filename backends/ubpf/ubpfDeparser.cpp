@@ -15,6 +15,8 @@ limitations under the License.
 */
 
 #include "ubpfDeparser.h"
+#include "ubpfControl.h"
+#include "ubpfParser.h"
 #include "ubpfType.h"
 #include "frontends/p4/methodInstance.h"
 
@@ -64,7 +66,7 @@ class OutHeaderSize final : public EBPF::CodeGenInspector {
     { return illegal(statement); }
     bool preorder(const IR::MethodCallStatement* statement) override {
         LOG5("Calculate OutHeaderSize");
-        auto &p4lib = P4::P4CoreLibrary::instance;
+        auto &p4lib = P4::P4CoreLibrary::instance();
 
         auto mi = P4::MethodInstance::resolve(statement->methodCall, refMap, typeMap);
         auto method = mi->to<P4::ExternMethod>();
@@ -102,11 +104,89 @@ class OutHeaderSize final : public EBPF::CodeGenInspector {
     { substitution.emplace(p, with); }
 };
 
+/// Finds the header fields written by a parser or a control, and whether the validity
+/// of the headers can change.
+class HeaderWrites final : public Inspector {
+    P4::ReferenceMap*       refMap;
+    P4::TypeMap*            typeMap;
+    const IR::Parameter*    headers;
+
+    bool isHeaders(const IR::Expression* expression) const {
+        auto path = expression->to<IR::PathExpression>();
+        return path != nullptr && refMap->getDeclaration(path->path, true) == headers;
+    }
+
+    void written(const IR::Expression* expression) {
+        while (auto slice = expression->to<IR::Slice>())
+            expression = slice->e0;
+        if (auto field = expression->to<IR::Member>()) {
+            auto header = field->expr->to<IR::Member>();
+            if (header != nullptr && isHeaders(header->expr) &&
+                typeMap->getType(header, true)->is<IR::Type_Header>()) {
+                fields[header->member.name].emplace(field->member.name);
+                return;
+            }
+        }
+        // Whole headers, header stacks and unions carry their validity
+        auto root = expression;
+        while (true) {
+            if (auto member = root->to<IR::Member>())
+                root = member->expr;
+            else if (auto index = root->to<IR::ArrayIndex>())
+                root = index->left;
+            else if (auto slice = root->to<IR::Slice>())
+                root = slice->e0;
+            else
+                break;
+        }
+        if (isHeaders(root))
+            validityChanges = true;
+    }
+
+ public:
+    HeaderFields    fields;
+    bool            validityChanges = false;
+
+    HeaderWrites(P4::ReferenceMap* refMap, P4::TypeMap* typeMap, const IR::Parameter* headers) :
+            refMap(refMap), typeMap(typeMap), headers(headers) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(headers);
+        setName("HeaderWrites"); }
+    void postorder(const IR::AssignmentStatement* statement) override
+    { written(statement->left); }
+    void postorder(const IR::MethodCallExpression* expression) override {
+        auto mi = P4::MethodInstance::resolve(expression, refMap, typeMap);
+        if (auto builtin = mi->to<P4::BuiltInMethod>()) {
+            if (builtin->name != IR::Type_Header::isValid)
+                validityChanges = true;
+            return;
+        }
+        if (auto method = mi->to<P4::ExternMethod>()) {
+            if (method->originalExternType->name.name ==
+                    P4::P4CoreLibrary::instance().packetIn.name &&
+                method->method->name.name == P4::P4CoreLibrary::instance().packetIn.extract.name) {
+                // The parser sets the layout; only headers of the headers structure are tracked
+                auto header = expression->arguments->at(0)->expression->to<IR::Member>();
+                if (header == nullptr || !isHeaders(header->expr))
+                    validityChanges = true;
+                return;
+            }
+        }
+        for (auto param : mi->getActualParameters()->parameters) {
+            if (param->direction != IR::Direction::Out &&
+                param->direction != IR::Direction::InOut)
+                continue;
+            auto argument = mi->substitution.lookup(param);
+            if (argument != nullptr)
+                written(argument->expression);
+        }
+    }
+};
+
 UBPFDeparserTranslationVisitor::UBPFDeparserTranslationVisitor(
         const UBPFDeparser *deparser) :
         CodeGenInspector(deparser->program->refMap,
                          deparser->program->typeMap), deparser(deparser),
-        p4lib(P4::P4CoreLibrary::instance) {
+        p4lib(P4::P4CoreLibrary::instance()) {
     setName("UBPFDeparserTranslationVisitor");
 }
 
@@ -243,6 +323,11 @@ void UBPFDeparserTranslationVisitor::compileEmit(const IR::Vector<IR::Argument>
         return;
     }
 
+    if (dirtyFields != nullptr) {
+        compileEmitInPlace(expr, ht);
+        return;
+    }
+
     builder->emitIndent();
     builder->append("if (");
     visit(expr);
@@ -282,6 +367,64 @@ void UBPFDeparserTranslationVisitor::compileEmit(const IR::Vector<IR::Argument>
     builder->blockEnd(true);
 }
 
+void UBPFDeparserTranslationVisitor::compileEmitInPlace(const IR::Expression *expr,
+                                                        const IR::Type_Header *ht) {
+    // The header is at the offset where the parser extracted it, and the packet is at
+    // least as long as the headers.
+    auto program = deparser->program;
+    auto header = expr->to<IR::Member>();
+    CHECK_NULL(header);
+    auto dirty = dirtyFields->find(header->member.name);
+
+    builder->emitIndent();
+    builder->append("if (");
+    visit(expr);
+    builder->append(".ebpf_valid) ");
+    if (dirty == dirtyFields->end()) {
+        builder->newline();
+        builder->increaseIndent();
+        builder->emitIndent();
+        builder->appendFormat("%s += %d", program->offsetVar.c_str(), ht->width_bits());
+        builder->endOfStatement(true);
+        builder->decreaseIndent();
+        return;
+    }
+    builder->blockStart();
+
+    unsigned alignment = 0;
+    unsigned skipped = 0;
+    for (auto f : ht->fields) {
+        auto ftype = typeMap->getType(f);
+        auto etype = UBPFTypeFactory::instance->create(ftype);
+        auto et = dynamic_cast<EBPF::IHasWidth *>(etype);
+        if (et == nullptr) {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "Only headers with fixed widths supported %1%", f);
+            return;
+        }
+        if (dirty->second.count(f->name.name) != 0) {
+            if (skipped != 0) {
+                builder->emitIndent();
+                builder->appendFormat("%s += %d", program->offsetVar.c_str(), skipped);
+                builder->endOfStatement(true);
+                skipped = 0;
+            }
+            compileEmitField(expr, f->name, alignment, etype);
+        } else {
+            skipped += et->widthInBits();
+        }
+        alignment += et->widthInBits();
+        alignment %= 8;
+    }
+    if (skipped != 0) {
+        builder->emitIndent();
+        builder->appendFormat("%s += %d", program->offsetVar.c_str(), skipped);
+        builder->endOfStatement(true);
+    }
+
+    builder->blockEnd(true);
+}
+
 bool UBPFDeparserTranslationVisitor::preorder(const IR::MethodCallExpression *expression) {
     auto mi = P4::MethodInstance::resolve(expression,
                                           deparser->program->refMap,
@@ -319,9 +462,106 @@ bool UBPFDeparser::build() {
     codeGen = new UBPFDeparserTranslationVisitor(this);
     codeGen->substitute(headers, parserHeaders);
 
+    auto parser = program->parser;
+    auto control = program->control;
+    inPlace = canEmitInPlace(parser->parserBlock->container, control->controlBlock->container);
+
     return ::errorCount() == 0;
 }
 
+bool UBPFDeparser::canEmitInPlace(const IR::Node *parser, const IR::Node *control) {
+    auto refMap = program->refMap;
+    auto typeMap = program->typeMap;
+
+    HeaderWrites parserWrites(refMap, typeMap, program->parser->headers);
+    parser->apply(parserWrites);
+    HeaderWrites controlWrites(refMap, typeMap, program->control->headers);
+    control->apply(controlWrites);
+    if (parserWrites.validityChanges || controlWrites.validityChanges)
+        return false;
+
+    // The position of each header in the deparser
+    std::map<cstring, size_t> emitted;
+    for (auto statement : controlBlock->container->body->components) {
+        auto call = statement->to<IR::MethodCallStatement>();
+        if (call == nullptr)
+            return false;
+        auto header = call->methodCall->arguments->size() == 1 ?
+                call->methodCall->arguments->at(0)->expression->to<IR::Member>() : nullptr;
+        if (header == nullptr || !header->expr->is<IR::PathExpression>() ||
+            emitted.count(header->member.name) != 0)
+            return false;
+        emitted.emplace(header->member.name, emitted.size());
+    }
+
+    // The headers extracted by each state, and the states that follow it
+    auto parserStates = program->parser->parserBlock->container->states;
+    std::map<cstring, std::vector<cstring>> extracted;
+    std::map<cstring, std::set<cstring>> next;
+    for (auto state : parserStates) {
+        auto& headers = extracted[state->name.name];
+        for (auto component : state->components) {
+            auto call = component->to<IR::MethodCallStatement>();
+            if (call == nullptr)
+                continue;
+            auto mi = P4::MethodInstance::resolve(call->methodCall, refMap, typeMap);
+            auto method = mi->to<P4::ExternMethod>();
+            if (method != nullptr &&
+                method->originalExternType->name.name ==
+                    P4::P4CoreLibrary::instance().packetIn.name &&
+                method->method->name.name == P4::P4CoreLibrary::instance().packetIn.extract.name)
+                headers.push_back(
+                        call->methodCall->arguments->at(0)->expression->to<IR::Member>()
+                        ->member.name);
+        }
+        auto& successors = next[state->name.name];
+        if (auto path = state->selectExpression->to<IR::PathExpression>()) {
+            successors.emplace(path->path->name.name);
+        } else if (auto select = state->selectExpression->to<IR::SelectExpression>()) {
+            for (auto c : select->selectCases)
+                successors.emplace(c->state->path->name.name);
+        }
+    }
+
+    // On every path, the headers must be extracted once, in the order of the deparser
+    auto precedes = [&emitted](cstring first, cstring second) {
+        if (first == second)
+            return false;
+        auto f = emitted.find(first), s = emitted.find(second);
+        // Headers that are not emitted change the length of the packet
+        return f == emitted.end() || s == emitted.end() || f->second < s->second;
+    };
+    for (auto state : parserStates) {
+        auto& headers = extracted[state->name.name];
+        for (size_t i = 0; i < headers.size(); i++)
+            for (size_t j = i + 1; j < headers.size(); j++)
+                if (!precedes(headers.at(i), headers.at(j)))
+                    return false;
+        if (headers.empty())
+            continue;
+        std::set<cstring> reached;
+        std::vector<cstring> toVisit(next[state->name.name].begin(),
+                                     next[state->name.name].end());
+        while (!toVisit.empty()) {
+            auto name = toVisit.back();
+            toVisit.pop_back();
+            if (!reached.emplace(name).second)
+                continue;
+            for (auto header : headers)
+                for (auto later : extracted[name])
+                    if (!precedes(header, later))
+                        return false;
+            toVisit.insert(toVisit.end(), next[name].begin(), next[name].end());
+        }
+    }
+
+    dirtyFields = parserWrites.fields;
+    for (auto& header : controlWrites.fields)
+        dirtyFields[header.first].insert(header.second.begin(), header.second.end());
+    LOG2("Deparser rewrites the headers in place when their layout does not change");
+    return true;
+}
+
 void UBPFDeparser::emit(EBPF::CodeBuilder *builder) {
     builder->emitIndent();
     builder->appendFormat("int %s = 0", program->outerHdrLengthVar.c_str());
@@ -370,6 +610,22 @@ void UBPFDeparser::emit(EBPF::CodeBuilder *builder) {
     builder->newline();
 
     codeGen->setBuilder(builder);
+    if (inPlace) {
+        builder->emitIndent();
+        builder->appendFormat("if (%s == 0) ", program->outerHdrOffsetVar.c_str());
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("/* The layout did not change: only write the modified fields */");
+        codeGen->dirtyFields = &dirtyFields;
+        controlBlock->container->body->apply(*codeGen);
+        codeGen->dirtyFields = nullptr;
+        builder->blockEnd(false);
+        builder->append(" else ");
+        builder->blockStart();
+        controlBlock->container->body->apply(*codeGen);
+        builder->blockEnd(true);
+        return;
+    }
     controlBlock->container->body->apply(*codeGen);
 }
 }  // namespace UBPF
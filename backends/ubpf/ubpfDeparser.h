@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef P4C_UBPFDEPARSER_H
 #define P4C_UBPFDEPARSER_H
 
+#include <map>
+#include <set>
+
 #include "ir/ir.h"
 #include "ubpfProgram.h"
 #include "ebpf/ebpfObject.h"
@@ -26,16 +29,23 @@ namespace UBPF {
 
     class UBPFDeparser;
 
+    /// The fields of each header that are modified, indexed by the names of the headers.
+    typedef std::map<cstring, std::set<cstring>> HeaderFields;
+
     class UBPFDeparserTranslationVisitor : public EBPF::CodeGenInspector {
     public:
         const UBPFDeparser *deparser;
         P4::P4CoreLibrary &p4lib;
+        /// If set, the layout of the headers did not change and only these fields
+        /// are written.
+        const HeaderFields *dirtyFields = nullptr;
 
         explicit UBPFDeparserTranslationVisitor(const UBPFDeparser *deparser);
 
         virtual void compileEmitField(const IR::Expression *expr, cstring field,
                                       unsigned alignment, EBPF::EBPFType *type);
         virtual void compileEmit(const IR::Vector<IR::Argument> *args);
+        void compileEmitInPlace(const IR::Expression *expr, const IR::Type_Header *ht);
 
         bool notSupported(const IR::Expression* expression)
         { ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
@@ -66,6 +76,11 @@ namespace UBPF {
         const IR::Parameter *parserHeaders;
 
         UBPFDeparserTranslationVisitor *codeGen;
+        /// True if the headers can be rewritten in place when their layout did not change:
+        /// no header changes its validity after the parser, and the deparser emits the headers
+        /// in the order of the parser.
+        bool inPlace = false;
+        HeaderFields dirtyFields;
 
         UBPFDeparser(const UBPFProgram *program, const IR::ControlBlock *block,
                      const IR::Parameter *parserHeaders) :
@@ -74,6 +89,9 @@ namespace UBPF {
 
         bool build();
         void emit(EBPF::CodeBuilder *builder);
+
+    private:
+        bool canEmitInPlace(const IR::Node *parser, const IR::Node *control);
     };
 
 }
@@ -16,9 +16,16 @@ limitations under the License.
 
 #include "ubpfModel.h"
 
+#include "lib/startup_profile.h"
+
 namespace UBPF {
 
     cstring UBPFModel::reservedPrefix = "ubpf_";
-    UBPFModel UBPFModel::instance;
+
+    UBPFModel &UBPFModel::instance() {
+        static UBPFModel *rv = Util::StartupProfile::time("UBPFModel", [] {
+            return new UBPFModel; });
+        return *rv;
+    }
 
 }
@@ -50,9 +50,10 @@ namespace UBPF {
 
     struct Algorithm_Model : public ::Model::Enum_Model {
         Algorithm_Model() : ::Model::Enum_Model("HashAlgorithm"),
-                            lookup3("lookup3") {}
+                            lookup3("lookup3"), crc32c("crc32c") {}
 
         ::Model::Elem lookup3;
+        ::Model::Elem crc32c;
     };
 
     struct Hash_Model : public ::Model::Elem {
@@ -62,7 +63,7 @@ namespace UBPF {
     class UBPFModel : public ::Model::Model {
     protected:
         UBPFModel() : CPacketName("pkt"),
-                      packet("packet", P4::P4CoreLibrary::instance.packetIn, 0),
+                      packet("packet", P4::P4CoreLibrary::instance().packetIn, 0),
                       pipeline(),
                       registerModel(),
                       drop("mark_to_drop"),
@@ -71,11 +72,13 @@ namespace UBPF {
                       truncate("truncate"),
                       csum_replace2("csum_replace2"),
                       csum_replace4("csum_replace4"),
+                      csum_replace8("csum_replace8"),
                       hashAlgorithm(),
                       hash() {}
 
     public:
-        static UBPFModel instance;
+        /// created on first use, to keep it out of the startup of the compiler
+        static UBPFModel &instance();
         static cstring reservedPrefix;
 
         ::Model::Elem CPacketName;
@@ -88,6 +91,7 @@ namespace UBPF {
         ::Model::Elem truncate;
         ::Model::Extern_Model csum_replace2;
         ::Model::Extern_Model csum_replace4;
+        ::Model::Extern_Model csum_replace8;
         Algorithm_Model hashAlgorithm;
         Hash_Model hash;
         unsigned version = 20200515;
@@ -101,7 +105,7 @@ namespace UBPF {
             bool preorder(const IR::Declaration_Constant *dc) override {
                 if (dc->name == "__ubpf_model_version") {
                     auto val = dc->initializer->to<IR::Constant>();
-                    UBPFModel::instance.version = static_cast<unsigned>(val->value); }
+                    UBPFModel::instance().version = static_cast<unsigned>(val->value); }
                 return false; }
             bool preorder(const IR::Declaration *) override { return false; }
         };
@@ -51,7 +51,7 @@ class UBPFStateTranslationVisitor : public EBPF::CodeGenInspector {
  public:
     explicit UBPFStateTranslationVisitor(const UBPFParserState* state) :
             CodeGenInspector(state->parser->program->refMap, state->parser->program->typeMap),
-            p4lib(P4::P4CoreLibrary::instance), state(state) {}
+            p4lib(P4::P4CoreLibrary::instance()), state(state) {}
     bool preorder(const IR::ParserState* state) override;
     bool preorder(const IR::SelectCase* selectCase) override;
     bool preorder(const IR::SelectExpression* expression) override;
@@ -481,7 +481,7 @@ void UBPFParser::emit(EBPF::CodeBuilder *builder) {
 
 bool UBPFParser::build() {
     auto pl = parserBlock->container->type->applyParams;
-    size_t numberOfArgs = UBPFModel::instance.numberOfParserArguments();
+    size_t numberOfArgs = UBPFModel::instance().numberOfParserArguments();
     if (pl->size() != numberOfArgs) {
         ::error(ErrorType::ERR_EXPECTED,
                 "Expected parser to have exactly %d parameters", numberOfArgs);
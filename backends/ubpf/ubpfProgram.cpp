@@ -127,6 +127,24 @@ namespace UBPF {
         builder->appendFormat("return %s;\n", builder->target->dropReturnCode().c_str());
         builder->decreaseIndent();
         builder->blockEnd(true);
+
+        if (options.emitBatch)
+            emitBatchEntry(builder, "entry");
+    }
+
+    void UBPFProgram::emitBatchEntry(EBPF::CodeBuilder *builder, cstring entry) {
+        builder->newline();
+        builder->append("void process_batch(void *pkts[], struct standard_metadata *std_meta[], "
+                        "uint64_t results[], uint32_t n) ");
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("for (uint32_t i = 0; i < n; i++)");
+        builder->increaseIndent();
+        builder->emitIndent();
+        builder->appendFormat("results[i] = %s(pkts[i], std_meta[i]);", entry.c_str());
+        builder->newline();
+        builder->decreaseIndent();
+        builder->blockEnd(true);
     }
 
     void UBPFProgram::emitH(EBPF::CodeBuilder *builder, cstring) {
@@ -49,7 +49,7 @@ namespace UBPF {
 
         UBPFProgram(const EbpfOptions &options, const IR::P4Program *program,
                     P4::ReferenceMap *refMap, P4::TypeMap *typeMap, const IR::ToplevelBlock *toplevel) :
-                EBPF::EBPFProgram(options, program, refMap, typeMap, toplevel), model(UBPFModel::instance) {
+                EBPF::EBPFProgram(options, program, refMap, typeMap, toplevel), model(UBPFModel::instance()) {
             packetStartVar = cstring("pkt");
             offsetVar = cstring("packetOffsetInBits");
             outerHdrOffsetVar = cstring("outHeaderOffset");
@@ -73,6 +73,8 @@ namespace UBPF {
         void emitMetadataInstance(EBPF::CodeBuilder *builder) const;
         void emitLocalVariables(EBPF::CodeBuilder *builder) override;
         void emitPipeline(EBPF::CodeBuilder *builder) override;
+        /// Emits process_batch, which calls @entry on each packet of a batch.
+        void emitBatchEntry(EBPF::CodeBuilder *builder, cstring entry);
     };
 
 }
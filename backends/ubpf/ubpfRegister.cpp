@@ -20,6 +20,9 @@ namespace UBPF {
 
     static cstring last_key_name;
 
+    const unsigned UBPFRegister::defaultCores = 16;
+    const cstring UBPFRegister::perCoreAnnotation = "per_core";
+
     UBPFRegister::UBPFRegister(const UBPFProgram *program,
                                const IR::ExternBlock *block,
                                cstring name, EBPF::CodeGenInspector *codeGen) :
@@ -57,10 +60,92 @@ namespace UBPF {
             error(ErrorType::ERR_UNEXPECTED, "%1%: negative size", cst);
             return;
         }
+
+        auto perCore = di->getAnnotation(perCoreAnnotation);
+        if (perCore == nullptr)
+            return;
+        cores = defaultCores;
+        if (perCore->expr.size() > 1) {
+            error(ErrorType::ERR_EXPECTED, "%1%: expected at most one argument", perCore);
+        } else if (perCore->expr.size() == 1) {
+            auto count = perCore->expr.at(0)->to<IR::Constant>();
+            if (count == nullptr || !count->fitsInt() || count->asInt() <= 0)
+                error(ErrorType::ERR_INVALID,
+                      "%1%: expected a positive number of cores", perCore);
+            else
+                cores = count->asInt();
+        }
+        if (!valueType->is<IR::Type_Bits>())
+            error(ErrorType::ERR_UNSUPPORTED,
+                  "%1%: the values of per-core registers must be bit<> values, so that "
+                  "the replicas can be added", name);
+        if (size * cores > UINT16_MAX)
+            error(ErrorType::ERR_OVERLIMIT,
+                  "%1%: the %2% replicas of the register are too large", name, cores);
+        coreKeyTypeName = program->refMap->newName(instanceName + "_core_key");
     }
 
     void UBPFRegister::emitInstance(EBPF::CodeBuilder *builder) {
-        UBPFTableBase::emitInstance(builder, EBPF::TableHash);
+        if (cores == 0) {
+            UBPFTableBase::emitInstance(builder, EBPF::TableHash);
+            return;
+        }
+
+        builder->appendFormat("struct %s ", coreKeyTypeName);
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("uint32_t core;");
+        builder->emitIndent();
+        builder->appendFormat("%s index;", keyTypeString());
+        builder->newline();
+        builder->blockEnd(false);
+        builder->endOfStatement(true);
+
+        builder->emitIndent();
+        builder->target->emitTableDecl(builder, dataMapName, EBPF::TableHash,
+                                       cstring("struct ") + coreKeyTypeName,
+                                       valueTypeString(), size * cores);
+        emitAggregateRead(builder);
+    }
+
+    void UBPFRegister::emitAggregateRead(EBPF::CodeBuilder *builder) {
+        auto valueTypeStr = valueTypeString();
+        builder->emitIndent();
+        builder->appendFormat("static inline int %s_read_aggregate(%s index, %s *value) ",
+                              instanceName, keyTypeString(), valueTypeStr);
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendFormat("struct %s key;", coreKeyTypeName);
+        builder->newline();
+        builder->emitIndent();
+        builder->appendLine("int found = 0;");
+        builder->emitIndent();
+        builder->appendLine("*value = 0;");
+        builder->emitIndent();
+        builder->appendFormat("for (uint32_t core = 0; core < %u; core++) ", cores);
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("__builtin_memset(&key, 0, sizeof(key));");
+        builder->emitIndent();
+        builder->appendLine("key.core = core;");
+        builder->emitIndent();
+        builder->appendLine("key.index = index;");
+        builder->emitIndent();
+        builder->appendFormat("%s *replica = ", valueTypeStr);
+        builder->target->emitTableLookup(builder, dataMapName, "key", "");
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->append("if (replica != NULL) ");
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("*value += *replica;");
+        builder->emitIndent();
+        builder->appendLine("found = 1;");
+        builder->blockEnd(true);
+        builder->blockEnd(true);
+        builder->emitIndent();
+        builder->appendLine("return found ? 0 : -1;");
+        builder->blockEnd(true);
     }
 
     void UBPFRegister::emitMethodInvocation(EBPF::CodeBuilder *builder,
@@ -94,6 +179,15 @@ namespace UBPF {
                                 "&" + valueVariableName);
     }
 
+    void UBPFRegister::emitRegisterWriteInPlace(EBPF::CodeBuilder *builder,
+                                                const IR::MethodCallExpression *expression,
+                                                cstring pointer) {
+        BUG_CHECK(expression->arguments->size() == 2,
+                  "Expected just 2 argument for %1%", expression);
+        builder->appendFormat("*%s = ", pointer);
+        codeGen->visit(expression->arguments->at(1)->expression);
+    }
+
     cstring UBPFRegister::emitValueInstanceIfNeeded(EBPF::CodeBuilder *builder,
                                                     const IR::Argument *arg_value) {
         cstring valueVariableName = nullptr;
@@ -152,6 +246,24 @@ namespace UBPF {
             keyName = arg_key->expression->to<IR::PathExpression>()->path->name.name;
         }
 
+        if (cores != 0) {
+            // Each core reads and writes its own replica
+            auto coreKeyName = program->refMap->newName("core_key");
+            builder->appendFormat("struct %s %s", coreKeyTypeName, coreKeyName);
+            builder->endOfStatement(true);
+            builder->emitIndent();
+            builder->appendFormat("__builtin_memset(&%s, 0, sizeof(%s))", coreKeyName, coreKeyName);
+            builder->endOfStatement(true);
+            builder->emitIndent();
+            builder->appendFormat("%s.core = ubpf_get_core_id()", coreKeyName);
+            builder->endOfStatement(true);
+            builder->emitIndent();
+            builder->appendFormat("%s.index = %s", coreKeyName, keyName);
+            builder->endOfStatement(true);
+            builder->emitIndent();
+            keyName = coreKeyName;
+        }
+
         last_key_name = keyName;
     }
 
@@ -22,8 +22,22 @@ limitations under the License.
 
 namespace UBPF {
 
+    /// A Register extern. The elements of a register with the @per_core annotation
+    /// have one replica per core, updated without contention by the packets processed
+    /// on that core. @per_core(n) sets the number of replicas (the maximum number of
+    /// cores); the control plane reads the sum of the replicas of an element with the
+    /// generated <register>_read_aggregate function.
     class UBPFRegister final : public UBPFTableBase {
     public:
+        /// Number of replicas of the @per_core registers without an argument.
+        static const unsigned defaultCores;
+        static const cstring perCoreAnnotation;
+
+        /// Number of replicas of each element, 0 if the register is shared.
+        unsigned cores = 0;
+        /// Key of the replicas: the core and the index.
+        cstring coreKeyTypeName;
+
         UBPFRegister(const UBPFProgram *program, const IR::ExternBlock *block,
                      cstring name, EBPF::CodeGenInspector *codeGen);
 
@@ -32,12 +46,17 @@ namespace UBPF {
                               const IR::MethodCallExpression *expression);
         void emitRegisterWrite(EBPF::CodeBuilder *builder,
                                const IR::MethodCallExpression *expression);
+        /// Writes the element through the pointer to its value.
+        void emitRegisterWriteInPlace(EBPF::CodeBuilder *builder,
+                                      const IR::MethodCallExpression *expression,
+                                      cstring pointer);
         void emitMethodInvocation(EBPF::CodeBuilder *builder,
                                   const P4::ExternMethod *method);
         void emitKeyInstance(EBPF::CodeBuilder *builder,
                              const IR::MethodCallExpression *expression);
         cstring emitValueInstanceIfNeeded(EBPF::CodeBuilder *builder,
                                           const IR::Argument *arg_value);
+        void emitAggregateRead(EBPF::CodeBuilder *builder);
 
     };
 }
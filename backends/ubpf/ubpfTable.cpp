@@ -134,10 +134,8 @@ class UbpfActionTranslationVisitor : public EBPF::CodeGenInspector {
 };  // UbpfActionTranslationVisitor
 }  // namespace
 
-void UBPFTableBase::emitInstance(EBPF::CodeBuilder *builder, EBPF::TableKind tableKind) {
+cstring UBPFTableBase::keyTypeString() const {
     BUG_CHECK(keyType != nullptr, "Key type of %1% is not set", instanceName);
-    BUG_CHECK(valueType != nullptr, "Value type of %1% is not set", instanceName);
-
     cstring keyTypeStr;
     if (keyType->is<IR::Type_Bits>()) {
         auto tb = keyType->to<IR::Type_Bits>();
@@ -148,7 +146,11 @@ void UBPFTableBase::emitInstance(EBPF::CodeBuilder *builder, EBPF::TableKind tab
     }
     // Key type is not null, but we didn't handle it
     BUG_CHECK(!keyTypeStr.isNullOrEmpty(), "Key type %1% not supported", keyType->toString());
+    return keyTypeStr;
+}
 
+cstring UBPFTableBase::valueTypeString() const {
+    BUG_CHECK(valueType != nullptr, "Value type of %1% is not set", instanceName);
     cstring valueTypeStr;
     if (valueType->is<IR::Type_Bits>()) {
         auto tb = valueType->to<IR::Type_Bits>();
@@ -159,9 +161,12 @@ void UBPFTableBase::emitInstance(EBPF::CodeBuilder *builder, EBPF::TableKind tab
     }
     // Value type is not null, but we didn't handle it
     BUG_CHECK(!valueTypeStr.isNullOrEmpty(), "Value type %1% not supported", valueType->toString());
+    return valueTypeStr;
+}
 
+void UBPFTableBase::emitInstance(EBPF::CodeBuilder *builder, EBPF::TableKind tableKind) {
     builder->target->emitTableDecl(builder, dataMapName, tableKind,
-                                   keyTypeStr, valueTypeStr, size);
+                                   keyTypeString(), valueTypeString(), size);
 }
 
 UBPFTable::UBPFTable(const UBPFProgram *program,
@@ -206,7 +211,7 @@ void UBPFTable::setTableKind() {
     for (auto it : keyGenerator->keyElements) {
         auto mtdecl = program->refMap->getDeclaration(it->matchType->path, true);
         auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
-        if (matchType->name.name == P4::P4CoreLibrary::instance.lpmMatch.name) {
+        if (matchType->name.name == P4::P4CoreLibrary::instance().lpmMatch.name) {
             if (tableKind == EBPF::TableLPMTrie) {
                 ::error(ErrorType::ERR_UNSUPPORTED,
                         "only one LPM field allowed", it->matchType);
@@ -289,8 +294,8 @@ void UBPFTable::emitKeyType(EBPF::CodeBuilder *builder) {
             auto mtdecl = program->refMap->getDeclaration(
                     c->matchType->path, true);
             auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
-            if (matchType->name.name != P4::P4CoreLibrary::instance.exactMatch.name &&
-                matchType->name.name != P4::P4CoreLibrary::instance.lpmMatch.name)
+            if (matchType->name.name != P4::P4CoreLibrary::instance().exactMatch.name &&
+                matchType->name.name != P4::P4CoreLibrary::instance().lpmMatch.name)
                 ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
                         "Match of type %1% not supported", c->matchType);
             key_idx++;
@@ -322,7 +327,7 @@ void UBPFTable::emitActionArguments(EBPF::CodeBuilder *builder,
 }
 
 cstring UBPFTable::generateActionName(const IR::P4Action *action) {
-    if (action->getName().originalName == P4::P4CoreLibrary::instance.noAction.name) {
+    if (action->getName().originalName == P4::P4CoreLibrary::instance().noAction.name) {
         return this->noActionName;
     } else {
         return EBPF::EBPFObject::externalName(action);
@@ -38,6 +38,9 @@ namespace UBPF {
         EBPF::CodeGenInspector *codeGen;
 
         void emitInstance(EBPF::CodeBuilder *pBuilder, EBPF::TableKind tableKind);
+        /// The C types of the keys and values.
+        cstring keyTypeString() const;
+        cstring valueTypeString() const;
 
     protected:
         UBPFTableBase(const UBPFProgram *program, cstring instanceName,
@@ -13,6 +13,9 @@
 /* Define to 1 if you have the GMP library. */
 #cmakedefine HAVE_LIBGMP 1
 
+/* Define to 1 to use boost cpp_int, which stores small values inline, for big_int */
+#cmakedefine P4C_INLINE_BIG_INT 1
+
 /* Define to 1 if you have the memchr function. */
 #cmakedefine HAVE_MEMCHR 1
 
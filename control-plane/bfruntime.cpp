@@ -37,7 +37,7 @@ TypeSpecParser TypeSpecParser::make(const p4configv1::P4Info& p4info,
         // Add support for required P4DataTypeSpec types here to generate
         // the correct field width
         if (fSpec.has_serializable_enum()) {
-            auto enums = typeInfo.serializable_enums();
+            const auto& enums = typeInfo.serializable_enums();
             auto e = fSpec.serializable_enum().name();
             auto typeEnum = enums.find(e);
             if (typeEnum == enums.end()) {
@@ -333,7 +333,7 @@ BFRuntimeGenerator::addCounterCommon(Util::JsonArray* tablesJson,
 
     tableJson->emplace("attributes", new Util::JsonArray());
 
-    tablesJson->append(tableJson);
+    tablesJson->append(new Util::JsonText(tableJson));
 }
 
 void
@@ -376,7 +376,7 @@ BFRuntimeGenerator::addMeterCommon(Util::JsonArray* tablesJson,
     attributesJson->append("MeterByteCountAdjust");
     tableJson->emplace("attributes", attributesJson);
 
-    tablesJson->append(tableJson);
+    tablesJson->append(new Util::JsonText(tableJson));
 }
 
 void
@@ -439,7 +439,7 @@ BFRuntimeGenerator::addRegisterCommon(Util::JsonArray* tablesJson,
 
     tableJson->emplace("attributes", new Util::JsonArray());
 
-    tablesJson->append(tableJson);
+    tablesJson->append(new Util::JsonText(tableJson));
 }
 
 void
@@ -521,12 +521,8 @@ BFRuntimeGenerator::addActionProfCommon(Util::JsonArray* tablesJson,
     auto* oneTable = Standard::findTable(p4info, oneTableId);
     CHECK_NULL(oneTable);
 
-
-    // Add action profile to match table depends on
-    auto oneTableJson = findJsonTable(tablesJson,
-    oneTable->preamble().name());
-    addToDependsOn(oneTableJson, actionProf.id);
-
+    // The action profile is added to the match table depends on by
+    // collectTableDependencies.
     tableJson->emplace("action_specs", makeActionSpecs(*oneTable));
 
     tableJson->emplace("data", new Util::JsonArray());
@@ -534,7 +530,7 @@ BFRuntimeGenerator::addActionProfCommon(Util::JsonArray* tablesJson,
     tableJson->emplace("supported_operations", new Util::JsonArray());
     tableJson->emplace("attributes", new Util::JsonArray());
 
-    tablesJson->append(tableJson);
+    tablesJson->append(new Util::JsonText(tableJson));
 }
 
 
@@ -554,11 +550,12 @@ BFRuntimeGenerator::makeActionSpecs(const p4configv1::Table& table,
     auto* specs = new Util::JsonArray();
     P4Id maxId = 0;
     for (const auto& action_ref : table.action_refs()) {
-        auto* action = Standard::findAction(p4info, action_ref.id());
-        if (action == nullptr) {
+        auto it = actions.find(action_ref.id());
+        if (it == actions.end()) {
             ::error("Invalid action id '%1%'", action_ref.id());
             continue;
         }
+        auto* action = it->second;
         auto* spec = new Util::JsonObject();
         const auto& pre = action->preamble();
         spec->emplace("id", pre.id());
@@ -581,16 +578,22 @@ BFRuntimeGenerator::makeActionSpecs(const p4configv1::Table& table,
             action_ref.annotations().begin(), action_ref.annotations().end());
         spec->emplace("annotations", annotations);
 
-        auto* dataJson = new Util::JsonArray();
-        for (const auto& param : action->params()) {
-            auto* annotations = transformAnnotations(
-                param.annotations().begin(), param.annotations().end());
-            addActionDataField(
-                dataJson, param.id(), param.name(), true /* mandatory */,
-                false /* read_only */, makeTypeBytes(param.bitwidth()), annotations);
-            if (param.id() > maxId) maxId = param.id();
+        auto data = actionDataFields.find(pre.id());
+        if (data == actionDataFields.end()) {
+            auto* dataJson = new Util::JsonArray();
+            P4Id maxParamId = 0;
+            for (const auto& param : action->params()) {
+                auto* annotations = transformAnnotations(
+                    param.annotations().begin(), param.annotations().end());
+                addActionDataField(
+                    dataJson, param.id(), param.name(), true /* mandatory */,
+                    false /* read_only */, makeTypeBytes(param.bitwidth()), annotations);
+                if (param.id() > maxParamId) maxParamId = param.id();
+            }
+            data = actionDataFields.emplace(pre.id(), std::make_pair(dataJson, maxParamId)).first;
         }
-        spec->emplace("data", dataJson);
+        spec->emplace("data", data->second.first);
+        if (data->second.second > maxId) maxId = data->second.second;
         specs->append(spec);
     }
     if (maxActionParamId != nullptr) *maxActionParamId = maxId;
@@ -650,8 +653,19 @@ BFRuntimeGenerator::addActionProfIds(const p4configv1::Table& table,
     return true;
 }
 
+void
+BFRuntimeGenerator::collectTableDependencies(TableDependencies* dependencies) const {
+    for (const auto& actionProf : p4info.action_profiles()) {
+        auto actionProfInstance = ActionProf::from(p4info, actionProf);
+        if (actionProfInstance == boost::none || actionProfInstance->tableIds.empty()) continue;
+        (*dependencies)[actionProfInstance->tableIds.at(0)].push_back(actionProfInstance->id);
+    }
+}
+
 void
 BFRuntimeGenerator::addMatchTables(Util::JsonArray* tablesJson) const {
+    TableDependencies dependencies;
+    collectTableDependencies(&dependencies);
     for (const auto& table : p4info.tables()) {
         const auto& pre = table.preamble();
         std::set<std::string> dupKey;
@@ -663,6 +677,10 @@ BFRuntimeGenerator::addMatchTables(Util::JsonArray* tablesJson) const {
             pre.name(), pre.id(), "MatchAction_Direct", table.size(), annotations);
 
         if (!addActionProfIds(table, tableJson)) continue;
+        auto tableDependencies = dependencies.find(pre.id());
+        if (tableDependencies != dependencies.end()) {
+            for (auto id : tableDependencies->second) addToDependsOn(tableJson, id);
+        }
 
         tableJson->emplace("has_const_default_action", table.const_default_action_id() != 0);
 
@@ -697,7 +715,7 @@ BFRuntimeGenerator::addMatchTables(Util::JsonArray* tablesJson) const {
             // e.g. hdr[23:16] where hdr is a 32 bit field
             std::string s(mf.name());
             std::smatch sm;
-            std::regex sliceRegex(R"(\[([0-9]+):([0-9]+)\])");
+            static const std::regex sliceRegex(R"(\[([0-9]+):([0-9]+)\])");
             std::regex_search(s, sm, sliceRegex);
             if (sm.size() == 3) {
                 auto *isFieldSliceAnnot = new Util::JsonObject();
@@ -715,7 +733,7 @@ BFRuntimeGenerator::addMatchTables(Util::JsonArray* tablesJson) const {
 
             // Replace header stack indices hdr[<index>] with hdr$<index>. This
             // is output in the context.json
-            std::regex hdrStackRegex(R"(\[([0-9]+)\])");
+            static const std::regex hdrStackRegex(R"(\[([0-9]+)\])");
             keyName = std::regex_replace(keyName, hdrStackRegex, "$$$1");
 
             // Control plane requires there's no duplicate key in one table.
@@ -816,7 +834,7 @@ BFRuntimeGenerator::addMatchTables(Util::JsonArray* tablesJson) const {
         tableJson->emplace("supported_operations", operationsJson);
         tableJson->emplace("attributes", attributesJson);
 
-        tablesJson->append(tableJson);
+        tablesJson->append(new Util::JsonText(tableJson));
     }
 }
 
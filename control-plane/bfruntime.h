@@ -20,10 +20,12 @@ limitations under the License.
 #include <iomanip>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <ostream>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <boost/optional.hpp>
 
@@ -57,17 +59,6 @@ static inline constexpr P4Id getIdPrefix(P4Id id) {
     return ((id >> 24) & 0xff);
 }
 
-static inline Util::JsonObject* findJsonTable(Util::JsonArray* tablesJson, cstring tblName) {
-    for (auto *t : *tablesJson) {
-        auto *tblObj = t->to<Util::JsonObject>();
-        auto tName = tblObj->get("name")->to<Util::JsonValue>()->getString();
-        if (tName == tblName) {
-            return tblObj;
-        }
-    }
-    return nullptr;
-}
-
 static inline Util::JsonObject* transformAnnotation(const cstring& annotation) {
     auto* annotationJson = new Util::JsonObject();
     // TODO(antonin): annotation string will need to be parsed so we can have it
@@ -286,7 +277,10 @@ class TypeSpecParser {
 class BFRuntimeGenerator {
  public:
     explicit BFRuntimeGenerator(const p4configv1::P4Info& p4info)
-        : p4info(p4info) { }
+        : p4info(p4info) {
+        for (const auto& action : p4info.actions())
+            actions.emplace(action.preamble().id(), &action);
+    }
 
     /// Generates the schema as a Json object for the provided P4Info instance.
     virtual const Util::JsonObject* genSchema() const;
@@ -401,6 +395,14 @@ class BFRuntimeGenerator {
         // from(const p4configv1::ExternInstance& externInstance);
     };
 
+    /// Ids added to the "depends_on" list of a match table by the tables
+    /// generated after it (e.g. action profiles), indexed by the P4Info id of
+    /// the match table.
+    using TableDependencies = std::map<P4Id, std::vector<P4Id>>;
+
+    /// Collects the @dependencies of the match tables up front, so that each
+    /// match table is complete when it is generated and can be kept as text.
+    virtual void collectTableDependencies(TableDependencies* dependencies) const;
     void addMatchTables(Util::JsonArray* tablesJson) const;
     virtual void addActionProfs(Util::JsonArray* tablesJson) const;
     virtual bool addActionProfIds(const p4configv1::Table& table,
@@ -480,6 +482,14 @@ class BFRuntimeGenerator {
 
 
     const p4configv1::P4Info& p4info;
+
+ private:
+    /// The P4Info actions, by id.
+    std::map<P4Id, const p4configv1::Action*> actions;
+    /// The data fields of the actions and their maximum parameter id, by action
+    /// id. They are generated once and shared by the action specs of all the
+    /// tables referring to the action.
+    mutable std::map<P4Id, std::pair<Util::JsonArray*, P4Id>> actionDataFields;
 };
 
 }  // namespace BFRT
@@ -16,6 +16,8 @@ limitations under the License.
 
 #include "bytestrings.h"
 
+#include <iterator>
+
 #include "ir/ir.h"
 
 namespace P4 {
@@ -25,14 +27,14 @@ namespace ControlPlaneAPI {
 /// Convert a bignum to the P4Runtime bytes representation. The value must fit
 /// within the provided @width expressed in bits. Padding will be added as
 /// necessary (as the most significant bits).
-boost::optional<std::string> stringReprConstant(big_int value, int width) {
+boost::optional<std::string> stringReprConstant(const big_int &value, int width) {
     // TODO(antonin): support negative values
     if (value < 0) {
         ::error(ErrorType::ERR_UNSUPPORTED, "%1%: Negative values not supported yet", value);
         return boost::none;
     }
     BUG_CHECK(width > 0, "Unexpected width 0");
-    size_t bitsRequired = floor_log2(value) + 1;
+    size_t bitsRequired = value == 0 ? 0 : boost::multiprecision::msb(value) + 1;
     BUG_CHECK(static_cast<size_t>(width) >= bitsRequired,
               "Cannot represent %1% on %2% bits", value, width);
     // TODO(antonin): P4Runtime defines the canonical representation for bit<W>
@@ -43,12 +45,17 @@ boost::optional<std::string> stringReprConstant(big_int value, int width) {
     // to the P4Runtime specification is also valid (but not the canonical
     // representation, which means no RW symmetry).
     // auto bytes = ROUNDUP(mpz_sizeinbase(value.get_mpz_t(), 2), 8);
-    auto bytes = ROUNDUP(width, 8);
-    std::vector<char> data(bytes);
-    for (auto &d : data) {
-        big_int v = (value >> (--bytes * 8)) & 0xff;
-        d = static_cast<uint8_t>(v); }
-    return std::string(data.begin(), data.end());
+    size_t bytes = ROUNDUP(width, 8);
+    // The bytes are written most significant first, after the zero padding.
+    std::string data(bytes - ROUNDUP(bitsRequired, 8), '\0');
+    if (bitsRequired <= 64) {
+        auto v = static_cast<uint64_t>(value);
+        for (size_t i = ROUNDUP(bitsRequired, 8); i > 0; i--)
+            data.push_back(static_cast<char>((v >> ((i - 1) * 8)) & 0xff));
+    } else {
+        boost::multiprecision::export_bits(value, std::back_inserter(data), 8);
+    }
+    return data;
 }
 
 /// Convert a Constant to the P4Runtime bytes representation by calling
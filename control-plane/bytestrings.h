@@ -38,7 +38,7 @@ boost::optional<std::string> stringRepr(const IR::Constant* constant, int width)
 
 boost::optional<std::string> stringRepr(const IR::BoolLiteral* constant, int width);
 
-boost::optional<std::string> stringReprConstant(big_int value, int width);
+boost::optional<std::string> stringReprConstant(const big_int &value, int width);
 
 }  // namespace ControlPlaneAPI
 
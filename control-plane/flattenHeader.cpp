@@ -69,12 +69,21 @@ const IR::Annotations* FlattenHeader::mergeAnnotations() const {
 
 /* static */
 const IR::Type_Header* FlattenHeader::flatten(
-    const P4::TypeMap* typeMap, const IR::Type_Header* headerType) {
+    const P4::TypeMap* typeMap, const IR::Type_Header* headerType, Cache* cache) {
+    if (cache) {
+        BUG_CHECK(cache->typeMap == nullptr || cache->typeMap == typeMap,
+                  "FlattenHeader cache used with different type maps");
+        cache->typeMap = typeMap;
+        auto it = cache->flattened.find(headerType);
+        if (it != cache->flattened.end()) return it->second;
+    }
     auto flattenedHeader = headerType->clone();
     flattenedHeader->fields.clear();
     FlattenHeader flattener(typeMap, flattenedHeader);
     flattener.doFlatten(headerType);
-    return flattener.needsFlattening ? flattenedHeader : headerType;
+    auto result = flattener.needsFlattening ? flattenedHeader : headerType;
+    if (cache) cache->flattened.emplace(headerType, result);
+    return result;
 }
 
 }  // namespace ControlPlaneAPI
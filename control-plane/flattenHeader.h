@@ -17,6 +17,7 @@ limitations under the License.
 #ifndef CONTROL_PLANE_FLATTENHEADER_H_
 #define CONTROL_PLANE_FLATTENHEADER_H_
 
+#include <map>
 #include <vector>
 
 #include "ir/ir.h"
@@ -44,11 +45,22 @@ class FlattenHeader {
     const IR::Annotations* mergeAnnotations() const;
 
  public:
+    /// The header types already flattened for a program, so that a header
+    /// type registered in many places is flattened once. A cache must only be
+    /// used with one @typeMap.
+    class Cache {
+        std::map<const IR::Type_Header*, const IR::Type_Header*> flattened;
+        const P4::TypeMap* typeMap = nullptr;
+        friend class FlattenHeader;
+    };
+
     /// If the @headerType needs flattening, creates a clone of the IR node with
     /// a new flattened field list. Otherwise returns @headerType. This does not
-    /// modify the IR.
+    /// modify the IR. If @cache is not nullptr, a header type flattened before
+    /// is returned without flattening it again.
     static const IR::Type_Header* flatten(
-        const P4::TypeMap* typeMap, const IR::Type_Header* headerType);
+        const P4::TypeMap* typeMap, const IR::Type_Header* headerType,
+        Cache* cache = nullptr);
 };
 
 }  // namespace ControlPlaneAPI
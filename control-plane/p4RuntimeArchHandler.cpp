@@ -97,7 +97,7 @@ int64_t getTableSize(const IR::P4Table* table) {
     // architecture-independent code; each architecture may have a different
     // default table size.
     const int64_t defaultTableSize =
-        P4V1::V1Model::instance.tableAttributes.defaultTableSize;
+        P4V1::V1Model::instance().tableAttributes.defaultTableSize;
 
     auto sizeProperty = table->properties->getProperty("size");
     if (sizeProperty == nullptr) {
@@ -85,7 +85,7 @@ class P4RuntimeArchHandlerV1Model final : public P4RuntimeArchHandlerCommon<Arch
                   ReferenceMap* refMap,
                   const P4::TypeMap* typeMap,
                   p4configv1::P4TypeInfo* p4RtTypeInfo) {
-        if (function->method->name != P4V1::V1Model::instance.digest_receiver.name)
+        if (function->method->name != P4V1::V1Model::instance().digest_receiver.name)
             return boost::none;
 
         auto call = function->expr;
@@ -132,7 +132,7 @@ class P4RuntimeArchHandlerV1Model final : public P4RuntimeArchHandlerCommon<Arch
     /// @return true if @table's 'support_timeout' property exists and is true. This
     /// indicates that @table supports entry ageing.
     static bool getSupportsTimeout(const IR::P4Table* table) {
-        auto timeout = table->properties->getProperty(P4V1::V1Model::instance
+        auto timeout = table->properties->getProperty(P4V1::V1Model::instance()
                                                       .tableAttributes
                                                       .supportTimeout.name);
         if (timeout == nullptr) return false;
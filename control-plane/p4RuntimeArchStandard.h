@@ -72,13 +72,13 @@ namespace Helpers {
 template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::V1MODEL> > {
     static const cstring name() { return "counter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.counters.name;
+        return P4V1::V1Model::instance().tableAttributes.counters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.counter.name;
+        return P4V1::V1Model::instance().counter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directCounter.name;
+        return P4V1::V1Model::instance().directCounter.name;
     }
     static const cstring sizeParamName() {
         return "size";
@@ -96,13 +96,13 @@ template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::V1MO
 template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::V1MODEL2020> > {
     static const cstring name() { return "counter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.counters.name;
+        return P4V1::V1Model::instance().tableAttributes.counters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.counter.name;
+        return P4V1::V1Model::instance().counter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directCounter.name;
+        return P4V1::V1Model::instance().directCounter.name;
     }
     static const cstring sizeParamName() {
         return "size";
@@ -148,13 +148,13 @@ template<> struct CounterlikeTraits<Standard::CounterExtern<Standard::Arch::PSA>
 template<> struct CounterlikeTraits<Standard::MeterExtern<Standard::Arch::V1MODEL> > {
     static const cstring name() { return "meter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.meters.name;
+        return P4V1::V1Model::instance().tableAttributes.meters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.meter.name;
+        return P4V1::V1Model::instance().meter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directMeter.name;
+        return P4V1::V1Model::instance().directMeter.name;
     }
     static const cstring sizeParamName() {
         return "size";
@@ -171,13 +171,13 @@ template<> struct CounterlikeTraits<Standard::MeterExtern<Standard::Arch::V1MODE
 template<> struct CounterlikeTraits<Standard::MeterExtern<Standard::Arch::V1MODEL2020> > {
     static const cstring name() { return "meter"; }
     static const cstring directPropertyName() {
-        return P4V1::V1Model::instance.tableAttributes.meters.name;
+        return P4V1::V1Model::instance().tableAttributes.meters.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.meter.name;
+        return P4V1::V1Model::instance().meter.name;
     }
     static const cstring directTypeName() {
-        return P4V1::V1Model::instance.directMeter.name;
+        return P4V1::V1Model::instance().directMeter.name;
     }
     static const cstring sizeParamName() {
         return "size";
@@ -283,10 +283,10 @@ template <Arch arch> struct ActionProfileTraits;
 template<> struct ActionProfileTraits<Arch::V1MODEL> {
     static const cstring name() { return "action profile"; }
     static const cstring propertyName() {
-        return P4V1::V1Model::instance.tableAttributes.tableImplementation.name;
+        return P4V1::V1Model::instance().tableAttributes.tableImplementation.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.action_profile.name;
+        return P4V1::V1Model::instance().action_profile.name;
     }
     static const cstring sizeParamName() { return "size"; }
 };
@@ -294,10 +294,10 @@ template<> struct ActionProfileTraits<Arch::V1MODEL> {
 template<> struct ActionProfileTraits<Arch::V1MODEL2020> {
     static const cstring name() { return "action profile"; }
     static const cstring propertyName() {
-        return P4V1::V1Model::instance.tableAttributes.tableImplementation.name;
+        return P4V1::V1Model::instance().tableAttributes.tableImplementation.name;
     }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.action_profile.name;
+        return P4V1::V1Model::instance().action_profile.name;
     }
     static const cstring sizeParamName() { return "size"; }
 };
@@ -320,7 +320,7 @@ template <Arch arch> struct ActionSelectorTraits;
 template<> struct ActionSelectorTraits<Arch::V1MODEL> : public ActionProfileTraits<Arch::V1MODEL> {
     static const cstring name() { return "action selector"; }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.action_selector.name;
+        return P4V1::V1Model::instance().action_selector.name;
     }
 };
 
@@ -328,7 +328,7 @@ template<> struct ActionSelectorTraits<Arch::V1MODEL2020> :
             public ActionProfileTraits<Arch::V1MODEL2020> {
     static const cstring name() { return "action selector"; }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.action_selector.name;
+        return P4V1::V1Model::instance().action_selector.name;
     }
 };
 
@@ -345,7 +345,7 @@ template <Arch arch> struct RegisterTraits;
 template<> struct RegisterTraits<Arch::V1MODEL> {
     static const cstring name() { return "register"; }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.registers.name;
+        return P4V1::V1Model::instance().registers.name;
     }
     static const cstring sizeParamName() { return "size"; }
     // the index of the type parameter for the data stored in the register, in
@@ -357,7 +357,7 @@ template<> struct RegisterTraits<Arch::V1MODEL> {
 template<> struct RegisterTraits<Arch::V1MODEL2020> {
     static const cstring name() { return "register"; }
     static const cstring typeName() {
-        return P4V1::V1Model::instance.registers.name;
+        return P4V1::V1Model::instance().registers.name;
     }
     static const cstring sizeParamName() { return "size"; }
     // the index of the type parameter for the data stored in the register, in
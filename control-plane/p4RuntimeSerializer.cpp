@@ -14,17 +14,21 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #include <google/protobuf/util/json_util.h>
 
 #include <algorithm>
+#include <exception>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <set>
 #include <typeinfo>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -52,9 +56,11 @@ limitations under the License.
 #include "frontends/p4/typeChecking/typeChecker.h"
 #include "frontends/p4/typeMap.h"
 #include "ir/ir.h"
+#include "lib/compile_context.h"
 #include "lib/log.h"
 #include "lib/nullstream.h"
 #include "lib/ordered_set.h"
+#include "lib/thread_pool.h"
 
 #include "bytestrings.h"
 #include "flattenHeader.h"
@@ -169,16 +175,15 @@ static bool writeJsonTo(const Message& message, std::ostream* destination) {
 static bool writeTextTo(const Message& message, std::ostream* destination) {
     CHECK_NULL(destination);
 
-    // According to the protobuf documentation, it would be better to use Print
-    // with a FileOutputStream object for performance reasons. However all we
-    // have here is a std::ostream and performance is not a concern.
-    std::string output;
-    if (!google::protobuf::TextFormat::PrintToString(message, &output)) {
-        ::error(ErrorType::ERR_IO, "Failed to serialize protobuf message to text");
-        return false;
+    // Print the message directly to the output, without building it in a string.
+    {
+        google::protobuf::io::OstreamOutputStream output(destination);
+        if (!google::protobuf::TextFormat::Print(message, &output)) {
+            ::error(ErrorType::ERR_IO, "Failed to serialize protobuf message to text");
+            return false;
+        }
     }
 
-    *destination << output;
     if (!destination->good()) {
         ::error(ErrorType::ERR_IO, "Failed to write text protobuf message to the output");
         return false;
@@ -188,6 +193,47 @@ static bool writeTextTo(const Message& message, std::ostream* destination) {
     return true;
 }
 
+/// Serialize the updates of @entries to @destination as WriteRequest messages
+/// of at most @chunkSize updates. In the binary @format each message is
+/// preceded by its size, in the JSON format the messages form an array. Only
+/// one message is built at a time.
+static bool writeChunksTo(const p4v1::WriteRequest& entries, unsigned chunkSize,
+                          P4RuntimeFormat format, std::ostream* destination) {
+    using namespace google::protobuf::util;
+    CHECK_NULL(destination);
+
+    JsonPrintOptions options;
+    options.add_whitespace = true;
+
+    if (format == P4RuntimeFormat::JSON) *destination << "[";
+    int size = entries.updates_size();
+    for (int first = 0; first == 0 || first < size; first += chunkSize) {
+        p4v1::WriteRequest chunk;
+        for (int i = first; i < size && i < first + static_cast<int>(chunkSize); i++)
+            *chunk.add_updates() = entries.updates(i);
+        if (format == P4RuntimeFormat::BINARY) {
+            if (!SerializeDelimitedToOstream(chunk, destination)) return false;
+            continue;
+        }
+        std::string output;
+        if (MessageToJsonString(chunk, &output, options) != Status::OK) {
+            ::error(ErrorType::ERR_IO,
+                    "Failed to serialize protobuf message to JSON");
+            return false;
+        }
+        if (first > 0) *destination << ",";
+        *destination << output;
+    }
+    if (format == P4RuntimeFormat::JSON) *destination << "]" << std::endl;
+    if (!destination->good()) {
+        ::error(ErrorType::ERR_IO, "Failed to write the protobuf messages to the output");
+        return false;
+    }
+
+    destination->flush();
+    return true;
+}
+
 }  // namespace writers
 
 /// The information about a default action which is needed to serialize it.
@@ -391,7 +437,13 @@ class P4RuntimeSymbolTable : public P4RuntimeSymbolTableIface {
     /// Add a @type symbol, extracting the name and id from @declaration.
     void add(P4RuntimeSymbolType type, const IR::IDeclaration* declaration) override {
         CHECK_NULL(declaration);
-        add(type, declaration->controlPlaneName(), externalId(type, declaration));
+        auto name = declaration->controlPlaneName();
+        // Declarations are added again for each of their uses, only the first
+        // addition needs their '@id'.
+        auto symbolTable = symbolTables.find(type);
+        if (symbolTable != symbolTables.end() && symbolTable->second.count(name))
+            return;
+        add(type, name, externalId(type, declaration));
     }
 
     /// Add a @type symbol with @name and possibly an explicit P4 '@id'.
@@ -447,12 +499,12 @@ class P4RuntimeSymbolTable : public P4RuntimeSymbolTableIface {
             return INVALID_ID;
         }
 
-        if (assignedIds.find(*id) != assignedIds.end()) {
+        if (assignedIds.count(*id)) {
             ::error(ErrorType::ERR_INVALID, "@id %1% is assigned to multiple declarations", *id);
             return INVALID_ID;
         }
 
-        assignedIds.insert(*id);
+        recordId(*id);
         return *id;
     }
 
@@ -489,9 +541,7 @@ class P4RuntimeSymbolTable : public P4RuntimeSymbolTableIface {
             // Hash the name and construct an id. Because linear probing is used to
             // resolve hash collisions, the id that we select depends on the order in
             // which the names are hashed. This is why we sort the names above.
-            boost::optional<p4rt_id_t> id = probeForId(nameId, [=](uint32_t nameId) {
-                return (resourceType << 24) | (nameId & 0xffffff);
-            });
+            boost::optional<p4rt_id_t> id = probeForId(resourceType, nameId);
 
             if (!id) {
                 ::error(ErrorType::ERR_OVERLIMIT,
@@ -500,33 +550,43 @@ class P4RuntimeSymbolTable : public P4RuntimeSymbolTableIface {
             }
 
             // Update the resource in place with the new id.
-            assignedIds.insert(*id);
+            recordId(*id);
             iterator->second = *id;
         }
     }
 
+    /// Record the assignment of @id.
+    void recordId(p4rt_id_t id) {
+        assignedIds.insert(id);
+        assignedCounts[id >> 24]++;
+    }
+
     /**
-     * Construct an id from the provided @sourceValue using the provided function
-     * @constructId, which is expected to be pure. If there's a collision,
-     * @sourceValue is incremented and the id is recomputed until an available id
-     * is found. We perform linear probing of @sourceValue rather than the id
-     * itself to ensure that we don't end up affecting bits of the id that should
-     * not depend on @sourceValue.  For example, @constructId will normally set
-     * some of the bits in the id it generates to a fixed value indicating a
-     * resource type, and those bits need to remain correct.
+     * Construct the id of @resourceType from @nameId. If there's a collision,
+     * the 24 bits of the id that come from @nameId are incremented, wrapping
+     * around, until an available id is found. The other bits indicate the
+     * resource type and remain fixed.
+     *
+     * The ids traversed to find an available id are all assigned, and ids are
+     * never unassigned, so the probes that reach one of them later can skip
+     * directly to that id; @probeSkips records these skips, which keeps the
+     * cost of probing constant on average even for long runs of collisions.
      */
-    template <typename ConstructIdFunc>
-    boost::optional<p4rt_id_t> probeForId(const uint32_t sourceValue,
-                                          ConstructIdFunc constructId) {
-        uint32_t value = sourceValue;
-        while (assignedIds.find(constructId(value)) != assignedIds.end()) {
-            ++value;
-            if (value == sourceValue) {
-                return boost::none;  // We wrapped around; there's no unassigned id left.
-            }
+    boost::optional<p4rt_id_t> probeForId(p4rt_id_t resourceType, uint32_t nameId) {
+        if (assignedCounts[resourceType] > 0xffffff)
+            return boost::none;  // There's no unassigned id left.
+
+        const p4rt_id_t prefix = resourceType << 24;
+        p4rt_id_t id = prefix | (nameId & 0xffffff);
+        std::vector<p4rt_id_t> probed;
+        while (assignedIds.count(id)) {
+            probed.push_back(id);
+            auto skip = probeSkips.find(id);
+            id = skip != probeSkips.end() ? skip->second : prefix | ((id + 1) & 0xffffff);
         }
-
-        return constructId(value);
+        for (auto p : probed)
+            probeSkips[p] = id;
+        return id;
     }
 
     // The hash function used for resource names.
@@ -547,7 +607,12 @@ class P4RuntimeSymbolTable : public P4RuntimeSymbolTableIface {
 
     // All the ids we've assigned so far. Used to avoid id collisions; this is
     // especially crucial since ids can be set manually via the '@id' annotation.
-    std::set<p4rt_id_t> assignedIds;
+    std::unordered_set<p4rt_id_t> assignedIds;
+    // The number of ids we've assigned so far, by resource type.
+    std::unordered_map<p4rt_id_t, uint32_t> assignedCounts;
+    // For assigned ids, a following id in probing order such that all the ids
+    // in between are assigned. See probeForId().
+    std::unordered_map<p4rt_id_t, p4rt_id_t> probeSkips;
 
     // Symbol tables, mapping symbols to P4Runtime ids.
     using SymbolTable = std::map<cstring, p4rt_id_t>;
@@ -700,17 +765,17 @@ getMatchTypeName(const IR::PathExpression* matchPathExpr, const ReferenceMap* re
 /// UNSPECIFIED is returned.
 static boost::optional<MatchField::MatchType>
 getMatchType(cstring matchTypeName) {
-    if (matchTypeName == P4CoreLibrary::instance.exactMatch.name) {
+    if (matchTypeName == P4CoreLibrary::instance().exactMatch.name) {
         return MatchField::MatchTypes::EXACT;
-    } else if (matchTypeName == P4CoreLibrary::instance.lpmMatch.name) {
+    } else if (matchTypeName == P4CoreLibrary::instance().lpmMatch.name) {
         return MatchField::MatchTypes::LPM;
-    } else if (matchTypeName == P4CoreLibrary::instance.ternaryMatch.name) {
+    } else if (matchTypeName == P4CoreLibrary::instance().ternaryMatch.name) {
         return MatchField::MatchTypes::TERNARY;
-    } else if (matchTypeName == P4V1::V1Model::instance.rangeMatchType.name) {
+    } else if (matchTypeName == P4V1::V1Model::instance().rangeMatchType.name) {
         return MatchField::MatchTypes::RANGE;
-    } else if (matchTypeName == P4V1::V1Model::instance.optionalMatchType.name) {
+    } else if (matchTypeName == P4V1::V1Model::instance().optionalMatchType.name) {
         return MatchField::MatchTypes::OPTIONAL;
-    } else if (matchTypeName == P4V1::V1Model::instance.selectorMatchType.name) {
+    } else if (matchTypeName == P4V1::V1Model::instance().selectorMatchType.name) {
         // Nothing to do here, we cannot even perform some sanity-checking.
         return boost::none;
     } else {
@@ -738,7 +803,8 @@ static std::vector<MatchField>
 getMatchFields(const IR::P4Table* table,
                ReferenceMap* refMap,
                TypeMap* typeMap,
-               p4configv1::P4TypeInfo* p4RtTypeInfo) {
+               p4configv1::P4TypeInfo* p4RtTypeInfo,
+               TypeSpecConverter::Memo* typeSpecs) {
     std::vector<MatchField> matchFields;
 
     auto key = table->getKey();
@@ -764,7 +830,7 @@ getMatchFields(const IR::P4Table* table,
                   "Couldn't determine type for key element %1%", keyElement);
         // We ignore the return type on purpose, but the call is required to update p4RtTypeInfo if
         // the match field has a user-defined type.
-        TypeSpecConverter::convert(refMap, typeMap, matchFieldType, p4RtTypeInfo);
+        TypeSpecConverter::convert(refMap, typeMap, matchFieldType, p4RtTypeInfo, typeSpecs);
         auto type_name = getTypeName(matchFieldType, typeMap);
         int width = getTypeWidth(matchFieldType, typeMap);
         matchFields.push_back(MatchField{*matchFieldName, id, *matchType,
@@ -978,7 +1044,8 @@ class P4RuntimeAnalyzer {
             param->set_bitwidth(w);
             // We ignore the return type on purpose, but the call is required to update p4RtTypeInfo
             // if the action parameter has a user-defined type.
-            TypeSpecConverter::convert(refMap, typeMap, paramType, p4Info->mutable_type_info());
+            TypeSpecConverter::convert(refMap, typeMap, paramType, p4Info->mutable_type_info(),
+                                       &typeSpecs);
             auto type_name = getTypeName(paramType, typeMap);
             if (type_name) {
                 auto namedType = param->mutable_type_name();
@@ -990,7 +1057,8 @@ class P4RuntimeAnalyzer {
     void addControllerHeader(const IR::Type_Header* type) {
         if (isHidden(type)) return;
 
-        auto flattenedHeaderType = FlattenHeader::flatten(typeMap, type);
+        auto flattenedHeaderType = FlattenHeader::flatten(typeMap, type,
+                                                           typeSpecs.flattenedHeaders());
 
         auto name = type->controlPlaneName();
         auto id = symbols.getId(P4RuntimeSymbolType::CONTROLLER_HEADER(), name);
@@ -1033,7 +1101,8 @@ class P4RuntimeAnalyzer {
             metadata->set_bitwidth(w);
             // We ignore the return type on purpose, but the call is required to update p4RtTypeInfo
             // if the header field has a user-defined type.
-            TypeSpecConverter::convert(refMap, typeMap, fieldType, p4Info->mutable_type_info());
+            TypeSpecConverter::convert(refMap, typeMap, fieldType, p4Info->mutable_type_info(),
+                                       &typeSpecs);
             auto type_name = getTypeName(fieldType, typeMap);
             if (type_name) {
                 auto namedType = metadata->mutable_type_name();
@@ -1051,7 +1120,7 @@ class P4RuntimeAnalyzer {
         auto tableSize = Helpers::getTableSize(tableDeclaration);
         auto defaultAction = getDefaultAction(tableDeclaration, refMap, typeMap);
         auto matchFields = getMatchFields(
-            tableDeclaration, refMap, typeMap, p4Info->mutable_type_info());
+            tableDeclaration, refMap, typeMap, p4Info->mutable_type_info(), &typeSpecs);
         auto actions = getActionRefs(tableDeclaration, refMap);
 
         bool isConstTable = getConstTable(tableDeclaration);
@@ -1356,6 +1425,8 @@ class P4RuntimeAnalyzer {
     /// Type information for the P4 program we're serializing.
     TypeMap* typeMap;
     ReferenceMap* refMap;
+    /// The types converted so far for the type_info of the P4Info message.
+    TypeSpecConverter::Memo typeSpecs;
     P4RuntimeArchHandlerIface* archHandler;
 };
 
@@ -1455,9 +1526,42 @@ class P4RuntimeEntriesConverter {
         return entries;
     }
 
-    /// Appends the 'const entries' for the table to the WriteRequest message.
-    void addTableEntries(const IR::TableBlock* tableBlock, ReferenceMap* refMap,
-                         TypeMap* typeMap, P4RuntimeArchHandlerIface* archHandler) {
+    /// Appends the 'const entries' for the tables to the WriteRequest message.
+    /// When the compiler runs several threads, the entries of each table are
+    /// converted in parallel into their own message, and the messages and the
+    /// diagnostics are then merged in the order of @tableBlocks.
+    void addTableEntries(const std::vector<const IR::TableBlock*>& tableBlocks,
+                         ReferenceMap* refMap, TypeMap* typeMap,
+                         P4RuntimeArchHandlerIface* archHandler) {
+        if (tableBlocks.size() < 2 || Util::ThreadPool::global().concurrency() == 1) {
+            for (auto tableBlock : tableBlocks)
+                addTableEntries(entries, tableBlock, refMap, typeMap, archHandler);
+            return;
+        }
+        std::vector<p4v1::WriteRequest> tableEntries(tableBlocks.size());
+        std::vector<ErrorReporter::Deferred> deferred(tableBlocks.size());
+        std::vector<std::exception_ptr> failed(tableBlocks.size());
+        Util::ThreadPool::global().parallel_for(tableBlocks.size(), [&](size_t i) {
+            ErrorReporter::Deferred::Scope keep(deferred[i]);
+            try {
+                addTableEntries(&tableEntries[i], tableBlocks[i], refMap, typeMap, archHandler);
+            } catch (...) {
+                failed[i] = std::current_exception();
+            }
+        });
+        auto& reporter = BaseCompileContext::get().errorReporter();
+        for (size_t i = 0; i < tableBlocks.size(); i++) {
+            for (auto& update : *tableEntries[i].mutable_updates())
+                entries->add_updates()->Swap(&update);
+            reporter.emit(deferred[i]);
+            if (failed[i]) std::rethrow_exception(failed[i]);
+        }
+    }
+
+    /// Appends the 'const entries' for the table to the @request message.
+    void addTableEntries(p4v1::WriteRequest* request, const IR::TableBlock* tableBlock,
+                         ReferenceMap* refMap, TypeMap* typeMap,
+                         P4RuntimeArchHandlerIface* archHandler) const {
         CHECK_NULL(tableBlock);
         auto table = tableBlock->container;
 
@@ -1470,7 +1574,7 @@ class P4RuntimeEntriesConverter {
         int entryPriority = entriesList->entries.size();
         auto needsPriority = tableNeedsPriority(table, refMap);
         for (auto e : entriesList->entries) {
-            auto protoUpdate = entries->add_updates();
+            auto protoUpdate = request->add_updates();
             protoUpdate->set_type(p4v1::Update::INSERT);
             auto protoEntity = protoUpdate->mutable_entity();
             auto protoEntry = protoEntity->mutable_table_entry();
@@ -1501,9 +1605,9 @@ class P4RuntimeEntriesConverter {
       for (auto e : table->getKey()->keyElements) {
           auto matchType = getKeyMatchType(e, refMap);
           // TODO(antonin): remove dependency on v1model.
-          if (matchType == P4CoreLibrary::instance.ternaryMatch.name ||
-              matchType == P4V1::V1Model::instance.rangeMatchType.name ||
-              matchType == P4V1::V1Model::instance.optionalMatchType.name) {
+          if (matchType == P4CoreLibrary::instance().ternaryMatch.name ||
+              matchType == P4V1::V1Model::instance().rangeMatchType.name ||
+              matchType == P4V1::V1Model::instance().optionalMatchType.name) {
               return true;
           }
       }
@@ -1561,15 +1665,15 @@ class P4RuntimeEntriesConverter {
             auto keyWidth = getTypeWidth(tableKey->expression->type, typeMap);
             auto matchType = getKeyMatchType(tableKey, refMap);
 
-            if (matchType == P4CoreLibrary::instance.exactMatch.name) {
+            if (matchType == P4CoreLibrary::instance().exactMatch.name) {
               addExact(protoEntry, fieldId++, k, keyWidth, typeMap);
-            } else if (matchType == P4CoreLibrary::instance.lpmMatch.name) {
+            } else if (matchType == P4CoreLibrary::instance().lpmMatch.name) {
               addLpm(protoEntry, fieldId++, k, keyWidth, typeMap);
-            } else if (matchType == P4CoreLibrary::instance.ternaryMatch.name) {
+            } else if (matchType == P4CoreLibrary::instance().ternaryMatch.name) {
               addTernary(protoEntry, fieldId++, k, keyWidth, typeMap);
-            } else if (matchType == P4V1::V1Model::instance.rangeMatchType.name) {
+            } else if (matchType == P4V1::V1Model::instance().rangeMatchType.name) {
               addRange(protoEntry, fieldId++, k, keyWidth, typeMap);
-            } else if (matchType == P4V1::V1Model::instance.optionalMatchType.name) {
+            } else if (matchType == P4V1::V1Model::instance().optionalMatchType.name) {
               addOptional(protoEntry, fieldId++, k, keyWidth, typeMap);
             } else {
                 if (!k->is<IR::DefaultExpression>())
@@ -1857,11 +1961,12 @@ P4RuntimeAnalyzer::analyze(const IR::P4Program* program,
     analyzer.addPkgInfo(evaluatedProgram, arch);
 
     P4RuntimeEntriesConverter entriesConverter(symbols);
+    std::vector<const IR::TableBlock*> tableBlocks;
     Helpers::forAllEvaluatedBlocks(evaluatedProgram, [&](const IR::Block* block) {
         if (block->is<IR::TableBlock>())
-            entriesConverter.addTableEntries(block->to<IR::TableBlock>(), refMap,
-                                             typeMap, archHandler);
+            tableBlocks.push_back(block->to<IR::TableBlock>());
     });
+    entriesConverter.addTableEntries(tableBlocks, refMap, typeMap, archHandler);
 
     auto* p4Info = analyzer.getP4Info();
     auto* p4Entries = entriesConverter.getEntries();
@@ -1929,9 +2034,17 @@ void P4RuntimeAPI::serializeP4InfoTo(std::ostream* destination, P4RuntimeFormat
         ::error(ErrorType::ERR_IO, "Failed to serialize the P4Runtime API to the output");
 }
 
-void P4RuntimeAPI::serializeEntriesTo(std::ostream* destination, P4RuntimeFormat format) const {
+void P4RuntimeAPI::serializeEntriesTo(std::ostream* destination, P4RuntimeFormat format,
+                                      unsigned chunkSize) const {
     using namespace ControlPlaneAPI;
 
+    if (chunkSize > 0 && format != P4RuntimeFormat::TEXT) {
+        if (!writers::writeChunksTo(*entries, chunkSize, format, destination))
+            ::error(ErrorType::ERR_IO,
+                    "Failed to serialize the P4Runtime static table entries to the output");
+        return;
+    }
+
     bool success = true;
     // Write the serialization out in the requested format.
     switch (format) {
@@ -2012,6 +2125,10 @@ P4RuntimeSerializer::serializeP4RuntimeIfRequired(const P4RuntimeAPI& p4Runtime,
     std::vector<cstring> files;
     std::vector<P4::P4RuntimeFormat> formats;
 
+    // The files are opened in order, then written concurrently, each one by
+    // its own task.
+    std::vector<std::function<void()>> writers;
+
     if (!options.p4RuntimeFile.isNullOrEmpty()) {
         files.push_back(options.p4RuntimeFile);
         formats.push_back(options.p4RuntimeFormat);
@@ -2019,17 +2136,16 @@ P4RuntimeSerializer::serializeP4RuntimeIfRequired(const P4RuntimeAPI& p4Runtime,
     if (!parseFileNames(options.p4RuntimeFiles, files, formats))
         return;
 
-    if (!files.empty()) {
-        for (unsigned i = 0; i < files.size(); i++) {
-            cstring file = files.at(i);
-            P4::P4RuntimeFormat format = formats.at(i);
-            std::ostream* out = openFile(file, false);
-            if (!out) {
-                ::error(ErrorType::ERR_IO, "Couldn't open P4Runtime API file: %1%", file);
-                continue;
-            }
-            p4Runtime.serializeP4InfoTo(out, format);
+    for (unsigned i = 0; i < files.size(); i++) {
+        cstring file = files.at(i);
+        P4::P4RuntimeFormat format = formats.at(i);
+        std::ostream* out = openFile(file, false);
+        if (!out) {
+            ::error(ErrorType::ERR_IO, "Couldn't open P4Runtime API file: %1%", file);
+            continue;
         }
+        writers.push_back([&p4Runtime, out, format]() {
+            p4Runtime.serializeP4InfoTo(out, format); });
     }
 
     // Do the same for the entries files
@@ -2041,19 +2157,41 @@ P4RuntimeSerializer::serializeP4RuntimeIfRequired(const P4RuntimeAPI& p4Runtime,
     }
 
     if (!parseFileNames(options.p4RuntimeEntriesFiles, files, formats))
+        files.clear();
+    for (unsigned i = 0; i < files.size(); i++) {
+        cstring file = files.at(i);
+        P4::P4RuntimeFormat format = formats.at(i);
+        std::ostream* out = openFile(file, false);
+        if (!out) {
+            ::error(ErrorType::ERR_IO, "Couldn't open P4Runtime static entries file: %1%",
+                    options.p4RuntimeEntriesFile);
+            continue;
+        }
+        auto chunkSize = options.p4RuntimeEntriesChunkSize;
+        writers.push_back([&p4Runtime, out, format, chunkSize]() {
+            p4Runtime.serializeEntriesTo(out, format, chunkSize); });
+    }
+
+    if (writers.size() < 2 || Util::ThreadPool::global().concurrency() == 1) {
+        for (auto& writer : writers)
+            writer();
         return;
-    if (!files.empty()) {
-        for (unsigned i = 0; i < files.size(); i++) {
-            cstring file = files.at(i);
-            P4::P4RuntimeFormat format = formats.at(i);
-            std::ostream* out = openFile(file, false);
-            if (!out) {
-                ::error(ErrorType::ERR_IO, "Couldn't open P4Runtime static entries file: %1%",
-                        options.p4RuntimeEntriesFile);
-                continue;
-            }
-            p4Runtime.serializeEntriesTo(out, format);
+    }
+    // The diagnostics of the writers are reported in the order of the files.
+    std::vector<ErrorReporter::Deferred> deferred(writers.size());
+    std::vector<std::exception_ptr> failed(writers.size());
+    Util::ThreadPool::global().parallel_for(writers.size(), [&](size_t i) {
+        ErrorReporter::Deferred::Scope keep(deferred[i]);
+        try {
+            writers[i]();
+        } catch (...) {
+            failed[i] = std::current_exception();
         }
+    });
+    auto& reporter = BaseCompileContext::get().errorReporter();
+    for (size_t i = 0; i < writers.size(); i++) {
+        reporter.emit(deferred[i]);
+        if (failed[i]) std::rethrow_exception(failed[i]);
     }
 }
 
@@ -56,7 +56,11 @@ struct P4RuntimeAPI {
     void serializeP4InfoTo(std::ostream* destination, P4RuntimeFormat format) const;
     /// Serialize the WriteRequest message containing all the table entries to
     /// the @destination stream in the requested protobuf serialization @format.
-    void serializeEntriesTo(std::ostream* destination, P4RuntimeFormat format) const;
+    /// A non-zero @chunkSize splits the entries into WriteRequest messages of
+    /// at most @chunkSize updates, written as a stream of length-delimited
+    /// messages in the binary format and as an array in the JSON format.
+    void serializeEntriesTo(std::ostream* destination, P4RuntimeFormat format,
+                            unsigned chunkSize = 0) const;
 
     /// A P4Runtime P4Info message, which encodes the control-plane API of the
     /// program. Never null.
@@ -93,8 +93,10 @@ cstring getTypeName(const IR::Type* type, const TypeMap* typeMap) {
 }
 
 TypeSpecConverter::TypeSpecConverter(
-    const P4::ReferenceMap* refMap, const P4::TypeMap* typeMap, P4TypeInfo* p4RtTypeInfo)
-    : refMap(refMap), typeMap(typeMap), p4RtTypeInfo(p4RtTypeInfo) {
+    const P4::ReferenceMap* refMap, const P4::TypeMap* typeMap, P4TypeInfo* p4RtTypeInfo,
+    FlattenHeader::Cache* flattenedHeaders)
+    : refMap(refMap), typeMap(typeMap), p4RtTypeInfo(p4RtTypeInfo),
+      flattenedHeaders(flattenedHeaders) {
     CHECK_NULL(refMap);
     CHECK_NULL(typeMap);
 }
@@ -282,11 +284,11 @@ bool TypeSpecConverter::preorder(const IR::Type_Struct* type) {
 }
 
 bool TypeSpecConverter::preorder(const IR::Type_Header* type) {
-    auto flattenedHeaderType = FlattenHeader::flatten(typeMap, type);
     if (p4RtTypeInfo) {
         auto name = std::string(type->controlPlaneName());
         auto headers = p4RtTypeInfo->mutable_headers();
         if (headers->find(name) == headers->end()) {
+            auto flattenedHeaderType = FlattenHeader::flatten(typeMap, type, flattenedHeaders);
             auto headerTypeSpec = new p4configv1::P4HeaderTypeSpec();
             for (auto f : flattenedHeaderType->fields) {
                 auto fType = f->type;
@@ -389,10 +391,20 @@ bool TypeSpecConverter::preorder(const IR::Type_Error* type) {
 const P4DataTypeSpec* TypeSpecConverter::convert(
     const P4::ReferenceMap* refMap,
     const P4::TypeMap* typeMap,
-    const IR::Type* type, P4TypeInfo* typeInfo) {
-    TypeSpecConverter typeSpecConverter(refMap, typeMap, typeInfo);
+    const IR::Type* type, P4TypeInfo* typeInfo, Memo* memo) {
+    if (memo) {
+        BUG_CHECK(memo->typeInfo == nullptr || memo->typeInfo == typeInfo,
+                  "TypeSpecConverter memo used with different P4TypeInfo messages");
+        memo->typeInfo = typeInfo;
+        auto it = memo->specs.find(type);
+        if (it != memo->specs.end()) return it->second;
+    }
+    TypeSpecConverter typeSpecConverter(refMap, typeMap, typeInfo,
+                                        memo ? memo->flattenedHeaders() : nullptr);
     type->apply(typeSpecConverter);
-    return typeSpecConverter.map.at(type);
+    auto typeSpec = typeSpecConverter.map.at(type);
+    if (memo) memo->specs.emplace(type, typeSpec);
+    return typeSpec;
 }
 
 }  // namespace ControlPlaneAPI
@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "p4/config/v1/p4types.pb.h"
 
+#include "flattenHeader.h"
 #include "ir/ir.h"
 #include "ir/visitor.h"
 
@@ -50,10 +51,13 @@ class TypeSpecConverter : public Inspector {
     /// after translating an Expression to P4DataTypeSpec, save the result to
     /// 'map'.
     std::map<const IR::Type*, ::p4::config::v1::P4DataTypeSpec*> map;
+    /// flattened header types shared across conversions, may be nullptr.
+    FlattenHeader::Cache* flattenedHeaders;
 
     TypeSpecConverter(const P4::ReferenceMap* refMap,
                       const P4::TypeMap* typeMap,
-                      ::p4::config::v1::P4TypeInfo* p4RtTypeInfo);
+                      ::p4::config::v1::P4TypeInfo* p4RtTypeInfo,
+                      FlattenHeader::Cache* flattenedHeaders = nullptr);
 
     // fallback for unsupported types, should be unreachable
     bool preorder(const IR::Type* type) override;
@@ -78,12 +82,29 @@ class TypeSpecConverter : public Inspector {
     bool preorder(const IR::Type_Error* type) override;
 
  public:
+    /// The p4.P4DataTypeSpec messages already generated for the types of a
+    /// program, so that each type referenced in many places is converted once.
+    /// A memo must only be used with one @typeInfo. Types are looked up by
+    /// pointer, so it is meant for the canonical types from the TypeMap.
+    /// The memo also caches the flattened header types, which callers that
+    /// flatten headers themselves can share through flattenedHeaders().
+    class Memo {
+        std::map<const IR::Type*, const ::p4::config::v1::P4DataTypeSpec*> specs;
+        const ::p4::config::v1::P4TypeInfo* typeInfo = nullptr;
+        FlattenHeader::Cache headers;
+        friend class TypeSpecConverter;
+     public:
+        FlattenHeader::Cache* flattenedHeaders() { return &headers; }
+    };
+
     /// Generates the appropriate p4.P4DataTypeSpec message for @type. If
     /// @typeInfo is nullptr, then the relevant information is not generated for
-    /// named types.
+    /// named types. If @memo is not nullptr, a message already generated for
+    /// @type is returned without converting it again.
     static const ::p4::config::v1::P4DataTypeSpec* convert(
         const P4::ReferenceMap* refMap, const P4::TypeMap* typeMap,
-        const IR::Type* type, ::p4::config::v1::P4TypeInfo* typeInfo);
+        const IR::Type* type, ::p4::config::v1::P4TypeInfo* typeInfo,
+        Memo* memo = nullptr);
 };
 
 /// See section "User-defined types" in P4RT specification.
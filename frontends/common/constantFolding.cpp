@@ -25,6 +25,9 @@ class CloneConstants : public Transform {
  public:
     CloneConstants() = default;
     const IR::Node* postorder(IR::Constant* constant) override {
+        return cloneConstant(constant);
+    }
+    static const IR::Constant* cloneConstant(const IR::Constant* constant) {
         // We clone the constant.  This is necessary because the same
         // the type associated with the constant may participate in
         // type unification, and thus we want to have different type
@@ -42,6 +45,11 @@ class CloneConstants : public Transform {
         return new IR::Constant(constant->srcInfo, type, constant->value, constant->base);
     }
     static const IR::Expression* clone(const IR::Expression* expression) {
+        // Most values are scalars: don't set up a traversal for them
+        if (auto constant = expression->to<IR::Constant>())
+            return cloneConstant(constant);
+        if (expression->is<IR::BoolLiteral>())
+            return expression;
         return expression->apply(CloneConstants())->to<IR::Expression>();
     }
 };
@@ -64,9 +72,10 @@ const IR::Expression* DoConstantFolding::getConstant(const IR::Expression* expr)
         return expr;
     } else if (auto cast = expr->to<IR::Cast>()) {
         // Casts of a constant to a value with type Type_Newtype
-        // are constants, but we cannot fold them.
+        // are constants, but we cannot fold them.  Callers that copy
+        // the value into the program clone it.
         if (getConstant(cast->expr))
-            return CloneConstants::clone(expr);
+            return expr;
         return nullptr;
     }
     if (typesKnown) {
@@ -293,35 +302,35 @@ DoConstantFolding::cast(const IR::Constant* node, unsigned base, const IR::Type_
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Add* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a + b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a + b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::AddSat* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a + b; }, true);
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a + b; }, true);
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Sub* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a - b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a - b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::SubSat* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a - b; }, true);
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a - b; }, true);
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Mul* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a * b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a * b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::BXor* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a ^ b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a ^ b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::BAnd* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a & b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a & b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::BOr* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a | b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a | b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Equ* e) {
@@ -333,23 +342,23 @@ const IR::Node* DoConstantFolding::postorder(IR::Neq* e) {
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Lss* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a < b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a < b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Grt* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a > b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a > b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Leq* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a <= b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a <= b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Geq* e) {
-    return binary(e, [](big_int a, big_int b) -> big_int { return a >= b; });
+    return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a >= b; });
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Div* e) {
-    return binary(e, [e](big_int a, big_int b) -> big_int {
+    return binary(e, [e](const big_int& a, const big_int& b) -> big_int {
             if (a < 0 || b < 0) {
                 ::error(ErrorType::ERR_INVALID,
                      "%1%: Division is not defined for negative numbers", e);
@@ -364,7 +373,7 @@ const IR::Node* DoConstantFolding::postorder(IR::Div* e) {
 }
 
 const IR::Node* DoConstantFolding::postorder(IR::Mod* e) {
-    return binary(e, [e](big_int a, big_int b) -> big_int {
+    return binary(e, [e](const big_int& a, const big_int& b) -> big_int {
             if (a < 0 || b < 0) {
                 ::error(ErrorType::ERR_INVALID,
                         "%1%: Modulo is not defined for negative numbers", e);
@@ -440,14 +449,14 @@ DoConstantFolding::compare(const IR::Operation_Binary* e) {
     }
 
     if (eqTest)
-        return binary(e, [](big_int a, big_int b) -> big_int { return a == b; });
+        return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a == b; });
     else
-        return binary(e, [](big_int a, big_int b) -> big_int { return a != b; });
+        return binary(e, [](const big_int& a, const big_int& b) -> big_int { return a != b; });
 }
 
 const IR::Node*
 DoConstantFolding::binary(const IR::Operation_Binary* e,
-                          std::function<big_int(big_int, big_int)> func,
+                          std::function<big_int(const big_int&, const big_int&)> func,
                           bool saturating) {
     auto eleft = getConstant(e->left);
     auto eright = getConstant(e->right);
@@ -501,14 +510,9 @@ DoConstantFolding::binary(const IR::Operation_Binary* e,
     } else if (lunk && runk) {
         resultType = lt;  // i.e., Type_InfInt
     } else {
-        // must cast one to the type of the other
-        if (lunk) {
-            resultType = rtb;
-            left = cast(left, left->base, rtb);
-        } else {
-            resultType = ltb;
-            right = cast(right, left->base, ltb);
-        }
+        // the untyped operand takes the type of the other; only the
+        // values are used below, so no cast constant is built
+        resultType = lunk ? rtb : ltb;
     }
     big_int value = func(left->value, right->value);
     if (saturating) {
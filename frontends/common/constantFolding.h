@@ -75,7 +75,7 @@ class DoConstantFolding : public Transform {
 
     /// Statically evaluate binary operation @p e implemented by @p func.
     const IR::Node* binary(const IR::Operation_Binary* op,
-                           std::function<big_int(big_int, big_int)> func,
+                           std::function<big_int(const big_int&, const big_int&)> func,
                            bool saturating = false);
     /// Statically evaluate comparison operation @p e.
     /// Note that this only handles the case where @p e represents `==` or `!=`.
@@ -105,7 +105,7 @@ class DoConstantFolding : public Transform {
  public:
     DoConstantFolding(const ReferenceMap* refMap, TypeMap* typeMap, bool warnings = true) :
             refMap(refMap), typeMap(typeMap), typesKnown(typeMap != nullptr), warnings(warnings) {
-        visitDagOnce = true; setName("DoConstantFolding");
+        visitDagOnce = true; freeUnchangedClones = true; setName("DoConstantFolding");
         assignmentTarget = false;
     }
 
@@ -0,0 +1,83 @@
+#include "declarationCache.h"
+
+#include <algorithm>
+
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+// What equiv() compares, so neither source positions nor the declids, which depend on
+// what was parsed before.
+uint64_t content(const IR::Node *decl) {
+    return decl->structural_hash();
+}
+
+}  // namespace
+
+DeclarationKeys::DeclarationKeys(const IR::P4Program *program, const ReferenceMap *refMap,
+                                 const CacheKeyHash &base) {
+    CHECK_NULL(program); CHECK_NULL(refMap);
+    // the top-level declaration each declaration is in
+    std::map<const IR::Node *, const IR::Node *> top;
+    for (auto *decl : program->objects)
+        forAllMatching<IR::Node>(decl, [&top, decl](const IR::Node *node) {
+            if (node->is<IR::IDeclaration>()) top.emplace(node, decl); });
+
+    std::map<const IR::Node *, uint64_t> contents;
+    for (auto *decl : program->objects) {
+        contents[decl] = content(decl);
+        auto &used = uses[decl];
+        forAllMatching<IR::Path>(decl, [&](const IR::Path *path) {
+            auto *target = refMap->getDeclaration(path);
+            if (!target) return;
+            auto it = top.find(target->getNode());
+            if (it == top.end() || it->second == decl) return;
+            if (std::find(used.begin(), used.end(), it->second) == used.end())
+                used.push_back(it->second); });
+    }
+
+    // P4 declares before use, so the declarations used come first and have their keys
+    for (auto *decl : program->objects) {
+        CacheKeyHash key(base);
+        key.add(contents[decl]);
+        for (auto *dep : uses[decl]) {
+            auto it = keys.find(dep);
+            if (it != keys.end())
+                key.add(it->second);
+            else
+                key.add(contents[dep]); }
+        keys[decl] = key.hex();
+    }
+    LOG2("computed the keys of " << keys.size() << " declarations");
+}
+
+cstring DeclarationKeys::key(const IR::Node *decl) const {
+    auto it = keys.find(decl);
+    return it == keys.end() ? cstring() : it->second;
+}
+
+const std::vector<const IR::Node *> &DeclarationKeys::dependencies(const IR::Node *decl) const {
+    static const std::vector<const IR::Node *> none;
+    auto it = uses.find(decl);
+    return it == uses.end() ? none : it->second;
+}
+
+const IR::Node *DeclarationCache::lookup(cstring dir, cstring stage, cstring key) {
+    if (!dir || !key) return nullptr;
+    cstring path = cstring::concat(dir, "/", stage, "-", key, ".p4ir");
+    auto *rv = FrontEndCache::readFile(path);
+    LOG1("declaration cache " << (rv ? "hit: " : "miss: ") << path);
+    return rv;
+}
+
+bool DeclarationCache::store(cstring dir, cstring stage, cstring key, const IR::Node *result) {
+    if (!dir || !key || !result) return false;
+    cstring path = cstring::concat(dir, "/", stage, "-", key, ".p4ir");
+    if (!FrontEndCache::writeFile(path, result)) return false;
+    LOG1("declaration cache: stored " << path);
+    return true;
+}
+
+}  // namespace P4
@@ -0,0 +1,57 @@
+#ifndef _FRONTENDS_COMMON_DECLARATIONCACHE_H_
+#define _FRONTENDS_COMMON_DECLARATIONCACHE_H_
+
+#include <map>
+#include <vector>
+
+#include "frontends/common/frontendCache.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "ir/ir.h"
+
+namespace P4 {
+
+/**
+ * Cache keys for the top-level declarations of a program, so that the results of
+ * compiling one control or parser can be reused by a later compilation in which it and
+ * everything it uses are unchanged.
+ *
+ * The key of a declaration hashes the caller's @base key (the compiler, its options and
+ * the stage the results are from), the structural_hash of the declaration itself, which
+ * leaves out source positions, and the keys of the other top-level declarations it
+ * refers to, as resolved by the ReferenceMap.  So editing a control changes its key, and the
+ * key of every declaration that uses it directly or indirectly, but not the keys of the
+ * other controls, even though their source positions move.
+ */
+class DeclarationKeys {
+    std::map<const IR::Node *, cstring>                         keys;
+    std::map<const IR::Node *, std::vector<const IR::Node *>>   uses;
+
+ public:
+    /// Compute the keys of the declarations of @program, whose references are resolved
+    /// in @refMap.
+    DeclarationKeys(const IR::P4Program *program, const ReferenceMap *refMap,
+                    const CacheKeyHash &base);
+    /// @return the key of the top-level declaration @decl, or nullptr if it is not one
+    cstring key(const IR::Node *decl) const;
+    /// The other top-level declarations @decl refers to, in the order of their first use.
+    const std::vector<const IR::Node *> &dependencies(const IR::Node *decl) const;
+};
+
+/**
+ * Results for single declarations (for example a control after the mid end), stored in
+ * the binary IR format under the keys of DeclarationKeys, in a cache directory shared
+ * with FrontEndCache.  As there, writes are atomic, so concurrent compilations may
+ * share the directory.
+ */
+class DeclarationCache {
+ public:
+    /// @return the result of @stage stored for the declaration key @key in @dir, or
+    /// nullptr on a miss
+    static const IR::Node *lookup(cstring dir, cstring stage, cstring key);
+    /// Store @result as the result of @stage for the declaration key @key in @dir.
+    static bool store(cstring dir, cstring stage, cstring key, const IR::Node *result);
+};
+
+}  // namespace P4
+
+#endif /* _FRONTENDS_COMMON_DECLARATIONCACHE_H_ */
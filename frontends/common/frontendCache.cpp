@@ -0,0 +1,175 @@
+#include "frontendCache.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <utility>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+#include "frontends/common/options.h"
+#include "ir/binary_generator.h"
+#include "ir/binary_loader.h"
+#include "lib/error.h"
+#include "lib/exceptions.h"
+#include "lib/gc.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+// The state of the compilation running on the calling thread.  It is in memory the
+// collector scans, since it does not scan thread-local storage.
+struct CompilationState {
+    // programs loaded from the cache
+    std::set<const IR::Node *> hits;
+    // cache file and diagnostic count for the last lookup miss
+    cstring missPath;
+    unsigned missDiagnostics = 0;
+    // programs parsed after a miss, with their cache file and diagnostic count at the lookup
+    std::map<const IR::Node *, std::pair<cstring, unsigned>> pending;
+};
+
+CompilationState &state() {
+    static thread_local CompilationState *rv = nullptr;
+    if (!rv) rv = new(gc_alloc_root(sizeof(CompilationState))) CompilationState;
+    return *rv;
+}
+
+// cache files already read, so that a compile server or a batch loads each one once
+struct LoadedFile {
+    time_t              mtime;
+    off_t               size;
+    const IR::Node      *root;
+};
+std::map<cstring, LoadedFile> loaded;
+#ifdef MULTITHREAD
+std::mutex loaded_lock;
+#endif  // MULTITHREAD
+
+// distinguishes the temporary files of compilations running at once
+std::atomic<unsigned> tmpCount(0);
+
+}  // namespace
+
+bool FrontEndCache::enabled(const ParserOptions &options) {
+    if (!options.frontendCacheDir || !options.top4.empty()) return false;
+    // passes with side effects other than the resulting IR
+    if (auto *copts = dynamic_cast<const CompilerOptions *>(&options))
+        if (copts->prettyPrintFile || copts->listFrontendPasses) return false;
+    return true;
+}
+
+std::string FrontEndCache::readInput(FILE *in) {
+    std::string rv;
+    char buf[64 << 10];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), in)) > 0)
+        rv.append(buf, len);
+    return rv;
+}
+
+const IR::P4Program *FrontEndCache::lookup(const ParserOptions &options,
+                                           const std::string &text) {
+    auto &st = state();
+    st.missPath = nullptr;
+    if (!enabled(options)) return nullptr;
+    CacheKeyHash key;
+    key.add("p4c front end cache 1").add(IR::binary_schema)
+       .add(options.exe_name).add(options.compilerVersion).add(options.file)
+       .add(static_cast<uint64_t>(options.langVersion))
+       .add(static_cast<uint64_t>(options.optimizeParserInlining));
+    for (auto a : options.disabledAnnotations) key.add(a);
+    if (auto *copts = dynamic_cast<const CompilerOptions *>(&options)) {
+        key.add(static_cast<uint64_t>(copts->excludeFrontendPasses));
+        for (auto p : copts->passesToExcludeFrontend) key.add(p); }
+    key.add(text);
+
+    cstring path = options.frontendCacheDir + "/" + key.hex() + ".p4ir";
+    if (auto *node = readFile(path)) {
+        if (auto *program = node->to<IR::P4Program>()) {
+            LOG1("front end cache hit: " << path);
+            st.hits.insert(program);
+            return program; }
+        LOG1("front end cache: ignoring unexpected " << path); }
+    LOG1("front end cache miss: " << path);
+    st.missPath = path;
+    st.missDiagnostics = ::diagnosticCount();
+    return nullptr;
+}
+
+void FrontEndCache::parsed(const IR::P4Program *program) {
+    auto &st = state();
+    if (program && st.missPath)
+        st.pending[program] = std::make_pair(st.missPath, st.missDiagnostics);
+    st.missPath = nullptr;
+}
+
+bool FrontEndCache::isCached(const IR::P4Program *program) {
+    return state().hits.count(program) != 0;
+}
+
+void FrontEndCache::store(const IR::P4Program *program, const IR::P4Program *result) {
+    auto &pending = state().pending;
+    auto it = pending.find(program);
+    if (it == pending.end()) return;
+    cstring path = it->second.first;
+    bool clean = ::diagnosticCount() == it->second.second;
+    pending.erase(it);
+    if (!result || !clean) return;
+
+    if (writeFile(path, result))
+        LOG1("front end cache: stored " << path);
+}
+
+const IR::Node *FrontEndCache::readFile(cstring path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return nullptr;
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(loaded_lock);
+#endif  // MULTITHREAD
+    auto it = loaded.find(path);
+    if (it != loaded.end() && it->second.mtime == st.st_mtime && it->second.size == st.st_size)
+        return it->second.root;
+    BinaryLoader loader(path);
+    try {
+        if (loader.valid()) {
+            loaded[path] = LoadedFile{st.st_mtime, st.st_size, loader.root()};
+            return loader.root(); }
+    } catch (Util::P4CExceptionBase &) {}
+    LOG1("front end cache: ignoring unreadable " << path);
+    return nullptr;
+}
+
+bool FrontEndCache::writeFile(cstring path, const IR::Node *node) {
+    auto dir = path.before(path.findlast('/'));
+    mkdir(dir.c_str(), 0777);  // may well exist already
+    // write to a temporary file and rename it, so that concurrent compilations sharing
+    // the cache never see a partial file
+    cstring tmp = path + "." + std::to_string(getpid()) + "." + std::to_string(tmpCount++) +
+                  ".tmp";
+    {
+        std::ofstream out(tmp.c_str(), std::ios::binary);
+        if (out) BinaryGenerator(true).write(node, out);
+        if (!out) {
+            LOG1("front end cache: can't write " << tmp);
+            unlink(tmp.c_str());
+            return false; }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        LOG1("front end cache: can't create " << path);
+        unlink(tmp.c_str());
+        return false; }
+    return true;
+}
+
+}  // namespace P4
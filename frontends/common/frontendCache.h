@@ -0,0 +1,85 @@
+#ifndef _FRONTENDS_COMMON_FRONTENDCACHE_H_
+#define _FRONTENDS_COMMON_FRONTENDCACHE_H_
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "frontends/common/parser_options.h"
+#include "ir/ir.h"
+
+namespace P4 {
+
+/// A 128-bit hash of a cache key, from two different 64-bit hashes, which is the same on
+/// every host.  This is not a cryptographic hash -- cache directories are trusted.
+class CacheKeyHash {
+    uint64_t h1 = 0xcbf29ce484222325ULL, h2 = 0x6c62272e07bb0142ULL;
+
+    void byte(uint8_t b) {
+        h1 = (h1 ^ b) * 0x100000001b3ULL;
+        h2 ^= b;
+        h2 = ((h2 << 29) | (h2 >> 35)) * 0x9e3779b97f4a7c15ULL;
+    }
+
+ public:
+    CacheKeyHash &add(const char *data, size_t len) {
+        // the length goes first, so that consecutive fields can't run together
+        for (unsigned i = 0; i < sizeof(len); ++i) byte(len >> (8 * i));
+        for (size_t i = 0; i < len; ++i) byte(data[i]);
+        return *this;
+    }
+    CacheKeyHash &add(const char *s) { return add(s, strlen(s)); }
+    CacheKeyHash &add(const std::string &s) { return add(s.data(), s.size()); }
+    CacheKeyHash &add(cstring s) { return s ? add(s.c_str(), s.size()) : add("\xff", 1); }
+    CacheKeyHash &add(uint64_t v) { return add(std::to_string(v)); }
+    cstring hex() const {
+        char buf[33];
+        snprintf(buf, sizeof(buf), "%016llx%016llx",
+                 static_cast<unsigned long long>(h1), static_cast<unsigned long long>(h2));
+        return buf;
+    }
+};
+
+/**
+ * A content-addressed cache of front end results, enabled with --frontend-cache.
+ *
+ * The key is a hash of the preprocessed source together with everything else that
+ * affects the output of the front end: the input file name, language version, compiler
+ * executable and version, the IR schema, and the front end options.  The value is the
+ * program after FrontEndLast, in the binary IR format.  parseP4File() consults the
+ * cache before parsing, and FrontEnd::run() returns a cached program unchanged, so a
+ * hit skips both for every compiler that uses them.
+ *
+ * Results are only stored when neither parsing nor the front end issued any
+ * diagnostic, since a hit would not repeat them.  Nodes loaded from the cache carry
+ * their source positions as file, line and column only, as with --fromJSON.
+ */
+class FrontEndCache {
+ public:
+    /// True if caching applies to compilations with these @options.
+    static bool enabled(const ParserOptions &options);
+    /// Read the rest of @in, which is the (preprocessed) input.
+    static std::string readInput(FILE *in);
+    /// Look up the front end output for the preprocessed source @text.
+    /// @return the cached program, or nullptr on a miss
+    static const IR::P4Program *lookup(const ParserOptions &options, const std::string &text);
+    /// Record that @program was parsed from the source of the last lookup() miss.
+    static void parsed(const IR::P4Program *program);
+    /// @return true if @program came from the cache, so it has already been through the
+    /// front end
+    static bool isCached(const IR::P4Program *program);
+    /// Store @result, the front end output for @program, if @program was recorded by
+    /// parsed() and no diagnostics have been issued since the lookup.
+    static void store(const IR::P4Program *program, const IR::P4Program *result);
+
+    /// Read a cache file written by writeFile().  A file is only loaded again if it
+    /// changed, so that a compile server keeps the cache in memory.
+    /// @return its root node, or nullptr if it is missing or unreadable
+    static const IR::Node *readFile(cstring path);
+    /// Write @node to the cache file @path, atomically, creating its directory if needed.
+    static bool writeFile(cstring path, const IR::Node *node);
+};
+
+}  // namespace P4
+
+#endif /* _FRONTENDS_COMMON_FRONTENDCACHE_H_ */
@@ -50,6 +50,14 @@ CompilerOptions::CompilerOptions() : ParserOptions() {
         },
         "Exclude passes from midend passes whose name is equal\n"
         "to one of `passX' strings.\n");
+    registerOption(
+        "--profileMidendPasses", nullptr,
+        [this](const char*) {
+            profileMidendPasses = true;
+            return true;
+        },
+        "Report on the standard error the time taken by each midend pass\n"
+        "and the number of IR nodes after it.\n");
     registerOption(
         "--toJSON", "file",
         [this](const char* arg) {
@@ -57,6 +65,21 @@ CompilerOptions::CompilerOptions() : ParserOptions() {
             return true;
         },
         "Dump the compiler IR after the midend as JSON in the specified file.");
+    registerOption(
+        "--compactJSON", nullptr,
+        [this](const char*) {
+            compactJson = true;
+            return true;
+        },
+        "Write the --toJSON output without line breaks or indentation.");
+    registerOption(
+        "--toBinaryIR", "file",
+        [this](const char* arg) {
+            dumpBinaryFile = arg;
+            return true;
+        },
+        "Dump the compiler IR after the midend in binary form in the specified file;\n"
+        "it can be reloaded much faster than JSON.");
     registerOption(
         "--ndebug", nullptr,
         [this](const char*) {
@@ -114,6 +137,20 @@ CompilerOptions::CompilerOptions() : ParserOptions() {
         "Write static table entries as a P4Runtime WriteRequest message\n"
         "to the specified files (comma-separated list); the file format is\n"
         "inferred from the suffix. Legal suffixes are .json, .txt and .bin");
+    registerOption(
+        "--p4runtime-entries-chunk-size", "updates",
+        [this](const char* arg) {
+            p4RuntimeEntriesChunkSize = strtoul(arg, nullptr, 10);
+            if (p4RuntimeEntriesChunkSize == 0) {
+                ::error(ErrorType::ERR_INVALID, "Invalid chunk size %1%", arg);
+                return false;
+            }
+            return true;
+        },
+        "Split the static table entries into WriteRequest messages of at most\n"
+        "this number of updates. The .bin files hold a stream of messages, each\n"
+        "preceded by its size as a varint, and the .json files an array of\n"
+        "messages. The .txt files always hold one message.");
     registerOption(
         "--p4runtime-format", "{binary,json,text}",
         [this](const char* arg) {
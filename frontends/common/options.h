@@ -39,6 +39,8 @@ class CompilerOptions : public ParserOptions {
     // passesToExcludeMidend vector.
     bool excludeMidendPasses = false;
     bool listMidendPasses = false;
+    // If true, report the time and the IR size of each midend pass on stderr.
+    bool profileMidendPasses = false;
     // If true, skip backend passes whose names are contained in
     // passesToExcludeBackend vector.
     bool excludeBackendPasses = false;
@@ -53,6 +55,10 @@ class CompilerOptions : public ParserOptions {
     std::vector<cstring> passesToExcludeBackend;
     // Dump a JSON representation of the IR in the file.
     cstring dumpJsonFile = nullptr;
+    // Leave the line breaks and the indentation out of the JSON dump.
+    bool compactJson = false;
+    // Dump a binary representation of the IR in the file (see ir/binary_generator.h).
+    cstring dumpBinaryFile = nullptr;
     // Dump and undump the IR tree.
     bool debugJson = false;
     // if this flag is true, compile program in non-debug mode.
@@ -67,6 +73,9 @@ class CompilerOptions : public ParserOptions {
     // Write static table entries as a P4Runtime WriteRequest message to the
     // specified files.
     cstring p4RuntimeEntriesFiles = nullptr;
+    // Split the static table entries into WriteRequest messages of at most this
+    // number of updates, 0 writes one message.
+    unsigned p4RuntimeEntriesChunkSize = 0;
     // Choose format for P4Runtime API description.
     P4::P4RuntimeFormat p4RuntimeFormat = P4::P4RuntimeFormat::BINARY;
     // Pretty-print the program in the specified file.
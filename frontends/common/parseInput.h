@@ -17,7 +17,12 @@ limitations under the License.
 #ifndef _FRONTENDS_COMMON_PARSEINPUT_H_
 #define _FRONTENDS_COMMON_PARSEINPUT_H_
 
+#include <sstream>
+#include <string>
+
+#include "frontends/common/frontendCache.h"
 #include "frontends/common/options.h"
+#include "frontends/common/precompiledIncludes.h"
 #include "frontends/parsers/parserDriver.h"
 #include "frontends/p4/fromv1.0/converters.h"
 #include "frontends/p4/frontend.h"
@@ -83,10 +88,28 @@ const IR::P4Program* parseP4File(ParserOptions& options) {
             return nullptr;
     }
 
-    auto result = options.isv1()
+    const IR::P4Program* result;
+    if (FrontEndCache::enabled(options) ||
+        (options.precompiledIncludesDir && !options.isv1())) {
+        // Both caches are keyed by the preprocessed source, so read it all first.
+        std::string text = FrontEndCache::readInput(in);
+        options.closeInput(in);
+        if (auto cached = FrontEndCache::lookup(options, text))
+            return cached;
+        if (options.isv1()) {
+            std::istringstream stream(text);
+            result = parseV1Program<std::istringstream, C>(stream, options.file, 1,
+                                                           options.getDebugHook());
+        } else {
+            result = PrecompiledIncludes::parse(options, text);
+        }
+        FrontEndCache::parsed(result);
+    } else {
+        result = options.isv1()
                 ? parseV1Program<FILE*, C>(in, options.file, 1, options.getDebugHook())
                 : P4ParserDriver::parse(in, options.file);
-    options.closeInput(in);
+        options.closeInput(in);
+    }
 
     if (::errorCount() > 0) {
         ::error(ErrorType::ERR_OVERLIMIT,
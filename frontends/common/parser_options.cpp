@@ -20,15 +20,24 @@ limitations under the License.
 
 #include <getopt.h>
 #include <regex>
+#include <sstream>
 #include <unordered_set>
 
+#include "frontends/common/preprocessor.h"
 #include "frontends/p4/toP4/toP4.h"
+#include "ir/alloc_stats.h"
 #include "ir/json_generator.h"
+#include "ir/node_census.h"
+#include "lib/arena.h"
 #include "lib/exceptions.h"
 #include "lib/exename.h"
+#include "lib/gc.h"
 #include "lib/log.h"
 #include "lib/nullstream.h"
 #include "lib/path.h"
+#include "lib/perf_counters.h"
+#include "lib/startup_profile.h"
+#include "lib/thread_pool.h"
 #include "parser_options.h"
 
 /* CONFIG_PKGDATADIR is defined by cmake at compile time to be the same as
@@ -42,6 +51,8 @@ const char* p4_14includePath = CONFIG_PKGDATADIR "/p4_14include";
 const char* ParserOptions::defaultMessage = "Compile a P4 program";
 
 ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
+    // about when main starts, as the options are among the first things it makes
+    Util::StartupProfile::mark("compiler options");
     registerOption(
         "--help", nullptr,
         [this](const char* ) {
@@ -198,6 +209,13 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
             return true;
         },
         "[Compiler debugging] Adjust logging level per file (see below)");
+    registerOption(
+        "--asyncLog", nullptr,
+        [](const char* ) {
+            Log::setAsync(true);
+            return true;
+        },
+        "[Compiler debugging] Write the log output in batches instead of line by line");
     registerOption(
         "-v", nullptr,
         [](const char* ) {
@@ -238,6 +256,142 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
         "When the optimization is enabled, compiler tries to identify the cases,\n"
         "when it can inline the subparser's states only once for multiple\n"
         "invocations of the same subparser instance.");
+    registerOption(
+        "--trace-passes", "file",
+        [](const char* arg) {
+            Visitor::openTraceFile(arg);
+            return true;
+        },
+        "[Compiler debugging] Write a Chrome/Perfetto trace of every pass run,\n"
+        "with its time, node counts and heap use, to the given file.");
+    registerOption(
+        "--perf-counters", nullptr,
+        [](const char*) {
+            Util::PerfCounters::enable();
+            return true;
+        },
+        "[Compiler debugging] Count the cycles, instructions, cache misses and page\n"
+        "faults of each pass, in the --trace-passes trace and the level 1 log.");
+    registerOption(
+        "--gc-between-passes", nullptr,
+        [](const char*) {
+            gc_pass_policy(true);
+            return true;
+        },
+        "Collect garbage at the end of passes, when the IR they replaced has become\n"
+        "unreachable, rather than within them.");
+    registerOption(
+        "--alloc-histogram", "file",
+        [](const char* arg) {
+            IR::AllocStats::open(arg);
+            return true;
+        },
+        "[Compiler debugging] Count the IR nodes and other allocations made by each\n"
+        "pass, by node class, and write the histogram to the given file at exit.");
+    registerOption(
+        "--startup-profile", nullptr,
+        [](const char*) {
+            Util::StartupProfile::enable();
+            return true;
+        },
+        "[Compiler debugging] At exit, write to stderr when the static constructors,\n"
+        "main and the lazily created singletons ran, and how long the latter took.");
+    registerOption(
+        "--node-sizes", "file",
+        [](const char* arg) {
+            auto stream = openFile(arg, false);
+            if (stream == nullptr)
+                return false;
+            IR::writeNodeSizes(*stream);
+            delete stream;
+            return true;
+        },
+        "[Compiler debugging] Write the size of every IR node class, with the bytes\n"
+        "of its fields and of its padding, to the given file.");
+    registerOption(
+        "--node-census", "file",
+        [](const char* arg) {
+            auto stream = openFile(arg, false);
+            if (stream == nullptr)
+                return false;
+            if (!IR::NodeCensus::global)
+                IR::NodeCensus::global = new IR::NodeCensus();
+            IR::NodeCensus::global->setOutput(stream);
+            return true;
+        },
+        "[Compiler debugging] Count the IR nodes after each pass, in total and by\n"
+        "node class, and write the counts and their changes to the given CSV file.");
+    registerOption(
+        "--max-ir-growth", "factor",
+        [](const char* arg) {
+            char* end = nullptr;
+            double factor = strtod(arg, &end);
+            if (end == arg || *end != 0 || factor <= 0) {
+                ::error(ErrorType::ERR_INVALID, "Invalid IR growth factor %1%", arg);
+                return false;
+            }
+            if (!IR::NodeCensus::global)
+                IR::NodeCensus::global = new IR::NodeCensus();
+            IR::NodeCensus::global->setMaxGrowth(factor);
+            return true;
+        },
+        "[Compiler debugging] Stop the compilation when a pass leaves the IR with\n"
+        "more than the given factor times the nodes of the parsed program.");
+    registerOption(
+        "--arena-alloc", nullptr,
+        [](const char*) {
+            // lives for the rest of the compilation, so never released
+            static Util::Arena *arena = new Util::Arena();
+            static Util::Arena::Scope scope(arena);
+            return true;
+        },
+        "[Compiler debugging] Allocate IR nodes from a bump arena rather than the\n"
+        "garbage-collected heap.");
+    auto setThreads = [](const char* arg) {
+        auto threads = strtoul(arg, nullptr, 10);
+        if (threads == 0) {
+            ::error(ErrorType::ERR_INVALID, "Invalid thread count %1%", arg);
+            return false;
+        }
+#ifndef MULTITHREAD
+        if (threads > 1)
+            ::warning(ErrorType::WARN_UNSUPPORTED,
+                      "--threads ignored; compiler was built without multithreading");
+#endif  // MULTITHREAD
+        Util::ThreadPool::setThreads(threads);
+        return true;
+    };
+    registerOption(
+        "--threads", "count", setThreads,
+        "Number of threads to use for passes that can run in parallel\n"
+        "(only effective when the compiler is built with ENABLE_MULTITHREAD).");
+    registerOption("-j", "count", setThreads, "Same as --threads.");
+    registerOption(
+        "--builtin-preprocessor", nullptr,
+        [this](const char*) {
+            builtinPreprocessor = true;
+            return true;
+        },
+        "Preprocess the input in the compiler instead of running cpp; supports\n"
+        "#include, #define, #if/#ifdef/#elif/#else, #line, #error and #pragma.");
+    registerOption(
+        "--frontend-cache", "dir",
+        [this](const char* arg) {
+            frontendCacheDir = arg;
+            return true;
+        },
+        "Cache the output of the front end in the given directory, keyed by the\n"
+        "preprocessed source and the options that affect the front end, and reuse\n"
+        "it instead of parsing and running the front end again.");
+    registerOption(
+        "--precompiled-includes", "dir",
+        [this](const char* arg) {
+            precompiledIncludesDir = arg;
+            return true;
+        },
+        "Keep the parsed declarations of the standard headers included from the\n"
+        "p4include directory in the given directory, and reuse them instead of\n"
+        "parsing the headers again while their preprocessed text is unchanged.");
     registerUsage(
         "loglevel format is: \"sourceFile:level,...,sourceFile:level\"\n"
         "where 'sourceFile' is a compiler source file and "
@@ -337,6 +491,22 @@ FILE* ParserOptions::preprocess() {
     if (file == "-") {
         file = "<stdin>";
         in = stdin;
+    } else if (builtinPreprocessor) {
+        P4::Preprocessor pp;
+        pp.addOptions(preprocessor_options);
+        pp.addOptions(getIncludePath());
+        std::string output;
+        if (!pp.run(file, output)) return nullptr;
+        // the parser reads from a FILE*, so hand the output over in a temporary file,
+        // which unlike a pipe needs no other process to fill it
+        in = tmpfile();
+        if (in == nullptr || fwrite(output.data(), 1, output.size(), in) != output.size() ||
+            fseek(in, 0, SEEK_SET) != 0) {
+            ::error(ErrorType::ERR_IO, "Error writing the preprocessed input");
+            if (in) fclose(in);
+            return nullptr;
+        }
+        builtin_input = true;
     } else {
 #ifdef __clang__
         std::string cmd("cc -E -x c -Wno-comment");
@@ -376,7 +546,9 @@ FILE* ParserOptions::preprocess() {
 }
 
 void ParserOptions::closeInput(FILE* inputStream) const {
-    if (close_input) {
+    if (builtin_input) {
+        fclose(inputStream);
+    } else if (close_input) {
         int exitCode = pclose(inputStream);
         if (WIFEXITED(exitCode) && WEXITSTATUS(exitCode) == 4)
             ::error(ErrorType::ERR_IO, "input file %s does not exist", file);
@@ -408,6 +580,8 @@ void ParserOptions::dumpPass(const char* manager, unsigned seq,
     cstring name = cstring(manager) + "_" + Util::toString(seq) + "_" + pass;
     if (Log::verbose())
         std::cerr << name << std::endl;
+    if (IR::NodeCensus::global)
+        IR::NodeCensus::global->record(name, node);
 
     for (auto s : top4) {
         bool match = false;
@@ -435,8 +609,14 @@ void ParserOptions::dumpPass(const char* manager, unsigned seq,
             if (stream != nullptr) {
                 if (Log::verbose())
                     std::cerr << "Writing program to " << fileName << std::endl;
-                P4::ToP4 toP4(stream, Log::verbose(), file);
-                node->apply(toP4);
+                if (node != lastDumped) {
+                    std::stringstream text;
+                    P4::ToP4 toP4(&text, Log::verbose(), file);
+                    node->apply(toP4);
+                    lastDumped = node;
+                    lastDump = text.str();
+                }
+                stream->write(lastDump.data(), lastDump.size());
                 delete stream;  // close the file
             }
             break;
@@ -20,6 +20,7 @@ limitations under the License.
 #define FRONTENDS_COMMON_PARSER_OPTIONS_H_
 
 #include <set>
+#include <string>
 #include <unordered_map>
 
 #include "ir/configuration.h"
@@ -33,15 +34,27 @@ limitations under the License.
 extern const char* p4includePath;
 extern const char* p4_14includePath;
 
+namespace P4 {
+class FrontEndCache;
+}  // namespace P4
+
 // Base class for compiler options.
 // This class contains the options for the front-ends.
 // Each back-end should subclass this file.
 class ParserOptions : public Util::Options {
     bool close_input = false;
+    // the input is a temporary file written by the built-in preprocessor
+    bool builtin_input = false;
     static const char* defaultMessage;
 
     // annotation names that are to be ignored by the compiler
     std::set<cstring> disabledAnnotations;
+    // The program last written by dumpPass and its text.  The IR is immutable, so a
+    // program that a pass left unchanged is copied instead of printed again.
+    mutable const IR::Node* lastDumped = nullptr;
+    mutable std::string lastDump;
+    // part of the front end cache key
+    friend class P4::FrontEndCache;
 
  protected:
     // Function that is returned by getDebugHook.
@@ -68,12 +81,18 @@ class ParserOptions : public Util::Options {
     cstring compilerVersion;
     // if true skip preprocess
     bool doNotPreprocess = false;
+    // if true use the built-in preprocessor (see preprocessor.h) instead of cpp
+    bool builtinPreprocessor = false;
     // substrings matched against pass names
     std::vector<cstring> top4;
     // debugging dumps of programs written in this folder
     cstring dumpFolder = ".";
     // If false, optimization of callee parsers (subparsers) inlining is disabled.
     bool optimizeParserInlining = false;
+    // If set, front end results are cached in this directory (see frontendCache.h)
+    cstring frontendCacheDir = nullptr;
+    // If set, the parsed p4include headers are kept in this directory (see precompiledIncludes.h)
+    cstring precompiledIncludesDir = nullptr;
     // Expect that the only remaining argument is the input file.
     void setInputFile();
     // Return target specific include path.
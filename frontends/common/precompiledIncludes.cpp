@@ -0,0 +1,120 @@
+#include "precompiledIncludes.h"
+
+#include <cctype>
+#include <sstream>
+
+#include "frontends/common/frontendCache.h"
+#include "frontends/p4/symbol_table.h"
+#include "frontends/parsers/parserDriver.h"
+#include "ir/binary_generator.h"
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+/// If the line text[pos, eol) is a line marker written by the preprocessor, as in
+/// `# 12 "file.p4" 1`, set @file and @flag (0 if it has none) and return true.
+bool lineMarker(const std::string &text, size_t pos, size_t eol, std::string &file,
+                int &flag) {
+    if (eol - pos < 4 || text[pos] != '#' || text[pos + 1] != ' ' ||
+        !isdigit(static_cast<unsigned char>(text[pos + 2])))
+        return false;
+    pos += 2;
+    while (pos < eol && isdigit(static_cast<unsigned char>(text[pos]))) ++pos;
+    if (pos + 1 >= eol || text[pos] != ' ' || text[pos + 1] != '"') return false;
+    auto quote = text.find('"', pos + 2);
+    if (quote == std::string::npos || quote >= eol) return false;
+    file = text.substr(pos + 2, quote - pos - 2);
+    flag = 0;
+    if (quote + 2 < eol && text[quote + 1] == ' ')
+        flag = atoi(text.c_str() + quote + 2);
+    return true;
+}
+
+/// True if text[pos, eol) has nothing for the parser but perhaps a directive, which the
+/// lexer skips.
+bool blankOrDirective(const std::string &text, size_t pos, size_t eol) {
+    while (pos < eol && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r')) ++pos;
+    return pos == eol || text[pos] == '#';
+}
+
+/// True if all of @decls can be declared in a prelude.
+bool replayable(const IR::Vector<IR::Node> &decls) {
+    Util::ProgramStructure structure;
+    for (auto decl : decls)
+        if (!structure.declareParsed(decl)) {
+            LOG1("precompiled includes: cannot reuse " << decl);
+            return false; }
+    return true;
+}
+
+}  // namespace
+
+PrecompiledIncludes::Prefix PrecompiledIncludes::prefix(const std::string &text,
+                                                        cstring includeDir) {
+    Prefix rv;
+    std::string dir = std::string(includeDir.c_str()) + "/";
+    size_t complete = 0;  // length of the headers in rv.headers that end before rv.end
+    int depth = 0;
+    std::string file;
+    int flag;
+    for (size_t pos = 0; pos < text.size(); ) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) eol = text.size();
+        size_t next = eol < text.size() ? eol + 1 : eol;
+        if (lineMarker(text, pos, eol, file, flag)) {
+            if (flag == 1 && depth++ == 0 && file.compare(0, dir.size(), dir) != 0)
+                break;
+            if (flag == 2 && depth > 0 && --depth == 0) {
+                rv.end = pos;
+                complete = rv.headers.size(); }
+        } else if (depth == 0 && !blankOrDirective(text, pos, eol)) {
+            break; }
+        if (depth > 0) rv.headers.append(text, pos, next - pos);
+        pos = next; }
+    rv.headers.resize(complete);
+    return rv;
+}
+
+const IR::P4Program *PrecompiledIncludes::parse(const ParserOptions &options,
+                                                const std::string &text) {
+    Prefix split;
+    if (options.precompiledIncludesDir) split = prefix(text, p4includePath);
+    if (split.headers.empty()) {
+        std::istringstream stream(text);
+        return P4ParserDriver::parse(stream, options.file);
+    }
+
+    CacheKeyHash key;
+    key.add("p4c precompiled includes 1").add(IR::binary_schema)
+       .add(options.compilerVersion).add(split.headers);
+    cstring path = options.precompiledIncludesDir + "/" + key.hex() + ".p4ir";
+    const IR::Vector<IR::Node> *prelude = nullptr;
+    if (auto *node = FrontEndCache::readFile(path)) {
+        auto *headers = node->to<IR::P4Program>();
+        if (headers && replayable(headers->objects)) {
+            LOG1("precompiled includes hit: " << path);
+            prelude = &headers->objects;
+        } else {
+            LOG1("precompiled includes: ignoring unexpected " << path); } }
+    if (!prelude) {
+        LOG1("precompiled includes miss: " << path);
+        unsigned diagnostics = ::diagnosticCount();
+        std::istringstream stream(split.headers);
+        auto *headers = P4ParserDriver::parse(stream, options.file);
+        if (!headers) return nullptr;
+        if (!replayable(headers->objects)) {
+            std::istringstream whole(text);
+            return P4ParserDriver::parse(whole, options.file); }
+        // a hit would not repeat the diagnostics
+        if (::diagnosticCount() == diagnostics && FrontEndCache::writeFile(path, headers))
+            LOG1("precompiled includes: stored " << path);
+        prelude = &headers->objects;
+    }
+    std::istringstream stream(text.substr(split.end));
+    return P4ParserDriver::parse(stream, options.file, 1, prelude);
+}
+
+}  // namespace P4
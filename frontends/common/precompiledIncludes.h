@@ -0,0 +1,53 @@
+#ifndef _FRONTENDS_COMMON_PRECOMPILEDINCLUDES_H_
+#define _FRONTENDS_COMMON_PRECOMPILEDINCLUDES_H_
+
+#include <string>
+
+#include "frontends/common/parser_options.h"
+#include "ir/ir.h"
+
+namespace P4 {
+
+/**
+ * Reuses the parsed declarations of the standard headers, enabled with
+ * --precompiled-includes.
+ *
+ * Most programs start by including headers from the p4include directory (core.p4 and an
+ * architecture such as v1model.p4), which are often longer than the program itself and
+ * are parsed again by every compilation.  prefix() finds the leading part of the
+ * preprocessed source that consists only of such headers.  Its text, line markers with
+ * the header paths included, is the key, so an entry is only used while the headers are
+ * unmodified and were preprocessed with the same defines.  The value is the list of
+ * top-level declarations parsed from the headers, in the binary IR format.  On a hit
+ * the declarations are replayed into the parser's program structure, so that the lexer
+ * still recognizes the names they declare, and only the rest of the source is parsed.
+ *
+ * Only parsing is skipped; the front end still checks the whole program.  Headers that
+ * declare parsers or controls, or that issue diagnostics, are parsed every time.  Nodes
+ * loaded from the directory carry their source positions as file, line and column only,
+ * as with --frontend-cache, and comments in the headers are not kept.
+ */
+class PrecompiledIncludes {
+ public:
+    /// The leading part of some preprocessed source that comes from standard headers.
+    struct Prefix {
+        /// The text of the headers, with their line markers but without the line
+        /// markers (and blank lines) of the including file in between.
+        std::string     headers;
+        /// The offset of the rest of the source, which starts with the line marker
+        /// returning to the including file.
+        size_t          end = 0;
+    };
+    /// Split the preprocessed source @text after the headers from @includeDir it
+    /// starts with.  If there are none, the headers are empty and end is 0.
+    static Prefix prefix(const std::string &text, cstring includeDir);
+
+    /// Parse the preprocessed P4-16 source @text, reusing the declarations of its
+    /// standard headers if --precompiled-includes is given.
+    /// @return the program, or nullptr on a syntax error, as P4ParserDriver::parse()
+    static const IR::P4Program *parse(const ParserOptions &options, const std::string &text);
+};
+
+}  // namespace P4
+
+#endif /* _FRONTENDS_COMMON_PRECOMPILEDINCLUDES_H_ */
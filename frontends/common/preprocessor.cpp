@@ -0,0 +1,796 @@
+#include "preprocessor.h"
+
+#include <sys/stat.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <utility>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif
+
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace {
+
+/// Marks a ## operator in a macro body while its operands are substituted.
+const char PASTE = '\x01';
+/// Include files nested deeper than this are assumed to recurse.
+const size_t MAX_INCLUDE_DEPTH = 200;
+
+bool isIdentStart(char c) { return isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+bool isIdentChar(char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+
+/// True if @a followed by @b could be read as one token.
+bool canPaste(char a, char b) {
+    static const char *punctuation = "+-*/%<>=!&|^.:#";
+    if (isIdentChar(a) && isIdentChar(b)) return true;
+    return a && b && strchr(punctuation, a) && strchr(punctuation, b);
+}
+
+size_t skipBlanks(const std::string &s, size_t pos) {
+    while (pos < s.size() && isBlank(s[pos])) ++pos;
+    return pos;
+}
+
+std::string trim(const std::string &s) {
+    size_t begin = skipBlanks(s, 0), end = s.size();
+    while (end > begin && isBlank(s[end - 1])) --end;
+    return s.substr(begin, end - begin);
+}
+
+/// @return the position after the identifier at @pos (which is @pos if there is none)
+size_t skipIdent(const std::string &s, size_t pos) {
+    if (pos < s.size() && isIdentStart(s[pos]))
+        while (pos < s.size() && isIdentChar(s[pos])) ++pos;
+    return pos;
+}
+
+/// @return the position after the string literal starting at @pos
+size_t skipString(const std::string &s, size_t pos) {
+    for (++pos; pos < s.size() && s[pos] != '"'; ++pos)
+        if (s[pos] == '\\') ++pos;
+    return pos < s.size() ? pos + 1 : pos;
+}
+
+/// Replace the comments in @line with spaces.  @comment is true if the line starts inside
+/// a comment, and set if it ends inside one.
+std::string stripComments(const std::string &line, bool &comment) {
+    std::string rv;
+    for (size_t pos = 0; pos < line.size(); ) {
+        if (comment) {
+            auto close = line.find("*/", pos);
+            if (close == std::string::npos) break;
+            comment = false;
+            rv += ' ';
+            pos = close + 2;
+        } else if (line[pos] == '"') {
+            size_t end = skipString(line, pos);
+            rv.append(line, pos, end - pos);
+            pos = end;
+        } else if (line.compare(pos, 2, "//") == 0) {
+            break;
+        } else if (line.compare(pos, 2, "/*") == 0) {
+            comment = true;
+            pos += 2;
+        } else {
+            rv += line[pos++]; } }
+    return rv;
+}
+
+/// The value of an #if expression, after macro expansion.
+class ConditionParser {
+    const std::string   &text;
+    size_t              pos = 0;
+
+    /// Read @op, unless it is followed by one of the characters in @notFollowedBy.
+    bool accept(const char *op, const char *notFollowedBy = "") {
+        pos = skipBlanks(text, pos);
+        size_t len = strlen(op);
+        if (text.compare(pos, len, op) != 0) return false;
+        if (pos + len < text.size() && *notFollowedBy && strchr(notFollowedBy, text[pos + len]))
+            return false;
+        pos += len;
+        return true;
+    }
+    void expect(const char *op) { if (!accept(op)) failed = true; }
+
+    long long ternary() {
+        auto cond = logicalOr();
+        if (!accept("?")) return cond;
+        auto a = ternary();
+        expect(":");
+        auto b = ternary();
+        return cond ? a : b;
+    }
+    long long logicalOr() {
+        auto v = logicalAnd();
+        while (accept("||")) { auto r = logicalAnd(); v = v || r; }
+        return v;
+    }
+    long long logicalAnd() {
+        auto v = bitOr();
+        while (accept("&&")) { auto r = bitOr(); v = v && r; }
+        return v;
+    }
+    long long bitOr() {
+        auto v = bitXor();
+        while (accept("|", "|")) v |= bitXor();
+        return v;
+    }
+    long long bitXor() {
+        auto v = bitAnd();
+        while (accept("^")) v ^= bitAnd();
+        return v;
+    }
+    long long bitAnd() {
+        auto v = equality();
+        while (accept("&", "&")) v &= equality();
+        return v;
+    }
+    long long equality() {
+        auto v = relational();
+        while (true) {
+            if (accept("==")) v = v == relational();
+            else if (accept("!=")) v = v != relational();
+            else return v; }
+    }
+    long long relational() {
+        auto v = shift();
+        while (true) {
+            if (accept("<=")) v = v <= shift();
+            else if (accept(">=")) v = v >= shift();
+            else if (accept("<", "<")) v = v < shift();
+            else if (accept(">", ">")) v = v > shift();
+            else return v; }
+    }
+    long long shift() {
+        auto v = additive();
+        while (true) {
+            if (accept("<<")) v = static_cast<long long>(static_cast<unsigned long long>(v)
+                                                         << (additive() & 63));
+            else if (accept(">>")) v >>= (additive() & 63);
+            else return v; }
+    }
+    long long additive() {
+        auto v = multiplicative();
+        while (true) {
+            if (accept("+")) v += multiplicative();
+            else if (accept("-")) v -= multiplicative();
+            else return v; }
+    }
+    long long multiplicative() {
+        auto v = unary();
+        while (true) {
+            if (accept("*")) {
+                v *= unary();
+            } else if (accept("/") || accept("%")) {
+                bool divide = text[pos - 1] == '/';
+                auto r = unary();
+                if (r == 0) {
+                    failed = true;
+                    return 0; }
+                v = divide ? v / r : v % r;
+            } else {
+                return v; } }
+    }
+    long long unary() {
+        if (accept("!", "=")) return !unary();
+        if (accept("~")) return ~unary();
+        if (accept("-")) return -unary();
+        if (accept("+")) return unary();
+        return primary();
+    }
+    long long primary() {
+        if (accept("(")) {
+            auto v = ternary();
+            expect(")");
+            return v; }
+        pos = skipBlanks(text, pos);
+        size_t end = pos;
+        while (end < text.size() && isIdentChar(text[end])) ++end;
+        if (end == pos) {
+            failed = true;
+            return 0; }
+        std::string token = text.substr(pos, end - pos);
+        pos = end;
+        // identifiers that are not macros are 0
+        if (isIdentStart(token[0])) return 0;
+        char *rest;
+        auto v = strtoull(token.c_str(), &rest, 0);
+        while (*rest == 'u' || *rest == 'U' || *rest == 'l' || *rest == 'L') ++rest;
+        if (*rest) failed = true;
+        return static_cast<long long>(v);
+    }
+
+ public:
+    bool failed = false;
+    explicit ConditionParser(const std::string &text) : text(text) {}
+    long long parse() {
+        auto v = ternary();
+        if (skipBlanks(text, pos) != text.size()) failed = true;
+        return v;
+    }
+};
+
+struct CachedFile {
+    time_t                              mtime;
+    off_t                               size;
+    std::shared_ptr<const std::string>  text;
+};
+std::map<std::string, CachedFile> fileCache;
+#ifdef MULTITHREAD
+std::mutex fileCacheLock;
+#endif
+
+}  // namespace
+
+std::shared_ptr<const std::string> Preprocessor::readFile(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return nullptr;
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(fileCacheLock);
+#endif
+    auto it = fileCache.find(path);
+    if (it != fileCache.end() && it->second.mtime == st.st_mtime && it->second.size == st.st_size)
+        return it->second.text;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return nullptr;
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    auto text = std::make_shared<const std::string>(contents.str());
+    fileCache[path] = CachedFile{ st.st_mtime, st.st_size, text };
+    LOG3("preprocessor: read " << path);
+    return text;
+}
+
+void Preprocessor::define(cstring name, cstring value) {
+    defineMacro(std::string(name.c_str()) + " " + value.c_str());
+}
+
+void Preprocessor::addOptions(cstring options) {
+    std::istringstream words(options.c_str());
+    std::string word;
+    while (words >> word) {
+        char kind = word.size() >= 2 && word[0] == '-' ? word[1] : 0;
+        if (kind != 'I' && kind != 'D' && kind != 'U') {
+            ::warning(ErrorType::WARN_UNSUPPORTED,
+                      "Preprocessor option %1% ignored by the built-in preprocessor",
+                      cstring(word));
+            continue; }
+        std::string arg = word.substr(2);
+        if (arg.empty() && !(words >> arg)) {
+            ::error(ErrorType::ERR_INVALID, "Preprocessor option %1% needs an argument",
+                    cstring(word));
+            return; }
+        if (kind == 'I') {
+            addIncludeDir(arg);
+        } else if (kind == 'U') {
+            undefine(arg);
+        } else {
+            auto eq = arg.find('=');
+            if (eq == std::string::npos)
+                define(arg, "1");
+            else
+                define(arg.substr(0, eq), arg.substr(eq + 1)); } }
+}
+
+bool Preprocessor::run(cstring file, std::string &output) {
+    out = &output;
+    errors = 0;
+    if (!processFile(file.c_str(), file.c_str(), false)) {
+        ::error(ErrorType::ERR_NOT_FOUND, "%1%: No such file or directory.", file);
+        return false; }
+    return errors == 0;
+}
+
+bool Preprocessor::run(cstring name, const std::string &text, std::string &output) {
+    out = &output;
+    errors = 0;
+    sources.push_back(Source{ name.c_str(), ".", 1 });
+    marker(1, name.c_str());
+    processText(text);
+    sources.pop_back();
+    return errors == 0;
+}
+
+void Preprocessor::report(const std::string &message) {
+    ++errors;
+    auto &source = sources.back();
+    ::error(ErrorType::ERR_INVALID, "%1%:%2%: %3%", cstring(source.name), source.line,
+            cstring(message));
+}
+
+void Preprocessor::warn(const std::string &message) {
+    auto &source = sources.back();
+    ::warning(ErrorType::WARN_UNSUPPORTED, "%1%:%2%: %3%", cstring(source.name), source.line,
+              cstring(message));
+}
+
+void Preprocessor::marker(unsigned line, const std::string &name, int flag) {
+    *out += "# " + std::to_string(line) + " \"" + name + "\"";
+    if (flag) *out += " " + std::to_string(flag);
+    *out += '\n';
+}
+
+std::string Preprocessor::findInclude(const std::string &name, bool quoted) const {
+    struct stat st;
+    if (name[0] == '/')
+        return stat(name.c_str(), &st) == 0 ? name : std::string();
+    if (quoted) {
+        auto path = sources.back().dir + "/" + name;
+        if (stat(path.c_str(), &st) == 0) return path; }
+    for (auto &dir : includeDirs) {
+        auto path = dir + "/" + name;
+        if (stat(path.c_str(), &st) == 0) return path; }
+    return std::string();
+}
+
+bool Preprocessor::processFile(const std::string &path, const std::string &name,
+                               bool included) {
+    auto text = readFile(path);
+    if (!text) return false;
+    auto slash = path.rfind('/');
+    sources.push_back(Source{ name, slash == std::string::npos ? "." : path.substr(0, slash),
+                              1 });
+    marker(1, name, included ? 1 : 0);
+    processText(*text);
+    sources.pop_back();
+    return true;
+}
+
+void Preprocessor::processText(const std::string &text) {
+    std::vector<Conditional> conditionals;
+    bool comment = false;  // inside a block comment
+    size_t pos = 0;
+    // Append the next physical line to @line, with the ones it is joined to by a
+    // backslash at the end; @lines counts the lines read.
+    auto readLine = [&text, &pos](std::string &line, unsigned &lines) {
+        do {
+            size_t eol = text.find('\n', pos);
+            if (eol == std::string::npos) eol = text.size();
+            line.append(text, pos, eol - pos);
+            pos = eol < text.size() ? eol + 1 : eol;
+            ++lines;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line.back() != '\\') return;
+            line.pop_back();
+        } while (pos < text.size());
+    };
+
+    while (pos < text.size()) {
+        std::string line;
+        unsigned lines = 0;
+        readLine(line, lines);
+        size_t hash = skipBlanks(line, 0);
+        bool active = conditionals.empty() || conditionals.back().active;
+
+        if (!comment && hash < line.size() && line[hash] == '#') {
+            auto body = stripComments(line.substr(hash + 1), comment);
+            if (!directive(body, lines, conditionals)) {
+                out->append(lines, '\n');
+                sources.back().line += lines; }
+            continue; }
+
+        if (!active) {
+            stripComments(line, comment);
+            out->append(lines, '\n');
+            sources.back().line += lines;
+            continue; }
+
+        // A call of a function-like macro may continue on the following lines.
+        bool startComment = comment;
+        std::string result;
+        while (true) {
+            std::set<std::string> disabled;
+            result.clear();
+            comment = startComment;
+            if (expand(line, disabled, result, &comment)) break;
+            if (pos >= text.size()) {
+                report("unterminated argument list of a macro call");
+                result = line;
+                break; }
+            line += ' ';
+            readLine(line, lines); }
+        *out += result;
+        out->append(lines, '\n');
+        sources.back().line += lines; }
+
+    if (!conditionals.empty()) {
+        sources.back().line = conditionals.back().line;
+        report("unterminated #if"); }
+}
+
+bool Preprocessor::directive(const std::string &body, unsigned lines,
+                             std::vector<Conditional> &conditionals) {
+    bool active = conditionals.empty() || conditionals.back().active;
+    size_t begin = skipBlanks(body, 0), end = skipIdent(body, begin);
+    std::string name = body.substr(begin, end - begin);
+    std::string rest = body.substr(end);
+    if (name.empty() && begin < body.size() && isdigit(
+            static_cast<unsigned char>(body[begin]))) {
+        name = "line";  // a line marker, as in cpp output
+        rest = body.substr(begin); }
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+        bool value = false;
+        if (active) {
+            if (name == "if") {
+                value = condition(rest);
+            } else {
+                auto macro = trim(rest);
+                if (macro.empty() || skipIdent(macro, 0) != macro.size())
+                    report("#" + name + " needs a macro name");
+                value = macros.count(macro) == (name == "ifdef" ? 1u : 0u); } }
+        conditionals.push_back(Conditional{ active, value, value, false, sources.back().line });
+    } else if (name == "elif" || name == "else" || name == "endif") {
+        if (conditionals.empty()) {
+            report("#" + name + " without #if");
+        } else if (name == "endif") {
+            conditionals.pop_back();
+        } else {
+            auto &cond = conditionals.back();
+            if (cond.seenElse) report("#" + name + " after #else");
+            if (name == "else") {
+                cond.active = cond.wasActive && !cond.taken;
+                cond.seenElse = true;
+            } else {
+                cond.active = cond.wasActive && !cond.taken && condition(rest); }
+            cond.taken = cond.taken || cond.active; }
+    } else if (!active || name.empty()) {
+        // skipped, or a null directive
+    } else if (name == "define") {
+        defineMacro(rest);
+    } else if (name == "undef") {
+        undefine(trim(rest));
+    } else if (name == "include") {
+        return include(rest, sources.back().line + lines);
+    } else if (name == "line") {
+        std::set<std::string> disabled;
+        std::string expanded;
+        expand(rest, disabled, expanded);
+        auto target = std::strtoul(expanded.c_str(), nullptr, 10);
+        auto open = expanded.find('"');
+        auto close = open == std::string::npos ? open : expanded.find('"', open + 1);
+        if (target == 0) {
+            report("#line needs a positive line number");
+        } else {
+            if (close != std::string::npos)
+                sources.back().name = expanded.substr(open + 1, close - open - 1);
+            sources.back().line = target;
+            marker(target, sources.back().name);
+            return true; }
+    } else if (name == "error") {
+        report("#error" + rest);
+    } else if (name == "warning") {
+        warn("#warning" + rest);
+    } else if (name == "pragma") {
+        *out += "#pragma" + rest;
+    } else {
+        report("invalid preprocessing directive #" + name); }
+    return false;
+}
+
+void Preprocessor::defineMacro(const std::string &text) {
+    size_t begin = skipBlanks(text, 0), end = skipIdent(text, begin);
+    if (begin == end) {
+        report("macro names must be identifiers");
+        return; }
+    std::string name = text.substr(begin, end - begin);
+    Macro macro;
+    size_t pos = end;
+    if (pos < text.size() && text[pos] == '(') {
+        // function-like: the parameter list follows the name without a space
+        macro.function = true;
+        pos = skipBlanks(text, pos + 1);
+        if (pos < text.size() && text[pos] == ')') {
+            ++pos;
+        } else {
+            while (true) {
+                pos = skipBlanks(text, pos);
+                if (text.compare(pos, 3, "...") == 0) {
+                    macro.variadic = true;
+                    pos = skipBlanks(text, pos + 3);
+                    if (pos >= text.size() || text[pos] != ')') {
+                        report("missing ')' after \"...\" in the parameters of " + name);
+                        return; }
+                    ++pos;
+                    break; }
+                size_t paramEnd = skipIdent(text, pos);
+                if (paramEnd == pos) {
+                    report("invalid parameter list of macro " + name);
+                    return; }
+                macro.params.push_back(text.substr(pos, paramEnd - pos));
+                pos = skipBlanks(text, paramEnd);
+                if (pos < text.size() && text[pos] == ',') {
+                    ++pos;
+                    continue; }
+                if (pos < text.size() && text[pos] == ')') {
+                    ++pos;
+                    break; }
+                report("invalid parameter list of macro " + name);
+                return; } } }
+    macro.body = trim(text.substr(pos));
+    macros[name] = std::move(macro);
+}
+
+bool Preprocessor::include(const std::string &text, unsigned next) {
+    std::string spec = trim(text);
+    if (!spec.empty() && spec[0] != '"' && spec[0] != '<') {
+        std::set<std::string> disabled;
+        std::string expanded;
+        expand(spec, disabled, expanded);
+        spec = trim(expanded); }
+    size_t close = std::string::npos;
+    if (!spec.empty())
+        close = spec.find(spec[0] == '"' ? '"' : '>', 1);
+    if (spec.empty() || (spec[0] != '"' && spec[0] != '<') || close == std::string::npos) {
+        report("#include expects \"FILENAME\" or <FILENAME>");
+        return false; }
+    auto name = spec.substr(1, close - 1);
+    auto path = findInclude(name, spec[0] == '"');
+    if (path.empty()) {
+        report(name + ": No such file or directory");
+        return false; }
+    if (sources.size() >= MAX_INCLUDE_DEPTH) {
+        report("#include nested too deeply");
+        return false; }
+    auto current = sources.back().name;
+    if (!processFile(path, path, true)) {
+        report(name + ": cannot read the file");
+        return false; }
+    sources.back().line = next;
+    marker(next, current, 2);
+    return true;
+}
+
+bool Preprocessor::condition(const std::string &text) {
+    // replace `defined X` and `defined(X)` before the macros are expanded
+    std::string replaced;
+    for (size_t pos = 0; pos < text.size(); ) {
+        size_t end = skipIdent(text, pos);
+        if (end == pos) {
+            if (isdigit(static_cast<unsigned char>(text[pos]))) {
+                while (end < text.size() && isIdentChar(text[end])) ++end;
+            } else {
+                end = pos + 1; }
+            replaced.append(text, pos, end - pos);
+            pos = end;
+            continue; }
+        if (text.compare(pos, end - pos, "defined") != 0) {
+            replaced.append(text, pos, end - pos);
+            pos = end;
+            continue; }
+        pos = skipBlanks(text, end);
+        bool paren = pos < text.size() && text[pos] == '(';
+        if (paren) pos = skipBlanks(text, pos + 1);
+        end = skipIdent(text, pos);
+        if (end == pos) {
+            report("\"defined\" needs a macro name");
+            return false; }
+        replaced += macros.count(text.substr(pos, end - pos)) ? " 1 " : " 0 ";
+        pos = skipBlanks(text, end);
+        if (paren) {
+            if (pos >= text.size() || text[pos] != ')') {
+                report("missing ')' after \"defined\"");
+                return false; }
+            ++pos; } }
+
+    std::set<std::string> disabled;
+    std::string expanded;
+    if (!expand(replaced, disabled, expanded)) {
+        report("unterminated argument list of a macro call in #if");
+        return false; }
+    ConditionParser parser(expanded);
+    auto value = parser.parse();
+    if (parser.failed) {
+        report("invalid #if expression: " + trim(text));
+        return false; }
+    return value != 0;
+}
+
+bool Preprocessor::expand(const std::string &text, std::set<std::string> &disabled,
+                          std::string &result, bool *comment) {
+    size_t pos = 0, size = text.size();
+    if (comment && *comment) {
+        auto close = text.find("*/");
+        if (close == std::string::npos) {
+            result += text;
+            return true; }
+        result.append(text, 0, close + 2);
+        pos = close + 2;
+        *comment = false; }
+    while (pos < size) {
+        char c = text[pos];
+        if (c == '"') {
+            size_t end = skipString(text, pos);
+            result.append(text, pos, end - pos);
+            pos = end;
+            continue; }
+        if (c == '/' && pos + 1 < size && text[pos + 1] == '/') {
+            result.append(text, pos, std::string::npos);
+            break; }
+        if (c == '/' && pos + 1 < size && text[pos + 1] == '*') {
+            auto close = text.find("*/", pos + 2);
+            if (close == std::string::npos) {
+                result.append(text, pos, std::string::npos);
+                if (comment) *comment = true;
+                break; }
+            result.append(text, pos, close + 2 - pos);
+            pos = close + 2;
+            continue; }
+        if (isdigit(static_cast<unsigned char>(c))) {
+            // a number, such as 8w0xff, has no identifiers in it
+            size_t end = pos;
+            while (end < size && (isIdentChar(text[end]) || text[end] == '.')) ++end;
+            result.append(text, pos, end - pos);
+            pos = end;
+            continue; }
+        size_t end = skipIdent(text, pos);
+        if (end == pos) {
+            result += c;
+            ++pos;
+            continue; }
+
+        std::string id = text.substr(pos, end - pos);
+        auto it = macros.find(id);
+        if (it == macros.end() || disabled.count(id)) {
+            if (id == "__LINE__" && it == macros.end())
+                result += std::to_string(sources.back().line);
+            else if (id == "__FILE__" && it == macros.end())
+                result += "\"" + sources.back().name + "\"";
+            else
+                result += id;
+            pos = end;
+            continue; }
+        const Macro &macro = it->second;
+        if (!macro.function) {
+            disabled.insert(id);
+            expandMacro(macro.body, disabled, result, text, end);
+            disabled.erase(id);
+            pos = end;
+            continue; }
+
+        // a function-like macro is only expanded when it is called
+        size_t open = skipBlanks(text, end);
+        if (open >= size || text[open] != '(') {
+            result += id;
+            pos = end;
+            continue; }
+        std::vector<std::string> args;
+        std::string arg;
+        int depth = 0;
+        bool closed = false;
+        size_t next = open + 1;
+        while (next < size) {
+            char d = text[next];
+            if (d == '"') {
+                size_t stringEnd = skipString(text, next);
+                arg.append(text, next, stringEnd - next);
+                next = stringEnd;
+                continue; }
+            ++next;
+            if (d == '(') {
+                ++depth;
+            } else if (d == ')') {
+                if (depth == 0) {
+                    closed = true;
+                    break; }
+                --depth;
+            } else if (d == ',' && depth == 0) {
+                args.push_back(arg);
+                arg.clear();
+                continue; }
+            arg += d; }
+        if (!closed) return false;
+        args.push_back(arg);
+        // a macro without parameters is called with one empty argument
+        if (macro.params.empty() && !macro.variadic && args.size() == 1 && trim(args[0]).empty())
+            args.clear();
+        if (args.size() < macro.params.size() ||
+            (!macro.variadic && args.size() > macro.params.size())) {
+            report("macro " + id + " takes " + std::to_string(macro.params.size()) +
+                   " arguments, but " + std::to_string(args.size()) + " were given");
+            result.append(text, pos, next - pos);
+            pos = next;
+            continue; }
+        auto body = substitute(macro, args, disabled);
+        disabled.insert(id);
+        expandMacro(body, disabled, result, text, next);
+        disabled.erase(id);
+        pos = next; }
+    return true;
+}
+
+void Preprocessor::expandMacro(const std::string &body, std::set<std::string> &disabled,
+                               std::string &result, const std::string &text, size_t next) {
+    // Like cpp, keep the expansion from running together with the tokens around it,
+    // as - and -1 would, or + and +1 (which is ++ in P4).
+    size_t start = result.size();
+    expand(body, disabled, result);
+    if (result.size() == start) return;
+    if (start > 0 && canPaste(result[start - 1], result[start]))
+        result.insert(start, 1, ' ');
+    if (next < text.size() && canPaste(result.back(), text[next]))
+        result += ' ';
+}
+
+std::string Preprocessor::substitute(const Macro &macro, const std::vector<std::string> &args,
+                                     std::set<std::string> &disabled) {
+    // the unexpanded argument for a parameter, or nullptr if @name is not one
+    std::string variadicArgs;
+    if (macro.variadic)
+        for (size_t i = macro.params.size(); i < args.size(); ++i) {
+            if (i > macro.params.size()) variadicArgs += ",";
+            variadicArgs += args[i]; }
+    auto argument = [&](const std::string &name) -> const std::string * {
+        for (size_t i = 0; i < macro.params.size(); ++i)
+            if (macro.params[i] == name) return &args[i];
+        if (macro.variadic && name == "__VA_ARGS__") return &variadicArgs;
+        return nullptr; };
+
+    const std::string &body = macro.body;
+    std::string rv;
+    for (size_t pos = 0; pos < body.size(); ) {
+        char c = body[pos];
+        if (c == '"') {
+            size_t end = skipString(body, pos);
+            rv.append(body, pos, end - pos);
+            pos = end;
+            continue; }
+        if (c == '#' && pos + 1 < body.size() && body[pos + 1] == '#') {
+            rv += PASTE;
+            pos += 2;
+            continue; }
+        if (c == '#') {
+            // stringify the argument named next
+            size_t begin = skipBlanks(body, pos + 1), end = skipIdent(body, begin);
+            auto *arg = end > begin ? argument(body.substr(begin, end - begin)) : nullptr;
+            if (arg) {
+                rv += '"';
+                for (char a : trim(*arg)) {
+                    if (a == '"' || a == '\\') rv += '\\';
+                    rv += a; }
+                rv += '"';
+                pos = end;
+                continue; } }
+        size_t end = skipIdent(body, pos);
+        if (end == pos) {
+            rv += c;
+            ++pos;
+            continue; }
+        auto *arg = argument(body.substr(pos, end - pos));
+        if (!arg) {
+            rv.append(body, pos, end - pos);
+        } else {
+            // the operands of ## are not expanded
+            size_t before = rv.find_last_not_of(" \t");
+            size_t after = skipBlanks(body, end);
+            if ((before != std::string::npos && rv[before] == PASTE) ||
+                body.compare(after, 2, "##") == 0) {
+                rv += trim(*arg);
+            } else {
+                std::string expanded;
+                expand(*arg, disabled, expanded);
+                rv += trim(expanded); } }
+        pos = end; }
+
+    // paste the tokens around each ##
+    std::string pasted;
+    for (size_t pos = 0; pos < rv.size(); ++pos) {
+        if (rv[pos] != PASTE) {
+            pasted += rv[pos];
+            continue; }
+        while (!pasted.empty() && isBlank(pasted.back())) pasted.pop_back();
+        while (pos + 1 < rv.size() && isBlank(rv[pos + 1])) ++pos; }
+    return pasted;
+}
+
+}  // namespace P4
@@ -0,0 +1,107 @@
+#ifndef _FRONTENDS_COMMON_PREPROCESSOR_H_
+#define _FRONTENDS_COMMON_PREPROCESSOR_H_
+
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/cstring.h"
+
+namespace P4 {
+
+/**
+ * A preprocessor for the part of the C preprocessor that P4 programs use, which runs in
+ * the compiler instead of an external cpp (--builtin-preprocessor).
+ *
+ * It supports #include, #define (object-like and function-like macros, with # and ##),
+ * #undef, #if, #ifdef, #ifndef, #elif, #else, #endif, #line, #error and #warning, and
+ * passes #pragma lines through.  Like `cpp -C`, comments are kept, and the output has
+ * line markers with the flags 1 and 2 on entering and leaving an included file, so
+ * source positions and PrecompiledIncludes work as with cpp.
+ *
+ * The contents of the files read are kept for the life of the process, keyed by their
+ * path, and read again only when their modification time or size changes.  Errors are
+ * reported with ::error().
+ */
+class Preprocessor {
+ public:
+    /// Add a directory searched by #include, after those added before.
+    void addIncludeDir(cstring dir) { includeDirs.push_back(dir.c_str()); }
+    /// Define @name as @value, as `-D name=value` would.
+    void define(cstring name, cstring value);
+    void undefine(cstring name) { macros.erase(name.c_str()); }
+    /// Apply the -I, -D and -U options in the cpp command line @options; others are
+    /// ignored with a warning.
+    void addOptions(cstring options);
+
+    /// Preprocess the file @file into @output.
+    /// @return false after reporting an error
+    bool run(cstring file, std::string &output);
+    /// Preprocess @text, read from a source called @name (e.g. "<stdin>"), into @output.
+    bool run(cstring name, const std::string &text, std::string &output);
+
+ private:
+    struct Macro {
+        bool                        function = false;
+        bool                        variadic = false;
+        std::vector<std::string>    params;
+        std::string                 body;
+    };
+    /// A conditional group (#if ... #endif) being read.
+    struct Conditional {
+        bool    wasActive;  // lines around the group are being kept
+        bool    active;     // lines of the current branch are being kept
+        bool    taken;      // some branch has been kept
+        bool    seenElse;
+        unsigned line;      // of the #if
+    };
+    /// The file being read.
+    struct Source {
+        std::string     name;  // as it appears in line markers
+        std::string     dir;   // searched first by #include "..."
+        unsigned        line;
+    };
+
+    std::vector<std::string>                    includeDirs;
+    std::unordered_map<std::string, Macro>      macros;
+    std::vector<Source>                         sources;
+    std::string                                 *out = nullptr;
+    unsigned                                    errors = 0;
+
+    static std::shared_ptr<const std::string> readFile(const std::string &path);
+    std::string findInclude(const std::string &name, bool quoted) const;
+
+    bool processFile(const std::string &path, const std::string &name, bool included);
+    void processText(const std::string &text);
+    /// Process the directive @body (the text after the #) spanning @lines lines.
+    /// @return true if it wrote a line marker for the line that follows it
+    bool directive(const std::string &body, unsigned lines,
+                   std::vector<Conditional> &conditionals);
+    void defineMacro(const std::string &text);
+    /// Include the file named by @text, continuing at line @next after it.
+    /// @return true if it wrote the line marker for @next
+    bool include(const std::string &text, unsigned next);
+    bool condition(const std::string &text);
+
+    /// Append the macro expansion of @text to @result; comments and string literals are
+    /// copied unchanged.  On a call of a function-like macro that is not complete before
+    /// the end of @text, stop and return false.  @comment is set if @text ends inside a
+    /// comment.
+    bool expand(const std::string &text, std::set<std::string> &disabled,
+                std::string &result, bool *comment = nullptr);
+    /// Expand the expansion @body of a macro called in @text, which continues at @next.
+    void expandMacro(const std::string &body, std::set<std::string> &disabled,
+                     std::string &result, const std::string &text, size_t next);
+    std::string substitute(const Macro &macro, const std::vector<std::string> &args,
+                           std::set<std::string> &disabled);
+
+    void report(const std::string &message);
+    void warn(const std::string &message);
+    void marker(unsigned line, const std::string &name, int flag = 0);
+};
+
+}  // namespace P4
+
+#endif /* _FRONTENDS_COMMON_PREPROCESSOR_H_ */
@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef _FRONTENDS_COMMON_PROGRAMMAP_H_
 #define _FRONTENDS_COMMON_PROGRAMMAP_H_
 
+#include <atomic>
+
 #include "ir/ir.h"
 
 namespace P4 {
@@ -25,13 +27,56 @@ namespace P4 {
 // A map is computed on a certain P4Program.
 // If the program has not changed, the map is up-to-date.
 class ProgramMap : public IHasDbPrint {
+    // Changes whenever entries are removed from the map, and is never the
+    // same for two maps, so results computed from a map can be remembered
+    // for as long as its generation stays the same.
+    uint64_t generation = newGeneration();
+    static uint64_t newGeneration() {
+        static std::atomic<uint64_t> next{1};
+        return next++; }
+    // While set the map must not change; see freeze().
+    bool frozen = false;
+
  protected:
     const IR::P4Program* program = nullptr;
     cstring mapKind;
     explicit ProgramMap(cstring kind) : mapKind(kind) {}
+    ProgramMap(const ProgramMap& other) : program(other.program), mapKind(other.mapKind) {}
+    ProgramMap& operator=(const ProgramMap& other) {
+        program = other.program;
+        mapKind = other.mapKind;
+        generation = newGeneration();
+        return *this; }
     virtual ~ProgramMap() {}
+    // Subclasses call this whenever they remove or change entries.
+    void invalidate() { generation = newGeneration(); }
+    // Subclasses call this before they change the map.
+    void checkNotFrozen() const {
+        BUG_CHECK(!frozen, "%1% changed while it is frozen", mapKind); }
 
  public:
+    uint64_t getGeneration() const { return generation; }
+
+    /// Make the map read-only until thaw(): changing it is then a bug.  The lookups of
+    /// the maps do not write, so a frozen map can be read by any number of threads at
+    /// once without locks.  Threads that learn more write to shards of it instead (see
+    /// TypeMap(const TypeMap*) and ReferenceMap(const ReferenceMap*)), which it merges
+    /// once it is thawed.  A copy of a frozen map is not frozen.
+    void freeze() { frozen = true; }
+    void thaw() { frozen = false; }
+    bool isFrozen() const { return frozen; }
+
+    /// Keeps a map frozen for as long as it lives.
+    class Freeze {
+        ProgramMap& map;
+        bool        wasFrozen;
+
+     public:
+        explicit Freeze(ProgramMap& map) : map(map), wasFrozen(map.frozen) { map.freeze(); }
+        Freeze(const Freeze&) = delete;
+        ~Freeze() { map.frozen = wasFrozen; }
+    };
+
     // Check if map is up-to-date for the specified node; return true if it is
     bool checkMap(const IR::Node* node) const {
         if (node == program) {
@@ -53,6 +98,7 @@ class ProgramMap : public IHasDbPrint {
     void updateMap(const IR::Node* node) {
         if (node == nullptr || !node->is<IR::P4Program>())
             return;
+        checkNotFrozen();
         program = node->to<IR::P4Program>();
         LOG2(mapKind << " updated to " << dbp(node));
     }
@@ -22,23 +22,42 @@ namespace P4 {
 
 MinimalNameGenerator::MinimalNameGenerator() {
     usedNames.insert(P4::reservedWords.begin(), P4::reservedWords.end());
+    invalidate();
 }
 
 ReferenceMap::ReferenceMap() : ProgramMap("ReferenceMap"), isv1(false) { clear(); }
 
+ReferenceMap::ReferenceMap(const ReferenceMap* parent)
+        : ProgramMap("ReferenceMap"), isv1(parent->isv1), parent(parent) {}
+
 void ReferenceMap::clear() {
+    checkNotFrozen();
     pathToDeclaration.clear();
     usedNames.clear();
+    nextName.clear();
     used.clear();
     thisToDeclaration.clear();
-    usedNames.insert(P4::reservedWords.begin(), P4::reservedWords.end());
+    // a shard finds them in its parent
+    if (parent == nullptr)
+        usedNames.insert(P4::reservedWords.begin(), P4::reservedWords.end());
+}
+
+void ReferenceMap::merge(const ReferenceMap& shard) {
+    BUG_CHECK(shard.parent == this, "Merging a reference map that is not a shard of this one");
+    for (auto e : shard.pathToDeclaration)
+        setDeclaration(e.first, e.second);
+    for (auto e : shard.thisToDeclaration)
+        setDeclaration(e.first, e.second);
+    used.insert(shard.used.begin(), shard.used.end());
+    usedNames.insert(shard.usedNames.begin(), shard.usedNames.end());
 }
 
 void ReferenceMap::setDeclaration(const IR::Path* path, const IR::IDeclaration* decl) {
     CHECK_NULL(path);
     CHECK_NULL(decl);
+    checkNotFrozen();
     LOG3("Resolved " << dbp(path) << " to " << dbp(decl));
-    auto previous = get(pathToDeclaration, path);
+    auto previous = pathToDeclaration.get(path);
     if (previous != nullptr && previous != decl)
         BUG("%1% already resolved to %2% instead of %3%",
             dbp(path), dbp(previous), dbp(decl->getNode()));
@@ -50,8 +69,9 @@ void ReferenceMap::setDeclaration(const IR::Path* path, const IR::IDeclaration*
 void ReferenceMap::setDeclaration(const IR::This* pointer, const IR::IDeclaration* decl) {
     CHECK_NULL(pointer);
     CHECK_NULL(decl);
+    checkNotFrozen();
     LOG3("Resolved " << dbp(pointer) << " to " << dbp(decl));
-    auto previous = get(thisToDeclaration, pointer);
+    auto previous = thisToDeclaration.get(pointer);
     if (previous != nullptr && previous != decl)
         BUG("%1% already resolved to %2% instead of %3%",
             dbp(pointer), dbp(previous), dbp(decl));
@@ -60,7 +80,9 @@ void ReferenceMap::setDeclaration(const IR::This* pointer, const IR::IDeclaratio
 
 const IR::IDeclaration* ReferenceMap::getDeclaration(const IR::This* pointer, bool notNull) const {
     CHECK_NULL(pointer);
-    auto result = get(thisToDeclaration, pointer);
+    auto result = thisToDeclaration.get(pointer);
+    for (auto map = parent; result == nullptr && map != nullptr; map = map->parent)
+        result = map->thisToDeclaration.get(pointer);
 
     if (result)
         LOG3("Looking up " << dbp(pointer) << " found " << dbp(result));
@@ -74,7 +96,9 @@ const IR::IDeclaration* ReferenceMap::getDeclaration(const IR::This* pointer, bo
 
 const IR::IDeclaration* ReferenceMap::getDeclaration(const IR::Path* path, bool notNull) const {
     CHECK_NULL(path);
-    auto result = get(pathToDeclaration, path);
+    auto result = pathToDeclaration.get(path);
+    for (auto map = parent; result == nullptr && map != nullptr; map = map->parent)
+        result = map->pathToDeclaration.get(path);
 
     if (result)
         LOG3("Looking up " << dbp(path) << " found " << dbp(result));
@@ -94,6 +118,12 @@ void ReferenceMap::dbprint(std::ostream &out) const {
 }
 
 cstring ReferenceMap::newName(cstring base) {
+    checkNotFrozen();
+    if (nameSource) {
+        cstring name = nameSource->newName(base);
+        usedNames.insert(name);
+        return name; }
+
     // Maybe in the future we'll maintain information with per-scope identifiers,
     // but today we are content to generate globally-unique identifiers.
 
@@ -107,7 +137,24 @@ cstring ReferenceMap::newName(cstring base) {
     if (len > 0 && base[len - 1] == '_')
         base = base.substr(0, len - 1);
 
-    cstring name = cstring::make_unique(usedNames, base, '_');
+    if (parent != nullptr) {
+        // the search resumes where the parent's would, and skips the names of both
+        struct InUse {
+            const ReferenceMap* map;
+            bool count(cstring name) const { return map->isUsedName(name); }
+        } inuse{this};
+        auto it = nextName.find(base);
+        if (it == nextName.end()) {
+            int start = 0;
+            for (auto map = parent; map != nullptr && !start; map = map->parent) {
+                auto p = map->nextName.find(base);
+                if (p != map->nextName.end()) start = p->second; }
+            it = nextName.emplace(base, start).first; }
+        cstring name = cstring::make_unique(inuse, base, it->second, '_');
+        usedNames.insert(name);
+        return name; }
+
+    cstring name = cstring::make_unique(usedNames, base, nextName[base], '_');
     usedNames.insert(name);
     return name;
 }
@@ -126,7 +173,7 @@ cstring MinimalNameGenerator::newName(cstring base) {
     if (len > 0 && base[len - 1] == '_')
         base = base.substr(0, len - 1);
 
-    cstring name = cstring::make_unique(usedNames, base, '_');
+    cstring name = cstring::make_unique(usedNames, base, nextName[base], '_');
     usedNames.insert(name);
     return name;
 }
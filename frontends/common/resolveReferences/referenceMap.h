@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef _COMMON_RESOLVEREFERENCES_REFERENCEMAP_H_
 #define _COMMON_RESOLVEREFERENCES_REFERENCEMAP_H_
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include "ir/ir.h"
 #include "lib/cstring.h"
 #include "lib/map.h"
@@ -31,7 +34,9 @@ class NameGenerator {
 
 // replacement for ReferenceMap NameGenerator to make it easier to remove uses of refMap
 class MinimalNameGenerator : public NameGenerator, public Inspector {
-    std::set<cstring> usedNames;
+    std::unordered_set<cstring, cstring_identity_hash> usedNames;
+    /// For each base, where newName() resumes its search (see cstring::make_unique).
+    std::unordered_map<cstring, int, cstring_identity_hash> nextName;
     void usedName(cstring name) { usedNames.insert(name); }
     void postorder(const IR::Path *p) override { usedName(p->name.name); }
     void postorder(const IR::Type_Declaration *t) override { usedName(t->name.name); }
@@ -64,19 +69,40 @@ class ReferenceMap final : public ProgramMap, public NameGenerator, public Decla
     bool isv1;
 
     /// Maps paths in the program to declarations.
-    std::map<const IR::Path*, const IR::IDeclaration*> pathToDeclaration;
+    IR::DenseNodeMap<const IR::IDeclaration*, IR::Path> pathToDeclaration;
 
     /// Set containing all declarations in the program.
     std::set<const IR::IDeclaration*> used;
 
     /// Map from `This` to declarations (an experimental feature).
-    std::map<const IR::This*, const IR::IDeclaration*> thisToDeclaration;
+    IR::DenseNodeMap<const IR::IDeclaration*, IR::This> thisToDeclaration;
 
     /// Set containing all names used in the program.
-    std::set<cstring> usedNames;
+    std::unordered_set<cstring, cstring_identity_hash> usedNames;
+
+    /// For each base, where newName() resumes its search (see cstring::make_unique).
+    std::unordered_map<cstring, int, cstring_identity_hash> nextName;
+
+    /// If set, newName() takes fresh names from here rather than from usedNames.
+    NameGenerator *nameSource = nullptr;
+
+    /// The map a shard adds to; see ReferenceMap(const ReferenceMap*).
+    const ReferenceMap* parent = nullptr;
+
+    /// Whether @name is used in this map or the maps it adds to.
+    bool isUsedName(cstring name) const {
+        for (auto map = this; map; map = map->parent)
+            if (map->usedNames.count(name)) return true;
+        return false; }
 
  public:
     ReferenceMap();
+    /// A shard of @parent, for resolving references concurrently with other shards.
+    /// Lookups fall back to @parent, which must not change while the shard is in use
+    /// (see ProgramMap::freeze); what is learned goes into the shard, until @parent
+    /// merges it.  The names a shard makes are fresh for @parent and the shard, but
+    /// may be those another shard makes, unless the shards share a name source.
+    explicit ReferenceMap(const ReferenceMap* parent);
     /// Looks up declaration for @p path. If @p notNull is false, then
     /// failure to find a declaration is an error.
     const IR::IDeclaration* getDeclaration(const IR::Path* path, bool notNull = false)
@@ -105,14 +131,25 @@ class ReferenceMap final : public ProgramMap, public NameGenerator, public Decla
     /// Clear the reference map
     void clear();
 
+    /// Add everything the shard @shard of this map learned.  Merging the shards in
+    /// a fixed order gives the same map whichever order they were filled in.
+    void merge(const ReferenceMap& shard);
+
     /// @returns @true if this map is for a P4_14 program
     bool isV1() const { return isv1; }
 
     /// @returns @true if @p decl is used in the program.
-    bool isUsed(const IR::IDeclaration* decl) const { return used.count(decl) > 0; }
+    bool isUsed(const IR::IDeclaration* decl) const {
+        return used.count(decl) > 0 || (parent != nullptr && parent->isUsed(decl)); }
 
     /// Indicate that @p name is used in the program.
-    void usedName(cstring name) { usedNames.insert(name); }
+    void usedName(cstring name) {
+        checkNotFrozen();
+        usedNames.insert(name); }
+
+    /// Generate new names with @p source (which survives clear()), e.g. so that the maps
+    /// for separate parts of a program do not hand out the same name twice.
+    void setNameSource(NameGenerator *source) { nameSource = source; }
 };
 
 }  // namespace P4
@@ -30,9 +30,14 @@ ResolutionContext::ResolutionContext() {
 
 const std::vector<const IR::IDeclaration*>*
 ResolutionContext::resolve(IR::ID name, P4::ResolutionType type) const {
-    const Context *ctxt = nullptr;
+    const Context *ctxt = getChildContext();
+    while (ctxt->parent) ctxt = ctxt->parent;
+    if (ctxt->node != indexedRoot) {
+        nameIndex.clear();
+        indexedRoot = ctxt->node; }
+    ctxt = nullptr;
     while (auto scope = findContext<IR::INamespace>(ctxt)) {
-        auto *rv = lookup(scope, name, type);
+        auto *rv = lookup(scope, name, type, ctxt->node == ctxt->original);
         if (!rv->empty()) return rv; }
     if (type == P4::ResolutionType::Any)
         return lookupMatchKind(name);
@@ -41,11 +46,14 @@ ResolutionContext::resolve(IR::ID name, P4::ResolutionType type) const {
 
 const std::vector<const IR::IDeclaration*>*
 ResolutionContext::lookup(const IR::INamespace *current, IR::ID name,
-                          P4::ResolutionType type) const {
+                          P4::ResolutionType type, bool indexed) const {
     LOG2("Trying to resolve in " << current->toString());
 
     if (auto gen = current->to<IR::IGeneralNamespace>()) {
-        Util::Enumerator<const IR::IDeclaration*> *decls = gen->getDeclsByName(name);
+        Util::Enumerator<const IR::IDeclaration*> *decls = indexed ?
+                Util::Enumerator<const IR::IDeclaration*>::createEnumerator(
+                    declsByName(gen, name)) :
+                gen->getDeclsByName(name);
         switch (type) {
             case P4::ResolutionType::Any:
                 break;
@@ -140,11 +148,22 @@ ResolutionContext::lookup(const IR::INamespace *current, IR::ID name,
         // boost bug -- trying to iterate with an adaptor over an unnamed temp crashes
         auto temp = nested->getNestedNamespaces();
         for (auto nn : boost::adaptors::reverse(temp)) {
-            auto rv = lookup(nn, name, type);
+            auto rv = lookup(nn, name, type, indexed);
             if (!rv->empty()) return rv; } }
     return &empty;
 }
 
+const std::vector<const IR::IDeclaration*> &
+ResolutionContext::declsByName(const IR::IGeneralNamespace *ns, cstring name) const {
+    auto it = nameIndex.find(ns);
+    if (it == nameIndex.end()) {
+        it = nameIndex.emplace(ns, NameIndex()).first;
+        for (auto decl : *ns->getDeclarations())
+            it->second[decl->getName().name].push_back(decl); }
+    auto decls = it->second.find(name);
+    return decls == it->second.end() ? empty : decls->second;
+}
+
 const std::vector<const IR::IDeclaration*> *ResolutionContext::lookupMatchKind(IR::ID name) const {
     if (auto *global = findContext<IR::P4Program>()) {
         for (auto *obj : global->objects) {
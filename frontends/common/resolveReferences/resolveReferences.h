@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef _COMMON_RESOLVEREFERENCES_RESOLVEREFERENCES_H_
 #define _COMMON_RESOLVEREFERENCES_RESOLVEREFERENCES_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include "ir/ir.h"
 #include "referenceMap.h"
 #include "lib/exceptions.h"
@@ -38,7 +41,8 @@ class ResolutionContext : virtual public Visitor, public DeclarationLookup {
     // a single error { } namespace.
 
     const std::vector<const IR::IDeclaration*>*
-    lookup(const IR::INamespace *ns, IR::ID name, ResolutionType type) const;
+    lookup(const IR::INamespace *ns, IR::ID name, ResolutionType type) const
+    { return lookup(ns, name, type, false); }
 
     // match kinds exist in their own special namespace, made from all the match_kind
     // declarations in the global scope.  Unlike errors, we don't merge those scopes in
@@ -55,6 +59,24 @@ class ResolutionContext : virtual public Visitor, public DeclarationLookup {
     ResolutionContext();
     explicit ResolutionContext(bool ao) : anyOrder(ao) {}
 
+ private:
+    // The declarations of general namespaces (the program and externs) by
+    // name, built on the first lookup in each of them.  A replaced namespace
+    // is a different node, with its own index.  Only namespaces found in the
+    // context unmodified are indexed; the index is dropped when visiting
+    // another program.
+    typedef std::unordered_map<cstring, std::vector<const IR::IDeclaration*>> NameIndex;
+    mutable std::unordered_map<const IR::INamespace*, NameIndex> nameIndex;
+    mutable const IR::Node *indexedRoot = nullptr;
+
+    /// If @p indexed, @p ns is not being modified and its index can be used.
+    const std::vector<const IR::IDeclaration*>*
+    lookup(const IR::INamespace *ns, IR::ID name, ResolutionType type, bool indexed) const;
+    const std::vector<const IR::IDeclaration*> &
+    declsByName(const IR::IGeneralNamespace *ns, cstring name) const;
+
+ protected:
+
 
     /// We are resolving a method call.  Find the arguments from the context.
     const IR::Vector<IR::Argument> *methodArguments(cstring name) const;
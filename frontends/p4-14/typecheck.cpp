@@ -376,11 +376,14 @@ inferTypeFromContext(const Visitor::Context* ctxt, const IR::V1Program* global)
 /// Top down type inferencing -- set the type of expression nodes based on their uses.
 class TypeCheck::InferExpressionsTopDown : public Modifier {
  public:
-    InferExpressionsTopDown() { setName("InferExpressionsTopDown"); }
+    /// @global is the program of the declarations it is applied to, if not the root
+    explicit InferExpressionsTopDown(const IR::V1Program *global = nullptr) : global(global) {
+        setName("InferExpressionsTopDown"); }
  private:
     const IR::V1Program *global = nullptr;
     profile_t init_apply(const IR::Node *root) override {
-        global = root->to<IR::V1Program>();
+        if (auto glob = root->to<IR::V1Program>())
+            global = glob;
         return Modifier::init_apply(root); }
     bool preorder(IR::ActionArg *) override { return false; }  // don't infer these yet
     bool preorder(IR::Expression *op) override {
@@ -396,6 +399,42 @@ class TypeCheck::InferExpressionsTopDown : public Modifier {
         return true; }
 };
 
+/// Bottom up and then top down type inferencing on each top-level declaration (action,
+/// control, table, parser state...) in turn, rather than on the whole program.  Only
+/// the declarations with expressions of still unknown types are swept again by the next
+/// iteration, and those that another pass changed, e.g. an action after
+/// AssignActionArgTypes set the type of one of its arguments: in all the others, both
+/// sweeps would find nothing to change.
+class TypeCheck::InferExpressions : public Transform {
+    TypeCheck           &self;
+    const IR::V1Program *global = nullptr;
+
+    static bool isResolved(const IR::Node *n) {
+        bool rv = true;
+        forAllMatching<IR::Expression>(n, [&rv](const IR::Expression *e) {
+            if (!e->type || e->type->is<IR::Type::Unknown>() || e->type->is<IR::Type_InfInt>())
+                rv = false; });
+        return rv; }
+    profile_t init_apply(const IR::Node *root) override {
+        global = root->to<IR::V1Program>();
+        return Transform::init_apply(root); }
+    const IR::Node *preorder(IR::V1Program *glob) override { return glob; }
+    const IR::Node *preorder(IR::Node *n) override {
+        prune();
+        auto orig = getOriginal();
+        if (self.resolvedDecls.count(orig))
+            return n;
+        InferExpressionsBottomUp bottomUp;
+        InferExpressionsTopDown topDown(global);
+        auto rv = orig->apply(bottomUp)->apply(topDown);
+        if (isResolved(rv))
+            self.resolvedDecls.insert(rv);
+        return rv; }
+
+ public:
+    explicit InferExpressions(TypeCheck &s) : self(s) { setName("InferExpressions"); }
+};
+
 class TypeCheck::InferActionArgsBottomUp : public Inspector {
     TypeCheck           &self;
     const IR::V1Program *global = nullptr;
@@ -532,8 +571,7 @@ class TypeCheck::MakeImplicitCastsExplicit : public Transform, P4WriteContext {
 TypeCheck::TypeCheck() : PassManager({
     new AssignInitialTypes,
     (new PassRepeated({
-        new InferExpressionsBottomUp,
-        new InferExpressionsTopDown,
+        new InferExpressions(*this),
         new InferActionArgsBottomUp(*this),
         new InferActionArgsTopDown(*this),
         new AssignActionArgTypes(*this)
@@ -543,6 +581,7 @@ TypeCheck::TypeCheck() : PassManager({
 
 const IR::Node *TypeCheck::apply_visitor(const IR::Node *n, const char *name) {
     LOG5("Before Typecheck:\n" << dumpToString(n));
+    resolvedDecls.clear();
     auto *rv = PassManager::apply_visitor(n, name);
     LOG5("After Typecheck:\n" << dumpToString(rv));
     return rv;
@@ -23,9 +23,12 @@ limitations under the License.
 class TypeCheck : public PassManager {
     std::map<const IR::Node *, const IR::Type *>        actionArgUseTypes;
     int                                                 iterCounter = 0;
+    // The declarations in which all the expression types are known
+    std::set<const IR::Node *>                          resolvedDecls;
     class AssignInitialTypes;
     class InferExpressionsBottomUp;
     class InferExpressionsTopDown;
+    class InferExpressions;
     class InferActionArgsBottomUp;
     class InferActionArgsTopDown;
     class AssignActionArgTypes;
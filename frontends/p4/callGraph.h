@@ -18,8 +18,10 @@ limitations under the License.
 #define _FRONTENDS_P4_CALLGRAPH_H_
 
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include "lib/bitvec.h"
 #include "lib/log.h"
 #include "lib/exceptions.h"
 #include "lib/map.h"
@@ -375,6 +377,171 @@ class CallGraph {
     }
 };
 
+/**
+ * An immutable snapshot of a CallGraph for answering many queries.
+ *
+ * The adjacency is kept in compressed sparse rows indexed by the position of each node in
+ * CallGraph::nodes.  The strongly-connected components are computed once with Tarjan's
+ * algorithm, visiting the nodes and edges in the same order as CallGraph::sort, so
+ * sort() produces the same order.  The set of nodes reachable from each component is a
+ * bitvec computed the first time it is needed, from the sets of its successors.
+ *
+ * The snapshot does not follow later changes to the graph it was built from.
+ */
+template <class T>
+class CompactCallGraph {
+    std::vector<T>                  nodes;
+    std::unordered_map<T, unsigned> index;       // of each node in 'nodes'
+    std::vector<unsigned>           edgeStart;   // edges of node n are at edgeStart[n..n+1)
+    std::vector<unsigned>           edges;
+    std::vector<unsigned>           component;   // of each node
+    std::vector<unsigned>           members;     // nodes grouped by component, in sort order
+    std::vector<unsigned>           memberStart;  // of each component, in 'members'
+    std::vector<bool>               cyclic;      // for each component
+    mutable std::vector<bitvec>     reach;       // nodes reachable from each component
+    mutable std::vector<bool>       reachKnown;
+
+    /// Iterative version of CallGraph::strongConnect starting from @root.
+    void strongConnect(unsigned root, std::vector<unsigned> &order,
+                       std::vector<unsigned> &lowlink, std::vector<bool> &onStack,
+                       std::vector<unsigned> &stack, unsigned &crtIndex) {
+        static const unsigned unknown = ~0u;
+        std::vector<std::pair<unsigned, unsigned>> dfs;  // node and its next edge
+        order[root] = lowlink[root] = crtIndex++;
+        stack.push_back(root);
+        onStack[root] = true;
+        dfs.emplace_back(root, edgeStart[root]);
+        while (!dfs.empty()) {
+            unsigned node = dfs.back().first;
+            if (dfs.back().second < edgeStart[node + 1]) {
+                unsigned next = edges[dfs.back().second++];
+                if (order[next] == unknown) {
+                    order[next] = lowlink[next] = crtIndex++;
+                    stack.push_back(next);
+                    onStack[next] = true;
+                    dfs.emplace_back(next, edgeStart[next]);
+                } else if (onStack[next]) {
+                    lowlink[node] = std::min(lowlink[node], lowlink[next]); }
+                continue; }
+
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                unsigned parent = dfs.back().first;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[node]); }
+            if (lowlink[node] != order[node])
+                continue;
+            unsigned comp = memberStart.size();
+            memberStart.push_back(members.size());
+            while (true) {
+                unsigned member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                component[member] = comp;
+                members.push_back(member);
+                if (member == node)
+                    break; }
+            bool loop = members.size() - memberStart.back() > 1;
+            for (unsigned e = edgeStart[node]; !loop && e < edgeStart[node + 1]; e++)
+                loop = edges[e] == node;
+            cyclic.push_back(loop); }
+    }
+
+    unsigned indexOf(T node) const {
+        auto it = index.find(node);
+        BUG_CHECK(it != index.end(), "%1%: Node not in graph", cgMakeString(node));
+        return it->second;
+    }
+
+    /// The nodes reachable from component @comp.  Tarjan's algorithm numbers the
+    /// components of the successors before the component itself, so the components
+    /// reachable from @comp are filled in increasing order.
+    const bitvec &reachableFrom(unsigned comp) const {
+        if (reachKnown[comp])
+            return reach[comp];
+        bitvec pending;
+        std::vector<unsigned> work = { comp };
+        while (!work.empty()) {
+            unsigned c = work.back();
+            work.pop_back();
+            if (reachKnown[c] || pending.getbit(c))
+                continue;
+            pending.setbit(c);
+            for (unsigned m = memberStart[c]; m < memberStart[c + 1]; m++)
+                for (unsigned e = edgeStart[members[m]]; e < edgeStart[members[m] + 1]; e++)
+                    work.push_back(component[edges[e]]); }
+        for (auto c : pending) {
+            auto &r = reach[c];
+            for (unsigned m = memberStart[c]; m < memberStart[c + 1]; m++) {
+                r.setbit(members[m]);
+                for (unsigned e = edgeStart[members[m]]; e < edgeStart[members[m] + 1]; e++) {
+                    unsigned succ = component[edges[e]];
+                    if (succ != unsigned(c))
+                        r |= reach[succ]; } }
+            reachKnown[c] = true; }
+        return reach[comp];
+    }
+
+ public:
+    explicit CompactCallGraph(const CallGraph<T> &graph) {
+        nodes.assign(graph.nodes.begin(), graph.nodes.end());
+        for (unsigned i = 0; i < nodes.size(); i++)
+            index.emplace(nodes[i], i);
+        edgeStart.assign(nodes.size() + 1, 0);
+        for (auto &callees : graph)
+            edgeStart[index.at(callees.first) + 1] = callees.second->size();
+        for (unsigned i = 0; i < nodes.size(); i++)
+            edgeStart[i + 1] += edgeStart[i];
+        edges.resize(edgeStart.back());
+        for (auto &callees : graph) {
+            unsigned e = edgeStart[index.at(callees.first)];
+            for (auto callee : *callees.second)
+                edges[e++] = index.at(callee); }
+
+        std::vector<unsigned> order(nodes.size(), ~0u), lowlink(nodes.size()), stack;
+        std::vector<bool> onStack(nodes.size());
+        unsigned crtIndex = 0;
+        component.resize(nodes.size());
+        for (unsigned n = 0; n < nodes.size(); n++)
+            if (order[n] == ~0u)
+                strongConnect(n, order, lowlink, onStack, stack, crtIndex);
+        memberStart.push_back(members.size());
+        reach.resize(cyclic.size());
+        reachKnown.assign(cyclic.size(), false);
+    }
+
+    size_t size() const { return nodes.size(); }
+    bool contains(T node) const { return index.count(node) != 0; }
+    size_t componentCount() const { return cyclic.size(); }
+    /// True if @a and @b are in the same strongly-connected component.
+    bool sameComponent(T a, T b) const { return component[indexOf(a)] == component[indexOf(b)]; }
+    /// True if @node is on a cycle, including a self-loop.
+    bool inCycle(T node) const { return cyclic[component[indexOf(node)]]; }
+    bool hasCycles() const { return std::find(cyclic.begin(), cyclic.end(), true) != cyclic.end(); }
+    /// True if there is a path, possibly empty, from @from to @to.
+    bool reachable(T from, T to) const {
+        unsigned f = indexOf(from), t = indexOf(to);
+        if (component[f] == component[t])
+            return true;
+        return reachableFrom(component[f]).getbit(t);
+    }
+    /// Same as CallGraph::reachable: @out will contain all nodes reachable from @start.
+    void reachable(T start, std::set<T> &out) const {
+        if (!contains(start)) {
+            out.emplace(start);
+            return; }
+        for (auto n : reachableFrom(component[indexOf(start)]))
+            out.emplace(nodes[n]);
+    }
+    /// Same as CallGraph::sort(out): callees are before their callers, and the nodes of
+    /// each strongly-connected component are consecutive.  @returns true if the graph
+    /// contains a cycle.
+    bool sort(std::vector<T> &out) const {
+        for (auto m : members)
+            out.push_back(nodes[m]);
+        return hasCycles();
+    }
+};
+
 }  // namespace P4
 
 #endif  /* _FRONTENDS_P4_CALLGRAPH_H_ */
@@ -36,6 +36,7 @@ class CheckNamedArgs : public Inspector {
     bool preorder(const IR::Declaration_Instance* call) override
     { return checkArguments(call->arguments); }
     bool preorder(const IR::Parameter* parameter) override;
+    bool canFuse() const override { return true; }
 };
 
 }  // namespace P4
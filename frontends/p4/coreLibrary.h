@@ -108,7 +108,8 @@ class P4CoreLibrary : public ::Model::Model {
             headerTooShort(StandardExceptions::HeaderTooShort) {}
 
  public:
-    static P4CoreLibrary instance;
+    /// created on first use, to keep it out of the startup of the compiler
+    static P4CoreLibrary &instance();
     ::Model::Elem noAction;
 
     ::Model::Elem exactMatch;
@@ -19,6 +19,7 @@ limitations under the License.
 #include "frontends/p4/methodInstance.h"
 #include "frontends/p4/tableApply.h"
 #include "parserCallGraph.h"
+#include "lib/dataflow.h"
 #include "lib/ordered_set.h"
 
 namespace P4 {
@@ -31,7 +32,7 @@ ProgramPoint ProgramPoint::beforeStart;
 
 unsigned StorageLocation::crtid = 0;
 
-StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) const {
+StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) {
     if (type->is<IR::Type_Bits>() ||
         type->is<IR::Type_Boolean>() ||
         type->is<IR::Type_Varbits>() ||
@@ -43,7 +44,7 @@ StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) cons
         type->is<IR::Type_Var>() ||
         // Also for newtype
         type->is<IR::Type_Newtype>())
-        return new BaseLocation(type, name);
+        return new BaseLocation(type, name, baseLocations++);
     if (auto bl = type->to<IR::Type_BaseList>()) {
         // A tuple with no fields is treated like a base location.
         // The other tuples are treated as a collection of their
@@ -54,7 +55,7 @@ StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) cons
         // (although it's not clear what an uninitialized value of
         // type empty tuple could be).
         if (bl->getSize() == 0)
-            return new BaseLocation(type, name);
+            return new BaseLocation(type, name, baseLocations++);
 
         // Tuple and List
         auto result = new TupleLocation(type, name);
@@ -70,7 +71,7 @@ StorageLocation* StorageFactory::create(const IR::Type* type, cstring name) cons
     if (auto st = type->to<IR::Type_StructLike>()) {
         if (st->is<IR::Type_Struct>() && st->fields.size() == 0)
             // See the comment above about empty tuples
-            return new BaseLocation(type, name);
+            return new BaseLocation(type, name, baseLocations++);
         auto result = new StructLocation(type, name);
 
         // For header unions we will model all of the valid fields
@@ -239,6 +240,8 @@ const LocationSet* LocationSet::allElements() const {
 }
 
 const LocationSet* LocationSet::canonicalize() const {
+    if (isCanonical())
+        return this;
     LocationSet* result = new LocationSet();
     for (auto e : locations)
         result->addCanonical(e);
@@ -260,6 +263,11 @@ void LocationSet::addCanonical(const StorageLocation* location) {
 }
 
 bool LocationSet::overlaps(const LocationSet* other) const {
+    if (bases.intersects(other->bases))
+        return true;
+    // A set of base locations can only share base locations with another set
+    if (isCanonical() || other->isCanonical())
+        return false;
     for (auto s : locations) {
         if (other->locations.find(s) != other->locations.end())
             return true;
@@ -305,28 +313,20 @@ bool ProgramPoints::operator==(const ProgramPoints& other) const {
 }
 
 Definitions* Definitions::joinDefinitions(const Definitions* other) const {
-    auto result = new Definitions();
-    for (auto d : other->definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::get(definitions, loc);
-        if (current != nullptr) {
-            auto merged = current->merge(defs);
-            result->definitions.emplace(loc, merged);
-        } else {
-            result->definitions.emplace(loc, defs);
-        }
-    }
-    for (auto d : definitions) {
-        auto loc = d.first;
-        auto defs = d.second;
-        auto current = ::get(other->definitions, loc);
-        if (current == nullptr)
-            result->definitions.emplace(loc, defs);
-        // otherwise have have already done it in the loop above
-    }
-    if (unreachable && other->unreachable)
-        result->setUnreachable();
+    auto result = new Definitions(*this);
+    if (result->definitions.size() < other->definitions.size())
+        result->definitions.resize(other->definitions.size());
+    for (auto i : other->defined) {
+        auto &current = result->definitions[i];
+        auto defs = other->definitions[i].second;
+        if (current.second == nullptr)
+            current = other->definitions[i];
+        else if (current.second != defs)
+            // both branches usually share the points of the locations they do not write
+            current.second = current.second->merge(defs);
+    }
+    result->defined |= other->defined;
+    result->unreachable = unreachable && other->unreachable;
     return result;
 }
 
@@ -334,31 +334,30 @@ void Definitions::setDefinition(const StorageLocation* location, const ProgramPo
     LocationSet locset;
     locset.addCanonical(location);
     for (auto sl : locset)
-        definitions[sl->to<BaseLocation>()] = point;
+        setDefintion(sl->to<BaseLocation>(), point);
 }
 
 void Definitions::setDefinition(const LocationSet* locations, const ProgramPoints* point) {
     for (auto sl : *locations->canonicalize())
-        definitions[sl->to<BaseLocation>()] = point;
+        setDefintion(sl->to<BaseLocation>(), point);
 }
 
 void Definitions::removeLocation(const StorageLocation* location) {
-    auto loc = new LocationSet();
-    loc->addCanonical(location);
-    for (auto sl : *loc) {
+    LocationSet locset;
+    locset.addCanonical(location);
+    for (auto sl : locset) {
         auto bl = sl->to<BaseLocation>();
-        auto it = definitions.find(bl);
-        if (it != definitions.end())
-            definitions.erase(it);
+        if (hasLocation(bl)) {
+            defined.clrbit(bl->index);
+            definitions[bl->index] = Definition(); }
     }
 }
 
 const ProgramPoints* Definitions::getPoints(const LocationSet* locations) const {
-    const ProgramPoints* result = new ProgramPoints();
-    for (auto sl : *locations->canonicalize()) {
-        auto points = getPoints(sl->to<BaseLocation>());
-        result = result->merge(points);
-    }
+    auto result = new ProgramPoints();
+    for (auto sl : *locations->canonicalize())
+        for (auto p : *getPoints(sl->to<BaseLocation>()))
+            result->add(p);
     return result;
 }
 
@@ -373,13 +372,12 @@ Definitions* Definitions::writes(ProgramPoint point, const LocationSet* location
 }
 
 bool Definitions::operator==(const Definitions& other) const {
-    if (definitions.size() != other.definitions.size())
+    if (defined != other.defined)
         return false;
-    for (auto d : definitions) {
-        auto od = ::get(other.definitions, d.first);
-        if (od == nullptr)
-            return false;
-        if (!d.second->operator==(*od))
+    for (auto i : defined) {
+        auto points = definitions[i].second;
+        auto otherPoints = other.definitions[i].second;
+        if (points != otherPoints && !points->operator==(*otherPoints))
             return false;
     }
     return true;
@@ -741,47 +739,57 @@ void ComputeWriteSet::visitVirtualMethods(const IR::IndexedVector<IR::Declaratio
             }}}
 }
 
-// Symbolic execution of the parser
-bool ComputeWriteSet::preorder(const IR::P4Parser* parser) {
-    LOG3("CWS Visiting " << dbp(parser));
-    auto startState = parser->getDeclByName(IR::ParserState::start)->to<IR::ParserState>();
-    auto startPoint = ProgramPoint(startState);
-    enterScope(parser->getApplyParameters(), &parser->parserLocals, startPoint);
-    visitVirtualMethods(parser->parserLocals);
-
-    ParserCallGraph transitions("transitions");
-    ComputeParserCG pcg(storageMap->refMap, &transitions);
-
-    (void)parser->apply(pcg);
-    ordered_set<const IR::ParserState*> toRun;  // worklist
-    toRun.emplace(startState);
+/// The definitions at the entry of each state of a parser.
+class ComputeWriteSet::ParserStates
+        : public Util::ForwardDataflow<const IR::ParserState*, Definitions*> {
+    ComputeWriteSet* parent;
+    ParserCallGraph transitions;
 
-    while (!toRun.empty()) {
-        auto state = *toRun.begin();
-        toRun.erase(state);
+    std::vector<const IR::ParserState*> successors(const IR::ParserState* state) override {
+        if (auto next = transitions.getCallees(state))
+            return *next;
+        return {};
+    }
+    Definitions* transfer(const IR::ParserState* state, Definitions* const &in) override {
         LOG3("Traversing " << dbp(state));
-
         // We need a new visitor to visit the state,
         // but we use the same data structures
         ProgramPoint pt(state);
-        currentDefinitions = allDefinitions->getDefinitions(pt);
-        ComputeWriteSet cws(this, pt, currentDefinitions);
+        parent->allDefinitions->setDefinitionsAt(pt, in, true);
+        ComputeWriteSet cws(parent, pt, in);
         (void)state->apply(cws);
+        return parent->getDefinitionsAfter(state);
+    }
+    bool join(Definitions* &into, Definitions* const &from) override {
+        auto defs = into != nullptr ? into : new Definitions();
+        auto newdefs = defs->joinDefinitions(from);
+        if (into != nullptr && *into == *newdefs)
+            return false;
+        into = newdefs;
+        return true;
+    }
 
-        ProgramPoint sp(state);
-        auto after = getDefinitionsAfter(state);
-        auto next = transitions.getCallees(state);
-        for (auto n : *next) {
-            ProgramPoint pt(n);
-            auto defs = allDefinitions->getDefinitions(pt, true);
-            auto newdefs = defs->joinDefinitions(after);
-            if (!(*defs == *newdefs)) {
-                // Only run once more if there are any changes
-                setDefinitions(newdefs, n, true);
-                toRun.emplace(n);
-            }
-        }
+ public:
+    ParserStates(ComputeWriteSet* parent, const IR::P4Parser* parser) :
+            parent(parent), transitions("transitions") {
+        ComputeParserCG pcg(parent->storageMap->refMap, &transitions);
+        (void)parser->apply(pcg);
     }
+};
+
+// Symbolic execution of the parser
+bool ComputeWriteSet::preorder(const IR::P4Parser* parser) {
+    LOG3("CWS Visiting " << dbp(parser));
+    auto startState = parser->getDeclByName(IR::ParserState::start)->to<IR::ParserState>();
+    auto startPoint = ProgramPoint(startState);
+    enterScope(parser->getApplyParameters(), &parser->parserLocals, startPoint);
+    visitVirtualMethods(parser->parserLocals);
+
+    // The states are visited in reverse postorder, and again only when the
+    // definitions reaching them change.
+    ParserStates states(this, parser);
+    states.solve(startState, allDefinitions->getDefinitions(startPoint));
+    LOG3("CWS Visited " << states.visits() << " states of " << dbp(parser));
     return false;
 }
 
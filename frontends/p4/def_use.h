@@ -17,6 +17,7 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_DEF_USE_H_
 #define _FRONTENDS_P4_DEF_USE_H_
 
+#include "lib/bitvec.h"
 #include "lib/ordered_map.h"
 #include "lib/ordered_set.h"
 #include "ir/ir.h"
@@ -68,8 +69,11 @@ class StorageLocation : public IHasDbPrint {
     It could be either a scalar variable, or a field of a struct, etc. */
 class BaseLocation : public StorageLocation {
  public:
-    BaseLocation(const IR::Type* type, cstring name) :
-            StorageLocation(type, name) {
+    /// Dense number of this location among the base locations created by the same
+    /// StorageFactory; used to represent sets of base locations as bit vectors.
+    const unsigned index;
+    BaseLocation(const IR::Type* type, cstring name, unsigned index) :
+            StorageLocation(type, name), index(index) {
         if (auto tt = type->to<IR::Type_Tuple>())
             BUG_CHECK(tt->getSize() == 0, "%1%: tuples with fields are not base locations", tt);
         else if (auto ts = type->to<IR::Type_StructLike>())
@@ -175,8 +179,12 @@ class ArrayLocation : public IndexedLocation {
 };
 
 class StorageFactory {
+    /// Number of base locations created so far.
+    unsigned baseLocations = 0;
+
  public:
-    StorageLocation* create(const IR::Type* type, cstring name) const;
+    StorageLocation* create(const IR::Type* type, cstring name);
+    unsigned baseLocationCount() const { return baseLocations; }
 
     static const cstring validFieldName;
     static const cstring indexFieldName;
@@ -184,14 +192,18 @@ class StorageFactory {
 
 /// A set of locations that may be read or written by a computation.
 /// In general this is a conservative approximation of the actual location set.
+/// Sets are only compared with sets of locations from the same StorageFactory.
 class LocationSet : public IHasDbPrint {
     ordered_set<const StorageLocation*> locations;
+    /// The BaseLocation::index of the base locations in the set.
+    bitvec bases;
 
  public:
     LocationSet() = default;
-    explicit LocationSet(const ordered_set<const StorageLocation*> &other) : locations(other) {}
-    explicit LocationSet(const StorageLocation* location)
-    { CHECK_NULL(location); locations.emplace(location); }
+    explicit LocationSet(const ordered_set<const StorageLocation*> &other) {
+        for (auto l : other)
+            add(l); }
+    explicit LocationSet(const StorageLocation* location) { add(location); }
     static const LocationSet* empty;
 
     const LocationSet* getField(cstring field) const;
@@ -200,8 +212,11 @@ class LocationSet : public IHasDbPrint {
     const LocationSet* allElements() const;
     const LocationSet* getArrayLastIndex() const;
 
-    void add(const StorageLocation* location)
-    { CHECK_NULL(location); locations.emplace(location); }
+    void add(const StorageLocation* location) {
+        CHECK_NULL(location);
+        if (locations.emplace(location).second)
+            if (auto bl = location->to<BaseLocation>())
+                bases.setbit(bl->index); }
     const LocationSet* join(const LocationSet* other) const;
     /// @returns this location set expressed only in terms of BaseLocation;
     /// e.g., a StructLocation is expanded in all its fields.
@@ -220,6 +235,8 @@ class LocationSet : public IHasDbPrint {
     // only defined for canonical representations
     bool overlaps(const LocationSet* other) const;
     bool isEmpty() const { return locations.empty(); }
+    /// True if the set only contains BaseLocations.
+    bool isCanonical() const { return locations.size() == size_t(bases.popcount()); }
 };
 
 /// Maps a declaration to its associated storage.
@@ -353,50 +370,57 @@ class ProgramPoints : public IHasDbPrint {
 
 /// List of definers for each base storage (at a specific program point).
 class Definitions : public IHasDbPrint {
+    typedef std::pair<const BaseLocation*, const ProgramPoints*> Definition;
     /// Set of program points that have written last to each location
-    /// (conservative approximation).
-    ordered_map<const BaseLocation*, const ProgramPoints*> definitions;
+    /// (conservative approximation), indexed by BaseLocation::index.
+    std::vector<Definition> definitions;
+    /// The indices of the locations in 'definitions' that have program points.
+    bitvec defined;
     /// If true the current program point is actually unreachable.
-    bool unreachable;
+    bool unreachable = false;
 
  public:
     Definitions() = default;
     Definitions(const Definitions& other) :
-            definitions(other.definitions), unreachable(other.unreachable) {}
+            definitions(other.definitions), defined(other.defined),
+            unreachable(other.unreachable) {}
     Definitions* joinDefinitions(const Definitions* other) const;
     /// Point writes the specified LocationSet.
     Definitions* writes(ProgramPoint point, const LocationSet* locations) const;
-    void setDefintion(const BaseLocation* loc, const ProgramPoints* point)
-    { CHECK_NULL(loc); CHECK_NULL(point); definitions[loc] = point; }
+    void setDefintion(const BaseLocation* loc, const ProgramPoints* point) {
+        CHECK_NULL(loc); CHECK_NULL(point);
+        if (definitions.size() <= loc->index)
+            definitions.resize(loc->index + 1);
+        definitions[loc->index] = Definition(loc, point);
+        defined.setbit(loc->index); }
     void setDefinition(const StorageLocation* loc, const ProgramPoints* point);
     void setDefinition(const LocationSet* loc, const ProgramPoints* point);
     Definitions* setUnreachable() { unreachable = true; return this; }
     bool isUnreachable() const { return unreachable; }
     bool hasLocation(const BaseLocation* location) const
-    { return definitions.find(location) != definitions.end(); }
+    { return defined.getbit(location->index); }
     const ProgramPoints* getPoints(const BaseLocation* location) const {
-        auto r = ::get(definitions, location);
-        BUG_CHECK(r != nullptr, "no definitions found for %1%", location);
-        return r; }
+        BUG_CHECK(hasLocation(location), "no definitions found for %1%", location);
+        return definitions[location->index].second; }
     const ProgramPoints* getPoints(const LocationSet* locations) const;
     bool operator==(const Definitions& other) const;
     void dbprint(std::ostream& out) const override {
         if (unreachable) {
             out << "  Unreachable" << IndentCtl::endl;
         }
-        if (definitions.empty())
+        if (empty())
             out << "  Empty definitions";
         bool first = true;
-        for (auto d : definitions) {
+        for (auto i : defined) {
             if (!first)
                 out << IndentCtl::endl;
-            out << "  " << *d.first << "=>" << *d.second;
+            out << "  " << *definitions[i].first << "=>" << *definitions[i].second;
             first = false;
         }
     }
     Definitions* cloneDefinitions() const { return new Definitions(*this); }
     void removeLocation(const StorageLocation* loc);
-    bool empty() const { return definitions.empty(); }
+    bool empty() const { return defined.empty(); }
 };
 
 class AllDefinitions : public IHasDbPrint {
@@ -464,6 +488,8 @@ class ComputeWriteSet : public Inspector, public IHasDbPrint {
     ordered_map<const IR::Expression*, const LocationSet*> writes;
     bool                virtualMethod;  /// True if we are analyzing a virtual method
 
+    class ParserStates;
+
     /// Creates new visitor, but with same underlying data structures.
     /// Needed to visit some program fragments repeatedly.
     ComputeWriteSet(const ComputeWriteSet* source, ProgramPoint context, Definitions* definitions) :
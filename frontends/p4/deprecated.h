@@ -36,6 +36,7 @@ class CheckDeprecated : public Inspector {
 
     bool preorder(const IR::PathExpression* path) override;
     bool preorder(const IR::Type_Name* name) override;
+    bool canFuse() const override { return true; }
 };
 
 class Deprecated : public PassManager {
@@ -80,7 +80,13 @@ const IR::CompileTimeValue* Evaluator::getValue(const IR::Node* node) const {
 ////////////////////////////// visitor methods ////////////////////////////////////
 
 bool Evaluator::preorder(const IR::P4Program* program) {
+    if (program == evaluated && refMap->checkMap(program) && typeMap->checkMap(program)) {
+        LOG2("Reusing the blocks of " << dbp(program));
+        return false;
+    }
     LOG2("Evaluating " << dbp(program));
+    auto errors = ::errorCount();
+    evaluated = nullptr;
     toplevelBlock = new IR::ToplevelBlock(program->srcInfo, program);
 
     pushBlock(toplevelBlock);
@@ -91,6 +97,8 @@ bool Evaluator::preorder(const IR::P4Program* program) {
         visit(d);
     }
     popBlock(toplevelBlock);
+    if (::errorCount() == errors)
+        evaluated = program;
     std::stringstream str;
     toplevelBlock->dbprint_recursive(str);
     LOG2(str.str());
@@ -33,6 +33,10 @@ class Evaluator final : public Inspector, public IHasBlock {
     const TypeMap*           typeMap;
     std::vector<IR::Block*>  blockStack;
     IR::ToplevelBlock*       toplevelBlock;
+    /// Program for which toplevelBlock was computed without errors.  The IR
+    /// is immutable, so the blocks are reused when the same program is
+    /// evaluated again with maps that are still up-to-date.
+    const IR::P4Program*     evaluated = nullptr;
 
  protected:
     void pushBlock(IR::Block* block);
@@ -37,7 +37,7 @@ limitations under the License.
 namespace P4V1 {
 
 ProgramStructure::ProgramStructure() :
-        v1model(P4V1::V1Model::instance), p4lib(P4::P4CoreLibrary::instance),
+        v1model(P4V1::V1Model::instance()), p4lib(P4::P4CoreLibrary::instance()),
         types(&allNames), metadata(&allNames), headers(&allNames), stacks(&allNames),
         controls(&allNames), parserStates(&allNames), tables(&allNames),
         actions(&allNames), counters(&allNames), registers(&allNames), meters(&allNames),
@@ -611,7 +611,7 @@ void ProgramStructure::loadModel() {
     // This includes in turn core.p4
     std::stringstream versionArg;
     versionArg << "-DV1MODEL_VERSION=" << V1Model::versionCurrent;
-    include(V1Model::instance.file.name, versionArg.str());
+    include(V1Model::instance().file.name, versionArg.str());
 
     metadataInstances.insert(v1model.standardMetadataType.name);
     metadataTypes.insert(v1model.standardMetadataType.name);
@@ -959,12 +959,9 @@ ProgramStructure::convertTable(const IR::V1Table* table, cstring newName,
         } else {
             // Since no default action arguments are added in the p4 program we
             // add zero initialized arguments
-            for (auto a : actions) {
-                if (a.second == table->default_action.name) {
-                    for (auto aa : a.first->args) {
-                        args->push_back(new IR::Argument(aa->name, new IR::Constant(0)));
-                    }
-                    break;
+            if (auto action = actions.getByNewName(table->default_action.name)) {
+                for (auto aa : action->args) {
+                    args->push_back(new IR::Argument(aa->name, new IR::Constant(0)));
                 }
             }
         }
@@ -2080,6 +2077,7 @@ ProgramStructure::convertControl(const IR::V1Control* control, cstring newName)
 
     std::vector<const IR::V1Table*> usedTables;
     tablesReferred(control, usedTables);
+    std::set<const IR::V1Table*> isUsedTable(usedTables.begin(), usedTables.end());
     for (auto t : usedTables) {
         for (auto a : t->actions)
             actionsInTables.push_back(a.name);
@@ -2109,7 +2107,7 @@ ProgramStructure::convertControl(const IR::V1Control* control, cstring newName)
                 ::error(ErrorType::ERR_NOT_FOUND, "Cannot locate table %1%", c.first->table.name);
                 return nullptr;
             }
-            if (std::find(usedTables.begin(), usedTables.end(), tbl) != usedTables.end()) {
+            if (isUsedTable.count(tbl)) {
                 auto extcounter = convertDirectCounter(c.first, c.second);
                 if (extcounter != nullptr) {
                     locals.push_back(extcounter);
@@ -2138,7 +2136,7 @@ ProgramStructure::convertControl(const IR::V1Control* control, cstring newName)
                 ::error(ErrorType::ERR_NOT_FOUND, "Cannot locate table %1%", m.first->table.name);
                 return nullptr;
             }
-            if (std::find(usedTables.begin(), usedTables.end(), tbl) != usedTables.end()) {
+            if (isUsedTable.count(tbl)) {
                 auto meter = meters.get(m.second);
                 auto extmeter = convertDirectMeter(meter, m.second);
                 if (extmeter != nullptr) {
@@ -2544,14 +2542,20 @@ void
 ProgramStructure::tablesReferred(const IR::V1Control* control,
                                  std::vector<const IR::V1Table*> &out) {
     LOG3("Inspecting " << control->name);
-    for (auto it : tableMapping) {
-        if (it.second == control)
-            out.push_back(it.first);
-    }
-    // sort alphabetically to have a deterministic order
-    std::sort(out.begin(), out.end(),
-              [](const IR::V1Table* left, const IR::V1Table* right) {
-                  return left->name.name < right->name.name; });
+    if (indexedTables != tableMapping.size() || indexedTables == 0) {
+        controlTables.clear();
+        for (auto it : tableMapping)
+            controlTables[it.second].push_back(it.first);
+        // sort alphabetically to have a deterministic order
+        for (auto &it : controlTables)
+            std::sort(it.second.begin(), it.second.end(),
+                      [](const IR::V1Table* left, const IR::V1Table* right) {
+                          return left->name.name < right->name.name; });
+        indexedTables = tableMapping.size();
+    }
+    auto it = controlTables.find(control);
+    if (it != controlTables.end())
+        out.insert(out.end(), it->second.begin(), it->second.end());
 }
 
 void ProgramStructure::populateOutputNames() {
@@ -18,6 +18,8 @@ limitations under the License.
 #define _FRONTENDS_P4_FROMV1_0_PROGRAMSTRUCTURE_H_
 
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "lib/map.h"
@@ -50,17 +52,20 @@ class ProgramStructure {
     class NamedObjectInfo {
         // If allNames is nullptr we don't check for duplicate names
         std::unordered_set<cstring> *allNames;
+        // nameToObject gives the iteration order; the hashed maps are used for lookups
         std::map<cstring, T> nameToObject;
-        std::map<T, cstring> objectToNewName;
+        std::unordered_map<cstring, T> nameIndex;
+        std::unordered_map<cstring, T> newNameIndex;
+        std::unordered_map<T, cstring> objectToNewName;
 
         // Iterate in order of name, but return pair<T, newname>
         class iterator {
             friend class NamedObjectInfo;
          private:
             typename std::map<cstring, T>::iterator it;
-            typename std::map<T, cstring> &objToName;
+            typename std::unordered_map<T, cstring> &objToName;
             iterator(typename std::map<cstring, T>::iterator it,
-                     typename std::map<T, cstring> &objToName) :
+                     typename std::unordered_map<T, cstring> &objToName) :
                     it(it), objToName(objToName) {}
          public:
             const iterator& operator++() { ++it; return *this; }
@@ -80,6 +85,7 @@ class ProgramStructure {
             }
 
             nameToObject.emplace(obj->name, obj);
+            nameIndex.emplace(obj->name, obj);
             cstring newName;
 
             if (allNames == nullptr ||
@@ -92,21 +98,34 @@ class ProgramStructure {
                 allNames->emplace(newName);
             LOG3("Discovered " << obj << " named " << newName);
             objectToNewName.emplace(obj, newName);
+            newNameIndex.emplace(newName, obj);
         }
         /// Lookup using the original name
-        T get(cstring name) const { return ::get(nameToObject, name); }
+        T get(cstring name) const {
+            auto it = nameIndex.find(name);
+            return it == nameIndex.end() ? nullptr : it->second; }
         /// Get the new name
-        cstring get(T object) const { return ::get(objectToNewName, object, object->name.name); }
+        cstring get(T object) const {
+            auto it = objectToNewName.find(object);
+            return it == objectToNewName.end() ? object->name.name : it->second; }
         /// Get the new name from the old name
         cstring newname(cstring name) const { return get(get(name)); }
-        bool contains(cstring name) const { return nameToObject.find(name) != nameToObject.end(); }
+        /// Lookup using the new name
+        T getByNewName(cstring newName) const {
+            auto it = newNameIndex.find(newName);
+            return it == newNameIndex.end() ? nullptr : it->second; }
+        bool contains(cstring name) const { return nameIndex.find(name) != nameIndex.end(); }
         iterator begin() { return iterator(nameToObject.begin(), objectToNewName); }
         iterator end() { return iterator(nameToObject.end(), objectToNewName); }
         void erase(cstring name) {
             allNames->erase(name);
             auto obj = get(name);
-            objectToNewName.erase(obj);
+            auto it = objectToNewName.find(obj);
+            if (it != objectToNewName.end()) {
+                newNameIndex.erase(it->second);
+                objectToNewName.erase(it); }
             nameToObject.erase(name);
+            nameIndex.erase(name);
         }
     };
 
@@ -156,6 +175,10 @@ class ProgramStructure {
     std::map<cstring, const IR::Declaration_Instance*> counterMap;
 
     std::map<const IR::V1Table*, const IR::V1Control*> tableMapping;
+    /// The tables of tableMapping grouped by control, each group sorted by
+    /// name; rebuilt by tablesReferred when tables were added.
+    std::map<const IR::V1Control*, std::vector<const IR::V1Table*>> controlTables;
+    size_t indexedTables = 0;
     std::map<const IR::V1Table*, const IR::Apply*> tableInvocation;
     /// Some types are transformed during conversion; this maps the
     /// original P4-14 header type name to the final P4-16
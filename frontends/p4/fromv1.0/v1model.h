@@ -34,7 +34,7 @@ struct Parser_Model : public ::Model::Elem {
     Parser_Model(Model::Type_Model headersType, Model::Type_Model userMetaType,
                  Model::Type_Model standardMetadataType) :
             Model::Elem("ParserImpl"),
-            packetParam("packet", P4::P4CoreLibrary::instance.packetIn, 0),
+            packetParam("packet", P4::P4CoreLibrary::instance().packetIn, 0),
             headersParam("hdr", headersType, 1),
             metadataParam("meta", userMetaType, 2),
             standardMetadataParam("standard_metadata", standardMetadataType, 3)
@@ -48,7 +48,7 @@ struct Parser_Model : public ::Model::Elem {
 struct Deparser_Model : public ::Model::Elem {
     explicit Deparser_Model(Model::Type_Model headersType) :
             Model::Elem("DeparserImpl"),
-            packetParam("packet", P4::P4CoreLibrary::instance.packetOut, 0),
+            packetParam("packet", P4::P4CoreLibrary::instance().packetOut, 0),
             headersParam("hdr", headersType, 1)
     {}
     ::Model::Param_Model packetParam;
@@ -306,7 +306,8 @@ class V1Model : public ::Model::Model {
     const DirectMeter_Model   directMeter;
     const DirectCounter_Model directCounter;
 
-    static V1Model instance;
+    /// created on first use, to keep it out of the startup of the compiler
+    static V1Model &instance();
     // The following match constants appearing in v1model.p4
     static const char* versionInitial;  // 20180101
     static const char* versionCurrent;  // 20200408
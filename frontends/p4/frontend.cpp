@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "ir/ir.h"
 #include "../common/options.h"
+#include "frontends/common/frontendCache.h"
 #include "lib/nullstream.h"
 #include "lib/path.h"
 #include "frontend.h"
@@ -125,6 +126,10 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
                                    bool skipSideEffectOrdering, std::ostream* outStream) {
     if (program == nullptr && options.listFrontendPasses == 0)
         return nullptr;
+    if (FrontEndCache::isCached(program)) {
+        LOG1("Front end output loaded from the cache");
+        return program;
+    }
 
     bool isv1 = options.isv1();
     ReferenceMap  refMap;
@@ -149,7 +154,9 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
         // into instantiations followed by application
         new InstantiateDirectCalls(&refMap),
         new ResolveReferences(&refMap),  // check shadowing
-        new Deprecated(&refMap),
+        // the references resolved above are all CheckDeprecated needs, so it can share
+        // a traversal with CheckNamedArgs
+        new CheckDeprecated(&refMap),
         new CheckNamedArgs(),
         // Type checking and type inference.  Also inserts
         // explicit casts where implicit casts exist.
@@ -230,6 +237,8 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
     passes.setStopOnError(true);
     passes.addDebugHooks(hooks, true);
     const IR::P4Program* result = program->apply(passes);
+    if (!skipSideEffectOrdering)
+        FrontEndCache::store(program, result);
     return result;
 }
 
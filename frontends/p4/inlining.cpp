@@ -202,7 +202,7 @@ class ComputeNewNames : public Inspector {
             // Do not change the external name of objects starting with a leading dot
             extName = name;
         else
-            extName = prefix + "." + name;
+            extName = cstring::concat(prefix, '.', name);
         cstring baseName = extName.replace('.', '_');
         cstring newName = refMap->newName(baseName);
         renameMap->setNewName(decl, newName, extName);
@@ -348,6 +348,7 @@ void InlineList::analyze() {
             continue;
         }
         cg.calls(inl->caller, inl->callee);
+        inlined++;
     }
 
     // must inline from leaves up
@@ -394,11 +395,13 @@ void DiscoverInlining::postorder(const IR::MethodCallStatement* statement) {
         !am->applyObject->is<IR::Type_Parser>())
         return;
     auto instantiation = am->object->to<IR::Declaration_Instance>();
-    if (instantiation != nullptr)
+    if (instantiation != nullptr) {
         inlineList->addInvocation(instantiation, statement);
-    else
+    } else {
         BUG_CHECK(am->object->is<IR::Parameter>(),
                   "%1% expected a constructor parameter", am->object);
+        inlineList->addDeferredInvocation(statement);
+    }
 }
 
 void DiscoverInlining::visit_all(const IR::Block* block) {
@@ -709,7 +712,7 @@ class ComputeNewStateNames : public Inspector {
         } else if (state->name.name == IR::ParserState::accept) {
             newName = acceptName;
         } else {
-            cstring base = prefix + "_" + state->name.name;
+            cstring base = cstring::concat(prefix, '_', state->name.name);
             newName = refMap->newName(base);
         }
         stateRenameMap->emplace(state->name.name, newName);
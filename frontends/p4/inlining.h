@@ -313,6 +313,10 @@ class InlineList {
     ordered_map<const IR::Declaration_Instance*, CallInfo*> inlineMap;
     std::vector<CallInfo*> toInline;  // sorted in order of inlining
     const bool allowMultipleCalls = true;
+    /// Number of calls found by analyze().
+    size_t inlined = 0;
+    /// Number of invocations of instances that are constructor parameters.
+    unsigned deferred = 0;
 
  public:
     void addInstantiation(const IR::IContainer* caller, const IR::IContainer* callee,
@@ -326,6 +330,12 @@ class InlineList {
     size_t size() const {
         return inlineMap.size();
     }
+    void clear() {
+        inlineMap.clear();
+        toInline.clear();
+        inlined = 0;
+        deferred = 0;
+    }
 
     void addInvocation(const IR::Declaration_Instance* instance,
                        const IR::MethodCallStatement* statement) {
@@ -335,6 +345,15 @@ class InlineList {
         BUG_CHECK(info, "Could not locate instance %1% invoked by %2%", instance, statement);
         info->addInvocation(statement);
     }
+    /// An invocation of an instance passed as a constructor argument; it can be inlined
+    /// only once the container invoking it is inlined into the one supplying the instance.
+    void addDeferredInvocation(const IR::MethodCallStatement* statement) {
+        CHECK_NULL(statement);
+        LOG3("Deferred invocation " << dbp(statement));
+        deferred++;
+    }
+    /// True if inlining the calls found may expose more calls to inline.
+    bool needsAnotherRound() const { return inlined != 0 && deferred != 0; }
 
     void replace(const IR::IContainer* container, const IR::IContainer* replacement) {
         CHECK_NULL(container); CHECK_NULL(replacement);
@@ -373,6 +392,7 @@ class DiscoverInlining : public Inspector {
     Visitor::profile_t init_apply(const IR::Node* node) override {
         toplevel = evaluator->getToplevelBlock();
         CHECK_NULL(toplevel);
+        inlineList->clear();
         return Inspector::init_apply(node); }
     void visit_all(const IR::Block* block);
     bool preorder(const IR::Block* block) override
@@ -429,24 +449,32 @@ class InlinePass : public PassManager {
         new InlineDriver<InlineList, InlineSummary>(&toInline, new GeneralInliner(refMap->isV1(),
             optimizeParserInlining)),
         new RemoveAllUnusedDeclarations(refMap) }) { setName("InlinePass"); }
+    /// True if the last run inlined calls that invoke constructor parameters.
+    bool needsAnotherRound() const { return toInline.needsAnotherRound(); }
 };
 
 /**
 Performs inlining as many times as necessary.  Most frequently once
 will be enough.  Multiple iterations are necessary only when instances are
-passed as arguments using constructor arguments.
+passed as arguments using constructor arguments; otherwise every call is
+inlined, bottom-up along the call graph, by the first round, and we stop
+without running the cleanup and the evaluator once more.
 */
-class Inline : public PassRepeated {
+class Inline : public PassRepeatUntil {
     static std::set<cstring> noPropagateAnnotations;
+    InlinePass* inlinePass;
 
  public:
     Inline(ReferenceMap* refMap, TypeMap* typeMap, EvaluatorPass* evaluator,
             bool optimizeParserInlining)
-    : PassManager({
-        new InlinePass(refMap, typeMap, evaluator, optimizeParserInlining),
+    : PassRepeatUntil([this]() {
+        return ::errorCount() > 0 || !inlinePass->needsAnotherRound(); }),
+      inlinePass(new InlinePass(refMap, typeMap, evaluator, optimizeParserInlining)) {
+        passes.push_back(inlinePass);
         // After inlining the output of the evaluator changes, so
         // we have to run it again
-        evaluator }) { setName("Inline"); }
+        passes.push_back(evaluator);
+        setName("Inline"); }
 
     /// Do not propagate annotation \p name during inlining
     static void setAnnotationNoPropagate(cstring name) {
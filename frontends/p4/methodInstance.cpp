@@ -16,15 +16,89 @@ limitations under the License.
 
 #include "methodInstance.h"
 #include "ir/ir.h"
+#include "lib/gc.h"
+#include "lib/hash.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 
 namespace P4 {
 
-// If useExpressionType is true trust the type in mce->type
+namespace {
+
+/**
+ * A direct-mapped memo of MethodInstance::resolve.  The refMap and typeMap only grow
+ * between clears, so a result stays valid for as long as the generations of both maps
+ * are the same; the generations are never reused, so they also tell the maps apart.
+ * Calls are keyed by the unique id of the node rather than by its address, which the
+ * garbage collector may reuse.  Each thread has its own cache, in memory the collector
+ * scans, so the instances it remembers stay alive.
+ */
+class ResolveCache {
+    struct Entry {
+        int             id = -1;
+        uint64_t        refMap = 0;
+        uint64_t        typeMap = 0;
+        bool            useExpressionType = false;
+        bool            incomplete = false;
+        MethodInstance  *result = nullptr;
+    };
+    static constexpr size_t entries = 4096;
+    Entry table[entries];
+
+ public:
+    static ResolveCache& get() {
+        static thread_local ResolveCache *cache = nullptr;
+        if (!cache) cache = new(gc_alloc_root(sizeof(ResolveCache))) ResolveCache;
+        return *cache;
+    }
+    Entry& slot(int id, uint64_t refMap, uint64_t typeMap) {
+        return table[Util::Hash::hash_values(id, refMap, typeMap) % entries];
+    }
+    MethodInstance* lookup(const IR::MethodCallExpression* mce, uint64_t refMap,
+                           uint64_t typeMap, bool useExpressionType, bool incomplete) {
+        auto& e = slot(mce->id, refMap, typeMap);
+        if (e.id != mce->id || e.refMap != refMap || e.typeMap != typeMap ||
+            e.useExpressionType != useExpressionType || e.incomplete != incomplete)
+            return nullptr;
+        return e.result;
+    }
+    void store(const IR::MethodCallExpression* mce, uint64_t refMap, uint64_t typeMap,
+               bool useExpressionType, bool incomplete, MethodInstance* result) {
+        auto& e = slot(mce->id, refMap, typeMap);
+        e = Entry{mce->id, refMap, typeMap, useExpressionType, incomplete, result};
+    }
+};
+
+constexpr size_t ResolveCache::entries;
+
+}  // namespace
+
 MethodInstance*
 MethodInstance::resolve(const IR::MethodCallExpression* mce, DeclarationLookup* refMap,
                         TypeMap* typeMap, bool useExpressionType, const Visitor::Context *ctxt,
                         bool incomplete) {
+    // only maps that say when they change can be remembered
+    auto refs = dynamic_cast<const ProgramMap*>(refMap);
+    if (refs == nullptr)
+        return resolveUncached(mce, refMap, typeMap, useExpressionType, ctxt, incomplete);
+    uint64_t refGeneration = refs->getGeneration();
+    uint64_t typeGeneration = typeMap ? typeMap->getGeneration() : 0;
+    auto& cache = ResolveCache::get();
+    if (auto result = cache.lookup(mce, refGeneration, typeGeneration,
+                                   useExpressionType, incomplete))
+        return result;
+    auto result = resolveUncached(mce, refMap, typeMap, useExpressionType, ctxt, incomplete);
+    // resolving may have cleared a map, in which case the result is not remembered
+    if (refs->getGeneration() == refGeneration &&
+        (typeMap ? typeMap->getGeneration() : 0) == typeGeneration)
+        cache.store(mce, refGeneration, typeGeneration, useExpressionType, incomplete, result);
+    return result;
+}
+
+// If useExpressionType is true trust the type in mce->type
+MethodInstance*
+MethodInstance::resolveUncached(const IR::MethodCallExpression* mce, DeclarationLookup* refMap,
+                                TypeMap* typeMap, bool useExpressionType,
+                                const Visitor::Context *ctxt, bool incomplete) {
     auto mt = typeMap ? typeMap->getType(mce->method) : nullptr;
     if (mt == nullptr && useExpressionType)
         mt = mce->method->type;
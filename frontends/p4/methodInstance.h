@@ -84,11 +84,22 @@ class MethodInstance : public InstanceBase {
     const IR::Type_MethodBase* actualMethodType;
     virtual bool isApply() const { return false; }
 
+ private:
+    static MethodInstance* resolveUncached(const IR::MethodCallExpression* mce,
+                                           DeclarationLookup* refMap, TypeMap* typeMap,
+                                           bool useExpressionType, const Visitor::Context *ctxt,
+                                           bool incomplete);
+
+ public:
     /** @param useExpressionType If true, the typeMap can be nullptr,
      *   and then mce->type is used.  For some technical reasons
      *   neither the refMap or the typeMap are const here.
      *  @param incomplete        If true we do not expect to have
      *                           all type arguments.
+     *
+     * The result is remembered until either map is cleared, so resolving the
+     * same call again with the same maps returns the same instance, which
+     * must not be modified.
      */
     static MethodInstance* resolve(const IR::MethodCallExpression* mce,
                                    DeclarationLookup* refMap, TypeMap* typeMap,
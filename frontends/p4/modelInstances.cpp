@@ -16,18 +16,25 @@ limitations under the License.
 
 #include "coreLibrary.h"
 #include "fromv1.0/v1model.h"
+#include "lib/startup_profile.h"
 
 namespace P4 {
 
-P4CoreLibrary P4CoreLibrary::instance;
+P4CoreLibrary &P4CoreLibrary::instance() {
+    static P4CoreLibrary *rv = Util::StartupProfile::time("P4CoreLibrary", [] {
+        return new P4CoreLibrary; });
+    return *rv;
+}
 
 }  // namespace P4
 
-/* These must be in the same compilation unit to ensure that P4CoreLibrary::instance
- * is initialized before V1Model::instance */
 namespace P4V1 {
 
-V1Model V1Model::instance;
+V1Model &V1Model::instance() {
+    static V1Model *rv = Util::StartupProfile::time("V1Model", [] { return new V1Model; });
+    return *rv;
+}
+
 const char* V1Model::versionInitial = "20180101";
 const char* V1Model::versionCurrent = "20200408";
 
@@ -27,12 +27,20 @@ namespace P4 {
 This inspector detects whether an IR tree contains
 'return' or 'exit' statements.
 It sets a boolean flag for each of them.
+The cases of a switch statement may be visited on separate threads.
 */
 class HasExits : public Inspector {
  public:
     bool hasExits;
     bool hasReturns;
-    HasExits() : hasExits(false), hasReturns(false) { setName("HasExits"); }
+    HasExits() : hasExits(false), hasReturns(false)
+    { setName("HasExits"); threadedParallelVisit = true; }
+    HasExits* clone() const override { return new HasExits(*this); }
+    void flow_merge(Visitor& other) override {
+        auto& he = dynamic_cast<HasExits&>(other);
+        hasExits |= he.hasExits;
+        hasReturns |= he.hasReturns;
+    }
 
     void postorder(const IR::ExitStatement*) override
     { hasExits = true; }
@@ -630,9 +630,23 @@ const IR::Node* DoSimplifyExpressions::postorder(IR::ParserState* state) {
     return state;
 }
 
+const IR::Node* DoSimplifyExpressions::skipSimplified(IR::Statement* statement) {
+    if (simplified != nullptr &&
+        simplified->find(getOriginal<IR::Statement>()) != simplified->end())
+        prune();
+    return statement;
+}
+
+const IR::Node* DoSimplifyExpressions::unchanged(IR::Statement* statement) {
+    auto orig = getOriginal<IR::Statement>();
+    if (simplified != nullptr && *statement == *orig)
+        simplified->emplace(orig);
+    return statement;
+}
+
 const IR::Node* DoSimplifyExpressions::postorder(IR::AssignmentStatement* statement) {
     if (statements.empty())
-        return statement;
+        return unchanged(statement);
     statements.push_back(statement);
     auto block = new IR::BlockStatement(statements);
     statements.clear();
@@ -642,7 +656,7 @@ const IR::Node* DoSimplifyExpressions::postorder(IR::AssignmentStatement* statem
 const IR::Node* DoSimplifyExpressions::postorder(IR::MethodCallStatement* statement) {
     if (statements.empty()) {
         BUG_CHECK(statement->methodCall, "NULL methodCall?");
-        return statement; }
+        return unchanged(statement); }
     if (statement->methodCall)
         statements.push_back(statement);
     if (statements.size() == 1) {
@@ -656,7 +670,7 @@ const IR::Node* DoSimplifyExpressions::postorder(IR::MethodCallStatement* statem
 
 const IR::Node* DoSimplifyExpressions::postorder(IR::ReturnStatement* statement) {
     if (statements.empty())
-        return statement;
+        return unchanged(statement);
     statements.push_back(statement);
     auto block = new IR::BlockStatement(statements);
     statements.clear();
@@ -699,14 +713,22 @@ const IR::Node* KeySideEffect::preorder(IR::Key* key) {
     // If any key field has side effects then pull out all
     // the key field values.
     LOG3("Visiting " << key);
+    auto orig = getOriginal<IR::Key>();
+    if (simpleKeys != nullptr && simpleKeys->find(orig) != simpleKeys->end()) {
+        prune();
+        return key;
+    }
     bool complex = false;
     for (auto k : key->keyElements)
         complex = complex || P4::SideEffects::check(k->expression, refMap, typeMap);
-    if (!complex)
+    if (!complex) {
         // This prune will prevent the postoder(IR::KeyElement*) below from executing
         prune();
-    else
+        if (simpleKeys != nullptr)
+            simpleKeys->emplace(orig);
+    } else {
         LOG3("Will pull out " << key);
+    }
     return key;
 }
 
@@ -766,6 +788,8 @@ const IR::Node* KeySideEffect::postorder(IR::P4Table* table) {
 const IR::Node* KeySideEffect::doStatement(const IR::Statement* statement,
                                            const IR::Expression *expression) {
     LOG3("Visiting " << getOriginal());
+    if (toInsert.empty())
+        return statement;
     HasTableApply hta(refMap, typeMap);
     (void)expression->apply(hta);
     if (hta.table == nullptr)
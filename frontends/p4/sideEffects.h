@@ -183,6 +183,8 @@ class DoSimplifyExpressions : public Transform, P4WriteContext {
     TypeMap*             typeMap;
     // Expressions holding temporaries that are already added.
     std::set<const IR::Expression*>* added;
+    /// Statements that an earlier run left unchanged; they are not visited again.
+    std::set<const IR::Statement*>* simplified;
 
     IR::IndexedVector<IR::Declaration> toInsert;  // temporaries
     IR::IndexedVector<IR::StatOrDecl> statements;
@@ -195,11 +197,16 @@ class DoSimplifyExpressions : public Transform, P4WriteContext {
                                         const IR::Expression* expression);
     bool mayAlias(const IR::Expression* left, const IR::Expression* right) const;
     bool containsHeaderType(const IR::Type* type);
+    /// Prune the visit of a statement simplified by an earlier run.
+    const IR::Node* skipSimplified(IR::Statement* statement);
+    /// Called by postorders; @returns @p statement.
+    const IR::Node* unchanged(IR::Statement* statement);
 
  public:
     DoSimplifyExpressions(ReferenceMap* refMap, TypeMap* typeMap,
-                          std::set<const IR::Expression*>* added)
-            : refMap(refMap), typeMap(typeMap), added(added) {
+                          std::set<const IR::Expression*>* added,
+                          std::set<const IR::Statement*>* simplified = nullptr)
+            : refMap(refMap), typeMap(typeMap), added(added), simplified(simplified) {
         CHECK_NULL(refMap); CHECK_NULL(typeMap);
         setName("DoSimplifyExpressions");
     }
@@ -228,6 +235,12 @@ class DoSimplifyExpressions : public Transform, P4WriteContext {
     const IR::Node* postorder(IR::P4Control* control) override;
     const IR::Node* postorder(IR::P4Action* action) override;
     const IR::Node* postorder(IR::ParserState* state) override;
+    const IR::Node* preorder(IR::AssignmentStatement* statement) override
+    { return skipSimplified(statement); }
+    const IR::Node* preorder(IR::MethodCallStatement* statement) override
+    { return skipSimplified(statement); }
+    const IR::Node* preorder(IR::ReturnStatement* statement) override
+    { return skipSimplified(statement); }
     const IR::Node* postorder(IR::AssignmentStatement* statement) override;
     const IR::Node* postorder(IR::MethodCallStatement* statement) override;
     const IR::Node* postorder(IR::ReturnStatement* statement) override;
@@ -287,11 +300,14 @@ class KeySideEffect : public Transform {
     TypeMap*      typeMap;
     std::map<const IR::P4Table*, TableInsertions*> toInsert;
     std::set<const IR::P4Table*>* invokedInKey;
+    /// Keys found to have no side effects by an earlier run.
+    std::set<const IR::Key*>* simpleKeys;
 
  public:
     KeySideEffect(ReferenceMap* refMap, TypeMap* typeMap,
-                  std::set<const IR::P4Table*>* invokedInKey)
-            : refMap(refMap), typeMap(typeMap), invokedInKey(invokedInKey)
+                  std::set<const IR::P4Table*>* invokedInKey,
+                  std::set<const IR::Key*>* simpleKeys = nullptr)
+            : refMap(refMap), typeMap(typeMap), invokedInKey(invokedInKey), simpleKeys(simpleKeys)
     { CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(invokedInKey); setName("KeySideEffect"); }
     const IR::Node* doStatement(const IR::Statement* statement, const IR::Expression* expression);
 
@@ -342,6 +358,10 @@ class TablesInKeys : public Inspector {
     }
 };
 
+/// Repeats the passes until nothing changes.  The statements and keys that are left
+/// unchanged are remembered across iterations, so later iterations only look at what the
+/// previous ones rewrote, and TypeChecking only recomputes the types of the declarations
+/// that changed.
 class SideEffectOrdering : public PassRepeated {
     // Contains all tables that are invoked within key
     // computations for other tables.  The keys for these
@@ -350,6 +370,8 @@ class SideEffectOrdering : public PassRepeated {
     std::set<const IR::P4Table*> invokedInKey;
     // Temporaries that were added
     std::set<const IR::Expression*> added;
+    std::set<const IR::Statement*> simplified;
+    std::set<const IR::Key*> simpleKeys;
 
  public:
     SideEffectOrdering(ReferenceMap* refMap, TypeMap* typeMap, bool skipSideEffectOrdering,
@@ -358,13 +380,18 @@ class SideEffectOrdering : public PassRepeated {
             typeChecking = new TypeChecking(refMap, typeMap);
         if (!skipSideEffectOrdering) {
             passes.push_back(new TypeChecking(refMap, typeMap));
-            passes.push_back(new DoSimplifyExpressions(refMap, typeMap, &added));
+            passes.push_back(new DoSimplifyExpressions(refMap, typeMap, &added, &simplified));
             passes.push_back(typeChecking);
             passes.push_back(new TablesInKeys(refMap, typeMap, &invokedInKey));
-            passes.push_back(new KeySideEffect(refMap, typeMap, &invokedInKey));
+            passes.push_back(new KeySideEffect(refMap, typeMap, &invokedInKey, &simpleKeys));
         }
         setName("SideEffectOrdering");
     }
+    profile_t init_apply(const IR::Node* root) override {
+        simplified.clear();
+        simpleKeys.clear();
+        return PassRepeated::init_apply(root);
+    }
 };
 
 }  // namespace P4
@@ -16,9 +16,67 @@ limitations under the License.
 
 #include "simplify.h"
 #include "sideEffects.h"
+#include "lib/gc.h"
+#include "lib/hash.h"
 
 namespace P4 {
 
+namespace {
+
+/**
+ * The top-level declarations in which DoSimplifyControlFlow found nothing to
+ * simplify.  Direct-mapped, so that it does not grow: a declaration that lost its
+ * entry is just visited again.  Keyed by the unique id of the node, with its address
+ * to tell apart nodes loaded with the same id.
+ */
+class Simplified {
+    struct Entry {
+        int             id = -1;
+        const IR::Node  *node = nullptr;
+    };
+    static constexpr size_t entries = 1024;
+    Entry table[entries];
+
+    Entry& slot(const IR::Node* node) {
+        return table[Util::Hash::hash_values(node->id) % entries];
+    }
+
+ public:
+    static Simplified& get() {
+        static thread_local Simplified *cache = nullptr;
+        if (!cache) cache = new(gc_alloc_root(sizeof(Simplified))) Simplified;
+        return *cache;
+    }
+    bool contains(const IR::Node* node) {
+        auto& e = slot(node);
+        return e.id == node->id && e.node == node;
+    }
+    void insert(const IR::Node* node) { slot(node) = Entry{node->id, node}; }
+};
+
+constexpr size_t Simplified::entries;
+
+}  // namespace
+
+template<class T>
+const IR::Node* DoSimplifyControlFlow::skipSimplified(T* declaration) {
+    if (!isTopLevel())
+        return declaration;
+    typeDependent = false;
+    if (Simplified::get().contains(getOriginal())) {
+        LOG3("Already simplified " << dbp(getOriginal()));
+        prune();
+    }
+    return declaration;
+}
+
+template<class T>
+const IR::Node* DoSimplifyControlFlow::rememberSimplified(T* declaration) {
+    if (isTopLevel() && !typeDependent && *declaration == *getOriginal<T>())
+        Simplified::get().insert(getOriginal());
+    return declaration;
+}
+
 const IR::Node* DoSimplifyControlFlow::postorder(IR::BlockStatement* statement) {
     LOG3("Visiting " << dbp(getOriginal()));
     if (statement->annotations->size() > 0)
@@ -71,11 +129,14 @@ const IR::Node* DoSimplifyControlFlow::postorder(IR::IfStatement* statement)  {
         statement->ifTrue = e;
     }
 
-    if (SideEffects::check(statement->condition, refMap, typeMap))
-        return statement;
     if (statement->ifTrue->is<IR::EmptyStatement>() &&
-        (statement->ifFalse == nullptr || statement->ifFalse->is<IR::EmptyStatement>()))
+        (statement->ifFalse == nullptr || statement->ifFalse->is<IR::EmptyStatement>())) {
+        if (SideEffects::check(statement->condition, refMap, typeMap)) {
+            typeDependent = true;
+            return statement;
+        }
         return new IR::EmptyStatement(statement->srcInfo);
+    }
     return statement;
 }
 
@@ -46,11 +46,27 @@ namespace P4 {
  * 6. If a block statement in an if statement branch only contains a single
  * statement, replace the block with the statement it contains.
  *
+ * Top-level parsers, controls, actions and functions in which nothing was found to
+ * simplify are remembered (by a bounded cache of this thread), and are not visited
+ * again while they are unchanged.  As the IR is immutable, only the declarations
+ * changed since they were last simplified are visited, whichever instance of the
+ * pass saw them.  A declaration is not remembered if an if statement with empty
+ * branches was kept because its condition has side effects, as that depends on the
+ * types and declarations of the program and not only on the declaration.
+ *
  * @pre An up-to-date ReferenceMap and TypeMap.
  */
 class DoSimplifyControlFlow : public Transform {
     ReferenceMap* refMap;
     TypeMap*      typeMap;
+    /// Whether the current top-level declaration kept a statement because of what its
+    /// expressions refer to.
+    bool          typeDependent = false;
+
+    bool isTopLevel() const { return getParent<IR::P4Program>() != nullptr; }
+    template<class T> const IR::Node* skipSimplified(T* declaration);
+    template<class T> const IR::Node* rememberSimplified(T* declaration);
+
  public:
     DoSimplifyControlFlow(ReferenceMap* refMap, TypeMap* typeMap) :
             refMap(refMap), typeMap(typeMap) {
@@ -64,18 +80,37 @@ class DoSimplifyControlFlow : public Transform {
     const IR::Node* postorder(IR::IfStatement* statement) override;
     const IR::Node* postorder(IR::EmptyStatement* statement) override;
     const IR::Node* postorder(IR::SwitchStatement* statement) override;
+
+    const IR::Node* preorder(IR::P4Parser* parser) override { return skipSimplified(parser); }
+    const IR::Node* preorder(IR::P4Control* control) override {
+        return skipSimplified(control); }
+    const IR::Node* preorder(IR::P4Action* action) override { return skipSimplified(action); }
+    const IR::Node* preorder(IR::Function* function) override {
+        return skipSimplified(function); }
+    const IR::Node* postorder(IR::P4Parser* parser) override {
+        return rememberSimplified(parser); }
+    const IR::Node* postorder(IR::P4Control* control) override {
+        return rememberSimplified(control); }
+    const IR::Node* postorder(IR::P4Action* action) override {
+        return rememberSimplified(action); }
+    const IR::Node* postorder(IR::Function* function) override {
+        return rememberSimplified(function); }
 };
 
 /// Repeatedly simplify control flow until convergence, as some simplification
-/// steps enable further simplification.
-class SimplifyControlFlow : public PassRepeated {
+/// steps enable further simplification.  The simplification only removes and
+/// rearranges statements, and finds the types and declarations it needs on the
+/// expressions it keeps, so the program is type checked before the repetitions
+/// and once after them, rather than before each.
+class SimplifyControlFlow : public PassManager {
  public:
     SimplifyControlFlow(ReferenceMap* refMap, TypeMap* typeMap,
             TypeChecking* typeChecking = nullptr) {
         if (!typeChecking)
             typeChecking = new TypeChecking(refMap, typeMap);
         passes.push_back(typeChecking);
-        passes.push_back(new DoSimplifyControlFlow(refMap, typeMap));
+        passes.push_back(new PassRepeated({ new DoSimplifyControlFlow(refMap, typeMap) }));
+        passes.push_back(typeChecking);
         setName("SimplifyControlFlow");
     }
 };
@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_SPECIALIZEGENERICFUNCTIONS_H_
 #define _FRONTENDS_P4_SPECIALIZEGENERICFUNCTIONS_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include "ir/ir.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
@@ -43,11 +46,16 @@ struct FunctionSpecializationMap {
     ReferenceMap* refMap;
     TypeMap* typeMap;
     ordered_map<const IR::MethodCallExpression*, FunctionSpecialization*> map;
+    /// The specializations of each function, in the order of 'map'.
+    std::unordered_map<const IR::Function*, std::vector<FunctionSpecialization*>> byFunction;
 
     void add(const IR::MethodCallExpression* mce, const IR::Function* func) {
+        if (map.count(mce))
+            return;
         cstring name = refMap->newName(func->name);
         FunctionSpecialization* fs = new FunctionSpecialization(name, mce, func);
         map.emplace(mce, fs);
+        byFunction[func].push_back(fs);
     }
     FunctionSpecialization* get(const IR::MethodCallExpression* mce) const {
         return ::get(map, mce);
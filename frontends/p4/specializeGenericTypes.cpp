@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "specializeGenericTypes.h"
 #include "frontends/p4/typeChecking/typeSubstitutionVisitor.h"
+#include "lib/hash.h"
 
 namespace P4 {
 
@@ -35,6 +36,45 @@ bool TypeSpecializationMap::same(
     return true;
 }
 
+namespace {
+
+/// A hash of @type such that the types TypeMap::equivalent considers equivalent
+/// have the same hash.
+size_t structuralHash(const IR::Type* type) {
+    size_t result = type->node_type_name().hash();
+    if (auto tt = type->to<IR::Type_Type>())
+        return Util::Hash::hash_combine(result, structuralHash(tt->type));
+    if (auto tb = type->to<IR::Type_Bits>())
+        return Util::Hash::hash_values(result, tb->size, tb->isSigned);
+    if (auto ts = type->to<IR::Type_Stack>()) {
+        result = Util::Hash::hash_combine(result, structuralHash(ts->elementType));
+        return ts->sizeKnown() ? Util::Hash::hash_values(result, ts->getSize()) : result;
+    }
+    if (auto tl = type->to<IR::Type_BaseList>()) {
+        for (auto c : tl->components)
+            result = Util::Hash::hash_combine(result, structuralHash(c));
+        return result;
+    }
+    if (type->is<IR::Type_StructLike>() && !type->is<IR::Type_UnknownStruct>())
+        return Util::Hash::hash_combine(result, type->to<IR::Type_StructLike>()->name.name.hash());
+    if (auto te = type->to<IR::Type_Enum>())
+        return Util::Hash::hash_combine(result, te->name.name.hash());
+    if (auto te = type->to<IR::Type_SerEnum>())
+        return Util::Hash::hash_combine(result, te->name.name.hash());
+    if (auto te = type->to<IR::Type_Extern>())
+        return Util::Hash::hash_combine(result, te->name.name.hash());
+    return result;
+}
+
+}  // namespace
+
+size_t TypeSpecializationMap::hash(const IR::Type_Specialized* t) const {
+    size_t result = t->baseType->path->name.name.hash();
+    for (auto a : *t->arguments)
+        result = Util::Hash::hash_combine(result, structuralHash(typeMap->getType(a, true)));
+    return result;
+}
+
 void TypeSpecializationMap::add(
     const IR::Type_Specialized* t, const IR::Type_StructLike* decl, const IR::Node* insertion) {
     auto it = map.find(t);
@@ -43,10 +83,13 @@ void TypeSpecializationMap::add(
 
     // First check if we have another specialization with the same
     // type arguments, in that case reuse it
-    for (auto it : map) {
-        if (same(it.second, t)) {
-            map.emplace(t, it.second);
-            LOG3("Found to specialize: " << t << " as previous " << it.second->name);
+    size_t key = hash(t);
+    auto range = canonical.equal_range(key);
+    for (auto c = range.first; c != range.second; ++c) {
+        if (same(c->second, t)) {
+            map.emplace(t, c->second);
+            lastUse[c->second] = t;
+            LOG3("Found to specialize: " << t << " as previous " << c->second->name);
             return;
         }
     }
@@ -59,12 +102,23 @@ void TypeSpecializationMap::add(
         argTypes->push_back(typeMap->getType(a, true));
     TypeSpecialization* s = new TypeSpecialization(name, t, decl, insertion, argTypes);
     map.emplace(t, s);
+    canonical.emplace(key, s);
+    byDeclaration[decl->name].push_back(s);
+    lastUse[s] = t;
 }
 
 TypeSpecialization* TypeSpecializationMap::get(const IR::Type_Specialized* type) const {
-    for (auto it : map) {
-        if (same(it.second, type))
-            return it.second;
+    auto it = map.find(type);
+    if (it != map.end())
+        return it->second;
+    // Only compute the hash, which needs the types of the arguments, for the
+    // specializations of generic declarations we know about.
+    if (!byDeclaration.count(type->baseType->path->name))
+        return nullptr;
+    auto range = canonical.equal_range(hash(type));
+    for (auto c = range.first; c != range.second; ++c) {
+        if (same(c->second, type))
+            return c->second;
     }
     return nullptr;
 }
@@ -121,21 +175,25 @@ void FindTypeSpecializations::postorder(const IR::Type_Specialized* type) {
 ///////////////////////////////////////////////////////////////////////////////////////
 
 const IR::Node* CreateSpecializedTypes::postorder(IR::Type_Declaration* type) {
-    for (auto it : specMap->map) {
-        if (it.second->declaration->name == type->name) {
-            auto specialized = it.first;
-            auto genDecl = type->to<IR::IMayBeGenericType>();
-            TypeVariableSubstitution ts;
-            ts.setBindings(type, genDecl->getTypeParameters(), specialized->arguments);
-            TypeSubstitutionVisitor tsv(specMap->typeMap, &ts);
-            auto renamed = type->apply(tsv)->to<IR::Type_StructLike>()->clone();
-            cstring name = it.second->name;
-            auto empty = new IR::TypeParameters();
-            renamed->name = name;
-            renamed->typeParameters = empty;
-            it.second->replacement = postorder(renamed)->to<IR::Type_StructLike>();
-            LOG3("CST Specializing " << dbp(type) << " with " << ts << " as " << dbp(renamed));
-        }
+    auto specs = specMap->byDeclaration.find(type->name);
+    if (specs == specMap->byDeclaration.end())
+        return insert(type);
+    for (auto spec : specs->second) {
+        // Once inserted in the program a replacement does not change any more.
+        if (specMap->inserted.count(spec))
+            continue;
+        auto specialized = specMap->lastUse.at(spec);
+        auto genDecl = type->to<IR::IMayBeGenericType>();
+        TypeVariableSubstitution ts;
+        ts.setBindings(type, genDecl->getTypeParameters(), specialized->arguments);
+        TypeSubstitutionVisitor tsv(specMap->typeMap, &ts);
+        auto renamed = type->apply(tsv)->to<IR::Type_StructLike>()->clone();
+        cstring name = spec->name;
+        auto empty = new IR::TypeParameters();
+        renamed->name = name;
+        renamed->typeParameters = empty;
+        spec->replacement = postorder(renamed)->to<IR::Type_StructLike>();
+        LOG3("CST Specializing " << dbp(type) << " with " << ts << " as " << dbp(renamed));
     }
     return insert(type);
 }
@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_SPECIALIZEGENERICTYPES_H_
 #define _FRONTENDS_P4_SPECIALIZEGENERICTYPES_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include "ir/ir.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
@@ -58,11 +61,21 @@ struct TypeSpecializationMap : public IHasDbPrint {
     // Keep track of the values in the above map which are already
     // inserted in the program.
     std::set<TypeSpecialization*> inserted;
+    /// Each distinct specialization, filed under hash(); the specializations
+    /// with the same hash are told apart with same().
+    std::unordered_multimap<size_t, TypeSpecialization*> canonical;
+    /// The distinct specializations of each generic declaration, in the order of 'map'.
+    std::unordered_map<cstring, std::vector<TypeSpecialization*>> byDeclaration;
+    /// For each specialization the last key of 'map' it was added for.
+    std::unordered_map<const TypeSpecialization*, const IR::Type_Specialized*> lastUse;
 
     void add(const IR::Type_Specialized* t, const IR::Type_StructLike* decl,
              const IR::Node* insertion);
     TypeSpecialization* get(const IR::Type_Specialized* t) const;
     bool same(const TypeSpecialization* left, const IR::Type_Specialized* right) const;
+    /// A hash of the generic type and the canonical type arguments of @t which is the
+    /// same for all the types that same() does not tell apart.
+    size_t hash(const IR::Type_Specialized* t) const;
     void dbprint(std::ostream& out) const override {
         for (auto it : map) { out << dbp(it.first) << " => " << it.second << std::endl; } }
     IR::Vector<IR::Node>*
@@ -65,7 +65,8 @@ class DoStrengthReduction final : public Transform {
     }
 
  public:
-    DoStrengthReduction() { visitDagOnce = true; setName("StrengthReduction"); }
+    DoStrengthReduction() {
+        visitDagOnce = true; freeUnchangedClones = true; setName("StrengthReduction"); }
 
     using Transform::postorder;
 
@@ -278,6 +278,87 @@ void ProgramStructure::declareParameters(const IR::IndexedVector<IR::Parameter>*
         declareObject(param->name, param->type->toString());
 }
 
+namespace {
+
+// The grammar actions for a functionPrototype, up to the final pop().
+void declarePrototype(ProgramStructure* structure, IR::ID name, const IR::Type_Method* type) {
+    structure->declareObject(name, type->returnType->toString());
+    if (!type->typeParameters->empty())
+        structure->markAsTemplate(name);
+    structure->pushNamespace(name.srcInfo, false);
+    structure->declareTypes(&type->typeParameters->parameters);
+    structure->declareParameters(&type->parameters->parameters);
+}
+
+// The grammar actions for a parser, control or package type declaration.
+void declareContainer(ProgramStructure* structure, const IR::Type_Declaration* decl,
+                      const IR::TypeParameters* typeParams, const IR::ParameterList* params,
+                      bool allowDuplicates) {
+    structure->pushContainerType(decl->name, allowDuplicates);
+    if (!typeParams->empty())
+        structure->markAsTemplate(decl->name);
+    structure->declareTypes(&typeParams->parameters);
+    structure->declareParameters(&params->parameters);
+    structure->pop();
+}
+
+}  // namespace
+
+bool ProgramStructure::declareParsed(const IR::Node* decl) {
+    if (decl->is<IR::Type_Error>() || decl->is<IR::Declaration_MatchKind>() ||
+        decl->is<IR::P4Action>())
+        return true;  // nothing to declare
+    if (auto ext = decl->to<IR::Type_Extern>()) {
+        pushContainerType(ext->name, true);
+        if (!ext->typeParameters->empty())
+            markAsTemplate(ext->name);
+        declareTypes(&ext->typeParameters->parameters);
+        for (auto method : ext->methods) {
+            if (method->name == ext->name) continue;  // constructor
+            declarePrototype(this, method->name, method->type);
+            pop(); }
+        pop();
+    } else if (auto method = decl->to<IR::Method>()) {
+        declarePrototype(this, method->name, method->type);
+        pop();
+    } else if (auto function = decl->to<IR::Function>()) {
+        declarePrototype(this, function->name, function->type);
+        pop();
+    } else if (auto parser = decl->to<IR::Type_Parser>()) {
+        declareContainer(this, parser, parser->typeParameters, parser->applyParams, true);
+    } else if (auto control = decl->to<IR::Type_Control>()) {
+        declareContainer(this, control, control->typeParameters, control->applyParams, true);
+    } else if (auto package = decl->to<IR::Type_Package>()) {
+        declareContainer(this, package, package->typeParameters, package->constructorParams,
+                         false);
+    } else if (auto st = decl->to<IR::Type_StructLike>()) {
+        // header, header_union and struct declarations are always marked as templates
+        pushContainerType(st->name, true);
+        markAsTemplate(st->name);
+        declareTypes(&st->typeParameters->parameters);
+        pop();
+    } else if (auto def = decl->to<IR::Type_Typedef>()) {
+        if (def->type->is<IR::Type_Declaration>() && !declareParsed(def->type))
+            return false;
+        declareType(def->name);
+    } else if (auto def = decl->to<IR::Type_Newtype>()) {
+        if (def->type->is<IR::Type_Declaration>() && !declareParsed(def->type))
+            return false;
+        declareType(def->name);
+    } else if (auto en = decl->to<IR::Type_Enum>()) {
+        declareType(en->name);
+    } else if (auto en = decl->to<IR::Type_SerEnum>()) {
+        declareType(en->name);
+    } else if (auto constant = decl->to<IR::Declaration_Constant>()) {
+        declareObject(constant->name, constant->type->toString());
+    } else if (auto inst = decl->to<IR::Declaration_Instance>()) {
+        declareObject(inst->name, inst->type->toString());
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void ProgramStructure::endParse() {
     BUG_CHECK(currentNamespace == rootNamespace,
               "Namespace stack is not empty at the end of parsing");
@@ -75,6 +75,10 @@ class ProgramStructure final {
     // Declares these types in the current scope
     void declareTypes(const IR::IndexedVector<IR::Type_Var>* typeVars);
     void declareParameters(const IR::IndexedVector<IR::Parameter>* params);
+    // Declares the top-level declaration @decl, parsed earlier, as the parser
+    // actions for it would have.  Returns false, declaring nothing, for kinds of
+    // declarations that cannot be replayed this way (parsers and controls).
+    bool declareParsed(const IR::Node* decl);
     SymbolKind lookupIdentifier(cstring identifier);
 
     void startAbsolutePath();
@@ -21,6 +21,7 @@ limitations under the License.
 #include "frontends/common/options.h"
 #include "frontends/parsers/p4/p4parser.hpp"
 #include "frontends/p4/fromv1.0/v1model.h"
+#include "lib/thread_pool.h"
 
 namespace P4 {
 
@@ -149,43 +150,56 @@ void ToP4::dump(unsigned depth, const IR::Node* node, unsigned adjDepth) {
         builder.emitIndent();
 }
 
+bool ToP4::emitInclude(const IR::P4Program* program, const IR::Node* decl,
+                       std::set<cstring>& includesEmitted, Util::SourceCodeBuilder& out) {
+    // Check where this declaration originates
+    cstring sourceFile = ifSystemFile(decl);
+    if (decl->is<IR::Type_Error>() ||  // errors can come from multiple files
+        sourceFile == nullptr)
+        return false;
+    /* FIXME -- when including a user header file (sourceFile != mainFile), do we want
+     * to emit an #include of it or not?  Probably not when translating from P4-14, as
+     * that would create a P4-16 file that tries to include a P4-14 header.  Unless we
+     * want to allow converting headers independently (is that even possible?).  For now
+     * we ignore mainFile and don't emit #includes for any non-system header */
+
+    if (includesEmitted.find(sourceFile) == includesEmitted.end()) {
+        if (sourceFile.startsWith(p4includePath)) {
+            const char *p = sourceFile.c_str() + strlen(p4includePath);
+            if (*p == '/') p++;
+            if (P4V1::V1Model::instance().file.name == p) {
+                P4V1::getV1ModelVersion g;
+                program->apply(g);
+                out.append("#define V1MODEL_VERSION ");
+                out.append(g.version);
+                out.appendLine("");
+            }
+            out.append("#include <");
+            out.append(p);
+            out.appendLine(">");
+        } else {
+            out.append("#include \"");
+            out.append(sourceFile);
+            out.appendLine("\"");
+        }
+        includesEmitted.emplace(sourceFile);
+    }
+    return true;
+}
+
 bool ToP4::preorder(const IR::P4Program* program) {
     std::set<cstring> includesEmitted;
 
+    if (parallel && !showIR && program->objects.size() > 1 &&
+        Util::ThreadPool::global().concurrency() > 1) {
+        printInParallel(program, includesEmitted);
+        return false;
+    }
+
     bool first = true;
     dump(2);
     for (auto a : program->objects) {
-        // Check where this declaration originates
-        cstring sourceFile = ifSystemFile(a);
-        if (!a->is<IR::Type_Error>() &&  // errors can come from multiple files
-            sourceFile != nullptr) {
-            /* FIXME -- when including a user header file (sourceFile != mainFile), do we want
-             * to emit an #include of it or not?  Probably not when translating from P4-14, as
-             * that would create a P4-16 file that tries to include a P4-14 header.  Unless we
-             * want to allow converting headers independently (is that even possible?).  For now
-             * we ignore mainFile and don't emit #includes for any non-system header */
-
-            if (includesEmitted.find(sourceFile) == includesEmitted.end()) {
-                if (sourceFile.startsWith(p4includePath)) {
-                    const char *p = sourceFile.c_str() + strlen(p4includePath);
-                    if (*p == '/') p++;
-                    if (P4V1::V1Model::instance.file.name == p) {
-                        P4V1::getV1ModelVersion g;
-                        program->apply(g);
-                        builder.append("#define V1MODEL_VERSION ");
-                        builder.append(g.version);
-                        builder.appendLine("");
-                    }
-                    builder.append("#include <");
-                    builder.append(p);
-                    builder.appendLine(">");
-                } else {
-                    builder.append("#include \"");
-                    builder.append(sourceFile);
-                    builder.appendLine("\"");
-                }
-                includesEmitted.emplace(sourceFile);
-            }
+        if (emitInclude(program, a, includesEmitted, builder)) {
             first = false;
             continue;
         }
@@ -199,6 +213,55 @@ bool ToP4::preorder(const IR::P4Program* program) {
     return false;
 }
 
+void ToP4::printInParallel(const IR::P4Program* program, std::set<cstring>& includesEmitted) {
+    // The #include lines are produced in order; every other declaration is printed
+    // into its own buffer, as the only declaration of a program, and the buffers are
+    // then stitched together exactly as the sequential loop would print them.
+    struct Segment {
+        std::string text;
+        const IR::Node* decl = nullptr;
+        bool leadingSpace = false;  // state of the output before the declaration
+    };
+    std::vector<Segment> segments(program->objects.size());
+    for (size_t i = 0; i < segments.size(); i++) {
+        auto a = program->objects.at(i);
+        Util::SourceCodeBuilder include;
+        if (emitInclude(program, a, includesEmitted, include)) {
+            segments[i].text = include.toString();
+        } else {
+            segments[i].decl = a;
+            segments[i].leadingSpace = i > 0 || builder.lastIsSpace();
+        }
+    }
+
+    Util::ThreadPool::global().parallel_for(segments.size(), [&](size_t i) {
+        auto& segment = segments[i];
+        if (segment.decl == nullptr)
+            return;
+        Util::SourceCodeBuilder out;
+        if (segment.leadingSpace)
+            out.newline();
+        ToP4 printer(out, false, mainFile);
+        printer.noIncludes = noIncludes;
+        printer.parallel = false;
+        auto single = new IR::P4Program(program->srcInfo, IR::Vector<IR::Node>(segment.decl));
+        single->apply(printer);
+        // drop the newline added above and the one ending the program
+        std::string text = out.toString();
+        size_t from = segment.leadingSpace ? 1 : 0;
+        segment.text = text.substr(from, text.size() - from - 1);
+    });
+
+    bool first = true;
+    for (auto& segment : segments) {
+        if (segment.decl != nullptr && !first)
+            builder.newline();
+        first = false;
+        builder.append(segment.text);
+    }
+    builder.newline();
+}
+
 bool ToP4::preorder(const IR::Type_Bits* t) {
     if (t->expression) {
         builder.append("bit<(");
@@ -1222,7 +1285,7 @@ bool ToP4::preorder(const IR::P4Control * c) {
 bool ToP4::preorder(const IR::ParameterList* p) {
     builder.append("(");
     bool first = true;
-    for (auto param : *p->getEnumerator()) {
+    for (auto param : p->parameters) {
         if (!first)
             builder.append(", ");
         first = false;
@@ -75,6 +75,13 @@ class ToP4 : public Inspector {
     }
     bool isSystemFile(cstring file);
     cstring ifSystemFile(const IR::Node* node);  // return file containing node if system file
+    /// If @decl comes from a system file append the #include for it to @out, unless
+    /// it was already emitted; @returns true if @decl comes from a system file.
+    bool emitInclude(const IR::P4Program* program, const IR::Node* decl,
+                     std::set<cstring>& includesEmitted, Util::SourceCodeBuilder& out);
+    /// Print the top-level declarations of @program using the threads of the global
+    /// Util::ThreadPool.  The output is the same as when printing them in sequence.
+    void printInParallel(const IR::P4Program* program, std::set<cstring>& includesEmitted);
     // dump node IR tree up to depth - in the form of a comment
     void dump(unsigned depth, const IR::Node* node = nullptr, unsigned adjDepth = 0);
     unsigned curDepth() const;
@@ -91,6 +98,9 @@ class ToP4 : public Inspector {
         that come from libraries and models are not
         emitted. */
     cstring mainFile;
+    /** If true and IR comments are not shown, the top-level declarations of
+        a program are printed in parallel when threads are available. */
+    bool parallel = true;
 
     ToP4(Util::SourceCodeBuilder& builder, bool showIR, cstring mainFile = nullptr) :
             expressionPrecedence(DBPrint::Prec_Low),
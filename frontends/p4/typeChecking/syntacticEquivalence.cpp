@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "syntacticEquivalence.h"
+#include "lib/hash.h"
 
 namespace P4 {
 
@@ -111,5 +112,87 @@ bool SameExpression::sameExpression(const IR::Expression* left, const IR::Expres
     }
 }
 
+size_t SameExpression::hash(const IR::Expression* expression) const {
+    // Follows sameExpression; the types, which are compared up to equivalence, are
+    // left out.
+    CHECK_NULL(expression);
+    size_t result = expression->node_type_name().hash();
+    if (auto m = expression->to<IR::Member>()) {
+        return Util::Hash::hash_values(result, m->member.name.hash(), hash(m->expr));
+    } else if (auto u = expression->to<IR::Operation_Unary>()) {
+        return Util::Hash::hash_combine(result, hash(u->expr));
+    } else if (auto b = expression->to<IR::Operation_Binary>()) {
+        return Util::Hash::hash_values(result, hash(b->left), hash(b->right));
+    } else if (auto t = expression->to<IR::Operation_Ternary>()) {
+        return Util::Hash::hash_values(result, hash(t->e0), hash(t->e1), hash(t->e2));
+    } else if (auto c = expression->to<IR::Constant>()) {
+        if (!c->fitsInt64())
+            return result;
+        return Util::Hash::hash_values(result, static_cast<int64_t>(c->value));
+    } else if (auto bl = expression->to<IR::BoolLiteral>()) {
+        return Util::Hash::hash_values(result, bl->value);
+    } else if (auto sl = expression->to<IR::StringLiteral>()) {
+        return Util::Hash::hash_combine(result, sl->value.hash());
+    } else if (expression->is<IR::Literal>()) {
+        return result;
+    } else if (auto pe = expression->to<IR::PathExpression>()) {
+        auto decl = refMap->getDeclaration(pe->path, true);
+        return Util::Hash::hash_combine(result, decl->getName().name.hash());
+    } else if (auto tn = expression->to<IR::TypeNameExpression>()) {
+        auto decl = refMap->getDeclaration(tn->typeName->path, true);
+        return Util::Hash::hash_combine(result, decl->getName().name.hash());
+    } else if (auto l = expression->to<IR::ListExpression>()) {
+        for (auto e : l->components)
+            result = Util::Hash::hash_combine(result, hash(e));
+        return result;
+    } else if (auto mc = expression->to<IR::MethodCallExpression>()) {
+        result = Util::Hash::hash_values(result, hash(mc->method), mc->typeArguments->size());
+        for (auto a : *mc->arguments)
+            result = Util::Hash::hash_combine(result, hash(a->expression));
+        return result;
+    } else if (auto cc = expression->to<IR::ConstructorCallExpression>()) {
+        for (auto a : *cc->arguments)
+            result = Util::Hash::hash_combine(result, hash(a->expression));
+        return result;
+    } else {
+        BUG("%1%: Unexpected expression", expression);
+    }
+}
+
+const IR::Expression* SameExpressionSet::insert(const IR::Expression* expression) {
+    auto& bucket = buckets[same.hash(expression)];
+    const IR::Expression* first = nullptr;
+    for (auto e : bucket) {
+        if (same.sameExpression(e, expression)) {
+            first = e;
+            break;
+        }
+    }
+    bucket.push_back(expression);
+    count_++;
+    return first;
+}
+
+const IR::Expression* SameExpressionSet::find(const IR::Expression* expression) const {
+    auto it = buckets.find(same.hash(expression));
+    if (it == buckets.end())
+        return nullptr;
+    for (auto e : it->second)
+        if (same.sameExpression(e, expression))
+            return e;
+    return nullptr;
+}
+
+size_t SameExpressionSet::count(const IR::Expression* expression) const {
+    auto it = buckets.find(same.hash(expression));
+    if (it == buckets.end())
+        return 0;
+    size_t result = 0;
+    for (auto e : it->second)
+        if (same.sameExpression(e, expression))
+            result++;
+    return result;
+}
+
 
 }  // namespace P4
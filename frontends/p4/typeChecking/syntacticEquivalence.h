@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef _TYPECHECKING_SYNTACTICEQUIVALENCE_H_
 #define _TYPECHECKING_SYNTACTICEQUIVALENCE_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include "ir/ir.h"
 #include "frontends/p4/typeMap.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
@@ -36,6 +39,30 @@ class SameExpression {
                          const IR::Vector<IR::Expression>* right) const;
     bool sameExpressions(const IR::Vector<IR::Argument>* left,
                          const IR::Vector<IR::Argument>* right) const;
+    /// A hash of @expression such that the same expressions have the same hash.
+    size_t hash(const IR::Expression* expression) const;
+};
+
+/// A multiset of expressions, in which the expressions that are the same as a
+/// given one are found without comparing it with every other expression.
+class SameExpressionSet {
+    SameExpression same;
+    std::unordered_map<size_t, std::vector<const IR::Expression*>> buckets;
+    size_t count_ = 0;
+
+ public:
+    SameExpressionSet(const ReferenceMap* refMap, const TypeMap* typeMap) :
+            same(refMap, typeMap) {}
+    /// Adds @expression to the set.
+    /// @returns the first expression added that is the same as @expression, or nullptr.
+    const IR::Expression* insert(const IR::Expression* expression);
+    /// @returns the first expression added that is the same as @expression, or nullptr.
+    const IR::Expression* find(const IR::Expression* expression) const;
+    /// The number of expressions added that are the same as @expression.
+    size_t count(const IR::Expression* expression) const;
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    void clear() { buckets.clear(); count_ = 0; }
 };
 
 }  // namespace P4
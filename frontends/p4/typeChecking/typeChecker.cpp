@@ -14,7 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <exception>
+#include <set>
+#include <vector>
+
 #include "lib/log.h"
+#include "lib/compile_context.h"
+#include "lib/thread_pool.h"
 #include "typeChecker.h"
 #include "typeUnification.h"
 #include "typeSubstitution.h"
@@ -88,10 +94,12 @@ class ConstantTypeSubstitution : public Transform {
 }  // namespace
 
 TypeChecking::TypeChecking(ReferenceMap* refMap, TypeMap* typeMap,
-                           bool updateExpressions) {
+                           bool updateExpressions, bool parallel) {
+    auto inference = new P4::TypeInference(refMap, typeMap, true);
+    inference->parallel = parallel;
     addPasses({
        new P4::ResolveReferences(refMap),
-       new P4::TypeInference(refMap, typeMap, true),
+       inference,
        updateExpressions ? new ApplyTypesToExpressions(typeMap) : nullptr,
        updateExpressions ? new P4::ResolveReferences(refMap) : nullptr });
     setStopOnError(true);
@@ -134,6 +142,7 @@ Visitor::profile_t TypeInference::init_apply(const IR::Node* node) {
         LOG2("TypeInference for " << dbp(node));
     }
     initialNode = node;
+    initialErrors = ::errorCount();
     refMap->validateMap(node);
     return Transform::init_apply(node);
 }
@@ -144,6 +153,8 @@ void TypeInference::end_apply(const IR::Node* node) {
             "should not infer new types anymore, but it did.");
     }
     typeMap->updateMap(node);
+    if (node == initialNode && ::errorCount() == initialErrors)
+        typeMap->setChecked(node);
     if (node->is<IR::P4Program>())
         LOG3("Typemap: " << std::endl << typeMap);
 }
@@ -234,7 +245,7 @@ const IR::ParameterList* TypeInference::canonicalizeParameters(const IR::Paramet
 
     bool changes = false;
     auto vec = new IR::IndexedVector<IR::Parameter>();
-    for (auto p : *params->getEnumerator()) {
+    for (auto p : params->parameters) {
         auto paramType = getTypeType(p->type);
         if (paramType == nullptr)
             return nullptr;
@@ -352,7 +363,7 @@ const IR::Type* TypeInference::canonicalize(const IR::Type* type) {
         if (et == set->elementType)
             return type;
         const IR::Type *canon = new IR::Type_Set(type->srcInfo, et);
-        return canon;
+        return typeMap->getCanonical(canon);
     } else if (auto stack = type->to<IR::Type_Stack>()) {
         auto et = canonicalize(stack->elementType);
         if (et == nullptr)
@@ -390,7 +401,7 @@ const IR::Type* TypeInference::canonicalize(const IR::Type* type) {
             canon = type;
         canon = typeMap->getCanonical(canon);
         if (anySet)
-            canon = new IR::Type_Set(type->srcInfo, canon);
+            canon = typeMap->getCanonical(new IR::Type_Set(type->srcInfo, canon));
         return canon;
     } else if (auto tuple = type->to<IR::Type_Tuple>()) {
         auto fields = new IR::Vector<IR::Type>();
@@ -587,10 +598,80 @@ const IR::Node* TypeInference::preorder(IR::P4Program* program) {
     if (typeMap->checkMap(getOriginal()) && readOnly) {
         LOG2("No need to typecheck");
         prune();
+    } else if (readOnly && parallel && Util::ThreadPool::global().concurrency() > 1) {
+        checkInParallel(getOriginal<IR::P4Program>());
+        prune();
     }
     return program;
 }
 
+void TypeInference::checkInParallel(const IR::P4Program* program) {
+    // Parsers, controls, actions and functions only add types for their own nodes, so
+    // consecutive ones can be checked together unless one refers to another.  Everything
+    // else is checked on its own, in program order, directly into the typeMap.
+    auto independent = [](const IR::Node* decl) {
+        return decl->is<IR::P4Parser>() || decl->is<IR::P4Control>() ||
+               decl->is<IR::P4Action>() || decl->is<IR::Function>(); };
+
+    std::vector<const IR::Node*> batch;
+    std::set<const IR::Node*> inBatch;
+    auto checkBatch = [&]() {
+        if (batch.size() == 1) {
+            TypeInference inference(refMap, typeMap, true);
+            batch.front()->apply(inference);
+        } else if (batch.size() > 1) {
+            LOG2("Type checking " << batch.size() << " declarations in parallel");
+            std::vector<TypeMap*> shards;
+            std::vector<ReferenceMap*> refShards;
+            std::vector<ErrorReporter::Deferred> deferred(batch.size());
+            std::vector<std::exception_ptr> failed(batch.size());
+            for (size_t i = 0; i < batch.size(); i++) {
+                shards.push_back(new TypeMap(typeMap));
+                refShards.push_back(new ReferenceMap(refMap)); }
+            {
+                // the shards read the maps without locks, so nothing may write them
+                ProgramMap::Freeze freezeTypes(*typeMap), freezeRefs(*refMap);
+                Util::ThreadPool::global().parallel_for(batch.size(), [&](size_t i) {
+                    ErrorReporter::Deferred::Scope keep(deferred[i]);
+                    try {
+                        TypeInference inference(refShards[i], shards[i], true);
+                        batch[i]->apply(inference);
+                    } catch (...) {
+                        failed[i] = std::current_exception(); } });
+            }
+            // Stop at the first declaration that failed, as the sequential loop would.
+            auto& reporter = BaseCompileContext::get().errorReporter();
+            for (size_t i = 0; i < batch.size(); i++) {
+                typeMap->merge(*shards[i]);
+                refMap->merge(*refShards[i]);
+                reporter.emit(deferred[i]);
+                if (failed[i])
+                    std::rethrow_exception(failed[i]); }
+        }
+        batch.clear();
+        inBatch.clear();
+    };
+
+    for (auto decl : program->objects) {
+        if (!independent(decl)) {
+            checkBatch();
+            TypeInference inference(refMap, typeMap, true);
+            decl->apply(inference);
+            continue;
+        }
+        bool usesBatch = false;
+        forAllMatching<IR::Path>(decl, [&](const IR::Path* path) {
+            auto target = refMap->getDeclaration(path);
+            if (target != nullptr && inBatch.count(target->getNode()))
+                usesBatch = true; });
+        if (usesBatch)
+            checkBatch();
+        batch.push_back(decl);
+        inBatch.insert(decl);
+    }
+    checkBatch();
+}
+
 const IR::Node* TypeInference::postorder(IR::Type_Error* decl) {
     (void)setTypeType(decl);
     for (auto id : *decl->getDeclarations())
@@ -914,7 +995,7 @@ TypeInference::checkExternConstructor(const IR::Node* errorPosition,
 
     auto args = new IR::Vector<IR::ArgumentInfo>();
     size_t i = 0;
-    for (auto pi : *methodType->parameters->getEnumerator()) {
+    for (auto pi : methodType->parameters->parameters) {
         if (i >= arguments->size()) {
             BUG_CHECK(pi->isOptional() || pi->defaultValue != nullptr,
                       "Missing nonoptional arg %s", pi);
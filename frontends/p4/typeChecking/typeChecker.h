@@ -44,8 +44,12 @@ class ClearTypeMap : public Inspector {
         // because the program is saved only *after* typechecking,
         // so if the program changes during type-checking, the
         // typeMap may not be complete.
-        if (force || !typeMap->checkMap(program))
+        // Unless forced, the types of the declarations that have
+        // not changed are kept.
+        if (force)
             typeMap->clear();
+        else if (!typeMap->checkMap(program))
+            typeMap->clearChanged(program);
         return false;  // prune()
     }
 };
@@ -53,11 +57,13 @@ class ClearTypeMap : public Inspector {
 // Performs together reference resolution and type checking by calling
 // TypeInference.  If updateExpressions is true, after type checking
 // it will update all Expression objects, writing the result type into
-// the Expression::type field.
+// the Expression::type field.  If parallel is true and more than one
+// thread is available, independent top-level declarations are checked
+// concurrently; the result is the same as when checking sequentially.
 class TypeChecking : public PassManager {
  public:
     TypeChecking(/* out */ReferenceMap* refMap, /* out */TypeMap* typeMap,
-                 bool updateExpressions = false);
+                 bool updateExpressions = false, bool parallel = true);
 };
 
 template<typename... T>
@@ -80,12 +86,17 @@ class TypeInference : public Transform {
     // Output: type map
     TypeMap* typeMap;
     const IR::Node* initialNode;
+    unsigned initialErrors = 0;
 
  public:
     // If readOnly=true it will assert that it behaves like
     // an Inspector.
     TypeInference(ReferenceMap* refMap, TypeMap* typeMap,
                   bool readOnly = false);
+    /// If true a readOnly inference of a whole program checks the parsers,
+    /// controls, actions and functions that do not refer to each other on
+    /// the global thread pool.
+    bool parallel = false;
 
  protected:
     // If true we expect to leave the program unchanged
@@ -124,6 +135,11 @@ class TypeInference : public Transform {
     bool canCastBetween(const IR::Type* dest, const IR::Type* src) const;
     bool checkAbstractMethods(const IR::Declaration_Instance* inst, const IR::Type_Extern* type);
     void addSubstitutions(const TypeVariableSubstitution* tvs);
+    /// Check the top-level declarations of @program, running batches of
+    /// independent declarations in parallel.  Each declaration of a batch
+    /// fills its own shard of the typeMap and defers its diagnostics; the
+    /// shards and diagnostics are merged in declaration order.
+    void checkInParallel(const IR::P4Program* program);
 
 
     /** Converts each type to a canonical representation.
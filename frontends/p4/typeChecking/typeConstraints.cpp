@@ -29,7 +29,7 @@ void TypeConstraints::addEqualityConstraint(
 
 TypeVariableSubstitution* TypeConstraints::solve() {
     LOG3("Solving constraints:\n" << *this);
-    currentSubstitution = new TypeVariableSubstitution();
+    bindings.clear();
     while (!constraints.empty()) {
         auto last = constraints.back();
         constraints.pop_back();
@@ -37,8 +37,88 @@ TypeVariableSubstitution* TypeConstraints::solve() {
         if (!success)
             return nullptr;
     }
-    LOG3("Constraint solution:\n" << currentSubstitution);
-    return currentSubstitution;
+    auto result = getCurrentSubstitution();
+    LOG3("Constraint solution:\n" << result);
+    return result;
+}
+
+TypeVariableSubstitution* TypeConstraints::getCurrentSubstitution() const {
+    auto triangular = new TypeVariableSubstitution();
+    for (auto& b : bindings)
+        triangular->setBinding(b.first, b.second);
+    // The visitor follows chains of variables, and then substitutes
+    // into the type it finds.
+    TypeVariableSubstitutionVisitor visitor(triangular);
+    auto result = new TypeVariableSubstitution();
+    for (auto& b : bindings) {
+        auto type = b.second->apply(visitor);
+        CHECK_NULL(type);
+        result->setBinding(b.first, type->to<IR::Type>());
+    }
+    return result;
+}
+
+const IR::ITypeVar* TypeConstraints::find(const IR::ITypeVar* var) {
+    auto root = var;
+    while (true) {
+        auto it = bindings.find(root);
+        if (it == bindings.end() || !it->second->is<IR::ITypeVar>())
+            break;
+        root = it->second->to<IR::ITypeVar>();
+    }
+    while (var != root) {
+        auto& value = bindings.at(var);
+        var = value->to<IR::ITypeVar>();
+        value = root->asType();
+    }
+    return root;
+}
+
+const IR::Type* TypeConstraints::lookup(const IR::ITypeVar* var) {
+    auto root = find(var);
+    auto it = bindings.find(root);
+    if (it != bindings.end())
+        return it->second;
+    return root == var ? nullptr : root->asType();
+}
+
+bool TypeConstraints::occurs(const IR::ITypeVar* var, const IR::Type* type,
+                             std::set<const IR::ITypeVar*>& seen) {
+    TypeOccursVisitor literal(var);
+    type->apply(literal);
+    if (literal.occurs)
+        return true;
+    bool result = false;
+    forAllMatching<IR::Type>(type, [&](const IR::Type* t) {
+        auto tv = t->to<IR::ITypeVar>();
+        if (result || tv == nullptr || !seen.insert(tv).second)
+            return;
+        if (auto value = lookup(tv))
+            result = occurs(var, value, seen); });
+    return result;
+}
+
+cstring TypeConstraints::bind(const IR::ITypeVar* var, const IR::Type* type) {
+    // The same checks as TypeVariableSubstitution::compose.
+    if (type->is<IR::Type_Dontcare>())
+        return "";
+    if (var->is<IR::Type_InfInt>()) {
+        auto base = type;
+        while (base->is<IR::Type_Newtype>())
+            base = base->to<IR::Type_Newtype>()->type;
+        if (auto se = base->to<IR::Type_SerEnum>())
+            base = se->type;
+        if (!base->is<IR::Type_InfInt>() && !base->is<IR::Type_Bits>())
+            return "'%1%' type can only be unified with 'int', 'bit<>', or 'signed<>' types, "
+                    "not with '%2%'";
+    }
+    std::set<const IR::ITypeVar*> seen;
+    if (occurs(var, type, seen))
+        return "'%1%' cannot be replaced with '%2%' which already contains it";
+    BUG_CHECK(bindings.count(var) == 0, "Two constraints on the same variable %1%: %2% and %3%",
+              var->toString(), type->toString(), bindings.at(var)->toString());
+    bindings.emplace(var, type);
+    return "";
 }
 
 bool TypeConstraints::isUnifiableTypeVariable(const IR::Type* type) {
@@ -60,13 +140,14 @@ bool TypeConstraints::solve(const EqualityConstraint *constraint) {
             return true;
 
         // check to see whether we already have a substitution for leftTv
-        const IR::Type* leftSubst = currentSubstitution->lookup(leftTv);
+        const IR::Type* leftSubst = lookup(leftTv);
         if (leftSubst == nullptr) {
             auto right = constraint->right->apply(replaceVariables)->to<IR::Type>();
-            if (leftTv == right->to<IR::ITypeVar>())
-                return true;
+            if (auto rightTv = right->to<IR::ITypeVar>())
+                if (find(rightTv) == leftTv)
+                    return true;
             LOG3("Binding " << leftTv << " => " << right);
-            auto error = currentSubstitution->compose(leftTv, right);
+            auto error = bind(leftTv, right);
             if (!error.isNullOrEmpty())
                 return constraint->reportError(getCurrentSubstitution(), error, leftTv, right);
             return true;
@@ -78,13 +159,14 @@ bool TypeConstraints::solve(const EqualityConstraint *constraint) {
 
     if (isUnifiableTypeVariable(constraint->right)) {
         auto rightTv = constraint->right->to<IR::ITypeVar>();
-        const IR::Type* rightSubst = currentSubstitution->lookup(rightTv);
+        const IR::Type* rightSubst = lookup(rightTv);
         if (rightSubst == nullptr) {
             auto left = constraint->left->apply(replaceVariables)->to<IR::Type>();
-            if (left->to<IR::ITypeVar>() == rightTv)
-                return true;
+            if (auto leftTv = left->to<IR::ITypeVar>())
+                if (find(leftTv) == rightTv)
+                    return true;
             LOG3("Binding " << rightTv << " => " << left);
-            auto error = currentSubstitution->compose(rightTv, left);
+            auto error = bind(rightTv, left);
             if (!error.isNullOrEmpty())
                 return constraint->reportError(getCurrentSubstitution(), error, rightTv, left);
             return true;
@@ -18,6 +18,7 @@ limitations under the License.
 #define _TYPECHECKING_TYPECONSTRAINTS_H_
 
 #include <sstream>
+#include <unordered_map>
 
 #include <boost/optional.hpp>
 #include <boost/algorithm/string.hpp>
@@ -222,15 +223,32 @@ class TypeConstraints final {
     std::vector<const TypeConstraint*> constraints;
     TypeUnification *unification;
     const TypeVariableSubstitution* definedVariables;
-    /// Keeps track of the values of all variables.
-    TypeVariableSubstitution* currentSubstitution;
+    /// Keeps track of the values of all variables, in triangular form: a
+    /// bound type may contain variables that are bound later, and a variable
+    /// unified with another variable is bound to it.  The variables bound to
+    /// variables form union-find trees, whose roots are unbound or bound to a
+    /// type which is not a variable.  The bound types are substituted into
+    /// each other only when the solution is read, instead of rewriting all
+    /// bindings each time one is added.
+    std::unordered_map<const IR::ITypeVar*, const IR::Type*> bindings;
+
+    /// The root of the tree of @var; compresses the path to it.
+    const IR::ITypeVar* find(const IR::ITypeVar* var);
+    /// The value of @var: the type bound to its root, or the root if that is
+    /// unbound and not @var itself, or nullptr if @var is unbound.
+    const IR::Type* lookup(const IR::ITypeVar* var);
+    /// True if @var occurs in @type, looking through the bindings.
+    bool occurs(const IR::ITypeVar* var, const IR::Type* type,
+                std::set<const IR::ITypeVar*>& seen);
+    /// Bind the unbound root @var to @type.
+    /// @return an error message format (see TypeVariableSubstitution::compose) on failure.
+    cstring bind(const IR::ITypeVar* var, const IR::Type* type);
 
  public:
     TypeVariableSubstitutionVisitor replaceVariables;
 
     explicit TypeConstraints(const TypeVariableSubstitution* definedVariables) :
             unification(new TypeUnification(this)), definedVariables(definedVariables),
-            currentSubstitution(new TypeVariableSubstitution()),
             replaceVariables(definedVariables) {}
 
     // Mark this variable as being free.
@@ -253,7 +271,8 @@ class TypeConstraints final {
     bool solve(const EqualityConstraint *constraint);
     TypeVariableSubstitution* solve();
     void dbprint(std::ostream& out) const;
-    const TypeVariableSubstitution* getCurrentSubstitution() const { return currentSubstitution; }
+    /// The values of all variables bound so far.
+    TypeVariableSubstitution* getCurrentSubstitution() const;
 };
 }  // namespace P4
 
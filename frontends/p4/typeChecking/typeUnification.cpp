@@ -165,7 +165,7 @@ bool TypeUnification::unifyFunctions(const EqualityConstraint* constraint,
         constraints->add(constraint->create(dest->returnType, src->returnType));
 
     auto sit = src->parameters->parameters.begin();
-    for (auto dit : *dest->parameters->getEnumerator()) {
+    for (auto dit : dest->parameters->parameters) {
         if (sit == src->parameters->parameters.end()) {
             if (dit->isOptional())
                 continue;
@@ -15,10 +15,76 @@ limitations under the License.
 */
 
 #include "typeMap.h"
+
+#include <algorithm>
+
+#include "lib/hash.h"
 #include "lib/map.h"
 
 namespace P4 {
 
+namespace {
+
+/**
+ * A direct-mapped memo of the results of TypeMap::equivalent and
+ * TypeMap::implicitlyConvertibleTo for the structured types.  Canonical types are
+ * not changed once built, so a result only depends on the identity of the two types.
+ * The entries are keyed by the unique ids of the nodes rather than by their addresses,
+ * which the garbage collector may reuse, and they do not keep the nodes alive.
+ * Each thread has its own cache.
+ */
+class EquivalenceCache {
+    struct Entry {
+        int left = -1;
+        int right = -1;
+        bool implicit = false;
+        bool result = false;
+    };
+    static constexpr size_t entries = 1024;
+    Entry table[entries];
+
+    Entry& slot(const IR::Type* left, const IR::Type* right, bool implicit) {
+        auto h = Util::Hash::hash_values(left->id, right->id, implicit);
+        return table[h % entries];
+    }
+
+ public:
+    static EquivalenceCache& get() {
+        static thread_local EquivalenceCache cache;
+        return cache;
+    }
+    bool lookup(const IR::Type* left, const IR::Type* right, bool implicit, bool& result) {
+        auto& e = slot(left, right, implicit);
+        if (e.left != left->id || e.right != right->id || e.implicit != implicit)
+            return false;
+        result = e.result;
+        return true;
+    }
+    void store(const IR::Type* left, const IR::Type* right, bool implicit, bool result) {
+        auto& e = slot(left, right, implicit);
+        e.left = left->id;
+        e.right = right->id;
+        e.implicit = implicit;
+        e.result = result;
+    }
+};
+
+constexpr size_t EquivalenceCache::entries;
+
+// The names a top-level declaration can be referred to by.
+std::vector<cstring> declaredNames(const IR::Node* decl) {
+    std::vector<cstring> result;
+    if (auto mk = decl->to<IR::Declaration_MatchKind>()) {
+        for (auto member : mk->members)
+            result.push_back(member->name.name);
+    } else if (auto d = decl->to<IR::IDeclaration>()) {
+        result.push_back(d->getName().name);
+    }
+    return result;
+}
+
+}  // namespace
+
 bool TypeMap::typeIsEmpty(const IR::Type* type) const {
     if (auto bt = type->to<IR::Type_Bits>()) {
         return bt->size == 0;
@@ -52,31 +118,44 @@ bool TypeMap::typeIsEmpty(const IR::Type* type) const {
 
 void TypeMap::dbprint(std::ostream& out) const {
     out << "TypeMap for " << dbp(program) << std::endl;
-    for (auto it : typeMap)
-        out << "\t" << dbp(it.first) << "->" << dbp(it.second) << std::endl;
+    nodeInfo.for_each([&out](const IR::Node* node, const NodeInfo& i) {
+        if (i.type)
+            out << "\t" << dbp(node) << "->" << dbp(i.type) << std::endl; });
     out << "Left values" << std::endl;
-    for (auto it : leftValues)
-        out << "\t" << dbp(it) << std::endl;
+    nodeInfo.for_each([&out](const IR::Node* node, const NodeInfo& i) {
+        if (i.leftValue)
+            out << "\t" << dbp(node) << std::endl; });
     out << "Constants" << std::endl;
-    for (auto it : constants)
-        out << "\t" << dbp(it) << std::endl;
+    nodeInfo.for_each([&out](const IR::Node* node, const NodeInfo& i) {
+        if (i.constant)
+            out << "\t" << dbp(node) << std::endl; });
     out << "Type variables" << std::endl;
     out << allTypeVariables << std::endl;
     out << "--------------" << std::endl;
 }
 
 void TypeMap::setLeftValue(const IR::Expression* expression) {
-    leftValues.insert(expression);
+    CHECK_NULL(expression);
+    info(expression).leftValue = true;
     LOG1("Left value " << dbp(expression));
 }
 
 void TypeMap::setCompileTimeConstant(const IR::Expression* expression) {
-    constants.insert(expression);
+    CHECK_NULL(expression);
+    info(expression).constant = true;
     LOG3("Constant value " << dbp(expression));
 }
 
+TypeMap::TypeMap(const TypeMap* parent) : ProgramMap("TypeMap"), parent(parent) {
+    CHECK_NULL(parent);
+    // The type constraints are solved knowing all the bindings so far.
+    allTypeVariables = parent->allTypeVariables;
+}
+
 bool TypeMap::isCompileTimeConstant(const IR::Expression* expression) const {
-    bool result = constants.find(expression) != constants.end();
+    auto i = nodeInfo.find(expression);
+    bool result = (i != nullptr && i->constant) ||
+            (parent != nullptr && parent->isCompileTimeConstant(expression));
     LOG3(dbp(expression) << (result ? " constant" : " not constant"));
     return result;
 }
@@ -93,9 +172,99 @@ void TypeMap::cloneExpressionProperties(const IR::Expression* to,
 }
 
 void TypeMap::clear() {
+    checkNotFrozen();
     LOG3("Clearing typeMap");
-    typeMap.clear(); leftValues.clear(); constants.clear(); allTypeVariables.clear();
-    program = nullptr;
+    nodeInfo.clear(); typeCount = 0; allTypeVariables.clear();
+    program = nullptr; checkedProgram = nullptr;
+    invalidate();
+}
+
+void TypeMap::forget(const IR::Node* node) {
+    if (auto i = nodeInfo.find(node)) {
+        if (i->type != nullptr)
+            typeCount--;
+        *i = NodeInfo{nullptr, false, false};
+    }
+    if (auto tv = node->to<IR::ITypeVar>())
+        allTypeVariables.erase(tv);
+}
+
+void TypeMap::clearChanged(const IR::P4Program* program) {
+    checkNotFrozen();
+    if (checkedProgram == nullptr) {
+        clear();
+        return;
+    }
+    // Top-level declarations by name, before and now.
+    std::map<cstring, std::vector<const IR::Node*>> before, after;
+    for (auto decl : checkedProgram->objects)
+        for (auto name : declaredNames(decl))
+            before[name].push_back(decl);
+    for (auto decl : program->objects)
+        for (auto name : declaredNames(decl))
+            after[name].push_back(decl);
+    // Names whose declarations are different or lose their types.
+    std::set<cstring> changed;
+    for (auto& b : before)
+        if (::get(after, b.first) != b.second)
+            changed.insert(b.first);
+    for (auto& a : after)
+        if (!before.count(a.first))
+            changed.insert(a.first);
+
+    // An unchanged declaration keeps its types unless it refers to a changed name.
+    std::set<const IR::Node*> old(checkedProgram->objects.begin(),
+                                  checkedProgram->objects.end());
+    std::map<const IR::Node*, std::set<cstring>> kept;  // with the names they use
+    for (auto decl : program->objects) {
+        if (!old.count(decl))
+            continue;
+        auto& uses = kept[decl];
+        forAllMatching<IR::Path>(decl, [&uses](const IR::Path* path) {
+            uses.insert(path->name.name); });
+    }
+    for (bool again = true; again; ) {
+        again = false;
+        for (auto it = kept.begin(); it != kept.end(); ) {
+            auto& uses = it->second;
+            bool stale = std::any_of(uses.begin(), uses.end(),
+                                     [&changed](cstring name) { return changed.count(name); });
+            if (stale) {
+                for (auto name : declaredNames(it->first))
+                    again |= changed.insert(name).second;
+                it = kept.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto decl : program->objects) {
+        if (!kept.count(decl))
+            forAllMatching<IR::Node>(decl, [this](const IR::Node* node) { forget(node); });
+    }
+    LOG2("TypeMap keeps the types of " << kept.size() << " of " <<
+         program->objects.size() << " declarations");
+    this->program = nullptr;
+    checkedProgram = nullptr;
+    invalidate();
+}
+
+void TypeMap::merge(const TypeMap& shard) {
+    BUG_CHECK(shard.parent == this, "Merging a type map that is not a shard of this one");
+    shard.nodeInfo.for_each([this](const IR::Node* node, const NodeInfo& i) {
+        if (i.type == nullptr && !i.leftValue && !i.constant)
+            return;
+        auto& mine = info(node);
+        if (i.type != nullptr && mine.type == nullptr) {
+            mine.type = i.type;
+            typeCount++;
+        }
+        mine.leftValue |= i.leftValue;
+        mine.constant |= i.constant; });
+    allTypeVariables.simpleCompose(&shard.newTypeVariables);
+    for (auto t : shard.canonicalTypes)
+        (void)getCanonical(t);
 }
 
 void TypeMap::checkPrecondition(const IR::Node* element, const IR::Type* type) const {
@@ -106,21 +275,27 @@ void TypeMap::checkPrecondition(const IR::Node* element, const IR::Type* type) c
 
 void TypeMap::setType(const IR::Node* element, const IR::Type* type) {
     checkPrecondition(element, type);
-    auto it = typeMap.find(element);
-    if (it != typeMap.end()) {
-        const IR::Type* existingType = it->second;
+    auto& i = info(element);
+    const IR::Type* existingType = i.type;
+    if (existingType == nullptr && parent != nullptr)
+        existingType = parent->getType(element);
+    if (existingType != nullptr) {
         if (!TypeMap::implicitlyConvertibleTo(type, existingType))
             BUG("Changing type of %1% in type map from %2% to %3%",
                 dbp(element), dbp(existingType), dbp(type));
         return;
     }
     LOG3("setType " << dbp(element) << " => " << dbp(type));
-    typeMap.emplace(element, type);
+    i.type = type;
+    typeCount++;
 }
 
 const IR::Type* TypeMap::getType(const IR::Node* element, bool notNull) const {
     CHECK_NULL(element);
-    auto result = get(typeMap, element);
+    auto i = nodeInfo.find(element);
+    auto result = i != nullptr ? i->type : nullptr;
+    if (result == nullptr && parent != nullptr)
+        result = parent->getType(element);
     LOG4("Looking up type for " << dbp(element) << " => " << dbp(result));
     if (notNull && result == nullptr)
         BUG_CHECK(errorCount() > 0, "Could not find type for %1%", dbp(element));
@@ -139,8 +314,11 @@ const IR::Type* TypeMap::getTypeType(const IR::Node* element, bool notNull) cons
 void TypeMap::addSubstitutions(const TypeVariableSubstitution* tvs) {
     if (tvs == nullptr || tvs->isIdentity())
         return;
+    checkNotFrozen();
     LOG3("New type variables " << tvs);
     allTypeVariables.simpleCompose(tvs);
+    if (parent != nullptr)
+        newTypeVariables.simpleCompose(tvs);
 }
 
 // Deep structural equivalence between canonical types.
@@ -188,6 +366,20 @@ bool TypeMap::equivalent(const IR::Type* left, const IR::Type* right) {
         auto re = right->to<IR::Type_SerEnum>();
         return le->name == re->name;
     }
+
+    // The remaining types are compared component by component; remember the result.
+    bool result;
+    auto& cache = EquivalenceCache::get();
+    if (cache.lookup(left, right, false, result))
+        return result;
+    auto errors = ::errorCount();
+    result = structurallyEquivalent(left, right);
+    if (::errorCount() == errors)
+        cache.store(left, right, false, result);
+    return result;
+}
+
+bool TypeMap::structurallyEquivalent(const IR::Type* left, const IR::Type* right) {
     if (auto sl = left->to<IR::Type_StructLike>()) {
         auto sr = right->to<IR::Type_StructLike>();
         if (sl->name != sr->name &&
@@ -314,6 +506,20 @@ bool TypeMap::equivalent(const IR::Type* left, const IR::Type* right) {
 bool TypeMap::implicitlyConvertibleTo(const IR::Type* from, const IR::Type* to) {
     if (TypeMap::equivalent(from, to))
         return true;
+    if (from == nullptr || to == nullptr)
+        return false;
+    bool result;
+    auto& cache = EquivalenceCache::get();
+    if (cache.lookup(from, to, true, result))
+        return result;
+    auto errors = ::errorCount();
+    result = implicitConversion(from, to);
+    if (::errorCount() == errors)
+        cache.store(from, to, true, result);
+    return result;
+}
+
+bool TypeMap::implicitConversion(const IR::Type* from, const IR::Type* to) {
     if (from->is<IR::Type_InfInt>() && to->is<IR::Type_InfInt>())
         // this case is not caught by the equivalence check
         return true;
@@ -345,24 +551,82 @@ bool TypeMap::implicitlyConvertibleTo(const IR::Type* from, const IR::Type* to)
     return false;
 }
 
-// Used for tuples, stacks and lists only
+// Hashes only what equivalent() compares, so that equivalent types hash alike.
+size_t TypeMap::canonicalHash(const IR::Type* type) {
+    if (type == nullptr)
+        return 0;
+    size_t result = std::hash<cstring>()(type->node_type_name());
+    auto add = [&result](size_t h) { result = Util::Hash::hash_combine(result, h); };
+    auto addParameters = [&add](const IR::Type_MethodBase* mt) {
+        for (auto tp : mt->typeParameters->parameters)
+            add(canonicalHash(tp));
+        add(canonicalHash(mt->returnType));
+        for (auto p : mt->parameters->parameters) {
+            add(static_cast<size_t>(p->direction));
+            add(canonicalHash(p->type));
+        } };
+
+    if (auto tb = type->to<IR::Type_Bits>()) {
+        add(tb->size);
+        add(tb->isSigned);
+    } else if (auto nt = type->to<IR::Type_Newtype>()) {
+        add(std::hash<cstring>()(nt->name.name));
+    } else if (type->is<IR::Type_Base>() || type->is<IR::Type_Error>()) {
+    } else if (auto tt = type->to<IR::Type_Type>()) {
+        add(canonicalHash(tt->type));
+    } else if (auto tv = type->to<IR::ITypeVar>()) {
+        add(std::hash<cstring>()(tv->getVarName()));
+        add(tv->getDeclId());
+    } else if (auto ts = type->to<IR::Type_Stack>()) {
+        add(canonicalHash(ts->elementType));
+        add(ts->sizeKnown() ? ts->getSize() : 0);
+    } else if (auto te = type->to<IR::Type_Enum>()) {
+        add(std::hash<cstring>()(te->name.name));
+    } else if (auto te = type->to<IR::Type_SerEnum>()) {
+        add(std::hash<cstring>()(te->name.name));
+    } else if (auto sl = type->to<IR::Type_StructLike>()) {
+        if (!sl->is<IR::Type_UnknownStruct>())
+            add(std::hash<cstring>()(sl->name.name));
+        for (auto f : sl->fields) {
+            add(std::hash<cstring>()(f->name.name));
+            add(canonicalHash(f->type));
+        }
+    } else if (auto bl = type->to<IR::Type_BaseList>()) {
+        for (auto t : bl->components)
+            add(canonicalHash(t));
+    } else if (auto set = type->to<IR::Type_Set>()) {
+        add(canonicalHash(set->elementType));
+    } else if (auto sc = type->to<IR::Type_SpecializedCanonical>()) {
+        add(canonicalHash(sc->substituted));
+    } else if (type->is<IR::Type_Method>() || type->is<IR::Type_Action>()) {
+        addParameters(type->to<IR::Type_MethodBase>());
+    } else if (auto te = type->to<IR::Type_Extern>()) {
+        add(std::hash<cstring>()(te->name.name));
+    }
+    // packages, parsers and controls are only told apart by equivalent()
+    return result;
+}
+
+// Used for tuples, lists, sets and stacks only
 const IR::Type* TypeMap::getCanonical(const IR::Type* type) {
-    // Currently a linear search; hopefully this won't be too expensive in practice
-    std::vector<const IR::Type*>* searchIn;
-    if (type->is<IR::Type_Stack>())
-        searchIn = &canonicalStacks;
-    else if (type->is<IR::Type_Tuple>())
-        searchIn = &canonicalTuples;
-    else if (type->is<IR::Type_List>())
-        searchIn = &canonicalLists;
-    else
-        BUG("%1%: unexpected type", type);
-
-    for (auto t : *searchIn) {
-        if (TypeMap::equivalent(type, t))
-            return t;
+    BUG_CHECK(type->is<IR::Type_Stack>() || type->is<IR::Type_BaseList>() ||
+              type->is<IR::Type_Set>(), "%1%: unexpected type", type);
+    auto h = canonicalHash(type);
+    if (parent != nullptr) {
+        auto range = parent->canonicalIndex.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (TypeMap::equivalent(type, it->second))
+                return it->second;
+        }
+    }
+    auto range = canonicalIndex.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (TypeMap::equivalent(type, it->second))
+            return it->second;
     }
-    searchIn->push_back(type);
+    checkNotFrozen();
+    canonicalTypes.push_back(type);
+    canonicalIndex.emplace(h, type);
     return type;
 }
 
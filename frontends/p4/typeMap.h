@@ -17,7 +17,10 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_TYPEMAP_H_
 #define _FRONTENDS_P4_TYPEMAP_H_
 
+#include <unordered_map>
+
 #include "ir/ir.h"
+#include "lib/epoch_map.h"
 #include "frontends/common/programMap.h"
 #include "frontends/p4/typeChecking/typeSubstitution.h"
 
@@ -40,48 +43,97 @@ Objects that have a type in the map:
 class TypeMap final : public ProgramMap {
  protected:
     // We want to have the same canonical type for two
-    // different tuples, lists, or stacks with the same signature.
-    std::vector<const IR::Type*> canonicalTuples;
-    std::vector<const IR::Type*> canonicalStacks;
-    std::vector<const IR::Type*> canonicalLists;
-
-    // Map each node to its canonical type
-    std::map<const IR::Node*, const IR::Type*> typeMap;
-    // All left-values in the program.
-    std::set<const IR::Expression*> leftValues;
-    // All compile-time constants.  A compile-time constant
-    // is not necessarily a constant - it could be a directionless
-    // parameter as well.
-    std::set<const IR::Expression*> constants;
+    // different tuples, lists, sets or stacks with the same signature.
+    // The canonical types in the order they were made, and indexed
+    // by canonicalHash, so that finding one is not a linear search.
+    std::vector<const IR::Type*> canonicalTypes;
+    std::unordered_multimap<size_t, const IR::Type*> canonicalIndex;
+
+    struct NodeInfo {
+        // The canonical type of the node, if it has one.
+        const IR::Type* type;
+        // The node is a left-value.
+        bool leftValue;
+        // The node is a compile-time constant.  A compile-time constant
+        // is not necessarily a constant - it could be a directionless
+        // parameter as well.
+        bool constant;
+    };
+    // Everything known about each node, in a single open-addressed table.
+    // The map is cleared (by ClearTypeMap) several times per front end run,
+    // which the epoch_map does in constant time, keeping its storage.
+    epoch_map<const IR::Node*, NodeInfo> nodeInfo;
+    // Number of nodes with a type.
+    size_t typeCount = 0;
+
+    NodeInfo& info(const IR::Node* node) {
+        checkNotFrozen();
+        return *nodeInfo.emplace(node, NodeInfo{nullptr, false, false}).first; }
     // For each type variable in the program the actual
     // type that is substituted for it.
     TypeVariableSubstitution allTypeVariables;
+    // The last program that type inference completed without errors or
+    // changes; the map has the types of all its nodes.
+    const IR::P4Program* checkedProgram = nullptr;
+    // The map a shard adds to; see TypeMap(const TypeMap*).
+    const TypeMap* parent = nullptr;
+    // The type variable bindings learned by a shard.
+    TypeVariableSubstitution newTypeVariables;
 
+    // Forget everything known about a node.
+    void forget(const IR::Node* node);
     // checks some preconditions before setting the type
     void checkPrecondition(const IR::Node* element, const IR::Type* type) const;
+    // The parts of equivalent() and implicitlyConvertibleTo() whose results are
+    // remembered.
+    static bool structurallyEquivalent(const IR::Type* left, const IR::Type* right);
+    static bool implicitConversion(const IR::Type* from, const IR::Type* to);
 
  public:
     TypeMap() : ProgramMap("TypeMap") {}
+    /// A shard of @parent, for inferring types concurrently with other shards.
+    /// Lookups fall back to @parent, which must not change while the shard is
+    /// in use; what is learned goes into the shard, until @parent merges it.
+    explicit TypeMap(const TypeMap* parent);
 
-    bool contains(const IR::Node* element) { return typeMap.count(element) != 0; }
+    bool contains(const IR::Node* element) const {
+        auto i = nodeInfo.find(element);
+        return (i != nullptr && i->type != nullptr) ||
+                (parent != nullptr && parent->contains(element)); }
     void setType(const IR::Node* element, const IR::Type* type);
     const IR::Type* getType(const IR::Node* element, bool notNull = false) const;
     // unwraps a TypeType into its contents
     const IR::Type* getTypeType(const IR::Node* element, bool notNull) const;
     void dbprint(std::ostream& out) const;
     void clear();
-    bool isLeftValue(const IR::Expression* expression) const
-    { return leftValues.count(expression) > 0; }
+    /// Record that the map has the types of all nodes of @node, if it is a program.
+    void setChecked(const IR::Node* node) {
+        checkNotFrozen();
+        if (auto program = node->to<IR::P4Program>())
+            checkedProgram = program; }
+    /// Like clear(), but keep the types of the top-level declarations of
+    /// @program that are unchanged since the last checked program and
+    /// refer only to declarations whose types are kept; type inference
+    /// then does not visit them again.  Clears the map if no program was
+    /// checked.
+    void clearChanged(const IR::P4Program* program);
+    /// Add everything the shard @shard of this map learned.  Merging the shards in
+    /// a fixed order gives the same map whichever order they were filled in.
+    void merge(const TypeMap& shard);
+    bool isLeftValue(const IR::Expression* expression) const {
+        auto i = nodeInfo.find(expression);
+        return (i != nullptr && i->leftValue) ||
+                (parent != nullptr && parent->isLeftValue(expression)); }
     bool isCompileTimeConstant(const IR::Expression* expression) const;
     size_t size() const
-    { return typeMap.size(); }
+    { return typeCount; }
 
     void setLeftValue(const IR::Expression* expression);
     void cloneExpressionProperties(const IR::Expression* to,
                                    const IR::Expression* from);
     void setCompileTimeConstant(const IR::Expression* expression);
     void addSubstitutions(const TypeVariableSubstitution* tvs);
-    const IR::Type* getSubstitution(const IR::Type_Var* var)
+    const IR::Type* getSubstitution(const IR::Type_Var* var) const
     { return allTypeVariables.lookup(var); }
     const TypeVariableSubstitution* getSubstitutions() const { return &allTypeVariables; }
 
@@ -92,7 +144,10 @@ class TypeMap final : public ProgramMap {
     /// is used when initializing a struct with a list expression.
     static bool implicitlyConvertibleTo(const IR::Type* from, const IR::Type* to);
 
-    // Used for tuples and stacks only
+    /// A hash of a canonical type that is the same for all types equivalent to it.
+    static size_t canonicalHash(const IR::Type* type);
+    /// The canonical type equivalent to @type, which becomes the canonical
+    /// one if there is none yet.  Used for tuples, lists, sets and stacks only.
     const IR::Type* getCanonical(const IR::Type* type);
     /// The minimum width in bits of this type.  If the width is not
     /// well-defined this will report an error and return -1.
@@ -25,6 +25,12 @@ Visitor::profile_t RemoveUnusedDeclarations::init_apply(const IR::Node* node) {
     return Transform::init_apply(node);
 }
 
+bool RemoveUnusedDeclarations::isUsed(const IR::IDeclaration* decl) const {
+    if (unused != nullptr)
+        return unused->isUsed(decl);
+    return refMap->isUsed(decl);
+}
+
 bool RemoveUnusedDeclarations::giveWarning(const IR::Node* node) {
     if (warned == nullptr)
         return false;
@@ -39,7 +45,7 @@ bool RemoveUnusedDeclarations::giveWarning(const IR::Node* node) {
 
 const IR::Node* RemoveUnusedDeclarations::preorder(IR::Type_Enum* type) {
     prune();  // never remove individual enum members
-    if (!refMap->isUsed(getOriginal<IR::Type_Enum>())) {
+    if (!isUsed(getOriginal<IR::Type_Enum>())) {
         LOG3("Removing " << type);
         return nullptr;
     }
@@ -48,7 +54,7 @@ const IR::Node* RemoveUnusedDeclarations::preorder(IR::Type_Enum* type) {
 
 const IR::Node* RemoveUnusedDeclarations::preorder(IR::Type_SerEnum* type) {
     prune();  // never remove individual enum members
-    if (!refMap->isUsed(getOriginal<IR::Type_SerEnum>())) {
+    if (!isUsed(getOriginal<IR::Type_SerEnum>())) {
         LOG3("Removing " << type);
         return nullptr;
     }
@@ -56,7 +62,7 @@ const IR::Node* RemoveUnusedDeclarations::preorder(IR::Type_SerEnum* type) {
 }
 
 const IR::Node* RemoveUnusedDeclarations::preorder(IR::P4Control* cont) {
-    if (!refMap->isUsed(getOriginal<IR::IDeclaration>())) {
+    if (!isUsed(getOriginal<IR::IDeclaration>())) {
         LOG3("Removing " << cont);
         prune();
         return nullptr;
@@ -69,7 +75,7 @@ const IR::Node* RemoveUnusedDeclarations::preorder(IR::P4Control* cont) {
 }
 
 const IR::Node* RemoveUnusedDeclarations::preorder(IR::P4Parser* cont) {
-    if (!refMap->isUsed(getOriginal<IR::IDeclaration>())) {
+    if (!isUsed(getOriginal<IR::IDeclaration>())) {
         LOG3("Removing " << cont);
         prune();
         return nullptr;
@@ -82,7 +88,7 @@ const IR::Node* RemoveUnusedDeclarations::preorder(IR::P4Parser* cont) {
 }
 
 const IR::Node* RemoveUnusedDeclarations::preorder(IR::P4Table* table) {
-    if (!refMap->isUsed(getOriginal<IR::IDeclaration>())) {
+    if (!isUsed(getOriginal<IR::IDeclaration>())) {
         if (giveWarning(getOriginal()))
             ::warning(ErrorType::WARN_UNUSED, "Table %1% is not used; removing", table);
         LOG3("Removing " << table);
@@ -108,27 +114,32 @@ const IR::Node* RemoveUnusedDeclarations::process(const IR::IDeclaration* decl)
     if (decl->getName().name.startsWith("__"))
         // Internal identifiers, e.g., __v1model_version
         return decl->getNode();
-    if (refMap->isUsed(getOriginal<IR::IDeclaration>()))
+    if (isUsed(getOriginal<IR::IDeclaration>()))
         return decl->getNode();
     LOG3("Removing " << getOriginal());
     prune();  // no need to go deeper
     return nullptr;
 }
 
+/// True if @decl is an instance of an extern type.
+static bool isExternInstance(const ReferenceMap* refMap, const IR::Declaration_Instance* decl) {
+    auto type = decl->type;
+    if (type->is<IR::Type_Specialized>())
+        type = type->to<IR::Type_Specialized>()->baseType;
+    if (type->is<IR::Type_Name>())
+        type = refMap->getDeclaration(type->to<IR::Type_Name>()->path, true)->to<IR::Type>();
+    return type->is<IR::Type_Extern>();
+}
+
 const IR::Node* RemoveUnusedDeclarations::preorder(IR::Declaration_Instance* decl) {
     // Don't delete instances; they may have consequences on the control-plane API
     if (decl->getName().name == IR::P4Program::main && getParent<IR::P4Program>())
         return decl;
-    if (!refMap->isUsed(getOriginal<IR::Declaration_Instance>())) {
+    if (!isUsed(getOriginal<IR::Declaration_Instance>())) {
         if (giveWarning(getOriginal()))
             ::warning(ErrorType::WARN_UNUSED, "%1%: unused instance", decl);
         // We won't delete extern instances; these may be useful even if not references.
-        auto type = decl->type;
-        if (type->is<IR::Type_Specialized>())
-            type = type->to<IR::Type_Specialized>()->baseType;
-        if (type->is<IR::Type_Name>())
-            type = refMap->getDeclaration(type->to<IR::Type_Name>()->path, true)->to<IR::Type>();
-        if (!type->is<IR::Type_Extern>())
+        if (!isExternInstance(refMap, decl))
             return process(decl);
         prune();
         return decl;
@@ -144,7 +155,7 @@ const IR::Node* RemoveUnusedDeclarations::preorder(IR::ParserState* state) {
         state->name == IR::ParserState::start)
         return state;
 
-    if (refMap->isUsed(getOriginal<IR::ParserState>()))
+    if (isUsed(getOriginal<IR::ParserState>()))
         return state;
     LOG3("Removing " << state);
     prune();
@@ -176,11 +187,154 @@ const IR::Node* RemoveUnusedDeclarations::preorder(IR::Method* method)
     if (ifSystemFile(method->getNode()))
         return method;
 
-    if (refMap->isUsed(getOriginal<IR::Method>()))
+    if (isUsed(getOriginal<IR::Method>()))
         return method;
     LOG3("Removing " << method);
     prune();
     return nullptr;
 }
 
+Visitor::profile_t FindUnusedDeclarations::init_apply(const IR::Node* node) {
+    candidates.clear();
+    references.clear();
+    removed.clear();
+    instances.clear();
+    warnings = false;
+    owners.clear();
+    scopes.clear();
+    hidden = 0;
+    return Inspector::init_apply(node);
+}
+
+bool FindUnusedDeclarations::enter(const IR::IDeclaration* decl) {
+    if (decl == nullptr || hidden != 0)
+        return false;
+    candidates[decl];
+    if (!owners.empty())
+        candidates.at(owners.back()).nested.push_back(decl);
+    owners.push_back(decl);
+    return true;
+}
+
+bool FindUnusedDeclarations::scan(const IR::Node* node, const IR::IDeclaration* decl,
+                                  bool hides) {
+    scopes.push_back(Scope{node, enter(decl), hides});
+    if (hides)
+        hidden++;
+    return true;
+}
+
+void FindUnusedDeclarations::postorder(const IR::Node* node) {
+    if (scopes.empty() || scopes.back().node != node)
+        return;
+    if (scopes.back().hides)
+        hidden--;
+    leave(scopes.back().candidate);
+    scopes.pop_back();
+}
+
+bool FindUnusedDeclarations::removable(const IR::IDeclaration* decl) const {
+    if (decl->getName().name == IR::ParserState::verify && getParent<IR::P4Program>())
+        return false;
+    return !decl->getName().name.startsWith("__");
+}
+
+void FindUnusedDeclarations::postorder(const IR::Path* path) {
+    auto decl = refMap->getDeclaration(path);
+    if (decl == nullptr)
+        return;
+    references[decl]++;
+    if (!owners.empty())
+        candidates.at(owners.back()).uses.push_back(decl);
+}
+
+bool FindUnusedDeclarations::preorder(const IR::P4Control* cont) {
+    bool candidate = enter(cont);
+    hidden++;
+    visit(cont->type, "type");
+    visit(cont->constructorParams, "constructorParams");
+    hidden--;
+    visit(cont->controlLocals, "controlLocals");
+    visit(cont->body, "body");
+    leave(candidate);
+    return false;
+}
+
+bool FindUnusedDeclarations::preorder(const IR::P4Parser* cont) {
+    bool candidate = enter(cont);
+    hidden++;
+    visit(cont->type, "type");
+    visit(cont->constructorParams, "constructorParams");
+    hidden--;
+    visit(cont->parserLocals, "parserLocals");
+    visit(cont->states, "states");
+    leave(candidate);
+    return false;
+}
+
+bool FindUnusedDeclarations::preorder(const IR::ParserState* state) {
+    if (state->name == IR::ParserState::accept ||
+        state->name == IR::ParserState::reject ||
+        state->name == IR::ParserState::start)
+        return true;
+    return scan(state, state, false);
+}
+
+bool FindUnusedDeclarations::preorder(const IR::Declaration_Instance* decl) {
+    if (decl->getName().name == IR::P4Program::main && getParent<IR::P4Program>())
+        return true;
+    if (hidden == 0 && (isExternInstance(refMap, decl) || !removable(decl))) {
+        instances.push_back(decl);
+        return scan(decl, nullptr, true);
+    }
+    return scan(decl, decl, true);
+}
+
+bool FindUnusedDeclarations::preorder(const IR::Method* method) {
+    if (RemoveUnusedDeclarations::ifSystemFile(method->getNode()))
+        return true;
+    return scan(method, method, false);
+}
+
+bool FindUnusedDeclarations::preorder(const IR::Declaration_Variable* decl) {
+    bool candidate = decl->initializer == nullptr ||
+            !SideEffects::check(decl->initializer, nullptr, nullptr);
+    return scan(decl, candidate && removable(decl) ? decl : nullptr, true);
+}
+
+void FindUnusedDeclarations::remove(const IR::IDeclaration* decl,
+                                    std::vector<const IR::IDeclaration*>& worklist) {
+    if (!removed.insert(decl).second)
+        return;
+    LOG3("Unused " << dbp(decl));
+    const auto& candidate = candidates.at(decl);
+    for (auto target : candidate.uses) {
+        if (--references.at(target) == 0 && candidates.count(target))
+            worklist.push_back(target);
+    }
+    for (auto nested : candidate.nested)
+        remove(nested, worklist);
+}
+
+void FindUnusedDeclarations::end_apply() {
+    std::vector<const IR::IDeclaration*> worklist;
+    for (auto& c : candidates)
+        if (references[c.first] == 0)
+            worklist.push_back(c.first);
+    while (!worklist.empty()) {
+        auto decl = worklist.back();
+        worklist.pop_back();
+        remove(decl, worklist);
+    }
+    for (auto decl : instances)
+        warnings |= !isUsed(decl);
+}
+
+bool FindUnusedDeclarations::isUsed(const IR::IDeclaration* decl) const {
+    if (removed.count(decl))
+        return false;
+    auto it = references.find(decl);
+    return it != references.end() && it->second != 0;
+}
+
 }  // namespace P4
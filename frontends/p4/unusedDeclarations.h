@@ -17,11 +17,17 @@ limitations under the License.
 #ifndef _P4_UNUSEDDECLARATIONS_H_
 #define _P4_UNUSEDDECLARATIONS_H_
 
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include "ir/ir.h"
 #include "../common/resolveReferences/resolveReferences.h"
 
 namespace P4 {
 
+class FindUnusedDeclarations;
+
 /** @brief Removes unused declarations.
  *
  * The following kinds of nodes are not removed even if they are unreferenced:
@@ -42,10 +48,14 @@ namespace P4 {
  * compilation warning is emitted when a new node is added to @warned,
  * preventing duplicate warnings per node.
  *
+ * If @unused is non-null, the declarations it reports as unused are removed
+ * instead of the ones the ReferenceMap has no references to.
+ *
  * @pre Requires an up-to-date ReferenceMap.
  */
 class RemoveUnusedDeclarations : public Transform {
     const ReferenceMap* refMap;
+    const FindUnusedDeclarations* unused;
 
     /** If not null, logs the following unused elements in @warn:
      *  - unused IR::P4Table nodes
@@ -61,12 +71,14 @@ class RemoveUnusedDeclarations : public Transform {
      * @return true if @node is added to @warned.
      */
     bool giveWarning(const IR::Node* node);
+    bool isUsed(const IR::IDeclaration* decl) const;
     const IR::Node* process(const IR::IDeclaration* decl);
 
  public:
     explicit RemoveUnusedDeclarations(const ReferenceMap* refMap,
-                                      std::set<const IR::Node*>* warned = nullptr) :
-            refMap(refMap), warned(warned)
+                                      std::set<const IR::Node*>* warned = nullptr,
+                                      const FindUnusedDeclarations* unused = nullptr) :
+            refMap(refMap), unused(unused), warned(warned)
     { CHECK_NULL(refMap); setName("RemoveUnusedDeclarations"); }
 
     using Transform::postorder;
@@ -103,11 +115,110 @@ class RemoveUnusedDeclarations : public Transform {
     const IR::Node* preorder(IR::Declaration_Variable* decl)  override;
     const IR::Node* preorder(IR::Declaration* decl) override { return process(decl); }
     const IR::Node* preorder(IR::Type_Declaration* decl) override { return process(decl); }
-    bool isSystemFile(cstring file);
-    cstring ifSystemFile(const IR::Node* node);  // return file containing node if system file
+    static bool isSystemFile(cstring file);
+    // return file containing node if system file
+    static cstring ifSystemFile(const IR::Node* node);
 };
 
-/** @brief Iterates RemoveUnusedDeclarations until convergence.
+/** @brief Computes, in one traversal, the declarations that iterating
+ * ResolveReferences and RemoveUnusedDeclarations until convergence would remove.
+ *
+ * Every declaration that RemoveUnusedDeclarations may remove is a
+ * "candidate"; every path is owned by the innermost candidate that
+ * contains it.  A candidate is unused when no path owned by a remaining
+ * declaration refers to it, or when the candidate containing it is unused;
+ * removing a candidate releases the references of the paths it owns, which
+ * may make further candidates unused.  Declarations that only refer to each
+ * other stay, exactly as they do when the passes are iterated.
+ *
+ * The choice of candidates mirrors the preorders of RemoveUnusedDeclarations.
+ *
+ * @pre Requires an up-to-date ReferenceMap.
+ */
+class FindUnusedDeclarations : public Inspector {
+    const ReferenceMap* refMap;
+
+    struct Candidate {
+        std::vector<const IR::IDeclaration*> uses;    // targets of the paths it owns
+        std::vector<const IR::IDeclaration*> nested;  // candidates it contains
+    };
+    std::unordered_map<const IR::IDeclaration*, Candidate> candidates;
+    /// Number of paths owned by the program or a remaining candidate referring to each
+    /// declaration.
+    std::unordered_map<const IR::IDeclaration*, unsigned> references;
+    std::unordered_set<const IR::IDeclaration*> removed;
+    /// Instances that are kept even if they are unused.
+    std::vector<const IR::IDeclaration*> instances;
+    bool warnings = false;
+
+    /// Candidates containing the current node, innermost last.
+    std::vector<const IR::IDeclaration*> owners;
+    /// Number of enclosing nodes that RemoveUnusedDeclarations does not look into.
+    unsigned hidden = 0;
+    /// Nodes being visited that enter() a candidate or are hidden; closed in postorder.
+    struct Scope {
+        const IR::Node* node;
+        bool candidate;
+        bool hides;
+    };
+    std::vector<Scope> scopes;
+
+    bool enter(const IR::IDeclaration* decl);
+    void leave(bool candidate) { if (candidate) owners.pop_back(); }
+    /// Open a scope for @node, whose declaration @decl is a candidate if it is not
+    /// null; @hides is true if RemoveUnusedDeclarations prunes @node.
+    bool scan(const IR::Node* node, const IR::IDeclaration* decl, bool hides);
+    /// The checks in RemoveUnusedDeclarations::process.
+    bool removable(const IR::IDeclaration* decl) const;
+    void remove(const IR::IDeclaration* decl, std::vector<const IR::IDeclaration*>& worklist);
+
+ public:
+    explicit FindUnusedDeclarations(const ReferenceMap* refMap) : refMap(refMap)
+    { CHECK_NULL(refMap); visitDagOnce = false; setName("FindUnusedDeclarations"); }
+
+    /// True if @decl is referenced by a declaration that is not removed.
+    bool isUsed(const IR::IDeclaration* decl) const;
+    /// True if RemoveUnusedDeclarations would change the program or give warnings.
+    bool changes() const { return !removed.empty() || warnings; }
+
+    Visitor::profile_t init_apply(const IR::Node* node) override;
+    void end_apply() override;
+
+    void postorder(const IR::Path* path) override;
+    void postorder(const IR::Node* node) override;
+
+    bool preorder(const IR::P4Control* cont) override;
+    bool preorder(const IR::P4Parser* cont) override;
+    bool preorder(const IR::P4Table* table) override { return scan(table, table, true); }
+    bool preorder(const IR::ParserState* state) override;
+    bool preorder(const IR::Type_Enum* type) override { return scan(type, type, true); }
+    bool preorder(const IR::Type_SerEnum* type) override { return scan(type, type, true); }
+    bool preorder(const IR::Declaration_Instance* decl) override;
+    bool preorder(const IR::Method* method) override;
+
+    bool preorder(const IR::Type_Error* type) override { return scan(type, nullptr, true); }
+    bool preorder(const IR::Declaration_MatchKind* decl) override
+    { return scan(decl, nullptr, true); }
+    bool preorder(const IR::Type_StructLike* type) override { return scan(type, nullptr, true); }
+    bool preorder(const IR::Type_Extern* type) override { return scan(type, nullptr, true); }
+    bool preorder(const IR::Type_Method* type) override { return scan(type, nullptr, true); }
+    bool preorder(const IR::Parameter*) override { return true; }
+    bool preorder(const IR::NamedExpression*) override { return true; }
+    bool preorder(const IR::TypeParameters* p) override { return scan(p, nullptr, true); }
+
+    bool preorder(const IR::Declaration_Variable* decl) override;
+    bool preorder(const IR::Declaration* decl) override
+    { return scan(decl, removable(decl) ? decl : nullptr, false); }
+    bool preorder(const IR::Type_Declaration* decl) override
+    { return scan(decl, removable(decl) ? decl : nullptr, false); }
+};
+
+/** @brief Removes unused declarations until convergence.
+ *
+ * The declarations are resolved once, FindUnusedDeclarations computes
+ * everything that becomes unused, and a single RemoveUnusedDeclarations
+ * removes it; the result is the same as iterating ResolveReferences and
+ * RemoveUnusedDeclarations.  The ReferenceMap is up to date afterwards.
  *
  * If @warn is true, emit compiler warnings if an unused instance of an
  * IR::P4Table or IR::Declaration_Instance is removed.
@@ -119,16 +230,19 @@ class RemoveAllUnusedDeclarations : public PassManager {
 
         // Unused extern instances are not removed but may still trigger
         // warnings.  The @warned set keeps track of warnings emitted in
-        // previous iterations to avoid emitting duplicate warnings.
+        // previous applications to avoid emitting duplicate warnings.
         std::set<const IR::Node*> *warned = nullptr;
         if (warn)
             warned = new std::set<const IR::Node*>();
 
+        auto unused = new FindUnusedDeclarations(refMap);
+        passes.emplace_back(new ResolveReferences(refMap));
+        passes.emplace_back(unused);
         passes.emplace_back(
-            new PassRepeated {
-                new ResolveReferences(refMap),
-                new RemoveUnusedDeclarations(refMap, warned)
-             });
+            new PassIf([unused]() { return unused->changes(); }, {
+                new RemoveUnusedDeclarations(refMap, warned, unused),
+                new ResolveReferences(refMap)
+             }));
         setName("RemoveAllUnusedDeclarations");
         setStopOnError(true);
     }
@@ -6,6 +6,9 @@
 
 namespace P4 {
 
+/// The constant of an INTEGER token of an annotation body.
+UnparsedConstant unparsedConstant(const IR::AnnotationToken* token);
+
 class P4AnnotationLexer : public AbstractP4Lexer {
  public:
     enum Type {
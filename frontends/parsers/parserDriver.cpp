@@ -1,6 +1,7 @@
 #include "parserDriver.h"
 
 #include <cerrno>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
 #include <sstream>
@@ -9,6 +10,7 @@
 #include <boost/format.hpp>
 
 
+#include "frontends/common/constantParsing.h"
 #include "frontends/common/options.h"
 #include "frontends/common/constantFolding.h"
 #include "frontends/parsers/p4/p4lexer.hpp"
@@ -17,6 +19,7 @@
 #include "frontends/parsers/v1/v1lexer.hpp"
 #include "frontends/parsers/v1/v1parser.hpp"
 #include "lib/error.h"
+#include "lib/gc.h"
 
 
 #ifdef HAVE_LIBBOOST_IOSTREAMS
@@ -149,10 +152,12 @@ P4ParserDriver::parse(AbstractP4Lexer& lexer, const char* sourceFile,
 
 /* static */ const IR::P4Program*
 P4ParserDriver::parse(std::istream& in, const char* sourceFile,
-                      unsigned sourceLine /* = 1 */) {
+                      unsigned sourceLine /* = 1 */,
+                      const IR::Vector<IR::Node>* prelude /* = nullptr */) {
     LOG1("Parsing P4-16 program " << sourceFile);
 
     P4ParserDriver driver;
+    if (prelude) driver.declarePrelude(*prelude);
     P4Lexer lexer(in);
     if (!driver.parse(lexer, sourceFile, sourceLine)) return nullptr;
     return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
@@ -179,123 +184,246 @@ P4ParserDriver::parse(P4AnnotationLexer::Type type,
     return nodes->front()->to<T>();
 }
 
+/* static */ P4ParserDriver*& P4ParserDriver::annotationDriver() {
+    static thread_local P4ParserDriver* driver = nullptr;
+    return driver;
+}
+
+template<typename T> /* static */ const T*
+P4ParserDriver::parseAnnotation(P4AnnotationLexer::Type type,
+                                const Util::SourceInfo& srcInfo,
+                                const IR::Vector<IR::AnnotationToken>& body) {
+    if (auto* simple = parseSimpleAnnotation(type, body))
+        return simple->to<T>();
+
+    // a root, as nothing the collector scans points to it
+    auto*& driver = annotationDriver();
+    if (!driver)
+        driver = new(gc_alloc_root(sizeof(P4ParserDriver))) P4ParserDriver;
+    driver->nodes->clear();
+    if (auto* rv = driver->parse<T>(type, srcInfo, body))
+        return rv;
+    driver->~P4ParserDriver();
+    gc_free_root(driver);
+    driver = nullptr;
+    return nullptr;
+}
+
+/* static */ const IR::Node*
+P4ParserDriver::parseSimpleAnnotation(P4AnnotationLexer::Type type,
+                                      const IR::Vector<IR::AnnotationToken>& body) {
+    // The kinds of literal that may be elements of the body, and how many elements it
+    // may have; lists need at least one, except lists of expressions, which may be empty.
+    bool integers = false, strings = false, booleans = false;
+    size_t minimum = 1, maximum = 1;
+    bool singleton = false;
+    switch (type) {
+    case P4AnnotationLexer::EXPRESSION_LIST:
+        minimum = 0;
+        maximum = SIZE_MAX;
+        integers = strings = booleans = true;
+        break;
+    case P4AnnotationLexer::INTEGER_LIST:
+        maximum = SIZE_MAX;
+        integers = true;
+        break;
+    case P4AnnotationLexer::INTEGER_OR_STRING_LITERAL_LIST:
+        maximum = SIZE_MAX;
+        integers = strings = true;
+        break;
+    case P4AnnotationLexer::STRING_LITERAL_LIST:
+        maximum = SIZE_MAX;
+        strings = true;
+        break;
+    case P4AnnotationLexer::EXPRESSION:
+        singleton = integers = strings = booleans = true;
+        break;
+    case P4AnnotationLexer::INTEGER:
+        singleton = integers = true;
+        break;
+    case P4AnnotationLexer::INTEGER_OR_STRING_LITERAL:
+        singleton = integers = strings = true;
+        break;
+    case P4AnnotationLexer::STRING_LITERAL:
+        singleton = strings = true;
+        break;
+    case P4AnnotationLexer::EXPRESSION_PAIR:
+        minimum = maximum = 2;
+        integers = strings = booleans = true;
+        break;
+    case P4AnnotationLexer::INTEGER_PAIR:
+        minimum = maximum = 2;
+        integers = true;
+        break;
+    case P4AnnotationLexer::STRING_LITERAL_PAIR:
+        minimum = maximum = 2;
+        strings = true;
+        break;
+    case P4AnnotationLexer::EXPRESSION_TRIPLE:
+        minimum = maximum = 3;
+        integers = strings = booleans = true;
+        break;
+    case P4AnnotationLexer::INTEGER_TRIPLE:
+        minimum = maximum = 3;
+        integers = true;
+        break;
+    case P4AnnotationLexer::STRING_LITERAL_TRIPLE:
+        minimum = maximum = 3;
+        strings = true;
+        break;
+    default:
+        return nullptr;
+    }
+
+    // The tokens are literals at the even positions and commas at the odd ones.
+    size_t count = (body.size() + 1) / 2;
+    if ((body.size() && body.size() % 2 == 0) || count < minimum || count > maximum)
+        return nullptr;
+    for (size_t i = 1; i < body.size(); i += 2)
+        if (body[i]->token_type != P4Parser::token_type::TOK_COMMA)
+            return nullptr;
+
+    // Check all the tokens first, so only the nodes that are returned are made.
+    for (size_t i = 0; i < body.size(); i += 2) {
+        switch (body[i]->token_type) {
+        case P4Parser::token_type::TOK_INTEGER:
+            if (!integers || !body[i]->constInfo) return nullptr;
+            break;
+        case P4Parser::token_type::TOK_STRING_LITERAL:
+            if (!strings) return nullptr;
+            break;
+        case P4Parser::token_type::TOK_TRUE:
+        case P4Parser::token_type::TOK_FALSE:
+            if (!booleans) return nullptr;
+            break;
+        default:
+            return nullptr;
+        }
+    }
+
+    // The same nodes as the rules of the grammar for these tokens.
+    auto* result = new IR::Vector<IR::Expression>();
+    for (size_t i = 0; i < body.size(); i += 2) {
+        auto* token = body[i];
+        switch (token->token_type) {
+        case P4Parser::token_type::TOK_INTEGER:
+            result->push_back(::parseConstant(token->srcInfo, unparsedConstant(token), 0));
+            break;
+        case P4Parser::token_type::TOK_STRING_LITERAL:
+            result->push_back(new IR::StringLiteral(token->srcInfo, token->text));
+            break;
+        default:
+            result->push_back(new IR::BoolLiteral(
+                token->srcInfo, token->token_type == P4Parser::token_type::TOK_TRUE));
+            break;
+        }
+    }
+    if (singleton) return result->front();
+    return result;
+}
+
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseExpressionList(const Util::SourceInfo& srcInfo,
                                     const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::EXPRESSION_LIST, srcInfo, body);
 }
 
 /* static */ const IR::IndexedVector<IR::NamedExpression>*
 P4ParserDriver::parseKvList(const Util::SourceInfo& srcInfo,
                             const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::IndexedVector<IR::NamedExpression>>(
+    return parseAnnotation<IR::IndexedVector<IR::NamedExpression>>(
             P4AnnotationLexer::KV_LIST, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseConstantList(const Util::SourceInfo& srcInfo,
                                   const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::INTEGER_LIST, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseConstantOrStringLiteralList(const Util::SourceInfo& srcInfo,
                                                  const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::INTEGER_OR_STRING_LITERAL_LIST, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseStringLiteralList(const Util::SourceInfo& srcInfo,
                                        const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::STRING_LITERAL_LIST, srcInfo, body);
 }
 
 /* static */ const IR::Expression*
 P4ParserDriver::parseExpression(const Util::SourceInfo& srcInfo,
                                 const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Expression>(
+    return parseAnnotation<IR::Expression>(
             P4AnnotationLexer::EXPRESSION, srcInfo, body);
 }
 
 /* static */ const IR::Constant*
 P4ParserDriver::parseConstant(const Util::SourceInfo& srcInfo,
                               const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Constant>(
+    return parseAnnotation<IR::Constant>(
             P4AnnotationLexer::INTEGER, srcInfo, body);
 }
 
 /* static */ const IR::Expression*
 P4ParserDriver::parseConstantOrStringLiteral(const Util::SourceInfo& srcInfo,
                                              const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Expression>(
+    return parseAnnotation<IR::Expression>(
             P4AnnotationLexer::INTEGER_OR_STRING_LITERAL, srcInfo, body);
 }
 
 /* static */ const IR::StringLiteral*
 P4ParserDriver::parseStringLiteral(const Util::SourceInfo& srcInfo,
                                    const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::StringLiteral>(
+    return parseAnnotation<IR::StringLiteral>(
             P4AnnotationLexer::STRING_LITERAL, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseExpressionPair(const Util::SourceInfo& srcInfo,
                                     const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::EXPRESSION_PAIR, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseConstantPair(const Util::SourceInfo& srcInfo,
                                   const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::INTEGER_PAIR, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseStringLiteralPair(const Util::SourceInfo& srcInfo,
                                        const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::STRING_LITERAL_PAIR, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseExpressionTriple(const Util::SourceInfo& srcInfo,
                                      const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::EXPRESSION_TRIPLE, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseConstantTriple(const Util::SourceInfo& srcInfo,
                                     const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::INTEGER_TRIPLE, srcInfo, body);
 }
 
 /* static */ const IR::Vector<IR::Expression>*
 P4ParserDriver::parseStringLiteralTriple(const Util::SourceInfo& srcInfo,
                                          const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::STRING_LITERAL_TRIPLE, srcInfo, body);
 }
 
@@ -303,11 +431,22 @@ P4ParserDriver::parseStringLiteralTriple(const Util::SourceInfo& srcInfo,
 P4ParserDriver::parseP4rtTranslationAnnotation(
     const Util::SourceInfo& srcInfo,
     const IR::Vector<IR::AnnotationToken>& body) {
-    P4ParserDriver driver;
-    return driver.parse<IR::Vector<IR::Expression>>(
+    return parseAnnotation<IR::Vector<IR::Expression>>(
             P4AnnotationLexer::P4RT_TRANSLATION_ANNOTATION, srcInfo, body);
 }
 
+void P4ParserDriver::declarePrelude(const IR::Vector<IR::Node>& prelude) {
+    for (auto node : prelude) {
+        if (auto error = node->to<IR::Type_Error>()) {
+            // later error declarations are merged into this one
+            onReadErrorDeclaration(error->clone());
+            continue; }
+        bool declared = structure->declareParsed(node);
+        BUG_CHECK(declared, "%1%: cannot be declared in a prelude", node);
+        nodes->push_back(node);
+    }
+}
+
 void P4ParserDriver::onReadErrorDeclaration(IR::Type_Error* error) {
     if (allErrors == nullptr) {
         nodes->push_back(error);
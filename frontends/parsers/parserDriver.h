@@ -96,6 +96,11 @@ class AbstractParserDriver {
 };
 
 /// A ParserDriver that can parse P4-16 programs.
+///
+/// Each parse has its own driver, lexer and InputSources, and reports its errors to the
+/// compilation context current on its thread, so programs and annotation bodies can
+/// be parsed on several threads at once; parse with the diagnostics kept back (see
+/// ErrorReporter::Deferred) to report them in a fixed order.
 class P4ParserDriver final : public AbstractParserDriver {
  public:
     /**
@@ -109,10 +114,14 @@ class P4ParserDriver final : public AbstractParserDriver {
      * @param sourceLine  The logical source line number. For programs parsed
      *                    from a file, this will normally be 1. This is used to
      *                    set the initial source location.
+     * @param prelude  Top-level declarations parsed earlier, which go first in the
+     *                 program and are in scope for the source read from @in (see
+     *                 precompiledIncludes.h).
      * @returns a P4Program object if parsing was successful, or null otherwise.
      */
     static const IR::P4Program* parse(std::istream& in, const char* sourceFile,
-                                      unsigned sourceLine = 1);
+                                      unsigned sourceLine = 1,
+                                      const IR::Vector<IR::Node>* prelude = nullptr);
     static const IR::P4Program* parse(FILE* in, const char* sourceFile,
                                       unsigned sourceLine = 1);
 
@@ -198,6 +207,9 @@ class P4ParserDriver final : public AbstractParserDriver {
     /// Notify that the parser parsed a P4 `error` declaration.
     void onReadErrorDeclaration(IR::Type_Error* error);
 
+    /// Add the declarations of a prelude to the program and the program structure.
+    void declarePrelude(const IR::Vector<IR::Node>& prelude);
+
     ////////////////////////////////////////////////////////////////////////////
     // Shared state manipulated directly by the lexer and parser.
     ////////////////////////////////////////////////////////////////////////////
@@ -229,6 +241,23 @@ class P4ParserDriver final : public AbstractParserDriver {
                                         const Util::SourceInfo& srcInfo,
                                         const IR::Vector<IR::AnnotationToken>& body);
 
+    /// Parse an annotation body of @type: without the parser if it is only literals
+    /// (see parseSimpleAnnotation), and otherwise with the annotation driver of this
+    /// thread, which is reused for all the annotation bodies it parses.
+    template<typename T> static const T* parseAnnotation(
+        P4AnnotationLexer::Type type, const Util::SourceInfo& srcInfo,
+        const IR::Vector<IR::AnnotationToken>& body);
+
+    /// @returns the node the parser would make for an annotation body of @type made
+    /// only of integer, string or boolean literals separated by commas, or null if
+    /// @body is anything else.
+    static const IR::Node* parseSimpleAnnotation(P4AnnotationLexer::Type type,
+                                                 const IR::Vector<IR::AnnotationToken>& body);
+
+    /// The driver that parseAnnotation reuses in this thread, or null before the first
+    /// use and after a parse that failed, which may leave it in any state.
+    static P4ParserDriver*& annotationDriver();
+
     /// All P4 `error` declarations are merged together in the node, which is
     /// lazily created the first time we see an `error` declaration. (This node
     /// is present in @declarations as well.)
@@ -242,7 +271,7 @@ namespace V1 {
 class V1Lexer;
 class V1Parser;
 
-/// A ParserDriver that can parse P4-14 programs.
+/// A ParserDriver that can parse P4-14 programs, reentrant as P4ParserDriver is.
 class V1ParserDriver final : public P4::AbstractParserDriver {
  public:
     /**
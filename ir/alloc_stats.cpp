@@ -0,0 +1,175 @@
+#include "alloc_stats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <new>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+#include "ir/node.h"
+#include "lib/error.h"
+#include "lib/gc.h"
+#include "lib/n4.h"
+
+namespace IR {
+
+bool AllocStats::enabled = false;
+
+namespace {
+
+struct class_counts_t {
+    size_t      count = 0;
+    size_t      clones = 0;
+    size_t      bytes = 0;
+};
+
+struct pass_counts_t {
+    size_t      allocations = 0;   // all operator new calls
+    size_t      allocated = 0;     // and their bytes
+    size_t      nodes = 0;
+    size_t      node_bytes = 0;
+    std::map<cstring, class_counts_t> classes;
+};
+
+struct thread_state_t {
+    struct created_t {
+        const Node      *node;
+        size_t          size;
+        bool            clone;
+    };
+    std::vector<std::pair<void *, size_t>>      allocating;  // not yet constructed
+    std::vector<created_t>                      created;     // not yet classified
+    std::vector<cstring>                        passes;      // innermost last
+    size_t                                      allocations = 0;
+    size_t                                      allocated = 0;
+};
+
+std::map<cstring, pass_counts_t> histogram;
+std::ofstream *output = nullptr;
+#ifdef MULTITHREAD
+std::mutex histogram_lock;
+#endif  // MULTITHREAD
+
+/// The state of the calling thread.  It is in memory the collector scans, so the nodes it
+/// points to stay alive until they have been classified.
+thread_state_t &state() {
+    static thread_local thread_state_t *rv = nullptr;
+    if (!rv) {
+        rv = new(gc_alloc_root(sizeof(thread_state_t))) thread_state_t;
+        rv->allocations = gc_allocation_count(&rv->allocated); }
+    return *rv;
+}
+
+/// Charge what the thread allocated since the last call to its innermost pass.
+void flush(thread_state_t &st) {
+    size_t allocated, allocations = gc_allocation_count(&allocated);
+    cstring pass = st.passes.empty() ? cstring("(no pass)") : st.passes.back();
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(histogram_lock);
+#endif  // MULTITHREAD
+    auto &counts = histogram[pass];
+    counts.allocations += allocations - st.allocations;
+    counts.allocated += allocated - st.allocated;
+    st.allocations = allocations;
+    st.allocated = allocated;
+    for (auto &c : st.created) {
+        auto &cls = counts.classes[c.node->node_type_name()];
+        ++cls.count;
+        cls.bytes += c.size;
+        if (c.clone) ++cls.clones;
+        ++counts.nodes;
+        counts.node_bytes += c.size; }
+    st.created.clear();
+}
+
+void write_at_exit() {
+    if (!output) return;
+    AllocStats::write(*output);
+    output->close();
+    output = nullptr;
+}
+
+}  // namespace
+
+void AllocStats::open(const char *filename) {
+    auto *out = new std::ofstream(filename);
+    if (!*out) {
+        ::error(ErrorType::ERR_IO, "Cannot open allocation histogram file %1%", filename);
+        return; }
+    if (!output) atexit(write_at_exit);
+    output = out;
+    enabled = true;
+    gc_count_allocations(true);
+}
+
+void AllocStats::allocated(void *p, size_t size) {
+    state().allocating.emplace_back(p, size);
+}
+
+void AllocStats::released(void *p) {
+    // happens when a constructor throws, so p is (nearly) always the last one allocated,
+    // or when a Transform deletes an unused clone, which is nearly always the last created
+    auto &st = state();
+    for (auto it = st.allocating.rbegin(); it != st.allocating.rend(); ++it)
+        if (it->first == p) {
+            st.allocating.erase(std::next(it).base());
+            return; }
+    for (auto it = st.created.rbegin(); it != st.created.rend(); ++it)
+        if (it->node == p) {
+            st.created.erase(std::next(it).base());
+            return; }
+}
+
+void AllocStats::created(const Node *node, bool clone) {
+    // Allocation and construction nest, so the node being constructed is the last one
+    // allocated -- unless it has no allocation of its own.
+    auto &st = state();
+    if (st.allocating.empty() || st.allocating.back().first != node) return;
+    st.created.push_back({ node, st.allocating.back().second, clone });
+    st.allocating.pop_back();
+}
+
+void AllocStats::enterPass(const char *name) {
+    auto &st = state();
+    flush(st);
+    st.passes.push_back(name);
+}
+
+void AllocStats::leavePass() {
+    auto &st = state();
+    flush(st);
+    if (!st.passes.empty()) st.passes.pop_back();
+}
+
+void AllocStats::write(std::ostream &out) {
+    flush(state());
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(histogram_lock);
+#endif  // MULTITHREAD
+    std::vector<std::pair<cstring, const pass_counts_t *>> passes;
+    for (auto &p : histogram) passes.emplace_back(p.first, &p.second);
+    std::stable_sort(passes.begin(), passes.end(), [](
+            const std::pair<cstring, const pass_counts_t *> &a,
+            const std::pair<cstring, const pass_counts_t *> &b) {
+        return a.second->node_bytes > b.second->node_bytes; });
+    for (auto &p : passes) {
+        auto &counts = *p.second;
+        if (counts.nodes == 0 && counts.allocations == 0) continue;
+        out << p.first << ": " << counts.nodes << " nodes, " << n4(counts.node_bytes) << "B; "
+            << counts.allocations << " allocations, " << n4(counts.allocated) << "B"
+            << std::endl;
+        std::vector<std::pair<cstring, class_counts_t>> classes(counts.classes.begin(),
+                                                                counts.classes.end());
+        std::stable_sort(classes.begin(), classes.end(), [](
+                const std::pair<cstring, class_counts_t> &a,
+                const std::pair<cstring, class_counts_t> &b) {
+            return a.second.bytes > b.second.bytes; });
+        for (auto &c : classes)
+            out << "    " << c.first << ": " << c.second.count << " nodes ("
+                << c.second.clones << " clones), " << n4(c.second.bytes) << "B" << std::endl; }
+}
+
+}  // namespace IR
@@ -0,0 +1,44 @@
+#ifndef _IR_ALLOC_STATS_H_
+#define _IR_ALLOC_STATS_H_
+
+#include <cstddef>
+#include <iosfwd>
+
+namespace IR {
+
+class Node;
+
+/**
+ * Counts the IR nodes created by each pass, by node class, with their bytes and how many
+ * of them are clones of another node, along with all the allocations made with operator
+ * new (when built with libgc).  Enabled by --alloc-histogram, which writes the
+ * histogram to a file at exit.
+ *
+ * Counts are attributed to the innermost pass running on the thread, so a PassManager is
+ * only charged with what it allocates itself.  Nodes are counted as they are allocated,
+ * but only classified at the next pass boundary, once they have been fully constructed;
+ * until then they are kept alive.  Nodes that are not allocated on their own (on the
+ * stack, or as a member of another node), and nodes deleted before they are classified,
+ * are not counted.
+ */
+class AllocStats {
+ public:
+    static bool enabled;
+
+    /// Start counting, and write the histogram to @filename at exit.
+    static void open(const char *filename);
+
+    // Hooks for IR::Node and Visitor::profile_t; only called when enabled
+    static void allocated(void *p, size_t size);
+    static void released(void *p);
+    static void created(const Node *node, bool clone);
+    static void enterPass(const char *name);
+    static void leavePass();
+
+    /// Write the histogram gathered so far.
+    static void write(std::ostream &out);
+};
+
+}  // namespace IR
+
+#endif /* _IR_ALLOC_STATS_H_ */
@@ -0,0 +1,51 @@
+#include "binary_generator.h"
+
+static const char BINARY_IR_MAGIC[8] = { 'P', '4', 'I', 'R', 'B', 'I', 'N', 0 };
+
+static void put_u32(std::ostream &out, uint32_t v) {
+    for (int i = 0; i < 32; i += 8) out.put(static_cast<char>(v >> i));
+}
+
+static void put_u64(std::ostream &out, uint64_t v) {
+    for (int i = 0; i < 64; i += 8) out.put(static_cast<char>(v >> i));
+}
+
+void BinaryGenerator::write(const IR::Node *root, std::ostream &out) {
+    std::string data;
+    std::vector<uint64_t> node_offsets, string_offsets;
+    node(root);  // root is node 0
+    buf.clear();
+    // nodes grows as the records refer to nodes not yet seen
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        auto *n = nodes[i];
+        node_offsets.push_back(HEADER_SIZE + data.size());
+        string(n->node_type_name());
+        n->toBinary(*this);
+        if (dumpSourceInfo)
+            n->sourceInfoToBinary(*this);
+        else
+            generate(false);
+        data += buf;
+        buf.clear(); }
+    for (auto s : strings) {
+        string_offsets.push_back(HEADER_SIZE + data.size());
+        varint(s.size());
+        buf.append(s.c_str(), s.size());
+        data += buf;
+        buf.clear(); }
+
+    uint64_t string_table = HEADER_SIZE + data.size();
+    uint64_t node_table = string_table + 8 * string_offsets.size();
+    out.write(BINARY_IR_MAGIC, sizeof(BINARY_IR_MAGIC));
+    put_u32(out, VERSION);
+    put_u32(out, nodes.size());
+    put_u64(out, IR::binary_schema);
+    put_u32(out, strings.size());
+    put_u32(out, 0);
+    put_u64(out, string_table);
+    put_u64(out, node_table);
+    out.write(data.data(), data.size());
+    for (auto off : string_offsets) put_u64(out, off);
+    for (auto off : node_offsets) put_u64(out, off);
+    out.flush();
+}
@@ -0,0 +1,214 @@
+#ifndef _IR_BINARY_GENERATOR_H_
+#define _IR_BINARY_GENERATOR_H_
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "frontends/common/constantParsing.h"
+#include "lib/bitvec.h"
+#include "lib/cstring.h"
+#include "lib/flat_map.h"
+#include "lib/gmputil.h"
+#include "lib/ltbitmatrix.h"
+#include "lib/match.h"
+#include "lib/ordered_map.h"
+#include "lib/ordered_set.h"
+#include "lib/safe_vector.h"
+#include "lib/small_ordered_map.h"
+
+#include "id.h"
+#include "node.h"
+
+namespace IR {
+/// Hash of the IR class definitions, generated by the ir-generator.  Binary IR files
+/// record it, so a file written by a compiler with different IR classes is rejected.
+extern const uint64_t binary_schema;
+}  // namespace IR
+
+/**
+ * Writes an IR tree in a compact binary form that BinaryLoader can read back.
+ *
+ * The file consists of a header, one record per distinct node, a table of the distinct
+ * strings, and offset tables for the records and the strings:
+ *
+ *     header      magic "P4IRBIN", version, IR::binary_schema, counts, table offsets
+ *     records     for each node: type name, fields in declaration order, source info
+ *     strings     for each string: length and bytes
+ *     tables      64-bit file offsets of each string and each record
+ *
+ * Numbers are LEB128 varints (zigzag encoded when signed).  A reference to a node is
+ * its record number plus one (0 is null) and a reference to a string is its index in
+ * the string table plus one, so shared subtrees and repeated names are stored once.
+ * Node 0 is the root.
+ */
+class BinaryGenerator {
+    template<typename T>
+    class has_toBinary {
+        typedef char small;
+        typedef struct { char c[2]; } big;
+
+        template<typename C> static small test(decltype(&C::toBinary));
+        template<typename C> static big test(...);
+     public:
+        static const bool value = sizeof(test<T>(0)) == sizeof(char);
+    };
+
+    std::string                                 buf;
+    std::unordered_map<const IR::Node *, uint32_t>      node_index;
+    std::vector<const IR::Node *>               nodes;
+    std::unordered_map<cstring, uint32_t>       string_index;
+    std::vector<cstring>                        strings;
+    bool                                        dumpSourceInfo;
+
+ public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 48;
+
+    explicit BinaryGenerator(bool dumpSourceInfo = false) : dumpSourceInfo(dumpSourceInfo) {}
+
+    /// Write the tree rooted at @root to @out.
+    void write(const IR::Node *root, std::ostream &out);
+
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            buf += static_cast<char>(v | 0x80);
+            v >>= 7; }
+        buf += static_cast<char>(v); }
+    void svarint(int64_t v) {
+        varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+    void bytes(const std::string &s) {
+        varint(s.size());
+        buf += s; }
+    void string(cstring s) {
+        if (!s) {
+            varint(0);
+            return; }
+        auto it = string_index.emplace(s, strings.size());
+        if (it.second) strings.push_back(s);
+        varint(it.first->second + 1); }
+    void node(const IR::Node *n) {
+        if (!n) {
+            varint(0);
+            return; }
+        auto it = node_index.emplace(n, nodes.size());
+        if (it.second) nodes.push_back(n);
+        varint(it.first->second + 1); }
+
+    template<typename T>
+    void generate(const safe_vector<T> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename T>
+    void generate(const std::vector<T> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename T, typename C, typename A>
+    void generate(const std::set<T, C, A> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename T, typename C, typename A>
+    void generate(const ordered_set<T, C, A> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename K, typename V, typename C, typename A>
+    void generate(const std::map<K, V, C, A> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename K, typename V, typename C, typename A>
+    void generate(const std::multimap<K, V, C, A> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename K, typename V, typename C, typename A>
+    void generate(const flat_map<K, V, C, A> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename K, typename V, typename C, typename A>
+    void generate(const ordered_map<K, V, C, A> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename K, typename V, typename H>
+    void generate(const small_ordered_map<K, V, H> &v) {
+        varint(v.size());
+        for (auto &el : v) generate(el); }
+    template<typename T, typename U>
+    void generate(const std::pair<T, U> &v) {
+        generate(v.first);
+        generate(v.second); }
+    template<typename T>
+    void generate(const boost::optional<T> &v) {
+        generate(static_cast<bool>(v));
+        if (v) generate(*v); }
+    template<typename T, size_t N>
+    void generate(const T (&v)[N]) {
+        for (size_t i = 0; i < N; ++i) generate(v[i]); }
+
+    void generate(bool v) { buf += static_cast<char>(v); }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    generate(T v) { svarint(v); }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    generate(T v) { varint(v); }
+    template<typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    generate(T v) { svarint(static_cast<int64_t>(v)); }
+    void generate(double v) {
+        char raw[sizeof(v)];
+        memcpy(raw, &v, sizeof(v));
+        buf.append(raw, sizeof(v)); }
+    template<typename T>
+    typename std::enable_if<std::is_same<T, big_int>::value>::type
+    generate(const T &v) { bytes(v.str()); }
+
+    void generate(cstring v) { string(v); }
+    void generate(const IR::ID &v) {
+        string(v.name);
+        string(v.originalName); }
+    void generate(const bitvec &v) {
+        std::stringstream tmp;
+        tmp << v;
+        bytes(tmp.str()); }
+    void generate(const LTBitMatrix &v) {
+        std::stringstream tmp;
+        tmp << v;
+        bytes(tmp.str()); }
+    void generate(const match_t &v) {
+        varint(v.word0);
+        varint(v.word1); }
+    void generate(const UnparsedConstant *v) {
+        generate(v != nullptr);
+        if (!v) return;
+        string(v->text);
+        varint(v->skip);
+        varint(v->base);
+        generate(v->hasWidth); }
+
+    template<typename T>
+    typename std::enable_if<
+                    has_toBinary<T>::value &&
+                    !std::is_base_of<IR::INode, T>::value>::type
+    generate(const T &v) { v.toBinary(*this); }
+    void generate(const IR::INode &v) { node(v.getNode()); }
+    void generate(const IR::INode *v) { node(v ? v->getNode() : nullptr); }
+
+    template<typename T>
+    typename std::enable_if<
+                    has_toBinary<T>::value &&
+                    !std::is_base_of<IR::INode, T>::value>::type
+    generate(const T *v) {
+        generate(v != nullptr);
+        if (v) v->toBinary(*this); }
+
+    template<typename T> BinaryGenerator &operator<<(const T &v) { generate(v); return *this; }
+};
+
+#endif /* _IR_BINARY_GENERATOR_H_ */
@@ -0,0 +1,136 @@
+#include "binary_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "lib/map.h"
+
+static const char BINARY_IR_MAGIC[8] = { 'P', '4', 'I', 'R', 'B', 'I', 'N', 0 };
+
+static uint32_t get_u32(const uint8_t *p) {
+    uint32_t rv = 0;
+    for (int i = 0; i < 4; ++i) rv |= static_cast<uint32_t>(p[i]) << (8 * i);
+    return rv;
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    uint64_t rv = 0;
+    for (int i = 0; i < 8; ++i) rv |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return rv;
+}
+
+BinaryLoader::BinaryLoader(cstring filename) : filename(filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errmsg = "can't open file";
+        return; }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            data = static_cast<const uint8_t *>(addr);
+            size = st.st_size;
+            mapped = true; } }
+    close(fd);
+    if (!mapped) {
+        // not a regular file (or mmap failed) -- read it instead
+        std::ifstream in(filename.c_str(), std::ios::binary);
+        std::stringstream contents;
+        contents << in.rdbuf();
+        open(contents.str());
+    } else if (!check_header()) {
+        munmap(const_cast<uint8_t *>(data), size);
+        mapped = false;
+        data = nullptr; }
+}
+
+BinaryLoader::BinaryLoader(std::istream &in) : filename("<stream>") {
+    std::stringstream contents;
+    contents << in.rdbuf();
+    open(contents.str());
+}
+
+BinaryLoader::~BinaryLoader() {
+    if (mapped) munmap(const_cast<uint8_t *>(data), size);
+}
+
+void BinaryLoader::open(const std::string &contents) {
+    owned = contents;
+    data = reinterpret_cast<const uint8_t *>(owned.data());
+    size = owned.size();
+    if (!check_header()) data = nullptr;
+}
+
+bool BinaryLoader::check_header() {
+    if (size < BinaryGenerator::HEADER_SIZE ||
+        memcmp(data, BINARY_IR_MAGIC, sizeof(BINARY_IR_MAGIC)) != 0) {
+        errmsg = "not a binary IR file";
+        return false; }
+    if (get_u32(data + 8) != BinaryGenerator::VERSION) {
+        errmsg = "unsupported binary IR version";
+        return false; }
+    if (get_u64(data + 16) != IR::binary_schema) {
+        errmsg = "binary IR written by a compiler with different IR classes";
+        return false; }
+    nnodes = get_u32(data + 12);
+    nstrings = get_u32(data + 24);
+    string_table = get_u64(data + 32);
+    node_table = get_u64(data + 40);
+    if (string_table > size || (size - string_table) / 8 < nstrings ||
+        node_table > size || (size - node_table) / 8 < nnodes) {
+        errmsg = "truncated binary IR file";
+        return false; }
+    nodes.resize(nnodes);
+    strings.resize(nstrings);
+    have_string.resize(nstrings);
+    pos = data + BinaryGenerator::HEADER_SIZE;
+    return true;
+}
+
+void BinaryLoader::corrupt() const {
+    throw Util::CompilationError("%1%: corrupt binary IR file", filename);
+}
+
+uint64_t BinaryLoader::offset(uint64_t table, uint32_t index) const {
+    uint64_t rv = get_u64(data + table + 8 * index);
+    if (rv >= size) corrupt();
+    return rv;
+}
+
+cstring BinaryLoader::string() {
+    uint64_t ref = varint();
+    if (ref == 0) return nullptr;
+    if (ref > nstrings) corrupt();
+    if (!have_string[ref - 1]) {
+        auto save = pos;
+        pos = data + offset(string_table, ref - 1);
+        auto text = bytes();
+        strings[ref - 1] = cstring(text.data(), text.size());
+        have_string[ref - 1] = true;
+        pos = save; }
+    return strings[ref - 1];
+}
+
+IR::Node *BinaryLoader::node(uint32_t index, IR::Node *(*fallback)(BinaryLoader &)) {
+    if (nodes[index]) return nodes[index];
+    auto save = pos;
+    pos = data + offset(node_table, index);
+    cstring type = string();
+    auto fn = get(IR::binary_unpacker_table(), type, fallback);
+    if (!fn)
+        throw Util::CompilationError("%1%: can't load IR node of type %2%", filename, type);
+    IR::Node *n = fn(*this);
+    if (byte()) {
+        cstring file = string();
+        int line = varint();
+        int column = varint();
+        cstring fragment = string();
+        n->srcInfo = Util::SourceInfo(file, line, column, fragment); }
+    pos = save;
+    return nodes[index] = n;
+}
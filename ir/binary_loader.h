@@ -0,0 +1,324 @@
+#ifndef _IR_BINARY_LOADER_H_
+#define _IR_BINARY_LOADER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "lib/bitvec.h"
+#include "lib/cstring.h"
+#include "lib/flat_map.h"
+#include "lib/ltbitmatrix.h"
+#include "lib/match.h"
+#include "lib/ordered_map.h"
+#include "lib/ordered_set.h"
+#include "lib/safe_vector.h"
+#include "lib/small_ordered_map.h"
+#include "ir.h"
+#include "binary_generator.h"
+
+/**
+ * Reads IR written by BinaryGenerator.
+ *
+ * The file is mapped into memory rather than read, and a node's record is only decoded
+ * when something refers to that node: loading a subtree with node(), or the whole
+ * program with root(), touches only the records reachable from it.  Strings are
+ * likewise interned on first use.  Decoding a node record decodes (and memoizes) the
+ * nodes it refers to, so shared subtrees are shared again after loading.
+ *
+ * A file with the wrong magic number, version or IR schema is rejected by the
+ * constructor (valid() is false, and error() says why); a corrupt record throws
+ * Util::CompilationError when it is decoded.
+ */
+class BinaryLoader {
+    template<typename T> class has_fromBinary {
+        typedef char small;
+        typedef struct { char c[2]; } big;
+
+        template<typename C> static small test(decltype(&C::fromBinary));
+        template<typename C> static big test(...);
+     public:
+        static const bool value = sizeof(test<T>(0)) == sizeof(char);
+    };
+
+    cstring                     filename;
+    const uint8_t               *data = nullptr;
+    size_t                      size = 0;
+    bool                        mapped = false;
+    std::string                 owned;  // file contents, when it can't be mapped
+    const uint8_t               *pos = nullptr;
+    uint32_t                    nnodes = 0, nstrings = 0;
+    uint64_t                    node_table = 0, string_table = 0;
+    std::vector<IR::Node *>     nodes;
+    std::vector<cstring>        strings;
+    std::vector<bool>           have_string;
+    cstring                     errmsg;
+
+    void open(const std::string &contents);
+    bool check_header();
+    uint64_t offset(uint64_t table, uint32_t index) const;
+    [[noreturn]] void corrupt() const;
+    IR::Node *node(uint32_t index, IR::Node *(*fallback)(BinaryLoader &));
+    template<class T> static IR::Node *make(BinaryLoader &bin) { return T::fromBinary(bin); }
+
+    template<class T> const T *typed_node() {
+        uint64_t ref = varint();
+        if (ref == 0) return nullptr;
+        if (ref > nnodes) corrupt();
+        auto *n = node(ref - 1, &make<T>)->template to<T>();
+        if (!n) corrupt();
+        return n; }
+    const IR::Node *any_node() {
+        uint64_t ref = varint();
+        if (ref == 0) return nullptr;
+        if (ref > nnodes) corrupt();
+        return node(ref - 1, nullptr); }
+
+    template<typename T>
+    void unpack(safe_vector<T> &v) {
+        T temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.push_back(temp); } }
+    template<typename T>
+    void unpack(std::vector<T> &v) {
+        T temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.push_back(temp); } }
+    template<typename T, typename C, typename A>
+    void unpack(std::set<T, C, A> &v) {
+        T temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.insert(temp); } }
+    template<typename T, typename C, typename A>
+    void unpack(ordered_set<T, C, A> &v) {
+        T temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.insert(temp); } }
+    template<typename K, typename V, typename C, typename A>
+    void unpack(std::map<K, V, C, A> &v) {
+        std::pair<K, V> temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.insert(temp); } }
+    template<typename K, typename V, typename C, typename A>
+    void unpack(std::multimap<K, V, C, A> &v) {
+        std::pair<K, V> temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.insert(temp); } }
+    template<typename K, typename V, typename C, typename A>
+    void unpack(flat_map<K, V, C, A> &v) {
+        std::pair<K, V> temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.insert(temp); } }
+    template<typename K, typename V, typename C, typename A>
+    void unpack(ordered_map<K, V, C, A> &v) {
+        std::pair<K, V> temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.insert(temp); } }
+    template<typename K, typename V, typename H>
+    void unpack(small_ordered_map<K, V, H> &v) {
+        std::pair<K, V> temp;
+        for (auto n = varint(); n > 0; --n) {
+            unpack(temp);
+            v.insert(temp); } }
+    template<typename T, typename U>
+    void unpack(std::pair<T, U> &v) {
+        unpack(v.first);
+        unpack(v.second); }
+    template<typename T>
+    void unpack(boost::optional<T> &v) {
+        bool isValid = false;
+        unpack(isValid);
+        if (!isValid) {
+            v = boost::none;
+            return; }
+        T value;
+        unpack(value);
+        v = std::move(value); }
+    template<typename T, size_t N>
+    void unpack(T (&v)[N]) {
+        for (size_t i = 0; i < N; ++i) unpack(v[i]); }
+
+    void unpack(bool &v) { v = byte() != 0; }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    unpack(T &v) { v = svarint(); }
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    unpack(T &v) { v = varint(); }
+    template<typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type
+    unpack(T &v) { v = static_cast<T>(svarint()); }
+    void unpack(double &v) {
+        if (size - (pos - data) < sizeof(v)) corrupt();
+        memcpy(&v, pos, sizeof(v));
+        pos += sizeof(v); }
+    void unpack(big_int &v) { v = big_int(bytes()); }
+
+    void unpack(cstring &v) { v = string(); }
+    void unpack(IR::ID &v) {
+        v.name = string();
+        v.originalName = string(); }
+    void unpack(bitvec &v) { bytes().c_str() >> v; }
+    void unpack(LTBitMatrix &v) { bytes().c_str() >> v; }
+    void unpack(match_t &v) {
+        v.word0 = varint();
+        v.word1 = varint(); }
+    void unpack(UnparsedConstant *&v) {
+        if (!byte()) {
+            v = nullptr;
+            return; }
+        cstring text = string();
+        unsigned skip = varint();
+        unsigned base = varint();
+        bool hasWidth = byte() != 0;
+        v = new UnparsedConstant({text, skip, base, hasWidth}); }
+
+    template<typename T>
+    typename std::enable_if<
+        has_fromBinary<T>::value &&
+        !std::is_base_of<IR::INode, T>::value &&
+        std::is_pointer<decltype(T::fromBinary(std::declval<BinaryLoader&>()))>::value
+    >::type
+    unpack(T *&v) { v = byte() ? T::fromBinary(*this) : nullptr; }
+
+    template<typename T>
+    typename std::enable_if<
+        has_fromBinary<T>::value &&
+        !std::is_base_of<IR::INode, T>::value &&
+        std::is_pointer<decltype(T::fromBinary(std::declval<BinaryLoader&>()))>::value
+    >::type
+    unpack(T &v) { v = *(T::fromBinary(*this)); }
+
+    template<typename T>
+    typename std::enable_if<
+        has_fromBinary<T>::value &&
+        !std::is_base_of<IR::INode, T>::value &&
+        !std::is_pointer<decltype(T::fromBinary(std::declval<BinaryLoader&>()))>::value
+    >::type
+    unpack(T &v) { v = T::fromBinary(*this); }
+
+    // Vectors and NameMaps are not in the factory table, as they are templates, so
+    // they are created from the statically known type of the field
+    template<typename T> void unpack(IR::Vector<T> &v) { v = *typed_node<IR::Vector<T>>(); }
+    template<typename T> void unpack(const IR::Vector<T> *&v) { v = typed_node<IR::Vector<T>>(); }
+    template<typename T> void unpack(IR::IndexedVector<T> &v) {
+        v = *typed_node<IR::IndexedVector<T>>(); }
+    template<typename T> void unpack(const IR::IndexedVector<T> *&v) {
+        v = typed_node<IR::IndexedVector<T>>(); }
+    template<class T, template<class K, class V, class COMP, class ALLOC> class MAP,
+             class COMP, class ALLOC>
+    void unpack(IR::NameMap<T, MAP, COMP, ALLOC> &m) {
+        m = *typed_node<IR::NameMap<T, MAP, COMP, ALLOC>>(); }
+    template<class T, template<class K, class V, class COMP, class ALLOC> class MAP,
+             class COMP, class ALLOC>
+    void unpack(const IR::NameMap<T, MAP, COMP, ALLOC> *&m) {
+        m = typed_node<IR::NameMap<T, MAP, COMP, ALLOC>>(); }
+
+    template<typename T> typename std::enable_if<std::is_base_of<IR::INode, T>::value>::type
+    unpack(T &v) {
+        auto *n = any_node();
+        if (!n || !n->to<T>()) corrupt();
+        v = *n->to<T>(); }
+    template<typename T> typename std::enable_if<std::is_base_of<IR::INode, T>::value>::type
+    unpack(const T *&v) {
+        auto *n = any_node();
+        v = n ? n->to<T>() : nullptr;
+        if (n && !v) corrupt(); }
+
+ public:
+    /// Map the binary IR file @filename.
+    explicit BinaryLoader(cstring filename);
+    /// Read binary IR from @in.
+    explicit BinaryLoader(std::istream &in);
+    BinaryLoader(const BinaryLoader &) = delete;
+    ~BinaryLoader();
+
+    bool valid() const { return data != nullptr; }
+    cstring error() const { return errmsg; }
+
+    /// The root node of the file; nullptr if the file is not valid.
+    const IR::Node *root() { return valid() && nnodes ? node(0, nullptr) : nullptr; }
+    /// The root node, which must be a @T (it need not be registered in the factory table,
+    /// so it can be a Vector); nullptr if the file is not valid.
+    template<class T> const T *root() {
+        if (!valid() || !nnodes) return nullptr;
+        auto *n = node(0, &make<T>)->template to<T>();
+        if (!n) corrupt();
+        return n; }
+    /// Node number @index of the file (0 is the root), decoding it if necessary.
+    const IR::Node *node(uint32_t index) {
+        if (index >= nnodes) corrupt();
+        return node(index, nullptr); }
+    uint32_t nodeCount() const { return nnodes; }
+
+    // Primitive readers, for the generated constructors
+    uint8_t byte() {
+        if (pos >= data + size) corrupt();
+        return *pos++; }
+    uint64_t varint() {
+        uint64_t rv = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            rv |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return rv; }
+        corrupt(); }
+    int64_t svarint() {
+        uint64_t v = varint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+    std::string bytes() {
+        uint64_t len = varint();
+        if (len > size - (pos - data)) corrupt();
+        std::string rv(reinterpret_cast<const char *>(pos), len);
+        pos += len;
+        return rv; }
+    cstring string();
+
+    template<typename T> BinaryLoader &operator>>(T &v) {
+        unpack(v);
+        return *this; }
+};
+
+template<class T>
+IR::Vector<T>::Vector(BinaryLoader &bin) : VectorBase(bin) {
+    bin >> vec;
+}
+template<class T>
+IR::Vector<T>* IR::Vector<T>::fromBinary(BinaryLoader &bin) {
+    return new Vector<T>(bin);
+}
+template<class T>
+IR::IndexedVector<T>::IndexedVector(BinaryLoader &bin) : Vector<T>(bin) {
+    bin >> declarations;
+}
+template<class T>
+IR::IndexedVector<T>* IR::IndexedVector<T>::fromBinary(BinaryLoader &bin) {
+    return new IndexedVector<T>(bin);
+}
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
+         class COMP /*= std::less<cstring>*/,
+         class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
+IR::NameMap<T, MAP, COMP, ALLOC>::NameMap(BinaryLoader &bin) : Node(bin) {
+    bin >> symbols;
+}
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
+         class COMP /*= std::less<cstring>*/,
+         class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
+IR::NameMap<T, MAP, COMP, ALLOC> *IR::NameMap<T, MAP, COMP, ALLOC>::fromBinary(BinaryLoader &bin) {
+    return new IR::NameMap<T, MAP, COMP, ALLOC>(bin);
+}
+
+#endif /* _IR_BINARY_LOADER_H_ */
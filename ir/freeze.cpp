@@ -0,0 +1,35 @@
+#include "freeze.h"
+
+#include <unordered_map>
+
+#include "ir/ir.h"
+
+namespace IR {
+
+namespace {
+
+/// Replaces each child by its copy, copying each node once.
+class DeepCopy : public Visitor {
+    std::unordered_map<const Node *, const Node *> copies;
+
+ public:
+    const Node *apply_visitor(const Node *n, const char * = 0) override {
+        if (!n || n->is<Type_Base>()) return n;
+        auto it = copies.find(n);
+        if (it != copies.end()) return it->second;
+        // the parent before its children, so the copy is laid out in preorder
+        auto *copy = n->clone();
+        copies.emplace(n, copy);
+        visit(*copy);
+        return copy; }
+};
+
+}  // namespace
+
+const Node *freeze(const Node *root, Util::Arena &arena) {
+    Util::Arena::Scope scope(&arena);
+    DeepCopy copy;
+    return copy.apply_visitor(root);
+}
+
+}  // namespace IR
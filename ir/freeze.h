@@ -0,0 +1,32 @@
+#ifndef _IR_FREEZE_H_
+#define _IR_FREEZE_H_
+
+#include "ir/node.h"
+#include "lib/arena.h"
+
+namespace IR {
+
+/**
+ * Copies the IR reachable from @root into @arena, in depth-first order, and @return the
+ * copy of @root.  By the end of the midend the nodes of a program are scattered over
+ * the heap by the passes that cloned them; the copy is laid out in the order the
+ * backends visit it, and refers to none of them, so once the caller drops the old
+ * program the collector can reclaim them all.
+ *
+ * Nodes shared in the IR are shared in the copy.  The base types (Type_Bits and the
+ * other Type_Base singletons) are not copied, as they are compared by identity.  The
+ * copy is meant to be read: nodes made by passes that change it are allocated as usual.
+ * Maps keyed by node (ReferenceMap, TypeMap) know only the original nodes, so they must
+ * be computed again for the copy.
+ *
+ * @arena becomes current while copying, so no other thread may allocate nodes then.
+ */
+const Node *freeze(const Node *root, Util::Arena &arena);
+
+template<class T> const T *freeze(const T *root, Util::Arena &arena) {
+    auto *rv = freeze(static_cast<const Node *>(root), arena);
+    return rv ? rv->template to<T>() : nullptr; }
+
+}  // namespace IR
+
+#endif /* _IR_FREEZE_H_ */
@@ -0,0 +1,126 @@
+#ifndef _IR_HASHCONS_H_
+#define _IR_HASHCONS_H_
+
+#include <atomic>
+#include <functional>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+#include "lib/arena.h"
+#include "lib/cstring.h"
+#include "lib/gmputil.h"
+#include "lib/hash.h"
+#include "id.h"
+
+/* Hash-consing of immutable IR nodes.
+ *
+ * Classes marked '#hashcons' in a .def file get, from the ir-generator,
+ *     static const T *intern(args...);     // canonical T equal to T(args...)
+ *     static const T *canonical(const T *n);  // canonical T equal to *n
+ * which return one shared instance for all nodes of the class that compare equal
+ * (operator==, so children are compared by pointer and source positions are ignored;
+ * the shared node keeps the srcInfo of the first one interned).  Interning a node whose
+ * children are themselves canonical therefore makes structural equality a pointer
+ * compare.
+ *
+ * This is opt-in: nodes created with 'new' are never shared.  Shared nodes must never be
+ * modified, and passes that key maps on node identity (ReferenceMap, TypeMap) will see
+ * one entry for every use of a shared node, so only intern nodes whose meaning does not
+ * depend on where they appear.
+ *
+ * Canonical nodes are immutable, so they also cache their structural_hash.
+ */
+
+namespace IR {
+
+inline size_t hashcons_combine(size_t seed, size_t h) {
+    return Util::Hash::hash_combine(seed, h); }
+
+// per-field hashes; fields whose type has no hash here hash as 0 (and are still compared
+// by operator== when looking for a match).
+template<class T>
+inline auto hashcons_field(const T &v, int) -> decltype(std::hash<T>()(v)) {
+    return std::hash<T>()(v); }
+template<class T>
+inline size_t hashcons_field(const T *v, int) { return std::hash<const void *>()(v); }
+inline size_t hashcons_field(const big_int &v, int) {
+    return std::hash<long>()(static_cast<long>(v & big_int(~0UL))); }
+inline size_t hashcons_field(const ID &v, int) { return std::hash<cstring>()(v.name); }
+template<class T> inline size_t hashcons_field(const T &, long) { return 0; }
+
+/// The structural_hash of a hash-consed node, kept once the node is canonical.  Copies
+/// start without one, as they may still be modified.
+class StructuralHashCache {
+    mutable std::atomic<bool>   canonical{false};
+    mutable std::atomic<size_t> value{0};
+
+ public:
+    StructuralHashCache() = default;
+    StructuralHashCache(const StructuralHashCache &) {}
+    StructuralHashCache &operator=(const StructuralHashCache &) {
+        canonical = false;
+        value = 0;
+        return *this; }
+    void setCanonical() const { canonical = true; }
+    /// @return the cached hash, or 0 if there is none
+    size_t get() const { return value; }
+    void set(size_t h) const { if (canonical) value = h; }
+};
+
+/// The table of canonical instances of one hash-consed class T.
+template<class T> class HashConsTable {
+    struct hash_t {
+        size_t operator()(const T *n) const { return n->hashcons_hash(); } };
+    struct equal_t {
+        bool operator()(const T *a, const T *b) const { return *a == *b; } };
+    std::unordered_set<const T *, hash_t, equal_t>      table;
+#ifdef MULTITHREAD
+    std::mutex                                          lock;
+#endif  // MULTITHREAD
+
+ public:
+    static HashConsTable &get() {
+        static HashConsTable *rv = new HashConsTable;
+        return *rv; }
+
+    /// @return the canonical node equal to @n, or nullptr if there is none yet
+    const T *find(const T *n) {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        auto it = table.find(n);
+        return it == table.end() ? nullptr : *it; }
+
+    /// @return the canonical node equal to @n, which becomes canonical if there is none
+    const T *insert(const T *n) {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        auto *rv = *table.insert(n).first;
+        rv->structural_hash_cache.setCanonical();
+        return rv; }
+
+    /// @return the canonical node equal to @tmp, making a heap copy of @tmp if there is
+    /// none.  The copy is never allocated from an arena, as the table outlives it.
+    const T *intern(const T &tmp) {
+        if (auto *rv = find(&tmp)) return rv;
+        Util::Arena::Scope noArena(nullptr);
+        return insert(new T(tmp)); }
+};
+
+}  // namespace IR
+
+#define IRNODE_DECLARE_HASHCONS(T)                                              \
+ public:                                                                        \
+    size_t hashcons_hash() const;                                               \
+    IR::StructuralHashCache structural_hash_cache;                              \
+    static const T *canonical(const T *n) {                                     \
+        return IR::HashConsTable<T>::get().insert(n); }                         \
+    template<typename... Args> static const T *intern(Args&&... args) {         \
+        return IR::HashConsTable<T>::get().intern(T(std::forward<Args>(args)...)); }
+
+#endif /* _IR_HASHCONS_H_ */
@@ -23,11 +23,13 @@ limitations under the License.
 #include "lib/error.h"
 #include "lib/null.h"
 #include "lib/safe_vector.h"
+#include "lib/small_ordered_map.h"
 #include "vector.h"
 #include "id.h"
 #include "declaration.h"
 
 class JSONLoader;
+class BinaryLoader;
 
 namespace IR {
 
@@ -37,7 +39,9 @@ namespace IR {
  */
 template<class T>
 class IndexedVector : public Vector<T> {
-    ordered_map<cstring, const IDeclaration*> declarations;
+    // Most IndexedVectors are small (parameter lists, struct fields, table properties),
+    // so the index is a flat map, searched linearly until it grows large.
+    small_ordered_map<cstring, const IDeclaration*> declarations;
     bool invalid = false;  // set when an error occurs; then we don't
                            // expect the validity check to succeed.
 
@@ -83,6 +87,7 @@ class IndexedVector : public Vector<T> {
     explicit IndexedVector(const Vector<T> &a) {
         insert(typename Vector<T>::end(), a.begin(), a.end()); }
     explicit IndexedVector(JSONLoader &json);
+    explicit IndexedVector(BinaryLoader &bin);
 
     void clear() { IR::Vector<T>::clear(); declarations.clear(); }
     // TODO: Although this is not a const_iterator, it should NOT
@@ -179,6 +184,8 @@ class IndexedVector : public Vector<T> {
 
     void toJSON(JSONGenerator &json) const override;
     static IndexedVector<T>* fromJSON(JSONLoader &json);
+    void toBinary(BinaryGenerator &bin) const override;
+    static IndexedVector<T>* fromBinary(BinaryLoader &bin);
     void validate() const override {
         if (invalid) return;  // don't crash the compiler because an error happened
         for (auto el : *this) {
@@ -108,6 +108,9 @@ template<class T> void IR::Vector<T>::parallel_visit_children(Visitor &v) {
             v.flow_merge(*tmp); }
 }
 template<class T> void IR::Vector<T>::parallel_visit_children(Visitor &v) const {
+    if (v.parallel_visit_threaded(vec.size(), [this](Visitor &tv, size_t i) {
+            tv.visit(vec[i]); }))
+        return;
     Visitor *start = nullptr, *tmp = &v;
     size_t todo = vec.size();
     if (todo > 1) start = &v.flow_clone();
@@ -133,6 +136,11 @@ template<class T> void IR::Vector<T>::toJSON(JSONGenerator &json) const {
     json << "]";
 }
 
+template<class T> void IR::Vector<T>::toBinary(BinaryGenerator &bin) const {
+    Node::toBinary(bin);
+    bin << vec;
+}
+
 std::ostream &operator<<(std::ostream &out, const IR::Vector<IR::Expression> &v);
 
 template<class T> void IR::IndexedVector<T>::visit_children(Visitor &v) {
@@ -168,6 +176,11 @@ void IR::IndexedVector<T>::toJSON(JSONGenerator &json) const {
     if (*sep) json << std::endl << json.indent;
     json << "}";
 }
+template<class T>
+void IR::IndexedVector<T>::toBinary(BinaryGenerator &bin) const {
+    Vector<T>::toBinary(bin);
+    bin << declarations;
+}
 IRNODE_DEFINE_APPLY_OVERLOAD(IndexedVector, template<class T>, <T>)
 
 #include "lib/ordered_map.h"
@@ -196,7 +209,7 @@ namemap_insert_helper(typename ordered_map<cstring, T>::iterator it,
     symbols.insert(it, b, e);
 }
 
-template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
          class COMP /*= std::less<cstring>*/,
          class ALLOC /*= std::allocator<std::pair<const cstring, const T*>>*/>
 void IR::NameMap<T, MAP, COMP, ALLOC>::visit_children(Visitor &v) {
@@ -222,12 +235,12 @@ void IR::NameMap<T, MAP, COMP, ALLOC>::visit_children(Visitor &v) {
                 n->node_type_name(), T::static_type_name()); } }
     symbols.insert(new_symbols.begin(), new_symbols.end());
 }
-template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
          class COMP /*= std::less<cstring>*/,
          class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
 void IR::NameMap<T, MAP, COMP, ALLOC>::visit_children(Visitor &v) const {
     for (auto &k : symbols) v.visit(k.second, k.first); }
-template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
          class COMP /*= std::less<cstring>*/,
          class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
 void IR::NameMap<T, MAP, COMP, ALLOC>::toJSON(JSONGenerator &json) const {
@@ -241,9 +254,16 @@ void IR::NameMap<T, MAP, COMP, ALLOC>::toJSON(JSONGenerator &json) const {
     if (*sep) json << std::endl << json.indent;
     json << "}";
 }
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
+         class COMP /*= std::less<cstring>*/,
+         class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
+void IR::NameMap<T, MAP, COMP, ALLOC>::toBinary(BinaryGenerator &bin) const {
+    Node::toBinary(bin);
+    bin << symbols;
+}
 
 template<class KEY, class VALUE,
-         template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+         template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
          class COMP /*= std::less<cstring>*/,
          class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
 void IR::NodeMap<KEY, VALUE, MAP, COMP, ALLOC>::visit_children(Visitor &v) {
@@ -268,7 +288,7 @@ void IR::NodeMap<KEY, VALUE, MAP, COMP, ALLOC>::visit_children(Visitor &v) {
     symbols.insert(new_symbols.begin(), new_symbols.end());
 }
 template<class KEY, class VALUE,
-         template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+         template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
          class COMP /*= std::less<cstring>*/,
          class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
 void IR::NodeMap<KEY, VALUE, MAP, COMP, ALLOC>::visit_children(Visitor &v) const {
@@ -32,8 +32,8 @@ const cstring IApply::applyMethodName = "apply";
 const cstring P4Program::main = "main";
 const cstring Type_Error::error = "error";
 
-int IR::Declaration::nextId = 0;
-int IR::This::nextId = 0;
+std::atomic<int> IR::Declaration::nextId(0);
+std::atomic<int> IR::This::nextId(0);
 
 const Type_Method* P4Control::getConstructorMethodType() const {
     return new Type_Method(getTypeParameters(), type, constructorParams, getName());
@@ -215,7 +215,7 @@ void Block::setValue(const Node* node, const CompileTimeValue* value) {
 void InstantiatedBlock::instantiate(std::vector<const CompileTimeValue*> *args) {
     CHECK_NULL(args);
     auto it = args->begin();
-    for (auto p : *getConstructorParameters()->getEnumerator()) {
+    for (auto p : getConstructorParameters()->parameters) {
         if (it == args->end()) {
             BUG_CHECK(p->isOptional(), "Missing nonoptional arg %s", p);
             continue; }
@@ -42,6 +42,7 @@ limitations under the License.
 #include "namemap.h"
 #include "nodemap.h"
 #include "id.h"
+#include "hashcons.h"
 
 
 // generated ir file
@@ -49,6 +50,8 @@ limitations under the License.
 
 class JSONLoader;
 #include "json_generator.h"
+class BinaryLoader;
+#include "binary_generator.h"
 
 #include "pass_manager.h"
 #include "ir-inline.h"
@@ -0,0 +1,43 @@
+/*
+Copyright 2013-present Barefoot Networks, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "json_generator.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+JSONGenerator::~JSONGenerator() {
+    flush();
+    if (out) out->flush();
+}
+
+void JSONGenerator::flush() {
+    if (buffer.empty()) return;
+    if (out) {
+        out->write(buffer.data(), buffer.size());
+    } else {
+        const char *data = buffer.data();
+        size_t left = buffer.size();
+        while (left > 0 && !failed) {
+            ssize_t n = ::write(fd, data, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                failed = true;
+            } else {
+                data += n;
+                left -= n; } } }
+    buffer.clear();
+}
@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <assert.h>
 
+#include <sstream>
 #include <string>
 #include <unordered_set>
 
@@ -34,10 +35,26 @@ limitations under the License.
 
 #include "ir.h"
 
+/**
+ * Writes an IR tree as JSON that JSONLoader can read back.
+ *
+ * The text is collected in a buffer and written to the stream or file descriptor in
+ * large chunks, when the buffer is full and after each value written at the top level
+ * (so the output of `gen << node;` is complete when the statement is), instead of
+ * going through the stream for every token.  In compact mode, the line breaks and the
+ * indentation are left out.
+ */
 class JSONGenerator {
     std::unordered_set<int> node_refs;
-    std::ostream &out;
+    std::ostream *out = nullptr;
+    int fd = -1;
     bool dumpSourceInfo;
+    bool compact;
+    bool failed = false;
+    std::string buffer;
+    int depth = 0;  // of the values being written by operator<<
+
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
 
     template<typename T>
     class has_toJSON {
@@ -50,159 +67,178 @@ class JSONGenerator {
         static const bool value = sizeof(test<T>(0)) == sizeof(char);
     };
 
+    void write(const char *s, size_t len) { buffer.append(s, len); }
+    void write(const char *s) { buffer.append(s); }
+    void write(char c) { buffer.push_back(c); }
+    void write(cstring s) { buffer.append(s.c_str(), s.size()); }
+    void endl() { if (!compact) buffer.push_back('\n'); }
+    void write(indent_t i) { if (!compact && i.width() > 0) buffer.append(i.width(), ' '); }
+    /// Write @v with the stream operator of its type.
+    template<typename T> void stream(const T &v) {
+        std::ostringstream tmp;
+        tmp << v;
+        buffer.append(tmp.str()); }
+    void written() {
+        if (depth == 0 || buffer.size() >= BUFFER_SIZE)
+            flush(); }
+
+    /// Write the elements from @begin to @end as an array.  @brk says whether "[" is
+    /// followed by a line break even if there are no elements.
+    template<typename I>
+    void array(I begin, I end, bool brk) {
+        write('[');
+        if (brk) endl();
+        if (begin != end) {
+            if (!brk) endl();
+            write(++indent);
+            generate(*begin);
+            for (++begin; begin != end; ++begin) {
+                write(',');
+                endl();
+                write(indent);
+                generate(*begin); }
+            endl();
+            write(--indent); }
+        write(']');
+    }
+
  public:
     indent_t indent;
 
-    explicit JSONGenerator(std::ostream &out, bool dumpSourceInfo = false) :
-        out(out), dumpSourceInfo(dumpSourceInfo) {}
+    explicit JSONGenerator(std::ostream &out, bool dumpSourceInfo = false,
+                           bool compact = false) :
+        out(&out), dumpSourceInfo(dumpSourceInfo), compact(compact) {}
+    /// Write to the file descriptor @fd with write(2), bypassing the iostreams.
+    explicit JSONGenerator(int fd, bool dumpSourceInfo = false, bool compact = false) :
+        fd(fd), dumpSourceInfo(dumpSourceInfo), compact(compact) {}
+    JSONGenerator(const JSONGenerator &) = delete;
+    ~JSONGenerator();
+
+    /// Write the buffered text out.
+    void flush();
+    /// True if writing to the file descriptor failed.
+    bool error() const { return failed; }
 
     template<typename T>
-    void generate(const safe_vector<T> &v) {
-        out << "[";
-        if (v.size() > 0) {
-            out << std::endl << ++indent;
-            generate(v[0]);
-            for (size_t i = 1; i < v.size(); i++) {
-                out << "," << std::endl << indent;
-                generate(v[i]); }
-            out << std::endl << --indent; }
-        out << "]";
-    }
+    void generate(const safe_vector<T> &v) { array(v.begin(), v.end(), false); }
 
     template<typename T>
-    void generate(const std::vector<T> &v) {
-        out << "[";
-        if (v.size() > 0) {
-            out << std::endl << ++indent;
-            generate(v[0]);
-            for (size_t i = 1; i < v.size(); i++) {
-                out << "," << std::endl << indent;
-                generate(v[i]); }
-            out << std::endl << --indent; }
-        out << "]";
-    }
+    void generate(const std::vector<T> &v) { array(v.begin(), v.end(), false); }
 
     template<typename T, typename U>
     void generate(const std::pair<T, U> &v) {
         ++indent;
-        out << "{" << std::endl;
+        write('{');
+        endl();
         toJSON(v);
-        out << std::endl << --indent << "}";
+        endl();
+        write(--indent);
+        write('}');
     }
 
     template<typename T, typename U>
     void toJSON(const std::pair<T, U> &v) {
-        out << indent << "\"first\" : ";
+        write(indent);
+        write("\"first\" : ");
         generate(v.first);
-        out << "," << std::endl << indent << "\"second\" : ";
+        write(',');
+        endl();
+        write(indent);
+        write("\"second\" : ");
         generate(v.second);
     }
 
     template<typename T>
     void generate(const boost::optional<T> &v) {
         if (!v) {
-            out << "{ \"valid\" : false }";
+            write("{ \"valid\" : false }");
             return;
         }
-        out << "{" << std::endl << ++indent;
-        out << "\"valid\" : true," << std::endl;
-        out << "\"value\" : ";
+        write('{');
+        endl();
+        write(++indent);
+        write("\"valid\" : true,");
+        endl();
+        write("\"value\" : ");
         generate(*v);
-        out << std::endl << --indent << "}";
+        endl();
+        write(--indent);
+        write('}');
     }
 
     template<typename T>
-    void generate(const std::set<T> &v) {
-        out << "[" << std::endl;
-        if (v.size() > 0) {
-            auto it = v.begin();
-            out << ++indent;
-            generate(*it);
-            for (it++; it != v.end(); ++it) {
-                out << "," << std::endl << indent;
-                generate(*it);
-            }
-            out << std::endl << --indent;
-        }
-        out << "]";
-    }
+    void generate(const std::set<T> &v) { array(v.begin(), v.end(), true); }
 
     template<typename T>
-    void generate(const ordered_set<T> &v) {
-        out << "[" << std::endl;
-        if (v.size() > 0) {
-            auto it = v.begin();
-            out << ++indent;
-            generate(*it);
-            for (it++; it != v.end(); ++it) {
-                out << "," << std::endl << indent;
-                generate(*it);
-            }
-            out << std::endl << --indent;
-        }
-        out << "]";
-    }
+    void generate(const ordered_set<T> &v) { array(v.begin(), v.end(), true); }
 
     template<typename K, typename V>
-    void generate(const std::map<K, V> &v) {
-        out << "[" << std::endl;
-        if (v.size() > 0) {
-            auto it = v.begin();
-            out << ++indent;
-            generate(*it);
-            for (it++; it != v.end(); ++it) {
-                out << "," << std::endl << indent;
-                generate(*it); }
-            out << std::endl << --indent; }
-        out << "]";
-    }
+    void generate(const std::map<K, V> &v) { array(v.begin(), v.end(), true); }
 
     template<typename K, typename V>
-    void generate(const ordered_map<K, V> &v) {
-        out << "[" << std::endl;
-        if (v.size() > 0) {
-            auto it = v.begin();
-            out << ++indent;
-            generate(*it);
-            for (it++; it != v.end(); ++it) {
-                out << "," << std::endl << indent;
-                generate(*it); }
-            out << std::endl << --indent; }
-        out << "]";
-    }
+    void generate(const ordered_map<K, V> &v) { array(v.begin(), v.end(), true); }
 
-    void generate(bool v) { out << (v ? "true" : "false"); }
+    void generate(bool v) { write(v ? "true" : "false"); }
     template<typename T>
     typename std::enable_if<std::is_integral<T>::value>::type
-    generate(T v) { out << std::to_string(v); }
-    void generate(double v) { out << std::to_string(v); }
+    generate(T v) {
+        typedef typename std::make_unsigned<T>::type U;
+        // v < T(1) && v != T(0) rather than v < T(0), which warns for unsigned types
+        bool negative = v < T(1) && v != T(0);
+        char digits[48];
+        char *p = digits + sizeof(digits);
+        U abs = negative ? U(0) - U(v) : U(v);
+        do {
+            *--p = static_cast<char>('0' + abs % 10);
+            abs /= 10;
+        } while (abs != 0);
+        if (negative) *--p = '-';
+        write(p, digits + sizeof(digits) - p);
+    }
+    void generate(double v) { buffer.append(std::to_string(v)); }
     template<typename T>
     typename std::enable_if<std::is_same<T, big_int>::value>::type
-    generate(const T &v) { out << v; }
+    generate(const T &v) { buffer.append(v.str()); }
 
     void generate(cstring v) {
-        if (v)
-            out << "\"" << v << "\"";
-        else
-            out << "null";
+        if (v) {
+            write('"');
+            write(v);
+            write('"');
+        } else {
+            write("null");
+        }
     }
     template<typename T>
     typename std::enable_if<
                 std::is_same<T, LTBitMatrix>::value ||
                 std::is_enum<T>::value>::type
     generate(T v) {
-        out << "\"" << v << "\"";
+        write('"');
+        stream(v);
+        write('"');
     }
 
     void generate(const bitvec &v) {
-        out << "\"" << v << "\"";
+        write('"');
+        stream(v);
+        write('"');
     }
 
     void generate(const match_t &v) {
-        out << "{" << std::endl
-            << (indent + 1) << "\"word0\" : " << v.word0 << "," << std::endl
-            << (indent + 1) << "\"word1\" : " << v.word1 << std::endl
-            << indent << "}";
+        write('{');
+        endl();
+        write(indent + 1);
+        write("\"word0\" : ");
+        generate(v.word0);
+        write(',');
+        endl();
+        write(indent + 1);
+        write("\"word1\" : ");
+        generate(v.word1);
+        endl();
+        write(indent);
+        write('}');
     }
 
     template<typename T>
@@ -211,16 +247,22 @@ class JSONGenerator {
                     !std::is_base_of<IR::Node, T>::value>::type
     generate(const T &v) {
         ++indent;
-        out << "{" << std::endl;
+        write('{');
+        endl();
         v.toJSON(*this);
-        out << std::endl << --indent << "}";
+        endl();
+        write(--indent);
+        write('}');
     }
 
     void generate(const IR::Node &v) {
-        out << "{" << std::endl;
+        write('{');
+        endl();
         ++indent;
         if (node_refs.find(v.id) != node_refs.end()) {
-            out << indent << "\"Node_ID\" : " << v.id;
+            write(indent);
+            write("\"Node_ID\" : ");
+            generate(v.id);
         } else {
             node_refs.insert(v.id);
             v.toJSON(*this);
@@ -228,7 +270,11 @@ class JSONGenerator {
                 v.sourceInfoToJSON(*this);
             }
         }
-        out << std::endl << --indent << "}";
+        endl();
+        write(--indent);
+        write('}');
+        if (buffer.size() >= BUFFER_SIZE)
+            flush();
     }
 
     template<typename T>
@@ -239,27 +285,27 @@ class JSONGenerator {
         if (v)
             generate(*v);
         else
-            out << "null";
+            write("null");
     }
 
     template<typename T, size_t N>
-    void generate(const T (&v)[N]) {
-        out << "[";
-        if (N > 0) {
-            out << std::endl << ++indent;
-            generate(v[0]);
-            for (size_t i = 1; i < N; i++) {
-                out << "," << std::endl << indent;
-                generate(v[i]); }
-            out << std::endl << --indent; }
-        out << "]";
-    }
-
-    JSONGenerator &operator<<(char ch) { out << ch; return *this; }
-    JSONGenerator &operator<<(const char *s) { out << s; return *this; }
-    JSONGenerator &operator<<(indent_t i) { out << i; return *this; }
-    JSONGenerator &operator<<(std::ostream &(*fn)(std::ostream &)) { out << fn; return *this; }
-    template<typename T> JSONGenerator &operator<<(const T &v) { generate(v); return *this; }
+    void generate(const T (&v)[N]) { array(v, v + N, false); }
+
+    JSONGenerator &operator<<(char ch) { write(ch); written(); return *this; }
+    JSONGenerator &operator<<(const char *s) { write(s); written(); return *this; }
+    JSONGenerator &operator<<(indent_t i) { write(i); written(); return *this; }
+    /// std::endl only ends the line; the stream itself is flushed by the destructor.
+    JSONGenerator &operator<<(std::ostream &(*fn)(std::ostream &)) {
+        if (fn == static_cast<std::ostream &(*)(std::ostream &)>(std::endl))
+            endl();
+        written();
+        return *this; }
+    template<typename T> JSONGenerator &operator<<(const T &v) {
+        ++depth;
+        generate(v);
+        --depth;
+        written();
+        return *this; }
 };
 
 
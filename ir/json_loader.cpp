@@ -0,0 +1,72 @@
+#include "json_loader.h"
+
+JSONStreamLoader::JSONStreamLoader(std::istream &in)
+: JSONLoader(new JsonStreamReader(in), *(new std::unordered_map<int, IR::Node*>())) {
+    if (stream->peek() == '{') json = new JsonObject();
+}
+
+void JSONLoader::open() {
+    if (opened) return;
+    stream->expect('{');
+    opened = true;
+}
+
+JsonData *JSONLoader::buffered(const std::string &field) const {
+    auto *obj = static_cast<JsonObject *>(json);
+    if (!obj) return nullptr;
+    auto it = obj->find(field);
+    return it == obj->end() ? nullptr : it->second;
+}
+
+bool JSONLoader::seek(const std::string &field, JsonData *&value) {
+    open();
+    if ((value = buffered(field))) return true;
+    std::string key;
+    while (!closed) {
+        if (!stream->nextKey(key)) {
+            closed = true;
+            break; }
+        if (key == field) return true;
+        if (!json) json = new JsonObject();
+        (*static_cast<JsonObject *>(json))[key] = stream->readValue(); }
+    return false;
+}
+
+void JSONLoader::finish(IR::Node *node) {
+    JsonData *src;
+    if (seek("Source_Info", src)) {
+        if (!src) src = stream->readValue();
+        if (auto *obj = dynamic_cast<const JsonObject *>(src))
+            node->srcInfo = Util::SourceInfo(obj->get_filename(), obj->get_line(),
+                                             obj->get_column(), obj->get_sourceFragment()); }
+    // skip any fields the constructor did not ask for
+    std::string key;
+    while (!closed && stream->nextKey(key)) stream->readValue();
+    closed = true;
+}
+
+const IR::Node *JSONLoader::stream_node(NodeFactoryFn fallback) {
+    if (stream->consumeNull()) return nullptr;
+    JSONLoader obj(stream, node_refs);
+    // JSONGenerator writes Node_ID and then Node_Type first, so this normally
+    // buffers just the id
+    JsonData *type;
+    bool isRef = !obj.seek("Node_Type", type);
+    if (!isRef && !type) type = stream->readValue();
+    int id = -1;
+    if (auto *num = dynamic_cast<const JsonNumber *>(obj.buffered("Node_ID"))) id = *num;
+    if (isRef) {
+        auto it = node_refs.find(id);
+        if (it == node_refs.end())
+            stream->fail("reference to undefined node " + std::to_string(id));
+        return it->second; }
+    auto *name = dynamic_cast<const JsonString *>(type);
+    if (!name) stream->fail("missing Node_Type");
+    NodeFactoryFn fn = get(IR::unpacker_table(), cstring(*name));
+    if (!fn) fn = fallback;
+    if (!fn) stream->fail("unknown node type " + *name);
+    IR::Node *node = fn(obj);
+    obj.finish(node);
+    if (id >= 0) node_refs[id] = node;
+    return node;
+}
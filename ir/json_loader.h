@@ -27,11 +27,14 @@ limitations under the License.
 #include <boost/optional.hpp>
 
 #include "lib/cstring.h"
+#include "lib/flat_map.h"
 #include "lib/indent.h"
+#include "lib/map.h"
 #include "lib/match.h"
 #include "lib/ordered_map.h"
 #include "lib/ordered_set.h"
 #include "lib/safe_vector.h"
+#include "lib/small_ordered_map.h"
 #include "ir.h"
 #include "json_parser.h"
 
@@ -64,13 +67,37 @@ class JSONLoader {
         if (auto obj = dynamic_cast<JsonObject *>(unpacker.json))
             json = get(obj, field); }
 
+ protected:
+    /// Streaming mode (see JSONStreamLoader): when @stream is set, the loader reads the
+    /// fields of one JSON object straight from the stream, in the order load() asks for
+    /// them, and @json holds only the fields that were skipped over to get there.
+    JsonStreamReader *stream = nullptr;
+    bool opened = false, closed = false;
+
+    JSONLoader(JsonStreamReader *stream, std::unordered_map<int, IR::Node*> &refs)
+    : node_refs(refs), stream(stream) {}
+
  private:
+    void open();
+    JsonData *buffered(const std::string &field) const;
+    /// Find @field in the current object.  @return false if it is absent; otherwise
+    /// @value is its tree if it was skipped over earlier, or null if it is next in the
+    /// stream.
+    bool seek(const std::string &field, JsonData *&value);
+    /// Read the rest of a node object after its constructor has loaded its fields.
+    void finish(IR::Node *node);
+    /// Read a node (or a reference to an earlier one) from the stream.  @fallback makes
+    /// nodes whose type is not in IR::unpacker_table.
+    const IR::Node *stream_node(NodeFactoryFn fallback);
+    template<class N> static IR::Node *factory(JSONLoader &json) { return N::fromJSON(json); }
+    template<class T> static const T *as(const IR::Node *n) { return n ? n->to<T>() : nullptr; }
+
     const IR::Node* get_node() {
         if (!json || !json->is<JsonObject>()) return nullptr;  // invalid json exception?
         int id = json->to<JsonObject>()->get_id();
         if (id >= 0) {
             if (node_refs.find(id) == node_refs.end()) {
-                if (auto fn = get(IR::unpacker_table, json->to<JsonObject>()->get_type())) {
+                if (auto fn = get(IR::unpacker_table(), json->to<JsonObject>()->get_type())) {
                         node_refs[id] = fn(*this);
                         // Creating JsonObject from source_info read from jsonFile
                         // and setting SourceInfo for each node
@@ -153,6 +180,26 @@ class JSONLoader {
             v.insert(temp);
         }
     }
+    template<typename K, typename V, typename C, typename A>
+    void unpack_json(flat_map<K, V, C, A> &v) {
+        std::pair<K, V> temp;
+        for (auto e : *json->to<JsonObject>()) {
+            JsonString* k = new JsonString(e.first);
+            load(k, temp.first);
+            load(e.second, temp.second);
+            v.insert(temp);
+        }
+    }
+    template<typename K, typename V, typename H>
+    void unpack_json(small_ordered_map<K, V, H> &v) {
+        std::pair<K, V> temp;
+        for (auto e : *json->to<JsonObject>()) {
+            JsonString* k = new JsonString(e.first);
+            load(k, temp.first);
+            load(e.second, temp.second);
+            v.insert(temp);
+        }
+    }
     template<typename K, typename V>
     void unpack_json(std::multimap<K, V> &v) {
         std::pair<K, V> temp;
@@ -270,6 +317,66 @@ class JSONLoader {
                 json = (*j)[i];
                 unpack_json(v[i]); } } }
 
+    // Streaming versions of the above.  Nodes and containers are read incrementally;
+    // any other value is small, so it is read into a tree and unpacked from that.
+    template<typename T>
+    typename std::enable_if<!std::is_base_of<IR::INode, T>::value>::type
+    unpack_stream(T &v) { JSONLoader(stream->readValue(), node_refs).unpack_json(v); }
+
+    template<typename T>
+    void unpack_stream(safe_vector<T> &v) {
+        T temp;
+        stream->expect('[');
+        while (stream->nextElement()) {
+            unpack_stream(temp);
+            v.push_back(temp); } }
+    template<typename T>
+    void unpack_stream(std::vector<T> &v) {
+        T temp;
+        stream->expect('[');
+        while (stream->nextElement()) {
+            unpack_stream(temp);
+            v.push_back(temp); } }
+    template<typename T>
+    void unpack_stream(std::set<T> &v) {
+        T temp;
+        stream->expect('[');
+        while (stream->nextElement()) {
+            unpack_stream(temp);
+            v.insert(temp); } }
+    template<typename T>
+    void unpack_stream(ordered_set<T> &v) {
+        T temp;
+        stream->expect('[');
+        while (stream->nextElement()) {
+            unpack_stream(temp);
+            v.insert(temp); } }
+
+    template<typename T> void unpack_stream(IR::Vector<T> &v) {
+        if (auto *n = as<IR::Vector<T>>(stream_node(&factory<IR::Vector<T>>))) v = *n; }
+    template<typename T> void unpack_stream(const IR::Vector<T> *&v) {
+        v = as<IR::Vector<T>>(stream_node(&factory<IR::Vector<T>>)); }
+    template<typename T> void unpack_stream(IR::IndexedVector<T> &v) {
+        if (auto *n = as<IR::IndexedVector<T>>(stream_node(&factory<IR::IndexedVector<T>>)))
+            v = *n; }
+    template<typename T> void unpack_stream(const IR::IndexedVector<T> *&v) {
+        v = as<IR::IndexedVector<T>>(stream_node(&factory<IR::IndexedVector<T>>)); }
+    template<class T, template<class K, class V, class COMP, class ALLOC> class MAP,
+             class COMP, class ALLOC>
+    void unpack_stream(IR::NameMap<T, MAP, COMP, ALLOC> &m) {
+        typedef IR::NameMap<T, MAP, COMP, ALLOC> map_t;
+        if (auto *n = as<map_t>(stream_node(&factory<map_t>))) m = *n; }
+    template<class T, template<class K, class V, class COMP, class ALLOC> class MAP,
+             class COMP, class ALLOC>
+    void unpack_stream(const IR::NameMap<T, MAP, COMP, ALLOC> *&m) {
+        typedef IR::NameMap<T, MAP, COMP, ALLOC> map_t;
+        m = as<map_t>(stream_node(&factory<map_t>)); }
+
+    template<typename T> typename std::enable_if<std::is_base_of<IR::INode, T>::value>::type
+    unpack_stream(T &v) { v = *as<T>(stream_node(nullptr)); }
+    template<typename T> typename std::enable_if<std::is_base_of<IR::INode, T>::value>::type
+    unpack_stream(const T *&v) { v = as<T>(stream_node(nullptr)); }
+
  public:
     template<typename T>
     void load(JsonData* json, T &v) {
@@ -277,6 +384,15 @@ class JSONLoader {
 
     template<typename T>
     void load(const std::string field, T *&v) {
+        if (stream) {
+            JsonData *value;
+            if (!seek(field, value))
+                v = nullptr;
+            else if (value)
+                load(value, v);
+            else
+                unpack_stream(v);
+            return; }
         JSONLoader loader(*this, field);
         if (loader.json == nullptr) {
             v = nullptr;
@@ -285,15 +401,43 @@ class JSONLoader {
 
     template<typename T>
     void load(const std::string field, T &v) {
+        if (stream) {
+            JsonData *value;
+            if (!seek(field, value)) return;
+            if (value)
+                load(value, v);
+            else
+                unpack_stream(v);
+            return; }
         JSONLoader loader(*this, field);
         if (loader.json == nullptr) return;
         loader.unpack_json(v); }
 
     template<typename T> JSONLoader& operator>>(T &v) {
-        unpack_json(v);
+        if (stream)
+            unpack_stream(v);
+        else
+            unpack_json(v);
         return *this; }
 };
 
+/**
+ * A JSONLoader that builds IR nodes while it reads the JSON, instead of first parsing
+ * the whole input into a JsonData tree, so loading a large IR dump needs little memory
+ * beyond the IR itself.  The fields of each object are expected in the order in which
+ * JSONGenerator writes them (the order the node constructors load them in); fields
+ * found out of order are parsed into a tree and still used.  References to nodes by
+ * Node_ID are resolved through the table of nodes read so far, in which the
+ * generator's preorder output always finds them.
+ *
+ * After construction, json is null if the input does not start with an object.  The
+ * root can then be read with operator>> or passed to a node constructor.
+ */
+class JSONStreamLoader : public JSONLoader {
+ public:
+    explicit JSONStreamLoader(std::istream &in);
+};
+
 template<class T>
 IR::Vector<T>::Vector(JSONLoader &json) : VectorBase(json) {
     json.load("vec", vec);
@@ -310,13 +454,13 @@ template<class T>
 IR::IndexedVector<T>* IR::IndexedVector<T>::fromJSON(JSONLoader &json) {
     return new IndexedVector<T>(json);
 }
-template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
          class COMP /*= std::less<cstring>*/,
          class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
 IR::NameMap<T, MAP, COMP, ALLOC>::NameMap(JSONLoader &json) : Node(json) {
     json.load("symbols", symbols);
 }
-template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= std::map */,
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP /*= flat_map */,
          class COMP /*= std::less<cstring>*/,
          class ALLOC /*= std::allocator<std::pair<cstring, const T*>>*/>
 IR::NameMap<T, MAP, COMP, ALLOC> *IR::NameMap<T, MAP, COMP, ALLOC>::fromJSON(JSONLoader &json) {
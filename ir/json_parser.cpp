@@ -18,6 +18,8 @@ limitations under the License.
 
 #include <iostream>
 
+#include "lib/exceptions.h"
+
 int JsonObject::get_id() const {
     if (find("Node_ID") == end())
         return -1;
@@ -121,6 +123,21 @@ std::ostream& operator<<(std::ostream &out, JsonData* json) {
 }
 
 
+// Read the rest of a string whose opening quote has been consumed.
+static std::string readQuoted(std::istream &in) {
+    std::string s;
+    getline(in, s, '"');
+    while (!s.empty() && s.back() == '\\') {
+        int bscount = 0;  // odd number of '\' chars mean the quote is escaped
+        for (auto t = s.rbegin(); t != s.rend() && *t == '\\'; ++t) bscount++;
+        if ((bscount & 1) == 0) break;
+        s += '"';
+        std::string more;
+        getline(in, more, '"');
+        s += more; }
+    return s;
+}
+
 std::istream& operator>>(std::istream &in, JsonData*& json) {
     while (in) {
         char ch;
@@ -163,17 +180,7 @@ std::istream& operator>>(std::istream &in, JsonData*& json) {
             return in;
         }
         case '"': {
-            std::string s;
-            getline(in, s, '"');
-            while (!s.empty() && s.back() == '\\') {
-                int bscount = 0;  // odd number of '\' chars mean the quote is escaped
-                for (auto t = s.rbegin(); t != s.rend() && *t == '\\'; ++t) bscount++;
-                if ((bscount & 1) == 0) break;
-                s += '"';
-                std::string more;
-                getline(in, more, '"');
-                s += more; }
-            json = new JsonString(s);
+            json = new JsonString(readQuoted(in));
             return in;
         }
         case '-': case '0': case '1': case '2': case '3':
@@ -208,3 +215,56 @@ std::istream& operator>>(std::istream &in, JsonData*& json) {
     }
     return in;
 }
+
+int JsonStreamReader::peek() {
+    in >> std::ws;
+    return in.peek();
+}
+
+bool JsonStreamReader::consume(char ch) {
+    if (peek() != ch) return false;
+    in.get();
+    return true;
+}
+
+void JsonStreamReader::expect(char ch) {
+    if (!consume(ch)) fail(std::string("expected '") + ch + "'");
+}
+
+bool JsonStreamReader::consumeNull() {
+    if (peek() != 'n') return false;
+    in.ignore(4);
+    return true;
+}
+
+bool JsonStreamReader::nextKey(std::string &key) {
+    consume(',');
+    if (consume('}')) return false;
+    key = readString();
+    expect(':');
+    return true;
+}
+
+bool JsonStreamReader::nextElement() {
+    consume(',');
+    if (peek() == EOF) fail("unterminated array");
+    return !consume(']');
+}
+
+std::string JsonStreamReader::readString() {
+    expect('"');
+    return readQuoted(in);
+}
+
+JsonData *JsonStreamReader::readValue() {
+    JsonData *rv = nullptr;
+    in >> rv;
+    if (!rv) fail("expected a value");
+    return rv;
+}
+
+void JsonStreamReader::fail(const std::string &what) {
+    in.clear();
+    throw Util::CompilationError("JSON IR input: %1% at offset %2%", what,
+                                 static_cast<long long>(in.tellg()));
+}
@@ -77,6 +77,35 @@ class JsonObject : public JsonData, public ordered_map<std::string, JsonData*>
 
 class JsonNull : public JsonData {};
 
+/**
+ * Reads JSON incrementally from a stream, for the streaming mode of JSONLoader: objects
+ * and arrays are consumed a token at a time, and only values the caller asks for as a
+ * whole are built into JsonData trees.  Malformed input throws Util::CompilationError.
+ */
+class JsonStreamReader {
+    std::istream &in;
+
+ public:
+    explicit JsonStreamReader(std::istream &in) : in(in) {}
+
+    /// @return the next non-blank character, without consuming it, or EOF
+    int peek();
+    /// Consume @ch if it is the next non-blank character.
+    bool consume(char ch);
+    void expect(char ch);
+    /// Consume a null literal if it is next.
+    bool consumeNull();
+    /// Read the next key of an object whose '{' has been consumed, and the ':' after it.
+    /// @return false at the closing '}', which is consumed
+    bool nextKey(std::string &key);
+    /// @return false at the closing ']' of an array whose '[' has been consumed
+    bool nextElement();
+    std::string readString();
+    /// Read the next value into a JsonData tree.
+    JsonData *readValue();
+    [[noreturn]] void fail(const std::string &what);
+};
+
 std::string getIndent(int l);
 
 std::ostream& operator<<(std::ostream &out, JsonData* json);
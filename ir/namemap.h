@@ -17,11 +17,17 @@ limitations under the License.
 #ifndef _IR_NAMEMAP_H_
 #define _IR_NAMEMAP_H_
 
+#include "lib/flat_map.h"
+#include "lib/hash.h"
+
 class JSONLoader;
+class BinaryLoader;
 
 namespace IR {
 
-template<class T, template<class K, class V, class COMP, class ALLOC> class MAP = std::map,
+/// A map from names to nodes.  The default MAP is a flat_map, as most NameMaps are small;
+/// it keeps the same order as a std::map.
+template<class T, template<class K, class V, class COMP, class ALLOC> class MAP = flat_map,
          class COMP = std::less<cstring>,
          class ALLOC = std::allocator<std::pair<const cstring, const T*>>>
 class NameMap : public Node {
@@ -39,6 +45,7 @@ class NameMap : public Node {
     NameMap(const NameMap &) = default;
     NameMap(NameMap &&) = default;
     explicit NameMap(JSONLoader &);
+    explicit NameMap(BinaryLoader &);
     NameMap &operator=(const NameMap &) = default;
     NameMap &operator=(NameMap &&) = default;
     typedef typename map_t::value_type          value_type;
@@ -124,6 +131,12 @@ class NameMap : public Node {
             if (el.first != it->first || !el.second->equiv(*(it++)->second))
                 return false;
         return true; }
+    size_t structural_hash() const override {
+        size_t rv = Node::structural_hash();
+        for (auto &el : *this)
+            rv = Util::Hash::hash_combine(rv, Util::Hash::hash_combine(
+                    std::hash<cstring>()(el.first), el.second->structural_hash()));
+        return rv; }
     cstring node_type_name() const override {
         return "NameMap<" + T::static_type_name() + ">"; }
     static cstring static_type_name() {
@@ -132,6 +145,8 @@ class NameMap : public Node {
     void visit_children(Visitor &v) const override;
     void toJSON(JSONGenerator &json) const override;
     static NameMap<T, MAP, COMP, ALLOC> *fromJSON(JSONLoader &json);
+    void toBinary(BinaryGenerator &bin) const override;
+    static NameMap<T, MAP, COMP, ALLOC> *fromBinary(BinaryLoader &bin);
 
     Util::Enumerator<const T*>* valueEnumerator() const {
         return Util::Enumerator<const T*>::createEnumerator(Values(symbols).begin(),
@@ -16,15 +16,19 @@ limitations under the License.
 
 #include "ir.h"
 #include "ir/json_loader.h"
+#include "ir/binary_loader.h"
 
 #include "node.h"
 
 void IR::Node::traceVisit(const char* visitor) const
 { LOG3("Visiting " << visitor << " " << id << ":" << node_type_name()); }
 
-void IR::Node::traceCreation() const { LOG5("Created node " << id); }
+void IR::Node::traceCreation() const {
+    LOG5("Created node " << id);
+    if (AllocStats::enabled) AllocStats::created(this, clone_id != id);
+}
 
-int IR::Node::currentId = 0;
+std::atomic<int> IR::Node::currentId(0);
 
 void IR::Node::toJSON(JSONGenerator &json) const {
     json << json.indent << "\"Node_ID\" : " << id << "," << std::endl
@@ -38,6 +42,21 @@ IR::Node::Node(JSONLoader &json) : id(-1) {
     else if (id >= currentId)
         currentId = id+1;
     clone_id = id;
+    traceCreation();
+}
+
+void IR::Node::toBinary(BinaryGenerator &bin) const {
+    bin << id;
+}
+
+IR::Node::Node(BinaryLoader &bin) : id(-1) {
+    bin >> id;
+    if (id < 0)
+        id = currentId++;
+    else if (id >= currentId)
+        currentId = id+1;
+    clone_id = id;
+    traceCreation();
 }
 
 // Abbreviated debug print
@@ -95,7 +114,7 @@ Util::JsonObject* IR::Node::sourceInfoJsonObj() const {
     unsigned lineNumber, columnNumber;
     cstring fName = prepareSourceInfoForJSON(si, &lineNumber, &columnNumber);
     if (fName == nullptr) {
-        if (si.line == -1) {
+        if (si.line() == -1) {
             // -1 is default value for objects when SourceInfo
             // was not read from jsonFile using "--fromJSON" flag
             return nullptr;
@@ -103,10 +122,10 @@ Util::JsonObject* IR::Node::sourceInfoJsonObj() const {
             // Added source_info for jsonObject when "--fromJSON" flag is used
             // which parameters are saved in srcInfo fileds(filename, line, column and srcBrief)
             auto json1 = new Util::JsonObject();
-            json1->emplace("filename", srcInfo.filename);
-            json1->emplace("line", srcInfo.line);
-            json1->emplace("column", srcInfo.column);
-            json1->emplace("source_fragment", srcInfo.srcBrief);
+            json1->emplace("filename", srcInfo.filename());
+            json1->emplace("line", srcInfo.line());
+            json1->emplace("column", srcInfo.column());
+            json1->emplace("source_fragment", srcInfo.srcBrief());
             return json1;
         }
     } else {
@@ -141,4 +160,18 @@ void IR::Node::sourceInfoToJSON(JSONGenerator &json) const {
     json << --json.indent << "}";
 }
 
+void IR::Node::sourceInfoToBinary(BinaryGenerator &bin) const {
+    Util::SourceInfo si = srcInfo;
+    unsigned lineNumber, columnNumber;
+    cstring fName = prepareSourceInfoForJSON(si, &lineNumber, &columnNumber);
+    if (fName) {
+        bin << true << fName << lineNumber << columnNumber << si.toBriefSourceFragment();
+    } else if (srcInfo.line() != -1) {
+        // as read back from a file by --fromJSON or --fromBinaryIR
+        bin << true << srcInfo.filename() << unsigned(srcInfo.line()) << unsigned(srcInfo.column())
+            << srcInfo.srcBrief();
+    } else {
+        bin << false; }
+}
+
 IRNODE_DEFINE_APPLY_OVERLOAD(Node, , )
@@ -17,22 +17,29 @@ limitations under the License.
 #ifndef _IR_NODE_H_
 #define _IR_NODE_H_
 
+#include <atomic>
 #include <memory>
+#include <type_traits>
+#include "lib/arena.h"
 #include "lib/cstring.h"
 #include "lib/stringify.h"
 #include "lib/indent.h"
 #include "lib/source_file.h"
 #include "ir-tree-macros.h"
+#include "alloc_stats.h"
 #include "lib/log.h"
 #include "lib/json.h"
 
 class Visitor;
 struct Visitor_Context;
 class Inspector;
+class FusedInspector;
 class Modifier;
 class Transform;
 class JSONGenerator;
 class JSONLoader;
+class BinaryGenerator;
+class BinaryLoader;
 
 namespace IR {
 
@@ -41,6 +48,15 @@ class Annotation;
 
 template<class T> class Vector;
 template<class T> class IndexedVector;
+
+/// True for the node classes generated by the ir-generator, which are numbered so that the
+/// node kinds of T and all its subclasses are [T::static_kind_first, T::static_kind_last].
+/// Casts to such classes are integer compares rather than dynamic_casts.
+template<class T, class = void> struct has_node_kind : std::false_type {};
+template<class T> struct has_node_kind<T,
+        typename std::enable_if<std::is_same<typename T::node_kind_class, T>::value>::type>
+    : std::true_type {};
+
 // node interface
 class INode : public Util::IHasSourceInfo, public IHasDbPrint {
  public:
@@ -50,11 +66,21 @@ class INode : public Util::IHasSourceInfo, public IHasDbPrint {
     virtual void dbprint(std::ostream &out) const = 0;  // for debugging
     virtual cstring toString() const = 0;  // for user consumption
     virtual void toJSON(JSONGenerator &) const = 0;
+    virtual void toBinary(BinaryGenerator &) const = 0;
     virtual cstring node_type_name() const = 0;
     virtual void validate() const {}
     virtual const Annotation *getAnnotation(cstring) const { return nullptr; }
+    /// The kind of a generated node class (see has_node_kind); 0 for all other nodes.
+    virtual unsigned node_kind() const { return 0; }
     template<typename T> bool is() const { return to<T>() != nullptr; }
-    template<typename T> const T *to() const { return dynamic_cast<const T*>(this); }
+    template<typename T>
+    typename std::enable_if<!has_node_kind<T>::value, const T *>::type to() const {
+        return dynamic_cast<const T*>(this); }
+    template<typename T>
+    typename std::enable_if<has_node_kind<T>::value, const T *>::type to() const {
+        unsigned kind = node_kind();
+        return kind >= T::static_kind_first && kind <= T::static_kind_last
+               ? static_cast<const T *>(getNode()) : nullptr; }
     template<typename T> const T &as() const { return dynamic_cast<const T&>(*this); }
 
     /// A checked version of INode::to. A BUG occurs if the cast fails.
@@ -83,12 +109,13 @@ class Node : public virtual INode {
     Node &operator=(Node &&) = default;
 
  protected:
-    static int currentId;
+    static std::atomic<int> currentId;
     void traceVisit(const char* visitor) const;
     virtual void visit_children(Visitor &) { }
     virtual void visit_children(Visitor &) const { }
     friend class ::Visitor;
     friend class ::Inspector;
+    friend class ::FusedInspector;
     friend class ::Modifier;
     friend class ::Transform;
     cstring prepareSourceInfoForJSON(Util::SourceInfo& si,
@@ -106,6 +133,18 @@ class Node : public virtual INode {
     Node(const Node& other) : srcInfo(other.srcInfo), id(currentId++), clone_id(other.clone_id) {
         traceCreation(); }
     virtual ~Node() {}
+    /// Nodes are allocated from the current Util::Arena, if there is one.
+    static void *operator new(std::size_t size) {
+        void *rv;
+        if (auto *arena = Util::Arena::current())
+            rv = arena->allocate(size);
+        else
+            rv = ::operator new(size);
+        if (AllocStats::enabled) AllocStats::allocated(rv, size);
+        return rv; }
+    static void operator delete(void *p) {
+        if (AllocStats::enabled) AllocStats::released(p);
+        if (!Util::Arena::isArenaPtr(p)) ::operator delete(p); }
     const Node *apply(Visitor &v, const Visitor_Context *ctxt = nullptr) const;
     const Node *apply(Visitor &&v, const Visitor_Context *ctxt = nullptr) const {
         return apply(v, ctxt); }
@@ -119,12 +158,22 @@ class Node : public virtual INode {
     static cstring static_type_name() { return "Node"; }
     virtual int num_children() { return 0; }
     template<typename T> bool is() const { return to<T>() != nullptr; }
-    template<typename T> const T *to() const { return dynamic_cast<const T*>(this); }
+    template<typename T>
+    typename std::enable_if<!has_node_kind<T>::value, const T *>::type to() const {
+        return dynamic_cast<const T*>(this); }
+    template<typename T>
+    typename std::enable_if<has_node_kind<T>::value, const T *>::type to() const {
+        unsigned kind = node_kind();
+        return kind >= T::static_kind_first && kind <= T::static_kind_last
+               ? static_cast<const T *>(this) : nullptr; }
     template<typename T> const T &as() const { return dynamic_cast<const T&>(*this); }
     explicit Node(JSONLoader &json);
+    explicit Node(BinaryLoader &bin);
     cstring toString() const override { return node_type_name(); }
     void toJSON(JSONGenerator &json) const override;
     void sourceInfoToJSON(JSONGenerator &json) const;
+    void toBinary(BinaryGenerator &bin) const override;
+    void sourceInfoToBinary(BinaryGenerator &bin) const;
     Util::JsonObject* sourceInfoJsonObj() const;
     /* operator== does a 'shallow' comparison, comparing two Node subclass objects for equality,
      * and comparing pointers in the Node directly for equality */
@@ -132,6 +181,9 @@ class Node : public virtual INode {
     /* 'equiv' does a deep-equals comparison, comparing all non-pointer fields and recursing
      * though all Node subclass pointers to compare them with 'equiv' as well. */
     virtual bool equiv(const Node &a) const { return typeid(*this) == typeid(a); }
+    /* 'structural_hash' hashes what 'equiv' compares (so never source positions), so nodes
+     * that are equiv hash the same and the IR can be indexed by structure. */
+    virtual size_t structural_hash() const { return typeid(*this).hash_code(); }
 #define DEFINE_OPEQ_FUNC(CLASS, BASE) \
     virtual bool operator==(const CLASS &) const { return false; }
     IRNODE_ALL_SUBCLASSES(DEFINE_OPEQ_FUNC)
@@ -152,6 +204,15 @@ inline bool equiv(const Node *a, const Node *b) {
 inline bool equiv(const INode *a, const INode *b) {
     return a == b || (a && b && a->getNode()->equiv(*b->getNode())); }
 
+/* node kind of a class generated by the ir-generator, which numbers the classes in
+ * preorder so that each class's subclasses have kinds in (FIRST, LAST] */
+#define IRNODE_KIND(T, FIRST, LAST)                                     \
+ public:                                                                \
+    typedef T node_kind_class;                                          \
+    static constexpr unsigned static_kind_first = FIRST;                \
+    static constexpr unsigned static_kind_last = LAST;                  \
+    unsigned node_kind() const override { return FIRST; }
+
 /* common things that ALL Node subclasses must define */
 #define IRNODE_SUBCLASS(T)                                              \
  public:                                                                \
@@ -0,0 +1,64 @@
+#include "node_census.h"
+
+#include <ostream>
+
+#include "ir/ir.h"
+#include "lib/exceptions.h"
+#include "lib/log.h"
+
+namespace IR {
+
+NodeCensus *NodeCensus::global = nullptr;
+
+size_t NodeCensus::getCount(cstring nodeClass) const {
+    auto it = counts.find(nodeClass);
+    return it == counts.end() ? 0 : it->second;
+}
+
+static std::ostream &row(std::ostream &out, cstring pass, cstring nodeClass, size_t count,
+                         long delta) {
+    return out << pass << "," << nodeClass << "," << count << ","
+               << (delta > 0 ? "+" : "") << delta << "\n";
+}
+
+void NodeCensus::record(cstring pass, const Node *tree) {
+    bool first = last == nullptr;
+    if (csv && first)
+        *csv << "pass,class,count,delta\n";
+    long delta = 0;
+    if (tree != last) {
+        struct Counter : public Inspector {
+            std::map<cstring, size_t> counts;
+            size_t total = 0;
+            bool preorder(const Node *node) override {
+                counts[node->node_type_name()]++;
+                total++;
+                return true; }
+        } counter;
+        tree->apply(counter);
+        delta = static_cast<long>(counter.total) - static_cast<long>(total);
+        if (csv) {
+            // the classes whose count changed, including those that have no nodes left
+            for (auto &c : counter.counts) {
+                auto before = getCount(c.first);
+                if (c.second != before)
+                    row(*csv, pass, c.first, c.second,
+                        static_cast<long>(c.second) - static_cast<long>(before)); }
+            for (auto &c : counts)
+                if (!counter.counts.count(c.first))
+                    row(*csv, pass, c.first, 0, -static_cast<long>(c.second)); }
+        counts = std::move(counter.counts);
+        total = counter.total;
+        last = tree;
+        if (first)
+            initial = total; }
+    if (csv) {
+        row(*csv, pass, "total", total, delta);
+        csv->flush(); }
+    LOG1(pass << ": " << total << " nodes (" << (delta > 0 ? "+" : "") << delta << ")");
+    if (maxGrowth > 0 && total > maxGrowth * initial)
+        FATAL_ERROR("%1%: the program grew to %2% IR nodes, more than %3% times its "
+                    "initial %4% nodes", pass, total, maxGrowth, initial);
+}
+
+}  // namespace IR
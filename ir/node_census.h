@@ -0,0 +1,52 @@
+#ifndef _IR_NODE_CENSUS_H_
+#define _IR_NODE_CENSUS_H_
+
+#include <iosfwd>
+#include <map>
+
+#include "lib/cstring.h"
+
+namespace IR {
+
+class Node;
+
+/**
+ * Counts the nodes of the IR after each pass, in total and by node class, to find the
+ * passes that make the program grow.  Enabled by --node-census, which writes a CSV file
+ * with a row for each node class whose count changed and a "total" row for each pass:
+ *
+ *     pass,class,count,delta
+ *     FrontEnd_12_SimplifyParsers,P4ParserState,18,+6
+ *     FrontEnd_12_SimplifyParsers,total,1520,+42
+ *
+ * and by --max-ir-growth, which stops the compilation with a fatal error as soon as the
+ * program has more than the given factor times the nodes it had the first time it was
+ * counted.  The totals are also logged at level 1.  Nodes shared by several parents are
+ * counted once.
+ */
+class NodeCensus {
+    std::ostream *csv = nullptr;
+    double maxGrowth = 0;
+    const Node *last = nullptr;
+    size_t initial = 0;
+    size_t total = 0;
+    std::map<cstring, size_t> counts;
+
+ public:
+    /// The census that ParserOptions::getDebugHook reports to, if enabled.
+    static NodeCensus *global;
+
+    /// Write the counts to @csv, if not null.
+    void setOutput(std::ostream *csv) { this->csv = csv; }
+    /// Stop when the IR has more than @factor times its initial size; 0 for no limit.
+    void setMaxGrowth(double factor) { maxGrowth = factor; }
+    /// Count the nodes of @tree after the pass called @pass.
+    void record(cstring pass, const Node *tree);
+
+    size_t getTotal() const { return total; }
+    size_t getCount(cstring nodeClass) const;
+};
+
+}  // namespace IR
+
+#endif /* _IR_NODE_CENSUS_H_ */
@@ -17,6 +17,14 @@ limitations under the License.
 #ifndef _IR_NODEMAP_H_
 #define _IR_NODEMAP_H_
 
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/hash.h"
+
 namespace IR {
 
 template<class KEY, class VALUE,
@@ -82,6 +90,12 @@ class NodeMap : public Node {
             if (el.first != it->first || !el.second->equiv(*(it++)->second))
                 return false;
         return true; }
+    size_t structural_hash() const override {
+        size_t rv = Node::structural_hash();
+        for (auto &el : *this)
+            rv = Util::Hash::hash_combine(rv, Util::Hash::hash_combine(
+                    std::hash<const void *>()(el.first), el.second->structural_hash()));
+        return rv; }
     cstring node_type_name() const override {
         return "NodeMap<" + KEY::static_type_name() + "," + VALUE::static_type_name() + ">"; }
     static cstring static_type_name() {
@@ -90,6 +104,163 @@ class NodeMap : public Node {
     void visit_children(Visitor &v) const override;
 };
 
+/**
+ * A side table from nodes to values, indexed by Node::id instead of by hashing or
+ * comparing pointers.  Ids are handed out sequentially, so the nodes of a program have
+ * dense runs of ids, and the index is a table of pages of ids that are allocated as
+ * they are first used.  Ids are not quite unique -- nodes read back from a JSON or
+ * binary dump keep the ids they were written with -- so each entry records its key,
+ * and a node whose id is already taken by another node goes into a (normally empty)
+ * overflow map.
+ *
+ * Entries are kept in insertion order, which is also the iteration order.  As with a
+ * std::vector, inserting or erasing entries invalidates iterators.
+ */
+template<class V, class K = Node>
+class DenseNodeMap {
+ public:
+    typedef const K *                   key_type;
+    typedef V                           mapped_type;
+    typedef std::pair<const K *, V>     value_type;
+
+ private:
+    static constexpr unsigned PAGE_BITS = 10;
+    static constexpr unsigned PAGE_SIZE = 1U << PAGE_BITS;
+    std::vector<value_type>     entries;    // the key is null for erased entries
+    std::vector<uint32_t *>     pages;      // entry index + 1 for each id, or 0
+    std::unordered_map<const K *, uint32_t>     overflow;
+    size_t                      live = 0;
+
+    /// @return the index slot for @id, allocating its page if @create is set
+    uint32_t *slot(int id, bool create) {
+        if (id < 0) return nullptr;
+        size_t page = static_cast<size_t>(id) >> PAGE_BITS;
+        if (page >= pages.size()) {
+            if (!create) return nullptr;
+            pages.resize(page + 1, nullptr); }
+        if (!pages[page]) {
+            if (!create) return nullptr;
+            pages[page] = new uint32_t[PAGE_SIZE];
+            memset(pages[page], 0, PAGE_SIZE * sizeof(uint32_t)); }
+        return &pages[page][id & (PAGE_SIZE - 1)]; }
+    /// @return the entry index + 1 of @key, or 0 if it is not present
+    uint32_t lookup(const K *key) const {
+        int id = key->id;
+        size_t page = static_cast<size_t>(id) >> PAGE_BITS;
+        if (id >= 0 && page < pages.size() && pages[page]) {
+            uint32_t i = pages[page][id & (PAGE_SIZE - 1)];
+            if (i && entries[i - 1].first == key) return i; }
+        if (overflow.empty()) return 0;
+        auto it = overflow.find(key);
+        return it == overflow.end() ? 0 : it->second; }
+    void index(const K *key, uint32_t i) {
+        uint32_t *s = slot(key->id, true);
+        if (s && (!*s || !entries[*s - 1].first))
+            *s = i;
+        else
+            overflow.emplace(key, i); }
+    /// Drop the erased entries, once they are the majority.
+    void compact() {
+        std::vector<value_type> kept;
+        kept.reserve(live);
+        for (auto &e : entries)
+            if (e.first) kept.push_back(e);
+        clear();
+        for (auto &e : kept) {
+            entries.push_back(e);
+            index(e.first, entries.size()); }
+        live = entries.size(); }
+
+    template<class E> class iter {
+        E       *p, *last;
+        void skip() { while (p != last && !p->first) ++p; }
+     public:
+        iter(E *p, E *last) : p(p), last(last) { skip(); }
+        E &operator*() const { return *p; }
+        E *operator->() const { return p; }
+        iter &operator++() { ++p; skip(); return *this; }
+        iter operator++(int) { iter rv = *this; ++*this; return rv; }
+        bool operator==(const iter &i) const { return p == i.p; }
+        bool operator!=(const iter &i) const { return p != i.p; }
+    };
+
+ public:
+    typedef iter<value_type>            iterator;
+    typedef iter<const value_type>      const_iterator;
+
+    DenseNodeMap() = default;
+    DenseNodeMap(const DenseNodeMap &a) : entries(a.entries), overflow(a.overflow),
+                                          live(a.live) {
+        pages.resize(a.pages.size(), nullptr);
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (!a.pages[i]) continue;
+            pages[i] = new uint32_t[PAGE_SIZE];
+            memcpy(pages[i], a.pages[i], PAGE_SIZE * sizeof(uint32_t)); } }
+    DenseNodeMap &operator=(const DenseNodeMap &a) {
+        if (this != &a) {
+            DenseNodeMap tmp(a);
+            swap(tmp); }
+        return *this; }
+    ~DenseNodeMap() { for (auto *p : pages) delete [] p; }
+    void swap(DenseNodeMap &a) {
+        entries.swap(a.entries);
+        pages.swap(a.pages);
+        overflow.swap(a.overflow);
+        std::swap(live, a.live); }
+
+    iterator begin() { return iterator(entries.data(), entries.data() + entries.size()); }
+    iterator end() {
+        return iterator(entries.data() + entries.size(), entries.data() + entries.size()); }
+    const_iterator begin() const {
+        return const_iterator(entries.data(), entries.data() + entries.size()); }
+    const_iterator end() const {
+        return const_iterator(entries.data() + entries.size(),
+                              entries.data() + entries.size()); }
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    /// Remove all entries; the index pages are kept for reuse.
+    void clear() {
+        entries.clear();
+        for (auto *p : pages)
+            if (p) memset(p, 0, PAGE_SIZE * sizeof(uint32_t));
+        overflow.clear();
+        live = 0; }
+
+    size_t count(const K *key) const { return lookup(key) ? 1 : 0; }
+    iterator find(const K *key) {
+        uint32_t i = lookup(key);
+        return i ? iterator(&entries[i - 1], entries.data() + entries.size()) : end(); }
+    const_iterator find(const K *key) const {
+        uint32_t i = lookup(key);
+        return i ? const_iterator(&entries[i - 1], entries.data() + entries.size()) : end(); }
+    /// @return the value for @key, or @def if it is not present
+    V get(const K *key, V def = V()) const {
+        uint32_t i = lookup(key);
+        return i ? entries[i - 1].second : def; }
+
+    std::pair<iterator, bool> emplace(const K *key, const V &value) {
+        if (uint32_t i = lookup(key))
+            return std::make_pair(iterator(&entries[i - 1], entries.data() + entries.size()),
+                                  false);
+        entries.emplace_back(key, value);
+        index(key, entries.size());
+        ++live;
+        return std::make_pair(iterator(&entries.back(), entries.data() + entries.size()),
+                              true); }
+    V &operator[](const K *key) { return emplace(key, V()).first->second; }
+    size_t erase(const K *key) {
+        uint32_t i = lookup(key);
+        if (!i) return 0;
+        entries[i - 1] = value_type(nullptr, V());
+        uint32_t *s = slot(key->id, false);
+        if (s && *s == i)
+            *s = 0;
+        else
+            overflow.erase(key);
+        if (--live * 2 < entries.size() && entries.size() > PAGE_SIZE) compact();
+        return 1; }
+};
+
 }  // namespace IR
 
 #endif /* _IR_NODEMAP_H_ */
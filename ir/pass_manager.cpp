@@ -14,6 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
 #include "ir.h"
 #include "lib/gc.h"
 #include "lib/n4.h"
@@ -44,6 +48,60 @@ void PassManager::listPasses(std::ostream &out, cstring sep) const {
         first = false; }
 }
 
+bool PassManager::canSkip(const Visitor *v, const IR::Node *program) const {
+    if (!unchangedInput) return false;
+    auto it = unchangedInput->find(v);
+    return it != unchangedInput->end() && it->second == program;
+}
+
+void PassManager::recordResult(const Visitor *v, const IR::Node *program,
+                               const IR::Node *after) {
+    if (!unchangedInput) return;
+    // Only passes that just rewrite the tree are candidates for skipping; Inspectors,
+    // functors and the like are run for their side effects.
+    if (dynamic_cast<const PassManager *>(v) ||
+        !(dynamic_cast<const Transform *>(v) || dynamic_cast<const Modifier *>(v)))
+        return;
+    if (after == program)
+        (*unchangedInput)[v] = program;
+    else
+        unchangedInput->erase(v);
+}
+
+/// The number of distinct nodes in @tree.
+static size_t nodeCount(const IR::Node *tree) {
+    struct NodeCounter : public Inspector {
+        size_t count = 0;
+        bool preorder(const IR::Node *) override { count++; return true; }
+    } counter;
+    tree->apply(counter);
+    return counter.count;
+}
+
+void PassManager::reportProfile(const Visitor *v, const IR::Node *before,
+                                const IR::Node *after, double milliseconds) {
+    if (before != profiledTree) {
+        profiledTree = before;
+        profiledSize = nodeCount(before); }
+    long delta = 0;
+    if (after != nullptr && after != before) {
+        size_t size = nodeCount(after);
+        delta = static_cast<long>(size) - static_cast<long>(profiledSize);
+        profiledTree = after;
+        profiledSize = size; }
+    // formatted apart so that the flags of the profile stream do not change
+    std::stringstream line;
+    line << name() << "_" << seqNo << "_" << v->name() << ": " << std::fixed
+         << std::setprecision(3) << milliseconds << " ms, " << profiledSize << " nodes ("
+         << std::showpos << delta << ")";
+    *profile << line.str() << std::endl;
+}
+
+static bool fusable(const Visitor *v) {
+    auto *insp = dynamic_cast<const Inspector *>(v);
+    return insp && insp->canFuse() && !dynamic_cast<const Backtrack *>(v);
+}
+
 const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *) {
     safe_vector<std::pair<safe_vector<Visitor *>::iterator, const IR::Node *>> backup;
     static indent_t log_indent(-1);
@@ -61,10 +119,41 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
         if (auto b = dynamic_cast<Backtrack *>(v)) {
             if (!b->never_backtracks()) {
                 backup.emplace_back(it, program); } }
+        if (canSkip(v, program)) {
+            LOG1(log_indent << name() << " skipping " << v->name() << " (input unchanged)");
+            seqNo++;
+            it++;
+            continue; }
+        // adjacent independent Inspectors share one traversal
+        size_t group = 1;
+        if (fuse_inspectors && fusable(v)) {
+            while (it + group != passes.end() && fusable(it[group])) ++group;
+            if (group > 1) {
+                std::vector<Inspector *> members;
+                for (size_t i = 0; i < group; ++i)
+                    members.push_back(dynamic_cast<Inspector *>(it[i]));
+                v = new FusedInspector(members, stop_on_error); } }
         try {
             try {
                 LOG1(log_indent << name() << " invoking " << v->name());
-                auto after = program->apply(**it);
+                // nested PassManagers share our record of unchanged inputs
+                auto *child = dynamic_cast<PassManager *>(v);
+                if (child && child->unchangedInput) child = nullptr;
+                if (child) child->unchangedInput = unchangedInput;
+                const IR::Node *after;
+                gc_pass_scope gc_scope;
+                auto start = std::chrono::steady_clock::now();
+                try {
+                    after = program->apply(*v);
+                } catch (...) {
+                    if (child) child->unchangedInput = nullptr;
+                    throw; }
+                if (child) child->unchangedInput = nullptr;
+                recordResult(v, program, after);
+                if (profile)
+                    reportProfile(v, program, after,
+                                  std::chrono::duration<double, std::milli>(
+                                      std::chrono::steady_clock::now() - start).count());
                 if (LOGGING(3)) {
                     size_t maxmem, mem = gc_mem_inuse(&maxmem);  // triggers gc
                     LOG3(log_indent << "heap after " << v->name() << ": in use " <<
@@ -72,6 +161,7 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
                 if (stop_on_error && ::errorCount() > initial_error_count)
                     break;
                 if ((program = after) == nullptr) break;
+                gc_scope.finished();
             } catch (Backtrack::trigger::type_t &trig_type) {
                 throw Backtrack::trigger(trig_type);
             }
@@ -91,11 +181,13 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
                 LOG1(log_indent << "rethrow trigger");
                 throw; }
             continue; }
-        runDebugHooks(v->name(), program);
+        for (size_t i = 0; i < group; ++i) {
+            runDebugHooks(it[i]->name(), program);
+            if (i + 1 < group) seqNo++; }
         if (early_exit_flag)
             break;
         seqNo++;
-        it++; }
+        it += group; }
     running = false;
     return program;
 }
@@ -127,6 +219,15 @@ const IR::Node *PassRepeated::apply_visitor(const IR::Node *program, const char
     bool done = false;
     unsigned iterations = 0;
     unsigned initial_error_count = ::errorCount();
+    // Passes that did nothing are not rerun on the same tree in later iterations
+    std::map<const Visitor *, const IR::Node *> unchanged;
+    auto *saveUnchanged = unchangedInput;
+    unchangedInput = &unchanged;
+    struct restore_t {
+        PassRepeated *self;
+        std::map<const Visitor *, const IR::Node *> *save;
+        ~restore_t() { self->unchangedInput = save; }
+    } restore { this, saveUnchanged };
     while (!done) {
         LOG5("PassRepeated state is:\n" << dumpToString(program));
         running = true;
@@ -31,9 +31,26 @@ class PassManager : virtual public Visitor, virtual public Backtrack {
     safe_vector<Visitor *>   passes;
     // if true stops compilation after first pass that signals an error
     bool                stop_on_error = true;
+    // if true, runs of adjacent Inspectors that allow it are run as one FusedInspector
+    bool                fuse_inspectors = true;
     bool                running = false;
     unsigned            seqNo = 0;
+    // When non-null, the time taken by each pass and the size of the IR it produces
+    // are written there
+    std::ostream        *profile = nullptr;
+    // The last tree whose nodes were counted for the profile, and its size
+    const IR::Node      *profiledTree = nullptr;
+    size_t              profiledSize = 0;
+    // When non-null (set by an enclosing PassRepeated), records for each Transform or
+    // Modifier sub-pass the input it was last applied to without changing anything, so
+    // that it can be skipped if it is applied to exactly the same tree again.  This
+    // relies on such passes producing a result that depends only on their input tree.
+    std::map<const Visitor *, const IR::Node *> *unchangedInput = nullptr;
+    bool canSkip(const Visitor *v, const IR::Node *program) const;
+    void recordResult(const Visitor *v, const IR::Node *program, const IR::Node *after);
     void runDebugHooks(const char* visitorName, const IR::Node* node);
+    void reportProfile(const Visitor *v, const IR::Node *before, const IR::Node *after,
+                       double milliseconds);
     profile_t init_apply(const IR::Node *root) override {
         running = true;
         return Visitor::init_apply(root); }
@@ -76,6 +93,7 @@ class PassManager : virtual public Visitor, virtual public Backtrack {
     bool backtrack(trigger &trig) override;
     bool never_backtracks() override;
     void setStopOnError(bool stop) { stop_on_error = stop; }
+    void setFuseInspectors(bool fuse) { fuse_inspectors = fuse; }
     void addDebugHook(DebugHook h, bool recursive = false) {
         debugHooks.push_back(h);
         if (recursive)
@@ -88,6 +106,14 @@ class PassManager : virtual public Visitor, virtual public Backtrack {
             for (auto pass : passes)
                 if (auto child = dynamic_cast<PassManager *>(pass))
                     child->addDebugHooks(hooks, recursive); }
+    /// Writes to @out, after each pass, the time it took and how it changed the number of
+    /// IR nodes.  Nested PassManagers also report their own passes if @recursive.
+    void setProfile(std::ostream *out, bool recursive = false) {
+        profile = out;
+        if (recursive)
+            for (auto pass : passes)
+                if (auto child = dynamic_cast<PassManager *>(pass))
+                    child->setProfile(out, recursive); }
     void early_exit() { early_exit_flag = true; }
     PassManager *clone() const override { return new PassManager(*this); }
 };
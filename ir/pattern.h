@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef IR_PATTERN_H_
 #define IR_PATTERN_H_
 
+#include <type_traits>
+
 #include "ir/ir.h"
 
 /**
@@ -172,5 +174,120 @@ inline Pattern operator^(int v, const Pattern &a) { return Pattern(v) ^ a; }
 inline Pattern operator&&(int v, const Pattern &a) { return Pattern(v) && a; }
 inline Pattern operator||(int v, const Pattern &a) { return Pattern(v) || a; }
 
+/**
+ * Compile-time patterns for IR::Expression trees.
+ *
+ * The same operators as for Pattern, applied to the leaves below, build a pattern whose
+ * type is the whole pattern, so matching allocates nothing and makes no virtual calls:
+ *
+ *     const IR::Expression *a, *b;
+ *     const IR::Constant *mask;
+ *     using StaticPattern::bind;
+ *     if (((bind(a) & bind(mask)) | b).match(expr)) ...
+ *
+ * bind(p) matches a node of the type of p and sets p to it, any<T>() matches a node of
+ * class T, and integers match constants of that value.  As with Pattern, the binary
+ * operators that commute also match the operands swapped, and the pointers bound by a
+ * failed match are left set to whatever they last matched.
+ */
+namespace StaticPattern {
+
+/// Marks the pattern classes, so the operators below only apply to them.
+struct Base {};
+template<class P> using IsPattern = std::is_base_of<Base, P>;
+
+template<class T> class Bind : public Base {
+    const T *&m;
+ public:
+    explicit Bind(const T *&m) : m(m) {}
+    bool match(const IR::Node *n) const { return (m = n->to<T>()) != nullptr; }
+};
+
+template<class T> struct Any : public Base {
+    bool match(const IR::Node *n) const { return n->is<T>(); }
+};
+
+class Const : public Base {
+    long value;
+ public:
+    explicit Const(long v) : value(v) {}
+    bool match(const IR::Node *n) const {
+        auto k = n->to<IR::Constant>();
+        return k && k->value == value; }
+};
+
+template<class T, class E> class Unary : public Base {
+    E expr;
+ public:
+    explicit Unary(const E &e) : expr(e) {}
+    bool match(const IR::Node *n) const {
+        auto u = n->to<T>();
+        return u && expr.match(u->expr); }
+};
+
+template<class T, bool commutative, class L, class R> class Binary : public Base {
+    L left;
+    R right;
+ public:
+    Binary(const L &l, const R &r) : left(l), right(r) {}
+    bool match(const IR::Node *n) const {
+        auto b = n->to<T>();
+        if (!b) return false;
+        if (left.match(b->left) && right.match(b->right))
+            return true;
+        return commutative && left.match(b->right) && right.match(b->left); }
+};
+
+template<class T> Bind<T> bind(const T *&m) { return Bind<T>(m); }
+template<class T> Any<T> any() { return Any<T>(); }
+
+/// The pattern for an operand: a pattern, a pointer to bind, or an integer constant.
+template<class P> const P &operand(const P &p, typename std::enable_if<
+        IsPattern<P>::value>::type * = nullptr) { return p; }
+template<class T> Bind<T> operand(const T *&m) { return Bind<T>(m); }
+inline Const operand(long v) { return Const(v); }
+
+template<class P>
+auto match(const IR::Node *n, const P &pattern) -> decltype(pattern.match(n)) {
+    return pattern.match(n); }
+
+#define STATIC_PATTERN_UNARY(OP, CLASS)                                                 \
+template<class E, class = typename std::enable_if<IsPattern<E>::value>::type>           \
+Unary<IR::CLASS, E> operator OP(const E &e) { return Unary<IR::CLASS, E>(e); }
+STATIC_PATTERN_UNARY(-, Neg)
+STATIC_PATTERN_UNARY(~, Cmpl)
+STATIC_PATTERN_UNARY(!, LNot)
+#undef STATIC_PATTERN_UNARY
+
+// One of the operands must be a pattern; the other may also be a pointer or an integer.
+#define STATIC_PATTERN_BINARY(OP, CLASS, COMMUTATIVE)                                   \
+template<class L, class R, class = typename std::enable_if<                             \
+    IsPattern<typename std::decay<L>::type>::value ||                                   \
+    IsPattern<typename std::decay<R>::type>::value>::type>                              \
+auto operator OP(L &&l, R &&r) -> Binary<IR::CLASS, COMMUTATIVE,                        \
+        typename std::decay<decltype(operand(l))>::type,                                \
+        typename std::decay<decltype(operand(r))>::type> {                              \
+    return { operand(l), operand(r) }; }
+STATIC_PATTERN_BINARY(*, Mul, true)
+STATIC_PATTERN_BINARY(/, Div, false)
+STATIC_PATTERN_BINARY(%, Mod, false)
+STATIC_PATTERN_BINARY(+, Add, true)
+STATIC_PATTERN_BINARY(-, Sub, false)
+STATIC_PATTERN_BINARY(<<, Shl, false)
+STATIC_PATTERN_BINARY(>>, Shr, false)
+STATIC_PATTERN_BINARY(==, Equ, true)
+STATIC_PATTERN_BINARY(!=, Neq, true)
+STATIC_PATTERN_BINARY(<, Lss, false)
+STATIC_PATTERN_BINARY(<=, Leq, false)
+STATIC_PATTERN_BINARY(>, Grt, false)
+STATIC_PATTERN_BINARY(>=, Geq, false)
+STATIC_PATTERN_BINARY(&, BAnd, true)
+STATIC_PATTERN_BINARY(|, BOr, true)
+STATIC_PATTERN_BINARY(^, BXor, true)
+STATIC_PATTERN_BINARY(&&, LAnd, false)
+STATIC_PATTERN_BINARY(||, LOr, false)
+#undef STATIC_PATTERN_BINARY
+
+}  // namespace StaticPattern
 
 #endif /* IR_PATTERN_H_ */
@@ -15,6 +15,9 @@ limitations under the License.
 */
 
 #include <utility>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 #include "ir.h"
 #include "frontends/common/options.h"
 
@@ -51,8 +54,8 @@ const cstring IR::Annotation::noSideEffectsAnnotation = "noSideEffects";
 const cstring IR::Annotation::noWarnAnnotation = "noWarn";
 const cstring IR::Annotation::matchAnnotation = "match";
 
-int Type_Declaration::nextId = 0;
-int Type_InfInt::nextId = 0;
+std::atomic<int> Type_Declaration::nextId(0);
+std::atomic<int> Type_InfInt::nextId(0);
 
 Annotations* Annotations::empty = new Annotations(Vector<Annotation>());
 
@@ -62,35 +65,46 @@ const Type_Bits* Type_Bits::get(int width, bool isSigned) {
     // map (width, signed) to type
     using bit_type_key = std::pair<int, bool>;
     static std::map<bit_type_key, const IR::Type_Bits*> *type_map = nullptr;
-    if (type_map == nullptr)
-        type_map = new std::map<bit_type_key, const IR::Type_Bits*>();
-    auto &result = (*type_map)[std::make_pair(width, isSigned)];
-    if (!result)
-        result = new Type_Bits(width, isSigned);
+    const IR::Type_Bits *result;
+    {
+#ifdef MULTITHREAD
+        // type checking may run on several threads
+        static std::mutex type_map_lock;
+        std::lock_guard<std::mutex> acquire(type_map_lock);
+#endif  // MULTITHREAD
+        if (type_map == nullptr)
+            type_map = new std::map<bit_type_key, const IR::Type_Bits*>();
+        auto &cached = (*type_map)[std::make_pair(width, isSigned)];
+        if (!cached) {
+            Util::Arena::Scope noArena(nullptr);  // cached across compilations
+            cached = new Type_Bits(width, isSigned); }
+        result = cached;
+    }
     if (width > P4CContext::getConfig().maximumWidthSupported())
         ::error(ErrorType::ERR_UNSUPPORTED, "%1%: Compiler only supports widths up to %2%",
                 result, P4CContext::getConfig().maximumWidthSupported());
     return result;
 }
 
+/// Creates the object behind a singleton type outside of any arena; initializing the
+/// local static with it makes get() safe to call from several threads.
+template<class T> static const T *makeSingleton() {
+    Util::Arena::Scope noArena(nullptr);
+    return new T();
+}
+
 const Type::Unknown *Type::Unknown::get() {
-    static const Type::Unknown *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type::Unknown());
+    static const Type::Unknown *singleton = makeSingleton<Type::Unknown>();
     return singleton;
 }
 
 const Type::Boolean *Type::Boolean::get() {
-    static const Type::Boolean *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type::Boolean());
+    static const Type::Boolean *singleton = makeSingleton<Type::Boolean>();
     return singleton;
 }
 
 const Type_String *Type_String::get() {
-    static const Type_String *singleton = nullptr;
-    if (!singleton)
-        singleton = (new Type_String());
+    static const Type_String *singleton = makeSingleton<Type_String>();
     return singleton;
 }
 
@@ -113,30 +127,22 @@ const Type::Varbits *Type::Varbits::get() {
 }
 
 const Type_Dontcare *Type_Dontcare::get() {
-    static const Type_Dontcare *singleton;
-    if (!singleton)
-        singleton = (new Type_Dontcare());
+    static const Type_Dontcare *singleton = makeSingleton<Type_Dontcare>();
     return singleton;
 }
 
 const Type_State *Type_State::get() {
-    static const Type_State *singleton;
-    if (!singleton)
-        singleton = (new Type_State());
+    static const Type_State *singleton = makeSingleton<Type_State>();
     return singleton;
 }
 
 const Type_Void *Type_Void::get() {
-    static const Type_Void *singleton;
-    if (!singleton)
-        singleton = (new Type_Void());
+    static const Type_Void *singleton = makeSingleton<Type_Void>();
     return singleton;
 }
 
 const Type_MatchKind *Type_MatchKind::get() {
-    static const Type_MatchKind *singleton;
-    if (!singleton)
-        singleton = (new Type_MatchKind());
+    static const Type_MatchKind *singleton = makeSingleton<Type_MatchKind>();
     return singleton;
 }
 
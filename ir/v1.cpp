@@ -24,8 +24,9 @@ limitations under the License.
 #define SINGLETON_TYPE(NAME)                                    \
 const IR::Type_##NAME *IR::Type_##NAME::get() {                 \
     static const Type_##NAME *singleton;                        \
-    if (!singleton)                                             \
-        singleton = (new Type_##NAME(Util::SourceInfo()));      \
+    if (!singleton) {                                           \
+        Util::Arena::Scope noArena(nullptr);                    \
+        singleton = (new Type_##NAME(Util::SourceInfo())); }    \
     return singleton;                                           \
 }
 SINGLETON_TYPE(Block)
@@ -19,10 +19,12 @@ limitations under the License.
 
 #include "dbprint.h"
 #include "lib/enumerator.h"
+#include "lib/hash.h"
 #include "lib/null.h"
 #include "lib/safe_vector.h"
 
 class JSONLoader;
+class BinaryLoader;
 
 namespace IR {
 
@@ -46,6 +48,7 @@ class VectorBase : public Node {
     VectorBase &operator=(VectorBase &&) = default;
  protected:
     explicit VectorBase(JSONLoader &json) : Node(json) {}
+    explicit VectorBase(BinaryLoader &bin) : Node(bin) {}
 };
 
 // This class should only be used in the IR.
@@ -60,6 +63,7 @@ class Vector : public VectorBase {
     Vector(const Vector &) = default;
     Vector(Vector &&) = default;
     explicit Vector(JSONLoader &json);
+    explicit Vector(BinaryLoader &bin);
     Vector &operator=(const Vector &) = default;
     Vector &operator=(Vector &&) = default;
     explicit Vector(const T *a) {
@@ -68,6 +72,7 @@ class Vector : public VectorBase {
         vec.insert(vec.end(), a.begin(), a.end()); }
     Vector(const std::initializer_list<const T *> &a) : vec(a) {}
     static Vector<T>* fromJSON(JSONLoader &json);
+    static Vector<T>* fromBinary(BinaryLoader &bin);
     typedef typename safe_vector<const T *>::iterator        iterator;
     typedef typename safe_vector<const T *>::const_iterator  const_iterator;
     iterator begin() { return vec.begin(); }
@@ -176,6 +181,10 @@ class Vector : public VectorBase {
         auto it = a.begin();
         for (auto *el : *this) if (!el->equiv(**it++)) return false;
         return true; }
+    size_t structural_hash() const override {
+        size_t rv = Node::structural_hash();
+        for (auto *el : *this) rv = Util::Hash::hash_combine(rv, el->structural_hash());
+        return rv; }
     cstring node_type_name() const override {
         return "Vector<" + T::static_type_name() + ">"; }
     static cstring static_type_name() {
@@ -185,6 +194,7 @@ class Vector : public VectorBase {
     virtual void parallel_visit_children(Visitor &v);
     virtual void parallel_visit_children(Visitor &v) const;
     void toJSON(JSONGenerator &json) const override;
+    void toBinary(BinaryGenerator &bin) const override;
     Util::Enumerator<const T*>* getEnumerator() const {
         return Util::Enumerator<const T*>::createEnumerator(vec); }
     template <typename S>
@@ -16,8 +16,20 @@ limitations under the License.
 
 
 #include <time.h>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
 #include "ir.h"
+#include "lib/gc.h"
+#include "lib/json.h"
 #include "lib/log.h"
+#include "lib/perf_counters.h"
+#include "lib/thread_pool.h"
 
 #include "visitor.h"
 
@@ -35,7 +47,7 @@ class Visitor::ChangeTracker {
         bool            visitOnce;
         const IR::Node  *result;
     };
-    typedef std::unordered_map<const IR::Node *, visit_info_t>  visited_t;
+    typedef epoch_map<const IR::Node *, visit_info_t>  visited_t;
     visited_t           visited;
 
  public:
@@ -44,16 +56,12 @@ class Visitor::ChangeTracker {
      */
     void start(const IR::Node *n, bool defaultVisitOnce) {
         // Initialization
-        visited_t::iterator visited_it;
-        bool inserted;
         bool visit_in_progress = true;
-        std::tie(visited_it, inserted) =
-            visited.emplace(n, visit_info_t{visit_in_progress, defaultVisitOnce, n});
+        auto vp = visited.emplace(n, visit_info_t{visit_in_progress, defaultVisitOnce, n});
 
         // Sanity check for IR loops
-        bool already_present = !inserted;
-        visit_info_t *visit_info = &(visited_it->second);
-        if (already_present && visit_info->visit_in_progress)
+        bool already_present = !vp.second;
+        if (already_present && vp.first->visit_in_progress)
             BUG("IR loop detected ");
     }
 
@@ -71,11 +79,10 @@ class Visitor::ChangeTracker {
      * previously been invoked.
      */
     bool finish(const IR::Node *orig, const IR::Node *final) {
-        auto it = visited.find(orig);
-        if (it == visited.end())
+        visit_info_t *orig_visit_info = visited.find(orig);
+        if (!orig_visit_info)
             BUG("visitor state tracker corrupted");
 
-        visit_info_t *orig_visit_info = &(it->second);
         orig_visit_info->visit_in_progress = false;
         if (!final) {
             orig_visit_info->result = final;
@@ -84,7 +91,7 @@ class Visitor::ChangeTracker {
             orig_visit_info->result = final;
             visited.emplace(final, visit_info_t{false, orig_visit_info->visitOnce, final});
             return true;
-        } else if (visited.count(final)) {
+        } else if (visited.find(final)) {
             // coalescing with some previously visited node, so we don't want to undo
             // the coalesce
             orig_visit_info->result = final;
@@ -98,19 +105,17 @@ class Visitor::ChangeTracker {
     /** Return a pointer to the visitOnce flag for node @n so that it can be changed
      */
     bool *refVisitOnce(const IR::Node *n) {
-        if (!visited.count(n))
+        visit_info_t *info = visited.find(n);
+        if (!info)
             BUG("visitor state tracker corrupted");
-        return &visited.at(n).visitOnce;
+        return &info->visitOnce;
     }
 
     /** Forget nodes that have already been visited, allowing them to be visited
      * again. */
     void revisit_visited() {
-        for (auto it = visited.begin(); it != visited.end();) {
-            if (!it->second.visit_in_progress)
-                it = visited.erase(it);
-            else
-                ++it; } }
+        visited.erase_if([](const IR::Node *, const visit_info_t &info) {
+            return !info.visit_in_progress; }); }
 
     /** Determine whether @n has been visited and the visitor has finished
      *  and we don't want to visit @n again the next time we see it.
@@ -120,8 +125,8 @@ class Visitor::ChangeTracker {
      * @return true if @n has been visited and the visitor is finished and visitOnce is true
      */
     bool done(const IR::Node *n) const {
-        auto it = visited.find(n);
-        return it != visited.end() && !it->second.visit_in_progress && it->second.visitOnce;
+        const visit_info_t *info = visited.find(n);
+        return info && !info->visit_in_progress && info->visitOnce;
     }
 
     /** Produce the result of visiting @n.
@@ -131,12 +136,149 @@ class Visitor::ChangeTracker {
      * if `start(@n)` has not been invoked.
      */
     const IR::Node *result(const IR::Node *n) const {
-        if (!visited.count(n))
-            return n;
-        return visited.at(n).result;
+        const visit_info_t *info = visited.find(n);
+        return info ? info->result : n;
+    }
+
+    /// Drop all tracked nodes so the tracker can be reused for another traversal.
+    void scrub() { visited.scrub(); }
+};
+
+/** Visited tables are recycled between traversals rather than allocated afresh for each
+ * one, since most passes are run many times over (parts of) the program.  Tables are
+ * scrubbed when returned so a pooled table doesn't keep an old IR tree alive. */
+template<class T> class table_pool {
+    static constexpr size_t MAX_FREE = 16;
+    std::vector<T *>    free;
+#ifdef MULTITHREAD
+    std::mutex          lock;
+#endif
+
+ public:
+    T *get() {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif
+        if (free.empty()) return new T;
+        T *rv = free.back();
+        free.pop_back();
+        return rv; }
+    void put(T *t) {
+        if (!t) return;
+        t->scrub();
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif
+        if (free.size() < MAX_FREE) free.push_back(t); }
+};
+
+template<class T> static table_pool<T> &visited_tables() {
+    static table_pool<T> pool;
+    return pool;
+}
+
+/* The visit functions a visitor inherits.
+ *
+ * Calling preorder or postorder for a node is a virtual call on the node, then a virtual
+ * call on the visitor, then one more for each base class of the node up to the first one
+ * the visitor has an overload for.  Most visitors have overloads for a few classes only,
+ * so for the dynamic type of each visitor, DefaultVisits records the node kinds for which
+ * the overloads of the kind's class and of all its bases up to IR::Node are those of
+ * Inspector, Modifier or Transform, which do nothing.  apply_visitor skips those calls.
+ * Which function a virtual function resolves to for an object is only available as a
+ * GCC extension, so with other compilers, or when visits are traced, nothing is skipped. */
+struct Visitor::DefaultVisits {
+    std::type_index     type;                 // of the visitor
+    std::vector<bool>   preorder, postorder;  // by node kind
+    explicit DefaultVisits(std::type_index type) : type(type) {}
+};
+
+namespace {
+
+template<class V> struct VisitFunctions;
+template<> struct VisitFunctions<Inspector> {
+    template<class T> using Pre = bool (Inspector::*)(const T *);
+    template<class T> using Post = void (Inspector::*)(const T *);
+};
+template<> struct VisitFunctions<Modifier> {
+    template<class T> using Pre = bool (Modifier::*)(T *);
+    template<class T> using Post = void (Modifier::*)(T *);
+};
+template<> struct VisitFunctions<Transform> {
+    template<class T> using Pre = const IR::Node *(Transform::*)(T *);
+    template<class T> using Post = const IR::Node *(Transform::*)(T *);
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpmf-conversions"
+/// The function the virtual function @fn resolves to for @v.
+template<class V, class R, class A> const void *resolve(V &v, R (V::*fn)(A)) {
+    return reinterpret_cast<const void *>(reinterpret_cast<R (*)(V *, A)>(v.*fn)); }
+#pragma GCC diagnostic pop
+
+template<class V> struct Plain : public V {};
+
+template<class V> class DefaultVisitsBuilder {
+    using F = VisitFunctions<V>;
+    V                   &v;
+    Plain<V>            plain;
+    std::vector<bool>   ownPre, ownPost;  // by node kind, true if @v has an overload
+
+    template<class FN> bool overrides(FN fn) {
+        return resolve(v, fn) != resolve(static_cast<V &>(plain), fn); }
+
+ public:
+    explicit DefaultVisitsBuilder(V &v)
+    : v(v), ownPre(IR::node_kind_count), ownPost(IR::node_kind_count) {}
+
+    template<class T> typename std::enable_if<IR::has_node_kind<T>::value>::type add() {
+        ownPre[T::static_kind_first] = overrides<typename F::template Pre<T>>(&V::preorder);
+        ownPost[T::static_kind_first] = overrides<typename F::template Post<T>>(&V::postorder);
+    }
+    template<class T> typename std::enable_if<!IR::has_node_kind<T>::value>::type add() {}
+
+    Visitor::DefaultVisits *build() {
+#define ADD_CLASS(CLASS, BASE)  add<IR::CLASS>();
+        IRNODE_ALL_NON_TEMPLATE_SUBCLASSES(ADD_CLASS)
+#undef ADD_CLASS
+        bool nodePre = overrides<typename F::template Pre<IR::Node>>(&V::preorder);
+        bool nodePost = overrides<typename F::template Post<IR::Node>>(&V::postorder);
+        auto *rv = new Visitor::DefaultVisits(typeid(v));
+        rv->preorder.resize(IR::node_kind_count);
+        rv->postorder.resize(IR::node_kind_count);
+        // kind 0 is for classes not numbered, which are always visited; the base of each
+        // kind has a smaller kind
+        for (unsigned k = 1; k < IR::node_kind_count; ++k) {
+            unsigned base = IR::node_kind_parent[k];
+            rv->preorder[k] = !ownPre[k] && (base ? rv->preorder[base] : !nodePre);
+            rv->postorder[k] = !ownPost[k] && (base ? rv->postorder[base] : !nodePost); }
+        return rv;
     }
 };
 
+/// @return the visit functions the dynamic type of @v inherits, @known if it is for that type
+template<class V>
+const Visitor::DefaultVisits *defaultVisitsOf(V &v, const Visitor::DefaultVisits *known) {
+    if (::Log::Detail::maximumLogLevel >= 3) return nullptr;  // see IR::Node::traceVisit
+    if (known && known->type == typeid(v)) return known;
+    static std::unordered_map<std::type_index, const Visitor::DefaultVisits *> types;
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    auto &rv = types[typeid(v)];
+    if (!rv) rv = DefaultVisitsBuilder<V>(v).build();
+    return rv;
+}
+#else
+template<class V>
+const Visitor::DefaultVisits *defaultVisitsOf(V &, const Visitor::DefaultVisits *) {
+    return nullptr; }
+#endif
+
+}  // namespace
+
 Visitor::profile_t Visitor::init_apply(const IR::Node *root) {
     ctxt = nullptr;
     if (joinFlows) init_join_flows(root);
@@ -149,22 +291,50 @@ Visitor::profile_t Visitor::init_apply(const IR::Node *root, const Context *pare
 }
 Visitor::profile_t Modifier::init_apply(const IR::Node *root) {
     auto rv = Visitor::init_apply(root);
-    visited = new ChangeTracker();
+    visited = visited_tables<ChangeTracker>().get();
+    defaultVisits = defaultVisitsOf<Modifier>(*this, defaultVisits);
     return rv; }
 Visitor::profile_t Inspector::init_apply(const IR::Node *root) {
     auto rv = Visitor::init_apply(root);
-    visited = new visited_t();
+    visited = visited_tables<visited_t>().get();
+    defaultVisits = defaultVisitsOf<Inspector>(*this, defaultVisits);
     return rv; }
 Visitor::profile_t Transform::init_apply(const IR::Node *root) {
     auto rv = Visitor::init_apply(root);
-    visited = new ChangeTracker();
+    visited = visited_tables<ChangeTracker>().get();
+    defaultVisits = defaultVisitsOf<Transform>(*this, defaultVisits);
     return rv; }
 void Visitor::end_apply() {}
 void Visitor::end_apply(const IR::Node*) {}
 
 static indent_t profile_indent;
 static uint64_t first_start = 0;
-Visitor::profile_t::profile_t(Visitor &v_) : v(v_) {
+static uint64_t nodes_visited = 0;       // count of calls to apply_visitor on non-null nodes
+static std::ostream *trace_file = nullptr;
+static const char *trace_sep = "";
+
+static void close_trace_file() {
+    if (trace_file) {
+        *trace_file << std::endl << "]" << std::endl;
+        trace_file->flush();
+        trace_file = nullptr; }
+}
+
+void Visitor::openTraceFile(const char *filename) {
+    auto *out = new std::ofstream(filename);
+    if (!*out) {
+        ::error(ErrorType::ERR_IO, "Cannot open trace file %1%", filename);
+        return; }
+    if (trace_file)
+        close_trace_file();
+    else
+        atexit(close_trace_file);
+    trace_file = out;
+    trace_sep = "";
+    *trace_file << "[";
+}
+
+static uint64_t profile_clock() {
     struct timespec ts;
 #ifdef CLOCK_MONOTONIC
     clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -172,28 +342,77 @@ Visitor::profile_t::profile_t(Visitor &v_) : v(v_) {
     // FIXME -- figure out how to do this on OSX/Mach
     ts.tv_sec = ts.tv_nsec = 0;
 #endif
-    start = ts.tv_sec*1000000000UL + ts.tv_nsec + 1;
+    return ts.tv_sec*1000000000UL + ts.tv_nsec + 1;
+}
+
+// the counts of a pass for the log, if they are counted
+static std::string counters_text(const Util::PerfCounters::Values &counters) {
+    std::stringstream out;
+    if (Util::PerfCounters::enabled())
+        for (int i = 0; i < Util::PerfCounters::COUNT; ++i)
+            out << ' ' << counters.value[i] << ' '
+                << Util::PerfCounters::name(Util::PerfCounters::Counter(i));
+    return out.str();
+}
+
+Visitor::profile_t::profile_t(Visitor &v_) : v(v_) {
+    start = profile_clock();
     assert(start);
+    visited_start = nodes_visited;
+    created_start = IR::Node::currentId;
+    heap_start = trace_file ? gc_heap_inuse() : 0;
+    if (Util::PerfCounters::enabled()) counters_start = Util::PerfCounters::read();
+    if (IR::AllocStats::enabled) IR::AllocStats::enterPass(v.name());
+    if (!first_start) first_start = start;
     LOG3(profile_indent << v.name() << " statrting at +" <<
-         (first_start ? start - first_start : (first_start = start, 0UL))/1000000.0 << " msec");
+         (start - first_start)/1000000.0 << " msec");
     ++profile_indent;
 }
-Visitor::profile_t::profile_t(profile_t &&a) : v(a.v), start(a.start) {
+Visitor::profile_t::profile_t(profile_t &&a)
+: v(a.v), start(a.start), visited_start(a.visited_start), created_start(a.created_start),
+  heap_start(a.heap_start), counters_start(a.counters_start) {
     a.start = 0;
 }
 Visitor::profile_t::~profile_t() {
     if (start) {
         v.end_apply();
+        if (IR::AllocStats::enabled) IR::AllocStats::leavePass();
         --profile_indent;
-        struct timespec ts;
-#ifdef CLOCK_MONOTONIC
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-#else
-        // FIXME -- figure out how to do this on OSX/Mach
-        ts.tv_sec = ts.tv_nsec = 0;
-#endif
-        uint64_t end = ts.tv_sec*1000000000UL + ts.tv_nsec + 1;
-        LOG1(profile_indent << v.name() << ' ' << (end-start)/1000.0 << " usec"); }
+        uint64_t end = profile_clock();
+        Util::PerfCounters::Values counters;
+        if (Util::PerfCounters::enabled())
+            counters = Util::PerfCounters::read() - counters_start;
+        LOG1(profile_indent << v.name() << ' ' << (end-start)/1000.0 << " usec" <<
+             counters_text(counters));
+        if (trace_file) {
+            // a complete ("X") event; the trace viewer nests events by time, so the
+            // passes run by a PassManager appear inside its span.
+            auto *args = new Util::JsonObject();
+            args->emplace("nodes_visited", nodes_visited - visited_start);
+            args->emplace("nodes_created", IR::Node::currentId - created_start);
+            args->emplace("heap_before", heap_start);
+            args->emplace("heap_after", gc_heap_inuse());
+            if (Util::PerfCounters::enabled())
+                for (int i = 0; i < Util::PerfCounters::COUNT; ++i)
+                    args->emplace(Util::PerfCounters::name(Util::PerfCounters::Counter(i)),
+                                  counters.value[i]);
+            auto *event = new Util::JsonObject();
+            event->emplace("name", v.name());
+            event->emplace("cat", "pass");
+            event->emplace("ph", "X");
+            event->emplace("ts", (start - first_start) / 1000);
+            event->emplace("dur", (end - start) / 1000);
+            event->emplace("pid", 1);
+            event->emplace("tid", 1);
+            event->emplace("args", args);
+#ifdef MULTITHREAD
+            // passes may be run on several threads at once (see ParallelBlocks)
+            static std::mutex trace_lock;
+            std::lock_guard<std::mutex> acquire(trace_lock);
+#endif  // MULTITHREAD
+            *trace_file << trace_sep << std::endl;
+            event->serialize(*trace_file);
+            trace_sep = ","; } }
 }
 
 void Visitor::print_context() const {
@@ -229,6 +448,7 @@ struct PushContext {
         current.child_index = 0;
         current.child_name = "";
         current.depth = stack ? stack->depth+1 : 1;
+        current.write_role = current.read_role = 0;
         assert(current.depth < 10000);    // stack overflow?
         stack = &current; }
     ~PushContext() { stack = current.parent; }
@@ -249,6 +469,7 @@ class ForwardChildren : public Visitor {
 const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
     if (ctxt) ctxt->child_name = name;
     if (n) {
+        ++nodes_visited;
         PushContext local(ctxt, n);
         if (visited->done(n)) {
             n->apply_visitor_revisit(*this, visited->result(n));
@@ -261,48 +482,56 @@ const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
                 ForwardChildren forward_children(*visited);
                 copy->visit_children(forward_children); }
             visitCurrentOnce = visited->refVisitOnce(n);
-            if (copy->apply_visitor_preorder(*this)) {
+            unsigned kind = defaultVisits ? copy->node_kind() : 0;
+            if ((kind && defaultVisits->preorder[kind]) || copy->apply_visitor_preorder(*this)) {
                 copy->visit_children(*this);
                 visitCurrentOnce = visited->refVisitOnce(n);
-                copy->apply_visitor_postorder(*this); }
+                if (!kind || !defaultVisits->postorder[kind])
+                    copy->apply_visitor_postorder(*this); }
             if (visited->finish(n, copy))
                 (n = copy)->validate(); } }
-    if (ctxt)
+    if (ctxt) {
         ctxt->child_index++;
-    else
-        visited = nullptr;
+    } else {
+        visited_tables<ChangeTracker>().put(visited);
+        visited = nullptr; }
     return n;
 }
 
 const IR::Node *Inspector::apply_visitor(const IR::Node *n, const char *name) {
     if (ctxt) ctxt->child_name = name;
     if (n && !join_flows(n)) {
+        ++nodes_visited;
         PushContext local(ctxt, n);
         auto vp = visited->emplace(n, info_t{false, visitDagOnce});
-        if (!vp.second && !vp.first->second.done)
+        if (!vp.second && !vp.first->done)
             BUG("IR loop detected");
-        if (!vp.second && vp.first->second.visitOnce) {
+        if (!vp.second && vp.first->visitOnce) {
             n->apply_visitor_revisit(*this);
         } else {
-            vp.first->second.done = false;
-            visitCurrentOnce = &vp.first->second.visitOnce;
-            if (n->apply_visitor_preorder(*this)) {
+            vp.first->done = false;
+            visitCurrentOnce = &vp.first->visitOnce;
+            unsigned kind = defaultVisits ? n->node_kind() : 0;
+            if ((kind && defaultVisits->preorder[kind]) || n->apply_visitor_preorder(*this)) {
                 n->visit_children(*this);
-                visitCurrentOnce = &vp.first->second.visitOnce;
-                n->apply_visitor_postorder(*this); }
+                visitCurrentOnce = &vp.first->visitOnce;
+                if (!kind || !defaultVisits->postorder[kind])
+                    n->apply_visitor_postorder(*this); }
             if (vp.first != visited->find(n))
                 BUG("visitor state tracker corrupted");
-            vp.first->second.done = true; } }
-    if (ctxt)
+            vp.first->done = true; } }
+    if (ctxt) {
         ctxt->child_index++;
-    else
-        visited = nullptr;
+    } else {
+        visited_tables<visited_t>().put(visited);
+        visited = nullptr; }
     return n;
 }
 
 const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
     if (ctxt) ctxt->child_name = name;
     if (n) {
+        ++nodes_visited;
         PushContext local(ctxt, n);
         if (visited->done(n)) {
             n->apply_visitor_revisit(*this, visited->result(n));
@@ -310,6 +539,7 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
         } else {
             visited->start(n, visitDagOnce);
             auto copy = n->clone();
+            auto *first_copy = copy;
             local.current.node = copy;
             if (!dontForwardChildrenBeforePreorder) {
                 ForwardChildren forward_children(*visited);
@@ -318,7 +548,9 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
             prune_flag = false;
             visitCurrentOnce = visited->refVisitOnce(n);
             bool extra_clone = false;
-            const IR::Node *preorder_result = copy->apply_visitor_preorder(*this);
+            unsigned kind = defaultVisits ? copy->node_kind() : 0;
+            const IR::Node *preorder_result = kind && defaultVisits->preorder[kind]
+                    ? copy : copy->apply_visitor_preorder(*this);
             assert(preorder_result != n);  // should never happen
             const IR::Node *final_result = preorder_result;
             if (preorder_result != copy) {
@@ -330,6 +562,11 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
                 } else if (visited->done(preorder_result)) {
                     final_result = visited->result(preorder_result);
                     prune_flag = true;
+                } else if (freeUnchangedClones && preorder_result->id > first_copy->id) {
+                    // made by preorder, so no one else has it yet; visit it in place
+                    extra_clone = true;
+                    visited->start(preorder_result, *visitCurrentOnce);
+                    local.current.node = copy = const_cast<IR::Node *>(preorder_result);
                 } else {
                     extra_clone = true;
                     visited->start(preorder_result, *visitCurrentOnce);
@@ -337,30 +574,133 @@ const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
             if (!prune_flag) {
                 copy->visit_children(*this);
                 visitCurrentOnce = visited->refVisitOnce(n);
-                final_result = copy->apply_visitor_postorder(*this); }
+                kind = defaultVisits ? copy->node_kind() : 0;
+                final_result = kind && defaultVisits->postorder[kind]
+                        ? copy : copy->apply_visitor_postorder(*this); }
             prune_flag = save_prune_flag;
             if (final_result == copy
                 && final_result != preorder_result
                 && *final_result == *preorder_result)
                 final_result = preorder_result;
-            if (visited->finish(n, final_result) && (n = final_result))
-                final_result->validate();
+            if (visited->finish(n, final_result)) {
+                if ((n = final_result)) final_result->validate();
+            } else if (freeUnchangedClones && !extra_clone &&
+                       (final_result == first_copy || final_result == n)) {
+                // n is unchanged, and nothing in the tree refers to the copy
+                local.current.node = n;
+                delete first_copy; }
             if (extra_clone)
                 visited->finish(preorder_result, final_result); } }
-    if (ctxt)
+    if (ctxt) {
         ctxt->child_index++;
-    else
-        visited = nullptr;
+    } else {
+        visited_tables<ChangeTracker>().put(visited);
+        visited = nullptr; }
     return n;
 }
 
 void Inspector::revisit_visited() {
-    for (auto it = visited->begin(); it != visited->end();) {
-        if (it->second.done)
-            it = visited->erase(it);
-        else
-            ++it; }
+    visited->erase_if([](const IR::Node *, const info_t &info) { return info.done; });
+}
+FusedInspector::FusedInspector(std::vector<Inspector *> members, bool stopOnError)
+        : members(std::move(members)), stopOnError(stopOnError),
+          diagnostics(this->members.size()) {
+    const char *sep = "";
+    for (auto *m : this->members) {
+        BUG_CHECK(!m->joinFlows, "%1%: flow-joining visitors cannot be fused", m->name());
+        fusedName = fusedName + sep + m->name();
+        sep = "+"; }
+}
+
+Visitor::profile_t FusedInspector::init_apply(const IR::Node *root) {
+    auto rv = Inspector::init_apply(root);
+    initialErrors = ::errorCount();
+    for (size_t i = 0; i < members.size(); ++i) {
+        ErrorReporter::Deferred::Scope keep(diagnostics[i]);
+        profiles.push_back(new profile_t(members[i]->init_apply(root))); }
+    return rv;
 }
+
+void FusedInspector::end_apply(const IR::Node *root) {
+    for (size_t i = 0; i < members.size(); ++i) {
+        ErrorReporter::Deferred::Scope keep(diagnostics[i]);
+        members[i]->end_apply(root); }
+}
+
+void FusedInspector::end_apply() {
+    // ends the members' profiles (which calls their end_apply()) in order
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        ErrorReporter::Deferred::Scope keep(diagnostics[i]);
+        delete profiles[i]; }
+    profiles.clear();
+    emitDiagnostics();
+}
+
+void FusedInspector::emitDiagnostics() {
+    auto &reporter = BaseCompileContext::get().errorReporter();
+    size_t i = 0;
+    while (i < diagnostics.size()) {
+        reporter.emit(diagnostics[i++]);
+        if (stopOnError && ::errorCount() > initialErrors) break; }
+    for (; i < diagnostics.size(); ++i)
+        diagnostics[i] = ErrorReporter::Deferred();
+}
+
+const IR::Node *FusedInspector::apply_visitor(const IR::Node *n, const char *name) {
+    if (ctxt) ctxt->child_name = name;
+    if (n) {
+        ++nodes_visited;
+        PushContext local(ctxt, n);
+        std::vector<size_t> all;
+        if (!active) {
+            for (size_t i = 0; i < members.size(); ++i) all.push_back(i); }
+        const std::vector<size_t> &here = active ? *active : all;
+        std::vector<size_t> descend;
+        std::vector<info_t *> entered, descend_info;
+        for (auto i : here) {
+            auto *m = members[i];
+            ErrorReporter::Deferred::Scope keep(diagnostics[i]);
+            m->ctxt = ctxt;
+            auto vp = m->visited->emplace(n, info_t{false, m->visitDagOnce});
+            if (!vp.second && !vp.first->done)
+                BUG("IR loop detected");
+            if (!vp.second && vp.first->visitOnce) {
+                n->apply_visitor_revisit(*m);
+                continue; }
+            vp.first->done = false;
+            entered.push_back(vp.first);
+            m->visitCurrentOnce = &vp.first->visitOnce;
+            if (n->apply_visitor_preorder(*m)) {
+                descend.push_back(i);
+                descend_info.push_back(vp.first); } }
+        if (!descend.empty()) {
+            auto *save = active;
+            active = &descend;
+            try {
+                n->visit_children(*this);
+            } catch (...) {
+                active = save;
+                throw; }
+            active = save;
+            for (size_t j = 0; j < descend.size(); ++j) {
+                auto *m = members[descend[j]];
+                ErrorReporter::Deferred::Scope keep(diagnostics[descend[j]]);
+                m->ctxt = ctxt;
+                m->visitCurrentOnce = &descend_info[j]->visitOnce;
+                n->apply_visitor_postorder(*m); } }
+        for (auto *info : entered) info->done = true; }
+    if (ctxt) {
+        ctxt->child_index++;
+    } else {
+        for (auto *m : members) {
+            m->ctxt = nullptr;
+            visited_tables<visited_t>().put(m->visited);
+            m->visited = nullptr; }
+        visited_tables<visited_t>().put(visited);
+        visited = nullptr; }
+    return n;
+}
+
 void Modifier::revisit_visited() {
     visited->revisit_visited();
 }
@@ -455,6 +795,43 @@ bool Transform::check_clone(const Visitor *v) {
     return Visitor::check_clone(v);
 }
 
+Visitor *Inspector::thread_clone() const {
+    auto *rv = dynamic_cast<Inspector *>(clone());
+    BUG_CHECK(rv && rv->check_clone(this), "Clone failed to copy visitor type");
+    // each thread needs its own visited table; nodes shared between the subtrees
+    // being visited in parallel will be visited once by each thread.
+    rv->visited = visited_tables<visited_t>().get();
+    return rv;
+}
+
+bool Visitor::parallel_visit_threaded(size_t count,
+                                      const std::function<void(Visitor &, size_t)> &fn) {
+#ifdef MULTITHREAD
+    auto &pool = Util::ThreadPool::global();
+    if (!threadedParallelVisit || joinFlows || !ctxt || count < 2 || pool.concurrency() < 2)
+        return false;
+    // All the clones must be made before this visitor visits anything.  Each gets its
+    // own copy of the current context, so that child_index/child_name updates from the
+    // different threads don't interfere.
+    safe_vector<Visitor *> clones(count, this);
+    safe_vector<Context> contexts(count, *ctxt);
+    int child_index = ctxt->child_index;
+    for (size_t i = 1; i < count; ++i) {
+        if (!(clones[i] = thread_clone())) return false;
+        contexts[i].child_index = child_index + i;
+        clones[i]->ctxt = &contexts[i]; }
+    pool.parallel_for(count, [&](size_t i) { fn(*clones[i], i); });
+    ctxt->child_index = child_index + count;
+    for (size_t i = 1; i < count; ++i)
+        flow_merge(*clones[i]);
+    return true;
+#else
+    (void)count;
+    (void)fn;
+    return false;
+#endif  // MULTITHREAD
+}
+
 ControlFlowVisitor &ControlFlowVisitor::flow_clone() {
     auto *rv = clone();
     BUG_CHECK(rv->check_clone(this), "Clone failed to copy visitor type");
@@ -20,8 +20,11 @@ limitations under the License.
 #include <stdexcept>
 #include <unordered_map>
 #include "lib/cstring.h"
+#include "lib/error_reporter.h"
+#include "lib/epoch_map.h"
 #include "ir/ir.h"
 #include "lib/exceptions.h"
+#include "lib/perf_counters.h"
 
 // declare this outside of Visitor so it can be forward declared in node.h
 struct Visitor_Context {
@@ -34,16 +37,24 @@ struct Visitor_Context {
     mutable int                 child_index;
     mutable const char          *child_name;
     int                         depth;
+    // whether node may be written or read where it is, remembered by
+    // P4WriteContext::isWrite/isRead, as it does not change while node is visited
+    mutable unsigned char       write_role, read_role;
 };
 
 class Visitor {
  public:
     typedef Visitor_Context Context;
+    struct DefaultVisits;  // the visit functions a visitor inherits (see visitor.cpp)
     class profile_t {
         // for profiling -- a profile_t object is created when a pass
         // starts and destroyed when it ends.  Moveable but not copyable.
         Visitor         &v;
         uint64_t        start;
+        uint64_t        visited_start;
+        int             created_start;
+        size_t          heap_start;
+        Util::PerfCounters::Values      counters_start;  // if PerfCounters::enabled()
         explicit profile_t(Visitor &);
         profile_t() = delete;
         profile_t(const profile_t &) = delete;
@@ -129,6 +140,14 @@ class Visitor {
             ctxt->child_index = cidx; }
         v.parallel_visit_children(*this); }
 
+    /** Visit @count children concurrently on the global thread pool if this visitor has
+     * threadedParallelVisit set, by calling @fn with each child index and the visitor to
+     * use for it.  The first child is visited by this visitor, and the rest by clones made
+     * before any child is visited, which are then flow_merged back into this visitor in
+     * order; this is the same result as visiting them sequentially.
+     * @return false (having done nothing) if the children must be visited sequentially. */
+    bool parallel_visit_threaded(size_t count, const std::function<void(Visitor &, size_t)> &fn);
+
     virtual Visitor *clone() const { BUG("need %s::clone method",  name()); return nullptr; }
     virtual bool check_clone(const Visitor *a) { return typeid(*this) == typeid(*a); }
 
@@ -146,6 +165,11 @@ class Visitor {
     virtual bool check_global(cstring) { return false; }
     virtual void clear_globals() { }
 
+    /// Write a Chrome trace (Trace Event Format, viewable in Perfetto or chrome://tracing)
+    /// to @filename, with one event for every visitor applied, recording its wall time,
+    /// the number of nodes visited and created, and the heap in use before and after.
+    static void openTraceFile(const char *filename);
+
     static cstring demangle(const char *);
     virtual const char *name() const {
         if (!internalName)
@@ -178,7 +202,7 @@ class Visitor {
     template <class T> inline const T *findContext(const Context *&c) const {
         if (!c) c = ctxt;
         while ((c = c->parent))
-            if (auto *rv = dynamic_cast<const T *>(c->node)) return rv;
+            if (auto *rv = c->node->to<T>()) return rv;
         return nullptr; }
     template <class T> inline const T *findContext() const {
         const Context *c = ctxt;
@@ -186,7 +210,7 @@ class Visitor {
     template <class T> inline const T *findOrigCtxt(const Context *&c) const {
         if (!c) c = ctxt;
         while ((c = c->parent))
-            if (auto *rv = dynamic_cast<const T *>(c->original)) return rv;
+            if (auto *rv = c->original->to<T>()) return rv;
         return nullptr; }
     template <class T> inline const T *findOrigCtxt() const {
         const Context *c = ctxt;
@@ -215,8 +239,17 @@ class Visitor {
     // flow_merge the visitor from all the parents before visiting the node and its
     // children.  This only works for Inspector (not Modifier/Transform) currently.
     bool joinFlows = false;
+    // if threadedParallelVisit is 'true' (and p4c is built with MULTITHREAD), parallel_visit
+    // of a Vector may visit its elements on separate threads (see parallel_visit_threaded).
+    // The visitor must have a clone method and must not update any state shared between
+    // clones from its preorder/postorder functions.  This only works for Inspector passes
+    // that do not use joinFlows, and is ignored otherwise.
+    bool threadedParallelVisit = false;
 
     virtual void init_join_flows(const IR::Node *) { assert(0); }
+    // Create a clone of this visitor that can visit a subtree concurrently with this one,
+    // or return nullptr if that is not possible.
+    virtual Visitor *thread_clone() const { return nullptr; }
 
     /** If @n is a join point in the control flow graph (i.e. has multiple incoming
      * edges) and is not filtered out by `filter_join_point`, then:
@@ -251,10 +284,12 @@ class Visitor {
     virtual void visitor_const_error();
     const Context *ctxt = nullptr;  // should be readonly to subclasses
     bool *visitCurrentOnce = nullptr;
+    const DefaultVisits *defaultVisits = nullptr;  // set by init_apply, if known
     friend class Inspector;
     friend class Modifier;
     friend class Transform;
     friend class ControlFlowVisitor;
+    friend class FusedInspector;
 };
 
 class Modifier : public virtual Visitor {
@@ -278,9 +313,10 @@ class Modifier : public virtual Visitor {
 
 class Inspector : public virtual Visitor {
     struct info_t { bool done, visitOnce; };
-    typedef std::unordered_map<const IR::Node *, info_t>       visited_t;
+    typedef epoch_map<const IR::Node *, info_t>       visited_t;
     visited_t   *visited = nullptr;
     bool check_clone(const Visitor *) override;
+    Visitor *thread_clone() const override;
  public:
     profile_t init_apply(const IR::Node *root) override;
     const IR::Node *apply_visitor(const IR::Node *, const char *name = 0) override;
@@ -294,6 +330,46 @@ class Inspector : public virtual Visitor {
     IRNODE_ALL_SUBCLASSES(DECLARE_VISIT_FUNCTIONS)
 #undef DECLARE_VISIT_FUNCTIONS
     void revisit_visited();
+    /// Return true if this Inspector may share a traversal with its neighbours in a
+    /// PassManager (see FusedInspector): it does not override apply_visitor, and neither
+    /// reads anything an adjacent Inspector computes nor computes anything they read.
+    virtual bool canFuse() const { return false; }
+    friend class FusedInspector;
+};
+
+/** Runs several Inspectors over the tree in a single traversal.  Each node is passed to
+ * the preorder/postorder/revisit of every member that has not pruned the subtree it is in,
+ * in member order, with the member's context and visitOnce state maintained as if it were
+ * running alone.  Members are interleaved rather than run one after another, so they must
+ * be independent of each other; their init_apply and end_apply are still called, but any
+ * apply_visitor override is bypassed.
+ *
+ * The diagnostics of each member are kept back and written in member order at the end,
+ * so that they come out as if the members had run one after another.  With @stopOnError,
+ * as in a PassManager, those of the members after the first one to report an error are
+ * dropped, as those members would not have run.
+ *
+ * PassManager uses this automatically for runs of adjacent Inspectors whose canFuse() is
+ * true, but it can also be added to a pass list directly. */
+class FusedInspector : public Inspector {
+    std::vector<Inspector *>                    members;
+    bool                                        stopOnError;
+    std::vector<ErrorReporter::Deferred>        diagnostics;    // of each member
+    const std::vector<size_t>                   *active = nullptr;
+    std::vector<profile_t *>                    profiles;
+    std::string                                 fusedName;
+    unsigned                                    initialErrors = 0;
+
+    void emitDiagnostics();
+
+ public:
+    explicit FusedInspector(std::vector<Inspector *> members, bool stopOnError = false);
+    const char *name() const override { return fusedName.c_str(); }
+    profile_t init_apply(const IR::Node *root) override;
+    void end_apply(const IR::Node *root) override;
+    void end_apply() override;
+    const IR::Node *apply_visitor(const IR::Node *, const char *name = 0) override;
+    FusedInspector *clone() const override { return new FusedInspector(*this); }
 };
 
 class Transform : public virtual Visitor {
@@ -319,14 +395,28 @@ class Transform : public virtual Visitor {
     void prune() { prune_flag = true; }
 
  protected:
+    // if freeUnchangedClones is 'true', the clone of each node made before preorder is
+    // deleted when the node turns out to be unchanged, rather than left as garbage, and a
+    // node newly created and returned by preorder is visited in place rather than cloned
+    // again.  Most Transforms change little of the tree, so this saves most of the memory
+    // they use.  The visitor must not keep pointers to the nodes passed to preorder and
+    // postorder (or found with findContext) after returning them unchanged, nor to the
+    // nodes its preorder makes; getOriginal() and the nodes it returns may be kept.
+    bool freeUnchangedClones = false;
+
     const IR::Node *transform_child(const IR::Node *child) {
         auto *rv = apply_visitor(child);
         prune_flag = true;
         return rv; }
 };
 
+/** A visitor that follows the control flow of the program: it is cloned (flow_clone) where
+ * the flow branches and the clones are merged (flow_merge) where it joins.  Subclasses with
+ * large flow state should keep it in containers like cow_map (lib/cow_map.h), whose copies
+ * share storage, so that a branch only copies the part of the state it changes.
+ */
 class ControlFlowVisitor : public virtual Visitor {
-    std::map<cstring, ControlFlowVisitor &>     &globals;
+    std::map<cstring, ControlFlowVisitor &, cstring_identity_less> &globals;
 
  protected:
     ControlFlowVisitor* clone() const override = 0;
@@ -341,7 +431,7 @@ class ControlFlowVisitor : public virtual Visitor {
      */
     virtual bool filter_join_point(const IR::Node *) { return false; }
     ControlFlowVisitor &flow_clone() override;
-    ControlFlowVisitor() : globals(*new std::map<cstring, ControlFlowVisitor &>) {}
+    ControlFlowVisitor() : globals(*new std::remove_reference<decltype(globals)>::type) {}
 
  public:
     void flow_merge_global_to(cstring key) override {
@@ -18,86 +18,122 @@ limitations under the License.
 #include "lib/log.h"
 #include "frontends/p4/typeMap.h"
 
-/* Determine from the Visitor context whether the currently being visited IR node
- * denotes something that might be written to by the code.  This is always conservative
- * (we don't know for certain that it is written) since even if it is, it might be
- * writing the same value.  All you can say for certain is that if this returns 'false'
- * the code at this point will not modify the object referred to by the current node */
+namespace {
 
-bool P4WriteContext::isWrite(bool root_value) {
-    const Context *ctxt = getContext();
+/* The role of the node of a context in its parent, remembered in the context (see
+ * Visitor_Context::write_role), as it does not change while the node is visited.
+ * ROOT means that the node is at the top of an expression, where the caller decides. */
+enum Role : unsigned char { UNKNOWN, NO, YES, ROOT };
+
+Role role(bool value) { return value ? YES : NO; }
+
+/// A component of what the parent denotes, so it is written or read when the parent is
+bool isComponent(const Visitor::Context *ctxt) {
+    return ctxt->child_index == 0 &&
+           (ctxt->node->is<IR::ArrayIndex>() ||
+            ctxt->node->is<IR::HeaderStackItemRef>() ||
+            ctxt->node->is<IR::Slice>() ||
+            ctxt->node->is<IR::Member>());
+}
+
+Role writeRole(const Visitor::Context *child);
+Role computeWriteRole(const Visitor::Context *child) {
+    const Visitor::Context *ctxt = child->parent;
     if (!ctxt || !ctxt->node)
-        return root_value;
-    while (ctxt->child_index == 0 &&
-            (ctxt->node->is<IR::ArrayIndex>() ||
-             ctxt->node->is<IR::HeaderStackItemRef>() ||
-             ctxt->node->is<IR::Slice>() ||
-             ctxt->node->is<IR::Member>())) {
-        ctxt = ctxt->parent;
-        if (!ctxt || !ctxt->node)
-            return root_value; }
+        return ROOT;
+    if (isComponent(ctxt))
+        return writeRole(ctxt);
     if (auto *prim = ctxt->node->to<IR::Primitive>())
-        return prim->isOutput(ctxt->child_index);
+        return role(prim->isOutput(ctxt->child_index));
     if (ctxt->node->is<IR::AssignmentStatement>())
-        return ctxt->child_index == 0;
+        return role(ctxt->child_index == 0);
     if (ctxt->node->is<IR::Argument>()) {
         // MethodCallExpression(Vector<Argument(Expression)>)
         if (!ctxt->parent || !ctxt->parent->parent || !ctxt->parent->parent->node)
-            return false;
+            return NO;
         if (auto *mc = ctxt->parent->parent->node->to<IR::MethodCallExpression>()) {
             auto type = mc->method->type->to<IR::Type_Method>();
             if (!type) {
                 /* FIXME -- can't find the type of the method -- should be a BUG? */
-                return true; }
+                return YES; }
             auto param = type->parameters->getParameter(ctxt->parent->child_index);
-            return param->direction == IR::Direction::Out ||
-                   param->direction == IR::Direction::InOut; }
+            return role(param->direction == IR::Direction::Out ||
+                        param->direction == IR::Direction::InOut); }
         if (ctxt->parent->node->is<IR::ConstructorCallExpression>()) {
             /* FIXME -- no constructor types?  assume all arguments are inout? */
-            return true; } }
+            return YES; } }
     if (ctxt->node->is<IR::MethodCallExpression>()) {
         /* receiver of a method call -- some methods might be 'const' and not modify
          * their receiver, but we currently have no way of determining that */
-        return true; }
-    return false;
+        return YES; }
+    return NO;
+}
+Role writeRole(const Visitor::Context *child) {
+    if (child->write_role == UNKNOWN)
+        child->write_role = computeWriteRole(child);
+    return Role(child->write_role);
 }
 
-/* Determine from the Visitor context whether the currently being visited IR node
- * denotes something that might be read by the code.  This is often conservative
- * (we don't know for certain that it is read).  We return root_value for top-level
- * expressions, and false for expression-statement unused values.
- * TODO -- currently returns true for expressions 'read' in annotations.
- */
-bool P4WriteContext::isRead(bool root_value) {
-    const Context *ctxt = getContext();
+Role readRole(const Visitor::Context *child);
+Role computeReadRole(const Visitor::Context *child) {
+    const Visitor::Context *ctxt = child->parent;
     if (!ctxt || !ctxt->node)
-        return root_value;
-    while (ctxt->child_index == 0 &&
-            (ctxt->node->is<IR::ArrayIndex>() ||
-             ctxt->node->is<IR::HeaderStackItemRef>() ||
-             ctxt->node->is<IR::Slice>() ||
-             ctxt->node->is<IR::Member>())) {
-        ctxt = ctxt->parent;
-        if (!ctxt || !ctxt->node)
-            return root_value; }
+        return ROOT;
+    if (isComponent(ctxt))
+        return readRole(ctxt);
     if (auto *prim = ctxt->node->to<IR::Primitive>())
-        return !prim->isOutput(ctxt->child_index);
+        return role(!prim->isOutput(ctxt->child_index));
     if (ctxt->node->is<IR::AssignmentStatement>())
-        return ctxt->child_index != 0;
+        return role(ctxt->child_index != 0);
     if (ctxt->node->is<IR::Argument>()) {
         // MethodCallExpression(Vector<Argument(Expression)>)
         if (!ctxt->parent || !ctxt->parent->parent || !ctxt->parent->parent->node)
-            return false;
+            return NO;
         if (auto *mc = ctxt->parent->parent->node->to<IR::MethodCallExpression>()) {
             auto type = mc->method->type->to<IR::Type_Method>();
             if (!type) {
                 /* FIXME -- can't find the type of the method -- should be a BUG? */
-                return true; }
+                return YES; }
             auto param = type->parameters->getParameter(ctxt->parent->child_index);
-            return param->direction != IR::Direction::Out; } }
+            return role(param->direction != IR::Direction::Out); } }
     if (ctxt->node->is<IR::IndexedVector<IR::StatOrDecl>>())
-        return false;
+        return NO;
     if (ctxt->node->is<IR::IfStatement>())
-        return ctxt->child_index == 0;
-    return true;
+        return role(ctxt->child_index == 0);
+    return YES;
+}
+Role readRole(const Visitor::Context *child) {
+    if (child->read_role == UNKNOWN)
+        child->read_role = computeReadRole(child);
+    return Role(child->read_role);
+}
+
+}  // namespace
+
+/* Determine from the Visitor context whether the currently being visited IR node
+ * denotes something that might be written to by the code.  This is always conservative
+ * (we don't know for certain that it is written) since even if it is, it might be
+ * writing the same value.  All you can say for certain is that if this returns 'false'
+ * the code at this point will not modify the object referred to by the current node.
+ * The answer is computed once for each node visited, and for the enclosing components
+ * it depends on, so asking again, or for the nodes below, takes constant time. */
+
+bool P4WriteContext::isWrite(bool root_value) {
+    if (!ctxt)
+        return root_value;
+    auto rv = writeRole(ctxt);
+    return rv == ROOT ? root_value : rv == YES;
+}
+
+/* Determine from the Visitor context whether the currently being visited IR node
+ * denotes something that might be read by the code.  This is often conservative
+ * (we don't know for certain that it is read).  We return root_value for top-level
+ * expressions, and false for expression-statement unused values.
+ * TODO -- currently returns true for expressions 'read' in annotations.
+ */
+bool P4WriteContext::isRead(bool root_value) {
+    if (!ctxt)
+        return root_value;
+    auto rv = readRole(ctxt);
+    return rv == ROOT ? root_value : rv == YES;
 }
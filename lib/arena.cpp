@@ -0,0 +1,179 @@
+#include "arena.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "backtrace.h"
+#include "exceptions.h"
+#include "gc.h"
+
+namespace Util {
+
+static std::atomic<Arena *> current_arena(nullptr);
+
+static constexpr size_t ALIGN = alignof(std::max_align_t);
+constexpr size_t Arena::compactChunkSize;
+
+// The pages of all live chunks, so operator delete can tell arena memory from heap
+// memory without a lock: a bit for each page, in a bitmap for each 4GB region of the
+// address space that has chunks.  Chunks start and end on page boundaries, so the pages
+// hold nothing else.  The bitmap of a region is allocated with its first chunk and never
+// freed; 2^16 regions cover 48-bit addresses.
+static constexpr unsigned PAGE_BITS = 12;
+static constexpr unsigned REGION_BITS = 32;
+static constexpr size_t PAGE = size_t(1) << PAGE_BITS;
+static constexpr size_t REGION_WORDS = (size_t(1) << (REGION_BITS - PAGE_BITS)) / 64;
+static constexpr size_t REGIONS = size_t(1) << 16;
+// zero-initialized, so untouched pages cost nothing
+static std::atomic<std::atomic<uint64_t> *> page_map[REGIONS];
+
+static std::atomic<uint64_t> *page_word(uint64_t page, uint64_t &bit) {
+    auto &region = page_map[page >> (REGION_BITS - PAGE_BITS)];
+    auto *words = region.load(std::memory_order_acquire);
+    if (!words) {
+        // not from the collector, which would scan the bitmap for pointers
+        auto *fresh = static_cast<std::atomic<uint64_t> *>(
+            std::calloc(REGION_WORDS, sizeof(std::atomic<uint64_t>)));
+        if (!fresh) throw backtrace_exception<std::bad_alloc>();
+        if (region.compare_exchange_strong(words, fresh, std::memory_order_acq_rel)) {
+            words = fresh;
+        } else {
+            std::free(fresh); } }
+    page &= (REGION_WORDS * 64) - 1;
+    bit = uint64_t(1) << (page % 64);
+    return &words[page / 64];
+}
+
+// Set or clear the bits of the pages from @base to @limit
+static void map_pages(const char *base, const char *limit, bool arena) {
+    uint64_t first = reinterpret_cast<uintptr_t>(base) >> PAGE_BITS;
+    uint64_t last = reinterpret_cast<uintptr_t>(limit - 1) >> PAGE_BITS;
+    BUG_CHECK((last >> (REGION_BITS - PAGE_BITS)) < REGIONS,
+              "arena chunk above the 48-bit address space");
+    for (uint64_t page = first; page <= last; ++page) {
+        uint64_t bit;
+        auto *word = page_word(page, bit);
+        if (arena)
+            word->fetch_or(bit, std::memory_order_release);
+        else
+            word->fetch_and(~bit, std::memory_order_release); }
+}
+
+// The handle of an object is the number of its chunk in the upper 16 bits, and its
+// offset in units of ALIGN in the lower 16.  A number is reused once its chunk is freed.
+static constexpr unsigned OFFSET_BITS = 16;
+static constexpr size_t MAX_CHUNK_NUMBER = (size_t(1) << (32 - OFFSET_BITS)) - 1;
+// zero-initialized, so untouched pages cost nothing
+static std::atomic<char *> chunk_bases[MAX_CHUNK_NUMBER + 1];
+static std::vector<uint32_t> &free_chunk_numbers() {
+    static std::vector<uint32_t> *numbers = new std::vector<uint32_t>;
+    return *numbers; }
+static uint32_t next_chunk_number = 1;  // 0 is for nullptr
+#ifdef MULTITHREAD
+static std::mutex chunk_numbers_lock;
+#define LOCK_CHUNK_NUMBERS std::lock_guard<std::mutex> acquire(chunk_numbers_lock)
+#else
+#define LOCK_CHUNK_NUMBERS
+#endif  // MULTITHREAD
+
+Arena::Arena(size_t chunkSize) : chunkSize(chunkSize) {}
+
+Arena::~Arena() {
+    Arena *self = this;
+    current_arena.compare_exchange_strong(self, nullptr);
+    for (auto &c : chunks) {
+        if (c.number) {
+            LOCK_CHUNK_NUMBERS;
+            chunk_bases[c.number] = nullptr;
+            free_chunk_numbers().push_back(c.number); }
+        map_pages(c.base, c.limit, false);
+        gc_free_root(c.memory); }
+}
+
+char *Arena::newChunk(size_t size) {
+    // whole pages, so that the page map is exact
+    size = (size + PAGE - 1) & ~(PAGE - 1);
+    void *memory = gc_alloc_root(size + PAGE - 1);
+    char *base = reinterpret_cast<char *>(
+        (reinterpret_cast<uintptr_t>(memory) + PAGE - 1) & ~uintptr_t(PAGE - 1));
+    map_pages(base, base + size, true);
+    uint32_t number = 0;
+    if (size <= compactChunkSize) {
+        LOCK_CHUNK_NUMBERS;
+        auto &numbers = free_chunk_numbers();
+        if (!numbers.empty()) {
+            number = numbers.back();
+            numbers.pop_back();
+        } else if (next_chunk_number <= MAX_CHUNK_NUMBER) {
+            number = next_chunk_number++; }
+        if (number) chunk_bases[number] = base; }
+    chunks.push_back(Chunk{memory, base, base + size, number});
+    return base;
+}
+
+void *Arena::allocate(size_t size) {
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    allocated += size;
+    if (size > chunkSize / 4) {
+        // big objects get their own chunk, so as not to waste the rest of the current one
+        return newChunk(size); }
+    if (size > static_cast<size_t>(limit - next)) {
+        next = newChunk(chunkSize);
+        limit = next + chunkSize; }
+    void *rv = next;
+    next += size;
+    return rv;
+}
+
+bool Arena::owns(const void *p) const {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    for (auto &c : chunks)
+        if (p >= c.base && p < c.limit) return true;
+    return false;
+}
+
+uint32_t Arena::compress(const void *p) const {
+    if (!p) return 0;
+    auto *c = static_cast<const char *>(p);
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    // most pointers are to recent objects
+    for (auto it = chunks.rbegin(); it != chunks.rend(); ++it)
+        if (c >= it->base && c < it->limit) {
+            if (!it->number || (c - it->base) % ALIGN) return 0;
+            return (it->number << OFFSET_BITS) | uint32_t((c - it->base) / ALIGN); }
+    return 0;
+}
+
+void *Arena::expand(uint32_t handle) {
+    if (!handle) return nullptr;
+    char *base = chunk_bases[handle >> OFFSET_BITS].load(std::memory_order_relaxed);
+    return base + (handle & ((1U << OFFSET_BITS) - 1)) * ALIGN;
+}
+
+void compactPtrError() {
+    BUG("CompactPtr to an object with no compact handle");
+}
+
+Arena *Arena::current() { return current_arena.load(std::memory_order_relaxed); }
+
+bool Arena::isArenaPtr(const void *p) {
+    uint64_t page = reinterpret_cast<uintptr_t>(p) >> PAGE_BITS;
+    if ((page >> (REGION_BITS - PAGE_BITS)) >= REGIONS) return false;
+    auto *words = page_map[page >> (REGION_BITS - PAGE_BITS)].load(std::memory_order_acquire);
+    if (!words) return false;
+    page &= (REGION_WORDS * 64) - 1;
+    return (words[page / 64].load(std::memory_order_acquire) >> (page % 64)) & 1;
+}
+
+Arena::Scope::Scope(Arena *arena) : prev(current_arena.exchange(arena)) {}
+Arena::Scope::~Scope() { current_arena = prev; }
+
+}  // namespace Util
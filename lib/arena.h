@@ -0,0 +1,108 @@
+#ifndef _LIB_ARENA_H_
+#define _LIB_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+namespace Util {
+
+/**
+ * A bump allocator whose memory is all released at once when the arena is destroyed.
+ *
+ * While an arena is current (see Scope), IR nodes are allocated from it rather than from
+ * the garbage-collected heap (strings interned by cstring always go to cstring's own
+ * permanent storage), so a compilation's allocations take no collector lock and are
+ * never individually traced, swept or freed.  Nothing allocated from an arena may be used
+ * after the arena is destroyed; caches that outlive a compilation (such as
+ * IR::Type_Bits::get) must allocate with no arena current.
+ *
+ * Arena memory is registered with the collector as a root, so objects on the GC heap that
+ * are referenced only from arena-allocated nodes remain live.
+ *
+ * A pointer into an arena can also be held in 32 bits, as a handle made by compress()
+ * (see CompactPtr): the number of its chunk and its offset in the chunk.  Only chunks of
+ * up to compactChunkSize bytes are numbered, so objects big enough to get a chunk of
+ * their own have no handle.
+ */
+class Arena {
+    struct Chunk {
+        void            *memory;        // as allocated, before aligning base to a page
+        char            *base, *limit;
+        uint32_t        number;         // 0 if the chunk has no handles
+    };
+    size_t              chunkSize;
+    std::vector<Chunk>  chunks;
+    char                *next = nullptr, *limit = nullptr;
+    size_t              allocated = 0;
+#ifdef MULTITHREAD
+    mutable std::mutex  lock;
+#endif  // MULTITHREAD
+
+    char *newChunk(size_t size);
+
+ public:
+    /// The biggest chunk whose objects have handles: one for each of 2^16 alignment units.
+    static constexpr size_t compactChunkSize = alignof(std::max_align_t) << 16;
+    explicit Arena(size_t chunkSize = 1 << 20);
+    Arena(const Arena &) = delete;
+    ~Arena();
+
+    /// Allocate @size bytes, aligned for any type.  Never returns nullptr.
+    void *allocate(size_t size);
+    /// @return true if @p points into memory allocated from this arena
+    bool owns(const void *p) const;
+    /// Total bytes handed out by allocate()
+    size_t bytesAllocated() const { return allocated; }
+
+    /// @return a 32-bit handle for @p, which must be an object allocated from this arena
+    /// (not a part of one), or 0 for nullptr or an object that has none.  Looks for the chunk of @p, so it
+    /// takes time linear in the number of chunks.
+    uint32_t compress(const void *p) const;
+    /// @return the pointer of a handle made by compress(), in constant time and
+    /// without locking.  The arena must still be alive.
+    static void *expand(uint32_t handle);
+
+    /// The arena IR nodes are currently allocated from, or nullptr for the GC heap.
+    static Arena *current();
+    /// @return true if @p was allocated from any live arena, in constant time and
+    /// without locking
+    static bool isArenaPtr(const void *p);
+
+    /// Make an arena (or none, for nullptr) current for the lifetime of the Scope.
+    class Scope {
+        Arena           *prev;
+     public:
+        explicit Scope(Arena *arena);
+        Scope(const Scope &) = delete;
+        ~Scope();
+    };
+};
+
+void compactPtrError();
+
+/// A pointer to an object allocated from an arena, in half the space of a pointer on a
+/// 64-bit host.  It is built from the arena the object was allocated from and read like
+/// a pointer; building it from an object without a handle is a bug.
+template<class T> class CompactPtr {
+    uint32_t            handle = 0;
+
+ public:
+    CompactPtr() = default;
+    CompactPtr(const Arena &arena, T *p) : handle(arena.compress(p)) {
+        if (p && !handle) compactPtrError(); }
+    T *get() const { return static_cast<T *>(Arena::expand(handle)); }
+    T *operator->() const { return get(); }
+    T &operator*() const { return *get(); }
+    operator T *() const { return get(); }
+    explicit operator bool() const { return handle != 0; }
+    bool operator==(const CompactPtr &a) const { return handle == a.handle; }
+    bool operator!=(const CompactPtr &a) const { return handle != a.handle; }
+};
+
+}  // namespace Util
+
+#endif /* _LIB_ARENA_H_ */
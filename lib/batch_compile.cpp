@@ -0,0 +1,141 @@
+#include "batch_compile.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "crash.h"
+#include "gc.h"
+#include "log.h"
+#include "thread_pool.h"
+
+namespace Util {
+
+namespace {
+
+struct Job {
+    unsigned                    line;
+    std::vector<std::string>    args;
+    int                         status = 0;
+};
+
+/// Read the compilations of the batch file @path.  @return false if it is unreadable
+bool readJobs(const char *path, std::vector<Job> &jobs) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string text;
+    for (unsigned line = 1; std::getline(in, text); ++line) {
+        std::istringstream words(text);
+        Job job;
+        job.line = line;
+        for (std::string word; words >> word; )
+            job.args.push_back(word);
+        if (!job.args.empty() && job.args.front()[0] != '#')
+            jobs.push_back(std::move(job)); }
+    return !in.bad();
+}
+
+int compileJob(const BatchCompile::Main &compile, char *exe,
+               const std::vector<std::string> &common, Job &job) {
+    // copies, since options may keep or even modify the arguments
+    std::vector<std::string> args(common);
+    args.insert(args.end(), job.args.begin(), job.args.end());
+    std::vector<char *> argv = { exe };
+    for (auto &arg : args) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+    try {
+        return compile(argv.size() - 1, argv.data());
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1; }
+}
+
+}  // namespace
+
+bool BatchCompile::requested(int argc, char *const argv[]) {
+    return argc >= 2 && strcmp(argv[1], "--batch") == 0;
+}
+
+int BatchCompile::run(int argc, char *const argv[], const Main &compile) {
+    if (argc < 3) {
+        std::cerr << argv[0] << ": --batch requires a file" << std::endl;
+        return 1; }
+    const char *path = argv[2];
+    unsigned jobs = 1;
+    int first = 3;
+    if (argc >= 5 && strcmp(argv[3], "--batch-jobs") == 0) {
+        jobs = strtoul(argv[4], nullptr, 10);
+        if (jobs == 0) {
+            std::cerr << argv[0] << ": invalid job count " << argv[4] << std::endl;
+            return 1; }
+        first = 5; }
+    std::vector<std::string> common(argv + first, argv + argc);
+
+    std::vector<Job> batch;
+    if (!readJobs(path, batch)) {
+        std::cerr << argv[0] << ": cannot read " << path << ": " << strerror(errno)
+                  << std::endl;
+        return 1; }
+#ifndef MULTITHREAD
+    if (jobs > 1) {
+        std::cerr << argv[0] << ": warning: --batch-jobs ignored; compiler was built "
+                  << "without multithreading" << std::endl;
+        jobs = 1; }
+#endif  // MULTITHREAD
+    if (jobs > batch.size()) jobs = batch.size();
+
+    if (jobs <= 1) {
+        for (auto &job : batch) {
+            job.status = compileJob(compile, argv[0], common, job);
+            // as for a compile server, -T options apply to one compilation only
+            Log::resetDebugSpecs(); }
+    } else {
+        // resizing the pool would stop it under the other compilations
+        auto threadsOption = [](const std::vector<std::string> &args) {
+            for (auto &arg : args) if (arg == "--threads") return true;
+            return false; };
+        bool threads = threadsOption(common);
+        if (threads)
+            std::cerr << argv[0] << ": --threads is not allowed with --batch-jobs" << std::endl;
+        for (auto &job : batch)
+            if (threadsOption(job.args)) {
+                std::cerr << path << ":" << job.line << ": --threads is not allowed "
+                          << "with --batch-jobs" << std::endl;
+                threads = true; }
+        if (threads) return 1;
+
+        ThreadPool::global();  // created before the compilations share it
+        gc_allow_threads();
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < jobs; ++i)
+            workers.emplace_back([&]() {
+                gc_register_thread();
+#ifdef MULTITHREAD
+                register_thread();
+#endif  // MULTITHREAD
+                for (size_t j = next++; j < batch.size(); j = next++)
+                    batch[j].status = compileJob(compile, argv[0], common, batch[j]);
+                gc_unregister_thread(); });
+        for (auto &worker : workers)
+            worker.join(); }
+
+    unsigned failed = 0;
+    for (auto &job : batch) {
+        if (job.status == 0) continue;
+        std::cerr << path << ":" << job.line << ": compilation failed" << std::endl;
+        ++failed; }
+    if (failed)
+        std::cerr << failed << " of " << batch.size() << " compilations failed" << std::endl;
+    return failed != 0;
+}
+
+}  // namespace Util
@@ -0,0 +1,42 @@
+#ifndef _LIB_BATCH_COMPILE_H_
+#define _LIB_BATCH_COMPILE_H_
+
+#include <functional>
+
+namespace Util {
+
+/**
+ * Compiles many programs in one process, enabled with `--batch <file>` as the first
+ * arguments of a compiler that supports it:
+ *
+ *     p4test --batch <file> [--batch-jobs <n>] [options...]
+ *
+ * Every line of the file that is not blank or a '#' comment holds the arguments of one
+ * compilation, separated by whitespace (there is no quoting); the options given after
+ * the file come before them.  Process startup and static IR initialization are then paid
+ * once, and with --precompiled-includes among the options every compilation uses the
+ * same parsed standard headers, which are read once (see FrontEndCache::readFile).
+ *
+ * Each compilation is a call of the compiler's main function, which creates its
+ * CompileContext.  With --batch-jobs, that many compilations run at once on threads of
+ * their own, sharing the thread pool of the passes that run in parallel; --threads is
+ * not allowed then, and -T options apply to all the compilations running at once.
+ * Diagnostics go to stderr as they are issued; at the end the lines of the file whose
+ * compilation failed are listed.  A compilation that exits the process (e.g. --help)
+ * ends the batch.
+ */
+class BatchCompile {
+ public:
+    using Main = std::function<int(int argc, char *const argv[])>;
+
+    /// @return true if @argv asks for a batch
+    static bool requested(int argc, char *const argv[]);
+
+    /// Run the batch described by @argv with @compile.
+    /// @return 0 if every compilation succeeded, otherwise 1
+    static int run(int argc, char *const argv[], const Main &compile);
+};
+
+}  // namespace Util
+
+#endif /* _LIB_BATCH_COMPILE_H_ */
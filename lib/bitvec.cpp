@@ -18,21 +18,246 @@ limitations under the License.
 #include "bitvec.h"
 #include "hex.h"
 
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define BITVEC_AVX2     1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define BITVEC_NEON     1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/* Scalar versions of the bulk kernels, used when no vector version is available, and for
+ * the tail words that don't fill a vector */
+bool and_scalar(uintptr_t *a, const uintptr_t *b, size_t n) {
+    uintptr_t diff = 0;
+    for (size_t i = 0; i < n; i++) {
+        diff |= a[i] & ~b[i];
+        a[i] &= b[i]; }
+    return diff != 0;
+}
+bool or_scalar(uintptr_t *a, const uintptr_t *b, size_t n) {
+    uintptr_t diff = 0;
+    for (size_t i = 0; i < n; i++) {
+        diff |= b[i] & ~a[i];
+        a[i] |= b[i]; }
+    return diff != 0;
+}
+bool andnot_scalar(uintptr_t *a, const uintptr_t *b, size_t n) {
+    uintptr_t diff = 0;
+    for (size_t i = 0; i < n; i++) {
+        diff |= a[i] & b[i];
+        a[i] &= ~b[i]; }
+    return diff != 0;
+}
+bool equal_scalar(const uintptr_t *a, const uintptr_t *b, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (a[i] != b[i]) return false;
+    return true;
+}
+bool intersects_scalar(const uintptr_t *a, const uintptr_t *b, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (a[i] & b[i]) return true;
+    return false;
+}
+size_t nonzero_scalar(const uintptr_t *a, size_t n) {
+    size_t i = 0;
+    while (i < n && !a[i]) ++i;
+    return i;
+}
+int popcount_scalar(const uintptr_t *a, size_t n) {
+    int rv = 0;
+    for (size_t i = 0; i < n; i++)
+#if defined(__GNUC__) || defined(__clang__)
+        rv += builtin_popcount(a[i]);
+#else
+        for (auto v = a[i]; v; v &= v-1)
+            ++rv;
+#endif
+    return rv;
+}
+
+#if BITVEC_AVX2
+/* AVX2 versions, 4 words at a time.  These are compiled for AVX2 regardless of the
+ * -march flags and only called if the CPU turns out to support it. */
+#define AVX2 __attribute__((target("avx2")))
+AVX2 bool and_avx2(uintptr_t *a, const uintptr_t *b, size_t n) {
+    __m256i diff = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        diff = _mm256_or_si256(diff, _mm256_andnot_si256(y, x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(a + i), _mm256_and_si256(x, y)); }
+    return and_scalar(a + i, b + i, n - i) | !_mm256_testz_si256(diff, diff);
+}
+AVX2 bool or_avx2(uintptr_t *a, const uintptr_t *b, size_t n) {
+    __m256i diff = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        diff = _mm256_or_si256(diff, _mm256_andnot_si256(x, y));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(a + i), _mm256_or_si256(x, y)); }
+    return or_scalar(a + i, b + i, n - i) | !_mm256_testz_si256(diff, diff);
+}
+AVX2 bool andnot_avx2(uintptr_t *a, const uintptr_t *b, size_t n) {
+    __m256i diff = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        diff = _mm256_or_si256(diff, _mm256_and_si256(x, y));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(a + i), _mm256_andnot_si256(y, x)); }
+    return andnot_scalar(a + i, b + i, n - i) | !_mm256_testz_si256(diff, diff);
+}
+AVX2 bool equal_avx2(const uintptr_t *a, const uintptr_t *b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        __m256i d = _mm256_xor_si256(x, y);
+        if (!_mm256_testz_si256(d, d)) return false; }
+    return equal_scalar(a + i, b + i, n - i);
+}
+AVX2 bool intersects_avx2(const uintptr_t *a, const uintptr_t *b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        if (!_mm256_testz_si256(x, y)) return true; }
+    return intersects_scalar(a + i, b + i, n - i);
+}
+AVX2 size_t nonzero_avx2(const uintptr_t *a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        if (!_mm256_testz_si256(x, x)) break; }
+    return i + nonzero_scalar(a + i, n - i);
+}
+/* Count the bits of each byte with two nibble table lookups, and sum the bytes of each
+ * word with vpsadbw */
+AVX2 int popcount_avx2(const uintptr_t *a, size_t n) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(x, nibble));
+        __m256i hi = _mm256_shuffle_epi8(table,
+                                         _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi),
+                                                    _mm256_setzero_si256())); }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + popcount_scalar(a + i, n - i);
+}
+#undef AVX2
+#endif /* BITVEC_AVX2 */
+
+#if BITVEC_NEON
+/* NEON versions, 2 words at a time.  NEON is always there on AArch64. */
+bool any(uint64x2_t x) { return (vgetq_lane_u64(x, 0) | vgetq_lane_u64(x, 1)) != 0; }
+bool and_neon(uintptr_t *a, const uintptr_t *b, size_t n) {
+    uint64x2_t diff = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64x2_t x = vld1q_u64(reinterpret_cast<const uint64_t *>(a + i));
+        uint64x2_t y = vld1q_u64(reinterpret_cast<const uint64_t *>(b + i));
+        diff = vorrq_u64(diff, vbicq_u64(x, y));
+        vst1q_u64(reinterpret_cast<uint64_t *>(a + i), vandq_u64(x, y)); }
+    return and_scalar(a + i, b + i, n - i) | any(diff);
+}
+bool or_neon(uintptr_t *a, const uintptr_t *b, size_t n) {
+    uint64x2_t diff = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64x2_t x = vld1q_u64(reinterpret_cast<const uint64_t *>(a + i));
+        uint64x2_t y = vld1q_u64(reinterpret_cast<const uint64_t *>(b + i));
+        diff = vorrq_u64(diff, vbicq_u64(y, x));
+        vst1q_u64(reinterpret_cast<uint64_t *>(a + i), vorrq_u64(x, y)); }
+    return or_scalar(a + i, b + i, n - i) | any(diff);
+}
+bool andnot_neon(uintptr_t *a, const uintptr_t *b, size_t n) {
+    uint64x2_t diff = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64x2_t x = vld1q_u64(reinterpret_cast<const uint64_t *>(a + i));
+        uint64x2_t y = vld1q_u64(reinterpret_cast<const uint64_t *>(b + i));
+        diff = vorrq_u64(diff, vandq_u64(x, y));
+        vst1q_u64(reinterpret_cast<uint64_t *>(a + i), vbicq_u64(x, y)); }
+    return andnot_scalar(a + i, b + i, n - i) | any(diff);
+}
+int popcount_neon(const uintptr_t *a, size_t n) {
+    int rv = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        rv += vaddlvq_u8(vcntq_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(a + i))));
+    return rv + popcount_scalar(a + i, n - i);
+}
+#endif /* BITVEC_NEON */
+
+struct bulk_kernels {
+    bool (*and_)(uintptr_t *, const uintptr_t *, size_t);
+    bool (*or_)(uintptr_t *, const uintptr_t *, size_t);
+    bool (*andnot)(uintptr_t *, const uintptr_t *, size_t);
+    bool (*equal)(const uintptr_t *, const uintptr_t *, size_t);
+    bool (*intersects)(const uintptr_t *, const uintptr_t *, size_t);
+    size_t (*nonzero)(const uintptr_t *, size_t);
+    int (*popcount)(const uintptr_t *, size_t);
+};
+
+const bulk_kernels &kernels() {
+    static const bulk_kernels rv = []() -> bulk_kernels {
+#if BITVEC_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            return { and_avx2, or_avx2, andnot_avx2, equal_avx2, intersects_avx2,
+                     nonzero_avx2, popcount_avx2 };
+#elif BITVEC_NEON
+        return { and_neon, or_neon, andnot_neon, equal_scalar, intersects_scalar,
+                 nonzero_scalar, popcount_neon };
+#endif
+        return { and_scalar, or_scalar, andnot_scalar, equal_scalar, intersects_scalar,
+                 nonzero_scalar, popcount_scalar };
+    }();
+    return rv;
+}
+
+}  // namespace
+
+constexpr size_t bitvec::inline_words;
+constexpr size_t bitvec::bulk_words;
+
+bool bitvec::bulk_and(uintptr_t *a, const uintptr_t *b, size_t n) {
+    return kernels().and_(a, b, n); }
+bool bitvec::bulk_or(uintptr_t *a, const uintptr_t *b, size_t n) {
+    return kernels().or_(a, b, n); }
+bool bitvec::bulk_andnot(uintptr_t *a, const uintptr_t *b, size_t n) {
+    return kernels().andnot(a, b, n); }
+bool bitvec::bulk_equal(const uintptr_t *a, const uintptr_t *b, size_t n) {
+    return kernels().equal(a, b, n); }
+bool bitvec::bulk_intersects(const uintptr_t *a, const uintptr_t *b, size_t n) {
+    return kernels().intersects(a, b, n); }
+size_t bitvec::bulk_nonzero(const uintptr_t *a, size_t n) {
+    return kernels().nonzero(a, n); }
+int bitvec::bulk_popcount(const uintptr_t *a, size_t n) {
+    return kernels().popcount(a, n); }
+
 std::ostream &operator<<(std::ostream &os, const bitvec &bv) {
-    if (bv.size == 1) {
-        os << hex(bv.data);
-    } else {
-        bool first = true;
-        for (int i = bv.size-1; i >= 0; i--) {
-            if (first) {
-                if (!bv.ptr[i]) continue;
-                os << hex(bv.ptr[i]);
-                first = false;
-            } else {
-                os << hex(bv.ptr[i], sizeof(bv.data)*2, '0'); } }
-        if (first)
-            os << '0';
-    }
+    const uintptr_t *w = bv.words();
+    bool first = true;
+    for (int i = bv.size-1; i >= 0; i--) {
+        if (first) {
+            if (!w[i]) continue;
+            os << hex(w[i]);
+            first = false;
+        } else {
+            os << hex(w[i], sizeof(*w)*2, '0'); } }
+    if (first)
+        os << '0';
     return os;
 }
 
@@ -69,44 +294,39 @@ bool operator>>(const char *s, bitvec &bv) {
 }
 
 bitvec &bitvec::operator>>=(size_t count) {
-    if (size == 1) {
-        if (count >= bits_per_unit)
-            data = 0;
-        else
-            data >>= count;
-        return *this; }
-    int off = count / bits_per_unit;
+    uintptr_t *w = words();
+    size_t off = count / bits_per_unit;
     count %= bits_per_unit;
     for (size_t i = 0; i < size; i++)
         if (i + off < size) {
-            ptr[i] = ptr[i+off] >> count;
+            w[i] = w[i+off] >> count;
             if (count && i + off + 1 < size)
-                ptr[i] |= ptr[i+off+1] << (bits_per_unit - count);
+                w[i] |= w[i+off+1] << (bits_per_unit - count);
         } else {
-            ptr[i] = 0; }
-    while (size > 1 && !ptr[size-1]) size--;
-    if (size == 1) {
-        auto tmp = ptr[0];
-        delete [] ptr;
-        data = tmp; }
+            w[i] = 0; }
+    // drop the zero words at the top, moving the rest inline if they fit
+    size_t used = size;
+    while (used > inline_words && !w[used-1]) used--;
+    if (used == inline_words && !inlined()) {
+        memcpy(data, w, sizeof(data));
+        delete [] w; }
+    size = used;
     return *this;
 }
 
 bitvec &bitvec::operator<<=(size_t count) {
     size_t needsize = (max().index() + count + bits_per_unit)/bits_per_unit;
     if (needsize > size) expand(needsize);
-    if (size == 1) {
-        data <<= count;
-        return *this; }
+    uintptr_t *w = words();
     int off = count / bits_per_unit;
     count %= bits_per_unit;
     for (int i = size-1; i >= 0; i--)
         if (i >= off) {
-            ptr[i] = ptr[i-off] << count;
+            w[i] = w[i-off] << count;
             if (count && i > off)
-                ptr[i] |= ptr[i-off-1] >> (bits_per_unit - count);
+                w[i] |= w[i-off-1] >> (bits_per_unit - count);
         } else {
-            ptr[i] = 0; }
+            w[i] = 0; }
     return *this;
 }
 
@@ -115,32 +335,30 @@ bitvec bitvec::getslice(size_t idx, size_t sz) const {
     if (idx >= size * bits_per_unit) return bitvec();
     if (idx + sz > size * bits_per_unit)
         sz = size * bits_per_unit - idx;
-    if (size > 1) {
-        bitvec rv;
-        unsigned shift = idx % bits_per_unit;
-        idx /= bits_per_unit;
-        if (sz > bits_per_unit) {
-            rv.expand((sz-1)/bits_per_unit + 1);
-            for (size_t i = 0; i < rv.size; i++) {
-                if (shift != 0 && i != 0)
-                    rv.ptr[i-1] |= ptr[idx + i] << (bits_per_unit - shift);
-                rv.ptr[i] = ptr[idx + i] >> shift; }
-            if ((sz %= bits_per_unit))
-                rv.ptr[rv.size-1] &= ~(~static_cast<uintptr_t>(1) << (sz-1));
-        } else {
-            rv.data = ptr[idx] >> shift;
-            if (shift != 0 && idx + 1 < size)
-                rv.data |= ptr[idx + 1] << (bits_per_unit - shift);
-            rv.data &= ~(~static_cast<uintptr_t>(1) << (sz-1)); }
-        return rv;
-    } else {
-        return bitvec((data >> idx) & ~(~static_cast<uintptr_t>(1) << (sz-1))); }
+    bitvec rv;
+    const uintptr_t *w = words();
+    unsigned shift = idx % bits_per_unit;
+    idx /= bits_per_unit;
+    size_t count = (sz-1)/bits_per_unit + 1;  // expand() may round up rv.size
+    if (count > rv.size) rv.expand(count);
+    uintptr_t *rw = rv.words();
+    for (size_t i = 0; i < count; i++) {
+        rw[i] = w[idx + i] >> shift;
+        if (shift != 0 && idx + i + 1 < size)
+            rw[i] |= w[idx + i + 1] << (bits_per_unit - shift); }
+    if ((sz %= bits_per_unit))
+        rw[count-1] &= ~(~static_cast<uintptr_t>(1) << (sz-1));
+    return rv;
 }
 
 int bitvec::ffs(unsigned start) const {
     uintptr_t val = ~static_cast<uintptr_t>(0);
     unsigned idx = start / bits_per_unit;
     val <<= (start % bits_per_unit);
+    if (idx < size && !(val &= word(idx)) && size - idx > bulk_words) {
+        // skip the zero words in bulk
+        idx += 1 + bulk_nonzero(ptr + idx + 1, size - idx - 1);
+        val = word(idx); }
     while (idx < size && !(val &= word(idx))) {
         ++idx;
         val = ~static_cast<uintptr_t>(0); }
@@ -22,6 +22,7 @@ limitations under the License.
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <utility>
 #include <iostream>
 #include "config.h"
@@ -57,12 +58,32 @@ static inline int builtin_popcount(unsigned long long x) { return __builtin_popc
 
 
 class bitvec {
-    size_t              size;
+    /// The words of bitvecs up to this size are stored inline, in data; larger ones are
+    /// allocated on the heap, in ptr.
+    static constexpr size_t inline_words = 4;
+    size_t              size;           // in words, at least inline_words
     union {
-        uintptr_t       data;
+        uintptr_t       data[inline_words];
         uintptr_t       *ptr;
     };
-    uintptr_t word(size_t i) const { return i < size ? size > 1 ? ptr[i] : data : 0; }
+    bool inlined() const { return size <= inline_words; }
+    uintptr_t *words() { return inlined() ? data : ptr; }
+    const uintptr_t *words() const { return inlined() ? data : ptr; }
+    uintptr_t word(size_t i) const { return i < size ? words()[i] : 0; }
+
+    /// Kernels for the loops over the words of wide bitvecs, using the widest vector
+    /// instructions the CPU supports (picked at run time, see bitvec.cpp).  They are only
+    /// worth the call for at least bulk_words words; smaller bitvecs use the inline loops.
+    /// The and/or/andnot kernels update @a in place and return true if it changed;
+    /// bulk_nonzero returns the index of the first nonzero word, or @n if there is none.
+    static constexpr size_t bulk_words = 8;
+    static bool bulk_and(uintptr_t *a, const uintptr_t *b, size_t n);
+    static bool bulk_or(uintptr_t *a, const uintptr_t *b, size_t n);
+    static bool bulk_andnot(uintptr_t *a, const uintptr_t *b, size_t n);
+    static bool bulk_equal(const uintptr_t *a, const uintptr_t *b, size_t n);
+    static bool bulk_intersects(const uintptr_t *a, const uintptr_t *b, size_t n);
+    static size_t bulk_nonzero(const uintptr_t *a, size_t n);
+    static int bulk_popcount(const uintptr_t *a, size_t n);
 
  public:
     static constexpr size_t bits_per_unit = CHAR_BIT * sizeof(uintptr_t);
@@ -148,162 +169,137 @@ class bitvec {
     // incomplete type errors
     class copy_bitref;
 
-    bitvec() : size(1), data(0) {}
-    explicit bitvec(uintptr_t v) : size(1), data(v) {}
+    bitvec() : size(inline_words), data() {}
+    explicit bitvec(uintptr_t v) : size(inline_words), data{v} {}
     template<typename T, typename = typename
         std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(uintptr_t))>::type>
-    explicit bitvec(T v) : size(1), data(v) {
-        if (v != data) {
-            size = sizeof(v)/sizeof(data);
-            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[size];
-            for (unsigned i = 0; i < size; ++i) {
-                ptr[i] = v;
-                v >>= bits_per_unit; } } }
-    bitvec(size_t lo, size_t cnt) : size(1), data(0) { setrange(lo, cnt); }
+    explicit bitvec(T v) : bitvec() { setraw(v); }
+    bitvec(size_t lo, size_t cnt) : bitvec() { setrange(lo, cnt); }
     bitvec(const bitvec &a) : size(a.size) {
-        if (size > 1) {
-            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[size];
-            memcpy(ptr, a.ptr, size * sizeof(*ptr));
+        if (inlined()) {
+            memcpy(data, a.data, sizeof(data));
         } else {
-            data = a.data; }}
-    bitvec(bitvec &&a) : size(a.size), data(a.data) { a.size = 1; }
+            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[size];
+            memcpy(ptr, a.ptr, size * sizeof(*ptr)); } }
+    bitvec(bitvec &&a) : size(a.size) {
+        memcpy(data, a.data, sizeof(data));
+        a.size = inline_words;
+        memset(a.data, 0, sizeof(a.data)); }
     bitvec &operator=(const bitvec &a) {
         if (this == &a) return *this;
-        if (size > 1) delete [] ptr;
-        if ((size = a.size) > 1) {
+        if (!inlined()) delete [] ptr;
+        if ((size = a.size) > inline_words) {
             ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[size];
             memcpy(ptr, a.ptr, size * sizeof(*ptr));
         } else {
-            data = a.data; }
+            memcpy(data, a.data, sizeof(data)); }
         return *this; }
     bitvec &operator=(bitvec &&a) {
         std::swap(size, a.size); std::swap(data, a.data);
         return *this; }
-    ~bitvec() { if (size > 1) delete [] ptr; }
+    ~bitvec() { if (!inlined()) delete [] ptr; }
 
-    void clear() {
-        if (size > 1) memset(ptr, 0, size * sizeof(*ptr));
-        else data = 0; }  // NOLINT(whitespace/newline)
+    void clear() { memset(words(), 0, size * sizeof(uintptr_t)); }
     bool setbit(size_t idx) {
         if (idx >= size * bits_per_unit) expand(1 + idx/bits_per_unit);
-        if (size > 1)
-            ptr[idx/bits_per_unit] |= (uintptr_t)1 << (idx%bits_per_unit);
-        else
-            data |= (uintptr_t)1 << idx;
+        words()[idx/bits_per_unit] |= (uintptr_t)1 << (idx%bits_per_unit);
         return true; }
     void setrange(size_t idx, size_t sz) {
         if (sz == 0) return;
         if (idx+sz > size * bits_per_unit) expand(1 + (idx+sz-1)/bits_per_unit);
-        if (size == 1) {
-            data |= ~(~(uintptr_t)1 << (sz-1)) << idx;
-        } else if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
-            ptr[idx/bits_per_unit] |=
+        uintptr_t *w = words();
+        if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
+            w[idx/bits_per_unit] |=
                 ~(~(uintptr_t)1 << (sz-1)) << (idx%bits_per_unit);
         } else {
             size_t i = idx/bits_per_unit;
-            ptr[i] |= ~(uintptr_t)0 << (idx%bits_per_unit);
+            w[i] |= ~(uintptr_t)0 << (idx%bits_per_unit);
             idx += sz;
             while (++i < idx/bits_per_unit) {
-                ptr[i] = ~(uintptr_t)0; }
+                w[i] = ~(uintptr_t)0; }
             if (i < size)
-                ptr[i] |= (((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
+                w[i] |= (((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
     void setraw(uintptr_t raw) {
-        if (size == 1) {
-            data = raw;
-        } else {
-            ptr[0] = raw;
-            for (size_t i = 1; i < size; i++)
-                ptr[i] = 0; } }
+        clear();
+        words()[0] = raw; }
     template<typename T, typename = typename
         std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(uintptr_t))>::type>
     void setraw(T raw) {
         if (sizeof(T)/sizeof(uintptr_t) > size) expand(sizeof(T)/sizeof(uintptr_t));
+        uintptr_t *w = words();
         for (size_t i = 0; i < size; i++) {
-            ptr[i] = raw;
+            w[i] = i < sizeof(T)/sizeof(uintptr_t) ? raw : 0;
             raw >>= bits_per_unit; } }
     void setraw(uintptr_t *raw, size_t sz) {
         if (sz > size) expand(sz);
-        if (size == 1) {
-            data = raw[0];
-        } else {
-            for (size_t i = 0; i < sz; i++)
-                ptr[i] = raw[i];
-            for (size_t i = sz; i < size; i++)
-                ptr[i] = 0; } }
+        uintptr_t *w = words();
+        for (size_t i = 0; i < sz; i++)
+            w[i] = raw[i];
+        for (size_t i = sz; i < size; i++)
+            w[i] = 0; }
     template<typename T, typename = typename
         std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(uintptr_t))>::type>
     void setraw(T *raw, size_t sz) {
         constexpr size_t m = sizeof(T)/sizeof(uintptr_t);
         if (m * sz > size) expand(m * sz);
+        uintptr_t *w = words();
         size_t i = 0;
         for (; i < sz*m; ++i)
-            ptr[i] = raw[i/m] >> ((i%m) * bits_per_unit);
+            w[i] = raw[i/m] >> ((i%m) * bits_per_unit);
         for (; i < size; ++i)
-            ptr[i] = 0; }
+            w[i] = 0; }
     bool clrbit(size_t idx) {
         if (idx >= size * bits_per_unit) return false;
-        if (size > 1)
-            ptr[idx/bits_per_unit] &= ~((uintptr_t)1 << (idx%bits_per_unit));
-        else
-            data &= ~((uintptr_t)1 << idx);
+        words()[idx/bits_per_unit] &= ~((uintptr_t)1 << (idx%bits_per_unit));
         return false; }
     void clrrange(size_t idx, size_t sz) {
         if (sz == 0) return;
         if (size < sz/bits_per_unit)  // To avoid sz + idx overflow
             sz = size * bits_per_unit;
         if (idx >= size * bits_per_unit) return;
-        if (size == 1) {
-            if (idx + sz < bits_per_unit)
-                data &= ~(~(~(uintptr_t)1 << (sz-1)) << idx);
-            else
-                data &= ~(~(uintptr_t)0 << idx);
-        } else if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
-            ptr[idx/bits_per_unit] &=
+        uintptr_t *w = words();
+        if (idx/bits_per_unit == (idx+sz-1)/bits_per_unit) {
+            w[idx/bits_per_unit] &=
                 ~(~(~(uintptr_t)1 << (sz-1)) << (idx%bits_per_unit));
         } else {
             size_t i = idx/bits_per_unit;
-            ptr[i] &= ~(~(uintptr_t)0 << (idx%bits_per_unit));
+            w[i] &= ~(~(uintptr_t)0 << (idx%bits_per_unit));
             idx += sz;
             while (++i < idx/bits_per_unit && i < size) {
-                ptr[i] = 0; }
+                w[i] = 0; }
             if (i < size)
-                ptr[i] &= ~(((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
+                w[i] &= ~(((uintptr_t)1 << (idx%bits_per_unit)) - 1); } }
     bool getbit(size_t idx) const {
         return (word(idx/bits_per_unit) >> (idx%bits_per_unit)) & 1; }
     uintmax_t getrange(size_t idx, size_t sz) const {
         assert(sz > 0 && sz <= CHAR_BIT * sizeof(uintmax_t));
         if (idx >= size * bits_per_unit) return 0;
-        if (size > 1) {
-            unsigned shift = idx % bits_per_unit;
-            idx /= bits_per_unit;
-            uintmax_t rv = ptr[idx] >> shift;
-            shift = bits_per_unit - shift;
-            while (shift < sz) {
-                if (++idx >= size) break;
-                rv |= (uintmax_t)ptr[idx] << shift;
-                shift += bits_per_unit; }
-            return rv & ~(~(uintmax_t)1 << (sz-1));
-        } else {
-            return (data >> idx) & ~(~(uintmax_t)1 << (sz-1)); } }
+        const uintptr_t *w = words();
+        unsigned shift = idx % bits_per_unit;
+        idx /= bits_per_unit;
+        uintmax_t rv = w[idx] >> shift;
+        shift = bits_per_unit - shift;
+        while (shift < sz) {
+            if (++idx >= size) break;
+            rv |= (uintmax_t)w[idx] << shift;
+            shift += bits_per_unit; }
+        return rv & ~(~(uintmax_t)1 << (sz-1)); }
     void putrange(size_t idx, size_t sz, uintmax_t v) {
         assert(sz > 0 && sz <= CHAR_BIT * sizeof(uintmax_t));
         uintptr_t mask = ~(uintmax_t)0 >> (CHAR_BIT * sizeof(uintmax_t) - sz);
         v &= mask;
         if (idx+sz > size * bits_per_unit) expand(1 + (idx+sz-1)/bits_per_unit);
-        if (size == 1) {
-            data &= ~(mask << idx);
-            data |= v << idx;
-        } else {
-            unsigned shift = idx % bits_per_unit;
-            idx /= bits_per_unit;
-            ptr[idx] &= ~(mask << shift);
-            ptr[idx] |= v << shift;
-            shift = bits_per_unit - shift;
-            while (shift < sz) {
-                assert(idx+1 < size);
-                ptr[++idx] &= ~(mask >> shift);
-                ptr[idx] |= v >> shift;
-                shift += bits_per_unit; } } }
+        uintptr_t *w = words();
+        unsigned shift = idx % bits_per_unit;
+        idx /= bits_per_unit;
+        w[idx] &= ~(mask << shift);
+        w[idx] |= v << shift;
+        shift = bits_per_unit - shift;
+        while (shift < sz) {
+            assert(idx+1 < size);
+            w[++idx] &= ~(mask >> shift);
+            w[idx] |= v >> shift;
+            shift += bits_per_unit; } }
     bitvec getslice(size_t idx, size_t sz) const;
     nonconst_bitref operator[](int idx) { return nonconst_bitref(*this, idx); }
     bool operator[](int idx) const { return getbit(idx); }
@@ -323,57 +319,64 @@ class bitvec {
     nonconst_bitref max() & { return --nonconst_bitref(*this, size * bits_per_unit); }
     nonconst_bitref begin() & { return min(); }
     nonconst_bitref end() & { return nonconst_bitref(*this, -1); }
+
+    // The operators below loop over a constant number of words when the bitvecs are
+    // inline, and call the bulk kernels when they are wide enough.
     bool empty() const {
+        if (inlined()) {
+            uintptr_t any = 0;
+            for (size_t i = 0; i < inline_words; i++) any |= data[i];
+            return any == 0; }
+        if (size >= bulk_words) return bulk_nonzero(ptr, size) == size;
         for (size_t i = 0; i < size; i++)
-            if (word(i) != 0) return false;
+            if (ptr[i] != 0) return false;
         return true; }
     explicit operator bool() const { return !empty(); }
     bool operator&=(const bitvec &a) {
+        uintptr_t diff = 0;
+        if (inlined() && a.inlined()) {
+            for (size_t i = 0; i < inline_words; i++) {
+                diff |= data[i] & ~a.data[i];
+                data[i] &= a.data[i]; }
+            return diff != 0; }
+        uintptr_t *w = words();
+        const uintptr_t *aw = a.words();
+        size_t n = std::min(size, a.size);
         bool rv = false;
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < size && i < a.size; i++) {
-                    rv |= ((ptr[i] & a.ptr[i]) != ptr[i]);
-                    ptr[i] &= a.ptr[i]; }
-            } else {
-                rv |= ((*ptr & a.data) != *ptr);
-                *ptr &= a.data; }
-            if (size > a.size) {
-                if (!rv) {
-                    for (size_t i = a.size; i < size; i++)
-                        if (ptr[i]) { rv = true; break; }}
-                memset(ptr + a.size, 0, (size-a.size) * sizeof(*ptr)); }
-        } else if (a.size > 1) {
-            rv |= ((data & a.ptr[0]) != data);
-            data &= a.ptr[0];
+        if (n >= bulk_words) {
+            rv = bulk_and(w, aw, n);
         } else {
-            rv |= ((data & a.data) != data);
-            data &= a.data; }
-        return rv; }
+            for (size_t i = 0; i < n; i++) {
+                diff |= w[i] & ~aw[i];
+                w[i] &= aw[i]; } }
+        for (size_t i = n; i < size; i++) {
+            diff |= w[i];
+            w[i] = 0; }
+        return rv || diff != 0; }
     bitvec operator&(const bitvec &a) const {
         if (size <= a.size) {
             bitvec rv(*this); rv &= a; return rv;
         } else {
             bitvec rv(a); rv &= *this; return rv; } }
     bool operator|=(const bitvec &a) {
-        bool rv = false;
+        uintptr_t diff = 0;
+        if (inlined() && a.inlined()) {
+            for (size_t i = 0; i < inline_words; i++) {
+                diff |= a.data[i] & ~data[i];
+                data[i] |= a.data[i]; }
+            return diff != 0; }
         if (size < a.size) expand(a.size);
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < a.size; i++) {
-                    rv |= ((ptr[i] | a.ptr[i]) != ptr[i]);
-                    ptr[i] |= a.ptr[i]; }
-            } else {
-                rv |= ((*ptr | a.data) != *ptr);
-                *ptr |= a.data; }
-        } else {
-            rv |= ((data | a.data) != data);
-            data |= a.data; }
-        return rv; }
+        uintptr_t *w = words();
+        const uintptr_t *aw = a.words();
+        if (a.size >= bulk_words)
+            return bulk_or(w, aw, a.size);
+        for (size_t i = 0; i < a.size; i++) {
+            diff |= aw[i] & ~w[i];
+            w[i] |= aw[i]; }
+        return diff != 0; }
     bool operator|=(uintptr_t a) {
-        bool rv = false;
-        auto t = size > 1 ? ptr : &data;
-        rv |= ((*t | a) != *t);
+        uintptr_t *t = words();
+        bool rv = (*t | a) != *t;
         *t |= a;
         return rv; }
     template<typename T, typename = typename
@@ -387,37 +390,44 @@ class bitvec {
              std::enable_if<std::is_integral<T>::value && (sizeof(T) > sizeof(uintptr_t))>::type>
     bitvec operator|(T a) { bitvec rv(*this); rv |= bitvec(a); return rv; }
     bitvec &operator^=(const bitvec &a) {
+        if (inlined() && a.inlined()) {
+            for (size_t i = 0; i < inline_words; i++) data[i] ^= a.data[i];
+            return *this; }
         if (size < a.size) expand(a.size);
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < a.size; i++) ptr[i] ^= a.ptr[i];
-            } else {
-                *ptr ^= a.data; }
-        } else {
-            data ^= a.data; }
+        uintptr_t *w = words();
+        const uintptr_t *aw = a.words();
+        for (size_t i = 0; i < a.size; i++) w[i] ^= aw[i];
         return *this; }
     bitvec operator^(const bitvec &a) const {
         bitvec rv(*this); rv ^= a; return rv; }
     bool operator-=(const bitvec &a) {
-        bool rv = false;
-        if (size > 1) {
-            if (a.size > 1) {
-                for (size_t i = 0; i < size && i < a.size; i++) {
-                    rv |= ((ptr[i] & ~a.ptr[i]) != ptr[i]);
-                    ptr[i] &= ~a.ptr[i]; }
-            } else {
-                rv |= ((*ptr & ~a.data) != *ptr);
-                *ptr &= ~a.data; }
-        } else if (a.size > 1) {
-            rv |= ((data & ~a.ptr[0]) != data);
-            data &= ~a.ptr[0];
-        } else {
-            rv |= ((data & ~a.data) != data);
-            data &= ~a.data; }
-        return rv; }
+        uintptr_t diff = 0;
+        if (inlined() && a.inlined()) {
+            for (size_t i = 0; i < inline_words; i++) {
+                diff |= data[i] & a.data[i];
+                data[i] &= ~a.data[i]; }
+            return diff != 0; }
+        uintptr_t *w = words();
+        const uintptr_t *aw = a.words();
+        size_t n = std::min(size, a.size);
+        if (n >= bulk_words)
+            return bulk_andnot(w, aw, n);
+        for (size_t i = 0; i < n; i++) {
+            diff |= w[i] & aw[i];
+            w[i] &= ~aw[i]; }
+        return diff != 0; }
     bitvec operator-(const bitvec &a) const {
         bitvec rv(*this); rv -= a; return rv; }
     bool operator==(const bitvec &a) const {
+        if (inlined() && a.inlined()) {
+            uintptr_t diff = 0;
+            for (size_t i = 0; i < inline_words; i++) diff |= data[i] ^ a.data[i];
+            return diff == 0; }
+        if (size >= bulk_words && a.size >= bulk_words) {
+            const bitvec &longer = size > a.size ? *this : a;
+            size_t n = std::min(size, a.size);
+            return bulk_equal(ptr, a.ptr, n) &&
+                   bulk_nonzero(longer.ptr + n, longer.size - n) == longer.size - n; }
         for (size_t i = 0; i < size || i < a.size; i++)
             if (word(i) != a.word(i)) return false;
         return true; }
@@ -432,10 +442,20 @@ class bitvec {
     bool operator>=(const bitvec &a) const { return !(*this < a); }
     bool operator<=(const bitvec &a) const { return !(a < *this); }
     bool intersects(const bitvec &a) const {
+        if (inlined() && a.inlined()) {
+            uintptr_t common = 0;
+            for (size_t i = 0; i < inline_words; i++) common |= data[i] & a.data[i];
+            return common != 0; }
+        if (size >= bulk_words && a.size >= bulk_words)
+            return bulk_intersects(ptr, a.ptr, std::min(size, a.size));
         for (size_t i = 0; i < size && i < a.size; i++)
             if (word(i) & a.word(i)) return true;
         return false; }
     bool contains(const bitvec &a) const {  // is 'a' a subset or equal to 'this'?
+        if (inlined() && a.inlined()) {
+            uintptr_t missing = 0;
+            for (size_t i = 0; i < inline_words; i++) missing |= a.data[i] & ~data[i];
+            return missing == 0; }
         for (size_t i = 0; i < size && i < a.size; i++)
             if ((word(i) & a.word(i)) != a.word(i)) return false;
         for (size_t i = size; i < a.size; i++)
@@ -448,12 +468,14 @@ class bitvec {
     void rotate_right(size_t start_bit, size_t rotation_idx, size_t end_bit);
     bitvec rotate_right_copy(size_t start_bit, size_t rotation_idx, size_t end_bit) const;
     int popcount() const {
+        if (size >= bulk_words) return bulk_popcount(ptr, size);
+        const uintptr_t *w = words();
         int rv = 0;
         for (size_t i = 0; i < size; i++)
 #if defined(__GNUC__) || defined(__clang__)
-            rv += builtin_popcount(word(i));
+            rv += builtin_popcount(w[i]);
 #else
-            for (auto v = word(i); v; v &= v-1)
+            for (auto v = w[i]; v; v &= v-1)
                 ++rv;
 #endif
         return rv; }
@@ -470,18 +492,11 @@ class bitvec {
             m |= m >> 8;
             m |= m >> 16;
             newsize = (newsize + m) & ~m; }
-        if (size > 1) {
-            uintptr_t *old = ptr;
-            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[newsize];
-            memcpy(ptr, old, size * sizeof(*ptr));
-            memset(ptr + size, 0, (newsize - size) * sizeof(*ptr));
-            delete [] old;
-        } else {
-            uintptr_t d = data;
-            ptr = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[newsize];
-            *ptr = d;
-            memset(ptr + size, 0, (newsize - size) * sizeof(*ptr));
-        }
+        uintptr_t *grown = new IF_HAVE_LIBGC((PointerFreeGC)) uintptr_t[newsize];
+        memcpy(grown, words(), size * sizeof(*grown));
+        memset(grown + size, 0, (newsize - size) * sizeof(*grown));
+        if (!inlined()) delete [] ptr;
+        ptr = grown;
         size = newsize;
     }
 
@@ -17,6 +17,7 @@ limitations under the License.
 #include "lib/compile_context.h"
 #include "lib/error.h"
 #include "lib/exceptions.h"
+#include "lib/gc.h"
 
 ICompileContext::~ICompileContext() { }
 
@@ -47,8 +48,10 @@ CompileContextStack::reportContextMismatch(const char* desiredContextType) {
 }
 
 /* static */ CompileContextStack::StackType& CompileContextStack::getStack() {
-    static StackType stack;
-    return stack;
+    // in memory the collector scans, since it does not scan thread-local storage
+    static thread_local StackType* stack = nullptr;
+    if (!stack) stack = new(gc_alloc_root(sizeof(StackType))) StackType;
+    return *stack;
 }
 
 AutoCompileContext::AutoCompileContext(ICompileContext* context) {
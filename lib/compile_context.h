@@ -34,7 +34,9 @@ class ICompileContext {
 
 /// A stack of active compilation contexts. Only the top context is accessible.
 /// Compilation contexts can be nested to allow composing programs without
-/// intermingling their stack.
+/// intermingling their stack. Each thread has a stack of its own, so that
+/// several programs can be compiled at once; tasks run by Util::ThreadPool
+/// inherit the current context of the thread that submitted them.
 struct CompileContextStack final {
     /// @return the current compilation context (i.e., the top of the
     /// compilation context stack), cast to the requested type. If the current
@@ -53,6 +55,12 @@ struct CompileContextStack final {
         return getStack().empty();
     }
 
+    /// @return the current compilation context, or nullptr if the stack is empty.
+    static ICompileContext* current() {
+        auto& stack = getStack();
+        return stack.empty() ? nullptr : stack.back();
+    }
+
  private:
     friend struct AutoCompileContext;
 
@@ -0,0 +1,187 @@
+#include "compile_server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "exename.h"
+#include "log.h"
+#include "thread_pool.h"
+
+namespace Util {
+
+namespace {
+
+bool readFully(int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= n; }
+    return true;
+}
+
+bool writeFully(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= n; }
+    return true;
+}
+
+bool reply(int conn, int32_t status) {
+    uint32_t word = htonl(static_cast<uint32_t>(status));
+    return writeFully(conn, reinterpret_cast<const char *>(&word), sizeof(word));
+}
+
+// Receive the streams and the payload of a request.
+bool receive(int conn, int fds[3], std::string &payload) {
+    uint32_t length;
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = { &length, sizeof(length) };
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    do {
+        n = recvmsg(conn, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return false;
+    auto *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+        return false;
+    memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+    // the rest of the length may come separately
+    if (static_cast<size_t>(n) < sizeof(length) &&
+        !readFully(conn, reinterpret_cast<char *>(&length) + n, sizeof(length) - n))
+        return false;
+    payload.resize(ntohl(length));
+    return readFully(conn, &payload[0], payload.size());
+}
+
+// Redirects the standard streams and the working directory of the process to the
+// client's for the duration of a request.
+class ClientScope {
+    int saved[3];
+    int savedCwd;
+
+ public:
+    ClientScope(const int fds[3], const char *cwd) {
+        fflush(nullptr);
+        for (int i = 0; i < 3; ++i) {
+            saved[i] = dup(i);
+            dup2(fds[i], i); }
+        savedCwd = open(".", O_RDONLY | O_DIRECTORY);
+        if (chdir(cwd) != 0)
+            std::cerr << "compile server: cannot change to " << cwd << ": "
+                      << strerror(errno) << std::endl;
+    }
+    ~ClientScope() {
+        std::cout.flush();
+        std::cerr.flush();
+        std::clog.flush();
+        fflush(nullptr);
+        for (int i = 0; i < 3; ++i) {
+            dup2(saved[i], i);
+            close(saved[i]); }
+        if (savedCwd >= 0) {
+            if (fchdir(savedCwd) != 0) perror("compile server: fchdir");
+            close(savedCwd); }
+    }
+};
+
+const char *baseName(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+void serveRequest(int conn, const CompileServer::Main &compile) {
+    int fds[3] = { -1, -1, -1 };
+    std::string payload;
+    bool valid = receive(conn, fds, payload) && !payload.empty() && payload.back() == '\0';
+    // the working directory, then the arguments
+    std::vector<char *> args;
+    if (valid) {
+        for (size_t pos = 0; pos < payload.size(); pos = payload.find('\0', pos) + 1)
+            args.push_back(&payload[pos]);
+        valid = args.size() >= 2; }
+    if (!valid || strcmp(baseName(args[1]), baseName(exename())) != 0) {
+        LOG1("compile server: refusing a request for " << (valid ? args[1] : "nothing"));
+        reply(conn, -1);
+        for (int fd : fds) if (fd >= 0) close(fd);
+        return; }
+    int argc = args.size() - 1;
+    args.push_back(nullptr);
+    int status;
+    {
+        ClientScope scope(fds, args[0]);
+        try {
+            status = compile(argc, args.data() + 1);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            status = 1; }
+    }
+    for (int fd : fds) close(fd);
+    Log::resetDebugSpecs();
+    ThreadPool::setThreads(1);
+    reply(conn, status);
+}
+
+}  // namespace
+
+const char *CompileServer::socketPath(int argc, char *const argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--serve") == 0) return argv[2];
+    return nullptr;
+}
+
+int CompileServer::serve(const char *path, const Main &compile) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        std::cerr << "compile server: socket path too long: " << path << std::endl;
+        return 1; }
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("compile server: socket");
+        return 1; }
+    unlink(path);  // left behind by a previous server
+    if (bind(sock, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(sock, SOMAXCONN) != 0) {
+        std::cerr << "compile server: cannot listen on " << path << ": "
+                  << strerror(errno) << std::endl;
+        close(sock);
+        return 1; }
+    // a client going away must not end the server
+    signal(SIGPIPE, SIG_IGN);
+    LOG1("compile server listening on " << path);
+    for (;;) {
+        int conn = accept(sock, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("compile server: accept");
+            close(sock);
+            return 1; }
+        serveRequest(conn, compile);
+        close(conn); }
+}
+
+}  // namespace Util
@@ -0,0 +1,45 @@
+#ifndef _LIB_COMPILE_SERVER_H_
+#define _LIB_COMPILE_SERVER_H_
+
+#include <functional>
+
+namespace Util {
+
+/**
+ * Runs the compiler as a long-lived server on a Unix socket, enabled with
+ * `--serve <socket>` as the only argument of a compiler that supports it.
+ *
+ * Tools that compile many small programs then pay for process startup, garbage
+ * collector and static IR initialization once, and the caches kept in memory (e.g. the
+ * files read for --precompiled-includes and --frontend-cache) stay warm.  The p4c driver
+ * sends its compiler step to a server with `--server <socket>`.
+ *
+ * A request is the client's standard input, output and error file descriptors, passed
+ * as SCM_RIGHTS ancillary data with the 4-byte big-endian length of the payload, then
+ * the payload: the client's working directory and the compiler arguments, argv[0]
+ * included, each terminated by a NUL.  The reply is the 4-byte big-endian exit status,
+ * or -1 if the server runs another compiler than argv[0], in which case the client
+ * should run the compiler itself.
+ *
+ * Requests are served one at a time, each by a call of the compiler's main function in
+ * the client's directory and with the client's streams.  That function creates the
+ * CompileContext of the compilation, so options and diagnostics do not leak between
+ * requests; the debug specs (-T) and verbosity are reset after each one.  A request that
+ * exits the process (e.g. --help) ends the server, which the client sees as a missing
+ * reply.
+ */
+class CompileServer {
+ public:
+    using Main = std::function<int(int argc, char *const argv[])>;
+
+    /// @return the socket path if @argv asks for a server, otherwise nullptr
+    static const char *socketPath(int argc, char *const argv[]);
+
+    /// Serve compilations with @compile on the Unix socket @path until the process is
+    /// killed.  @return the exit status of the server if it fails to start
+    static int serve(const char *path, const Main &compile);
+};
+
+}  // namespace Util
+
+#endif /* _LIB_COMPILE_SERVER_H_ */
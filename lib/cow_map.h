@@ -0,0 +1,175 @@
+#ifndef _LIB_COW_MAP_H_
+#define _LIB_COW_MAP_H_
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/// A sorted map with unique keys whose copies share storage, meant for the flow state of
+/// ControlFlowVisitors, which is copied by flow_clone at every branch and mostly left
+/// unchanged on each side.
+///
+/// The entries are kept in sorted chunks of up to 2*CHUNK entries, each reference counted.
+/// Copying the map copies only the chunk pointers; the first change to a chunk that is
+/// shared with another copy makes a private copy of that chunk alone.  Because of this,
+/// the entries can't be modified through iterators -- use modify() or operator[] instead.
+/// Inserting or erasing entries invalidates iterators.
+template<class K, class V, class COMP = std::less<K>>
+class cow_map {
+ public:
+    typedef K                   key_type;
+    typedef V                   mapped_type;
+    typedef std::pair<K, V>     value_type;
+    static constexpr size_t CHUNK = 32;
+
+ private:
+    typedef std::vector<value_type>     chunk_t;
+    std::vector<std::shared_ptr<chunk_t>>       chunks;  // none empty; in key order
+    size_t                                      live = 0;
+    COMP                                        comp;
+
+    /// index of the chunk that holds (or would hold) @key
+    size_t chunk_for(const K &key) const {
+        size_t lo = 0, hi = chunks.size();
+        while (hi - lo > 1) {
+            size_t mid = (lo + hi) / 2;
+            if (comp(key, chunks[mid]->front().first))
+                hi = mid;
+            else
+                lo = mid; }
+        return lo; }
+    size_t pos_in(size_t ci, const K &key) const {
+        auto &c = *chunks[ci];
+        return std::lower_bound(c.begin(), c.end(), key,
+            [this](const value_type &a, const K &k) { return comp(a.first, k); }) - c.begin(); }
+    chunk_t &detach(size_t ci) {
+        if (chunks[ci].use_count() > 1)
+            chunks[ci] = std::make_shared<chunk_t>(*chunks[ci]);
+        return *chunks[ci]; }
+
+ public:
+    class const_iterator {
+        friend class cow_map;
+        const cow_map   *map;
+        size_t          ci, pos;
+        const_iterator(const cow_map *map, size_t ci, size_t pos) : map(map), ci(ci), pos(pos) {
+            if (ci < map->chunks.size() && pos >= map->chunks[ci]->size()) {
+                this->ci++;
+                this->pos = 0; } }
+
+     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<K, V>                 value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef const value_type                *pointer;
+        typedef const value_type                &reference;
+        const_iterator() : map(nullptr), ci(0), pos(0) {}
+        reference operator*() const { return (*map->chunks[ci])[pos]; }
+        pointer operator->() const { return &(*map->chunks[ci])[pos]; }
+        const_iterator &operator++() {
+            if (++pos == map->chunks[ci]->size()) {
+                ++ci;
+                pos = 0; }
+            return *this; }
+        const_iterator operator++(int) { const_iterator rv = *this; ++*this; return rv; }
+        const_iterator &operator--() {
+            if (pos-- == 0) pos = map->chunks[--ci]->size() - 1;
+            return *this; }
+        const_iterator operator--(int) { const_iterator rv = *this; --*this; return rv; }
+        bool operator==(const const_iterator &i) const { return ci == i.ci && pos == i.pos; }
+        bool operator!=(const const_iterator &i) const { return !(*this == i); }
+    };
+    typedef const_iterator iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0, 0); }
+    const_iterator end() const { return const_iterator(this, chunks.size(), 0); }
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    void clear() {
+        chunks.clear();
+        live = 0; }
+
+    const_iterator lower_bound(const K &key) const {
+        if (chunks.empty()) return end();
+        size_t ci = chunk_for(key);
+        return const_iterator(this, ci, pos_in(ci, key)); }
+    const_iterator upper_bound(const K &key) const {
+        auto it = lower_bound(key);
+        if (it != end() && !comp(key, it->first)) ++it;
+        return it; }
+    const_iterator find(const K &key) const {
+        auto it = lower_bound(key);
+        return it != end() && !comp(key, it->first) ? it : end(); }
+    size_t count(const K &key) const { return find(key) != end() ? 1 : 0; }
+
+    /// @return the value for @key, or nullptr if it is not present
+    const V *getref(const K &key) const {
+        auto it = find(key);
+        return it != end() ? &it->second : nullptr; }
+
+    /// @return a modifiable reference to the value at @it, unsharing its chunk if needed
+    V &modify(const_iterator it) { return detach(it.ci)[it.pos].second; }
+    /// @return a modifiable pointer to the value for @key, or nullptr if it is not present
+    V *modify(const K &key) {
+        auto it = find(key);
+        return it != end() ? &modify(it) : nullptr; }
+
+    std::pair<const_iterator, bool> emplace(const K &key, const V &value) {
+        if (chunks.empty()) {
+            chunks.push_back(std::make_shared<chunk_t>());
+            chunks.back()->reserve(CHUNK); }
+        size_t ci = chunk_for(key);
+        size_t pos = pos_in(ci, key);
+        if (pos < chunks[ci]->size() && !comp(key, (*chunks[ci])[pos].first))
+            return std::make_pair(const_iterator(this, ci, pos), false);
+        auto &c = detach(ci);
+        c.insert(c.begin() + pos, value_type(key, value));
+        ++live;
+        if (c.size() > 2 * CHUNK) {
+            auto split = std::make_shared<chunk_t>(c.begin() + CHUNK, c.end());
+            c.resize(CHUNK);
+            chunks.insert(chunks.begin() + ci + 1, split);
+            if (pos >= CHUNK) {
+                ++ci;
+                pos -= CHUNK; } }
+        return std::make_pair(const_iterator(this, ci, pos), true); }
+    std::pair<const_iterator, bool> insert(const value_type &v) {
+        return emplace(v.first, v.second); }
+    V &operator[](const K &key) { return modify(emplace(key, V()).first); }
+
+    const_iterator erase(const_iterator it) {
+        size_t ci = it.ci, pos = it.pos;
+        auto &c = detach(ci);
+        c.erase(c.begin() + pos);
+        --live;
+        if (c.empty()) {
+            chunks.erase(chunks.begin() + ci);
+            pos = 0; }
+        return const_iterator(this, ci, pos); }
+    size_t erase(const K &key) {
+        auto it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1; }
+
+    /// Call @fn(it) for each entry of this map, except those in chunks still shared with
+    /// @other, which are known to hold the same entries in both maps.  In a flow_merge
+    /// this skips the state that neither branch changed.
+    template<class Fn> void for_each_unshared(const cow_map &other, Fn fn) {
+        std::unordered_set<const chunk_t *> shared;
+        for (auto &c : other.chunks) shared.insert(c.get());
+        for (size_t ci = 0; ci < chunks.size(); ++ci) {
+            if (shared.count(chunks[ci].get())) continue;
+            for (size_t pos = 0; pos < chunks[ci]->size(); ++pos)
+                fn(const_iterator(this, ci, pos)); } }
+
+    bool operator==(const cow_map &a) const {
+        return live == a.live && std::equal(begin(), end(), a.begin()); }
+    bool operator!=(const cow_map &a) const { return !(*this == a); }
+};
+
+#endif /* _LIB_COW_MAP_H_ */
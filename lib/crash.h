@@ -19,5 +19,9 @@ limitations under the License.
 
 void setup_signals();
 const char *addr2line(void *addr, const char *text);
+#ifdef MULTITHREAD
+// record the calling thread so crash handlers can report which thread failed
+void register_thread();
+#endif  // MULTITHREAD
 
 #endif /* _LIB_CRASH_H_ */
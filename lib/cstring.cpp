@@ -20,115 +20,32 @@ limitations under the License.
 #include <ios>
 #include <string>
 #include <unordered_set>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
 
 #include "hash.h"
 
 namespace {
-enum class table_entry_flags {
-    none,
-    no_need_copy = 1 << 0,
-    require_destruction = 1 << 1,
-    inplace = 1 << 2,
-};
-
-inline table_entry_flags operator &(table_entry_flags l, table_entry_flags r) {
-    return static_cast<table_entry_flags>(static_cast<int>(l) & static_cast<int>(r));
-}
-
-inline table_entry_flags operator |(table_entry_flags l, table_entry_flags r) {
-    return static_cast<table_entry_flags>(static_cast<int>(l) | static_cast<int>(r));
-}
 
-// cache entry, ordered by string length
+// cache entry; the string it refers to is preceded by a cstring::header_t
 class table_entry {
-    std::size_t m_length = 0;
-    table_entry_flags m_flags = table_entry_flags::none;
-
-    union {
-        const char *m_string;
-        char m_inplace_string[sizeof(const char *)];
-    };
+    const char *m_string;
+    std::size_t m_length;
+    std::size_t m_hash;
 
  public:
-    // entry ctor, makes copy of passed string
-    table_entry(const char *string, std::size_t length, table_entry_flags flags)
-        : m_length(length) {
-        if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::no_need_copy) {
-            // No need to copy object, it's view of string, string literal or string allocated
-            // on heap and wrapped with cstring.
-            // Inherit require_destruction flag here, because string can be allready
-            // allocated on heap and wrapped with cstring object, so cstring owns the string now
-
-            m_flags = flags & table_entry_flags::require_destruction;
-            m_string = string;
-            return;
-        }
-
-        if (length < sizeof(const char *)) {
-            // String with length less than size of pointer store directly
-            // in pointer, that hint allows reduce stack fragmentation.
-            // We can make such optimization because std::unordered_set never
-            // moves objects in memory on new element insert
-            std::memcpy(m_inplace_string, string, length);
-            m_inplace_string[length] = '\0';
-            m_flags = table_entry_flags::inplace;
-        } else {
-            // Make copy of string elseware
-            auto copy = new char[length + 1];
-            std::memcpy(copy, string, length);
-            copy[length] = '\0';
-            m_string = copy;
-
-            // destruction required, because we own copy of string
-            m_flags = table_entry_flags::require_destruction;
-        }
-    }
-
-    // table_entry moveable only
-    table_entry(const table_entry &) = delete;
-
-    table_entry(table_entry &&other) : m_length(other.m_length), m_flags(other.m_flags) {
-        // this object for internal usage only, length will never be accessed
-        // if object was moved, so do not zero other.m_length here
-
-        if (is_inplace()) {
-            std::memcpy(m_inplace_string, other.m_inplace_string, sizeof(m_inplace_string));
-        } else {
-            m_string = other.string();
-            other.m_string = nullptr;
-        }
-    }
-
-    ~table_entry() {
-        if ((m_flags & table_entry_flags::require_destruction) ==
-                table_entry_flags::require_destruction) {
-            // null pointer checked in operator delete [], so we don't need
-            // to check it explicitly
-
-            delete [] m_string;
-        }
-    }
-
-    std::size_t length() const {
-        return m_length;
-    }
-
-    const char *string() const {
-        if (is_inplace()) {
-            return m_inplace_string;
-        }
+    table_entry(const char *string, std::size_t length, std::size_t hash)
+        : m_string(string), m_length(length), m_hash(hash) {}
 
-        return m_string;
-    }
+    std::size_t length() const { return m_length; }
+    std::size_t hash() const { return m_hash; }
+    const char *string() const { return m_string; }
 
     bool operator ==(const table_entry &other) const {
         return length() == other.length() && std::memcmp(string(), other.string(), length()) == 0;
     }
-
- private:
-    bool is_inplace() const {
-        return (m_flags & table_entry_flags::inplace) == table_entry_flags::inplace;
-    }
 };
 }  // namespace
 
@@ -136,53 +53,118 @@ namespace std {
 template<>
 struct hash<table_entry> {
     std::size_t operator()(const table_entry &entry) const {
-        return Util::Hash::murmur(entry.string(), entry.length());
+        return entry.hash();
     }
 };
 }
 
 namespace {
-std::unordered_set<table_entry>& cache() {
-    static std::unordered_set<table_entry> g_cache;
 
-    return g_cache;
-}
+/// The intern table is split by hash into shards, each with its own lock and its own
+/// storage for the strings it holds, so that threads interning different strings seldom
+/// wait for each other.  Interned strings are never removed, so the storage is never
+/// released.
+class shard_t {
+    static constexpr std::size_t STORAGE_CHUNK = 16 << 10;
+    static constexpr std::size_t ALIGN = alignof(cstring::header_t);
+    std::vector<char *> chunks;     // keeps the storage reachable
+    char *next = nullptr, *limit = nullptr;
 
-const char *save_to_cache(const char *string, std::size_t length, table_entry_flags flags) {
-    if ((flags & table_entry_flags::no_need_copy) == table_entry_flags::no_need_copy) {
-        return cache().emplace(string, length, flags).first->string();
-    }
+ public:
+#ifdef MULTITHREAD
+    std::mutex lock;
+#endif  // MULTITHREAD
+    std::unordered_set<table_entry> strings;
+
+    /// Copy @length bytes of @string into the shard's storage, after a header and
+    /// followed by a terminating NUL, and return the address of the copy.
+    const char *copy(const char *string, std::size_t length, std::size_t hash) {
+        std::size_t size = (sizeof(cstring::header_t) + length + 1 + ALIGN - 1) & ~(ALIGN - 1);
+        char *block;
+        if (size >= STORAGE_CHUNK / 4) {
+            // long strings get their own chunk, so as not to waste the rest of the current one
+            chunks.push_back(block = new char[size]);
+        } else {
+            if (size > static_cast<std::size_t>(limit - next)) {
+                chunks.push_back(next = new char[STORAGE_CHUNK]);
+                limit = next + STORAGE_CHUNK; }
+            block = next;
+            next += size; }
+        auto *header = reinterpret_cast<cstring::header_t *>(block);
+        header->hash = hash;
+        header->length = length;
+        char *rv = reinterpret_cast<char *>(header + 1);
+        std::memcpy(rv, string, length);
+        rv[length] = '\0';
+        return rv; }
+};
 
-    // temporary table_entry, used for searching only. no need to copy string
-    auto found = cache().find(table_entry(string, length, table_entry_flags::no_need_copy));
+constexpr std::size_t SHARD_BITS = 6;
 
-    if (found == cache().end()) {
-        return cache().emplace(string, length, flags).first->string();
-    }
+shard_t *shards() {
+    static shard_t *g_shards = new shard_t[1 << SHARD_BITS];
+    return g_shards;
+}
 
-    return found->string();
+/// The shard for a string is chosen by the top bits of its hash, as the low bits pick the
+/// bucket within the shard.
+shard_t &shard_for(std::size_t hash) {
+    return shards()[hash >> (sizeof(std::size_t) * 8 - SHARD_BITS)];
+}
+
+const char *save_to_cache(const char *string, std::size_t length) {
+    std::size_t hash = Util::Hash::murmur(string, length);
+    auto &shard = shard_for(hash);
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(shard.lock);
+#endif  // MULTITHREAD
+    auto found = shard.strings.find(table_entry(string, length, hash));
+    if (found != shard.strings.end())
+        return found->string();
+    // every string is copied, even literals, so that all have a header
+    auto copy = shard.copy(string, length, hash);
+    return shard.strings.emplace(copy, length, hash).first->string();
 }
 
 }  // namespace
 
 void cstring::construct_from_shared(const char *string, std::size_t length) {
-    str = save_to_cache(string, length, table_entry_flags::none);
+    str = save_to_cache(string, length);
 }
 
 void cstring::construct_from_unique(const char *string, std::size_t length) {
-    str = save_to_cache(string, length,
-        table_entry_flags::no_need_copy | table_entry_flags::require_destruction);
+    str = save_to_cache(string, length);
+    delete [] string;
 }
 
 void cstring::construct_from_literal(const char *string, std::size_t length) {
-    str = save_to_cache(string, length, table_entry_flags::no_need_copy);
+    str = save_to_cache(string, length);
 }
 
 size_t cstring::cache_size(size_t &count) {
     size_t rv = 0;
-    count = cache().size();
-    for (auto &s : cache())
-        rv += sizeof(s) + s.length();
+    count = 0;
+    for (size_t i = 0; i < (1 << SHARD_BITS); ++i) {
+        auto &shard = shards()[i];
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(shard.lock);
+#endif  // MULTITHREAD
+        count += shard.strings.size();
+        for (auto &s : shard.strings)
+            rv += sizeof(s) + sizeof(header_t) + s.length(); }
+    return rv;
+}
+
+cstring cstring::lookup(const char *string, std::size_t length) {
+    std::size_t hash = Util::Hash::murmur(string, length);
+    auto &shard = shard_for(hash);
+    cstring rv;
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(shard.lock);
+#endif  // MULTITHREAD
+    auto found = shard.strings.find(table_entry(string, length, hash));
+    if (found != shard.strings.end())
+        rv.str = found->string();
     return rv;
 }
 
@@ -209,11 +191,10 @@ cstring cstring::substr(size_t start, size_t length) const {
 }
 
 cstring cstring::replace(char c, char with) const {
-    char* dup = strdup(c_str());
-    for (char* p = dup; *p; ++p)
-        if (*p == c)
-            *p = with;
-    return cstring(dup);
+    if (!find(c)) return *this;
+    std::string s(str, size());
+    std::replace(s.begin(), s.end(), c, with);
+    return cstring(s);
 }
 
 cstring cstring::replace(cstring search, cstring replace) const {
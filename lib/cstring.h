@@ -20,10 +20,12 @@ limitations under the License.
 #include <cstring>
 #include <cstddef>
 
+#include <cstdio>
 #include <functional>
 #include <iomanip>
 #include <string>
 #include <sstream>
+#include <type_traits>
 
 /**
  * A cstring is a reference to a zero-terminated, immutable, interned string.
@@ -51,8 +53,6 @@ limitations under the License.
  *     std::string.
  *   - Interned strings can never be freed, so they'll stick around for the
  *     lifetime of the program.
- *   - The string interning cstring performs is currently not threadsafe, so you
- *     can't safely use cstrings off the main thread.
  *
  * Given these tradeoffs, the general rule of thumb to follow is that you should
  * try to convert strings to cstrings early and keep them in that form. That
@@ -73,6 +73,12 @@ class cstring {
     const char *str = nullptr;
 
  public:
+    /// Every interned string is preceded in memory by its hash and length.
+    struct header_t {
+        std::size_t     hash;
+        std::size_t     length;
+    };
+
     cstring() = default;
     // TODO (DanilLutsenko): Enable when initialization with 0 will be eliminated
     // cstring(std::nullptr_t) {} // NOLINT(runtime/explicit)
@@ -136,6 +142,8 @@ class cstring {
     }
 
  private:
+    const header_t *header() const { return reinterpret_cast<const header_t *>(str) - 1; }
+
     // passed string is shared, we not unique owners
     void construct_from_shared(const char *string, std::size_t length);
 
@@ -159,19 +167,18 @@ class cstring {
     const char *c_str() const { return str; }
     operator const char *() const { return str; }
 
-    // Size tests. Constant time except for size(), which is linear time.
-    size_t size() const {
-        // TODO (DanilLutsenko): We store size of string in table on object construction,
-        // compiler cannot optimize strlen if str not points to string literal.
-        // Probably better fetch size from table or store it to cstring on construction.
-        return str ? strlen(str) : 0;
-    }
+    // Size tests. Constant time.
+    size_t size() const { return str ? header()->length : 0; }
     bool isNull() const { return str == nullptr; }
     bool isNullOrEmpty() const { return str == nullptr ? true : str[0] == 0; }
 
     // iterate over characters
     const char *begin() const { return str; }
-    const char *end() const { return str ? str + strlen(str) : str; }
+    const char *end() const { return str ? str + size() : str; }
+
+    /// A hash of the contents of the string, computed once when it was interned.  Unlike
+    /// the address of the string, it is the same from run to run.
+    size_t hash() const { return str ? header()->hash : 0; }
 
     // Search for characters. Linear time.
     const char *find(int c) const { return str ? strchr(str, c) : nullptr; }
@@ -252,7 +259,25 @@ class cstring {
             if (begin != current) ss << delim;
             ss << *current; }
         return cstring(ss.str()); }
+    /// @return the concatenation of @args (strings, characters and integers), built in one
+    /// buffer and interned once.  Unlike a chain of +=, which interns every intermediate
+    /// string (and keeps it forever), only the result is interned.
+    template<typename... Args> static cstring concat(const Args &... args);
+    /// @return the interned string equal to the @length bytes at @string, or a null
+    /// cstring if there is none; unlike the constructors, this interns nothing.
+    static cstring lookup(const char *string, std::size_t length);
+
+    /// @return the first of @base, @base.0, @base.1, ... (with @sep for '.') that is not in
+    /// the set of cstrings @inuse.  Only the name returned is interned: a candidate that
+    /// is not interned yet cannot be in @inuse, so it is the answer.
     template<class T> static cstring make_unique(const T &inuse, cstring base, char sep = '.');
+    /// Like make_unique above, but starts searching at the candidate number @counter (0 is
+    /// @base itself, 1 is @base.0, ...), and leaves @counter at the one returned.  As
+    /// long as names are only added to @inuse, passing the same @counter on each call for
+    /// the same base gives the same names as the search from the start, in constant
+    /// amortized time.
+    template<class T>
+    static cstring make_unique(const T &inuse, cstring base, int &counter, char sep = '.');
 
     /// @return the total size in bytes of all interned strings. @count is set
     /// to the total number of interned strings.
@@ -289,13 +314,80 @@ inline std::string& operator+=(std::string& a, cstring b) {
     return a; }
 
 template<class T> cstring cstring::make_unique(const T &inuse, cstring base, char sep) {
-    char suffix[12];
-    cstring rv = base;
     int counter = 0;
-    while (inuse.count(rv)) {
-        snprintf(suffix, sizeof(suffix)/sizeof(suffix[0]), "%c%d", sep, counter++);
-        rv = base + suffix; }
-    return rv; }
+    return make_unique(inuse, base, counter, sep); }
+
+template<class T>
+cstring cstring::make_unique(const T &inuse, cstring base, int &counter, char sep) {
+    std::string candidate(base.begin(), base.end());
+    for (;; ++counter) {
+        cstring rv = base;
+        if (counter > 0) {
+            char suffix[16];
+            snprintf(suffix, sizeof(suffix)/sizeof(suffix[0]), "%c%d", sep, counter - 1);
+            candidate.resize(base.size());
+            candidate += suffix;
+            rv = lookup(candidate.data(), candidate.size());
+            if (rv.isNull()) return cstring(candidate); }
+        if (!inuse.count(rv)) return rv; } }
+
+namespace Util {
+namespace Detail {
+/// The pieces cstring::concat can join: their length (at most, for numbers), and how
+/// they are written at @p, returning the end of what was written.
+inline size_t concat_size(cstring s) { return s.size(); }
+inline size_t concat_size(const char *s) { return s ? strlen(s) : 0; }
+inline size_t concat_size(const std::string &s) { return s.size(); }
+inline size_t concat_size(char) { return 1; }
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value, size_t>::type concat_size(T) {
+    return 20; }
+inline char *concat_write(char *p, cstring s) {
+    memcpy(p, s.c_str(), s.size());
+    return p + s.size(); }
+inline char *concat_write(char *p, const char *s) {
+    size_t len = concat_size(s);
+    memcpy(p, s, len);
+    return p + len; }
+inline char *concat_write(char *p, const std::string &s) {
+    memcpy(p, s.data(), s.size());
+    return p + s.size(); }
+inline char *concat_write(char *p, char c) { *p = c; return p + 1; }
+template<typename T> inline char *concat_number(char *p, const char *format, T v) {
+    char digits[24];
+    int len = snprintf(digits, sizeof(digits), format, v);
+    memcpy(p, digits, len);
+    return p + len; }
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value,
+                               char *>::type concat_write(char *p, T v) {
+    return concat_number(p, "%lld", static_cast<long long>(v)); }
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value,
+                               char *>::type concat_write(char *p, T v) {
+    return concat_number(p, "%llu", static_cast<unsigned long long>(v)); }
+
+inline size_t concat_sizes() { return 0; }
+template<typename T, typename... Rest>
+inline size_t concat_sizes(const T &first, const Rest &... rest) {
+    return concat_size(first) + concat_sizes(rest...); }
+inline char *concat_writes(char *p) { return p; }
+template<typename T, typename... Rest>
+inline char *concat_writes(char *p, const T &first, const Rest &... rest) {
+    return concat_writes(concat_write(p, first), rest...); }
+}  // namespace Detail
+}  // namespace Util
+
+template<typename... Args> cstring cstring::concat(const Args &... args) {
+    size_t size = Util::Detail::concat_sizes(args...);
+    char small[256];
+    std::string big;
+    char *buffer = small;
+    if (size > sizeof(small)) {
+        big.resize(size);
+        buffer = &big[0]; }
+    char *end = Util::Detail::concat_writes(buffer, args...);
+    return cstring(buffer, end - buffer); }
 
 inline std::ostream &operator<<(std::ostream &out, cstring s) {
     return out << (s ? s.c_str() : "<null>"); }
@@ -303,10 +395,25 @@ inline std::ostream &operator<<(std::ostream &out, cstring s) {
 namespace std {
 template<> struct hash<cstring> {
     std::size_t operator()(const cstring& c) const {
-        // This implementation is good for cstring, since the strings are internalized
-        return hash<const void *>()(c.c_str());
+        // the precomputed hash of the contents, so unordered containers of cstrings
+        // iterate in the same order on every run
+        return c.hash();
     }
 };
 }  // namespace std
 
+/// Orders cstrings by the address of their interned string, which takes no string
+/// comparison.  Only for containers whose iteration order doesn't matter, as the order
+/// changes from run to run.
+struct cstring_identity_less {
+    bool operator()(cstring a, cstring b) const {
+        return std::less<const char *>()(a.c_str(), b.c_str()); }
+};
+
+/// Hashes cstrings by the address of their interned string.  Only for containers whose
+/// iteration order doesn't matter, as the order changes from run to run.
+struct cstring_identity_hash {
+    std::size_t operator()(cstring c) const { return std::hash<const void *>()(c.c_str()); }
+};
+
 #endif /* _LIB_CSTRING_H_ */
@@ -0,0 +1,121 @@
+#ifndef _LIB_DATAFLOW_H_
+#define _LIB_DATAFLOW_H_
+
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/exceptions.h"
+
+namespace Util {
+
+/**
+ * A forward dataflow analysis over a directed graph, solved with a worklist.
+ *
+ * Subclasses describe the graph with successors() and the lattice of facts with join()
+ * and transfer(); `Fact()` stands for the bottom of the lattice, i.e., the fact at the
+ * entry of a node that is not reached.  solve(entry, initial) computes the least
+ * fixpoint of
+ *
+ *     in(entry) = initial
+ *     in(n)     = join of transfer(p, in(p)) over the predecessors p of n
+ *
+ * Nodes are taken from the worklist in the reverse postorder of a depth-first traversal
+ * from the entry.  When the graph has no cycles this visits each reachable node once, after
+ * all its predecessors; a node is visited again only when the fact at its entry changes.
+ *
+ * Node must be hashable and cheap to copy (typically a pointer to an IR node).
+ */
+template <class Node, class Fact>
+class ForwardDataflow {
+    std::vector<Node>                   nodes;  // in reverse postorder
+    std::unordered_map<Node, unsigned>  index;  // of each node in 'nodes'
+    std::vector<std::vector<unsigned>>  edges;  // successors of each node
+    std::vector<Fact>                   facts;  // at the entry of each node
+    std::vector<bool>                   isReached;
+    unsigned                            transfers = 0;
+
+    /// Number the nodes reachable from @entry in reverse postorder.
+    void number(Node entry) {
+        std::unordered_map<Node, std::vector<Node>> succs;
+        std::vector<Node> postorder;
+        std::vector<std::pair<Node, size_t>> stack;  // node and its next successor
+        succs.emplace(entry, successors(entry));
+        stack.emplace_back(entry, 0);
+        while (!stack.empty()) {
+            Node node = stack.back().first;
+            auto &next = succs.at(node);
+            if (stack.back().second < next.size()) {
+                Node succ = next[stack.back().second++];
+                if (succs.count(succ) == 0) {
+                    auto s = successors(succ);
+                    succs.emplace(succ, std::move(s));
+                    stack.emplace_back(succ, 0); }
+            } else {
+                postorder.push_back(node);
+                stack.pop_back(); } }
+
+        nodes.assign(postorder.rbegin(), postorder.rend());
+        for (unsigned i = 0; i < nodes.size(); i++)
+            index.emplace(nodes[i], i);
+        edges.resize(nodes.size());
+        for (unsigned i = 0; i < nodes.size(); i++)
+            for (auto succ : succs.at(nodes[i]))
+                edges[i].push_back(index.at(succ));
+    }
+
+ protected:
+    /// The nodes with an edge from @node.
+    virtual std::vector<Node> successors(Node node) = 0;
+    /// @returns the fact at the exit of @node given the fact @in at its entry.
+    virtual Fact transfer(Node node, const Fact &in) = 0;
+    /// Join @from into @into, which is `Fact()` if its node was not reached yet.
+    /// @returns true if @into changed.
+    virtual bool join(Fact &into, const Fact &from) = 0;
+
+ public:
+    virtual ~ForwardDataflow() {}
+
+    void solve(Node entry, const Fact &initial) {
+        nodes.clear();
+        index.clear();
+        edges.clear();
+        transfers = 0;
+        number(entry);
+        facts.assign(nodes.size(), Fact());
+        isReached.assign(nodes.size(), false);
+        facts[0] = initial;
+        isReached[0] = true;
+
+        std::set<unsigned> worklist = { 0 };
+        while (!worklist.empty()) {
+            unsigned n = *worklist.begin();
+            worklist.erase(worklist.begin());
+            Fact out = transfer(nodes[n], facts[n]);
+            transfers++;
+            for (auto succ : edges[n]) {
+                if (join(facts[succ], out) || !isReached[succ]) {
+                    isReached[succ] = true;
+                    worklist.insert(succ); } } }
+    }
+
+    /// True if @node is reachable from the entry of the last solve().
+    bool reached(Node node) const {
+        auto it = index.find(node);
+        return it != index.end() && isReached[it->second];
+    }
+    /// The fact at the entry of a reached @node.
+    const Fact &in(Node node) const {
+        BUG_CHECK(reached(node), "node not reached by the dataflow analysis");
+        return facts[index.at(node)];
+    }
+    /// The nodes reachable from the entry, in reverse postorder.
+    const std::vector<Node> &order() const { return nodes; }
+    /// Number of calls of transfer() by the last solve().
+    unsigned visits() const { return transfers; }
+};
+
+}  // namespace Util
+
+#endif /* _LIB_DATAFLOW_H_ */
@@ -25,6 +25,8 @@ limitations under the License.
 #include <stdexcept>
 #include <functional>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
 #include "lib/cstring.h"
 
 namespace Util {
@@ -574,5 +576,196 @@ bool EnumeratorHandle<T>::operator != (const EnumeratorHandle<T>& other) const {
     return this->enumerator->state == EnumeratorState::Valid;
 }
 
+/////////////////////////////////// Enumerable ///////////////////////////////////
+
+/* Allocation-free, non-virtual counterparts of the Enumerator adapters.
+   Util::enumerate(c) wraps a container (anything with begin() and end()) or an
+   Enumerator<T>*, and where(), map(), as<S>() and concat() on it build ranges that hold
+   their input and function by value, so a chain of them compiles into an ordinary loop:
+
+       for (auto *p : Util::enumerate(params->parameters).where(isUsed)) ...
+
+   The rest of the Enumerator interface (count, any, single, next, nextOrDefault,
+   toVector) is there too, but these ranges can be iterated more than once, and next()
+   does not advance anything.  Unlike an Enumerator, map() and as() call their function
+   each time an element is dereferenced (once for each element in a range for, twice
+   for elements passing an enclosing where()), so the function should be cheap and have
+   no side effects.  A range refers to the containers it enumerates, which must outlive
+   it; a range over an Enumerator can be iterated only once, like the Enumerator. */
+
+template <class R, class P> class FilterRange;
+template <class R, class F> class MapRange;
+template <class R1, class R2> class ConcatRange;
+
+namespace Detail {
+template <class S> struct CastTo {
+    template <class T> S operator()(const T &v) const { return dynamic_cast<S>(v); }
+};
+}  // namespace Detail
+
+/* The adapters and queries shared by all ranges; D is the range type */
+template <class D>
+class Enumerable {
+    const D &self() const { return static_cast<const D &>(*this); }
+
+ public:
+    /* Only the elements for which pred(element) is true */
+    template <class P> FilterRange<D, P> where(P pred) const {
+        return FilterRange<D, P>(self(), pred); }
+    /* fn(element) for each element */
+    template <class F> MapRange<D, F> map(F fn) const { return MapRange<D, F>(self(), fn); }
+    /* Each element dynamic_cast to S */
+    template <class S> MapRange<D, Detail::CastTo<S>> as() const {
+        return MapRange<D, Detail::CastTo<S>>(self(), Detail::CastTo<S>()); }
+    /* All elements of this followed by all elements of other */
+    template <class R> ConcatRange<D, R> concat(const R &other) const {
+        return ConcatRange<D, R>(self(), other); }
+
+    uint64_t count() const {
+        uint64_t found = 0;
+        for (auto it = self().begin(), end = self().end(); it != end; ++it)
+            found++;
+        return found; }
+    bool any() const { return self().begin() != self().end(); }
+    template <class DD = D> typename DD::value_type single() const {
+        auto it = self().begin(), end = self().end();
+        if (!(it != end))
+            throw std::logic_error("There is no element for `single()'");
+        typename DD::value_type result = *it;
+        if (++it != end)
+            throw std::logic_error("There are multiple elements when calling `single()'");
+        return result; }
+    template <class DD = D> typename DD::value_type next() const {
+        auto it = self().begin();
+        if (!(it != self().end()))
+            throw std::logic_error("There is no element for `next()'");
+        return *it; }
+    template <class DD = D> typename DD::value_type nextOrDefault() const {
+        auto it = self().begin();
+        if (!(it != self().end()))
+            return typename DD::value_type{};
+        return *it; }
+    template <class DD = D> std::vector<typename DD::value_type> toVector() const {
+        std::vector<typename DD::value_type> result;
+        for (auto it = self().begin(), end = self().end(); it != end; ++it)
+            result.push_back(*it);
+        return result; }
+};
+
+/* The elements between two iterators */
+template <class Iter>
+class IterRange : public Enumerable<IterRange<Iter>> {
+    Iter first, last;
+
+ public:
+    typedef Iter iterator;
+    typedef typename std::decay<decltype(*std::declval<Iter &>())>::type value_type;
+    IterRange(Iter first, Iter last) : first(first), last(last) {}
+    Iter begin() const { return first; }
+    Iter end() const { return last; }
+};
+
+/* The elements of an Enumerator, which can only be iterated once */
+template <class T>
+class EnumeratorRange : public Enumerable<EnumeratorRange<T>> {
+    Enumerator<T> *input;
+
+ public:
+    typedef EnumeratorHandle<T> iterator;
+    typedef T value_type;
+    explicit EnumeratorRange(Enumerator<T> *input) : input(input) {}
+    iterator begin() const { return input->begin(); }
+    iterator end() const { return input->end(); }
+};
+
+template <class C>
+IterRange<decltype(std::declval<const C &>().begin())> enumerate(const C &container) {
+    return IterRange<decltype(container.begin())>(container.begin(), container.end());
+}
+
+template <class Iter>
+IterRange<Iter> enumerate(Iter begin, Iter end) { return IterRange<Iter>(begin, end); }
+
+template <class T>
+EnumeratorRange<T> enumerate(Enumerator<T> *input) { return EnumeratorRange<T>(input); }
+
+template <class R, class P>
+class FilterRange : public Enumerable<FilterRange<R, P>> {
+    R input;
+    P pred;
+
+ public:
+    typedef typename R::value_type value_type;
+    class iterator {
+        typename R::iterator cur, last;
+        const P *pred;
+        void skip() { while (cur != last && !(*pred)(*cur)) ++cur; }
+
+     public:
+        iterator(typename R::iterator cur, typename R::iterator last, const P *pred)
+        : cur(cur), last(last), pred(pred) { skip(); }
+        value_type operator*() const { return *cur; }
+        iterator &operator++() { ++cur; skip(); return *this; }
+        bool operator!=(const iterator &a) const { return cur != a.cur; }
+        bool operator==(const iterator &a) const { return !(cur != a.cur); }
+    };
+    FilterRange(const R &input, P pred) : input(input), pred(pred) {}
+    iterator begin() const { return iterator(input.begin(), input.end(), &pred); }
+    iterator end() const { return iterator(input.end(), input.end(), &pred); }
+};
+
+template <class R, class F>
+class MapRange : public Enumerable<MapRange<R, F>> {
+    R input;
+    F fn;
+
+ public:
+    typedef typename std::decay<decltype(std::declval<const F &>()(
+        std::declval<typename R::value_type>()))>::type value_type;
+    class iterator {
+        typename R::iterator cur;
+        const F *fn;
+
+     public:
+        iterator(typename R::iterator cur, const F *fn) : cur(cur), fn(fn) {}
+        value_type operator*() const { return (*fn)(*cur); }
+        iterator &operator++() { ++cur; return *this; }
+        bool operator!=(const iterator &a) const { return cur != a.cur; }
+        bool operator==(const iterator &a) const { return !(cur != a.cur); }
+    };
+    MapRange(const R &input, F fn) : input(input), fn(fn) {}
+    iterator begin() const { return iterator(input.begin(), &fn); }
+    iterator end() const { return iterator(input.end(), &fn); }
+};
+
+template <class R1, class R2>
+class ConcatRange : public Enumerable<ConcatRange<R1, R2>> {
+    R1 first;
+    R2 second;
+
+ public:
+    typedef typename R1::value_type value_type;
+    class iterator {
+        typename R1::iterator cur1, last1;
+        typename R2::iterator cur2;
+
+     public:
+        iterator(typename R1::iterator cur1, typename R1::iterator last1,
+                 typename R2::iterator cur2) : cur1(cur1), last1(last1), cur2(cur2) {}
+        value_type operator*() const { return cur1 != last1 ? *cur1 : value_type(*cur2); }
+        iterator &operator++() {
+            if (cur1 != last1)
+                ++cur1;
+            else
+                ++cur2;
+            return *this; }
+        bool operator!=(const iterator &a) const { return cur1 != a.cur1 || cur2 != a.cur2; }
+        bool operator==(const iterator &a) const { return !(*this != a); }
+    };
+    ConcatRange(const R1 &first, const R2 &second) : first(first), second(second) {}
+    iterator begin() const { return iterator(first.begin(), first.end(), second.begin()); }
+    iterator end() const { return iterator(first.end(), first.end(), second.end()); }
+};
+
 }  // namespace Util
 #endif  /* _LIB_ENUMERATOR_H_ */
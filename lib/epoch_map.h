@@ -0,0 +1,138 @@
+#ifndef _LIB_EPOCH_MAP_H_
+#define _LIB_EPOCH_MAP_H_
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// A map keyed by pointers, intended for the per-traversal tables of visitors.
+///
+/// The table is open-addressed (linear probing) and each slot is stamped with the epoch
+/// in which it was filled, so clear() is O(1): it just starts a new epoch, and the storage
+/// can be reused for the next traversal without being freed or rewritten.  Values live in
+/// fixed-size chunks that never move, so pointers returned by emplace and find remain
+/// valid until the next clear(), even as other keys are added or erased.
+///
+/// Values must be trivially copyable; keys may not be null.
+template<class K, class V>
+class epoch_map {
+    static_assert(std::is_pointer<K>::value, "epoch_map keys must be pointers");
+    static_assert(std::is_trivially_copyable<V>::value, "epoch_map values must be trivial");
+    static constexpr size_t CHUNK = 256;
+    struct slot_t {
+        K               key;
+        uint32_t        epoch;
+        uint32_t        index;
+    };
+    slot_t              *slots = nullptr;
+    size_t              mask = 0;       // capacity - 1; capacity is a power of 2
+    size_t              count = 0;      // live entries
+    size_t              used = 0;       // entries allocated (live or erased) since clear
+    uint32_t            epoch = 1;
+    std::vector<std::pair<K, V> *>  chunks;
+
+    size_t hash(K key) const {
+        return (reinterpret_cast<uintptr_t>(key) >> 3) * 0x9e3779b97f4a7c15ULL;
+    }
+    std::pair<K, V> &entry(uint32_t index) const { return chunks[index / CHUNK][index % CHUNK]; }
+    void new_epoch() {
+        if (++epoch == 0) {
+            // wrapped around -- old stamps might now look current
+            if (slots) std::memset(static_cast<void *>(slots), 0, (mask + 1) * sizeof(slot_t));
+            epoch = 1; } }
+    slot_t *lookup(K key) const {
+        for (size_t i = hash(key) & mask; ; i = (i + 1) & mask) {
+            slot_t &s = slots[i];
+            if (s.epoch != epoch || s.key == key) return &s; } }
+    void grow() {
+        slot_t *old = slots;
+        size_t old_size = slots ? mask + 1 : 0;
+        size_t size = old_size ? old_size * 2 : 64;
+        slots = new slot_t[size];
+        std::memset(static_cast<void *>(slots), 0, size * sizeof(slot_t));
+        mask = size - 1;
+        uint32_t old_epoch = epoch;
+        epoch = 1;
+        for (size_t i = 0; i < old_size; ++i) {
+            if (old[i].epoch != old_epoch) continue;
+            slot_t *s = lookup(old[i].key);
+            *s = old[i];
+            s->epoch = epoch; }
+        delete [] old; }
+
+ public:
+    epoch_map() = default;
+    epoch_map(const epoch_map &) = delete;
+    epoch_map &operator=(const epoch_map &) = delete;
+    ~epoch_map() {
+        delete [] slots;
+        for (auto *c : chunks) delete [] c; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    /// Insert @key with @value if it is not already present.
+    /// @return the (stable) address of the value for @key, and whether it was inserted
+    std::pair<V *, bool> emplace(K key, const V &value) {
+        if (slots) {
+            slot_t *s = lookup(key);
+            if (s->epoch == epoch) return std::make_pair(&entry(s->index).second, false); }
+        if ((count + 1) * 2 > (slots ? mask + 1 : 0)) grow();
+        slot_t *s = lookup(key);
+        if (used / CHUNK >= chunks.size()) chunks.push_back(new std::pair<K, V>[CHUNK]);
+        s->key = key;
+        s->epoch = epoch;
+        s->index = used;
+        entry(used) = std::make_pair(key, value);
+        ++count;
+        return std::make_pair(&entry(used++).second, true); }
+
+    /// @return the value for @key, or nullptr if it is not present
+    V *find(K key) const {
+        if (!slots) return nullptr;
+        slot_t *s = lookup(key);
+        return s->epoch == epoch ? &entry(s->index).second : nullptr; }
+    size_t count_of(K key) const { return find(key) ? 1 : 0; }
+
+    /// Remove all entries, in constant time; the storage is kept for reuse.
+    void clear() {
+        count = used = 0;
+        new_epoch(); }
+
+    /// Remove all entries and zero the storage, so that the table holds no stale pointers
+    /// (which would keep their targets alive under a conservative collector) while it is
+    /// kept for reuse.  Linear in the storage used, but involves no allocation.
+    void scrub() {
+        if (slots) std::memset(static_cast<void *>(slots), 0, (mask + 1) * sizeof(slot_t));
+        for (size_t i = 0; i < chunks.size() && i * CHUNK < used; ++i)
+            std::memset(static_cast<void *>(chunks[i]), 0, CHUNK * sizeof(std::pair<K, V>));
+        count = used = 0;
+        epoch = 1; }
+
+    /// Remove all entries for which @pred(key, value) is true.  The remaining values stay
+    /// where they are; only the index is rebuilt.
+    template<class Pred> void erase_if(Pred pred) {
+        new_epoch();
+        count = 0;
+        for (size_t i = 0; i < used; ++i) {
+            auto &e = entry(i);
+            if (!e.first) continue;
+            if (pred(e.first, e.second)) {
+                e.first = nullptr;
+                continue; }
+            slot_t *s = lookup(e.first);
+            s->key = e.first;
+            s->epoch = epoch;
+            s->index = i;
+            ++count; } }
+
+    /// Call @fn(key, value) for every entry, in insertion order.
+    template<class Fn> void for_each(Fn fn) const {
+        for (size_t i = 0; i < used; ++i) {
+            auto &e = entry(i);
+            if (e.first) fn(e.first, e.second); } }
+};
+
+#endif /* _LIB_EPOCH_MAP_H_ */
@@ -17,6 +17,7 @@ limitations under the License.
 #include <map>
 #include <string>
 #include "error_catalog.h"
+#include "startup_profile.h"
 
 // -------- Errors -------------
 const int ErrorType::LEGACY_ERROR      =   0;
@@ -62,8 +63,14 @@ const int ErrorType::WARN_UNINITIALIZED_OUT_PARAM  = 1018;
 const int ErrorType::WARN_UNINITIALIZED_USE = 1019;
 const int ErrorType::WARN_MAX_WARNINGS      = 2142;
 
+ErrorCatalog &ErrorCatalog::getCatalog() {
+    static ErrorCatalog *instance = Util::StartupProfile::time("error catalog", [] {
+        return new ErrorCatalog; });
+    return *instance;
+}
+
 // map from errorCode to ErrorSig
-std::map<int, cstring> ErrorCatalog::errorCatalog = {
+ErrorCatalog::ErrorCatalog() : errorCatalog {
     // Errors
     { ErrorType::LEGACY_ERROR,           "legacy"},
     { ErrorType::ERR_UNKNOWN,            "unknown"},
@@ -103,4 +110,4 @@ std::map<int, cstring> ErrorCatalog::errorCatalog = {
     { ErrorType::WARN_UNINITIALIZED_USE, "uninitialized_use"},
     { ErrorType::WARN_UNINITIALIZED_OUT_PARAM,     "uninitialized_out_param"},
     { ErrorType::WARN_IGNORE,            "ignore"}
-};
+} {}
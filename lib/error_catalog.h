@@ -78,11 +78,8 @@ class ErrorType {
 
 class ErrorCatalog {
  public:
-    /// Return the singleton object
-    static ErrorCatalog &getCatalog() {
-        static ErrorCatalog instance;
-        return instance;
-    }
+    /// Return the singleton object, created on first use
+    static ErrorCatalog &getCatalog();
 
     /// add to the catalog
     /// returns false if the code already exists and forceReplace was not set to true
@@ -98,16 +95,17 @@ class ErrorCatalog {
 
     /// retrieve the name for errorCode
     const cstring getName(int errorCode) {
-        if (errorCatalog.count(errorCode))
-            return errorCatalog.at(errorCode);
+        auto it = errorCatalog.find(errorCode);
+        if (it != errorCatalog.end())
+            return it->second;
         return "--unknown--";
     }
 
  private:
-    ErrorCatalog() {}
+    ErrorCatalog();
 
     /// map from errorCode to name
-    static std::map<int, cstring> errorCatalog;
+    std::map<int, cstring> errorCatalog;
 };
 
 #endif  // _LIB_ERROR_CATALOG_H_
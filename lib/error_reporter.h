@@ -17,9 +17,19 @@ limitations under the License.
 #ifndef _LIB_ERROR_REPORTER_H_
 #define _LIB_ERROR_REPORTER_H_
 
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 #include "error_helper.h"
 #include "error_catalog.h"
 #include "exceptions.h"
+#include "hash.h"
 
 /// An action to take when a diagnostic message is triggered.
 enum class DiagnosticAction {
@@ -38,8 +48,18 @@ class ErrorReporter {
  protected:
     std::ostream* outputstream;
 
+    /// Identifies a diagnostic, to report it only once: its code and where it starts (0 if
+    /// it has no position).  Diagnostics starting at the same place are the same.
+    typedef std::pair<int, uint64_t> DiagnosticKey;
+    typedef std::unordered_set<DiagnosticKey, Util::Hash::hash<DiagnosticKey>>
+        DiagnosticTracker;
+    static DiagnosticKey diagnosticKey(int err, const Util::SourceInfo &source) {
+        if (!source.isValid()) return { err, 0 };
+        auto &start = source.getStart();
+        return { err, uint64_t(start.getLineNumber()) << 32 | start.getColumnNumber() }; }
+
     /// Track errors or warnings that have already been issued for a particular source location
-    std::set<std::pair<int, const Util::SourceInfo>> errorTracker;
+    DiagnosticTracker errorTracker;
 
     /// Output the message and flush the stream
     virtual void emit_message(const ErrorMessage &msg) {
@@ -57,16 +77,116 @@ class ErrorReporter {
     /// If the error has been reported, return true. Otherwise, insert add the error to the
     /// list of seen errors, and return false.
     bool error_reported(int err, const Util::SourceInfo source) {
-        auto p = errorTracker.emplace(err, source);
+#ifdef MULTITHREAD
+        std::lock_guard<std::recursive_mutex> acquire(lock());
+#endif  // MULTITHREAD
+        auto key = diagnosticKey(err, source);
+        if (auto deferred = currentDeferred()) {
+            if (errorTracker.count(key) || !deferred->reported.insert(key).second)
+                return true;
+            deferred->pending = true;
+            deferred->pendingKey = key;
+            return false;
+        }
+        auto p = errorTracker.insert(key);
         return !p.second;  // if insertion took place, then we have not seen the error.
     }
 
     /// retrieve the format from the error catalog
-    const char *get_error_name(int errorCode) {
+    cstring get_error_name(int errorCode) {
         return ErrorCatalog::getCatalog().getName(errorCode);
     }
 
+#ifdef MULTITHREAD
+    /// Serializes diagnostics from passes running concurrently on several threads.
+    static std::recursive_mutex &lock() {
+        static std::recursive_mutex diagnostic_lock;
+        return diagnostic_lock; }
+#endif  // MULTITHREAD
+
  public:
+    /// Diagnostics that are written later by emit().  Threads working on parts of a
+    /// program concurrently keep their diagnostics back, so that they can be written in
+    /// the same order whatever the scheduling.  While diagnostics are kept back, the
+    /// counts seen by a thread are those of the reporter plus its own; emit() then
+    /// filters, counts and writes them as if they were reported at that point.
+    class Deferred {
+        struct Entry {
+            ErrorMessage msg;
+            DiagnosticAction action;
+            bool tracked;  // the key below is in the set of reported diagnostics
+            DiagnosticKey key;
+            std::shared_ptr<ParserErrorMessage> parserMsg;  // written instead of msg
+        };
+        std::vector<Entry> messages;
+        DiagnosticTracker reported;
+        unsigned errors = 0;
+        unsigned warnings = 0;
+        bool pending = false;  // error_reported() accepted pendingKey for the next message
+        DiagnosticKey pendingKey;
+        friend class ErrorReporter;
+
+     public:
+        bool empty() const { return messages.empty(); }
+
+        /// While a Scope is alive, the diagnostics reported by the thread that created
+        /// it are kept in a Deferred instead of being written.
+        class Scope {
+            Deferred *outer;
+
+         public:
+            explicit Scope(Deferred &deferred) : outer(currentDeferred()) {
+                currentDeferred() = &deferred; }
+            Scope(const Scope &) = delete;
+            ~Scope() { currentDeferred() = outer; }
+        };
+    };
+
+    /// Write the diagnostics kept in @deferred, in the order they were reported.  If the
+    /// diagnostics of the thread are themselves kept back, they are added to those instead.
+    void emit(Deferred &deferred) {
+#ifdef MULTITHREAD
+        std::lock_guard<std::recursive_mutex> acquire(lock());
+#endif  // MULTITHREAD
+        std::vector<Deferred::Entry> messages;
+        messages.swap(deferred.messages);
+        deferred.reported.clear();
+        deferred.errors = deferred.warnings = 0;
+        if (auto outer = currentDeferred()) {
+            BUG_CHECK(outer != &deferred, "emitting the diagnostics being kept back");
+            for (auto &entry : messages) {
+                if (entry.tracked && (errorTracker.count(entry.key) ||
+                                      !outer->reported.insert(entry.key).second))
+                    continue;
+                if (entry.action == DiagnosticAction::Warn) {
+                    if (getErrorCount() > 0) continue;
+                    outer->warnings++;
+                } else {
+                    outer->errors++;
+                }
+                outer->messages.push_back(std::move(entry));
+            }
+            return;
+        }
+        for (auto &entry : messages) {
+            if (entry.tracked && !errorTracker.insert(entry.key).second)
+                continue;
+            if (entry.action == DiagnosticAction::Warn) {
+                if (errorCount > 0) continue;
+                warningCount++;
+            } else {
+                errorCount++;
+            }
+            if (entry.parserMsg) {
+                emit_message(*entry.parserMsg);
+                continue;
+            }
+            emit_message(entry.msg);
+            if (errorCount >= maxErrorCount)
+                FATAL_ERROR("Number of errors exceeded set maximum of %1%", maxErrorCount);
+        }
+    }
+
     ErrorReporter()
         : errorCount(0),
           warningCount(0),
@@ -95,14 +215,15 @@ class ErrorReporter {
               typename... Args>
     void diagnose(DiagnosticAction action, const int errorCode, const char *format,
                   const char* suffix, const T *node, Args... args) {
-        if (!error_reported(errorCode, node->getSourceInfo())) {
-            const char *name = get_error_name(errorCode);
-            auto da = getDiagnosticAction(name, action);
-            if (name)
-                diagnose(da, name, format, suffix, node, args...);
-            else
-                diagnose(action, nullptr, format, suffix, node, std::forward<Args>(args)...);
-        }
+        // Decide what to do before tracking the position, so that diagnostics that are
+        // ignored (or warnings that would be dropped after errors) cost next to nothing.
+        cstring name = get_error_name(errorCode);
+        auto da = name ? getDiagnosticAction(name, action) : action;
+        if (da == DiagnosticAction::Ignore ||
+            (da == DiagnosticAction::Warn && getErrorCount() > 0))
+            return;
+        if (!error_reported(errorCode, node->getSourceInfo()))
+            diagnose(da, name.c_str(), format, suffix, node, std::forward<Args>(args)...);
     }
 
     template <class T,
@@ -117,12 +238,9 @@ class ErrorReporter {
     template <typename... Args>
     void diagnose(DiagnosticAction action, const int errorCode, const char *format,
                   const char* suffix, Args... args) {
-        const char *name = get_error_name(errorCode);
-        auto da = getDiagnosticAction(name, action);
-        if (name)
-            diagnose(da, name, format, suffix, args...);
-        else
-            diagnose(action, nullptr, format, suffix, std::forward<Args>(args)...);
+        cstring name = get_error_name(errorCode);
+        auto da = name ? getDiagnosticAction(name, action) : action;
+        diagnose(da, name.c_str(), format, suffix, std::forward<Args>(args)...);
     }
 
     /// The sink of all the diagnostic functions. Here the error gets printed
@@ -130,24 +248,36 @@ class ErrorReporter {
     template <typename... T>
     void diagnose(DiagnosticAction action, const char* diagnosticName,
                   const char* format, const char* suffix, T... args) {
+        auto deferred = currentDeferred();
+        bool tracked = deferred && deferred->pending;
+        if (deferred) deferred->pending = false;
         if (action == DiagnosticAction::Ignore) return;
+#ifdef MULTITHREAD
+        std::lock_guard<std::recursive_mutex> acquire(lock());
+#endif  // MULTITHREAD
 
         ErrorMessage::MessageType msgType = ErrorMessage::MessageType::None;
         if (action == DiagnosticAction::Warn) {
             // Avoid burying errors in a pile of warnings: don't emit any more warnings if we've
             // emitted errors.
-            if (errorCount > 0) return;
+            if (getErrorCount() > 0) return;
 
-            warningCount++;
+            (deferred ? deferred->warnings : warningCount)++;
             msgType = ErrorMessage::MessageType::Warning;
         } else if (action == DiagnosticAction::Error) {
-            errorCount++;
+            (deferred ? deferred->errors : errorCount)++;
             msgType = ErrorMessage::MessageType::Error;
         }
 
         boost::format fmt(format);
         ErrorMessage msg(msgType, diagnosticName ? diagnosticName : "", suffix);
         msg = ::error_helper(fmt, msg, args...);
+        if (deferred) {
+            // counted, checked against the maximum and written by emit()
+            deferred->messages.push_back({ msg, action, tracked, deferred->pendingKey,
+                                           nullptr });
+            return;
+        }
         emit_message(msg);
 
         if (errorCount >= maxErrorCount)
@@ -155,7 +285,9 @@ class ErrorReporter {
     }
 
 
-    unsigned getErrorCount() const { return errorCount; }
+    unsigned getErrorCount() const {
+        auto deferred = currentDeferred();
+        return errorCount + (deferred ? deferred->errors : 0); }
 
     unsigned getMaxErrorCount() const { return maxErrorCount; }
     /// set maxErrorCount to a the @newMaxCount threshold and return the previous value
@@ -165,11 +297,13 @@ class ErrorReporter {
         return r;
     }
 
-    unsigned getWarningCount() const { return warningCount; }
+    unsigned getWarningCount() const {
+        auto deferred = currentDeferred();
+        return warningCount + (deferred ? deferred->warnings : 0); }
 
     /// @return the number of diagnostics (warnings and errors) encountered
     /// in the current CompileContext.
-    unsigned getDiagnosticCount() const { return errorCount + warningCount; }
+    unsigned getDiagnosticCount() const { return getErrorCount() + getWarningCount(); }
 
     void setOutputStream(std::ostream* stream) { outputstream = stream; }
 
@@ -179,12 +313,11 @@ class ErrorReporter {
     /// position information provided by Bison.
     template <typename T>
     void parser_error(const Util::SourceInfo& location, const T& message) {
-        errorCount++;
         std::stringstream ss;
         ss << message;
 
         ParserErrorMessage msg(location, ss.str());
-        emit_message(msg);
+        parser_error(msg);
     }
 
     /**
@@ -197,19 +330,34 @@ class ErrorReporter {
         va_list args;
         va_start(args, fmt);
 
-        errorCount++;
-
         Util::SourcePosition position = sources->getCurrentPosition();
         position--;
         cstring message = Util::vprintf_format(fmt, args);
 
         Util::SourceInfo info(sources, position);
         ParserErrorMessage msg(info, message);
-        emit_message(msg);
+        parser_error(msg);
 
         va_end(args);
     }
 
+    /// Count and write a parser error, or keep it back like the other diagnostics, so
+    /// that programs can be parsed on several threads at once.
+    void parser_error(const ParserErrorMessage& msg) {
+        if (auto deferred = currentDeferred()) {
+            deferred->errors++;
+            deferred->messages.push_back({ ErrorMessage(), DiagnosticAction::Error, false,
+                                           DiagnosticKey(),
+                                           std::make_shared<ParserErrorMessage>(msg) });
+            return;
+        }
+#ifdef MULTITHREAD
+        std::lock_guard<std::recursive_mutex> acquire(lock());
+#endif  // MULTITHREAD
+        errorCount++;
+        emit_message(msg);
+    }
+
     /// @return the action to take for the given diagnostic, falling back to the
     /// default action if it wasn't overridden via the command line or a pragma.
     DiagnosticAction
@@ -240,6 +388,11 @@ class ErrorReporter {
     }
 
  private:
+    /// Where the diagnostics of the current thread are kept back, if anywhere.
+    static Deferred *&currentDeferred() {
+        static thread_local Deferred *deferred = nullptr;
+        return deferred; }
+
     unsigned errorCount;
     unsigned warningCount;
     unsigned maxErrorCount;  /// the maximum number of errors that we print before fail
@@ -0,0 +1,135 @@
+#ifndef _LIB_FLAT_MAP_H_
+#define _LIB_FLAT_MAP_H_
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/// A drop-in for std::map (unique keys, iterated in key order) that keeps its entries
+/// sorted in a single vector.  It is meant for the many small maps in the IR: a map of
+/// a few entries costs one allocation rather than one per entry, and lookups in maps of
+/// up to LINEAR entries scan the vector rather than binary searching it.
+///
+/// Unlike std::map, inserting or erasing entries invalidates iterators to later entries,
+/// and the key of value_type is not const (it must not be modified through an iterator).
+template<class K, class V, class COMP = std::less<K>,
+         class ALLOC = std::allocator<std::pair<const K, V>>>
+class flat_map {
+ public:
+    typedef K                           key_type;
+    typedef V                           mapped_type;
+    typedef std::pair<K, V>             value_type;
+    typedef COMP                        key_compare;
+    typedef value_type                  &reference;
+    typedef const value_type            &const_reference;
+    static constexpr size_t LINEAR = 8;
+
+ private:
+    typedef typename std::allocator_traits<ALLOC>::template rebind_alloc<value_type> alloc_t;
+    typedef std::vector<value_type, alloc_t>    vector_type;
+    vector_type         data;
+    COMP                comp;
+
+ public:
+    typedef typename vector_type::iterator                      iterator;
+    typedef typename vector_type::const_iterator                const_iterator;
+    typedef typename vector_type::reverse_iterator              reverse_iterator;
+    typedef typename vector_type::const_reverse_iterator        const_reverse_iterator;
+    typedef typename vector_type::size_type                     size_type;
+
+    flat_map() = default;
+    flat_map(const flat_map &) = default;
+    flat_map(flat_map &&) = default;
+    flat_map(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+    template<class InputIt> flat_map(InputIt b, InputIt e) { insert(b, e); }
+    flat_map &operator=(const flat_map &) = default;
+    flat_map &operator=(flat_map &&) = default;
+
+    iterator begin() noexcept { return data.begin(); }
+    const_iterator begin() const noexcept { return data.begin(); }
+    iterator end() noexcept { return data.end(); }
+    const_iterator end() const noexcept { return data.end(); }
+    reverse_iterator rbegin() noexcept { return data.rbegin(); }
+    const_reverse_iterator rbegin() const noexcept { return data.rbegin(); }
+    reverse_iterator rend() noexcept { return data.rend(); }
+    const_reverse_iterator rend() const noexcept { return data.rend(); }
+
+    bool empty() const noexcept { return data.empty(); }
+    size_type size() const noexcept { return data.size(); }
+    void clear() noexcept { data.clear(); }
+    void reserve(size_type n) { data.reserve(n); }
+    void swap(flat_map &a) { data.swap(a.data); std::swap(comp, a.comp); }
+
+    iterator lower_bound(const K &key) {
+        if (data.size() <= LINEAR) {
+            auto it = data.begin();
+            while (it != data.end() && comp(it->first, key)) ++it;
+            return it; }
+        return std::lower_bound(data.begin(), data.end(), key,
+            [this](const value_type &a, const K &k) { return comp(a.first, k); }); }
+    const_iterator lower_bound(const K &key) const {
+        return const_cast<flat_map *>(this)->lower_bound(key); }
+    iterator upper_bound(const K &key) {
+        auto it = lower_bound(key);
+        return it != data.end() && !comp(key, it->first) ? it + 1 : it; }
+    const_iterator upper_bound(const K &key) const {
+        return const_cast<flat_map *>(this)->upper_bound(key); }
+    iterator find(const K &key) {
+        auto it = lower_bound(key);
+        return it != data.end() && !comp(key, it->first) ? it : data.end(); }
+    const_iterator find(const K &key) const { return const_cast<flat_map *>(this)->find(key); }
+    size_type count(const K &key) const { return find(key) != end() ? 1 : 0; }
+    std::pair<iterator, iterator> equal_range(const K &key) {
+        auto it = lower_bound(key);
+        if (it != data.end() && !comp(key, it->first)) return std::make_pair(it, it + 1);
+        return std::make_pair(it, it); }
+    std::pair<const_iterator, const_iterator> equal_range(const K &key) const {
+        auto r = const_cast<flat_map *>(this)->equal_range(key);
+        return std::make_pair(const_iterator(r.first), const_iterator(r.second)); }
+
+    V &at(const K &key) {
+        auto it = find(key);
+        if (it == data.end()) throw std::out_of_range("flat_map::at");
+        return it->second; }
+    const V &at(const K &key) const { return const_cast<flat_map *>(this)->at(key); }
+    V &operator[](const K &key) {
+        auto it = lower_bound(key);
+        if (it == data.end() || comp(key, it->first))
+            it = data.emplace(it, key, V());
+        return it->second; }
+
+    std::pair<iterator, bool> insert(const value_type &v) {
+        auto it = lower_bound(v.first);
+        if (it != data.end() && !comp(v.first, it->first)) return std::make_pair(it, false);
+        return std::make_pair(data.insert(it, v), true); }
+    std::pair<iterator, bool> insert(value_type &&v) {
+        auto it = lower_bound(v.first);
+        if (it != data.end() && !comp(v.first, it->first)) return std::make_pair(it, false);
+        return std::make_pair(data.insert(it, std::move(v)), true); }
+    template<class InputIt> void insert(InputIt b, InputIt e) {
+        for (; b != e; ++b) insert(value_type(b->first, b->second)); }
+    template<class... Args> std::pair<iterator, bool> emplace(Args &&... args) {
+        return insert(value_type(std::forward<Args>(args)...)); }
+    template<class... Args> iterator emplace_hint(const_iterator, Args &&... args) {
+        return emplace(std::forward<Args>(args)...).first; }
+
+    iterator erase(const_iterator pos) { return data.erase(pos); }
+    iterator erase(iterator pos) { return data.erase(pos); }
+    iterator erase(const_iterator f, const_iterator l) { return data.erase(f, l); }
+    size_type erase(const K &key) {
+        auto it = find(key);
+        if (it == data.end()) return 0;
+        data.erase(it);
+        return 1; }
+
+    bool operator==(const flat_map &a) const { return data == a.data; }
+    bool operator!=(const flat_map &a) const { return data != a.data; }
+    bool operator<(const flat_map &a) const { return data < a.data; }
+};
+
+#endif /* _LIB_FLAT_MAP_H_ */
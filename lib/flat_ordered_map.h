@@ -0,0 +1,114 @@
+#ifndef _LIB_FLAT_ORDERED_MAP_H_
+#define _LIB_FLAT_ORDERED_MAP_H_
+
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include "flat_ordered_table.h"
+
+/// A drop-in alternative to ordered_map for maps that are mostly built and iterated: the
+/// entries are kept in insertion order in one vector and found through an open-addressed
+/// hash index, so there are no per-entry allocations and iteration is a linear scan.
+///
+/// Unlike ordered_map, keys need HASH and EQ rather than an ordering, so there is no
+/// lower_bound/upper_bound, and new entries can only be appended.  Inserting or erasing
+/// entries invalidates iterators and references.  The keys are not const in value_type,
+/// but must not be changed through iterators.
+template<class K, class V, class HASH = std::hash<K>, class EQ = std::equal_to<K>>
+class flat_ordered_map {
+ public:
+    typedef K                           key_type;
+    typedef V                           mapped_type;
+    typedef std::pair<K, V>             value_type;
+    typedef value_type                  &reference;
+    typedef const value_type            &const_reference;
+    typedef size_t                      size_type;
+
+ private:
+    struct keyof {
+        const K &operator()(const value_type &v) const { return v.first; } };
+    typedef flat_ordered_table<K, value_type, keyof, HASH, EQ>  table_type;
+    table_type                          data;
+
+ public:
+    typedef typename table_type::iterator               iterator;
+    typedef typename table_type::const_iterator         const_iterator;
+    typedef std::reverse_iterator<iterator>             reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>       const_reverse_iterator;
+
+    flat_ordered_map() {}
+    flat_ordered_map(const std::initializer_list<value_type> &il) { insert(il.begin(), il.end()); }
+
+    iterator                    begin() { return data.begin(); }
+    const_iterator              begin() const { return data.begin(); }
+    iterator                    end() { return data.end(); }
+    const_iterator              end() const { return data.end(); }
+    reverse_iterator            rbegin() { return reverse_iterator(end()); }
+    const_reverse_iterator      rbegin() const { return const_reverse_iterator(end()); }
+    reverse_iterator            rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator      rend() const { return const_reverse_iterator(begin()); }
+    const_iterator              cbegin() const { return data.begin(); }
+    const_iterator              cend() const { return data.end(); }
+
+    bool        empty() const { return data.empty(); }
+    size_type   size() const { return data.size(); }
+    void        reserve(size_type n) { data.reserve(n); }
+    bool operator==(const flat_ordered_map &a) const { return data == a.data; }
+    bool operator!=(const flat_ordered_map &a) const { return data != a.data; }
+    void clear() { data.clear(); }
+
+    iterator        find(const key_type &a) { return data.find(a); }
+    const_iterator  find(const key_type &a) const { return data.find(a); }
+    size_type       count(const key_type &a) const { return data.count(a); }
+
+    V& operator[](const K &x) {
+        return data.insert_with(x, [&x]() { return value_type(x, V()); }).first->second; }
+    V& at(const K &x) {
+        auto it = find(x);
+        if (it == end()) throw std::out_of_range("flat_ordered_map::at");
+        return it->second; }
+    const V& at(const K &x) const {
+        auto it = find(x);
+        if (it == end()) throw std::out_of_range("flat_ordered_map::at");
+        return it->second; }
+
+    template<typename... VV>
+    std::pair<iterator, bool> emplace(const K &k, VV &&... v) {
+        return data.insert_with(k, [&]() {
+            return value_type(std::piecewise_construct, std::forward_as_tuple(k),
+                              std::forward_as_tuple(std::forward<VV>(v)...)); }); }
+    std::pair<iterator, bool> insert(const value_type &v) {
+        return data.insert_with(v.first, [&v]() { return v; }); }
+    template<class InputIterator> void insert(InputIterator b, InputIterator e) {
+        while (b != e) insert(*b++); }
+
+    iterator erase(const_iterator pos) { return data.erase(pos); }
+    size_type erase(const K &k) { return data.erase(k); }
+
+    template<class Compare> void sort(Compare comp) { data.sort(comp); }
+};
+
+namespace GetImpl {
+
+template<class K, class T, class V, class Hash, class Eq>
+inline V get(const flat_ordered_map<K, V, Hash, Eq> &m, T key, V def = V()) {
+    auto it = m.find(key);
+    if (it != m.end()) return it->second;
+    return def; }
+
+template<class K, class T, class V, class Hash, class Eq>
+inline V *getref(flat_ordered_map<K, V, Hash, Eq> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+template<class K, class T, class V, class Hash, class Eq>
+inline const V *getref(const flat_ordered_map<K, V, Hash, Eq> &m, T key) {
+    auto it = m.find(key);
+    if (it != m.end()) return &it->second;
+    return 0; }
+
+}  // namespace GetImpl
+using namespace GetImpl;  // NOLINT(build/namespaces)
+
+#endif /* _LIB_FLAT_ORDERED_MAP_H_ */
@@ -0,0 +1,67 @@
+#ifndef _LIB_FLAT_ORDERED_SET_H_
+#define _LIB_FLAT_ORDERED_SET_H_
+
+#include <initializer_list>
+#include "flat_ordered_table.h"
+
+/// A drop-in alternative to ordered_set for sets that are mostly built and iterated,
+/// kept like flat_ordered_map: the elements in insertion order in one vector, with an
+/// open-addressed hash index.  There are no sorted iterators or lower/upper_bound, and
+/// inserting or erasing elements invalidates iterators.
+template<class T, class HASH = std::hash<T>, class EQ = std::equal_to<T>>
+class flat_ordered_set {
+ public:
+    typedef T                   key_type;
+    typedef T                   value_type;
+    typedef const T             &reference;
+    typedef const T             &const_reference;
+    typedef size_t              size_type;
+
+ private:
+    struct keyof {
+        const T &operator()(const T &v) const { return v; } };
+    typedef flat_ordered_table<T, T, keyof, HASH, EQ>   table_type;
+    table_type                  data;
+
+ public:
+    // elements can't be modified in place, as that would break the index
+    typedef typename table_type::const_iterator         iterator;
+    typedef typename table_type::const_iterator         const_iterator;
+    typedef std::reverse_iterator<const_iterator>       reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>       const_reverse_iterator;
+
+    flat_ordered_set() {}
+    flat_ordered_set(std::initializer_list<T> init) { insert(init.begin(), init.end()); }
+
+    const_iterator              begin() const { return data.begin(); }
+    const_iterator              end() const { return data.end(); }
+    const_reverse_iterator      rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator      rend() const { return const_reverse_iterator(begin()); }
+    const_iterator              cbegin() const { return data.begin(); }
+    const_iterator              cend() const { return data.end(); }
+    reference front() const { return *begin(); }
+    reference back() const { return *rbegin(); }
+
+    bool        empty() const { return data.empty(); }
+    size_type   size() const { return data.size(); }
+    void        reserve(size_type n) { data.reserve(n); }
+    void        clear() { data.clear(); }
+    bool operator==(const flat_ordered_set &a) const { return data == a.data; }
+    bool operator!=(const flat_ordered_set &a) const { return data != a.data; }
+
+    const_iterator  find(const T &a) const { return data.find(a); }
+    size_type       count(const T &a) const { return data.count(a); }
+
+    std::pair<const_iterator, bool> insert(const T &v) {
+        return data.insert_with(v, [&v]() { return v; }); }
+    template<class InputIterator> void insert(InputIterator b, InputIterator e) {
+        while (b != e) insert(*b++); }
+    void push_back(const T &v) { insert(v); }
+
+    const_iterator erase(const_iterator pos) { return data.erase(pos); }
+    size_type erase(const T &v) { return data.erase(v); }
+
+    template<class Compare> void sort(Compare comp) { data.sort(comp); }
+};
+
+#endif /* _LIB_FLAT_ORDERED_SET_H_ */
@@ -0,0 +1,172 @@
+#ifndef _LIB_FLAT_ORDERED_TABLE_H_
+#define _LIB_FLAT_ORDERED_TABLE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/// The storage shared by flat_ordered_map and flat_ordered_set: the entries in insertion
+/// order in one vector, and an open-addressed (linear probing) hash index of their
+/// positions.  Erasing an entry leaves a dead slot behind so that the other positions stay
+/// put; the vector is compacted once more than half of it is dead.  @KEYOF extracts the
+/// key from an entry.
+template<class K, class E, class KEYOF, class HASH, class EQ>
+class flat_ordered_table {
+    struct slot_t {
+        E               value;
+        size_t          hash;
+        bool            live;
+    };
+    std::vector<slot_t>         slots;
+    std::vector<uint32_t>       index;  // 0 for an empty bucket, else position + 1
+    size_t                      live = 0;
+    HASH                        hasher;
+    EQ                          equal;
+    KEYOF                       keyof;
+
+    size_t bucket(size_t hash) const { return hash & (index.size() - 1); }
+    void index_insert(size_t pos) {
+        size_t b = bucket(slots[pos].hash);
+        while (index[b]) b = bucket(b + 1);
+        index[b] = pos + 1; }
+    /// Remove @pos from the index, moving later entries of its probe sequence back so
+    /// that lookups never need to step over a hole.
+    void index_erase(size_t pos) {
+        size_t b = bucket(slots[pos].hash);
+        while (index[b] != pos + 1) b = bucket(b + 1);
+        index[b] = 0;
+        for (size_t next = bucket(b + 1); index[next]; next = bucket(next + 1)) {
+            size_t home = bucket(slots[index[next] - 1].hash);
+            // leave the entry if its home bucket is cyclically in (b, next]
+            if (b < next ? b < home && home <= next : b < home || home <= next) continue;
+            index[b] = index[next];
+            index[next] = 0;
+            b = next; } }
+    void reindex(size_t capacity) {
+        size_t buckets = 16;
+        while (buckets < 2 * capacity) buckets *= 2;
+        index.assign(buckets, 0);
+        for (size_t pos = 0; pos < slots.size(); ++pos)
+            if (slots[pos].live) index_insert(pos); }
+    void compact() {
+        size_t out = 0;
+        for (size_t pos = 0; pos < slots.size(); ++pos)
+            if (slots[pos].live) {
+                if (out != pos) slots[out] = std::move(slots[pos]);
+                ++out; }
+        slots.resize(out);
+        reindex(out); }
+
+ public:
+    template<class T, class V> class iter {
+        friend class flat_ordered_table;
+        T       *table;
+        size_t  pos;
+        iter(T *table, size_t pos) : table(table), pos(pos) {}
+        void skip() { while (pos < table->slots.size() && !table->slots[pos].live) ++pos; }
+
+     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef E                               value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef V                               *pointer;
+        typedef V                               &reference;
+        iter() : table(nullptr), pos(0) {}
+        template<class T2, class V2> iter(const iter<T2, V2> &i)  // NOLINT(runtime/explicit)
+        : table(i.table), pos(i.pos) {}
+        reference operator*() const { return table->slots[pos].value; }
+        pointer operator->() const { return &table->slots[pos].value; }
+        iter &operator++() { ++pos; skip(); return *this; }
+        iter operator++(int) { iter rv = *this; ++*this; return rv; }
+        iter &operator--() {
+            while (!table->slots[--pos].live) {}
+            return *this; }
+        iter operator--(int) { iter rv = *this; --*this; return rv; }
+        bool operator==(const iter &i) const { return pos == i.pos; }
+        bool operator!=(const iter &i) const { return pos != i.pos; }
+        template<class, class> friend class iter;
+    };
+    typedef iter<flat_ordered_table, E>                 iterator;
+    typedef iter<const flat_ordered_table, const E>     const_iterator;
+
+ private:
+    iterator at_pos(size_t pos) { iterator rv(this, pos); rv.skip(); return rv; }
+    const_iterator at_pos(size_t pos) const {
+        const_iterator rv(this, pos); rv.skip(); return rv; }
+
+ public:
+    iterator begin() { return at_pos(0); }
+    iterator end() { return iterator(this, slots.size()); }
+    const_iterator begin() const { return at_pos(0); }
+    const_iterator end() const { return const_iterator(this, slots.size()); }
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    void clear() {
+        slots.clear();
+        index.clear();
+        live = 0; }
+    void reserve(size_t n) {
+        slots.reserve(n);
+        if (2 * n > index.size()) reindex(n); }
+
+    /// @return the position of the entry for @key, or size of the slot vector if none
+    size_t position(const K &key) const {
+        if (index.empty()) return slots.size();
+        size_t hash = hasher(key);
+        for (size_t b = bucket(hash); index[b]; b = bucket(b + 1)) {
+            auto &slot = slots[index[b] - 1];
+            if (slot.hash == hash && equal(keyof(slot.value), key)) return index[b] - 1; }
+        return slots.size(); }
+    iterator find(const K &key) { return iterator(this, position(key)); }
+    const_iterator find(const K &key) const { return const_iterator(this, position(key)); }
+    size_t count(const K &key) const { return position(key) != slots.size(); }
+
+    /// Append an entry for @key, made by calling @make(), unless there is one already
+    template<class MAKE> std::pair<iterator, bool> insert_with(const K &key, MAKE make) {
+        size_t pos = position(key);
+        if (pos != slots.size()) return std::make_pair(iterator(this, pos), false);
+        size_t hash = hasher(key);
+        slots.push_back(slot_t{ make(), hash, true });
+        ++live;
+        if (2 * slots.size() > index.size())
+            reindex(slots.size());
+        else
+            index_insert(pos);
+        return std::make_pair(iterator(this, pos), true); }
+
+    iterator erase(const_iterator it) {
+        size_t pos = it.pos;
+        index_erase(pos);
+        slots[pos].live = false;
+        slots[pos].value = E();
+        --live;
+        if (slots.size() > 2 * live + 8) {
+            // the next live entry moves down by the number of dead entries before it
+            size_t next = 0;
+            for (size_t i = 0; i < pos; ++i)
+                if (slots[i].live) ++next;
+            compact();
+            pos = next; }
+        return at_pos(pos); }
+    size_t erase(const K &key) {
+        auto it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1; }
+
+    template<class COMP> void sort(COMP comp) {
+        compact();
+        std::stable_sort(slots.begin(), slots.end(), [&comp](const slot_t &a, const slot_t &b) {
+            return comp(a.value, b.value); });
+        reindex(slots.size()); }
+
+    bool operator==(const flat_ordered_table &a) const {
+        return live == a.live && std::equal(begin(), end(), a.begin()); }
+    bool operator!=(const flat_ordered_table &a) const { return !(*this == a); }
+};
+
+#endif /* _LIB_FLAT_ORDERED_TABLE_H_ */
@@ -16,10 +16,15 @@ limitations under the License.
 
 #include "config.h"
 #if HAVE_LIBGC
+#ifdef MULTITHREAD
+#define GC_THREADS
+#endif  // MULTITHREAD
 #include <gc/gc_cpp.h>
 #include <gc/gc_mark.h>
 #endif  /* HAVE_LIBGC */
 #include <unistd.h>
+#include <atomic>
+#include <cstdlib>
 #include <new>
 #include "log.h"
 #include "gc.h"
@@ -39,9 +44,16 @@ static bool done_init, started_init;
 static char emergency_pool[16*1024];
 static char *emergency_ptr;
 
+// counts for gc_allocation_count
+static bool count_allocations;
+static thread_local size_t allocation_count, allocation_bytes;
+
 // One can disable the GC, e.g., to run under Valgrind, by editing config.h
 #if HAVE_LIBGC
 void *operator new(std::size_t size) {
+    if (count_allocations) {
+        ++allocation_count;
+        allocation_bytes += size; }
     /* DANGER -- on OSX, can't safely call the garbage collector allocation
      * routines from a static global constructor without manually initializing
      * it first.  Since we have global constructors that want to allocate
@@ -155,3 +167,113 @@ size_t gc_mem_inuse(size_t *max) {
     return 0;
 #endif
 }
+
+size_t gc_heap_inuse() {
+#if HAVE_LIBGC
+    GC_word heapsize, heapfree;
+    GC_get_heap_usage_safe(&heapsize, &heapfree, 0, 0, 0);
+    return heapsize - heapfree;
+#else
+    return 0;
+#endif
+}
+
+void gc_allow_threads() {
+#if HAVE_LIBGC && defined(MULTITHREAD)
+    GC_allow_register_threads();
+#endif
+}
+
+void gc_register_thread() {
+#if HAVE_LIBGC && defined(MULTITHREAD)
+    struct GC_stack_base sb;
+    GC_get_stack_base(&sb);
+    GC_register_my_thread(&sb);
+#endif
+}
+
+void gc_unregister_thread() {
+#if HAVE_LIBGC && defined(MULTITHREAD)
+    GC_unregister_my_thread();
+#endif
+}
+
+void gc_count_allocations(bool enable) {
+    count_allocations = enable;
+}
+
+size_t gc_allocation_count(size_t *bytes) {
+    if (bytes) *bytes = allocation_bytes;
+    return allocation_count;
+}
+
+void *gc_alloc_root(size_t size) {
+#if HAVE_LIBGC
+    void *rv = GC_MALLOC_UNCOLLECTABLE(size);
+#else
+    void *rv = std::malloc(size);
+#endif
+    if (!rv) throw backtrace_exception<std::bad_alloc>();
+    return rv;
+}
+
+void gc_free_root(void *p) {
+#if HAVE_LIBGC
+    GC_FREE(p);
+#else
+    std::free(p);
+#endif
+}
+
+// While passes run the heap may grow by its own size before an automatic collection (the
+// libgc default is a third), and at the end of a pass at depth d it is collected if the
+// allocations since the last collection reach heap_size / pass_collect_divisor[d].
+static bool pass_policy;
+#if HAVE_LIBGC
+static const unsigned pass_free_space_divisor = 1;
+static const unsigned pass_collect_divisor[] = { 8, 8, 4, 2 };
+static GC_word saved_free_space_divisor;
+// the passes running on all threads, and their nesting depth on this one
+static std::atomic<unsigned> passes_running(0);
+static thread_local unsigned pass_depth;
+#endif  /* HAVE_LIBGC */
+
+void gc_pass_policy(bool enable) {
+    pass_policy = enable;
+}
+
+bool gc_pass_policy_enabled() {
+    return pass_policy;
+}
+
+gc_pass_scope::gc_pass_scope() : active(pass_policy) {
+#if HAVE_LIBGC
+    if (!active) return;
+    ++pass_depth;
+    if (passes_running++ == 0) {
+        saved_free_space_divisor = GC_get_free_space_divisor();
+        GC_set_free_space_divisor(pass_free_space_divisor); }
+#endif  /* HAVE_LIBGC */
+}
+
+gc_pass_scope::~gc_pass_scope() {
+#if HAVE_LIBGC
+    if (!active) return;
+    --pass_depth;
+    if (--passes_running == 0) GC_set_free_space_divisor(saved_free_space_divisor);
+#endif  /* HAVE_LIBGC */
+}
+
+void gc_pass_scope::finished() {
+#if HAVE_LIBGC
+    if (!active) return;
+    const size_t levels = sizeof(pass_collect_divisor) / sizeof(pass_collect_divisor[0]);
+    unsigned divisor = pass_collect_divisor[pass_depth < levels ? pass_depth : levels - 1];
+    size_t allocated = GC_get_bytes_since_gc();
+    if (allocated < GC_get_heap_size() / divisor) return;
+    if (gc_logging_level >= 1)
+        std::clog << "****** GC between passes ****** (" << n4(allocated)
+                  << " allocated since the last)" << std::endl;
+    GC_gcollect();
+#endif  /* HAVE_LIBGC */
+}
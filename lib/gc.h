@@ -21,5 +21,46 @@ limitations under the License.
 
 void setup_gc_logging();
 size_t gc_mem_inuse(size_t *max = 0);  // trigger GC, return inuse after
+size_t gc_heap_inuse();                 // heap in use (including garbage), without a GC
+
+// Threads other than the main thread must register with the collector before they touch
+// the GC heap.  gc_allow_threads must be called from the main thread before any other
+// thread is started.  All are no-ops unless built with both libgc and MULTITHREAD.
+void gc_allow_threads();
+void gc_register_thread();
+void gc_unregister_thread();
+
+// Memory that is scanned for pointers by the collector but never collected; it must be
+// freed explicitly.  Plain malloc/free when built without libgc.
+void *gc_alloc_root(size_t size);
+void gc_free_root(void *p);
+
+// Count the allocations made with operator new, per thread.  Only counted when built with
+// libgc, which replaces operator new.
+void gc_count_allocations(bool enable);
+size_t gc_allocation_count(size_t *bytes = 0);  // by the calling thread, so far
+
+// A collection policy for compilations run as a sequence of passes, enabled with
+// gc_pass_policy(true).  Within a pass most of the heap is live, so collecting there
+// finds little garbage; instead the heap may grow further before an automatic collection,
+// and gc_pass_scope collects at the end of a pass once enough was allocated that the IR
+// the pass replaced is likely garbage.  The threshold is lower between the outer passes
+// (front end, mid end, back end), which each leave a whole generation of IR behind, than
+// between the short inner ones.  No-op without libgc.
+void gc_pass_policy(bool enable);
+bool gc_pass_policy_enabled();
+
+// Brackets running one pass, for the collection policy above.
+class gc_pass_scope {
+    bool active;
+
+ public:
+    gc_pass_scope();
+    ~gc_pass_scope();
+    gc_pass_scope(const gc_pass_scope &) = delete;
+    gc_pass_scope &operator=(const gc_pass_scope &) = delete;
+    // The pass finished and its result replaced its input; collect if it is worth it.
+    void finished();
+};
 
 #endif /* LIB_GC_H_ */
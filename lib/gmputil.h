@@ -19,10 +19,17 @@ limitations under the License.
 
 #include "config.h"
 
-#if HAVE_LIBGMP
+/* With P4C_INLINE_BIG_INT (the ENABLE_INLINE_BIG_INT build option), big_int is a boost
+ * cpp_int even if GMP is available.  A cpp_int holds values of up to 128 bits inline and
+ * does arithmetic on them with machine words, only going to heap storage for wider values,
+ * whereas every mpz_int is heap allocated.  Most constants in P4 programs are small, so
+ * this makes constant folding and the backends' constant handling cheaper. */
+#if HAVE_LIBGMP && !P4C_INLINE_BIG_INT
+#define BIG_INT_IS_MPZ 1
 #include <boost/multiprecision/gmp.hpp>
 typedef boost::multiprecision::mpz_int big_int;
 #else
+#define BIG_INT_IS_MPZ 0
 #include <boost/multiprecision/cpp_int.hpp>
 typedef boost::multiprecision::cpp_int big_int;
 #endif
@@ -50,7 +57,7 @@ big_int shift_right(const big_int &v, unsigned bits);
 big_int maskFromSlice(unsigned m, unsigned l);
 big_int mask(unsigned bits);
 
-#if HAVE_LIBGMP
+#if BIG_INT_IS_MPZ
 inline unsigned scan0(const boost::multiprecision::mpz_int &val, unsigned pos) {
     return mpz_scan0(val.backend().data(), pos); }
 inline unsigned scan1(const boost::multiprecision::mpz_int &val, unsigned pos) {
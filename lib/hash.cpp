@@ -139,5 +139,86 @@ struct murmur<sizeof(std::uint64_t)> {
 std::size_t murmur(const void *data, std::size_t size) {
     return Detail::murmur<>::hash(data, size);
 }
+
+namespace Detail {
+static const std::uint64_t wyp[4] = {
+    UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9),
+    UINT64_C(0x4b33a62ed433d4a3), UINT64_C(0x4d5a2da51de1aa47) };
+
+static inline void wymum(std::uint64_t *a, std::uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = *a;
+    r *= *b;
+    *a = static_cast<std::uint64_t>(r);
+    *b = static_cast<std::uint64_t>(r >> 64);
+#else
+    std::uint64_t ha = *a >> 32, hb = *b >> 32, la = *a & 0xffffffff, lb = *b & 0xffffffff;
+    std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    std::uint64_t t = rl + (rm0 << 32), c = t < rl;
+    std::uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline std::uint64_t wyr8(const unsigned char *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline std::uint64_t wyr4(const unsigned char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline std::uint64_t wyr3(const unsigned char *p, std::size_t k) {
+    return (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[k >> 1]) << 8) | p[k - 1];
+}
+}  // namespace Detail
+
+std::size_t wyhash(const void *data, std::size_t size, std::uint64_t seed) {
+    using namespace Detail;
+    auto p = static_cast<const unsigned char *>(data);
+    seed ^= wymix(seed ^ wyp[0], wyp[1]);
+    std::uint64_t a, b;
+    if (size <= 16) {
+        if (size >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((size >> 3) << 2));
+            b = (wyr4(p + size - 4) << 32) | wyr4(p + size - 4 - ((size >> 3) << 2));
+        } else if (size > 0) {
+            a = wyr3(p, size);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        std::size_t i = size;
+        if (i >= 48) {
+            std::uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp[0] ^ size, b ^ wyp[1]);
+}
 }  // namespace Hash
 }  // namespace Util
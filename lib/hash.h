@@ -2,7 +2,11 @@
 #define _LIB_HASH_H_
 
 #include <cstddef>
+#include <cstdint>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace Util {
 namespace Hash {
@@ -37,6 +41,97 @@ auto murmur(const T& obj, typename std::enable_if<
     -> decltype(murmur(reinterpret_cast<const void *>(&obj), sizeof(T))) {
     return murmur(reinterpret_cast<const void *>(&obj), sizeof(T));
 }
+
+/// wyhash (final version 4): much faster than fnv1a and murmur on all but the shortest
+/// inputs, and as well distributed.  The result depends on the byte order of the host, so
+/// it is only for hashing values in memory, not for anything written out.
+std::size_t wyhash(const void *data, std::size_t size, std::uint64_t seed = 0);
+
+// returns wyhash sum for object with public methods size() and data()
+template<typename T>
+auto wyhash(const T& obj) -> decltype(wyhash(obj.data(), obj.size())) {
+    return wyhash(obj.data(), obj.size());
+}
+
+namespace Detail {
+/// The 64-bit halves of the 128-bit product of @a and @b, xored together.
+inline std::uint64_t wymix(std::uint64_t a, std::uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = a;
+    r *= b;
+    return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#else
+    std::uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xffffffff, lb = b & 0xffffffff;
+    std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    std::uint64_t t = rl + (rm0 << 32), c = t < rl;
+    std::uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+}  // namespace Detail
+
+/// Hash of a 64-bit value; every bit of the result depends on every bit of @v.
+inline std::size_t mix(std::uint64_t v) {
+    return Detail::wymix(v ^ UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9));
+}
+
+/// The hash of a sequence of values whose hashes are @seed (the values so far) and @h.
+/// Unlike xor or addition, the order matters.
+inline std::size_t hash_combine(std::size_t seed, std::size_t h) {
+    return Detail::wymix(seed ^ UINT64_C(0x4b33a62ed433d4a3), h ^ UINT64_C(0x4d5a2da51de1aa47));
+}
+
+/**
+ * Util::Hash::hash<T> hashes a T.  It is defined for integers, enums, pointers (by
+ * address), std::string, std::pair and std::vector of hashable types, and for any class
+ * with a `size_t hash() const` method (such as cstring); anything else falls back to
+ * std::hash<T>.  Specialize it to hash other types.
+ */
+template<class T, class Enable = void> struct hash : std::hash<T> {};
+
+template<class T> struct hash<T, typename std::enable_if<std::is_integral<T>::value ||
+                                                          std::is_enum<T>::value>::type> {
+    std::size_t operator()(T v) const { return mix(static_cast<std::uint64_t>(v)); }
+};
+
+template<class T> struct hash<T *> {
+    std::size_t operator()(const T *p) const { return mix(reinterpret_cast<std::uintptr_t>(p)); }
+};
+
+namespace Detail {
+template<class T> struct void_type { typedef void type; };
+}  // namespace Detail
+
+template<class T> struct hash<T, typename Detail::void_type<
+        decltype(static_cast<std::size_t>(std::declval<const T &>().hash()))>::type> {
+    std::size_t operator()(const T &v) const { return v.hash(); }
+};
+
+template<> struct hash<std::string> {
+    std::size_t operator()(const std::string &s) const { return wyhash(s.data(), s.size()); }
+};
+
+template<class A, class B> struct hash<std::pair<A, B>> {
+    std::size_t operator()(const std::pair<A, B> &p) const {
+        return hash_combine(hash<A>()(p.first), hash<B>()(p.second)); }
+};
+
+template<class T, class ALLOC> struct hash<std::vector<T, ALLOC>> {
+    std::size_t operator()(const std::vector<T, ALLOC> &v) const {
+        std::size_t rv = mix(v.size());
+        for (auto &el : v) rv = hash_combine(rv, hash<T>()(el));
+        return rv; }
+};
+
+/// The combined hash of a sequence of values, e.g. the fields of a structure.
+inline std::size_t hash_values() { return 0; }
+template<class T, class... REST>
+std::size_t hash_values(const T &v, const REST &... rest) {
+    return hash_combine(hash<T>()(v), hash_values(rest...));
+}
+
 }  // namespace Hash
 }  // namespace Util
 
@@ -17,7 +17,7 @@ limitations under the License.
 #include <stdexcept>
 #include <sstream>
 #include "json.h"
-#include "indent.h"
+#include "json_writer.h"
 #include "lib/gmputil.h"
 
 namespace Util {
@@ -113,32 +113,7 @@ bool JsonValue::operator==(const JsonValue& other) const {
 }
 
 void JsonArray::serialize(std::ostream& out) const {
-    bool isSmall = true;
-    for (auto v : *this) {
-        if (!v->is<JsonValue>())
-            isSmall = false;
-    }
-    out << "[";
-    if (!isSmall)
-        out << IndentCtl::indent;
-    bool first = true;
-    for (auto v : *this) {
-        if (!first) {
-            out << ",";
-            if (isSmall)
-                out << " ";
-        }
-        if (!isSmall)
-            out << IndentCtl::endl;
-        if (v == nullptr)
-            out << "null";
-        else
-            v->serialize(out);
-        first = false;
-    }
-    if (!isSmall)
-        out << IndentCtl::unindent << IndentCtl::endl;
-    out << "]";
+    JsonWriter(out).value(this);
 }
 
 bool JsonValue::getBool() const {
@@ -172,20 +147,19 @@ JsonArray* JsonArray::append(IJson* value) {
 }
 
 void JsonObject::serialize(std::ostream& out) const {
-    out << "{" << IndentCtl::indent;
-    bool first = true;
-    for (auto &it : *this) {
-        if (!first)
-            out << ",";
-        first = false;
-        out << IndentCtl::endl;
-        out << "\"" << it.first << "\"" << " : ";
-        if (it.second == nullptr)
-            out << "null";
-        else
-            it.second->serialize(out);
-    }
-    out << IndentCtl::unindent << IndentCtl::endl << "}";
+    JsonWriter(out).value(this);
+}
+
+JsonText::JsonText(const IJson* json) {
+    if (json == nullptr)
+        throw std::logic_error("Null JSON text");
+    std::stringstream str;
+    JsonWriter(str).value(json);
+    text = str.str();
+}
+
+void JsonText::serialize(std::ostream& out) const {
+    JsonWriter(out).value(this);
 }
 
 JsonObject* JsonObject::emplace(cstring label, IJson* value) {
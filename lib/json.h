@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <type_traits>
 
@@ -154,6 +155,17 @@ class JsonObject final : public IJson, public ordered_map<cstring, IJson*> {
     IJson* get(cstring label) const { return ::get(*this, label); }
 };
 
+/// A finished JSON object or array kept as its text rather than as a tree, which takes a
+/// fraction of the memory.  It is written the same as the tree would be, at any depth.
+class JsonText final : public IJson {
+    std::string text;  // written at indentation 0
+
+ public:
+    explicit JsonText(const IJson* json);
+    void serialize(std::ostream& out) const;
+    const std::string& getText() const { return text; }
+};
+
 }  // namespace Util
 
 #endif  /* _LIB_JSON_H_ */
@@ -0,0 +1,263 @@
+#include "json_binary.h"
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "json.h"
+
+namespace Util {
+
+namespace {
+
+enum Tag : unsigned char { Null, False, True, Integer, String, BigNumber, Array, Object };
+
+const char magic[4] = { 'P', '4', 'J', 'B' };
+
+void varint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7; }
+    out.push_back(static_cast<char>(v));
+}
+
+void fixed(std::string &out, uint64_t v, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; ++i, v >>= 8)
+        out.push_back(static_cast<char>(v & 0xff));
+}
+
+/// Reads values from a buffer, checking that they stay in it.
+class Decoder {
+    const std::string &data;
+    size_t pos = 0;
+    std::vector<cstring> strings;
+
+    void need(size_t bytes) const {
+        if (data.size() - pos < bytes)
+            throw std::runtime_error("Truncated binary JSON"); }
+    uint64_t fixed(unsigned bytes) {
+        need(bytes);
+        uint64_t v = 0;
+        for (unsigned i = 0; i < bytes; ++i)
+            v |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos++])) << (8 * i);
+        return v; }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            need(1);
+            auto byte = static_cast<unsigned char>(data[pos++]);
+            v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return v; }
+        throw std::runtime_error("Malformed varint in binary JSON"); }
+    cstring string() { return string(varint()); }
+    cstring string(uint64_t i) {
+        if (i >= strings.size())
+            throw std::runtime_error("Bad string index in binary JSON");
+        return strings[i]; }
+
+    IJson *value() {
+        need(1);
+        switch (static_cast<unsigned char>(data[pos++])) {
+        case Null: return new JsonValue();
+        case False: return new JsonValue(false);
+        case True: return new JsonValue(true);
+        case Integer: {
+            auto zigzag = varint();
+            auto v = static_cast<long long>(zigzag >> 1) ^ -static_cast<long long>(zigzag & 1);
+            return new JsonValue(v); }
+        case String: return new JsonValue(string());
+        case BigNumber: return new JsonValue(big_int(string().c_str()));
+        case Array: {
+            auto array = new JsonArray();
+            for (auto count = varint(); count > 0; --count)
+                array->append(value());
+            return array; }
+        case Object: {
+            auto object = new JsonObject();
+            for (auto count = varint(); count > 0; --count) {
+                auto key = string();
+                object->emplace(key, value()); }
+            return object; }
+        default:
+            throw std::runtime_error("Bad tag in binary JSON"); } }
+
+ public:
+    explicit Decoder(const std::string &data) : data(data) {}
+    JsonObject *document() {
+        need(sizeof(magic));
+        if (memcmp(data.data(), magic, sizeof(magic)) != 0)
+            throw std::runtime_error("Not a binary JSON file");
+        pos += sizeof(magic);
+        if (fixed(4) != JsonBinary::version)
+            throw std::runtime_error("Unsupported binary JSON version");
+        for (auto count = fixed(4); count > 0; --count) {
+            auto length = fixed(4);
+            need(length + 1);
+            strings.push_back(cstring(data.substr(pos, length)));
+            pos += length + 1; }
+        auto toplevel = new JsonObject();
+        for (auto count = fixed(4); count > 0; --count) {
+            auto name = string(fixed(4));
+            auto length = fixed(8);
+            need(length);
+            auto end = pos + length;
+            toplevel->emplace(name, value());
+            if (pos != end)
+                throw std::runtime_error("Bad section length in binary JSON"); }
+        return toplevel; }
+};
+
+}  // namespace
+
+uint32_t JsonBinary::intern(const std::string &s) {
+    auto it = index.emplace(s, strings.size());
+    if (it.second)
+        strings.push_back(&it.first->first);
+    return it.first->second;
+}
+
+void JsonBinary::number(std::string &out, const std::string &digits) {
+    big_int v(digits);
+    if (v >= std::numeric_limits<long long>::min() && v <= std::numeric_limits<long long>::max()) {
+        auto n = static_cast<long long>(v);
+        out.push_back(Integer);
+        varint(out, (static_cast<uint64_t>(n) << 1) ^ static_cast<uint64_t>(n >> 63));
+    } else {
+        out.push_back(BigNumber);
+        varint(out, intern(digits)); }
+}
+
+void JsonBinary::str(std::string &out, const std::string &s) {
+    out.push_back(String);
+    varint(out, intern(s));
+}
+
+void JsonBinary::value(std::string &out, const IJson *json) {
+    if (json == nullptr) {
+        out.push_back(Null);
+    } else if (auto v = json->to<JsonValue>()) {
+        if (v->isNull())
+            out.push_back(Null);
+        else if (v->isBool())
+            out.push_back(v->getBool() ? True : False);
+        else if (v->isNumber())
+            number(out, v->getValue().str());
+        else
+            str(out, v->getString().c_str());
+    } else if (auto array = json->to<JsonArray>()) {
+        out.push_back(Array);
+        varint(out, array->size());
+        for (auto element : *array)
+            value(out, element);
+    } else if (auto object = json->to<JsonObject>()) {
+        out.push_back(Object);
+        varint(out, object->size());
+        for (auto &member : *object) {
+            varint(out, intern(member.first.c_str()));
+            value(out, member.second); }
+    } else if (auto t = json->to<JsonText>()) {
+        size_t pos = 0;
+        text(out, t->getText(), pos);
+    } else {
+        throw std::logic_error("Unexpected JSON node in binary encoding");
+    }
+}
+
+/// Encodes the JSON at @pos in @json, as written by JsonWriter, and moves past it.
+void JsonBinary::text(std::string &out, const std::string &json, size_t &pos) {
+    auto skip = [&]() { while (pos < json.size() && isspace(json[pos])) ++pos; };
+    auto fail = [&]() -> void { throw std::logic_error("Malformed JSON text"); };
+    auto quoted = [&]() {
+        std::string s;
+        for (++pos; pos < json.size() && json[pos] != '"'; ++pos) {
+            // Strings are written without escaping, so they are copied as they are.
+            if (json[pos] == '\\' && pos + 1 < json.size()) s.push_back(json[pos++]);
+            s.push_back(json[pos]); }
+        if (pos == json.size()) fail();
+        ++pos;
+        return s; };
+    // A container is encoded after its elements have been counted.
+    auto container = [&](char close, bool object) {
+        std::string elements;
+        size_t count = 0;
+        ++pos;
+        for (skip(); pos < json.size() && json[pos] != close; skip()) {
+            if (count > 0) {
+                if (json[pos] != ',') fail();
+                ++pos;
+                skip(); }
+            if (object) {
+                if (pos == json.size() || json[pos] != '"') fail();
+                varint(elements, intern(quoted()));
+                skip();
+                if (pos == json.size() || json[pos] != ':') fail();
+                ++pos;
+                skip(); }
+            text(elements, json, pos);
+            ++count; }
+        if (pos == json.size()) fail();
+        ++pos;
+        out.push_back(object ? Object : Array);
+        varint(out, count);
+        out += elements; };
+
+    skip();
+    if (pos == json.size()) fail();
+    char c = json[pos];
+    if (c == '{') {
+        container('}', true);
+    } else if (c == '[') {
+        container(']', false);
+    } else if (c == '"') {
+        str(out, quoted());
+    } else if (json.compare(pos, 4, "null") == 0) {
+        out.push_back(Null);
+        pos += 4;
+    } else if (json.compare(pos, 4, "true") == 0) {
+        out.push_back(True);
+        pos += 4;
+    } else if (json.compare(pos, 5, "false") == 0) {
+        out.push_back(False);
+        pos += 5;
+    } else if (c == '-' || isdigit(c)) {
+        size_t start = pos++;
+        while (pos < json.size() && isdigit(json[pos])) ++pos;
+        number(out, json.substr(start, pos - start));
+    } else {
+        fail();
+    }
+}
+
+void JsonBinary::write(std::ostream &out, const JsonObject *toplevel) {
+    JsonBinary encoder;
+    std::vector<std::pair<uint32_t, std::string>> sections;
+    for (auto &member : *toplevel) {
+        sections.emplace_back(encoder.intern(member.first.c_str()), std::string());
+        encoder.value(sections.back().second, member.second); }
+
+    std::string header(magic, sizeof(magic));
+    fixed(header, version, 4);
+    fixed(header, encoder.strings.size(), 4);
+    for (auto s : encoder.strings) {
+        fixed(header, s->size(), 4);
+        header += *s;
+        header.push_back(0); }
+    fixed(header, sections.size(), 4);
+    out.write(header.data(), header.size());
+    for (auto &section : sections) {
+        std::string prefix;
+        fixed(prefix, section.first, 4);
+        fixed(prefix, section.second.size(), 8);
+        out.write(prefix.data(), prefix.size());
+        out.write(section.second.data(), section.second.size()); }
+}
+
+JsonObject *JsonBinary::read(std::istream &in) {
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return Decoder(data).document();
+}
+
+}  // namespace Util
@@ -0,0 +1,56 @@
+#ifndef _LIB_JSON_BINARY_H_
+#define _LIB_JSON_BINARY_H_
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Util {
+
+class IJson;
+class JsonObject;
+
+/**
+ * A compact binary encoding of a JSON document whose top level is an object, such as a
+ * BMv2 configuration.  The members of the top-level object are written as sections
+ * that can be found (and skipped) without decoding them, and all the strings, keys
+ * included, are kept once in a string table in front of them:
+ *
+ *     file     := "P4JB" version:u32 strings sections
+ *     strings  := count:u32 { length:u32 byte[length] 0 }
+ *     sections := count:u32 { name:u32 length:u64 value }
+ *     value    := 0                                     null
+ *               | 1 | 2                                 false, true
+ *               | 3 zigzag:varint                       number that fits in 64 bits
+ *               | 4 string:varint                       string
+ *               | 5 string:varint                       other number, in decimal
+ *               | 6 count:varint value*                 array
+ *               | 7 count:varint { key:varint value }*  object
+ *
+ * Fixed-size integers are little-endian, varints are LEB128 and strings are referred to
+ * by their index in the table.  JsonText pieces are encoded as the trees they stand for.
+ */
+class JsonBinary {
+    std::unordered_map<std::string, uint32_t>   index;
+    std::vector<const std::string *>            strings;
+
+    uint32_t intern(const std::string &s);
+    void str(std::string &out, const std::string &s);
+    void value(std::string &out, const IJson *json);
+    void text(std::string &out, const std::string &json, size_t &pos);
+    void number(std::string &out, const std::string &digits);
+
+ public:
+    static constexpr uint32_t version = 1;
+
+    /// Write @toplevel to @out.
+    static void write(std::ostream &out, const JsonObject *toplevel);
+    /// Read a document written by write(); throws std::runtime_error if it is malformed.
+    static JsonObject *read(std::istream &in);
+};
+
+}  // namespace Util
+
+#endif /* _LIB_JSON_BINARY_H_ */
@@ -0,0 +1,175 @@
+#include "json_writer.h"
+
+#include <sstream>
+#include <stdexcept>
+
+#include "indent.h"
+#include "json.h"
+
+namespace Util {
+
+JsonWriter::JsonWriter(std::ostream &out) : out(out) {
+    // continue at the indentation that IndentCtl is using for the stream
+    std::ostringstream base;
+    base << indent_t::getindent(out);
+    newline = "\n" + base.str();
+    buffer.reserve(BUFFER_SIZE);
+}
+
+JsonWriter::~JsonWriter() {
+    flush();
+}
+
+size_t JsonWriter::indent_size() {
+    return indent_t::tabsz;
+}
+
+void JsonWriter::flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+void JsonWriter::separate() {
+    if (stack.empty()) return;
+    auto &frame = stack.back();
+    if (frame.object) {
+        if (!have_key)
+            throw std::logic_error("JSON object member without a key");
+        have_key = false;
+        return; }
+    if (!frame.first) write(',');
+    frame.first = false;
+    endl();
+}
+
+void JsonWriter::unhold() {
+    auto &frame = stack.back();
+    frame.oneline = false;
+    write('[');
+    indent();
+    for (auto &text : frame.held) {
+        if (!frame.first) write(',');
+        frame.first = false;
+        endl();
+        write(text); }
+    frame.held.clear();
+}
+
+void JsonWriter::scalar(const std::string &text) {
+    if (!stack.empty() && stack.back().oneline) {
+        stack.back().held.push_back(text);
+        return; }
+    separate();
+    write(text);
+}
+
+JsonWriter &JsonWriter::value(const char *s) {
+    std::string text = "\"";
+    text += s ? s : "";
+    text += "\"";
+    scalar(text);
+    return *this;
+}
+
+JsonWriter &JsonWriter::begin_object() {
+    if (!stack.empty() && stack.back().oneline) unhold();
+    separate();
+    write('{');
+    indent();
+    stack.emplace_back(true, false);
+    return *this;
+}
+
+JsonWriter &JsonWriter::end_object() {
+    if (stack.empty() || !stack.back().object || have_key)
+        throw std::logic_error("Unbalanced JSON object");
+    stack.pop_back();
+    unindent();
+    endl();
+    write('}');
+    return *this;
+}
+
+JsonWriter &JsonWriter::begin_array() {
+    if (!stack.empty() && stack.back().oneline) unhold();
+    separate();
+    stack.emplace_back(false, true);  // '[' is written by end_array() or unhold()
+    return *this;
+}
+
+JsonWriter &JsonWriter::end_array() {
+    if (stack.empty() || stack.back().object)
+        throw std::logic_error("Unbalanced JSON array");
+    auto &frame = stack.back();
+    if (frame.oneline) {
+        write('[');
+        for (size_t i = 0; i < frame.held.size(); ++i) {
+            if (i) write(", ", 2);
+            write(frame.held[i]); }
+        write(']');
+    } else {
+        unindent();
+        endl();
+        write(']'); }
+    stack.pop_back();
+    return *this;
+}
+
+JsonWriter &JsonWriter::key(cstring name) {
+    if (stack.empty() || !stack.back().object || have_key)
+        throw std::logic_error("JSON key outside of an object member");
+    auto &frame = stack.back();
+    if (!frame.first) write(',');
+    frame.first = false;
+    endl();
+    write('"');
+    write(name.c_str(), name.size());
+    write("\" : ", 4);
+    have_key = true;
+    return *this;
+}
+
+JsonWriter &JsonWriter::value(const IJson *json) {
+    if (json == nullptr) return null();
+    if (auto *v = json->to<JsonValue>()) {
+        if (v->isString()) return value(v->getString());
+        if (v->isNumber()) return value(v->getValue());
+        if (v->isBool()) return value(v->getBool());
+        return null();
+    } else if (auto *array = json->to<JsonArray>()) {
+        begin_array();
+        // IJson::serialize() only writes arrays of JsonValues on one line
+        for (auto *elem : *array)
+            if (elem == nullptr) {
+                unhold();
+                break; }
+        for (auto *elem : *array) value(elem);
+        return end_array();
+    } else if (auto *object = json->to<JsonObject>()) {
+        begin_object();
+        for (auto &member : *object) {
+            key(member.first);
+            value(member.second); }
+        return end_object();
+    } else if (auto *text = json->to<JsonText>()) {
+        if (!stack.empty() && stack.back().oneline) unhold();
+        separate();
+        // re-indent the text to the current depth
+        auto &s = text->getText();
+        size_t start = 0, end;
+        while ((end = s.find('\n', start)) != std::string::npos) {
+            write(s.data() + start, end - start);
+            endl();
+            start = end + 1; }
+        write(s.data() + start, s.size() - start);
+        return *this;
+    }
+    // some other kind of IJson; it can only write itself
+    if (!stack.empty() && stack.back().oneline) unhold();
+    separate();
+    cstring text = json->toString();
+    write(text.c_str(), text.size());
+    return *this;
+}
+
+}  // namespace Util
@@ -0,0 +1,98 @@
+#ifndef _LIB_JSON_WRITER_H_
+#define _LIB_JSON_WRITER_H_
+
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "lib/cstring.h"
+#include "lib/gmputil.h"
+
+namespace Util {
+
+class IJson;
+
+/**
+ * Writes JSON to a stream as it is produced, without building a tree of IJson nodes:
+ *
+ *     JsonWriter w(out);
+ *     w.begin_object();
+ *     w.key("name").value("x");
+ *     w.key("fields").begin_array().value(1).value(2).end_array();
+ *     w.end_object();
+ *
+ * The text is the same as IJson::serialize() would write for the equivalent tree, and
+ * value(const IJson *) writes an existing tree (or a piece of one) in the middle of a
+ * stream.  Output is collected in a buffer and written to the stream in large chunks;
+ * flush() writes it out early, and the destructor writes whatever is left.
+ *
+ * Like IJson::serialize(), arrays of scalars only are written on one line.  So that this
+ * can be decided without lookahead, the scalars of the innermost open array are held
+ * back until the array either ends or gets a nested object or array.
+ */
+class JsonWriter {
+    struct frame_t {
+        bool                            object;
+        bool                            first = true;
+        bool                            oneline;  // array of scalars (so far)
+        std::vector<std::string>        held;     // held-back scalars of a one-line array
+        frame_t(bool object, bool oneline) : object(object), oneline(oneline) {}
+    };
+    std::ostream                &out;
+    std::string                 buffer;
+    std::string                 newline;  // newline followed by the stream's indentation
+    std::vector<frame_t>        stack;
+    bool                        have_key = false;
+
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+    void write(const char *s, size_t len) {
+        buffer.append(s, len);
+        if (buffer.size() >= BUFFER_SIZE) flush(); }
+    void write(const std::string &s) { write(s.data(), s.size()); }
+    void write(char c) {
+        buffer.push_back(c);
+        if (buffer.size() >= BUFFER_SIZE) flush(); }
+    void endl() { write(newline); }
+    void indent() { newline.append(indent_size(), ' '); }
+    void unindent() { newline.resize(newline.size() - indent_size()); }
+    static size_t indent_size();
+
+    void separate();         // write what goes in front of the next value
+    void unhold();           // switch the innermost array from one line to one per line
+    void scalar(const std::string &text);
+    void tree(const IJson *json);
+
+ public:
+    explicit JsonWriter(std::ostream &out);
+    JsonWriter(const JsonWriter &) = delete;
+    ~JsonWriter();
+
+    JsonWriter &begin_object();
+    JsonWriter &end_object();
+    JsonWriter &begin_array();
+    JsonWriter &end_array();
+    /// Start a member of the current object; must be followed by one value or container.
+    JsonWriter &key(cstring name);
+
+    JsonWriter &value(bool b) { scalar(b ? "true" : "false"); return *this; }
+    JsonWriter &value(const big_int &v) { scalar(v.str()); return *this; }
+    template<typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                 !std::is_same<T, bool>::value, int>::type = 0>
+    JsonWriter &value(T v) { scalar(std::to_string(v)); return *this; }
+    /// Like JsonValue, floating point values are written as integers.
+    JsonWriter &value(double v) { return value(big_int(v)); }
+    JsonWriter &value(cstring s) { return value(s.c_str()); }
+    JsonWriter &value(const std::string &s) { return value(s.c_str()); }
+    JsonWriter &value(const char *s);
+    JsonWriter &null() { scalar("null"); return *this; }
+    /// Write an existing tree; nullptr is written as null.
+    JsonWriter &value(const IJson *json);
+
+    /// Write the buffered text to the stream.
+    void flush();
+};
+
+}  // namespace Util
+
+#endif /* _LIB_JSON_WRITER_H_ */
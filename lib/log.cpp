@@ -29,12 +29,17 @@ limitations under the License.
 #include <sstream>
 #include <iomanip>
 #include <memory>
+#include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #ifdef MULTITHREAD
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #endif  // MULTITHREAD
+#include "gc.h"
 
 namespace Log {
 namespace Detail {
@@ -97,39 +102,228 @@ struct OutputLogPrefix::lock_t {
 };
 #endif  // MULTITHREAD
 
+// Whether the prefixes of the log records show the time, and the file and level.
+static bool prefixTime() {
+#ifdef CLOCK_MONOTONIC
+    return LOGGING(2);
+#else
+    return false;
+#endif
+}
+static bool prefixFile() { return LOGGING(1); }
+
+// The milliseconds since logging was initialized.
+static uint64_t logTime() {
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec*1000000000UL + ts.tv_nsec - initTime) / 1000000UL;
+#else
+    return 0;
+#endif
+}
+
+static void writePrefix(std::ostream &out, const char *fn, int level, bool time, bool file,
+                        uint64_t t) {
+    if (time)
+        out << t/1000 << '.' << std::setw(3) << std::setfill('0') << t%1000 << ':'
+            << std::setfill(' ');
+    if (file) {
+        const char *s = strrchr(fn, '/');
+        const char *e = strrchr(fn, '.');
+        s = s ? s + 1 : fn;
+        if (e && e > s)
+            out.write(s, e-s);
+        else
+            out << s;
+        out << ':' << level << ':'; }
+}
+
+// Asynchronous logging (see Log::setAsync).  Each thread logs to a buffer of its own for
+// each output; a record goes to the committed text at the end of the LOG statement, when
+// its OutputLogPrefix is destroyed, and the committed text is written out in batches.
+// The prefixes are kept aside as marks, and only formatted when the text is written out.
+struct AsyncLogBuffer : public std::streambuf {
+    struct Mark {
+        size_t          offset;         // in the text
+        const char      *file;          // null for the padding of a continuation line
+        int             level;
+        bool            time, showFile;
+        uint64_t        t;
+    };
+    std::ostream                &out;
+    std::thread::id             owner;
+    std::ostream                stream;
+    std::string                 record;
+    std::vector<Mark>           recordMarks;
+#ifdef MULTITHREAD
+    std::mutex                  lock;           // of text and marks
+#endif  // MULTITHREAD
+    std::string                 text;
+    std::vector<Mark>           marks;
+    int                         prefixWidth = 0;    // of the last prefix written out
+
+    explicit AsyncLogBuffer(std::ostream &out)
+    : out(out), owner(std::this_thread::get_id()), stream(this) {}
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            record.push_back(traits_type::to_char_type(c));
+        return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        record.append(s, n);
+        return n; }
+    void mark(const char *file, int level) {
+        bool time = prefixTime();
+        recordMarks.push_back({ record.size(), file, level, time, file && prefixFile(),
+                                time ? logTime() : 0 }); }
+    void commit();
+    bool writeOut();
+};
+
+static bool asyncLogging = false;
+static const size_t asyncBatchSize = 1 << 20;
+// Every AsyncLogBuffer, so that they can be written out.
+static std::vector<AsyncLogBuffer *> asyncBuffers;
+#ifdef MULTITHREAD
+static std::mutex asyncBuffersLock;         // of asyncBuffers and the writer state
+static std::mutex asyncWriteLock;           // held while writing the buffers out
+static std::condition_variable asyncWake;
+static bool asyncFull = false, asyncStop = false;
+static std::thread asyncWriter;
+#endif  // MULTITHREAD
+
+// Write out the committed text of every buffer, then flush each output once.
+static void writeOutAsync() {
+    std::vector<AsyncLogBuffer *> buffers;
+    {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(asyncBuffersLock);
+#endif  // MULTITHREAD
+        buffers = asyncBuffers;
+    }
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> write(asyncWriteLock);
+#endif  // MULTITHREAD
+    std::set<std::ostream *> outputs;
+    for (auto *buffer : buffers)
+        if (buffer->writeOut())
+            outputs.insert(&buffer->out);
+    for (auto *out : outputs)
+        out->flush();
+}
+
+#ifdef MULTITHREAD
+// Writes the buffers out when one is full, and at least every 100ms.
+static void asyncWriterLoop() {
+    gc_register_thread();
+    std::unique_lock<std::mutex> acquire(asyncBuffersLock);
+    while (!asyncStop) {
+        asyncWake.wait_for(acquire, std::chrono::milliseconds(100),
+                           []() { return asyncStop || asyncFull; });
+        asyncFull = false;
+        acquire.unlock();
+        writeOutAsync();
+        acquire.lock(); }
+    acquire.unlock();
+    gc_unregister_thread();
+}
+#endif  // MULTITHREAD
+
+void AsyncLogBuffer::commit() {
+    bool full;
+    {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        for (auto &m : recordMarks) {
+            m.offset += text.size();
+            marks.push_back(m); }
+        text += record;
+        full = text.size() >= asyncBatchSize;
+    }
+    record.clear();
+    recordMarks.clear();
+    if (!full) return;
+#ifdef MULTITHREAD
+    {
+        std::lock_guard<std::mutex> acquire(asyncBuffersLock);
+        asyncFull = true;
+    }
+    asyncWake.notify_one();
+#else
+    writeOutAsync();
+#endif  // MULTITHREAD
+}
+
+bool AsyncLogBuffer::writeOut() {
+    std::string t;
+    std::vector<Mark> m;
+    {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+        t.swap(text);
+        m.swap(marks);
+    }
+    if (t.empty()) return false;
+    size_t done = 0;
+    for (auto &mark : m) {
+        out.write(t.data() + done, mark.offset - done);
+        done = mark.offset;
+        if (mark.file) {
+            std::stringstream tmp;
+            writePrefix(tmp, mark.file, mark.level, mark.time, mark.showFile, mark.t);
+            prefixWidth = tmp.str().size();
+            out << tmp.str();
+        } else if (prefixWidth) {
+            out << std::setw(prefixWidth) << ':'; } }
+    out.write(t.data() + done, t.size() - done);
+    return true;
+}
+
+// The stream of the calling thread for the records to @out.
+static std::ostream &asyncLogStream(std::ostream &out) {
+    // nearly all the records of a thread go to the same output
+    static thread_local AsyncLogBuffer *last = nullptr;
+    if (last && &last->out == &out) return last->stream;
+    auto self = std::this_thread::get_id();
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(asyncBuffersLock);
+#endif  // MULTITHREAD
+    for (auto *buffer : asyncBuffers)
+        if (buffer->owner == self && &buffer->out == &out)
+            return (last = buffer)->stream;
+    last = new NOGC_ARGS AsyncLogBuffer(out);
+    asyncBuffers.push_back(last);
+    return last->stream;
+}
+
 OutputLogPrefix::~OutputLogPrefix() {
 #ifdef MULTITHREAD
     if (lock) lock->unlock();
 #endif  // MULTITHREAD
+    if (async) async->commit();
 }
 
 void OutputLogPrefix::indent(std::ostream &out) {
-    setup_ostream_xalloc(out);
-    if (int pfx = out.iword(ostream_xalloc))
-        out << std::setw(pfx) << ':';
+    if (auto *async = dynamic_cast<AsyncLogBuffer *>(out.rdbuf())) {
+        async->mark(nullptr, 0);
+    } else {
+        setup_ostream_xalloc(out);
+        if (int pfx = out.iword(ostream_xalloc))
+            out << std::setw(pfx) << ':'; }
     out << indent_t::getindent(out);
 }
 
 std::ostream& operator<<(std::ostream& out, const OutputLogPrefix& pfx) {
+    if (auto *async = dynamic_cast<AsyncLogBuffer *>(out.rdbuf())) {
+        async->mark(pfx.fn, pfx.level);
+        pfx.async = async;
+        out << indent_t::getindent(out);
+        return out; }
     std::stringstream tmp;
-#ifdef CLOCK_MONOTONIC
-    if (LOGGING(2)) {
-        struct timespec ts;
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-        uint64_t t = ts.tv_sec*1000000000UL + ts.tv_nsec - Log::Detail::initTime;
-        t /= 1000000UL;  // millisec
-        tmp << t/1000 << '.' << std::setw(3) << std::setfill('0') << t%1000 << ':'
-            << std::setfill(' '); }
-#endif
-    if (LOGGING(1)) {
-        const char *s = strrchr(pfx.fn, '/');
-        const char *e = strrchr(pfx.fn, '.');
-        s = s ? s + 1 : pfx.fn;
-        if (e && e > s)
-            tmp.write(s, e-s);
-        else
-            tmp << s;
-        tmp << ':' << pfx.level << ':'; }
+    bool time = prefixTime();
+    writePrefix(tmp, pfx.fn, pfx.level, time, prefixFile(), time ? logTime() : 0);
     pfx.setup_ostream_xalloc(out);
 #ifdef MULTITHREAD
     if (!(pfx.lock = static_cast<OutputLogPrefix::lock_t *>(out.pword(pfx.ostream_xalloc)))) {
@@ -264,13 +458,40 @@ std::ostream &fileLogOutput(const char* file) {
 #endif  // MULTITHREAD
         if (!info->out) {
             info->out = &uncachedFileLogOutput(file); } }
-    return *info->out;
+    return asyncLogging ? asyncLogStream(*info->out) : *info->out;
+}
+
+// The FileLogLevelCaches that hold a level, so that they can be reset.
+static std::vector<FileLogLevelCache *> &callSiteCaches() {
+    static std::vector<FileLogLevelCache *> caches;
+    return caches; }
+#ifdef MULTITHREAD
+static std::mutex callSiteCachesLock;
+#endif  // MULTITHREAD
+
+int FileLogLevelCache::refresh(const char *file) {
+    int rv = fileLogLevel(file);
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(callSiteCachesLock);
+#endif  // MULTITHREAD
+    if (!registered) {
+        callSiteCaches().push_back(this);
+        registered = true; }
+    level.store(rv, std::memory_order_relaxed);
+    return rv;
 }
 
 void invalidateCaches(int possibleNewMaxLogLevel) {
     mostRecentFile = nullptr;
     mostRecentInfo = nullptr;
     logLevelCache.clear();
+    {
+#ifdef MULTITHREAD
+        std::lock_guard<std::mutex> acquire(callSiteCachesLock);
+#endif  // MULTITHREAD
+        for (auto *cache : callSiteCaches())
+            cache->level.store(-1, std::memory_order_relaxed);
+    }
     maximumLogLevel = std::max(maximumLogLevel, possibleNewMaxLogLevel);
     for (auto fn : invalidateCallbacks) fn();
 }
@@ -330,4 +551,47 @@ void increaseVerbosity() {
     Detail::invalidateCaches(Detail::verbosity - 1);
 }
 
+void resetDebugSpecs() {
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+    Detail::debugSpecs.clear();
+    Detail::verbosity = 0;
+    flushAsync();
+    for (auto &logfile : Detail::logfiles) logfile.second->flush();
+    Detail::invalidateCaches(0);
+}
+
+void setAsync(bool async) {
+    if (async == Detail::asyncLogging) return;
+    if (async) {
+        static bool stopAtExit = false;
+        if (!stopAtExit) {
+            atexit([]() { setAsync(false); });
+            stopAtExit = true; }
+#ifdef MULTITHREAD
+        gc_allow_threads();
+        Detail::asyncStop = false;
+        Detail::asyncWriter = std::thread(Detail::asyncWriterLoop);
+#endif  // MULTITHREAD
+        Detail::asyncLogging = true;
+    } else {
+        Detail::asyncLogging = false;
+#ifdef MULTITHREAD
+        {
+            std::lock_guard<std::mutex> acquire(Detail::asyncBuffersLock);
+            Detail::asyncStop = true;
+        }
+        Detail::asyncWake.notify_one();
+        Detail::asyncWriter.join();
+#endif  // MULTITHREAD
+        Detail::writeOutAsync(); }
+}
+
+void flushAsync() {
+    if (Detail::asyncLogging)
+        Detail::writeOutAsync();
+}
+
 }  // namespace Log
@@ -17,6 +17,7 @@ limitations under the License.
 #ifndef _LIB_LOG_H_
 #define _LIB_LOG_H_
 
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <set>
@@ -41,6 +42,24 @@ extern int maximumLogLevel;
 int fileLogLevel(const char* file);
 std::ostream &fileLogOutput(const char *file);
 
+// The log level of one file, cached in a function-local static at each LOGGING() call site
+// so that checking it is a single load.  It is constant-initialized, so there is no guard
+// for the static either.  Reset when the debug specs or the verbosity change.
+class FileLogLevelCache {
+    std::atomic<int>    level;
+    bool                registered;
+    int refresh(const char *file);
+    friend void invalidateCaches(int);
+
+ public:
+    constexpr FileLogLevelCache() : level(-1), registered(false) {}
+    int get(const char *file) {
+        int rv = level.load(std::memory_order_relaxed);
+        return rv >= 0 ? rv : refresh(file); }
+};
+
+struct AsyncLogBuffer;
+
 // A utility class used to prepend file and log level information to logging output.
 // also controls indent control and locking for multithreaded use
 class OutputLogPrefix {
@@ -53,6 +72,7 @@ class OutputLogPrefix {
     struct lock_t;
     mutable lock_t *lock = nullptr;
 #endif  // MULTITHREAD
+    mutable AsyncLogBuffer *async = nullptr;  // the record ends with the prefix
  public:
     OutputLogPrefix(const char* f, int l) : fn(f), level(l) {}
     ~OutputLogPrefix();
@@ -84,6 +104,19 @@ inline bool verbose() { return Detail::verbosity > 0; }
 inline int verbosity() { return Detail::verbosity; }
 void increaseVerbosity();
 
+// Forget all debug specs and the verbosity, e.g. between the compilations of a compile
+// server.  Log files that were opened stay open.
+void resetDebugSpecs();
+
+// Keep the log records of each thread in a buffer instead of writing and flushing each one
+// when it is logged, and write them out in batches (from a background thread when built
+// with MULTITHREAD), formatting their prefixes only then.  The records that different
+// threads log to the same output may be written out of order.  Must not be called while
+// other threads are logging.
+void setAsync(bool async);
+// Write out the records kept by asynchronous logging.
+void flushAsync();
+
 }  // namespace Log
 
 #ifndef MAX_LOGGING_LEVEL
@@ -91,7 +124,12 @@ void increaseVerbosity();
 #define MAX_LOGGING_LEVEL 10
 #endif
 
-#define LOGGING(N) ((N) <= MAX_LOGGING_LEVEL && ::Log::fileLogLevelIsAtLeast(__FILE__, N))
+// Levels above MAX_LOGGING_LEVEL are compiled out entirely; otherwise, unless any file
+// logs at level N, the check is one load and compare of maximumLogLevel.
+#define LOGGING(N) ((N) <= MAX_LOGGING_LEVEL && ::Log::Detail::maximumLogLevel >= (N) &&     \
+                    []() -> int {                                                       \
+                        static ::Log::Detail::FileLogLevelCache cache;                  \
+                        return cache.get(__FILE__); }() >= (N))
 #define LOGN(N, X) (LOGGING(N)                                                  \
                       ? ::Log::Detail::fileLogOutput(__FILE__)                  \
                           << ::Log::Detail::OutputLogPrefix(__FILE__, N)        \
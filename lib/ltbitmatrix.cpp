@@ -0,0 +1,40 @@
+#include "ltbitmatrix.h"
+#include <vector>
+#include "thread_pool.h"
+
+namespace {
+
+/* Merge into reached[r] the closures of the rows c in [from, to) that rows[r] points
+ * at directly.  Those rows must be closed already.  Going down from the highest c means
+ * that most rows reached through another one are skipped, as everything they reach is
+ * already in the set. */
+void close_row(std::vector<bitvec> &rows, unsigned r, unsigned from, unsigned to,
+               bitvec &reached) {
+    for (auto c = --rows[r][to]; c.index() >= static_cast<int>(from); --c)
+        if (!reached[c.index()])
+            reached |= rows[c.index()];
+}
+
+}  // namespace
+
+void LTBitMatrix::transitive_closure() {
+    static const unsigned BLOCK = 256, CHUNK = 32;
+    unsigned n = size();
+    std::vector<bitvec> rows(n);
+    for (unsigned r = 0; r < n; r++)
+        rows[r] = operator[](r);
+    for (unsigned lo = 0; lo < n; lo += BLOCK) {
+        unsigned hi = std::min(n, lo + BLOCK);
+        std::vector<bitvec> reached(hi - lo);
+        // The rows before this block are closed, so merging them in is independent for
+        // each row of the block.
+        Util::ThreadPool::global().parallel_for((hi - lo + CHUNK - 1) / CHUNK, [&](size_t i) {
+            unsigned end = std::min(hi, static_cast<unsigned>(lo + (i + 1) * CHUNK));
+            for (unsigned r = lo + i * CHUNK; r < end; r++)
+                close_row(rows, r, 0, lo, reached[r - lo]); });
+        for (unsigned r = lo; r < hi; r++) {
+            close_row(rows, r, lo, r, reached[r - lo]);
+            rows[r] |= reached[r - lo]; } }
+    for (unsigned r = 0; r < n; r++)
+        putrow(r, rows[r]);
+}
@@ -21,6 +21,13 @@ limitations under the License.
 
 /* A lower-triangular bit matrix, held in a bit vector */
 class LTBitMatrix : private bitvec {
+    /* replace bits [0..r] of row r with those of v */
+    void putrow(unsigned r, const bitvec &v) {
+        size_t base = (r*r+r)/2;
+        for (size_t c = 0; c <= r; c += bits_per_unit) {
+            size_t sz = r + 1 - c < bits_per_unit ? r + 1 - c : bits_per_unit;
+            putrange(base + c, sz, v.getrange(c, sz)); } }
+
  public:
     nonconst_bitref operator()(unsigned r, unsigned c) {
         return r >= c ? bitvec::operator[]((r*r+r)/2 + c) : end(); }
@@ -57,10 +64,19 @@ class LTBitMatrix : private bitvec {
      public:
         friend class LTBitMatrix;
         using rowref<LTBitMatrix>::rowref;
-        void operator|=(bitvec a) const {
-            for (size_t v : a) {
-                if (v > row) break;
-                self(row, v) = 1; } }
+        /* bulk row operations; bits of a beyond the diagonal are ignored */
+        void operator|=(const bitvec &a) const {
+            bitvec v = *this;
+            v |= a;
+            self.putrow(row, v); }
+        void operator&=(const bitvec &a) const {
+            bitvec v = *this;
+            v &= a;
+            self.putrow(row, v); }
+        void operator-=(const bitvec &a) const {
+            bitvec v = *this;
+            v -= a;
+            self.putrow(row, v); }
         nonconst_bitref operator[](unsigned col) const { return self(row, col); }
     };
     class const_rowref : public rowref<const LTBitMatrix> {
@@ -76,6 +92,14 @@ class LTBitMatrix : private bitvec {
 
     bool operator==(const LTBitMatrix &a) const { return bitvec::operator==(a); }
     bool operator!=(const LTBitMatrix &a) const { return bitvec::operator!=(a); }
+
+    /* Replace the relation with its transitive closure: (r, c) is set afterwards if there is
+     * a path r -> ... -> c of one or more set bits.  Rows are processed in blocks; within a
+     * block, the rows merged in from earlier (already closed) blocks are done in parallel on
+     * the global Util::ThreadPool.  Each row is closed with whole-row ORs, skipping rows that
+     * are already reachable, so sparse and dense graphs both take far less than O(n^3). */
+    void transitive_closure();
+
     friend bool operator>>(const char *p, LTBitMatrix &bm);
 };
 
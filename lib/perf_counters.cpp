@@ -0,0 +1,87 @@
+#include "perf_counters.h"
+
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "error.h"
+
+namespace Util {
+
+bool PerfCounters::isEnabled = false;
+
+namespace {
+
+#if defined(__linux__)
+/// The counters of one thread.  Each is opened on its own, so that the others are still
+/// counted where some are missing (hardware counters, in many virtual machines).
+class ThreadCounters {
+    int fd[PerfCounters::COUNT];
+
+ public:
+    ThreadCounters() {
+        static const struct { uint32_t type; uint64_t config; } events[] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+        };
+        for (int i = 0; i < PerfCounters::COUNT; ++i) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // this thread, on any cpu
+            fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0); } }
+    ~ThreadCounters() {
+        for (int i = 0; i < PerfCounters::COUNT; ++i)
+            if (fd[i] >= 0) close(fd[i]); }
+    bool valid() const {
+        for (int i = 0; i < PerfCounters::COUNT; ++i)
+            if (fd[i] >= 0) return true;
+        return false; }
+    PerfCounters::Values read() const {
+        PerfCounters::Values rv;
+        for (int i = 0; i < PerfCounters::COUNT; ++i)
+            if (fd[i] >= 0 && ::read(fd[i], &rv.value[i], sizeof(uint64_t)) != sizeof(uint64_t))
+                rv.value[i] = 0;
+        return rv; }
+};
+
+ThreadCounters &threadCounters() {
+    static thread_local ThreadCounters counters;
+    return counters;
+}
+#endif  // __linux__
+
+}  // namespace
+
+bool PerfCounters::enable() {
+#if defined(__linux__)
+    isEnabled = threadCounters().valid();
+#endif  // __linux__
+    if (!isEnabled)
+        ::warning(ErrorType::WARN_UNSUPPORTED,
+                  "Cannot read the performance counters (see perf_event_paranoid)");
+    return isEnabled;
+}
+
+PerfCounters::Values PerfCounters::read() {
+#if defined(__linux__)
+    if (isEnabled) return threadCounters().read();
+#endif  // __linux__
+    return Values();
+}
+
+const char *PerfCounters::name(Counter c) {
+    static const char *names[] = { "cycles", "instructions", "cache_misses", "page_faults" };
+    return c < COUNT ? names[c] : "?";
+}
+
+}  // namespace Util
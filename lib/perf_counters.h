@@ -0,0 +1,45 @@
+#ifndef _LIB_PERF_COUNTERS_H_
+#define _LIB_PERF_COUNTERS_H_
+
+#include <cstdint>
+
+namespace Util {
+
+/**
+ * The hardware and kernel counters of the calling thread, read with perf_event_open on
+ * Linux: with the time of a pass they tell whether it is bound by computation (cycles
+ * and instructions), by cache misses (last level cache misses) or by allocation (page
+ * faults).  Enabled by --perf-counters; the per-pass profile of Visitor reads them when
+ * each pass starts and ends, so the counts of a pass include those of the passes it runs.
+ *
+ * Each thread opens its own counters the first time it reads them, and counts only what
+ * it runs itself, not what a pass hands to the thread pool.  A counter that cannot be
+ * opened (such as the hardware ones in many virtual machines) reads as 0; if none can
+ * (not Linux, or perf_event_paranoid forbids it) enable() warns and returns false.
+ */
+class PerfCounters {
+ public:
+    enum Counter { CYCLES, INSTRUCTIONS, CACHE_MISSES, PAGE_FAULTS, COUNT };
+    struct Values {
+        uint64_t    value[COUNT] = {};
+        Values operator-(const Values &a) const {
+            Values rv;
+            for (int i = 0; i < COUNT; ++i) rv.value[i] = value[i] - a.value[i];
+            return rv; }
+    };
+
+    /// Start counting; @return false (with a warning) if the counters are not available.
+    static bool enable();
+    static bool enabled() { return isEnabled; }
+    /// The counts of the calling thread so far, or zeros if not enabled.
+    static Values read();
+    /// The name of counter @c in reports.
+    static const char *name(Counter c);
+
+ private:
+    static bool isEnabled;
+};
+
+}  // namespace Util
+
+#endif /* _LIB_PERF_COUNTERS_H_ */
@@ -0,0 +1,132 @@
+#ifndef _LIB_SMALL_ORDERED_MAP_H_
+#define _LIB_SMALL_ORDERED_MAP_H_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// A map with unique keys that remembers insertion order, like ordered_map, but tuned
+/// for the small indexes kept by the IR: the entries live in one vector, are found by a
+/// linear scan while there are at most LINEAR of them, and by a hash index beyond that.
+///
+/// Erasing an entry only marks it dead, so the positions of the others (and so the
+/// index) stay valid; the vector is compacted once most of it is dead.  Inserting or
+/// erasing entries invalidates iterators.
+template<class K, class V, class HASH = std::hash<K>>
+class small_ordered_map {
+ public:
+    typedef K                   key_type;
+    typedef V                   mapped_type;
+    typedef std::pair<K, V>     value_type;
+    static constexpr size_t LINEAR = 8;
+
+ private:
+    struct slot_t {
+        value_type      kv;
+        bool            live;
+    };
+    std::vector<slot_t>                 data;
+    std::unordered_map<K, size_t, HASH> index;  // empty until there are > LINEAR entries
+    size_t                              live = 0;
+
+    template<class M, class E> class iter {
+        friend class small_ordered_map;
+        M       *map;
+        size_t  pos;
+        void skip() { while (pos < map->data.size() && !map->data[pos].live) ++pos; }
+     public:
+        typedef std::forward_iterator_tag       iterator_category;
+        typedef std::pair<K, V>                 value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef E                               *pointer;
+        typedef E                               &reference;
+        iter(M *map, size_t pos) : map(map), pos(pos) { skip(); }
+        template<class M2, class E2> iter(const iter<M2, E2> &i)  // NOLINT(runtime/explicit)
+        : map(i.map), pos(i.pos) {}
+        reference operator*() const { return map->data[pos].kv; }
+        pointer operator->() const { return &map->data[pos].kv; }
+        iter &operator++() { ++pos; skip(); return *this; }
+        iter operator++(int) { iter rv = *this; ++*this; return rv; }
+        bool operator==(const iter &i) const { return pos == i.pos; }
+        bool operator!=(const iter &i) const { return pos != i.pos; }
+        template<class, class> friend class iter;
+    };
+
+    size_t position(const K &key) const {
+        if (!index.empty()) {
+            auto it = index.find(key);
+            return it == index.end() ? data.size() : it->second; }
+        for (size_t i = 0; i < data.size(); ++i)
+            if (data[i].live && data[i].kv.first == key) return i;
+        return data.size(); }
+    void reindex() {
+        index.clear();
+        if (live <= LINEAR) return;
+        index.reserve(live);
+        for (size_t i = 0; i < data.size(); ++i)
+            if (data[i].live) index.emplace(data[i].kv.first, i); }
+    void compact() {
+        size_t out = 0;
+        for (size_t i = 0; i < data.size(); ++i)
+            if (data[i].live) data[out++] = std::move(data[i]);
+        data.resize(out);
+        reindex(); }
+
+ public:
+    typedef iter<small_ordered_map, value_type>                 iterator;
+    typedef iter<const small_ordered_map, const value_type>     const_iterator;
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, data.size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, data.size()); }
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+    void clear() {
+        data.clear();
+        index.clear();
+        live = 0; }
+
+    iterator find(const K &key) { return iterator(this, position(key)); }
+    const_iterator find(const K &key) const { return const_iterator(this, position(key)); }
+    size_t count(const K &key) const { return position(key) < data.size() ? 1 : 0; }
+
+    std::pair<iterator, bool> emplace(const K &key, const V &value) {
+        size_t pos = position(key);
+        if (pos < data.size()) return std::make_pair(iterator(this, pos), false);
+        pos = data.size();
+        data.push_back(slot_t{value_type(key, value), true});
+        if (++live > LINEAR) {
+            if (index.empty())
+                reindex();
+            else
+                index.emplace(key, pos); }
+        return std::make_pair(iterator(this, pos), true); }
+    std::pair<iterator, bool> insert(const value_type &v) { return emplace(v.first, v.second); }
+    V &operator[](const K &key) { return emplace(key, V()).first->second; }
+
+    iterator erase(iterator it) {
+        size_t pos = it.pos;
+        if (!index.empty()) index.erase(data[pos].kv.first);
+        data[pos].live = false;
+        data[pos].kv = value_type();
+        if (--live <= LINEAR) index.clear();
+        if (data.size() > 2 * live + LINEAR) {
+            // the next live entry moves down by the number of dead entries before it
+            size_t next = 0;
+            for (size_t i = 0; i < pos; ++i)
+                if (data[i].live) ++next;
+            compact();
+            pos = next; }
+        return iterator(this, pos); }
+    size_t erase(const K &key) {
+        auto it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1; }
+};
+
+#endif /* _LIB_SMALL_ORDERED_MAP_H_ */
@@ -0,0 +1,71 @@
+#include "sourceCodeBuilder.h"
+
+#include <stdio.h>
+#include <vector>
+
+namespace Util {
+
+constexpr size_t SourceCodeBuilder::CHUNK_SIZE;
+
+void SourceCodeBuilder::appendNumber(long value, bool isUnsigned) {
+    char digits[24];
+    char *end = digits + sizeof(digits), *p = end;
+    unsigned long magnitude = value < 0 && !isUnsigned ? 0UL - value : value;
+    do {
+        *--p = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0 && !isUnsigned)
+        *--p = '-';
+    append(p, end - p);
+}
+
+void SourceCodeBuilder::appendVFormat(const char *format, va_list ap) {
+    if (format == nullptr)
+        BUG("Null format string");
+    // Check for conversions other than the plain ones first, since the arguments can
+    // only be consumed once.
+    for (const char *p = strchr(format, '%'); p; p = strchr(p + 2, '%')) {
+        if (strchr("sdiu%", p[1]) && p[1] != 0)
+            continue;
+        char small[128];
+        va_list ap_copy;
+        va_copy(ap_copy, ap);
+        int size = vsnprintf(small, sizeof(small), format, ap);
+        if (size < 0)
+            BUG("Error in vsnprintf");
+        if (static_cast<size_t>(size) < sizeof(small)) {
+            append(small, size);
+        } else {
+            std::vector<char> large(size + 1);
+            vsnprintf(large.data(), large.size(), format, ap_copy);
+            append(large.data(), size);
+        }
+        va_end(ap_copy);
+        return;
+    }
+    const char *text = format;
+    for (const char *p = strchr(format, '%'); p; p = strchr(text, '%')) {
+        append(text, p - text);
+        switch (p[1]) {
+        case 's': {
+            const char *str = va_arg(ap, const char *);
+            append(str ? str : "(null)");
+            break; }
+        case 'd':
+        case 'i':
+            appendNumber(va_arg(ap, int), false);
+            break;
+        case 'u':
+            appendNumber(va_arg(ap, unsigned), true);
+            break;
+        default:  // '%'
+            append('%');
+            break;
+        }
+        text = p + 2;
+    }
+    append(text);
+}
+
+}  // namespace Util
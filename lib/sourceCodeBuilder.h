@@ -18,27 +18,56 @@ limitations under the License.
 #define _LIB_SOURCECODEBUILDER_H_
 
 #include <ctype.h>
-#include <sstream>
+#include <stdarg.h>
+#include <string.h>
+#include <iostream>
+#include <string>
 
 #include "lib/stringify.h"
 #include "lib/cstring.h"
 #include "lib/exceptions.h"
 
 namespace Util {
+/**
+ * Collects generated source code.  By default all of it is kept in memory until
+ * toString(); after setOutput() it is instead written to a stream in chunks of about
+ * CHUNK_SIZE bytes as it is produced, so that the memory used does not grow with the size
+ * of the generated file.
+ */
 class SourceCodeBuilder {
     int indentLevel;  // current indent level
     unsigned indentAmount;
 
-    std::stringstream buffer;
-    const std::string nl = "\n";
+    std::string buffer;
+    std::ostream *output = nullptr;
     bool endsInSpace;
 
+    static constexpr size_t CHUNK_SIZE = 1 << 16;
+    void put(const char *str, size_t len) {
+        buffer.append(str, len);
+        if (output && buffer.size() >= CHUNK_SIZE) flush(); }
+    void put(size_t count, char c) {
+        buffer.append(count, c);
+        if (output && buffer.size() >= CHUNK_SIZE) flush(); }
+    void appendNumber(long value, bool isUnsigned);
+
  public:
     SourceCodeBuilder() :
             indentLevel(0),
             indentAmount(4),
             endsInSpace(false)
-    {}
+    { buffer.reserve(CHUNK_SIZE); }
+    SourceCodeBuilder(const SourceCodeBuilder &) = delete;
+    ~SourceCodeBuilder() { flush(); }
+
+    /// Write the code to @out from now on, starting with whatever has been collected so
+    /// far; toString() then only returns the text that has not been written out yet.
+    void setOutput(std::ostream *out) { flush(); output = out; }
+    /// Write the collected text to the output stream, if there is one.
+    void flush() {
+        if (output == nullptr || buffer.empty()) return;
+        output->write(buffer.data(), buffer.size());
+        buffer.clear(); }
 
     void increaseIndent() { indentLevel += indentAmount; }
     void decreaseIndent() {
@@ -46,42 +75,46 @@ class SourceCodeBuilder {
         if (indentLevel < 0)
             BUG("Negative indent");
     }
-    void newline() { buffer << nl; endsInSpace = true; }
+    void newline() { put(1, '\n'); endsInSpace = true; }
     void spc() {
         if (!endsInSpace)
-            buffer << " ";
+            put(1, ' ');
         endsInSpace = true;
     }
 
-    void append(cstring str) { append(str.c_str()); }
-    void appendLine(cstring str) { append(str); newline(); }
-    void append(const std::string &str) {
-        if (str.size() == 0)
-            return;
-        endsInSpace = ::isspace(str.at(str.size() - 1));
-        buffer << str;
+    void append(cstring str) {
+        if (str.isNull())
+            BUG("Null argument to append");
+        append(str.c_str(), str.size());
     }
+    void appendLine(cstring str) { append(str); newline(); }
+    void append(const std::string &str) { append(str.data(), str.size()); }
     void append(char c) {
         endsInSpace = ::isspace(c);
-        buffer << c;
+        put(1, c);
     }
     void append(const char* str) {
         if (str == nullptr)
             BUG("Null argument to append");
-        if (strlen(str) == 0)
+        append(str, strlen(str));
+    }
+    void append(const char *str, size_t len) {
+        if (len == 0)
             return;
-        endsInSpace = ::isspace(str[strlen(str) - 1]);
-        buffer << str;
+        endsInSpace = ::isspace(str[len - 1]);
+        put(str, len);
     }
+    /// printf-style formatting.  Plain %s, %d, %i, %u and %% conversions are formatted
+    /// directly into the buffer; anything else goes through vsnprintf.
     void appendFormat(const char* format, ...) {
         va_list ap;
         va_start(ap, format);
-        cstring str = Util::vprintf_format(format, ap);
+        appendVFormat(format, ap);
         va_end(ap);
-        append(str);
     }
-    void append(unsigned u) { appendFormat("%d", u); }
-    void append(int u) { appendFormat("%d", u); }
+    void appendVFormat(const char *format, va_list ap);
+    void append(unsigned u) { appendNumber(u, true); }
+    void append(int u) { appendNumber(u, false); }
 
     void endOfStatement(bool addNl = false) {
         append(";");
@@ -94,7 +127,7 @@ class SourceCodeBuilder {
     }
 
     void emitIndent() {
-        buffer << std::string(indentLevel, ' ');
+        put(indentLevel, ' ');
         if (indentLevel > 0)
             endsInSpace = true;
     }
@@ -107,7 +140,7 @@ class SourceCodeBuilder {
             newline();
     }
 
-    std::string toString() const { return buffer.str(); }
+    std::string toString() const { return buffer; }
     void commentStart() { append("/* "); }
     void commentEnd() { append(" */"); }
     bool lastIsSpace() const { return endsInSpace; }
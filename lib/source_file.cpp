@@ -14,9 +14,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <string.h>
 #include <sstream>
 
 #include <algorithm>
+#include <stdexcept>
 #include "source_file.h"
 #include "exceptions.h"
 #include "lib/log.h"
@@ -57,8 +59,8 @@ cstring SourceInfo::toDebugString() const {
 //////////////////////////////////////////////////////////////////////////////////////////
 
 InputSources::InputSources() : sealed(false) {
+    lineStarts.push_back(0);
     mapLine(nullptr, 1);  // the first line read will be line 1 of stdin
-    contents.push_back("");
 }
 
 void InputSources::addComment(SourceInfo srcInfo, bool singleLine, cstring body) {
@@ -78,8 +80,8 @@ void InputSources::seal() {
 }
 
 unsigned InputSources::lineCount() const {
-    int size = contents.size();
-    if (contents.back().empty()) {
+    int size = lineStarts.size();
+    if (lineStarts.back() == contents.size()) {
         // do not count the last line if it is empty.
         size -= 1;
         if (size < 0)
@@ -93,52 +95,35 @@ void InputSources::appendToLastLine(StringRef text) {
     if (sealed)
         BUG("Appending to sealed InputSources");
     // Text should not contain any newline characters
-    for (size_t i = 0; i < text.len; i++) {
-        char c = text[i];
-        if (c == '\n')
-            BUG("Text contains newlines");
-    }
-    contents.back() += text.toString();
+    if (memchr(text.p, '\n', text.len))
+        BUG("Text contains newlines");
+    contents.append(text.p, text.len);
 }
 
 // Append a newline and start a new line
 void InputSources::appendNewline(StringRef newline) {
     if (sealed)
         BUG("Appending to sealed InputSources");
-    contents.back() += newline.toString();
-    contents.push_back("");  // start a new line
+    contents.append(newline.p, newline.len);
+    lineStarts.push_back(contents.size());  // start a new line
 }
 
 void InputSources::appendText(const char* text) {
     if (text == nullptr)
         BUG("Null text being appended");
-    StringRef ref = text;
-
-    while (ref.len > 0) {
-        const char* nl = ref.find("\r\n");
-        if (nl == nullptr) {
-            appendToLastLine(ref);
+    if (sealed)
+        BUG("Appending to sealed InputSources");
+    // Only '\n' ends a line ("\r\n" ends with one too, and a lone '\r' is just text), so
+    // the line starts can be found with memchr, which scans in bulk.
+    size_t start = contents.size();
+    contents.append(text);
+    const char *data = contents.data();
+    for (size_t pos = start; pos < contents.size(); ) {
+        auto nl = static_cast<const char *>(memchr(data + pos, '\n', contents.size() - pos));
+        if (nl == nullptr)
             break;
-        }
-
-        size_t toCut = nl - ref.p;
-        if (toCut != 0) {
-            StringRef nonnl(ref.p, toCut);
-            appendToLastLine(nonnl);
-            ref += toCut;
-        } else {
-            if (ref[0] == '\n') {
-                appendNewline("\n");
-                ref += 1;
-            } else if (ref.len > 2 && ref[0] == '\r' && ref[1] == '\n') {
-                appendNewline("\r\n");
-                ref += 2;
-            } else {
-                // Just \r
-                appendToLastLine(ref.substr(0, 1));
-                ref += 1;
-            }
-        }
+        pos = nl - data + 1;
+        lineStarts.push_back(pos);
     }
 }
 
@@ -149,22 +134,31 @@ cstring InputSources::getLine(unsigned lineNumber) const {
         // don't throw: this code may be called by exceptions
         // reporting on elements that have no source position
     }
-    return contents.at(lineNumber - 1);
+    if (lineNumber > lineStarts.size())
+        throw std::out_of_range("InputSources::getLine");
+    size_t start = lineStarts[lineNumber - 1];
+    size_t end = lineNumber < lineStarts.size() ? lineStarts[lineNumber] : contents.size();
+    return cstring(contents.data() + start, end - start);
 }
 
 void InputSources::mapLine(cstring file, unsigned originalSourceLineNo) {
     if (sealed)
         BUG("Changing mapping to sealed InputSources");
     unsigned lineno = getCurrentLineNumber();
-    line_file_map.emplace(lineno, SourceFileLine(file, originalSourceLineNo));
+    // Lines are only ever appended, so this keeps the vector sorted; like the first
+    // mapping of a line, later ones for the same line are ignored.
+    if (!line_file_map.empty() && line_file_map.back().first == lineno)
+        return;
+    line_file_map.emplace_back(lineno, SourceFileLine(file, originalSourceLineNo));
 }
 
 SourceFileLine InputSources::getSourceLine(unsigned line) const {
-    auto it = line_file_map.upper_bound(line+1);
+    auto it = std::upper_bound(line_file_map.begin(), line_file_map.end(), line+1,
+                               [](unsigned l, const std::pair<unsigned, SourceFileLine> &m) {
+                                   return l < m.first; });
     if (it == line_file_map.begin())
         // There must be always something mapped to line 0
         BUG("No source information for line %1%", line);
-    LOG3(line << " mapped to " << it->first << "," << it->second.toString());
     --it;
     LOG3(line << " corrected to " << it->first << "," << it->second.toString());
     // For a source file such as
@@ -181,12 +175,12 @@ SourceFileLine InputSources::getSourceLine(unsigned line) const {
 }
 
 unsigned InputSources::getCurrentLineNumber() const {
-    return contents.size();
+    return lineStarts.size();
 }
 
 SourcePosition InputSources::getCurrentPosition() const {
     unsigned line = getCurrentLineNumber();
-    unsigned column = contents.back().size();
+    unsigned column = contents.size() - lineStarts.back();
     return SourcePosition(line, column);
 }
 
@@ -267,8 +261,7 @@ cstring InputSources::getBriefSourceFragment(const SourceInfo &position) const {
 
 cstring InputSources::toDebugString() const {
     std::stringstream builder;
-    for (auto line : contents)
-        builder << line;
+    builder << contents;
     builder << "---------------" << std::endl;
     for (auto lf : line_file_map)
         builder << lf.first << ": " << lf.second.toString() << std::endl;
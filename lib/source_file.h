@@ -21,6 +21,8 @@ limitations under the License.
 #ifndef _LIB_SOURCE_FILE_H_
 #define _LIB_SOURCE_FILE_H_
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "gtest/gtest_prod.h"
@@ -135,27 +137,33 @@ interpreted relative to some InputSources.
 For a program element, the start is inclusive and the end is
 exclusive (the first position after the language element).
 
-SourceInfo can also be "invalid"
+SourceInfo can also be "invalid".  An invalid SourceInfo can still carry
+the position of an IR node read back from a file (by --fromJSON or
+--fromBinaryIR): its filename(), line(), column() and srcBrief().
+
+There is a SourceInfo in every IR node, so it is kept small: the sources
+pointer and the pointer to the rarely used position read from a file
+share one word, told apart by whether start is valid.
 */
 class SourceInfo final {
+    /// The position of a node read back from a file
+    struct Loaded {
+        cstring filename;
+        int line;
+        int column;
+        cstring srcBrief;
+    };
+
  public:
-    cstring filename = "";
-    int line = -1;
-    int column = -1;
-    cstring srcBrief = "";
-    SourceInfo(cstring filename, int line, int column, cstring srcBrief) {
-        this->filename = filename;
-        this->line = line;
-        this->column = column;
-        this->srcBrief = srcBrief;
-    }
+    SourceInfo(cstring filename, int line, int column, cstring srcBrief)
+        : loaded(new Loaded{filename, line, column, srcBrief}) {}
     /// Creates an "invalid" SourceInfo
     SourceInfo()
         : sources(nullptr), start(SourcePosition()), end(SourcePosition()) {}
 
     /// Creates a SourceInfo for a 'point' in the source, or invalid
     SourceInfo(const InputSources* sources, SourcePosition point)
-        : sources(sources), start(point), end(point) {}
+        : sources(point.isValid() ? sources : nullptr), start(point), end(point) {}
 
     SourceInfo(const InputSources* sources, SourcePosition start,
                SourcePosition end);
@@ -207,6 +215,12 @@ class SourceInfo final {
 
     cstring getSourceFile() const;
 
+    /// The position read back from a file, or "", -1, -1, "" if there is none
+    cstring filename() const { return from_file() ? loaded->filename : cstring(""); }
+    int line() const { return from_file() ? loaded->line : -1; }
+    int column() const { return from_file() ? loaded->column : -1; }
+    cstring srcBrief() const { return from_file() ? loaded->srcBrief : cstring(""); }
+
     const SourcePosition& getStart() const
     { return this->start; }
 
@@ -231,7 +245,12 @@ class SourceInfo final {
     { return !this->operator< (rhs); }
 
  private:
-    const InputSources* sources = nullptr;
+    bool from_file() const { return !start.isValid() && loaded != nullptr; }
+
+    union {
+        const InputSources* sources = nullptr;  // if start is valid
+        const Loaded* loaded;                   // if start is not valid
+    };
     SourcePosition start = SourcePosition();
     SourcePosition end = SourcePosition();
 };
@@ -289,7 +308,8 @@ class Comment final : IHasDbPrint {
   The mutable part of the API is tailored for interaction with the lexer.
   After the lexer is done this object can be "sealed" and never changes again.
 
-  This class implements a singleton pattern: there is a single instance of this class.
+  Each parse has its own instance, made by its parser driver and referred to by the
+  SourceInfo of the nodes it makes, so several programs can be parsed at once.
 */
 class InputSources final {
     FRIEND_TEST(UtilSourceFile, InputSources);
@@ -337,10 +357,14 @@ class InputSources final {
     /// Input program that is being currently compiled; there can be only one.
     bool sealed;
 
-    std::map<unsigned, SourceFileLine> line_file_map;
+    /// (line, source) pairs sorted by line: the lines from each line up to the next one
+    /// in the vector come from the given source line onwards.
+    std::vector<std::pair<unsigned, SourceFileLine>> line_file_map;
 
-    /// Each line also stores the end-of-line character(s)
-    std::vector<std::string> contents;
+    /// All the text, including the end-of-line character(s) of each line
+    std::string contents;
+    /// Offset in contents at which each line starts
+    std::vector<size_t> lineStarts;
     /// The commends found in the file.
     std::vector<Comment*> comments;
 };
@@ -0,0 +1,138 @@
+#include "startup_profile.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef MULTITHREAD
+#include <mutex>
+#endif  // MULTITHREAD
+
+namespace Util {
+
+namespace {
+
+struct Event {
+    const char  *what;
+    uint64_t    start, end;     // equal for marks
+};
+
+// Reached through functions, as they may be used by the static constructors of other
+// files before those of this file have run.
+std::vector<Event> &events() {
+    static std::vector<Event> *rv = new std::vector<Event>;
+    return *rv;
+}
+#ifdef MULTITHREAD
+std::mutex &eventsLock() {
+    static std::mutex *rv = new std::mutex;
+    return *rv;
+}
+#endif  // MULTITHREAD
+
+/// The time the process started, on the clock of StartupProfile::now, or 0 if unknown.
+uint64_t processStart() {
+#if defined(__linux__) && defined(CLOCK_BOOTTIME)
+    // the 22nd field of /proc/self/stat is the start time, in clock ticks since boot
+    std::ifstream stat("/proc/self/stat");
+    std::string text;
+    if (!std::getline(stat, text)) return 0;
+    auto fields = text.rfind(')');  // the command name may contain anything
+    if (fields == std::string::npos) return 0;
+    unsigned long long ticks = 0;
+    const char *p = text.c_str() + fields + 1;
+    for (int field = 3; field <= 22 && *p; ++field) {
+        while (*p == ' ') ++p;
+        if (field == 22) ticks = strtoull(p, nullptr, 10);
+        while (*p && *p != ' ') ++p; }
+    long hz = sysconf(_SC_CLK_TCK);
+    struct timespec boot, mono;
+    if (!ticks || hz <= 0 || clock_gettime(CLOCK_BOOTTIME, &boot) != 0 ||
+        clock_gettime(CLOCK_MONOTONIC, &mono) != 0)
+        return 0;
+    uint64_t sinceStart = boot.tv_sec * 1000000000ULL + boot.tv_nsec - ticks * 1000000000ULL / hz;
+    uint64_t now = mono.tv_sec * 1000000000ULL + mono.tv_nsec;
+    return sinceStart < now ? now - sinceStart : 0;
+#else
+    return 0;
+#endif
+}
+
+// Constructed before the static objects of the default priority, so this is about when
+// the executable is loaded and its static constructors start.
+struct MarkConstructors {
+    MarkConstructors() { StartupProfile::mark("static constructors"); }
+};
+#if defined(__GNUC__)
+MarkConstructors markConstructors __attribute__((init_priority(101)));
+#else
+MarkConstructors markConstructors;
+#endif
+
+void writeAtExit() {
+    StartupProfile::write(std::cerr);
+}
+
+}  // namespace
+
+uint64_t StartupProfile::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void StartupProfile::record(const char *what, uint64_t start, uint64_t end) {
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(eventsLock());
+#endif  // MULTITHREAD
+    events().push_back({ what, start, end });
+}
+
+void StartupProfile::mark(const char *what) {
+    uint64_t t = now();
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(eventsLock());
+#endif  // MULTITHREAD
+    for (auto &e : events())
+        if (e.start == e.end && strcmp(e.what, what) == 0) return;
+    events().push_back({ what, t, t });
+}
+
+void StartupProfile::enable() {
+    static bool enabled = false;
+    if (!enabled) atexit(writeAtExit);
+    enabled = true;
+}
+
+void StartupProfile::write(std::ostream &out) {
+    uint64_t process = processStart();
+#ifdef MULTITHREAD
+    std::lock_guard<std::mutex> acquire(eventsLock());
+#endif  // MULTITHREAD
+    uint64_t start = process || events().empty() ? process : events().front().start;
+    auto ms = [](uint64_t t, uint64_t from) {
+        std::stringstream tmp;
+        tmp << std::fixed << std::setprecision(3) << (t - from) / 1000000.0;
+        return tmp.str(); };
+    out << "Startup profile (milliseconds since the "
+        << (process ? "process started" : "static constructors started") << "):" << std::endl;
+    // a timed initialization is recorded when it ends, after what it includes
+    std::vector<Event> sorted(events());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Event &a, const Event &b) {
+        return a.start < b.start; });
+    for (auto &e : sorted) {
+        out << std::setw(12) << ms(e.start, start) << "  " << e.what;
+        if (e.end != e.start) out << " (" << ms(e.end, e.start) << ")";
+        out << std::endl; }
+    out << std::setw(12) << ms(now(), start) << "  exit" << std::endl;
+}
+
+}  // namespace Util
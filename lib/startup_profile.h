@@ -0,0 +1,40 @@
+#ifndef _LIB_STARTUP_PROFILE_H_
+#define _LIB_STARTUP_PROFILE_H_
+
+#include <cstdint>
+#include <iosfwd>
+
+namespace Util {
+
+/**
+ * Measures where the time goes before a compilation starts, reported on stderr at exit
+ * with `--startup-profile`: loading the executable, the static constructors, and the
+ * lazily initialized singletons (P4CoreLibrary, the architecture models, the error
+ * catalog...), each timed on its first use.  Times are recorded whether or not the
+ * report is asked for, as most of them happen before the options are parsed.
+ */
+class StartupProfile {
+ public:
+    /// Note that @what happened now, if it has not happened before.
+    static void mark(const char *what);
+
+    /// @return the result of @init, timed as the initialization of @what
+    template<class F> static auto time(const char *what, F init) -> decltype(init()) {
+        uint64_t start = now();
+        auto rv = init();
+        record(what, start, now());
+        return rv; }
+
+    /// Write the report to stderr at exit.
+    static void enable();
+
+    static void write(std::ostream &out);
+
+ private:
+    static uint64_t now();
+    static void record(const char *what, uint64_t start, uint64_t end);
+};
+
+}  // namespace Util
+
+#endif /* _LIB_STARTUP_PROFILE_H_ */
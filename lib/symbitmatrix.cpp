@@ -0,0 +1,25 @@
+#include "symbitmatrix.h"
+#include <vector>
+
+void SymBitMatrix::transitive_closure() {
+    unsigned n = size();
+    std::vector<unsigned> parent(n);
+    std::vector<bool> linked(n);
+    for (unsigned i = 0; i < n; i++) parent[i] = i;
+    auto find = [&parent](unsigned i) {
+        while (parent[i] != i) i = parent[i] = parent[parent[i]];
+        return i; };
+    unsigned r = 0;
+    for (size_t bit : *static_cast<bitvec *>(this)) {
+        while ((r*r+r)/2 + r < bit) r++;
+        unsigned c = bit - (r*r+r)/2;
+        linked[r] = linked[c] = true;
+        unsigned a = find(r), b = find(c);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b); }
+    std::vector<bitvec> components(n);
+    for (unsigned i = 0; i < n; i++)
+        if (linked[i]) components[find(i)][i] = 1;
+    clear();
+    for (unsigned i = 0; i < n; i++)
+        if (linked[i]) putrow(i, components[find(i)]);
+}
@@ -23,6 +23,13 @@ limitations under the License.
  * is used for both halves, so modifying one bit modifies both sides, keeping the matrix
  * always symmetric.  Iterating over the matrix only iterates over the lower triangle */
 class SymBitMatrix : private bitvec {
+    /* replace bits [0..r] of row r (the part of it held in row r) with those of v */
+    void putrow(unsigned r, const bitvec &v) {
+        size_t base = (r*r+r)/2;
+        for (size_t c = 0; c <= r; c += bits_per_unit) {
+            size_t sz = r + 1 - c < bits_per_unit ? r + 1 - c : bits_per_unit;
+            putrange(base + c, sz, v.getrange(c, sz)); } }
+
  public:
     nonconst_bitref operator()(unsigned r, unsigned c) {
         if (r < c) std::swap(r, c);
@@ -69,9 +76,20 @@ class SymBitMatrix : private bitvec {
      public:
         friend class SymBitMatrix;
         using rowref<SymBitMatrix>::rowref;
-        void operator|=(bitvec a) const {
-            for (size_t v : a) {
-                self(row, v) = 1; } }
+        /* bulk row operations; the part of the row that is held in other rows (the
+         * columns beyond the diagonal) is still updated bit by bit */
+        void operator|=(const bitvec &a) const {
+            auto v = self.getslice((row*row+row)/2, row+1);
+            v |= a;
+            self.putrow(row, v);
+            for (int c = a.ffs(row+1); c >= 0; c = a.ffs(c+1))
+                self(row, c) = 1; }
+        void operator&=(const bitvec &a) const {
+            auto v = self.getslice((row*row+row)/2, row+1);
+            v &= a;
+            self.putrow(row, v);
+            for (auto c = self.size(); c-- > row+1;)
+                if (!a[c]) self(row, c) = 0; }
         nonconst_bitref operator[](unsigned col) const { return self(row, col); }
     };
     class const_rowref : public rowref<const SymBitMatrix> {
@@ -88,6 +106,12 @@ class SymBitMatrix : private bitvec {
     bool operator==(const SymBitMatrix &a) const { return bitvec::operator==(a); }
     bool operator!=(const SymBitMatrix &a) const { return bitvec::operator!=(a); }
     bool operator|=(const SymBitMatrix &a) { return bitvec::operator|=(a); }
+
+    /* Replace the relation with its transitive closure: (r, c) is set afterwards if r and c
+     * are connected by a path of one or more set bits, so every connected component becomes
+     * a clique (including the diagonal).  The components are found with union-find, in
+     * time linear in the size of the matrix. */
+    void transitive_closure();
 };
 
 #endif /* _LIB_SYMBITMATRIX_H_ */
@@ -0,0 +1,199 @@
+#include "thread_pool.h"
+
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "compile_context.h"
+#include "crash.h"
+#include "exceptions.h"
+#include "gc.h"
+
+namespace Util {
+
+struct ThreadPool::Task {
+    std::function<void()>       fn;
+    TaskGroup                   *group;
+    size_t                      seq;
+    ICompileContext             *context;   // of the thread that submitted the task
+};
+
+struct ThreadPool::Worker {
+    std::mutex                  lock;
+    std::deque<Task *>          tasks;
+    std::thread                 thread;
+};
+
+// the pool and worker index of the current thread, if it is a pool worker
+static thread_local ThreadPool  *current_pool = nullptr;
+static thread_local unsigned    current_worker = 0;
+
+ThreadPool::ThreadPool(unsigned threads) : queued(0), shutdown(false) {
+#ifdef MULTITHREAD
+    if (threads > 1) {
+        gc_allow_threads();
+        nworkers = threads - 1;
+        workers = new Worker *[nworkers];
+        for (unsigned i = 0; i < nworkers; ++i)
+            workers[i] = new Worker;
+        for (unsigned i = 0; i < nworkers; ++i)
+            workers[i]->thread = std::thread(&ThreadPool::worker_loop, this, i); }
+#else
+    (void)threads;
+#endif  // MULTITHREAD
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+void ThreadPool::stop() {
+    if (!nworkers) return;
+    {
+        std::lock_guard<std::mutex> acquire(sleep_lock);
+        shutdown = true;
+    }
+    sleep_cv.notify_all();
+    for (unsigned i = 0; i < nworkers; ++i) {
+        workers[i]->thread.join();
+        BUG_CHECK(workers[i]->tasks.empty(), "thread pool stopped with tasks pending");
+        delete workers[i]; }
+    delete [] workers;
+    workers = nullptr;
+    nworkers = 0;
+}
+
+static std::exception_ptr run_task(const std::function<void()> &fn, ICompileContext *context) {
+    try {
+        if (context && context != CompileContextStack::current()) {
+            AutoCompileContext inherit(context);
+            fn();
+        } else {
+            fn(); }
+    } catch (...) {
+        return std::current_exception(); }
+    return nullptr;
+}
+
+void ThreadPool::submit(Task *task) {
+    if (!nworkers) {
+        task->group->finish(task->seq, run_task(task->fn, task->context));
+        delete task;
+        return; }
+    static std::atomic<unsigned> next_queue(0);
+    unsigned q = current_pool == this ? current_worker : next_queue++ % nworkers;
+    {
+        std::lock_guard<std::mutex> acquire(workers[q]->lock);
+        workers[q]->tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> acquire(sleep_lock);
+        ++queued;
+    }
+    sleep_cv.notify_one();
+}
+
+/// Run one queued task, if there is one.  Workers take the newest task from their own
+/// deque, and steal the oldest task from the other workers' deques.  @self is the index
+/// of the calling worker, or nworkers for a thread that is not part of the pool.
+bool ThreadPool::run_one(unsigned self) {
+    if (!queued.load()) return false;
+    Task *task = nullptr;
+    if (self < nworkers) {
+        std::lock_guard<std::mutex> acquire(workers[self]->lock);
+        if (!workers[self]->tasks.empty()) {
+            task = workers[self]->tasks.back();
+            workers[self]->tasks.pop_back(); } }
+    for (unsigned i = 1; !task && i <= nworkers; ++i) {
+        auto *victim = workers[(self + i) % nworkers];
+        std::lock_guard<std::mutex> acquire(victim->lock);
+        if (!victim->tasks.empty()) {
+            task = victim->tasks.front();
+            victim->tasks.pop_front(); } }
+    if (!task) return false;
+    --queued;
+    task->group->finish(task->seq, run_task(task->fn, task->context));
+    delete task;
+    return true;
+}
+
+void ThreadPool::worker_loop(unsigned self) {
+    gc_register_thread();
+#ifdef MULTITHREAD
+    register_thread();
+#endif  // MULTITHREAD
+    current_pool = this;
+    current_worker = self;
+    while (!shutdown.load()) {
+        if (run_one(self)) continue;
+        std::unique_lock<std::mutex> acquire(sleep_lock);
+        sleep_cv.wait(acquire, [this]() { return shutdown.load() || queued.load() > 0; }); }
+    current_pool = nullptr;
+    gc_unregister_thread();
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)> &fn) {
+    if (nworkers == 0 || count < 2) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return; }
+    TaskGroup group(*this);
+    for (size_t i = 0; i < count; ++i)
+        group.run([&fn, i]() { fn(i); });
+    group.wait();
+}
+
+ThreadPool::TaskGroup::TaskGroup(ThreadPool &pool) : pool(pool), outstanding(0) {}
+
+ThreadPool::TaskGroup::~TaskGroup() {
+    // tasks may still refer to the group (and to the caller's stack), so they must
+    // all complete before it goes away, even when unwinding from an exception.
+    try {
+        wait();
+    } catch (...) {}
+}
+
+void ThreadPool::TaskGroup::run(std::function<void()> fn) {
+    ++outstanding;
+    pool.submit(new Task{std::move(fn), this, next_seq++, CompileContextStack::current()});
+}
+
+void ThreadPool::TaskGroup::finish(size_t seq, std::exception_ptr err) {
+    // the group may be destroyed as soon as wait() sees the last task finish, so
+    // the count is only changed, and the waiters notified, while holding the lock
+    // that wait() takes before it returns.
+    std::lock_guard<std::mutex> acquire(lock);
+    if (err && (!error || seq < error_seq)) {
+        error = err;
+        error_seq = seq; }
+    if (--outstanding == 0)
+        done_cv.notify_all();
+}
+
+void ThreadPool::TaskGroup::wait() {
+    unsigned self = current_pool == &pool ? current_worker : pool.nworkers;
+    for (;;) {
+        if (outstanding.load() > 0 && pool.run_one(self)) continue;
+        std::unique_lock<std::mutex> acquire(lock);
+        if (done_cv.wait_for(acquire, std::chrono::milliseconds(1),
+                             [this]() { return outstanding.load() == 0; }))
+            break; }
+    next_seq = 0;
+    if (error) {
+        auto err = error;
+        error = nullptr;
+        std::rethrow_exception(err); }
+}
+
+static ThreadPool *global_pool = nullptr;
+
+ThreadPool &ThreadPool::global() {
+    if (!global_pool) global_pool = new ThreadPool(1);
+    return *global_pool;
+}
+
+void ThreadPool::setThreads(unsigned threads) {
+    if (global_pool && global_pool->concurrency() == (threads ? threads : 1)) return;
+    delete global_pool;
+    global_pool = new ThreadPool(threads);
+}
+
+}  // namespace Util
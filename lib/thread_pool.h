@@ -0,0 +1,96 @@
+#ifndef _LIB_THREAD_POOL_H_
+#define _LIB_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Util {
+
+/**
+ * A work-stealing pool of worker threads for compiler-internal parallelism.
+ *
+ * Each worker owns a task deque; tasks submitted from a worker go to that worker's
+ * deque, and idle workers steal from the other end of their siblings' deques.  A thread
+ * waiting for a TaskGroup runs queued tasks itself rather than blocking, so nested
+ * parallelism cannot deadlock the pool.  A task runs in the compilation context (see
+ * CompileContextStack) that was current on the thread that submitted it.
+ *
+ * Worker threads are only started when p4c is built with MULTITHREAD (they must be
+ * registered with the garbage collector); otherwise the pool has no workers and every
+ * task runs inline on the thread that submits it.
+ */
+class ThreadPool {
+    struct Task;
+    struct Worker;
+    Worker              **workers = nullptr;
+    unsigned            nworkers = 0;
+    std::atomic<size_t> queued;
+    std::atomic<bool>   shutdown;
+    std::mutex          sleep_lock;
+    std::condition_variable     sleep_cv;
+
+    void submit(Task *);
+    bool run_one(unsigned self);
+    void worker_loop(unsigned self);
+    void stop();
+
+ public:
+    /** A set of tasks that can be waited for as a unit.  The first exception thrown by
+     * any task in the group (in submission order) is rethrown by wait(). */
+    class TaskGroup {
+        ThreadPool              &pool;
+        std::atomic<size_t>     outstanding;
+        std::mutex              lock;
+        std::condition_variable done_cv;
+        size_t                  next_seq = 0, error_seq = 0;
+        std::exception_ptr      error;
+        friend class ThreadPool;
+        void finish(size_t seq, std::exception_ptr);
+
+     public:
+        explicit TaskGroup(ThreadPool &pool = ThreadPool::global());
+        TaskGroup(const TaskGroup &) = delete;
+        ~TaskGroup();
+        void run(std::function<void()> fn);
+        void wait();
+    };
+
+    explicit ThreadPool(unsigned threads);
+    ThreadPool(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    /// The number of threads that may run tasks concurrently, including the caller.
+    unsigned concurrency() const { return nworkers + 1; }
+
+    /// Run fn(i) for every i in [0, count), returning once all have completed.
+    void parallel_for(size_t count, const std::function<void(size_t)> &fn);
+
+    /// Compute map(i) for every i in [0, count) in parallel, and fold the results into
+    /// @init with combine(acc, value) in the order of i, so that the result does not
+    /// depend on the number of threads even if combine is not associative.  T must be
+    /// default-constructible.
+    template <typename T, typename Map, typename Combine>
+    T parallel_reduce(size_t count, T init, Map map, Combine combine) {
+        std::vector<T> values(count);
+        parallel_for(count, [&](size_t i) { values[i] = map(i); });
+        for (auto &value : values)
+            init = combine(std::move(init), std::move(value));
+        return init;
+    }
+
+    /// The pool shared by all compiler passes, sized by setThreads().
+    static ThreadPool &global();
+    /// Resize the global pool to use @threads threads in total (including the main
+    /// thread).  Must not be called while tasks are running.
+    static void setThreads(unsigned threads);
+};
+
+}  // namespace Util
+
+#endif /* _LIB_THREAD_POOL_H_ */
@@ -15,11 +15,123 @@ limitations under the License.
 */
 
 #include "actionSynthesis.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "frontends/p4/methodInstance.h"
 #include "frontends/p4/coreLibrary.h"
 
 namespace P4 {
 
+namespace {
+
+/// The locations a statement reads and writes, as paths such as "hdr.h.f".  The paths
+/// are conservative: an element of a stack or a header union stands for all of it.
+class Accesses : public Inspector {
+    ReferenceMap* refMap;
+    TypeMap*      typeMap;
+
+    std::string location(const IR::Expression* expr) const {
+        if (auto pe = expr->to<IR::PathExpression>())
+            return pe->path->name.name.c_str();
+        if (auto m = expr->to<IR::Member>()) {
+            auto base = location(m->expr);
+            auto type = typeMap->getType(m->expr);
+            if (base.empty() || !type || type->is<IR::Type_Stack>() ||
+                type->is<IR::Type_HeaderUnion>())
+                return base;
+            return base + "." + m->member.name.c_str(); }
+        if (auto ai = expr->to<IR::ArrayIndex>())
+            return location(ai->left);
+        if (auto sl = expr->to<IR::Slice>())
+            return location(sl->e0);
+        return std::string();
+    }
+    /// Record the location of @expr in @into, and read its indices.
+    /// @return false if it is not a location
+    bool access(const IR::Expression* expr, std::vector<std::string>& into) {
+        auto loc = location(expr);
+        if (loc.empty())
+            return false;
+        into.push_back(loc);
+        for (auto e = expr; ; ) {
+            if (auto ai = e->to<IR::ArrayIndex>()) {
+                visit(ai->right);
+                e = ai->left;
+            } else if (auto m = e->to<IR::Member>()) {
+                e = m->expr;
+            } else if (auto sl = e->to<IR::Slice>()) {
+                e = sl->e0;
+            } else {
+                break; } }
+        return true;
+    }
+    static bool overlap(const std::string& a, const std::string& b) {
+        auto n = std::min(a.size(), b.size());
+        if (a.compare(0, n, b, 0, n) != 0)
+            return false;
+        auto& longer = a.size() > b.size() ? a : b;
+        return longer.size() == n || longer[n] == '.';
+    }
+    static bool overlap(const std::vector<std::string>& a, const std::vector<std::string>& b) {
+        for (auto& x : a)
+            for (auto& y : b)
+                if (overlap(x, y))
+                    return true;
+        return false;
+    }
+
+ public:
+    std::vector<std::string> reads, writes;
+    bool opaque = false;  // has effects that are not tracked
+
+    Accesses(ReferenceMap* refMap, TypeMap* typeMap, const IR::Node* node) :
+            refMap(refMap), typeMap(typeMap) {
+        setName("Accesses");
+        node->apply(*this);
+    }
+    /// True if the two can run in either order.
+    bool independent(const Accesses& other) const {
+        return !opaque && !other.opaque && !overlap(writes, other.reads) &&
+                !overlap(writes, other.writes) && !overlap(reads, other.writes);
+    }
+
+    bool preorder(const IR::PathExpression* e) override { return !access(e, reads); }
+    bool preorder(const IR::Member* e) override { return !access(e, reads); }
+    bool preorder(const IR::ArrayIndex* e) override { return !access(e, reads); }
+    bool preorder(const IR::Slice* e) override { return !access(e, reads); }
+    bool preorder(const IR::MethodCallExpression* mc) override {
+        auto mi = MethodInstance::resolve(mc, refMap, typeMap);
+        auto bim = mi->to<BuiltInMethod>();
+        if (!bim)
+            opaque = true;
+        else if (bim->name == IR::Type_Header::isValid)
+            access(bim->appliedTo, reads);
+        else if (!access(bim->appliedTo, writes))
+            opaque = true;
+        return false;
+    }
+
+    bool preorder(const IR::AssignmentStatement* a) override {
+        if (!access(a->left, writes))
+            opaque = true;
+        visit(a->right);
+        return false;
+    }
+    bool preorder(const IR::MethodCallStatement*) override { return true; }
+    bool preorder(const IR::IfStatement*) override { return true; }
+    bool preorder(const IR::BlockStatement*) override { return true; }
+    bool preorder(const IR::EmptyStatement*) override { return true; }
+    bool preorder(const IR::Statement*) override {
+        opaque = true;
+        return false;
+    }
+};
+
+}  // namespace
+
 const IR::Node* DoMoveActionsToTables::postorder(IR::MethodCallStatement* statement) {
     auto mi = MethodInstance::resolve(statement, refMap, typeMap);
     if (!mi->is<ActionCall>())
@@ -124,12 +236,45 @@ const IR::Node* DoSynthesizeActions::postorder(IR::P4Control* control) {
     return control;
 }
 
+std::vector<const IR::StatOrDecl*>
+DoSynthesizeActions::hoist(const IR::IndexedVector<IR::StatOrDecl>& stats) {
+    auto moves = [this](const IR::StatOrDecl* s) {
+        if (auto *as = s->to<IR::AssignmentStatement>())
+            return mustMove(as);
+        if (auto *mc = s->to<IR::MethodCallStatement>())
+            return mustMove(mc);
+        return false; };
+    std::vector<const IR::StatOrDecl*> result;
+    for (auto it = stats.begin(); it != stats.end(); ++it) {
+        auto ifs = (*it)->to<IR::IfStatement>();
+        if (!ifs || result.empty() || !moves(result.back()) || it + 1 == stats.end() ||
+            !moves(it[1])) {
+            result.push_back(*it);
+            continue; }
+        Accesses cond(refMap, typeMap, ifs);
+        auto next = it + 1;
+        for (; next != stats.end() && moves(*next); ++next) {
+            if (!Accesses(refMap, typeMap, *next).independent(cond))
+                break;
+            LOG3("Moving " << *next << " before " << ifs->condition);
+            result.push_back(*next); }
+        result.push_back(ifs);
+        it = next - 1;
+    }
+    return result;
+}
+
 const IR::Node* DoSynthesizeActions::preorder(IR::BlockStatement* statement) {
     // Find a chain of statements to convert
     auto actbody = new IR::BlockStatement;  // build here new action
     auto left = new IR::BlockStatement(statement->annotations);  // leftover statements
 
-    for (auto c : statement->components) {
+    std::vector<const IR::StatOrDecl*> components;
+    if (policy && policy->coalesce())
+        components = hoist(statement->components);
+    else
+        components.assign(statement->components.begin(), statement->components.end());
+    for (auto c : components) {
         bool moveToAction = false;
         if (auto *as = c->to<IR::AssignmentStatement>()) {
             moveToAction = mustMove(as);
@@ -192,13 +337,20 @@ static cstring createName(const Util::SourceInfo &si) {
 
 const IR::Statement* DoSynthesizeActions::createAction(const IR::Statement* toAdd) {
     changes = true;
-    auto name = refMap->newName(createName(toAdd->srcInfo));
     const IR::BlockStatement* body;
     if (toAdd->is<IR::BlockStatement>()) {
         body = toAdd->to<IR::BlockStatement>();
     } else {
         body = new IR::BlockStatement(toAdd->srcInfo, { toAdd });
     }
+    if (policy && policy->coalesce()) {
+        for (auto a : actions) {
+            if (a->body->equiv(*body)) {
+                LOG3("Sharing action " << a->name << body);
+                auto repl = new IR::MethodCallExpression(toAdd->srcInfo,
+                                                         new IR::PathExpression(a->name));
+                return new IR::MethodCallStatement(toAdd->srcInfo, repl); } } }
+    auto name = refMap->newName(createName(toAdd->srcInfo));
     LOG3("Adding new action " << name << body);
 
     auto annos = new IR::Annotations();
@@ -49,6 +49,15 @@ class ActionSynthesisPolicy {
     virtual bool can_combine(const Visitor::Context *, const IR::BlockStatement *,
                              const IR::StatOrDecl *) {
         return true; }
+
+    /**
+       If true, statements are coalesced into fewer synthesized actions: synthesized
+       actions with the same body in a control are shared, and statements put into an
+       action move before an if statement they are independent of, joining the action
+       before it.  Each synthesized action call becomes a table applied by each packet,
+       so this is worth it for targets such as BMv2.
+    */
+    virtual bool coalesce() { return false; }
 };
 
 /**
@@ -139,6 +148,9 @@ class DoSynthesizeActions : public Transform {
 
  protected:
     const IR::Statement* createAction(const IR::Statement* body);
+    /// The statements of a block, with those that must move hoisted above the if
+    /// statements they are independent of, when they would join a preceding action.
+    std::vector<const IR::StatOrDecl*> hoist(const IR::IndexedVector<IR::StatOrDecl>& stats);
 };
 
 class SynthesizeActions : public PassManager {
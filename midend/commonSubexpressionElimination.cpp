@@ -0,0 +1,374 @@
+#include "commonSubexpressionElimination.h"
+
+#include <algorithm>
+#include <map>
+
+#include "expr_uses.h"
+#include "frontends/p4/typeChecking/syntacticEquivalence.h"
+#include "lib/stringify.h"
+
+namespace P4 {
+
+namespace {
+
+/// An expression that may be computed once for several statements.
+struct Occurrence {
+    const IR::Expression* expression;
+    int                   parent;  // index of the innermost occurrence containing it, or -1
+    size_t                cls;     // of the expressions that compute the same value
+    size_t                size;    // number of expressions in it
+};
+
+bool hasCall(const IR::Node* node) {
+    bool result = false;
+    forAllMatching<IR::MethodCallExpression>(node, [&](const IR::MethodCallExpression*) {
+        result = true; });
+    return result;
+}
+
+/// The expressions of a statement that are evaluated before the statement has any effect.
+std::vector<const IR::Expression*> roots(const IR::StatOrDecl* statement) {
+    const IR::Expression* expression = nullptr;
+    if (auto assign = statement->to<IR::AssignmentStatement>())
+        expression = assign->right;
+    else if (auto decl = statement->to<IR::Declaration_Variable>())
+        expression = decl->initializer;
+    else if (auto call = statement->to<IR::MethodCallStatement>())
+        expression = call->methodCall;
+    else if (auto ifs = statement->to<IR::IfStatement>())
+        expression = ifs->condition;
+    if (expression == nullptr)
+        return {};
+
+    if (auto call = expression->to<IR::MethodCallExpression>()) {
+        // the arguments are all evaluated before the call
+        if (hasCall(call->arguments))
+            return {};
+        std::vector<const IR::Expression*> result;
+        for (auto arg : *call->arguments)
+            result.push_back(arg->expression);
+        return result;
+    }
+    if (hasCall(expression))
+        return {};
+    return { expression };
+}
+
+/// The name of the location written by assigning to @expression, as understood by
+/// exprUses, or nullptr if it is not known.
+cstring written(const IR::Expression* expression) {
+    if (auto path = expression->to<IR::PathExpression>())
+        return path->path->name;
+    if (auto member = expression->to<IR::Member>()) {
+        auto base = written(member->expr);
+        if (!base || (member->expr->type && member->expr->type->is<IR::Type_Stack>()))
+            return base;  // next or last may be any element
+        return base + "." + member->member;
+    }
+    if (auto index = expression->to<IR::ArrayIndex>()) {
+        auto base = written(index->left);
+        if (!base) return base;
+        if (auto k = index->right->to<IR::Constant>())
+            return base + "[" + Util::toString(k->asInt()) + "]";
+        return base;
+    }
+    if (auto slice = expression->to<IR::Slice>())
+        return written(slice->e0);
+    return nullptr;
+}
+
+/// Finds the expressions in an expression that are worth computing only once.
+class FindOccurrences : public Inspector {
+    const TypeMap*              typeMap;
+    std::vector<Occurrence>&    found;
+    std::vector<int>            open;  // the occurrences containing the current expression
+    size_t                      count = 0;
+
+    bool candidate(const IR::Expression* expression) const {
+        if (expression->is<IR::Slice>()) {
+            // may be an out argument
+            if (getContext() && getContext()->node->is<IR::Argument>())
+                return false;
+        } else if (!(expression->is<IR::Operation_Binary>() &&
+                     !expression->is<IR::ArrayIndex>()) &&
+                   !(expression->is<IR::Operation_Unary>() && !expression->is<IR::Member>()) &&
+                   !expression->is<IR::Mux>()) {
+            return false;
+        }
+        auto type = typeMap->getType(expression);
+        if (type == nullptr || !(type->is<IR::Type_Bits>() || type->is<IR::Type_Boolean>()))
+            return false;
+        bool reads = false;
+        forAllMatching<IR::PathExpression>(expression, [&](const IR::PathExpression*) {
+            reads = true; });
+        return reads;
+    }
+
+ public:
+    FindOccurrences(const TypeMap* typeMap, std::vector<Occurrence>& found) :
+            typeMap(typeMap), found(found) { visitDagOnce = false; }
+
+    bool preorder(const IR::Expression* expression) override {
+        ++count;
+        if (candidate(expression)) {
+            int parent = open.empty() ? -1 : open.back();
+            open.push_back(found.size());
+            found.push_back({ expression, parent, 0, count });
+        }
+        return true;
+    }
+    void postorder(const IR::Expression* expression) override {
+        if (!open.empty() && found[open.back()].expression == expression) {
+            auto& occurrence = found[open.back()];
+            occurrence.size = count - occurrence.size + 1;
+            open.pop_back();
+        }
+    }
+};
+
+/// Replaces the occurrences of the expressions computed into temporaries, in the parts of
+/// a statement returned by roots().
+class ReplaceOccurrences : public Transform {
+    const std::map<const IR::Expression*, cstring>& temporaries;
+    const IR::Expression* keep;  // the expression a temporary is computed from
+
+ public:
+    ReplaceOccurrences(const std::map<const IR::Expression*, cstring>& temporaries,
+                       const IR::Expression* keep = nullptr) :
+            temporaries(temporaries), keep(keep) { visitDagOnce = false; }
+
+    const IR::Node* preorder(IR::AssignmentStatement* statement) override {
+        visit(statement->right, "right");
+        prune();
+        return statement;
+    }
+    const IR::Node* preorder(IR::Declaration_Variable* decl) override {
+        if (decl->initializer)
+            visit(decl->initializer, "initializer");
+        prune();
+        return decl;
+    }
+    const IR::Node* preorder(IR::IfStatement* statement) override {
+        visit(statement->condition, "condition");
+        prune();
+        return statement;
+    }
+    const IR::Node* preorder(IR::MethodCallExpression* call) override {
+        visit(call->arguments, "arguments");
+        prune();
+        return call;
+    }
+    const IR::Node* preorder(IR::Expression* expression) override {
+        auto original = getOriginal<IR::Expression>();
+        auto it = temporaries.find(original);
+        if (original != keep && it != temporaries.end()) {
+            prune();
+            return new IR::PathExpression(expression->srcInfo, expression->type,
+                                          new IR::Path(it->second));
+        }
+        return expression;
+    }
+};
+
+}  // namespace
+
+void DoCommonSubexpressionElimination::eliminate(IR::IndexedVector<IR::StatOrDecl>& components) {
+    struct Class {
+        const IR::Expression*   expression;  // the first one
+        size_t                  size;
+        /// (statement, occurrence) of each expression of the class, in order
+        std::vector<std::pair<size_t, int>> occurrences;
+        bool                    selected = false;
+        std::pair<size_t, int>  def;  // the occurrence computed into the temporary
+        cstring                 temporary;
+    };
+    std::vector<std::vector<Occurrence>> found(components.size());
+    std::vector<Class> classes;
+
+    // Group the expressions that compute the same value.
+    SameExpressionSet available(refMap, typeMap);
+    std::map<const IR::Expression*, size_t> classOf;  // of the expressions in 'available'
+    auto makeUnavailable = [&](cstring name) {
+        std::vector<const IR::Expression*> keep;
+        for (auto& c : classOf)
+            if (name && !exprUses(c.first, name))
+                keep.push_back(c.first);
+        std::map<const IR::Expression*, size_t> kept;
+        available.clear();
+        for (auto e : keep) {
+            available.insert(e);
+            kept.emplace(e, classOf.at(e)); }
+        classOf.swap(kept); };
+    for (size_t i = 0; i < components.size(); i++) {
+        auto statement = components.at(i);
+        FindOccurrences find(typeMap, found[i]);
+        for (auto root : roots(statement))
+            (void)root->apply(find);
+        for (size_t o = 0; o < found[i].size(); o++) {
+            auto& occurrence = found[i][o];
+            auto first = available.find(occurrence.expression);
+            if (first == nullptr) {
+                occurrence.cls = classes.size();
+                classes.push_back(Class());
+                classes.back().expression = occurrence.expression;
+                classes.back().size = occurrence.size;
+                available.insert(occurrence.expression);
+                classOf.emplace(occurrence.expression, occurrence.cls);
+            } else {
+                occurrence.cls = classOf.at(first);
+            }
+            classes[occurrence.cls].occurrences.emplace_back(i, o);
+        }
+
+        if (statement->is<IR::EmptyStatement>())
+            continue;
+        cstring name;
+        if (auto assign = statement->to<IR::AssignmentStatement>()) {
+            if (!hasCall(assign->right))
+                name = written(assign->left);
+        } else if (auto decl = statement->to<IR::Declaration_Variable>()) {
+            if (!decl->initializer || !hasCall(decl->initializer))
+                name = decl->name;
+        }
+        // a call or a nested statement may write anything
+        makeUnavailable(name);
+    }
+
+    // Choose the classes, the largest expressions first, so that the occurrences inside
+    // the expressions that are replaced are not counted.
+    std::vector<size_t> order;
+    for (size_t c = 0; c < classes.size(); c++)
+        order.push_back(c);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return classes[a].size > classes[b].size; });
+    auto survives = [&](size_t i, int o) {
+        for (int p = found[i][o].parent; p >= 0; p = found[i][p].parent) {
+            auto& c = classes[found[i][p].cls];
+            if (c.selected && c.def != std::make_pair(i, p))
+                return false; }
+        return true; };
+    bool changes = false;
+    for (auto c : order) {
+        auto& cls = classes[c];
+        std::vector<std::pair<size_t, int>> survivors;
+        for (auto occurrence : cls.occurrences)
+            if (survives(occurrence.first, occurrence.second))
+                survivors.push_back(occurrence);
+        if (survivors.size() < 2)
+            continue;
+        cls.selected = true;
+        cls.def = survivors.front();
+        cls.temporary = refMap->newName("cse");
+        auto type = typeMap->getType(cls.expression, true);
+        temporaries.back().push_back(new IR::Declaration_Variable(cls.temporary, type));
+        LOG3("Computing " << cls.expression << " once into " << cls.temporary << " for " <<
+             survivors.size() << " uses");
+        changes = true;
+    }
+    if (!changes)
+        return;
+
+    IR::IndexedVector<IR::StatOrDecl> result;
+    for (size_t i = 0; i < components.size(); i++) {
+        std::map<const IR::Expression*, cstring> replace;
+        std::vector<const Occurrence*> defs;
+        for (size_t o = 0; o < found[i].size(); o++) {
+            auto& occurrence = found[i][o];
+            auto& cls = classes[occurrence.cls];
+            if (!cls.selected)
+                continue;
+            replace.emplace(occurrence.expression, cls.temporary);
+            if (cls.def == std::make_pair(i, int(o)))
+                defs.push_back(&occurrence);
+        }
+        if (replace.empty()) {
+            result.push_back(components.at(i));
+            continue;
+        }
+        // the temporaries used by the others are computed first
+        std::stable_sort(defs.begin(), defs.end(), [](const Occurrence* a, const Occurrence* b) {
+            return a->size < b->size; });
+        for (auto def : defs) {
+            auto value = def->expression->apply(ReplaceOccurrences(replace, def->expression));
+            auto temporary = new IR::PathExpression(def->expression->srcInfo, value->type,
+                                                    new IR::Path(classes[def->cls].temporary));
+            result.push_back(new IR::AssignmentStatement(def->expression->srcInfo,
+                                                         temporary, value));
+        }
+        auto statement = components.at(i)->apply(ReplaceOccurrences(replace));
+        result.push_back(statement->to<IR::StatOrDecl>());
+    }
+    components = result;
+}
+
+void DoCommonSubexpressionElimination::declare(IR::IndexedVector<IR::Declaration>& locals) {
+    for (auto decl : temporaries.back())
+        locals.push_back(decl);
+    temporaries.pop_back();
+}
+
+const IR::Node* DoCommonSubexpressionElimination::preorder(IR::P4Action* action) {
+    temporaries.emplace_back();
+    return action;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::postorder(IR::P4Action* action) {
+    if (!temporaries.back().empty()) {
+        auto body = action->body->clone();
+        body->components.insert(body->components.begin(), temporaries.back().begin(),
+                                temporaries.back().end());
+        action->body = body;
+    }
+    temporaries.pop_back();
+    return action;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::preorder(IR::Function* function) {
+    temporaries.emplace_back();
+    return function;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::postorder(IR::Function* function) {
+    if (!temporaries.back().empty()) {
+        auto body = function->body->clone();
+        body->components.insert(body->components.begin(), temporaries.back().begin(),
+                                temporaries.back().end());
+        function->body = body;
+    }
+    temporaries.pop_back();
+    return function;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::preorder(IR::P4Control* control) {
+    temporaries.emplace_back();
+    return control;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::postorder(IR::P4Control* control) {
+    declare(control->controlLocals);
+    return control;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::preorder(IR::P4Parser* parser) {
+    temporaries.emplace_back();
+    return parser;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::postorder(IR::P4Parser* parser) {
+    declare(parser->parserLocals);
+    return parser;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::postorder(IR::BlockStatement* block) {
+    if (!temporaries.empty())
+        eliminate(block->components);
+    return block;
+}
+
+const IR::Node* DoCommonSubexpressionElimination::postorder(IR::ParserState* state) {
+    if (!temporaries.empty())
+        eliminate(state->components);
+    return state;
+}
+
+}  // namespace P4
@@ -0,0 +1,95 @@
+#ifndef _MIDEND_COMMONSUBEXPRESSIONELIMINATION_H_
+#define _MIDEND_COMMONSUBEXPRESSIONELIMINATION_H_
+
+#include <vector>
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * Computes the expressions that are evaluated more than once in a sequence of statements
+ * only once, into a temporary.
+ *
+ * \code{.cpp}
+ *  action a() {
+ *    h.ttl = h.ttl - 1;
+ *    m.ttl = h.ttl - 1;
+ *    m.x = (m.a + m.b) & 0xf;
+ *    m.y = (m.a + m.b) | 1;
+ *  }
+ * \endcode
+ *
+ * is transformed to
+ *
+ * \code{.cpp}
+ *  action a() {
+ *    bit<8> cse;
+ *    h.ttl = h.ttl - 1;
+ *    m.ttl = h.ttl - 1;
+ *    cse = m.a + m.b;
+ *    m.x = cse & 0xf;
+ *    m.y = cse | 1;
+ *  }
+ * \endcode
+ *
+ * The statements of a block (or of a parser state) are scanned in order.  An expression
+ * is only reused while nothing it reads is written: an assignment makes the expressions
+ * that use its destination unavailable, and a statement that calls a method or contains
+ * other statements makes all of them unavailable.  Only the right-hand sides of
+ * assignments, the initializers of variables, the arguments of method calls and the
+ * conditions of if statements are searched.  The expressions considered are the
+ * operations with a bit or boolean type, that read some variable and call no method.
+ * When an expression is reused, the repeated expressions inside it are not computed
+ * separately unless they also appear elsewhere.  The temporaries are declared in the
+ * enclosing action, function, control or parser.
+ *
+ * @pre The expressions are typed (e.g. by TypeChecking with updateExpressions).
+ */
+class DoCommonSubexpressionElimination : public Transform {
+    ReferenceMap*   refMap;
+    TypeMap*        typeMap;
+    /// The temporaries declared in each enclosing action, function, control or parser.
+    std::vector<IR::IndexedVector<IR::Declaration>> temporaries;
+
+    void eliminate(IR::IndexedVector<IR::StatOrDecl>& components);
+    /// Adds the temporaries of the innermost enclosing object to @locals.
+    void declare(IR::IndexedVector<IR::Declaration>& locals);
+
+ public:
+    DoCommonSubexpressionElimination(ReferenceMap* refMap, TypeMap* typeMap) :
+            refMap(refMap), typeMap(typeMap) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap);
+        setName("DoCommonSubexpressionElimination");
+    }
+
+    const IR::Node* preorder(IR::P4Action* action) override;
+    const IR::Node* postorder(IR::P4Action* action) override;
+    const IR::Node* preorder(IR::Function* function) override;
+    const IR::Node* postorder(IR::Function* function) override;
+    const IR::Node* preorder(IR::P4Control* control) override;
+    const IR::Node* postorder(IR::P4Control* control) override;
+    const IR::Node* preorder(IR::P4Parser* parser) override;
+    const IR::Node* postorder(IR::P4Parser* parser) override;
+    const IR::Node* postorder(IR::BlockStatement* block) override;
+    const IR::Node* postorder(IR::ParserState* state) override;
+};
+
+class CommonSubexpressionElimination : public PassManager {
+ public:
+    CommonSubexpressionElimination(ReferenceMap* refMap, TypeMap* typeMap,
+                                   TypeChecking* typeChecking = nullptr) {
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap, true);
+        passes.push_back(typeChecking);
+        passes.push_back(new DoCommonSubexpressionElimination(refMap, typeMap));
+        setName("CommonSubexpressionElimination");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_COMMONSUBEXPRESSIONELIMINATION_H_ */
@@ -39,6 +39,7 @@ class CompileTimeOperations : public Inspector {
     { err(expression); }
     void postorder(const IR::Div* expression) override
     { err(expression); }
+    bool canFuse() const override { return true; }
 };
 
 }  // namespace P4
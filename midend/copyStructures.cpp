@@ -96,6 +96,10 @@ const IR::Node* DoCopyStructures::postorder(IR::AssignmentStatement* statement)
                       statement->right->is<IR::ArrayIndex>(),
                       "%1%: Unexpected operation when eliminating struct copying",
                       statement->right);
+            if (policy != nullptr && ltype->is<IR::Type_Struct>() &&
+                policy->copyAsBlock(ltype->to<IR::Type_Struct>()))
+                // The target copies the whole structure at once
+                return statement;
             for (auto f : strct->fields) {
                 auto right = new IR::Member(statement->right, f->name);
                 auto left = new IR::Member(statement->left, f->name);
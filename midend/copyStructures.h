@@ -22,6 +22,18 @@ limitations under the License.
 
 namespace P4 {
 
+/**
+ * Policy used by CopyStructures: a target that copies structures with a single operation
+ * (memcpy, wide stores or a move) can keep some struct to struct copies.
+ */
+class CopyStructuresPolicy {
+ public:
+    virtual ~CopyStructuresPolicy() {}
+    /// True if assignments between two values of @type should be kept as a single copy
+    /// instead of one assignment per field.  By default no copy is kept.
+    virtual bool copyAsBlock(const IR::Type_Struct* type) const { (void)type; return false; }
+};
+
 /**
  * Convert assignments between structures to assignments between fields
  *
@@ -44,7 +56,9 @@ namespace P4 {
  *
  *   Further, struct initialization is converted to assignment on struct fields
  *
- *   Note, header assignments are not converted in this pass.
+ *   Note, header assignments are not converted in this pass, and neither are
+ *   copies from a structure stored in a variable, field or stack element when the
+ *   CopyStructuresPolicy keeps them as a block copy.
  *
  * @pre none
  * @post
@@ -59,9 +73,12 @@ class DoCopyStructures : public Transform {
      * errorOnMethodCall flag will produce an error message if such a
      * method is encountered. */
     bool errorOnMethodCall;
+    /// If not null, decides which struct copies are kept.
+    const CopyStructuresPolicy* policy;
  public:
-    explicit DoCopyStructures(TypeMap* typeMap, bool errorOnMethodCall) :
-            typeMap(typeMap), errorOnMethodCall(errorOnMethodCall)
+    explicit DoCopyStructures(TypeMap* typeMap, bool errorOnMethodCall,
+                              const CopyStructuresPolicy* policy = nullptr) :
+            typeMap(typeMap), errorOnMethodCall(errorOnMethodCall), policy(policy)
     { CHECK_NULL(typeMap); setName("DoCopyStructures"); }
     const IR::Node* postorder(IR::AssignmentStatement* statement) override;
 };
@@ -106,7 +123,8 @@ class CopyStructures : public PassRepeated {
  public:
     CopyStructures(ReferenceMap* refMap, TypeMap* typeMap,
                    bool errorOnMethodCall = true,
-                   TypeChecking* typeChecking = nullptr) :
+                   TypeChecking* typeChecking = nullptr,
+                   const CopyStructuresPolicy* policy = nullptr) :
             PassManager({}) {
         CHECK_NULL(refMap); CHECK_NULL(typeMap); setName("CopyStructures");
         if (!typeChecking)
@@ -114,7 +132,7 @@ class CopyStructures : public PassRepeated {
         passes.emplace_back(typeChecking);
         passes.emplace_back(new RemoveAliases(refMap, typeMap));
         passes.emplace_back(typeChecking);
-        passes.emplace_back(new DoCopyStructures(typeMap, errorOnMethodCall));
+        passes.emplace_back(new DoCopyStructures(typeMap, errorOnMethodCall, policy));
     }
 };
 
@@ -26,11 +26,33 @@ const IR::Node* DoEliminateSwitch::postorder(IR::P4Control* control) {
     return control;
 }
 
+bool DoEliminateSwitch::isDense(const IR::SwitchStatement* statement) const {
+    if (!typeMap->getType(statement->expression)->is<IR::Type_Bits>())
+        return false;
+    unsigned labels = 0;
+    big_int min, max;
+    for (auto sc : statement->cases) {
+        if (sc->label->is<IR::DefaultExpression>())
+            continue;
+        auto constant = sc->label->to<IR::Constant>();
+        if (constant == nullptr)
+            return false;
+        if (labels == 0 || constant->value < min)
+            min = constant->value;
+        if (labels == 0 || constant->value > max)
+            max = constant->value;
+        labels++;
+    }
+    return labels >= minDenseCases && max - min < 2 * labels;
+}
+
 const IR::Node* DoEliminateSwitch::postorder(IR::SwitchStatement* statement) {
     auto type = typeMap->getType(statement->expression);
     if (type->is<IR::Type_ActionEnum>())
         // Classic switch; no changes needed
         return statement;
+    if (keepDense && isDense(statement))
+        return statement;
 
     auto src = statement->srcInfo;
     IR::IndexedVector<IR::StatOrDecl> contents;
@@ -48,13 +70,13 @@ const IR::Node* DoEliminateSwitch::postorder(IR::SwitchStatement* statement) {
 
     auto tableKeyEl = new IR::KeyElement(
         src, new IR::PathExpression(key),
-        new IR::PathExpression(P4CoreLibrary::instance.exactMatch.Id()));
+        new IR::PathExpression(P4CoreLibrary::instance().exactMatch.Id()));
     IR::IndexedVector<IR::ActionListElement> actionsList;
     IR::IndexedVector<IR::Property> properties;
     IR::Vector<IR::SwitchCase> cases;
     IR::Vector<IR::Entry> entries;
     properties.push_back(new IR::Property(src, "key", new IR::Key({tableKeyEl}), false));
-    IR::ID defaultAction = P4CoreLibrary::instance.noAction.Id();
+    IR::ID defaultAction = P4CoreLibrary::instance().noAction.Id();
 
     // Create actions
     IR::Vector<IR::Expression> pendingLabels;  // switch labels with no statement
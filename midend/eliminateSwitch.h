@@ -73,15 +73,27 @@ switch1_case_4:       { ... }
 switch1_case_default: { ... }
 }
 
+If keepDense is set, switch statements on bit<N> values whose labels
+are at least minDenseCases constants covering at least half of the
+range between the smallest and the largest label are left unchanged:
+software targets compile these to a jump table, which is cheaper than
+a table lookup or a chain of comparisons.
+
  */
 class DoEliminateSwitch final : public Transform {
     ReferenceMap* refMap;
     const TypeMap* typeMap;
+    bool keepDense;
     std::vector<const IR::Declaration*> toInsert;
  public:
-    explicit DoEliminateSwitch(ReferenceMap* refMap, const TypeMap* typeMap):
-            refMap(refMap), typeMap(typeMap)
+    static const unsigned minDenseCases = 4;
+
+    explicit DoEliminateSwitch(ReferenceMap* refMap, const TypeMap* typeMap,
+                               bool keepDense = false):
+            refMap(refMap), typeMap(typeMap), keepDense(keepDense)
     { setName("DoEliminateSwitch"); CHECK_NULL(refMap); CHECK_NULL(typeMap); }
+    /// True if @statement switches on a bit<N> value with dense constant labels.
+    bool isDense(const IR::SwitchStatement* statement) const;
     const IR::Node* postorder(IR::SwitchStatement* statement) override;
     const IR::Node* postorder(IR::P4Control* control) override;
 };
@@ -89,11 +101,11 @@ class DoEliminateSwitch final : public Transform {
 class EliminateSwitch final : public PassManager {
  public:
     EliminateSwitch(ReferenceMap* refMap, TypeMap* typeMap,
-                    TypeChecking* typeChecking = nullptr) {
+                    TypeChecking* typeChecking = nullptr, bool keepDense = false) {
         if (!typeChecking)
             typeChecking = new TypeChecking(refMap, typeMap);
         passes.push_back(typeChecking);
-        passes.push_back(new DoEliminateSwitch(refMap, typeMap));
+        passes.push_back(new DoEliminateSwitch(refMap, typeMap, keepDense));
         passes.push_back(new ClearTypeMap(typeMap));
         setName("EliminateSwitch");
     }
@@ -19,6 +19,22 @@ limitations under the License.
 
 namespace P4 {
 
+const cstring DoExpandEmit::headerRunAnnotation = "header_run";
+
+int DoExpandEmit::fixedWidth(const IR::Type* type) const {
+    auto header = type->to<IR::Type_Header>();
+    if (header == nullptr)
+        return -1;
+    int width = 0;
+    for (auto f : header->fields) {
+        auto ftype = typeMap->getTypeType(f->type, true);
+        if (ftype->is<IR::Type_Varbits>())
+            return -1;
+        width += ftype->width_bits();
+    }
+    return width;
+}
+
 bool DoExpandEmit::expandArg(
     const IR::Type* type, const IR::Argument* arg,
     std::vector<const IR::Argument*> *result, std::vector<const IR::Type*> *resultTypes) {
@@ -61,8 +77,8 @@ bool DoExpandEmit::expandArg(
 const IR::Node* DoExpandEmit::postorder(IR::MethodCallStatement* statement) {
     auto mi = MethodInstance::resolve(statement->methodCall, refMap, typeMap);
     if (auto em = mi->to<P4::ExternMethod>()) {
-        if (em->originalExternType->name.name == P4::P4CoreLibrary::instance.packetOut.name &&
-            em->method->name.name == P4::P4CoreLibrary::instance.packetOut.emit.name) {
+        if (em->originalExternType->name.name == P4::P4CoreLibrary::instance().packetOut.name &&
+            em->method->name.name == P4::P4CoreLibrary::instance().packetOut.emit.name) {
             if (em->expr->arguments->size() != 1) {
                 ::error(ErrorType::ERR_UNEXPECTED, "%1%: expected exactly 1 argument", statement);
                 return statement;
@@ -74,6 +90,19 @@ const IR::Node* DoExpandEmit::postorder(IR::MethodCallStatement* statement) {
             std::vector<const IR::Type*> expansionTypes;
             if (expandArg(type, arg0, &expansion, &expansionTypes)) {
                 auto vec = new IR::IndexedVector<IR::StatOrDecl>();
+                // the current run of fixed-size headers, and their widths
+                auto run = new IR::IndexedVector<IR::StatOrDecl>();
+                auto widths = new IR::Vector<IR::Expression>();
+                auto endRun = [&]() {
+                    if (run->size() > 1) {
+                        auto annos = new IR::Annotations();
+                        annos->add(new IR::Annotation(headerRunAnnotation, *widths));
+                        vec->push_back(new IR::BlockStatement(annos, *run));
+                    } else {
+                        vec->append(*run);
+                    }
+                    run = new IR::IndexedVector<IR::StatOrDecl>();
+                    widths = new IR::Vector<IR::Expression>(); };
                 auto it = expansionTypes.begin();
                 for (auto e : expansion) {
                     auto method = statement->methodCall->method->clone();
@@ -85,9 +114,17 @@ const IR::Node* DoExpandEmit::postorder(IR::MethodCallStatement* statement) {
                     auto mce = new IR::MethodCallExpression(
                         statement->methodCall->srcInfo, method, typeArgs, args);
                     auto stat = new IR::MethodCallStatement(mce);
-                    vec->push_back(stat);
+                    int width = headerRuns ? fixedWidth(argType) : -1;
+                    if (width < 0) {
+                        endRun();
+                        vec->push_back(stat);
+                    } else {
+                        run->push_back(stat);
+                        widths->push_back(new IR::Constant(width));
+                    }
                     ++it;
                 }
+                endRun();
                 return new IR::BlockStatement(*vec);
             }
         }
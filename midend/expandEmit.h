@@ -40,13 +40,32 @@ namespace P4 {
  * emit(s.h1);
  * emit(s.h2[0]);
  * emit(s.h2[1]);
+ *
+ * For targets that can copy a run of headers at once (when they are all valid), with
+ * headerRuns each run of two or more consecutive fixed-size headers in the expansion is
+ * put in a block annotated with its layout, the width in bits of each header:
+ *
+ * @header_run(8, 16, 16) {
+ *     emit(s.h1);
+ *     emit(s.h2[0]);
+ *     emit(s.h2[1]);
+ * }
+ *
+ * Headers with varbit fields end a run.  Other targets see the same emits as before.
  */
 class DoExpandEmit : public Transform {
     ReferenceMap* refMap;
     TypeMap* typeMap;
+    bool headerRuns;
+
+    /// The width of headers of @type, or -1 if it has a varbit field.
+    int fixedWidth(const IR::Type* type) const;
+
  public:
-    DoExpandEmit(ReferenceMap* refMap, TypeMap* typeMap):
-            refMap(refMap), typeMap(typeMap)
+    static const cstring headerRunAnnotation;
+
+    DoExpandEmit(ReferenceMap* refMap, TypeMap* typeMap, bool headerRuns = false):
+            refMap(refMap), typeMap(typeMap), headerRuns(headerRuns)
     { CHECK_NULL(refMap); CHECK_NULL(typeMap); setName("DoExpandEmit"); }
     // return true if the expansion produced something "new"
     bool expandArg(const IR::Type* type, const IR::Argument* argument,
@@ -58,12 +77,12 @@ class DoExpandEmit : public Transform {
 class ExpandEmit : public PassManager {
  public:
     ExpandEmit(ReferenceMap* refMap, TypeMap* typeMap,
-            TypeChecking* typeChecking = nullptr) {
+            TypeChecking* typeChecking = nullptr, bool headerRuns = false) {
         setName("ExpandEmit");
         if (!typeChecking)
             typeChecking = new TypeChecking(refMap, typeMap);
         passes.push_back(typeChecking);
-        passes.push_back(new DoExpandEmit(refMap, typeMap));
+        passes.push_back(new DoExpandEmit(refMap, typeMap, headerRuns));
     }
 };
 
@@ -72,8 +72,8 @@ DoExpandLookahead::convertLookahead(const IR::MethodCallExpression* expression)
     if (!mi->is<P4::ExternMethod>())
         return nullptr;
     auto em = mi->to<P4::ExternMethod>();
-    if (em->originalExternType->name != P4CoreLibrary::instance.packetIn.name ||
-        em->method->name != P4CoreLibrary::instance.packetIn.lookahead.name)
+    if (em->originalExternType->name != P4CoreLibrary::instance().packetIn.name ||
+        em->method->name != P4CoreLibrary::instance().packetIn.lookahead.name)
         return nullptr;
 
     // this is a call to packet_in.lookahead.
@@ -83,6 +83,8 @@ DoExpandLookahead::convertLookahead(const IR::MethodCallExpression* expression)
     auto typearg = typeMap->getTypeType(targ, true);
     if (!typearg->is<IR::Type_StructLike>() && !typearg->is<IR::Type_Tuple>())
         return nullptr;
+    if (!expandHeaders && typearg->is<IR::Type_Header>())
+        return nullptr;
 
     int width = typeMap->minWidthBits(typearg, expression);
     if (width < 0)
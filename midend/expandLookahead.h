@@ -32,10 +32,13 @@ namespace P4 {
 /// a.m0 = tmp[f1,f0];
 /// a.m1 = tmp[f2, f1+1];
 /// ...
+/// Targets that can look ahead at a header in one copy can leave lookaheads of a single
+/// header type unexpanded, with expandHeaders false.
 class DoExpandLookahead : public Transform {
     P4::ReferenceMap* refMap;
     P4::TypeMap* typeMap;
     IR::IndexedVector<IR::Declaration> newDecls;
+    bool expandHeaders;
 
     struct ExpansionInfo {
         const IR::Statement* statement;
@@ -51,8 +54,8 @@ class DoExpandLookahead : public Transform {
     ExpansionInfo* convertLookahead(const IR::MethodCallExpression* expression);
 
  public:
-    DoExpandLookahead(ReferenceMap* refMap, TypeMap* typeMap) :
-            refMap(refMap), typeMap(typeMap) {
+    DoExpandLookahead(ReferenceMap* refMap, TypeMap* typeMap, bool expandHeaders = true) :
+            refMap(refMap), typeMap(typeMap), expandHeaders(expandHeaders) {
         CHECK_NULL(refMap); CHECK_NULL(typeMap); setName("DoExpandLookahead"); }
     const IR::Node* postorder(IR::AssignmentStatement* statement) override;
     const IR::Node* postorder(IR::MethodCallStatement* statement) override;
@@ -70,11 +73,11 @@ class DoExpandLookahead : public Transform {
 class ExpandLookahead : public PassManager {
  public:
     ExpandLookahead(ReferenceMap* refMap, TypeMap* typeMap,
-            TypeChecking* typeChecking = nullptr) {
+            TypeChecking* typeChecking = nullptr, bool expandHeaders = true) {
         if (!typeChecking)
             typeChecking = new TypeChecking(refMap, typeMap);
         passes.push_back(typeChecking);
-        passes.push_back(new DoExpandLookahead(refMap, typeMap));
+        passes.push_back(new DoExpandLookahead(refMap, typeMap, expandHeaders));
         setName("ExpandLookahead");
     }
 };
@@ -0,0 +1,39 @@
+#include "flatLayout.h"
+
+namespace P4 {
+
+void FlatLayout::add(cstring path, const IR::Type* type, const IR::Type_StructLike* parent) {
+    cstring name = cstring::concat(path.replace('.', '_'), fields.size());
+    names.emplace(path, name);
+    fields.push_back({ path, name, type, parent });
+}
+
+const FlatLayout* FlatLayouts::get(const IR::Type_StructLike* type) {
+    auto it = layouts.find(type);
+    if (it != layouts.end())
+        return it->second;
+    auto layout = new FlatLayout();
+    if (auto st = type->to<IR::Type_Struct>())
+        layout->structs.emplace("", st);
+    for (auto f : type->fields) {
+        cstring path = cstring::concat('.', f->name);
+        // the fields of canonical types may have no type of their own
+        auto ft = typeMap->getType(f);
+        if (ft == nullptr)
+            ft = f->type;
+        if (auto nested = ft->to<IR::Type_Struct>()) {
+            auto inner = get(nested);
+            for (auto s : inner->structs)
+                layout->structs.emplace(cstring::concat(path, s.first), s.second);
+            for (auto& nf : inner->fields)
+                layout->add(cstring::concat(path, nf.path), nf.type, nf.parent);
+        } else {
+            layout->add(path, ft, type);
+        }
+    }
+    LOG3("Flat layout of " << type << " has " << layout->fields.size() << " fields");
+    layouts.emplace(type, layout);
+    return layout;
+}
+
+}  // namespace P4
@@ -0,0 +1,50 @@
+#ifndef _MIDEND_FLATLAYOUT_H_
+#define _MIDEND_FLATLAYOUT_H_
+
+#include <map>
+#include <vector>
+
+#include "ir/ir.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * The fields of a header or struct type once the structs nested in it are flattened, in
+ * order.  A field is known by its path from the type, for example .t.s.a, and is renamed
+ * after its path and its position, _t_s_a0.
+ */
+struct FlatLayout {
+    struct Field {
+        cstring                         path;
+        cstring                         name;       // the new name
+        const IR::Type*                 type;
+        const IR::Type_StructLike*      parent;     // the header or struct declaring it
+    };
+    std::vector<Field>                          fields;
+    // Maps the paths of the fields to their new names, e.g. .t.s.a -> _t_s_a0
+    std::map<cstring, cstring>                  names;
+    // Maps the paths of the nested structs to their types, e.g. .t -> T, and ""
+    // to the type itself if it is a struct.
+    std::map<cstring, const IR::Type_Struct*>   structs;
+
+    void add(cstring path, const IR::Type* type, const IR::Type_StructLike* parent);
+};
+
+/**
+ * Computes the flat layout of each type once, for all the passes that share it; the
+ * layout of a struct is reused for the headers and structs that nest it.  The types are
+ * the canonical types of @typeMap.
+ */
+class FlatLayouts {
+    const TypeMap*  typeMap;
+    std::map<const IR::Type_StructLike*, const FlatLayout*> layouts;
+
+ public:
+    explicit FlatLayouts(const TypeMap* typeMap) : typeMap(typeMap) { CHECK_NULL(typeMap); }
+    const FlatLayout* get(const IR::Type_StructLike* type);
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_FLATLAYOUT_H_ */
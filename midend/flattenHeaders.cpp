@@ -19,45 +19,30 @@ limitations under the License.
 
 namespace P4 {
 
-void FindHeaderTypesToReplace::HeaderTypeReplacement::flatten(cstring prefix,
-        const IR::Type* type, const IR::Annotations* annos,
-        IR::IndexedVector<IR::StructField> *fields,
-        AnnotationSelectionPolicy *policy) {
-    if (auto st = type->to<IR::Type_StructLike>()) {
-        std::function<bool(const IR::Annotation *)> selector =
-                [&policy](const IR::Annotation *annot) {
-                    if (!policy)
-                        return false;
-                    return policy->keep(annot);
-                };
-        auto annotations = st->annotations->where(selector);
-        for (auto f : st->fields) {
-            auto ft = typeMap->getType(f, true);
-            flatten(prefix + "." + f->name, ft, annotations, fields, policy);
-        }
-        return;
-    }
-    //  cstring originalName = prefix; TODO once behavioral model is fixed.
-    cstring fieldName = prefix.replace(".", "_") +
-                        cstring::to_cstring(fieldNameRemap.size());
-    fieldNameRemap.emplace(prefix, fieldName);
-    fields->push_back(new IR::StructField(IR::ID(fieldName), annos, type->getP4Type()));
-    LOG3("Flatten: " << type << " | " << prefix);
-}
-
 FindHeaderTypesToReplace::HeaderTypeReplacement::HeaderTypeReplacement(
-    const P4::TypeMap* typeMap, const IR::Type_Header* type, AnnotationSelectionPolicy *policy) :
-    typeMap(typeMap) {
-    auto vec = new IR::IndexedVector<IR::StructField>();
-    flatten("", type, IR::Annotations::empty, vec, policy);
-    replacementType = new IR::Type_Header(type->name, type->annotations, *vec);
+    FlatLayouts* layouts, const IR::Type_Header* type, AnnotationSelectionPolicy *policy) :
+    fieldNameRemap(layouts->get(type)->names) {
+    std::function<bool(const IR::Annotation *)> selector =
+            [&policy](const IR::Annotation *annot) {
+                if (!policy)
+                    return false;
+                return policy->keep(annot);
+            };
+    IR::IndexedVector<IR::StructField> fields;
+    // the fields keep the annotations of their struct that the policy selects
+    for (auto& f : layouts->get(type)->fields) {
+        auto annotations = f.parent->annotations->where(selector);
+        fields.push_back(new IR::StructField(IR::ID(f.name), annotations, f.type->getP4Type()));
+        LOG3("Flatten: " << f.type << " | " << f.path);
+    }
+    replacementType = new IR::Type_Header(type->name, type->annotations, fields);
 }
 
 void FindHeaderTypesToReplace::createReplacement(const IR::Type_Header* type,
         AnnotationSelectionPolicy *policy) {
     if (replacement.count(type->name))
         return;
-    replacement.emplace(type->name, new HeaderTypeReplacement(typeMap, type, policy));
+    replacement.emplace(type->name, new HeaderTypeReplacement(layouts, type, policy));
 }
 
 bool FindHeaderTypesToReplace::preorder(const IR::Type_Header* type) {
@@ -94,20 +79,35 @@ const IR::Node* ReplaceHeaders::postorder(IR::Type_Header* type) {
 }
 
 const IR::Node* ReplaceHeaders::postorder(IR::Member* expression) {
+    return replaceField(typeMap, findHeaderTypesToReplace, expression,
+                        getOriginal<IR::Member>(), getParent<IR::Member>() == nullptr);
+}
+
+const IR::Expression* ReplaceHeaders::replaceField(const P4::TypeMap* typeMap,
+                                                   const FindHeaderTypesToReplace* headers,
+                                                   const IR::Member* expression,
+                                                   const IR::Member* original,
+                                                   bool outermost) {
     // Find out if this applies to one of the parameters that are being replaced.
     const IR::Expression* e = expression;
+    const IR::Expression* o = original;
     cstring prefix = "";
     const IR::Type_Header* h = nullptr;
-    while (auto mem = e->to<IR::Member>()) {
-        e = mem->expr;
+    while (auto mem = o->to<IR::Member>()) {
+        auto emem = e->to<IR::Member>();
+        if (emem == nullptr)
+            // the fields of a flattened struct, which contains no header here
+            return expression;
+        e = emem->expr;
+        o = mem->expr;
         prefix = cstring(".") + mem->member + prefix;
-        auto type = typeMap->getType(e, true);
+        auto type = typeMap->getType(o, true);
         if ((h = type->to<IR::Type_Header>())) break;
     }
     if (h == nullptr)
         return expression;
 
-    auto repl = findHeaderTypesToReplace->getReplacement(h->name);
+    auto repl = headers->getReplacement(h->name);
     if (repl == nullptr) {
         return expression;
     }
@@ -116,11 +116,11 @@ const IR::Node* ReplaceHeaders::postorder(IR::Member* expression) {
     auto newFieldName = ::get(repl->fieldNameRemap, prefix);
     const IR::Expression* result;
     if (newFieldName.isNullOrEmpty()) {
-        auto type = typeMap->getType(getOriginal(), true);
+        auto type = typeMap->getType(original, true);
         // This could be, for example, a method like setValid.
         if (!type->is<IR::Type_Struct>())
             return expression;
-        if (getParent<IR::Member>() != nullptr)
+        if (!outermost)
             // We only want to process the outermost Member
             return expression;
         BUG_CHECK(!newFieldName.isNullOrEmpty(),
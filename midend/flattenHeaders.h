@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "ir/ir.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
+#include "flatLayout.h"
 
 namespace P4 {
 
@@ -50,11 +51,11 @@ Find the types to replace and insert them in the nested struct map.
 class FindHeaderTypesToReplace : public Inspector {
     P4::TypeMap* typeMap;
     AnnotationSelectionPolicy *policy;
+    FlatLayouts* layouts;
 
     struct HeaderTypeReplacement : public IHasDbPrint {
-        HeaderTypeReplacement(const P4::TypeMap* typeMap, const IR::Type_Header* type,
+        HeaderTypeReplacement(FlatLayouts* layouts, const IR::Type_Header* type,
                 AnnotationSelectionPolicy *policy);
-        const P4::TypeMap *typeMap;
 
         // Maps nested field names to final field names.
         // In our example this could be:
@@ -62,7 +63,7 @@ class FindHeaderTypesToReplace : public Inspector {
         // .t.s.b -> _t_s_b1;
         // .t.y -> _t_y2;
         // .x -> _x3;
-        std::map<cstring, cstring> fieldNameRemap;
+        const std::map<cstring, cstring>& fieldNameRemap;
         // Holds a new flat type
         // struct M {
         //    bit _t_s_a0;
@@ -74,23 +75,19 @@ class FindHeaderTypesToReplace : public Inspector {
         virtual void dbprint(std::ostream& out) const {
             out << replacementType;
         }
-
-        // Helper for constructor
-        void flatten(cstring prefix,
-                     const IR::Type* type,
-                     const IR::Annotations* annos,
-                     IR::IndexedVector<IR::StructField> *fields,
-                     AnnotationSelectionPolicy *policy);
     };
 
     ordered_map<cstring, HeaderTypeReplacement*> replacement;
 
  public:
+    /// The flat layouts are computed in @layouts, if any.
     explicit FindHeaderTypesToReplace(P4::TypeMap *typeMap,
-            AnnotationSelectionPolicy *policy):
-        typeMap(typeMap), policy(policy) {
+            AnnotationSelectionPolicy *policy, FlatLayouts* layouts = nullptr):
+        typeMap(typeMap), policy(policy), layouts(layouts) {
         setName("FindHeaderTypesToReplace");
         CHECK_NULL(typeMap);
+        if (!layouts)
+            this->layouts = new FlatLayouts(typeMap);
     }
     bool preorder(const IR::Type_Header* type) override;
     void createReplacement(const IR::Type_Header* type, AnnotationSelectionPolicy *policy);
@@ -183,6 +180,15 @@ class ReplaceHeaders : public Transform {
         setName("ReplaceHeaders");
     }
 
+    /// The replacement of @expression if it refers to a field of a header that is replaced,
+    /// or else @expression.  The types are those of its @original, which is the same down
+    /// to the header, although the fields of the header may have been replaced already;
+    /// @outermost if the parent of @expression is not a Member.
+    static const IR::Expression* replaceField(const P4::TypeMap* typeMap,
+                                              const FindHeaderTypesToReplace* headers,
+                                              const IR::Member* expression,
+                                              const IR::Member* original, bool outermost);
+
     const IR::Node* preorder(IR::P4Program* program) override;
     const IR::Node* postorder(IR::Member* expression) override;
     const IR::Node* postorder(IR::Type_Header* type) override;
@@ -18,27 +18,13 @@ limitations under the License.
 
 namespace P4 {
 
-void StructTypeReplacement::flatten(const P4::TypeMap* typeMap,
-                                    cstring prefix,
-                                    const IR::Type* type,
-                                    IR::IndexedVector<IR::StructField> *fields) {
-    if (auto st = type->to<IR::Type_Struct>()) {
-        structFieldMap.emplace(prefix, st);
-        for (auto f : st->fields)
-            flatten(typeMap, prefix + "." + f->name, f->type, fields);
-        return;
-    }
-    cstring fieldName = prefix.replace(".", "_") +
-                        cstring::to_cstring(fieldNameRemap.size());
-    fieldNameRemap.emplace(prefix, fieldName);
-    fields->push_back(new IR::StructField(IR::ID(fieldName), type->getP4Type()));
-}
-
-StructTypeReplacement::StructTypeReplacement(
-    const P4::TypeMap* typeMap, const IR::Type_Struct* type) {
-    auto vec = new IR::IndexedVector<IR::StructField>();
-    flatten(typeMap, "", type, vec);
-    replacementType = new IR::Type_Struct(type->name, IR::Annotations::empty, *vec);
+StructTypeReplacement::StructTypeReplacement(FlatLayouts* layouts, const IR::Type_Struct* type) :
+        fieldNameRemap(layouts->get(type)->names),
+        structFieldMap(layouts->get(type)->structs) {
+    IR::IndexedVector<IR::StructField> fields;
+    for (auto& f : layouts->get(type)->fields)
+        fields.push_back(new IR::StructField(IR::ID(f.name), f.type->getP4Type()));
+    replacementType = new IR::Type_Struct(type->name, IR::Annotations::empty, fields);
 }
 
 const IR::StructExpression* StructTypeReplacement::explode(
@@ -79,7 +65,7 @@ void NestedStructMap::createReplacement(const IR::Type_Struct* type) {
     auto repl = ::get(replacement, type);
     if (repl != nullptr)
         return;
-    repl = new StructTypeReplacement(typeMap, type);
+    repl = new StructTypeReplacement(layouts, type);
     LOG3("Replacement for " << type << " is " << repl);
     replacement.emplace(type, repl);
 }
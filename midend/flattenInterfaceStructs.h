@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "ir/ir.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
+#include "flatLayout.h"
 
 namespace P4 {
 
@@ -43,7 +44,7 @@ struct M {
 }
 */
 struct StructTypeReplacement : public IHasDbPrint {
-    StructTypeReplacement(const P4::TypeMap* typeMap, const IR::Type_Struct* type);
+    StructTypeReplacement(FlatLayouts* layouts, const IR::Type_Struct* type);
 
     // Maps nested field names to final field names.
     // In our example this could be:
@@ -51,11 +52,11 @@ struct StructTypeReplacement : public IHasDbPrint {
     // .t.s.b -> _t_s_b1;
     // .t.y -> _t_y2;
     // .x -> _x3;
-    std::map<cstring, cstring> fieldNameRemap;
+    const std::map<cstring, cstring>& fieldNameRemap;
     // Maps internal fields names to types.
     // .t -> T
     // .t.s -> S
-    std::map<cstring, const IR::Type_Struct*> structFieldMap;
+    const std::map<cstring, const IR::Type_Struct*>& structFieldMap;
     // Holds a new flat type
     // struct M {
     //    bit _t_s_a0;
@@ -68,12 +69,6 @@ struct StructTypeReplacement : public IHasDbPrint {
         out << replacementType;
     }
 
-    // Helper for constructor
-    void flatten(const P4::TypeMap* typeMap,
-                 cstring prefix,
-                 const IR::Type* type,
-                 IR::IndexedVector<IR::StructField> *fields);
-
     /// Returns a StructExpression suitable for
     /// initializing a struct for the fields that start with the
     /// given prefix.  For example, for prefix .t and root R this returns
@@ -89,12 +84,18 @@ struct StructTypeReplacement : public IHasDbPrint {
 struct NestedStructMap {
     P4::ReferenceMap* refMap;
     P4::TypeMap* typeMap;
+    FlatLayouts* layouts;
 
     ordered_map<const IR::Type*, StructTypeReplacement*> replacement;
 
-    NestedStructMap(P4::ReferenceMap* refMap, P4::TypeMap* typeMap):
-            refMap(refMap), typeMap(typeMap)
-    { CHECK_NULL(refMap); CHECK_NULL(typeMap); }
+    /// The flat layouts are computed in @layouts, if any.
+    NestedStructMap(P4::ReferenceMap* refMap, P4::TypeMap* typeMap,
+                    FlatLayouts* layouts = nullptr):
+            refMap(refMap), typeMap(typeMap), layouts(layouts) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap);
+        if (!layouts)
+            this->layouts = new FlatLayouts(typeMap);
+    }
     void createReplacement(const IR::Type_Struct* type);
     StructTypeReplacement* getReplacement(const IR::Type* type) const
     { return ::get(replacement, type); }
@@ -158,9 +159,11 @@ top<TFlat>(c()) main;
 
  */
 class ReplaceStructs : public Transform, P4WriteContext {
-    NestedStructMap* replacementMap;
     std::map<const IR::Parameter*, StructTypeReplacement*> toReplace;
 
+ protected:
+    NestedStructMap* replacementMap;
+
  public:
     explicit ReplaceStructs(NestedStructMap* sm): replacementMap(sm) {
         CHECK_NULL(sm);
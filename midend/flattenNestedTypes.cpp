@@ -0,0 +1,34 @@
+#include "flattenNestedTypes.h"
+
+namespace P4 {
+
+const IR::Node* ReplaceHeadersAndStructs::preorder(IR::P4Program* program) {
+    if (headers->empty() && replacementMap->empty()) {
+        // nothing to do
+        prune();
+    }
+    return program;
+}
+
+const IR::Node* ReplaceHeadersAndStructs::postorder(IR::Type_Header* type) {
+    auto canon = replacementMap->typeMap->getTypeType(getOriginal(), true);
+    auto repl = headers->getReplacement(canon->to<IR::Type_Header>()->name);
+    if (repl != nullptr) {
+        LOG3("Replace " << type << " with " << repl->replacementType);
+        return repl->replacementType;
+    }
+    return type;
+}
+
+const IR::Node* ReplaceHeadersAndStructs::postorder(IR::Member* expression) {
+    // A flattened struct ends at the headers it contains, so at most one of the two
+    // replaces a Member; the header itself may have been replaced already, as in m._t_h1.s.a
+    auto result = ReplaceHeaders::replaceField(replacementMap->typeMap, headers, expression,
+                                               getOriginal<IR::Member>(),
+                                               getParent<IR::Member>() == nullptr);
+    if (result != expression)
+        return result;
+    return ReplaceStructs::postorder(expression);
+}
+
+}  // namespace P4
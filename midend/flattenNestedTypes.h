@@ -0,0 +1,55 @@
+#ifndef _MIDEND_FLATTENNESTEDTYPES_H_
+#define _MIDEND_FLATTENNESTEDTYPES_H_
+
+#include "ir/ir.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "flatLayout.h"
+#include "flattenHeaders.h"
+#include "flattenInterfaceStructs.h"
+
+namespace P4 {
+
+/**
+ * Does the work of ReplaceHeaders and ReplaceStructs in a single traversal: a reference
+ * to a field of a header nested in a struct that is flattened, such as m.t.h.s.a, becomes
+ * m._t_h1._s_a0.
+ */
+class ReplaceHeadersAndStructs final : public ReplaceStructs {
+    FindHeaderTypesToReplace* headers;
+
+ public:
+    ReplaceHeadersAndStructs(NestedStructMap* sm, FindHeaderTypesToReplace* headers) :
+            ReplaceStructs(sm), headers(headers) {
+        CHECK_NULL(headers);
+        setName("ReplaceHeadersAndStructs");
+    }
+
+    const IR::Node* preorder(IR::P4Program* program) override;
+    const IR::Node* postorder(IR::Member* expression) override;
+    const IR::Node* postorder(IR::Type_Header* type) override;
+};
+
+/**
+ * Equivalent to FlattenHeaders followed by FlattenInterfaceStructs, with one type checking
+ * and one rewrite of the program instead of two.  The flat layouts of the types nested in
+ * both headers and structs are computed once.
+ */
+class FlattenNestedTypes final : public PassManager {
+ public:
+    FlattenNestedTypes(ReferenceMap* refMap, TypeMap* typeMap,
+                       AnnotationSelectionPolicy *policy = nullptr) {
+        auto layouts = new FlatLayouts(typeMap);
+        auto headers = new FindHeaderTypesToReplace(typeMap, policy, layouts);
+        auto sm = new NestedStructMap(refMap, typeMap, layouts);
+        passes.push_back(new TypeChecking(refMap, typeMap));
+        passes.push_back(headers);
+        passes.push_back(new FindTypesToReplace(sm));
+        passes.push_back(new ReplaceHeadersAndStructs(sm, headers));
+        passes.push_back(new ClearTypeMap(typeMap));
+        setName("FlattenNestedTypes");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_FLATTENNESTEDTYPES_H_ */
@@ -0,0 +1,307 @@
+#include "fuseTables.h"
+
+#include <set>
+
+#include "frontends/p4/coreLibrary.h"
+#include "frontends/p4/methodInstance.h"
+
+namespace P4 {
+
+const cstring TableFusionPolicy::fuseAnnotation = "fuse";
+
+bool TableFusionPolicy::fuse(const IR::P4Table* first, const IR::P4Table*,
+                             size_t actions) const {
+    return first->getAnnotation(fuseAnnotation) != nullptr && actions <= maxActions;
+}
+
+struct DoFuseTables::Fusion {
+    const IR::P4Table*                      first;
+    const IR::P4Table*                      second;
+    /// The one of the two tables declared last, which the new declarations replace.
+    const IR::P4Table*                      last;
+    /// The new actions and the new table.
+    IR::IndexedVector<IR::Declaration>*     declarations;
+    cstring                                 name;
+};
+
+namespace {
+
+/// Renames the parameters of an action in its body.
+class RenameParameters : public Transform {
+    ReferenceMap*                                   refMap;
+    const std::map<const IR::Parameter*, cstring>&  names;
+
+ public:
+    RenameParameters(ReferenceMap* refMap, const std::map<const IR::Parameter*, cstring>& names) :
+            refMap(refMap), names(names) { setName("RenameParameters"); }
+    const IR::Node* postorder(IR::PathExpression* expression) override {
+        auto decl = refMap->getDeclaration(getOriginal<IR::PathExpression>()->path);
+        auto param = decl ? decl->to<IR::Parameter>() : nullptr;
+        auto it = param ? names.find(param) : names.end();
+        if (it == names.end())
+            return expression;
+        return new IR::PathExpression(expression->srcInfo, new IR::Path(it->second));
+    }
+};
+
+/// The location written through @expression: the slices and array elements it writes are
+/// approximated by the whole variable or field.
+cstring location(const IR::Expression* expression) {
+    while (true) {
+        if (auto index = expression->to<IR::ArrayIndex>())
+            expression = index->left;
+        else if (auto slice = expression->to<IR::Slice>())
+            expression = slice->e0;
+        else
+            return expression->toString();
+    }
+}
+
+/// Collects the outermost variables and fields read by an expression.
+class ReadLocations : public Inspector {
+ public:
+    std::set<cstring> locations;
+    bool preorder(const IR::Member* member) override
+    { locations.emplace(member->toString()); return false; }
+    bool preorder(const IR::PathExpression* path) override
+    { locations.emplace(path->toString()); return false; }
+};
+
+/// True if @left and @right are the same location or one of them contains the other.
+bool overlap(cstring left, cstring right) {
+    if (left.size() > right.size())
+        std::swap(left, right);
+    return left == right || (right.startsWith(left) && right.c_str()[left.size()] == '.');
+}
+
+}  // namespace
+
+const IR::P4Table* DoFuseTables::appliedTable(const IR::StatOrDecl* statement) const {
+    auto call = statement->to<IR::MethodCallStatement>();
+    if (call == nullptr)
+        return nullptr;
+    auto mi = MethodInstance::resolve(call, refMap, typeMap);
+    auto am = mi->to<ApplyMethod>();
+    if (am == nullptr || !am->isTableApply())
+        return nullptr;
+    return am->object->to<IR::P4Table>();
+}
+
+bool DoFuseTables::canFuse(const IR::P4Table* table) const {
+    for (auto property : table->properties->properties) {
+        auto name = property->name.name;
+        if (name != IR::TableProperties::keyPropertyName &&
+            name != IR::TableProperties::actionsPropertyName &&
+            name != IR::TableProperties::defaultActionPropertyName &&
+            name != IR::TableProperties::sizePropertyName)
+            return false;
+    }
+    auto key = table->getKey();
+    auto defaultAction = table->getDefaultAction();
+    if (key == nullptr || table->getActionList() == nullptr || defaultAction == nullptr ||
+        !defaultAction->is<IR::MethodCallExpression>())
+        return false;
+    for (auto element : key->keyElements)
+        if (element->matchType->path->name != P4CoreLibrary::instance().exactMatch.name)
+            return false;
+    for (auto element : table->getActionList()->actionList) {
+        auto call = element->expression->to<IR::MethodCallExpression>();
+        if (call == nullptr || !call->arguments->empty())
+            return false;
+        auto decl = refMap->getDeclaration(element->getPath(), true)->to<IR::P4Action>();
+        if (decl == nullptr)
+            return false;
+        for (auto param : decl->parameters->parameters)
+            if (param->direction != IR::Direction::None)
+                return false;
+    }
+    return true;
+}
+
+DoFuseTables::Fusion* DoFuseTables::fuse(const IR::P4Table* first,
+                                         const IR::P4Table* second) {
+    auto& firstKey = first->getKey()->keyElements;
+    auto& secondKey = second->getKey()->keyElements;
+    if (firstKey.size() != secondKey.size())
+        return nullptr;
+    ReadLocations keyLocations;
+    for (size_t i = 0; i < firstKey.size(); i++) {
+        if (!firstKey.at(i)->expression->equiv(*secondKey.at(i)->expression))
+            return nullptr;
+        firstKey.at(i)->expression->apply(keyLocations);
+    }
+    auto& firstActions = first->getActionList()->actionList;
+    auto& secondActions = second->getActionList()->actionList;
+    if (!policy->fuse(first, second, firstActions.size() * secondActions.size()))
+        return nullptr;
+
+    // The actions of the first table must not change the key of the second one.
+    bool writesKey = false;
+    auto written = [&](const IR::Expression* expression) {
+        auto target = location(expression);
+        for (auto read : keyLocations.locations)
+            writesKey = writesKey || overlap(target, read);
+    };
+    for (auto element : firstActions) {
+        auto action = refMap->getDeclaration(element->getPath(), true)->to<IR::P4Action>();
+        forAllMatching<IR::AssignmentStatement>(action->body,
+                                                [&](const IR::AssignmentStatement* statement) {
+            written(statement->left); });
+        forAllMatching<IR::MethodCallExpression>(action->body,
+                                                 [&](const IR::MethodCallExpression* call) {
+            auto mi = MethodInstance::resolve(call, refMap, typeMap);
+            for (auto param : *mi->substitution.getParametersInArgumentOrder())
+                if (param->hasOut())
+                    written(mi->substitution.lookup(param)->expression);
+            if (auto bim = mi->to<BuiltInMethod>())
+                written(bim->appliedTo); });
+    }
+    if (writesKey)
+        return nullptr;
+
+    auto fusion = new Fusion;
+    fusion->first = first;
+    fusion->second = second;
+    fusion->name = refMap->newName(first->name + "_" + second->name);
+    fusion->declarations = new IR::IndexedVector<IR::Declaration>();
+
+    // The new action for each pair of actions, indexed by their names.
+    std::map<std::pair<cstring, cstring>, cstring> actions;
+    IR::IndexedVector<IR::ActionListElement> actionList;
+    for (auto firstElement : firstActions) {
+        auto a = refMap->getDeclaration(firstElement->getPath(), true)->to<IR::P4Action>();
+        for (auto secondElement : secondActions) {
+            auto b = refMap->getDeclaration(secondElement->getPath(), true)->to<IR::P4Action>();
+            auto parameters = new IR::ParameterList();
+            auto body = new IR::BlockStatement(a->body->srcInfo);
+            // a and b may be the same action, so each body is renamed on its own.
+            for (auto action : { a, b }) {
+                std::map<const IR::Parameter*, cstring> names;
+                for (auto param : action->parameters->parameters) {
+                    cstring name = refMap->newName(action->name + "_" + param->name);
+                    names.emplace(param, name);
+                    parameters->push_back(new IR::Parameter(
+                        param->srcInfo, name, param->annotations, param->direction,
+                        param->type, param->defaultValue));
+                }
+                RenameParameters rename(refMap, names);
+                body->push_back(action->body->apply(rename)->to<IR::StatOrDecl>());
+            }
+            cstring name = refMap->newName(a->name + "_" + b->name);
+            actions.emplace(std::make_pair(a->name.name, b->name.name), name);
+            fusion->declarations->push_back(
+                new IR::P4Action(a->srcInfo, name, parameters, body));
+            actionList.push_back(new IR::ActionListElement(
+                firstElement->srcInfo,
+                new IR::MethodCallExpression(new IR::PathExpression(name))));
+        }
+    }
+
+    auto firstDefault = first->getDefaultAction()->to<IR::MethodCallExpression>();
+    auto secondDefault = second->getDefaultAction()->to<IR::MethodCallExpression>();
+    auto defaultName = actions.at(std::make_pair(
+        firstDefault->method->to<IR::PathExpression>()->path->name.name,
+        secondDefault->method->to<IR::PathExpression>()->path->name.name));
+    auto arguments = new IR::Vector<IR::Argument>(*firstDefault->arguments);
+    arguments->append(*secondDefault->arguments);
+    auto defaultAction = new IR::MethodCallExpression(
+        firstDefault->srcInfo, new IR::PathExpression(defaultName), arguments);
+    bool constantDefault =
+        first->properties->getProperty(IR::TableProperties::defaultActionPropertyName)
+            ->isConstant &&
+        second->properties->getProperty(IR::TableProperties::defaultActionPropertyName)
+            ->isConstant;
+
+    IR::IndexedVector<IR::Property> properties;
+    properties.push_back(first->properties->getProperty(IR::TableProperties::keyPropertyName));
+    properties.push_back(new IR::Property(
+        IR::TableProperties::actionsPropertyName, new IR::ActionList(actionList), false));
+    properties.push_back(new IR::Property(
+        IR::TableProperties::defaultActionPropertyName,
+        new IR::ExpressionValue(defaultAction), constantDefault));
+    auto firstSize = first->getSizeProperty();
+    auto secondSize = second->getSizeProperty();
+    if (firstSize != nullptr && secondSize != nullptr)
+        properties.push_back(new IR::Property(
+            IR::TableProperties::sizePropertyName,
+            new IR::ExpressionValue(firstSize->value > secondSize->value ? firstSize
+                                                                         : secondSize),
+            false));
+    auto annotations = new IR::Annotations();
+    if (second->getAnnotation(TableFusionPolicy::fuseAnnotation))
+        annotations->add(new IR::Annotation(TableFusionPolicy::fuseAnnotation, {}));
+    fusion->declarations->push_back(new IR::P4Table(
+        first->srcInfo, fusion->name, annotations, new IR::TableProperties(properties)));
+    LOG2("Fusing " << dbp(first) << " and " << dbp(second) << " into " << fusion->name);
+    return fusion;
+}
+
+const IR::Node* DoFuseTables::preorder(IR::P4Control* control) {
+    auto orig = getOriginal<IR::P4Control>();
+    std::map<const IR::P4Table*, unsigned> uses, applied;
+    forAllMatching<IR::PathExpression>(orig->body, [&](const IR::PathExpression* path) {
+        auto decl = refMap->getDeclaration(path->path);
+        if (decl != nullptr && decl->is<IR::P4Table>())
+            uses[decl->to<IR::P4Table>()]++; });
+    forAllMatching<IR::MethodCallStatement>(orig->body, [&](const IR::MethodCallStatement* call) {
+        if (auto table = appliedTable(call))
+            applied[table]++; });
+    auto fusable = [&](const IR::P4Table* table) {
+        return table != nullptr && !fusions.count(table) && uses[table] == 1 &&
+               applied[table] == 1 && canFuse(table);
+    };
+
+    forAllMatching<IR::BlockStatement>(orig->body, [&](const IR::BlockStatement* block) {
+        auto& components = block->components;
+        for (size_t i = 0; i + 1 < components.size(); i++) {
+            auto first = appliedTable(components.at(i));
+            auto second = appliedTable(components.at(i + 1));
+            if (first == second || !fusable(first) || !fusable(second))
+                continue;
+            auto fusion = fuse(first, second);
+            if (fusion == nullptr)
+                continue;
+            fusions.emplace(first, fusion);
+            fusions.emplace(second, fusion);
+            auto apply = new IR::MethodCallStatement(new IR::MethodCallExpression(
+                new IR::Member(new IR::PathExpression(fusion->name),
+                               IR::IApply::applyMethodName)));
+            applies.emplace(components.at(i)->to<IR::MethodCallStatement>(), apply);
+            applies.emplace(components.at(i + 1)->to<IR::MethodCallStatement>(), nullptr);
+            i++;
+        } });
+
+    for (auto local : orig->controlLocals) {
+        auto it = fusions.find(local->to<IR::P4Table>());
+        if (it != fusions.end())
+            it->second->last = it->first;
+    }
+    return control;
+}
+
+const IR::Node* DoFuseTables::postorder(IR::P4Control* control) {
+    fusions.clear();
+    applies.clear();
+    return control;
+}
+
+const IR::Node* DoFuseTables::postorder(IR::P4Table* table) {
+    auto orig = getOriginal<IR::P4Table>();
+    auto it = fusions.find(orig);
+    if (it == fusions.end())
+        return table;
+    if (it->second->last == orig)
+        return it->second->declarations;
+    return nullptr;
+}
+
+const IR::Node* DoFuseTables::postorder(IR::MethodCallStatement* statement) {
+    auto it = applies.find(getOriginal<IR::MethodCallStatement>());
+    if (it == applies.end())
+        return statement;
+    if (it->second == nullptr && !getParent<IR::BlockStatement>())
+        return new IR::EmptyStatement(statement->srcInfo);
+    return it->second;
+}
+
+}  // namespace P4
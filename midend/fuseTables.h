@@ -0,0 +1,114 @@
+#ifndef _MIDEND_FUSETABLES_H_
+#define _MIDEND_FUSETABLES_H_
+
+#include <map>
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * Policy for FuseTables: decides which pairs of tables applied one after the other are
+ * fused.
+ */
+class TableFusionPolicy {
+    size_t maxActions;
+
+ public:
+    /// Annotation on a table that asks for it to be fused with the table applied after it.
+    static const cstring fuseAnnotation;
+
+    explicit TableFusionPolicy(size_t maxActions = 32) : maxActions(maxActions) {}
+    virtual ~TableFusionPolicy() {}
+    /// True if @first and @second should be replaced by one table with @actions actions.
+    /// By default this is the case when @first has the @fuse annotation and there are at
+    /// most maxActions actions.
+    virtual bool fuse(const IR::P4Table* first, const IR::P4Table* second,
+                      size_t actions) const;
+};
+
+/**
+ * Replaces two tables that are applied one after the other on the same exact key by a
+ * single table.  The actions of the new table perform an action of the first table
+ * followed by an action of the second one, so the control plane installs in the new
+ * table, for each key, the pair of actions (and their arguments) it would have installed
+ * in the two tables, using the default actions for the keys missing from one of them.
+ *
+ * \code{.cpp}
+ *  @fuse table t1 { key = { h.x : exact; } actions = { a; NoAction; }
+ *                   default_action = NoAction(); }
+ *  table t2 { key = { h.x : exact; } actions = { b; } default_action = b(0); }
+ *  apply { t1.apply(); t2.apply(); }
+ * \endcode
+ *
+ * becomes
+ *
+ * \code{.cpp}
+ *  action a_b(bit<8> v) { { ... a ... } { ... b with v ... } }
+ *  action NoAction_b(bit<8> v) { { } { ... b with v ... } }
+ *  table t1_t2 { key = { h.x : exact; } actions = { a_b; NoAction_b; }
+ *                default_action = NoAction_b(0); }
+ *  apply { t1_t2.apply(); }
+ * \endcode
+ *
+ * Both tables must be applied only once, by statements that follow each other in a block
+ * (not for their hit or action_run results), have only exact keys, no properties other
+ * than the key, the actions, the default action and the size, no arguments in their
+ * action lists, and the actions of the first table must not write the variables read
+ * by the key.  The fused table keeps the @fuse annotation of the second table, so that
+ * FuseTables can fuse longer sequences.
+ *
+ * @pre The program is type checked.
+ */
+class DoFuseTables : public Transform {
+    ReferenceMap*               refMap;
+    TypeMap*                    typeMap;
+    const TableFusionPolicy*    policy;
+
+    struct Fusion;
+    /// The fusions in the current control, indexed by both tables.
+    std::map<const IR::P4Table*, Fusion*> fusions;
+    /// The replacement of the statements applying the fused tables.
+    std::map<const IR::MethodCallStatement*, const IR::Statement*> applies;
+
+    /// The table applied by @statement, if it is a table application.
+    const IR::P4Table* appliedTable(const IR::StatOrDecl* statement) const;
+    /// True if @table can be fused with some other table.
+    bool canFuse(const IR::P4Table* table) const;
+    Fusion* fuse(const IR::P4Table* first, const IR::P4Table* second);
+
+ public:
+    DoFuseTables(ReferenceMap* refMap, TypeMap* typeMap, const TableFusionPolicy* policy) :
+            refMap(refMap), typeMap(typeMap), policy(policy) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(policy);
+        setName("DoFuseTables");
+    }
+    const IR::Node* preorder(IR::P4Control* control) override;
+    const IR::Node* postorder(IR::P4Control* control) override;
+    const IR::Node* postorder(IR::P4Table* table) override;
+    const IR::Node* postorder(IR::MethodCallStatement* statement) override;
+    const IR::Node* preorder(IR::P4Parser* parser) override
+    { prune(); return parser; }
+};
+
+/// Fuses tables until no more tables can be fused.
+class FuseTables : public PassRepeated {
+    TableFusionPolicy defaultPolicy;
+
+ public:
+    FuseTables(ReferenceMap* refMap, TypeMap* typeMap,
+               const TableFusionPolicy* policy = nullptr) : PassRepeated({}) {
+        if (!policy)
+            policy = &defaultPolicy;
+        passes.push_back(new TypeChecking(refMap, typeMap));
+        passes.push_back(new DoFuseTables(refMap, typeMap, policy));
+        setName("FuseTables");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_FUSETABLES_H_ */
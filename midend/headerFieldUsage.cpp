@@ -0,0 +1,190 @@
+#include "headerFieldUsage.h"
+
+#include "has_side_effects.h"
+#include "frontends/p4/coreLibrary.h"
+#include "frontends/p4/methodInstance.h"
+
+namespace P4 {
+
+void HeaderFieldUsage::clear() {
+    fieldsRead.clear();
+    fieldsWritten.clear();
+    wholeRead.clear();
+    modified.clear();
+    extracted.clear();
+}
+
+bool HeaderFieldUsage::isRead(const IR::Type_Header* type, cstring field) const {
+    if (wholeRead.count(type->name.name))
+        return true;
+    auto it = fieldsRead.find(type->name.name);
+    return it != fieldsRead.end() && it->second.count(field);
+}
+
+bool HeaderFieldUsage::isUsed(const IR::Type_Header* type) const {
+    return wholeRead.count(type->name.name) || fieldsRead.count(type->name.name);
+}
+
+bool HeaderFieldUsage::isModified(const IR::Type_Header* type) const {
+    return modified.count(type->name.name) != 0;
+}
+
+bool HeaderFieldUsage::isWritten(const IR::Type_Header* type, cstring field) const {
+    auto it = fieldsWritten.find(type->name.name);
+    return it != fieldsWritten.end() && it->second.count(field);
+}
+
+void FindHeaderFieldUsage::headersIn(const IR::Type* type,
+                                     std::function<void(const IR::Type_Header*)> fn) {
+    if (type == nullptr)
+        return;
+    if (auto header = type->to<IR::Type_Header>()) {
+        fn(header);
+    } else if (auto stack = type->to<IR::Type_Stack>()) {
+        headersIn(typeMap->getTypeType(stack->elementType, true), fn);
+    } else if (auto st = type->to<IR::Type_StructLike>()) {
+        for (auto field : st->fields)
+            headersIn(typeMap->getTypeType(field->type, true), fn);
+    } else if (auto list = type->to<IR::Type_BaseList>()) {
+        for (auto component : list->components)
+            headersIn(typeMap->getTypeType(component, true), fn);
+    }
+}
+
+const IR::Type_Header* FindHeaderFieldUsage::fieldOf(const IR::Member* expression) const {
+    auto header = typeMap->getType(expression->expr)->to<IR::Type_Header>();
+    if (header == nullptr || header->getField(expression->member) == nullptr)
+        return nullptr;
+    return header;
+}
+
+void FindHeaderFieldUsage::visitIndexes(const IR::Expression* expression) {
+    while (true) {
+        if (auto member = expression->to<IR::Member>()) {
+            expression = member->expr;
+        } else if (auto index = expression->to<IR::ArrayIndex>()) {
+            visit(index->right);
+            expression = index->left;
+        } else if (auto slice = expression->to<IR::Slice>()) {
+            expression = slice->e0;
+        } else {
+            if (!expression->is<IR::PathExpression>())
+                visit(expression);
+            return;
+        }
+    }
+}
+
+void FindHeaderFieldUsage::write(const IR::Expression* expression) {
+    if (auto slice = expression->to<IR::Slice>())
+        expression = slice->e0;
+    if (auto member = expression->to<IR::Member>()) {
+        if (auto header = fieldOf(member)) {
+            usage->fieldsWritten[header->name.name].emplace(member->member.name);
+            usage->modified.emplace(header->name.name);
+            visitIndexes(member->expr);
+            return;
+        }
+    }
+    headersIn(typeMap->getType(expression), [this](const IR::Type_Header* header) {
+        usage->modified.emplace(header->name.name); });
+    visitIndexes(expression);
+}
+
+Visitor::profile_t FindHeaderFieldUsage::init_apply(const IR::Node* node) {
+    usage->clear();
+    return Inspector::init_apply(node);
+}
+
+bool FindHeaderFieldUsage::preorder(const IR::Parameter* parameter) {
+    // The parameters of the blocks and externs of the architecture, as opposed to
+    // those of the blocks of the program: the target may read these headers.
+    if (!findContext<IR::P4Parser>() && !findContext<IR::P4Control>() &&
+        !findContext<IR::P4Action>() && !findContext<IR::Function>())
+        headersIn(typeMap->getType(parameter), [this](const IR::Type_Header* header) {
+            usage->wholeRead.emplace(header->name.name); });
+    return false;
+}
+
+bool FindHeaderFieldUsage::preorder(const IR::AssignmentStatement* statement) {
+    write(statement->left);
+    visit(statement->right);
+    return false;
+}
+
+bool FindHeaderFieldUsage::preorder(const IR::MethodCallExpression* expression) {
+    auto mi = MethodInstance::resolve(expression, refMap, typeMap);
+    if (auto bim = mi->to<BuiltInMethod>()) {
+        if (bim->name == IR::Type_Header::setValid || bim->name == IR::Type_Stack::push_front ||
+            bim->name == IR::Type_Stack::pop_front)
+            headersIn(typeMap->getType(bim->appliedTo), [this](const IR::Type_Header* header) {
+                usage->modified.emplace(header->name.name); });
+        visitIndexes(bim->appliedTo);
+        visit(expression->arguments);
+        return false;
+    }
+    auto& corelib = P4CoreLibrary::instance();
+    bool extract = false;
+    if (auto em = mi->to<ExternMethod>())
+        extract = em->originalExternType->name == corelib.packetIn.name &&
+                  em->method->name == corelib.packetIn.extract.name;
+    for (auto parameter : *mi->substitution.getParametersInArgumentOrder()) {
+        auto argument = mi->substitution.lookup(parameter)->expression;
+        if (extract && parameter->direction == IR::Direction::Out) {
+            headersIn(typeMap->getType(argument), [this](const IR::Type_Header* header) {
+                usage->extracted.emplace(header->name.name); });
+            visitIndexes(argument);
+            continue;
+        }
+        if (parameter->direction == IR::Direction::Out ||
+            parameter->direction == IR::Direction::InOut)
+            write(argument);
+        if (parameter->direction != IR::Direction::Out)
+            visit(argument);
+    }
+    return false;
+}
+
+bool FindHeaderFieldUsage::preorder(const IR::Member* expression) {
+    if (auto header = fieldOf(expression)) {
+        usage->fieldsRead[header->name.name].emplace(expression->member.name);
+        visitIndexes(expression->expr);
+        return false;
+    }
+    return preorder(expression->to<IR::Expression>());
+}
+
+bool FindHeaderFieldUsage::preorder(const IR::Expression* expression) {
+    bool headers = false;
+    headersIn(typeMap->getType(expression), [&](const IR::Type_Header* header) {
+        usage->wholeRead.emplace(header->name.name);
+        headers = true; });
+    if (!headers)
+        return true;
+    visitIndexes(expression);
+    return false;
+}
+
+const IR::Node* DoRemoveDeadHeaderFieldWrites::postorder(IR::AssignmentStatement* statement) {
+    auto left = statement->left;
+    if (auto slice = left->to<IR::Slice>())
+        left = slice->e0;
+    auto member = left->to<IR::Member>();
+    if (member == nullptr)
+        return statement;
+    auto header = typeMap->getType(member->expr)->to<IR::Type_Header>();
+    if (header == nullptr || header->getField(member->member) == nullptr ||
+        usage->isRead(header, member->member))
+        return statement;
+    if (hasSideEffects(refMap, typeMap, statement->left) ||
+        hasSideEffects(refMap, typeMap, statement->right))
+        return statement;
+    LOG3("Removing " << statement << ": " << header->name << "." << member->member <<
+         " is never read");
+    if (getParent<IR::BlockStatement>() || getParent<IR::ParserState>() ||
+        getParent<IR::IndexedVector<IR::StatOrDecl>>())
+        return nullptr;
+    return new IR::EmptyStatement(statement->srcInfo);
+}
+
+}  // namespace P4
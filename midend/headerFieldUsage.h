@@ -0,0 +1,119 @@
+#ifndef _MIDEND_HEADERFIELDUSAGE_H_
+#define _MIDEND_HEADERFIELDUSAGE_H_
+
+#include <functional>
+#include <map>
+#include <set>
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * How the fields of each header type are used in a program.  Headers are identified by
+ * their type, since the same header is named by different parameters in the parser,
+ * the controls and the deparser.
+ *
+ * A header is read as a whole when it is emitted, copied, or passed to an action,
+ * function or extern (other than packet_in.extract), or when it appears in the
+ * parameters of an architecture block or extern.  A field is read when its value is used,
+ * including in table keys and select expressions.  A header is modified when one of its
+ * fields or the whole header is written (other than by packet_in.extract), when it is
+ * passed as an out or inout argument, or when it is made valid.
+ *
+ * Targets can use this to skip extracting fields that are never read, or to copy the
+ * bytes of headers that are never modified in one piece from the input to the output.
+ */
+class HeaderFieldUsage {
+    friend class FindHeaderFieldUsage;
+    std::map<cstring, std::set<cstring>>    fieldsRead;
+    std::map<cstring, std::set<cstring>>    fieldsWritten;
+    std::set<cstring>                       wholeRead;
+    std::set<cstring>                       modified;
+    std::set<cstring>                       extracted;
+
+ public:
+    void clear();
+    /// True if the value of @field of headers of @type may be used.
+    bool isRead(const IR::Type_Header* type, cstring field) const;
+    /// True if anything in headers of @type may be used.
+    bool isUsed(const IR::Type_Header* type) const;
+    /// True if the contents of a header of @type may differ from what was extracted.
+    bool isModified(const IR::Type_Header* type) const;
+    /// True if headers of @type are extracted from the packet.
+    bool isExtracted(const IR::Type_Header* type) const
+    { return extracted.count(type->name.name) != 0; }
+    /// True if @field of headers of @type is assigned.
+    bool isWritten(const IR::Type_Header* type, cstring field) const;
+};
+
+/// Computes the HeaderFieldUsage of a program.
+/// @pre The program is type checked.
+class FindHeaderFieldUsage : public Inspector {
+    ReferenceMap*       refMap;
+    TypeMap*            typeMap;
+    HeaderFieldUsage*   usage;
+
+    /// Calls @fn for the header types in @type.
+    void headersIn(const IR::Type* type, std::function<void(const IR::Type_Header*)> fn);
+    /// If @expression is a field of a header, its type.
+    const IR::Type_Header* fieldOf(const IR::Member* expression) const;
+    /// Visits the expressions used to find the location @expression.
+    void visitIndexes(const IR::Expression* expression);
+    void write(const IR::Expression* expression);
+
+ public:
+    FindHeaderFieldUsage(ReferenceMap* refMap, TypeMap* typeMap, HeaderFieldUsage* usage) :
+            refMap(refMap), typeMap(typeMap), usage(usage) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(usage);
+        setName("FindHeaderFieldUsage");
+        visitDagOnce = false;
+    }
+    Visitor::profile_t init_apply(const IR::Node* node) override;
+    bool preorder(const IR::Parameter* parameter) override;
+    bool preorder(const IR::AssignmentStatement* statement) override;
+    bool preorder(const IR::MethodCallExpression* expression) override;
+    bool preorder(const IR::Member* expression) override;
+    bool preorder(const IR::Expression* expression) override;
+};
+
+/**
+ * Removes the assignments to header fields that are never read, in headers that are
+ * never read as a whole (and hence never emitted).
+ */
+class DoRemoveDeadHeaderFieldWrites : public Transform {
+    ReferenceMap*               refMap;
+    TypeMap*                    typeMap;
+    const HeaderFieldUsage*     usage;
+
+ public:
+    DoRemoveDeadHeaderFieldWrites(ReferenceMap* refMap, TypeMap* typeMap,
+                                  const HeaderFieldUsage* usage) :
+            refMap(refMap), typeMap(typeMap), usage(usage) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(usage);
+        setName("DoRemoveDeadHeaderFieldWrites");
+    }
+    const IR::Node* postorder(IR::AssignmentStatement* statement) override;
+};
+
+class RemoveDeadHeaderFieldWrites : public PassManager {
+    HeaderFieldUsage usage;
+
+ public:
+    RemoveDeadHeaderFieldWrites(ReferenceMap* refMap, TypeMap* typeMap,
+                                TypeChecking* typeChecking = nullptr) {
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap);
+        passes.push_back(typeChecking);
+        passes.push_back(new FindHeaderFieldUsage(refMap, typeMap, &usage));
+        passes.push_back(new DoRemoveDeadHeaderFieldWrites(refMap, typeMap, &usage));
+        setName("RemoveDeadHeaderFieldWrites");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_HEADERFIELDUSAGE_H_ */
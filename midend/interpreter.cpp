@@ -8,6 +8,56 @@ namespace P4 {
 
 unsigned SymbolicValue::crtid = 0;
 
+void* SymbolicValue::operator new(size_t size) {
+    if (auto arena = SymbolicValueArena::current)
+        return arena->arena.allocate(size);
+    return ::operator new(size);
+}
+
+void SymbolicValue::operator delete(void* p) {
+    if (!Util::Arena::isArenaPtr(p))
+        ::operator delete(p);
+}
+
+thread_local SymbolicValueArena* SymbolicValueArena::current = nullptr;
+
+SymbolicValueArena::SymbolicValueArena() : prev(current) { current = this; }
+
+SymbolicValueArena::~SymbolicValueArena() { current = prev; }
+
+SymbolicInteger* SymbolicValueArena::constant(const IR::Constant* constant) {
+    if (!current)
+        return new SymbolicInteger(constant);
+    auto& result = current->constants[constant];
+    if (!result) {
+        result = new SymbolicInteger(constant);
+        result->shared = true;
+    }
+    return result;
+}
+
+SymbolicBool* SymbolicValueArena::boolean(bool value) {
+    if (!current)
+        return new SymbolicBool(value);
+    auto& result = current->bools[value];
+    if (!result) {
+        result = new SymbolicBool(value);
+        result->shared = true;
+    }
+    return result;
+}
+
+SymbolicBool* SymbolicValueArena::unknownBoolean() {
+    if (!current)
+        return new SymbolicBool(ScalarValue::ValueState::NotConstant);
+    auto& result = current->bools[2];
+    if (!result) {
+        result = new SymbolicBool(ScalarValue::ValueState::NotConstant);
+        result->shared = true;
+    }
+    return result;
+}
+
 SymbolicValue* SymbolicValueFactory::create(const IR::Type* type, bool uninitialized) const {
     type = typeMap->getTypeType(type, true);
     if (type->is<IR::Type_Bits>())
@@ -32,7 +82,7 @@ SymbolicValue* SymbolicValueFactory::create(const IR::Type* type, bool uninitial
     }
     if (type->is<IR::Type_Extern>()) {
         auto te = type->to<IR::Type_Extern>();
-        if (te->name.name == P4CoreLibrary::instance.packetIn.name) {
+        if (te->name.name == P4CoreLibrary::instance().packetIn.name) {
             return new SymbolicPacketIn(te);
         }
         return new SymbolicExtern(te);
@@ -247,10 +297,18 @@ SymbolicStruct::SymbolicStruct(const IR::Type_StructLike* type, bool uninitializ
     }
 }
 
+SymbolicValue* SymbolicStruct::modifyField(cstring field) {
+    auto value = SymbolicStruct::get(nullptr, field);
+    if (!value->shared)
+        return value;
+    return *fieldValue.modify(field) = value->clone();
+}
+
 SymbolicValue* SymbolicStruct::clone() const {
     auto result = new SymbolicStruct(type->to<IR::Type_StructLike>());
+    result->fieldValue = fieldValue;
     for (auto f : fieldValue)
-        result->fieldValue[f.first] = f.second->clone();
+        f.second->shared = true;
     return result;
 }
 
@@ -259,7 +317,7 @@ void SymbolicStruct::assign(const SymbolicValue* other) {
     BUG_CHECK(other->is<SymbolicStruct>(), "%1%: expected a struct", other);
     auto sv = other->to<SymbolicStruct>();
     for (auto f : sv->fieldValue)
-        fieldValue[f.first]->assign(f.second);
+        modifyField(f.first)->assign(f.second);
 }
 
 bool SymbolicStruct::merge(const SymbolicValue* other) {
@@ -267,13 +325,13 @@ bool SymbolicStruct::merge(const SymbolicValue* other) {
     auto sv = other->to<SymbolicStruct>();
     bool changes = false;
     for (auto f : sv->fieldValue)
-        changes = changes || fieldValue[f.first]->merge(f.second);
+        changes = changes || modifyField(f.first)->merge(f.second);
     return changes;
 }
 
 void SymbolicStruct::setAllUnknown() {
     for (auto f : type->to<IR::Type_StructLike>()->fields)
-        fieldValue[f->name.name]->setAllUnknown();
+        modifyField(f->name.name)->setAllUnknown();
 }
 
 bool SymbolicStruct::equals(const SymbolicValue* other) const {
@@ -313,12 +371,12 @@ SymbolicHeader::SymbolicHeader(const IR::Type_Header* type,
                                bool uninitialized,
                                const SymbolicValueFactory* factory) :
         SymbolicStruct(type, uninitialized, factory),
-        valid(new SymbolicBool(false)) {}
+        valid(SymbolicValueArena::boolean(false)) {}
 
 void SymbolicHeader::setValid(bool v) {
     if (!v)
         setAllUnknown();
-    valid = new SymbolicBool(v);
+    valid = SymbolicValueArena::boolean(v);
 }
 
 SymbolicValue* SymbolicHeader::get(const IR::Node* node, cstring field) const {
@@ -327,16 +385,24 @@ SymbolicValue* SymbolicHeader::get(const IR::Node* node, cstring field) const {
     return SymbolicStruct::get(node, field);
 }
 
+SymbolicValue* SymbolicHeader::modify(const IR::Node* node, cstring field) {
+    if (valid->isKnown() && !valid->value)
+        return new SymbolicStaticError(node, "Reading field from invalid header");
+    return SymbolicStruct::modify(node, field);
+}
+
 void SymbolicHeader::setAllUnknown() {
     SymbolicStruct::setAllUnknown();
-    valid->setAllUnknown();
+    unshare(valid)->setAllUnknown();
 }
 
 SymbolicValue* SymbolicHeader::clone() const {
     auto result = new SymbolicHeader(type->to<IR::Type_Header>());
+    result->fieldValue = fieldValue;
     for (auto f : fieldValue)
-        result->fieldValue[f.first] = f.second->clone();
-    result->valid = valid->clone()->to<SymbolicBool>();
+        f.second->shared = true;
+    valid->shared = true;
+    result->valid = valid;
     return result;
 }
 
@@ -345,8 +411,8 @@ void SymbolicHeader::assign(const SymbolicValue* other) {
     BUG_CHECK(other->is<SymbolicHeader>(), "%1%: expected a header", other);
     auto hv = other->to<SymbolicHeader>();
     for (auto f : hv->fieldValue)
-        fieldValue[f.first]->assign(f.second);
-    valid->assign(hv->valid);
+        modifyField(f.first)->assign(f.second);
+    unshare(valid)->assign(hv->valid);
 }
 
 bool SymbolicHeader::merge(const SymbolicValue* other) {
@@ -354,8 +420,8 @@ bool SymbolicHeader::merge(const SymbolicValue* other) {
     auto hv = other->to<SymbolicHeader>();
     bool changes = false;
     for (auto f : hv->fieldValue)
-        changes = changes || fieldValue[f.first]->merge(f.second);
-    changes = changes || valid->merge(hv->valid);
+        changes = changes || modifyField(f.first)->merge(f.second);
+    changes = changes || unshare(valid)->merge(hv->valid);
     return changes;
 }
 
@@ -396,16 +462,19 @@ SymbolicArray::SymbolicArray(const IR::Type_Stack* type, bool uninitialized,
 }
 
 void SymbolicArray::shift(int amount) {
+    // the elements that move may stay where they were too
+    for (auto v : values)
+        v->shared = true;
     if (amount < 0) {
         for (unsigned i = 0; i < values.size() + amount; i++)
             values[i] = values[i - amount];
         for (unsigned i = values.size() + amount; i < values.size(); i++)
-            values[i]->setValid(false);
+            unshare(values[i])->setValid(false);
     } else if (amount > 0) {
         for (unsigned i = 0; i < values.size() - amount; i++)
             values[values.size() - i - 1] = values[values.size() - i - amount - 1];
         for (unsigned i = 0; i < (unsigned)amount; i++)
-            values[i]->setValid(false);
+            unshare(values[i])->setValid(false);
     }
 }
 
@@ -415,7 +484,7 @@ SymbolicValue* SymbolicArray::next(const IR::Node* node) {
         if (v->valid->isUnknown() || v->valid->isUninitialized())
             return new AnyElement(this);
         if (!v->valid->value)
-            return v;
+            return unshare(values.at(i));
     }
     return new SymbolicException(node, P4::StandardExceptions::StackOutOfBounds);
 }
@@ -427,20 +496,21 @@ SymbolicValue* SymbolicArray::last(const IR::Node* node) {
         if (v->valid->isUnknown() || v->valid->isUninitialized())
             return new AnyElement(this);
         if (v->valid->value)
-            return v;
+            return unshare(values.at(index));
     }
     return new SymbolicException(node, P4::StandardExceptions::StackOutOfBounds);
 }
 
 void SymbolicArray::setAllUnknown() {
     for (unsigned i = 0; i < values.size(); i++)
-        values.at(i)->setAllUnknown();
+        unshare(values.at(i))->setAllUnknown();
 }
 
 SymbolicValue* SymbolicArray::clone() const {
     auto result = new SymbolicArray(type->to<IR::Type_Stack>());
-    for (unsigned i=0; i < values.size(); i++)
-        result->values.push_back(get(nullptr, i)->clone()->to<SymbolicHeader>());
+    result->values = values;
+    for (auto v : values)
+        v->shared = true;
     return result;
 }
 
@@ -448,14 +518,15 @@ void SymbolicArray::assign(const SymbolicValue* other) {
     if (other->is<SymbolicError>()) return;
     BUG_CHECK(other->is<SymbolicArray>(), "%1%: expected an array", other);
     for (unsigned i=0; i < values.size(); i++)
-        values.at(i)->assign(other->to<SymbolicArray>()->get(nullptr, i));
+        unshare(values.at(i))->assign(other->to<SymbolicArray>()->get(nullptr, i));
 }
 
 bool SymbolicArray::merge(const SymbolicValue* other) {
     BUG_CHECK(other->is<SymbolicArray>(), "%1%: expected an array", other);
     bool changes = false;
     for (unsigned i=0; i < values.size(); i++)
-        changes = changes || values.at(i)->merge(other->to<SymbolicArray>()->get(nullptr, i));
+        changes = changes ||
+                unshare(values.at(i))->merge(other->to<SymbolicArray>()->get(nullptr, i));
     return changes;
 }
 
@@ -520,13 +591,14 @@ SymbolicTuple::SymbolicTuple(const IR::Type_Tuple* type, bool uninitialized,
 
 void SymbolicTuple::setAllUnknown() {
     for (unsigned i = 0; i < values.size(); i++)
-        values.at(i)->setAllUnknown();
+        unshare(values.at(i))->setAllUnknown();
 }
 
 SymbolicValue* SymbolicTuple::clone() const {
     auto result = new SymbolicTuple(type->to<IR::Type_Tuple>());
-    for (unsigned i=0; i < values.size(); i++)
-        result->values.push_back(get(i)->clone());
+    result->values = values;
+    for (auto v : values)
+        v->shared = true;
     return result;
 }
 
@@ -536,7 +608,7 @@ bool SymbolicTuple::merge(const SymbolicValue* other) {
     BUG_CHECK(values.size() == tpl->values.size(), "merging tuples with different sizes");
     bool changes = false;
     for (unsigned i=0; i < values.size(); i++)
-        changes = changes || values.at(i)->merge(tpl->get(i));
+        changes = changes || unshare(values.at(i))->merge(tpl->get(i));
     return changes;
 }
 
@@ -604,7 +676,7 @@ void ExpressionEvaluator::checkResult(const IR::Expression* expression,
         set(expression, new SymbolicInteger(result->to<IR::Constant>()));
         return;
     } else if (result->is<IR::BoolLiteral>()){
-        set(expression, new SymbolicBool(result->to<IR::BoolLiteral>()->value));
+        set(expression, SymbolicValueArena::boolean(result->to<IR::BoolLiteral>()->value));
         return;
     }
     BUG("%1% : expected a constant/bool literal", result);
@@ -613,7 +685,7 @@ void ExpressionEvaluator::checkResult(const IR::Expression* expression,
 void ExpressionEvaluator::setNonConstant(const IR::Expression* expression) {
     auto type = typeMap->getType(expression, true);
     if (type->is<IR::BoolLiteral>()) {
-        set(expression, new SymbolicBool(ScalarValue::ValueState::NotConstant));
+        set(expression, SymbolicValueArena::unknownBoolean());
     } else if (type->is<IR::Type_Bits>()) {
         set(expression, new SymbolicInteger(ScalarValue::ValueState::NotConstant,
                                             type->to<IR::Type_Bits>()));
@@ -737,14 +809,14 @@ void ExpressionEvaluator::postorder(const IR::Operation_Unary* expression) {
         DoConstantFolding cf(refMap, typeMap);
         auto result = expression->apply(cf);
         BUG_CHECK(result->is<IR::BoolLiteral>(), "%1%: expected a boolean", result);
-        set(expression, new SymbolicBool(result->to<IR::BoolLiteral>()));
+        set(expression, SymbolicValueArena::boolean(result->to<IR::BoolLiteral>()->value));
         return;
     }
     BUG("%1%: unexpected type", l);
 }
 
 void ExpressionEvaluator::postorder(const IR::Constant* expression) {
-    set(expression, new SymbolicInteger(expression));
+    set(expression, SymbolicValueArena::constant(expression));
 }
 
 void ExpressionEvaluator::postorder(const IR::ListExpression* expression) {
@@ -768,7 +840,7 @@ void ExpressionEvaluator::postorder(const IR::StructExpression* expression) {
 }
 
 void ExpressionEvaluator::postorder(const IR::BoolLiteral* expression) {
-    set(expression, new SymbolicBool(expression));
+    set(expression, SymbolicValueArena::boolean(expression->value));
 }
 
 void ExpressionEvaluator::postorder(const IR::Operation_Relation* expression) {
@@ -797,11 +869,11 @@ void ExpressionEvaluator::postorder(const IR::Operation_Relation* expression) {
         return;
     }
     if (lv->isUnknown()) {
-        set(expression, new SymbolicBool(ScalarValue::ValueState::NotConstant));
+        set(expression, SymbolicValueArena::unknownBoolean());
         return;
     }
     if (rv->isUnknown()) {
-        set(expression, new SymbolicBool(ScalarValue::ValueState::NotConstant));
+        set(expression, SymbolicValueArena::unknownBoolean());
         return;
     }
 
@@ -813,7 +885,7 @@ void ExpressionEvaluator::postorder(const IR::Operation_Relation* expression) {
         DoConstantFolding cf(refMap, typeMap);
         auto result = expression->apply(cf);
         BUG_CHECK(result->is<IR::BoolLiteral>(), "%1%: expected a boolean", result);
-        set(expression, new SymbolicBool(result->to<IR::BoolLiteral>()));
+        set(expression, SymbolicValueArena::boolean(result->to<IR::BoolLiteral>()->value));
         return;
     } else if (l->is<SymbolicBool>()) {
         BUG_CHECK(r->is<SymbolicBool>(), "%1%: expected an SymbolicBool");
@@ -822,7 +894,7 @@ void ExpressionEvaluator::postorder(const IR::Operation_Relation* expression) {
         DoConstantFolding cf(refMap, typeMap);
         auto result = expression->apply(cf);
         BUG_CHECK(result->is<IR::BoolLiteral>(), "%1%: expected a boolean", result);
-        set(expression, new SymbolicBool(result->to<IR::BoolLiteral>()));
+        set(expression, SymbolicValueArena::boolean(result->to<IR::BoolLiteral>()->value));
         return;
     }
     BUG("%1%: unexpected type", l);
@@ -863,7 +935,8 @@ void ExpressionEvaluator::postorder(const IR::Member* expression) {
         set(expression, v);
     } else {
         BUG_CHECK(l->is<SymbolicStruct>(), "%1%: expected a struct", l);
-        auto v = l->to<SymbolicStruct>()->get(expression, expression->member.name);
+        // the evaluation of some expressions changes the values they use
+        auto v = l->to<SymbolicStruct>()->modify(expression, expression->member.name);
         set(expression, v);
     }
 }
@@ -907,7 +980,7 @@ void ExpressionEvaluator::postorder(const IR::ArrayIndex* expression) {
     CHECK_NULL(lv);
     auto ix = r->to<SymbolicInteger>();
     CHECK_NULL(ix);
-    auto result = lv->get(expression, ix->constant->asInt());
+    auto result = lv->modify(expression, ix->constant->asInt());
     set(expression, result);
 }
 
@@ -918,7 +991,7 @@ void ExpressionEvaluator::postorder(const IR::PathExpression* expression) {
     if (type->is<IR::Type_Error>())
         result = new SymbolicEnum(type, decl->getName());
     else
-        result = valueMap->get(decl);
+        result = valueMap->modify(decl);
     set(expression, result);
 }
 
@@ -978,9 +1051,9 @@ void ExpressionEvaluator::postorder(const IR::MethodCallExpression* expression)
     if (mi->is<ExternMethod>()) {
         // There are some extern methods that we know something about
         auto em = mi->to<ExternMethod>();
-        if (em->originalExternType->name.name == P4CoreLibrary::instance.packetIn.name) {
+        if (em->originalExternType->name.name == P4CoreLibrary::instance().packetIn.name) {
             // packet methods
-            if (em->method->name.name == P4CoreLibrary::instance.packetIn.extract.name) {
+            if (em->method->name.name == P4CoreLibrary::instance().packetIn.extract.name) {
                 // We know that after an extract terminates the header argument
                 // is always valid.
                 auto arg0 = expression->arguments->at(0);
@@ -1019,7 +1092,7 @@ void ExpressionEvaluator::postorder(const IR::MethodCallExpression* expression)
                 }
 
                 auto decl = em->object;
-                auto obj = valueMap->get(decl);
+                auto obj = valueMap->modify(decl);
                 CHECK_NULL(obj);
                 if (obj->is<SymbolicError>()) {
                     set(expression, obj);
@@ -16,7 +16,11 @@ limitations under the License.
 #ifndef _MIDEND_INTERPRETER_H_
 #define _MIDEND_INTERPRETER_H_
 
+#include <unordered_map>
+
 #include "ir/ir.h"
+#include "lib/arena.h"
+#include "lib/cow_map.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/typeMap.h"
 #include "frontends/p4/coreLibrary.h"
@@ -26,6 +30,8 @@ limitations under the License.
 namespace P4 {
 
 class SymbolicValueFactory;
+class SymbolicBool;
+class SymbolicInteger;
 
 // Base class for all abstract values
 class SymbolicValue {
@@ -37,6 +43,19 @@ class SymbolicValue {
  public:
     const unsigned id;
     const IR::Type* type;
+    // True if the value may be referenced from more than one place, so that it must be
+    // cloned before it is changed.  The values that contain others share them with their
+    // clones, and only copy the ones they change (see unshare).
+    bool shared = false;
+
+    // Allocated from the current SymbolicValueArena, if any.
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+    // Replaces @value with a clone of it if it is shared, and returns it.
+    template<typename T> static T* unshare(T*& value) {
+        if (value->shared)
+            value = value->clone()->template to<T>();
+        return value; }
     virtual bool isScalar() const = 0;
     virtual void dbprint(std::ostream& out) const = 0;
     template<typename T> T* to() {
@@ -46,6 +65,7 @@ class SymbolicValue {
         auto result = dynamic_cast<const T*>(this);
         CHECK_NULL(result); return result; }
     template<typename T> bool is() const { return dynamic_cast<const T*>(this) != nullptr; }
+    // The values contained in this one are shared with the clone.
     virtual SymbolicValue* clone() const = 0;
     virtual void setAllUnknown() = 0;
     virtual void assign(const SymbolicValue* other) = 0;
@@ -57,6 +77,33 @@ class SymbolicValue {
     virtual bool hasUninitializedParts() const = 0;
 };
 
+/**
+ * While a SymbolicValueArena is alive, the symbolic values its thread creates are allocated
+ * from an arena of its own, and are all released with it, so that an exploration such as
+ * the symbolic evaluation of a parser makes no garbage collected allocation per value.  It
+ * also interns the values the evaluator produces most often, the values of the integer
+ * literals and the booleans, which are shared and so never changed.  None of the values
+ * may be used once it is destroyed.
+ */
+class SymbolicValueArena {
+    Util::Arena                                                 arena;
+    SymbolicValueArena*                                         prev;
+    std::unordered_map<const IR::Constant*, SymbolicInteger*>   constants;
+    SymbolicBool*                                               bools[3] = {};
+    static thread_local SymbolicValueArena*                     current;
+    friend class SymbolicValue;
+
+ public:
+    SymbolicValueArena();
+    SymbolicValueArena(const SymbolicValueArena&) = delete;
+    ~SymbolicValueArena();
+
+    // These allocate a value of their own when there is no current arena.
+    static SymbolicInteger* constant(const IR::Constant* constant);
+    static SymbolicBool* boolean(bool value);
+    static SymbolicBool* unknownBoolean();
+};
+
 // Creates values from type declarations
 class SymbolicValueFactory {
     const TypeMap* typeMap;
@@ -72,26 +119,41 @@ class SymbolicValueFactory {
     unsigned getWidth(const IR::Type* type) const;
 };
 
+// The values of the variables.  A clone shares the values with the original, until either
+// changes them through modify().
 class ValueMap final : public IHasDbPrint {
  public:
-    std::map<const IR::IDeclaration*, SymbolicValue*> map;
+    cow_map<const IR::IDeclaration*, SymbolicValue*> map;
     ValueMap* clone() const {
         auto result = new ValueMap();
+        result->map = map;
         for (auto v : map)
-            result->map.emplace(v.first, v.second->clone());
+            v.second->shared = true;
         return result;
     }
     ValueMap* filter(std::function<bool(const IR::IDeclaration*, const SymbolicValue*)> filter) {
         auto result = new ValueMap();
         for (auto v : map)
-            if (filter(v.first, v.second))
+            if (filter(v.first, v.second)) {
+                v.second->shared = true;
                 result->map.emplace(v.first, v.second);
+            }
         return result;
     }
     void set(const IR::IDeclaration* left, SymbolicValue* right)
-    { CHECK_NULL(left); CHECK_NULL(right); map[left] = right; }
-    SymbolicValue* get(const IR::IDeclaration* left) const
-    { CHECK_NULL(left); return ::get(map, left); }
+    { CHECK_NULL(left); CHECK_NULL(right); right->shared = true; map[left] = right; }
+    SymbolicValue* get(const IR::IDeclaration* left) const {
+        CHECK_NULL(left);
+        auto v = map.getref(left);
+        return v ? *v : nullptr;
+    }
+    // Like get, but the value is not shared, so that it can be changed.
+    SymbolicValue* modify(const IR::IDeclaration* left) {
+        auto v = get(left);
+        if (v == nullptr || !v->shared)
+            return v;
+        return *map.modify(left) = v->clone();
+    }
 
     void dbprint(std::ostream& out) const {
         bool first = true;
@@ -108,7 +170,7 @@ class ValueMap final : public IHasDbPrint {
         for (auto d : map) {
             auto v = other->get(d.first);
             CHECK_NULL(v);
-            change = change || d.second->merge(v);
+            change = change || modify(d.first)->merge(v);
         }
         return change;
     }
@@ -258,7 +320,7 @@ class ScalarValue : public SymbolicValue {
 };
 
 class SymbolicVoid : public SymbolicValue {
-    SymbolicVoid() : SymbolicValue(IR::Type_Void::get()) {}
+    SymbolicVoid() : SymbolicValue(IR::Type_Void::get()) { shared = true; }
     static SymbolicVoid* instance;
  public:
     void dbprint(std::ostream& out) const override { out << "void"; }
@@ -369,19 +431,27 @@ class SymbolicEnum final : public ScalarValue {
 };
 
 class SymbolicStruct : public SymbolicValue {
+ protected:
+    // The value of @field, which is cloned first if it is shared.
+    SymbolicValue* modifyField(cstring field);
+
  public:
     explicit SymbolicStruct(const IR::Type_StructLike* type) :
             SymbolicValue(type) { CHECK_NULL(type); }
-    std::map<cstring, SymbolicValue*> fieldValue;
+    cow_map<cstring, SymbolicValue*> fieldValue;
     SymbolicStruct(const IR::Type_StructLike* type, bool uninitialized,
                    const SymbolicValueFactory* factory);
     virtual SymbolicValue* get(const IR::Node*, cstring field) const {
-        auto r = ::get(fieldValue, field);
+        auto r = fieldValue.getref(field);
         CHECK_NULL(r);
-        return r;
+        return *r;
     }
+    // Like get, but the value is not shared, so that it can be changed.
+    virtual SymbolicValue* modify(const IR::Node*, cstring field)
+    { return modifyField(field); }
     void set(cstring field, SymbolicValue* value) {
         CHECK_NULL(value);
+        value->shared = true;
         fieldValue[field] = value;
     }
     void dbprint(std::ostream& out) const override;
@@ -403,6 +473,7 @@ class SymbolicHeader : public SymbolicStruct {
     virtual void setValid(bool v);
     SymbolicValue* clone() const override;
     SymbolicValue* get(const IR::Node* node, cstring field) const override;
+    SymbolicValue* modify(const IR::Node* node, cstring field) override;
     void setAllUnknown() override;
     void assign(const SymbolicValue* other) override;
     void dbprint(std::ostream& out) const override;
@@ -427,9 +498,16 @@ class SymbolicArray final : public SymbolicValue {
             return new SymbolicStaticError(node, "Out of bounds");
         return values.at(index);
     }
+    // Like get, but the value is not shared, so that it can be changed.
+    SymbolicValue* modify(const IR::Node* node, size_t index) {
+        if (index >= values.size())
+            return new SymbolicStaticError(node, "Out of bounds");
+        return unshare(values.at(index));
+    }
     void shift(int amount);  // negative = shift left
     void set(size_t index, SymbolicHeader* value) {
         CHECK_NULL(value);
+        value->shared = true;
         values[index] = value;
     }
     void dbprint(std::ostream& out) const override;
@@ -491,7 +569,7 @@ class SymbolicTuple final : public SymbolicValue {
     void assign(const SymbolicValue*) override
     { BUG("%1%: tuples are read-only", this); }
     void add(SymbolicValue* value)
-    { values.push_back(value); }
+    { value->shared = true; values.push_back(value); }
     bool merge(const SymbolicValue* other) override;
     bool equals(const SymbolicValue* other) const override;
     bool hasUninitializedParts() const override;
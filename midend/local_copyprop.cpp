@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "local_copyprop.h"
+#include <algorithm>
 #include "has_side_effects.h"
 #include "expr_uses.h"
 
@@ -69,21 +70,31 @@ class DoLocalCopyPropagation::ElimDead : public Transform {
      * we run this over just the block (body and declarations) after copyprop
      * of the block, so it only removes those vars declared in the block */
     DoLocalCopyPropagation &self;
+    /// True if @name is a local that is never read
+    bool dead(cstring name) const {
+        int var = self.numbering.find(name);
+        return var >= 0 && self.available.tracked.getbit(var) &&
+               self.available.local.getbit(var) && !self.available.live.getbit(var); }
+    bool tracked(cstring name, bool &local) const {
+        int var = self.numbering.find(name);
+        if (var < 0 || !self.available.tracked.getbit(var)) return false;
+        local = self.available.local.getbit(var);
+        return true; }
     const IR::Node *preorder(IR::Declaration_Variable *var) override {
-        if (auto local = ::getref(self.available, var->name)) {
-            if (local->local && !local->live) {
-                LOG3("  removing dead local " << var->name);
-                return nullptr; } }
+        if (dead(var->name)) {
+            LOG3("  removing dead local " << var->name);
+            return nullptr; }
         return var; }
     const IR::Statement *postorder(IR::AssignmentStatement *as) override {
         if (auto dest = lvalue_out(as->left)->to<IR::PathExpression>()) {
-            if (auto var = ::getref(self.available, dest->path->name)) {
-                if (var->local && !var->live) {
+            bool local = false;
+            if (tracked(dest->path->name, local)) {
+                if (dead(dest->path->name)) {
                     LOG3("  removing dead assignment to " << dest->path->name);
                     if (self.hasSideEffects(as->right))
                         return makeSideEffectStatement(as->right);
                     return nullptr;
-                } else if (var->local) {
+                } else if (local) {
                     LOG6("  not removing live assignment to " << dest->path->name);
                 } else {
                     LOG6("  not removing assignment to non-local " << dest->path->name); } } }
@@ -157,17 +168,50 @@ class DoLocalCopyPropagation::RewriteTableKeys : public Transform {
     explicit RewriteTableKeys(DoLocalCopyPropagation &self) : self(self) {}
 };
 
+unsigned DoLocalCopyPropagation::VarNumbering::get(cstring name) {
+    auto it = index.find(name);
+    if (it != index.end()) return it->second;
+    unsigned var = names.size();
+    index.emplace(name, var);
+    names.push_back(name);
+    overlaps.emplace_back();
+    overlaps[var].setbit(var);
+    for (unsigned other = 0; other < var; ++other) {
+        if (name_overlap(name, names[other])) {
+            overlaps[var].setbit(other);
+            overlaps[other].setbit(var); } }
+    return var;
+}
+
+bool DoLocalCopyPropagation::VarNumbering::valueUses(const IR::Expression *value, unsigned var) {
+    auto &known = uses[value->id];
+    if (!known.first.getbit(var)) {
+        known.first.setbit(var);
+        if (exprUses(value, names.at(var)))
+            known.second.setbit(var); }
+    return known.second.getbit(var);
+}
+
+void DoLocalCopyPropagation::Available::set(unsigned var, const IR::Expression *val) {
+    tracked.setbit(var);
+    if (val) {
+        if (value.size() <= var) value.resize(var + 1);
+        value[var] = val;
+        hasValue.setbit(var);
+    } else {
+        hasValue.clrbit(var); }
+}
+
 void DoLocalCopyPropagation::flow_merge(Visitor &a_) {
     auto &a = dynamic_cast<DoLocalCopyPropagation &>(a_);
     BUG_CHECK(working == a.working, "inconsitent DoLocalCopyPropagation state on merge");
-    for (auto &var : available) {
-        if (auto merge = ::getref(a.available, var.first)) {
-            if (merge->val != var.second.val)
-                var.second.val = nullptr;
-            if (merge->live)
-                var.second.live = true;
-        } else {
-            var.second.val = nullptr; } }
+    const Available &other = a.available;
+    // a value survives only if the other branch has the same one
+    available.hasValue -= available.tracked - other.tracked;
+    for (auto var : available.hasValue & other.tracked)
+        if (other.get(var) != available.value[var])
+            available.hasValue.clrbit(var);
+    available.live |= other.live & available.tracked;
     need_key_rewrite |= a.need_key_rewrite;
 }
 
@@ -182,44 +226,54 @@ bool DoLocalCopyPropagation::name_overlap(cstring name1, cstring name2) {
 }
 
 void DoLocalCopyPropagation::forOverlapAvail(cstring name,
-                                             std::function<void(cstring, VarInfo *)> fn) {
-    for (const char *pfx = name.c_str(); *pfx; pfx += strspn(pfx, ".[")) {
-        pfx += strcspn(pfx, ".[");
-        auto it = available.find(name.before(pfx));
-        if (it != available.end())
-            fn(it->first, &it->second); }
-    for (auto it = available.upper_bound(name); it != available.end(); ++it) {
-        if (!it->first.startsWith(name) || !strchr(".[", it->first.get(name.size())))
-            break;
-        fn(it->first, &it->second); }
+                                             std::function<void(cstring, unsigned)> fn) {
+    // the containing names first, from the outermost, then the contained ones in order
+    std::vector<unsigned> vars;
+    for (auto var : numbering.overlapping(numbering.get(name)) & available.tracked)
+        vars.push_back(var);
+    auto &names = numbering.names;
+    std::sort(vars.begin(), vars.end(), [&names, name](unsigned a, unsigned b) {
+        bool ca = names[a].size() <= name.size(), cb = names[b].size() <= name.size();
+        if (ca != cb) return ca;
+        return ca ? names[a].size() < names[b].size() : names[a] < names[b]; });
+    for (auto var : vars)
+        fn(names[var], var);
 }
 
 void DoLocalCopyPropagation::dropValuesUsing(cstring name) {
     LOG6("dropValuesUsing(" << name << ")");
-    for (auto &var : available) {
-        LOG7("  checking " << var.first << " = " << var.second.val);
-        if (name_overlap(var.first, name)) {
-            LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << "as " << name <<
-                 " is being assigned to");
-            var.second.val = nullptr;
-        } else if (var.second.val && exprUses(var.second.val, name)) {
-            LOG4("   dropping " << (var.second.val ? "" : "(nop) ") << var.first <<
-                 " as it uses " << name);
-            var.second.val = nullptr; } }
+    unsigned written = numbering.get(name);
+    const bitvec &overlapping = numbering.overlapping(written);
+    for (auto var : bitvec(available.hasValue)) {
+        LOG7("  checking " << numbering.names[var] << " = " << available.value[var]);
+        if (overlapping.getbit(var)) {
+            LOG4("   dropping as " << name << " is being assigned to");
+            available.hasValue.clrbit(var);
+        } else if (numbering.valueUses(available.value[var], written)) {
+            LOG4("   dropping " << numbering.names[var] << " as it uses " << name);
+            available.hasValue.clrbit(var); } }
+}
+
+void DoLocalCopyPropagation::finishBlock() {
+    working = false;
+    available.clear();
+    numbering.clear();
+    numbering.clear();
 }
 
 void DoLocalCopyPropagation::visit_local_decl(const IR::Declaration_Variable *var) {
     LOG4("Visiting " << var);
-    if (available.count(var->name))
+    unsigned local = numbering.get(var->name);
+    if (available.tracked.getbit(local))
         BUG("duplicate var declaration for %s", var->name);
-    auto &local = available[var->name];
-    local.local = true;
+    available.set(local, nullptr);
+    available.local.setbit(local);
     if (var->initializer) {
         if (!hasSideEffects(var->initializer)) {
             LOG3("  saving init value for " << var->name << ": " << var->initializer);
-            local.val = var->initializer;
+            available.set(local, var->initializer);
         } else {
-            local.live = true; } }
+            available.live.setbit(local); } }
 }
 
 const IR::Node *DoLocalCopyPropagation::postorder(IR::Declaration_Variable *var) {
@@ -252,24 +306,25 @@ const IR::Expression *DoLocalCopyPropagation::copyprop_name(cstring name) {
              * read, but we can't dead-code eliminate it without eliminating the entire
              * call, so we mark it as live.  Unfortunate as we then won't dead-code
              * remove other assignmnents. */
-            forOverlapAvail(name, [name](cstring, VarInfo *var) {
+            forOverlapAvail(name, [this, name](cstring, unsigned var) {
                 LOG4("  using " << name << " in read-write");
-                var->live = true; });
+                available.live.setbit(var); });
             if (inferForFunc)
                 inferForFunc->reads.insert(name); }
         return nullptr; }
-    if (auto var = ::getref(available, name)) {
-        if (var->val) {
-            if (policy(getChildContext(), var->val)) {
-                LOG3("  propagating value for " << name << ": " << var->val);
-                return var->val; }
-            LOG3("  policy rejects propagation of " << name << ": " << var->val);
+    int var = numbering.find(name);
+    if (var >= 0 && available.tracked.getbit(var)) {
+        if (auto val = available.get(var)) {
+            if (policy(getChildContext(), val)) {
+                LOG3("  propagating value for " << name << ": " << val);
+                return val; }
+            LOG3("  policy rejects propagation of " << name << ": " << val);
         } else {
             LOG4("  using " << name << " with no propagated value"); }
-        var->live = true; }
-    forOverlapAvail(name, [name](cstring, VarInfo *var) {
+        available.live.setbit(var); }
+    forOverlapAvail(name, [this, name](cstring, unsigned var) {
         LOG4("  using part of " << name);
-        var->live = true; });
+        available.live.setbit(var); });
     if (inferForFunc)
         inferForFunc->reads.insert(name);
     return nullptr;
@@ -340,7 +395,7 @@ IR::AssignmentStatement *DoLocalCopyPropagation::postorder(IR::AssignmentStateme
                  * may make things worse rather than better */
                 return as; }
             LOG3("  saving value for " << dest << ": " << as->right);
-            available[dest].val = as->right;
+            available.set(numbering.get(dest), as->right);
         } else {
             LOG3("Can't copyprop " << as->right << " due to side effects"); }
     } else {
@@ -417,9 +472,9 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
                     return mc; }
             } else if (mem->expr->type->is<IR::Type_Header>()) {
                 if (mem->member == "isValid") {
-                    forOverlapAvail(obj, [obj](cstring, VarInfo *var) {
+                    forOverlapAvail(obj, [this, obj](cstring, unsigned var) {
                         LOG4("  using " << obj << " (isValid)");
-                        var->live = true; });
+                        available.live.setbit(var); });
                     if (inferForFunc)
                         inferForFunc->reads.insert(obj);
                 } else {
@@ -434,9 +489,9 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
                 BUG_CHECK(mem->member == "push_front" || mem->member == "pop_front",
                           "Unexpected stack method %s", mem->member);
                 dropValuesUsing(obj);
-                forOverlapAvail(obj, [obj](cstring, VarInfo *var) {
+                forOverlapAvail(obj, [this, obj](cstring, unsigned var) {
                     LOG4("  using " << obj << " (push/pop)");
-                    var->live = true; });
+                    available.live.setbit(var); });
                 if (inferForFunc) {
                     inferForFunc->reads.insert(obj);
                     inferForFunc->writes.insert(obj); }
@@ -452,14 +507,14 @@ IR::MethodCallExpression *DoLocalCopyPropagation::postorder(IR::MethodCallExpres
             // maybe should have annotations if it does
             return mc; } }
     LOG3("unknown method call " << mc->method << " clears all nonlocal saved values");
-    for (auto &var : available) {
-        if (!var.second.local) {
-            LOG7("    may access non-local " << var.first);
-            var.second.val = nullptr;
-            var.second.live = true;
-            if (inferForFunc) {
-                inferForFunc->reads.insert(var.first);
-                inferForFunc->writes.insert(var.first); } } }
+    for (auto var : available.tracked - available.local) {
+        auto name = numbering.names[var];
+        LOG7("    may access non-local " << name);
+        available.hasValue.clrbit(var);
+        available.live.setbit(var);
+        if (inferForFunc) {
+            inferForFunc->reads.insert(name);
+            inferForFunc->writes.insert(name); } }
     return mc;
 }
 
@@ -478,8 +533,7 @@ IR::P4Action *DoLocalCopyPropagation::postorder(IR::P4Action *act) {
     LOG5(act);
     BUG_CHECK(inferForFunc == &actions[act->name], "corrupt internal data struct");
     act->body = act->body->apply(ElimDead(*this))->to<IR::BlockStatement>();
-    working = false;
-    available.clear();
+    finishBlock();
     LOG3("DoLocalCopyPropagation finished action " << act->name);
     LOG4("reads=" << inferForFunc->reads << " writes=" << inferForFunc->writes);
     LOG4(act);
@@ -514,8 +568,7 @@ IR::Function *DoLocalCopyPropagation::postorder(IR::Function *fn) {
     LOG5(fn);
     BUG_CHECK(inferForFunc == &methods[name], "corrupt internal data struct");
     fn->body = fn->body->apply(ElimDead(*this))->to<IR::BlockStatement>();
-    working = false;
-    available.clear();
+    finishBlock();
     LOG3("DoLocalCopyPropagation finished function " << name);
     LOG4("reads=" << inferForFunc->reads << " writes=" << inferForFunc->writes);
     LOG4(fn);
@@ -556,8 +609,7 @@ IR::P4Control *DoLocalCopyPropagation::preorder(IR::P4Control *ctrl) {
     LOG5(ctrl);
     ctrl->controlLocals = *ctrl->controlLocals.apply(ElimDead(*this));
     ctrl->body = ctrl->body->apply(ElimDead(*this))->to<IR::BlockStatement>();
-    working = false;
-    available.clear();
+    finishBlock();
     LOG3("DoLocalCopyPropagation finished control " << ctrl->name);
     LOG4(ctrl);
     prune();
@@ -570,8 +622,8 @@ void DoLocalCopyPropagation::apply_function(DoLocalCopyPropagation::FuncInfo *ac
     for (auto write : act->writes)
         dropValuesUsing(write);
     for (auto read : act->reads)
-        forOverlapAvail(read, [](cstring, VarInfo *var) {
-            var->live = true; });
+        forOverlapAvail(read, [this](cstring, unsigned var) {
+            available.live.setbit(var); });
     if (inferForFunc) {
         inferForFunc->writes.insert(act->writes.begin(), act->writes.end());
         inferForFunc->reads.insert(act->reads.begin(), act->reads.end()); }
@@ -580,26 +632,27 @@ void DoLocalCopyPropagation::apply_function(DoLocalCopyPropagation::FuncInfo *ac
 void DoLocalCopyPropagation::apply_table(DoLocalCopyPropagation::TableInfo *tbl) {
     ++tbl->apply_count;
     for (auto key : tbl->keyreads) {
-        forOverlapAvail(key, [key, tbl, this](cstring vname, VarInfo *var) {
-            if (var->val && lvalue_out(var->val)->is<IR::PathExpression>()) {
+        forOverlapAvail(key, [key, tbl, this](cstring vname, unsigned var) {
+            auto val = available.get(var);
+            if (val && lvalue_out(val)->is<IR::PathExpression>()) {
                 if (tbl->apply_count > 1 &&
-                    (!tbl->key_remap.count(vname) || !tbl->key_remap.at(vname)->equiv(*var->val))) {
+                    (!tbl->key_remap.count(vname) || !tbl->key_remap.at(vname)->equiv(*val))) {
                     LOG3("  different values used in different applies for key " << key);
                     tbl->key_remap.erase(vname);
-                    var->live = true;
-                } else if (policy(getChildContext(), var->val)) {
-                    LOG3("  will propagate value into table key " << vname << ": " << var->val);
-                    tbl->key_remap.emplace(vname, var->val);
+                    available.live.setbit(var);
+                } else if (policy(getChildContext(), val)) {
+                    LOG3("  will propagate value into table key " << vname << ": " << val);
+                    tbl->key_remap.emplace(vname, val);
                     need_key_rewrite = true;
                 } else {
                     LOG3("  policy prevents propagation of value into table key " <<
-                         vname << ": " << var->val);
-                    var->live = true; }
+                         vname << ": " << val);
+                    available.live.setbit(var); }
             } else {
                 tbl->key_remap.erase(key);
                 LOG4("  table using " << key << " with " <<
-                     (var->val ? "value to complex for key" : "no propagated value"));
-                var->live = true; } }); }
+                     (val ? "value to complex for key" : "no propagated value"));
+                available.live.setbit(var); } }); }
     for (auto action : tbl->actions)
         apply_function(&actions[action]);
 }
@@ -630,8 +683,7 @@ const IR::P4Parser *DoLocalCopyPropagation::postorder(IR::P4Parser *parser) {
     for (auto *state : parser->states)
         apply_function(&states[state->name]);
     auto *rv = parser->apply(ElimDead(*this));
-    working = false;
-    available.clear();
+    finishBlock();
     return rv;
 }
 
@@ -650,9 +702,8 @@ IR::ParserState *DoLocalCopyPropagation::postorder(IR::ParserState *state) {
     LOG5("DoLocalCopyPropagation before ElimDead " << state->name);
     LOG5(state);
     state->components = *state->components.apply(ElimDead(*this));
-    working = false;
+    finishBlock();
     inferForFunc = nullptr;
-    available.clear();
     LOG3("DoLocalCopyPropagation finished parser state " << state->name);
     LOG4(state);
     return state;
@@ -16,7 +16,12 @@ limitations under the License.
 #ifndef MIDEND_LOCAL_COPYPROP_H_
 #define MIDEND_LOCAL_COPYPROP_H_
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "ir/ir.h"
+#include "lib/bitvec.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "has_side_effects.h"
@@ -48,16 +53,15 @@ policy should only evaluate the potential cost of propagating, as propagated exp
 may be evaluated mulitple times.  The default policy just returns true -- always propagate
 if legal to do so.
 
+The names of the variables and fields used in each action, function, control or parser
+state are numbered as they are seen, and the flow state copied at every branch is a few
+bitvecs over those numbers plus a vector of the values that can be propagated.
+
  */
 class DoLocalCopyPropagation : public ControlFlowVisitor, Transform, P4WriteContext {
     ReferenceMap                *refMap;
     TypeMap                     *typeMap;
     bool                        working = false;
-    struct VarInfo {
-        bool                    local = false;
-        bool                    live = false;
-        const IR::Expression    *val = nullptr;
-    };
     struct TableInfo {
         std::set<cstring>       keyreads, actions;
         int                                             apply_count = 0;
@@ -67,7 +71,43 @@ class DoLocalCopyPropagation : public ControlFlowVisitor, Transform, P4WriteCont
         std::set<cstring>       reads, writes;
         int                     apply_count = 0;
     };
-    std::map<cstring, VarInfo>          available;
+    /// Numbers the variables, fields and stack elements seen in the block being
+    /// worked on, so that the sets of them in the flow state are bitvecs.  Shared
+    /// between flow_clones.
+    class VarNumbering {
+        std::unordered_map<cstring, unsigned>   index;
+        std::vector<bitvec>                     overlaps;  // names overlapping each name
+        /// For each saved value, by node id as replaced values may be collected, the names
+        /// for which exprUses was computed and its results.
+        std::unordered_map<int, std::pair<bitvec, bitvec>>      uses;
+
+     public:
+        std::vector<cstring>                    names;
+        /// The number of @name, which is numbered if it was not seen before.
+        unsigned get(cstring name);
+        /// The number of @name, or -1 if it was not seen
+        int find(cstring name) const {
+            auto it = index.find(name);
+            return it == index.end() ? -1 : int(it->second); }
+        const bitvec &overlapping(unsigned var) const { return overlaps.at(var); }
+        /// exprUses(@value, names[@var]), remembered
+        bool valueUses(const IR::Expression *value, unsigned var);
+        void clear() { index.clear(); overlaps.clear(); uses.clear(); names.clear(); }
+    };
+    /// The flow state: which numbered names are tracked, local to the block, read
+    /// in the block, and have a value that may be propagated.
+    struct Available {
+        bitvec                                  tracked, local, live, hasValue;
+        std::vector<const IR::Expression *>     value;  // meaningful where hasValue is set
+        const IR::Expression *get(unsigned var) const {
+            return hasValue.getbit(var) ? value.at(var) : nullptr; }
+        void set(unsigned var, const IR::Expression *val);
+        bool empty() const { return tracked.empty(); }
+        void clear() { tracked.clear(); local.clear(); live.clear(); hasValue.clear();
+                       value.clear(); }
+    };
+    VarNumbering                        &numbering;
+    Available                           available;
     std::map<cstring, TableInfo>        &tables;
     std::map<cstring, FuncInfo>         &actions;
     std::map<cstring, FuncInfo>         &methods;
@@ -80,9 +120,10 @@ class DoLocalCopyPropagation : public ControlFlowVisitor, Transform, P4WriteCont
 
     DoLocalCopyPropagation *clone() const override { return new DoLocalCopyPropagation(*this); }
     void flow_merge(Visitor &) override;
-    bool name_overlap(cstring, cstring);
-    void forOverlapAvail(cstring, std::function<void(cstring, VarInfo *)>);
+    static bool name_overlap(cstring, cstring);
+    void forOverlapAvail(cstring, std::function<void(cstring, unsigned)>);
     void dropValuesUsing(cstring);
+    void finishBlock();
     bool hasSideEffects(const IR::Expression *e) {
         return bool(::hasSideEffects(refMap, typeMap, e)); }
 
@@ -118,7 +159,8 @@ class DoLocalCopyPropagation : public ControlFlowVisitor, Transform, P4WriteCont
  public:
     DoLocalCopyPropagation(ReferenceMap* refMap, TypeMap* typeMap,
         std::function<bool(const Context *, const IR::Expression *)> policy, bool eut)
-    : refMap(refMap), typeMap(typeMap), tables(*new std::map<cstring, TableInfo>),
+    : refMap(refMap), typeMap(typeMap), numbering(*new VarNumbering),
+      tables(*new std::map<cstring, TableInfo>),
       actions(*new std::map<cstring, FuncInfo>), methods(*new std::map<cstring, FuncInfo>),
       states(*new std::map<cstring, FuncInfo>), policy(policy), elimUnusedTables(eut) {}
 };
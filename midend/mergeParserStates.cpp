@@ -0,0 +1,127 @@
+#include "mergeParserStates.h"
+
+#include "frontends/p4/cloner.h"
+#include "frontends/p4/coreLibrary.h"
+#include "frontends/p4/methodInstance.h"
+#include "frontends/p4/parserCallGraph.h"
+
+namespace P4 {
+
+bool MergeParserStatesPolicy::duplicate(const IR::ParserState* state) const {
+    if (state->components.size() > maxStatements)
+        return false;
+    for (auto component : state->components)
+        if (component->is<IR::Declaration>())
+            return false;
+    return true;
+}
+
+const IR::Node* DoMergeParserStates::preorder(IR::P4Parser* parser) {
+    ParserCallGraph transitions("transitions");
+    parser->apply(ComputeParserCG(refMap, &transitions));
+
+    bool changed = false;
+    IR::IndexedVector<IR::ParserState> states;
+    for (auto state : parser->states) {
+        if (state->name == IR::ParserState::accept || state->name == IR::ParserState::reject) {
+            states.push_back(state);
+            continue;
+        }
+        auto components = state->components;
+        auto select = state->selectExpression;
+        std::set<cstring> chain = { state->name };
+        bool copying = false;
+        while (auto path = select ? select->to<IR::PathExpression>() : nullptr) {
+            // Copied transitions are not in refMap, so the states are looked up by name.
+            auto next = parser->states.getDeclaration<IR::ParserState>(path->path->name);
+            if (next == nullptr || chain.count(next->name) ||
+                next->name == IR::ParserState::accept ||
+                next->name == IR::ParserState::reject ||
+                next->name == IR::ParserState::start ||
+                !next->annotations->annotations.empty())
+                break;
+            std::set<const IR::ParserState*> callers;
+            if (auto in = transitions.getCallers(next))
+                callers.insert(in->begin(), in->end());
+            // Once a state is copied, the states it absorbs are copied with it.
+            if (callers.size() == 1 && !copying) {
+                components.append(next->components);
+                select = next->selectExpression;
+            } else if (callers.size() == 1 || policy->duplicate(next)) {
+                copying = true;
+                ClonePathExpressions cloner;
+                for (auto component : next->components)
+                    components.push_back(cloner.clone<IR::StatOrDecl>(component));
+                select = cloner.clone<IR::Expression>(next->selectExpression);
+            } else {
+                break;
+            }
+            LOG2("Merging " << dbp(next) << " into " << dbp(state));
+            chain.emplace(next->name);
+        }
+        if (chain.size() > 1) {
+            changed = true;
+            state = new IR::ParserState(state->srcInfo, state->name, state->annotations,
+                                        components, select);
+        }
+        states.push_back(state);
+    }
+    if (changed)
+        parser->states = states;
+    prune();
+    return parser;
+}
+
+Visitor::profile_t FindParserExtractRuns::init_apply(const IR::Node* node) {
+    runs->clear();
+    return Inspector::init_apply(node);
+}
+
+unsigned FindParserExtractRuns::extractWidth(const IR::StatOrDecl* statement) const {
+    auto call = statement->to<IR::MethodCallStatement>();
+    if (call == nullptr)
+        return 0;
+    auto mi = MethodInstance::resolve(call, refMap, typeMap);
+    auto em = mi->to<ExternMethod>();
+    auto& corelib = P4CoreLibrary::instance();
+    if (em == nullptr || em->originalExternType->name != corelib.packetIn.name ||
+        em->method->name != corelib.packetIn.extract.name ||
+        call->methodCall->arguments->size() != 1)
+        return 0;
+    auto header = typeMap->getType(call->methodCall->arguments->at(0)->expression, true);
+    if (!header->is<IR::Type_Header>())
+        return 0;
+    unsigned width = 0;
+    for (auto field : header->to<IR::Type_Header>()->fields) {
+        auto type = typeMap->getType(field, true);
+        if (!type->is<IR::Type_Bits>() && !type->is<IR::Type_Boolean>())
+            return 0;
+        width += type->width_bits();
+    }
+    return width;
+}
+
+bool FindParserExtractRuns::preorder(const IR::ParserState* state) {
+    auto& components = state->components;
+    for (size_t start = 0; start < components.size(); ) {
+        unsigned width = extractWidth(components.at(start));
+        size_t end = start + 1;
+        if (width != 0) {
+            for (; end < components.size(); end++) {
+                unsigned next = extractWidth(components.at(end));
+                if (next == 0)
+                    break;
+                width += next;
+            }
+        }
+        if (end - start > 1) {
+            runs->widths.emplace(components.at(start)->to<IR::MethodCallStatement>(), width);
+            for (size_t i = start + 1; i < end; i++)
+                runs->covered.emplace(components.at(i)->to<IR::MethodCallStatement>());
+        }
+        start = end;
+    }
+    return false;
+}
+
+}  // namespace P4
@@ -0,0 +1,147 @@
+#ifndef _MIDEND_MERGEPARSERSTATES_H_
+#define _MIDEND_MERGEPARSERSTATES_H_
+
+#include <map>
+#include <set>
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/simplifyParsers.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * Policy for MergeParserStates: decides which states that are reached from several
+ * states can be copied into their predecessors.
+ */
+class MergeParserStatesPolicy {
+    unsigned maxStatements;
+
+ public:
+    explicit MergeParserStatesPolicy(unsigned maxStatements = 4) :
+            maxStatements(maxStatements) {}
+    virtual ~MergeParserStatesPolicy() {}
+    /// True if @state may be copied into the states that always transition to it.
+    /// By default this is the case for states with at most maxStatements statements
+    /// and no declarations.
+    virtual bool duplicate(const IR::ParserState* state) const;
+};
+
+/**
+ * Merges each parser state with the states it always transitions to, following chains of
+ * unconditional transitions.  Unlike SimplifyParsers, a successor with several
+ * predecessors is merged, by copying it, when the policy allows it.  The accept, reject
+ * and start states, states with annotations and states already in the chain are never
+ * merged.  The states that become unreachable are removed by SimplifyParsers.
+ *
+ * \code{.cpp}
+ *  state start { transition select(p.lookahead<bit<8>>()) { 1: a; default: b; } }
+ *  state a { p.extract(h.x); transition c; }
+ *  state b { p.extract(h.y); transition c; }
+ *  state c { p.extract(h.z); transition accept; }
+ * \endcode
+ *
+ * becomes
+ *
+ * \code{.cpp}
+ *  state start { transition select(p.lookahead<bit<8>>()) { 1: a; default: b; } }
+ *  state a { p.extract(h.x); p.extract(h.z); transition accept; }
+ *  state b { p.extract(h.y); p.extract(h.z); transition accept; }
+ * \endcode
+ *
+ * @pre References are resolved.
+ */
+class DoMergeParserStates : public Transform {
+    ReferenceMap*                   refMap;
+    const MergeParserStatesPolicy*  policy;
+
+ public:
+    DoMergeParserStates(ReferenceMap* refMap, const MergeParserStatesPolicy* policy) :
+            refMap(refMap), policy(policy) {
+        CHECK_NULL(refMap); CHECK_NULL(policy);
+        setName("DoMergeParserStates");
+    }
+    const IR::Node* preorder(IR::P4Parser* parser) override;
+    const IR::Node* preorder(IR::P4Control* control) override
+    { prune(); return control; }
+};
+
+/**
+ * The runs of consecutive extracts of fixed-size headers in the parser states.  A target
+ * can check once, before the first extract of a run, that the packet holds all the
+ * headers of the run, instead of checking before each extract.  When the packet is too
+ * short the parser then rejects it without extracting the first headers of the run, so
+ * this is only suitable for targets that do not expose the headers of rejected packets.
+ */
+class ParserExtractRuns {
+    friend class FindParserExtractRuns;
+    /// The width in bits of each run, indexed by its first extract.
+    std::map<const IR::MethodCallStatement*, unsigned> widths;
+    /// The extracts of the runs other than the first ones.
+    std::set<const IR::MethodCallStatement*> covered;
+
+ public:
+    void clear() { widths.clear(); covered.clear(); }
+    /// The total width in bits of the run starting at @extract, or 0 if it starts no run.
+    unsigned runWidth(const IR::MethodCallStatement* extract) const {
+        auto it = widths.find(extract);
+        return it == widths.end() ? 0 : it->second; }
+    /// True if the length of the packet for @extract is checked by an earlier extract.
+    bool isCovered(const IR::MethodCallStatement* extract) const
+    { return covered.count(extract) != 0; }
+};
+
+/// Computes the ParserExtractRuns of a program.
+/// @pre The program is type checked.
+class FindParserExtractRuns : public Inspector {
+    ReferenceMap*       refMap;
+    TypeMap*            typeMap;
+    ParserExtractRuns*  runs;
+
+    /// If @statement extracts a fixed-size header, its width in bits, otherwise 0.
+    unsigned extractWidth(const IR::StatOrDecl* statement) const;
+
+ public:
+    FindParserExtractRuns(ReferenceMap* refMap, TypeMap* typeMap, ParserExtractRuns* runs) :
+            refMap(refMap), typeMap(typeMap), runs(runs) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(runs);
+        setName("FindParserExtractRuns");
+    }
+    Visitor::profile_t init_apply(const IR::Node* node) override;
+    bool preorder(const IR::ParserState* state) override;
+    bool preorder(const IR::P4Control*) override { return false; }
+};
+
+/**
+ * Merges the chains of parser states, and optionally computes the runs of extracts whose
+ * length checks can be merged.  Targets that want merged length checks pass @runs, which
+ * describes the program returned by this pass.
+ */
+class MergeParserStates : public PassManager {
+    MergeParserStatesPolicy defaultPolicy;
+
+ public:
+    MergeParserStates(ReferenceMap* refMap, TypeMap* typeMap,
+                      const MergeParserStatesPolicy* policy = nullptr,
+                      ParserExtractRuns* runs = nullptr,
+                      TypeChecking* typeChecking = nullptr) {
+        if (!policy)
+            policy = &defaultPolicy;
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap);
+        passes.push_back(typeChecking);
+        passes.push_back(new DoMergeParserStates(refMap, policy));
+        passes.push_back(new SimplifyParsers(refMap));
+        if (runs) {
+            passes.push_back(new TypeChecking(refMap, typeMap));
+            passes.push_back(new FindParserExtractRuns(refMap, typeMap, runs));
+        }
+        setName("MergeParserStates");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_MERGEPARSERSTATES_H_ */
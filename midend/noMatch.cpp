@@ -32,7 +32,7 @@ const IR::Node* DoHandleNoMatch::postorder(IR::SelectExpression* expression) {
 }
 
 const IR::Node* DoHandleNoMatch::preorder(IR::P4Parser* parser) {
-    P4CoreLibrary& lib = P4CoreLibrary::instance;
+    P4CoreLibrary& lib = P4CoreLibrary::instance();
 
     cstring name = nameGen->newName("noMatch");
     LOG2("Inserting " << name << " state");
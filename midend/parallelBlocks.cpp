@@ -0,0 +1,146 @@
+#include "parallelBlocks.h"
+
+#include "lib/thread_pool.h"
+
+namespace P4 {
+
+namespace {
+
+/// Hands out the fresh names for one block, remembering them so that names also handed
+/// out for another block can be fixed up afterwards.
+class BlockNames : public NameGenerator {
+    MinimalNameGenerator        names;
+
+ public:
+    std::vector<cstring>        generated;
+    explicit BlockNames(const MinimalNameGenerator &program) : names(program) {}
+    cstring newName(cstring base) override {
+        cstring name = names.newName(base);
+        generated.push_back(name);
+        return name; }
+};
+
+/// Renames the declarations of and references to generated names in a block.  The names
+/// were fresh for the whole program, so every use of one refers to the new declaration.
+class RenameGenerated : public Transform {
+    const std::map<cstring, cstring>    &renames;
+
+    IR::ID rename(const IR::ID &id) const {
+        auto it = renames.find(id.name);
+        return it == renames.end() ? id : IR::ID(id.srcInfo, it->second, id.originalName); }
+    const IR::Node *postorder(IR::Path *path) override {
+        path->name = rename(path->name);
+        return path; }
+    const IR::Node *postorder(IR::Declaration *decl) override {
+        decl->name = rename(decl->name);
+        return decl; }
+    const IR::Node *postorder(IR::Type_Declaration *decl) override {
+        decl->name = rename(decl->name);
+        return decl; }
+
+ public:
+    explicit RenameGenerated(const std::map<cstring, cstring> &renames) : renames(renames) {
+        setName("RenameGenerated"); }
+};
+
+/// A block with nothing inside, standing in for a block processed by another thread.
+const IR::Node *stub(const IR::Node *block) {
+    if (auto *control = block->to<IR::P4Control>()) {
+        auto *rv = control->clone();
+        rv->controlLocals.clear();
+        rv->body = new IR::BlockStatement(control->body->srcInfo);
+        return rv; }
+    auto *parser = block->to<IR::P4Parser>();
+    CHECK_NULL(parser);
+    auto *rv = parser->clone();
+    rv->parserLocals.clear();
+    rv->states.clear();
+    rv->states.push_back(new IR::ParserState(IR::ParserState::start,
+                                             new IR::PathExpression(IR::ParserState::accept)));
+    for (auto *state : parser->states)
+        if (state->name == IR::ParserState::accept || state->name == IR::ParserState::reject)
+            rv->states.push_back(state);
+    return rv;
+}
+
+}  // namespace
+
+const IR::Node *ParallelBlocks::apply_visitor(const IR::Node *node, const char *) {
+    auto *program = node->to<IR::P4Program>();
+    BUG_CHECK(program, "%1%: ParallelBlocks must be applied to a whole program", node);
+    std::vector<size_t> blocks;
+    for (size_t i = 0; i < program->objects.size(); ++i)
+        if (program->objects.at(i)->is<IR::P4Control>() ||
+            program->objects.at(i)->is<IR::P4Parser>())
+            blocks.push_back(i);
+    const IR::Node *result = nullptr;
+    if (blocks.size() > 1 && Util::ThreadPool::global().concurrency() > 1 &&
+        runParallel(program, blocks, result))
+        return result;
+    LOG2("ParallelBlocks running sequentially");
+    return program->apply(*sequential);
+}
+
+bool ParallelBlocks::runParallel(const IR::P4Program *program, const std::vector<size_t> &blocks,
+                                 const IR::Node *&result) {
+    struct task_t {
+        const IR::P4Program     *input = nullptr;
+        const IR::Node          *output = nullptr;
+        BlockNames              *names = nullptr;
+    };
+    std::vector<task_t> tasks(blocks.size());
+    std::map<size_t, const IR::Node *> stubs;
+    for (auto i : blocks) stubs.emplace(i, stub(program->objects.at(i)));
+    MinimalNameGenerator programNames(program);
+    for (size_t t = 0; t < blocks.size(); ++t) {
+        IR::Vector<IR::Node> objects;
+        for (size_t i = 0; i < program->objects.size(); ++i)
+            objects.push_back(stubs.count(i) && i != blocks[t] ? stubs.at(i)
+                                                                : program->objects.at(i));
+        tasks[t].input = new IR::P4Program(program->srcInfo, objects);
+        tasks[t].names = new BlockNames(programNames); }
+
+    Util::ThreadPool::global().parallel_for(tasks.size(), [&](size_t t) {
+        auto *blockRefMap = new ReferenceMap;
+        blockRefMap->setIsV1(refMap->isV1());
+        blockRefMap->setNameSource(tasks[t].names);
+        auto *passes = makePasses(blockRefMap, new TypeMap);
+        tasks[t].output = tasks[t].input->apply(*passes); });
+
+    // Check that each copy only changed its own block before stitching them together.
+    auto *rv = program->clone();
+    bool changed = false;
+    std::set<cstring> generated;
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        auto *output = tasks[t].output ? tasks[t].output->to<IR::P4Program>() : nullptr;
+        if (!output || output->objects.size() != tasks[t].input->objects.size()) {
+            LOG2("ParallelBlocks: pipeline on " << program->objects.at(blocks[t]) <<
+                 " did not return a program of the same shape");
+            return false; }
+        for (size_t i = 0; i < output->objects.size(); ++i) {
+            if (i != blocks[t] && output->objects.at(i) != tasks[t].input->objects.at(i)) {
+                LOG2("ParallelBlocks: pipeline on " << program->objects.at(blocks[t]) <<
+                     " changed " << output->objects.at(i));
+                return false; } }
+        auto *block = output->objects.at(blocks[t]);
+        // Rename the names this block shares with earlier blocks, in block order so that
+        // the result doesn't depend on the order in which the threads ran.
+        std::map<cstring, cstring> renames;
+        auto names = tasks[t].names->generated;  // newName() below appends to it
+        for (auto name : names) {
+            if (!generated.count(name)) continue;
+            cstring fresh;
+            do {
+                fresh = tasks[t].names->newName(name);
+            } while (generated.count(fresh));
+            renames.emplace(name, fresh); }
+        for (auto name : names) generated.insert(renames.count(name) ? renames.at(name) : name);
+        if (!renames.empty()) block = block->apply(RenameGenerated(renames));
+        if (block != program->objects.at(blocks[t])) {
+            rv->objects[blocks[t]] = block;
+            changed = true; } }
+    result = changed ? rv : program;
+    return true;
+}
+
+}  // namespace P4
@@ -0,0 +1,56 @@
+#ifndef _MIDEND_PARALLELBLOCKS_H_
+#define _MIDEND_PARALLELBLOCKS_H_
+
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+Runs a pipeline of passes that each only change the inside of the top-level controls and
+parsers (e.g. LocalCopyPropagation, Predication, SimplifyKey) over all of them at once, on
+the threads of the global Util::ThreadPool.
+
+@p makePasses is called to build the pipeline once for every control or parser; each gets a
+ReferenceMap and TypeMap of its own, so the copies share no mutable state.  A copy is applied
+to the program with all the other controls and parsers replaced by empty stubs with the same
+types, so that global declarations still resolve; its version of the block is then put back
+into the program.  Fresh names are taken from a generator seeded with all the names in the
+program, and names that two blocks both generated are renamed in the later block, so the
+result does not depend on the scheduling of the threads.
+
+If the program has only one block, if the pool has no worker threads, or if a copy of the
+pipeline changes anything outside its own block, the pipeline is instead run sequentially
+on the whole program with @p refMap and @p typeMap, just as if it had been added directly.
+Either way, the maps are stale afterwards if the program changed.
+
+@pre The program must have been inlined, so that no control or parser instantiates another.
+*/
+class ParallelBlocks : public Visitor {
+ public:
+    typedef std::function<PassManager *(ReferenceMap *, TypeMap *)> PassFactory;
+
+ private:
+    ReferenceMap        *refMap;
+    TypeMap             *typeMap;
+    PassFactory         makePasses;
+    PassManager         *sequential;
+
+    bool runParallel(const IR::P4Program *program, const std::vector<size_t> &blocks,
+                     const IR::Node *&result);
+
+ public:
+    ParallelBlocks(ReferenceMap *refMap, TypeMap *typeMap, PassFactory makePasses)
+    : refMap(refMap), typeMap(typeMap), makePasses(makePasses),
+      sequential(makePasses(refMap, typeMap)) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(sequential);
+        setName("ParallelBlocks"); }
+    const IR::Node *apply_visitor(const IR::Node *node, const char *name = 0) override;
+    ParallelBlocks *clone() const override { return new ParallelBlocks(*this); }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_PARALLELBLOCKS_H_ */
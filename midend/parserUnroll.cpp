@@ -1,6 +1,13 @@
 #include "parserUnroll.h"
+
+#include <exception>
+#include <vector>
+
 #include "interpreter.h"
+#include "lib/compile_context.h"
+#include "lib/hash.h"
 #include "lib/stringify.h"
+#include "lib/thread_pool.h"
 #include "ir/ir.h"
 
 namespace P4 {
@@ -8,9 +15,9 @@ namespace P4 {
 /// The main class for parsers' states key for visited checking.
 struct VisitedKey {
     cstring                     name;       // name of a state.
-    std::map<cstring, size_t>   indexes;    // indexes of header stacks.
+    StateIndexes                indexes;    // indexes of header stacks.
 
-    VisitedKey(cstring name, std::map<cstring, size_t>& indexes) : name(name), indexes(indexes) {
+    VisitedKey(cstring name, const StateIndexes& indexes) : name(name), indexes(indexes) {
     }
 
     explicit VisitedKey(const ParserStateInfo* stateInfo) {
@@ -19,37 +26,38 @@ struct VisitedKey {
         indexes = stateInfo->statesIndexes;
     }
 
-    /// Checks of two states to be less. If @a name < @a e.name then it returns @a true.
-    /// if @a name > @a e.name then it returns false.
-    /// If @a name is equal @a e.name then it checks the values of the headers stack indexes.
-    /// For both map of header stacks' indexes it creates map of pairs of values for each
-    /// header stack index.
-    /// If some indexes are missing then it cosiders them as -1.
-    /// Next, it continues checking each pair in a intermidiate map with the same approach
-    /// as for @a name and @a e.name.
-    bool operator<(const VisitedKey& e) const {
-        if (name < e.name)
-            return true;
-        if (name > e.name)
+    /// The states are equal if they have the same name and the same header stack
+    /// indexes, where a missing index is considered -1.
+    bool operator==(const VisitedKey& e) const {
+        if (name != e.name)
             return false;
-        std::map<cstring, std::pair<size_t, size_t> > mp;
-        for (auto& i1 : indexes)
-            mp.emplace(i1.first, std::make_pair(i1.second, -1));
-        for (auto& i2 : e.indexes) {
-            auto ref = mp.find(i2.first);
-            if (ref == mp.end())
-                mp.emplace(i2.first, std::make_pair(-1, i2.second));
-            else
-                ref->second.second = i2.second;
-        }
-        for (auto j : mp) {
-            if (j.second.first < j.second.second)
-                return true;
-            if (j.second.first > j.second.second)
-                return false;
+        auto i1 = indexes.begin(), i2 = e.indexes.begin();
+        while (i1 != indexes.end() || i2 != e.indexes.end()) {
+            if (i2 == e.indexes.end() || (i1 != indexes.end() && i1->first < i2->first)) {
+                if (i1->second != size_t(-1)) return false;
+                ++i1;
+            } else if (i1 == indexes.end() || i2->first < i1->first) {
+                if (i2->second != size_t(-1)) return false;
+                ++i2;
+            } else {
+                if (i1->second != i2->second) return false;
+                ++i1;
+                ++i2;
+            }
         }
-        return false;
+        return true;
     }
+
+    /// The same for the keys that are equal, so a key is looked up in constant time.
+    struct Hash {
+        size_t operator()(const VisitedKey& key) const {
+            size_t result = key.name.hash();
+            for (auto& i : key.indexes)
+                if (i.second != size_t(-1))
+                    result = Util::Hash::hash_values(result, i.first.hash(), i.second);
+            return result;
+        }
+    };
 };
 
 /**
@@ -99,7 +107,7 @@ namespace ParserStructureImpl {
 /// Visited map of pairs :
 /// 1) name of the parser state and values of the header stack indexes.
 /// 2) value of index which is used for generation of the new names of the parsers' states.
-using StatesVisitedMap = std::map<VisitedKey, size_t>;
+using StatesVisitedMap = std::unordered_map<VisitedKey, size_t, VisitedKey::Hash>;
 
 // Makes transformation of the statements of a parser state.
 // It updates indexes of a header stack and generates correct name of the next transition.
@@ -292,8 +300,7 @@ class ParserSymbolicInterpreter {
             stateName == IR::ParserState::reject)
             return nullptr;
         auto state = structure->get(stateName);
-        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values->clone(),
-                                      index);
+        auto pi = new ParserStateInfo(stateName, parser, state, predecessor, values, index);
         synthesizedParser->add(pi);
         return pi;
     }
@@ -415,7 +422,8 @@ class ParserSymbolicInterpreter {
             CHECK_NULL(node);
             newSelect = node->to<IR::Expression>();
             CHECK_NULL(newSelect);
-            auto nextInfo = newStateInfo(state, next->getName(), state->after, rewriter.getIndex());
+            auto nextInfo = newStateInfo(state, next->getName(), state->after->clone(),
+                                         rewriter.getIndex());
             if (nextInfo != nullptr) {
                 nextInfo->scenarioStates = state->scenarioStates;
                 result->push_back(nextInfo);
@@ -430,9 +438,11 @@ class ParserSymbolicInterpreter {
                                          visitedStates);
             const IR::Node* node = se->select->apply(rewriter);
             const IR::ListExpression* newListSelect = node->to<IR::ListExpression>();
-            std::map<cstring, size_t> etalonStateIndexes = state->statesIndexes;
+            StateIndexes etalonStateIndexes = state->statesIndexes;
+            // all the successors start from the same values, which none of them changes
+            ValueMap* successorValues = state->after->clone();
             for (auto c : se->selectCases) {
-                std::map<cstring, size_t> currentStateIndexes = etalonStateIndexes;
+                StateIndexes currentStateIndexes = etalonStateIndexes;
                 auto path = c->state->path;
                 auto next = refMap->getDeclaration(path);
                 BUG_CHECK(next->is<IR::ParserState>(), "%1%: expected a state", path);
@@ -446,7 +456,7 @@ class ParserSymbolicInterpreter {
                 CHECK_NULL(newC);
                 newSelectCases.push_back(newC);
 
-                auto nextInfo = newStateInfo(state, next->getName(), state->after,
+                auto nextInfo = newStateInfo(state, next->getName(), successorValues,
                                              rewriter.getIndex());
                 if (nextInfo != nullptr) {
                     nextInfo->scenarioStates = state->scenarioStates;
@@ -603,15 +613,29 @@ class ParserSymbolicInterpreter {
     }
     /// running symbolic execution
     ParserInfo* run() {
+        // the values of the states are allocated from it, and released when it is done
+        SymbolicValueArena values;
+        explore();
+        for (auto& states : synthesizedParser->getStates()) {
+            for (auto state : *states.second) {
+                state->before = nullptr;
+                state->after = nullptr;
+            }
+        }
+        return synthesizedParser;
+    }
+
+ private:
+    void explore() {
         synthesizedParser = new ParserInfo();
         auto initMap = initializeVariables();
         if (initMap == nullptr)
             // error during initializer evaluation
-            return synthesizedParser;
+            return;
         auto startInfo = newStateInfo(nullptr, structure->start->name.name, initMap, 0);
         std::vector<ParserStateInfo*> toRun;  // worklist
         toRun.push_back(startInfo);
-        std::set<VisitedKey> visited;
+        std::unordered_set<VisitedKey, VisitedKey::Hash> visited;
         std::unordered_set<cstring> newStates;
         while (!toRun.empty()) {
             auto stateInfo = toRun.back();
@@ -625,7 +649,7 @@ class ParserSymbolicInterpreter {
                 continue;
             auto iHSNames = structure->statesWithHeaderStacks.find(stateInfo->name);
             if (iHSNames != structure->statesWithHeaderStacks.end())
-                stateInfo->scenarioHS.insert(iHSNames->second.begin(), iHSNames->second.end());
+                stateInfo->addScenarioHS(iHSNames->second);
             visited.insert(VisitedKey(stateInfo));  // add to visited map
             stateInfo->scenarioStates.insert(stateInfo->name);  // add to loops detection
             bool infLoop = checkLoops(stateInfo);
@@ -648,8 +672,6 @@ class ParserSymbolicInterpreter {
             }
             toRun.insert(toRun.end(), nextStates.first->begin(), nextStates.first->end());
         }
-
-        return synthesizedParser;
     }
 };
 
@@ -663,13 +685,16 @@ bool ParserStructure::analyze(ReferenceMap* refMap, TypeMap* typeMap, bool unrol
 
 /// check reachability for usage of header stack
 bool ParserStructure::reachableHSUsage(IR::ID id, const ParserStateInfo* state) const {
-    if (!state->scenarioHS.size())
+    auto& scenarioHS = state->getScenarioHS();
+    if (!scenarioHS.size())
         return false;
     CHECK_NULL(callGraph);
     const IR::IDeclaration* declaration = parser->states.getDeclaration(id.name);
     BUG_CHECK(declaration && declaration->is<IR::ParserState>(), "Invalid declaration %1%", id);
     std::set<const IR::ParserState*> reachableStates;
-    callGraph->reachable(declaration->to<IR::ParserState>(), reachableStates);
+    if (reachability == nullptr)
+        reachability = new CompactCallGraph<const IR::ParserState*>(*callGraph);
+    reachability->reachable(declaration->to<IR::ParserState>(), reachableStates);
     std::set<cstring> reachebleHSoperators;
     for (auto i : reachableStates) {
         auto iHSNames = statesWithHeaderStacks.find(i->name);
@@ -677,7 +702,7 @@ bool ParserStructure::reachableHSUsage(IR::ID id, const ParserStateInfo* state)
             reachebleHSoperators.insert(iHSNames->second.begin(), iHSNames->second.end());
     }
     std::set<cstring> intersectionHSOperators;
-    std::set_intersection(state->scenarioHS.begin(), state->scenarioHS.end(),
+    std::set_intersection(scenarioHS.begin(), scenarioHS.end(),
                             reachebleHSoperators.begin(), reachebleHSoperators.end(),
                             std::inserter(intersectionHSOperators,
                                           intersectionHSOperators.begin()));
@@ -698,5 +723,41 @@ void ParserStructure::addStateHSUsage(const IR::ParserState* state,
     }
 }
 
+const IR::Node* RewriteAllParsers::preorder(IR::P4Program* program) {
+    analyzed.clear();
+    if (Util::ThreadPool::global().concurrency() > 1)
+        analyzeInParallel(getOriginal<IR::P4Program>());
+    return program;
+}
+
+void RewriteAllParsers::analyzeInParallel(const IR::P4Program* program) {
+    // The parsers are analyzed independently: the symbolic evaluation only reads the maps
+    // and names the new states after the states of its own parser.
+    std::vector<const IR::P4Parser*> parsers;
+    for (auto decl : program->objects)
+        if (auto parser = decl->to<IR::P4Parser>())
+            parsers.push_back(parser);
+    if (parsers.size() < 2)
+        return;
+    LOG2("Analyzing " << parsers.size() << " parsers in parallel");
+    std::vector<ParserRewriter*> rewriters(parsers.size());
+    std::vector<ErrorReporter::Deferred> deferred(parsers.size());
+    std::vector<std::exception_ptr> failed(parsers.size());
+    Util::ThreadPool::global().parallel_for(parsers.size(), [&](size_t i) {
+        ErrorReporter::Deferred::Scope keep(deferred[i]);
+        try {
+            rewriters[i] = new ParserRewriter(refMap, typeMap, unroll);
+            parsers[i]->apply(*rewriters[i]);
+        } catch (...) {
+            failed[i] = std::current_exception(); } });
+    // Report in program order, stopping at the first parser that failed, as the
+    // sequential analysis would.
+    auto& reporter = BaseCompileContext::get().errorReporter();
+    for (size_t i = 0; i < parsers.size(); i++) {
+        reporter.emit(deferred[i]);
+        if (failed[i])
+            std::rethrow_exception(failed[i]);
+        analyzed.emplace(parsers[i], rewriters[i]); }
+}
 
 }  // namespace P4
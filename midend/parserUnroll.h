@@ -17,7 +17,12 @@ limitations under the License.
 #ifndef _MIDEND_PARSERUNROLL_H_
 #define _MIDEND_PARSERUNROLL_H_
 
+#include <memory>
+#include <set>
+#include <unordered_set>
+
 #include "ir/ir.h"
+#include "lib/cow_map.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/callGraph.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
@@ -32,6 +37,10 @@ const char outOfBoundsStateName[] = "stateOutOfBound";
 //////////////////////////////////////////////
 // The following are for a single parser
 
+/// Header stack indexes of a parser state.  The states produced from a state start
+/// from its indexes, so the copies share them until they are changed.
+typedef cow_map<cstring, size_t> StateIndexes;
+
 /// Information produced for a parser state by the symbolic evaluator
 struct ParserStateInfo {
     friend class ParserStateRewriter;
@@ -39,14 +48,20 @@ struct ParserStateInfo {
     const IR::P4Parser*             parser;
     const IR::ParserState*          state;  // original state this is produced from
     const ParserStateInfo*          predecessor;     // how we got here in the symbolic evaluation
-    ValueMap*                       before;
+    // The values are only available during the symbolic evaluation, and null after it.
+    ValueMap*                       before;  // not changed; may be shared with other states
     ValueMap*                       after;
     IR::ParserState*                newState;        // pointer to a new state
     size_t                          currentIndex;
-    std::map<cstring, size_t>       statesIndexes;   // global map in state indexes
+    StateIndexes                    statesIndexes;   // global map in state indexes
     // set of parsers' states names with are in current path.
     std::unordered_set<cstring>     scenarioStates;
-    std::unordered_set<cstring>     scenarioHS;      // scenario header stack's operations
+
+ private:
+    // scenario header stack's operations; shared with the predecessor until extended
+    std::shared_ptr<const std::unordered_set<cstring>> scenarioHS;
+
+ public:
     ParserStateInfo(cstring name, const IR::P4Parser* parser, const IR::ParserState* state,
                     const ParserStateInfo* predecessor, ValueMap* before, size_t index) :
             name(name), parser(parser), state(state), predecessor(predecessor),
@@ -57,6 +72,17 @@ struct ParserStateInfo {
             scenarioHS = predecessor->scenarioHS;
         }
     }
+    const std::unordered_set<cstring>& getScenarioHS() const {
+        static const std::unordered_set<cstring> empty;
+        return scenarioHS ? *scenarioHS : empty; }
+    void addScenarioHS(const std::set<cstring>& names) {
+        auto& current = getScenarioHS();
+        for (auto n : names) {
+            if (current.count(n)) continue;
+            auto extended = new std::unordered_set<cstring>(current);
+            extended->insert(names.begin(), names.end());
+            scenarioHS.reset(extended);
+            return; } }
 };
 
 /// Information produced for a parser by the symbolic evaluator
@@ -94,6 +120,8 @@ class ParserStructure {
     friend class ParserSymbolicInterpreter;
     friend class AnalyzeParser;
     std::map<cstring, const IR::ParserState*> stateMap;
+    /// Snapshot of 'callGraph' for the reachability queries, built when first needed.
+    mutable const CompactCallGraph<const IR::ParserState*>* reachability = nullptr;
 
  public:
     const IR::P4Parser*    parser;
@@ -105,6 +133,7 @@ class ParserStructure {
     void setParser(const IR::P4Parser* parser) {
         CHECK_NULL(parser);
         callGraph = new StateCallGraph(parser->name);
+        reachability = nullptr;
         this->parser = parser;
         start = nullptr;
     }
@@ -113,7 +142,10 @@ class ParserStructure {
     const IR::ParserState* get(cstring state) const
     { return ::get(stateMap, state); }
     void calls(const IR::ParserState* caller, const IR::ParserState* callee)
-    { callGraph->calls(caller, callee); }
+    {
+        BUG_CHECK(reachability == nullptr, "%1%: state graph changed after being queried", caller);
+        callGraph->calls(caller, callee);
+    }
 
     bool analyze(ReferenceMap* refMap, TypeMap* typeMap, bool unroll);
     /// check reachability for usage of header stack
@@ -174,6 +206,12 @@ class RewriteAllParsers : public Transform {
     ReferenceMap*           refMap;
     TypeMap*                typeMap;
     bool                    unroll;
+    /// Parsers already analyzed by analyzeInParallel, by original parser
+    std::map<const IR::P4Parser*, ParserRewriter*> analyzed;
+
+    /// Run the ParserRewriter of every top-level parser of @program on the threads
+    /// of the global Util::ThreadPool.
+    void analyzeInParallel(const IR::P4Program* program);
 
  public:
     RewriteAllParsers(ReferenceMap* refMap, TypeMap* typeMap, bool unroll) :
@@ -181,11 +219,19 @@ class RewriteAllParsers : public Transform {
         CHECK_NULL(refMap); CHECK_NULL(typeMap); setName("RewriteAllParsers");
     }
 
+    const IR::Node* preorder(IR::P4Program* program) override;
+
     // start generation of a code
     const IR::Node* postorder(IR::P4Parser* parser) override {
         // making rewriting
-        auto rewriter = new ParserRewriter(refMap, typeMap, unroll);
-        parser->apply(*rewriter);
+        ParserRewriter* rewriter;
+        auto it = analyzed.find(getOriginal<IR::P4Parser>());
+        if (it != analyzed.end()) {
+            rewriter = it->second;
+        } else {
+            rewriter = new ParserRewriter(refMap, typeMap, unroll);
+            parser->apply(*rewriter);
+        }
         /// make a new parser
         BUG_CHECK(rewriter->current.result,
                   "No result was found after unrolling of the parser loop");
@@ -17,6 +17,22 @@ limitations under the License.
 #include "frontends/p4/cloner.h"
 namespace P4 {
 
+bool PredicationPolicy::predicate(const IR::IfStatement* statement) const {
+    if (branchCost() == std::numeric_limits<unsigned>::max())
+        return true;
+    unsigned selects = 0;
+    bool onlyAssignments = true;
+    forAllMatching<IR::Statement>(statement, [&](const IR::Statement* s) {
+        if (s->is<IR::AssignmentStatement>())
+            selects++;
+        else if (auto ifs = s->to<IR::IfStatement>())
+            // a composite condition is stored in a temporary
+            selects += ifs->condition->is<IR::PathExpression>() ? 0 : 1;
+        else if (!s->is<IR::BlockStatement>() && !s->is<IR::EmptyStatement>())
+            onlyAssignments = false; });
+    return onlyAssignments && selects * selectCost() <= branchCost();
+}
+
 /// convert an expression into a string that uniqely identifies the lvalue referenced
 /// return null cstring if not a reference to a lvalue.
 static cstring lvalue_name(const IR::Expression *exp) {
@@ -43,6 +59,75 @@ static cstring lvalue_name(const IR::Expression *exp) {
     return cstring();
 }
 
+/// True if @left and @right, two lvalue names, may refer to overlapping data.
+static bool overlap(cstring left, cstring right) {
+    if (left.size() > right.size())
+        std::swap(left, right);
+    if (!right.startsWith(left))
+        return false;
+    return left.size() == right.size() ||
+           right.c_str()[left.size()] == '.' || right.c_str()[left.size()] == '[';
+}
+
+/// Collects the names of the outermost lvalues read by an expression.
+class ReadNames : public Inspector {
+ public:
+    std::vector<cstring> names;
+    // Set when some value read cannot be named, or may change when read
+    bool unknown = false;
+    bool preorder(const IR::Member* member) override {
+        auto name = lvalue_name(member);
+        if (name.isNullOrEmpty())
+            return true;
+        names.push_back(name);
+        return false;
+    }
+    bool preorder(const IR::PathExpression* path) override {
+        names.push_back(path->path->name);
+        return false;
+    }
+    bool preorder(const IR::MethodCallExpression* mce) override {
+        auto member = mce->method->to<IR::Member>();
+        if (member == nullptr || member->member != IR::Type_Header::isValid)
+            unknown = true;
+        else
+            visit(member->expr);
+        return false;
+    }
+};
+
+/// True if @statement may change the value of @condition.
+static bool changesCondition(const IR::Statement* statement, const IR::Expression* condition) {
+    ReadNames reads;
+    condition->apply(reads);
+    bool changes = reads.unknown;
+    forAllMatching<IR::AssignmentStatement>(statement, [&](const IR::AssignmentStatement* a) {
+        auto written = lvalue_name(a->left);
+        if (written.isNullOrEmpty()) {
+            changes = true;
+            return;
+        }
+        for (auto read : reads.names)
+            changes = changes || overlap(read, written); });
+    return changes;
+}
+
+/// Concatenates two optional branches of if statements.
+static const IR::Statement* join(const IR::Statement* first, const IR::Statement* second) {
+    if (first == nullptr)
+        return second;
+    if (second == nullptr)
+        return first;
+    auto result = new IR::BlockStatement(first->srcInfo);
+    for (auto statement : { first, second }) {
+        if (auto block = statement->to<IR::BlockStatement>())
+            result->components.append(block->components);
+        else
+            result->push_back(statement);
+    }
+    return result;
+}
+
 const IR::Node* Predication::EmptyStatementRemover::postorder(IR::EmptyStatement*) {
     return nullptr;
 }
@@ -279,10 +364,44 @@ const IR::Node* Predication::preorder(IR::ArrayIndex * arrInd) {
     return arrInd;
 }
 
+const IR::Node* Predication::preorder(IR::BlockStatement* statement) {
+    if (findContext<IR::P4Action>() == nullptr || ifNestingLevel > 0) {
+        return statement;
+    }
+    // Merge consecutive if statements with the same condition, so that they
+    // share their predicate.
+    std::vector<const IR::StatOrDecl*> components;
+    for (auto component : statement->components) {
+        auto ifs = component->to<IR::IfStatement>();
+        auto last = components.empty() ? nullptr : components.back()->to<IR::IfStatement>();
+        if (ifs != nullptr && last != nullptr && ifs->condition->equiv(*last->condition) &&
+            !changesCondition(last, last->condition)) {
+            LOG2("Merging " << last << " and " << ifs);
+            components.back() = new IR::IfStatement(
+                last->srcInfo, last->condition, join(last->ifTrue, ifs->ifTrue),
+                join(last->ifFalse, ifs->ifFalse));
+            continue;
+        }
+        components.push_back(component);
+    }
+    if (components.size() == statement->components.size())
+        return statement;
+    statement->components.clear();
+    for (auto component : components)
+        statement->components.push_back(component);
+    return statement;
+}
+
 const IR::Node* Predication::preorder(IR::IfStatement* statement) {
     if (findContext<IR::P4Action>() == nullptr) {
         return statement;
     }
+    if (ifNestingLevel == 0 && !policy->predicate(statement)) {
+        // The target can branch: the statements inside are left as they are.
+        LOG1("Not predicating " << statement);
+        prune();
+        return statement;
+    }
     ++ifNestingLevel;
     LOG1("Preorder of IfStatement, level: " << ifNestingLevel);
     LOG2(*statement);
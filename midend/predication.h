@@ -17,17 +17,42 @@ limitations under the License.
 #ifndef _MIDEND_PREDICATION_H_
 #define _MIDEND_PREDICATION_H_
 
+#include <limits>
+
 #include "ir/ir.h"
 #include "frontends/p4/typeChecking/typeChecker.h"
 
 namespace P4 {
 
+/**
+ * Cost model used by Predication to decide which 'if' statements in actions are
+ * converted to '?:' expressions.  The default model describes a target that cannot
+ * branch inside actions, so every 'if' statement is converted.
+ */
+class PredicationPolicy {
+ public:
+    virtual ~PredicationPolicy() {}
+    /// The cost of a conditional branch; unsigned max if the target cannot branch.
+    virtual unsigned branchCost() const { return std::numeric_limits<unsigned>::max(); }
+    /// The cost of a select between two values.
+    virtual unsigned selectCost() const { return 1; }
+    /// True if the outermost 'if' @statement should be predicated.  By default this is the
+    /// case when the target cannot branch, or when @statement contains only assignments
+    /// and the selects they become cost no more than a branch.
+    virtual bool predicate(const IR::IfStatement* statement) const;
+};
+
 /**
 This pass operates on action bodies.  It converts 'if' statements to
 '?:' expressions, if possible.  Otherwise this pass will signal an
 error.  This pass should be used only on architectures that do not
 support conditionals in actions.
 For this to work all statements must be assignments or other ifs.
+A PredicationPolicy can leave some 'if' statements alone on targets
+where a branch is cheaper than the selects that replace it.
+Consecutive 'if' statements with the same condition are first merged,
+when the first one does not change the condition, so that they share
+their condition temporary.
 if (e)
    a = f(b);
 else
@@ -81,6 +106,9 @@ class Predication final : public Transform {
 
     // Used to dynamically generate names for variables in parts of code
     NameGenerator* generator;
+    // Decides which if statements are predicated
+    const PredicationPolicy* policy;
+    PredicationPolicy defaultPolicy;
     // Used to remove empty statements and empty block statements that appear in the code
     EmptyStatementRemover remover;
     bool inside_action;
@@ -121,12 +149,17 @@ class Predication final : public Transform {
     }
 
  public:
-    explicit Predication(NameGenerator* gen) :
-        generator(gen), inside_action(false), ifNestingLevel(0), depNestingLevel(0)
-    { setName("Predication"); }
+    explicit Predication(NameGenerator* gen, const PredicationPolicy* policy = nullptr) :
+        generator(gen), policy(policy), inside_action(false), ifNestingLevel(0),
+        depNestingLevel(0) {
+        if (!this->policy)
+            this->policy = &defaultPolicy;
+        setName("Predication");
+    }
     const IR::Expression* clone(const IR::Expression* expression);
     const IR::Node* clone(const IR::AssignmentStatement* statement);
     const IR::Node* preorder(IR::IfStatement* statement) override;
+    const IR::Node* preorder(IR::BlockStatement* statement) override;
     const IR::Node* preorder(IR::P4Action* action) override;
     const IR::Node* postorder(IR::P4Action* action) override;
     const IR::Node* preorder(IR::AssignmentStatement* statement) override;
@@ -0,0 +1,131 @@
+#include "propagateActionData.h"
+
+#include "frontends/p4/methodInstance.h"
+
+namespace P4 {
+
+namespace {
+
+bool sameValue(const IR::Literal* left, const IR::Literal* right) {
+    if (auto lc = left->to<IR::Constant>()) {
+        auto rc = right->to<IR::Constant>();
+        return rc != nullptr && lc->value == rc->value;
+    }
+    if (auto lb = left->to<IR::BoolLiteral>()) {
+        auto rb = right->to<IR::BoolLiteral>();
+        return rb != nullptr && lb->value == rb->value;
+    }
+    return false;
+}
+
+}  // namespace
+
+void ActionDataValues::add(const IR::Parameter* parameter, const IR::Literal* value) {
+    if (unknown.count(parameter))
+        return;
+    if (value == nullptr) {
+        unknown.emplace(parameter);
+        values.erase(parameter);
+        return;
+    }
+    auto& known = values[parameter];
+    for (auto v : known)
+        if (sameValue(v, value))
+            return;
+    known.push_back(value);
+}
+
+const std::vector<const IR::Literal*>*
+ActionDataValues::get(const IR::Parameter* parameter) const {
+    if (unknown.count(parameter))
+        return nullptr;
+    auto it = values.find(parameter);
+    if (it == values.end())
+        return nullptr;
+    return &it->second;
+}
+
+const IR::Literal* ActionDataValues::invariant(const IR::Parameter* parameter) const {
+    auto known = get(parameter);
+    if (known == nullptr || known->size() != 1)
+        return nullptr;
+    return known->at(0);
+}
+
+Visitor::profile_t FindActionDataValues::init_apply(const IR::Node* node) {
+    values->clear();
+    return Inspector::init_apply(node);
+}
+
+void FindActionDataValues::unknown(const IR::P4Action* action) {
+    for (auto param : action->parameters->parameters)
+        if (param->direction == IR::Direction::None)
+            values->add(param, nullptr);
+}
+
+void FindActionDataValues::postorder(const IR::P4Table* table) {
+    auto actions = table->getActionList();
+    if (actions == nullptr)
+        return;
+    // The control plane can choose the actions and their data unless both the entries
+    // and the default action are constant.
+    auto entries = table->properties->getProperty(IR::TableProperties::entriesPropertyName);
+    auto defaultAction =
+        table->properties->getProperty(IR::TableProperties::defaultActionPropertyName);
+    if (entries != nullptr && entries->isConstant &&
+        defaultAction != nullptr && defaultAction->isConstant)
+        return;
+    for (auto element : actions->actionList) {
+        auto decl = refMap->getDeclaration(element->getPath(), true);
+        if (auto action = decl->to<IR::P4Action>())
+            unknown(action);
+    }
+}
+
+void FindActionDataValues::postorder(const IR::MethodCallExpression* expression) {
+    auto mi = MethodInstance::resolve(expression, refMap, typeMap);
+    auto ac = mi->to<ActionCall>();
+    if (ac == nullptr)
+        return;
+    for (auto param : ac->action->parameters->parameters) {
+        if (param->direction != IR::Direction::None)
+            continue;
+        auto argument = ac->substitution.lookup(param);
+        values->add(param, argument ? argument->expression->to<IR::Literal>() : nullptr);
+    }
+}
+
+const IR::Node* DoPropagateActionData::preorder(IR::P4Action* action) {
+    bool known = false;
+    for (auto param : action->parameters->parameters)
+        known = known || values->invariant(param) != nullptr;
+    if (!known)
+        prune();
+    return action;
+}
+
+const IR::Node* DoPropagateActionData::postorder(IR::PathExpression* expression) {
+    auto decl = refMap->getDeclaration(expression->path, true);
+    auto param = decl->to<IR::Parameter>();
+    if (param == nullptr)
+        return expression;
+    auto value = values->invariant(param);
+    if (value == nullptr)
+        return expression;
+    auto type = typeMap->getType(param, true);
+    if (auto constant = value->to<IR::Constant>()) {
+        if (!type->is<IR::Type_Bits>())
+            return expression;
+        LOG2("Replacing " << dbp(param) << " with " << constant);
+        return new IR::Constant(expression->srcInfo, type, constant->value, constant->base);
+    }
+    if (auto boolean = value->to<IR::BoolLiteral>()) {
+        if (!type->is<IR::Type_Boolean>())
+            return expression;
+        LOG2("Replacing " << dbp(param) << " with " << boolean);
+        return new IR::BoolLiteral(expression->srcInfo, boolean->value);
+    }
+    return expression;
+}
+
+}  // namespace P4
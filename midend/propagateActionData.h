@@ -0,0 +1,115 @@
+#ifndef _MIDEND_PROPAGATEACTIONDATA_H_
+#define _MIDEND_PROPAGATEACTIONDATA_H_
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ir/ir.h"
+#include "frontends/common/constantFolding.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * The values that the directionless parameters of actions (their action data) can take.
+ * These values are known when an action is only called with constant arguments: directly,
+ * by the constant entries of tables, or as a constant default action.  An action listed by
+ * a table whose entries or default action the control plane can change may receive any
+ * value.
+ */
+class ActionDataValues {
+    friend class FindActionDataValues;
+    std::map<const IR::Parameter*, std::vector<const IR::Literal*>>    values;
+    std::set<const IR::Parameter*>                                      unknown;
+
+    void add(const IR::Parameter* parameter, const IR::Literal* value);
+
+ public:
+    void clear() { values.clear(); unknown.clear(); }
+    /// The values that @parameter can take, or nullptr if they are not known.
+    const std::vector<const IR::Literal*>* get(const IR::Parameter* parameter) const;
+    /// The only value of @parameter, or nullptr if it can take several values.
+    const IR::Literal* invariant(const IR::Parameter* parameter) const;
+};
+
+/// Computes the ActionDataValues of a program.
+/// @pre The program is type checked.
+class FindActionDataValues : public Inspector {
+    ReferenceMap*       refMap;
+    TypeMap*            typeMap;
+    ActionDataValues*   values;
+
+    void unknown(const IR::P4Action* action);
+
+ public:
+    FindActionDataValues(ReferenceMap* refMap, TypeMap* typeMap, ActionDataValues* values) :
+            refMap(refMap), typeMap(typeMap), values(values) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(values);
+        setName("FindActionDataValues");
+    }
+    Visitor::profile_t init_apply(const IR::Node* node) override;
+    bool preorder(const IR::ActionListElement*) override { return false; }
+    void postorder(const IR::P4Table* table) override;
+    void postorder(const IR::MethodCallExpression* expression) override;
+};
+
+/**
+ * Replaces the uses of action parameters that always receive the same value with that
+ * value.
+ *
+ * \code{.cpp}
+ *  action set_port(bit<9> port) { m.port = port; }
+ *  table t {
+ *      key = { h.x : exact; } actions = { set_port; }
+ *      const entries = { 1 : set_port(3); 2 : set_port(3); }
+ *      const default_action = set_port(3);
+ *  }
+ * \endcode
+ *
+ * becomes
+ *
+ * \code{.cpp}
+ *  action set_port(bit<9> port) { m.port = 9w3; }
+ * \endcode
+ *
+ * The parameters are kept, so the calls of the action do not change, and later passes
+ * such as local copy propagation can use the constants that this pass exposes.
+ */
+class DoPropagateActionData : public Transform {
+    ReferenceMap*               refMap;
+    TypeMap*                    typeMap;
+    const ActionDataValues*     values;
+
+ public:
+    DoPropagateActionData(ReferenceMap* refMap, TypeMap* typeMap,
+                          const ActionDataValues* values) :
+            refMap(refMap), typeMap(typeMap), values(values) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(values);
+        setName("DoPropagateActionData");
+    }
+    const IR::Node* preorder(IR::P4Action* action) override;
+    const IR::Node* postorder(IR::PathExpression* expression) override;
+};
+
+class PropagateActionData : public PassManager {
+    ActionDataValues values;
+
+ public:
+    PropagateActionData(ReferenceMap* refMap, TypeMap* typeMap,
+                        TypeChecking* typeChecking = nullptr) {
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap);
+        passes.push_back(typeChecking);
+        passes.push_back(new FindActionDataValues(refMap, typeMap, &values));
+        passes.push_back(new DoPropagateActionData(refMap, typeMap, &values));
+        passes.push_back(new ConstantFolding(refMap, typeMap, false, typeChecking));
+        setName("PropagateActionData");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_PROPAGATEACTIONDATA_H_ */
@@ -30,7 +30,7 @@ const IR::Node* RemoveUnusedActionParameters::postorder(IR::P4Action* action) {
 
     // Some parameters are unused; filter them out.
     auto newParams = new IR::ParameterList;
-    for (auto param : *params->getEnumerator()->where(isUsed))
+    for (auto param : Util::enumerate(params->parameters).where(isUsed))
         newParams->push_back(param);
 
     action->parameters = newParams;
@@ -0,0 +1,96 @@
+#include "removeUnusedStructFields.h"
+
+#include "frontends/p4/methodInstance.h"
+#include "frontends/p4/unusedDeclarations.h"
+
+namespace P4 {
+
+bool StructFieldUsage::isUsed(const IR::Type_Struct* type, cstring field) const {
+    if (whole.count(type->name.name))
+        return true;
+    auto it = fields.find(type->name.name);
+    return it != fields.end() && it->second.count(field);
+}
+
+Visitor::profile_t FindStructFieldUsage::init_apply(const IR::Node* node) {
+    usage->clear();
+    return Inspector::init_apply(node);
+}
+
+void FindStructFieldUsage::useWhole(const IR::Type* type) {
+    if (type == nullptr)
+        return;
+    if (auto st = type->to<IR::Type_Struct>()) {
+        if (!usage->whole.insert(st->name.name).second)
+            return;
+        for (auto field : st->fields)
+            useWhole(typeMap->getTypeType(field->type, false));
+    } else if (auto list = type->to<IR::Type_BaseList>()) {
+        for (auto component : list->components)
+            useWhole(typeMap->getTypeType(component, false));
+    }
+}
+
+void FindStructFieldUsage::check(const IR::Expression* expression) {
+    auto type = typeMap->getType(expression);
+    if (type == nullptr || !type->is<IR::Type_Struct>())
+        return;
+    if (getParent<IR::Member>())
+        return;
+    if (getParent<IR::Argument>()) {
+        // the fields a parser or control of the program uses are found in its body
+        auto call = findContext<IR::MethodCallExpression>();
+        if (call && MethodInstance::resolve(call, refMap, typeMap)->is<ApplyMethod>())
+            return;
+    }
+    LOG3("Struct " << type << " used as a whole by " << expression);
+    useWhole(type);
+}
+
+bool FindStructFieldUsage::preorder(const IR::Member* expression) {
+    auto type = typeMap->getType(expression->expr);
+    if (auto st = type ? type->to<IR::Type_Struct>() : nullptr)
+        usage->fields[st->name.name].insert(expression->member.name);
+    check(expression);
+    return true;
+}
+
+bool FindStructFieldUsage::preorder(const IR::Expression* expression) {
+    check(expression);
+    return true;
+}
+
+bool FindStructFieldUsage::preorder(const IR::Declaration_Instance* instance) {
+    // e.g. Digest<T> or register<T>, which keep values of T in the target
+    forAllMatching<IR::Type_Name>(instance->type, [this](const IR::Type_Name* name) {
+        auto decl = refMap->getDeclaration(name->path);
+        if (decl)
+            useWhole(decl->to<IR::Type_Struct>()); });
+    return true;
+}
+
+bool FindStructFieldUsage::preorder(const IR::MethodCallExpression* expression) {
+    for (auto type : *expression->typeArguments)
+        useWhole(typeMap->getTypeType(type, false));
+    check(expression);
+    return true;
+}
+
+const IR::Node* DoRemoveUnusedStructFields::postorder(IR::Type_Struct* type) {
+    if (RemoveUnusedDeclarations::ifSystemFile(type))
+        return type;
+    IR::IndexedVector<IR::StructField> fields;
+    for (auto field : type->fields) {
+        if (usage->isUsed(type, field->name) || field->getAnnotation("alias") ||
+            field->getAnnotation("field_list"))
+            fields.push_back(field);
+        else
+            LOG2("Removing unused field " << type->name << "." << field->name);
+    }
+    if (fields.size() == type->fields.size())
+        return type;
+    type->fields = fields;
+    return type;
+}
+
+}  // namespace P4
@@ -0,0 +1,93 @@
+#ifndef _MIDEND_REMOVEUNUSEDSTRUCTFIELDS_H_
+#define _MIDEND_REMOVEUNUSEDSTRUCTFIELDS_H_
+
+#include <map>
+#include <set>
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * The fields of the struct types declared by a program that are referenced by name.
+ * A struct is used as a whole when a value of its type is copied, compared, passed to
+ * anything but a parser or control of the program, or used as the type argument of an
+ * extern or a method, since then every field may be needed; its struct-typed fields are
+ * then used as a whole too.
+ */
+class StructFieldUsage {
+    friend class FindStructFieldUsage;
+    std::map<cstring, std::set<cstring>>    fields;
+    std::set<cstring>                       whole;
+
+ public:
+    void clear() { fields.clear(); whole.clear(); }
+    /// True if @field of the struct @type may be used.
+    bool isUsed(const IR::Type_Struct* type, cstring field) const;
+};
+
+/// Computes the StructFieldUsage of a program.
+/// @pre The program is type checked.
+class FindStructFieldUsage : public Inspector {
+    ReferenceMap*       refMap;
+    TypeMap*            typeMap;
+    StructFieldUsage*   usage;
+
+    void useWhole(const IR::Type* type);
+    /// Marks @expression as a use of its whole value if it is a struct used other than
+    /// as the base of a field reference or an argument to a parser or control.
+    void check(const IR::Expression* expression);
+
+ public:
+    FindStructFieldUsage(ReferenceMap* refMap, TypeMap* typeMap, StructFieldUsage* usage) :
+            refMap(refMap), typeMap(typeMap), usage(usage) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(usage);
+        setName("FindStructFieldUsage");
+        visitDagOnce = false;
+    }
+    Visitor::profile_t init_apply(const IR::Node* node) override;
+    bool preorder(const IR::Member* expression) override;
+    bool preorder(const IR::Expression* expression) override;
+    bool preorder(const IR::Declaration_Instance* instance) override;
+    bool preorder(const IR::MethodCallExpression* expression) override;
+};
+
+/**
+ * Removes the fields of the struct types declared by the program (not those of the
+ * architecture) that are never referenced, such as metadata left over after
+ * FlattenInterfaceStructs.  Fields with an @alias or @field_list annotation are kept,
+ * as targets refer to them by name.  With fewer fields the target has less per-packet
+ * state to initialize and copy.
+ */
+class DoRemoveUnusedStructFields : public Transform {
+    const StructFieldUsage*     usage;
+
+ public:
+    explicit DoRemoveUnusedStructFields(const StructFieldUsage* usage) : usage(usage) {
+        CHECK_NULL(usage);
+        setName("DoRemoveUnusedStructFields");
+    }
+    const IR::Node* postorder(IR::Type_Struct* type) override;
+};
+
+class RemoveUnusedStructFields : public PassManager {
+    StructFieldUsage usage;
+
+ public:
+    RemoveUnusedStructFields(ReferenceMap* refMap, TypeMap* typeMap,
+                             TypeChecking* typeChecking = nullptr) {
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap);
+        passes.push_back(typeChecking);
+        passes.push_back(new FindStructFieldUsage(refMap, typeMap, &usage));
+        passes.push_back(new DoRemoveUnusedStructFields(&usage));
+        setName("RemoveUnusedStructFields");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_REMOVEUNUSEDSTRUCTFIELDS_H_ */
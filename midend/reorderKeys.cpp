@@ -0,0 +1,124 @@
+#include "reorderKeys.h"
+
+#include <algorithm>
+
+#include "frontends/p4/coreLibrary.h"
+
+namespace P4 {
+
+bool KeyLayoutPolicy::reorder(const IR::P4Table* table) const {
+    auto key = table->getKey();
+    if (key == nullptr)
+        return false;
+    for (auto element : key->keyElements)
+        if (element->matchType->path->name != P4CoreLibrary::instance().exactMatch.name)
+            return false;
+    return true;
+}
+
+unsigned KeyLayoutPolicy::alignment(unsigned width) const {
+    unsigned bytes = 1;
+    while (bytes < 8 && bytes * 8 < width)
+        bytes *= 2;
+    return bytes;
+}
+
+namespace {
+
+/// Key fields that are laid out together.
+struct KeyGroup {
+    size_t              first;      // position of the first field in the original key
+    unsigned            width;
+    std::vector<size_t> elements;   // positions in the original key, in layout order
+};
+
+}  // namespace
+
+const IR::Node* DoReorderKeys::postorder(IR::P4Table* table) {
+    auto orig = getOriginal<IR::P4Table>();
+    if (!policy->reorder(orig))
+        return table;
+    auto key = orig->getKey();
+    auto& elements = key->keyElements;
+    if (elements.size() < 2)
+        return table;
+
+    std::vector<KeyGroup> groups;
+    // The fields of each header: (index in the header, position in the key)
+    std::map<cstring, std::vector<std::pair<size_t, size_t>>> headerFields;
+    std::vector<unsigned> widths;
+    for (size_t i = 0; i < elements.size(); i++) {
+        auto expression = elements.at(i)->expression;
+        auto type = typeMap->getType(expression, true);
+        if (!type->is<IR::Type_Bits>() && !type->is<IR::Type_Boolean>())
+            return table;
+        widths.push_back(type->width_bits());
+        if (auto member = expression->to<IR::Member>()) {
+            if (auto header = typeMap->getType(member->expr, true)->to<IR::Type_Header>()) {
+                auto field = header->getField(member->member);
+                auto index = std::find(header->fields.begin(), header->fields.end(), field) -
+                             header->fields.begin();
+                headerFields[member->expr->toString()].emplace_back(index, i);
+                continue;
+            }
+        }
+        groups.push_back(KeyGroup{ i, widths.back(), { i } });
+    }
+    for (auto& header : headerFields) {
+        auto& fields = header.second;
+        std::sort(fields.begin(), fields.end());
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (i == 0 || fields.at(i).first != fields.at(i - 1).first + 1)
+                groups.push_back(KeyGroup{ fields.at(i).second, 0, {} });
+            auto& group = groups.back();
+            group.first = std::min(group.first, fields.at(i).second);
+            group.width += widths.at(fields.at(i).second);
+            group.elements.push_back(fields.at(i).second);
+        }
+    }
+    std::sort(groups.begin(), groups.end(), [](const KeyGroup& left, const KeyGroup& right) {
+        return left.first < right.first; });
+    std::stable_sort(groups.begin(), groups.end(),
+                     [this](const KeyGroup& left, const KeyGroup& right) {
+        return policy->alignment(left.width) > policy->alignment(right.width); });
+
+    std::vector<size_t> order;
+    for (auto& group : groups)
+        order.insert(order.end(), group.elements.begin(), group.elements.end());
+    bool unchanged = true;
+    for (size_t i = 0; i < order.size(); i++)
+        unchanged = unchanged && order.at(i) == i;
+    if (unchanged)
+        return table;
+    LOG2("Reordering the key of " << dbp(table));
+
+    auto properties = new IR::IndexedVector<IR::Property>();
+    for (auto property : table->properties->properties) {
+        if (auto k = property->value->to<IR::Key>()) {
+            IR::Vector<IR::KeyElement> keyElements;
+            for (auto i : order)
+                keyElements.push_back(k->keyElements.at(i));
+            auto clone = property->clone();
+            clone->value = new IR::Key(k->srcInfo, keyElements);
+            property = clone;
+        } else if (auto list = property->value->to<IR::EntriesList>()) {
+            IR::Vector<IR::Entry> entries;
+            for (auto entry : list->entries) {
+                IR::Vector<IR::Expression> keysets;
+                for (auto i : order)
+                    keysets.push_back(entry->keys->components.at(i));
+                auto clone = entry->clone();
+                clone->keys = new IR::ListExpression(entry->keys->srcInfo, keysets);
+                entries.push_back(clone);
+            }
+            auto clone = property->clone();
+            clone->value = new IR::EntriesList(list->srcInfo, entries);
+            property = clone;
+        }
+        properties->push_back(property);
+    }
+    table->properties = new IR::TableProperties(table->properties->srcInfo, *properties);
+    return table;
+}
+
+}  // namespace P4
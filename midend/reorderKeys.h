@@ -0,0 +1,82 @@
+#ifndef _MIDEND_REORDERKEYS_H_
+#define _MIDEND_REORDERKEYS_H_
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * Policy used by ReorderKeys to decide which table keys are reordered, and how the target
+ * aligns the fields of a key.
+ */
+class KeyLayoutPolicy {
+ public:
+    virtual ~KeyLayoutPolicy() {}
+    /// True if the key fields of @table may be reordered.  By default this is the case
+    /// when all of them are matched with exact.
+    virtual bool reorder(const IR::P4Table* table) const;
+    /// The alignment in bytes of @width bits of key: by default the smallest power of two
+    /// that holds them, up to 8.
+    virtual unsigned alignment(unsigned width) const;
+};
+
+/**
+ * Reorders the fields of table keys so that the target can build them with few, wide
+ * copies.  The key fields are split into groups: the fields of the same header that
+ * follow each other in the header form one group, and every other field forms a group of
+ * its own.  The groups are then sorted by decreasing alignment, keeping the original order
+ * between groups with the same alignment, and the fields of each group stay in the order
+ * of the header.  The keysets of constant entries are reordered in the same way.
+ *
+ * \code{.cpp}
+ *  key = { m.port : exact; h.ip.proto : exact; h.ip.src : exact; h.ip.dst : exact; }
+ * \endcode
+ *
+ * with ip.src and ip.dst declared one after the other becomes
+ *
+ * \code{.cpp}
+ *  key = { h.ip.src : exact; h.ip.dst : exact; m.port : exact; h.ip.proto : exact; }
+ * \endcode
+ *
+ * The names that the control plane uses for the key fields do not change, but the layout
+ * of the key does; this pass runs in the midend, after the P4Runtime information is
+ * produced.
+ *
+ * @pre The program is type checked.
+ */
+class DoReorderKeys : public Transform {
+    TypeMap*                typeMap;
+    const KeyLayoutPolicy*  policy;
+
+ public:
+    DoReorderKeys(TypeMap* typeMap, const KeyLayoutPolicy* policy) :
+            typeMap(typeMap), policy(policy) {
+        CHECK_NULL(typeMap); CHECK_NULL(policy);
+        setName("DoReorderKeys");
+    }
+    const IR::Node* postorder(IR::P4Table* table) override;
+};
+
+class ReorderKeys : public PassManager {
+    KeyLayoutPolicy defaultPolicy;
+
+ public:
+    ReorderKeys(ReferenceMap* refMap, TypeMap* typeMap,
+                const KeyLayoutPolicy* policy = nullptr,
+                TypeChecking* typeChecking = nullptr) {
+        if (!policy)
+            policy = &defaultPolicy;
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap);
+        passes.push_back(typeChecking);
+        passes.push_back(new DoReorderKeys(typeMap, policy));
+        setName("ReorderKeys");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_REORDERKEYS_H_ */
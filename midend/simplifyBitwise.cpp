@@ -18,10 +18,11 @@ void SimplifyBitwise::assignSlices(const IR::Expression *expr, big_int mask) {
 }
 
 const IR::Node *SimplifyBitwise::preorder(IR::AssignmentStatement *as) {
-    Pattern::Match<IR::Expression> a, b;
-    Pattern::Match<IR::Constant> maskA, maskB;
+    const IR::Expression *a, *b;
+    const IR::Constant *maskA, *maskB;
+    using StaticPattern::bind;
 
-    if (!((a & maskA) | (b & maskB)).match(as->right))
+    if (!((bind(a) & bind(maskA)) | (bind(b) & bind(maskB))).match(as->right))
         return as;
     if ((maskA->value & maskB->value) != 0)
         return as;
@@ -0,0 +1,283 @@
+#include "specializeConstTables.h"
+
+#include <algorithm>
+
+#include "has_side_effects.h"
+#include "frontends/p4/cloner.h"
+#include "frontends/p4/coreLibrary.h"
+#include "frontends/p4/methodInstance.h"
+#include "lib/gmputil.h"
+
+namespace P4 {
+
+namespace {
+
+/// Builds the code that replaces one table.
+class TableCode {
+    const IR::P4Table*                      table;
+    std::vector<const IR::Expression*>      keys;
+    std::vector<const IR::Entry*>           entries;
+    ClonePathExpressions                    cloner;
+
+ public:
+    TableCode(const IR::P4Table* table, std::vector<const IR::Expression*> keys,
+              std::vector<const IR::Entry*> entries) :
+            table(table), keys(keys), entries(entries) {}
+
+    const IR::Expression* key(size_t index)
+    { return cloner.clone<IR::Expression>(keys.at(index)); }
+
+    /// A call of @action, which is an action reference of an entry or default action.
+    const IR::Statement* call(const IR::Expression* action) {
+        if (action == nullptr)
+            return nullptr;
+        if (auto path = action->to<IR::PathExpression>())
+            return new IR::MethodCallStatement(new IR::MethodCallExpression(
+                action->srcInfo, cloner.clone<IR::PathExpression>(path)));
+        return new IR::MethodCallStatement(cloner.clone<IR::MethodCallExpression>(action));
+    }
+    const IR::Statement* defaultCall() { return call(table->getDefaultAction()); }
+
+    /// The condition for @keyset to match key @index, or nullptr if it always matches.
+    const IR::Expression* matches(size_t index, const IR::Expression* keyset) {
+        if (keyset->is<IR::DefaultExpression>())
+            return nullptr;
+        if (auto mask = keyset->to<IR::Mask>()) {
+            auto value = mask->left->to<IR::Constant>();
+            auto bits = mask->right->to<IR::Constant>();
+            auto type = value->type->to<IR::Type_Bits>();
+            if (bits->value == 0)
+                return nullptr;
+            if (bits->value == Util::mask(type->width_bits()))
+                return new IR::Equ(key(index), value);
+            return new IR::Equ(new IR::BAnd(key(index), bits),
+                               new IR::Constant(type, value->value & bits->value));
+        }
+        if (auto range = keyset->to<IR::Range>()) {
+            if (range->left->to<IR::Constant>()->value == range->right->to<IR::Constant>()->value)
+                return new IR::Equ(key(index), range->left);
+            return new IR::LAnd(new IR::Leq(range->left, key(index)),
+                                new IR::Leq(key(index), range->right));
+        }
+        return new IR::Equ(key(index), keyset);
+    }
+
+    /// Tests @entry and calls its action, or else runs @otherwise.
+    const IR::Statement* test(const IR::Entry* entry, const IR::Statement* otherwise) {
+        const IR::Expression* condition = nullptr;
+        auto& keysets = entry->keys->components;
+        for (size_t i = 0; i < keysets.size(); i++) {
+            auto match = matches(i, keysets.at(i));
+            if (match == nullptr)
+                continue;
+            condition = condition ? new IR::LAnd(condition, match) : match;
+        }
+        if (condition == nullptr)
+            return call(entry->action);
+        return new IR::IfStatement(condition, call(entry->action), otherwise);
+    }
+
+    /// Tests the entries in [@begin, @end) one after the other.
+    const IR::Statement* inOrder(size_t begin, size_t end) {
+        auto result = defaultCall();
+        for (size_t i = end; i > begin; i--)
+            result = test(entries.at(i - 1), result);
+        return result;
+    }
+
+    /// Searches the entries in [@begin, @end), which are sorted and do not overlap.
+    const IR::Statement* binarySearch(size_t begin, size_t end) {
+        if (end - begin <= 2)
+            return inOrder(begin, end);
+        size_t middle = begin + (end - begin) / 2;
+        auto lower = lowerBound(entries.at(middle));
+        auto left = binarySearch(begin, middle);
+        auto right = binarySearch(middle, end);
+        // Each half has some entries, so neither is null.
+        return new IR::IfStatement(new IR::Lss(key(0), lower), left, right);
+    }
+
+    /// The smallest value matched by the first keyset of @entry.
+    static const IR::Constant* lowerBound(const IR::Entry* entry) {
+        auto keyset = entry->keys->components.at(0);
+        if (auto range = keyset->to<IR::Range>())
+            return range->left->to<IR::Constant>();
+        return keyset->to<IR::Constant>();
+    }
+    static const IR::Constant* upperBound(const IR::Entry* entry) {
+        auto keyset = entry->keys->components.at(0);
+        if (auto range = keyset->to<IR::Range>())
+            return range->right->to<IR::Constant>();
+        return keyset->to<IR::Constant>();
+    }
+};
+
+/// True if @keyset can be translated for a key matched with @kind.
+bool supported(cstring kind, const IR::Expression* keyset) {
+    auto& corelib = P4CoreLibrary::instance();
+    if (keyset->is<IR::DefaultExpression>())
+        return true;
+    if (keyset->is<IR::Constant>())
+        return true;
+    if (keyset->is<IR::BoolLiteral>())
+        return kind == corelib.exactMatch.name;
+    if (auto mask = keyset->to<IR::Mask>())
+        return (kind == corelib.ternaryMatch.name || kind == corelib.lpmMatch.name) &&
+               mask->left->is<IR::Constant>() && mask->right->is<IR::Constant>() &&
+               mask->left->type->is<IR::Type_Bits>();
+    if (auto range = keyset->to<IR::Range>())
+        return kind == "range" &&
+               range->left->is<IR::Constant>() && range->right->is<IR::Constant>();
+    return false;
+}
+
+/// The length of the prefix matched by @keyset for a key of @width bits, or -1 if it
+/// always matches.
+int prefixLength(const IR::Expression* keyset, int width) {
+    if (keyset->is<IR::DefaultExpression>())
+        return -1;
+    if (auto mask = keyset->to<IR::Mask>())
+        return bitcount(mask->right->to<IR::Constant>()->value);
+    return width;
+}
+
+}  // namespace
+
+const IR::Statement* DoSpecializeConstTables::specialize(const IR::P4Table* table) const {
+    for (auto property : table->properties->properties) {
+        auto name = property->name.name;
+        if (name != IR::TableProperties::keyPropertyName &&
+            name != IR::TableProperties::actionsPropertyName &&
+            name != IR::TableProperties::entriesPropertyName &&
+            name != IR::TableProperties::defaultActionPropertyName &&
+            name != IR::TableProperties::sizePropertyName)
+            return nullptr;
+    }
+    auto property = table->properties->getProperty(IR::TableProperties::entriesPropertyName);
+    auto key = table->getKey();
+    auto list = table->getEntries();
+    if (property == nullptr || !property->isConstant || key == nullptr || list == nullptr ||
+        !policy->specialize(table, list->entries.size()))
+        return nullptr;
+    for (auto action : table->getActionList()->actionList) {
+        auto call = action->expression->to<IR::MethodCallExpression>();
+        if (call != nullptr && !call->arguments->empty())
+            return nullptr;
+    }
+
+    std::vector<const IR::Expression*> keys;
+    std::vector<cstring> kinds;
+    std::vector<const IR::Type*> types;
+    int lpm = -1;
+    for (auto element : key->keyElements) {
+        auto type = typeMap->getType(element->expression, true);
+        if ((!type->is<IR::Type_Bits>() && !type->is<IR::Type_Boolean>()) ||
+            hasSideEffects(refMap, typeMap, element->expression))
+            return nullptr;
+        auto kind = element->matchType->path->name.name;
+        auto& corelib = P4CoreLibrary::instance();
+        if (kind == corelib.lpmMatch.name)
+            lpm = keys.size();
+        else if (kind != corelib.exactMatch.name && kind != corelib.ternaryMatch.name &&
+                 kind != "range")
+            return nullptr;
+        keys.push_back(element->expression);
+        kinds.push_back(kind);
+        types.push_back(type);
+    }
+
+    std::vector<const IR::Entry*> entries;
+    for (auto entry : list->entries) {
+        if (entry->getAnnotation("priority") != nullptr ||
+            entry->keys->components.size() != keys.size())
+            return nullptr;
+        for (size_t i = 0; i < keys.size(); i++)
+            if (!supported(kinds.at(i), entry->keys->components.at(i)))
+                return nullptr;
+        entries.push_back(entry);
+    }
+    if (lpm >= 0) {
+        int width = types.at(lpm)->width_bits();
+        std::stable_sort(entries.begin(), entries.end(),
+                         [lpm, width](const IR::Entry* left, const IR::Entry* right) {
+            return prefixLength(left->keys->components.at(lpm), width) >
+                   prefixLength(right->keys->components.at(lpm), width); });
+    }
+
+    // A single exact or range key with disjoint entries can be searched.
+    bool search = keys.size() == 1 && lpm < 0 &&
+                  kinds.at(0) != P4CoreLibrary::instance().ternaryMatch.name &&
+                  types.at(0)->is<IR::Type_Bits>() &&
+                  policy->binarySearch(entries.size());
+    for (auto entry : entries) {
+        if (!search)
+            break;
+        if (TableCode::lowerBound(entry) == nullptr)
+            search = false;
+    }
+    if (search) {
+        // Overlapping entries are tested in their original order.
+        auto sorted = entries;
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const IR::Entry* left, const IR::Entry* right) {
+            return TableCode::lowerBound(left)->value < TableCode::lowerBound(right)->value; });
+        for (size_t i = 1; i < sorted.size(); i++)
+            if (TableCode::upperBound(sorted.at(i - 1))->value >=
+                TableCode::lowerBound(sorted.at(i))->value)
+                search = false;
+        if (search)
+            entries = sorted;
+    }
+
+    LOG2("Replacing " << dbp(table) << " with " << (search ? "a binary search" : "tests")
+         << " of " << entries.size() << " entries");
+    TableCode code(table, keys, entries);
+    auto result = search ? code.binarySearch(0, entries.size())
+                         : code.inOrder(0, entries.size());
+    return result ? result : new IR::EmptyStatement(table->srcInfo);
+}
+
+const IR::Node* DoSpecializeConstTables::preorder(IR::P4Control* control) {
+    auto body = getOriginal<IR::P4Control>()->body;
+    std::map<const IR::P4Table*, unsigned> uses, applies;
+    forAllMatching<IR::PathExpression>(body, [&](const IR::PathExpression* path) {
+        auto decl = refMap->getDeclaration(path->path);
+        if (decl != nullptr && decl->is<IR::P4Table>())
+            uses[decl->to<IR::P4Table>()]++; });
+    forAllMatching<IR::MethodCallStatement>(body, [&](const IR::MethodCallStatement* call) {
+        auto mi = MethodInstance::resolve(call, refMap, typeMap);
+        if (auto am = mi->to<ApplyMethod>())
+            if (am->isTableApply())
+                applies[am->object->to<IR::P4Table>()]++; });
+    for (auto use : uses) {
+        if (use.second != 1 || applies[use.first] != 1)
+            continue;
+        if (auto code = specialize(use.first))
+            replacement.emplace(use.first, code);
+    }
+    return control;
+}
+
+const IR::Node* DoSpecializeConstTables::postorder(IR::P4Control* control) {
+    replacement.clear();
+    return control;
+}
+
+const IR::Node* DoSpecializeConstTables::postorder(IR::P4Table* table) {
+    if (replacement.count(getOriginal<IR::P4Table>()))
+        return nullptr;
+    return table;
+}
+
+const IR::Node* DoSpecializeConstTables::postorder(IR::MethodCallStatement* statement) {
+    auto mi = MethodInstance::resolve(getOriginal<IR::MethodCallStatement>(), refMap, typeMap);
+    auto am = mi->to<ApplyMethod>();
+    if (am == nullptr || !am->isTableApply())
+        return statement;
+    auto it = replacement.find(am->object->to<IR::P4Table>());
+    if (it == replacement.end())
+        return statement;
+    return it->second;
+}
+
+}  // namespace P4
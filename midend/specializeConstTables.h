@@ -0,0 +1,112 @@
+#ifndef _MIDEND_SPECIALIZECONSTTABLES_H_
+#define _MIDEND_SPECIALIZECONSTTABLES_H_
+
+#include <map>
+
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+
+namespace P4 {
+
+/**
+ * Policy for SpecializeConstTables: decides which tables are replaced, and how their
+ * entries are searched.
+ */
+class SpecializeConstTablesPolicy {
+    size_t maxEntries;
+    size_t minBinarySearch;
+
+ public:
+    explicit SpecializeConstTablesPolicy(size_t maxEntries = 8, size_t minBinarySearch = 4) :
+            maxEntries(maxEntries), minBinarySearch(minBinarySearch) {}
+    virtual ~SpecializeConstTablesPolicy() {}
+    /// True if @table, which has @entries constant entries, may be replaced by code.
+    /// The P4Runtime description of the program is produced before the midend and still
+    /// lists the table; targets whose control plane must find the table at run time
+    /// should return false.
+    virtual bool specialize(const IR::P4Table*, size_t entries) const
+    { return entries <= maxEntries; }
+    /// True if @entries entries on a single exact or range key, which do not overlap,
+    /// are searched by a binary search rather than one after the other.
+    virtual bool binarySearch(size_t entries) const
+    { return entries >= minBinarySearch; }
+};
+
+/**
+ * Replaces the tables that only have constant entries with code that finds the matching
+ * entry and calls its action.
+ *
+ * \code{.cpp}
+ *  table t {
+ *    key = { h.x : exact; }
+ *    actions = { a; b; }
+ *    const entries = { 1 : a(); 2 : b(); }
+ *    default_action = b();
+ *  }
+ *  apply { t.apply(); }
+ * \endcode
+ *
+ * becomes
+ *
+ * \code{.cpp}
+ *  apply { if (h.x == 1) a(); else if (h.x == 2) b(); else b(); }
+ * \endcode
+ *
+ * The entries of a table with a single exact or range key that do not overlap are
+ * searched by comparing the key with their lower bounds, when the policy asks for a
+ * binary search.  Otherwise they are tested in order: the order of the entries for
+ * ternary keys, and the longest prefix first for lpm keys.  A table is only replaced if
+ * it is applied once, in a statement of its own (not for its hit or action_run results),
+ * has no properties other than the key, the actions, the entries, the default action and
+ * the size, matches with exact, ternary, lpm or range on keys without side effects, has
+ * no entry priorities, and binds no arguments in its action list.
+ *
+ * @pre The program is type checked.
+ */
+class DoSpecializeConstTables : public Transform {
+    ReferenceMap*                       refMap;
+    TypeMap*                            typeMap;
+    const SpecializeConstTablesPolicy*  policy;
+    /// The code replacing the application of each table of the current control.
+    std::map<const IR::P4Table*, const IR::Statement*> replacement;
+
+    /// The code replacing @table, or nullptr if it cannot be replaced.
+    const IR::Statement* specialize(const IR::P4Table* table) const;
+
+ public:
+    DoSpecializeConstTables(ReferenceMap* refMap, TypeMap* typeMap,
+                            const SpecializeConstTablesPolicy* policy) :
+            refMap(refMap), typeMap(typeMap), policy(policy) {
+        CHECK_NULL(refMap); CHECK_NULL(typeMap); CHECK_NULL(policy);
+        setName("DoSpecializeConstTables");
+    }
+    const IR::Node* preorder(IR::P4Control* control) override;
+    const IR::Node* postorder(IR::P4Control* control) override;
+    const IR::Node* postorder(IR::P4Table* table) override;
+    const IR::Node* postorder(IR::MethodCallStatement* statement) override;
+    const IR::Node* preorder(IR::P4Parser* parser) override
+    { prune(); return parser; }
+};
+
+class SpecializeConstTables : public PassManager {
+    SpecializeConstTablesPolicy defaultPolicy;
+
+ public:
+    SpecializeConstTables(ReferenceMap* refMap, TypeMap* typeMap,
+                          const SpecializeConstTablesPolicy* policy = nullptr,
+                          TypeChecking* typeChecking = nullptr) {
+        if (!policy)
+            policy = &defaultPolicy;
+        if (!typeChecking)
+            typeChecking = new TypeChecking(refMap, typeMap);
+        passes.push_back(typeChecking);
+        passes.push_back(new DoSpecializeConstTables(refMap, typeMap, policy));
+        setName("SpecializeConstTables");
+    }
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_SPECIALIZECONSTTABLES_H_ */
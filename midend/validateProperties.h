@@ -43,6 +43,7 @@ class ValidateTableProperties : public Inspector {
     void postorder(const IR::Property* property) override;
     // don't check properties in externs (Declaration_Instances)
     bool preorder(const IR::Declaration_Instance *) override { return false; }
+    bool canFuse() const override { return true; }
 };
 
 }  // namespace P4
@@ -0,0 +1,103 @@
+#include "benchmark.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lib/compile_context.h"
+#include "lib/gc.h"
+
+namespace Bench {
+
+namespace {
+
+struct Benchmark {
+    const char          *name;
+    Function            fn;
+    std::vector<long>   args;
+};
+
+std::vector<Benchmark> &benchmarks() {
+    static std::vector<Benchmark> *rv = new std::vector<Benchmark>;
+    return *rv;
+}
+
+}  // namespace
+
+Registration::Registration(const char *name, Function fn, std::initializer_list<long> args) {
+    benchmarks().push_back({ name, fn, args });
+    if (benchmarks().back().args.empty()) benchmarks().back().args.push_back(0);
+}
+
+class Runner {
+    std::chrono::nanoseconds    minTime;
+
+ public:
+    explicit Runner(std::chrono::nanoseconds minTime) : minTime(minTime) {}
+
+    /// Run @fn on @arg with more and more iterations until they take at least minTime.
+    void run(const std::string &name, Function fn, long arg) {
+        for (size_t iterations = 1; ; iterations *= 2) {
+            State state(arg, iterations);
+            fn(state);
+            if (state.elapsed < minTime && iterations < (size_t(1) << 40)) continue;
+            double ns = std::chrono::duration<double, std::nano>(state.elapsed).count();
+            std::cout << std::left << std::setw(40) << name << std::right
+                      << std::setw(12) << iterations << std::setw(14) << std::fixed
+                      << std::setprecision(1) << ns / iterations << " ns";
+            if (state.items)
+                std::cout << std::setw(14) << std::setprecision(2)
+                          << state.items * iterations / ns * 1e3 << " M items/s";
+            std::cout << std::endl;
+            return; }
+    }
+};
+
+}  // namespace Bench
+
+/// The benchmarks report no errors, but some of the code they run looks for a context.
+class BenchContext : public BaseCompileContext {};
+
+static void usage(const char *name) {
+    std::cerr << "usage: " << name << " [--quick] [--min-time ms] [name...]\n"
+              << "Runs the benchmarks whose name contains one of the names, or all of them.\n"
+              << "--quick runs each one briefly, and not on arguments over 10000, to check\n"
+              << "that they work." << std::endl;
+}
+
+int main(int argc, char **argv) {
+    AutoCompileContext context(new BenchContext);
+    long minTimeMs = 500;
+    bool quick = false;
+    std::vector<const char *> names;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+            minTimeMs = 0;
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minTimeMs = strtol(argv[++i], nullptr, 10);
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            names.push_back(argv[i]); } }
+
+    Bench::Runner runner{std::chrono::milliseconds(minTimeMs)};
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(12)
+              << "iterations" << std::setw(17) << "time" << std::endl;
+    for (auto &b : Bench::benchmarks()) {
+        bool selected = names.empty();
+        for (auto n : names) if (strstr(b.name, n)) selected = true;
+        if (!selected) continue;
+        for (auto arg : b.args) {
+            if (quick && arg > 10000) continue;
+            std::stringstream name;
+            name << b.name;
+            if (b.args.size() > 1 || arg) name << "/" << arg;
+            runner.run(name.str(), b.fn, arg); } }
+    return 0;
+}
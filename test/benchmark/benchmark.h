@@ -0,0 +1,87 @@
+#ifndef TEST_BENCHMARK_BENCHMARK_H_
+#define TEST_BENCHMARK_BENCHMARK_H_
+
+#include <chrono>
+#include <cstddef>
+#include <initializer_list>
+
+/* A small microbenchmark harness, with the shape of Google Benchmark's:
+
+       static void cstringCompare(Bench::State &state) {
+           ... setup, sized by state.arg() ...
+           for (auto _ : state)
+               Bench::doNotOptimize(a == b);
+       }
+       BENCHMARK(cstringCompare, 16, 1024);
+
+   registers a benchmark run once for each argument, or once with 0 if there are none.
+   The loop runs until it has taken long enough to time, and the time per iteration is
+   reported; setItems() adds a rate of items per second.  p4cbench runs them all, or
+   those whose name contains one of its arguments. */
+
+namespace Bench {
+
+class State {
+    long                                                arg_;
+    size_t                                              iterations;
+    size_t                                              items = 0;
+    std::chrono::steady_clock::duration                 elapsed{};
+    std::chrono::steady_clock::time_point               start;
+    bool                                                paused = false;
+    friend class Runner;
+
+ public:
+    State(long arg, size_t iterations) : arg_(arg), iterations(iterations) {}
+    long arg() const { return arg_; }
+    /// The number of items each iteration processes, to report a rate.
+    void setItems(size_t n) { items = n; }
+    /// Leave the code run until the next resumeTiming() out of the time.
+    void pauseTiming() {
+        elapsed += std::chrono::steady_clock::now() - start;
+        paused = true; }
+    void resumeTiming() {
+        paused = false;
+        start = std::chrono::steady_clock::now(); }
+
+    // unused, as in 'for (auto _ : state)'
+    struct __attribute__((unused)) Iteration {};
+    class iterator {
+        State   *state;
+        size_t  left;
+
+     public:
+        iterator(State *state, size_t left) : state(state), left(left) {}
+        Iteration operator*() const { return Iteration(); }
+        iterator &operator++() { --left; return *this; }
+        bool operator!=(const iterator &a) const {
+            if (left != a.left) return true;
+            state->stop();
+            return false; }
+    };
+    iterator begin() {
+        start = std::chrono::steady_clock::now();
+        return iterator(this, iterations); }
+    iterator end() { return iterator(this, 0); }
+
+ private:
+    void stop() { if (!paused) elapsed += std::chrono::steady_clock::now() - start; }
+};
+
+using Function = void (*)(State &);
+
+/// Registers a benchmark; use BENCHMARK.
+struct Registration {
+    Registration(const char *name, Function fn, std::initializer_list<long> args);
+};
+
+/// Keep the compiler from optimizing away the computation of @v.
+template<class T> inline void doNotOptimize(const T &v) {
+    asm volatile("" : : "g"(&v) : "memory");
+}
+
+}  // namespace Bench
+
+#define BENCHMARK(FN, ...) \
+    static Bench::Registration benchmark_##FN(#FN, FN, { __VA_ARGS__ })
+
+#endif  // TEST_BENCHMARK_BENCHMARK_H_
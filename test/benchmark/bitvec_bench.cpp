@@ -0,0 +1,71 @@
+#include "benchmark.h"
+#include "lib/bitvec.h"
+
+/// A bitvec with every third of its @bits bits set.
+static bitvec sparse(long bits, int offset = 0) {
+    bitvec rv;
+    for (long i = offset; i < bits; i += 3) rv.setbit(i);
+    rv.setbit(bits - 1);
+    return rv;
+}
+
+static void bitvecSetClear(Bench::State &state) {
+    long bits = state.arg();
+    bitvec bv;
+    bv.setbit(bits - 1);
+    state.setItems(bits);
+    for (auto _ : state) {
+        for (long i = 0; i < bits; ++i) bv.setbit(i);
+        for (long i = 0; i < bits; ++i) bv.clrbit(i);
+        Bench::doNotOptimize(bv); }
+}
+BENCHMARK(bitvecSetClear, 64, 1024, 65536);
+
+static void bitvecOr(Bench::State &state) {
+    bitvec a = sparse(state.arg()), b = sparse(state.arg(), 1);
+    for (auto _ : state)
+        Bench::doNotOptimize(a | b);
+}
+BENCHMARK(bitvecOr, 64, 1024, 65536);
+
+static void bitvecAndAssign(Bench::State &state) {
+    bitvec a = sparse(state.arg()), b = sparse(state.arg(), 1);
+    for (auto _ : state) {
+        bitvec c = a;
+        c &= b;
+        Bench::doNotOptimize(c); }
+}
+BENCHMARK(bitvecAndAssign, 64, 1024, 65536);
+
+static void bitvecIntersects(Bench::State &state) {
+    bitvec a = sparse(state.arg()), b = sparse(state.arg(), 1);
+    b.clrbit(state.arg() - 1);
+    for (auto _ : state)
+        Bench::doNotOptimize(a.intersects(b));
+}
+BENCHMARK(bitvecIntersects, 64, 1024, 65536);
+
+static void bitvecPopcount(Bench::State &state) {
+    bitvec a = sparse(state.arg());
+    for (auto _ : state)
+        Bench::doNotOptimize(a.popcount());
+}
+BENCHMARK(bitvecPopcount, 64, 1024, 65536);
+
+static void bitvecShift(Bench::State &state) {
+    bitvec a = sparse(state.arg());
+    for (auto _ : state)
+        Bench::doNotOptimize((a << 7) >> 5);
+}
+BENCHMARK(bitvecShift, 64, 1024, 65536);
+
+/// Iterating over the set bits.
+static void bitvecIterate(Bench::State &state) {
+    bitvec a = sparse(state.arg());
+    state.setItems(a.popcount());
+    for (auto _ : state) {
+        int sum = 0;
+        for (int i : a) sum += i;
+        Bench::doNotOptimize(sum); }
+}
+BENCHMARK(bitvecIterate, 64, 1024, 65536);
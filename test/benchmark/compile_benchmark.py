@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+""" Times the compilers on a set of programs, and compares the times with a baseline.
+
+    Each program in the list is compiled by its backend --repeat times, with
+    --trace-passes, and the median wall time, peak resident set size and time of each
+    pass are written to --output.  With --baseline (an earlier --output), changes above
+    --threshold percent are reported, and the exit status is 1 if any time or size grew
+    by more than that.
+
+    The program list has one program per line: the backend, the program (a path relative
+    to the source tree, or synthetic:<tables> for a generated v1model program with that
+    many tables, or synthetic:<size>=<n>,... for other tools/p4gen.py sizes), and any extra
+    compiler options.  Lines starting with # are comments.
+
+    With --scale <size>=<n>,<n>,..., it instead compiles p4gen programs of each of those
+    sizes (and the others of --sizes) with each --backend, and writes the time of each
+    pass at each size to --output as CSV, with the exponent k of the best fit of
+    time = c * size^k; passes with k above 1.5 are listed as not scaling linearly."""
+
+import argparse
+import csv
+import json
+import math
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+SOURCE_DIR = Path(__file__).resolve().parents[2]
+sys.path.insert(0, str(SOURCE_DIR / "tools"))
+import p4gen  # noqa: E402
+
+# backend: (executable, options); {out} is replaced by the output file's name
+BACKENDS = {
+    "p4test": ("p4test", []),
+    "bmv2": ("p4c-bm2-ss", ["-o", "{out}.json"]),
+    "psa": ("p4c-bm2-psa", ["-o", "{out}.json"]),
+    "ebpf": ("p4c-ebpf", ["-o", "{out}.c"]),
+    "ubpf": ("p4c-ubpf", ["-o", "{out}.c"]),
+    "dpdk": ("p4c-dpdk", ["--arch", "psa", "-o", "{out}.spec"]),
+}
+# the p4gen architecture for the synthetic programs of each backend
+ARCH = {"bmv2": "v1model", "psa": "psa", "dpdk": "psa", "ebpf": "ebpf"}
+
+
+def synthetic(spec):
+    """ The sizes of the p4gen program for synthetic:<spec>, which is a number of tables
+        or a list of size=value separated by commas """
+    if spec.isdigit():
+        return {"tables": int(spec)}
+    sizes = dict(kv.split("=", 1) for kv in spec.split(","))
+    return {k: v if k == "arch" else int(v) for k, v in sizes.items()}
+
+
+def find_compiler(build_dir, name):
+    for path in [build_dir / name] + sorted(build_dir.glob("backends/*/" + name)):
+        if path.is_file() and os.access(path, os.X_OK):
+            return path
+    return None
+
+
+def read_programs(listfile):
+    programs = []
+    for line in open(listfile):
+        words = line.split()
+        if not words or words[0].startswith("#"):
+            continue
+        if len(words) < 2 or words[0] not in BACKENDS:
+            sys.exit("%s: cannot read '%s'" % (listfile, line.strip()))
+        programs.append((words[0], words[1], words[2:]))
+    return programs
+
+
+def compile_once(compiler, options, program, tmpdir):
+    """ @return the wall time in milliseconds, the peak RSS in kilobytes and the total
+        time of each pass in milliseconds, or None if the compilation failed """
+    trace = tmpdir / "trace.json"
+    args = [str(compiler)] + options + ["--trace-passes", str(trace), str(program)]
+    start = time.perf_counter()
+    proc = subprocess.Popen(args, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    stderr = proc.stderr.read()
+    proc.stderr.close()
+    # wait4 rather than wait, for the resource use of this compilation alone
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = (time.perf_counter() - start) * 1000
+    proc.returncode = status
+    if status != 0:
+        print(" ".join(args), "failed:", stderr.decode(errors="replace"), file=sys.stderr)
+        return None
+    passes = {}
+    for event in json.load(open(trace)):
+        passes[event["name"]] = passes.get(event["name"], 0) + event["dur"] / 1000
+    return wall, usage.ru_maxrss, passes
+
+
+def measure(compiler, options, program, tmpdir, repeat):
+    """ @return the median results of @repeat compilations, or None if one failed """
+    runs = []
+    for _ in range(repeat):
+        rv = compile_once(compiler, options, program, tmpdir)
+        if rv is None:
+            return None
+        runs.append(rv)
+    passes = {}
+    for p in set().union(*(r[2] for r in runs)):
+        passes[p] = statistics.median(r[2].get(p, 0) for r in runs)
+    return {
+        "wall_ms": statistics.median(r[0] for r in runs),
+        "peak_rss_kb": statistics.median(r[1] for r in runs),
+        "passes": passes,
+    }
+
+
+class Compilers:
+    """ The compiler for each backend, and the options to write its output in tmpdir """
+
+    def __init__(self, build_dir, tmpdir):
+        self.build_dir = build_dir
+        self.tmpdir = tmpdir
+        self.missing = set()
+
+    def find(self, backend):
+        executable, options = BACKENDS[backend]
+        compiler = find_compiler(self.build_dir, executable)
+        if not compiler and backend not in self.missing:
+            print("skipping %s: no %s in %s" % (backend, executable, self.build_dir))
+            self.missing.add(backend)
+        return compiler, [o.format(out=self.tmpdir / "out") for o in options]
+
+
+def run(args, tmpdir):
+    results = {}
+    compilers = Compilers(args.build_dir, tmpdir)
+    for backend, name, extra in read_programs(args.programs):
+        if args.backend and backend not in args.backend:
+            continue
+        compiler, options = compilers.find(backend)
+        if not compiler:
+            continue
+        if name.startswith("synthetic:"):
+            sizes = dict({"arch": ARCH.get(backend, "v1model")}, **synthetic(name[10:]))
+            program = tmpdir / "synthetic.p4"
+            program.write_text(p4gen.program(**sizes))
+        else:
+            program = SOURCE_DIR / name
+        key = " ".join([backend, name] + extra)
+        results[key] = measure(compiler, options + extra, program, tmpdir, args.repeat)
+        if not results[key]:
+            results[key] = {"error": True}
+            continue
+        print("%-60s %10.1f ms %10d KB" % (key, results[key]["wall_ms"],
+                                          results[key]["peak_rss_kb"]))
+    return results
+
+
+def slope(points):
+    """ The least-squares slope of log(time) against log(size) """
+    points = [(math.log(x), math.log(y)) for x, y in points if x > 0 and y > 0]
+    if len(points) < 2:
+        return 0
+    mx = sum(x for x, _ in points) / len(points)
+    my = sum(y for _, y in points) / len(points)
+    sxx = sum((x - mx) ** 2 for x, _ in points)
+    return sum((x - mx) * (y - my) for x, y in points) / sxx if sxx else 0
+
+
+def scale(args, tmpdir):
+    """ Compile p4gen programs of growing size; @return False if a compilation failed """
+    size, values = args.scale.split("=", 1)
+    values = [int(v) for v in values.split(",")]
+    if size not in p4gen.DEFAULTS or size == "arch":
+        sys.exit("cannot scale '%s'; the sizes are %s" %
+                 (size, ", ".join(k for k in p4gen.DEFAULTS if k != "arch")))
+    compilers = Compilers(args.build_dir, tmpdir)
+    rows = []
+    ok = True
+    for backend in args.backend or ["p4test"]:
+        compiler, options = compilers.find(backend)
+        if not compiler:
+            continue
+        sizes = {"arch": ARCH.get(backend, "v1model")}
+        if args.sizes:
+            sizes.update(synthetic(args.sizes))
+        series = {}
+        for v in values:
+            sizes[size] = v
+            program = tmpdir / "scale.p4"
+            program.write_text(p4gen.program(**sizes))
+            rv = measure(compiler, options, program, tmpdir, args.repeat)
+            if not rv:
+                ok = False
+                break
+            print("%s %s=%d: %.1f ms %d KB" % (backend, size, v, rv["wall_ms"],
+                                               rv["peak_rss_kb"]))
+            series.setdefault("wall time", {})[v] = rv["wall_ms"]
+            series.setdefault("peak RSS (KB)", {})[v] = rv["peak_rss_kb"]
+            for p, t in rv["passes"].items():
+                series.setdefault(p, {})[v] = t
+        for name, times in series.items():
+            k = slope(times.items())
+            rows.append([backend, name, "%.2f" % k] +
+                        ["%.3f" % times.get(v, 0) for v in values])
+            if k > 1.5 and max(times.values()) >= args.min_ms and "RSS" not in name:
+                print("NOT LINEAR %s %s: time grows as %s^%.2f" % (backend, name, size, k))
+    with open(args.output, "w", newline="") as out:
+        writer = csv.writer(out)
+        writer.writerow(["backend", "pass", "exponent"] + ["%s=%d" % (size, v) for v in values])
+        writer.writerows(sorted(rows, key=lambda r: (r[0], -float(r[2]))))
+    return ok
+
+
+def regressed(new, old, args, minimum):
+    return new > old * (1 + args.threshold / 100) and new - old >= minimum
+
+
+def compare(results, baseline, args):
+    """ Report the changes from the baseline; @return the number of regressions """
+    regressions = 0
+
+    def report(what, new, old, unit):
+        nonlocal regressions
+        regressions += 1
+        print("REGRESSION %s: %.1f %s -> %.1f %s (%+.0f%%)" %
+              (what, old, unit, new, unit, (new - old) * 100 / old if old else 100))
+
+    for key, new in results.items():
+        old = baseline.get(key)
+        if not old or "error" in old or "error" in new:
+            continue
+        if regressed(new["wall_ms"], old["wall_ms"], args, args.min_ms):
+            report(key, new["wall_ms"], old["wall_ms"], "ms")
+        if regressed(new["peak_rss_kb"], old["peak_rss_kb"], args, 1024):
+            report(key + " peak RSS", new["peak_rss_kb"], old["peak_rss_kb"], "KB")
+        for p, t in sorted(new["passes"].items()):
+            if regressed(t, old["passes"].get(p, 0), args, args.min_ms):
+                report(key + " " + p, t, old["passes"].get(p, 0), "ms")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--build-dir", type=Path, default=Path.cwd(),
+                        help="where the compilers are (default: the current directory)")
+    parser.add_argument("--programs", type=Path,
+                        default=Path(__file__).resolve().parent / "compile_programs.txt",
+                        help="the program list")
+    parser.add_argument("--backend", action="append",
+                        help="compile only for this backend (may be repeated)")
+    parser.add_argument("--repeat", "-n", type=int, default=3,
+                        help="compile each program this many times (default: 3)")
+    parser.add_argument("--output", type=Path, default=Path("compile-benchmark.json"),
+                        help="where to write the results")
+    parser.add_argument("--baseline", type=Path, help="results to compare with")
+    parser.add_argument("--threshold", type=float, default=10,
+                        help="percentage increase reported as a regression (default: 10)")
+    parser.add_argument("--min-ms", type=float, default=5,
+                        help="ignore time increases smaller than this (default: 5)")
+    parser.add_argument("--scale", metavar="SIZE=N,N,...",
+                        help="measure how the passes scale with this p4gen size")
+    parser.add_argument("--sizes", metavar="SIZE=N,...",
+                        help="the other p4gen sizes for --scale (default: p4gen's)")
+    args = parser.parse_args()
+
+    tmpdir = Path(tempfile.mkdtemp(prefix="compile-benchmark-"))
+    try:
+        if args.scale:
+            if args.output.suffix == ".json":
+                args.output = args.output.with_suffix(".csv")
+            sys.exit(0 if scale(args, tmpdir) else 1)
+        results = run(args, tmpdir)
+    finally:
+        shutil.rmtree(tmpdir)
+    with open(args.output, "w") as out:
+        json.dump(results, out, indent=1, sort_keys=True)
+    if args.baseline:
+        regressions = compare(results, json.load(open(args.baseline)), args)
+        print("%d regressions over %g%% from %s" % (regressions, args.threshold, args.baseline))
+        if regressions:
+            sys.exit(1)
+    if any("error" in r for r in results.values()):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
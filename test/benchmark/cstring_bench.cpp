@@ -0,0 +1,67 @@
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "lib/cstring.h"
+
+/// Strings of @size characters, distinct in their last characters.
+static std::vector<std::string> strings(size_t count, long size) {
+    std::vector<std::string> rv;
+    for (size_t i = 0; i < count; ++i) {
+        std::string s(size, 'a');
+        for (size_t j = i, k = s.size(); j && k; j /= 26) s[--k] = 'a' + j % 26;
+        rv.push_back(s); }
+    return rv;
+}
+
+/// Interning strings that are already in the table.
+static void cstringIntern(Bench::State &state) {
+    auto inputs = strings(1000, state.arg());
+    for (auto &s : inputs) cstring interned(s);
+    state.setItems(inputs.size());
+    for (auto _ : state)
+        for (auto &s : inputs) Bench::doNotOptimize(cstring(s));
+}
+BENCHMARK(cstringIntern, 8, 64, 1024);
+
+/// Interning new strings.
+static void cstringInternNew(Bench::State &state) {
+    static size_t serial = 0;
+    std::string s(state.arg(), 'x');
+    state.setItems(1000);
+    for (auto _ : state)
+        for (int i = 0; i < 1000; ++i) {
+            auto n = std::to_string(serial++);
+            s.replace(s.size() - std::min(s.size(), n.size()), n.size(), n);
+            Bench::doNotOptimize(cstring(s)); }
+}
+BENCHMARK(cstringInternNew, 16, 256);
+
+/// Comparing interned strings for equality, which compares pointers.
+static void cstringEqual(Bench::State &state) {
+    auto inputs = strings(2, state.arg());
+    cstring a = inputs[0], b = inputs[1], c = inputs[0];
+    for (auto _ : state) {
+        Bench::doNotOptimize(a == b);
+        Bench::doNotOptimize(a == c); }
+}
+BENCHMARK(cstringEqual, 8, 1024);
+
+/// Comparing with a const char *, which compares the characters.
+static void cstringEqualCharPtr(Bench::State &state) {
+    auto inputs = strings(2, state.arg());
+    cstring a = inputs[0];
+    const char *b = inputs[1].c_str();
+    for (auto _ : state)
+        Bench::doNotOptimize(a == b);
+}
+BENCHMARK(cstringEqualCharPtr, 8, 1024);
+
+/// Ordering interned strings, which compares the characters.
+static void cstringLess(Bench::State &state) {
+    auto inputs = strings(2, state.arg());
+    cstring a = inputs[0], b = inputs[1];
+    for (auto _ : state)
+        Bench::doNotOptimize(a < b);
+}
+BENCHMARK(cstringLess, 8, 1024);
@@ -0,0 +1,69 @@
+#include <vector>
+
+#include "benchmark.h"
+#include "lib/enumerator.h"
+
+static std::vector<int> numbers(long count) {
+    std::vector<int> rv;
+    for (long i = 0; i < count; ++i) rv.push_back(i);
+    return rv;
+}
+
+/// A where().map() chain of Enumerators, which allocates each adapter and makes a
+/// virtual call for each element at each stage.
+static void enumeratorChain(Bench::State &state) {
+    auto input = numbers(state.arg());
+    state.setItems(input.size());
+    for (auto _ : state) {
+        long sum = 0;
+        auto e = Util::Enumerator<int>::createEnumerator(input)
+                ->where([](const int &i) { return i % 3 != 0; })
+                ->map<long>([](const int &i) { return 2L * i; });
+        for (long v : *e) sum += v;
+        Bench::doNotOptimize(sum); }
+}
+BENCHMARK(enumeratorChain, 16, 1024, 65536);
+
+/// The same chain with Util::enumerate ranges.
+static void enumerateRangeChain(Bench::State &state) {
+    auto input = numbers(state.arg());
+    state.setItems(input.size());
+    for (auto _ : state) {
+        long sum = 0;
+        for (long v : Util::enumerate(input)
+                          .where([](const int &i) { return i % 3 != 0; })
+                          .map([](const int &i) { return 2L * i; }))
+            sum += v;
+        Bench::doNotOptimize(sum); }
+}
+BENCHMARK(enumerateRangeChain, 16, 1024, 65536);
+
+/// The same computation as a plain loop, as a baseline.
+static void plainLoop(Bench::State &state) {
+    auto input = numbers(state.arg());
+    state.setItems(input.size());
+    for (auto _ : state) {
+        long sum = 0;
+        for (int i : input)
+            if (i % 3 != 0) sum += 2L * i;
+        Bench::doNotOptimize(sum); }
+}
+BENCHMARK(plainLoop, 16, 1024, 65536);
+
+static void enumeratorConcatCount(Bench::State &state) {
+    auto a = numbers(state.arg()), b = numbers(state.arg());
+    state.setItems(a.size() + b.size());
+    for (auto _ : state) {
+        auto e = Util::Enumerator<int>::createEnumerator(a)
+                ->concat(Util::Enumerator<int>::createEnumerator(b));
+        Bench::doNotOptimize(e->count()); }
+}
+BENCHMARK(enumeratorConcatCount, 16, 1024, 65536);
+
+static void enumerateRangeConcatCount(Bench::State &state) {
+    auto a = numbers(state.arg()), b = numbers(state.arg());
+    state.setItems(a.size() + b.size());
+    for (auto _ : state)
+        Bench::doNotOptimize(Util::enumerate(a).concat(Util::enumerate(b)).count());
+}
+BENCHMARK(enumerateRangeConcatCount, 16, 1024, 65536);
@@ -0,0 +1,70 @@
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "lib/cstring.h"
+#include "lib/ordered_map.h"
+
+static std::vector<cstring> keys(long count) {
+    std::vector<cstring> rv;
+    for (long i = 0; i < count; ++i) rv.push_back(cstring("key" + std::to_string(i * 7919)));
+    return rv;
+}
+
+static void orderedMapInsert(Bench::State &state) {
+    auto k = keys(state.arg());
+    state.setItems(k.size());
+    for (auto _ : state) {
+        ordered_map<cstring, int> map;
+        for (size_t i = 0; i < k.size(); ++i) map.emplace(k[i], i);
+        Bench::doNotOptimize(map); }
+}
+BENCHMARK(orderedMapInsert, 16, 1024, 65536);
+
+static void orderedMapLookup(Bench::State &state) {
+    auto k = keys(state.arg());
+    ordered_map<cstring, int> map;
+    for (size_t i = 0; i < k.size(); ++i) map.emplace(k[i], i);
+    state.setItems(k.size());
+    for (auto _ : state)
+        for (auto &key : k) Bench::doNotOptimize(map.find(key));
+}
+BENCHMARK(orderedMapLookup, 16, 1024, 65536);
+
+/// Lookups that do not find the key.
+static void orderedMapLookupMissing(Bench::State &state) {
+    auto k = keys(state.arg());
+    ordered_map<cstring, int> map;
+    for (size_t i = 0; i < k.size(); ++i) map.emplace(k[i], i);
+    std::vector<cstring> missing;
+    for (auto &key : k) missing.push_back(key + "x");
+    state.setItems(k.size());
+    for (auto _ : state)
+        for (auto &key : missing) Bench::doNotOptimize(map.find(key));
+}
+BENCHMARK(orderedMapLookupMissing, 16, 1024, 65536);
+
+static void orderedMapIterate(Bench::State &state) {
+    auto k = keys(state.arg());
+    ordered_map<cstring, int> map;
+    for (size_t i = 0; i < k.size(); ++i) map.emplace(k[i], i);
+    state.setItems(k.size());
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto &kv : map) sum += kv.second;
+        Bench::doNotOptimize(sum); }
+}
+BENCHMARK(orderedMapIterate, 16, 1024, 65536);
+
+static void orderedMapErase(Bench::State &state) {
+    auto k = keys(state.arg());
+    state.setItems(k.size());
+    for (auto _ : state) {
+        state.pauseTiming();
+        ordered_map<cstring, int> map;
+        for (size_t i = 0; i < k.size(); ++i) map.emplace(k[i], i);
+        state.resumeTiming();
+        for (auto &key : k) map.erase(key);
+        Bench::doNotOptimize(map); }
+}
+BENCHMARK(orderedMapErase, 16, 1024);
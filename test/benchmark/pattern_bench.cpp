@@ -0,0 +1,61 @@
+#include "benchmark.h"
+#include "ir/ir.h"
+#include "ir/pattern.h"
+
+namespace {
+
+// (x & 3) | (y & 12), the expression SimplifyBitwise looks for
+const IR::Expression *expression() {
+    return new IR::BOr(new IR::BAnd(new IR::PathExpression("x"), new IR::Constant(3)),
+                       new IR::BAnd(new IR::Constant(12), new IR::PathExpression("y")));
+}
+
+void matchPattern(Bench::State &state) {
+    auto *e = expression();
+    for (auto _ : state) {
+        Pattern::Match<IR::Expression> a, b;
+        Pattern::Match<IR::Constant> maskA, maskB;
+        Bench::doNotOptimize(((a & maskA) | (b & maskB)).match(e));
+    }
+}
+BENCHMARK(matchPattern);
+
+void matchStaticPattern(Bench::State &state) {
+    auto *e = expression();
+    using StaticPattern::bind;
+    for (auto _ : state) {
+        const IR::Expression *a, *b;
+        const IR::Constant *maskA, *maskB;
+        Bench::doNotOptimize(((bind(a) & bind(maskA)) | (bind(b) & bind(maskB))).match(e));
+    }
+}
+BENCHMARK(matchStaticPattern);
+
+/// one side of the |: an & of an expression and a constant, either way around
+bool masked(const IR::Expression *e, const IR::Expression *&a, const IR::Constant *&mask) {
+    auto *band = e->to<IR::BAnd>();
+    if (!band) return false;
+    if ((mask = band->right->to<IR::Constant>())) {
+        a = band->left;
+        return true; }
+    if ((mask = band->left->to<IR::Constant>())) {
+        a = band->right;
+        return true; }
+    return false;
+}
+
+void matchByHand(Bench::State &state) {
+    auto *e = expression();
+    for (auto _ : state) {
+        const IR::Expression *a, *b;
+        const IR::Constant *maskA, *maskB;
+        auto *bor = e->to<IR::BOr>();
+        Bench::doNotOptimize(bor && ((masked(bor->left, a, maskA) &&
+                                      masked(bor->right, b, maskB)) ||
+                                     (masked(bor->right, a, maskA) &&
+                                      masked(bor->left, b, maskB))));
+    }
+}
+BENCHMARK(matchByHand);
+
+}  // namespace
@@ -0,0 +1,64 @@
+#include "benchmark.h"
+#include "ir/ir.h"
+#include "ir/visitor.h"
+
+namespace {
+
+/// A balanced tree of Adds with @nodes nodes in all (@nodes should be odd), so that
+/// large trees do not recurse deeply.
+const IR::Expression *tree(long nodes, long &next) {
+    if (nodes <= 1) return new IR::Constant(next++);
+    long left = (nodes - 1) / 2 | 1;
+    auto *l = tree(left, next);
+    return new IR::Add(l, tree(nodes - 1 - left, next));
+}
+
+const IR::Expression *tree(long nodes) {
+    long next = 0;
+    return tree(nodes | 1, next);
+}
+
+class CountConstants : public Inspector {
+ public:
+    long count = 0;
+    bool preorder(const IR::Constant *) override { ++count; return false; }
+};
+
+class BumpConstants : public Transform {
+    const IR::Node *postorder(IR::Constant *c) override {
+        return new IR::Constant(c->srcInfo, c->type, c->value + 1); }
+};
+
+/// Visits everything and changes nothing, so what is cloned is thrown away.
+class Identity : public Transform {};
+
+void inspect(Bench::State &state) {
+    auto *root = tree(state.arg());
+    state.setItems(state.arg());
+    for (auto _ : state) {
+        CountConstants count;
+        root->apply(count);
+        Bench::doNotOptimize(count.count); }
+}
+
+void transform(Bench::State &state) {
+    auto *root = tree(state.arg());
+    state.setItems(state.arg());
+    for (auto _ : state) {
+        BumpConstants bump;
+        Bench::doNotOptimize(root->apply(bump)); }
+}
+
+void identityTransform(Bench::State &state) {
+    auto *root = tree(state.arg());
+    state.setItems(state.arg());
+    for (auto _ : state) {
+        Identity identity;
+        Bench::doNotOptimize(root->apply(identity)); }
+}
+
+}  // namespace
+
+BENCHMARK(inspect, 1000, 10000, 100000, 1000000);
+BENCHMARK(transform, 1000, 10000, 100000, 1000000);
+BENCHMARK(identityTransform, 1000, 10000, 100000, 1000000);
@@ -0,0 +1,59 @@
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/alloc_stats.h"
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+#include "ir/visitor.h"
+
+namespace {
+
+/// Replaces each constant by a new one, one bigger.
+class BumpConstants : public Transform {
+    const IR::Node *postorder(IR::Constant *c) override {
+        return new IR::Constant(c->srcInfo, c->type, c->value + 1); }
+
+ public:
+    BumpConstants() { setName("BumpConstants"); }
+};
+
+}  // namespace
+
+namespace Test {
+
+class AllocStatsTest : public P4CTest { };
+
+TEST_F(AllocStatsTest, PerPassHistogram) {
+    const IR::Node *tree = new IR::Add(new IR::Constant(1), new IR::Constant(2));
+    IR::AllocStats::enabled = true;
+    PassManager passes({ new BumpConstants });
+    passes.setName("Passes");
+    tree = tree->apply(passes);
+    IR::AllocStats::enabled = false;
+
+    std::stringstream out;
+    IR::AllocStats::write(out);
+    std::string text = out.str();
+    // the Transform clones each node it visits, then makes a new Constant for each
+    // Constant; the PassManager itself makes no nodes, so it is not listed.
+    auto pass = text.find("BumpConstants: 7 nodes");
+    ASSERT_NE(pass, std::string::npos) << text;
+    EXPECT_NE(text.find("    Constant: 4 nodes (2 clones)", pass), std::string::npos) << text;
+    EXPECT_NE(text.find("    Add: 1 nodes (1 clones)", pass), std::string::npos) << text;
+    EXPECT_EQ(text.find("Passes:"), std::string::npos) << text;
+}
+
+TEST_F(AllocStatsTest, NodeSizes) {
+    std::stringstream out;
+    IR::writeNodeSizes(out);
+    std::string text = out.str();
+    std::stringstream constant;
+    constant << "\nConstant: " << sizeof(IR::Constant) << " bytes, "
+             << sizeof(IR::Constant) - sizeof(IR::Literal) << " more than Literal with "
+             << sizeof(IR::Constant::value) + sizeof(IR::Constant::base) << " in fields";
+    EXPECT_NE(text.find(constant.str()), std::string::npos) << text;
+    EXPECT_NE(text.find("\nAdd: "), std::string::npos) << text;
+}
+
+}  // namespace Test
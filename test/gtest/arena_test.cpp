@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/arena.h"
+#include "lib/exceptions.h"
+
+namespace Test {
+
+TEST(Arena, Allocate) {
+    Util::Arena arena(4096);
+    char *prev = nullptr;
+    for (int i = 0; i < 1000; ++i) {
+        auto *p = static_cast<char *>(arena.allocate(24));
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignof(std::max_align_t), 0u);
+        EXPECT_TRUE(arena.owns(p));
+        EXPECT_NE(p, prev);
+        prev = p; }
+    auto *big = arena.allocate(100000);
+    EXPECT_TRUE(arena.owns(big));
+    EXPECT_TRUE(Util::Arena::isArenaPtr(big));
+    int local;
+    EXPECT_FALSE(arena.owns(&local));
+    EXPECT_FALSE(Util::Arena::isArenaPtr(&local));
+}
+
+// isArenaPtr looks up the pages of the chunks, which hold nothing but arena memory
+TEST(Arena, IsArenaPtr) {
+    std::vector<char *> objects;
+    {
+        Util::Arena arena(4096);
+        for (int i = 0; i < 1000; ++i)
+            objects.push_back(static_cast<char *>(arena.allocate(40)));
+        objects.push_back(static_cast<char *>(arena.allocate(100000)));
+        for (auto *p : objects) {
+            EXPECT_TRUE(Util::Arena::isArenaPtr(p));
+            EXPECT_TRUE(Util::Arena::isArenaPtr(p + 39)); }
+        std::vector<char> heap(64);
+        EXPECT_FALSE(Util::Arena::isArenaPtr(heap.data()));
+        EXPECT_FALSE(Util::Arena::isArenaPtr(nullptr));
+    }
+    // the pages of a destroyed arena are not arena memory any more
+    for (auto *p : objects)
+        EXPECT_FALSE(Util::Arena::isArenaPtr(p));
+}
+
+TEST(Arena, Scope) {
+    EXPECT_EQ(Util::Arena::current(), nullptr);
+    Util::Arena arena;
+    {
+        Util::Arena::Scope scope(&arena);
+        EXPECT_EQ(Util::Arena::current(), &arena);
+        {
+            Util::Arena::Scope none(nullptr);
+            EXPECT_EQ(Util::Arena::current(), nullptr);
+        }
+        EXPECT_EQ(Util::Arena::current(), &arena);
+    }
+    EXPECT_EQ(Util::Arena::current(), nullptr);
+}
+
+TEST(Arena, CompactPtr) {
+    Util::Arena arena(4096);
+    std::vector<long *> objects;
+    for (long i = 0; i < 1000; ++i)
+        objects.push_back(new(arena.allocate(sizeof(long))) long(i));
+    for (long i = 0; i < 1000; ++i) {
+        Util::CompactPtr<long> p(arena, objects[i]);
+        EXPECT_EQ(sizeof(p), 4u);
+        EXPECT_EQ(p.get(), objects[i]);
+        EXPECT_EQ(*p, i); }
+    EXPECT_FALSE(Util::CompactPtr<long>(arena, nullptr));
+    EXPECT_EQ(Util::CompactPtr<long>(arena, nullptr).get(), nullptr);
+    // a part of an object, or one too big for a numbered chunk, has no handle
+    EXPECT_EQ(arena.compress(reinterpret_cast<char *>(objects[0]) + 1), 0u);
+    auto *big = static_cast<char *>(arena.allocate(Util::Arena::compactChunkSize * 2));
+    EXPECT_EQ(arena.compress(big), 0u);
+    EXPECT_THROW(Util::CompactPtr<char>(arena, big), Util::CompilerBug);
+    int local;
+    EXPECT_EQ(arena.compress(&local), 0u);
+}
+
+}  // namespace Test
@@ -0,0 +1,53 @@
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/binary_generator.h"
+#include "ir/binary_loader.h"
+#include "ir/ir.h"
+
+namespace Test {
+
+class BinaryIR : public P4CTest { };
+
+TEST_F(BinaryIR, RoundTrip) {
+    auto *a = new IR::PathExpression("a");
+    auto *bit8 = new IR::Type_Bits(8, false);
+    auto *fields = new IR::IndexedVector<IR::StructField>;
+    fields->push_back(new IR::StructField("f", bit8));
+    fields->push_back(new IR::StructField("g", bit8));
+    auto *st = new IR::Type_Struct("s", *fields);
+    auto *root = new IR::Vector<IR::Node>({ st, new IR::Add(a, new IR::Member(a, "f")), a });
+
+    std::stringstream file;
+    BinaryGenerator().write(root, file);
+    BinaryLoader loader(file);
+    ASSERT_TRUE(loader.valid());
+
+    auto *copy = loader.root<IR::Vector<IR::Node>>();
+    ASSERT_NE(copy, nullptr);
+    EXPECT_TRUE(copy->equiv(*root));
+    ASSERT_EQ(copy->size(), 3u);
+    auto *st2 = copy->at(0)->to<IR::Type_Struct>();
+    ASSERT_NE(st2, nullptr);
+    EXPECT_EQ(st2->name, "s");
+    EXPECT_NE(st2->fields.getDeclaration("g"), nullptr);
+    EXPECT_EQ(st2->fields.at(0)->type, st2->fields.at(1)->type);
+    auto *add = copy->at(1)->to<IR::Add>();
+    ASSERT_NE(add, nullptr);
+    EXPECT_EQ(add->left, copy->at(2));
+    EXPECT_EQ(add->right->to<IR::Member>()->expr, copy->at(2));
+}
+
+TEST_F(BinaryIR, Reject) {
+    std::stringstream file;
+    BinaryGenerator().write(new IR::PathExpression("a"), file);
+    std::string bad = file.str();
+    bad[0] = 'X';
+    std::stringstream badFile(bad);
+    BinaryLoader loader(badFile);
+    EXPECT_FALSE(loader.valid());
+    EXPECT_EQ(loader.root(), nullptr);
+}
+
+}  // namespace Test
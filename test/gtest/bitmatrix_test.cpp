@@ -0,0 +1,100 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ltbitmatrix.h"
+#include "lib/symbitmatrix.h"
+#include "lib/thread_pool.h"
+
+namespace Test {
+
+namespace {
+
+/* edges of a pseudo-random graph on n nodes, and their closure by Warshall's algorithm */
+std::vector<std::vector<bool>> graph(unsigned n, unsigned density, bool lower) {
+    std::vector<std::vector<bool>> rv(n, std::vector<bool>(n));
+    unsigned seed = 12345;
+    for (unsigned r = 0; r < n; r++)
+        for (unsigned c = 0; c <= r; c++) {
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 16) % 1000 < density) {
+                rv[r][c] = true;
+                if (!lower) rv[c][r] = true; } }
+    return rv;
+}
+
+std::vector<std::vector<bool>> closure(std::vector<std::vector<bool>> m) {
+    for (unsigned k = 0; k < m.size(); k++)
+        for (unsigned i = 0; i < m.size(); i++)
+            if (m[i][k])
+                for (unsigned j = 0; j < m.size(); j++)
+                    if (m[k][j]) m[i][j] = true;
+    return m;
+}
+
+}  // namespace
+
+TEST(LTBitMatrix, TransitiveClosure) {
+    for (unsigned threads : { 1, 4 }) {
+        Util::ThreadPool::setThreads(threads);
+        for (unsigned density : { 2, 30 }) {
+            const unsigned n = 600;  // more than one block
+            auto edges = graph(n, density, true);
+            LTBitMatrix m;
+            for (unsigned r = 0; r < n; r++)
+                for (unsigned c = 0; c <= r; c++)
+                    if (edges[r][c]) m(r, c) = 1;
+            m(n-1, 0) = 1;
+            edges[n-1][0] = true;
+            m.transitive_closure();
+            auto expect = closure(edges);
+            for (unsigned r = 0; r < n; r++)
+                for (unsigned c = 0; c <= r; c++)
+                    ASSERT_EQ(m(r, c), expect[r][c]) << r << ", " << c; } }
+    Util::ThreadPool::setThreads(1);
+}
+
+TEST(LTBitMatrix, RowOps) {
+    LTBitMatrix m;
+    m[5] |= bitvec(0, 10);      // only bits up to the diagonal are set
+    EXPECT_EQ(bitvec(m[5]), bitvec(0, 6));
+    EXPECT_FALSE(m(6, 0));
+    m[5] &= bitvec(2, 8);
+    EXPECT_EQ(bitvec(m[5]), bitvec(2, 4));
+    m[5] -= bitvec(3, 1);
+    EXPECT_EQ(bitvec(m[5]), bitvec(2, 1) | bitvec(4, 2));
+    m[200] |= m[5];
+    EXPECT_TRUE(m(200, 2));
+    EXPECT_TRUE(m(200, 5));
+    EXPECT_FALSE(m(200, 3));
+    EXPECT_TRUE(m(5, 5));
+}
+
+TEST(SymBitMatrix, TransitiveClosure) {
+    const unsigned n = 300;
+    auto edges = graph(n, 3, false);
+    SymBitMatrix m;
+    for (unsigned r = 0; r < n; r++)
+        for (unsigned c = 0; c <= r; c++)
+            if (edges[r][c]) m(r, c) = 1;
+    m(n-1, n-1) = 1;
+    edges[n-1][n-1] = true;
+    m.transitive_closure();
+    auto expect = closure(edges);
+    for (unsigned r = 0; r < n; r++)
+        for (unsigned c = 0; c < n; c++)
+            ASSERT_EQ(m(r, c), expect[r][c]) << r << ", " << c;
+}
+
+TEST(SymBitMatrix, RowOps) {
+    SymBitMatrix m;
+    m[3] |= bitvec(0, 8);
+    EXPECT_TRUE(m(3, 0));
+    EXPECT_TRUE(m(7, 3));
+    EXPECT_EQ(bitvec(m[3]), bitvec(0, 8));
+    m[3] &= bitvec(1, 5);
+    EXPECT_EQ(bitvec(m[3]), bitvec(1, 5));
+    EXPECT_FALSE(m(7, 3));
+    EXPECT_TRUE(m(5, 3));
+}
+
+}  // namespace Test
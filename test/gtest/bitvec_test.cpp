@@ -16,6 +16,8 @@ limitations under the License.
 */
 
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "lib/bitvec.h"
 
@@ -91,6 +93,11 @@ TEST(Bitvec, getslice) {
     EXPECT_EQ(slice.ffs(32), 64);
     EXPECT_EQ(slice.ffz(64), 80u);
     EXPECT_EQ(slice.ffs(80), 96);
+
+    // an unaligned slice whose last word takes bits from one word further on
+    bitvec wide;
+    wide.setbit(6408);
+    EXPECT_EQ(wide.getslice(6328, 113), bitvec(80, 1));
 }
 
 TEST(Bitvec, rotate) {
@@ -141,4 +148,95 @@ TEST(Bitvec, io) {
     EXPECT_EQ(a, b);
 }
 
+TEST(Bitvec, wide) {
+    // wide enough for the vectorized kernels, with lengths that leave partial vectors
+    for (int bits : { 600, 1000, 2411 }) {
+        std::vector<bool> ra(bits), rb(bits);
+        bitvec a, b;
+        for (int i = 0; i < bits; i++) {
+            if ((i * 7919) % 13 < 5) { ra[i] = true; a.setbit(i); }
+            if ((i * 104729) % 11 < 3) { rb[i] = true; b.setbit(i); } }
+        int pop = 0;
+        for (int i = 0; i < bits; i++) pop += ra[i];
+        EXPECT_EQ(a.popcount(), pop);
+        EXPECT_TRUE(a.intersects(b));
+        EXPECT_FALSE(a == b);
+        bitvec c(a);
+        EXPECT_TRUE(c == a);
+        c[bits - 1] = !ra[bits - 1];
+        EXPECT_NE(c, a);
+        c[bits - 1] = ra[bits - 1];
+        EXPECT_EQ(c, a);
+        c.setbit(bits + 500);
+        EXPECT_NE(c, a);
+        EXPECT_NE(a, c);
+
+        bitvec o(a), n(a), d(a);
+        EXPECT_TRUE(o |= b);
+        EXPECT_FALSE(o |= b);
+        EXPECT_TRUE(n &= b);
+        EXPECT_FALSE(n &= b);
+        EXPECT_TRUE(d -= b);
+        EXPECT_FALSE(d -= b);
+        EXPECT_FALSE(d.intersects(b));
+        for (int i = 0; i < bits; i++) {
+            EXPECT_EQ(o[i], ra[i] || rb[i]);
+            EXPECT_EQ(n[i], ra[i] && rb[i]);
+            EXPECT_EQ(d[i], ra[i] && !rb[i]); } }
+
+    bitvec sparse;
+    sparse.setbit(3000);
+    EXPECT_FALSE(sparse.empty());
+    EXPECT_EQ(sparse.ffs(), 3000);
+    EXPECT_EQ(sparse.ffs(70), 3000);
+    EXPECT_EQ(sparse.ffs(3001), -1);
+    EXPECT_EQ(sparse.popcount(), 1);
+    sparse.clrbit(3000);
+    EXPECT_TRUE(sparse.empty());
+    EXPECT_EQ(sparse.ffs(), -1);
+}
+
+TEST(Bitvec, InlineAndHeap) {
+    // up to 256 bits are inline; mix the two representations in each operation
+    for (int abits : { 3, 64, 65, 200, 256, 257, 700 }) {
+        for (int bbits : { 1, 128, 256, 300 }) {
+            bitvec a, b;
+            std::vector<bool> ra(abits), rb(bbits);
+            for (int i = 0; i < abits; i += 3) { a.setbit(i); ra[i] = true; }
+            for (int i = 1; i < bbits; i += 2) { b.setbit(i); rb[i] = true; }
+            auto bit = [](const std::vector<bool> &r, int i) {
+                return i < static_cast<int>(r.size()) && r[i]; };
+            bitvec o = a | b, n = a & b, x = a ^ b, d = a - b;
+            bool meet = false, subset = true;
+            for (int i = 0; i < 800; i++) {
+                EXPECT_EQ(o[i], bit(ra, i) || bit(rb, i));
+                EXPECT_EQ(n[i], bit(ra, i) && bit(rb, i));
+                EXPECT_EQ(x[i], bit(ra, i) != bit(rb, i));
+                EXPECT_EQ(d[i], bit(ra, i) && !bit(rb, i));
+                meet |= bit(ra, i) && bit(rb, i);
+                subset &= !bit(rb, i) || bit(ra, i); }
+            EXPECT_EQ(a.intersects(b), meet);
+            EXPECT_EQ(a.contains(b), subset);
+            EXPECT_EQ(o.contains(a), true);
+            EXPECT_EQ(a == b, false);
+            EXPECT_EQ(n.popcount() + x.popcount(), o.popcount());
+
+            bitvec copy(a), moved(std::move(copy));
+            EXPECT_EQ(moved, a);
+            EXPECT_TRUE(copy.empty());
+            copy = b;
+            EXPECT_EQ(copy, b);
+            copy = std::move(moved);
+            EXPECT_EQ(copy, a); } }
+
+    bitvec wide(0, 1);
+    wide <<= 600;
+    EXPECT_EQ(wide.ffs(), 600);
+    wide >>= 590;
+    EXPECT_EQ(wide, bitvec(1 << 10));
+    wide.setbit(255);
+    EXPECT_EQ(wide.getslice(250, 10), bitvec(1 << 5));
+    EXPECT_EQ(wide.getrange(8, 4), 4U);
+}
+
 }  // namespace Test
@@ -0,0 +1,194 @@
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "backends/bmv2/common/controlFlowGraph.h"
+#include "frontends/p4/typeMap.h"
+
+namespace Test {
+
+namespace {
+
+using BMV2::CFG;
+
+/// A control-flow graph built edge by edge, as CFG::build would for the nested
+/// if statements in each test.
+class TestCFG {
+    P4::TypeMap typeMap;
+
+ public:
+    CFG cfg;
+
+    TestCFG() {
+        cfg.entryPoint = cfg.makeNode("c.entry");
+        cfg.exitPoint = cfg.makeNode("");
+    }
+    CFG::Node *entry() { return cfg.entryPoint; }
+    CFG::Node *exit() { return cfg.exitPoint; }
+    /// An If node testing h.@header.isValid(), or calling e.@header() if @call.
+    CFG::IfNode *makeIf(cstring header, bool call = false) {
+        auto method = call ? new IR::Member(new IR::PathExpression("e"), header)
+                           : new IR::Member(new IR::PathExpression(header),
+                                            IR::Type_Header::isValid);
+        auto statement = new IR::IfStatement(new IR::MethodCallExpression(method),
+                                             new IR::EmptyStatement(), nullptr);
+        return cfg.makeNode(statement)->to<CFG::IfNode>();
+    }
+    /// A node standing for a table.
+    CFG::Node *makeTable(cstring name) { return cfg.makeNode(name); }
+    void edge(CFG::Node *from, CFG::Node *to) {
+        to->addPredecessors(new CFG::EdgeSet(new CFG::Edge(from))); }
+    void edge(CFG::Node *from, CFG::Node *to, bool value) {
+        to->addPredecessors(new CFG::EdgeSet(new CFG::Edge(from, value))); }
+
+    void simplify() {
+        cfg.computeSuccessors();
+        cfg.simplify(&typeMap);
+    }
+    unsigned ifNodes() const {
+        unsigned count = 0;
+        for (auto n : cfg.allNodes)
+            if (n->is<CFG::IfNode>()) count++;
+        return count;
+    }
+    bool hasType(const IR::Expression *e) const { return typeMap.getType(e) != nullptr; }
+};
+
+/// The node that the edge of @node taken when its condition is @value leads to.
+CFG::Node *successor(CFG::Node *node, bool value) {
+    for (auto e : node->successors.edges)
+        if (e->isBool() && e->getBool() == value)
+            return e->endpoint;
+    return nullptr;
+}
+
+}  // namespace
+
+// if (h.a.isValid()) { if (h.b.isValid()) { t.apply(); } }
+TEST(Bmv2CFG, FoldsNestedIfIntoAnd) {
+    TestCFG g;
+    auto a = g.makeIf("a"), b = g.makeIf("b");
+    auto t = g.makeTable("t");
+    g.edge(g.entry(), a);
+    g.edge(a, b, true);
+    g.edge(a, g.exit(), false);
+    g.edge(b, t, true);
+    g.edge(b, g.exit(), false);
+    g.edge(t, g.exit());
+    auto condA = a->condition, condB = b->condition;
+    g.simplify();
+
+    EXPECT_EQ(g.ifNodes(), 1u);
+    EXPECT_EQ(g.cfg.allNodes.count(b), 0u);
+    auto cond = a->condition->to<IR::LAnd>();
+    ASSERT_TRUE(cond != nullptr);
+    EXPECT_EQ(cond->left, condA);
+    EXPECT_EQ(cond->right, condB);
+    EXPECT_TRUE(g.hasType(cond));
+    EXPECT_EQ(successor(a, true), t);
+    EXPECT_EQ(successor(a, false), g.exit());
+}
+
+// if (!h.a.isValid()) { if (!h.b.isValid()) { t.apply(); } }, where the frontend has
+// swapped the branches to test h.a.isValid() and h.b.isValid()
+TEST(Bmv2CFG, FoldsNestedElseIntoOr) {
+    TestCFG g;
+    auto a = g.makeIf("a"), b = g.makeIf("b");
+    auto t = g.makeTable("t");
+    g.edge(g.entry(), a);
+    g.edge(a, g.exit(), true);
+    g.edge(a, b, false);
+    g.edge(b, g.exit(), true);
+    g.edge(b, t, false);
+    g.edge(t, g.exit());
+    g.simplify();
+
+    EXPECT_EQ(g.ifNodes(), 1u);
+    ASSERT_TRUE(a->condition->is<IR::LOr>());
+    EXPECT_EQ(successor(a, true), g.exit());
+    EXPECT_EQ(successor(a, false), t);
+}
+
+// if (h.a.isValid()) { if (h.b.isValid()) { if (h.c.isValid()) { t.apply(); } } }
+TEST(Bmv2CFG, FoldsThreeLevels) {
+    TestCFG g;
+    auto a = g.makeIf("a"), b = g.makeIf("b"), c = g.makeIf("c");
+    auto t = g.makeTable("t");
+    g.edge(g.entry(), a);
+    g.edge(a, b, true);
+    g.edge(a, g.exit(), false);
+    g.edge(b, c, true);
+    g.edge(b, g.exit(), false);
+    g.edge(c, t, true);
+    g.edge(c, g.exit(), false);
+    g.edge(t, g.exit());
+    g.simplify();
+
+    EXPECT_EQ(g.ifNodes(), 1u);
+    auto cond = a->condition->to<IR::LAnd>();
+    ASSERT_TRUE(cond != nullptr);
+    EXPECT_TRUE(cond->left->is<IR::LAnd>());
+    EXPECT_EQ(successor(a, true), t);
+}
+
+// b is reached both from a and from p, so folding it into a would change the path
+// from p:
+//     if (h.p.isValid()) { if (h.a.isValid()) { B } } else { B }
+// with B = if (h.b.isValid()) { t.apply(); }
+TEST(Bmv2CFG, InnerIfWithSeveralPredecessorsNotFolded) {
+    TestCFG g;
+    auto p = g.makeIf("p"), a = g.makeIf("a"), b = g.makeIf("b");
+    auto t = g.makeTable("t");
+    g.edge(g.entry(), p);
+    g.edge(p, a, true);
+    g.edge(p, b, false);
+    g.edge(a, b, true);
+    g.edge(a, g.exit(), false);
+    g.edge(b, t, true);
+    g.edge(b, g.exit(), false);
+    g.edge(t, g.exit());
+    auto condA = a->condition;
+    g.simplify();
+
+    EXPECT_EQ(g.ifNodes(), 3u);
+    EXPECT_EQ(a->condition, condA);
+    EXPECT_EQ(successor(a, true), b);
+    EXPECT_EQ(successor(p, false), b);
+}
+
+// if (h.a.isValid()) { if (e.check()) { t.apply(); } }
+TEST(Bmv2CFG, InnerIfWithMethodCallNotFolded) {
+    TestCFG g;
+    auto a = g.makeIf("a"), b = g.makeIf("check", true);
+    auto t = g.makeTable("t");
+    g.edge(g.entry(), a);
+    g.edge(a, b, true);
+    g.edge(a, g.exit(), false);
+    g.edge(b, t, true);
+    g.edge(b, g.exit(), false);
+    g.edge(t, g.exit());
+    auto condA = a->condition;
+    g.simplify();
+
+    EXPECT_EQ(g.ifNodes(), 2u);
+    EXPECT_EQ(a->condition, condA);
+    EXPECT_EQ(successor(a, true), b);
+}
+
+// if (h.a.isValid()) {} t.apply(); loses the if, but if (e.check()) {} must call check
+TEST(Bmv2CFG, PassThroughRemovedUnlessMethodCall) {
+    for (bool call : { false, true }) {
+        TestCFG g;
+        auto a = g.makeIf(call ? "check" : "a", call);
+        auto t = g.makeTable("t");
+        g.edge(g.entry(), a);
+        g.edge(a, t, true);
+        g.edge(a, t, false);
+        g.edge(t, g.exit());
+        g.simplify();
+
+        EXPECT_EQ(g.ifNodes(), call ? 1u : 0u);
+        auto start = (*g.entry()->successors.edges.begin())->endpoint;
+        EXPECT_EQ(start, call ? static_cast<CFG::Node *>(a) : t);
+    }
+}
+
+}  // namespace Test
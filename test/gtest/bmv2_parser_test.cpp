@@ -0,0 +1,106 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "backends/bmv2/common/parser.h"
+#include "lib/json.h"
+
+namespace Test {
+
+namespace {
+
+class DeadSets : public BMV2::ParserConverter {
+ public:
+    DeadSets() : ParserConverter(nullptr) {}
+    using ParserConverter::removeDeadSets;
+};
+
+Util::JsonObject *ref(cstring type, Util::IJson *value) {
+    return (new Util::JsonObject())->emplace("type", type)->emplace("value", value);
+}
+
+Util::JsonObject *field(cstring header, cstring name) {
+    return ref("field", (new Util::JsonArray())->append(header)->append(name));
+}
+
+/// hs.last.f
+Util::JsonObject *stackField(cstring stack, cstring name) {
+    return ref("stack_field", (new Util::JsonArray())->append(stack)->append(name));
+}
+
+Util::JsonObject *constant(int value) {
+    return ref("hexstr", new Util::JsonValue(cstring("0x0" + std::to_string(value))));
+}
+
+Util::JsonObject *add(Util::IJson *left, Util::IJson *right) {
+    auto op = (new Util::JsonObject())->emplace("op", "+")->emplace("left", left)
+            ->emplace("right", right);
+    return ref("expression", op);
+}
+
+Util::IJson *set(Util::IJson *left, Util::IJson *right) {
+    return (new Util::JsonObject())->emplace("op", "set")
+            ->emplace("parameters", (new Util::JsonArray())->append(left)->append(right));
+}
+
+Util::IJson *extract(cstring header) {
+    auto parameter = ref("regular", new Util::JsonValue(header));
+    return (new Util::JsonObject())->emplace("op", "extract")
+            ->emplace("parameters", (new Util::JsonArray())->append(parameter));
+}
+
+std::vector<Util::IJson *> removeDeadSets(std::vector<Util::IJson *> ops) {
+    DeadSets().removeDeadSets(ops);
+    return ops;
+}
+
+}  // namespace
+
+// h.f = 1; h.f = 2; leaves h.f = 2
+TEST(Bmv2ParserDeadSets, OverwrittenSetRemoved) {
+    auto first = set(field("h", "f"), constant(1));
+    auto second = set(field("h", "f"), constant(2));
+    auto other = set(field("h", "g"), constant(3));
+    EXPECT_EQ(removeDeadSets({ first, other, second }),
+              (std::vector<Util::IJson *>{ other, second }));
+}
+
+TEST(Bmv2ParserDeadSets, SetReadBeforeOverwriteKept) {
+    // h.f = 1; h.g = h.f; h.f = 2;
+    std::vector<Util::IJson *> ops = {
+        set(field("h", "f"), constant(1)),
+        set(field("h", "g"), field("h", "f")),
+        set(field("h", "f"), constant(2)) };
+    EXPECT_EQ(removeDeadSets(ops), ops);
+    // h.f = 1; h.f = h.f + 1;
+    ops = { set(field("h", "f"), constant(1)),
+            set(field("h", "f"), add(field("h", "f"), constant(1))) };
+    EXPECT_EQ(removeDeadSets(ops), ops);
+    // an extract ends the run of sets: h.f = 1; pkt.extract(h2); h.f = 2;
+    ops = { set(field("h", "f"), constant(1)), extract("h2"),
+            set(field("h", "f"), constant(2)) };
+    EXPECT_EQ(removeDeadSets(ops), ops);
+}
+
+// hs[0].f = 1; hs[0].f = hs.last.f + 1; keeps the first set, which hs.last.f may read
+TEST(Bmv2ParserDeadSets, StackElementReadThroughStack) {
+    std::vector<Util::IJson *> ops = {
+        set(field("hs[0]", "f"), constant(1)),
+        set(field("hs[0]", "f"), add(stackField("hs", "f"), constant(1))) };
+    EXPECT_EQ(removeDeadSets(ops), ops);
+    // or through the stack as a whole, or another element
+    ops = { set(field("hs[0]", "f"), constant(1)),
+            set(field("hs[0]", "f"), ref("header_stack", new Util::JsonValue("hs"))) };
+    EXPECT_EQ(removeDeadSets(ops), ops);
+    ops = { set(field("hs[0]", "f"), constant(1)),
+            set(field("hs[1]", "g"), field("hs[1]", "f")),
+            set(field("hs[0]", "f"), constant(2)) };
+    EXPECT_EQ(removeDeadSets(ops), ops);
+    // a set that nothing can read is still removed
+    auto dead = set(field("hs[0]", "f"), constant(1));
+    auto other = set(field("hs2[0]", "f"), stackField("hs2", "f"));
+    auto last = set(field("hs[0]", "f"), constant(2));
+    EXPECT_EQ(removeDeadSets({ dead, other, last }),
+              (std::vector<Util::IJson *>{ other, last }));
+}
+
+}  // namespace Test
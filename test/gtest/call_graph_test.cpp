@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <set>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -52,4 +53,58 @@ TEST(CallGraph, Acyclic) {
     EXPECT_EQ('a', sorted.at(2));
 }
 
+TEST(CallGraph, Compact) {
+    P4::CallGraph<char> graph("graph");
+    // a->b->c->b, c->d, a->e->e; f is not called by anyone
+    graph.calls('a', 'b');
+    graph.calls('b', 'c');
+    graph.calls('c', 'b');
+    graph.calls('c', 'd');
+    graph.calls('a', 'e');
+    graph.calls('e', 'e');
+    graph.add('f');
+
+    P4::CompactCallGraph<char> compact(graph);
+    EXPECT_EQ(6u, compact.size());
+    EXPECT_EQ(5u, compact.componentCount());
+    EXPECT_TRUE(compact.sameComponent('b', 'c'));
+    EXPECT_FALSE(compact.sameComponent('a', 'b'));
+    EXPECT_TRUE(compact.inCycle('b'));
+    EXPECT_TRUE(compact.inCycle('e'));
+    EXPECT_FALSE(compact.inCycle('a'));
+    EXPECT_FALSE(compact.inCycle('d'));
+
+    EXPECT_TRUE(compact.reachable('a', 'd'));
+    EXPECT_TRUE(compact.reachable('c', 'b'));
+    EXPECT_TRUE(compact.reachable('f', 'f'));
+    EXPECT_FALSE(compact.reachable('d', 'c'));
+    EXPECT_FALSE(compact.reachable('b', 'e'));
+    for (char n = 'a'; n <= 'f'; n++) {
+        std::set<char> expected, actual;
+        graph.reachable(n, expected);
+        compact.reachable(n, actual);
+        EXPECT_EQ(expected, actual) << n;
+    }
+
+    std::vector<char> expected, actual;
+    EXPECT_EQ(graph.sort(expected), compact.sort(actual));
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(CallGraph, CompactAcyclic) {
+    // a long chain is handled without recursion
+    P4::CallGraph<int> chain("chain");
+    for (int i = 0; i < 10000; i++)
+        chain.calls(i, i + 1);
+    P4::CompactCallGraph<int> compact(chain);
+    EXPECT_FALSE(compact.hasCycles());
+    EXPECT_TRUE(compact.reachable(0, 10000));
+    EXPECT_FALSE(compact.reachable(10000, 0));
+    std::vector<int> sorted;
+    EXPECT_FALSE(compact.sort(sorted));
+    EXPECT_EQ(10001u, sorted.size());
+    EXPECT_EQ(10000, sorted.front());
+    EXPECT_EQ(0, sorted.back());
+}
+
 }  // namespace Test
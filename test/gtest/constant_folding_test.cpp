@@ -0,0 +1,47 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/constantFolding.h"
+
+namespace Test {
+
+class ConstantFoldingTest : public P4CTest {
+ protected:
+    static const IR::Node* fold(const IR::Node* node) {
+        return node->apply(P4::DoConstantFolding(nullptr, nullptr));
+    }
+};
+
+TEST_F(ConstantFoldingTest, Binary) {
+    auto b8 = IR::Type_Bits::get(8);
+    // the untyped operand takes the type of the other one
+    auto cst = fold(new IR::Add(new IR::Constant(b8, 3), new IR::Constant(4)))
+            ->to<IR::Constant>();
+    ASSERT_NE(cst, nullptr);
+    EXPECT_EQ(cst->value, 7);
+    EXPECT_TRUE(cst->type->equiv(*b8));
+    cst = fold(new IR::Sub(new IR::Constant(255), new IR::Constant(b8, 1)))->to<IR::Constant>();
+    ASSERT_NE(cst, nullptr);
+    EXPECT_EQ(cst->value, 254);
+    EXPECT_TRUE(cst->type->equiv(*b8));
+    auto lit = fold(new IR::Lss(new IR::Constant(b8, 1), new IR::Constant(2)))
+            ->to<IR::BoolLiteral>();
+    ASSERT_NE(lit, nullptr);
+    EXPECT_TRUE(lit->value);
+    EXPECT_EQ(0u, ::errorCount());
+}
+
+TEST_F(ConstantFoldingTest, Unchanged) {
+    auto b8 = IR::Type_Bits::get(8);
+    // nothing to fold: the original expression is returned, not a copy
+    auto sum = new IR::Add(new IR::PathExpression("x"),
+                           new IR::Mul(new IR::PathExpression("y"), new IR::Constant(b8, 2)));
+    EXPECT_EQ(fold(sum), sum);
+    // casts of constants to other types are values, but are not folded
+    auto cmp = new IR::Equ(new IR::Cast(new IR::Type_Name("N"), new IR::Constant(b8, 1)),
+                           new IR::Cast(new IR::Type_Name("N"), new IR::Constant(b8, 2)));
+    EXPECT_EQ(fold(cmp), cmp);
+    EXPECT_EQ(0u, ::errorCount());
+}
+
+}  // namespace Test
@@ -0,0 +1,63 @@
+#include <map>
+
+#include "gtest/gtest.h"
+#include "lib/cow_map.h"
+
+namespace Test {
+
+TEST(CowMap, LikeStdMap) {
+    cow_map<int, int> cm;
+    std::map<int, int> sm;
+    for (int i = 0; i < 1000; ++i) {
+        int k = (i * 389) % 1000;
+        EXPECT_EQ(cm.emplace(k, i).second, sm.emplace(k, i).second); }
+    for (int k = 0; k < 1000; k += 3) EXPECT_EQ(cm.erase(k), sm.erase(k));
+    EXPECT_EQ(cm.erase(0), 0u);
+    for (int k = 1; k < 1000; k += 7) {
+        cm[k] += 5;
+        sm[k] += 5; }
+    ASSERT_EQ(cm.size(), sm.size());
+    auto it = cm.begin();
+    for (auto &kv : sm) {
+        ASSERT_NE(it, cm.end());
+        EXPECT_EQ(it->first, kv.first);
+        EXPECT_EQ(it->second, kv.second);
+        ++it; }
+    EXPECT_EQ(it, cm.end());
+    for (int k = -1; k <= 1000; ++k) {
+        EXPECT_EQ(cm.count(k), sm.count(k));
+        auto ub = sm.upper_bound(k);
+        if (ub == sm.end())
+            EXPECT_EQ(cm.upper_bound(k), cm.end());
+        else
+            EXPECT_EQ(cm.upper_bound(k)->first, ub->first); }
+}
+
+TEST(CowMap, CopiesAreIndependent) {
+    cow_map<int, int> a;
+    for (int i = 0; i < 500; ++i) a[i] = i;
+    cow_map<int, int> b(a);
+    EXPECT_TRUE(a == b);
+    *b.modify(10) = -10;
+    b.erase(20);
+    b[1000] = 1000;
+    EXPECT_EQ(*a.getref(10), 10);
+    EXPECT_EQ(a.count(20), 1u);
+    EXPECT_EQ(a.count(1000), 0u);
+    EXPECT_EQ(*b.getref(10), -10);
+    EXPECT_EQ(b.count(20), 0u);
+    EXPECT_EQ(b.size(), 500u);
+    EXPECT_TRUE(a != b);
+
+    // only the entries in chunks that b changed are visited
+    int visited = 0;
+    bool saw10 = false;
+    a.for_each_unshared(b, [&](cow_map<int, int>::const_iterator it) {
+        ++visited;
+        if (it->first == 10) saw10 = true; });
+    EXPECT_TRUE(saw10);
+    EXPECT_GT(visited, 0);
+    EXPECT_LT(visited, 500 / 2);
+}
+
+}  // namespace Test
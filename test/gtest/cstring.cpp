@@ -14,8 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <set>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "lib/cstring.h"
+#include "lib/thread_pool.h"
 
 namespace Test {
 
@@ -110,4 +115,82 @@ TEST(cstring, replace) {
     EXPECT_EQ(c.replace("i", ""), "Orgnal");
 }
 
+TEST(cstring, intern_concurrently) {
+    // every thread interns the same strings, and must get the same pointers
+    const size_t count = 2000;
+    std::vector<std::vector<const char *>> seen(8);
+    Util::ThreadPool pool(4);
+    pool.parallel_for(seen.size(), [&](size_t t) {
+        for (size_t i = 0; i < count; ++i) {
+            std::string s = "interned_string_" + std::to_string((i * 7 + t) % count);
+            seen[t].push_back(cstring(s).c_str()); } });
+    for (size_t t = 0; t < seen.size(); ++t) {
+        for (size_t i = 0; i < count; ++i) {
+            cstring expect = "interned_string_" + std::to_string((i * 7 + t) % count);
+            EXPECT_EQ(seen[t][i], expect.c_str()); } }
+    EXPECT_EQ(cstring("ab").c_str(), cstring(std::string("ab")).c_str());
+}
+
+TEST(cstring, hash_and_size) {
+    cstring a = "some_name";
+    cstring b = cstring::literal("some_name");
+    std::string c = "some_";
+    cstring d = c + "name";
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a, d);
+    EXPECT_EQ(a.hash(), d.hash());
+    EXPECT_NE(a.hash(), cstring("some_other_name").hash());
+    EXPECT_EQ(a.size(), 9u);
+    EXPECT_EQ(cstring::empty.size(), 0u);
+    EXPECT_EQ(cstring().size(), 0u);
+    EXPECT_EQ(cstring().hash(), 0u);
+    EXPECT_EQ(std::hash<cstring>()(a), a.hash());
+    EXPECT_FALSE(cstring_identity_less()(a, d));
+    EXPECT_FALSE(cstring_identity_less()(d, a));
+    EXPECT_EQ(cstring_identity_hash()(a), cstring_identity_hash()(d));
+}
+
+TEST(cstring, make_unique) {
+    std::set<cstring> inuse = { "tmp", "tmp_0", "tmp_2", "x" };
+    EXPECT_EQ(cstring::make_unique(inuse, "tmp", '_'), "tmp_1");
+    EXPECT_EQ(cstring::make_unique(inuse, "y", '_'), "y");
+
+    // resuming from a counter gives the same names as searching from the start
+    int counter = 0;
+    for (auto expect : { "tmp_1", "tmp_3", "tmp_4" }) {
+        cstring name = cstring::make_unique(inuse, "tmp", counter, '_');
+        EXPECT_EQ(name, cstring::make_unique(inuse, "tmp", '_'));
+        EXPECT_EQ(name, expect);
+        inuse.insert(name); }
+    counter = 0;
+    EXPECT_EQ(cstring::make_unique(inuse, "x", counter), "x.0");
+    EXPECT_EQ(counter, 1);
+
+    // the candidates looked at are not interned, only the name returned
+    size_t before, after;
+    cstring::cache_size(before);
+    EXPECT_EQ(cstring::make_unique(inuse, "tmp", '_'), "tmp_5");
+    cstring::cache_size(after);
+    EXPECT_LE(after, before + 1);
+}
+
+TEST(cstring, concat) {
+    cstring a = "concat_a";
+    std::string b = "b";
+    EXPECT_EQ(cstring::concat(a, '.', b, "_", 42, -1, 7u), "concat_a.b_42-17");
+    EXPECT_EQ(cstring::concat(), "");
+    EXPECT_EQ(cstring::concat(cstring(), static_cast<const char *>(nullptr)), "");
+    std::string big(1000, 'x');
+    EXPECT_EQ(cstring::concat(big, big), big + big);
+
+    // only the result is interned
+    size_t before, after;
+    cstring::cache_size(before);
+    cstring name = cstring::concat(a, "_never_interned_", 12345);
+    cstring::cache_size(after);
+    EXPECT_EQ(after, before + 1);
+    EXPECT_EQ(cstring::lookup(name.c_str(), name.size()), name);
+    EXPECT_TRUE(cstring::lookup("concat_never_seen", 17).isNull());
+}
+
 }  // namespace Test
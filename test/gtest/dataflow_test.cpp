@@ -0,0 +1,70 @@
+#include <map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/dataflow.h"
+
+namespace Test {
+
+namespace {
+
+/// Computes the set of nodes, as a bit mask, on some path from the entry to each node.
+class Predecessors : public Util::ForwardDataflow<int, unsigned> {
+    std::map<int, std::vector<int>> graph;
+
+    std::vector<int> successors(int node) override { return graph[node]; }
+    unsigned transfer(int node, const unsigned &in) override { return in | (1u << node); }
+    bool join(unsigned &into, const unsigned &from) override {
+        unsigned joined = into | from;
+        bool changed = joined != into;
+        into = joined;
+        return changed;
+    }
+
+ public:
+    void edge(int from, int to) { graph[from].push_back(to); }
+};
+
+}  // namespace
+
+TEST(ForwardDataflow, Acyclic) {
+    // 0 -> 1 -> 3, 0 -> 2 -> 3; the successors of 0 are listed in an order in which a
+    // FIFO worklist would visit 3 twice
+    Predecessors pred;
+    pred.edge(0, 1);
+    pred.edge(0, 2);
+    pred.edge(1, 3);
+    pred.edge(2, 1);
+    pred.edge(2, 3);
+    pred.solve(0, 0);
+    EXPECT_EQ(pred.visits(), 4u);
+    EXPECT_EQ(pred.order().front(), 0);
+    EXPECT_EQ(pred.order().back(), 3);
+    EXPECT_EQ(pred.in(3), 0x7u);
+    EXPECT_EQ(pred.in(1), 0x5u);
+    EXPECT_FALSE(pred.reached(4));
+}
+
+TEST(ForwardDataflow, Cycles) {
+    // 0 -> 1 -> 2 -> 3 with the back edges 2 -> 1 and 3 -> 0; 4 is not reachable
+    Predecessors pred;
+    pred.edge(0, 1);
+    pred.edge(1, 2);
+    pred.edge(2, 1);
+    pred.edge(2, 3);
+    pred.edge(3, 0);
+    pred.edge(4, 3);
+    pred.solve(0, 0);
+    for (int n = 0; n < 4; n++)
+        EXPECT_EQ(pred.in(n), 0xfu) << n;
+    EXPECT_FALSE(pred.reached(4));
+    // a few passes over the loops, not one per path
+    EXPECT_LE(pred.visits(), 12u);
+
+    // solving again starts from scratch
+    pred.solve(2, 0);
+    EXPECT_EQ(pred.order().front(), 2);
+    EXPECT_EQ(pred.in(2), 0xfu);
+}
+
+}  // namespace Test
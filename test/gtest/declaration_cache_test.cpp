@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/common/declarationCache.h"
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace Test {
+
+namespace {
+
+/// A program with a header and three controls, the last using the first; @a is the
+/// statement of the first control, and @padding goes before it all.
+std::string program(const std::string &a, const std::string &padding = "") {
+    return padding +
+           "header h_t { bit<8> f; }\n"
+           "control A(inout h_t h) { apply { " + a + " } }\n"
+           "control B(inout h_t h) { apply { h.f = 2; } }\n"
+           "control C(inout h_t h) { A() a; apply { a.apply(h); } }\n";
+}
+
+/// The keys of the declarations of @text, by name.
+std::map<cstring, cstring> keys(const std::string &text, const IR::P4Program **parsed = nullptr) {
+    auto *prog = P4::parseP4String(text, CompilerOptions::FrontendVersion::P4_16);
+    if (!prog) return {};
+    P4::ReferenceMap refMap;
+    prog->apply(P4::ResolveReferences(&refMap));
+    P4::DeclarationKeys declKeys(prog, &refMap, P4::CacheKeyHash().add("test"));
+    std::map<cstring, cstring> rv;
+    for (auto *decl : prog->objects)
+        rv[decl->to<IR::IDeclaration>()->getName().name] = declKeys.key(decl);
+    if (parsed) *parsed = prog;
+    return rv;
+}
+
+}  // namespace
+
+class DeclarationCacheTest : public P4CTest { };
+
+TEST_F(DeclarationCacheTest, Keys) {
+    const IR::P4Program *prog = nullptr;
+    auto before = keys(program("h.f = 1;"), &prog);
+    ASSERT_EQ(::errorCount(), 0u);
+    ASSERT_EQ(before.size(), 4u);
+
+    // C uses the header and A
+    P4::ReferenceMap refMap;
+    prog->apply(P4::ResolveReferences(&refMap));
+    P4::DeclarationKeys declKeys(prog, &refMap, P4::CacheKeyHash());
+    auto &deps = declKeys.dependencies(prog->objects.at(3));
+    ASSERT_EQ(deps.size(), 2u);
+    EXPECT_EQ(deps.at(0), prog->objects.at(0));
+    EXPECT_EQ(deps.at(1), prog->objects.at(1));
+    EXPECT_TRUE(declKeys.dependencies(prog->objects.at(0)).empty());
+    EXPECT_FALSE(declKeys.key(prog->objects.at(1)).isNullOrEmpty());
+    EXPECT_TRUE(declKeys.key(prog).isNullOrEmpty());
+
+    // moving everything changes no key
+    EXPECT_EQ(keys(program("h.f = 1;", "\n\n// moved\n")), before);
+
+    // changing A changes the keys of A and C, which uses it
+    auto after = keys(program("h.f = 3;"));
+    ASSERT_EQ(::errorCount(), 0u);
+    EXPECT_EQ(after["h_t"], before["h_t"]);
+    EXPECT_EQ(after["B"], before["B"]);
+    EXPECT_NE(after["A"], before["A"]);
+    EXPECT_NE(after["C"], before["C"]);
+
+    // the base key is part of every key
+    P4::DeclarationKeys other(prog, &refMap, P4::CacheKeyHash().add("other"));
+    EXPECT_NE(other.key(prog->objects.at(0)), declKeys.key(prog->objects.at(0)));
+}
+
+TEST_F(DeclarationCacheTest, StoreAndLookup) {
+    char name[] = "/tmp/p4c-declaration-cache-XXXXXX";
+    ASSERT_NE(mkdtemp(name), nullptr);
+    cstring dir = name;
+    auto *decl = new IR::Declaration_Constant("c", IR::Type_Bits::get(8), new IR::Constant(7));
+
+    EXPECT_EQ(P4::DeclarationCache::lookup(dir, "midend", "0123"), nullptr);
+    EXPECT_TRUE(P4::DeclarationCache::store(dir, "midend", "0123", decl));
+    auto *found = P4::DeclarationCache::lookup(dir, "midend", "0123");
+    ASSERT_NE(found, nullptr);
+    EXPECT_TRUE(found->equiv(*decl));
+    // each stage has its own entries
+    EXPECT_EQ(P4::DeclarationCache::lookup(dir, "backend", "0123"), nullptr);
+
+    unlink((dir + "/midend-0123.p4ir").c_str());
+    rmdir(dir.c_str());
+}
+
+}  // namespace Test
@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/p4/def_use.h"
+
+namespace Test {
+
+class DefUseTest : public P4CTest {
+ protected:
+    P4::StorageFactory factory;
+
+    /// Storage for a header with the fields f and g.
+    const P4::StructLocation* header(cstring name) {
+        auto type = new IR::Type_Header("H", {
+            new IR::StructField("f", IR::Type_Bits::get(8)),
+            new IR::StructField("g", IR::Type_Bits::get(16)) });
+        return factory.create(type, name)->to<P4::StructLocation>();
+    }
+    static const P4::BaseLocation* field(const P4::StorageLocation* loc, cstring name) {
+        auto set = P4::LocationSet(loc).getField(name);
+        return (*set->begin())->to<P4::BaseLocation>(); }
+};
+
+TEST_F(DefUseTest, LocationSets) {
+    auto h = header("h"), k = header("k");
+    // f, g and $valid of each header are numbered densely
+    EXPECT_EQ(factory.baseLocationCount(), 6u);
+    auto hf = field(h, "f"), kg = field(k, "g");
+    ASSERT_NE(hf, nullptr);
+    ASSERT_NE(kg, nullptr);
+    EXPECT_EQ(hf->index, 0u);
+    EXPECT_EQ(kg->index, 4u);
+
+    auto all = (new P4::LocationSet(h))->canonicalize();
+    EXPECT_TRUE(all->isCanonical());
+    EXPECT_EQ(all->canonicalize(), all);
+    EXPECT_TRUE(all->overlaps(new P4::LocationSet(hf)));
+    EXPECT_FALSE(all->overlaps(new P4::LocationSet(kg)));
+    // sets that are not canonical are compared element by element
+    P4::LocationSet mixed(k);
+    mixed.add(hf);
+    EXPECT_FALSE(mixed.isCanonical());
+    EXPECT_TRUE(mixed.overlaps(new P4::LocationSet(k)));
+    EXPECT_TRUE(mixed.overlaps(all));
+}
+
+TEST_F(DefUseTest, Definitions) {
+    auto h = header("h");
+    auto hf = field(h, "f");
+    auto start = new P4::ProgramPoints(P4::ProgramPoint::beforeStart);
+    P4::Definitions defs;
+    EXPECT_TRUE(defs.empty());
+    defs.setDefinition(h, start);
+    EXPECT_FALSE(defs.empty());
+    EXPECT_TRUE(defs.hasLocation(hf));
+
+    auto statement = new IR::EmptyStatement();
+    auto written = defs.writes(P4::ProgramPoint(statement), new P4::LocationSet(hf));
+    EXPECT_FALSE(*written == defs);
+    EXPECT_EQ(written->getPoints(hf)->size(), 1u);
+    EXPECT_FALSE(written->getPoints(hf)->containsBeforeStart());
+
+    // the join has both definitions of h.f, and shares the points of the other fields
+    auto joined = written->joinDefinitions(&defs);
+    EXPECT_EQ(joined->getPoints(hf)->size(), 2u);
+    EXPECT_EQ(joined->getPoints(field(h, "g")), start);
+    EXPECT_EQ(joined->getPoints(new P4::LocationSet(h))->size(), 2u);
+    EXPECT_TRUE(*defs.joinDefinitions(&defs) == defs);
+
+    joined->removeLocation(h);
+    EXPECT_TRUE(joined->empty());
+    EXPECT_FALSE(joined->hasLocation(hf));
+}
+
+}  // namespace Test
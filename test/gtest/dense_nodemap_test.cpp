@@ -0,0 +1,62 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+
+TEST(IR, DenseNodeMap) {
+    IR::DenseNodeMap<int> map;
+    std::vector<const IR::Node *> nodes;
+    for (int i = 0; i < 3000; ++i) nodes.push_back(new IR::Constant(i));
+    for (int i = 0; i < 3000; i += 2)
+        EXPECT_TRUE(map.emplace(nodes[i], i).second);
+    EXPECT_FALSE(map.emplace(nodes[0], 42).second);
+    EXPECT_EQ(map.size(), 1500u);
+    for (int i = 0; i < 3000; ++i) {
+        EXPECT_EQ(map.count(nodes[i]), i % 2 ? 0u : 1u);
+        EXPECT_EQ(map.get(nodes[i], -1), i % 2 ? -1 : i); }
+
+    // iteration is in insertion order
+    int next = 0;
+    for (auto &e : map) {
+        EXPECT_EQ(e.first, nodes[next]);
+        EXPECT_EQ(e.second, next);
+        next += 2; }
+
+    for (int i = 0; i < 3000; i += 4) EXPECT_EQ(map.erase(nodes[i]), 1u);
+    EXPECT_EQ(map.erase(nodes[1]), 0u);
+    EXPECT_EQ(map.size(), 750u);
+    size_t seen = 0;
+    for (auto &e : map) {
+        EXPECT_EQ(e.second % 4, 2);
+        ++seen; }
+    EXPECT_EQ(seen, 750u);
+    EXPECT_EQ(map.find(nodes[2])->second, 2);
+    EXPECT_TRUE(map.find(nodes[4]) == map.end());
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(IR, DenseNodeMapSharedIds) {
+    // nodes read back from a dump may share ids with other nodes
+    auto *a = new IR::Constant(1);
+    auto *b = new IR::Constant(2);
+    b->id = a->id;
+    IR::DenseNodeMap<const IR::Node *> map;
+    map[a] = b;
+    map[b] = a;
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.get(a), b);
+    EXPECT_EQ(map.get(b), a);
+    map.erase(a);
+    EXPECT_EQ(map.get(a), nullptr);
+    EXPECT_EQ(map.get(b), a);
+    map[a] = a;
+    EXPECT_EQ(map.get(a), a);
+
+    auto copy = map;
+    map.clear();
+    EXPECT_EQ(copy.get(b), a);
+    EXPECT_EQ(copy.get(a), a);
+}
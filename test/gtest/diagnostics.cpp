@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <sstream>
 #include <vector>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -267,4 +268,33 @@ TEST_F(Diagnostics, CompilerOptions) {
     }
 }
 
+TEST_F(Diagnostics, ReportedOnce) {
+    AutoCompileContext autoContext(new GTestContext);
+    std::stringstream out;
+    auto &reporter = BaseCompileContext::get().errorReporter();
+    reporter.setOutputStream(&out);
+    auto *sources = new Util::InputSources;
+    sources->appendText("bit<8> x;");
+    // const, as ::warning tracks the positions of const nodes only
+    const IR::Node *a = new IR::Constant(Util::SourceInfo(sources, Util::SourcePosition(1, 0)), 1);
+    const IR::Node *b = new IR::Constant(Util::SourceInfo(sources, Util::SourcePosition(1, 7)), 2);
+
+    // a diagnostic that is ignored does not count as reported at its position
+    reporter.setDiagnosticAction("uninitialized_use", DiagnosticAction::Ignore);
+    ::warning(ErrorType::WARN_UNINITIALIZED_USE, "%1%: first", a);
+    EXPECT_EQ(0u, ::diagnosticCount());
+    reporter.setDiagnosticAction("uninitialized_use", DiagnosticAction::Warn);
+    ::warning(ErrorType::WARN_UNINITIALIZED_USE, "%1%: second", a);
+    ::warning(ErrorType::WARN_UNINITIALIZED_USE, "%1%: third", a);
+    ::warning(ErrorType::WARN_UNINITIALIZED_USE, "%1%: fourth", b);
+    ::warning(ErrorType::WARN_UNUSED, "%1%: fifth", a);
+    EXPECT_EQ(3u, ::diagnosticCount());
+    EXPECT_EQ(std::string::npos, out.str().find("first"));
+    EXPECT_NE(std::string::npos, out.str().find("second"));
+    EXPECT_EQ(std::string::npos, out.str().find("third"));
+    EXPECT_NE(std::string::npos, out.str().find("fourth"));
+    EXPECT_NE(std::string::npos, out.str().find("fifth"));
+    reporter.setOutputStream(&std::cerr);
+}
+
 }  // namespace Test
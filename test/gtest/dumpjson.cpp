@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <stdio.h>
+#include <unistd.h>
+
 #include <iostream>
 
 #include "gtest/gtest.h"
@@ -36,3 +39,75 @@ TEST(IR, DumpJSON) {
     loader >> e2;
     JSONGenerator(std::cout) << e2 << std::endl;
 }
+
+TEST(IR, StreamJSON) {
+    auto c = new IR::Constant(2);
+    auto e = new IR::ListExpression({ new IR::Add(Util::SourceInfo(), c, c), c });
+
+    std::stringstream ss, ss2;
+    JSONGenerator(ss) << e << std::endl;
+    std::string text = ss.str();
+
+    JSONStreamLoader loader(ss);
+    ASSERT_NE(loader.json, nullptr);
+    const IR::Node* e2 = nullptr;
+    loader >> e2;
+    ASSERT_NE(e2, nullptr);
+    auto list = e2->to<IR::ListExpression>();
+    ASSERT_NE(list, nullptr);
+    ASSERT_EQ(list->components.size(), 2u);
+    // the shared constant is read back as a single node
+    auto add = list->components.at(0)->to<IR::Add>();
+    ASSERT_NE(add, nullptr);
+    EXPECT_EQ(add->left, add->right);
+    EXPECT_EQ(add->left, list->components.at(1));
+
+    JSONGenerator(ss2) << e2 << std::endl;
+    EXPECT_EQ(text, ss2.str());
+}
+
+TEST(IR, CompactJSON) {
+    auto c = new IR::Constant(2);
+    auto e = new IR::ListExpression({ new IR::Add(Util::SourceInfo(), c, c), c });
+
+    std::stringstream ss, ss2;
+    JSONGenerator(ss, false, true) << e;
+    std::string text = ss.str();
+    EXPECT_EQ(text.find('\n'), std::string::npos);
+    EXPECT_EQ(text.find("  "), std::string::npos);
+
+    JSONStreamLoader loader(ss);
+    const IR::Node* e2 = nullptr;
+    loader >> e2;
+    ASSERT_NE(e2, nullptr);
+    JSONGenerator(ss2, false, true) << e2;
+    EXPECT_EQ(text, ss2.str());
+}
+
+TEST(IR, JSONToFileDescriptor) {
+    auto c = new IR::Constant(2);
+    IR::Expression* e = new IR::Add(Util::SourceInfo(), c, c);
+
+    std::stringstream ss;
+    JSONGenerator(ss) << e << std::endl;
+
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        JSONGenerator gen(fileno(file));
+        gen << e << std::endl;
+        EXPECT_FALSE(gen.error());
+    }
+    std::string text(ss.str().size() + 1, '\0');
+    rewind(file);
+    text.resize(fread(&text[0], 1, text.size(), file));
+    fclose(file);
+    EXPECT_EQ(text, ss.str());
+}
+
+TEST(IR, StreamJSONMalformed) {
+    std::stringstream ss("{ \"Node_ID\" : 1, \"Node_Type\" : \"Add\", \"left\" : [ ");
+    JSONStreamLoader loader(ss);
+    const IR::Node* e = nullptr;
+    EXPECT_THROW(loader >> e, Util::CompilationError);
+}
@@ -203,4 +203,33 @@ TEST_F(UtilEnumerator, Linq) {
     }
 }
 
+TEST_F(UtilEnumerator, Enumerable) {
+    auto odd = enumerate(vec).where([](int i) { return i % 2 == 1; });
+    EXPECT_EQ(2u, odd.count());
+    EXPECT_EQ(std::vector<int>({ 1, 3 }), odd.toVector());
+    // ranges can be iterated again
+    int sum = 0;
+    for (auto i : odd.map([](int i) { return i * 10; }))
+        sum += i;
+    EXPECT_EQ(40, sum);
+
+    std::vector<int> more{ 4, 5 };
+    auto all = enumerate(vec).concat(enumerate(more));
+    EXPECT_EQ(std::vector<int>({ 1, 2, 3, 4, 5 }), all.toVector());
+    EXPECT_EQ(5, all.where([](int i) { return i > 4; }).single());
+    EXPECT_THROW(all.single(), std::logic_error);
+    EXPECT_EQ(1, all.next());
+    EXPECT_EQ(0, all.where([](int i) { return i > 5; }).nextOrDefault());
+    EXPECT_FALSE(enumerate(std::vector<int>()).any());
+
+    B b0(0), b1(1);
+    std::vector<B*> bs{ &b0, &b1 };
+    auto as = enumerate(bs).as<A*>().where([](A *a) { return a->a > 0; });
+    EXPECT_EQ(&b1, as.single());
+
+    // over an Enumerator, which can be iterated only once
+    auto e = enumerate(Enumerator<int>::createEnumerator(vec)).map([](int i) { return i + 1; });
+    EXPECT_EQ(std::vector<int>({ 2, 3, 4 }), e.toVector());
+}
+
 }  // namespace Util
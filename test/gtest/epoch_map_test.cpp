@@ -0,0 +1,58 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/epoch_map.h"
+
+namespace Test {
+
+struct value_t { int v; bool flag; };
+
+TEST(EpochMap, InsertFind) {
+    std::vector<int> keys(1000);
+    epoch_map<const int *, value_t> map;
+    for (int i = 0; i < 1000; ++i) {
+        auto r = map.emplace(&keys[i], value_t{i, false});
+        EXPECT_TRUE(r.second);
+        EXPECT_EQ(r.first->v, i); }
+    EXPECT_EQ(map.size(), 1000u);
+    auto r = map.emplace(&keys[10], value_t{-1, true});
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ(r.first->v, 10);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_NE(map.find(&keys[i]), nullptr);
+        EXPECT_EQ(map.find(&keys[i])->v, i); }
+    int other;
+    EXPECT_EQ(map.find(&other), nullptr);
+    EXPECT_EQ(map.count_of(&other), 0u);
+}
+
+TEST(EpochMap, StablePointers) {
+    std::vector<int> keys(2000);
+    epoch_map<const int *, value_t> map;
+    value_t *first = map.emplace(&keys[0], value_t{0, false}).first;
+    for (int i = 1; i < 2000; ++i) map.emplace(&keys[i], value_t{i, false});
+    EXPECT_EQ(first, map.find(&keys[0]));
+    map.erase_if([](const int *, const value_t &val) { return val.v % 2 == 1; });
+    EXPECT_EQ(map.size(), 1000u);
+    EXPECT_EQ(first, map.find(&keys[0]));
+    EXPECT_EQ(map.find(&keys[1]), nullptr);
+    EXPECT_NE(map.find(&keys[2]), nullptr);
+}
+
+TEST(EpochMap, ClearAndReuse) {
+    std::vector<int> keys(100);
+    epoch_map<const int *, value_t> map;
+    for (int round = 0; round < 3; ++round) {
+        EXPECT_TRUE(map.empty());
+        for (int i = round; i < 100; i += 3) map.emplace(&keys[i], value_t{i, true});
+        int seen = 0;
+        map.for_each([&](const int *k, const value_t &val) {
+            EXPECT_EQ(k, &keys[val.v]);
+            ++seen; });
+        EXPECT_EQ(static_cast<size_t>(seen), map.size());
+        for (int i = 0; i < 100; ++i)
+            EXPECT_EQ(map.find(&keys[i]) != nullptr, i % 3 == round);
+        if (round == 1) map.scrub(); else map.clear(); }
+}
+
+}  // namespace Test
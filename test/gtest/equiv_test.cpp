@@ -70,3 +70,37 @@ TEST(IR, Equiv) {
     pr2->add("listb", list1);
     EXPECT_FALSE(pr1->equiv(*pr2));
 }
+
+TEST(IR, StructuralHash) {
+    auto *t = IR::Type::Bits::get(16);
+    auto *a1 = new IR::Constant(t, 10);
+    // source positions are ignored
+    auto *a2 = new IR::Constant(Util::SourceInfo("x.p4", 3, 7, "brief"), t, 10);
+    auto *d1 = new IR::PathExpression("d");
+    auto *d2 = new IR::PathExpression("d");
+    auto *call1 = new IR::MethodCallExpression(new IR::Member(d1, "m"), { a1, d1 });
+    auto *call2 = new IR::MethodCallExpression(new IR::Member(d2, "m"), { a2, d2 });
+
+    // nodes that are equiv hash the same
+    EXPECT_EQ(a1->structural_hash(), a2->structural_hash());
+    EXPECT_EQ(d1->structural_hash(), d2->structural_hash());
+    EXPECT_EQ(call1->structural_hash(), call2->structural_hash());
+
+    // differences that equiv sees usually change the hash too
+    EXPECT_NE(a1->structural_hash(), (new IR::Constant(t, 20))->structural_hash());
+    EXPECT_NE(d1->structural_hash(), (new IR::PathExpression("e"))->structural_hash());
+    EXPECT_NE(call1->structural_hash(),
+              (new IR::MethodCallExpression(new IR::Member(d1, "f"), { a1, d1 }))
+              ->structural_hash());
+    EXPECT_NE(call1->structural_hash(),
+              (new IR::MethodCallExpression(new IR::Member(d1, "m"), { d1, a1 }))
+              ->structural_hash());
+
+    auto *pr1 = new IR::V1Program;
+    auto *pr2 = pr1->clone();
+    pr1->add("a", a1);
+    pr1->add("call", call1);
+    pr2->add("a", a2);
+    pr2->add("call", call2);
+    EXPECT_EQ(pr1->structural_hash(), pr2->structural_hash());
+}
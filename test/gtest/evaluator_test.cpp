@@ -0,0 +1,39 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/evaluator/evaluator.h"
+#include "frontends/p4/typeMap.h"
+
+namespace Test {
+
+class EvaluatorTest : public P4CTest { };
+
+TEST_F(EvaluatorTest, Reuse) {
+    auto b8 = IR::Type_Bits::get(8);
+    auto program = new IR::P4Program();
+    auto a = new IR::Declaration_Constant("a", b8, new IR::Constant(b8, 1));
+    program->objects.push_back(a);
+
+    P4::ReferenceMap refMap;
+    P4::TypeMap typeMap;
+    P4::EvaluatorPass evaluator(&refMap, &typeMap);
+    program->apply(evaluator);
+    ASSERT_EQ(0u, ::errorCount());
+    auto block = evaluator.getToplevelBlock();
+    ASSERT_NE(block, nullptr);
+    EXPECT_TRUE(block->hasValue(a));
+
+    // the program has not changed: its blocks are not evaluated again
+    program->apply(evaluator);
+    EXPECT_EQ(evaluator.getToplevelBlock(), block);
+
+    // a new program gets new blocks
+    auto copy = program->clone();
+    copy->apply(evaluator);
+    ASSERT_EQ(0u, ::errorCount());
+    EXPECT_NE(evaluator.getToplevelBlock(), block);
+    EXPECT_EQ(evaluator.getToplevelBlock()->getProgram(), copy);
+}
+
+}  // namespace Test
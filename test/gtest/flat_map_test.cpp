@@ -0,0 +1,96 @@
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/flat_map.h"
+#include "lib/small_ordered_map.h"
+
+namespace Test {
+
+TEST(FlatMap, SortedLikeStdMap) {
+    // cover both the linear and the binary search regime
+    for (int n : { 5, 100 }) {
+        flat_map<int, int> fm;
+        std::map<int, int> sm;
+        for (int i = 0; i < n; ++i) {
+            int k = (i * 37) % n;
+            EXPECT_EQ(fm.emplace(k, i).second, sm.emplace(k, i).second);
+            EXPECT_FALSE(fm.emplace(k, -1).second); }
+        ASSERT_EQ(fm.size(), sm.size());
+        auto it = fm.begin();
+        for (auto &kv : sm) {
+            EXPECT_EQ(it->first, kv.first);
+            EXPECT_EQ(it->second, kv.second);
+            ++it; }
+        for (int k = -1; k <= n; ++k) {
+            EXPECT_EQ(fm.count(k), sm.count(k));
+            EXPECT_EQ(fm.lower_bound(k) - fm.begin(),
+                      std::distance(sm.begin(), sm.lower_bound(k)));
+            EXPECT_EQ(fm.upper_bound(k) - fm.begin(),
+                      std::distance(sm.begin(), sm.upper_bound(k))); } }
+}
+
+TEST(FlatMap, IndexAndErase) {
+    flat_map<std::string, int> m;
+    m["c"] = 3;
+    m["a"] = 1;
+    m["b"] = 2;
+    m["a"] += 10;
+    EXPECT_EQ(m.at("a"), 11);
+    EXPECT_THROW(m.at("z"), std::out_of_range);
+    EXPECT_EQ(m.erase("b"), 1u);
+    EXPECT_EQ(m.erase("b"), 0u);
+    std::vector<std::string> keys;
+    for (auto &kv : m) keys.push_back(kv.first);
+    EXPECT_EQ(keys, (std::vector<std::string>{ "a", "c" }));
+    flat_map<std::string, int> copy(m);
+    EXPECT_TRUE(copy == m);
+    copy["d"] = 4;
+    EXPECT_TRUE(copy != m);
+}
+
+TEST(SmallOrderedMap, InsertionOrder) {
+    for (int n : { 6, 50 }) {
+        small_ordered_map<int, int> m;
+        for (int i = 0; i < n; ++i) m.emplace((i * 7) % n, i);
+        EXPECT_FALSE(m.emplace(0, -1).second);
+        ASSERT_EQ(m.size(), static_cast<size_t>(n));
+        int i = 0;
+        for (auto &kv : m) {
+            EXPECT_EQ(kv.first, (i * 7) % n);
+            EXPECT_EQ(kv.second, i);
+            ++i; }
+        for (int k = 0; k < n; ++k) {
+            ASSERT_NE(m.find(k), m.end());
+            EXPECT_EQ(m.find(k)->first, k); }
+        EXPECT_EQ(m.find(n), m.end()); }
+}
+
+TEST(SmallOrderedMap, Erase) {
+    small_ordered_map<int, int> m;
+    for (int i = 0; i < 40; ++i) m[i] = i;
+    // erase every other entry while iterating, which forces compaction along the way
+    for (auto it = m.begin(); it != m.end(); ) {
+        if (it->first % 2 == 0)
+            it = m.erase(it);
+        else
+            ++it; }
+    EXPECT_EQ(m.size(), 20u);
+    int expect = 1;
+    for (auto &kv : m) {
+        EXPECT_EQ(kv.first, expect);
+        expect += 2; }
+    for (int i = 0; i < 40; ++i)
+        EXPECT_EQ(m.count(i), static_cast<size_t>(i % 2));
+    for (int i = 1; i < 37; i += 2) EXPECT_EQ(m.erase(i), 1u);
+    EXPECT_EQ(m.size(), 2u);
+    EXPECT_EQ(m.count(37), 1u);
+    EXPECT_EQ(m.count(39), 1u);
+    m[2] = 2;
+    EXPECT_EQ(m.size(), 3u);
+    EXPECT_EQ(m.begin()->first, 37);
+}
+
+}  // namespace Test
@@ -0,0 +1,77 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/flat_ordered_map.h"
+#include "lib/flat_ordered_set.h"
+#include "lib/ordered_map.h"
+
+namespace Test {
+
+TEST(FlatOrderedMap, LikeOrderedMap) {
+    flat_ordered_map<int, int> fm;
+    ordered_map<int, int> om;
+    for (int i = 0; i < 2000; ++i) {
+        int k = (i * 7919) % 1500;
+        EXPECT_EQ(fm.emplace(k, i).second, om.emplace(k, i).second); }
+    // erase enough to force compaction, while iterating
+    for (auto it = fm.begin(); it != fm.end(); ) {
+        if (it->first % 3 != 0)
+            it = fm.erase(it);
+        else
+            ++it; }
+    for (int k = 0; k < 1500; ++k)
+        if (k % 3 != 0) om.erase(k);
+    for (int k = 0; k < 1500; k += 5) {
+        fm[k] += 1;
+        om[k] += 1; }
+    ASSERT_EQ(fm.size(), om.size());
+    auto it = fm.begin();
+    for (auto &kv : om) {
+        ASSERT_NE(it, fm.end());
+        EXPECT_EQ(it->first, kv.first);
+        EXPECT_EQ(it->second, kv.second);
+        ++it; }
+    EXPECT_EQ(it, fm.end());
+    for (int k = -1; k <= 1500; ++k) {
+        EXPECT_EQ(fm.count(k), om.count(k));
+        EXPECT_EQ(get(fm, k, -1), get(om, k, -1)); }
+    EXPECT_THROW(fm.at(1), std::out_of_range);
+    EXPECT_EQ(fm.rbegin()->first, om.rbegin()->first);
+
+    flat_ordered_map<int, int> copy(fm);
+    EXPECT_TRUE(copy == fm);
+    copy.erase(0);
+    EXPECT_TRUE(copy != fm);
+}
+
+TEST(FlatOrderedMap, Sort) {
+    flat_ordered_map<std::string, int> m = { { "c", 1 }, { "a", 2 }, { "b", 3 } };
+    m.erase("a");
+    m["a"] = 4;
+    std::vector<std::string> keys;
+    for (auto &kv : m) keys.push_back(kv.first);
+    EXPECT_EQ(keys, (std::vector<std::string>{ "c", "b", "a" }));
+    m.sort([](const std::pair<std::string, int> &a, const std::pair<std::string, int> &b) {
+        return a.first < b.first; });
+    keys.clear();
+    for (auto &kv : m) keys.push_back(kv.first);
+    EXPECT_EQ(keys, (std::vector<std::string>{ "a", "b", "c" }));
+    EXPECT_EQ(m.at("a"), 4);
+}
+
+TEST(FlatOrderedSet, InsertionOrder) {
+    flat_ordered_set<int> s = { 5, 3, 9 };
+    EXPECT_FALSE(s.insert(3).second);
+    s.push_back(1);
+    EXPECT_EQ(s.front(), 5);
+    EXPECT_EQ(s.back(), 1);
+    EXPECT_EQ(s.erase(9), 1u);
+    EXPECT_EQ(s.erase(9), 0u);
+    std::vector<int> v(s.begin(), s.end());
+    EXPECT_EQ(v, (std::vector<int>{ 5, 3, 1 }));
+    EXPECT_EQ(s.count(3), 1u);
+    EXPECT_EQ(s.find(9), s.end());
+}
+
+}  // namespace Test
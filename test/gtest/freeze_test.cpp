@@ -0,0 +1,64 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/freeze.h"
+#include "ir/ir.h"
+#include "lib/arena.h"
+
+namespace Test {
+
+class FreezeTest : public P4CTest { };
+
+TEST_F(FreezeTest, CopiesInDepthFirstOrder) {
+    // a control assigning the same (shared) expression to two variables
+    auto b8 = IR::Type_Bits::get(8);
+    auto sum = new IR::Add(new IR::PathExpression("x"), new IR::Constant(b8, 1));
+    auto body = new IR::BlockStatement({
+        new IR::AssignmentStatement(new IR::PathExpression("y"), sum),
+        new IR::AssignmentStatement(new IR::PathExpression("z"), sum) });
+    auto params = new IR::ParameterList({
+        new IR::Parameter("x", IR::Direction::In, b8),
+        new IR::Parameter("y", IR::Direction::Out, b8),
+        new IR::Parameter("z", IR::Direction::Out, b8) });
+    auto program = new IR::P4Program();
+    program->objects.push_back(new IR::P4Control("c", new IR::Type_Control("c", params), body));
+
+    Util::Arena arena;
+    auto frozen = IR::freeze(program, arena);
+    ASSERT_NE(frozen, nullptr);
+    EXPECT_NE(frozen, program);
+    EXPECT_TRUE(frozen->equiv(*program));
+
+    struct Nodes : public Inspector {
+        std::vector<const IR::Node *> order;
+        bool preorder(const IR::Node *n) override { order.push_back(n); return true; }
+    } original, copy;
+    program->apply(original);
+    frozen->apply(copy);
+    ASSERT_EQ(copy.order.size(), original.order.size());
+    const IR::Node *last = nullptr;
+    for (size_t i = 0; i < copy.order.size(); i++) {
+        auto n = copy.order[i];
+        if (n->is<IR::Type_Base>()) {
+            // shared with the rest of the compiler, so not copied
+            EXPECT_EQ(n, original.order[i]);
+            continue; }
+        EXPECT_TRUE(arena.owns(n)) << n;
+        EXPECT_FALSE(arena.owns(original.order[i])) << n;
+        // laid out in the order it is visited
+        if (last) EXPECT_LT(last, n) << n;
+        last = n; }
+
+    // the shared expression is still shared
+    auto control = frozen->objects.at(0)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    auto first = control->body->components.at(0)->to<IR::AssignmentStatement>();
+    auto second = control->body->components.at(1)->to<IR::AssignmentStatement>();
+    EXPECT_EQ(first->right, second->right);
+    EXPECT_NE(first->right, sum);
+    EXPECT_EQ(IR::freeze(static_cast<const IR::Node *>(nullptr), arena), nullptr);
+    EXPECT_EQ(0u, ::errorCount());
+}
+
+}  // namespace Test
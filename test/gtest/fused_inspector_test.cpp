@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/parsers/parserDriver.h"
+#include "ir/ir.h"
+#include "ir/node_census.h"
+#include "ir/pass_manager.h"
+#include "ir/visitor.h"
+#include "midend/compileTimeOps.h"
+#include "midend/validateProperties.h"
+
+namespace {
+
+/// Records, in order, the names of the paths it visits before or after their children.
+class PathRecorder : public Inspector {
+    bool postorderOnly;
+    bool skipMembers;
+
+ public:
+    std::vector<cstring> seen;
+    int starts = 0, ends = 0;
+    PathRecorder(bool postorderOnly, bool skipMembers)
+    : postorderOnly(postorderOnly), skipMembers(skipMembers) {}
+    bool canFuse() const override { return true; }
+    profile_t init_apply(const IR::Node *root) override {
+        ++starts;
+        return Inspector::init_apply(root); }
+    void end_apply() override { ++ends; }
+    bool preorder(const IR::Member *) override { return !skipMembers; }
+    bool preorder(const IR::PathExpression *pe) override {
+        if (!postorderOnly) seen.push_back(pe->path->name.name);
+        return true; }
+    void postorder(const IR::PathExpression *pe) override {
+        if (postorderOnly) seen.push_back(pe->path->name.name); }
+};
+
+const IR::Node *makeTree() {
+    auto *a = new IR::PathExpression("a");
+    auto *b = new IR::PathExpression("b");
+    // 'a' is shared, so it should be visited only once per visitor
+    return new IR::Add(new IR::Add(a, new IR::Member(b, "f")), a);
+}
+
+/// Replaces field accesses with the expression they apply to.
+class RemoveMembers : public Transform {
+ public:
+    const IR::Node *postorder(IR::Member *member) override { return member->expr; }
+};
+
+/// Reports an error at each path named @name.
+class ErrorAt : public Inspector {
+    cstring name;
+
+ public:
+    explicit ErrorAt(cstring name) : name(name) {}
+    bool canFuse() const override { return true; }
+    bool preorder(const IR::PathExpression *pe) override {
+        if (pe->path->name.name == name)
+            ::error(ErrorType::ERR_INVALID, "%1%: found by %2%", pe, name);
+        return true; }
+};
+
+/// The diagnostics written by running the Inspectors in @passes over @tree, fused or
+/// not, with the PassManager stopping on errors if @stopOnError.
+std::string diagnostics(const IR::Node *tree, std::initializer_list<VisitorRef> passes,
+                        bool fuse, bool stopOnError = true, unsigned *errors = nullptr) {
+    AutoCompileContext autoContext(new GTestContext);
+    std::stringstream out;
+    BaseCompileContext::get().errorReporter().setOutputStream(&out);
+    PassManager pm(passes);
+    pm.setFuseInspectors(fuse);
+    pm.setStopOnError(stopOnError);
+    tree->apply(pm);
+    if (errors) *errors = ::errorCount();
+    return out.str();
+}
+
+}  // namespace
+
+class P4C_IR : public P4CTest { };
+
+TEST_F(P4C_IR, FusedInspector) {
+    auto *tree = makeTree();
+    PathRecorder ref1(false, false), ref2(true, true);
+    tree->apply(ref1);
+    tree->apply(ref2);
+    EXPECT_EQ(ref1.seen, (std::vector<cstring>{"a", "b"}));
+    EXPECT_EQ(ref2.seen, (std::vector<cstring>{"a"}));
+
+    PathRecorder f1(false, false), f2(true, true);
+    PassManager pm({ &f1, &f2 });
+    tree->apply(pm);
+    EXPECT_EQ(f1.seen, ref1.seen);
+    EXPECT_EQ(f2.seen, ref2.seen);
+    EXPECT_EQ(f1.starts, 1);
+    EXPECT_EQ(f1.ends, 1);
+    EXPECT_EQ(f2.starts, 1);
+    EXPECT_EQ(f2.ends, 1);
+
+    PathRecorder u1(false, false), u2(true, true);
+    PassManager unfused({ &u1, &u2 });
+    unfused.setFuseInspectors(false);
+    tree->apply(unfused);
+    EXPECT_EQ(u1.seen, f1.seen);
+    EXPECT_EQ(u2.seen, f2.seen);
+}
+
+// the diagnostics of fused Inspectors come out as if they had run one after another
+TEST_F(P4C_IR, FusedInspectorDiagnostics) {
+    std::string source = R"(
+control c(inout bit<8> x) {
+    action a() { x = x / 3; }
+    table t { key = { x : exact; } actions = { a; } bogus = 1; }
+    apply { t.apply(); x = x % 5; }
+}
+)";
+    std::istringstream in(source);
+    auto *program = P4::P4ParserDriver::parse(in, "fused.p4");
+    ASSERT_TRUE(program != nullptr);
+
+    // the table is visited after the action, but its warning comes first, before the
+    // errors that would otherwise suppress it
+    auto validate = new P4::ValidateTableProperties({});
+    auto compileTime = new P4::CompileTimeOperations();
+    EXPECT_TRUE(validate->canFuse());
+    EXPECT_TRUE(compileTime->canFuse());
+    unsigned errors = 0;
+    auto serial = diagnostics(program, { validate, compileTime }, false);
+    auto fused = diagnostics(program, { validate, compileTime }, true, true, &errors);
+    EXPECT_EQ(fused, serial);
+    EXPECT_EQ(errors, 2u);
+    auto warning = fused.find("Unknown table property");
+    auto firstError = fused.find("compilation time");
+    EXPECT_NE(warning, std::string::npos);
+    EXPECT_NE(firstError, std::string::npos);
+    EXPECT_LT(warning, firstError);
+
+    // a fused Inspector after the first one to report an error does not report anything
+    auto *tree = makeTree();
+    auto serialStop = diagnostics(tree, { new ErrorAt("b"), new ErrorAt("a") }, false);
+    auto fusedStop = diagnostics(tree, { new ErrorAt("b"), new ErrorAt("a") }, true, true,
+                                 &errors);
+    EXPECT_EQ(fusedStop, serialStop);
+    EXPECT_EQ(errors, 1u);
+    EXPECT_EQ(fusedStop.find("found by a"), std::string::npos);
+    // but does when the PassManager keeps going
+    auto serialAll = diagnostics(tree, { new ErrorAt("b"), new ErrorAt("a") }, false, false);
+    auto fusedAll = diagnostics(tree, { new ErrorAt("b"), new ErrorAt("a") }, true, false,
+                                &errors);
+    EXPECT_EQ(fusedAll, serialAll);
+    EXPECT_EQ(errors, 2u);
+    EXPECT_LT(fusedAll.find("found by b"), fusedAll.find("found by a"));
+}
+
+TEST_F(P4C_IR, PassProfile) {
+    auto *tree = makeTree();
+    PathRecorder recorder(false, false);
+    RemoveMembers remover;
+    PassManager pm({ &recorder, &remover });
+    pm.setName("Profiled");
+    std::stringstream profile;
+    pm.setProfile(&profile);
+    tree->apply(pm);
+
+    std::string first, second, rest;
+    std::getline(profile, first);
+    std::getline(profile, second);
+    std::getline(profile, rest);
+    EXPECT_EQ(first.find("Profiled_0_"), 0u);
+    EXPECT_NE(first.find(" ms, "), std::string::npos);
+    EXPECT_NE(first.find("(+0)"), std::string::npos);
+    EXPECT_EQ(second.find("Profiled_1_"), 0u);
+    // the Member node is gone
+    EXPECT_NE(second.find("(-1)"), std::string::npos);
+    EXPECT_TRUE(rest.empty());
+}
+
+TEST_F(P4C_IR, NodeCensus) {
+    auto *tree = makeTree();
+    RemoveMembers remover;
+    remover.setName("RemoveMembers");
+    PassManager pm({ &remover });
+    pm.setName("Census");
+    IR::NodeCensus census;
+    std::stringstream csv;
+    census.setOutput(&csv);
+    pm.addDebugHook([&census](const char *manager, unsigned seq, const char *pass,
+                              const IR::Node *node) {
+        census.record(cstring(manager) + "_" + Util::toString(seq) + "_" + pass, node); });
+    census.record("parsed", tree);
+    EXPECT_EQ(census.getCount("Add"), 2u);
+    EXPECT_EQ(census.getCount("Member"), 1u);
+    size_t total = census.getTotal();
+    tree = tree->apply(pm);
+    EXPECT_EQ(census.getCount("Member"), 0u);
+    EXPECT_EQ(census.getTotal(), total - 1);
+
+    std::string header, line;
+    std::getline(csv, header);
+    EXPECT_EQ(header, "pass,class,count,delta");
+    std::vector<std::string> rows;
+    while (std::getline(csv, line))
+        rows.push_back(line);
+    EXPECT_NE(std::find(rows.begin(), rows.end(), "parsed,Member,1,+1"),
+              rows.end());
+    EXPECT_NE(std::find(rows.begin(), rows.end(), "Census_0_RemoveMembers,Member,0,-1"),
+              rows.end());
+    EXPECT_EQ(rows.back(),
+              "Census_0_RemoveMembers,total," + std::to_string(total - 1) + ",-1");
+}
+
+TEST_F(P4C_IR, NodeCensusGrowth) {
+    IR::NodeCensus census;
+    census.setMaxGrowth(2);
+    census.record("small", new IR::PathExpression("a"));
+    EXPECT_THROW(census.record("big", makeTree()), Util::CompilationError);
+}
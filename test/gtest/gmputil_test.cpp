@@ -0,0 +1,36 @@
+#include "gtest/gtest.h"
+#include "lib/gmputil.h"
+
+namespace Test {
+
+// These hold for either representation of big_int (see gmputil.h).
+TEST(GmpUtil, BigIntOps) {
+    big_int small = 0xffff;
+    EXPECT_EQ(Util::findOnes(small).lowIndex, 0u);
+    EXPECT_EQ(Util::findOnes(small).highIndex, 15u);
+    EXPECT_EQ(Util::scan1(big_int(0x50), 0), 4u);
+    EXPECT_EQ(Util::scan0(big_int(0x5f), 0), 5u);
+    EXPECT_EQ(Util::scan0(big_int(-4), 0), 0u);
+    EXPECT_EQ(Util::scan1(big_int(-4), 0), 2u);
+    EXPECT_EQ(bitcount(small), 16u);
+    EXPECT_EQ(ffs(big_int(0x100)), 8);
+
+    // values that outgrow 64 and 128 bits
+    big_int wide = Util::mask(100);
+    EXPECT_EQ(bitcount(wide), 100u);
+    EXPECT_EQ(wide + 1, Util::shift_left(1, 100));
+    big_int huge = Util::shift_left(wide, 100) | wide;
+    EXPECT_EQ(bitcount(huge), 200u);
+    EXPECT_EQ(Util::shift_right(huge, 150), Util::mask(50));
+    EXPECT_EQ(Util::maskFromSlice(199, 100) & huge, huge - wide);
+    EXPECT_EQ(huge * huge / huge, huge);
+    EXPECT_EQ(Util::cvtInt("ffff_ffff_ffff_ffff_ffff", 16), Util::mask(80));
+
+    // two's complement semantics for bit operations on negative values
+    EXPECT_EQ(big_int(-1) & small, small);
+    EXPECT_EQ(big_int(-256) & small, 0xff00);
+    EXPECT_EQ(Util::ripBits(wide, 64), Util::mask(64));
+    EXPECT_EQ(wide, Util::mask(36));
+}
+
+}  // namespace Test
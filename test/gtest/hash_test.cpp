@@ -0,0 +1,58 @@
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/cstring.h"
+#include "lib/hash.h"
+
+namespace Test {
+
+namespace {
+struct Point {
+    int x, y;
+    size_t hash() const { return Util::Hash::hash_values(x, y); }
+};
+}  // namespace
+
+TEST(Hash, Wyhash) {
+    // every length through the short, medium and 48-byte block paths
+    std::string text;
+    std::set<size_t> seen;
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(Util::Hash::wyhash(text), Util::Hash::wyhash(text.data(), text.size()));
+        seen.insert(Util::Hash::wyhash(text));
+        text += static_cast<char>('a' + i % 26); }
+    EXPECT_EQ(seen.size(), 200u);
+    // changing any one byte changes the hash
+    std::string base(100, 'x');
+    for (size_t i = 0; i < base.size(); ++i) {
+        std::string changed = base;
+        changed[i] = 'y';
+        EXPECT_NE(Util::Hash::wyhash(base), Util::Hash::wyhash(changed)); }
+    EXPECT_NE(Util::Hash::wyhash(base.data(), base.size(), 1),
+              Util::Hash::wyhash(base.data(), base.size(), 2));
+}
+
+TEST(Hash, Combine) {
+    using Util::Hash::hash;
+    using Util::Hash::hash_values;
+    EXPECT_NE(hash_values(1, 2), hash_values(2, 1));
+    EXPECT_EQ(hash_values(1, 2), hash_values(1, 2));
+    typedef hash<std::pair<int, int>> pair_hash;
+    EXPECT_EQ(pair_hash()(std::make_pair(1, 2)),
+              Util::Hash::hash_combine(hash<int>()(1), hash<int>()(2)));
+    EXPECT_NE(hash<std::vector<int>>()({1, 2}), hash<std::vector<int>>()({1, 2, 0}));
+    EXPECT_EQ(hash<std::string>()("abc"), Util::Hash::wyhash("abc", 3));
+    // classes with a hash() method, like cstring, use it
+    EXPECT_EQ(hash<cstring>()(cstring("abc")), cstring("abc").hash());
+    EXPECT_EQ(hash<Point>()(Point{1, 2}), hash_values(1, 2));
+    EXPECT_NE(hash_values(cstring("a"), Point{1, 2}), hash_values(cstring("a"), Point{2, 1}));
+    // small integers spread over all the bits
+    std::set<size_t> low;
+    for (int i = 0; i < 1000; ++i) low.insert(hash<int>()(i) & 0xff);
+    EXPECT_GT(low.size(), 200u);
+}
+
+}  // namespace Test
@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+
+TEST(IR, HashCons) {
+    auto *t = IR::Type::Bits::get(16);
+    auto *a1 = IR::Constant::intern(t, 10);
+    auto *a2 = IR::Constant::intern(t, 10);
+    auto *b = IR::Constant::intern(IR::Type::Bits::get(10), 10);
+    auto *c = IR::Constant::intern(t, 20);
+    EXPECT_EQ(a1, a2);
+    EXPECT_NE(a1, b);
+    EXPECT_NE(a1, c);
+    EXPECT_EQ(IR::Constant::canonical(new IR::Constant(t, 20)), c);
+
+    auto *d1 = IR::PathExpression::intern(IR::Path::intern(IR::ID("d")));
+    auto *d2 = IR::PathExpression::intern(IR::Path::intern(IR::ID("d")));
+    auto *e = IR::PathExpression::intern(IR::Path::intern(IR::ID("e")));
+    EXPECT_EQ(d1, d2);
+    EXPECT_NE(d1, e);
+
+    // children are compared by pointer, so only canonical children lead to sharing
+    EXPECT_EQ(IR::Member::intern(d1, IR::ID("f")), IR::Member::intern(d2, IR::ID("f")));
+    EXPECT_NE(IR::Member::intern(d1, IR::ID("f")), IR::Member::intern(d1, IR::ID("g")));
+    EXPECT_NE(IR::Member::intern(new IR::PathExpression("d"), IR::ID("f")),
+              IR::Member::intern(d1, IR::ID("f")));
+}
+
+TEST(IR, HashConsStructuralHash) {
+    auto *t = IR::Type::Bits::get(16);
+    auto *a = IR::Constant::intern(t, 10);
+    auto *b = new IR::Constant(t, 10);
+    // canonical nodes cache their hash, which is still that of an equiv node
+    EXPECT_EQ(a->structural_hash(), b->structural_hash());
+    EXPECT_EQ(a->structural_hash(), a->structural_hash_cache.get());
+
+    // copies do not keep it, as they may be modified
+    auto *c = a->clone();
+    EXPECT_EQ(c->structural_hash_cache.get(), 0U);
+    c->value = 20;
+    EXPECT_NE(c->structural_hash(), a->structural_hash());
+    EXPECT_EQ(c->structural_hash_cache.get(), 0U);
+}
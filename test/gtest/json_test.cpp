@@ -18,6 +18,8 @@ limitations under the License.
 
 #include "gtest/gtest.h"
 #include "lib/json.h"
+#include "lib/json_binary.h"
+#include "lib/json_writer.h"
 
 namespace Util {
 
@@ -71,4 +73,97 @@ TEST(Util, Json) {
               obj->toString());
 }
 
+TEST(Util, JsonWriter) {
+    // the same document, as a tree and streamed
+    auto obj = new JsonObject();
+    obj->emplace("name", "x");
+    auto fields = new JsonArray();
+    for (int i = 0; i < 3; ++i) {
+        auto f = new JsonObject();
+        f->emplace("id", i);
+        f->emplace("bits", (new JsonArray())->append(i)->append(true));
+        fields->append(f); }
+    obj->emplace("fields", fields);
+    obj->emplace("empty", new JsonArray());
+    obj->emplace("nested", (new JsonArray())->append(new JsonArray())->append(7));
+    obj->emplace("holes", (new JsonArray())->append(1)->append(static_cast<IJson *>(nullptr)));
+    obj->emplace("none", static_cast<IJson *>(nullptr));
+
+    std::stringstream streamed;
+    {
+        JsonWriter w(streamed);
+        w.begin_object();
+        w.key("name").value("x");
+        w.key("fields").begin_array();
+        for (int i = 0; i < 3; ++i) {
+            w.begin_object();
+            w.key("id").value(i);
+            w.key("bits").begin_array().value(i).value(true).end_array();
+            w.end_object(); }
+        w.end_array();
+        w.key("empty").begin_array().end_array();
+        w.key("nested").begin_array().begin_array().end_array().value(7).end_array();
+        w.key("holes").value(obj->get("holes"));
+        w.key("none").null();
+        w.end_object();
+    }
+    EXPECT_EQ(obj->toString(), streamed.str());
+
+    EXPECT_THROW(JsonWriter(streamed).begin_object().value(1), std::logic_error);
+    EXPECT_THROW(JsonWriter(streamed).key("x"), std::logic_error);
+}
+
+TEST(Util, JsonText) {
+    // finished pieces kept as text are written as their trees, at any depth
+    auto tree = new JsonObject();
+    auto list = new JsonArray();
+    auto compact = new JsonArray();
+    for (int i = 0; i < 3; ++i) {
+        auto elem = new JsonObject();
+        elem->emplace("id", i);
+        elem->emplace("data", (new JsonArray())->append(i)->append(i + 1));
+        elem->emplace("nested", (new JsonObject())->emplace("x", i));
+        list->append(elem);
+        compact->append(new JsonText(elem)); }
+    tree->emplace("list", list);
+    auto scalars = (new JsonArray())->append(1)->append(2);
+    tree->emplace("scalars", (new JsonArray())->append(scalars)->append(3));
+
+    auto text = new JsonObject();
+    text->emplace("list", compact);
+    text->emplace("scalars", (new JsonArray())->append(new JsonText(scalars))->append(3));
+    EXPECT_EQ(tree->toString(), text->toString());
+    EXPECT_EQ(tree->toString(), JsonText(tree).toString());
+}
+
+TEST(Util, JsonBinary) {
+    auto tree = new JsonObject();
+    auto header = new JsonObject();
+    header->emplace("name", "ethernet_t");
+    header->emplace("id", 0);
+    header->emplace("big", big_int("123456789012345678901234567890"));
+    header->emplace("negative", -42);
+    header->emplace("fields", (new JsonArray())->append("dst")->append(false)->append(48));
+    header->emplace("missing", new JsonValue());
+    tree->emplace("header_types", (new JsonArray())->append(header));
+    auto action = new JsonObject();
+    action->emplace("name", "ethernet_t");
+    action->emplace("source", "a\\b");
+    action->emplace("primitives", (new JsonArray())->append(true)->append(new JsonArray()));
+    tree->emplace("actions", (new JsonArray())->append(new JsonText(action)));
+
+    std::stringstream binary;
+    JsonBinary::write(binary, tree);
+    auto expected = tree->toString();
+    // ethernet_t is kept once in the string table
+    EXPECT_EQ(binary.str().find("ethernet_t"), binary.str().rfind("ethernet_t"));
+    EXPECT_LT(binary.str().size(), expected.size());
+    EXPECT_EQ(JsonBinary::read(binary)->toString(), expected);
+
+    std::stringstream truncated(binary.str().substr(0, binary.str().size() - 1));
+    EXPECT_THROW(JsonBinary::read(truncated), std::runtime_error);
+    std::stringstream other("{}");
+    EXPECT_THROW(JsonBinary::read(other), std::runtime_error);
+}
+
 }  // namespace Util
@@ -0,0 +1,49 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/log.h"
+
+namespace Test {
+
+namespace {
+bool logging2() { return LOGGING(2); }
+}  // namespace
+
+TEST(Log, CallSiteLevelCache) {
+    EXPECT_FALSE(LOGGING(11));  // above MAX_LOGGING_LEVEL, as built by default
+    ::Log::addDebugSpec("not_this_file:5");
+    EXPECT_FALSE(logging2());
+    // the level cached at the LOGGING call site is reset by the new spec
+    ::Log::addDebugSpec("log_test:2");
+    EXPECT_TRUE(logging2());
+    EXPECT_TRUE(LOGGING(1));
+    EXPECT_FALSE(LOGGING(3));
+}
+
+TEST(Log, Async) {
+    char name[] = "/tmp/p4c-log-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    ::Log::resetDebugSpecs();
+    ::Log::addDebugSpec((std::string("log_test:1>") + name).c_str());
+    LOG1("sync" << Log::endl << "second line");
+    ::Log::setAsync(true);
+    LOG1("async" << Log::endl << "second line");
+    ::Log::flushAsync();
+    ::Log::setAsync(false);
+    ::Log::resetDebugSpecs();
+
+    std::ifstream in(name);
+    std::stringstream text;
+    text << in.rdbuf();
+    EXPECT_EQ(text.str(), "sync\nsecond line\nasync\nsecond line\n");
+    unlink(name);
+}
+
+}  // namespace Test
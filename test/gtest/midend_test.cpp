@@ -21,8 +21,25 @@ limitations under the License.
 
 #include "frontends/common/parseInput.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/createBuiltins.h"
 #include "frontends/p4/typeMap.h"
+#include "lib/thread_pool.h"
+#include "midend/actionSynthesis.h"
+#include "midend/commonSubexpressionElimination.h"
 #include "midend/convertEnums.h"
+#include "midend/copyStructures.h"
+#include "midend/eliminateSwitch.h"
+#include "midend/expandEmit.h"
+#include "midend/fuseTables.h"
+#include "midend/headerFieldUsage.h"
+#include "midend/local_copyprop.h"
+#include "midend/mergeParserStates.h"
+#include "midend/parallelBlocks.h"
+#include "midend/predication.h"
+#include "midend/propagateActionData.h"
+#include "midend/removeUnusedStructFields.h"
+#include "midend/reorderKeys.h"
+#include "midend/specializeConstTables.h"
 
 using namespace P4;
 
@@ -39,6 +56,27 @@ class EnumOn32Bits : public ChooseEnumRepresentation {
     }
 };
 
+class CheapBranches : public PredicationPolicy {
+    unsigned branchCost() const override {
+        return 4;
+    }
+};
+
+class CoalesceActions : public ActionSynthesisPolicy {
+    bool convert(const Visitor::Context *, const IR::P4Control*) override {
+        return true;
+    }
+    bool coalesce() override {
+        return true;
+    }
+};
+
+class CopyPairs : public CopyStructuresPolicy {
+    bool copyAsBlock(const IR::Type_Struct* type) const override {
+        return type->name == "Pair";
+    }
+};
+
 }  // namespace
 
 class P4CMidend : public P4CTest { };
@@ -109,4 +147,577 @@ TEST_F(P4CMidend, getEnumMapping) {
     ASSERT_EQ(enumMap.size(), (unsigned long)1);
 }
 
+// running per-control passes in parallel gives the same program as running them in sequence
+TEST_F(P4CMidend, parallelBlocks_matches_sequential) {
+    std::string program = P4_SOURCE(R"(
+        control c(inout bit<8> a) {
+            bit<8> t;
+            apply { t = a + 1; a = t; }
+        }
+        control d(inout bit<8> b) {
+            bit<8> u;
+            apply { u = b; b = u + 2; }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    auto makePasses = [](ReferenceMap *refMap, TypeMap *typeMap) {
+        return new PassManager({ new P4::LocalCopyPropagation(refMap, typeMap) }); };
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    auto sequential = pgm->apply(ParallelBlocks(&refMap, &typeMap, makePasses));
+    Util::ThreadPool::setThreads(4);
+    ReferenceMap  parallelRefMap;
+    TypeMap       parallelTypeMap;
+    auto parallel = pgm->apply(ParallelBlocks(&parallelRefMap, &parallelTypeMap, makePasses));
+    Util::ThreadPool::setThreads(1);
+    ASSERT_TRUE(sequential != nullptr && parallel != nullptr && ::errorCount() == 0);
+    EXPECT_TRUE(parallel->equiv(*sequential));
+}
+
+TEST_F(P4CMidend, localCopyProp_removes_dead_locals) {
+    std::string program = P4_SOURCE(R"(
+        control c(inout bit<8> x, inout bit<8> y) {
+            action a() { bit<8> t = x; bit<8> u = t + 8w1; y = u; }
+            apply { bit<8> v = y; a(); x = v; }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::LocalCopyPropagation(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(0)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // t and u are propagated into y = x + 8w1 and removed
+    auto action = control->controlLocals.getDeclaration<IR::P4Action>("a");
+    ASSERT_NE(action, nullptr);
+    ASSERT_EQ(action->body->components.size(), 1u);
+    auto assign = action->body->components.at(0)->to<IR::AssignmentStatement>();
+    ASSERT_NE(assign, nullptr);
+    auto add = assign->right->to<IR::Add>();
+    ASSERT_NE(add, nullptr);
+    EXPECT_EQ(add->left->toString(), "x");
+    // the action writes y, so v keeps its value
+    EXPECT_EQ(control->body->components.size(), 3u);
+}
+
+TEST_F(P4CMidend, commonSubexpressionElimination) {
+    std::string program = P4_SOURCE(R"(
+        control c(inout bit<8> a, inout bit<8> b, out bit<8> x, out bit<8> y) {
+            apply {
+                x = (a + b) & 8w15;
+                y = (a + b) | 8w1;
+                a = a + b;
+                b = a + b;
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::CommonSubexpressionElimination(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(0)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // a + b is computed once into a new local, and again after a is written
+    EXPECT_EQ(control->controlLocals.size(), 1u);
+    auto& components = control->body->components;
+    ASSERT_EQ(components.size(), 5u);
+    auto compute = components.at(0)->to<IR::AssignmentStatement>();
+    ASSERT_NE(compute, nullptr);
+    EXPECT_TRUE(compute->right->is<IR::Add>());
+    auto reuse = components.at(3)->to<IR::AssignmentStatement>();
+    ASSERT_NE(reuse, nullptr);
+    EXPECT_TRUE(reuse->right->is<IR::PathExpression>());
+    auto last = components.at(4)->to<IR::AssignmentStatement>();
+    ASSERT_NE(last, nullptr);
+    EXPECT_TRUE(last->right->is<IR::Add>());
+}
+
+TEST_F(P4CMidend, removeDeadHeaderFieldWrites) {
+    std::string program = P4_SOURCE(R"(
+        header H { bit<8> f; bit<8> g; }
+        header H2 { bit<8> f; bit<8> g; }
+        struct Hs { H h; H2 h2; }
+        control c(inout Hs hdr, out bit<8> o, out H2 o2) {
+            apply {
+                hdr.h.f = 8w1;
+                hdr.h.g = 8w2;
+                o = hdr.h.g;
+                hdr.h2.f = 8w3;
+                o2 = hdr.h2;
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::RemoveDeadHeaderFieldWrites(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    // only the write to hdr.h.f is dead: hdr.h2 is copied as a whole
+    auto control = pgm->objects.at(3)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    EXPECT_EQ(control->body->components.size(), 4u);
+
+    P4::HeaderFieldUsage usage;
+    pgm->apply(P4::FindHeaderFieldUsage(&refMap, &typeMap, &usage));
+    auto h = pgm->objects.at(0)->to<IR::Type_Header>();
+    auto h2 = pgm->objects.at(1)->to<IR::Type_Header>();
+    ASSERT_TRUE(h != nullptr && h2 != nullptr);
+    EXPECT_FALSE(usage.isRead(h, "f"));
+    EXPECT_TRUE(usage.isRead(h, "g"));
+    EXPECT_TRUE(usage.isRead(h2, "f"));
+    EXPECT_TRUE(usage.isModified(h));
+    EXPECT_FALSE(usage.isWritten(h, "f"));
+    EXPECT_FALSE(usage.isExtracted(h));
+}
+
+TEST_F(P4CMidend, mergeParserStates) {
+    std::string program = P4_SOURCE(R"(
+        extern packet_in {
+            void extract<T>(out T hdr);
+        }
+        header H { bit<8> a; }
+        struct Hs { H x; H y; H z; H w; }
+        parser p(packet_in pk, out Hs h, in bit<8> sel) {
+            state start { transition select(sel) { 8w1: a; default: b; } }
+            state a { pk.extract<H>(h.x); transition c; }
+            state b { pk.extract<H>(h.y); transition c; }
+            state c { pk.extract<H>(h.z); pk.extract<H>(h.w); transition accept; }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    pgm = pgm->apply(P4::CreateBuiltins());
+
+    ReferenceMap        refMap;
+    TypeMap             typeMap;
+    ParserExtractRuns   runs;
+    auto merged = pgm->apply(P4::MergeParserStates(&refMap, &typeMap, nullptr, &runs));
+    ASSERT_TRUE(merged != nullptr && ::errorCount() == 0);
+    // c is copied into a and b, and removed
+    auto parser = merged->objects.at(3)->to<IR::P4Parser>();
+    ASSERT_NE(parser, nullptr);
+    EXPECT_EQ(parser->states.size(), 5u);
+    EXPECT_EQ(parser->states.getDeclaration("c"), nullptr);
+    auto a = parser->states.getDeclaration<IR::ParserState>("a");
+    ASSERT_NE(a, nullptr);
+    ASSERT_EQ(a->components.size(), 3u);
+    // the three extracts need one length check
+    auto first = a->components.at(0)->to<IR::MethodCallStatement>();
+    EXPECT_EQ(runs.runWidth(first), 24u);
+    EXPECT_FALSE(runs.isCovered(first));
+    EXPECT_TRUE(runs.isCovered(a->components.at(2)->to<IR::MethodCallStatement>()));
+
+    // a policy that copies nothing keeps c
+    MergeParserStatesPolicy never(0);
+    ReferenceMap        refMap2;
+    TypeMap             typeMap2;
+    merged = pgm->apply(P4::MergeParserStates(&refMap2, &typeMap2, &never));
+    ASSERT_TRUE(merged != nullptr && ::errorCount() == 0);
+    parser = merged->objects.at(3)->to<IR::P4Parser>();
+    ASSERT_NE(parser, nullptr);
+    EXPECT_EQ(parser->states.size(), 6u);
+}
+
+TEST_F(P4CMidend, eliminateSwitch_keeps_dense_switches) {
+    std::string program = P4_SOURCE(R"(
+        control c(in bit<8> x, out bit<8> y) {
+            apply {
+                switch (x) {
+                    8w1: { y = 8w10; }
+                    8w2:
+                    8w3: { y = 8w20; }
+                    8w5: { y = 8w30; }
+                    default: { y = 8w0; }
+                }
+                switch (x) {
+                    8w1: { y = 8w10; }
+                    8w100: { y = 8w20; }
+                    8w200: { y = 8w30; }
+                    8w250: { y = 8w40; }
+                }
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::EliminateSwitch(&refMap, &typeMap, nullptr, true));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(0)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // the first switch is kept, the second one is replaced by a table
+    auto& components = control->body->components;
+    ASSERT_EQ(components.size(), 2u);
+    auto dense = components.at(0)->to<IR::SwitchStatement>();
+    ASSERT_NE(dense, nullptr);
+    EXPECT_EQ(dense->expression->toString(), "x");
+    EXPECT_TRUE(components.at(1)->is<IR::BlockStatement>());
+    size_t tables = 0;
+    for (auto local : control->controlLocals)
+        if (local->is<IR::P4Table>())
+            tables++;
+    EXPECT_EQ(tables, 1u);
+}
+
+TEST_F(P4CMidend, specializeConstTables) {
+    std::string program = P4_SOURCE(R"(
+        match_kind { exact, ternary }
+        control c(in bit<8> x, out bit<8> y) {
+            action a(bit<8> v) { y = v; }
+            action b() { y = 8w0; }
+            table t {
+                key = { x : exact; }
+                actions = { a; b; }
+                const entries = {
+                    8w5 : a(8w1);
+                    8w1 : a(8w2);
+                    8w9 : a(8w3);
+                    8w3 : a(8w4);
+                }
+                default_action = b();
+            }
+            apply { t.apply(); }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    pgm = pgm->apply(P4::CreateBuiltins());
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::SpecializeConstTables(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(1)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // the table is gone, and its entries are searched by comparing x with 8w5
+    EXPECT_EQ(control->controlLocals.getDeclaration("t"), nullptr);
+    ASSERT_EQ(control->body->components.size(), 1u);
+    auto search = control->body->components.at(0)->to<IR::IfStatement>();
+    ASSERT_NE(search, nullptr);
+    auto lss = search->condition->to<IR::Lss>();
+    ASSERT_NE(lss, nullptr);
+    EXPECT_EQ(lss->right->to<IR::Constant>()->asInt(), 5);
+
+    // the new code type checks
+    ReferenceMap  refMap2;
+    TypeMap       typeMap2;
+    pgm->apply(TypeChecking(&refMap2, &typeMap2));
+    EXPECT_EQ(::errorCount(), 0u);
+}
+
+TEST_F(P4CMidend, reorderKeys) {
+    std::string program = P4_SOURCE(R"(
+        match_kind { exact }
+        header ip_t { bit<8> proto; bit<16> csum; bit<32> src; bit<32> dst; }
+        struct Hs { ip_t ip; }
+        control c(inout Hs h, in bit<9> port) {
+            action b() {}
+            table t {
+                key = { port : exact; h.ip.proto : exact; h.ip.src : exact; h.ip.dst : exact; }
+                actions = { b; }
+                const entries = { (9w1, 8w2, 32w3, 32w4) : b(); }
+            }
+            apply { t.apply(); }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    pgm = pgm->apply(P4::CreateBuiltins());
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::ReorderKeys(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(3)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    auto table = control->controlLocals.getDeclaration<IR::P4Table>("t");
+    ASSERT_NE(table, nullptr);
+    // src and dst are adjacent in the header and copied as 8 bytes, then port and proto
+    auto& elements = table->getKey()->keyElements;
+    ASSERT_EQ(elements.size(), 4u);
+    EXPECT_EQ(elements.at(0)->expression->toString(), "h.ip.src");
+    EXPECT_EQ(elements.at(1)->expression->toString(), "h.ip.dst");
+    EXPECT_EQ(elements.at(2)->expression->toString(), "port");
+    EXPECT_EQ(elements.at(3)->expression->toString(), "h.ip.proto");
+    auto keysets = table->getEntries()->entries.at(0)->keys->components;
+    ASSERT_EQ(keysets.size(), 4u);
+    EXPECT_EQ(keysets.at(0)->to<IR::Constant>()->asInt(), 3);
+    EXPECT_EQ(keysets.at(2)->to<IR::Constant>()->asInt(), 1);
+}
+
+TEST_F(P4CMidend, fuseTables) {
+    std::string program = P4_SOURCE(R"(
+        match_kind { exact }
+        header H { bit<8> x; bit<8> y; }
+        control c(inout H h) {
+            action a() { h.y = 1; }
+            action n() {}
+            action b(bit<8> v) { h.y = v; }
+            action w() { h.x = 1; }
+            @fuse table t1 { key = { h.x : exact; } actions = { a; n; } default_action = n(); }
+            @fuse table t2 { key = { h.x : exact; } actions = { b; w; } default_action = b(0); }
+            table t3 { key = { h.x : exact; } actions = { n; } default_action = n(); }
+            apply { t1.apply(); t2.apply(); t3.apply(); }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    pgm = pgm->apply(P4::CreateBuiltins());
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::FuseTables(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(2)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // t3 is not fused with t1_t2 because w writes the key
+    auto table = control->controlLocals.getDeclaration<IR::P4Table>("t1_t2");
+    ASSERT_NE(table, nullptr);
+    EXPECT_EQ(table->getActionList()->size(), 4u);
+    auto defaultAction = table->getDefaultAction()->to<IR::MethodCallExpression>();
+    ASSERT_NE(defaultAction, nullptr);
+    EXPECT_EQ(defaultAction->method->toString(), "n_b");
+    EXPECT_EQ(defaultAction->arguments->size(), 1u);
+    EXPECT_NE(control->controlLocals.getDeclaration<IR::P4Table>("t3"), nullptr);
+    EXPECT_EQ(control->controlLocals.getDeclaration("t1"), nullptr);
+    EXPECT_EQ(control->body->components.size(), 2u);
+}
+
+TEST_F(P4CMidend, copyStructures_keeps_block_copies) {
+    std::string program = P4_SOURCE(R"(
+        struct Pair { bit<8> a; bit<8> b; }
+        struct Other { bit<8> a; bit<8> b; }
+        control c(inout Pair p, inout Other o) {
+            apply {
+                Pair q;
+                Other r;
+                q = p;
+                r = o;
+                p = q;
+                o = r;
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    CopyPairs     policy;
+    pgm = pgm->apply(P4::CopyStructures(&refMap, &typeMap, true, nullptr, &policy));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(2)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // Copies of Pair stay whole, copies of Other are split into fields
+    unsigned pairs = 0, fields = 0;
+    forAllMatching<IR::AssignmentStatement>(control->body,
+                                            [&](const IR::AssignmentStatement* statement) {
+        auto type = typeMap.getType(statement->left, true);
+        if (type->is<IR::Type_Struct>())
+            pairs++;
+        else
+            fields++; });
+    EXPECT_EQ(pairs, 2u);
+    EXPECT_EQ(fields, 4u);
+}
+
+TEST_F(P4CMidend, predication_shares_guards_and_keeps_cheap_branches) {
+    std::string program = P4_SOURCE(R"(
+        header H { bit<8> x; bit<8> y; bit<8> z; }
+        control c(inout H h) {
+            action a() {
+                if (h.x == 8w1) { h.y = 8w1; } else { h.y = 8w2; }
+                if (h.x == 8w1) { h.z = 8w3; }
+            }
+            action b() {
+                if (h.x == 8w1) { h.y = 8w1; h.z = 8w1; h.y = 8w3; h.z = 8w4; }
+            }
+            apply {}
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    CheapBranches policy;
+    pgm = pgm->apply(P4::Predication(&refMap, &policy));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(1)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // Both ifs of a are merged and predicated with a single condition temporary
+    auto a = control->controlLocals.getDeclaration<IR::P4Action>("a");
+    unsigned temporaries = 0, ifs = 0;
+    forAllMatching<IR::Declaration_Variable>(a, [&](const IR::Declaration_Variable*) {
+        temporaries++; });
+    forAllMatching<IR::IfStatement>(a, [&](const IR::IfStatement*) { ifs++; });
+    EXPECT_EQ(temporaries, 1u);
+    EXPECT_EQ(ifs, 0u);
+    // The selects of b cost more than a branch
+    auto b = control->controlLocals.getDeclaration<IR::P4Action>("b");
+    forAllMatching<IR::IfStatement>(b, [&](const IR::IfStatement*) { ifs++; });
+    EXPECT_EQ(ifs, 1u);
+}
+
+TEST_F(P4CMidend, propagateActionData) {
+    std::string program = P4_SOURCE(R"(
+        match_kind { exact }
+        header H { bit<8> x; bit<8> y; }
+        control c(inout H h) {
+            action a(bit<8> v) { h.y = v + 1; }
+            action b(bit<8> w) { h.x = w; }
+            table t {
+                key = { h.x : exact; }
+                actions = { a; }
+                const entries = { 1 : a(3); 2 : a(3); }
+                const default_action = a(3);
+            }
+            table u {
+                key = { h.x : exact; }
+                actions = { b; }
+                const default_action = b(3);
+            }
+            apply { t.apply(); u.apply(); }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    pgm = pgm->apply(P4::CreateBuiltins());
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::PropagateActionData(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(2)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // v is always 3, so h.y = v + 1 folds to 4
+    auto a = control->controlLocals.getDeclaration<IR::P4Action>("a");
+    auto assign = a->body->components.at(0)->to<IR::AssignmentStatement>();
+    ASSERT_NE(assign, nullptr);
+    ASSERT_TRUE(assign->right->is<IR::Constant>());
+    EXPECT_EQ(assign->right->to<IR::Constant>()->asInt(), 4);
+    // The control plane can add entries of u with any value of w
+    auto b = control->controlLocals.getDeclaration<IR::P4Action>("b");
+    assign = b->body->components.at(0)->to<IR::AssignmentStatement>();
+    ASSERT_NE(assign, nullptr);
+    EXPECT_TRUE(assign->right->is<IR::PathExpression>());
+}
+
+TEST_F(P4CMidend, synthesizeActions_coalesces) {
+    std::string program = P4_SOURCE(R"(
+        header H { bit<8> x; bit<8> y; bit<8> z; }
+        control c(inout H h) {
+            apply {
+                h.x = 1;
+                if (h.y == 2) { h.y = 3; }
+                h.z = 4;
+                if (h.y == 5) { h.x = 6; }
+                h.y = 7;
+                if (h.z == 1) { h.x = 6; }
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    pgm = pgm->apply(P4::CreateBuiltins());
+
+    ReferenceMap    refMap;
+    TypeMap         typeMap;
+    CoalesceActions policy;
+    pgm = pgm->apply(P4::SynthesizeActions(&refMap, &typeMap, &policy));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(1)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    // h.z = 4 joins h.x = 1 before the first if, but h.y = 7 stays after the if reading
+    // h.y, and both ifs setting h.x call the same action
+    unsigned actions = 0;
+    for (auto decl : control->controlLocals)
+        if (decl->is<IR::P4Action>()) actions++;
+    EXPECT_EQ(actions, 4u);
+    auto &body = control->body->components;
+    ASSERT_EQ(body.size(), 5u);
+    auto first = body.at(0)->to<IR::MethodCallStatement>();
+    ASSERT_NE(first, nullptr);
+    auto name = first->methodCall->method->to<IR::PathExpression>()->path->name;
+    auto action = control->controlLocals.getDeclaration<IR::P4Action>(name);
+    ASSERT_NE(action, nullptr);
+    EXPECT_EQ(action->body->components.size(), 2u);
+    EXPECT_TRUE(body.at(3)->is<IR::MethodCallStatement>());
+}
+
+TEST_F(P4CMidend, removeUnusedStructFields) {
+    std::string program = P4_SOURCE(R"(
+        extern void f<T>(in T x);
+        struct M { bit<8> used; bit<8> unused; @field_list(1) bit<8> listed; }
+        struct W { bit<8> a; bit<8> b; }
+        control d(inout M m) { apply { m.used = 1; } }
+        control c(inout M m) {
+            d() x;
+            W w;
+            apply { x.apply(m); f(w); }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::RemoveUnusedStructFields(&refMap, &typeMap));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    // passing m to d uses only the fields d uses, but W is used as a whole by f
+    auto m = pgm->objects.at(1)->to<IR::Type_Struct>();
+    ASSERT_NE(m, nullptr);
+    ASSERT_EQ(m->fields.size(), 2u);
+    EXPECT_EQ(m->fields.at(0)->name, "used");
+    EXPECT_EQ(m->fields.at(1)->name, "listed");
+    auto w = pgm->objects.at(2)->to<IR::Type_Struct>();
+    ASSERT_NE(w, nullptr);
+    EXPECT_EQ(w->fields.size(), 2u);
+}
+
+TEST_F(P4CMidend, expandEmit_header_runs) {
+    std::string program = P4_SOURCE(R"(
+        extern packet_out { void emit<T>(in T hdr); }
+        header H1 { bit<8> a; }
+        header H2 { bit<16> b; }
+        header HV { bit<8> len; varbit<64> data; }
+        struct S { H1 h1; H2[2] h2; HV v; H1 last; }
+        control d(packet_out p, in S s) { apply { p.emit(s); } }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    pgm = pgm->apply(P4::ExpandEmit(&refMap, &typeMap, nullptr, true));
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+    auto control = pgm->objects.at(5)->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    auto block = control->body->components.at(0)->to<IR::BlockStatement>();
+    ASSERT_NE(block, nullptr);
+    // h1 and h2 form one run, which the varbit header ends; last is on its own
+    ASSERT_EQ(block->components.size(), 3u);
+    auto run = block->components.at(0)->to<IR::BlockStatement>();
+    ASSERT_NE(run, nullptr);
+    EXPECT_EQ(run->components.size(), 3u);
+    auto layout = run->annotations->getSingle(P4::DoExpandEmit::headerRunAnnotation);
+    ASSERT_NE(layout, nullptr);
+    ASSERT_EQ(layout->expr.size(), 3u);
+    EXPECT_EQ(layout->expr.at(0)->to<IR::Constant>()->asInt(), 8);
+    EXPECT_EQ(layout->expr.at(2)->to<IR::Constant>()->asInt(), 16);
+    EXPECT_TRUE(block->components.at(1)->is<IR::MethodCallStatement>());
+    EXPECT_TRUE(block->components.at(2)->is<IR::MethodCallStatement>());
+}
+
 }  // namespace Test
@@ -0,0 +1,79 @@
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "frontends/p4/removeReturns.h"
+#include "lib/thread_pool.h"
+
+namespace Test {
+
+namespace {
+
+/// switch (t.apply().action_run) with @count cases, of which the cases in @exits end
+/// with an exit and the ones in @returns with a return.  The last case also holds
+/// @nested, if it is not null.
+const IR::SwitchStatement *makeSwitch(unsigned count, std::set<unsigned> exits,
+                                      std::set<unsigned> returns,
+                                      const IR::Statement *nested = nullptr) {
+    IR::Vector<IR::SwitchCase> cases;
+    for (unsigned i = 0; i < count; ++i) {
+        auto body = new IR::BlockStatement;
+        body->components.push_back(new IR::AssignmentStatement(
+            new IR::PathExpression("x"), new IR::Constant(static_cast<int>(i))));
+        if (exits.count(i))
+            body->components.push_back(new IR::ExitStatement());
+        if (returns.count(i))
+            body->components.push_back(new IR::ReturnStatement(nullptr));
+        if (nested && i == count - 1)
+            body->components.push_back(nested);
+        cases.push_back(new IR::SwitchCase(
+            new IR::PathExpression(cstring("a" + std::to_string(i))), body));
+    }
+    return new IR::SwitchStatement(
+        new IR::Member(new IR::PathExpression("t"), "action_run"), cases);
+}
+
+struct Result {
+    bool hasExits, hasReturns;
+    bool operator==(const Result &r) const {
+        return hasExits == r.hasExits && hasReturns == r.hasReturns; }
+};
+
+Result hasExits(const IR::Node *node, unsigned threads) {
+    Util::ThreadPool::setThreads(threads);
+    P4::HasExits he;
+    node->apply(he);
+    Util::ThreadPool::setThreads(1);
+    return { he.hasExits, he.hasReturns };
+}
+
+}  // namespace
+
+// the cases of a switch visited on several threads give the same result as a serial walk
+TEST(ParallelVisit, HasExitsMatchesSerial) {
+    std::vector<const IR::Node *> programs = {
+        makeSwitch(16, {}, {}),
+        makeSwitch(16, {0}, {}),
+        makeSwitch(16, {15}, {}),
+        makeSwitch(16, {}, {7}),
+        makeSwitch(16, {3}, {12}),
+        makeSwitch(2, {1}, {1}),
+    };
+    // a switch nested in a case of another
+    programs.push_back(makeSwitch(8, {}, {}, makeSwitch(8, {5}, {})));
+
+    for (auto program : programs) {
+        auto serial = hasExits(program, 1);
+        EXPECT_TRUE(hasExits(program, 4) == serial);
+        EXPECT_TRUE(hasExits(program, 8) == serial);
+    }
+    EXPECT_FALSE(hasExits(programs[0], 4).hasExits);
+    EXPECT_TRUE(hasExits(programs[2], 4).hasExits);
+    EXPECT_TRUE(hasExits(programs[3], 4).hasReturns);
+    EXPECT_TRUE(hasExits(programs.back(), 4).hasExits);
+    EXPECT_FALSE(hasExits(programs.back(), 4).hasReturns);
+}
+
+}  // namespace Test
@@ -0,0 +1,105 @@
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/p4/parseAnnotations.h"
+#include "frontends/parsers/parserDriver.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace Test {
+
+namespace {
+
+class TestAnnotations : public P4::ParseAnnotations {
+ public:
+    TestAnnotations() : P4::ParseAnnotations("Test", true, {
+        PARSE_PAIR("pair", Constant),
+        PARSE("flag", Expression),
+        PARSE("sum", Expression),
+        PARSE_CONSTANT_OR_STRING_LITERAL_LIST("mixed"),
+        PARSE_STRING_LITERAL_LIST("names"),
+    }) {}
+};
+
+const IR::P4Program *parseWithAnnotations(const std::string &text) {
+    std::istringstream in(text);
+    auto *program = P4::P4ParserDriver::parse(in, "annotations.p4");
+    if (!program) return nullptr;
+    return program->apply(TestAnnotations());
+}
+
+const IR::Annotation *annotation(const IR::P4Program *program, cstring decl, cstring name) {
+    for (auto *node : program->objects)
+        if (auto *c = node->to<IR::Declaration_Constant>())
+            if (c->name == decl) return c->getAnnotation(name);
+    return nullptr;
+}
+
+}  // namespace
+
+class ParseAnnotationsTest : public P4CTest {};
+
+TEST_F(ParseAnnotationsTest, Literals) {
+    auto *program = parseWithAnnotations(
+        "@name(\"c\") @length(8w8) @pair(1, 2) @flag(true) @mixed(3, \"x\")\n"
+        "@names(\"y\", \"z\") @sum(1 + 2)\n"
+        "const bit<8> c = 1;\n");
+    ASSERT_NE(program, nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+
+    auto *name = annotation(program, "c", "name");
+    ASSERT_NE(name, nullptr);
+    EXPECT_FALSE(name->needsParsing);
+    ASSERT_EQ(name->expr.size(), 1u);
+    auto *literal = name->expr[0]->to<IR::StringLiteral>();
+    ASSERT_NE(literal, nullptr);
+    EXPECT_EQ(literal->value, "c");
+    EXPECT_EQ(literal->srcInfo.toPositionString(), name->body[0]->srcInfo.toPositionString());
+
+    auto *length = annotation(program, "c", "length")->expr[0]->to<IR::Constant>();
+    ASSERT_NE(length, nullptr);
+    EXPECT_EQ(length->asInt(), 8);
+    EXPECT_TRUE(length->type->is<IR::Type_Bits>());
+
+    auto *pair = annotation(program, "c", "pair");
+    ASSERT_EQ(pair->expr.size(), 2u);
+    EXPECT_EQ(pair->expr[1]->to<IR::Constant>()->asInt(), 2);
+
+    auto *flag = annotation(program, "c", "flag")->expr[0]->to<IR::BoolLiteral>();
+    ASSERT_NE(flag, nullptr);
+    EXPECT_TRUE(flag->value);
+
+    auto *mixed = annotation(program, "c", "mixed");
+    ASSERT_EQ(mixed->expr.size(), 2u);
+    EXPECT_TRUE(mixed->expr[0]->is<IR::Constant>());
+    EXPECT_TRUE(mixed->expr[1]->is<IR::StringLiteral>());
+
+    auto *names = annotation(program, "c", "names");
+    ASSERT_EQ(names->expr.size(), 2u);
+    EXPECT_EQ(names->expr[1]->to<IR::StringLiteral>()->value, "z");
+
+    // not only literals, so parsed by the parser
+    auto *sum = annotation(program, "c", "sum")->expr[0]->to<IR::Add>();
+    ASSERT_NE(sum, nullptr);
+    EXPECT_EQ(sum->right->to<IR::Constant>()->asInt(), 2);
+}
+
+TEST_F(ParseAnnotationsTest, AfterAnError) {
+    // the body of the first @length is not an expression; those after it still parse
+    auto *program = parseWithAnnotations(
+        "@length(1 +) const bit<8> c = 1;\n"
+        "@length(2 * 3) @mixed(4, c) const bit<8> d = 2;\n"
+        "@sum(c + d) const bit<8> e = 3;\n");
+    ASSERT_NE(program, nullptr);
+    EXPECT_EQ(::errorCount(), 2u);
+    EXPECT_TRUE(annotation(program, "c", "length")->needsParsing);
+    EXPECT_TRUE(annotation(program, "d", "mixed")->needsParsing);
+    EXPECT_TRUE(annotation(program, "d", "length")->expr[0]->is<IR::Mul>());
+    auto *sum = annotation(program, "e", "sum")->expr[0]->to<IR::Add>();
+    ASSERT_NE(sum, nullptr);
+    EXPECT_EQ(sum->left->to<IR::PathExpression>()->path->name, "c");
+}
+
+}  // namespace Test
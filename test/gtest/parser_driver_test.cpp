@@ -0,0 +1,68 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/parsers/parserDriver.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+#include "lib/thread_pool.h"
+
+namespace Test {
+
+class ParserDriverTest : public P4CTest {
+ protected:
+    void TearDown() override { Util::ThreadPool::setThreads(1); }
+};
+
+TEST_F(ParserDriverTest, ParsesConcurrently) {
+    // P4-16 and P4-14 programs, one of them with a syntax error at its fourth line
+    const size_t count = 16, bad = 6;
+    std::vector<std::string> sources;
+    for (size_t i = 0; i < count; ++i) {
+        std::stringstream text;
+        if (i % 2) {
+            text << "header_type h" << i << "_t { fields { f : " << i + 1 << "; } }\n";
+        } else {
+            for (size_t j = 0; j < 3; ++j)
+                text << "const bit<8> c" << i << "_" << j << " = " << j << ";\n";
+            if (i == bad) text << "const bit<8> = 1;\n"; }
+        sources.push_back(text.str()); }
+
+    Util::ThreadPool::setThreads(4);
+    std::vector<const IR::Node*> programs(count);
+    std::vector<ErrorReporter::Deferred> deferred(count);
+    Util::ThreadPool::global().parallel_for(count, [&](size_t i) {
+        ErrorReporter::Deferred::Scope keep(deferred[i]);
+        std::istringstream in(sources[i]);
+        std::string file = "prog" + std::to_string(i) + ".p4";
+        if (i % 2)
+            programs[i] = V1::V1ParserDriver::parse(in, file.c_str());
+        else
+            programs[i] = P4::P4ParserDriver::parse(in, file.c_str()); });
+    EXPECT_EQ(::errorCount(), 0u);
+    for (auto &d : deferred)
+        BaseCompileContext::get().errorReporter().emit(d);
+    EXPECT_EQ(::errorCount(), 1u);
+
+    for (size_t i = 0; i < count; ++i) {
+        SCOPED_TRACE(i);
+        if (i == bad) {
+            EXPECT_EQ(programs[i], nullptr);
+        } else if (i % 2) {
+            auto *program = programs[i] ? programs[i]->to<IR::V1Program>() : nullptr;
+            ASSERT_NE(program, nullptr);
+            EXPECT_NE(program->get<IR::v1HeaderType>("h" + std::to_string(i) + "_t"), nullptr);
+        } else {
+            auto *program = programs[i] ? programs[i]->to<IR::P4Program>() : nullptr;
+            ASSERT_NE(program, nullptr);
+            ASSERT_EQ(program->objects.size(), 3u);
+            // each program has its own input sources, so its own file and line numbers
+            auto last = program->objects.back()->srcInfo.toPosition();
+            EXPECT_EQ(last.fileName.c_str(), "prog" + std::to_string(i) + ".p4");
+            EXPECT_EQ(last.sourceLine, 3u);
+        } }
+}
+
+}  // namespace Test
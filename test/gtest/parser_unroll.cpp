@@ -8,6 +8,7 @@
 #include "ir/ir.h"
 #include "helpers.h"
 #include "lib/log.h"
+#include "lib/thread_pool.h"
 
 #include "frontends/common/parseInput.h"
 
@@ -144,14 +145,14 @@ class MidEnd : public PassManager {
                     // nothing further to do
                     return nullptr;
                 // Special handling when compiling for v1model.p4
-                if (main->type->name == P4V1::V1Model::instance.sw.name) {
+                if (main->type->name == P4V1::V1Model::instance().sw.name) {
                     if (main->getConstructorParameters()->size() != 6)
                         return root;
-                    auto verify = main->getParameterValue(P4V1::V1Model::instance.sw.verify.name);
+                    auto verify = main->getParameterValue(P4V1::V1Model::instance().sw.verify.name);
                     auto update = main->getParameterValue(
-                        P4V1::V1Model::instance.sw.compute.name);
+                        P4V1::V1Model::instance().sw.compute.name);
                     auto deparser = main->getParameterValue(
-                                    P4V1::V1Model::instance.sw.deparser.name);
+                                    P4V1::V1Model::instance().sw.deparser.name);
                     if (verify == nullptr || update == nullptr || deparser == nullptr ||
                         !verify->is<IR::ControlBlock>() || !update->is<IR::ControlBlock>() ||
                         !deparser->is<IR::ControlBlock>()) {
@@ -311,4 +312,44 @@ TEST_F(P4CParserUnroll, t1_Cond) {
     ASSERT_EQ(parsers.first->states.size(), parsers.second->states.size());
 }
 
+/// Parsers p0 ... p5, each with the states start and s1.
+static const IR::P4Program* manyParsers() {
+    auto program = new IR::P4Program();
+    auto b8 = IR::Type_Bits::get(8);
+    for (int i = 0; i < 6; i++) {
+        cstring name = "p" + Util::toString(i);
+        auto params = new IR::ParameterList({
+            new IR::Parameter("x", IR::Direction::InOut, b8) });
+        auto x = new IR::PathExpression("x");
+        auto start = new IR::ParserState("start", {
+                new IR::AssignmentStatement(x, new IR::Add(x, new IR::Constant(b8, i))) },
+            new IR::SelectExpression(new IR::ListExpression({ x }), {
+                new IR::SelectCase(new IR::Constant(b8, 0), new IR::PathExpression("accept")),
+                new IR::SelectCase(new IR::DefaultExpression(), new IR::PathExpression("s1")) }));
+        auto s1 = new IR::ParserState("s1", {
+            new IR::AssignmentStatement(x, new IR::Constant(b8, 3)) },
+            new IR::PathExpression("accept"));
+        IR::IndexedVector<IR::ParserState> states({ start, s1,
+            new IR::ParserState(IR::ParserState::accept, nullptr),
+            new IR::ParserState(IR::ParserState::reject, nullptr) });
+        program->objects.push_back(
+            new IR::P4Parser(name, new IR::Type_Parser(name, params), states));
+    }
+    return program;
+}
+
+TEST_F(P4CParserUnroll, parallel_matches_sequential) {
+    auto program = manyParsers();
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    auto sequential = program->apply(ParsersUnroll(true, &refMap, &typeMap));
+    Util::ThreadPool::setThreads(4);
+    ReferenceMap parallelRefMap;
+    TypeMap parallelTypeMap;
+    auto parallel = program->apply(ParsersUnroll(true, &parallelRefMap, &parallelTypeMap));
+    Util::ThreadPool::setThreads(1);
+    ASSERT_TRUE(sequential != nullptr && parallel != nullptr && ::errorCount() == 0);
+    EXPECT_TRUE(parallel->equiv(*sequential));
+}
+
 }  // namespace Test
@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/pattern.h"
+
+namespace Test {
+
+class PatternTest : public P4CTest { };
+
+TEST_F(PatternTest, StaticMatchesLikePattern) {
+    auto *x = new IR::PathExpression("x");
+    auto *y = new IR::PathExpression("y");
+    const IR::Expression *e = new IR::BOr(new IR::BAnd(new IR::Constant(3), x),
+                                          new IR::BAnd(y, new IR::Constant(12)));
+
+    Pattern::Match<IR::Expression> pa, pb;
+    Pattern::Match<IR::Constant> pmaskA, pmaskB;
+    ASSERT_TRUE(((pa & pmaskA) | (pb & pmaskB)).match(e));
+
+    const IR::Expression *a, *b;
+    const IR::Constant *maskA, *maskB;
+    using StaticPattern::bind;
+    ASSERT_TRUE(((bind(a) & bind(maskA)) | (bind(b) & bind(maskB))).match(e));
+    // & commutes, so the constant may be on either side
+    EXPECT_EQ(x, a);
+    EXPECT_EQ(a, static_cast<const IR::Expression *>(pa));
+    EXPECT_EQ(y, b);
+    EXPECT_EQ(3, maskA->asInt());
+    EXPECT_EQ(12, maskB->asInt());
+    EXPECT_FALSE(((bind(a) & bind(maskA)) | (bind(b) & bind(maskB))).match(x));
+}
+
+TEST_F(PatternTest, StaticOperators) {
+    auto *x = new IR::PathExpression("x");
+    const IR::Expression *a;
+    using StaticPattern::any;
+    using StaticPattern::bind;
+    using StaticPattern::match;
+
+    EXPECT_TRUE(match(new IR::Add(x, new IR::Constant(0)), bind(a) + 0));
+    EXPECT_TRUE(match(new IR::Add(new IR::Constant(0), x), bind(a) + 0));
+    EXPECT_FALSE(match(new IR::Add(x, new IR::Constant(1)), bind(a) + 0));
+    EXPECT_TRUE(match(new IR::Sub(new IR::Constant(0), x), 0 - bind(a)));
+    // - does not commute
+    EXPECT_FALSE(match(new IR::Sub(x, new IR::Constant(0)), 0 - bind(a)));
+    EXPECT_TRUE(match(new IR::Neg(x), -any<IR::PathExpression>()));
+    EXPECT_FALSE(match(new IR::Neg(new IR::Constant(1)), -any<IR::PathExpression>()));
+    EXPECT_TRUE(match(new IR::LNot(new IR::Equ(x, x)), !(bind(a) == a)));
+    EXPECT_EQ(x, a);
+}
+
+}  // namespace Test
@@ -0,0 +1,27 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "lib/perf_counters.h"
+
+namespace Test {
+
+class PerfCountersTest : public P4CTest { };
+
+TEST_F(PerfCountersTest, CountsPageFaults) {
+    using Util::PerfCounters;
+    if (!PerfCounters::enable()) {
+        // not available here: everything reads as 0
+        auto none = PerfCounters::read();
+        for (int i = 0; i < PerfCounters::COUNT; ++i)
+            EXPECT_EQ(none.value[i], 0u) << PerfCounters::name(PerfCounters::Counter(i));
+        return; }
+    auto before = PerfCounters::read();
+    std::vector<char> touched(16 << 20, 1);
+    auto counts = PerfCounters::read() - before;
+    EXPECT_GT(counts.value[PerfCounters::PAGE_FAULTS], 0u);
+    EXPECT_EQ(touched[12345], 1);
+    EXPECT_STREQ(PerfCounters::name(PerfCounters::CACHE_MISSES), "cache_misses");
+}
+
+}  // namespace Test
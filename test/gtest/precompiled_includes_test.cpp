@@ -0,0 +1,117 @@
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/common/precompiledIncludes.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace Test {
+
+namespace {
+
+/// The preprocessed text of a program including the header @header from @dir.
+std::string preprocessed(const std::string &dir, const std::string &header) {
+    return "# 1 \"prog.p4\"\n"
+           "# 1 \"" + dir + "/arch.p4\" 1\n" + header +
+           "# 2 \"prog.p4\" 2\n"
+           "header h_t { bit<8> f; }\n"
+           "error { Other }\n"
+           "parser p(packet_in b, out h_t h) {\n"
+           "    state start { b.extract<h_t>(h); transition accept; }\n"
+           "}\n"
+           "Top(p()) main;\n";
+}
+
+const char *header =
+    "error { NoError }\n"
+    "match_kind { exact }\n"
+    "extern packet_in { void extract<T>(out T hdr); }\n"
+    "extern Checksum<W> { Checksum(); W get(); }\n"
+    "struct standard_t { bit<9> port; }\n"
+    "parser P<H>(packet_in b, out H h);\n"
+    "package Top<H>(P<H> p);\n"
+    "action NoAction() {}\n";
+
+unsigned countFiles(const std::string &dir) {
+    unsigned rv = 0;
+    if (DIR *d = opendir(dir.c_str())) {
+        while (auto *entry = readdir(d))
+            if (entry->d_name[0] != '.') ++rv;
+        closedir(d); }
+    return rv;
+}
+
+}  // namespace
+
+class PrecompiledIncludesTest : public P4CTest {
+ protected:
+    std::string dir;
+    const char *savedIncludePath = nullptr;
+
+    void SetUp() override {
+        char name[] = "/tmp/p4c-precompiled-XXXXXX";
+        ASSERT_NE(mkdtemp(name), nullptr);
+        dir = name;
+        savedIncludePath = p4includePath;
+        p4includePath = dir.c_str();
+        auto &options = P4CContext::get().options();
+        options.file = "prog.p4";
+        options.precompiledIncludesDir = dir;
+    }
+    void TearDown() override {
+        p4includePath = savedIncludePath;
+        if (DIR *d = opendir(dir.c_str())) {
+            while (auto *entry = readdir(d))
+                if (entry->d_name[0] != '.') unlink((dir + "/" + entry->d_name).c_str());
+            closedir(d); }
+        rmdir(dir.c_str());
+    }
+};
+
+TEST_F(PrecompiledIncludesTest, Prefix) {
+    auto text = preprocessed(dir, header);
+    auto split = P4::PrecompiledIncludes::prefix(text, dir);
+    EXPECT_EQ(split.headers, "# 1 \"" + dir + "/arch.p4\" 1\n" + header);
+    EXPECT_EQ(text.substr(split.end, 16), "# 2 \"prog.p4\" 2\n");
+
+    // headers from elsewhere, or after the first declaration, are not part of it
+    EXPECT_TRUE(P4::PrecompiledIncludes::prefix(text, "/elsewhere").headers.empty());
+    auto late = "const bit<8> x = 1;\n" + text;
+    EXPECT_TRUE(P4::PrecompiledIncludes::prefix(late, dir).headers.empty());
+}
+
+TEST_F(PrecompiledIncludesTest, ReusesHeaders) {
+    auto &options = P4CContext::get().options();
+    auto text = preprocessed(dir, header);
+    auto *first = P4::PrecompiledIncludes::parse(options, text);
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+    EXPECT_EQ(countFiles(dir), 1u);
+
+    // The second parse declares the headers from the stored file; the lexer must still
+    // see packet_in and Top as types and extract as generic for the program to parse.
+    auto *second = P4::PrecompiledIncludes::parse(options, text);
+    ASSERT_NE(second, nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+    EXPECT_EQ(countFiles(dir), 1u);
+    ASSERT_EQ(first->objects.size(), second->objects.size());
+    for (size_t i = 0; i < first->objects.size(); ++i)
+        EXPECT_EQ(first->objects.at(i)->toString(), second->objects.at(i)->toString());
+    // the error declarations of the program are merged into those of the headers
+    auto *errors = second->objects.at(0)->to<IR::Type_Error>();
+    ASSERT_NE(errors, nullptr);
+    EXPECT_EQ(errors->members.size(), 2u);
+
+    // different header text is a different entry
+    auto *third = P4::PrecompiledIncludes::parse(
+        options, preprocessed(dir, std::string(header) + "typedef bit<9> port_t;\n"));
+    ASSERT_NE(third, nullptr);
+    EXPECT_EQ(countFiles(dir), 2u);
+}
+
+}  // namespace Test
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/common/preprocessor.h"
+#include "lib/error.h"
+
+namespace Test {
+
+namespace {
+
+/// The non-blank lines of @text other than line markers, with each run of blanks
+/// replaced by one space (cpp does this outside comments, we don't), and without leading
+/// blanks.
+std::string contentLines(const std::string &text) {
+    std::string rv;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) eol = text.size();
+        size_t begin = text.find_first_not_of(" \t", pos);
+        if (begin < eol && !(text[begin] == '#' && text.compare(begin, 7, "#pragma") != 0)) {
+            for (size_t i = begin; i < eol; ++i) {
+                bool blank = text[i] == ' ' || text[i] == '\t';
+                if (!blank) rv += text[i];
+                else if (rv.back() != ' ') rv += ' '; }
+            while (rv.back() == ' ') rv.pop_back();
+            rv += '\n'; }
+        pos = eol + 1; }
+    return rv;
+}
+
+}  // namespace
+
+class PreprocessorTest : public P4CTest {
+ protected:
+    std::string dir;
+
+    void SetUp() override {
+        char name[] = "/tmp/p4c-preprocessor-XXXXXX";
+        ASSERT_NE(mkdtemp(name), nullptr);
+        dir = name;
+    }
+    void TearDown() override {
+        for (auto &file : files) unlink(file.c_str());
+        rmdir((dir + "/inc").c_str());
+        rmdir(dir.c_str());
+    }
+    std::string write(const std::string &name, const std::string &text) {
+        auto path = dir + "/" + name;
+        std::ofstream(path) << text;
+        files.push_back(path);
+        return path;
+    }
+
+ private:
+    std::vector<std::string> files;
+};
+
+TEST_F(PreprocessorTest, Macros) {
+    P4::Preprocessor pp;
+    pp.define("WIDTH", "8");
+    std::string out;
+    ASSERT_TRUE(pp.run("prog.p4", R"(#define PORT 9
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define STR(x) #x
+#define CAT(a, b) a ## b
+#define ID(...) __VA_ARGS__
+bit<WIDTH> x = MAX(PORT, 8w0xff);
+const string s = STR(PORT "q");
+CAT(eth, _t) e; ID(a, b) "PORT" // PORT
+/* PORT
+   PORT */ PORT
+MAX(1,
+    2)
+line __LINE__
+)", out));
+    EXPECT_EQ(0u, ::errorCount());
+    EXPECT_EQ(out, R"(# 1 "prog.p4"
+
+
+
+
+
+bit<8> x = ((9) > (8w0xff) ? (9) : (8w0xff));
+const string s = "PORT \"q\"";
+eth_t e; a, b "PORT" // PORT
+/* PORT
+   PORT */ 9
+((1) > (2) ? (1) : (2))
+
+line 13
+)");
+
+    // the expansion does not run together with what is around it
+    out.clear();
+    ASSERT_TRUE(pp.run("prog.p4", "#define INC +1\nx = y+INC;\n", out));
+    EXPECT_EQ(contentLines(out), "x = y+ +1;\n");
+}
+
+TEST_F(PreprocessorTest, Conditionals) {
+    P4::Preprocessor pp;
+    pp.addOptions(" -DVERSION=20200408 -DA -UA");
+    std::string out;
+    ASSERT_TRUE(pp.run("prog.p4", R"(#if VERSION >= 20180101 && !defined(A)
+new
+#  if defined B || (VERSION % 2) == 1
+no
+#  elif (1 << 3) == 8 /* comment */
+shift
+#  else
+no
+#  endif
+#elif 1
+no
+#else
+#error not seen
+#endif
+#ifdef VERSION
+#ifndef VERSION
+no
+#endif
+yes
+#endif
+)", out));
+    EXPECT_EQ(0u, ::errorCount());
+    EXPECT_EQ(contentLines(out), "new\nshift\nyes\n");
+    // every line of the input is a line of the output
+    EXPECT_EQ(std::count(out.begin(), out.end(), '\n'), 21);
+}
+
+TEST_F(PreprocessorTest, Include) {
+    mkdir((dir + "/inc").c_str(), 0777);
+    auto header = write("inc/arch.p4", "#ifndef _ARCH_\n#define _ARCH_\nextern E {}\n#endif\n");
+    auto prog = write("prog.p4", "#include <arch.p4>\n#include \"inc/arch.p4\"\nE() e;\n");
+    P4::Preprocessor pp;
+    pp.addIncludeDir(dir + "/inc");
+    std::string out;
+    ASSERT_TRUE(pp.run(prog, out));
+    EXPECT_EQ(0u, ::errorCount());
+    EXPECT_EQ(out, "# 1 \"" + prog + "\"\n"
+                   "# 1 \"" + header + "\" 1\n\n\nextern E {}\n\n"
+                   "# 2 \"" + prog + "\" 2\n"
+                   "# 1 \"" + dir + "/inc/arch.p4\" 1\n\n\n\n\n"
+                   "# 3 \"" + prog + "\" 2\n"
+                   "E() e;\n");
+
+    // the cached contents are only used while the file is unchanged
+    write("inc/arch.p4", "extern F {}\n");
+    out.clear();
+    P4::Preprocessor again;
+    again.addIncludeDir(dir + "/inc");
+    ASSERT_TRUE(again.run(prog, out));
+    EXPECT_NE(out.find("extern F {}"), std::string::npos);
+}
+
+TEST_F(PreprocessorTest, Errors) {
+    P4::Preprocessor pp;
+    std::string out;
+    EXPECT_FALSE(pp.run("prog.p4", "#include <missing.p4>\n#error stop\n#if 1\n", out));
+    EXPECT_EQ(3u, ::errorCount());
+}
+
+TEST_F(PreprocessorTest, MatchesCpp) {
+    // The content of the standard headers should be exactly what cpp produces.
+    for (auto file : { "p4include/v1model.p4", "p4include/bmv2/psa.p4" }) {
+        std::string cmd = std::string("cpp -C -undef -nostdinc -x assembler-with-cpp ") +
+                          "-Ip4include -DV1MODEL_VERSION=20200408 " + file;
+        FILE *in = popen(cmd.c_str(), "r");
+        ASSERT_NE(in, nullptr);
+        std::string expected;
+        char buffer[4096];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof(buffer), in)) > 0) expected.append(buffer, len);
+        if (pclose(in) != 0) continue;  // no cpp to compare with
+
+        P4::Preprocessor pp;
+        pp.addOptions("-Ip4include -DV1MODEL_VERSION=20200408");
+        std::string out;
+        ASSERT_TRUE(pp.run(file, out));
+        EXPECT_EQ(contentLines(out), contentLines(expected)) << file;
+    }
+}
+
+}  // namespace Test
@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "lib/exceptions.h"
+
+namespace Test {
+
+namespace {
+
+/// Replaces the constant `a` by one with another value.
+class ChangeA : public Transform {
+    const IR::Node* postorder(IR::Declaration_Constant* decl) override {
+        if (decl->name == "a")
+            return new IR::Declaration_Constant("a", decl->type, new IR::Constant(2));
+        return decl;
+    }
+};
+
+}  // namespace
+
+class ResolveReferencesTest : public P4CTest { };
+
+TEST_F(ResolveReferencesTest, GlobalNames) {
+    // struct S0 { } ... struct S99 { }, a constant a, and a control using them
+    auto program = new IR::P4Program();
+    for (int i = 0; i < 100; i++)
+        program->objects.push_back(new IR::Type_Struct(cstring("S" + Util::toString(i)),
+                                                       IR::IndexedVector<IR::StructField>()));
+    auto b8 = IR::Type_Bits::get(8);
+    program->objects.push_back(new IR::Declaration_Constant("a", b8, new IR::Constant(1)));
+    auto a = new IR::PathExpression("a");
+    auto s = new IR::Type_Name("S42");
+    auto body = new IR::BlockStatement({
+        new IR::Declaration_Variable("v", s),
+        new IR::AssignmentStatement(new IR::PathExpression("x"), a) });
+    auto params = new IR::ParameterList({ new IR::Parameter("x", IR::Direction::Out, b8) });
+    program->objects.push_back(new IR::P4Control("c", new IR::Type_Control("c", params), body));
+
+    P4::ReferenceMap refMap;
+    program->apply(P4::ResolveReferences(&refMap));
+    ASSERT_EQ(0u, ::errorCount());
+    EXPECT_EQ(refMap.getDeclaration(a->path)->getNode(), program->objects.at(100));
+    EXPECT_EQ(refMap.getDeclaration(s->path)->getNode(), program->objects.at(42));
+
+    // after a change the new declaration is found, not the one indexed before
+    auto changed = program->apply(ChangeA())->to<IR::P4Program>();
+    ASSERT_NE(changed, program);
+    P4::ReferenceMap newMap;
+    P4::ResolveReferences resolve(&newMap);
+    program->apply(resolve);
+    changed->apply(resolve);
+    ASSERT_EQ(0u, ::errorCount());
+    auto decl = newMap.getDeclaration(a->path)->to<IR::Declaration_Constant>();
+    ASSERT_NE(decl, nullptr);
+    EXPECT_EQ(decl, changed->objects.at(100));
+    EXPECT_EQ(decl->initializer->to<IR::Constant>()->asInt(), 2);
+}
+
+TEST_F(ResolveReferencesTest, NewNames) {
+    P4::ReferenceMap refMap;
+    refMap.usedName("tmp");
+    refMap.usedName("tmp_1");
+    EXPECT_EQ(refMap.newName("tmp"), "tmp_0");
+    // a numeric suffix is dropped from the base
+    EXPECT_EQ(refMap.newName("tmp_0"), "tmp_2");
+    EXPECT_EQ(refMap.newName("tmp"), "tmp_3");
+    refMap.clear();
+    EXPECT_EQ(refMap.newName("tmp"), "tmp");
+    EXPECT_EQ(refMap.newName("tmp"), "tmp_0");
+
+    P4::MinimalNameGenerator names;
+    EXPECT_EQ(names.newName("tmp"), "tmp");
+    EXPECT_EQ(names.newName("tmp"), "tmp_0");
+}
+
+TEST_F(ResolveReferencesTest, Shards) {
+    auto b8 = IR::Type_Bits::get(8);
+    auto a = new IR::Declaration_Constant("a", b8, new IR::Constant(1));
+    auto b = new IR::Declaration_Constant("b", b8, new IR::Constant(2));
+    auto pa = new IR::Path("a");
+    auto pb = new IR::Path("b");
+    P4::ReferenceMap refMap;
+    refMap.setDeclaration(pa, a);
+    refMap.usedName("tmp");
+    EXPECT_EQ(refMap.newName("tmp"), "tmp_0");
+
+    P4::ReferenceMap shard(&refMap);
+    {
+        P4::ProgramMap::Freeze freeze(refMap);
+        // a frozen map can be read, but not changed
+        EXPECT_EQ(refMap.getDeclaration(pa), a);
+        EXPECT_THROW(refMap.setDeclaration(pb, b), Util::CompilerBug);
+        EXPECT_THROW(refMap.newName("tmp"), Util::CompilerBug);
+        // a shard finds what its parent knows, and learns on its own
+        EXPECT_EQ(shard.getDeclaration(pa), a);
+        EXPECT_TRUE(shard.isUsed(a));
+        shard.setDeclaration(pb, b);
+        EXPECT_EQ(shard.getDeclaration(pb), b);
+        EXPECT_EQ(refMap.getDeclaration(pb), nullptr);
+        EXPECT_EQ(shard.newName("tmp"), "tmp_1");
+        EXPECT_EQ(shard.newName("if"), "if_0");
+    }
+    EXPECT_FALSE(refMap.isFrozen());
+    refMap.merge(shard);
+    EXPECT_EQ(refMap.getDeclaration(pb), b);
+    EXPECT_TRUE(refMap.isUsed(b));
+    EXPECT_EQ(refMap.newName("tmp"), "tmp_2");
+    EXPECT_THROW(shard.merge(refMap), Util::CompilerBug);
+}
+
+}  // namespace Test
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/simplify.h"
+#include "frontends/p4/typeMap.h"
+
+namespace Test {
+
+class SimplifyControlFlowTest : public P4CTest {};
+
+TEST_F(SimplifyControlFlowTest, Simplifies) {
+    std::string program = P4_SOURCE(R"(
+        extern bool f();
+        control c(inout bit<8> x) {
+            action a() { { } if (x == 1) { } }
+            apply {
+                if (!(x == 2)) { x = 1; } else { }
+                { { x = 3; } }
+                if (f()) { }
+                a();
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    P4::ReferenceMap refMap;
+    P4::TypeMap typeMap;
+    auto result = pgm->apply(P4::SimplifyControlFlow(&refMap, &typeMap));
+    ASSERT_TRUE(result != nullptr && ::errorCount() == 0);
+    // the maps describe the simplified program
+    EXPECT_TRUE(refMap.checkMap(result));
+    EXPECT_TRUE(typeMap.checkMap(result));
+
+    auto control = result->to<IR::P4Program>()->objects.back()->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    auto action = control->controlLocals.getDeclaration<IR::P4Action>("a");
+    ASSERT_NE(action, nullptr);
+    EXPECT_TRUE(action->body->components.empty());
+    auto &body = control->body->components;
+    ASSERT_EQ(body.size(), 4u);
+    auto swapped = body.at(0)->to<IR::IfStatement>();
+    ASSERT_NE(swapped, nullptr);
+    EXPECT_TRUE(swapped->condition->is<IR::Equ>());
+    EXPECT_TRUE(swapped->ifTrue->is<IR::EmptyStatement>());
+    EXPECT_TRUE(swapped->ifFalse->is<IR::AssignmentStatement>());
+    EXPECT_TRUE(body.at(1)->is<IR::AssignmentStatement>());
+    // kept for the side effects of its condition
+    EXPECT_TRUE(body.at(2)->is<IR::IfStatement>());
+
+    // nothing is left to simplify, by this pass or another instance of it
+    EXPECT_EQ(result->apply(P4::SimplifyControlFlow(&refMap, &typeMap)), result);
+    P4::ReferenceMap otherRefMap;
+    P4::TypeMap otherTypeMap;
+    EXPECT_EQ(result->apply(P4::SimplifyControlFlow(&otherRefMap, &otherTypeMap)), result);
+    EXPECT_EQ(::errorCount(), 0u);
+}
+
+}  // namespace Test
@@ -0,0 +1,46 @@
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "lib/sourceCodeBuilder.h"
+
+namespace Test {
+
+TEST(SourceCodeBuilder, Format) {
+    Util::SourceCodeBuilder builder;
+    builder.appendFormat("%s = %d + %u;%%", "x", -12, 4000000000U);
+    builder.spc();
+    builder.appendFormat("%04x|%-3s|", 0xab, "y");
+    builder.append(-7);
+    builder.append(cstring(" end "));
+    EXPECT_TRUE(builder.lastIsSpace());
+    EXPECT_EQ(builder.toString(), "x = -12 + 4000000000;% 00ab|y  |-7 end ");
+
+    std::string longArg(300, 'a');
+    Util::SourceCodeBuilder other;
+    other.appendFormat("%5s%s", "b", longArg.c_str());
+    EXPECT_EQ(other.toString(), "    b" + longArg);
+}
+
+TEST(SourceCodeBuilder, Output) {
+    std::stringstream out;
+    std::string expected;
+    {
+        Util::SourceCodeBuilder builder;
+        builder.blockStart();
+        builder.setOutput(&out);
+        for (int i = 0; i < 20000; ++i) {
+            builder.emitIndent();
+            builder.appendFormat("x%d = %s;", i, "y");
+            builder.newline(); }
+        builder.blockEnd(true);
+        // only the text since the last chunk is still held in memory
+        EXPECT_LT(builder.toString().size(), size_t(1 << 16));
+        expected = "{\n";
+        for (int i = 0; i < 20000; ++i)
+            expected += "    x" + std::to_string(i) + " = y;\n";
+        expected += "}\n";
+    }
+    EXPECT_EQ(out.str(), expected);
+}
+
+}  // namespace Test
@@ -76,6 +76,26 @@ TEST(UtilSourceFile, InputSources) {
     EXPECT_EQ(5u, original.sourceLine);
 }
 
+TEST(UtilSourceFile, AppendText) {
+    Util::InputSources sources;
+    sources.appendText("one\ntwo\r\nthree");
+    sources.appendText(" more\r");
+    EXPECT_EQ(3u, sources.getCurrentLineNumber());
+    EXPECT_EQ(11u, sources.getCurrentPosition().getColumnNumber());
+    sources.appendText("\n");
+    for (unsigned i = 0; i < 100; ++i) {
+        if (i % 10 == 0) sources.mapLine(cstring::to_cstring(i), 1000 + i);
+        sources.appendText("x\n");
+    }
+    EXPECT_EQ(103u, sources.lineCount());
+    EXPECT_EQ("two\r\n", sources.getLine(2));
+    EXPECT_EQ("three more\r\n", sources.getLine(3));
+    EXPECT_EQ(1u, sources.getSourceLine(2).sourceLine);
+    SourceFileLine original = sources.getSourceLine(38);
+    EXPECT_EQ("30", original.fileName);
+    EXPECT_EQ(1033u, original.sourceLine);
+}
+
 TEST(UtilSourceFile, SourceInfo) {
     Util::InputSources sources;
 
@@ -95,6 +115,20 @@ TEST(UtilSourceFile, SourceInfo) {
 
     SourceInfo invalid;
     EXPECT_FALSE(invalid.isValid());
+    EXPECT_EQ(-1, invalid.line());
+    EXPECT_EQ("", invalid.filename());
+
+    SourceInfo loaded("x.p4", 12, 3, "bit<8> f;");
+    EXPECT_FALSE(loaded.isValid());
+    EXPECT_EQ("x.p4", loaded.filename());
+    EXPECT_EQ(12, loaded.line());
+    EXPECT_EQ(3, loaded.column());
+    EXPECT_EQ("bit<8> f;", loaded.srcBrief());
+    loaded += t1;
+    EXPECT_EQ(t1, loaded);
+    EXPECT_EQ(-1, loaded.line());
+
+    EXPECT_LE(sizeof(SourceInfo), sizeof(void *) + 2 * sizeof(SourcePosition));
 }
 
 }  // namespace Util
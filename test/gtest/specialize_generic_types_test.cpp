@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/specializeGenericTypes.h"
+#include "frontends/p4/typeMap.h"
+
+namespace Test {
+
+class SpecializeGenericTypesTest : public P4CTest { };
+
+TEST_F(SpecializeGenericTypesTest, SameArguments) {
+    // struct S<T> { T f; }
+    // typedef bit<8> B;
+    // control c() { S<bit<8>> a; S<B> b; S<bit<16>> d; ... }
+    auto b8 = IR::Type_Bits::get(8);
+    auto program = new IR::P4Program();
+    auto tp = new IR::TypeParameters({ new IR::Type_Var("T") });
+    program->objects.push_back(new IR::Type_Struct("S", tp, {
+        new IR::StructField("f", new IR::Type_Name("T")) }));
+    program->objects.push_back(new IR::Type_Typedef("B", b8));
+    auto spec = [](const IR::Type* arg) {
+        return new IR::Type_Specialized(new IR::Type_Name("S"), new IR::Vector<IR::Type>(arg));
+    };
+    IR::IndexedVector<IR::Declaration> locals;
+    locals.push_back(new IR::Declaration_Variable("a", spec(b8)));
+    locals.push_back(new IR::Declaration_Variable("b", spec(new IR::Type_Name("B"))));
+    locals.push_back(new IR::Declaration_Variable("d", spec(IR::Type_Bits::get(16))));
+    for (int i = 0; i < 20; i++)
+        locals.push_back(new IR::Declaration_Variable(cstring("x" + Util::toString(i)),
+                                                      spec(b8)));
+    auto type = new IR::Type_Control("c", new IR::ParameterList());
+    program->objects.push_back(new IR::P4Control("c", type, locals, new IR::BlockStatement()));
+
+    P4::ReferenceMap refMap;
+    P4::TypeMap typeMap;
+    auto result = program->apply(P4::SpecializeGenericTypes(&refMap, &typeMap));
+    ASSERT_EQ(0u, ::errorCount());
+    ASSERT_NE(result, nullptr);
+
+    // S itself is removed, and one struct is created for each distinct argument
+    std::vector<const IR::Type_Struct*> structs;
+    for (auto o : result->objects)
+        if (auto st = o->to<IR::Type_Struct>())
+            structs.push_back(st);
+    ASSERT_EQ(2u, structs.size());
+    EXPECT_EQ(b8, structs.at(0)->fields.at(0)->type);
+    auto control = result->getDeclsByName("c")->single()->to<IR::P4Control>();
+    ASSERT_NE(control, nullptr);
+    auto typeOf = [control](cstring name) {
+        auto decl = control->getDeclByName(name)->to<IR::Declaration_Variable>();
+        return decl->type->to<IR::Type_Name>()->path->name.name;
+    };
+    EXPECT_EQ(structs.at(0)->name.name, typeOf("a"));
+    EXPECT_EQ(structs.at(0)->name.name, typeOf("b"));
+    EXPECT_EQ(structs.at(0)->name.name, typeOf("x19"));
+    EXPECT_EQ(structs.at(1)->name.name, typeOf("d"));
+}
+
+}  // namespace Test
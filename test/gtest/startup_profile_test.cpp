@@ -0,0 +1,30 @@
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/startup_profile.h"
+
+namespace Test {
+
+TEST(StartupProfile, Report) {
+    Util::StartupProfile::mark("profile test mark");
+    Util::StartupProfile::mark("profile test mark");
+    EXPECT_EQ(Util::StartupProfile::time("profile test init", [] { return 42; }), 42);
+
+    std::stringstream out;
+    Util::StartupProfile::write(out);
+    std::string text = out.str();
+    EXPECT_EQ(text.find("Startup profile"), 0U) << text;
+    // constructors start before any test runs
+    auto constructors = text.find("  static constructors\n");
+    auto mark = text.find("  profile test mark\n");
+    ASSERT_NE(constructors, std::string::npos) << text;
+    ASSERT_NE(mark, std::string::npos) << text;
+    EXPECT_LT(constructors, mark) << text;
+    // a mark is only recorded the first time
+    EXPECT_EQ(text.find("  profile test mark\n", mark + 1), std::string::npos) << text;
+    EXPECT_NE(text.find("  profile test init ("), std::string::npos) << text;
+    EXPECT_NE(text.find("  exit\n"), std::string::npos) << text;
+}
+
+}  // namespace Test
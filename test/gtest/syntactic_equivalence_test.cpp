@@ -0,0 +1,63 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/p4/typeChecking/syntacticEquivalence.h"
+
+namespace Test {
+
+class SyntacticEquivalenceTest : public P4CTest {
+ protected:
+    P4::ReferenceMap refMap;
+    P4::TypeMap typeMap;
+    const IR::Declaration_Variable* a = new IR::Declaration_Variable("a", IR::Type_Bits::get(8));
+    const IR::Declaration_Variable* b = new IR::Declaration_Variable("b", IR::Type_Bits::get(8));
+
+    /// A new reference to @decl.
+    const IR::PathExpression* ref(const IR::Declaration_Variable* decl) {
+        auto path = new IR::PathExpression(decl->name);
+        refMap.setDeclaration(path->path, decl);
+        return path;
+    }
+    const IR::Expression* plusOne(const IR::Declaration_Variable* decl) {
+        return new IR::Add(ref(decl), new IR::Constant(1)); }
+};
+
+TEST_F(SyntacticEquivalenceTest, Hash) {
+    P4::SameExpression same(&refMap, &typeMap);
+    auto e1 = plusOne(a), e2 = plusOne(a), e3 = plusOne(b);
+    EXPECT_TRUE(same.sameExpression(e1, e2));
+    EXPECT_EQ(same.hash(e1), same.hash(e2));
+    EXPECT_FALSE(same.sameExpression(e1, e3));
+    EXPECT_NE(same.hash(e1), same.hash(e3));
+
+    auto l1 = new IR::ListExpression({ ref(a), new IR::Member(ref(b), "f") });
+    auto l2 = new IR::ListExpression({ ref(a), new IR::Member(ref(b), "f") });
+    auto l3 = new IR::ListExpression({ ref(a), new IR::Member(ref(b), "g") });
+    EXPECT_EQ(same.hash(l1), same.hash(l2));
+    EXPECT_NE(same.hash(l1), same.hash(l3));
+    EXPECT_NE(same.hash(new IR::Constant(1)), same.hash(new IR::Constant(2)));
+    EXPECT_NE(same.hash(new IR::BoolLiteral(true)), same.hash(new IR::BoolLiteral(false)));
+}
+
+TEST_F(SyntacticEquivalenceTest, Set) {
+    P4::SameExpressionSet set(&refMap, &typeMap);
+    auto e1 = plusOne(a);
+    EXPECT_EQ(set.insert(e1), nullptr);
+    EXPECT_EQ(set.insert(plusOne(b)), nullptr);
+    // a duplicate finds the first expression added
+    EXPECT_EQ(set.insert(plusOne(a)), e1);
+    EXPECT_EQ(set.find(plusOne(a)), e1);
+    EXPECT_EQ(set.count(plusOne(a)), 2u);
+    EXPECT_EQ(set.count(plusOne(b)), 1u);
+    EXPECT_EQ(set.find(new IR::Sub(ref(a), new IR::Constant(1))), nullptr);
+    EXPECT_EQ(set.size(), 3u);
+
+    set.clear();
+    EXPECT_TRUE(set.empty());
+    for (int i = 0; i < 1000; i++)
+        EXPECT_EQ(set.insert(new IR::Add(ref(a), new IR::Constant(i))), nullptr);
+    for (int i = 0; i < 1000; i++)
+        EXPECT_EQ(set.count(new IR::Add(ref(a), new IR::Constant(i))), 1u);
+}
+
+}  // namespace Test
@@ -0,0 +1,94 @@
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/compile_context.h"
+#include "lib/thread_pool.h"
+
+namespace Test {
+
+TEST(ThreadPool, ParallelFor) {
+    Util::ThreadPool pool(4);
+    std::vector<int> seen(100, 0);
+    pool.parallel_for(seen.size(), [&](size_t i) { seen[i]++; });
+    for (auto s : seen) EXPECT_EQ(s, 1);
+}
+
+TEST(ThreadPool, Nested) {
+    Util::ThreadPool pool(3);
+    std::atomic<int> total(0);
+    pool.parallel_for(8, [&](size_t) {
+        pool.parallel_for(8, [&](size_t j) { total += j; }); });
+    EXPECT_EQ(total, 8 * 28);
+}
+
+TEST(ThreadPool, FirstExceptionRethrown) {
+    Util::ThreadPool pool(4);
+    std::atomic<int> ran(0);
+    try {
+        pool.parallel_for(20, [&](size_t i) {
+            ran++;
+            if (i == 5 || i == 12) throw std::runtime_error(std::to_string(i)); });
+        FAIL() << "exception was not propagated";
+    } catch (std::runtime_error &e) {
+        EXPECT_STREQ(e.what(), "5");
+    }
+    EXPECT_EQ(ran, 20);
+}
+
+TEST(ThreadPool, TaskGroup) {
+    Util::ThreadPool pool(2);
+    Util::ThreadPool::TaskGroup group(pool);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 10; ++i)
+        group.run([&]() { count++; });
+    group.wait();
+    EXPECT_EQ(count, 10);
+}
+
+// a group on the stack goes away as soon as wait() returns, while the worker that ran
+// its last task may still be finishing it (run under TSan to catch a use after free)
+TEST(ThreadPool, ShortLivedTaskGroups) {
+    Util::ThreadPool pool(4);
+    int count = 0;
+    for (int i = 0; i < 10000; ++i) {
+        Util::ThreadPool::TaskGroup group(pool);
+        group.run([&]() { count++; });
+        group.run([]() {});
+        group.wait(); }
+    EXPECT_EQ(count, 10000);
+}
+
+TEST(ThreadPool, ParallelReduceIsOrdered) {
+    Util::ThreadPool pool(4);
+    auto concat = [](std::string acc, std::string s) { return acc + s; };
+    auto digit = [](size_t i) { return std::to_string(i % 10); };
+    auto result = pool.parallel_reduce(30, std::string(">"), digit, concat);
+    EXPECT_EQ(result, ">012345678901234567890123456789");
+    EXPECT_EQ(pool.parallel_reduce(0, std::string(">"), digit, concat), ">");
+    // the same as sequentially, even with rounding
+    auto third = [](size_t i) { return 1.0 / (3 + i); };
+    auto add = [](double a, double b) { return a + b; };
+    double sequential = 0;
+    for (size_t i = 0; i < 1000; ++i) sequential = add(sequential, third(i));
+    EXPECT_EQ(pool.parallel_reduce(1000, 0.0, third, add), sequential);
+}
+
+namespace {
+class TestContext : public BaseCompileContext {};
+}  // namespace
+
+TEST(ThreadPool, TasksInheritCompileContext) {
+    Util::ThreadPool pool(4);
+    TestContext context;
+    AutoCompileContext autoContext(&context);
+    std::atomic<int> inherited(0);
+    pool.parallel_for(20, [&](size_t) {
+        if (CompileContextStack::current() == &context) inherited++; });
+    EXPECT_EQ(inherited, 20);
+    EXPECT_EQ(CompileContextStack::current(), &context);
+}
+
+}  // namespace Test
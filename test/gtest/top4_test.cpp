@@ -0,0 +1,46 @@
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/p4/toP4/toP4.h"
+#include "lib/thread_pool.h"
+
+namespace Test {
+
+class ToP4Test : public P4CTest {
+ protected:
+    static std::string print(const IR::Node* program, bool parallel) {
+        std::stringstream out;
+        P4::ToP4 toP4(&out, false);
+        toP4.parallel = parallel;
+        program->apply(toP4);
+        return out.str();
+    }
+};
+
+TEST_F(ToP4Test, ParallelDeclarations) {
+    auto b8 = IR::Type_Bits::get(8);
+    auto program = new IR::P4Program();
+    program->objects.push_back(new IR::Type_Struct("S", {
+        new IR::StructField("f", b8), new IR::StructField("g", IR::Type_Bits::get(16)) }));
+    for (int i = 0; i < 20; i++) {
+        cstring name = "c" + Util::toString(i);
+        program->objects.push_back(new IR::Declaration_Constant(name, b8, new IR::Constant(i)));
+    }
+    auto params = new IR::ParameterList({ new IR::Parameter("x", IR::Direction::InOut, b8) });
+    auto body = new IR::BlockStatement({
+        new IR::AssignmentStatement(new IR::PathExpression("x"),
+                                    new IR::Add(new IR::PathExpression("x"),
+                                                new IR::PathExpression("c1"))) });
+    program->objects.push_back(new IR::P4Control("c", new IR::Type_Control("c", params), body));
+
+    auto sequential = print(program, false);
+    Util::ThreadPool::setThreads(4);
+    auto parallel = print(program, true);
+    Util::ThreadPool::setThreads(1);
+    EXPECT_NE(sequential.find("control c(inout bit<8> x)"), std::string::npos);
+    EXPECT_EQ(parallel, sequential);
+}
+
+}  // namespace Test
@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <string>
+
 #include "gtest/gtest.h"
 #include "helpers.h"
 #include "ir/ir.h"
@@ -43,4 +45,59 @@ TEST_F(P4C_IR, Transform) {
     EXPECT_EQ(e, n);
 }
 
+TEST_F(P4C_IR, TransformFreeingUnchangedClones) {
+    // Replaces the constant 3 with 30, and a Sub with an Add made by preorder.
+    struct Change : public Transform {
+        const IR::Add *made = nullptr;
+        Change() { freeUnchangedClones = true; }
+        const IR::Node *postorder(IR::Constant *c) override {
+            return c->value == 3 ? new IR::Constant(30) : c; }
+        const IR::Node *preorder(IR::Sub *s) override {
+            return made = new IR::Add(s->left, s->right); }
+    };
+
+    auto *left = new IR::Add(new IR::Constant(1), new IR::Constant(2));
+    auto *right = new IR::Add(new IR::Constant(3), new IR::Constant(4));
+    const IR::Expression *e = new IR::Add(left, right);
+    auto *n = e->apply(Change())->to<IR::Add>();
+    ASSERT_NE(nullptr, n);
+    EXPECT_NE(e, n);
+    EXPECT_EQ(left, n->left);  // unchanged, so not copied
+    auto *r = n->right->to<IR::Add>();
+    ASSERT_NE(nullptr, r);
+    EXPECT_EQ(30, r->left->to<IR::Constant>()->asInt());
+    EXPECT_EQ(right->right, r->right);
+
+    EXPECT_EQ(left, left->apply(Change()));
+
+    Change change;
+    auto *sub = new IR::Sub(new IR::Constant(3), new IR::Constant(5));
+    auto *s = sub->apply(change)->to<IR::Add>();
+    ASSERT_NE(nullptr, s);
+    EXPECT_EQ(change.made, s);  // visited in place rather than cloned
+    EXPECT_EQ(30, s->left->to<IR::Constant>()->asInt());
+    EXPECT_EQ(sub->right, s->right);
+}
+
+TEST_F(P4C_IR, WriteContext) {
+    struct Roles : public Inspector, P4WriteContext {
+        std::string writes, reads;
+        void postorder(const IR::PathExpression *p) override {
+            // asked twice, the second time from what was remembered
+            for (int i = 0; i < 2; i++) {
+                EXPECT_EQ(isWrite(), isWrite(true));
+                if (isWrite()) writes += p->path->name.name;
+                if (isRead()) reads += p->path->name.name; } }
+    };
+
+    auto *left = new IR::Slice(new IR::Member(new IR::PathExpression("a"), "f"), 1, 0);
+    auto *right = new IR::Add(new IR::PathExpression("b"),
+                              new IR::Member(new IR::PathExpression("c"), "g"));
+    const IR::Node *stat = new IR::AssignmentStatement(left, right);
+    Roles roles;
+    stat->apply(roles);
+    EXPECT_EQ("aa", roles.writes);
+    EXPECT_EQ("bbcc", roles.reads);
+}
+
 }  // namespace Test
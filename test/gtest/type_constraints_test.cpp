@@ -0,0 +1,75 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/p4/typeChecking/typeConstraints.h"
+#include "lib/error.h"
+
+namespace Test {
+
+class TypeConstraintsTest : public P4CTest {
+ protected:
+    P4::TypeVariableSubstitution defined;
+    P4::TypeConstraints constraints{&defined};
+
+    const IR::Type_Var* var(cstring name) {
+        auto tv = new IR::Type_Var(name);
+        constraints.addUnifiableTypeVariable(tv);
+        return tv;
+    }
+    void equal(const IR::Type* left, const IR::Type* right) {
+        constraints.addEqualityConstraint(left, left, right);
+    }
+};
+
+TEST_F(TypeConstraintsTest, Chains) {
+    auto b8 = IR::Type_Bits::get(8);
+    auto b16 = IR::Type_Bits::get(16);
+    auto x = var("X"), y = var("Y"), z = var("Z"), w = var("W");
+    // constraints are solved from the last one
+    equal(z, b8);
+    equal(y, z);
+    equal(x, y);
+    equal(new IR::Type_Tuple({ x, w }), new IR::Type_Tuple({ y, b16 }));
+    auto solution = constraints.solve();
+    ASSERT_NE(solution, nullptr);
+    EXPECT_EQ(0u, ::errorCount());
+    // every variable gets its final value, not another variable
+    EXPECT_EQ(solution->lookup(x), b8);
+    EXPECT_EQ(solution->lookup(y), b8);
+    EXPECT_EQ(solution->lookup(z), b8);
+    EXPECT_EQ(solution->lookup(w), b16);
+}
+
+TEST_F(TypeConstraintsTest, LongChain) {
+    auto b8 = IR::Type_Bits::get(8);
+    std::vector<const IR::Type_Var*> vars;
+    for (int i = 0; i < 2000; i++)
+        vars.push_back(var("V" + Util::toString(i)));
+    equal(vars.back(), b8);
+    for (size_t i = vars.size() - 1; i > 0; i--)
+        equal(vars.at(i), vars.at(i - 1));
+    // the head of the chain also appears in a structured type
+    auto stack = new IR::Type_Stack(vars.front(), new IR::Constant(4));
+    auto t = var("T");
+    equal(t, stack);
+    auto solution = constraints.solve();
+    ASSERT_NE(solution, nullptr);
+    for (auto v : vars)
+        EXPECT_EQ(solution->lookup(v), b8);
+    auto st = solution->lookup(t)->to<IR::Type_Stack>();
+    ASSERT_NE(st, nullptr);
+    EXPECT_EQ(st->elementType, b8);
+}
+
+TEST_F(TypeConstraintsTest, Occurs) {
+    // X = tuple<Y> and Y = tuple<X> have no solution
+    auto x = var("X"), y = var("Y");
+    equal(y, new IR::Type_Tuple({ x }));
+    equal(x, new IR::Type_Tuple({ y }));
+    EXPECT_EQ(constraints.solve(), nullptr);
+    EXPECT_EQ(1u, ::errorCount());
+}
+
+}  // namespace Test
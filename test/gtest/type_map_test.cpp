@@ -0,0 +1,236 @@
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/parseInput.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "frontends/p4/methodInstance.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+#include "lib/thread_pool.h"
+
+namespace Test {
+
+namespace {
+
+/// Adds a field to the struct T.
+class ExtendT : public Transform {
+    const IR::Node* postorder(IR::Type_Struct* type) override {
+        if (type->name == "T")
+            type->fields.push_back(new IR::StructField("h", IR::Type_Bits::get(8)));
+        return type;
+    }
+};
+
+const IR::Node* find(const IR::P4Program* program, cstring name) {
+    for (auto decl : program->objects)
+        if (auto d = decl->to<IR::IDeclaration>())
+            if (d->getName() == name) return decl;
+    return nullptr;
+}
+
+/// A block assigning @value to the parameter x.
+IR::BlockStatement* assignX(const IR::Expression* value) {
+    return new IR::BlockStatement({
+        new IR::AssignmentStatement(new IR::PathExpression("x"), value) });
+}
+
+}  // namespace
+
+class TypeMapTest : public P4CTest {
+ protected:
+    P4::ReferenceMap refMap;
+    P4::TypeMap typeMap;
+
+    const IR::P4Program* check(const IR::P4Program* program) {
+        PassManager passes = {
+            new P4::ResolveReferences(&refMap),
+            new P4::TypeInference(&refMap, &typeMap),
+            new P4::TypeChecking(&refMap, &typeMap),
+        };
+        return program->apply(passes);
+    }
+};
+
+TEST_F(TypeMapTest, KeepsUnchangedDeclarations) {
+    auto program = P4::parseP4String(P4_SOURCE(R"(
+        struct S { bit<8> f; }
+        struct T { bit<16> g; }
+        const bit<8> one = 1;
+        control c(inout S s) { apply { s.f = s.f + one; } }
+        control d(inout T t) { apply { t.g = 2; } }
+    )"), CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    program = check(program);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+
+    auto changed = program->apply(ExtendT());
+    ASSERT_NE(changed, program);
+    changed->apply(P4::ClearTypeMap(&typeMap));
+    // c and what it uses are unchanged; d uses the new T
+    EXPECT_TRUE(typeMap.contains(find(changed, "S")));
+    EXPECT_TRUE(typeMap.contains(find(changed, "one")));
+    EXPECT_TRUE(typeMap.contains(find(changed, "c")));
+    EXPECT_FALSE(typeMap.contains(find(changed, "d")));
+    EXPECT_FALSE(typeMap.contains(find(changed, "T")));
+
+    changed = check(changed);
+    ASSERT_TRUE(changed != nullptr && ::errorCount() == 0);
+    auto d = find(changed, "d")->to<IR::P4Control>();
+    auto param = d->getApplyParameters()->getParameter(0);
+    auto type = typeMap.getType(param, true)->to<IR::Type_Struct>();
+    ASSERT_NE(type, nullptr);
+    EXPECT_EQ(type->fields.size(), 2u);
+
+    // a forced clear keeps nothing
+    changed->apply(P4::ClearTypeMap(&typeMap, true));
+    EXPECT_EQ(typeMap.size(), 0u);
+    EXPECT_FALSE(typeMap.contains(find(changed, "c")));
+}
+
+TEST_F(TypeMapTest, Equivalence) {
+    auto b8 = IR::Type_Bits::get(8);
+    auto s1 = new IR::Type_Struct("S", { new IR::StructField("f", b8) });
+    auto s2 = new IR::Type_Struct("S", { new IR::StructField("f", b8) });
+    auto s3 = new IR::Type_Struct("S", { new IR::StructField("f", IR::Type_Bits::get(16)) });
+    auto t1 = new IR::Type_Tuple({ s1, b8 });
+    auto t2 = new IR::Type_Tuple({ s2, b8 });
+    auto t3 = new IR::Type_Tuple({ s3, b8 });
+    auto list = new IR::Type_List({ b8 });
+    // the second time the results are remembered, and must not change
+    for (int i = 0; i < 2; i++) {
+        EXPECT_TRUE(P4::TypeMap::equivalent(s1, s2));
+        EXPECT_FALSE(P4::TypeMap::equivalent(s1, s3));
+        EXPECT_TRUE(P4::TypeMap::equivalent(t1, t2));
+        EXPECT_FALSE(P4::TypeMap::equivalent(t2, t3));
+        EXPECT_FALSE(P4::TypeMap::equivalent(list, s1));
+        EXPECT_TRUE(P4::TypeMap::implicitlyConvertibleTo(s1, list));
+        EXPECT_FALSE(P4::TypeMap::implicitlyConvertibleTo(s3, list));
+        EXPECT_FALSE(P4::TypeMap::implicitlyConvertibleTo(list, s1));
+    }
+    EXPECT_EQ(0u, ::errorCount());
+}
+
+TEST_F(TypeMapTest, CanonicalTypes) {
+    auto b8 = IR::Type_Bits::get(8);
+    auto s1 = new IR::Type_Struct("S", { new IR::StructField("f", b8) });
+    auto s2 = new IR::Type_Struct("S", { new IR::StructField("f", b8) });
+    auto t1 = new IR::Type_Tuple({ s1, b8 });
+    auto t2 = new IR::Type_Tuple({ s2, b8 });
+    auto t3 = new IR::Type_Tuple({ b8, s1 });
+    EXPECT_EQ(P4::TypeMap::canonicalHash(t1), P4::TypeMap::canonicalHash(t2));
+    EXPECT_EQ(typeMap.getCanonical(t1), t1);
+    EXPECT_EQ(typeMap.getCanonical(t2), t1);
+    EXPECT_EQ(typeMap.getCanonical(t3), t3);
+    // a list is not the same as a tuple with the same components
+    auto list = new IR::Type_List({ s2, b8 });
+    EXPECT_EQ(typeMap.getCanonical(list), list);
+    auto set = new IR::Type_Set(t1);
+    EXPECT_EQ(typeMap.getCanonical(new IR::Type_Set(t1)), typeMap.getCanonical(set));
+    EXPECT_NE(typeMap.getCanonical(new IR::Type_Set(t3)), typeMap.getCanonical(set));
+    auto stack = new IR::Type_Stack(s1, new IR::Constant(4));
+    EXPECT_EQ(typeMap.getCanonical(new IR::Type_Stack(s2, new IR::Constant(4))),
+              typeMap.getCanonical(stack));
+    EXPECT_NE(typeMap.getCanonical(new IR::Type_Stack(s2, new IR::Constant(5))), stack);
+
+    // a shard finds the canonical types of its parent
+    P4::TypeMap shard(&typeMap);
+    EXPECT_EQ(shard.getCanonical(new IR::Type_Tuple({ s2, b8 })), t1);
+    auto t4 = new IR::Type_Tuple({ b8 });
+    EXPECT_EQ(shard.getCanonical(t4), t4);
+    typeMap.merge(shard);
+    EXPECT_EQ(typeMap.getCanonical(new IR::Type_Tuple({ b8 })), t4);
+    EXPECT_EQ(0u, ::errorCount());
+}
+
+TEST_F(TypeMapTest, RemembersResolvedCalls) {
+    auto program = P4::parseP4String(P4_SOURCE(R"(
+        extern void f(in bit<8> x);
+        control c() { apply { f(1); } }
+    )"), CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    program = check(program);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    const IR::MethodCallExpression* call = nullptr;
+    forAllMatching<IR::MethodCallExpression>(program, [&](const IR::MethodCallExpression* mce) {
+        call = mce; });
+    ASSERT_NE(call, nullptr);
+
+    auto mi = P4::MethodInstance::resolve(call, &refMap, &typeMap);
+    EXPECT_TRUE(mi->is<P4::ExternFunction>());
+    EXPECT_EQ(mi, P4::MethodInstance::resolve(call, &refMap, &typeMap));
+    // once the map is cleared the call is resolved again
+    auto generation = typeMap.getGeneration();
+    typeMap.clear();
+    EXPECT_NE(generation, typeMap.getGeneration());
+    program = check(program);
+    ASSERT_TRUE(program != nullptr && ::errorCount() == 0);
+    auto again = P4::MethodInstance::resolve(call, &refMap, &typeMap);
+    EXPECT_NE(mi, again);
+    EXPECT_TRUE(again->is<P4::ExternFunction>());
+}
+
+TEST_F(TypeMapTest, ParallelChecking) {
+    // a constant, actions a0..a9 and controls c0..c9 using it; c5 calls a5, and the
+    // controls bad1 and bad2 assign a boolean
+    auto b8 = IR::Type_Bits::get(8);
+    auto program = new IR::P4Program();
+    program->objects.push_back(new IR::Declaration_Constant("one", b8, new IR::Constant(b8, 1)));
+    auto params = [&]() {
+        return new IR::ParameterList({ new IR::Parameter("x", IR::Direction::InOut, b8) }); };
+    auto increment = []() {
+        return assignX(new IR::Add(new IR::PathExpression("x"), new IR::PathExpression("one")));
+    };
+    for (int i = 0; i < 10; i++)
+        program->objects.push_back(new IR::P4Action(cstring("a" + Util::toString(i)),
+                                                    params(), increment()));
+    for (int i = 0; i < 10; i++) {
+        cstring name = "c" + Util::toString(i);
+        auto body = increment();
+        if (i == 5)
+            body->components.push_back(new IR::MethodCallStatement(
+                new IR::MethodCallExpression(new IR::PathExpression("a5"),
+                    new IR::Vector<IR::Argument>({
+                        new IR::Argument(new IR::PathExpression("x")) }))));
+        program->objects.push_back(new IR::P4Control(name, new IR::Type_Control(name, params()),
+                                                     body));
+    }
+    for (auto name : { "bad1", "bad2" })
+        program->objects.push_back(new IR::P4Control(name, new IR::Type_Control(name, params()),
+                                                     assignX(new IR::BoolLiteral(true))));
+
+    struct Result {
+        std::string diagnostics;
+        unsigned errors;
+        P4::TypeMap types;
+    };
+    auto check = [&](bool parallel, Result& result) {
+        // a context of its own, so that the errors are not filtered as repeated
+        AutoCompileContext context(new GTestContext);
+        std::stringstream out;
+        BaseCompileContext::get().errorReporter().setOutputStream(&out);
+        P4::ReferenceMap refMap;
+        program->apply(P4::TypeChecking(&refMap, &result.types, false, parallel));
+        result.diagnostics = out.str();
+        result.errors = ::errorCount();
+    };
+    Result sequential, parallel;
+    check(false, sequential);
+    Util::ThreadPool::setThreads(4);
+    check(true, parallel);
+    Util::ThreadPool::setThreads(1);
+
+    EXPECT_GT(sequential.errors, 0u);
+    EXPECT_EQ(parallel.errors, sequential.errors);
+    EXPECT_NE(sequential.diagnostics, "");
+    EXPECT_EQ(parallel.diagnostics, sequential.diagnostics);
+    EXPECT_EQ(parallel.types.size(), sequential.types.size());
+    for (auto decl : program->objects) {
+        auto type = sequential.types.getType(decl);
+        ASSERT_NE(type, nullptr) << decl;
+        EXPECT_TRUE(P4::TypeMap::equivalent(parallel.types.getType(decl), type)) << decl;
+    }
+}
+
+}  // namespace Test
@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/common/resolveReferences/resolveReferences.h"
+#include "frontends/p4/unusedDeclarations.h"
+
+namespace Test {
+
+class UnusedDeclarationsTest : public P4CTest {
+ protected:
+    IR::P4Program* program = new IR::P4Program();
+
+    const IR::Declaration_Constant* constant(cstring name, const IR::Expression* value) {
+        auto decl = new IR::Declaration_Constant(name, IR::Type_Bits::get(8), value);
+        program->objects.push_back(decl);
+        return decl;
+    }
+};
+
+TEST_F(UnusedDeclarationsTest, Chains) {
+    // a <- b <- c is unused; d is used by a declaration that is always kept
+    auto a = constant("a", new IR::Constant(1));
+    auto b = constant("b", new IR::PathExpression("a"));
+    auto c = constant("c", new IR::PathExpression("b"));
+    auto d = constant("d", new IR::Constant(2));
+    auto keep = constant("__keep", new IR::PathExpression("d"));
+
+    P4::ReferenceMap refMap;
+    program->apply(P4::ResolveReferences(&refMap));
+    P4::FindUnusedDeclarations find(&refMap);
+    program->apply(find);
+    ASSERT_EQ(0u, ::errorCount());
+    // b is referenced, but only by c, which is removed
+    EXPECT_TRUE(refMap.isUsed(b));
+    EXPECT_FALSE(find.isUsed(a));
+    EXPECT_FALSE(find.isUsed(b));
+    EXPECT_FALSE(find.isUsed(c));
+    EXPECT_TRUE(find.isUsed(d));
+    EXPECT_TRUE(find.changes());
+
+    auto result = program->apply(P4::RemoveAllUnusedDeclarations(&refMap));
+    ASSERT_NE(result, nullptr);
+    ASSERT_EQ(result->objects.size(), 2u);
+    EXPECT_EQ(result->objects.at(0), d);
+    EXPECT_EQ(result->objects.at(1), keep);
+    // the reference map describes the result
+    EXPECT_FALSE(refMap.isUsed(b));
+    EXPECT_EQ(refMap.getDeclaration(keep->initializer->to<IR::PathExpression>()->path), d);
+
+    // nothing else to remove
+    result->apply(find);
+    EXPECT_FALSE(find.changes());
+}
+
+}  // namespace Test
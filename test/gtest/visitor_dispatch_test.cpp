@@ -0,0 +1,82 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/visitor.h"
+
+namespace {
+
+const IR::Node *makeTree() {
+    auto *a = new IR::PathExpression("a");
+    auto *b = new IR::PathExpression("b");
+    return new IR::Add(new IR::Sub(a, new IR::Member(b, "f")), new IR::Neg(a));
+}
+
+/// Counts the binary operations, through the overload of their common base class.
+class CountBinary : public Inspector {
+ public:
+    int pre = 0, post = 0;
+    bool preorder(const IR::Operation_Binary *) override { ++pre; return true; }
+    void postorder(const IR::Operation_Binary *) override { ++post; }
+};
+
+/// Also counts the unary operations; only applied after CountBinary.
+class CountBinaryAndUnary : public CountBinary {
+ public:
+    int unary = 0;
+    bool preorder(const IR::Operation_Unary *) override { ++unary; return true; }
+};
+
+/// Counts every node, through the overload for IR::Node.
+class CountNodes : public Inspector {
+ public:
+    int nodes = 0;
+    bool preorder(const IR::Node *) override { ++nodes; return true; }
+};
+
+/// Counts the field accesses.
+class CountMembers : public Inspector {
+ public:
+    int members = 0;
+    void postorder(const IR::Member *) override { ++members; }
+};
+
+/// Replaces field accesses with the expression they apply to.
+class RemoveMembers : public Transform {
+ public:
+    const IR::Node *postorder(IR::Member *member) override { return member->expr; }
+};
+
+}  // namespace
+
+class P4C_IR_Dispatch : public P4CTest { };
+
+TEST_F(P4C_IR_Dispatch, InheritedOverloads) {
+    auto *tree = makeTree();
+    CountBinary binary;
+    tree->apply(binary);
+    EXPECT_EQ(binary.pre, 2);
+    EXPECT_EQ(binary.post, 2);
+
+    CountBinaryAndUnary both;
+    tree->apply(both);
+    EXPECT_EQ(both.pre, 2);
+    EXPECT_EQ(both.unary, 2);  // the Member and the Neg
+
+    CountNodes nodes;
+    tree->apply(nodes);
+    // the operations, the paths and their types
+    EXPECT_GT(nodes.nodes, binary.pre + both.unary + 2);
+}
+
+TEST_F(P4C_IR_Dispatch, Transform) {
+    auto *tree = makeTree()->to<IR::Expression>();
+    CountMembers before, after;
+    tree->apply(before);
+    auto *result = tree->apply(RemoveMembers());
+    result->apply(after);
+    EXPECT_EQ(before.members, 1);
+    EXPECT_EQ(after.members, 0);
+    EXPECT_NE(result, tree);
+}
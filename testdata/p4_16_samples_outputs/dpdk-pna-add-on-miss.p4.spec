@@ -0,0 +1,80 @@
+
+
+struct ethernet_t {
+	bit<48> dstAddr
+	bit<48> srcAddr
+	bit<16> etherType
+}
+
+struct flow_hit_arg_t {
+	bit<16> id
+}
+
+struct main_metadata_t {
+	bit<32> pna_pre_input_metadata_input_port
+	bit<8> pna_pre_input_metadata_parser_error
+	bit<32> pna_pre_input_metadata_direction
+	bit<3> pna_pre_input_metadata_pass
+	bit<8> pna_pre_input_metadata_loopedback
+	bit<8> pna_pre_output_metadata_decrypt
+	bit<32> pna_pre_output_metadata_said
+	bit<16> pna_pre_output_metadata_decrypt_start_offset
+	bit<32> pna_main_parser_input_metadata_direction
+	bit<3> pna_main_parser_input_metadata_pass
+	bit<8> pna_main_parser_input_metadata_loopedback
+	bit<32> pna_main_parser_input_metadata_input_port
+	bit<32> pna_main_input_metadata_direction
+	bit<3> pna_main_input_metadata_pass
+	bit<8> pna_main_input_metadata_loopedback
+	bit<64> pna_main_input_metadata_timestamp
+	bit<8> pna_main_input_metadata_parser_error
+	bit<8> pna_main_input_metadata_class_of_service
+	bit<32> pna_main_input_metadata_input_port
+	bit<8> pna_main_output_metadata_class_of_service
+	bit<16> MainControlT_flow_hit_id
+}
+metadata instanceof main_metadata_t
+
+header ethernet instanceof ethernet_t
+
+action flow_hit args instanceof flow_hit_arg_t {
+	mov h.ethernet.etherType t.id
+	rearm
+	return
+}
+
+action flow_miss args none {
+	mov m.MainControlT_flow_hit_id h.ethernet.etherType
+	learn flow_hit m.MainControlT_flow_hit_id
+	return
+}
+
+learner flows {
+	key {
+		h.ethernet.dstAddr
+	}
+	actions {
+		flow_hit
+		flow_miss
+	}
+	default_action flow_miss args none 
+	size 0x10000
+	timeout {
+		60
+		120
+		180
+	}
+}
+
+apply {
+	rx m.psa_ingress_input_metadata_ingress_port
+	mov m.psa_ingress_output_metadata_drop 0x0
+	extract h.ethernet
+	table flows
+	jmpneq LABEL_DROP m.psa_ingress_output_metadata_drop 0x0
+	emit h.ethernet
+	tx m.psa_ingress_output_metadata_egress_port
+	LABEL_DROP : drop
+}
+
+
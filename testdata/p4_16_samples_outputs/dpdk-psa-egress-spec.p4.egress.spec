@@ -0,0 +1,48 @@
+
+
+struct ethernet_t {
+	bit<48> dstAddr
+	bit<48> srcAddr
+	bit<16> etherType
+}
+
+struct user_meta_t {
+	bit<32> psa_egress_input_metadata_egress_port
+	bit<8> psa_egress_output_metadata_drop
+}
+metadata instanceof user_meta_t
+
+header ethernet instanceof ethernet_t
+
+struct psa_ingress_output_metadata_t {
+	bit<8> class_of_service
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+	bit<8> resubmit
+	bit<32> multicast_group
+	bit<32> egress_port
+}
+
+struct psa_egress_output_metadata_t {
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+}
+
+struct psa_egress_deparser_input_metadata_t {
+	bit<32> egress_port
+}
+
+apply {
+	rx m.psa_egress_input_metadata_egress_port
+	mov m.psa_egress_output_metadata_drop 0x0
+	extract h.ethernet
+	mov h.ethernet.srcAddr 0x20000000001
+	jmpneq LABEL_DROP m.psa_egress_output_metadata_drop 0x0
+	emit h.ethernet
+	tx m.psa_egress_input_metadata_egress_port
+	LABEL_DROP : drop
+}
+
+
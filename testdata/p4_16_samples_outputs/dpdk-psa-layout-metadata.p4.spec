@@ -0,0 +1,80 @@
+
+
+struct ethernet_t {
+	bit<48> dstAddr
+	bit<48> srcAddr
+	bit<16> etherType
+}
+
+struct rewrite_arg_t {
+	bit<48> src
+}
+
+struct user_meta_t {
+	bit<48> Ingress_tbl_ethernet_dstAddr
+	bit<16> local_metadata_data
+	bit<32> psa_ingress_input_metadata_ingress_port
+	bit<32> psa_ingress_output_metadata_egress_port
+	bit<8> psa_ingress_output_metadata_drop
+}
+metadata instanceof user_meta_t
+
+header ethernet instanceof ethernet_t
+
+struct psa_ingress_output_metadata_t {
+	bit<8> class_of_service
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+	bit<8> resubmit
+	bit<32> multicast_group
+	bit<32> egress_port
+}
+
+struct psa_egress_output_metadata_t {
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+}
+
+struct psa_egress_deparser_input_metadata_t {
+	bit<32> egress_port
+}
+
+action NoAction args none {
+	return
+}
+
+action rewrite args instanceof rewrite_arg_t {
+	mov h.ethernet.srcAddr t.src
+	return
+}
+
+table tbl {
+	key {
+		m.Ingress_tbl_ethernet_dstAddr exact
+		m.local_metadata_data exact
+	}
+	actions {
+		NoAction
+		rewrite
+	}
+	default_action NoAction args none 
+	size 0x10000
+}
+
+
+apply {
+	rx m.psa_ingress_input_metadata_ingress_port
+	mov m.psa_ingress_output_metadata_drop 0x0
+	extract h.ethernet
+	mov m.local_metadata_data h.ethernet.etherType
+	mov m.Ingress_tbl_ethernet_dstAddr h.ethernet.dstAddr
+	table tbl
+	jmpneq LABEL_DROP m.psa_ingress_output_metadata_drop 0x0
+	emit h.ethernet
+	tx m.psa_ingress_output_metadata_egress_port
+	LABEL_DROP : drop
+}
+
+
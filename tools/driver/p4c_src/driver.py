@@ -12,7 +12,7 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 import os
-import shlex, subprocess
+import array, shlex, socket, struct, subprocess
 import sys
 
 import p4c_src.util as util
@@ -46,6 +46,7 @@ class BackendDriver:
         self._source_filename = None
         self._source_basename = None
         self._verbose = False
+        self._compile_server = None
 
     def __str__(self):
         return self._backend
@@ -81,6 +82,7 @@ class BackendDriver:
         """
         self._dry_run = opts.dry_run
         self._verbose = opts.debug
+        self._compile_server = opts.compile_server
         self._output_directory = opts.output_directory
         self._source_filename = opts.source_file
         self._source_basename = os.path.splitext(os.path.basename(opts.source_file))[0]
@@ -240,6 +242,11 @@ class BackendDriver:
             return 0
 
         args = shlex.split(" ".join(cmd))
+        if step == 'compiler' and self._compile_server:
+            rc = self.runOnServer(args)
+            if rc is not None:
+                return rc
+
         try:
             p = subprocess.Popen(args)
         except:
@@ -253,6 +260,41 @@ class BackendDriver:
         return p.returncode
 
 
+    def runOnServer(self, args):
+        """
+        Run a compiler command on the compile server, with the standard
+        streams and working directory of the driver.
+        Returns the exit status, or None if the server did not run it
+        """
+        sys.stdout.flush()
+        sys.stderr.flush()
+        payload = b''.join(a.encode() + b'\0' for a in [os.getcwd()] + args)
+        try:
+            with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+                s.connect(self._compile_server)
+                s.sendmsg([struct.pack('!I', len(payload))],
+                          [(socket.SOL_SOCKET, socket.SCM_RIGHTS,
+                            array.array('i', [0, 1, 2]))])
+                s.sendall(payload)
+                reply = b''
+                while len(reply) < 4:
+                    data = s.recv(4 - len(reply))
+                    if not data:
+                        break
+                    reply += data
+        except OSError as e:
+            if self._verbose:
+                print('compile server {}: {}'.format(self._compile_server, e))
+            return None
+        if len(reply) < 4 or struct.unpack('!i', reply)[0] < 0:
+            if self._verbose:
+                print('compile server {} did not run {}'.format(self._compile_server,
+                                                                args[0]))
+            return None
+        if self._verbose:
+            print('ran {} on {}'.format(' '.join(args), self._compile_server))
+        return struct.unpack('!i', reply)[0]
+
     def preRun(self, cmd_name):
         """
         Preamble to a command to setup anything needed
@@ -72,6 +72,12 @@ def main():
     parser.add_argument("-v", "--debug", dest="debug",
                         help="verbose",
                         action="store_true", default=False)
+    parser.add_argument("--server", dest="compile_server", metavar="SOCKET",
+                        help="Send the compiler step to the compile server listening on "
+                             "the Unix socket SOCKET, started with "
+                             "'<compiler> --serve SOCKET'. The compiler is run directly "
+                             "if no server for it answers.",
+                        default=None)
     parser.add_argument("-###", "--test-only", dest="dry_run",
                         help="print (but do not run) the commands",
                         action="store_true", default=False)
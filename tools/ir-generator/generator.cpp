@@ -33,6 +33,7 @@ void usage(const char* progname) {
     fprintf(stderr, "     -t file: file where the tree macro is written\n");
     fprintf(stderr, "     -h: print this message and exit\n");
     fprintf(stderr, "     -P: don't generate #line directives\n");
+    fprintf(stderr, "     -L: lay out the fields of classes to minimize padding\n");
 }
 
 int main(int argc, char* argv[]) {
@@ -41,7 +42,7 @@ int main(int argc, char* argv[]) {
     std::ostream *impl = new nullstream();
 
     while (true) {
-        int opt = getopt(argc, argv, "o:i:t:hP");
+        int opt = getopt(argc, argv, "o:i:t:hPL");
         if (opt == -1)
             break;
 
@@ -64,6 +65,9 @@ int main(int argc, char* argv[]) {
             case 'P':
                 LineDirective::inhibit = true;
                 break;
+            case 'L':
+                IrClass::packFields = true;
+                break;
             default:
                 std::cerr << "Unknown option: " << opt << std::endl;
                 usage(argv[0]);
@@ -15,10 +15,17 @@ limitations under the License.
 */
 
 #include "irclass.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
 #include "lib/exceptions.h"
 #include "lib/enumerator.h"
 
 const char* IrClass::indent = "    ";
+bool IrClass::packFields = false;
 IrNamespace& IrNamespace::global() {
     static IrNamespace irn(nullptr, nullptr);
     return irn;
@@ -101,25 +108,67 @@ Util::Enumerator<IrClass*>* IrDefinitions::getClasses() const {
             ->where([] (IrClass* e) { return e != nullptr; });
 }
 
+/// Number the node classes in preorder of the class hierarchy, so the kinds of each class
+/// and all its subclasses are a contiguous range, and IR::Node::to<T>() can test a node's
+/// class with two compares.  Kind 0 is left for nodes not generated here.
+/// @return the number of kinds
+unsigned IrDefinitions::numberKinds() const {
+    std::map<const IrClass *, std::vector<IrClass *>> children;
+    for (auto cls : *getClasses())
+        if (cls->kind == NodeKind::Abstract || cls->kind == NodeKind::Concrete)
+            children[cls->getParent()].push_back(cls);
+    unsigned next = 1;
+    std::function<void(IrClass *)> number = [&](IrClass *cls) {
+        cls->kind_first = next++;
+        for (auto child : children[cls]) number(child);
+        cls->kind_last = next - 1; };
+    for (auto cls : children[IrClass::nodeClass()]) number(cls);
+    return next;
+}
+
 void IrDefinitions::generate(std::ostream &t, std::ostream &out, std::ostream &impl) const {
+    unsigned kinds = numberKinds();
     std::string macroname = "_IR_GENERATED_H_";
     out << "#ifndef " << macroname << "\n"
         << "#define " << macroname << "\n" << std::endl;
 
     impl << "#include \"ir/ir.h\"\n"
          << "#include \"ir/visitor.h\"\n"
-         << "#include \"ir/json_loader.h\"\n" << std::endl;
+         << "#include \"ir/json_loader.h\"\n"
+         << "#include \"ir/binary_loader.h\"\n"
+         << "#include \"lib/startup_profile.h\"\n" << std::endl;
 
     out << "#include <map>\n"
         << "#include <functional>\n" << std::endl
         << "class JSONLoader;\n"
         << "using NodeFactoryFn = IR::Node*(*)(JSONLoader&);\n"
+        << "class BinaryLoader;\n"
+        << "using BinaryFactoryFn = IR::Node*(*)(BinaryLoader&);\n"
         << std::endl
         << "namespace IR {\n"
-        << "extern std::map<cstring, NodeFactoryFn> unpacker_table;\n"
+        << "/// The factories of the node classes by name, built on first use\n"
+        << "std::map<cstring, NodeFactoryFn> &unpacker_table();\n"
+        << "std::map<cstring, BinaryFactoryFn> &binary_unpacker_table();\n"
+        << "/// The number of node kinds, including kind 0 (see IR::Node::node_kind)\n"
+        << "constexpr unsigned node_kind_count = " << kinds << ";\n"
+        << "/// The kind of the base class of each kind; 0 for the direct subclasses of Node\n"
+        << "extern const unsigned short node_kind_parent[node_kind_count];\n"
+        << "/// Write the size of every node class, and how much of it is padding\n"
+        << "void writeNodeSizes(std::ostream &out);\n"
         << "}\n";
 
-    impl << "std::map<cstring, NodeFactoryFn> IR::unpacker_table = {\n";
+    std::vector<unsigned> parents(kinds, 0);
+    for (auto cls : *getClasses())
+        if (cls->kind_first) parents[cls->kind_first] = cls->getParent()->kind_first;
+    impl << "const unsigned short IR::node_kind_parent[IR::node_kind_count] = {";
+    for (unsigned k = 0; k < kinds; ++k)
+        impl << (k % 16 ? " " : "\n    ") << parents[k] << (k + 1 < kinds ? "," : "");
+    impl << " };\n" << std::endl;
+
+    // the tables are built on first use, as most compilations never load IR
+    impl << "std::map<cstring, NodeFactoryFn> &IR::unpacker_table() {\n"
+            "    static auto *rv = Util::StartupProfile::time(\"JSON node factories\", [] {\n"
+            "        return new std::map<cstring, NodeFactoryFn>({\n";
 
     bool first = true;
     for (auto cls : *getClasses()) {
@@ -132,12 +181,62 @@ void IrDefinitions::generate(std::ostream &t, std::ostream &out, std::ostream &i
             if (cls->containedIn && cls->containedIn->name)
                 impl << cls->containedIn->name << "::";
             impl << cls->name << "::fromJSON)}"; } }
-    impl << " };\n" << std::endl;
+    impl << " }); });\n    return *rv;\n}\n" << std::endl;
+
+    // The binary IR format depends on the fields of every class, so they are hashed
+    // into a schema id that binary IR files must match.
+    uint64_t schema = 0xcbf29ce484222325ULL;
+    auto hash = [&schema](cstring s) {
+        for (auto *p = s.c_str(); *p; ++p) schema = (schema ^ uint8_t(*p)) * 0x100000001b3ULL;
+        schema = (schema ^ 0xff) * 0x100000001b3ULL; };
+    impl << "std::map<cstring, BinaryFactoryFn> &IR::binary_unpacker_table() {\n"
+            "    static auto *rv = Util::StartupProfile::time(\"binary node factories\", [] {\n"
+            "        return new std::map<cstring, BinaryFactoryFn>({\n";
+    first = true;
+    for (auto cls : *getClasses()) {
+        hash(cls->name);
+        for (auto f : *cls->getFields()) {
+            hash(f->type->toString());
+            hash(f->name); }
+        if (cls->kind == NodeKind::Concrete) {
+            if (first)
+                first = false;
+            else
+                impl << ",\n";
+            impl << "{\"" << cls->name << "\", BinaryFactoryFn(&IR::";
+            if (cls->containedIn && cls->containedIn->name)
+                impl << cls->containedIn->name << "::";
+            impl << cls->name << "::fromBinary)}"; } }
+    impl << " }); });\n    return *rv;\n}\n" << std::endl;
+    impl << "const uint64_t IR::binary_schema = 0x" << std::hex << schema << std::dec
+         << "ULL;\n" << std::endl;
 
     for (auto e : elements) {
         e->generate_hdr(out);
         e->generate_impl(impl); }
 
+    // the bytes of fields are those of the public ones, as the others cannot be named here
+    impl << "void IR::writeNodeSizes(std::ostream &out) {\n"
+            "    struct { const char *name, *parent; size_t size; long over, fields; }\n"
+            "    sizes[] = {\n";
+    for (auto cls : *getClasses()) {
+        if (cls->kind != NodeKind::Abstract && cls->kind != NodeKind::Concrete) continue;
+        auto parent = cls->getParent();
+        impl << "        { \"" << cls->name << "\", \"" << parent->name << "\", sizeof("
+             << cls->fullName() << "), sizeof(" << cls->fullName() << ") - sizeof("
+             << parent->fullName() << "), 0";
+        for (auto f : *cls->getFields())
+            if (f->access == IrElement::Public)
+                impl << " + sizeof(" << cls->fullName() << "::" << f->name << ")";
+        impl << " },\n"; }
+    impl << "    };\n"
+            "    for (auto &s : sizes)\n"
+            "        out << s.name << \": \" << s.size << \" bytes, \"\n"
+            "            << s.over << \" more than \" << s.parent << \" with \" << s.fields\n"
+            "            << \" in fields and \" << s.over - s.fields << \" in padding and bases\"\n"
+            "            << std::endl;\n"
+            "}\n" << std::endl;
+
     out << "#endif /* " << macroname << " */" << std::endl;
 
     ///////////////////////////////// tree
@@ -272,6 +371,27 @@ void IrApply::generate_impl(std::ostream &out) const {
 
 ////////////////////////////////////////////////////////////////////////////////////
 
+void IrHashCons::generate_hdr(std::ostream &out) const {
+    if (clss->kind != NodeKind::Concrete)
+        throw Util::CompilationError("%1%: only concrete classes can be hash-consed", clss);
+    out << IrClass::indent << "IRNODE_DECLARE_HASHCONS(" << clss->name << ")" << std::endl;
+}
+
+void IrHashCons::generate_impl(std::ostream &out) const {
+    // hashes the same fields (including inherited ones) that operator== compares
+    out << "size_t IR::" << clss->containedIn << clss->name << "::hashcons_hash() const {"
+        << std::endl << IrClass::indent << "size_t rv = 0;" << std::endl;
+    for (auto cl = clss; cl && cl != IrClass::nodeClass(); cl = cl->getParent()) {
+        for (auto f : *cl->getFields()) {
+            if (*f->type == NamedType::SourceInfo()) continue;
+            out << IrClass::indent << "rv = hashcons_combine(rv, hashcons_field(" << f->name;
+            if (dynamic_cast<const ArrayType *>(f->type)) out << "[0]";
+            out << ", 0));" << std::endl; } }
+    out << IrClass::indent << "return rv;" << std::endl << "}" << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
 void IrClass::declare(std::ostream &out) const {
     out << "class " << name << ";" << std::endl;
 }
@@ -333,14 +453,22 @@ void IrClass::generate_hdr(std::ostream &out) const {
 
     out << " {" << std::endl;
 
+    // the fields take the places of the fields of the .def file, in the order of storage
+    auto storage = storageOrder();
+    size_t next = 0;
     auto access = IrElement::Private;
     for (auto e : elements) {
+        auto *f = e->to<IrField>();
+        if (f && !f->isStatic) e = const_cast<IrField *>(storage[next++]);
         if (e->access != access) out << (access = e->access);
         e->generate_hdr(out); }
 
     if (kind != NodeKind::Interface && kind != NodeKind::Nested)
         out << indent << "IRNODE" << (kind == NodeKind::Abstract ?  "_ABSTRACT" : "")
             << "_SUBCLASS(" << name << ")" << std::endl;
+    if (kind_first)
+        out << indent << "IRNODE_KIND(" << name << ", " << kind_first << ", " << kind_last
+            << ")" << std::endl;
 
     out << "};" << std::endl;
     if (kind != NodeKind::Nested) {
@@ -381,23 +509,28 @@ int IrClass::generateConstructor(const ctor_args_t &arglist, const IrMethod *use
     const char *sep = ":\n    ";
     auto parent = getParent() ? getParent()->qualified_name(containedIn) : cstring();
     const char *end_parent = "";
+    std::vector<const IrField *> own;
     for (auto &arg : arglist) {
         if (arg.first->optional && (skip_opt & (1U << optargs++)))
             continue;
         if (arg.second == this) {
-            body << end_parent;
-            end_parent = "";
-        } else if (parent) {
+            own.push_back(arg.first);
+            continue; }
+        if (parent) {
             body << sep << parent;
             parent = nullptr;
             sep = "(";
             end_parent = ")"; }
         body << sep << arg.first->name;
-        if (arg.second == this)
-            body << "(" << arg.first->name << ")";
+        sep = ", "; }
+    body << end_parent;
+    // in the order the fields are initialized, which is that of their storage
+    for (auto f : storageOrder()) {
+        if (std::find(own.begin(), own.end(), f) == own.end()) continue;
+        body << sep << f->name << "(" << f->name << ")";
         sep = ", "; }
 
-    body << end_parent << std::endl << indent << "{";
+    body << std::endl << indent << "{";
     if (user)
         body << '\n' << LineDirective(user->getSourceInfo()) << user->body << '\n'
              << LineDirective() << indent;
@@ -426,6 +559,45 @@ Util::Enumerator<IrField*>* IrClass::getFields() const {
             ->where([] (IrField *f) { return !f->isStatic; });
 }
 
+/// The alignment that a field of type @t (a pointer for IR classes not inlined) most likely
+/// has.  Types not known here are assumed to be as aligned as a pointer.
+static unsigned fieldAlignment(const Type *t, bool isInline, const IrNamespace *ns) {
+    static const std::map<cstring, unsigned> known = {
+        { "bool", 1 }, { "char", 1 }, { "int8_t", 1 }, { "uint8_t", 1 },
+        { "short", 2 }, { "int16_t", 2 }, { "uint16_t", 2 },
+        { "int", 4 }, { "unsigned", 4 }, { "float", 4 }, { "int32_t", 4 }, { "uint32_t", 4 } };
+    if (auto *arr = dynamic_cast<const ArrayType *>(t))
+        return fieldAlignment(arr->base, isInline, ns);
+    if (!dynamic_cast<const NamedType *>(t) || (t->resolve(ns) && !isInline))
+        return sizeof(void *);
+    auto it = known.find(t->toString());
+    return it == known.end() ? sizeof(void *) : it->second;
+}
+
+/// With -L, the fields of a class are stored from the most aligned to the least aligned
+/// so that there is as little padding between them as possible.  Only the layout changes:
+/// constructor arguments, visiting, dumps and the JSON and binary formats all keep the
+/// order of the .def file.  Classes whose fields might be initialized by code written in
+/// the .def file keep that order, as their initialization could depend on it.
+std::vector<const IrField *> IrClass::storageOrder() const {
+    std::vector<const IrField *> rv;
+    for (auto f : *getFields()) rv.push_back(f);
+    if (!packFields || kind == NodeKind::Interface) return rv;
+    for (auto e : elements) {
+        if (auto *m = e->to<IrMethod>())
+            if (m->isUser && m->name == name) return rv;
+        if (auto *emit = e->to<EmitBlock>())
+            if (emit->toString().find((name + "(").c_str())) return rv; }
+    for (auto f : rv) {
+        if (!f->initializer) continue;
+        for (auto other : rv)
+            if (other != f && f->initializer.find(other->name.c_str())) return rv; }
+    std::stable_sort(rv.begin(), rv.end(), [this](const IrField *a, const IrField *b) {
+        return fieldAlignment(a->type, a->isInline, containedIn) >
+               fieldAlignment(b->type, b->isInline, containedIn); });
+    return rv;
+}
+
 Util::Enumerator<IrMethod*>* IrClass::getUserMethods() const {
     return Util::Enumerator<IrElement*>::createEnumerator(elements)
             ->where([] (IrElement* e) { return e->is<IrMethod>(); })
@@ -170,6 +170,14 @@ class IrApply : public IrElement {
     cstring toString() const override { return "#apply"; }
 };
 
+class IrHashCons : public IrElement {
+ public:
+    explicit IrHashCons(Util::SourceInfo info) : IrElement(info) {}
+    void generate_hdr(std::ostream &out) const override;
+    void generate_impl(std::ostream &out) const override;
+    cstring toString() const override { return "#hashcons"; }
+};
+
 enum class NodeKind {
     Interface,
     Abstract,
@@ -232,9 +240,11 @@ class IrClass : public IrElement {
     mutable bool needIndexedVector = false;  // using an IndexedVecor of this class
     mutable bool needNameMap = false;   // using a NameMap of this class
     mutable bool needNodeMap = false;   // using a NodeMap of this class
+    unsigned kind_first = 0, kind_last = 0;  // node kind range of this class and subclasses
     access_t current_access = Public;   // used while parsing the class body
 
     static const char* indent;
+    static bool packFields;  // lay out fields to minimize padding (-L)
 
     IrClass(Util::SourceInfo info, IrNamespace *ns, NodeKind kind, cstring name,
             const std::initializer_list<const Type *> &parents,
@@ -271,6 +281,7 @@ class IrClass : public IrElement {
     cstring toString() const override { return name; }
     std::string fullName() const;
     Util::Enumerator<IrField*>* getFields() const;
+    std::vector<const IrField *> storageOrder() const;  // fields in the order of their storage
     Util::Enumerator<IrMethod*>* getUserMethods() const;
     cstring qualified_name(const IrNamespace *ctxt = nullptr) const;
     // name with scope qual if needed in the context
@@ -279,6 +290,7 @@ class IrClass : public IrElement {
 class IrDefinitions {
     std::vector<IrElement*> elements;
     Util::Enumerator<IrClass*>* getClasses() const;
+    unsigned numberKinds() const;
 
  public:
     explicit IrDefinitions(std::vector<IrElement*> classes) : elements(classes) {}
@@ -62,6 +62,52 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
         buf << ";" << std::endl;
         buf << cl->indent << "}";
         return buf.str(); } } },
+// generated before equiv, so that a user-defined equiv is still recognizable here
+{ "structural_hash", { &NamedType::Size_t(), {}, CONST + IN_IMPL + OVERRIDE,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        // nodes that are equiv must hash the same, so only hash the fields the generated
+        // equiv compares; a user-defined equiv (or #noequiv) may compare fewer of them
+        bool ownFields = !Util::Enumerator<IrElement*>::createEnumerator(cl->elements)
+            ->where([] (IrElement *el) {
+                auto *m = el->to<IrMethod>();
+                auto *no = el->to<IrNo>();
+                return (m && m->name == "equiv") || (no && no->text == "equiv"); })
+            ->any();
+        bool cached = Util::Enumerator<IrElement*>::createEnumerator(cl->elements)
+            ->where([] (IrElement *el) { return el->is<IrHashCons>(); })
+            ->any();
+        std::stringstream buf;
+        buf << "{" << std::endl;
+        if (cached)
+            buf << cl->indent << cl->indent << "bool cached = typeid(*this) == typeid("
+                << cl->name << ");\n"
+                << cl->indent << cl->indent << "if (cached && structural_hash_cache.get()) "
+                                               "return structural_hash_cache.get();\n";
+        buf << cl->indent << cl->indent << "size_t rv = ";
+        auto parent = cl->getParent();
+        if (parent && parent->name != "Node")
+            buf << parent->qualified_name(cl->containedIn);
+        else
+            buf << "Node";
+        buf << "::structural_hash();" << std::endl;
+        for (auto f : *cl->getFields()) {
+            if (!ownFields) break;
+            if (*f->type == NamedType::SourceInfo()) continue;
+            // equiv does not compare the elements of arrays
+            if (dynamic_cast<const ArrayType *>(f->type)) continue;
+            buf << cl->indent << cl->indent << "rv = hashcons_combine(rv, ";
+            if (f->type->resolve(cl->containedIn) == nullptr)
+                buf << "hashcons_field(" << f->name << ", 0)";
+            else if (f->isInline)
+                buf << f->name << ".structural_hash()";
+            else
+                buf << "(" << f->name << " ? " << f->name << "->structural_hash() : 0)";
+            buf << ");" << std::endl; }
+        if (cached)
+            buf << cl->indent << cl->indent << "if (cached) structural_hash_cache.set(rv);\n";
+        buf << cl->indent << cl->indent << "return rv;" << std::endl;
+        buf << cl->indent << "}";
+        return buf.str(); } } },
 { "equiv", { &NamedType::Bool(),
              { new IrField(new ReferenceType(new NamedType(IrClass::nodeClass()), true), "a_") },
              EXTEND + CONST + IN_IMPL + OVERRIDE,
@@ -223,6 +269,41 @@ const ordered_map<cstring, IrMethod::info_t> IrMethod::Generate = {
         buf << "{ return new " << cl->name << "(json); }";
         return buf.str();
     } } },
+{ "toBinary", { &NamedType::Void(), {
+        new IrField(new ReferenceType(&NamedType::BinaryGenerator()), "bin")
+    }, CONST + IN_IMPL + OVERRIDE + INCL_NESTED,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        buf << "{" << std::endl;
+        if (auto parent = cl->getParent())
+            buf << cl->indent << parent->qualified_name(cl->containedIn)
+                << "::toBinary(bin);" << std::endl;
+        for (auto f : *cl->getFields()) {
+            if (*f->type == NamedType::SourceInfo()) continue;  // written by BinaryGenerator
+            buf << cl->indent << "bin << this->" << f->name << ";" << std::endl; }
+        buf << "}";
+        return buf.str(); } } },
+{ "binary_constructor", { nullptr, {
+        new IrField(new ReferenceType(&NamedType::BinaryLoader()), "bin")
+    }, IN_IMPL + CONSTRUCTOR + INCL_NESTED,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        if (auto parent = cl->getParent())
+            buf << ": " << parent->qualified_name(cl->containedIn) << "(bin)";
+        buf << " {" << std::endl;
+        for (auto f : *cl->getFields()) {
+            if (*f->type == NamedType::SourceInfo()) continue;  // read by BinaryLoader
+            buf << cl->indent << "bin >> " << f->name << ";" << std::endl; }
+        buf << "}";
+        return buf.str(); } } },
+{ "fromBinary", { nullptr, {
+        new IrField(new ReferenceType(&NamedType::BinaryLoader()), "bin"),
+    }, FACTORY + IN_IMPL + CONCRETE_ONLY + INCL_NESTED,
+    [](IrClass *cl, Util::SourceInfo, cstring) -> cstring {
+        std::stringstream buf;
+        buf << "{ return new " << cl->name << "(bin); }";
+        return buf.str();
+    } } },
 { "toString", { &NamedType::Cstring(), {}, CONST + IN_IMPL + OVERRIDE + NOT_DEFAULT,
     [](IrClass *, Util::SourceInfo, cstring) -> cstring { return cstring(); } } },
 };
@@ -293,7 +374,7 @@ void IrClass::generateMethods() {
         if (!IrMethod::Generate.count(m->name))
             throw Util::CompilationError("Unrecognized predefined method %1%", m->name);
         auto &info = IrMethod::Generate.at(m->name);
-        if (m->name) {
+        if (!(info.flags & CONSTRUCTOR)) {
             if (info.rtype) {
                 // This predefined method has an explicit return type.
                 m->rtype = info.rtype;
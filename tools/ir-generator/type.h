@@ -90,6 +90,7 @@ class NamedType : public Type {
 
     static NamedType& Bool();
     static NamedType& Int();
+    static NamedType& Size_t();
     static NamedType& Void();
     static NamedType& Cstring();
     static NamedType& Ostream();
@@ -98,6 +99,8 @@ class NamedType : public Type {
     static NamedType& JSONGenerator();
     static NamedType& JSONLoader();
     static NamedType& JSONObject();
+    static NamedType& BinaryGenerator();
+    static NamedType& BinaryLoader();
     static NamedType& SourceInfo();
 };
 
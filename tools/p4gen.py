@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+""" Generates P4-16 programs of a given size, to find the compiler passes that do not
+    scale.  The program has:
+
+      --states     parser states, each extracting a header and choosing the next state
+      --stack      the depth of a header stack, parsed by a loop (unrolled for ebpf)
+      --tables     tables, each matching on a header field and the metadata
+      --actions    actions for each table to choose from
+      --entries    const entries in each table
+      --nesting    controls applying each other, with the tables spread among them
+
+    for the v1model, psa or ebpf_model architecture.  Used as a module, program(**sizes)
+    returns the text for the sizes given by keyword (see DEFAULTS). """
+
+import argparse
+import sys
+
+DEFAULTS = {
+    "arch": "v1model",
+    "states": 4,
+    "stack": 4,
+    "tables": 10,
+    "actions": 4,
+    "entries": 0,
+    "nesting": 1,
+}
+FIELDS = 8  # bit<32> fields in each header
+
+
+class Program:
+    def __init__(self, sizes):
+        self.__dict__.update(DEFAULTS)
+        self.__dict__.update(sizes)
+        self.states = max(self.states, 1)
+        self.nesting = max(self.nesting, 1)
+        self.lines = []
+
+    def emit(self, *lines):
+        self.lines.extend(lines)
+
+    def field(self, t):
+        """ The header field matched and set by table @t """
+        return "hdr.h%d.f%d" % (t % self.states, t // self.states % FIELDS)
+
+    def headers(self):
+        fields = " ".join("bit<32> f%d;" % f for f in range(FIELDS))
+        for h in range(self.states):
+            self.emit("header h%d_t { bit<16> nxt; %s }" % (h, fields))
+        self.emit("header s_t { bit<8> more; bit<24> data; }",
+                  "struct headers_t {")
+        for h in range(self.states):
+            self.emit("    h%d_t h%d;" % (h, h))
+        if self.stack:
+            self.emit("    s_t[%d] stack;" % self.stack)
+        self.emit("}",
+                  "struct meta_t { bit<32> acc; bit<32> key; }",
+                  "struct empty_t {}", "")
+
+    def parser(self, name, params):
+        self.emit("parser %s(%s) {" % (name, params),
+                  "    state start { transition parse_h0; }")
+        stack = "parse_stack" if self.stack else "accept"
+        for h in range(self.states):
+            nxt = "parse_h%d" % (h + 1) if h + 1 < self.states else stack
+            self.emit("    state parse_h%d {" % h,
+                      "        pkt.extract(hdr.h%d);" % h,
+                      "        transition select(hdr.h%d.nxt) {" % h,
+                      "            0: accept;")
+            if self.stack and h + 1 < self.states:
+                self.emit("            1: parse_stack;")
+            self.emit("            default: %s;" % nxt,
+                      "        }",
+                      "    }")
+        if self.stack and self.arch == "ebpf":
+            # unrolled, as the ebpf backend does not support parser loops
+            for s in range(self.stack):
+                suffix = str(s) if s else ""
+                nxt = "parse_stack%d" % (s + 1) if s + 1 < self.stack else "accept"
+                self.emit("    state parse_stack%s {" % suffix,
+                          "        pkt.extract(hdr.stack[%d]);" % s,
+                          "        transition select(hdr.stack[%d].more) {" % s,
+                          "            0: accept;",
+                          "            default: %s;" % nxt,
+                          "        }",
+                          "    }")
+        elif self.stack:
+            self.emit("    state parse_stack {",
+                      "        pkt.extract(hdr.stack.next);",
+                      "        transition select(hdr.stack.last.more) {",
+                      "            0: accept;",
+                      "            default: parse_stack;",
+                      "        }",
+                      "    }")
+        self.emit("}", "")
+
+    def table(self, t):
+        self.emit("    action set%d_0(bit<32> v) { %s = v; meta.acc = meta.acc ^ v; }"
+                  % (t, self.field(t)))
+        for a in range(1, self.actions):
+            self.emit("    action set%d_%d() { %s = %s + %d; meta.key = meta.key + %d; }"
+                      % (t, a, self.field(t), self.field(t), a, t))
+        actions = ["set%d_%d;" % (t, a) for a in range(self.actions)] + ["NoAction;"]
+        self.emit("    table t%d {" % t)
+        if self.arch == "ebpf":
+            self.emit("        key = { %s: exact; }" % self.field(t))
+        else:
+            self.emit("        key = { %s: exact; meta.key: ternary; }" % self.field(t))
+        self.emit("        actions = { %s }" % " ".join(actions))
+        if self.arch == "ebpf":
+            self.emit("        implementation = hash_table(%d);" % max(self.entries, 64))
+        else:
+            self.emit("        size = %d;" % max(self.entries, 64))
+        if self.entries:
+            self.emit("        const entries = {")
+            for e in range(self.entries):
+                key = "32w%d" % e
+                if self.arch != "ebpf":
+                    key = "(%s, 32w%d &&& 32w0xff)" % (key, e % 256)
+                action = e % self.actions
+                args = "32w%d" % (e * 7) if action == 0 else ""
+                self.emit("            %s : set%d_%d(%s);" % (key, t, action, args))
+            self.emit("        }")
+        self.emit("        default_action = NoAction();",
+                  "    }")
+
+    def applyTable(self, t):
+        h = t % self.states
+        if t % 2:
+            self.emit("        if (hdr.h%d.isValid() && t%d.apply().hit) {" % (h, t),
+                      "            meta.acc = meta.acc + 1;",
+                      "        }")
+        else:
+            self.emit("        if (hdr.h%d.isValid()) { t%d.apply(); }" % (h, t))
+
+    def controls(self):
+        """ Controls C0 ... C(nesting-1), each applying the next; table t is in C(t % nesting) """
+        for c in reversed(range(self.nesting)):
+            tables = range(c, self.tables, self.nesting)
+            self.emit("control C%d(inout headers_t hdr, inout meta_t meta) {" % c)
+            if c + 1 < self.nesting:
+                self.emit("    C%d() c%d;" % (c + 1, c + 1))
+            for t in tables:
+                self.table(t)
+            self.emit("    apply {")
+            for t in tables:
+                self.applyTable(t)
+            if c + 1 < self.nesting:
+                self.emit("        c%d.apply(hdr, meta);" % (c + 1))
+            self.emit("    }", "}", "")
+
+    def deparse(self, packet):
+        for h in range(self.states):
+            self.emit("        %s.emit(hdr.h%d);" % (packet, h))
+        if self.stack:
+            self.emit("        %s.emit(hdr.stack);" % packet)
+
+    def v1model(self):
+        self.emit("#include <core.p4>", "#include <v1model.p4>", "")
+        self.headers()
+        self.parser("P", "packet_in pkt, out headers_t hdr, inout meta_t meta, "
+                    "inout standard_metadata_t std")
+        self.controls()
+        self.emit("control I(inout headers_t hdr, inout meta_t meta, "
+                  "inout standard_metadata_t std) {",
+                  "    C0() c0;",
+                  "    apply {",
+                  "        c0.apply(hdr, meta);",
+                  "        std.egress_spec = (bit<9>)meta.acc;",
+                  "    }",
+                  "}",
+                  "control E(inout headers_t hdr, inout meta_t meta, "
+                  "inout standard_metadata_t std) { apply {} }",
+                  "control V(inout headers_t hdr, inout meta_t meta) { apply {} }",
+                  "control K(inout headers_t hdr, inout meta_t meta) { apply {} }",
+                  "control D(packet_out pkt, in headers_t hdr) {",
+                  "    apply {")
+        self.deparse("pkt")
+        self.emit("    }", "}", "", "V1Switch(P(), V(), I(), E(), K(), D()) main;")
+
+    def psa(self):
+        self.emit("#include <core.p4>", "#include <bmv2/psa.p4>", "")
+        self.headers()
+        self.parser("IP", "packet_in pkt, out headers_t hdr, inout meta_t meta, "
+                    "in psa_ingress_parser_input_metadata_t istd, in empty_t resubmit_meta, "
+                    "in empty_t recirculate_meta")
+        self.controls()
+        self.emit("control I(inout headers_t hdr, inout meta_t meta, "
+                  "in psa_ingress_input_metadata_t istd, "
+                  "inout psa_ingress_output_metadata_t ostd) {",
+                  "    C0() c0;",
+                  "    apply {",
+                  "        c0.apply(hdr, meta);",
+                  "        send_to_port(ostd, (PortId_t)meta.acc);",
+                  "    }",
+                  "}",
+                  "control ID(packet_out pkt, out empty_t clone_i2e_meta, "
+                  "out empty_t resubmit_meta, out empty_t normal_meta, inout headers_t hdr, "
+                  "in meta_t meta, in psa_ingress_output_metadata_t istd) {",
+                  "    apply {")
+        self.deparse("pkt")
+        self.emit("    }", "}",
+                  "parser EP(packet_in pkt, out headers_t hdr, inout meta_t meta, "
+                  "in psa_egress_parser_input_metadata_t istd, in empty_t normal_meta, "
+                  "in empty_t clone_i2e_meta, in empty_t clone_e2e_meta) {",
+                  "    state start { transition accept; }",
+                  "}",
+                  "control E(inout headers_t hdr, inout meta_t meta, "
+                  "in psa_egress_input_metadata_t istd, "
+                  "inout psa_egress_output_metadata_t ostd) { apply {} }",
+                  "control ED(packet_out pkt, out empty_t clone_e2e_meta, "
+                  "out empty_t recirculate_meta, inout headers_t hdr, in meta_t meta, "
+                  "in psa_egress_output_metadata_t istd, "
+                  "in psa_egress_deparser_input_metadata_t edstd) {",
+                  "    apply {")
+        self.deparse("pkt")
+        self.emit("    }", "}", "",
+                  "IngressPipeline(IP(), I(), ID()) ip;",
+                  "EgressPipeline(EP(), E(), ED()) ep;",
+                  "PSA_Switch(ip, PacketReplicationEngine(), ep, BufferingQueueingEngine()) main;")
+
+    def ebpf(self):
+        self.emit("#include <core.p4>", "#include <ebpf_model.p4>", "")
+        self.headers()
+        self.parser("prs", "packet_in pkt, out headers_t hdr")
+        self.controls()
+        self.emit("control pipe(inout headers_t hdr, out bool pass) {",
+                  "    C0() c0;",
+                  "    meta_t meta;",
+                  "    apply {",
+                  "        meta.acc = 0;",
+                  "        meta.key = 0;",
+                  "        c0.apply(hdr, meta);",
+                  "        pass = meta.acc != 0;",
+                  "    }",
+                  "}", "",
+                  "ebpfFilter(prs(), pipe()) main;")
+
+    def text(self):
+        getattr(self, self.arch)()
+        return "\n".join(self.lines) + "\n"
+
+
+def program(**sizes):
+    if sizes.get("arch", DEFAULTS["arch"]) not in ("v1model", "psa", "ebpf"):
+        raise ValueError("unknown architecture " + sizes["arch"])
+    return Program(sizes).text()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--arch", choices=["v1model", "psa", "ebpf"], default="v1model")
+    for size, default in DEFAULTS.items():
+        if size != "arch":
+            parser.add_argument("--" + size, type=int, default=default,
+                                help="(default: %d)" % default)
+    parser.add_argument("-o", "--output", help="write the program here, not to stdout")
+    args = vars(parser.parse_args())
+    output = args.pop("output")
+    text = program(**args)
+    if output:
+        with open(output, "w") as out:
+            out.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()